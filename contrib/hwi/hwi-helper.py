@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+# Copyright (c) 2023 The Qtum Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Long-lived HWI helper for qtumd and qtum-qt.
+
+Runs the HWI commands it reads from its standard input, so that the interpreter and HWI
+are loaded once instead of for every hardware wallet operation. Requests and responses are
+framed as the decimal length in bytes of the payload on its own line, followed by the payload.
+A request is a JSON array with the command line arguments of HWI, and the response is the
+JSON result HWI prints for them. The helper exits when its standard input is closed.
+
+Usage: hwi-helper.py <path to hwi.py>
+"""
+
+import json
+import os
+import sys
+from contextlib import redirect_stdout
+
+
+def read_frame(stream):
+    line = stream.readline()
+    if not line:
+        return None
+    length = int(line)
+    data = stream.read(length)
+    if len(data) != length:
+        return None
+    return data
+
+
+def write_frame(stream, data):
+    stream.write(str(len(data)).encode() + b"\n" + data)
+    stream.flush()
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__, file=sys.stderr)
+        sys.exit(1)
+
+    sys.path.insert(0, os.path.dirname(os.path.abspath(sys.argv[1])))
+    try:
+        from hwilib._cli import process_commands
+    except ImportError:
+        from hwilib.cli import process_commands
+
+    stdin = sys.stdin.buffer
+    stdout = sys.stdout.buffer
+    while True:
+        request = read_frame(stdin)
+        if request is None:
+            break
+        try:
+            # The standard output carries the frames, what HWI prints goes to the standard error
+            with redirect_stdout(sys.stderr):
+                result = process_commands(json.loads(request))
+        except SystemExit as e:
+            result = {"error": "Invalid command: {}".format(e), "code": -1}
+        except Exception as e:
+            result = {"error": str(e), "code": -13}
+        write_frame(stdout, json.dumps(result).encode())
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+# Copyright (c) 2017-2022 The Qtum Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Convert the VM log segments written with -record-log-opcodes to the JSON document of vmExecLogs.json.
+
+Usage: vmlog-to-json.py <datadir>/vmlogs [output.json]
+
+The records are streamed, so the log does not need to fit in memory. Without an output file the
+document is written to stdout.
+"""
+
+import re
+import sys
+from pathlib import Path
+
+SEGMENT_RE = re.compile(r"^vmlog_(\d+)\.ndjson$")
+
+
+def segments(vmlogs_dir):
+    found = []
+    for path in Path(vmlogs_dir).iterdir():
+        match = SEGMENT_RE.match(path.name)
+        if match:
+            found.append((int(match.group(1)), path))
+    return [path for _, path in sorted(found)]
+
+
+def convert(vmlogs_dir, out):
+    out.write('{"logs":[')
+    first = True
+    for path in segments(vmlogs_dir):
+        with open(path, encoding="utf8") as segment:
+            for line in segment:
+                line = line.strip()
+                # A record cut short by a crash is the last line of its segment
+                if not line or not line.endswith("}"):
+                    continue
+                if not first:
+                    out.write(",")
+                out.write(line)
+                first = False
+    out.write("]}")
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        sys.exit(__doc__)
+    if len(sys.argv) == 3:
+        with open(sys.argv[2], "w", encoding="utf8") as out:
+            convert(sys.argv[1], out)
+    else:
+        convert(sys.argv[1], sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -208,17 +208,16 @@ void AddrManImpl::Serialize(Stream& s_) const
         }
     }
     for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
+        uint64_t positions = m_new_occupancy.Positions(bucket);
         int nSize = 0;
-        for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
-            if (vvNew[bucket][i] != -1)
-                nSize++;
+        for (uint64_t rest = positions; rest != 0; rest &= rest - 1) {
+            nSize++;
         }
         s << nSize;
-        for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
-            if (vvNew[bucket][i] != -1) {
-                int nIndex = mapUnkIds[vvNew[bucket][i]];
-                s << nIndex;
-            }
+        for (; positions != 0; positions &= positions - 1) {
+            const int i = CountBits(positions & (~positions + 1)) - 1;
+            int nIndex = mapUnkIds[vvNew[bucket][i]];
+            s << nIndex;
         }
     }
     // Store asmap checksum after bucket entries so that it
@@ -309,7 +308,7 @@ void AddrManImpl::Unserialize(Stream& s_)
             vRandom.push_back(nIdCount);
             mapInfo[nIdCount] = info;
             mapAddr[info] = nIdCount;
-            vvTried[nKBucket][nKBucketPos] = nIdCount;
+            SetTriedPos(nKBucket, nKBucketPos, nIdCount);
             nIdCount++;
             m_network_counts[info.GetNetwork()].n_tried++;
         } else {
@@ -366,7 +365,7 @@ void AddrManImpl::Unserialize(Stream& s_)
         int bucket_position = info.GetBucketPosition(nKey, true, bucket);
         if (restore_bucketing && vvNew[bucket][bucket_position] == -1) {
             // Bucketing has not changed, using existing bucket positions for the new table
-            vvNew[bucket][bucket_position] = entry_index;
+            SetNewPos(bucket, bucket_position, entry_index);
             ++info.nRefCount;
         } else {
             // In case the new table data cannot be used (bucket count wrong or new asmap),
@@ -374,7 +373,7 @@ void AddrManImpl::Unserialize(Stream& s_)
             bucket = info.GetNewBucket(nKey, m_netgroupman);
             bucket_position = info.GetBucketPosition(nKey, true, bucket);
             if (vvNew[bucket][bucket_position] == -1) {
-                vvNew[bucket][bucket_position] = entry_index;
+                SetNewPos(bucket, bucket_position, entry_index);
                 ++info.nRefCount;
             }
         }
@@ -475,6 +474,30 @@ void AddrManImpl::Delete(int nId)
     nNew--;
 }
 
+void AddrManImpl::SetNewPos(int bucket, int pos, int nId)
+{
+    AssertLockHeld(cs);
+
+    vvNew[bucket][pos] = nId;
+    if (nId == -1) {
+        m_new_occupancy.Clear(bucket, pos);
+    } else {
+        m_new_occupancy.Set(bucket, pos);
+    }
+}
+
+void AddrManImpl::SetTriedPos(int bucket, int pos, int nId)
+{
+    AssertLockHeld(cs);
+
+    vvTried[bucket][pos] = nId;
+    if (nId == -1) {
+        m_tried_occupancy.Clear(bucket, pos);
+    } else {
+        m_tried_occupancy.Set(bucket, pos);
+    }
+}
+
 void AddrManImpl::ClearNew(int nUBucket, int nUBucketPos)
 {
     AssertLockHeld(cs);
@@ -485,7 +508,7 @@ void AddrManImpl::ClearNew(int nUBucket, int nUBucketPos)
         AddrInfo& infoDelete = mapInfo[nIdDelete];
         assert(infoDelete.nRefCount > 0);
         infoDelete.nRefCount--;
-        vvNew[nUBucket][nUBucketPos] = -1;
+        SetNewPos(nUBucket, nUBucketPos, -1);
         LogPrint(BCLog::ADDRMAN, "Removed %s from new[%i][%i]\n", infoDelete.ToStringAddrPort(), nUBucket, nUBucketPos);
         if (infoDelete.nRefCount == 0) {
             Delete(nIdDelete);
@@ -503,7 +526,7 @@ void AddrManImpl::MakeTried(AddrInfo& info, int nId)
         const int bucket{(start_bucket + n) % ADDRMAN_NEW_BUCKET_COUNT};
         const int pos{info.GetBucketPosition(nKey, true, bucket)};
         if (vvNew[bucket][pos] == nId) {
-            vvNew[bucket][pos] = -1;
+            SetNewPos(bucket, pos, -1);
             info.nRefCount--;
             if (info.nRefCount == 0) break;
         }
@@ -526,7 +549,7 @@ void AddrManImpl::MakeTried(AddrInfo& info, int nId)
 
         // Remove the to-be-evicted item from the tried set.
         infoOld.fInTried = false;
-        vvTried[nKBucket][nKBucketPos] = -1;
+        SetTriedPos(nKBucket, nKBucketPos, -1);
         nTried--;
         m_network_counts[infoOld.GetNetwork()].n_tried--;
 
@@ -538,7 +561,7 @@ void AddrManImpl::MakeTried(AddrInfo& info, int nId)
 
         // Enter it into the new set again.
         infoOld.nRefCount = 1;
-        vvNew[nUBucket][nUBucketPos] = nIdEvict;
+        SetNewPos(nUBucket, nUBucketPos, nIdEvict);
         nNew++;
         m_network_counts[infoOld.GetNetwork()].n_new++;
         LogPrint(BCLog::ADDRMAN, "Moved %s from tried[%i][%i] to new[%i][%i] to make space\n",
@@ -546,7 +569,7 @@ void AddrManImpl::MakeTried(AddrInfo& info, int nId)
     }
     assert(vvTried[nKBucket][nKBucketPos] == -1);
 
-    vvTried[nKBucket][nKBucketPos] = nId;
+    SetTriedPos(nKBucket, nKBucketPos, nId);
     nTried++;
     info.fInTried = true;
     m_network_counts[info.GetNetwork()].n_tried++;
@@ -616,7 +639,7 @@ bool AddrManImpl::AddSingle(const CAddress& addr, const CNetAddr& source, std::c
         if (fInsert) {
             ClearNew(nUBucket, nUBucketPos);
             pinfo->nRefCount++;
-            vvNew[nUBucket][nUBucketPos] = nId;
+            SetNewPos(nUBucket, nUBucketPos, nId);
             LogPrint(BCLog::ADDRMAN, "Added %s mapped to AS%i to new[%i][%i]\n",
                      addr.ToStringAddrPort(), m_netgroupman.GetMappedAS(addr), nUBucket, nUBucketPos);
         } else {
@@ -728,19 +751,12 @@ std::pair<CAddress, NodeSeconds> AddrManImpl::Select_(bool newOnly) const
         // use a tried node
         double fChanceFactor = 1.0;
         while (1) {
-            // Pick a tried bucket, and an initial position in that bucket.
-            int nKBucket = insecure_rand.randrange(ADDRMAN_TRIED_BUCKET_COUNT);
+            // Pick a non-empty tried bucket, and an initial position in that bucket.
+            int nKBucket = m_tried_occupancy.UsedBucket(insecure_rand.randrange(m_tried_occupancy.UsedBuckets()));
             int nKBucketPos = insecure_rand.randrange(ADDRMAN_BUCKET_SIZE);
-            // Iterate over the positions of that bucket, starting at the initial one,
-            // and looping around.
-            int i;
-            for (i = 0; i < ADDRMAN_BUCKET_SIZE; ++i) {
-                if (vvTried[nKBucket][(nKBucketPos + i) % ADDRMAN_BUCKET_SIZE] != -1) break;
-            }
-            // If the bucket is entirely empty, start over with a (likely) different one.
-            if (i == ADDRMAN_BUCKET_SIZE) continue;
-            // Find the entry to return.
-            int nId = vvTried[nKBucket][(nKBucketPos + i) % ADDRMAN_BUCKET_SIZE];
+            // Find the entry to return: the first one of that bucket, starting at the initial
+            // position, and looping around.
+            int nId = vvTried[nKBucket][m_tried_occupancy.FindUsed(nKBucket, nKBucketPos)];
             const auto it_found{mapInfo.find(nId)};
             assert(it_found != mapInfo.end());
             const AddrInfo& info{it_found->second};
@@ -756,19 +772,12 @@ std::pair<CAddress, NodeSeconds> AddrManImpl::Select_(bool newOnly) const
         // use a new node
         double fChanceFactor = 1.0;
         while (1) {
-            // Pick a new bucket, and an initial position in that bucket.
-            int nUBucket = insecure_rand.randrange(ADDRMAN_NEW_BUCKET_COUNT);
+            // Pick a non-empty new bucket, and an initial position in that bucket.
+            int nUBucket = m_new_occupancy.UsedBucket(insecure_rand.randrange(m_new_occupancy.UsedBuckets()));
             int nUBucketPos = insecure_rand.randrange(ADDRMAN_BUCKET_SIZE);
-            // Iterate over the positions of that bucket, starting at the initial one,
-            // and looping around.
-            int i;
-            for (i = 0; i < ADDRMAN_BUCKET_SIZE; ++i) {
-                if (vvNew[nUBucket][(nUBucketPos + i) % ADDRMAN_BUCKET_SIZE] != -1) break;
-            }
-            // If the bucket is entirely empty, start over with a (likely) different one.
-            if (i == ADDRMAN_BUCKET_SIZE) continue;
-            // Find the entry to return.
-            int nId = vvNew[nUBucket][(nUBucketPos + i) % ADDRMAN_BUCKET_SIZE];
+            // Find the entry to return: the first one of that bucket, starting at the initial
+            // position, and looping around.
+            int nId = vvNew[nUBucket][m_new_occupancy.FindUsed(nUBucket, nUBucketPos)];
             const auto it_found{mapInfo.find(nId)};
             assert(it_found != mapInfo.end());
             const AddrInfo& info{it_found->second};
@@ -1061,6 +1070,8 @@ int AddrManImpl::CheckAddrman() const
 
     for (int n = 0; n < ADDRMAN_TRIED_BUCKET_COUNT; n++) {
         for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
+            if ((vvTried[n][i] != -1) != bool((m_tried_occupancy.Positions(n) >> i) & 1))
+                return -22;
             if (vvTried[n][i] != -1) {
                 if (!setTried.count(vvTried[n][i]))
                     return -11;
@@ -1078,6 +1089,8 @@ int AddrManImpl::CheckAddrman() const
 
     for (int n = 0; n < ADDRMAN_NEW_BUCKET_COUNT; n++) {
         for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
+            if ((vvNew[n][i] != -1) != bool((m_new_occupancy.Positions(n) >> i) & 1))
+                return -23;
             if (vvNew[n][i] != -1) {
                 if (!mapNew.count(vvNew[n][i]))
                     return -12;
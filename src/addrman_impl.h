@@ -15,6 +15,9 @@
 #include <uint256.h>
 #include <util/time.h>
 
+#include <crypto/common.h>
+
+#include <algorithm>
 #include <cstdint>
 #include <optional>
 #include <set>
@@ -99,6 +102,63 @@ public:
     double GetChance(NodeSeconds now = Now<NodeSeconds>()) const;
 };
 
+/**
+ * Which positions of the buckets of a table are used, one bit per position, and which buckets
+ * are not empty. Selecting a random entry and scanning a table then only look at the used
+ * buckets and positions, however empty the table is.
+ */
+template <int BUCKET_COUNT>
+class BucketOccupancy
+{
+    static_assert(ADDRMAN_BUCKET_SIZE == 64, "a bucket is one 64-bit word");
+
+    //! The used positions of every bucket
+    uint64_t m_positions[BUCKET_COUNT]{};
+    //! The buckets with a used position, in no particular order
+    std::vector<int> m_used_buckets;
+    //! Index of every bucket in m_used_buckets, -1 for an empty bucket
+    int m_used_index[BUCKET_COUNT];
+
+public:
+    BucketOccupancy() { std::fill(std::begin(m_used_index), std::end(m_used_index), -1); }
+
+    void Set(int bucket, int pos)
+    {
+        if (m_positions[bucket] == 0) {
+            m_used_index[bucket] = m_used_buckets.size();
+            m_used_buckets.push_back(bucket);
+        }
+        m_positions[bucket] |= uint64_t{1} << pos;
+    }
+
+    void Clear(int bucket, int pos)
+    {
+        if (m_positions[bucket] == 0) return;
+        m_positions[bucket] &= ~(uint64_t{1} << pos);
+        if (m_positions[bucket] != 0) return;
+        // Move the last used bucket in its place
+        const int index = m_used_index[bucket];
+        m_used_buckets[index] = m_used_buckets.back();
+        m_used_index[m_used_buckets[index]] = index;
+        m_used_buckets.pop_back();
+        m_used_index[bucket] = -1;
+    }
+
+    uint64_t Positions(int bucket) const { return m_positions[bucket]; }
+
+    size_t UsedBuckets() const { return m_used_buckets.size(); }
+
+    int UsedBucket(size_t index) const { return m_used_buckets[index]; }
+
+    //! The first used position of a non-empty bucket at or after @p pos, looping around
+    int FindUsed(int bucket, int pos) const
+    {
+        const uint64_t positions = m_positions[bucket];
+        const uint64_t rotated = pos == 0 ? positions : (positions >> pos) | (positions << (ADDRMAN_BUCKET_SIZE - pos));
+        return (pos + CountBits(rotated & (~rotated + 1)) - 1) % ADDRMAN_BUCKET_SIZE;
+    }
+};
+
 class AddrManImpl
 {
 public:
@@ -197,12 +257,18 @@ private:
     //! list of "tried" buckets
     int vvTried[ADDRMAN_TRIED_BUCKET_COUNT][ADDRMAN_BUCKET_SIZE] GUARDED_BY(cs);
 
+    //! used positions of vvTried
+    BucketOccupancy<ADDRMAN_TRIED_BUCKET_COUNT> m_tried_occupancy GUARDED_BY(cs);
+
     //! number of (unique) "new" entries
     int nNew GUARDED_BY(cs){0};
 
     //! list of "new" buckets
     int vvNew[ADDRMAN_NEW_BUCKET_COUNT][ADDRMAN_BUCKET_SIZE] GUARDED_BY(cs);
 
+    //! used positions of vvNew
+    BucketOccupancy<ADDRMAN_NEW_BUCKET_COUNT> m_new_occupancy GUARDED_BY(cs);
+
     //! last time Good was called (memory only). Initially set to 1 so that "never" is strictly worse.
     NodeSeconds m_last_good GUARDED_BY(cs){1s};
 
@@ -235,6 +301,12 @@ private:
     //! Delete an entry. It must not be in tried, and have refcount 0.
     void Delete(int nId) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    //! Store an entry (-1 for none) at a position of the "new" table, and keep its occupancy up to date.
+    void SetNewPos(int bucket, int pos, int nId) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    //! Store an entry (-1 for none) at a position of the "tried" table, and keep its occupancy up to date.
+    void SetTriedPos(int bucket, int pos, int nId) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     //! Clear a position in a "new" table. This is the only place where entries are actually deleted.
     void ClearNew(int nUBucket, int nUBucketPos) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
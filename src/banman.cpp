@@ -12,6 +12,9 @@
 #include <util/time.h>
 #include <util/translation.h>
 
+#include <algorithm>
+#include <optional>
+
 
 BanMan::BanMan(fs::path ban_file, CClientUIInterface* client_interface, int64_t default_ban_time)
     : m_client_interface(client_interface), m_ban_db(std::move(ban_file)), m_default_ban_time(default_ban_time)
@@ -42,6 +45,7 @@ void BanMan::LoadBanlist()
         m_banned = {};
         m_is_dirty = true;
     }
+    m_index_stale = true;
 }
 
 void BanMan::DumpBanlist()
@@ -73,6 +77,7 @@ void BanMan::ClearBanned()
         LOCK(m_cs_banned);
         m_banned.clear();
         m_is_dirty = true;
+        m_index_stale = true;
     }
     DumpBanlist(); //store banlist to disk
     if (m_client_interface) m_client_interface->BannedListChanged();
@@ -84,18 +89,99 @@ bool BanMan::IsDiscouraged(const CNetAddr& net_addr)
     return m_discouraged.contains(net_addr.GetAddrBytes());
 }
 
-bool BanMan::IsBanned(const CNetAddr& net_addr)
+/** Key of an address in the index of the banned addresses: its network followed by its bytes */
+static std::optional<std::vector<unsigned char>> BanIndexKey(const CNetAddr& addr)
 {
-    auto current_time = GetTime();
-    LOCK(m_cs_banned);
-    for (const auto& it : m_banned) {
-        CSubNet sub_net = it.first;
-        CBanEntry ban_entry = it.second;
+    // Like CSubNet::Match(), the subnets only contain addresses of their own network
+    uint8_t network;
+    if (addr.IsIPv4()) {
+        network = NET_IPV4;
+    } else if (addr.IsIPv6()) {
+        network = NET_IPV6;
+    } else if (addr.IsTor()) {
+        network = NET_ONION;
+    } else if (addr.IsI2P()) {
+        network = NET_I2P;
+    } else if (addr.IsCJDNS()) {
+        network = NET_CJDNS;
+    } else {
+        return std::nullopt;
+    }
+    std::vector<unsigned char> key{network};
+    const std::vector<unsigned char> bytes{addr.GetAddrBytes()};
+    key.insert(key.end(), bytes.begin(), bytes.end());
+    return key;
+}
 
-        if (current_time < ban_entry.nBanUntil && sub_net.Match(net_addr)) {
-            return true;
+/** The bits of an IP address in a key of BanIndexKey(), an IPv4 address is serialized as IPv4-mapped IPv6 */
+static Span<const unsigned char> IPBits(const std::vector<unsigned char>& key, bool ipv4)
+{
+    return Span<const unsigned char>{key}.subspan(ipv4 ? 1 + 12 : 1);
+}
+
+void BanMan::SubnetTrie::Insert(Span<const unsigned char> prefix, unsigned int prefix_bits, int64_t ban_until)
+{
+    uint32_t node{0};
+    for (unsigned int i = 0; i < prefix_bits; ++i) {
+        const int bit = (prefix[i / 8] >> (7 - i % 8)) & 1;
+        if (!m_nodes[node].children[bit]) {
+            m_nodes[node].children[bit] = m_nodes.size();
+            m_nodes.emplace_back();
+        }
+        node = m_nodes[node].children[bit];
+    }
+    m_nodes[node].ban_until = std::max(m_nodes[node].ban_until, ban_until);
+}
+
+bool BanMan::SubnetTrie::Match(Span<const unsigned char> addr, int64_t now) const
+{
+    uint32_t node{0};
+    for (unsigned int i = 0; i < addr.size() * 8; ++i) {
+        if (now < m_nodes[node].ban_until) return true;
+        node = m_nodes[node].children[(addr[i / 8] >> (7 - i % 8)) & 1];
+        if (!node) return false;
+    }
+    return now < m_nodes[node].ban_until;
+}
+
+void BanMan::IndexBanned()
+{
+    AssertLockHeld(m_cs_banned);
+
+    m_banned_addrs.clear();
+    m_banned_ipv4_subnets.Clear();
+    m_banned_ipv6_subnets.Clear();
+    for (const auto& [sub_net, ban_entry] : m_banned) {
+        if (!sub_net.IsValid()) continue;
+        const CNetAddr& base = sub_net.GetBaseAddress();
+        std::optional<std::vector<unsigned char>> key{BanIndexKey(base)};
+        if (!key) continue;
+        const bool ipv4{base.IsIPv4()};
+        if ((ipv4 || base.IsIPv6()) && sub_net.GetPrefixLength() < IPBits(*key, ipv4).size() * 8) {
+            SubnetTrie& trie = ipv4 ? m_banned_ipv4_subnets : m_banned_ipv6_subnets;
+            trie.Insert(IPBits(*key, ipv4), sub_net.GetPrefixLength(), ban_entry.nBanUntil);
+        } else {
+            m_banned_addrs[std::move(*key)] = ban_entry.nBanUntil;
         }
     }
+    m_index_stale = false;
+}
+
+bool BanMan::IsBanned(const CNetAddr& net_addr)
+{
+    auto current_time = GetTime();
+    LOCK(m_cs_banned);
+    if (m_index_stale) IndexBanned();
+    if (!net_addr.IsValid()) return false;
+    const std::optional<std::vector<unsigned char>> key{BanIndexKey(net_addr)};
+    if (!key) return false;
+
+    // One lookup for the bans of single addresses, the more common ones, and a walk along the bits of an IP
+    // address for the subnets
+    const auto it = m_banned_addrs.find(*key);
+    if (it != m_banned_addrs.end() && current_time < it->second) return true;
+    if (net_addr.IsIPv4()) return m_banned_ipv4_subnets.Match(IPBits(*key, /*ipv4=*/true), current_time);
+    if (net_addr.IsIPv6()) return m_banned_ipv6_subnets.Match(IPBits(*key, /*ipv4=*/false), current_time);
     return false;
 }
 
@@ -142,6 +228,7 @@ void BanMan::Ban(const CSubNet& sub_net, int64_t ban_time_offset, bool since_uni
         if (m_banned[sub_net].nBanUntil < ban_entry.nBanUntil) {
             m_banned[sub_net] = ban_entry;
             m_is_dirty = true;
+            m_index_stale = true;
         } else
             return;
     }
@@ -163,6 +250,7 @@ bool BanMan::Unban(const CSubNet& sub_net)
         LOCK(m_cs_banned);
         if (m_banned.erase(sub_net) == 0) return false;
         m_is_dirty = true;
+        m_index_stale = true;
     }
     if (m_client_interface) m_client_interface->BannedListChanged();
     DumpBanlist(); //store banlist to disk immediately
@@ -190,6 +278,7 @@ void BanMan::SweepBanned()
         if (!sub_net.IsValid() || now > ban_entry.nBanUntil) {
             m_banned.erase(it++);
             m_is_dirty = true;
+            m_index_stale = true;
             notify_ui = true;
             LogPrint(BCLog::NET, "Removed banned node address/subnet: %s\n", sub_net.ToString());
         } else {
@@ -8,12 +8,16 @@
 #include <addrdb.h>
 #include <common/bloom.h>
 #include <net_types.h> // For banmap_t
+#include <span.h>
 #include <sync.h>
+#include <util/bytevectorhash.h>
 #include <util/fs.h>
 
 #include <chrono>
 #include <cstdint>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static constexpr unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24; // Default 24-hour ban
@@ -80,6 +84,24 @@ public:
     void DumpBanlist();
 
 private:
+    /** Binary trie of the ban times of the subnets of an IP network, walked along the bits of an address */
+    class SubnetTrie
+    {
+        struct Node {
+            uint32_t children[2]{0, 0};
+            int64_t ban_until{0};
+        };
+        std::vector<Node> m_nodes{1};
+
+    public:
+        void Insert(Span<const unsigned char> prefix, unsigned int prefix_bits, int64_t ban_until);
+        //! Whether a subnet containing addr is banned at the given time
+        bool Match(Span<const unsigned char> addr, int64_t now) const;
+        void Clear() { m_nodes.assign(1, Node{}); }
+    };
+
+    //! Rebuild the indexes of m_banned used to match addresses
+    void IndexBanned() EXCLUSIVE_LOCKS_REQUIRED(m_cs_banned);
     void LoadBanlist() EXCLUSIVE_LOCKS_REQUIRED(!m_cs_banned);
     bool BannedSetIsDirty();
     //!set the "dirty" flag for the banlist
@@ -90,6 +112,13 @@ private:
     RecursiveMutex m_cs_banned;
     banmap_t m_banned GUARDED_BY(m_cs_banned);
     bool m_is_dirty GUARDED_BY(m_cs_banned){false};
+    //! Whether m_banned changed since the indexes below were built
+    bool m_index_stale GUARDED_BY(m_cs_banned){true};
+    //! Ban times of the single addresses (including those of Tor, I2P and CJDNS) by network and address bytes
+    std::unordered_map<std::vector<unsigned char>, int64_t, ByteVectorHash> m_banned_addrs GUARDED_BY(m_cs_banned);
+    //! Ban times of the IPv4 and IPv6 subnets wider than a single address
+    SubnetTrie m_banned_ipv4_subnets GUARDED_BY(m_cs_banned);
+    SubnetTrie m_banned_ipv6_subnets GUARDED_BY(m_cs_banned);
     CClientUIInterface* m_client_interface = nullptr;
     CBanDB m_ban_db;
     const int64_t m_default_ban_time;
@@ -4,8 +4,10 @@
 
 #include <addrman.h>
 #include <bench/bench.h>
+#include <clientversion.h>
 #include <netgroup.h>
 #include <random.h>
+#include <streams.h>
 #include <util/check.h>
 #include <util/time.h>
 
@@ -95,6 +97,19 @@ static void AddrManSelect(benchmark::Bench& bench)
     });
 }
 
+static void AddrManSelectFromAlmostEmpty(benchmark::Bench& bench)
+{
+    AddrMan addrman{EMPTY_NETGROUPMAN, /*deterministic=*/false, ADDRMAN_CONSISTENCY_CHECK_RATIO};
+
+    // Add one address to the new table, almost all of its buckets are empty
+    CreateAddresses();
+    addrman.Add({g_addresses[0][0]}, g_sources[0]);
+
+    bench.run([&] {
+        (void)addrman.Select();
+    });
+}
+
 static void AddrManGetAddr(benchmark::Bench& bench)
 {
     AddrMan addrman{EMPTY_NETGROUPMAN, /*deterministic=*/false, ADDRMAN_CONSISTENCY_CHECK_RATIO};
@@ -133,7 +148,23 @@ static void AddrManAddThenGood(benchmark::Bench& bench)
     });
 }
 
+static void AddrManSerialize(benchmark::Bench& bench)
+{
+    AddrMan addrman{EMPTY_NETGROUPMAN, /*deterministic=*/false, ADDRMAN_CONSISTENCY_CHECK_RATIO};
+
+    FillAddrMan(addrman);
+
+    bench.run([&] {
+        // As when peers.dat is written
+        CDataStream stream{SER_DISK, CLIENT_VERSION};
+        stream << addrman;
+        assert(stream.size() > 0);
+    });
+}
+
 BENCHMARK(AddrManAdd, benchmark::PriorityLevel::HIGH);
 BENCHMARK(AddrManSelect, benchmark::PriorityLevel::HIGH);
+BENCHMARK(AddrManSelectFromAlmostEmpty, benchmark::PriorityLevel::HIGH);
 BENCHMARK(AddrManGetAddr, benchmark::PriorityLevel::HIGH);
 BENCHMARK(AddrManAddThenGood, benchmark::PriorityLevel::HIGH);
+BENCHMARK(AddrManSerialize, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,59 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <libdevcore/CommonData.h>
+#include <libdevcrypto/LibSnark.h>
+
+#include <cassert>
+#include <string>
+
+// The generators of G1 and G2, and the negated generator of G1, as encoded in the precompile input
+static const std::string G1 = "0000000000000000000000000000000000000000000000000000000000000001"
+                              "0000000000000000000000000000000000000000000000000000000000000002";
+static const std::string G1_NEG = "0000000000000000000000000000000000000000000000000000000000000001"
+                                  "30644e72e131a029b85045b68181585d97816a916871ca8d3c208c16d87cfd45";
+static const std::string G2 = "198e9393920d483a7260bfb731fb5d25f1aa493335a9e71297e485b7aef312c2"
+                              "1800deef121f1e76426a00665e5c4479674322d4f75edadd46debd5cd992f6ed"
+                              "090689d0585ff075ec9e99ad690c3395bc4b313370b38ef355acdadcd122975b"
+                              "12c85ea5db8c6deb4aab71808dcb408fe3d1e7690c43d37b4ce6cc0166fa7daa";
+
+static void PairingProduct(benchmark::Bench& bench, int pairs)
+{
+    std::string input;
+    for (int i = 0; i < pairs; ++i) {
+        input += (i % 2 ? G1_NEG : G1) + G2;
+    }
+    const dev::bytes in = dev::fromHex(input);
+    bench.run([&] {
+        std::pair<bool, dev::bytes> ret = dev::crypto::alt_bn128_pairing_product(dev::bytesConstRef(&in));
+        assert(ret.first && ret.second.back() == 1);
+    });
+}
+
+static void AltBn128PairingProduct2(benchmark::Bench& bench) { PairingProduct(bench, 2); }
+static void AltBn128PairingProduct4(benchmark::Bench& bench) { PairingProduct(bench, 4); }
+
+static void AltBn128G1Add(benchmark::Bench& bench)
+{
+    const dev::bytes in = dev::fromHex(G1 + G1_NEG);
+    bench.run([&] {
+        std::pair<bool, dev::bytes> ret = dev::crypto::alt_bn128_G1_add(dev::bytesConstRef(&in));
+        assert(ret.first);
+    });
+}
+
+static void AltBn128G1Mul(benchmark::Bench& bench)
+{
+    const dev::bytes in = dev::fromHex(G1 + "30644e72e131a029b85045b68181585d2833e84879b9709143e1f593f0000000");
+    bench.run([&] {
+        std::pair<bool, dev::bytes> ret = dev::crypto::alt_bn128_G1_mul(dev::bytesConstRef(&in));
+        assert(ret.first);
+    });
+}
+
+BENCHMARK(AltBn128PairingProduct2, benchmark::PriorityLevel::HIGH);
+BENCHMARK(AltBn128PairingProduct4, benchmark::PriorityLevel::HIGH);
+BENCHMARK(AltBn128G1Add, benchmark::PriorityLevel::HIGH);
+BENCHMARK(AltBn128G1Mul, benchmark::PriorityLevel::HIGH);
@@ -8,6 +8,7 @@
 #include <chainparams.h>
 #include <consensus/validation.h>
 #include <streams.h>
+#include <support/arena.h>
 #include <util/system.h>
 #include <validation.h>
 #include <test/util/setup_common.h>
@@ -30,6 +31,24 @@ static void DeserializeBlockTest(benchmark::Bench& bench)
     });
 }
 
+static void DeserializeBlockArenaTest(benchmark::Bench& bench)
+{
+    CDataStream stream(benchmark::data::blockbench, SER_NETWORK, PROTOCOL_VERSION);
+    std::byte a{0};
+    stream.write({&a, 1}); // Prevent compaction
+
+    bench.unit("block").run([&] {
+        CBlock block;
+        {
+            DeserializeArena arena{benchmark::data::blockbench.size()};
+            DeserializeArenaScope arena_scope{arena};
+            stream >> block;
+        }
+        bool rewound = stream.Rewind(benchmark::data::blockbench.size());
+        assert(rewound);
+    });
+}
+
 static void DeserializeAndCheckBlockTest(benchmark::Bench& bench)
 {
     CDataStream stream(benchmark::data::blockbench, SER_NETWORK, PROTOCOL_VERSION);
@@ -54,4 +73,5 @@ static void DeserializeAndCheckBlockTest(benchmark::Bench& bench)
 }
 
 BENCHMARK(DeserializeBlockTest, benchmark::PriorityLevel::HIGH);
+BENCHMARK(DeserializeBlockArenaTest, benchmark::PriorityLevel::HIGH);
 BENCHMARK(DeserializeAndCheckBlockTest, benchmark::PriorityLevel::HIGH);
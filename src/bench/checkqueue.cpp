@@ -4,6 +4,7 @@
 
 #include <bench/bench.h>
 #include <checkqueue.h>
+#include <hash.h>
 #include <key.h>
 #include <prevector.h>
 #include <pubkey.h>
@@ -65,3 +66,55 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
     ECC_Stop();
 }
 BENCHMARK(CCheckQueueSpeedPrevectorJob, benchmark::PriorityLevel::HIGH);
+
+// This Benchmark tests how the CheckQueue scales with the number of threads, with
+// checks that take about as long as hashing a signature message, submitted in the
+// small batches a block with many transactions adds.
+static void CCheckQueueScaling(benchmark::Bench& bench, int threads)
+{
+    // Running more threads than cores measures the scheduler rather than the queue.
+    if (threads > GetNumCores()) return;
+
+    struct HashJob {
+        uint256 data;
+        explicit HashJob(FastRandomContext& insecure_rand) : data(insecure_rand.rand256()) {}
+        bool operator()()
+        {
+            for (int i = 0; i < 16; ++i) {
+                data = Hash(data);
+            }
+            return true;
+        }
+    };
+    CCheckQueue<HashJob> queue{QUEUE_BATCH_SIZE};
+    // The main thread is one of the threads
+    queue.StartWorkerThreads(threads - 1);
+
+    FastRandomContext insecure_rand(true);
+    std::vector<std::vector<HashJob>> vBatches(BATCHES * 10);
+    for (auto& vChecks : vBatches) {
+        vChecks.reserve(BATCH_SIZE / 10);
+        for (size_t x = 0; x < BATCH_SIZE / 10; ++x)
+            vChecks.emplace_back(insecure_rand);
+    }
+
+    bench.minEpochIterations(10).batch(BATCH_SIZE * BATCHES).unit("job").run([&] {
+        CCheckQueueControl<HashJob> control(&queue);
+        for (auto vChecks : vBatches) {
+            control.Add(std::move(vChecks));
+        }
+        control.Wait();
+    });
+    queue.StopWorkerThreads();
+}
+
+static void CCheckQueueScaling1Thread(benchmark::Bench& bench) { CCheckQueueScaling(bench, 1); }
+static void CCheckQueueScaling2Threads(benchmark::Bench& bench) { CCheckQueueScaling(bench, 2); }
+static void CCheckQueueScaling4Threads(benchmark::Bench& bench) { CCheckQueueScaling(bench, 4); }
+static void CCheckQueueScaling8Threads(benchmark::Bench& bench) { CCheckQueueScaling(bench, 8); }
+static void CCheckQueueScaling16Threads(benchmark::Bench& bench) { CCheckQueueScaling(bench, 16); }
+BENCHMARK(CCheckQueueScaling1Thread, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCheckQueueScaling2Threads, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCheckQueueScaling4Threads, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCheckQueueScaling8Threads, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCheckQueueScaling16Threads, benchmark::PriorityLevel::HIGH);
@@ -14,12 +14,14 @@
 using node::NodeContext;
 using wallet::AttemptSelection;
 using wallet::CHANGE_LOWER;
+using wallet::ChooseSelectionResult;
 using wallet::COutput;
 using wallet::CWallet;
 using wallet::CWalletTx;
 using wallet::CoinEligibilityFilter;
 using wallet::CoinSelectionParams;
 using wallet::CreateDummyWalletDatabase;
+using wallet::Groups;
 using wallet::OutputGroup;
 using wallet::SelectCoinsBnB;
 using wallet::TxStateInactive;
@@ -122,5 +124,34 @@ static void BnBExhaustion(benchmark::Bench& bench)
     });
 }
 
+static void CoinSelectionLargePool(benchmark::Bench& bench)
+{
+    // A large pool without an exact match, so BnB uses its whole search budget
+    // while knapsack and SRD run next to it
+    FastRandomContext rand{/*fDeterministic=*/true};
+    Groups groups;
+    for (int i = 0; i < 1000; ++i) {
+        add_coin(1000 * COIN + i + rand.randrange(1000 * COIN), 0, groups.positive_group);
+    }
+    groups.mixed_group = groups.positive_group;
+
+    const CoinSelectionParams coin_selection_params{
+        rand,
+        /*change_output_size=*/ 34,
+        /*change_spend_size=*/ 148,
+        /*min_change_target=*/ CHANGE_LOWER,
+        /*effective_feerate=*/ CFeeRate(0),
+        /*long_term_feerate=*/ CFeeRate(0),
+        /*discard_feerate=*/ CFeeRate(0),
+        /*tx_noinputs_size=*/ 0,
+        /*avoid_partial=*/ false,
+    };
+    bench.run([&] {
+        auto result = ChooseSelectionResult(10000 * COIN + 1, groups, coin_selection_params);
+        assert(result);
+    });
+}
+
 BENCHMARK(CoinSelection, benchmark::PriorityLevel::HIGH);
 BENCHMARK(BnBExhaustion, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CoinSelectionLargePool, benchmark::PriorityLevel::HIGH);
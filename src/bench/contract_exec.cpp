@@ -0,0 +1,222 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <qtum/qtumDGP.h>
+#include <test/util/setup_common.h>
+#include <tinyformat.h>
+#include <util/allocstats.h>
+#include <util/strencodings.h>
+#include <validation.h>
+
+#include <cassert>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+//! Sender of the contract transactions, as in the contract unit tests
+const dev::Address SENDER{"0101010101010101010101010101010101010101"};
+const dev::u256 GAS_LIMIT{500000};
+const dev::u256 GAS_PRICE{1};
+constexpr unsigned BLOCK_TXS{100};
+constexpr unsigned BLOCK_CREATES{20};
+
+/*
+    contract TokenVersion1 {
+        mapping (address => uint) balances;
+
+        event Transfer(address _from, address _to, uint256 _value);
+
+        function balanceOf(address _address) public view returns (uint) {
+            return balances[_address];
+        }
+
+        function transfer(address _to, uint256 _value) public {
+            require(balances[msg.sender] >= _value);
+            balances[msg.sender] -= _value;
+            balances[_to] += _value;
+            emit Transfer(msg.sender, _to, _value);
+        }
+
+        function mint(address _to, uint256 _value) public {
+            balances[_to] += _value * 2;
+            emit Transfer(0x0, _to, _value);
+        }
+    }
+*/
+const std::string TOKEN_CODE = "608060405234801561001057600080fd5b506101e3806100206000396000f3006080604052600436106100565763ffffffff7c010000000000000000000000000000000000000000000000000000000060003504166340c10f19811461005b57806370a082311461008e578063a9059cbb146100ce575b600080fd5b34801561006757600080fd5b5061008c73ffffffffffffffffffffffffffffffffffffffff600435166024356100ff565b005b34801561009a57600080fd5b506100bc73ffffffffffffffffffffffffffffffffffffffff60043516610134565b60408051918252519081900360200190f35b3480156100da57600080fd5b5061008c73ffffffffffffffffffffffffffffffffffffffff6004351660243561015c565b73ffffffffffffffffffffffffffffffffffffffff909116600090815260208190526040902080546002909202919091019055565b73ffffffffffffffffffffffffffffffffffffffff1660009081526020819052604090205490565b3360009081526020819052604090205481111561017857600080fd5b336000908152602081905260408082208054849003905573ffffffffffffffffffffffffffffffffffffffff93909316815291909120805490910190555600a165627a7a72305820c517c25d8609e1668bebed32141ed2c2415e8b77ba9f2aef29c6d84e5756b4c20029";
+
+/*
+    contract Temp {
+        function () payable {}
+    }
+*/
+const std::string PAYABLE_CODE = "6060604052346000575b60398060166000396000f30060606040525b600b5b5b565b0000a165627a7a723058209cedb722bf57a30e3eb00eeefc392103ea791a2001deed29f5c3809ff10eb1dd0029";
+
+//! Heap allocations of all the subsystems so far
+uint64_t AllocCount()
+{
+    uint64_t count{0};
+    for (const AllocStats& stats : GetAllocStats()) count += stats.count;
+    return count;
+}
+
+//! ABI encoded call of a token function taking an address and an optional amount
+dev::bytes TokenCall(const std::string& selector, const dev::Address& address, std::optional<uint64_t> amount = std::nullopt)
+{
+    std::string data = selector + std::string(24, '0') + address.hex();
+    if (amount) data += dev::toHex(dev::toBigEndian(dev::u256(*amount)));
+    return ParseHex(data);
+}
+
+//! A contract transaction, the output @a n of a transaction of its own
+QtumTransaction MakeTx(const dev::bytes& data, const dev::u256& value, const dev::Address& to, unsigned n)
+{
+    QtumTransaction tx = to == dev::Address() ? QtumTransaction(value, GAS_PRICE, GAS_LIMIT, data, dev::u256(0)) :
+                                                QtumTransaction(value, GAS_PRICE, GAS_LIMIT, to, data, dev::u256(0));
+    tx.forceSender(SENDER);
+    tx.setHashWith(dev::sha3(dev::toBigEndian(dev::u256(n))));
+    tx.setNVout(0);
+    tx.setVersion(VersionVM::GetEVMDefault());
+    return tx;
+}
+
+/** Runs contract transactions as the ones of a block on top of the tip of a test chain */
+class ContractBlockSetup
+{
+public:
+    ContractBlockSetup() : m_setup(MakeNoLogFileContext<const TestingSetup>()) {}
+
+    //! Execute the transactions, build the condensing transaction and commit the state to the databases
+    std::vector<ResultExecute> Execute(const std::vector<QtumTransaction>& txs)
+    {
+        std::vector<ResultExecute> result = ExecuteBlock(txs);
+        globalState->db().commit();
+        globalState->dbUtxo().commit();
+        return result;
+    }
+
+    //! Execute the transactions and build the condensing transaction, then drop the changes
+    void Run(benchmark::Bench& bench, const std::vector<QtumTransaction>& txs)
+    {
+        const QtumState::Checkpoint checkpoint = globalState->checkpoint();
+        uint64_t runs{0};
+        const uint64_t allocs_before{AllocCount()};
+        bench.batch(txs.size()).unit("tx").run([&] {
+            std::vector<ResultExecute> result = ExecuteBlock(txs);
+            assert(result.size() == txs.size());
+            globalState->revertToCheckpoint(checkpoint);
+            globalState->db().rollback();
+            globalState->dbUtxo().rollback();
+            ++runs;
+        });
+        if (ALLOC_TRACKING && runs > 0) {
+            // Includes the allocations of the rollbacks, which are few next to the executions
+            tfm::format(std::cout, "%s: %.1f heap allocations per tx\n", bench.name(), double(AllocCount() - allocs_before) / (runs * txs.size()));
+        }
+    }
+
+    //! Deploy a contract and return its address
+    dev::Address Deploy(const std::string& code, unsigned n)
+    {
+        std::vector<ResultExecute> result = Execute({MakeTx(ParseHex(code), 0, dev::Address(), n)});
+        assert(result.size() == 1 && result[0].execRes.excepted == dev::eth::TransactionException::None);
+        return result[0].execRes.newAddress;
+    }
+
+    ChainstateManager& Chainman() { return *m_setup->m_node.chainman; }
+
+private:
+    std::vector<ResultExecute> ExecuteBlock(const std::vector<QtumTransaction>& txs)
+    {
+        LOCK(cs_main);
+        CChain& chain = Chainman().ActiveChain();
+        CMutableTransaction coinbase;
+        coinbase.vout.emplace_back(0, CScript() << OP_TRUE);
+        CBlock block;
+        block.vtx.push_back(MakeTransactionRef(coinbase));
+        QtumDGP qtumDGP(globalState.get(), Chainman().ActiveChainstate(), fGettingValuesDGP);
+        const uint64_t blockGasLimit = qtumDGP.getBlockGasLimit(chain.Height() + 1);
+        ByteCodeExec exec(block, txs, blockGasLimit, chain.Tip(), chain, Chainman().Qtum());
+        exec.performByteCode();
+        ByteCodeExecResult bceResult;
+        exec.processingResults(bceResult);
+        return exec.getResult();
+    }
+
+    const std::unique_ptr<const TestingSetup> m_setup;
+};
+} // namespace
+
+static void ContractTokenTransfers(benchmark::Bench& bench)
+{
+    ContractBlockSetup setup;
+    const dev::Address token = setup.Deploy(TOKEN_CODE, 0);
+    setup.Execute({MakeTx(TokenCall("40c10f19", SENDER, 1000000000), 0, token, 1)});
+
+    std::vector<QtumTransaction> txs;
+    for (unsigned i = 0; i < BLOCK_TXS; ++i) {
+        txs.push_back(MakeTx(TokenCall("a9059cbb", dev::Address(dev::u160(i + 1)), 1), 0, token, 2 + i));
+    }
+    setup.Run(bench, txs);
+}
+
+static void ContractCreates(benchmark::Bench& bench)
+{
+    ContractBlockSetup setup;
+    std::vector<QtumTransaction> txs;
+    for (unsigned i = 0; i < BLOCK_CREATES; ++i) {
+        txs.push_back(MakeTx(ParseHex(TOKEN_CODE), 0, dev::Address(), i));
+    }
+    setup.Run(bench, txs);
+}
+
+static void ContractValueTransfers(benchmark::Bench& bench)
+{
+    // Every call moves coins into the contract, which the condensing transaction collects
+    ContractBlockSetup setup;
+    const dev::Address payable = setup.Deploy(PAYABLE_CODE, 0);
+    std::vector<QtumTransaction> txs;
+    for (unsigned i = 0; i < BLOCK_TXS; ++i) {
+        txs.push_back(MakeTx(dev::bytes(), 1000, payable, 1 + i));
+    }
+    setup.Run(bench, txs);
+}
+
+static void ContractDGPReads(benchmark::Bench& bench)
+{
+    ContractBlockSetup setup;
+    LOCK(cs_main);
+    Chainstate& chainstate = setup.Chainman().ActiveChainstate();
+    const unsigned height = chainstate.m_chain.Height() + 1;
+    bench.run([&] {
+        QtumDGP qtumDGP(globalState.get(), chainstate, true);
+        uint64_t blockGasLimit = qtumDGP.getBlockGasLimit(height);
+        uint64_t minGasPrice = qtumDGP.getMinGasPrice(height);
+        ankerl::nanobench::doNotOptimizeAway(blockGasLimit + minGasPrice);
+    });
+}
+
+static void ContractViewCalls(benchmark::Bench& bench)
+{
+    ContractBlockSetup setup;
+    const dev::Address token = setup.Deploy(TOKEN_CODE, 0);
+    setup.Execute({MakeTx(TokenCall("40c10f19", SENDER, 1000000000), 0, token, 1)});
+
+    const dev::bytes balanceOf = TokenCall("70a08231", SENDER);
+    LOCK(cs_main);
+    Chainstate& chainstate = setup.Chainman().ActiveChainstate();
+    bench.run([&] {
+        std::vector<ResultExecute> result = CallContract(token, balanceOf, chainstate);
+        assert(result.size() == 1 && result[0].execRes.excepted == dev::eth::TransactionException::None);
+    });
+}
+
+BENCHMARK(ContractTokenTransfers, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ContractCreates, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ContractValueTransfers, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ContractDGPReads, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ContractViewCalls, benchmark::PriorityLevel::HIGH);
@@ -135,10 +135,58 @@ static void EvictionProtection3Networks250Candidates(benchmark::Bench& bench)
         });
 }
 
+static void EvictionProtection3Networks1000Candidates(benchmark::Bench& bench)
+{
+    EvictionProtectionCommon(
+        bench,
+        /*num_candidates=*/1000,
+        [](NodeEvictionCandidate& c) {
+            c.m_connected = std::chrono::seconds{c.id};
+            c.m_is_local = (c.id >= 560 && c.id < 640); // 80 localhost
+            if (c.id >= 680 && c.id < 720) {            // 40 I2P
+                c.m_network = NET_I2P;
+            } else if (c.id >= 760 && c.id < 960) { // 200 Tor
+                c.m_network = NET_ONION;
+            } else {
+                c.m_network = NET_IPV4;
+            }
+        });
+}
+
+static void EvictionProtection3Networks5000Candidates(benchmark::Bench& bench)
+{
+    EvictionProtectionCommon(
+        bench,
+        /*num_candidates=*/5000,
+        [](NodeEvictionCandidate& c) {
+            c.m_connected = std::chrono::seconds{c.id};
+            c.m_is_local = (c.id >= 2800 && c.id < 3200); // 400 localhost
+            if (c.id >= 3400 && c.id < 3600) {            // 200 I2P
+                c.m_network = NET_I2P;
+            } else if (c.id >= 3800 && c.id < 4800) { // 1000 Tor
+                c.m_network = NET_ONION;
+            } else {
+                c.m_network = NET_IPV4;
+            }
+        });
+}
+
+static void EvictionSelect5000Candidates(benchmark::Bench& bench)
+{
+    FastRandomContext random_context{true};
+    const std::vector<NodeEvictionCandidate> candidates{GetRandomNodeEvictionCandidates(5000, random_context)};
+
+    bench.run([&] {
+        auto copy = candidates;
+        (void)SelectNodeToEvict(std::move(copy));
+    });
+}
+
 // Candidate numbers used for the benchmarks:
 // -  50 candidates simulates a possible use of -maxconnections
 // - 100 candidates approximates an average node with default settings
 // - 250 candidates is the number of peers reported by operators of busy nodes
+// - 1000/5000 candidates show how the selection scales with large -maxconnections
 
 // No disadvantaged networks, with 250 eviction candidates.
 BENCHMARK(EvictionProtection0Networks250Candidates, benchmark::PriorityLevel::HIGH);
@@ -153,3 +201,8 @@ BENCHMARK(EvictionProtection2Networks250Candidates, benchmark::PriorityLevel::HI
 BENCHMARK(EvictionProtection3Networks050Candidates, benchmark::PriorityLevel::HIGH);
 BENCHMARK(EvictionProtection3Networks100Candidates, benchmark::PriorityLevel::HIGH);
 BENCHMARK(EvictionProtection3Networks250Candidates, benchmark::PriorityLevel::HIGH);
+BENCHMARK(EvictionProtection3Networks1000Candidates, benchmark::PriorityLevel::HIGH);
+BENCHMARK(EvictionProtection3Networks5000Candidates, benchmark::PriorityLevel::HIGH);
+
+// Full eviction selection, protections and netgroup choice, with 5000 eviction candidates.
+BENCHMARK(EvictionSelect5000Candidates, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,89 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <kernel/mempool_entry.h>
+#include <policy/fees.h>
+#include <test/util/setup_common.h>
+
+#include <memory>
+#include <vector>
+
+/** Transactions of ten feerates entering each block, the higher feerates confirmed sooner */
+class EstimatorFeed
+{
+public:
+    explicit EstimatorFeed(CBlockPolicyEstimator& estimator) : m_estimator(estimator)
+    {
+        m_tx.vin.resize(1);
+        m_tx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(128, 'X');
+        m_tx.vout.resize(1);
+    }
+
+    void NextBlock()
+    {
+        for (int j = 0; j < 10; j++) {
+            for (int k = 0; k < 20; k++) {
+                m_tx.vin[0].prevout.n = m_count++;
+                LockPoints lp;
+                m_pending[j].push_back(std::make_unique<CTxMemPoolEntry>(MakeTransactionRef(m_tx), /*fee=*/2000 * (j + 1), /*time=*/0, m_height, /*spends_coinbase=*/false, /*sigops_cost=*/4, lp));
+                m_estimator.processTransaction(*m_pending[j].back(), /*validFeeEstimate=*/true);
+            }
+        }
+        std::vector<std::unique_ptr<CTxMemPoolEntry>> mined;
+        std::vector<const CTxMemPoolEntry*> block;
+        for (unsigned int h = 0; h <= m_height % 10; h++) {
+            for (auto& entry : m_pending[9 - h]) {
+                block.push_back(entry.get());
+                mined.push_back(std::move(entry));
+            }
+            m_pending[9 - h].clear();
+        }
+        m_estimator.processBlock(++m_height, block);
+    }
+
+private:
+    CBlockPolicyEstimator& m_estimator;
+    CMutableTransaction m_tx;
+    std::vector<std::unique_ptr<CTxMemPoolEntry>> m_pending[10];
+    unsigned int m_height{0};
+    uint32_t m_count{0};
+};
+
+static void PolicyEstimatorProcessBlock(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    CBlockPolicyEstimator estimator{fs::path{}, /*read_stale_estimates=*/false};
+    EstimatorFeed feed{estimator};
+    for (int i = 0; i < 200; i++) {
+        feed.NextBlock();
+    }
+
+    bench.run([&] {
+        feed.NextBlock();
+    });
+}
+
+static void PolicyEstimatorEstimateSmartFee(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    CBlockPolicyEstimator estimator{fs::path{}, /*read_stale_estimates=*/false};
+    EstimatorFeed feed{estimator};
+    for (int i = 0; i < 200; i++) {
+        feed.NextBlock();
+    }
+
+    // Wallets ask for a few targets between blocks, the first query of a target calculates it
+    int queries = 0;
+    bench.run([&] {
+        if (++queries % 100 == 0) feed.NextBlock();
+        for (int target : {2, 6, 12, 24, 144}) {
+            FeeCalculation feeCalc;
+            (void)estimator.estimateSmartFee(target, &feeCalc, /*conservative=*/true);
+        }
+    });
+}
+
+BENCHMARK(PolicyEstimatorProcessBlock, benchmark::PriorityLevel::HIGH);
+BENCHMARK(PolicyEstimatorEstimateSmartFee, benchmark::PriorityLevel::HIGH);
@@ -58,3 +58,17 @@ static void BlockToJsonVerboseWrite(benchmark::Bench& bench)
 }
 
 BENCHMARK(BlockToJsonVerboseWrite, benchmark::PriorityLevel::HIGH);
+
+static void BlockToJsonVerboseRead(benchmark::Bench& bench)
+{
+    TestBlockAndIndex data;
+    const std::string json = blockToJSON(data.testing_setup->m_node.chainman->m_blockman, data.block, &data.blockindex, &data.blockindex, TxVerbosity::SHOW_DETAILS_AND_PREVOUT).write();
+    bench.run([&] {
+        UniValue univalue;
+        bool ok = univalue.read(json);
+        assert(ok);
+        ankerl::nanobench::doNotOptimizeAway(univalue);
+    });
+}
+
+BENCHMARK(BlockToJsonVerboseRead, benchmark::PriorityLevel::HIGH);
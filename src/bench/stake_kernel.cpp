@@ -0,0 +1,104 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <checkqueue.h>
+#include <pos.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+#include <util/system.h>
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace {
+//! Target under which some kernels are found in a slot and most coins miss, as in the unit tests
+constexpr unsigned int STAKE_BITS{0x1c00ffff};
+
+/** Stake cache of a wallet with synthetic coins, staking on top of a mocked tip */
+class StakeKernelSetup
+{
+public:
+    explicit StakeKernelSetup(size_t coins) : m_setup(MakeNoLogFileContext<>())
+    {
+        FastRandomContext rng(true);
+        m_index.nHeight = Params().GetConsensus().nReduceBlocktimeHeight;
+        m_index.nStakeModifier = rng.rand256();
+        m_prevouts.reserve(coins);
+        for (size_t i = 0; i < coins; ++i) {
+            m_prevouts.emplace_back(rng.rand256(), i % 4);
+            m_cache.insert(m_prevouts.back(), CStakeCache(1000 + i, (1 + rng.randrange(1000)) * COIN));
+        }
+        m_timeBlock = 1000 + coins;
+    }
+
+    //! Time of the next slot to search
+    uint32_t NextSlot() { return m_timeBlock += Params().GetConsensus().MinStakeTimestampMask() + 1; }
+
+    CBlockIndex m_index;
+    std::vector<COutPoint> m_prevouts;
+    CStakeCacheMap m_cache;
+
+private:
+    const std::unique_ptr<const BasicTestingSetup> m_setup;
+    uint32_t m_timeBlock;
+};
+} // namespace
+
+// Kernel search of one slot with the hashers of the coins prepared once per tip, as the staker does
+static void StakeKernelSearchSlot(benchmark::Bench& bench, size_t coins, bool parallel)
+{
+    StakeKernelSetup setup(coins);
+    StakeKernelSearch search(&setup.m_index, STAKE_BITS, setup.m_prevouts, setup.m_cache);
+    assert(search.Size() == coins);
+
+    CCheckQueue<StakeKernelCheck> queue(STAKE_KERNEL_QUEUE_BATCH_SIZE);
+    if (parallel) queue.StartWorkerThreads(std::max(GetNumCores() - 1, 1));
+
+    bench.batch(coins).unit("coin").run([&] {
+        std::vector<StakeKernelSearch::Kernel> kernels = search.Search(setup.NextSlot(), parallel ? &queue : nullptr);
+        ankerl::nanobench::doNotOptimizeAway(kernels);
+    });
+    if (parallel) queue.StopWorkerThreads();
+}
+
+// Kernel check of one slot done coin by coin from the stake cache
+static void StakeKernelCheckCache(benchmark::Bench& bench, size_t coins)
+{
+    StakeKernelSetup setup(coins);
+    bench.batch(coins).unit("coin").run([&] {
+        const uint32_t nTimeBlock = setup.NextSlot();
+        for (const COutPoint& prevout : setup.m_prevouts) {
+            uint256 hashProofOfStake;
+            CheckKernelCache(&setup.m_index, STAKE_BITS, nTimeBlock, prevout, setup.m_cache, hashProofOfStake);
+        }
+    });
+}
+
+// Preparation of the search when the tip changes
+static void StakeKernelSearchSetup(benchmark::Bench& bench, size_t coins)
+{
+    StakeKernelSetup setup(coins);
+    bench.batch(coins).unit("coin").run([&] {
+        StakeKernelSearch search(&setup.m_index, STAKE_BITS, setup.m_prevouts, setup.m_cache);
+        assert(search.Size() == coins);
+    });
+}
+
+static void StakeKernelSearch1k(benchmark::Bench& bench) { StakeKernelSearchSlot(bench, 1000, /*parallel=*/false); }
+static void StakeKernelSearch10k(benchmark::Bench& bench) { StakeKernelSearchSlot(bench, 10000, /*parallel=*/false); }
+static void StakeKernelSearch100k(benchmark::Bench& bench) { StakeKernelSearchSlot(bench, 100000, /*parallel=*/false); }
+static void StakeKernelSearchParallel100k(benchmark::Bench& bench) { StakeKernelSearchSlot(bench, 100000, /*parallel=*/true); }
+static void StakeKernelCheckCache10k(benchmark::Bench& bench) { StakeKernelCheckCache(bench, 10000); }
+static void StakeKernelSearchSetup100k(benchmark::Bench& bench) { StakeKernelSearchSetup(bench, 100000); }
+
+BENCHMARK(StakeKernelSearch1k, benchmark::PriorityLevel::HIGH);
+BENCHMARK(StakeKernelSearch10k, benchmark::PriorityLevel::HIGH);
+BENCHMARK(StakeKernelSearch100k, benchmark::PriorityLevel::HIGH);
+BENCHMARK(StakeKernelSearchParallel100k, benchmark::PriorityLevel::HIGH);
+BENCHMARK(StakeKernelCheckCache10k, benchmark::PriorityLevel::HIGH);
+BENCHMARK(StakeKernelSearchSetup100k, benchmark::PriorityLevel::HIGH);
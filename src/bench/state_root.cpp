@@ -0,0 +1,66 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <libdevcore/RLP.h>
+#include <libdevcore/SHA3.h>
+#include <libdevcore/TrieCommon.h>
+#include <libdevcore/TrieHash.h>
+
+#include <vector>
+
+static constexpr unsigned NUM_ACCOUNTS{10000};
+
+//! Accounts keyed by the hash of their address, as in the state trie
+static dev::BytesMap MakeAccounts()
+{
+    dev::BytesMap accounts;
+    dev::RLPStream s;
+    for (unsigned i = 0; i < NUM_ACCOUNTS; ++i) {
+        s.clear();
+        s.appendList(4) << dev::u256(i) << dev::u256(i) * dev::u256(1000000007) << dev::sha3(dev::toBigEndian(dev::u256(i))) << dev::EmptySHA3;
+        accounts[dev::sha3(dev::toBigEndian(dev::u256(i))).asBytes()] = s.out();
+    }
+    return accounts;
+}
+
+static void StateRoot(benchmark::Bench& bench)
+{
+    const dev::BytesMap accounts = MakeAccounts();
+    bench.batch(accounts.size()).unit("account").run([&] {
+        dev::h256 root = dev::hash256(accounts);
+        ankerl::nanobench::doNotOptimizeAway(root);
+    });
+}
+
+static void RLPEncodeAccounts(benchmark::Bench& bench)
+{
+    dev::RLPStream s;
+    bench.batch(NUM_ACCOUNTS).unit("account").run([&] {
+        for (unsigned i = 0; i < NUM_ACCOUNTS; ++i) {
+            s.clear();
+            s.appendList(4) << dev::u256(i) << dev::u256(i) << dev::EmptyTrie << dev::EmptySHA3;
+        }
+        ankerl::nanobench::doNotOptimizeAway(s.out().size());
+    });
+}
+
+static void Keccak256Batch(benchmark::Bench& bench)
+{
+    std::vector<dev::h256> keys(NUM_ACCOUNTS);
+    std::vector<dev::bytesConstRef> refs;
+    for (unsigned i = 0; i < NUM_ACCOUNTS; ++i) {
+        keys[i] = dev::h256(dev::u256(i));
+        refs.push_back(keys[i].ref());
+    }
+    std::vector<dev::h256> hashes(NUM_ACCOUNTS);
+    bench.batch(NUM_ACCOUNTS).unit("key").run([&] {
+        dev::sha3Batch(refs.data(), hashes.data(), refs.size());
+        ankerl::nanobench::doNotOptimizeAway(hashes[0]);
+    });
+}
+
+BENCHMARK(StateRoot, benchmark::PriorityLevel::HIGH);
+BENCHMARK(RLPEncodeAccounts, benchmark::PriorityLevel::HIGH);
+BENCHMARK(Keccak256Batch, benchmark::PriorityLevel::HIGH);
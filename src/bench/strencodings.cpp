@@ -15,4 +15,25 @@ static void HexStrBench(benchmark::Bench& bench)
     });
 }
 
+static void ParseHexBench(benchmark::Bench& bench)
+{
+    const std::string hex = HexStr(benchmark::data::blockbench);
+    bench.batch(hex.size()).unit("byte").run([&] {
+        auto data = TryParseHex<uint8_t>(hex);
+        ankerl::nanobench::doNotOptimizeAway(data);
+    });
+}
+
+/** A payload the size of a contract call, where the scalar tail and the setup matter */
+static void ParseHexSmallBench(benchmark::Bench& bench)
+{
+    const std::string hex = HexStr(Span{benchmark::data::blockbench}.first(300));
+    bench.batch(hex.size()).unit("byte").run([&] {
+        auto data = TryParseHex<uint8_t>(hex);
+        ankerl::nanobench::doNotOptimizeAway(data);
+    });
+}
+
 BENCHMARK(HexStrBench, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ParseHexBench, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ParseHexSmallBench, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,48 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <node/txreconciliation.h>
+#include <random.h>
+#include <uint256.h>
+
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+/** A reconciliation round of two 1000 transaction sets that differ by 10 transactions on each side. */
+static void TxReconciliationRound(benchmark::Bench& bench)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<uint256> shared(1000), initiator_only(10), responder_only(10);
+    for (auto* set : {&shared, &initiator_only, &responder_only}) {
+        for (uint256& wtxid : *set) wtxid = rng.rand256();
+    }
+
+    bench.run([&] {
+        TxReconciliationTracker initiator(TXRECONCILIATION_VERSION);
+        TxReconciliationTracker responder(TXRECONCILIATION_VERSION);
+        const uint64_t initiator_salt{initiator.PreRegisterPeer(0)};
+        const uint64_t responder_salt{responder.PreRegisterPeer(0)};
+        initiator.RegisterPeer(0, /*is_peer_inbound=*/false, 1, responder_salt);
+        responder.RegisterPeer(0, /*is_peer_inbound=*/true, 1, initiator_salt);
+        for (size_t i = 0; i < shared.size(); ++i) {
+            initiator.AddToSet(0, shared[i]);
+            responder.AddToSet(0, shared[i]);
+        }
+        for (size_t i = 0; i < initiator_only.size(); ++i) {
+            initiator.AddToSet(0, initiator_only[i]);
+            responder.AddToSet(0, responder_only[i]);
+        }
+
+        const auto request{initiator.MaybeRequestReconciliation(0, std::chrono::seconds{1})};
+        const auto skdata{responder.HandleReconciliationRequest(0, request->first, request->second)};
+        const auto result{initiator.HandleSketch(0, *skdata)};
+        const auto announce{responder.HandleReconciliationDifference(0, result->m_success, result->m_ask_short_ids)};
+        assert(result->m_success && announce->size() == responder_only.size());
+        ankerl::nanobench::doNotOptimizeAway(announce);
+    });
+}
+
+BENCHMARK(TxReconciliationRound, benchmark::PriorityLevel::HIGH);
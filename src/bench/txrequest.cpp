@@ -0,0 +1,52 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <random.h>
+#include <txrequest.h>
+
+#include <chrono>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+/** A relay node with 1000 peers, each transaction announced by 50 of them and fetched from one of them */
+static void TxRequestTrackerManyPeers(benchmark::Bench& bench)
+{
+    constexpr int PEERS{1000};
+    constexpr int TXS_PER_ROUND{100};
+    constexpr int ANNOUNCERS_PER_TX{50};
+
+    TxRequestTracker tracker{/*deterministic=*/true};
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::chrono::microseconds now{1s};
+    std::vector<uint256> requested;
+
+    bench.run([&] {
+        for (int i = 0; i < TXS_PER_ROUND; ++i) {
+            const GenTxid gtxid{GenTxid::Wtxid(rng.rand256())};
+            for (int j = 0; j < ANNOUNCERS_PER_TX; ++j) {
+                const NodeId peer = rng.randrange(PEERS);
+                // Like net_processing, the outbound peers are preferred and the others delayed
+                const bool preferred = peer % 8 == 0;
+                tracker.ReceivedInv(peer, gtxid, preferred, now + (preferred ? 0s : 2s));
+            }
+        }
+        now += 500ms;
+
+        // The transactions requested in the previous round arrived
+        for (const uint256& txhash : requested) tracker.ForgetTxHash(txhash);
+        requested.clear();
+
+        for (NodeId peer = 0; peer < PEERS; ++peer) {
+            std::vector<std::pair<NodeId, GenTxid>> expired;
+            for (const GenTxid& gtxid : tracker.GetRequestable(peer, now, &expired)) {
+                tracker.RequestedTx(peer, gtxid.GetHash(), now + 60s);
+                requested.push_back(gtxid.GetHash());
+            }
+        }
+    });
+}
+
+BENCHMARK(TxRequestTrackerManyPeers, benchmark::PriorityLevel::HIGH);
@@ -18,6 +18,7 @@
 
 using wallet::CWallet;
 using wallet::DatabaseFormat;
+using wallet::DatabaseGroupCommit;
 using wallet::DatabaseOptions;
 using wallet::TxStateInactive;
 using wallet::WALLET_FLAG_DESCRIPTORS;
@@ -98,6 +99,35 @@ BENCHMARK(WalletLoadingLegacy, benchmark::PriorityLevel::HIGH);
 #endif
 
 #ifdef USE_SQLITE
+static void WalletAddTxs(benchmark::Bench& bench, bool group_commit)
+{
+    const auto test_setup = MakeNoLogFileContext<TestingSetup>();
+
+    WalletContext context;
+    context.args = &test_setup->m_args;
+    context.chain = test_setup->m_node.chain.get();
+
+    DatabaseOptions options;
+    options.create_flags = WALLET_FLAG_DESCRIPTORS;
+    options.require_format = DatabaseFormat::SQLITE;
+    auto wallet = BenchLoadWallet(CreateMockWalletDatabase(options), context, options);
+
+    // Add the transactions one by one, or committed together like the transactions of a block
+    bench.epochs(5).epochIterations(1).run([&] {
+        std::optional<DatabaseGroupCommit> group;
+        if (group_commit) group.emplace(wallet->GetDatabase());
+        for (int i = 0; i < 100; ++i) {
+            AddTx(*wallet);
+        }
+    });
+
+    BenchUnloadWallet(std::move(wallet));
+}
+
 static void WalletLoadingDescriptors(benchmark::Bench& bench) { WalletLoading(bench, /*legacy_wallet=*/false); }
 BENCHMARK(WalletLoadingDescriptors, benchmark::PriorityLevel::HIGH);
+static void WalletAddTxsDescriptors(benchmark::Bench& bench) { WalletAddTxs(bench, /*group_commit=*/false); }
+static void WalletAddTxsGroupCommitDescriptors(benchmark::Bench& bench) { WalletAddTxs(bench, /*group_commit=*/true); }
+BENCHMARK(WalletAddTxsDescriptors, benchmark::PriorityLevel::HIGH);
+BENCHMARK(WalletAddTxsGroupCommitDescriptors, benchmark::PriorityLevel::HIGH);
 #endif
@@ -0,0 +1,183 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <consensus/merkle.h>
+#include <kernel/chain.h>
+#include <node/context.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+#include <wallet/stake.h>
+#include <wallet/test/util.h>
+#include <wallet/wallet.h>
+
+#include <cassert>
+
+using wallet::CWallet;
+using wallet::CWalletTx;
+using wallet::CreateMockWalletDatabase;
+using wallet::DBErrors;
+using wallet::WALLET_FLAG_DESCRIPTORS;
+
+namespace {
+//! Blocks whose coinbase pays the coins of the wallet
+constexpr size_t STAKE_COIN_BLOCKS{100};
+//! Target under which a kernel is found for few of the coins in a slot
+constexpr unsigned int STAKE_BITS_SEARCH{0x1c00ffff};
+
+/** Descriptor wallet holding mature coinbase coins, which are also in the coins view of the chain */
+class StakeWalletSetup
+{
+public:
+    explicit StakeWalletSetup(size_t coins)
+        : m_setup(MakeNoLogFileContext<const TestingSetup>()),
+          m_wallet(m_setup->m_node.chain.get(), "", CreateMockWalletDatabase())
+    {
+        {
+            LOCK(m_wallet.cs_wallet);
+            m_wallet.SetWalletFlag(WALLET_FLAG_DESCRIPTORS);
+            m_wallet.SetupDescriptorScriptPubKeyMans();
+            if (m_wallet.LoadWallet() != DBErrors::LOAD_OK) assert(false);
+        }
+        const CScript dest = GetScriptForDestination(getNewDestination(m_wallet, OutputType::LEGACY));
+        for (size_t i = 0; i < STAKE_COIN_BLOCKS; ++i) {
+            AddFakeBlock(dest, coins / STAKE_COIN_BLOCKS);
+        }
+        // Mature the coins with blocks paying elsewhere
+        const int maturity = Params().GetConsensus().CoinbaseMaturity(STAKE_COIN_BLOCKS + 1);
+        for (int i = 0; i <= maturity; ++i) {
+            AddFakeBlock(CScript() << OP_TRUE, 1);
+        }
+
+        LOCK(m_wallet.cs_wallet);
+        CAmount nTargetValue = MAX_MONEY;
+        CAmount nValueIn = 0;
+        wallet::SelectCoinsForStaking(m_wallet, nTargetValue, m_coins, nValueIn);
+        assert(m_coins.size() == coins);
+        for (const auto& pcoin : m_coins) {
+            m_prevouts.emplace_back(pcoin.first->GetHash(), pcoin.second);
+        }
+        m_timeBlock = WITH_LOCK(::cs_main, return Chainman().ActiveTip()->GetBlockTime());
+    }
+
+    //! Time of the next slot to search
+    uint32_t NextSlot() { return m_timeBlock += Params().GetConsensus().MinStakeTimestampMask() + 1; }
+
+    ChainstateManager& Chainman() { return *m_setup->m_node.chainman; }
+
+    CWallet& Wallet() { return m_wallet; }
+
+    std::set<std::pair<const CWalletTx*, unsigned int>> m_coins;
+    std::vector<COutPoint> m_prevouts;
+
+private:
+    //! Add a block with a coinbase of @a outputs coins paid to @a script, and notify the wallet
+    void AddFakeBlock(const CScript& script, size_t outputs)
+    {
+        const node::NodeContext& context = m_setup->m_node;
+        CBlockIndex* tip = WITH_LOCK(::cs_main, return context.chainman->ActiveTip());
+
+        CMutableTransaction coinbase_tx;
+        coinbase_tx.vin.resize(1);
+        coinbase_tx.vin[0].prevout.SetNull();
+        coinbase_tx.vin[0].scriptSig = CScript() << (tip->nHeight + 1) << OP_0;
+        coinbase_tx.vout.assign(outputs, CTxOut(100 * COIN, script));
+        CBlock block;
+        block.vtx = {MakeTransactionRef(std::move(coinbase_tx))};
+        block.nVersion = VERSIONBITS_LAST_OLD_BLOCK_VERSION;
+        block.hashPrevBlock = tip->GetBlockHash();
+        block.hashMerkleRoot = BlockMerkleRoot(block);
+        block.nTime = tip->GetBlockTime() + 1;
+        block.nBits = Params().GenesisBlock().nBits;
+
+        CBlockIndex* pindex;
+        {
+            LOCK(::cs_main);
+            pindex = context.chainman->m_blockman.AddToBlockIndex(block, context.chainman->m_best_header);
+            context.chainman->ActiveChain().SetTip(*pindex);
+            AddCoins(context.chainman->ActiveChainstate().CoinsTip(), *block.vtx[0], pindex->nHeight);
+        }
+        m_wallet.blockConnected(kernel::MakeBlockInfo(pindex, &block));
+    }
+
+    const std::unique_ptr<const TestingSetup> m_setup;
+    CWallet m_wallet;
+    uint32_t m_timeBlock;
+};
+} // namespace
+
+// Listing of the wallet coins that can stake, done by the staker before each block
+static void WalletSelectCoinsForStaking(benchmark::Bench& bench, size_t coins)
+{
+    StakeWalletSetup setup(coins);
+    CWallet& wallet = setup.Wallet();
+    bench.batch(coins).unit("coin").run([&] {
+        LOCK(wallet.cs_wallet);
+        std::set<std::pair<const CWalletTx*, unsigned int>> setCoins;
+        CAmount nTargetValue = MAX_MONEY;
+        CAmount nValueIn = 0;
+        wallet::SelectCoinsForStaking(wallet, nTargetValue, setCoins, nValueIn);
+        assert(setCoins.size() == coins);
+    });
+}
+
+// Caching of the kernel data of the coins when the tip changes
+static void WalletUpdateStakeCache(benchmark::Bench& bench, size_t coins)
+{
+    StakeWalletSetup setup(coins);
+    CWallet& wallet = setup.Wallet();
+    bench.batch(coins).unit("coin").run([&] {
+        LOCK(::cs_main);
+        wallet.minerStakeCache.clear();
+        wallet::UpdateMinerStakeCache(wallet, true, setup.m_prevouts, setup.Chainman().ActiveTip());
+        assert(wallet.minerStakeCache.size() == coins);
+    });
+}
+
+// Coinstake creation for one slot, which searches all the coins for a kernel when @a found is false
+// and assembles the coinstake of the first coin otherwise
+static void WalletCreateCoinStake(benchmark::Bench& bench, size_t coins, bool found)
+{
+    StakeWalletSetup setup(coins);
+    CWallet& wallet = setup.Wallet();
+    const unsigned int nBits = found ? UintToArith256(Params().GetConsensus().posLimit).GetCompact() : STAKE_BITS_SEARCH;
+    {
+        LOCK(::cs_main);
+        wallet::UpdateMinerStakeCache(wallet, true, setup.m_prevouts, setup.Chainman().ActiveTip());
+    }
+
+    std::vector<COutPoint> setSelectedCoins;
+    std::vector<COutPoint> setDelegateCoins;
+    bench.batch(found ? 1 : coins).unit(found ? "coinstake" : "coin").run([&] {
+        LOCK2(wallet.cs_wallet, ::cs_main);
+        CMutableTransaction txCoinStake;
+        PKHash pkhash;
+        std::vector<unsigned char> vchPoD;
+        COutPoint headerPrevout;
+        bool created = wallet::CreateCoinStake(wallet, nBits, 0, setup.NextSlot(), txCoinStake, pkhash, setup.m_coins, setSelectedCoins,
+                                               setDelegateCoins, /*selectedOnly=*/false, /*sign=*/false, vchPoD, headerPrevout);
+        if (found) assert(created);
+    });
+}
+
+static void WalletSelectCoinsForStaking1k(benchmark::Bench& bench) { WalletSelectCoinsForStaking(bench, 1000); }
+static void WalletSelectCoinsForStaking10k(benchmark::Bench& bench) { WalletSelectCoinsForStaking(bench, 10000); }
+static void WalletSelectCoinsForStaking100k(benchmark::Bench& bench) { WalletSelectCoinsForStaking(bench, 100000); }
+static void WalletUpdateStakeCache10k(benchmark::Bench& bench) { WalletUpdateStakeCache(bench, 10000); }
+static void WalletCreateCoinStakeSearch1k(benchmark::Bench& bench) { WalletCreateCoinStake(bench, 1000, /*found=*/false); }
+static void WalletCreateCoinStakeSearch10k(benchmark::Bench& bench) { WalletCreateCoinStake(bench, 10000, /*found=*/false); }
+static void WalletCreateCoinStakeSearch100k(benchmark::Bench& bench) { WalletCreateCoinStake(bench, 100000, /*found=*/false); }
+static void WalletCreateCoinStakeFound10k(benchmark::Bench& bench) { WalletCreateCoinStake(bench, 10000, /*found=*/true); }
+
+BENCHMARK(WalletSelectCoinsForStaking1k, benchmark::PriorityLevel::LOW);
+BENCHMARK(WalletSelectCoinsForStaking10k, benchmark::PriorityLevel::LOW);
+BENCHMARK(WalletSelectCoinsForStaking100k, benchmark::PriorityLevel::LOW);
+BENCHMARK(WalletUpdateStakeCache10k, benchmark::PriorityLevel::LOW);
+BENCHMARK(WalletCreateCoinStakeSearch1k, benchmark::PriorityLevel::LOW);
+BENCHMARK(WalletCreateCoinStakeSearch10k, benchmark::PriorityLevel::LOW);
+BENCHMARK(WalletCreateCoinStakeSearch100k, benchmark::PriorityLevel::LOW);
+BENCHMARK(WalletCreateCoinStakeFound10k, benchmark::PriorityLevel::LOW);
@@ -0,0 +1,292 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// The qtum-blockreplay executable replays real blocks on top of a copy of a
+// datadir and reports how long each block and each step of its connection
+// took, to measure validation performance on realistic workloads.
+//
+// Its setup and teardown follow bitcoin-chainstate.cpp, it is also part of the
+// experimental libbitcoinkernel project.
+
+#include <kernel/checks.h>
+#include <kernel/context.h>
+#include <kernel/validation_cache_sizes.h>
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <core_io.h>
+#include <node/blockstorage.h>
+#include <node/caches.h>
+#include <node/chainstate.h>
+#include <scheduler.h>
+#include <script/sigcache.h>
+#include <util/system.h>
+#include <util/thread.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+/** Catches the validation result of one block, adapted from rpc/mining.cpp */
+class BlockStateCatcher final : public CValidationInterface
+{
+public:
+    uint256 hash;
+    bool found{false};
+    BlockValidationState state;
+
+    explicit BlockStateCatcher(const uint256& hashIn) : hash(hashIn) {}
+
+protected:
+    void BlockChecked(const CBlock& block, const BlockValidationState& stateIn) override
+    {
+        if (block.GetHash() != hash) return;
+        found = true;
+        state = stateIn;
+    }
+};
+
+double Millis(SteadyClock::duration duration) { return Ticks<MillisecondsDouble>(duration); }
+
+BlockConnectionTimings operator-(const BlockConnectionTimings& a, const BlockConnectionTimings& b)
+{
+    BlockConnectionTimings d;
+    d.blocks = a.blocks - b.blocks;
+    d.read_from_disk = a.read_from_disk - b.read_from_disk;
+    d.check = a.check - b.check;
+    d.forks = a.forks - b.forks;
+    d.connect = a.connect - b.connect;
+    d.contracts = a.contracts - b.contracts;
+    d.verify = a.verify - b.verify;
+    d.undo = a.undo - b.undo;
+    d.index = a.index - b.index;
+    d.connect_total = a.connect_total - b.connect_total;
+    d.flush = a.flush - b.flush;
+    d.chainstate = a.chainstate - b.chainstate;
+    d.post_connect = a.post_connect - b.post_connect;
+    d.total = a.total - b.total;
+    return d;
+}
+
+void PrintPhases(std::ostream& out, const BlockConnectionTimings& t)
+{
+    out << Millis(t.check) << ',' << Millis(t.forks) << ',' << Millis(t.connect) << ',' << Millis(t.contracts) << ','
+        << Millis(t.verify) << ',' << Millis(t.undo) << ',' << Millis(t.index) << ',' << Millis(t.connect_total) << ','
+        << Millis(t.flush) << ',' << Millis(t.chainstate) << ',' << Millis(t.post_connect);
+}
+
+int Usage(const char* name)
+{
+    std::cerr
+        << "Usage: " << name << " [-chain=<main|test|regtest>] [-par=<n>] [-parcontracts=<n>] DATADIR [BLOCKFILE]" << std::endl
+        << "Replay hex-encoded blocks, one per line, read from BLOCKFILE or standard input on top of the chain" << std::endl
+        << "state of DATADIR, and print the timings of each block as CSV on standard output and their totals" << std::endl
+        << "on standard error. The timings in milliseconds are those logged with -debug=bench." << std::endl
+        << std::endl
+        << "DATADIR is modified by the replay: use a copy of the datadir of a node stopped at the height" << std::endl
+        << "before the blocks, and a new copy for each run. The blocks of a range can be exported with" << std::endl
+        << "  for h in $(seq FIRST LAST); do qtum-cli getblock $(qtum-cli getblockhash $h) 0; done > blocks.hex" << std::endl
+        << std::endl
+        << "  -chain=<chain>      Chain of DATADIR (default: main)" << std::endl
+        << "  -par=<n>            Script verification threads (default: 0, verify in the replay thread)" << std::endl
+        << "  -parcontracts=<n>   Contract execution threads (default: 0, execute contracts sequentially)" << std::endl
+        << std::endl
+        << "IMPORTANT: THIS EXECUTABLE IS EXPERIMENTAL, FOR TESTING ONLY, AND EXPECTED TO" << std::endl
+        << "           BREAK IN FUTURE VERSIONS. DO NOT USE ON YOUR ACTUAL DATADIR." << std::endl;
+    return 1;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    // SETUP: Argument parsing and handling
+    std::string chain{CBaseChainParams::MAIN};
+    int script_threads{0};
+    int contract_threads{0};
+    int arg{1};
+    try {
+        for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+            const std::string option{argv[arg]};
+            if (option.rfind("-chain=", 0) == 0) {
+                chain = option.substr(7);
+            } else if (option.rfind("-par=", 0) == 0) {
+                script_threads = std::clamp(std::stoi(option.substr(5)), 0, MAX_SCRIPTCHECK_THREADS);
+            } else if (option.rfind("-parcontracts=", 0) == 0) {
+                contract_threads = std::clamp(std::stoi(option.substr(14)), 0, MAX_CONTRACTEXEC_THREADS);
+            } else {
+                return Usage(argv[0]);
+            }
+        }
+        if (argc - arg < 1 || argc - arg > 2) return Usage(argv[0]);
+        SelectParams(chain);
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid argument: " << e.what() << std::endl;
+        return Usage(argv[0]);
+    }
+    std::filesystem::path abs_datadir = std::filesystem::absolute(argv[arg]);
+    if (!std::filesystem::is_directory(abs_datadir)) {
+        std::cerr << "The datadir " << abs_datadir << " does not exist." << std::endl;
+        return 1;
+    }
+    gArgs.ForceSetArg("-datadir", abs_datadir.string());
+    std::ifstream block_file;
+    if (argc - arg == 2) {
+        block_file.open(argv[arg + 1]);
+        if (!block_file) {
+            std::cerr << "Failed to open " << argv[arg + 1] << std::endl;
+            return 1;
+        }
+    }
+    std::istream& blocks_in = block_file.is_open() ? block_file : std::cin;
+
+
+    // SETUP: Misc Globals
+    const CChainParams& chainparams = Params();
+
+    kernel::Context kernel_context{};
+    assert(!kernel::SanityChecks(kernel_context).has_value());
+
+    kernel::ValidationCacheSizes validation_cache_sizes{};
+    Assert(InitSignatureCache(validation_cache_sizes.signature_cache_bytes));
+    Assert(InitScriptExecutionCache(validation_cache_sizes.script_execution_cache_bytes));
+
+
+    // SETUP: Scheduling and Background Signals
+    CScheduler scheduler{};
+    scheduler.m_service_thread = std::thread(util::TraceThread, "scheduler", [&] { scheduler.serviceQueue(); });
+    GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
+
+    if (script_threads > 0) StartScriptCheckWorkerThreads(script_threads);
+    if (contract_threads > 0) StartContractExecWorkerThreads(contract_threads);
+
+
+    // SETUP: Chainstate
+    const ChainstateManager::Options chainman_opts{
+        .chainparams = chainparams,
+        .datadir = gArgs.GetDataDirNet(),
+        .adjusted_time_callback = NodeClock::now,
+    };
+    ChainstateManager chainman{chainman_opts, {}};
+
+    // The default caches of qtumd, so that the flushes happen as often as in IBD
+    node::CacheSizes cache_sizes;
+    cache_sizes.block_tree_db = 2 << 20;
+    cache_sizes.coins_db = 2 << 22;
+    cache_sizes.coins = (450 << 20) - (2 << 20) - (2 << 22);
+    cache_sizes.receipts = nDefaultReceiptsCache << 20;
+    cache_sizes.state_writes = nDefaultStateWriteCache << 20;
+    node::ChainstateLoadOptions options;
+    options.check_interrupt = [] { return false; };
+    int replayed{0};
+    size_t replayed_txs{0};
+    BlockConnectionTimings start_timings;
+    SteadyClock::duration process_total{};
+    auto [status, error] = node::LoadChainstate(chainman, cache_sizes, options);
+    if (status != node::ChainstateLoadStatus::SUCCESS) {
+        std::cerr << "Failed to load Chain state from your datadir." << std::endl;
+        goto epilogue;
+    }
+
+    {
+        BlockValidationState state;
+        if (!chainman.ActiveChainstate().ActivateBestChain(state, nullptr)) {
+            std::cerr << "Failed to connect best block (" << state.ToString() << ")" << std::endl;
+            goto epilogue;
+        }
+    }
+
+    {
+        LOCK(::cs_main);
+        std::cerr << "Replaying blocks on top of " << chainman.ActiveTip()->ToString() << std::endl;
+        start_timings = GetBlockConnectionTimings();
+    }
+
+    // Main program logic starts here
+    std::cout << "height,hash,txs,process_ms,check_ms,forks_ms,connect_ms,contracts_ms,verify_ms,undo_ms,index_ms,"
+              << "connect_total_ms,flush_ms,chainstate_ms,post_connect_ms" << std::endl;
+    for (std::string line; std::getline(blocks_in, line);) {
+        if (line.empty()) continue;
+
+        std::shared_ptr<CBlock> blockptr = std::make_shared<CBlock>();
+        if (!DecodeHexBlk(*blockptr, line)) {
+            std::cerr << "Block decode failed" << std::endl;
+            break;
+        }
+        const uint256 hash = blockptr->GetHash();
+
+        BlockConnectionTimings before;
+        {
+            LOCK(::cs_main);
+            if (chainman.ActiveTip()->GetBlockHash() != blockptr->hashPrevBlock) {
+                std::cerr << "Block " << hash.ToString() << " does not extend the tip "
+                          << chainman.ActiveTip()->GetBlockHash().ToString() << std::endl;
+                break;
+            }
+            before = GetBlockConnectionTimings();
+        }
+
+        auto sc = std::make_shared<BlockStateCatcher>(hash);
+        RegisterSharedValidationInterface(sc);
+        const auto time_start{SteadyClock::now()};
+        const bool accepted = chainman.ProcessNewBlock(blockptr, /*force_processing=*/true, /*min_pow_checked=*/true, /*new_block=*/nullptr);
+        const auto time_process{SteadyClock::now() - time_start};
+        UnregisterSharedValidationInterface(sc);
+        if (!accepted || !sc->found || !sc->state.IsValid()) {
+            std::cerr << "Block " << hash.ToString() << " rejected: " << (sc->found ? sc->state.ToString() : "inconclusive") << std::endl;
+            break;
+        }
+
+        LOCK(::cs_main);
+        if (chainman.ActiveTip()->GetBlockHash() != hash) {
+            std::cerr << "Block " << hash.ToString() << " was not connected" << std::endl;
+            break;
+        }
+        const BlockConnectionTimings block_timings = GetBlockConnectionTimings() - before;
+        std::cout << chainman.ActiveHeight() << ',' << hash.ToString() << ',' << blockptr->vtx.size() << ',' << Millis(time_process) << ',';
+        PrintPhases(std::cout, block_timings);
+        std::cout << '\n';
+        ++replayed;
+        replayed_txs += blockptr->vtx.size();
+        process_total += time_process;
+    }
+
+    if (replayed > 0) {
+        const BlockConnectionTimings total = WITH_LOCK(::cs_main, return GetBlockConnectionTimings()) - start_timings;
+        std::cerr << "Replayed " << replayed << " blocks (" << replayed_txs << " transactions) in " << Ticks<SecondsDouble>(process_total) << "s, "
+                  << replayed / Ticks<SecondsDouble>(process_total) << " blocks/s" << std::endl
+                  << "Total ms check,forks,connect,contracts,verify,undo,index,connect_total,flush,chainstate,post_connect: ";
+        PrintPhases(std::cerr, total);
+        std::cerr << std::endl;
+    }
+
+epilogue:
+    // Without this precise shutdown sequence, there will be a lot of nullptr
+    // dereferencing and UB.
+    scheduler.stop();
+    if (chainman.m_load_block.joinable()) chainman.m_load_block.join();
+    StopScriptCheckWorkerThreads();
+    StopContractExecWorkerThreads();
+
+    GetMainSignals().FlushBackgroundCallbacks();
+    {
+        LOCK(cs_main);
+        for (Chainstate* chainstate : chainman.GetAll()) {
+            if (chainstate->CanFlushToDisk()) {
+                chainstate->ForceFlushStateToDisk();
+                chainstate->ResetCoinsViews();
+            }
+        }
+    }
+    GetMainSignals().UnregisterBackgroundSignalScheduler();
+}
@@ -85,6 +85,10 @@ int main(int argc, char* argv[])
         .chainparams = *chainparams,
         .datadir = gArgs.GetDataDirNet(),
         .adjusted_time_callback = NodeClock::now,
+        .qtum_context = std::make_shared<QtumContext>(),
+        .receipts_callback = [](const CBlockIndex& index, const std::vector<TransactionReceiptInfo>& receipts) {
+            std::cout << "Block " << index.GetBlockHash().GetHex() << " has " << receipts.size() << " contract receipts" << std::endl;
+        },
     };
     ChainstateManager chainman{chainman_opts, {}};
 
@@ -92,6 +96,8 @@ int main(int argc, char* argv[])
     cache_sizes.block_tree_db = 2 << 20;
     cache_sizes.coins_db = 2 << 22;
     cache_sizes.coins = (450 << 20) - (2 << 20) - (2 << 22);
+    cache_sizes.receipts = nDefaultReceiptsCache << 20;
+    cache_sizes.state_writes = nDefaultStateWriteCache << 20;
     node::ChainstateLoadOptions options;
     options.check_interrupt = [] { return false; };
     auto [status, error] = node::LoadChainstate(chainman, cache_sizes, options);
@@ -251,6 +257,7 @@ epilogue:
     scheduler.stop();
     if (chainman.m_load_block.joinable()) chainman.m_load_block.join();
     StopScriptCheckWorkerThreads();
+    StopContractExecWorkerThreads();
 
     GetMainSignals().FlushBackgroundCallbacks();
     {
@@ -21,6 +21,7 @@
 #include <univalue.h>
 #include <util/exception.h>
 #include <util/strencodings.h>
+#include <util/string.h>
 #include <util/system.h>
 #include <util/translation.h>
 
@@ -29,6 +30,7 @@
 #include <cmath>
 #include <cstdio>
 #include <functional>
+#include <map>
 #include <memory>
 #include <optional>
 #include <string>
@@ -64,6 +66,9 @@ static constexpr std::array UNREACHABLE_NETWORK_IDS{/*not_publicly_routable*/0,
 /** Default number of blocks to generate for RPC generatetoaddress. */
 static const std::string DEFAULT_NBLOCKS = "1";
 
+/** Default number of commands sent in each batch of -stdinbatch. */
+static const int64_t DEFAULT_BATCH_SIZE = 100;
+
 /** Default -color setting. */
 static const std::string DEFAULT_COLOR_SETTING{"auto"};
 
@@ -90,6 +95,7 @@ static void SetupCliArgs(ArgsManager& argsman)
     argsman.AddArg("-netinfo", "Get network peer connection information from the remote server. An optional integer argument from 0 to 4 can be passed for different peers listings (default: 0). Pass \"help\" for detailed help documentation.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 
     SetupChainParamsBaseOptions(argsman);
+    argsman.AddArg("-batchsize=<n>", strprintf("Number of commands sent in each batch of -stdinbatch (default: %d)", DEFAULT_BATCH_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-color=<when>", strprintf("Color setting for CLI output (default: %s). Valid values: always, auto (add color codes when standard output is connected to a terminal and OS is not WIN32), never.", DEFAULT_COLOR_SETTING), ArgsManager::ALLOW_ANY | ArgsManager::DISALLOW_NEGATION, OptionsCategory::OPTIONS);
     argsman.AddArg("-named", strprintf("Pass named instead of positional arguments (default: %s)", DEFAULT_NAMED), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-rpcclienttimeout=<n>", strprintf("Timeout in seconds during HTTP requests, or 0 for no timeout. (default: %d)", DEFAULT_HTTP_CLIENT_TIMEOUT), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -102,6 +108,7 @@ static void SetupCliArgs(ArgsManager& argsman)
     argsman.AddArg("-rpcwaittimeout=<n>", strprintf("Timeout in seconds to wait for the RPC server to start, or 0 for no timeout. (default: %d)", DEFAULT_WAIT_CLIENT_TIMEOUT), ArgsManager::ALLOW_ANY | ArgsManager::DISALLOW_NEGATION, OptionsCategory::OPTIONS);
     argsman.AddArg("-rpcwallet=<walletname>", "Send RPC for non-default wallet on RPC server (needs to exactly match corresponding -wallet option passed to qtumd). This changes the RPC endpoint used, e.g. http://127.0.0.1:8332/wallet/<walletname>", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-stdin", "Read extra arguments from standard input, one per line until EOF/Ctrl-D (recommended for sensitive information such as passphrases). When combined with -stdinrpcpass, the first line from standard input is used for the RPC password.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-stdinbatch", "Read commands from standard input, one per line until EOF/Ctrl-D, as the method followed by its arguments separated by spaces or as a JSON array. The commands are sent in batches over one connection kept alive, and the reply of each command is written as one line of JSON in the order of the commands. Returns an error code if any command failed. When combined with -stdinrpcpass, the first line from standard input is used for the RPC password.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-stdinrpcpass", "Read RPC password from standard input as a single line. When combined with -stdin, the first line from standard input is used for the RPC password. When combined with -stdinwalletpassphrase, -stdinrpcpass consumes the first line, and -stdinwalletpassphrase consumes the second.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-stdinwalletpassphrase", "Read wallet passphrase from standard input as a single line. When combined with -stdin, the first line from standard input is used for the wallet passphrase.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 }
@@ -189,6 +196,8 @@ struct HTTPReply
     int status{0};
     int error{-1};
     std::string body;
+    //! Event loop to break once the reply is received, when the connection is kept alive
+    struct event_base* base{nullptr};
 };
 
 static std::string http_errorstring(int code)
@@ -214,6 +223,7 @@ static std::string http_errorstring(int code)
 static void http_request_done(struct evhttp_request *req, void *ctx)
 {
     HTTPReply *reply = static_cast<HTTPReply*>(ctx);
+    if (reply->base) event_base_loopbreak(reply->base);
 
     if (req == nullptr) {
         /* If req is nullptr, it means an error occurred while connecting: the
@@ -731,115 +741,140 @@ public:
     }
 };
 
-static UniValue CallRPC(BaseRequestHandler* rh, const std::string& strMethod, const std::vector<std::string>& args, const std::optional<std::string>& rpcwallet = {})
+/** An HTTP connection to the RPC server, which can be kept alive to send several requests */
+class RPCConnection
 {
-    std::string host;
-    // In preference order, we choose the following for the port:
-    //     1. -rpcport
-    //     2. port in -rpcconnect (ie following : in ipv4 or ]: in ipv6)
-    //     3. default port for chain
-    uint16_t port{BaseParams().RPCPort()};
-    SplitHostPort(gArgs.GetArg("-rpcconnect", DEFAULT_RPCCONNECT), port, host);
-    port = static_cast<uint16_t>(gArgs.GetIntArg("-rpcport", port));
-
-    // Obtain event base
-    raii_event_base base = obtain_event_base();
-
-    // Synchronously look up hostname
-    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
-
-    // Set connection timeout
+public:
+    explicit RPCConnection(const std::optional<std::string>& rpcwallet)
     {
-        const int timeout = gArgs.GetIntArg("-rpcclienttimeout", DEFAULT_HTTP_CLIENT_TIMEOUT);
-        if (timeout > 0) {
-            evhttp_connection_set_timeout(evcon.get(), timeout);
+        // In preference order, we choose the following for the port:
+        //     1. -rpcport
+        //     2. port in -rpcconnect (ie following : in ipv4 or ]: in ipv6)
+        //     3. default port for chain
+        m_port = BaseParams().RPCPort();
+        SplitHostPort(gArgs.GetArg("-rpcconnect", DEFAULT_RPCCONNECT), m_port, m_host);
+        m_port = static_cast<uint16_t>(gArgs.GetIntArg("-rpcport", m_port));
+
+        // Synchronously look up hostname
+        m_evcon = obtain_evhttp_connection_base(m_base.get(), m_host, m_port);
+
+        // Set connection timeout
+        {
+            const int timeout = gArgs.GetIntArg("-rpcclienttimeout", DEFAULT_HTTP_CLIENT_TIMEOUT);
+            if (timeout > 0) {
+                evhttp_connection_set_timeout(m_evcon.get(), timeout);
+            } else {
+                // Indefinite request timeouts are not possible in libevent-http, so we
+                // set the timeout to a very long time period instead.
+
+                constexpr int YEAR_IN_SECONDS = 31556952; // Average length of year in Gregorian calendar
+                evhttp_connection_set_timeout(m_evcon.get(), 5 * YEAR_IN_SECONDS);
+            }
+        }
+
+        // Get credentials
+        if (gArgs.GetArg("-rpcpassword", "") == "") {
+            // Try fall back to cookie-based authentication if no password is provided
+            if (!GetAuthCookie(&m_rpc_user_colon_pass)) {
+                m_failed_auth_cookie = true;
+            }
         } else {
-            // Indefinite request timeouts are not possible in libevent-http, so we
-            // set the timeout to a very long time period instead.
+            m_rpc_user_colon_pass = gArgs.GetArg("-rpcuser", "") + ":" + gArgs.GetArg("-rpcpassword", "");
+        }
 
-            constexpr int YEAR_IN_SECONDS = 31556952; // Average length of year in Gregorian calendar
-            evhttp_connection_set_timeout(evcon.get(), 5 * YEAR_IN_SECONDS);
+        // check if we should use a special wallet endpoint
+        if (rpcwallet) {
+            char* encodedURI = evhttp_uriencode(rpcwallet->data(), rpcwallet->size(), false);
+            if (encodedURI) {
+                m_endpoint = "/wallet/" + std::string(encodedURI);
+                free(encodedURI);
+            } else {
+                throw CConnectionFailed("uri-encode failed");
+            }
         }
     }
 
-    HTTPReply response;
-    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
-    if (req == nullptr) {
-        throw std::runtime_error("create http request failed");
-    }
+    /**
+     * Send a request and wait for its reply. With @p keep_alive the connection stays open
+     * for the next request, and libevent connects again if the server closed it meanwhile.
+     *
+     * @returns the parsed body of the reply.
+     * @throws a CConnectionFailed std::runtime_error if the server could not be reached.
+     */
+    UniValue Post(const std::string& strRequest, bool keep_alive)
+    {
+        HTTPReply response;
+        // The loop of an idle kept alive connection does not end on its own
+        if (keep_alive) response.base = m_base.get();
+        raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
+        if (req == nullptr) {
+            throw std::runtime_error("create http request failed");
+        }
 
-    evhttp_request_set_error_cb(req.get(), http_error_cb);
+        evhttp_request_set_error_cb(req.get(), http_error_cb);
 
-    // Get credentials
-    std::string strRPCUserColonPass;
-    bool failedToGetAuthCookie = false;
-    if (gArgs.GetArg("-rpcpassword", "") == "") {
-        // Try fall back to cookie-based authentication if no password is provided
-        if (!GetAuthCookie(&strRPCUserColonPass)) {
-            failedToGetAuthCookie = true;
-        }
-    } else {
-        strRPCUserColonPass = gArgs.GetArg("-rpcuser", "") + ":" + gArgs.GetArg("-rpcpassword", "");
-    }
+        struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
+        assert(output_headers);
+        evhttp_add_header(output_headers, "Host", m_host.c_str());
+        evhttp_add_header(output_headers, "Connection", keep_alive ? "keep-alive" : "close");
+        evhttp_add_header(output_headers, "Content-Type", "application/json");
+        evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(m_rpc_user_colon_pass)).c_str());
 
-    struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
-    assert(output_headers);
-    evhttp_add_header(output_headers, "Host", host.c_str());
-    evhttp_add_header(output_headers, "Connection", "close");
-    evhttp_add_header(output_headers, "Content-Type", "application/json");
-    evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(strRPCUserColonPass)).c_str());
-
-    // Attach request data
-    std::string strRequest = rh->PrepareRequest(strMethod, args).write() + "\n";
-    struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
-    assert(output_buffer);
-    evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
-
-    // check if we should use a special wallet endpoint
-    std::string endpoint = "/";
-    if (rpcwallet) {
-        char* encodedURI = evhttp_uriencode(rpcwallet->data(), rpcwallet->size(), false);
-        if (encodedURI) {
-            endpoint = "/wallet/" + std::string(encodedURI);
-            free(encodedURI);
-        } else {
-            throw CConnectionFailed("uri-encode failed");
+        // Attach request data
+        struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
+        assert(output_buffer);
+        evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
+
+        int r = evhttp_make_request(m_evcon.get(), req.get(), EVHTTP_REQ_POST, m_endpoint.c_str());
+        req.release(); // ownership moved to evcon in above call
+        if (r != 0) {
+            throw CConnectionFailed("send http request failed");
         }
-    }
-    int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, endpoint.c_str());
-    req.release(); // ownership moved to evcon in above call
-    if (r != 0) {
-        throw CConnectionFailed("send http request failed");
+
+        event_base_dispatch(m_base.get());
+
+        if (response.status == 0) {
+            std::string responseErrorMessage;
+            if (response.error != -1) {
+                responseErrorMessage = strprintf(" (error code %d - \"%s\")", response.error, http_errorstring(response.error));
+            }
+            throw CConnectionFailed(strprintf("Could not connect to the server %s:%d%s\n\nMake sure the qtumd server is running and that you are connecting to the correct RPC port.", m_host, m_port, responseErrorMessage));
+        } else if (response.status == HTTP_UNAUTHORIZED) {
+            if (m_failed_auth_cookie) {
+                throw std::runtime_error(strprintf(
+                    "Could not locate RPC credentials. No authentication cookie could be found, and RPC password is not set.  See -rpcpassword and -stdinrpcpass.  Configuration file: (%s)",
+                    fs::PathToString(gArgs.GetConfigFilePath())));
+            } else {
+                throw std::runtime_error("Authorization failed: Incorrect rpcuser or rpcpassword");
+            }
+        } else if (response.status == HTTP_SERVICE_UNAVAILABLE) {
+            throw std::runtime_error(strprintf("Server response: %s", response.body));
+        } else if (response.status >= 400 && response.status != HTTP_BAD_REQUEST && response.status != HTTP_NOT_FOUND && response.status != HTTP_INTERNAL_SERVER_ERROR)
+            throw std::runtime_error(strprintf("server returned HTTP error %d", response.status));
+        else if (response.body.empty())
+            throw std::runtime_error("no response from server");
+
+        // Parse reply
+        UniValue valReply(UniValue::VSTR);
+        if (!valReply.read(response.body))
+            throw std::runtime_error("couldn't parse reply from server");
+        return valReply;
     }
 
-    event_base_dispatch(base.get());
+private:
+    std::string m_host;
+    uint16_t m_port{0};
+    raii_event_base m_base{obtain_event_base()};
+    raii_evhttp_connection m_evcon;
+    std::string m_rpc_user_colon_pass;
+    bool m_failed_auth_cookie{false};
+    std::string m_endpoint{"/"};
+};
 
-    if (response.status == 0) {
-        std::string responseErrorMessage;
-        if (response.error != -1) {
-            responseErrorMessage = strprintf(" (error code %d - \"%s\")", response.error, http_errorstring(response.error));
-        }
-        throw CConnectionFailed(strprintf("Could not connect to the server %s:%d%s\n\nMake sure the qtumd server is running and that you are connecting to the correct RPC port.", host, port, responseErrorMessage));
-    } else if (response.status == HTTP_UNAUTHORIZED) {
-        if (failedToGetAuthCookie) {
-            throw std::runtime_error(strprintf(
-                "Could not locate RPC credentials. No authentication cookie could be found, and RPC password is not set.  See -rpcpassword and -stdinrpcpass.  Configuration file: (%s)",
-                fs::PathToString(gArgs.GetConfigFilePath())));
-        } else {
-            throw std::runtime_error("Authorization failed: Incorrect rpcuser or rpcpassword");
-        }
-    } else if (response.status == HTTP_SERVICE_UNAVAILABLE) {
-        throw std::runtime_error(strprintf("Server response: %s", response.body));
-    } else if (response.status >= 400 && response.status != HTTP_BAD_REQUEST && response.status != HTTP_NOT_FOUND && response.status != HTTP_INTERNAL_SERVER_ERROR)
-        throw std::runtime_error(strprintf("server returned HTTP error %d", response.status));
-    else if (response.body.empty())
-        throw std::runtime_error("no response from server");
-
-    // Parse reply
-    UniValue valReply(UniValue::VSTR);
-    if (!valReply.read(response.body))
-        throw std::runtime_error("couldn't parse reply from server");
-    UniValue reply = rh->ProcessReply(valReply);
+static UniValue CallRPC(BaseRequestHandler* rh, const std::string& strMethod, const std::vector<std::string>& args, const std::optional<std::string>& rpcwallet = {})
+{
+    RPCConnection connection{rpcwallet};
+    UniValue reply = rh->ProcessReply(connection.Post(rh->PrepareRequest(strMethod, args).write() + "\n", /*keep_alive=*/false));
     if (reply.empty())
         throw std::runtime_error("expected reply to have result, error and id properties");
 
@@ -1112,6 +1147,103 @@ static void SetGenerateToAddressArgs(const std::string& address, std::vector<std
     args.emplace(args.begin() + 1, address);
 }
 
+/**
+ * Parse a command of -stdinbatch, either a method followed by its arguments separated by
+ * whitespace or a JSON array whose first element is the method.
+ */
+static std::vector<std::string> ParseBatchCommand(const std::string& line)
+{
+    std::vector<std::string> command;
+    if (line.front() == '[') {
+        UniValue array;
+        if (!array.read(line) || !array.isArray()) {
+            throw std::runtime_error("command is not a valid JSON array");
+        }
+        for (const UniValue& arg : array.getValues()) {
+            command.push_back(arg.isStr() ? arg.get_str() : arg.write());
+        }
+    } else {
+        for (std::string& arg : SplitString(line, " \t")) {
+            if (!arg.empty()) command.push_back(std::move(arg));
+        }
+    }
+    if (command.empty() || command[0].empty()) {
+        throw std::runtime_error("command has no method");
+    }
+    return command;
+}
+
+/**
+ * Read commands from standard input, one per line, and send them in JSON-RPC batches of
+ * -batchsize commands over one kept alive connection. The reply of each command is written
+ * as one line of JSON, in the order of the commands, as soon as its batch is answered.
+ *
+ * libevent sends the next request on a connection once the previous reply was read, so a
+ * batch rather than a queue of requests is what avoids the round trip per command.
+ *
+ * @returns 1 if any of the commands failed, 0 otherwise.
+ */
+static int StdinBatchRPC(const std::optional<std::string>& rpcwallet)
+{
+    const size_t batch_size = std::max<int64_t>(1, gArgs.GetIntArg("-batchsize", DEFAULT_BATCH_SIZE));
+    const bool named = gArgs.GetBoolArg("-named", DEFAULT_NAMED);
+    RPCConnection connection{rpcwallet};
+    int nRet = 0;
+    int64_t line_number = 0;
+    bool eof = false;
+    while (!eof) {
+        // Commands that cannot be converted are answered with their error without being sent
+        UniValue batch(UniValue::VARR);
+        std::vector<UniValue> replies;
+        std::map<int64_t, size_t> positions;
+        std::string line;
+        while (replies.size() < batch_size) {
+            if (!std::getline(std::cin, line)) {
+                eof = true;
+                break;
+            }
+            ++line_number;
+            line = TrimString(line);
+            if (line.empty()) continue;
+            try {
+                std::vector<std::string> args = ParseBatchCommand(line);
+                const std::string method = args[0];
+                args.erase(args.begin());
+                UniValue params = named ? RPCConvertNamedValues(method, args) : RPCConvertValues(method, args);
+                batch.push_back(JSONRPCRequestObj(method, params, line_number));
+                positions.emplace(line_number, replies.size());
+                replies.emplace_back();
+            } catch (const std::exception& e) {
+                replies.push_back(JSONRPCReplyObj(NullUniValue, JSONRPCError(RPC_INVALID_PARAMETER, e.what()), line_number));
+            }
+        }
+        if (!batch.empty()) {
+            const UniValue reply = connection.Post(batch.write() + "\n", /*keep_alive=*/true);
+            if (!reply.isArray()) {
+                // A batch that failed as a whole, like for an unknown wallet
+                throw std::runtime_error(strprintf("unexpected reply to batch: %s", reply.write()));
+            }
+            for (const UniValue& item : reply.getValues()) {
+                const UniValue& id = find_value(item, "id");
+                if (!id.isNum()) continue;
+                const auto it = positions.find(id.getInt<int64_t>());
+                if (it != positions.end()) replies[it->second] = item;
+            }
+        }
+        for (const auto& [id, pos] : positions) {
+            if (replies[pos].isNull()) {
+                replies[pos] = JSONRPCReplyObj(NullUniValue, JSONRPCError(RPC_MISC_ERROR, "no reply from server"), id);
+            }
+        }
+        for (const UniValue& reply : replies) {
+            if (!find_value(reply, "error").isNull()) nRet = 1;
+            std::cout << reply.write() << '\n';
+        }
+        std::cout.flush();
+    }
+    return nRet;
+}
+
 static int CommandLineRPC(int argc, char *argv[])
 {
     std::string strPrint;
@@ -1138,6 +1270,14 @@ static int CommandLineRPC(int argc, char *argv[])
             gArgs.ForceSetArg("-rpcpassword", rpcPass);
         }
         std::vector<std::string> args = std::vector<std::string>(&argv[1], &argv[argc]);
+        if (gArgs.GetBoolArg("-stdinbatch", false)) {
+            if (!args.empty() || gArgs.GetBoolArg("-stdin", false) || gArgs.GetBoolArg("-stdinwalletpassphrase", false)) {
+                throw std::runtime_error("-stdinbatch reads the commands from standard input and cannot be combined with a command, -stdin or -stdinwalletpassphrase");
+            }
+            std::optional<std::string> wallet_name{};
+            if (gArgs.IsArgSet("-rpcwallet")) wallet_name = gArgs.GetArg("-rpcwallet", "");
+            return StdinBatchRPC(wallet_name);
+        }
         if (gArgs.GetBoolArg("-stdinwalletpassphrase", false)) {
             NO_STDIN_ECHO();
             std::string walletPass;
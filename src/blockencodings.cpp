@@ -16,15 +16,29 @@
 
 #include <unordered_map>
 
+bool CBlockHeaderAndShortTxIDs::IsPrefilled(const CBlock& block, size_t index)
+{
+    // The coinstake and the OP_SPEND txs that move contract value are made by the staker
+    // and never relayed, so peers cannot find them in their mempool
+    if (index == 0) return true;
+    if (index == 1 && block.IsProofOfStake()) return true;
+    return block.vtx[index]->HasOpSpend();
+}
+
 CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block) :
         nonce(GetRand<uint64_t>()),
-        shorttxids(block.vtx.size() - 1), prefilledtxn(1), header(block) {
+        header(block) {
     FillShortTxIDSelector();
-    //TODO: Use our mempool prior to block acceptance to predictively fill more than just the coinbase
-    prefilledtxn[0] = {0, block.vtx[0]};
-    for (size_t i = 1; i < block.vtx.size(); i++) {
+    //TODO: Use our mempool prior to block acceptance to predictively fill more than just the txs made by the staker
+    int32_t lastprefilledindex = -1;
+    for (size_t i = 0; i < block.vtx.size(); i++) {
         const CTransaction& tx = *block.vtx[i];
-        shorttxids[i - 1] = GetShortID(tx.GetWitnessHash());
+        if (IsPrefilled(block, i)) {
+            prefilledtxn.push_back({static_cast<uint16_t>(i - lastprefilledindex - 1), block.vtx[i]});
+            lastprefilledindex = i;
+        } else {
+            shorttxids.push_back(GetShortID(tx.GetWitnessHash()));
+        }
     }
 }
 
@@ -115,6 +115,9 @@ public:
 
     uint64_t GetShortID(const uint256& txhash) const;
 
+    /** Whether the tx at @p index of @p block is sent in full rather than as a short ID */
+    static bool IsPrefilled(const CBlock& block, size_t index);
+
     size_t BlockTxCount() const { return shorttxids.size() + prefilledtxn.size(); }
 
     SERIALIZE_METHODS(CBlockHeaderAndShortTxIDs, obj)
@@ -22,6 +22,7 @@ static constexpr int GCS_SER_VERSION = 0;
 
 static const std::map<BlockFilterType, std::string> g_filter_types = {
     {BlockFilterType::BASIC, "basic"},
+    {BlockFilterType::CONTRACT, "contract"},
 };
 
 uint64_t GCSFilter::HashToRange(const Element& element) const
@@ -229,10 +230,26 @@ BlockFilter::BlockFilter(BlockFilterType filter_type, const CBlock& block, const
     m_filter = GCSFilter(params, BasicFilterElements(block, block_undo));
 }
 
+BlockFilter::BlockFilter(BlockFilterType filter_type, const CBlock& block, const CBlockUndo& block_undo,
+                         const GCSFilter::ElementSet& contract_elements)
+    : m_filter_type(filter_type), m_block_hash(block.GetHash())
+{
+    GCSFilter::Params params;
+    if (!BuildParams(params)) {
+        throw std::invalid_argument("unknown filter_type");
+    }
+    GCSFilter::ElementSet elements = BasicFilterElements(block, block_undo);
+    if (m_filter_type == BlockFilterType::CONTRACT) {
+        elements.insert(contract_elements.begin(), contract_elements.end());
+    }
+    m_filter = GCSFilter(params, elements);
+}
+
 bool BlockFilter::BuildParams(GCSFilter::Params& params) const
 {
     switch (m_filter_type) {
     case BlockFilterType::BASIC:
+    case BlockFilterType::CONTRACT:
         params.m_siphash_k0 = m_block_hash.GetUint64(0);
         params.m_siphash_k1 = m_block_hash.GetUint64(1);
         params.m_P = BASIC_FILTER_P;
@@ -89,6 +89,8 @@ constexpr uint32_t BASIC_FILTER_M = 784931;
 enum class BlockFilterType : uint8_t
 {
     BASIC = 0,
+    //! BASIC elements plus the contract addresses and log topics of the block's receipts
+    CONTRACT = 1,
     INVALID = 255,
 };
 
@@ -128,6 +130,11 @@ public:
     //! Construct a new BlockFilter of the specified type from a block.
     BlockFilter(BlockFilterType filter_type, const CBlock& block, const CBlockUndo& block_undo);
 
+    //! Construct a new BlockFilter of the specified type from a block and the elements of its
+    //! contract receipts, which are only committed by CONTRACT filters.
+    BlockFilter(BlockFilterType filter_type, const CBlock& block, const CBlockUndo& block_undo,
+                const GCSFilter::ElementSet& contract_elements);
+
     BlockFilterType GetFilterType() const { return m_filter_type; }
     const uint256& GetBlockHash() const LIFETIMEBOUND { return m_block_hash; }
     const GCSFilter& GetFilter() const LIFETIMEBOUND { return m_filter; }
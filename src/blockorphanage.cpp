@@ -0,0 +1,188 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockorphanage.h>
+
+#include <clientversion.h>
+#include <logging.h>
+#include <random.h>
+#include <streams.h>
+
+#include <cassert>
+
+bool BlockOrphanage::AddBlock(const CBlock& block, NodeId peer)
+{
+    LOCK(m_mutex);
+
+    const uint256 hash = block.GetHash();
+    if (m_orphans.count(hash))
+        return false;
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+    Span<const uint8_t> data = MakeUCharSpan(ss);
+
+    // A peer that sends more orphans than its share keeps its older ones, they are
+    // requested again once their chain is connected
+    size_t& peer_bytes = m_peer_bytes[peer];
+    if (peer_bytes + data.size() > m_max_bytes / ORPHAN_BLOCKS_PEER_SHARE) {
+        if (peer_bytes == 0) m_peer_bytes.erase(peer);
+        LogPrint(BCLog::NET, "orphan block %s from peer=%d exceeds its share of the orphan pool\n", hash.ToString(), peer);
+        return false;
+    }
+
+    auto ret = m_orphans.emplace(hash, OrphanBlock{block.hashPrevBlock, block.GetProofOfStake(), block.IsProofOfStake(),
+                                                   std::vector<unsigned char>(data.begin(), data.end()), peer, NOT_LEAF});
+    assert(ret.second);
+    OrphanMap::iterator it = ret.first;
+    peer_bytes += data.size();
+    m_total_bytes += data.size();
+    if (it->second.fProofOfStake)
+        m_stakes.insert(it->second.stake);
+
+    // The previous block is no longer a leaf, and the new one is unless its children came first
+    OrphanMap::iterator prev = m_orphans.find(block.hashPrevBlock);
+    if (prev != m_orphans.end())
+        RemoveLeaf(prev);
+    m_orphans_by_prev.emplace(block.hashPrevBlock, it);
+    if (!m_orphans_by_prev.count(hash))
+        AddLeaf(it);
+
+    // Evict random orphans without orphan children until the pool fits
+    FastRandomContext rng;
+    unsigned int nEvicted = 0;
+    while (m_total_bytes > m_max_bytes && !m_leaves.empty()) {
+        _EraseBlock(m_leaves[rng.randrange(m_leaves.size())]);
+        ++nEvicted;
+    }
+    if (nEvicted > 0) LogPrint(BCLog::NET, "orphan block overflow, removed %u blocks\n", nEvicted);
+
+    LogPrint(BCLog::NET, "stored orphan block %s (mapsz %u bytes %u)\n", hash.ToString(), m_orphans.size(), m_total_bytes);
+    return m_orphans.count(hash) > 0;
+}
+
+bool BlockOrphanage::HaveBlock(const uint256& hash) const
+{
+    LOCK(m_mutex);
+    return m_orphans.count(hash) > 0;
+}
+
+bool BlockOrphanage::HaveChildren(const uint256& hash) const
+{
+    LOCK(m_mutex);
+    return m_orphans_by_prev.count(hash) > 0;
+}
+
+bool BlockOrphanage::HaveStake(const std::pair<COutPoint, unsigned int>& stake) const
+{
+    LOCK(m_mutex);
+    return m_stakes.count(stake) > 0;
+}
+
+uint256 BlockOrphanage::GetRoot(const uint256& hash) const
+{
+    LOCK(m_mutex);
+    uint256 root = hash;
+    // Work back to the first block in the orphan chain
+    for (auto it = m_orphans.find(root); it != m_orphans.end(); it = m_orphans.find(root)) {
+        root = it->second.hashPrev;
+        if (!m_orphans.count(root))
+            return it->first;
+    }
+    return root;
+}
+
+std::vector<CBlock> BlockOrphanage::TakeChildren(const uint256& hash)
+{
+    LOCK(m_mutex);
+    std::vector<OrphanMap::iterator> children;
+    auto range = m_orphans_by_prev.equal_range(hash);
+    for (auto mi = range.first; mi != range.second; ++mi) {
+        children.push_back(mi->second);
+    }
+
+    std::vector<CBlock> blocks;
+    for (OrphanMap::iterator it : children) {
+        CBlock& block = blocks.emplace_back();
+        CDataStream ss(it->second.vchBlock, SER_DISK, CLIENT_VERSION);
+        ss >> block;
+        _EraseBlock(it);
+    }
+    return blocks;
+}
+
+void BlockOrphanage::EraseForPeer(NodeId peer)
+{
+    LOCK(m_mutex);
+    if (!m_peer_bytes.count(peer))
+        return;
+
+    int nErased = 0;
+    OrphanMap::iterator iter = m_orphans.begin();
+    while (iter != m_orphans.end()) {
+        OrphanMap::iterator maybeErase = iter++;
+        if (maybeErase->second.fromPeer == peer) {
+            _EraseBlock(maybeErase);
+            ++nErased;
+        }
+    }
+    if (nErased > 0) LogPrint(BCLog::NET, "Erased %d orphan block(s) from peer=%d\n", nErased, peer);
+}
+
+void BlockOrphanage::AddLeaf(OrphanMap::iterator it)
+{
+    AssertLockHeld(m_mutex);
+    if (it->second.leaf_pos != NOT_LEAF)
+        return;
+    it->second.leaf_pos = m_leaves.size();
+    m_leaves.push_back(it);
+}
+
+void BlockOrphanage::RemoveLeaf(OrphanMap::iterator it)
+{
+    AssertLockHeld(m_mutex);
+    size_t old_pos = it->second.leaf_pos;
+    if (old_pos == NOT_LEAF)
+        return;
+    // Move the last leaf in its place
+    assert(m_leaves[old_pos] == it);
+    if (old_pos + 1 != m_leaves.size()) {
+        OrphanMap::iterator it_last = m_leaves.back();
+        m_leaves[old_pos] = it_last;
+        it_last->second.leaf_pos = old_pos;
+    }
+    m_leaves.pop_back();
+    it->second.leaf_pos = NOT_LEAF;
+}
+
+void BlockOrphanage::_EraseBlock(OrphanMap::iterator it)
+{
+    AssertLockHeld(m_mutex);
+    const OrphanBlock& orphan = it->second;
+    RemoveLeaf(it);
+
+    auto range = m_orphans_by_prev.equal_range(orphan.hashPrev);
+    for (auto mi = range.first; mi != range.second; ++mi) {
+        if (mi->second == it) {
+            m_orphans_by_prev.erase(mi);
+            break;
+        }
+    }
+    OrphanMap::iterator prev = m_orphans.find(orphan.hashPrev);
+    if (prev != m_orphans.end() && !m_orphans_by_prev.count(orphan.hashPrev))
+        AddLeaf(prev);
+
+    if (orphan.fProofOfStake) {
+        auto stake = m_stakes.find(orphan.stake);
+        if (stake != m_stakes.end()) m_stakes.erase(stake);
+    }
+
+    auto peer_bytes = m_peer_bytes.find(orphan.fromPeer);
+    assert(peer_bytes != m_peer_bytes.end() && peer_bytes->second >= orphan.vchBlock.size());
+    peer_bytes->second -= orphan.vchBlock.size();
+    if (peer_bytes->second == 0) m_peer_bytes.erase(peer_bytes);
+    m_total_bytes -= orphan.vchBlock.size();
+
+    m_orphans.erase(it);
+}
@@ -0,0 +1,113 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKORPHANAGE_H
+#define BITCOIN_BLOCKORPHANAGE_H
+
+#include <net.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+/** A peer may hold at most this fraction (1/n) of the orphan block pool */
+static constexpr size_t ORPHAN_BLOCKS_PEER_SHARE{4};
+
+/** A class to track the blocks received before their previous block (orphan blocks).
+ * The blocks are kept serialized and only deserialized when their previous block is
+ * connected. The pool is limited in bytes, and every peer to a share of it, so one peer
+ * cannot evict the orphans of the others. Orphans without orphan children are evicted
+ * at random when the pool is full.
+ */
+class BlockOrphanage {
+public:
+    explicit BlockOrphanage(size_t max_bytes) : m_max_bytes(max_bytes) {}
+
+    /** Add a new orphan block received from a peer. Returns false if the block is already
+     *  there or does not fit in the share of the peer. */
+    bool AddBlock(const CBlock& block, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Check if we already have an orphan block */
+    bool HaveBlock(const uint256& hash) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Check if an orphan block builds on the block @p hash */
+    bool HaveChildren(const uint256& hash) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Check if an orphan block has the proof-of-stake @p stake */
+    bool HaveStake(const std::pair<COutPoint, unsigned int>& stake) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Return the first block of the orphan chain of @p hash, the previous block of which is missing */
+    uint256 GetRoot(const uint256& hash) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Remove the orphan blocks that build on the block @p hash and return them */
+    std::vector<CBlock> TakeChildren(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Erase all orphan blocks received from a peer (eg, after that peer disconnects) */
+    void EraseForPeer(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Return how many orphan blocks there are */
+    size_t Size() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        return m_orphans.size();
+    }
+
+    /** Return the serialized size of the orphan blocks */
+    size_t TotalBytes() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        return m_total_bytes;
+    }
+
+protected:
+    /** Guards orphan blocks */
+    mutable Mutex m_mutex;
+
+    const size_t m_max_bytes;
+
+    struct OrphanBlock {
+        uint256 hashPrev;
+        std::pair<COutPoint, unsigned int> stake;
+        bool fProofOfStake;
+        std::vector<unsigned char> vchBlock;
+        NodeId fromPeer;
+        //! Position in m_leaves, NOT_LEAF when an orphan builds on it
+        size_t leaf_pos;
+    };
+
+    static constexpr size_t NOT_LEAF{std::numeric_limits<size_t>::max()};
+
+    std::map<uint256, OrphanBlock> m_orphans GUARDED_BY(m_mutex);
+
+    using OrphanMap = decltype(m_orphans);
+
+    /** Index from the previous block hash into m_orphans */
+    std::multimap<uint256, OrphanMap::iterator> m_orphans_by_prev GUARDED_BY(m_mutex);
+
+    /** Proofs-of-stake of the orphan blocks, a stake is only used again by a block that has an orphan child */
+    std::multiset<std::pair<COutPoint, unsigned int>> m_stakes GUARDED_BY(m_mutex);
+
+    /** Orphan blocks without orphan children, in a vector for quick random eviction */
+    std::vector<OrphanMap::iterator> m_leaves GUARDED_BY(m_mutex);
+
+    /** Serialized size of the orphan blocks of every peer */
+    std::map<NodeId, size_t> m_peer_bytes GUARDED_BY(m_mutex);
+
+    size_t m_total_bytes GUARDED_BY(m_mutex){0};
+
+    void AddLeaf(OrphanMap::iterator it) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void RemoveLeaf(OrphanMap::iterator it) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    /** Erase an orphan block, and make its previous block a leaf if it is an orphan left without children */
+    void _EraseBlock(OrphanMap::iterator it) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+};
+
+#endif // BITCOIN_BLOCKORPHANAGE_H
@@ -11,7 +11,11 @@
 #include <util/threadnames.h>
 
 #include <algorithm>
-#include <iterator>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 
 template <typename T>
@@ -26,11 +30,35 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Each worker has a lane of batches, which the master fills in turn. A
+  * worker claims checks from the batches of its own lane first and steals
+  * from the other lanes when it runs out, with atomic operations only, so
+  * that the workers do not contend on a lock while there is work. The
+  * mutex is only taken to add batches and to sleep or wake up.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
+    /** A batch of checks, claimed a few at a time by the workers and freed once all are done */
+    struct Segment {
+        std::vector<T> checks;
+        //! Index of the first check that no worker has claimed
+        std::atomic<size_t> next{0};
+        //! Next segment of the same lane
+        std::atomic<Segment*> link{nullptr};
+
+        explicit Segment(std::vector<T>&& checks_in) : checks(std::move(checks_in)) {}
+    };
+
+    struct Lane {
+        //! First segment of the lane that may have unclaimed checks
+        std::atomic<Segment*> head{nullptr};
+        //! Last segment of the lane, only used by the master
+        Segment* tail{nullptr};
+    };
+
     //! Mutex to protect the inner state
     Mutex m_mutex;
 
@@ -40,25 +68,31 @@ private:
     //! Master thread blocks on this when out of work
     std::condition_variable m_master_cv;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue GUARDED_BY(m_mutex);
+    //! One lane for each worker thread and a last one for the master
+    std::vector<Lane> m_lanes;
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle GUARDED_BY(m_mutex){0};
+    //! Lane the next batch is added to, only used by the master
+    size_t m_next_lane{0};
 
-    //! The total number of workers (including the master).
-    int nTotal GUARDED_BY(m_mutex){0};
+    //! The batches of the current verification, only used by the master
+    std::vector<std::unique_ptr<Segment>> m_segments;
 
-    //! The temporary evaluation result.
-    bool fAllOk GUARDED_BY(m_mutex){true};
+    //! Number of checks that no worker has claimed yet. Only increased under m_mutex, which
+    //! the workers wait on for it.
+    std::atomic<size_t> m_unclaimed{0};
 
     /**
      * Number of verifications that haven't completed yet.
-     * This includes elements that are no longer queued, but still in the
-     * worker's own batches.
+     * This includes elements that are claimed but still being run by a worker.
      */
-    unsigned int nTodo GUARDED_BY(m_mutex){0};
+    std::atomic<size_t> m_todo{0};
+
+    //! Number of workers (including the master) looking through the lanes or running checks, which
+    //! keeps the segments alive
+    std::atomic<int> m_scanning{0};
+
+    //! The temporary evaluation result.
+    std::atomic<bool> m_all_ok{true};
 
     //! The maximum number of elements to be processed in one batch
     const unsigned int nBatchSize;
@@ -66,64 +100,89 @@ private:
     std::vector<std::thread> m_worker_threads;
     bool m_request_stop GUARDED_BY(m_mutex){false};
 
-    /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    /** Claim unclaimed checks, from lane @p own first. @returns their segment, or nullptr if there are none. */
+    Segment* Claim(size_t own, size_t& begin, size_t& end)
     {
-        std::condition_variable& cond = fMaster ? m_master_cv : m_worker_cv;
-        std::vector<T> vChecks;
-        vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
-        do {
-            {
-                WAIT_LOCK(m_mutex, lock);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        m_master_cv.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty() && !m_request_stop) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        fAllOk = true;
-                        // return the current status
-                        return fRet;
+        const size_t lanes = m_lanes.size();
+        for (size_t i = 0; i < lanes; ++i) {
+            Lane& lane = m_lanes[(own + i) % lanes];
+            for (Segment* segment = lane.head.load(); segment;) {
+                const size_t size = segment->checks.size();
+                if (segment->next.load(std::memory_order_relaxed) < size) {
+                    // Do not take everything at once, but aim for increasingly smaller batches so all
+                    // workers finish approximately simultaneously, and no larger than nBatchSize.
+                    const size_t remaining = size - std::min(size, segment->next.load(std::memory_order_relaxed));
+                    const size_t count = std::clamp<size_t>(remaining / (lanes + 1), 1, nBatchSize);
+                    begin = segment->next.fetch_add(count);
+                    if (begin < size) {
+                        end = std::min(begin + count, size);
+                        m_unclaimed -= end - begin;
+                        return segment;
                     }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
                 }
-                if (m_request_stop) {
-                    return false;
+                // Skip the exhausted segment from now on, unless the master may still link a segment after it
+                Segment* link = segment->link.load();
+                if (link) {
+                    Segment* expected = segment;
+                    lane.head.compare_exchange_strong(expected, link);
                 }
+                segment = link;
+            }
+        }
+        return nullptr;
+    }
 
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                auto start_it = queue.end() - nNow;
-                vChecks.assign(std::make_move_iterator(start_it), std::make_move_iterator(queue.end()));
-                queue.erase(start_it, queue.end());
+    /** Internal function that does bulk of the verification work. */
+    bool Loop(bool fMaster, size_t lane) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        do {
+            // The segments cannot be freed while this worker looks at them
+            ++m_scanning;
+            size_t begin, end;
+            if (Segment* segment = Claim(lane, begin, end)) {
                 // Check whether we need to do work at all
-                fOk = fAllOk;
+                bool fOk = m_all_ok.load(std::memory_order_relaxed);
+                for (size_t i = begin; i < end && fOk; ++i) {
+                    fOk = segment->checks[i]();
+                }
+                if (!fOk) m_all_ok = false;
+                if (m_todo.fetch_sub(end - begin) == end - begin) {
+                    // We processed the last element; inform the master it can exit and return the result
+                    WITH_LOCK(m_mutex, m_master_cv.notify_one());
+                }
+                --m_scanning;
+                continue;
+            }
+            --m_scanning;
+
+            WAIT_LOCK(m_mutex, lock);
+            if (fMaster) {
+                // No check is added while the master waits, so there is none left to claim
+                while (m_todo.load() != 0) {
+                    m_master_cv.wait(lock);
+                }
+                break;
+            }
+            while (m_unclaimed.load() == 0 && !m_request_stop) {
+                m_worker_cv.wait(lock);
+            }
+            if (m_request_stop) {
+                return false;
             }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
         } while (true);
+
+        // Detach the segments from the lanes, and free them once no worker can look at them anymore
+        for (Lane& l : m_lanes) {
+            l.head = nullptr;
+            l.tail = nullptr;
+        }
+        while (m_scanning.load() != 0) {
+            std::this_thread::yield();
+        }
+        m_segments.clear();
+        m_next_lane = 0;
+        // reset the status for new work later, and return the current status
+        return m_all_ok.exchange(true);
     }
 
 public:
@@ -132,25 +191,23 @@ public:
 
     //! Create a new check queue
     explicit CCheckQueue(unsigned int nBatchSizeIn)
-        : nBatchSize(nBatchSizeIn)
+        : m_lanes(1), nBatchSize(nBatchSizeIn)
     {
     }
 
     //! Create a pool of new worker threads.
-    void StartWorkerThreads(const int threads_num) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    void StartWorkerThreads(const int threads_num, const std::string& thread_name = "scriptch", SyscallSandboxPolicy sandbox_policy = SyscallSandboxPolicy::VALIDATION_SCRIPT_CHECK) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
-        {
-            LOCK(m_mutex);
-            nIdle = 0;
-            nTotal = 0;
-            fAllOk = true;
-        }
         assert(m_worker_threads.empty());
+        assert(m_segments.empty());
+        m_lanes = std::vector<Lane>(threads_num + 1);
+        m_next_lane = 0;
+        m_all_ok = true;
         for (int n = 0; n < threads_num; ++n) {
-            m_worker_threads.emplace_back([this, n]() {
-                util::ThreadRename(strprintf("scriptch.%i", n));
-                SetSyscallSandboxPolicy(SyscallSandboxPolicy::VALIDATION_SCRIPT_CHECK);
-                Loop(false /* worker thread */);
+            m_worker_threads.emplace_back([this, n, thread_name, sandbox_policy]() {
+                util::ThreadRename(strprintf("%s.%i", thread_name, n));
+                SetSyscallSandboxPolicy(sandbox_policy);
+                Loop(false /* worker thread */, n);
             });
         }
     }
@@ -158,7 +215,7 @@ public:
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
-        return Loop(true /* master thread */);
+        return Loop(true /* master thread */, m_lanes.size() - 1);
     }
 
     //! Add a batch of checks to the queue
@@ -168,13 +225,24 @@ public:
             return;
         }
 
+        const size_t count = vChecks.size();
+        Segment* segment = m_segments.emplace_back(std::make_unique<Segment>(std::move(vChecks))).get();
+        Lane& lane = m_lanes[m_next_lane];
+        m_next_lane = (m_next_lane + 1) % m_lanes.size();
         {
             LOCK(m_mutex);
-            queue.insert(queue.end(), std::make_move_iterator(vChecks.begin()), std::make_move_iterator(vChecks.end()));
-            nTodo += vChecks.size();
+            // Count the checks before they can be claimed
+            m_todo += count;
+            m_unclaimed += count;
+            if (lane.tail) {
+                lane.tail->link = segment;
+            } else {
+                lane.head = segment;
+            }
+            lane.tail = segment;
         }
 
-        if (vChecks.size() == 1) {
+        if (count == 1) {
             m_worker_cv.notify_one();
         } else {
             m_worker_cv.notify_all();
@@ -22,9 +22,18 @@ bool CCoinsView::HaveCoin(const COutPoint &outpoint) const
     return GetCoin(outpoint, coin);
 }
 
+void CCoinsView::GetCoins(Span<const COutPoint> outpoints, std::vector<Coin>& coins) const
+{
+    coins.assign(outpoints.size(), Coin());
+    for (size_t i = 0; i < outpoints.size(); i++) {
+        if (!GetCoin(outpoints[i], coins[i])) coins[i].Clear();
+    }
+}
+
 CCoinsViewBacked::CCoinsViewBacked(CCoinsView *viewIn) : base(viewIn) { }
 bool CCoinsViewBacked::GetCoin(const COutPoint &outpoint, Coin &coin) const { return base->GetCoin(outpoint, coin); }
 bool CCoinsViewBacked::HaveCoin(const COutPoint &outpoint) const { return base->HaveCoin(outpoint); }
+void CCoinsViewBacked::GetCoins(Span<const COutPoint> outpoints, std::vector<Coin>& coins) const { base->GetCoins(outpoints, coins); }
 uint256 CCoinsViewBacked::GetBestBlock() const { return base->GetBestBlock(); }
 std::vector<uint256> CCoinsViewBacked::GetHeadBlocks() const { return base->GetHeadBlocks(); }
 void CCoinsViewBacked::SetBackend(CCoinsView &viewIn) { base = &viewIn; }
@@ -48,6 +57,7 @@ CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const
     Coin tmp;
     if (!base->GetCoin(outpoint, tmp))
         return cacheCoins.end();
+    auto lock = WriteLock();
     CCoinsMap::iterator ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(tmp))).first;
     if (ret->second.coin.IsSpent()) {
         // The parent only has an empty entry for this outpoint; we can consider our
@@ -58,6 +68,32 @@ CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const
     return ret;
 }
 
+void CCoinsViewCache::FetchCoins(Span<const COutPoint> outpoints) const {
+    std::vector<COutPoint> missing;
+    for (const COutPoint& outpoint : outpoints) {
+        if (!cacheCoins.count(outpoint)) missing.push_back(outpoint);
+    }
+    if (missing.empty()) return;
+    std::vector<Coin> coins;
+    base->GetCoins(missing, coins);
+    auto lock = WriteLock();
+    for (size_t i = 0; i < missing.size(); i++) {
+        // Not found, as FetchCoin nothing is cached for it
+        if (coins[i].IsSpent()) continue;
+        auto [it, inserted] = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(missing[i]), std::forward_as_tuple(std::move(coins[i])));
+        if (inserted) cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+    }
+}
+
+void CCoinsViewCache::GetCoins(Span<const COutPoint> outpoints, std::vector<Coin>& coins) const {
+    FetchCoins(outpoints);
+    coins.assign(outpoints.size(), Coin());
+    for (size_t i = 0; i < outpoints.size(); i++) {
+        CCoinsMap::const_iterator it = cacheCoins.find(outpoints[i]);
+        if (it != cacheCoins.end()) coins[i] = it->second.coin;
+    }
+}
+
 bool CCoinsViewCache::GetCoin(const COutPoint &outpoint, Coin &coin) const {
     CCoinsMap::const_iterator it = FetchCoin(outpoint);
     if (it != cacheCoins.end()) {
@@ -70,6 +106,7 @@ bool CCoinsViewCache::GetCoin(const COutPoint &outpoint, Coin &coin) const {
 void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possible_overwrite) {
     assert(!coin.IsSpent());
     if (coin.out.scriptPubKey.IsUnspendable()) return;
+    auto lock = WriteLock();
     CCoinsMap::iterator it;
     bool inserted;
     std::tie(it, inserted) = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::tuple<>());
@@ -109,6 +146,7 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
 }
 
 void CCoinsViewCache::EmplaceCoinInternalDANGER(COutPoint&& outpoint, Coin&& coin) {
+    auto lock = WriteLock();
     cachedCoinsUsage += coin.DynamicMemoryUsage();
     cacheCoins.emplace(
         std::piecewise_construct,
@@ -131,6 +169,7 @@ void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight, bool
 bool CCoinsViewCache::SpendCoin(const COutPoint &outpoint, Coin* moveout) {
     CCoinsMap::iterator it = FetchCoin(outpoint);
     if (it == cacheCoins.end()) return false;
+    auto lock = WriteLock();
     cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
     TRACE6(utxocache, spent,
            outpoint.hash.data(),
@@ -172,17 +211,35 @@ bool CCoinsViewCache::HaveCoinInCache(const COutPoint &outpoint) const {
     return (it != cacheCoins.end() && !it->second.coin.IsSpent());
 }
 
+bool CCoinsViewCache::GetCoinConcurrent(const COutPoint &outpoint, Coin &coin, uint256 &best_block) const {
+    assert(m_concurrent_reads);
+    std::shared_lock<std::shared_mutex> lock(m_concurrent_mutex);
+    best_block = hashBlock.IsNull() ? base->GetBestBlock() : hashBlock;
+    CCoinsMap::const_iterator it = cacheCoins.find(outpoint);
+    if (it != cacheCoins.end()) {
+        coin = it->second.coin;
+        return !coin.IsSpent();
+    }
+    // Coins that are not cached are the same in the backing view
+    return base->GetCoin(outpoint, coin);
+}
+
 uint256 CCoinsViewCache::GetBestBlock() const {
-    if (hashBlock.IsNull())
-        hashBlock = base->GetBestBlock();
+    if (hashBlock.IsNull()) {
+        uint256 best_block = base->GetBestBlock();
+        auto lock = WriteLock();
+        hashBlock = best_block;
+    }
     return hashBlock;
 }
 
 void CCoinsViewCache::SetBestBlock(const uint256 &hashBlockIn) {
+    auto lock = WriteLock();
     hashBlock = hashBlockIn;
 }
 
 bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn, bool erase) {
+    auto lock = WriteLock();
     for (CCoinsMap::iterator it = mapCoins.begin();
             it != mapCoins.end();
             it = erase ? mapCoins.erase(it) : std::next(it)) {
@@ -255,6 +312,8 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
 }
 
 bool CCoinsViewCache::Flush() {
+    // Held until the coins are in the backing view, so concurrent readers find them in one of the two
+    auto lock = WriteLock();
     bool fOk = base->BatchWrite(cacheCoins, hashBlock, /*erase=*/true);
     if (fOk && !cacheCoins.empty()) {
         /* BatchWrite must erase all cacheCoins elements when erase=true. */
@@ -266,6 +325,7 @@ bool CCoinsViewCache::Flush() {
 
 bool CCoinsViewCache::Sync()
 {
+    auto lock = WriteLock();
     bool fOk = base->BatchWrite(cacheCoins, hashBlock, /*erase=*/false);
     // Instead of clearing `cacheCoins` as we would in Flush(), just clear the
     // FRESH/DIRTY flags of any coin that isn't spent.
@@ -285,6 +345,7 @@ void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
     if (it != cacheCoins.end() && it->second.flags == 0) {
+        auto lock = WriteLock();
         cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
         TRACE6(utxocache, uncache,
                hash.hash.data(),
@@ -329,6 +390,7 @@ void CCoinsViewCache::ReallocateCache()
 {
     // Cache should be empty when we're calling this.
     assert(cacheCoins.size() == 0);
+    auto lock = WriteLock();
     cacheCoins.~CCoinsMap();
     ::new (&cacheCoins) CCoinsMap(0, SaltedOutpointHasher(/*deterministic=*/m_deterministic));
 }
@@ -364,19 +426,31 @@ const Coin& AccessByTxid(const CCoinsViewCache& view, const uint256& txid)
     return coinEmpty;
 }
 
+void CCoinsViewErrorCatcher::HandleReadError(const std::runtime_error& e) const {
+    for (const auto& f : m_err_callbacks) {
+        f();
+    }
+    LogPrintf("Error reading from database: %s\n", e.what());
+    // Starting the shutdown sequence and returning false to the caller would be
+    // interpreted as 'entry not found' (as opposed to unable to read data), and
+    // could lead to invalid interpretation. Just exit immediately, as we can't
+    // continue anyway, and all writes should be atomic.
+    std::abort();
+}
+
 bool CCoinsViewErrorCatcher::GetCoin(const COutPoint &outpoint, Coin &coin) const {
     try {
         return CCoinsViewBacked::GetCoin(outpoint, coin);
     } catch(const std::runtime_error& e) {
-        for (const auto& f : m_err_callbacks) {
-            f();
-        }
-        LogPrintf("Error reading from database: %s\n", e.what());
-        // Starting the shutdown sequence and returning false to the caller would be
-        // interpreted as 'entry not found' (as opposed to unable to read data), and
-        // could lead to invalid interpretation. Just exit immediately, as we can't
-        // continue anyway, and all writes should be atomic.
-        std::abort();
+        HandleReadError(e);
+    }
+}
+
+void CCoinsViewErrorCatcher::GetCoins(Span<const COutPoint> outpoints, std::vector<Coin>& coins) const {
+    try {
+        CCoinsViewBacked::GetCoins(outpoints, coins);
+    } catch(const std::runtime_error& e) {
+        HandleReadError(e);
     }
 }
 
@@ -11,6 +11,7 @@
 #include <memusage.h>
 #include <primitives/transaction.h>
 #include <serialize.h>
+#include <span.h>
 #include <uint256.h>
 #include <util/hasher.h>
 
@@ -18,6 +19,8 @@
 #include <stdint.h>
 
 #include <functional>
+#include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 
 ////////////////////////////////////////////////////////////////// // qtum
@@ -232,6 +235,11 @@ public:
     //! Just check whether a given outpoint is unspent.
     virtual bool HaveCoin(const COutPoint &outpoint) const;
 
+    /** Retrieve the Coins for a set of outpoints. coins gets one entry per outpoint, which is
+     *  left spent when no unspent coin was found for it.
+     */
+    virtual void GetCoins(Span<const COutPoint> outpoints, std::vector<Coin>& coins) const;
+
     //! Retrieve the block hash whose state this CCoinsView currently represents
     virtual uint256 GetBestBlock() const;
 
@@ -266,6 +274,7 @@ public:
     CCoinsViewBacked(CCoinsView *viewIn);
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
+    void GetCoins(Span<const COutPoint> outpoints, std::vector<Coin>& coins) const override;
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
     void SetBackend(CCoinsView &viewIn);
@@ -292,6 +301,21 @@ protected:
     /* Cached dynamic memory usage for the inner Coin objects. */
     mutable size_t cachedCoinsUsage{0};
 
+    /**
+     * Once EnableConcurrentReads() is called, GetCoinConcurrent takes this shared and every
+     * change to cacheCoins or hashBlock takes it exclusively. The changes are still only made
+     * by the single owner of the cache (e.g. the holder of cs_main for the chainstate tip),
+     * whose own reads need no lock.
+     */
+    mutable std::shared_mutex m_concurrent_mutex;
+    bool m_concurrent_reads{false};
+
+    //! Exclusive lock of m_concurrent_mutex, that does not lock anything until concurrent reads are enabled
+    std::unique_lock<std::shared_mutex> WriteLock() const
+    {
+        return m_concurrent_reads ? std::unique_lock{m_concurrent_mutex} : std::unique_lock<std::shared_mutex>{};
+    }
+
 public:
     CCoinsViewCache(CCoinsView *baseIn, bool deterministic = false);
 
@@ -303,6 +327,7 @@ public:
     // Standard CCoinsView methods
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
+    void GetCoins(Span<const COutPoint> outpoints, std::vector<Coin>& coins) const override;
     uint256 GetBestBlock() const override;
     void SetBestBlock(const uint256 &hashBlock);
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase = true) override;
@@ -317,6 +342,27 @@ public:
      */
     bool HaveCoinInCache(const COutPoint &outpoint) const;
 
+    /** Allow GetCoinConcurrent. Must be called before the cache is shared with other threads. */
+    void EnableConcurrentReads() { m_concurrent_reads = true; }
+
+    /**
+     * Look up a coin from any thread, while the owner of the cache may be changing it.
+     * Readers share a lock, so they run concurrently with each other. A coin that is not
+     * cached is read from the backing view, which must be thread safe, without caching it.
+     * best_block is the block the coins of the cache correspond to.
+     */
+    bool GetCoinConcurrent(const COutPoint &outpoint, Coin &coin, uint256 &best_block) const;
+
+    /**
+     * Load the coins of the given outpoints into this cache. The ones that are not cached
+     * yet are requested from the backing view with a single GetCoins call, which lets the
+     * coins database read them in parallel.
+     *
+     * @note this is marked const, but may actually append to `cacheCoins`, increasing
+     * memory usage.
+     */
+    void FetchCoins(Span<const COutPoint> outpoints) const;
+
     /**
      * Return a reference to Coin in the cache, or coinEmpty if not found. This is
      * more efficient than GetCoin.
@@ -444,8 +490,11 @@ public:
     }
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    void GetCoins(Span<const COutPoint> outpoints, std::vector<Coin>& coins) const override;
 
 private:
+    [[noreturn]] void HandleReadError(const std::runtime_error& e) const;
+
     /** A list of callbacks to execute upon leveldb read error. */
     std::vector<std::function<void()>> m_err_callbacks;
 
@@ -0,0 +1,66 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX2
+
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace hex_avx2 {
+namespace {
+
+/** The hex digits of the low nibbles of @p x */
+__m256i inline Digits(__m256i x)
+{
+    return _mm256_shuffle_epi8(_mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+                                                '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'), x);
+}
+
+/** The values of the hex digits in @p x, sets @p valid to the bytes that are hex digits */
+__m256i inline Values(__m256i x, __m256i& valid)
+{
+    const __m256i digit = _mm256_sub_epi8(x, _mm256_set1_epi8('0'));
+    const __m256i letter = _mm256_sub_epi8(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    const __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+    const __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+    valid = _mm256_or_si256(is_digit, is_letter);
+    return _mm256_or_si256(_mm256_and_si256(digit, is_digit), _mm256_and_si256(_mm256_add_epi8(letter, _mm256_set1_epi8(10)), is_letter));
+}
+
+} // namespace
+
+void Encode(char* out, const uint8_t* in, size_t blocks)
+{
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    for (size_t i = 0; i < blocks; ++i) {
+        // The unpacks work within the 128-bit lanes, spread the input so each lane expands 16 consecutive bytes
+        const __m256i x = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i*)(in + 32 * i)), 0xD8);
+        const __m256i hi = Digits(_mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+        const __m256i lo = Digits(_mm256_and_si256(x, mask));
+        _mm256_storeu_si256((__m256i*)(out + 64 * i), _mm256_unpacklo_epi8(hi, lo));
+        _mm256_storeu_si256((__m256i*)(out + 64 * i + 32), _mm256_unpackhi_epi8(hi, lo));
+    }
+}
+
+size_t Decode(uint8_t* out, const char* in, size_t blocks)
+{
+    // Multiply the first digit of each pair by 16 and add the second one
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    for (size_t i = 0; i < blocks; ++i) {
+        __m256i valid0, valid1;
+        const __m256i v0 = Values(_mm256_loadu_si256((const __m256i*)(in + 64 * i)), valid0);
+        const __m256i v1 = Values(_mm256_loadu_si256((const __m256i*)(in + 64 * i + 32)), valid1);
+        if (_mm256_movemask_epi8(_mm256_and_si256(valid0, valid1)) != -1) return i;
+        const __m256i b0 = _mm256_maddubs_epi16(v0, weights);
+        const __m256i b1 = _mm256_maddubs_epi16(v1, weights);
+        // The pack interleaves the lanes of its operands, put them back in order
+        _mm256_storeu_si256((__m256i*)(out + 32 * i), _mm256_permute4x64_epi64(_mm256_packus_epi16(b0, b1), 0xD8));
+    }
+    return blocks;
+}
+
+} // namespace hex_avx2
+
+#endif
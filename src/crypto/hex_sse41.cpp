@@ -0,0 +1,63 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_SSE41
+
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace hex_sse41 {
+namespace {
+
+/** The hex digits of the low nibbles of @p x */
+__m128i inline Digits(__m128i x)
+{
+    return _mm_shuffle_epi8(_mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'), x);
+}
+
+/** The values of the hex digits in @p x, sets @p valid to the bytes that are hex digits */
+__m128i inline Values(__m128i x, __m128i& valid)
+{
+    const __m128i digit = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+    const __m128i letter = _mm_sub_epi8(_mm_or_si128(x, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    const __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+    valid = _mm_or_si128(is_digit, is_letter);
+    return _mm_or_si128(_mm_and_si128(digit, is_digit), _mm_and_si128(_mm_add_epi8(letter, _mm_set1_epi8(10)), is_letter));
+}
+
+} // namespace
+
+void Encode(char* out, const uint8_t* in, size_t blocks)
+{
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    for (size_t i = 0; i < blocks; ++i) {
+        const __m128i x = _mm_loadu_si128((const __m128i*)(in + 16 * i));
+        const __m128i hi = Digits(_mm_and_si128(_mm_srli_epi16(x, 4), mask));
+        const __m128i lo = Digits(_mm_and_si128(x, mask));
+        _mm_storeu_si128((__m128i*)(out + 32 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(out + 32 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+}
+
+size_t Decode(uint8_t* out, const char* in, size_t blocks)
+{
+    // Multiply the first digit of each pair by 16 and add the second one
+    const __m128i weights = _mm_set1_epi16(0x0110);
+    for (size_t i = 0; i < blocks; ++i) {
+        __m128i valid0, valid1;
+        const __m128i v0 = Values(_mm_loadu_si128((const __m128i*)(in + 32 * i)), valid0);
+        const __m128i v1 = Values(_mm_loadu_si128((const __m128i*)(in + 32 * i + 16)), valid1);
+        if (_mm_movemask_epi8(_mm_and_si128(valid0, valid1)) != 0xffff) return i;
+        const __m128i b0 = _mm_maddubs_epi16(v0, weights);
+        const __m128i b1 = _mm_maddubs_epi16(v1, weights);
+        _mm_storeu_si128((__m128i*)(out + 16 * i), _mm_packus_epi16(b0, b1));
+    }
+    return blocks;
+}
+
+} // namespace hex_sse41
+
+#endif
@@ -8,6 +8,7 @@
 #include <crypto/common.h>
 #include <hash.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <limits>
@@ -113,11 +114,77 @@ inline void addnextract2(limb_t& c0, limb_t& c1, const limb_t& a, limb_t& n)
     c1 = c2;
 }
 
-/** in_out = in_out^(2^sq) * mul */
-inline void square_n_mul(Num3072& in_out, const int sq, const Num3072& mul)
+/** The modulus 2^3072 - MAX_PRIME_DIFF, which is not a valid reduced Num3072 but fits its limbs. */
+Num3072 Modulus()
 {
-    for (int j = 0; j < sq; ++j) in_out.Square();
-    in_out.Multiply(mul);
+    Num3072 p;
+    p.limbs[0] = std::numeric_limits<limb_t>::max() - MAX_PRIME_DIFF + 1;
+    for (int i = 1; i < Num3072::LIMBS; ++i) p.limbs[i] = std::numeric_limits<limb_t>::max();
+    return p;
+}
+
+/** a += b over the lowest n limbs, returns the carry. */
+inline limb_t add_n(Num3072& a, const Num3072& b, int n)
+{
+    double_limb_t t = 0;
+    for (int i = 0; i < n; ++i) {
+        t += (double_limb_t)a.limbs[i] + b.limbs[i];
+        a.limbs[i] = t;
+        t >>= LIMB_SIZE;
+    }
+    return t;
+}
+
+/** a -= b over the lowest n limbs, returns the borrow. */
+inline limb_t sub_n(Num3072& a, const Num3072& b, int n)
+{
+    limb_t borrow = 0;
+    for (int i = 0; i < n; ++i) {
+        const double_limb_t t = (double_limb_t)a.limbs[i] - b.limbs[i] - borrow;
+        a.limbs[i] = t;
+        borrow = (t >> LIMB_SIZE) ? 1 : 0;
+    }
+    return borrow;
+}
+
+/** a = (a + (top << (LIMB_SIZE * n))) >> 1 over the lowest n limbs. */
+inline void shr1_n(Num3072& a, limb_t top, int n)
+{
+    for (int i = 0; i < n - 1; ++i) a.limbs[i] = (a.limbs[i] >> 1) | (a.limbs[i + 1] << (LIMB_SIZE - 1));
+    a.limbs[n - 1] = (a.limbs[n - 1] >> 1) | (top << (LIMB_SIZE - 1));
+}
+
+/** Whether a >= b over the lowest n limbs. */
+inline bool geq_n(const Num3072& a, const Num3072& b, int n)
+{
+    for (int i = n - 1; i >= 0; --i) {
+        if (a.limbs[i] != b.limbs[i]) return a.limbs[i] > b.limbs[i];
+    }
+    return true;
+}
+
+/** Whether a is one. */
+inline bool is_one(const Num3072& a, int n)
+{
+    if (a.limbs[0] != 1) return false;
+    for (int i = 1; i < n; ++i) {
+        if (a.limbs[i] != 0) return false;
+    }
+    return true;
+}
+
+/** x = x / 2 mod p, for x < p. */
+inline void halve_mod(Num3072& x, const Num3072& p)
+{
+    limb_t carry = 0;
+    if (x.limbs[0] & 1) carry = add_n(x, p, Num3072::LIMBS);
+    shr1_n(x, carry, Num3072::LIMBS);
+}
+
+/** x = x - y mod p, for x, y < p. */
+inline void sub_mod(Num3072& x, const Num3072& y, const Num3072& p)
+{
+    if (sub_n(x, y, Num3072::LIMBS)) add_n(x, p, Num3072::LIMBS);
 }
 
 } // namespace
@@ -143,39 +210,41 @@ void Num3072::FullReduce()
 
 Num3072 Num3072::GetInverse() const
 {
-    // For fast exponentiation a sliding window exponentiation with repunit
-    // precomputation is utilized. See "Fast Point Decompression for Standard
-    // Elliptic Curves" (Brumley, Järvinen, 2008).
-
-    Num3072 p[12]; // p[i] = a^(2^(2^i)-1)
-    Num3072 out;
-
-    p[0] = *this;
-
-    for (int i = 0; i < 11; ++i) {
-        p[i + 1] = p[i];
-        for (int j = 0; j < (1 << i); ++j) p[i + 1].Square();
-        p[i + 1].Multiply(p[i]);
+    // Binary extended Euclidean algorithm, maintaining x1 * this = u and x2 * this = v modulo p.
+    // Its running time depends on the value, which is fine as MuHash only commits to public
+    // data, and it is several times faster than an exponentiation by p - 2. The active length
+    // of u and v shrinks as they are reduced, which saves most of the limb operations.
+    const Num3072 p = Modulus();
+    Num3072 u = *this;
+    Num3072 v = p;
+    Num3072 x1;
+    Num3072 x2;
+    x2.limbs[0] = 0;
+
+    // Zero has no inverse, return zero like the exponentiation did
+    if (std::all_of(std::begin(u.limbs), std::end(u.limbs), [](limb_t l) { return l == 0; })) return u;
+
+    int n = LIMBS;
+    while (!is_one(u, n) && !is_one(v, n)) {
+        while ((u.limbs[0] & 1) == 0) {
+            shr1_n(u, 0, n);
+            halve_mod(x1, p);
+        }
+        while ((v.limbs[0] & 1) == 0) {
+            shr1_n(v, 0, n);
+            halve_mod(x2, p);
+        }
+        if (geq_n(u, v, n)) {
+            sub_n(u, v, n);
+            sub_mod(x1, x2, p);
+        } else {
+            sub_n(v, u, n);
+            sub_mod(x2, x1, p);
+        }
+        while (n > 1 && u.limbs[n - 1] == 0 && v.limbs[n - 1] == 0) --n;
     }
 
-    out = p[11];
-
-    square_n_mul(out, 512, p[9]);
-    square_n_mul(out, 256, p[8]);
-    square_n_mul(out, 128, p[7]);
-    square_n_mul(out, 64, p[6]);
-    square_n_mul(out, 32, p[5]);
-    square_n_mul(out, 8, p[3]);
-    square_n_mul(out, 2, p[1]);
-    square_n_mul(out, 1, p[0]);
-    square_n_mul(out, 5, p[2]);
-    square_n_mul(out, 3, p[0]);
-    square_n_mul(out, 2, p[0]);
-    square_n_mul(out, 4, p[0]);
-    square_n_mul(out, 4, p[1]);
-    square_n_mul(out, 3, p[0]);
-
-    return out;
+    return is_one(u, n) ? x1 : x2;
 }
 
 void Num3072::Multiply(const Num3072& a)
@@ -5,8 +5,13 @@
 // Based on https://github.com/mjosaarinen/tiny_sha3/blob/master/sha3.c
 // by Markku-Juhani O. Saarinen <mjos@iki.fi>
 
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
 #include <crypto/sha3.h>
 #include <crypto/common.h>
+#include <compat/cpuid.h>
 #include <span.h>
 
 #include <algorithm>
@@ -20,6 +25,11 @@ namespace
 uint64_t Rotl(uint64_t x, int n) { return (x << n) | (x >> (64 - n)); }
 } // namespace
 
+namespace sha3_avx2
+{
+void KeccakF_4way(uint64_t (&st)[25][4]);
+} // namespace sha3_avx2
+
 void KeccakF(uint64_t (&st)[25])
 {
     static constexpr uint64_t RNDC[24] = {
@@ -108,6 +118,56 @@ void KeccakF(uint64_t (&st)[25])
     }
 }
 
+namespace
+{
+void KeccakF_4wayGeneric(uint64_t (&st)[25][4])
+{
+    for (int j = 0; j < 4; ++j) {
+        uint64_t one[25];
+        for (int i = 0; i < 25; ++i) one[i] = st[i][j];
+        KeccakF(one);
+        for (int i = 0; i < 25; ++i) st[i][j] = one[i];
+    }
+}
+
+using KeccakF_4wayFn = void (*)(uint64_t (&)[25][4]);
+
+KeccakF_4wayFn KeccakF_4wayAutoDetect()
+{
+#if defined(USE_ASM) && defined(HAVE_GETCPUID) && defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    const bool have_xsave = (ecx >> 27) & 1;
+    const bool have_avx = (ecx >> 28) & 1;
+    if (have_xsave && have_avx) {
+        // Check whether the OS has enabled AVX registers
+        uint32_t a, d;
+        __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        const bool have_avx2 = (ebx >> 5) & 1;
+        if ((a & 6) == 6 && have_avx2) return sha3_avx2::KeccakF_4way;
+    }
+#endif
+    return KeccakF_4wayGeneric;
+}
+
+KeccakF_4wayFn KeccakF_4wayImpl()
+{
+    static const KeccakF_4wayFn impl = KeccakF_4wayAutoDetect();
+    return impl;
+}
+} // namespace
+
+void KeccakF_4way(uint64_t (&st)[25][4])
+{
+    KeccakF_4wayImpl()(st);
+}
+
+bool KeccakF_4way_Accelerated()
+{
+    return KeccakF_4wayImpl() != KeccakF_4wayGeneric;
+}
+
 SHA3_256& SHA3_256::Write(Span<const unsigned char> data)
 {
     if (m_bufsize && m_bufsize + data.size() >= sizeof(m_buffer)) {
@@ -13,6 +13,13 @@
 //! The Keccak-f[1600] transform.
 void KeccakF(uint64_t (&st)[25]);
 
+/** The Keccak-f[1600] transform of four independent states, with word i of state j in st[i][j].
+ *  Uses AVX2 when the CPU supports it, and four KeccakF calls otherwise. */
+void KeccakF_4way(uint64_t (&st)[25][4]);
+
+/** Whether KeccakF_4way is faster than four KeccakF calls on this CPU. */
+bool KeccakF_4way_Accelerated();
+
 class SHA3_256
 {
 private:
@@ -395,8 +395,9 @@ public:
      * @post one of the following: All previously inserted elements and e are
      * now in the table, one previously inserted element is evicted from the
      * table, the entry attempted to be inserted is evicted.
+     * @returns false if an element was evicted
      */
-    inline void insert(Element e)
+    inline bool insert(Element e)
     {
         epoch_check();
         uint32_t last_loc = invalid();
@@ -408,7 +409,7 @@ public:
             if (table[loc] == e) {
                 please_keep(loc);
                 epoch_flags[loc] = last_epoch;
-                return;
+                return true;
             }
         for (uint8_t depth = 0; depth < depth_limit; ++depth) {
             // First try to insert to an empty slot, if one exists
@@ -418,7 +419,7 @@ public:
                 table[loc] = std::move(e);
                 please_keep(loc);
                 epoch_flags[loc] = last_epoch;
-                return;
+                return true;
             }
             /** Swap with the element at the location that was
             * not the last one looked at. Example:
@@ -444,6 +445,7 @@ public:
             // Recompute the locs -- unfortunately happens one too many times!
             locs = compute_hashes(e);
         }
+        return false;
     }
 
     /** contains iterates through the hash locations for a given element
@@ -484,6 +486,29 @@ public:
             }
         return false;
     }
+
+    /** find is like contains, but returns the element stored in the table.
+     *
+     * This lets an Element carry a value besides the fields compared by its
+     * operator==, to use the cache as a map.
+     *
+     * @param e the element to look for
+     * @param erase whether to attempt setting the garbage collect flag
+     *
+     * @returns a pointer to the stored element, valid until the next insert,
+     * or nullptr if the element is not found
+     */
+    inline const Element* find(const Element& e, const bool erase) const
+    {
+        std::array<uint32_t, 8> locs = compute_hashes(e);
+        for (const uint32_t loc : locs)
+            if (table[loc] == e) {
+                if (erase)
+                    allow_erase(loc);
+                return &table[loc];
+            }
+        return nullptr;
+    }
 };
 } // namespace CuckooCache
 
@@ -10,6 +10,7 @@
 #include <util/fs.h>
 #include <util/fs_helpers.h>
 #include <util/strencodings.h>
+#include <util/thread.h>
 
 #include <algorithm>
 #include <cassert>
@@ -85,6 +86,193 @@ public:
     }
 };
 
+namespace {
+
+/** Environment forwarding to another one that counts the background work and write slowdowns of a database */
+class MonitorEnv : public leveldb::EnvWrapper
+{
+public:
+    MonitorEnv(std::shared_ptr<DBActivity> activity, leveldb::Env* base) : leveldb::EnvWrapper(base), m_activity(std::move(activity)) {}
+
+    void Schedule(void (*function)(void* arg), void* arg) override
+    {
+        // The job keeps the counters alive, as the database may be closed before it returns
+        target()->Schedule(&MonitorEnv::Run, new Job{function, arg, m_activity});
+    }
+
+    void SleepForMicroseconds(int micros) override
+    {
+        // LevelDB only sleeps to slow down writes while level 0 waits for a compaction
+        target()->SleepForMicroseconds(micros);
+        LOCK(m_activity->mutex);
+        ++m_activity->stats.write_slowdowns;
+        m_activity->stats.write_slowdown_time += std::chrono::microseconds{micros};
+    }
+
+private:
+    struct Job {
+        void (*function)(void* arg);
+        void* arg;
+        std::shared_ptr<DBActivity> activity;
+    };
+
+    static void Run(void* arg)
+    {
+        std::unique_ptr<Job> job{static_cast<Job*>(arg)};
+        const auto start{SteadyClock::now()};
+        job->function(job->arg);
+        const auto time{std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - start)};
+        LOCK(job->activity->mutex);
+        ++job->activity->stats.background_compactions;
+        job->activity->stats.background_compaction_time += time;
+    }
+
+    const std::shared_ptr<DBActivity> m_activity;
+};
+
+} // namespace
+
+CompactionController::~CompactionController()
+{
+    Stop();
+}
+
+std::shared_ptr<DBActivity> CompactionController::Activity(const std::string& name)
+{
+    LOCK(m_mutex);
+    auto& activity = m_activity[name];
+    if (!activity) activity = std::make_shared<DBActivity>();
+    return activity;
+}
+
+std::unique_ptr<leveldb::Env> CompactionController::NewMonitorEnv(std::shared_ptr<DBActivity> activity, leveldb::Env* base)
+{
+    return std::make_unique<MonitorEnv>(std::move(activity), base);
+}
+
+leveldb::Env* CompactionController::SharedMonitorEnv(const std::string& name)
+{
+    auto activity{Activity(name)};
+    LOCK(m_mutex);
+    auto& env = m_shared_envs[name];
+    if (!env) env = NewMonitorEnv(std::move(activity), leveldb::Env::Default());
+    return env.get();
+}
+
+void CompactionController::Request(const void* owner, const std::string& name, std::function<void()> compact)
+{
+    auto activity{Activity(name)};
+    LOCK(m_mutex);
+    if (m_stopped) {
+        LogPrint(BCLog::LEVELDB, "Dropping compaction of %s requested at shutdown\n", name);
+        return;
+    }
+    m_queue.push_back({owner, std::move(activity), std::move(compact)});
+    if (!m_thread.joinable()) {
+        m_thread = std::thread(&util::TraceThread, "dbcompact", [this] { ThreadCompact(); });
+    }
+    m_cv.notify_all();
+}
+
+void CompactionController::Cancel(const void* owner)
+{
+    WAIT_LOCK(m_mutex, lock);
+    m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), [&](const PendingCompaction& pending) { return pending.owner == owner; }), m_queue.end());
+    m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_running != owner; });
+}
+
+void CompactionController::NotifyTip(bool ibd)
+{
+    LOCK(m_mutex);
+    m_ibd = ibd;
+    m_last_tip = SteadyClock::now();
+    m_cv.notify_all();
+}
+
+void CompactionController::Stop()
+{
+    {
+        LOCK(m_mutex);
+        m_stopped = true;
+        m_queue.clear();
+        m_cv.notify_all();
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+std::map<std::string, DBCompactionStats> CompactionController::GetStats()
+{
+    LOCK(m_mutex);
+    std::map<std::string, DBCompactionStats> result;
+    for (const auto& [name, activity] : m_activity) {
+        LOCK(activity->mutex);
+        result[name] = activity->stats;
+        result[name].pending_compactions = std::count_if(m_queue.begin(), m_queue.end(), [&](const PendingCompaction& pending) { return pending.activity == activity; });
+    }
+    return result;
+}
+
+bool CompactionController::Busy() const
+{
+    AssertLockHeld(m_mutex);
+    return m_ibd || SteadyClock::now() < m_last_tip + m_quiet_period;
+}
+
+void CompactionController::ThreadCompact()
+{
+    WAIT_LOCK(m_mutex, lock);
+    while (!m_stopped) {
+        if (m_queue.empty()) {
+            m_cv.wait(lock);
+            continue;
+        }
+        if (Busy()) {
+            for (PendingCompaction& pending : m_queue) {
+                if (pending.deferred) continue;
+                pending.deferred = true;
+                LOCK(pending.activity->mutex);
+                ++pending.activity->stats.deferred_compactions;
+            }
+            // During initial block download the next tip tells when it ends
+            if (m_ibd) {
+                m_cv.wait(lock);
+            } else {
+                m_cv.wait_until(lock, m_last_tip + m_quiet_period);
+            }
+            continue;
+        }
+
+        PendingCompaction pending{std::move(m_queue.front())};
+        m_queue.pop_front();
+        m_running = pending.owner;
+        const auto start{SteadyClock::now()};
+        {
+            REVERSE_LOCK(lock);
+            try {
+                pending.compact();
+            } catch (const std::exception& e) {
+                LogPrintf("%s: compaction failed: %s\n", __func__, e.what());
+            }
+        }
+        const auto time{std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - start)};
+        {
+            LOCK(pending.activity->mutex);
+            ++pending.activity->stats.compactions;
+            pending.activity->stats.compaction_time += time;
+        }
+        m_running = nullptr;
+        m_cv.notify_all();
+    }
+}
+
+CompactionController& GetCompactionController()
+{
+    static CompactionController controller;
+    return controller;
+}
+
 static void SetMaxOpenFiles(leveldb::Options *options) {
     // On most platforms the default setting of max_open_files (which is 1000)
     // is optimal. On Windows using a large file count is OK because the handles
@@ -139,8 +327,11 @@ CDBWrapper::CDBWrapper(const DBParams& params)
     options.create_if_missing = true;
     if (params.memory_only) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
-        options.env = penv;
-    } else {
+    }
+    m_activity = GetCompactionController().Activity(m_name);
+    m_monitor_env = CompactionController::NewMonitorEnv(m_activity, penv ? penv : leveldb::Env::Default());
+    options.env = m_monitor_env.get();
+    if (!params.memory_only) {
         if (params.wipe_data) {
             LogPrintf("Wiping LevelDB in %s\n", fs::PathToString(params.path));
             leveldb::Status result = leveldb::DestroyDB(fs::PathToString(params.path), options);
@@ -185,6 +376,7 @@ CDBWrapper::CDBWrapper(const DBParams& params)
 
 CDBWrapper::~CDBWrapper()
 {
+    GetCompactionController().Cancel(this);
     delete pdb;
     pdb = nullptr;
     delete options.filter_policy;
@@ -193,8 +385,9 @@ CDBWrapper::~CDBWrapper()
     options.info_log = nullptr;
     delete options.block_cache;
     options.block_cache = nullptr;
-    delete penv;
     options.env = nullptr;
+    m_monitor_env.reset();
+    delete penv;
 }
 
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
@@ -204,7 +397,15 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     if (log_memory) {
         mem_before = DynamicMemoryUsage() / 1024.0 / 1024;
     }
+    const auto start{SteadyClock::now()};
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
+    const auto time{std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - start)};
+    {
+        LOCK(m_activity->mutex);
+        ++m_activity->stats.writes;
+        m_activity->stats.write_time += time;
+        if (time > DB_SLOW_WRITE) ++m_activity->stats.slow_writes;
+    }
     dbwrapper_private::HandleError(status);
     if (log_memory) {
         double mem_after = DynamicMemoryUsage() / 1024.0 / 1024;
@@ -244,6 +445,16 @@ std::vector<unsigned char> CDBWrapper::CreateObfuscateKey() const
     return ret;
 }
 
+void CDBWrapper::RequestCompaction(std::string key_begin, std::string key_end)
+{
+    GetCompactionController().Request(this, m_name, [this, key_begin = std::move(key_begin), key_end = std::move(key_end)] {
+        const leveldb::Slice begin{key_begin};
+        const leveldb::Slice end{key_end};
+        LogPrint(BCLog::LEVELDB, "Compacting a key range of %s\n", m_name);
+        pdb->CompactRange(&begin, &end);
+    });
+}
+
 bool CDBWrapper::IsEmpty()
 {
     std::unique_ptr<CDBIterator> it(NewIterator());
@@ -255,6 +466,8 @@ CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() const { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
 void CDBIterator::Next() { piter->Next(); }
+void CDBIterator::SeekToLast() { piter->SeekToLast(); }
+void CDBIterator::Prev() { piter->Prev(); }
 
 namespace dbwrapper_private {
 
@@ -10,23 +10,30 @@
 #include <serialize.h>
 #include <span.h>
 #include <streams.h>
+#include <sync.h>
 #include <util/fs.h>
+#include <util/time.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <exception>
+#include <functional>
 #include <leveldb/db.h>
+#include <leveldb/env.h>
 #include <leveldb/iterator.h>
 #include <leveldb/options.h>
 #include <leveldb/slice.h>
 #include <leveldb/status.h>
 #include <leveldb/write_batch.h>
+#include <map>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
-namespace leveldb {
-class Env;
-}
 
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
@@ -54,6 +61,107 @@ struct DBParams {
     DBOptions options{};
 };
 
+//! Writes taking longer than this are reported as slow
+static constexpr auto DB_SLOW_WRITE{std::chrono::milliseconds{100}};
+//! Time after a new tip during which compactions are deferred
+static constexpr auto DB_COMPACTION_QUIET_PERIOD{std::chrono::seconds{5}};
+
+//! Activity of the databases sharing a name, as reported by getdbinfo.
+struct DBCompactionStats {
+    //! Batches written, with their total time and the number of those slower than DB_SLOW_WRITE
+    uint64_t writes{0};
+    uint64_t slow_writes{0};
+    std::chrono::microseconds write_time{0};
+    //! Writes delayed by LevelDB because compaction lags behind level 0
+    uint64_t write_slowdowns{0};
+    std::chrono::microseconds write_slowdown_time{0};
+    //! Compactions and memtable flushes run by LevelDB in its background thread
+    uint64_t background_compactions{0};
+    std::chrono::microseconds background_compaction_time{0};
+    //! Range compactions requested through the CompactionController
+    uint64_t compactions{0};
+    std::chrono::microseconds compaction_time{0};
+    //! Requested compactions that had to wait for validation to be idle, and those still waiting
+    uint64_t deferred_compactions{0};
+    uint64_t pending_compactions{0};
+};
+
+//! Counters shared by the databases of a name and the LevelDB threads working for them.
+struct DBActivity {
+    Mutex mutex;
+    DBCompactionStats stats GUARDED_BY(mutex);
+};
+
+/**
+ * Schedules the compactions requested by the node, so that they do not compete for the disk with
+ * block validation. Requests are run one at a time by a background thread, and are deferred during
+ * initial block download and for a quiet period after each new tip.
+ *
+ * LevelDB's own background compactions cannot be deferred, since writers stall when they lag behind.
+ * They are monitored instead, with the write slowdowns they cause, through the environments returned
+ * by NewMonitorEnv().
+ */
+class CompactionController
+{
+public:
+    explicit CompactionController(std::chrono::milliseconds quiet_period = DB_COMPACTION_QUIET_PERIOD) : m_quiet_period{quiet_period} {}
+    ~CompactionController();
+
+    CompactionController(const CompactionController&) = delete;
+    CompactionController& operator=(const CompactionController&) = delete;
+
+    /** The counters of the databases named @p name */
+    std::shared_ptr<DBActivity> Activity(const std::string& name) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** An environment forwarding to @p base that counts the background work and write slowdowns of @p activity */
+    static std::unique_ptr<leveldb::Env> NewMonitorEnv(std::shared_ptr<DBActivity> activity, leveldb::Env* base);
+    /** A monitoring environment over the default one, kept for the lifetime of the controller */
+    leveldb::Env* SharedMonitorEnv(const std::string& name) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /**
+     * Queue @p compact, run when validation is idle. @p owner identifies the requests to drop with
+     * Cancel() before the database they compact is closed.
+     */
+    void Request(const void* owner, const std::string& name, std::function<void()> compact) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Drop the requests of @p owner, waiting for the one running if any */
+    void Cancel(const void* owner) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** A new tip was connected, @p ibd tells whether the node is in initial block download */
+    void NotifyTip(bool ibd) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Drop the pending requests and stop the background thread */
+    void Stop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    std::map<std::string, DBCompactionStats> GetStats() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    struct PendingCompaction {
+        const void* owner;
+        std::shared_ptr<DBActivity> activity;
+        std::function<void()> compact;
+        bool deferred{false};
+    };
+
+    bool Busy() const EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void ThreadCompact() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    const std::chrono::milliseconds m_quiet_period;
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::map<std::string, std::shared_ptr<DBActivity>> m_activity GUARDED_BY(m_mutex);
+    std::map<std::string, std::unique_ptr<leveldb::Env>> m_shared_envs GUARDED_BY(m_mutex);
+    std::deque<PendingCompaction> m_queue GUARDED_BY(m_mutex);
+    //! Owner of the compaction running, if any
+    const void* m_running GUARDED_BY(m_mutex){nullptr};
+    bool m_ibd GUARDED_BY(m_mutex){false};
+    SteadyClock::time_point m_last_tip GUARDED_BY(m_mutex){};
+    bool m_stopped GUARDED_BY(m_mutex){false};
+    std::thread m_thread;
+};
+
+//! The controller of the compactions of the node's databases.
+CompactionController& GetCompactionController();
+
 class dbwrapper_error : public std::runtime_error
 {
 public:
@@ -183,6 +291,11 @@ public:
 
     void Next();
 
+    void SeekToLast();
+
+    //! Step back to the previous key, for the scans that read the newest entries first
+    void Prev();
+
     template<typename K> bool GetKey(K& key) {
         leveldb::Slice slKey = piter->key();
         try {
@@ -214,6 +327,10 @@ private:
     //! custom environment this database is using (may be nullptr in case of default environment)
     leveldb::Env* penv;
 
+    //! counters of this database, and the environment over penv or the default one updating them
+    std::shared_ptr<DBActivity> m_activity;
+    std::unique_ptr<leveldb::Env> m_monitor_env;
+
     //! database options used
     leveldb::Options options;
 
@@ -343,6 +460,23 @@ public:
      */
     bool IsEmpty();
 
+    /**
+     * Compact the keys from @p key_begin to @p key_end, after many of them were erased. The compaction
+     * is run by the CompactionController in the background, once validation is idle.
+     */
+    template <typename K>
+    void CompactRange(const K& key_begin, const K& key_end)
+    {
+        DataStream ssKey1{}, ssKey2{};
+        ssKey1.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey2.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey1 << key_begin;
+        ssKey2 << key_end;
+        RequestCompaction(std::string((const char*)ssKey1.data(), ssKey1.size()), std::string((const char*)ssKey2.data(), ssKey2.size()));
+    }
+
+    void RequestCompaction(std::string key_begin, std::string key_end);
+
     template<typename K>
     size_t EstimateSize(const K& key_begin, const K& key_end) const
     {
@@ -4,6 +4,11 @@
 #include "LevelDB.h"
 #include "Assertions.h"
 
+#include <leveldb/filter_policy.h>
+
+#include <atomic>
+#include <mutex>
+
 namespace dev
 {
 namespace db
@@ -66,8 +71,75 @@ void LevelDBWriteBatch::kill(Slice _key)
     m_writeBatch.Delete(toLDBSlice(_key));
 }
 
+/// An LRU cache that counts its lookups, and the insertions that have to evict entries
+class CountingCache : public leveldb::Cache
+{
+public:
+    explicit CountingCache(size_t _capacity) : m_cache(leveldb::NewLRUCache(_capacity)), m_capacity(_capacity) {}
+
+    Handle* Insert(leveldb::Slice const& _key, void* _value, size_t _charge,
+        void (*_deleter)(leveldb::Slice const& _key, void* _value)) override
+    {
+        if (m_cache->TotalCharge() + _charge > m_capacity)
+            m_evictions.fetch_add(1, std::memory_order_relaxed);
+        return m_cache->Insert(_key, _value, _charge, _deleter);
+    }
+
+    Handle* Lookup(leveldb::Slice const& _key) override
+    {
+        Handle* handle = m_cache->Lookup(_key);
+        (handle ? m_hits : m_misses).fetch_add(1, std::memory_order_relaxed);
+        return handle;
+    }
+
+    void Release(Handle* _handle) override { m_cache->Release(_handle); }
+    void* Value(Handle* _handle) override { return m_cache->Value(_handle); }
+    void Erase(leveldb::Slice const& _key) override { m_cache->Erase(_key); }
+    uint64_t NewId() override { return m_cache->NewId(); }
+    void Prune() override { m_cache->Prune(); }
+    size_t TotalCharge() const override { return m_cache->TotalCharge(); }
+
+    LevelDB::CacheStats stats() const
+    {
+        return {m_hits.load(std::memory_order_relaxed), m_misses.load(std::memory_order_relaxed),
+            m_evictions.load(std::memory_order_relaxed), m_capacity};
+    }
+
+private:
+    std::unique_ptr<leveldb::Cache> m_cache;
+    size_t const m_capacity;
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+    std::atomic<uint64_t> m_evictions{0};
+};
+
+std::mutex x_blockCache;
+std::shared_ptr<CountingCache> g_blockCache;
+size_t g_writeBufferSize = 0;
+leveldb::Env* g_env = nullptr;
+
 }  // namespace
 
+void LevelDB::setCacheSize(size_t _bytes)
+{
+    std::lock_guard<std::mutex> lock(x_blockCache);
+    // Databases opened with the previous cache keep it alive until they are closed
+    g_blockCache = _bytes ? std::make_shared<CountingCache>(_bytes / 2) : nullptr;
+    g_writeBufferSize = _bytes / 8;
+}
+
+void LevelDB::setEnv(leveldb::Env* _env)
+{
+    std::lock_guard<std::mutex> lock(x_blockCache);
+    g_env = _env;
+}
+
+LevelDB::CacheStats LevelDB::cacheStats()
+{
+    std::lock_guard<std::mutex> lock(x_blockCache);
+    return g_blockCache ? g_blockCache->stats() : CacheStats{};
+}
+
 leveldb::ReadOptions LevelDB::defaultReadOptions()
 {
     return leveldb::ReadOptions();
@@ -83,6 +155,17 @@ leveldb::Options LevelDB::defaultDBOptions()
     leveldb::Options options;
     options.create_if_missing = true;
     options.max_open_files = 256;
+    // Trie nodes are looked up by hash, the filters spare the disk reads of the tables without them
+    static leveldb::FilterPolicy const* const filterPolicy = leveldb::NewBloomFilterPolicy(10);
+    options.filter_policy = filterPolicy;
+    std::lock_guard<std::mutex> lock(x_blockCache);
+    if (g_blockCache)
+    {
+        options.block_cache = g_blockCache.get();
+        options.write_buffer_size = g_writeBufferSize;
+    }
+    if (g_env)
+        options.env = g_env;
     return options;
 }
 
@@ -90,6 +173,11 @@ LevelDB::LevelDB(boost::filesystem::path const& _path, leveldb::ReadOptions _rea
     leveldb::WriteOptions _writeOptions, leveldb::Options _dbOptions)
   : m_db(nullptr), m_readOptions(std::move(_readOptions)), m_writeOptions(std::move(_writeOptions))
 {
+    {
+        std::lock_guard<std::mutex> lock(x_blockCache);
+        if (g_blockCache && _dbOptions.block_cache == g_blockCache.get())
+            m_blockCache = g_blockCache;
+    }
     auto db = static_cast<leveldb::DB*>(nullptr);
     auto const status = leveldb::DB::Open(_dbOptions, _path.string(), &db);
     checkStatus(status, _path);
@@ -176,5 +264,10 @@ void LevelDB::forEach(std::function<bool(Slice, Slice)> _f) const
     }
 }
 
+void LevelDB::compact()
+{
+    m_db->CompactRange(nullptr, nullptr);
+}
+
 }  // namespace db
 }  // namespace dev
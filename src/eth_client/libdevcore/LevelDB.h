@@ -7,9 +7,12 @@
 #include "db.h"
 
 #include <boost/filesystem.hpp>
+#include <leveldb/cache.h>
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <memory>
+
 namespace dev
 {
 namespace db
@@ -21,6 +24,24 @@ public:
     static leveldb::WriteOptions defaultWriteOptions();
     static leveldb::Options defaultDBOptions();
 
+    struct CacheStats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t maxBytes = 0;
+    };
+
+    /// Give the databases opened with defaultDBOptions() from now on a block cache of half of
+    /// @a _bytes, shared by all of them, and a write buffer of an eighth of it each. 0 restores
+    /// the LevelDB defaults.
+    static void setCacheSize(size_t _bytes);
+    /// Lookups of the shared block cache since it was set up
+    static CacheStats cacheStats();
+    /// Open the databases with defaultDBOptions() from now on in @a _env, which must outlive them.
+    /// nullptr restores the default environment.
+    static void setEnv(leveldb::Env* _env);
+
     explicit LevelDB(boost::filesystem::path const& _path,
         leveldb::ReadOptions _readOptions = defaultReadOptions(),
         leveldb::WriteOptions _writeOptions = defaultWriteOptions(),
@@ -36,7 +57,11 @@ public:
 
     void forEach(std::function<bool(Slice, Slice)> _f) const override;
 
+    void compact() override;
+
 private:
+    /// The shared block cache the database was opened with, it outlives the database
+    std::shared_ptr<leveldb::Cache> m_blockCache;
     std::unique_ptr<leveldb::DB> m_db;
     leveldb::ReadOptions const m_readOptions;
     leveldb::WriteOptions const m_writeOptions;
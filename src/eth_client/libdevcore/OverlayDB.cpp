@@ -1,6 +1,7 @@
 // Aleth: Ethereum C++ client, tools and libraries.
 // Copyright 2014-2019 Aleth Authors.
 // Licensed under the GNU General Public License, Version 3.
+#include <algorithm>
 #include <thread>
 #include <libdevcore/db.h>
 #include <libdevcore/Common.h>
@@ -36,6 +37,16 @@ void OverlayDB::commit()
     if (m_db)
     {
         auto writeBatch = m_db->createWriteBatch();
+        // The staged nodes stay readable while they are written, another copy may look them up
+        UpgradableGuard staged(m_staged->x_staged);
+        for (auto const& i: m_staged->main)
+            writeBatch->insert(toSlice(i.first), toSlice(i.second));
+        for (auto const& i: m_staged->aux)
+        {
+            bytes b = i.first.asBytes();
+            b.push_back(255);   // for aux
+            writeBatch->insert(toSlice(b), toSlice(i.second));
+        }
 //      cnote << "Committing nodes to disk DB:";
 #if DEV_GUARDED_DB
         DEV_READ_GUARDED(x_this)
@@ -82,14 +93,56 @@ void OverlayDB::commit()
             m_aux.clear();
             m_main.clear();
         }
+        if (!m_staged->main.empty() || !m_staged->aux.empty())
+        {
+            UpgradeGuard write(staged);
+            m_staged->main.clear();
+            m_staged->aux.clear();
+            m_staged->memoryUsage = 0;
+        }
     }
 }
 
+void OverlayDB::stage()
+{
+    if (!m_db)
+        return;
+    // Key and value, and the overhead of a node of the hash map
+    static constexpr size_t c_entryOverhead = h256::size + 64;
+    WriteGuard l(m_staged->x_staged);
+    for (auto const& i: m_main)
+        if (i.second.second && m_staged->main.emplace(i.first, i.second.first).second)
+            m_staged->memoryUsage += c_entryOverhead + i.second.first.size();
+    for (auto const& i: m_aux)
+        if (i.second.second && m_staged->aux.emplace(i.first, i.second.first).second)
+            m_staged->memoryUsage += c_entryOverhead + i.second.first.size();
+    m_aux.clear();
+    m_main.clear();
+}
+
+size_t OverlayDB::stagedMemoryUsage() const
+{
+    ReadGuard l(m_staged->x_staged);
+    return m_staged->memoryUsage;
+}
+
+bool OverlayDB::stagedExists(h256 const& _h) const
+{
+    ReadGuard l(m_staged->x_staged);
+    return m_staged->main.count(_h);
+}
+
 bytes OverlayDB::lookupAux(h256 const& _h) const
 {
     bytes ret = StateCacheDB::lookupAux(_h);
     if (!ret.empty() || !m_db)
         return ret;
+    {
+        ReadGuard l(m_staged->x_staged);
+        auto it = m_staged->aux.find(_h);
+        if (it != m_staged->aux.end())
+            return it->second;
+    }
 
     bytes b = _h.asBytes();
     b.push_back(255);   // for aux
@@ -100,6 +153,23 @@ bytes OverlayDB::lookupAux(h256 const& _h) const
     return asBytes(v);
 }
 
+bool OverlayDB::existsAux(h256 const& _h) const
+{
+    if (!StateCacheDB::lookupAux(_h).empty())
+        return true;
+    if (!m_db)
+        return false;
+    {
+        ReadGuard l(m_staged->x_staged);
+        if (m_staged->aux.count(_h))
+            return true;
+    }
+
+    bytes b = _h.asBytes();
+    b.push_back(255);   // for aux
+    return m_db->exists(toSlice(b));
+}
+
 void OverlayDB::rollback()
 {
 #if DEV_GUARDED_DB
@@ -113,6 +183,12 @@ std::string OverlayDB::lookup(h256 const& _h) const
     std::string ret = StateCacheDB::lookup(_h);
     if (!ret.empty() || !m_db)
         return ret;
+    {
+        ReadGuard l(m_staged->x_staged);
+        auto it = m_staged->main.find(_h);
+        if (it != m_staged->main.end())
+            return it->second;
+    }
 
     return m_db->lookup(toSlice(_h));
 }
@@ -121,7 +197,55 @@ bool OverlayDB::exists(h256 const& _h) const
 {
     if (StateCacheDB::exists(_h))
         return true;
-    return m_db && m_db->exists(toSlice(_h));
+    return m_db && (stagedExists(_h) || m_db->exists(toSlice(_h)));
+}
+
+void OverlayDB::forEachDiskNode(std::function<bool(h256 const&)> const& _f) const
+{
+    if (!m_db)
+        return;
+    m_db->forEach([&](db::Slice _key, db::Slice) {
+        if (_key.size() != h256::size)
+            return true;
+        return _f(h256(reinterpret_cast<byte const*>(_key.data()), h256::ConstructFromPointer));
+    });
+}
+
+OverlayDB OverlayDB::diskView() const
+{
+    OverlayDB ret;
+    ret.m_db = m_db;
+    return ret;
+}
+
+void OverlayDB::prune(std::vector<h256>& _keys, std::function<bool(h256 const&)> const& _reachable)
+{
+    if (!m_db)
+    {
+        _keys.clear();
+        return;
+    }
+    {
+#if DEV_GUARDED_DB
+        ReadGuard l(x_this);
+#endif
+        _keys.erase(std::remove_if(_keys.begin(), _keys.end(), [&](h256 const& k) {
+            auto it = m_main.find(k);
+            return (it != m_main.end() && it->second.second > 0) || stagedExists(k) || _reachable(k);
+        }), _keys.end());
+    }
+    if (_keys.empty())
+        return;
+    auto writeBatch = m_db->createWriteBatch();
+    for (auto const& k: _keys)
+        writeBatch->kill(toSlice(k));
+    m_db->commit(std::move(writeBatch));
+}
+
+void OverlayDB::compact()
+{
+    if (m_db)
+        m_db->compact();
 }
 
 void OverlayDB::kill(h256 const& _h)
@@ -130,7 +254,7 @@ void OverlayDB::kill(h256 const& _h)
     {
         if (m_db)
         {
-            if (!m_db->exists(toSlice(_h)))
+            if (!stagedExists(_h) && !m_db->exists(toSlice(_h)))
             {
                 // No point node ref decreasing for EmptyTrie since we never bother incrementing it
                 // in the first place for empty storage tries.
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <libdevcore/db.h>
+#include <libdevcore/Guards.h>
 #include <libdevcore/Common.h>
 #include <libdevcore/Log.h>
 #include <libdevcore/StateCacheDB.h>
@@ -20,7 +21,8 @@ public:
       : m_db(_db.release(), [](db::DatabaseFace* db) {
             clog(VerbosityDebug, "overlaydb") << "Closing state DB";
             delete db;
-        })
+        }),
+        m_staged(std::make_shared<Staged>())
     {}
 
     ~OverlayDB();
@@ -32,19 +34,54 @@ public:
     OverlayDB(OverlayDB&&) = default;
     OverlayDB& operator=(OverlayDB&&) = default;
 
+    /// Write the nodes of the memory overlay and the staged nodes to the disk database.
     void commit();
 	void rollback();
 
+	/// Move the nodes of the memory overlay that are referenced to the staged nodes, to be written by the
+	/// next commit() in the same batch. Unlike those of the overlay, the staged nodes are kept when they
+	/// are killed afterwards, so every root reached before stage() can still be read once they are written.
+	/// The staged nodes are shared with the copies of this database.
+	void stage();
+	/// @returns an estimate of the memory taken by the staged nodes.
+	size_t stagedMemoryUsage() const;
+
 	std::string lookup(h256 const& _h) const;
 	bool exists(h256 const& _h) const;
 	void kill(h256 const& _h);
 
 	bytes lookupAux(h256 const& _h) const;
+	/// Whether the aux entry @a _h is stored, without warning when it is not.
+	bool existsAux(h256 const& _h) const;
+
+	/// Call @a _f with the key of each node stored in the disk database, stopping when it returns false.
+	/// Aux entries are skipped.
+	void forEachDiskNode(std::function<bool(h256 const&)> const& _f) const;
+	/// Erase from the disk database the nodes of @a _keys that are no longer reachable. Nodes for which
+	/// @a _reachable returns true, nodes referenced by the memory overlay and staged nodes are kept.
+	/// @a _keys is left with the nodes erased.
+	void prune(std::vector<h256>& _keys, std::function<bool(h256 const&)> const& _reachable);
+	/// Compact the disk database, to reclaim the space of the nodes pruned.
+	void compact();
+	/// A database over the same disk database with an empty memory overlay. It only sees the
+	/// committed nodes, and is taken without reading the overlay of this one.
+	OverlayDB diskView() const;
 
 private:
 	using StateCacheDB::clear;
 
+	struct Staged
+	{
+		mutable SharedMutex x_staged;
+		std::unordered_map<h256, std::string> main;
+		std::unordered_map<h256, bytes> aux;
+		size_t memoryUsage = 0;
+	};
+
+	bool stagedExists(h256 const& _h) const;
+
     std::shared_ptr<db::DatabaseFace> m_db;
+	std::shared_ptr<Staged> m_staged;
 };
 
 }
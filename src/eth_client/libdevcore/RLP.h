@@ -377,9 +377,9 @@ public:
     ~RLPStream() {}
 
     /// Append given datum to the byte stream.
-    RLPStream& append(unsigned _s) { return append(bigint(_s)); }
-    RLPStream& append(u160 _s) { return append(bigint(_s)); }
-    RLPStream& append(u256 _s) { return append(bigint(_s)); }
+    RLPStream& append(unsigned _s) { return appendInt(_s); }
+    RLPStream& append(u160 _s) { return appendInt(_s); }
+    RLPStream& append(u256 _s) { return appendInt(_s); }
     RLPStream& append(bigint _s);
     RLPStream& append(bytesConstRef _s, bool _compact = false);
     RLPStream& append(bytes const& _s) { return append(bytesConstRef(&_s)); }
@@ -412,8 +412,13 @@ public:
     template <class T> RLPStream& operator<<(T _data) { return append(_data); }
 
     /// Clear the output stream so far.
+    /// Clear the output stream so far. The memory is kept, so that a stream can be reused
+    /// to encode many small items without allocating.
     void clear() { m_out.clear(); m_listStack.clear(); }
 
+    /// Reserve memory for @a _bytes bytes of output.
+    void reserve(size_t _bytes) { m_out.reserve(_bytes); }
+
     /// Read the byte stream.
     bytes const& out() const { if(!m_listStack.empty()) BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("listStack is not empty")); return m_out; }
 
@@ -430,6 +435,32 @@ private:
     /// @arg _count is number of characters for strings, data-bytes for ints, or items for lists.
     void pushCount(size_t _count, byte _offset);
 
+    /// Append an integer without converting it to bigint first.
+    template <class _T> RLPStream& appendInt(_T const& _i)
+    {
+        if (!_i)
+            m_out.push_back(c_rlpDataImmLenStart);
+        else if (_i < c_rlpDataImmLenStart)
+            m_out.push_back((byte)_i);
+        else
+        {
+            unsigned br = bytesRequired(_i);
+            if (br < c_rlpDataImmLenCount)
+                m_out.push_back((byte)(br + c_rlpDataImmLenStart));
+            else
+            {
+                auto brbr = bytesRequired(br);
+                if (c_rlpDataIndLenZero + brbr > 0xff)
+                    BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("Number too large for RLP"));
+                m_out.push_back((byte)(c_rlpDataIndLenZero + brbr));
+                pushInt(br, brbr);
+            }
+            pushInt(_i, br);
+        }
+        noteAppended();
+        return *this;
+    }
+
     /// Push an integer as a raw big-endian byte-stream.
     template <class _T> void pushInt(_T _i, size_t _br)
     {
@@ -5,8 +5,13 @@
 #include "SHA3.h"
 #include "RLP.h"
 
+#include <crypto/common.h>
+#include <crypto/sha3.h>
 #include <ethash/keccak.hpp>
 
+#include <algorithm>
+#include <numeric>
+
 namespace dev
 {
 h256 const EmptySHA3 = sha3(bytesConstRef());
@@ -20,4 +25,77 @@ bool sha3(bytesConstRef _input, bytesRef o_output) noexcept
     bytesConstRef{h.bytes, 32}.copyTo(o_output);
     return true;
 }
+
+namespace
+{
+/// The Keccak-256 rate in bytes.
+constexpr size_t c_rate = 136;
+
+/// Number of blocks absorbed for an input, the last one holding the padding.
+size_t blockCount(bytesConstRef _input)
+{
+    return _input.size() / c_rate + 1;
+}
+
+/// Hash four inputs of the same block count with the multi-way Keccak transform.
+void sha3x4(bytesConstRef const* _inputs, size_t const* _indexes, h256* o_outputs)
+{
+    size_t const blocks = blockCount(_inputs[_indexes[0]]);
+    uint64_t st[25][4] = {};
+    byte last[c_rate];
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        for (size_t j = 0; j < 4; ++j)
+        {
+            bytesConstRef in = _inputs[_indexes[j]];
+            byte const* block = in.data() + b * c_rate;
+            if (b + 1 == blocks)
+            {
+                size_t const rest = in.size() - b * c_rate;
+                std::fill(std::copy(block, block + rest, last), last + c_rate, 0);
+                last[rest] ^= 0x01;
+                last[c_rate - 1] ^= 0x80;
+                block = last;
+            }
+            for (size_t i = 0; i < c_rate / 8; ++i)
+                st[i][j] ^= ReadLE64(block + i * 8);
+        }
+        KeccakF_4way(st);
+    }
+    for (size_t j = 0; j < 4; ++j)
+        for (size_t i = 0; i < 4; ++i)
+            WriteLE64(o_outputs[_indexes[j]].data() + i * 8, st[i][j]);
+}
+}  // namespace
+
+void sha3Batch(bytesConstRef const* _inputs, h256* o_outputs, size_t _count)
+{
+    if (_count < 4 || !KeccakF_4way_Accelerated())
+    {
+        for (size_t i = 0; i < _count; ++i)
+            sha3(_inputs[i], o_outputs[i].ref());
+        return;
+    }
+
+    std::vector<size_t> order(_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t _a, size_t _b) {
+        return blockCount(_inputs[_a]) < blockCount(_inputs[_b]);
+    });
+
+    // Runs of four inputs with the same block count go through the multi-way transform
+    for (size_t i = 0; i < _count;)
+    {
+        if (i + 4 <= _count && blockCount(_inputs[order[i]]) == blockCount(_inputs[order[i + 3]]))
+        {
+            sha3x4(_inputs, &order[i], o_outputs);
+            i += 4;
+        }
+        else
+        {
+            sha3(_inputs[order[i]], o_outputs[order[i]].ref());
+            ++i;
+        }
+    }
+}
 }  // namespace dev
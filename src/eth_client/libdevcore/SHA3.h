@@ -10,6 +10,7 @@
 #include <ethash/keccak.hpp>
 
 #include <string>
+#include <vector>
 
 namespace dev
 {
@@ -28,6 +29,17 @@ inline h256 sha3(bytesConstRef _input) noexcept
     return ret;
 }
 
+/// Calculate the SHA3-256 hashes of _count inputs into o_outputs. Inputs of the same
+/// number of blocks are hashed four at a time when the CPU has a multi-way Keccak.
+void sha3Batch(bytesConstRef const* _inputs, h256* o_outputs, size_t _count);
+
+inline std::vector<h256> sha3Batch(std::vector<bytesConstRef> const& _inputs)
+{
+    std::vector<h256> ret(_inputs.size());
+    sha3Batch(_inputs.data(), ret.data(), _inputs.size());
+    return ret;
+}
+
 inline SecureFixedHash<32> sha3Secure(bytesConstRef _input) noexcept
 {
     SecureFixedHash<32> ret;
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include "Log.h"
 #include "Exceptions.h"
@@ -36,6 +37,14 @@ enum class Verification {
  * assert(t.isEmpty());
  * @endcode
  */
+/// A change of a batch update of a hashing trie: the key, its hash and the new value, empty to remove the key.
+struct HashedTrieChange
+{
+    bytesConstRef key;
+    h256 keyHash;
+    bytesConstRef value;
+};
+
 template <class _DB>
 class GenericTrieDB
 {
@@ -87,6 +96,12 @@ public:
     bool contains(bytes const& _key) const { return contains(&_key); }
     bool contains(bytesConstRef _key) const { return !at(_key).empty(); }
 
+    /// Apply a batch of changes, (key, value) with an empty value to remove the key, in one pass
+    /// over the trie: the nodes shared by the paths of several keys are read, hashed and written
+    /// once instead of once per key. The keys are applied in order and the last change of a key
+    /// wins. The root is the same as when inserting and removing the keys one at a time.
+    void update(std::vector<std::pair<bytesConstRef, bytesConstRef>> const& _changes);
+
     class iterator
     {
     public:
@@ -265,6 +280,27 @@ private:
     // out: [null ** i, H, null ** (16 - i)] ; [K, V] => H (INS)  (being [null ** i, [K, V], null ** (16 - i)]  if necessary)
     bytes branch(RLP const& _orig);
 
+    /// A change of update(): the nibbles of the whole key and the new value, empty to remove the key.
+    struct Change
+    {
+        bytes key;
+        bytesConstRef value;
+    };
+    using Changes = std::vector<Change const*>;
+
+    // The update() pass. Each returns the new node at _depth nibbles of the keys of _changes, which
+    // are all under it, or no bytes if the subtree ends up empty.
+
+    // _orig: the node, which is not killed.
+    bytes updateNode(RLP const& _orig, Changes const& _changes, unsigned _depth);
+    // _ref: the reference to the node in its parent. A hashed node is killed if it changes.
+    bytes updateRef(RLP const& _ref, Changes const& _changes, unsigned _depth, bool& _changed);
+    // The subtree of the inserts of _changes alone.
+    bytes buildNode(Changes const& _changes, unsigned _depth);
+    // _node under the nibbles _prefix: the node itself with its key extended if it is a leaf or
+    // an extension, killing it if stored under _stored, or else an extension to it.
+    bytes prefixNode(bytes const& _prefix, bytes const& _node, h256 const* _stored);
+
     bool isTwoItemNode(RLP const& _n) const;
     std::string deref(RLP const& _n) const;
 
@@ -315,6 +351,12 @@ public:
     void insert(KeyType _k, bytes const& _value) { insert(_k, bytesConstRef(&_value)); }
     void remove(KeyType _k) { Generic::remove(bytesConstRef((byte const*)&_k, sizeof(KeyType))); }
 
+    /// Variants for a hashing trie when the caller has already hashed the key, e.g. with sha3Batch.
+    void insertHashed(KeyType _k, h256 const& _keyHash, bytesConstRef _value) { Generic::insertHashed(bytesConstRef((byte const*)&_k, sizeof(KeyType)), _keyHash, _value); }
+    void insertHashed(KeyType _k, h256 const& _keyHash, bytes const& _value) { insertHashed(_k, _keyHash, bytesConstRef(&_value)); }
+    void removeHashed(h256 const& _keyHash) { Generic::removeHashed(_keyHash); }
+    void updateHashed(std::vector<HashedTrieChange> const& _changes) { Generic::updateHashed(_changes); }
+
     class iterator: public Generic::iterator
     {
     public:
@@ -375,6 +417,17 @@ public:
     bool contains(bytesConstRef _key) const { return Super::contains(sha3(_key)); }
     void insert(bytesConstRef _key, bytesConstRef _value) { Super::insert(sha3(_key), _value); }
     void remove(bytesConstRef _key) { Super::remove(sha3(_key)); }
+    void insertHashed(bytesConstRef, h256 const& _keyHash, bytesConstRef _value) { Super::insert(_keyHash, _value); }
+    void removeHashed(h256 const& _keyHash) { Super::remove(_keyHash); }
+    /// Apply the changes in one pass over the trie, see GenericTrieDB::update().
+    void updateHashed(std::vector<HashedTrieChange> const& _changes)
+    {
+        std::vector<std::pair<bytesConstRef, bytesConstRef>> changes;
+        changes.reserve(_changes.size());
+        for (auto const& c: _changes)
+            changes.emplace_back(c.keyHash.ref(), c.value);
+        Super::update(changes);
+    }
 
     // empty from the PoV of the iterator interface; still need a basic iterator impl though.
     class iterator
@@ -424,14 +477,28 @@ public:
 
     std::string at(bytesConstRef _key) const { return Super::at(sha3(_key)); }
     bool contains(bytesConstRef _key) const { return Super::contains(sha3(_key)); }
-    void insert(bytesConstRef _key, bytesConstRef _value)
+    void insert(bytesConstRef _key, bytesConstRef _value) { insertHashed(_key, sha3(_key), _value); }
+    void insertHashed(bytesConstRef _key, h256 const& _keyHash, bytesConstRef _value)
     {
-        h256 hash = sha3(_key);
-        Super::insert(hash, _value);
-        Super::db()->insertAux(hash, _key);
+        Super::insert(_keyHash, _value);
+        Super::db()->insertAux(_keyHash, _key);
     }
 
     void remove(bytesConstRef _key) { Super::remove(sha3(_key)); }
+    void removeHashed(h256 const& _keyHash) { Super::remove(_keyHash); }
+
+    /// Apply the changes in one pass over the trie, see GenericTrieDB::update().
+    void updateHashed(std::vector<HashedTrieChange> const& _changes)
+    {
+        std::vector<std::pair<bytesConstRef, bytesConstRef>> changes;
+        changes.reserve(_changes.size());
+        for (auto const& c: _changes)
+            changes.emplace_back(c.keyHash.ref(), c.value);
+        Super::update(changes);
+        for (auto const& c: _changes)
+            if (!c.value.empty())
+                Super::db()->insertAux(c.keyHash, c.key);
+    }
 
     // iterates over <key, value> pairs
     class iterator: public GenericTrieDB<_DB>::iterator
@@ -1160,4 +1227,271 @@ template <class DB> bytes GenericTrieDB<DB>::branch(RLP const& _orig)
     return r.out();
 }
 
+template <class DB> void GenericTrieDB<DB>::update(std::vector<std::pair<bytesConstRef, bytesConstRef>> const& _changes)
+{
+    std::vector<Change> changes;
+    changes.reserve(_changes.size());
+    for (auto const& c: _changes)
+    {
+        Change change;
+        change.key.reserve(c.first.size() * 2);
+        for (unsigned i = 0; i < c.first.size() * 2; ++i)
+            change.key.push_back(nibble(c.first, i));
+        change.value = c.second;
+        changes.push_back(std::move(change));
+    }
+
+    // Sorted, so that the nodes are written in key order, and without the overwritten changes.
+    Changes sorted;
+    sorted.reserve(changes.size());
+    for (auto const& c: changes)
+        sorted.push_back(&c);
+    std::stable_sort(sorted.begin(), sorted.end(), [](Change const* _a, Change const* _b) { return _a->key < _b->key; });
+    Changes unique;
+    unique.reserve(sorted.size());
+    for (size_t i = 0; i < sorted.size(); ++i)
+        if (i + 1 == sorted.size() || sorted[i]->key != sorted[i + 1]->key)
+            unique.push_back(sorted[i]);
+    if (unique.empty())
+        return;
+
+    std::string rootValue = node(m_root);
+    assert(rootValue.size());
+    bytes b = updateNode(RLP(rootValue), unique, 0);
+    if (b.empty())
+        b = RLPNull;
+    if (bytesConstRef(&b).contentsEqual(asBytes(rootValue)))
+        return;
+
+    // The root is always hashed, whatever its size.
+    forceKillNode(m_root);
+    m_root = forceInsertNode(&b);
+}
+
+template <class DB> bytes GenericTrieDB<DB>::updateRef(RLP const& _ref, Changes const& _changes, unsigned _depth, bool& _changed)
+{
+    if (_ref.isEmpty())
+    {
+        bytes b = buildNode(_changes, _depth);
+        _changed = !b.empty();
+        return b;
+    }
+    if (_ref.isList())
+    {
+        bytes b = updateNode(_ref, _changes, _depth);
+        _changed = !_ref.data().contentsEqual(b);
+        return b;
+    }
+    h256 h = _ref.toHash<h256>();
+    std::string s = node(h);
+    bytes b = updateNode(RLP(s), _changes, _depth);
+    _changed = !bytesConstRef(&b).contentsEqual(asBytes(s));
+    if (_changed)
+        forceKillNode(h);
+    return b;
+}
+
+template <class DB> bytes GenericTrieDB<DB>::updateNode(RLP const& _orig, Changes const& _changes, unsigned _depth)
+{
+    if (_orig.isEmpty())
+        return buildNode(_changes, _depth);
+
+    assert(_orig.isList() && (_orig.itemCount() == 2 || _orig.itemCount() == 17));
+    if (_orig.itemCount() == 2)
+    {
+        NibbleSlice k = keyOf(_orig);
+        bytes key;
+        for (unsigned i = 0; i < k.size(); ++i)
+            key.push_back(k[i]);
+
+        if (isLeaf(_orig))
+        {
+            // The leaf is one more insert, unless it is changed.
+            Changes merged = _changes;
+            Change leaf;
+            bool changed = false;
+            for (Change const* c: _changes)
+                if (std::equal(c->key.begin() + _depth, c->key.end(), key.begin(), key.end()))
+                    changed = true;
+            if (!changed)
+            {
+                leaf.key.assign(_changes.front()->key.begin(), _changes.front()->key.begin() + _depth);
+                leaf.key.insert(leaf.key.end(), key.begin(), key.end());
+                leaf.value = _orig[1].payload();
+                merged.push_back(&leaf);
+            }
+            return buildNode(merged, _depth);
+        }
+
+        // Extension: the changes under it go down to its child, and those diverging from its key
+        // make it a branch at the first nibble where one does.
+        unsigned shared = key.size();
+        for (Change const* c: _changes)
+        {
+            unsigned n = 0;
+            while (n < shared && _depth + n < c->key.size() && c->key[_depth + n] == key[n])
+                ++n;
+            shared = n;
+        }
+        if (shared == key.size())
+        {
+            bool changed = false;
+            bytes child = updateRef(_orig[1], _changes, _depth + key.size(), changed);
+            if (!changed)
+                return _orig.data().toBytes();
+            return prefixNode(key, child, nullptr);
+        }
+
+        RLPStream r(17);
+        for (unsigned i = 0; i < 16; ++i)
+            if (i != key[shared])
+                r << "";
+            else if (shared + 1 < key.size())
+                // The rest of the extension, inline here whatever its size as it is not stored.
+                r.appendRaw(rlpList(hexPrefixEncode(key, false, shared + 1), _orig[1]));
+            else
+                r << _orig[1];
+        r << "";
+        bytes branched = updateNode(RLP(r.out()), _changes, _depth + shared);
+        if (branched == r.out())
+            // Only removals of keys that are not in the trie.
+            return _orig.data().toBytes();
+        return prefixNode(bytes(key.begin(), key.begin() + shared), branched, nullptr);
+    }
+
+    Changes children[16];
+    Change const* valueChange = nullptr;
+    for (Change const* c: _changes)
+        if (c->key.size() == _depth)
+            valueChange = c;
+        else
+            children[c->key[_depth]].push_back(c);
+
+    bool any = false;
+    bytes updated[16];
+    bool changed[16] = {};
+    for (unsigned i = 0; i < 16; ++i)
+        if (!children[i].empty())
+        {
+            updated[i] = updateRef(_orig[i], children[i], _depth + 1, changed[i]);
+            any = any || changed[i];
+        }
+    bytesConstRef value = _orig[16].payload();
+    if (valueChange && !valueChange->value.contentsEqual(value.toBytes()))
+    {
+        value = valueChange->value;
+        any = true;
+    }
+    if (!any)
+        return _orig.data().toBytes();
+
+    unsigned used = 0;
+    byte last = 0;
+    for (byte i = 0; i < 16; ++i)
+        if (changed[i] ? !updated[i].empty() : !_orig[i].isEmpty())
+        {
+            ++used;
+            last = i;
+        }
+
+    if (used == 0)
+        return value.empty() ? bytes() : rlpList(hexPrefixEncode(bytes(), true), value);
+    if (used == 1 && value.empty())
+    {
+        // A branch with a single child is not one: the child goes under the nibble of its slot.
+        bytes const prefix{last};
+        if (changed[last])
+            return prefixNode(prefix, updated[last], nullptr);
+        if (_orig[last].isList())
+            return prefixNode(prefix, _orig[last].data().toBytes(), nullptr);
+        h256 h = _orig[last].toHash<h256>();
+        return prefixNode(prefix, asBytes(node(h)), &h);
+    }
+
+    RLPStream r(17);
+    for (unsigned i = 0; i < 16; ++i)
+        if (changed[i])
+        {
+            if (updated[i].empty())
+                r << "";
+            else
+                streamNode(r, updated[i]);
+        }
+        else if (_orig[i].isList() && _orig[i].data().size() >= 32)
+            // The rest of an extension made a branch by updateNode().
+            streamNode(r, _orig[i].data().toBytes());
+        else
+            r << _orig[i];
+    r << value;
+    return r.out();
+}
+
+template <class DB> bytes GenericTrieDB<DB>::buildNode(Changes const& _changes, unsigned _depth)
+{
+    Changes inserts;
+    for (Change const* c: _changes)
+        if (!c->value.empty())
+            inserts.push_back(c);
+    if (inserts.empty())
+        return bytes();
+    if (inserts.size() == 1)
+        return rlpList(hexPrefixEncode(inserts.front()->key, true, _depth), inserts.front()->value);
+
+    bytes const& first = inserts.front()->key;
+    unsigned shared = first.size() - _depth;
+    for (Change const* c: inserts)
+    {
+        unsigned n = 0;
+        while (n < shared && _depth + n < c->key.size() && c->key[_depth + n] == first[_depth + n])
+            ++n;
+        shared = n;
+    }
+    if (shared)
+        return prefixNode(bytes(first.begin() + _depth, first.begin() + _depth + shared), buildNode(inserts, _depth + shared), nullptr);
+
+    Changes children[16];
+    bytesConstRef value;
+    for (Change const* c: inserts)
+        if (c->key.size() == _depth)
+            value = c->value;
+        else
+            children[c->key[_depth]].push_back(c);
+
+    RLPStream r(17);
+    for (unsigned i = 0; i < 16; ++i)
+        if (children[i].empty())
+            r << "";
+        else
+            streamNode(r, buildNode(children[i], _depth + 1));
+    r << value;
+    return r.out();
+}
+
+template <class DB> bytes GenericTrieDB<DB>::prefixNode(bytes const& _prefix, bytes const& _node, h256 const* _stored)
+{
+    if (_node.empty() || _prefix.empty())
+        return _node;
+
+    RLP n(_node);
+    assert(n.isList() && (n.itemCount() == 2 || n.itemCount() == 17));
+    if (n.itemCount() == 2)
+    {
+        if (_stored)
+            forceKillNode(*_stored);
+        bytes key = _prefix;
+        NibbleSlice k = keyOf(n);
+        for (unsigned i = 0; i < k.size(); ++i)
+            key.push_back(k[i]);
+        return rlpList(hexPrefixEncode(key, isLeaf(n)), n[1]);
+    }
+
+    RLPStream s(2);
+    s << hexPrefixEncode(_prefix, false);
+    if (_stored)
+        s << *_stored;
+    else
+        streamNode(s, _node);
+    return s.out();
+}
+
 }
@@ -6,12 +6,19 @@
 #include "TrieCommon.h"
 #include "TrieDB.h"	// @TODO replace ASAP!
 
+#include <deque>
+
 namespace dev
 {
 
-void hash256aux(HexMap const& _s, HexMap::const_iterator _begin, HexMap::const_iterator _end, unsigned _preLen, RLPStream& _rlp);
+/// Streams that encode the nodes of a trie, one per level, reused for all the nodes of that level
+/// so that encoding a trie does not allocate for each node. A deque keeps the streams of the
+/// outer levels in place when a deeper one is added.
+using RLPScratch = std::deque<RLPStream>;
+
+void hash256aux(HexMap const& _s, HexMap::const_iterator _begin, HexMap::const_iterator _end, unsigned _preLen, RLPStream& _rlp, RLPScratch& _scratch, size_t _level);
 
-void hash256rlp(HexMap const& _s, HexMap::const_iterator _begin, HexMap::const_iterator _end, unsigned _preLen, RLPStream& _rlp)
+void hash256rlp(HexMap const& _s, HexMap::const_iterator _begin, HexMap::const_iterator _end, unsigned _preLen, RLPStream& _rlp, RLPScratch& _scratch, size_t _level)
 {
 	if (_begin == _end)
 		_rlp << "";	// NULL
@@ -37,7 +44,7 @@ void hash256rlp(HexMap const& _s, HexMap::const_iterator _begin, HexMap::const_i
 		{
 			// if they all have the same next nibble, we also want a pair.
 			_rlp.appendList(2) << hexPrefixEncode(_begin->first, false, _preLen, (int)sharedPre);
-			hash256aux(_s, _begin, _end, (unsigned)sharedPre, _rlp);
+			hash256aux(_s, _begin, _end, (unsigned)sharedPre, _rlp, _scratch, _level);
 		}
 		else
 		{
@@ -53,7 +60,7 @@ void hash256rlp(HexMap const& _s, HexMap::const_iterator _begin, HexMap::const_i
 				if (b == n)
 					_rlp << "";
 				else
-					hash256aux(_s, b, n, _preLen + 1, _rlp);
+					hash256aux(_s, b, n, _preLen + 1, _rlp, _scratch, _level);
 				b = n;
 			}
 			if (_preLen == _begin->first.size())
@@ -65,10 +72,13 @@ void hash256rlp(HexMap const& _s, HexMap::const_iterator _begin, HexMap::const_i
 	}
 }
 
-void hash256aux(HexMap const& _s, HexMap::const_iterator _begin, HexMap::const_iterator _end, unsigned _preLen, RLPStream& _rlp)
+void hash256aux(HexMap const& _s, HexMap::const_iterator _begin, HexMap::const_iterator _end, unsigned _preLen, RLPStream& _rlp, RLPScratch& _scratch, size_t _level)
 {
-	RLPStream rlp;
-	hash256rlp(_s, _begin, _end, _preLen, rlp);
+	if (_scratch.size() == _level)
+		_scratch.emplace_back();
+	RLPStream& rlp = _scratch[_level];
+	rlp.clear();
+	hash256rlp(_s, _begin, _end, _preLen, rlp, _scratch, _level + 1);
 	if (rlp.out().size() < 32)
 	{
 		// RECURSIVE RLP
@@ -87,7 +97,8 @@ bytes rlp256(BytesMap const& _s)
 	for (auto i = _s.rbegin(); i != _s.rend(); ++i)
 		hexMap[asNibbles(bytesConstRef(&i->first))] = i->second;
 	RLPStream s;
-	hash256rlp(hexMap, hexMap.cbegin(), hexMap.cend(), 0, s);
+	RLPScratch scratch;
+	hash256rlp(hexMap, hexMap.cbegin(), hexMap.cend(), 0, s, scratch, 0);
 	return s.out();
 }
 
@@ -100,7 +111,7 @@ h256 orderedTrieRoot(std::vector<bytes> const& _data)
 {
 	BytesMap m;
 	unsigned j = 0;
-	for (auto i: _data)
+	for (auto const& i: _data)
 		m[rlp(j++)] = i;
 	return hash256(m);
 }
@@ -51,6 +51,10 @@ public:
     // of each record in the database. If `f` returns false, the `forEach`
     // method must return immediately.
     virtual void forEach(std::function<bool(Slice, Slice)> f) const = 0;
+
+    // Compact the whole database after many of its records were killed. Databases without
+    // compaction do nothing.
+    virtual void compact() {}
 };
 
 DEV_SIMPLE_EXCEPTION(DatabaseError);
@@ -62,8 +62,9 @@ libff::alt_bn128_Fq decodeFqElement(dev::bytesConstRef _data)
 	// h256::AlignLeft ensures that the h256 is zero-filled on the right if _data
 	// is too short.
 	h256 xbin(_data, h256::AlignLeft);
-	// TODO: Consider using a compiler time constant for comparison.
-	if (u256(xbin) >= u256(fromLibsnarkBigint(libff::alt_bn128_Fq::mod)))
+	// The modulus is set by initLibSnark, which runs before the first decoding.
+	static u256 const s_mod = u256(fromLibsnarkBigint(libff::alt_bn128_Fq::mod));
+	if (u256(xbin) >= s_mod)
 		BOOST_THROW_EXCEPTION(InvalidEncoding());
 	return toLibsnarkBigint(xbin);
 }
@@ -128,7 +129,8 @@ pair<bool, bytes> dev::crypto::alt_bn128_pairing_product(dev::bytesConstRef _in)
 	try
 	{
 		initLibSnark();
-		libff::alt_bn128_Fq12 x = libff::alt_bn128_Fq12::one();
+		std::vector<std::pair<libff::alt_bn128_G1_precomp, libff::alt_bn128_G2_precomp>> precomputed;
+		precomputed.reserve(pairs);
 		for (size_t i = 0; i < pairs; ++i)
 		{
 			bytesConstRef const pair = _in.cropped(i * pairSize, pairSize);
@@ -139,11 +141,17 @@ pair<bool, bytes> dev::crypto::alt_bn128_pairing_product(dev::bytesConstRef _in)
 				return {false, bytes()};
 			if (p.is_zero() || g1.is_zero())
 				continue; // the pairing is one
-			x = x * libff::alt_bn128_miller_loop(
-				libff::alt_bn128_precompute_G1(g1),
-				libff::alt_bn128_precompute_G2(p)
-			);
+			precomputed.emplace_back(libff::alt_bn128_precompute_G1(g1), libff::alt_bn128_precompute_G2(p));
 		}
+		// The Miller loops of two pairs share their squarings, the product of the loops is the same
+		libff::alt_bn128_Fq12 x = libff::alt_bn128_Fq12::one();
+		for (size_t i = 0; i + 1 < precomputed.size(); i += 2)
+			x = x * libff::alt_bn128_double_miller_loop(
+				precomputed[i].first, precomputed[i].second,
+				precomputed[i + 1].first, precomputed[i + 1].second
+			);
+		if (precomputed.size() % 2)
+			x = x * libff::alt_bn128_miller_loop(precomputed.back().first, precomputed.back().second);
 		bool const result = libff::alt_bn128_final_exponentiation(x) == libff::alt_bn128_GT::one();
 		return {true, h256{result}.asBytes()};
 	}
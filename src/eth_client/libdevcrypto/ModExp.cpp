@@ -0,0 +1,188 @@
+// Aleth: Ethereum C++ client, tools and libraries.
+// Copyright 2019 Aleth Authors.
+// Licensed under the GNU General Public License, Version 3.
+
+#include "ModExp.h"
+
+#include <array>
+#include <iterator>
+
+namespace dev
+{
+namespace crypto
+{
+namespace
+{
+#ifdef __SIZEOF_INT128__
+using uint128 = unsigned __int128;
+
+/// Modular arithmetic in the Montgomery form for a modulus of N 64-bit limbs, little-endian
+template <size_t N>
+class Montgomery
+{
+public:
+    using Limbs = std::array<uint64_t, N>;
+
+    explicit Montgomery(bigint const& _mod) : m_mod(toLimbs(_mod))
+    {
+        // -mod^-1 mod 2^64 by Newton iteration, each step doubles the correct low bits
+        uint64_t inv = 1;
+        for (int i = 0; i < 6; ++i)
+            inv *= 2 - m_mod[0] * inv;
+        m_modInv = -inv;
+
+        // R^2 mod mod, with R = 2^(64 * N)
+        m_r2 = toLimbs((bigint(1) << (128 * N)) % _mod);
+    }
+
+    Limbs toMont(bigint const& _x) const { return mul(toLimbs(_x), m_r2); }
+
+    bigint fromMont(Limbs const& _x) const
+    {
+        Limbs one{};
+        one[0] = 1;
+        return fromLimbs(mul(_x, one));
+    }
+
+    /// Montgomery multiplication (CIOS), a * b / R mod mod, for a, b < mod
+    Limbs mul(Limbs const& _a, Limbs const& _b) const
+    {
+        std::array<uint64_t, N + 2> t{};
+        for (size_t i = 0; i < N; ++i)
+        {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < N; ++j)
+            {
+                uint128 const s = uint128(_a[j]) * _b[i] + t[j] + carry;
+                t[j] = uint64_t(s);
+                carry = uint64_t(s >> 64);
+            }
+            uint128 s = uint128(t[N]) + carry;
+            t[N] = uint64_t(s);
+            t[N + 1] = uint64_t(s >> 64);
+
+            uint64_t const m = t[0] * m_modInv;
+            s = uint128(m) * m_mod[0] + t[0];
+            carry = uint64_t(s >> 64);
+            for (size_t j = 1; j < N; ++j)
+            {
+                s = uint128(m) * m_mod[j] + t[j] + carry;
+                t[j - 1] = uint64_t(s);
+                carry = uint64_t(s >> 64);
+            }
+            s = uint128(t[N]) + carry;
+            t[N - 1] = uint64_t(s);
+            t[N] = t[N + 1] + uint64_t(s >> 64);
+        }
+
+        // The result is below 2 * mod, subtract mod once if it is not below mod
+        Limbs r;
+        std::copy(t.begin(), t.begin() + N, r.begin());
+        if (t[N] != 0 || !less(r, m_mod))
+        {
+            uint64_t borrow = 0;
+            for (size_t j = 0; j < N; ++j)
+            {
+                uint128 const d = uint128(r[j]) - m_mod[j] - borrow;
+                r[j] = uint64_t(d);
+                borrow = uint64_t(d >> 64) & 1;
+            }
+        }
+        return r;
+    }
+
+private:
+    static bool less(Limbs const& _a, Limbs const& _b)
+    {
+        for (size_t j = N; j-- > 0;)
+        {
+            if (_a[j] != _b[j])
+                return _a[j] < _b[j];
+        }
+        return false;
+    }
+
+    static Limbs toLimbs(bigint const& _x)
+    {
+        Limbs r{};
+        std::vector<uint64_t> limbs;
+        boost::multiprecision::export_bits(_x, std::back_inserter(limbs), 64, false);
+        std::copy(limbs.begin(), limbs.begin() + std::min(limbs.size(), N), r.begin());
+        return r;
+    }
+
+    static bigint fromLimbs(Limbs const& _x)
+    {
+        bigint r;
+        boost::multiprecision::import_bits(r, _x.begin(), _x.end(), 64, false);
+        return r;
+    }
+
+    Limbs m_mod;
+    uint64_t m_modInv;
+    Limbs m_r2;
+};
+
+/// Left-to-right exponentiation with a fixed window of 4 bits
+template <size_t N>
+bigint modexp(bigint const& _base, bigint const& _exp, bigint const& _mod)
+{
+    Montgomery<N> const mont(_mod);
+    using Limbs = typename Montgomery<N>::Limbs;
+
+    constexpr unsigned c_window = 4;
+    std::array<Limbs, 1 << c_window> powers;
+    powers[0] = mont.toMont(1);
+    powers[1] = mont.toMont(_base % _mod);
+    for (size_t i = 2; i < powers.size(); ++i)
+        powers[i] = mont.mul(powers[i - 1], powers[1]);
+
+    Limbs r = powers[0];
+    if (_exp != 0)
+    {
+        size_t const bits = msb(_exp) + 1;
+        size_t bit = (bits + c_window - 1) / c_window * c_window;
+        while (bit > 0)
+        {
+            bit -= c_window;
+            unsigned digit = 0;
+            for (unsigned i = c_window; i-- > 0;)
+                digit = (digit << 1) | (bit_test(_exp, bit + i) ? 1 : 0);
+
+            for (unsigned i = 0; i < c_window; ++i)
+                r = mont.mul(r, r);
+            if (digit)
+                r = mont.mul(r, powers[digit]);
+        }
+    }
+    return mont.fromMont(r);
+}
+#endif
+}  // namespace
+
+bool modexpFixedWidth(bigint const& _base, bigint const& _exp, bigint const& _mod, bigint& o_result)
+{
+#ifdef __SIZEOF_INT128__
+    if (_mod <= 1 || !bit_test(_mod, 0))
+        return false;
+
+    size_t const bits = msb(_mod) + 1;
+    if (bits <= 256)
+        o_result = modexp<4>(_base, _exp, _mod);
+    else if (bits <= 512)
+        o_result = modexp<8>(_base, _exp, _mod);
+    else if (bits <= 1024)
+        o_result = modexp<16>(_base, _exp, _mod);
+    else if (bits <= 2048)
+        o_result = modexp<32>(_base, _exp, _mod);
+    else if (bits <= 4096)
+        o_result = modexp<64>(_base, _exp, _mod);
+    else
+        return false;
+    return true;
+#else
+    return false;
+#endif
+}
+}  // namespace crypto
+}  // namespace dev
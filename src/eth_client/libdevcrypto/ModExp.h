@@ -0,0 +1,18 @@
+// Aleth: Ethereum C++ client, tools and libraries.
+// Copyright 2019 Aleth Authors.
+// Licensed under the GNU General Public License, Version 3.
+
+#pragma once
+
+#include <libdevcore/Common.h>
+
+namespace dev
+{
+namespace crypto
+{
+/// Calculates _base ^ _exp mod _mod with Montgomery multiplication on fixed-width limbs, for odd
+/// moduli of up to 4096 bits, the width being the smallest of 256, 512, 1024, 2048 and 4096 bits.
+/// @returns false when the modulus is not supported, the result is then to be calculated with powm
+bool modexpFixedWidth(bigint const& _base, bigint const& _exp, bigint const& _mod, bigint& o_result);
+}
+}  // namespace dev
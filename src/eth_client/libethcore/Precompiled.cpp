@@ -11,6 +11,7 @@
 #include <libdevcrypto/Common.h>
 #include <libdevcrypto/Hash.h>
 #include <libdevcrypto/LibSnark.h>
+#include <libdevcrypto/ModExp.h>
 #include <libethcore/Common.h>
 #include <qtum/qtumutils.h>
 using namespace std;
@@ -68,17 +69,23 @@ ETH_REGISTER_PRECOMPILED(btc_ecrecover)(bytesConstRef _in)
     memcpy(&in, _in.data(), min(_in.size(), sizeof(in)));
 
     h256 ret;
-    try
+    bool recovered = false;
+    h256 entry = qtumutils::recover_cache_entry(qtumutils::RecoverType::BTC, bytesConstRef((dev::byte const*)&in, sizeof(in)));
+    if (!qtumutils::recover_cache_get(entry, recovered, ret))
     {
-        bool recovered = false;
-        u256 v = (u256)in.v;
-        recovered = qtumutils::btc_ecrecover(in.hash, v, in.r, in.s, ret);
-        if(recovered)
+        try
         {
-            return {true, ret.asBytes()};
+            u256 v = (u256)in.v;
+            recovered = qtumutils::btc_ecrecover(in.hash, v, in.r, in.s, ret);
         }
+        catch (...) {}
+        qtumutils::recover_cache_set(entry, recovered, ret);
+    }
+
+    if(recovered)
+    {
+        return {true, ret.asBytes()};
     }
-    catch (...) {}
 
     return {true, {}};
 }
@@ -102,16 +109,24 @@ ETH_REGISTER_PRECOMPILED(ecrecover)(bytesConstRef _in)
         SignatureStruct sig(in.r, in.s, (dev::byte)((int)v - 27));
         if (sig.isValid())
         {
-            try
+            bool recovered = false;
+            h256 entry = qtumutils::recover_cache_entry(qtumutils::RecoverType::ETH, bytesConstRef((dev::byte const*)&in, sizeof(in)));
+            if (!qtumutils::recover_cache_get(entry, recovered, ret))
             {
-                if (Public rec = recover(sig, in.hash))
+                try
                 {
-                    ret = dev::sha3(rec);
-                    memset(ret.data(), 0, 12);
-                    return {true, ret.asBytes()};
+                    if (Public rec = recover(sig, in.hash))
+                    {
+                        ret = dev::sha3(rec);
+                        memset(ret.data(), 0, 12);
+                        recovered = true;
+                    }
                 }
+                catch (...) {}
+                qtumutils::recover_cache_set(entry, recovered, ret);
             }
-            catch (...) {}
+            if (recovered)
+                return {true, ret.asBytes()};
         }
     }
     return {true, {}};
@@ -187,7 +202,10 @@ ETH_REGISTER_PRECOMPILED(modexp)(bytesConstRef _in)
     bigint const exp(parseBigEndianRightPadded(_in, 96 + baseLength, expLength));
     bigint const mod(parseBigEndianRightPadded(_in, 96 + baseLength + expLength, modLength));
 
-    bigint const result = mod != 0 ? boost::multiprecision::powm(base, exp, mod) : bigint{0};
+    // Odd moduli of common sizes use the fixed-width Montgomery kernels, the others the generic powm
+    bigint result{0};
+    if (mod != 0 && !dev::crypto::modexpFixedWidth(base, exp, mod, result))
+        result = boost::multiprecision::powm(base, exp, mod);
 
     size_t const retLength(modLength);
     bytes ret(retLength);
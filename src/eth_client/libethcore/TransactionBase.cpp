@@ -20,7 +20,7 @@ TransactionBase::TransactionBase(TransactionSkeleton const& _ts, Secret const& _
     m_receiveAddress(_ts.to),
     m_gasPrice(_ts.gasPrice),
     m_gas(_ts.gas),
-    m_data(_ts.data),
+    m_data(_ts.data.begin(), _ts.data.end()),
     m_sender(_ts.from)
 {
     if (_s)
@@ -49,7 +49,8 @@ TransactionBase::TransactionBase(bytesConstRef _rlpData, CheckTransaction _check
             BOOST_THROW_EXCEPTION(InvalidTransactionFormat()
                                   << errinfo_comment("transaction data RLP must be a byte array"));
 
-        m_data = rlp[5].toBytes();
+        bytesConstRef const data = rlp[5].toBytesConstRef();
+        m_data.assign(data.begin(), data.end());
 
         u256 const v = rlp[6].toInt<u256>();
         h256 const r = rlp[7].toInt<u256>();
@@ -163,7 +164,7 @@ void TransactionBase::streamRLP(RLPStream& _s, IncludeSignature _sig, bool _forE
         _s << m_receiveAddress;
     else
         _s << "";
-    _s << m_value << m_data;
+    _s << m_value << dataRef();
 
     if (_sig)
     {
@@ -9,6 +9,8 @@
 #include <libdevcore/RLP.h>
 #include <libdevcore/SHA3.h>
 
+#include <prevector.h>
+
 #include <boost/optional.hpp>
 
 namespace dev
@@ -18,6 +20,11 @@ namespace eth
 
 struct EVMSchedule;
 
+/// Bytes of the transaction data kept inline, which covers the calls of the QRC20 token functions
+/// (68 bytes for transfer, 100 bytes for transferFrom) so that they and their copies do not allocate.
+static constexpr unsigned int TRANSACTION_DATA_INLINE_SIZE = 100;
+using TransactionData = prevector<TRANSACTION_DATA_INLINE_SIZE, byte>;
+
 /// Named-boolean type to encode whether a signature be included in the serialisation process.
 enum IncludeSignature
 {
@@ -45,16 +52,16 @@ public:
     TransactionBase(TransactionSkeleton const& _ts, Secret const& _s = Secret());
 
     /// Constructs a signed message-call transaction.
-    TransactionBase(u256 const& _value, u256 const& _gasPrice, u256 const& _gas, Address const& _dest, bytes const& _data, u256 const& _nonce, Secret const& _secret): m_type(MessageCall), m_nonce(_nonce), m_value(_value), m_receiveAddress(_dest), m_gasPrice(_gasPrice), m_gas(_gas), m_data(_data) { sign(_secret); }
+    TransactionBase(u256 const& _value, u256 const& _gasPrice, u256 const& _gas, Address const& _dest, bytes const& _data, u256 const& _nonce, Secret const& _secret): m_type(MessageCall), m_nonce(_nonce), m_value(_value), m_receiveAddress(_dest), m_gasPrice(_gasPrice), m_gas(_gas), m_data(_data.begin(), _data.end()) { sign(_secret); }
 
     /// Constructs a signed contract-creation transaction.
-    TransactionBase(u256 const& _value, u256 const& _gasPrice, u256 const& _gas, bytes const& _data, u256 const& _nonce, Secret const& _secret): m_type(ContractCreation), m_nonce(_nonce), m_value(_value), m_gasPrice(_gasPrice), m_gas(_gas), m_data(_data) { sign(_secret); }
+    TransactionBase(u256 const& _value, u256 const& _gasPrice, u256 const& _gas, bytes const& _data, u256 const& _nonce, Secret const& _secret): m_type(ContractCreation), m_nonce(_nonce), m_value(_value), m_gasPrice(_gasPrice), m_gas(_gas), m_data(_data.begin(), _data.end()) { sign(_secret); }
 
     /// Constructs an unsigned message-call transaction.
-    TransactionBase(u256 const& _value, u256 const& _gasPrice, u256 const& _gas, Address const& _dest, bytes const& _data, u256 const& _nonce = 0): m_type(MessageCall), m_nonce(_nonce), m_value(_value), m_receiveAddress(_dest), m_gasPrice(_gasPrice), m_gas(_gas), m_data(_data) {}
+    TransactionBase(u256 const& _value, u256 const& _gasPrice, u256 const& _gas, Address const& _dest, bytes const& _data, u256 const& _nonce = 0): m_type(MessageCall), m_nonce(_nonce), m_value(_value), m_receiveAddress(_dest), m_gasPrice(_gasPrice), m_gas(_gas), m_data(_data.begin(), _data.end()) {}
 
     /// Constructs an unsigned contract-creation transaction.
-    TransactionBase(u256 const& _value, u256 const& _gasPrice, u256 const& _gas, bytes const& _data, u256 const& _nonce = 0): m_type(ContractCreation), m_nonce(_nonce), m_value(_value), m_gasPrice(_gasPrice), m_gas(_gas), m_data(_data) {}
+    TransactionBase(u256 const& _value, u256 const& _gasPrice, u256 const& _gas, bytes const& _data, u256 const& _nonce = 0): m_type(ContractCreation), m_nonce(_nonce), m_value(_value), m_gasPrice(_gasPrice), m_gas(_gas), m_data(_data.begin(), _data.end()) {}
 
     /// Constructs a transaction from the given RLP.
     explicit TransactionBase(bytesConstRef _rlp, CheckTransaction _checkSig);
@@ -118,7 +125,10 @@ public:
     Address from() const { return safeSender(); }
 
     /// @returns the data associated with this (message-call) transaction. Synonym for initCode().
-    bytes const& data() const { return m_data; }
+    TransactionData const& data() const { return m_data; }
+
+    /// @returns a reference to the data associated with this transaction.
+    bytesConstRef dataRef() const { return bytesConstRef(m_data.data(), m_data.size()); }
 
     /// @returns the transaction-count of the sender.
     u256 nonce() const { return m_nonce; }
@@ -146,7 +156,7 @@ public:
     void sign(Secret const& _priv);			///< Sign the transaction.
 
     /// @returns amount of gas required for the basic payment.
-    int64_t baseGasRequired(EVMSchedule const& _es) const { return baseGasRequired(isCreation(), &m_data, _es); }
+    int64_t baseGasRequired(EVMSchedule const& _es) const { return baseGasRequired(isCreation(), dataRef(), _es); }
 
     /// Get the fee associated for a transaction with the given data.
     static int64_t baseGasRequired(bool _contractCreation, bytesConstRef _data, EVMSchedule const& _es);
@@ -171,7 +181,7 @@ protected:
     Address m_receiveAddress;			///< The receiving address of the transaction.
     u256 m_gasPrice;					///< The base fee and thus the implied exchange rate of ETH to GAS.
     u256 m_gas;							///< The total gas to convert, paid for from sender's account. Any unused gas gets refunded once the contract is ended.
-    bytes m_data;						///< The data associated with the transaction, or the initialiser if it's a creation transaction.
+    TransactionData m_data;				///< The data associated with the transaction, or the initialiser if it's a creation transaction.
     boost::optional<SignatureStruct> m_vrs;	///< The signature of the transaction. Encodes the sender.
     /// EIP155 value for calculating transaction hash
     /// https://github.com/ethereum/EIPs/blob/master/EIPS/eip-155.md
@@ -4,6 +4,7 @@
 
 
 #include "Account.h"
+#include "FlatStateCache.h"
 #include "SecureTrieDB.h"
 #include "ValidationSchemes.h"
 #include <libdevcore/JsonUtils.h>
@@ -22,7 +23,7 @@ void Account::setCode(bytes&& _code, u256 const& _version)
     auto const newHash = sha3(_code);
     if (newHash != m_codeHash)
     {
-        m_codeCache = std::move(_code);
+        m_codeCache = std::make_shared<bytes const>(std::move(_code));
         m_hasNewCode = true;
         m_codeHash = newHash;
     }
@@ -31,7 +32,7 @@ void Account::setCode(bytes&& _code, u256 const& _version)
 
 void Account::resetCode()
 {
-    m_codeCache.clear();
+    m_codeCache.reset();
     m_hasNewCode = false;
     m_codeHash = EmptySHA3;
     // Reset the version, as it was set together with code
@@ -44,11 +45,18 @@ u256 Account::originalStorageValue(u256 const& _key, OverlayDB const& _db) const
     if (it != m_storageOriginal.end())
         return it->second;
 
-    // Not in the original values cache - go to the DB.
+    // Not in the original values cache - try the flat cache, then go to the DB.
+    u256 value;
+    if (FlatStateCache::instance().storage(m_storageRoot, _key, value))
+    {
+        m_storageOriginal[_key] = value;
+        return value;
+    }
     SecureTrieDB<h256, OverlayDB> const memdb(const_cast<OverlayDB*>(&_db), m_storageRoot);
     std::string const payload = memdb.at(_key);
-    auto const value = payload.size() ? RLP(payload).toInt<u256>() : 0;
+    value = payload.size() ? RLP(payload).toInt<u256>() : 0;
     m_storageOriginal[_key] = value;
+    FlatStateCache::instance().storeStorage(m_storageRoot, _key, value);
     return value;
 }
 
@@ -12,6 +12,8 @@
 
 #include <boost/filesystem/path.hpp>
 
+#include <memory>
+
 namespace dev
 {
 class OverlayDB;
@@ -138,6 +140,9 @@ public:
     /// @returns the storage overlay as a simple hash map.
     std::unordered_map<u256, u256> const& storageOverlay() const { return m_storageOverlay; }
 
+    /// @returns the original values of the storage slots loaded so far.
+    std::unordered_map<u256, u256> const& originalStorage() const { return m_storageOriginal; }
+
     /// Set a key/value pair in the account's storage. This actually goes into the overlay, for committing
     /// to the trie later.
     void setStorage(u256 _p, u256 _v) { m_storageOverlay[_p] = _v; changed(); }
@@ -172,11 +177,14 @@ public:
     void resetCode();
 
     /// Specify to the object what the actual code is for the account. @a _code must have a SHA3
-    /// equal to codeHash().
-    void noteCode(bytesConstRef _code) { assert(sha3(_code) == m_codeHash); m_codeCache = _code.toBytes(); }
+    /// equal to codeHash(). The code is shared with the CodeCache and other accounts.
+    void noteCode(std::shared_ptr<bytes const> _code) { assert(_code && sha3(*_code) == m_codeHash); m_codeCache = std::move(_code); }
 
     /// @returns the account's code.
-    bytes const& code() const { return m_codeCache; }
+    bytes const& code() const { return m_codeCache ? *m_codeCache : NullBytes; }
+
+    /// @returns the account's code as shared immutable bytes, null if it was not loaded.
+    std::shared_ptr<bytes const> const& sharedCode() const { return m_codeCache; }
 
     u256 version() const { return m_version; }
 
@@ -222,7 +230,7 @@ private:
 
     /// The associated code for this account. The SHA3 of this should be equal to m_codeHash unless
     /// m_codeHash equals c_contractConceptionCodeHash.
-    bytes m_codeCache;
+    std::shared_ptr<bytes const> m_codeCache;
 
     /// Value for m_codeHash when this account is having its code determined.
     static const h256 c_contractConceptionCodeHash;
@@ -0,0 +1,73 @@
+// Aleth: Ethereum C++ client, tools and libraries.
+// Copyright 2015-2019 Aleth Authors.
+// Licensed under the GNU General Public License, Version 3.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Thread-safe cache of contract code by code hash, shared by all State instances.
+ * Code is immutable and content-addressed, so the entries stay valid across root switches.
+ * The cache is bounded by the number of entries and their total size, when it is full
+ * random elements are removed.
+ */
+class CodeCache
+{
+public:
+	using Code = std::shared_ptr<bytes const>;
+
+	void store(h256 const& _hash, Code const& _code)
+	{
+		if (!_code || _code->size() > c_maxBytes)
+			return;
+		UniqueGuard g(x_cache);
+		if (m_cache.count(_hash))
+			return;
+		while (m_cache.size() >= c_maxSize || m_bytes + _code->size() > c_maxBytes)
+			removeRandomElement();
+		m_cache[_hash] = _code;
+		m_bytes += _code->size();
+	}
+	/// @returns the code with hash @a _hash, or null if it is not cached.
+	Code get(h256 const& _hash) const
+	{
+		UniqueGuard g(x_cache);
+		auto it = m_cache.find(_hash);
+		return it == m_cache.end() ? nullptr : it->second;
+	}
+
+	static CodeCache& instance() { static CodeCache cache; return cache; }
+
+private:
+	/// Removes a random element from the cache.
+	void removeRandomElement()
+	{
+		if (!m_cache.empty())
+		{
+			auto it = m_cache.lower_bound(h256::random());
+			if (it == m_cache.end())
+				it = m_cache.begin();
+			m_bytes -= it->second->size();
+			m_cache.erase(it);
+		}
+	}
+
+	static const size_t c_maxSize = 50000;
+	static const size_t c_maxBytes = 128 * 1024 * 1024;
+	mutable Mutex x_cache;
+	std::map<h256, Code> m_cache;
+	size_t m_bytes = 0;
+};
+
+}
+}
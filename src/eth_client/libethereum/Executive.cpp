@@ -101,9 +101,9 @@ bool Executive::execute()
 
     assert(m_t.gas() >= (u256)m_baseGasRequired);
     if (m_t.isCreation())
-        return create(m_t.sender(), m_t.value(), m_t.gasPrice(), m_t.gas() - (u256)m_baseGasRequired, &m_t.data(), m_t.sender());
+        return create(m_t.sender(), m_t.value(), m_t.gasPrice(), m_t.gas() - (u256)m_baseGasRequired, m_t.dataRef(), m_t.sender());
     else
-        return call(m_t.receiveAddress(), m_t.sender(), m_t.value(), m_t.gasPrice(), bytesConstRef(&m_t.data()), m_t.gas() - (u256)m_baseGasRequired);
+        return call(m_t.receiveAddress(), m_t.sender(), m_t.value(), m_t.gasPrice(), m_t.dataRef(), m_t.gas() - (u256)m_baseGasRequired);
 }
 
 bool Executive::call(Address const& _receiveAddress, Address const& _senderAddress, u256 const& _value, u256 const& _gasPrice, bytesConstRef _data, u256 const& _gas)
@@ -151,7 +151,14 @@ bool Executive::call(CallParameters const& _p, u256 const& _gasPrice, Address co
             m_gas = (u256)(_p.gas - g);
             bytes output;
             bool success;
-            tie(success, output) = m_sealEngine.executePrecompiled(_p.codeAddress, _p.data, m_envInfo.number());
+            if (ContractProfiler::Active())
+            {
+                auto const start = std::chrono::steady_clock::now();
+                tie(success, output) = m_sealEngine.executePrecompiled(_p.codeAddress, _p.data, m_envInfo.number());
+                ContractProfiler::RecordPrecompile(_p.senderAddress, std::chrono::steady_clock::now() - start);
+            }
+            else
+                tie(success, output) = m_sealEngine.executePrecompiled(_p.codeAddress, _p.data, m_envInfo.number());
             size_t outputSize = output.size();
             m_output = owning_bytes_ref{std::move(output), 0, outputSize};
             if (!success)
@@ -131,6 +131,7 @@ h256 ExtVM::codeHashAt(Address _a)
 
 void ExtVM::setStore(u256 _n, u256 _v)
 {
+    ContractProfiler::RecordStorageWrite(myAddress);
     m_s.setStorage(myAddress, _n, _v);
 }
 
@@ -178,10 +179,7 @@ h256 ExtVM::blockHash(u256 _number)
     if (currentNumber < m_sealEngine.chainParams().experimentalForkBlock + 256)
     {
         h256 const parentHash = envInfo().header().parentHash();
-        h256s const lastHashes = envInfo().lastHashes().precedingHashes(parentHash);
-
-        assert(lastHashes.size() > (unsigned)(currentNumber - 1 - _number));
-        return lastHashes[(unsigned)(currentNumber - 1 - _number)];
+        return envInfo().lastHashes().precedingHash(parentHash, (unsigned)(currentNumber - 1 - _number));
     }
 
     u256 const nonce = m_s.getNonce(caller);
@@ -10,6 +10,7 @@
 #include <libethcore/Common.h>
 #include <libethcore/SealEngine.h>
 #include <libevm/ExtVMFace.h>
+#include <qtum/qtumprofiler.h>
 
 #include <functional>
 #include <map>
@@ -43,7 +44,11 @@ public:
     }
 
     /// Read storage location.
-    u256 store(u256 _n) final { return m_s.storage(myAddress, _n); }
+    u256 store(u256 _n) final
+    {
+        ContractProfiler::RecordStorageRead(myAddress);
+        return m_s.storage(myAddress, _n);
+    }
 
     /// Write a value in storage.
     void setStore(u256 _n, u256 _v) final;
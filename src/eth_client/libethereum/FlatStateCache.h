@@ -0,0 +1,157 @@
+// Aleth: Ethereum C++ client, tools and libraries.
+// Copyright 2015-2019 Aleth Authors.
+// Licensed under the GNU General Public License, Version 3.
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <libdevcore/Address.h>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Thread-safe flat cache of the state trie lookups, in front of the trie walks.
+ * Accounts are keyed by (state root, address) and storage slots by (storage root, key). The tries are
+ * content-addressed, so an entry holds for every state that has the root: commits put the values they
+ * write under the new roots, and a state set back to an older root, e.g. when a block is disconnected,
+ * finds the entries of that root again. If the cache is over its memory budget, random elements are removed.
+ */
+class FlatStateCache
+{
+public:
+	struct Stats
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+		size_t maxBytes = 0;
+	};
+
+	/// @returns true and sets @a o_rlp to the account RLP at @a _root, empty if there is no account.
+	bool account(h256 const& _root, Address const& _addr, std::string& o_rlp) const
+	{
+		ReadGuard g(x_cache);
+		auto it = m_accounts.find(std::make_pair(_root, _addr));
+		if (it == m_accounts.end())
+			return miss();
+		o_rlp = it->second;
+		return hit();
+	}
+	void storeAccount(h256 const& _root, Address const& _addr, std::string const& _rlp)
+	{
+		WriteGuard g(x_cache);
+		auto key = std::make_pair(_root, _addr);
+		auto it = m_accounts.find(key);
+		if (it != m_accounts.end())
+		{
+			m_usage -= it->second.size();
+			it->second = _rlp;
+			m_usage += _rlp.size();
+			return;
+		}
+		makeRoom(c_accountUsage + _rlp.size());
+		m_accounts.emplace(key, _rlp);
+		m_usage += c_accountUsage + _rlp.size();
+	}
+
+	/// @returns true and sets @a o_value to the value of @a _key in the storage trie with @a _root.
+	bool storage(h256 const& _root, u256 const& _key, u256& o_value) const
+	{
+		ReadGuard g(x_cache);
+		auto it = m_slots.find(std::make_pair(_root, _key));
+		if (it == m_slots.end())
+			return miss();
+		o_value = it->second;
+		return hit();
+	}
+	void storeStorage(h256 const& _root, u256 const& _key, u256 const& _value)
+	{
+		WriteGuard g(x_cache);
+		auto key = std::make_pair(_root, _key);
+		auto it = m_slots.find(key);
+		if (it != m_slots.end())
+		{
+			it->second = _value;
+			return;
+		}
+		makeRoom(c_slotUsage);
+		m_slots.emplace(key, _value);
+		m_usage += c_slotUsage;
+	}
+
+	/// Change the memory budget, removing random elements until the cache fits in it.
+	void setMaxBytes(size_t _maxBytes)
+	{
+		WriteGuard g(x_cache);
+		m_maxBytes = _maxBytes;
+		makeRoom(0);
+	}
+
+	Stats stats() const
+	{
+		ReadGuard g(x_cache);
+		return {m_hits.load(std::memory_order_relaxed), m_misses.load(std::memory_order_relaxed), m_evictions, m_maxBytes};
+	}
+
+	static FlatStateCache& instance() { static FlatStateCache cache; return cache; }
+
+	static const size_t c_defaultMaxBytes = 48 << 20;
+
+private:
+	bool hit() const { m_hits.fetch_add(1, std::memory_order_relaxed); return true; }
+	bool miss() const { m_misses.fetch_add(1, std::memory_order_relaxed); return false; }
+
+	/// Removes random elements, from the map with more of them, until @a _bytes more fit in the budget.
+	void makeRoom(size_t _bytes)
+	{
+		while (m_usage + _bytes > m_maxBytes && !(m_accounts.empty() && m_slots.empty()))
+		{
+			if (m_slots.size() >= m_accounts.size())
+				removeRandomElement(m_slots);
+			else
+				removeRandomElement(m_accounts);
+		}
+	}
+
+	/// Removes a random element from @a _map.
+	template <class Map>
+	void removeRandomElement(Map& _map)
+	{
+		if (!_map.empty())
+		{
+			auto it = _map.lower_bound(std::make_pair(h256::random(), typename Map::key_type::second_type()));
+			if (it == _map.end())
+				it = _map.begin();
+			m_usage -= usage(*it);
+			_map.erase(it);
+			++m_evictions;
+		}
+	}
+
+	static size_t usage(std::pair<const std::pair<h256, Address>, std::string> const& _entry) { return c_accountUsage + _entry.second.size(); }
+	static size_t usage(std::pair<const std::pair<h256, u256>, u256> const&) { return c_slotUsage; }
+
+	/// Rough memory usage of the map nodes, without the account RLP
+	static const size_t c_accountUsage = sizeof(std::pair<h256, Address>) + sizeof(std::string) + 48;
+	static const size_t c_slotUsage = sizeof(std::pair<h256, u256>) + sizeof(u256) + 48;
+
+	mutable SharedMutex x_cache;
+	std::map<std::pair<h256, Address>, std::string> m_accounts;
+	std::map<std::pair<h256, u256>, u256> m_slots;
+	size_t m_usage = 0;
+	size_t m_maxBytes = c_defaultMaxBytes;
+	uint64_t m_evictions = 0;
+	mutable std::atomic<uint64_t> m_hits{0};
+	mutable std::atomic<uint64_t> m_misses{0};
+};
+
+}
+}
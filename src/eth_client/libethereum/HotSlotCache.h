@@ -0,0 +1,79 @@
+// Aleth: Ethereum C++ client, tools and libraries.
+// Copyright 2015-2019 Aleth Authors.
+// Licensed under the GNU General Public License, Version 3.
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include <libdevcore/Address.h>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Thread-safe record of the storage slots the contracts used, shared by all State instances.
+ * Commits note the slots the executions loaded, and State::prefetch loads them again before the
+ * next transactions to the contracts run. If a set is full, a random slot of it is replaced.
+ */
+class HotSlotCache
+{
+public:
+	/// Notes the keys of @a _slots as used by @a _contract.
+	void note(Address const& _contract, std::unordered_map<u256, u256> const& _slots)
+	{
+		WriteGuard g(x_cache);
+		auto it = m_slots.find(_contract);
+		if (it == m_slots.end())
+		{
+			if (m_slots.size() >= c_maxContracts)
+				removeRandomElement(m_slots, Address::random());
+			it = m_slots.emplace(_contract, std::set<u256>()).first;
+		}
+		for (auto const& i: _slots)
+		{
+			if (it->second.size() >= c_maxSlotsPerContract && !it->second.count(i.first))
+				removeRandomElement(it->second, u256(h256::random()));
+			it->second.insert(i.first);
+		}
+	}
+
+	/// @returns the slots noted for @a _contract.
+	std::vector<u256> slots(Address const& _contract) const
+	{
+		ReadGuard g(x_cache);
+		auto it = m_slots.find(_contract);
+		return it == m_slots.end() ? std::vector<u256>() : std::vector<u256>(it->second.begin(), it->second.end());
+	}
+
+	static HotSlotCache& instance() { static HotSlotCache cache; return cache; }
+
+private:
+	/// Removes a random element from @a _c, the first one at or after @a _random.
+	template <class Container, class Key>
+	static void removeRandomElement(Container& _c, Key const& _random)
+	{
+		if (!_c.empty())
+		{
+			auto it = _c.lower_bound(_random);
+			if (it == _c.end())
+				it = _c.begin();
+			_c.erase(it);
+		}
+	}
+
+	static const size_t c_maxContracts = 10000;
+	static const size_t c_maxSlotsPerContract = 256;
+	mutable SharedMutex x_cache;
+	std::map<Address, std::set<u256>> m_slots;
+};
+
+}
+}
@@ -29,6 +29,14 @@ public:
 	/// i.e. result[0] is @a _mostRecentHash, result[1] is its parent, result[2] is grandparent etc.
 	virtual h256s precedingHashes(h256 const& _mostRecentHash) const = 0;
 
+	/// Get the hash of the block @a _index blocks before @a _mostRecentHash, result[_index] of precedingHashes()
+	/// Returns h256() when there is no such block
+	virtual h256 precedingHash(h256 const& _mostRecentHash, unsigned _index) const
+	{
+		h256s const hashes = precedingHashes(_mostRecentHash);
+		return _index < hashes.size() ? hashes[_index] : h256();
+	}
+
 	/// Clear any cached result
 	virtual void clear() = 0;
 };
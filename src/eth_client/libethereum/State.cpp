@@ -6,11 +6,18 @@
 
 #include "ExtVM.h"
 #include "DatabasePaths.h"
+#include "CodeCache.h"
+#include "FlatStateCache.h"
+#include "HotSlotCache.h"
 #include <libdevcore/Assertions.h>
 #include <libdevcore/DBFactory.h>
 #include <libevm/VMFactory.h>
 #include <boost/filesystem.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 using namespace std;
 using namespace dev;
 using namespace dev::eth;
@@ -157,6 +164,9 @@ Account const* State::account(Address const& _a) const
 
 Account* State::account(Address const& _addr)
 {
+    if (m_accessedAddresses)
+        m_accessedAddresses->insert(_addr);
+
     auto it = m_cache.find(_addr);
     if (it != m_cache.end())
         return &it->second;
@@ -165,7 +175,13 @@ Account* State::account(Address const& _addr)
         return nullptr;
 
     // Populate basic info.
-    string stateBack = m_state.at(_addr);
+    string stateBack;
+    h256 const stateRoot = m_state.root();
+    if (!FlatStateCache::instance().account(stateRoot, _addr, stateBack))
+    {
+        stateBack = m_state.at(_addr);
+        FlatStateCache::instance().storeAccount(stateRoot, _addr, stateBack);
+    }
     if (stateBack.empty())
     {
         m_nonExistingAccountsCache.insert(_addr);
@@ -212,11 +228,75 @@ void State::commit(CommitBehaviour _commitBehaviour)
     if (_commitBehaviour == CommitBehaviour::RemoveEmptyAccounts)
         removeEmptyAccounts();
     m_touched += dev::eth::commit(m_cache, m_state);
+    for (auto const& i: m_cache)
+        if (!i.second.originalStorage().empty())
+            HotSlotCache::instance().note(i.first, i.second.originalStorage());
     m_changeLog.clear();
     m_cache.clear();
     m_unchangedCacheEntries.clear();
 }
 
+void State::prefetch(std::vector<Address> const& _addresses) const
+{
+    unsigned const threads = std::min<unsigned>(std::thread::hardware_concurrency(), c_maxPrefetchThreads);
+    if (_addresses.size() < 2 || threads < 2)
+        return;
+
+    h256 const stateRoot = m_state.root();
+    OverlayDB* db = const_cast<OverlayDB*>(&m_db);  // only read
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t j = next++; j < _addresses.size(); j = next++)
+        {
+            Address const& addr = _addresses[j];
+            try
+            {
+                string stateBack;
+                if (!FlatStateCache::instance().account(stateRoot, addr, stateBack))
+                {
+                    stateBack = SecureTrieDB<Address, OverlayDB>(db, stateRoot).at(addr);
+                    FlatStateCache::instance().storeAccount(stateRoot, addr, stateBack);
+                }
+                if (stateBack.empty())
+                    continue;
+
+                RLP state(stateBack);
+                auto const storageRoot = state[2].toHash<h256>();
+                auto const codeHash = state[3].toHash<h256>();
+                if (codeHash != EmptySHA3 && !CodeCache::instance().get(codeHash))
+                {
+                    CodeCache::Code code = std::make_shared<bytes const>(asBytes(m_db.lookup(codeHash)));
+                    CodeCache::instance().store(codeHash, code);
+                    CodeSizeCache::instance().store(codeHash, code->size());
+                }
+
+                std::vector<u256> const slots = HotSlotCache::instance().slots(addr);
+                if (slots.empty() || storageRoot == EmptyTrie)
+                    continue;
+                SecureTrieDB<h256, OverlayDB> const storageDB(db, storageRoot);
+                for (u256 const& key: slots)
+                {
+                    u256 value;
+                    if (FlatStateCache::instance().storage(storageRoot, key, value))
+                        continue;
+                    std::string const payload = storageDB.at(key);
+                    FlatStateCache::instance().storeStorage(storageRoot, key, payload.size() ? RLP(payload).toInt<u256>() : 0);
+                }
+            }
+            catch (...)
+            {
+                // The execution reads what could not be loaded here and reports the errors
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < std::min<size_t>(threads, _addresses.size()); ++t)
+        workers.emplace_back(work);
+    work();
+    for (std::thread& t: workers)
+        t.join();
+}
+
 unordered_map<Address, u256> State::addresses() const
 {
 #if ETH_FATDB
@@ -499,6 +579,63 @@ map<h256, pair<u256, u256>> State::storage(Address const& _id) const
 #endif
 }
 
+std::pair<map<h256, pair<u256, u256>>, h256> State::storage(
+    Address const& _id, h256 const& _beginHash, size_t _maxResults) const
+{
+    map<h256, pair<u256, u256>> ret;
+    h256 nextKey;
+
+#if ETH_FATDB
+    if (Account const* a = account(_id))
+    {
+        // Read one slot past the page, it is the cursor of the next one
+        if (h256 root = a->baseRoot())
+        {
+            SecureTrieDB<h256, OverlayDB> memdb(const_cast<OverlayDB*>(&m_db), root);       // promise we won't alter the overlay! :)
+
+            for (auto it = memdb.hashedLowerBound(_beginHash); it != memdb.hashedEnd() && ret.size() <= _maxResults; ++it)
+            {
+                h256 const hashedKey((*it).first);
+                u256 const key = h256(it.key());
+                u256 const value = RLP((*it).second).toInt<u256>();
+                ret[hashedKey] = make_pair(key, value);
+            }
+        }
+
+        // Then merge the cached slots in the range over the top
+        h256 const endHash = ret.size() > _maxResults ? ret.rbegin()->first : h256();
+        for (auto const& i : a->storageOverlay())
+        {
+            h256 const hashedKey = sha3(i.first);
+            if (hashedKey < _beginHash || (endHash && hashedKey > endHash))
+                continue;
+            if (i.second)
+                ret[hashedKey] = i;
+            else
+                ret.erase(hashedKey);
+        }
+
+        if (ret.size() > _maxResults)
+        {
+            auto itEnd = std::next(ret.begin(), _maxResults);
+            nextKey = itEnd->first;
+            ret.erase(itEnd, ret.end());
+        }
+        else if (endHash)
+        {
+            // The slot read past the page was deleted in the cache, the trie goes on after it
+            nextKey = h256(u256(endHash) + 1);
+        }
+    }
+#else
+    (void) _id;
+    (void) _beginHash;
+    (void) _maxResults;
+    BOOST_THROW_EXCEPTION(InterfaceNotSupported() << errinfo_interface("State::storage(Address const& _id, h256 const& _beginHash, size_t _maxResults)"));
+#endif
+    return {ret, nextKey};
+}
+
 h256 State::storageRoot(Address const& _id) const
 {
     string s = m_state.at(_id);
@@ -518,9 +655,15 @@ bytes const& State::code(Address const& _addr) const
 
     if (a->code().empty())
     {
-        // Load the code from the backend.
+        // Load the code from the backend, unless another state has already loaded it.
         Account* mutableAccount = const_cast<Account*>(a);
-        mutableAccount->noteCode(m_db.lookup(a->codeHash()));
+        CodeCache::Code code = CodeCache::instance().get(a->codeHash());
+        if (!code)
+        {
+            code = std::make_shared<bytes const>(asBytes(m_db.lookup(a->codeHash())));
+            CodeCache::instance().store(a->codeHash(), code);
+        }
+        mutableAccount->noteCode(std::move(code));
         CodeSizeCache::instance().store(a->codeHash(), a->code().size());
     }
 
@@ -750,15 +893,169 @@ std::ostream& dev::eth::operator<<(std::ostream& _out, State const& _s)
     return _out;
 }
 
+namespace
+{
+/// Write a storage overlay into a storage trie. The slot keys are hashed in one batch.
+template <class Trie>
+void updateStorageTrie(Trie& _storageDB, std::unordered_map<u256, u256> const& _overlay)
+{
+    std::vector<h256> keys;
+    std::vector<bytesConstRef> refs;
+    keys.reserve(_overlay.size());
+    refs.reserve(_overlay.size());
+    for (auto const& j: _overlay)
+    {
+        keys.emplace_back(j.first);
+        refs.push_back(keys.back().ref());
+    }
+    std::vector<h256> const hashes = sha3Batch(refs);
+
+    size_t k = 0;
+    for (auto const& j: _overlay)
+    {
+        if (j.second)
+            _storageDB.insertHashed(keys[k], hashes[k], rlp(j.second));
+        else
+            _storageDB.removeHashed(hashes[k]);
+        ++k;
+    }
+}
+
+/// Hashes of the addresses of the dirty accounts of @a _cache, in its iteration order.
+std::vector<h256> hashDirtyAddresses(AccountMap const& _cache)
+{
+    std::vector<bytesConstRef> refs;
+    for (auto const& i: _cache)
+        if (i.second.isDirty())
+            refs.push_back(i.first.ref());
+    return sha3Batch(refs);
+}
+
+/// Node database of a storage trie that is updated on a worker thread. Nodes are read from the
+/// state database, which is not written meanwhile, and the writes are logged to be replayed on it
+/// in the order of a serial commit, so that the reference counts of the nodes are the same.
+template <class DB>
+class StorageCommitDB
+{
+public:
+    explicit StorageCommitDB(DB const& _db): m_db(_db) {}
+
+    std::string lookup(h256 const& _h) const
+    {
+        std::string ret = m_written.lookup(_h);
+        return ret.empty() ? m_db.lookup(_h) : ret;
+    }
+    bool exists(h256 const& _h) const { return m_written.exists(_h) || m_db.exists(_h); }
+    void insert(h256 const& _h, bytesConstRef _v)
+    {
+        m_written.insert(_h, _v);
+        m_log.push_back({Write::Insert, _h, _v.toBytes()});
+    }
+    void kill(h256 const& _h)
+    {
+        m_written.kill(_h);
+        m_log.push_back({Write::Kill, _h, bytes()});
+    }
+    void insertAux(h256 const& _h, bytesConstRef _v) { m_log.push_back({Write::InsertAux, _h, _v.toBytes()}); }
+
+    void replay(DB& _db) const
+    {
+        for (auto const& w: m_log)
+        {
+            if (w.type == Write::Insert)
+                _db.insert(w.hash, &w.value);
+            else if (w.type == Write::Kill)
+                _db.kill(w.hash);
+            else
+                _db.insertAux(w.hash, &w.value);
+        }
+    }
+
+private:
+    struct Write
+    {
+        enum Type { Insert, Kill, InsertAux } type;
+        h256 hash;
+        bytes value;
+    };
+
+    DB const& m_db;
+    StateCacheDB m_written;
+    std::vector<Write> m_log;
+};
+
+/// The storage trie of an account, updated ahead of the serial part of commit.
+template <class DB>
+struct StorageCommit
+{
+    Account const* account = nullptr;
+    std::unique_ptr<StorageCommitDB<DB>> db;
+    h256 root;
+    bool done = false;
+};
+
+/// Update the storage tries of the dirty accounts of @a _cache on several threads when there are
+/// enough of them. The storage tries are independent, only the account trie needs them all.
+/// An account whose update fails is left to the serial commit, which reports the error.
+template <class DB>
+std::unordered_map<Address, StorageCommit<DB>> commitStorageParallel(AccountMap const& _cache, DB const& _db)
+{
+    std::unordered_map<Address, StorageCommit<DB>> ret;
+    std::vector<StorageCommit<DB>*> jobs;
+    for (auto const& i: _cache)
+        if (i.second.isDirty() && i.second.isAlive() && !i.second.storageOverlay().empty())
+        {
+            StorageCommit<DB>& job = ret[i.first];
+            job.account = &i.second;
+            jobs.push_back(&job);
+        }
+    unsigned const threads = std::min<unsigned>(std::thread::hardware_concurrency(), c_maxCommitThreads);
+    if (jobs.size() < c_parallelCommitMinAccounts || threads < 2)
+        return {};
+
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t j = next++; j < jobs.size(); j = next++)
+        {
+            StorageCommit<DB>& job = *jobs[j];
+            try
+            {
+                job.db = std::make_unique<StorageCommitDB<DB>>(_db);
+                SecureTrieDB<h256, StorageCommitDB<DB>> storageDB(job.db.get(), job.account->baseRoot());
+                updateStorageTrie(storageDB, job.account->storageOverlay());
+                job.root = storageDB.root();
+                job.done = true;
+            }
+            catch (...) {}
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < std::min<size_t>(threads, jobs.size()); ++t)
+        workers.emplace_back(work);
+    work();
+    for (std::thread& t: workers)
+        t.join();
+    return ret;
+}
+}
+
 template <class DB>
 AddressHash dev::eth::commit(AccountMap const& _cache, SecureTrieDB<Address, DB>& _state)
 {
     AddressHash ret;
+    std::vector<std::pair<Address, std::string>> written;
+    std::unordered_map<Address, StorageCommit<DB>> storage = commitStorageParallel(_cache, *_state.db());
+    std::vector<h256> const addressHashes = hashDirtyAddresses(_cache);
+    size_t dirty = 0;
     for (auto const& i: _cache)
         if (i.second.isDirty())
         {
+            h256 const& addressHash = addressHashes[dirty++];
             if (!i.second.isAlive())
-                _state.remove(i.first);
+            {
+                _state.removeHashed(addressHash);
+                written.emplace_back(i.first, std::string());
+            }
             else
             {
                 auto const version = i.second.version();
@@ -775,14 +1072,24 @@ AddressHash dev::eth::commit(AccountMap const& _cache, SecureTrieDB<Address, DB>
                 }
                 else
                 {
-                    SecureTrieDB<h256, DB> storageDB(_state.db(), i.second.baseRoot());
+                    h256 storageRoot;
+                    auto const done = storage.find(i.first);
+                    if (done != storage.end() && done->second.done)
+                    {
+                        done->second.db->replay(*_state.db());
+                        storageRoot = done->second.root;
+                    }
+                    else
+                    {
+                        SecureTrieDB<h256, DB> storageDB(_state.db(), i.second.baseRoot());
+                        updateStorageTrie(storageDB, i.second.storageOverlay());
+                        storageRoot = storageDB.root();
+                    }
+                    assert(storageRoot);
+                    s.append(storageRoot);
+                    // The written slots are known under the new storage root
                     for (auto const& j: i.second.storageOverlay())
-                        if (j.second)
-                            storageDB.insert(j.first, rlp(j.second));
-                        else
-                            storageDB.remove(j.first);
-                    assert(storageDB.root());
-                    s.append(storageDB.root());
+                        FlatStateCache::instance().storeStorage(storageRoot, j.first, j.second);
                 }
 
                 if (i.second.hasNewCode())
@@ -790,6 +1097,7 @@ AddressHash dev::eth::commit(AccountMap const& _cache, SecureTrieDB<Address, DB>
                     h256 ch = i.second.codeHash();
                     // Store the size of the code
                     CodeSizeCache::instance().store(ch, i.second.code().size());
+                    CodeCache::instance().store(ch, i.second.sharedCode());
                     _state.db()->insert(ch, &i.second.code());
                     s << ch;
                 }
@@ -799,10 +1107,16 @@ AddressHash dev::eth::commit(AccountMap const& _cache, SecureTrieDB<Address, DB>
                 if (version != 0)
                     s << i.second.version();
 
-                _state.insert(i.first, &s.out());
+                _state.insertHashed(i.first, addressHash, &s.out());
+                written.emplace_back(i.first, asString(s.out()));
             }
             ret.insert(i.first);
         }
+
+    // The written accounts are known under the new state root
+    h256 const root = _state.root();
+    for (auto const& i: written)
+        FlatStateCache::instance().storeAccount(root, i.first, i.second);
     return ret;
 }
 
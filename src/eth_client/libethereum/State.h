@@ -255,6 +255,12 @@ public:
     /// @returns map of hashed keys to key-value pairs or empty map if no account exists at that address.
     std::map<h256, std::pair<u256, u256>> storage(Address const& _contract) const;
 
+    /// Get at most @a _maxResults storage slots of an account, in the order of their hashed keys.
+    /// @returns map of hashed keys >= @a _beginHash to key-value pairs, and the hashed key of the
+    /// next slot, zero when there are no more.
+    std::pair<std::map<h256, std::pair<u256, u256>>, h256> storage(
+        Address const& _contract, h256 const& _beginHash, size_t _maxResults) const;
+
     /// Get the code of an account.
     /// @returns bytes() if no account exists at that address.
     /// @warning The reference to the code is only valid until the access to
@@ -290,6 +296,10 @@ public:
     /// @param _commitBehaviour whether or not to remove empty accounts during commit.
     void commit(CommitBehaviour _commitBehaviour);
 
+    /// Load the accounts, the code and the storage slots used before of @a _addresses into the
+    /// shared caches on several threads, ahead of executing transactions to them.
+    void prefetch(std::vector<Address> const& _addresses) const;
+
     /// Resets any uncommitted changes to the cache.
     void setRoot(h256 const& _root);
 
@@ -310,6 +320,12 @@ public:
 
     ChangeLog const& changeLog() const { return m_changeLog; }
 
+    /// Record every address looked up through account() into @p _accessed, nullptr disables it. // qtum
+    void setAccessedAddresses(AddressHash* _accessed) const { m_accessedAddresses = _accessed; }
+
+    /// @returns the RLP of the account as committed to the state trie, ignoring the cache. // qtum
+    std::string committedAccount(Address const& _addr) const { return m_state.at(_addr); }
+
     virtual ~State(){}
 
 protected:
@@ -353,10 +369,20 @@ protected:
 
     friend std::ostream& operator<<(std::ostream& _out, State const& _s);
     ChangeLog m_changeLog;
+
+    /// Optional sink for the addresses read through account(), not copied with the state. // qtum
+    mutable AddressHash* m_accessedAddresses = nullptr;
 };
 
 std::ostream& operator<<(std::ostream& _out, State const& _s);
 
+/// Minimum number of storage tries changed by a commit to update them on several threads.
+static const size_t c_parallelCommitMinAccounts = 8;
+/// Maximum number of threads that update the storage tries of a commit.
+static const unsigned c_maxCommitThreads = 8;
+/// Maximum number of threads that load the state of State::prefetch.
+static const unsigned c_maxPrefetchThreads = 8;
+
 template <class DB>
 AddressHash commit(AccountMap const& _cache, SecureTrieDB<Address, DB>& _state);
 
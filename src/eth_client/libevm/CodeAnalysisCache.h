@@ -0,0 +1,88 @@
+// Aleth: Ethereum C++ client, tools and libraries.
+// Copyright 2015-2019 Aleth Authors.
+// Licensed under the GNU General Public License, Version 3.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <evmc/evmc.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+namespace evmone
+{
+namespace baseline
+{
+class CodeAnalysis;
+}
+}
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Thread-safe cache of the evmone code analysis (padded code and JUMPDEST map) by code hash
+ * and revision, shared by all VM instances. The cache is bounded by the number of entries and by
+ * their estimated size, when it is full random elements are removed.
+ */
+class CodeAnalysisCache
+{
+public:
+	using Analysis = std::shared_ptr<evmone::baseline::CodeAnalysis const>;
+
+	void store(h256 const& _hash, evmc_revision _rev, Analysis _analysis, size_t _size)
+	{
+		if (_size > c_maxBytes)
+			return;
+		UniqueGuard g(x_cache);
+		auto const key = std::make_pair(_hash, _rev);
+		if (m_cache.count(key))
+			return;
+		while (m_cache.size() >= c_maxSize || m_bytes + _size > c_maxBytes)
+			removeRandomElement();
+		m_cache.emplace(key, std::make_pair(std::move(_analysis), _size));
+		m_bytes += _size;
+	}
+	/// @returns the analysis of the code, or null if it is not cached.
+	Analysis get(h256 const& _hash, evmc_revision _rev) const
+	{
+		UniqueGuard g(x_cache);
+		auto it = m_cache.find(std::make_pair(_hash, _rev));
+		return it == m_cache.end() ? nullptr : it->second.first;
+	}
+	/// @returns whether the code has been analyzed for any revision.
+	bool contains(h256 const& _hash) const
+	{
+		UniqueGuard g(x_cache);
+		auto it = m_cache.lower_bound(std::make_pair(_hash, EVMC_FRONTIER));
+		return it != m_cache.end() && it->first.first == _hash;
+	}
+
+	static CodeAnalysisCache& instance() { static CodeAnalysisCache cache; return cache; }
+
+private:
+	/// Removes a random element from the cache.
+	void removeRandomElement()
+	{
+		if (!m_cache.empty())
+		{
+			auto it = m_cache.lower_bound(std::make_pair(h256::random(), EVMC_FRONTIER));
+			if (it == m_cache.end())
+				it = m_cache.begin();
+			m_bytes -= it->second.second;
+			m_cache.erase(it);
+		}
+	}
+
+	static const size_t c_maxSize = 10000;
+	static const size_t c_maxBytes = 64 * 1024 * 1024;
+	mutable Mutex x_cache;
+	std::map<std::pair<h256, evmc_revision>, std::pair<Analysis, size_t>> m_cache;
+	size_t m_bytes = 0;
+};
+
+}
+}
@@ -4,8 +4,13 @@
 #include "EVMC.h"
 
 #include <libdevcore/Log.h>
+#include <libevm/CodeAnalysisCache.h>
 #include <libevm/VMFactory.h>
 
+#include <evmone/baseline.hpp>
+#include <evmone/execution_state.hpp>
+#include <evmone/vm.hpp>
+
 namespace dev
 {
 namespace eth
@@ -64,6 +69,38 @@ EVMC::EVMC(evmc_vm* _vm, std::vector<std::pair<std::string, std::string>> const&
     }
 }
 
+EVMC::~EVMC() = default;
+
+evmc::Result EVMC::executeAnalyzed(EvmCHost& _host, evmc_revision _rev, evmc_message const& _msg,
+    bytes const& _code, h256 const& _codeHash)
+{
+    // The "advanced" option replaces the baseline interpreter, which has its own analysis
+    evmc_vm const* vm = get_raw_pointer();
+    evmc_execute_fn const baseline = evmone::baseline::execute;
+    if (!_codeHash || vm->execute != baseline)
+        return execute(_host, _rev, _msg, _code.data(), _code.size());
+
+    auto& cache = CodeAnalysisCache::instance();
+    CodeAnalysisCache::Analysis analysis = cache.get(_codeHash, _rev);
+    if (!analysis)
+    {
+        analysis = std::make_shared<evmone::baseline::CodeAnalysis const>(
+            evmone::baseline::analyze(_rev, {_code.data(), _code.size()}));
+        // Padded code and JUMPDEST bitmap
+        cache.store(_codeHash, _rev, analysis,
+            sizeof(evmone::baseline::CodeAnalysis) + _code.size() + 33 + _code.size() / 8);
+    }
+
+    evmc::bytes_view const code{_code.data(), _code.size()};
+    if (m_state)
+        m_state->reset(_msg, _rev, evmc::Host::get_interface(), _host.to_context(), code);
+    else
+        m_state = std::make_unique<evmone::ExecutionState>(
+            _msg, _rev, evmc::Host::get_interface(), _host.to_context(), code);
+    return evmc::Result{evmone::baseline::execute(
+        *static_cast<evmone::VM const*>(vm), _msg.gas, *m_state, *analysis)};
+}
+
 owning_bytes_ref EVMC::exec(u256& io_gas, ExtVMFace& _ext, const OnOpFunc& _onOp)
 {
     assert(_ext.envInfo().number() >= 0);
@@ -88,7 +125,7 @@ owning_bytes_ref EVMC::exec(u256& io_gas, ExtVMFace& _ext, const OnOpFunc& _onOp
         toEvmC(_ext.caller), _ext.data.data(), _ext.data.size(), toEvmC(_ext.value),
         toEvmC(0x0_cppui256), toEvmC(_ext.myAddress)};
     EvmCHost host{_ext};
-    auto r = execute(host, mode, msg, _ext.code.data(), _ext.code.size());
+    auto r = executeAnalyzed(host, mode, msg, _ext.code, _ext.codeHash);
     // FIXME: Copy the output for now, but copyless version possible.
     auto output = owning_bytes_ref{{&r.output_data[0], &r.output_data[r.output_size]}, 0, r.output_size};
 
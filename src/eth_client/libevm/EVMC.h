@@ -5,10 +5,16 @@
 #pragma once
 
 #include <libevm/VMFace.h>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+namespace evmone
+{
+class ExecutionState;
+}
+
 namespace dev
 {
 namespace eth
@@ -18,8 +24,20 @@ class EVMC : public evmc::VM, public VMFace
 {
 public:
     EVMC(evmc_vm* _vm, std::vector<std::pair<std::string, std::string>> const& _options) noexcept;
+    ~EVMC();
 
     owning_bytes_ref exec(u256& io_gas, ExtVMFace& _ext, OnOpFunc const& _onOp) final;
+
+private:
+    /// Execute with the analysis of the code from the CodeAnalysisCache when the VM is the evmone
+    /// baseline interpreter, or let the VM analyze the code otherwise.
+    evmc::Result executeAnalyzed(EvmCHost& _host, evmc_revision _rev, evmc_message const& _msg,
+        bytes const& _code, h256 const& _codeHash);
+
+    /// The execution state of the baseline interpreter, reset for each call run by this VM.
+    /// The VMFactory pool hands a VM to one call frame at a time, so the memory and stack
+    /// buffers of the state are reused by the frames of one thread.
+    std::unique_ptr<evmone::ExecutionState> m_state;
 };
 }  // namespace eth
 }  // namespace dev
@@ -153,11 +153,17 @@ public:
     u256 const& gasUsed() const { return m_gasUsed; }
     u256 const& chainID() const { return m_chainID; }
 
+    /// Set @p _read when the VM reads the block context, nullptr disables it. Copies of the
+    /// environment made for nested calls share the flag. // qtum
+    void setBlockContextRead(bool* _read) { m_blockContextRead = _read; }
+    void noteBlockContextRead() const { if (m_blockContextRead) *m_blockContextRead = true; }
+
 private:
     BlockHeader m_headerInfo;
     LastBlockHashesFace const& m_lastHashes;
     u256 m_gasUsed;
     u256 m_chainID;
+    bool* m_blockContextRead = nullptr;
 };
 
 /// Represents a call result.
@@ -117,6 +117,32 @@ po::options_description vmProgramOptions(unsigned _lineLength)
 }
 
 
+namespace
+{
+/// The most VMs a thread keeps for reuse. A call frame holds a VM while it runs, so a thread
+/// needs as many as its deepest call; deeper frames get VMs that are destroyed after use.
+constexpr size_t c_maxPooledVMs = 64;
+
+/// The VMs released on this thread. There is a single VM kind, so any of them can be reused.
+thread_local std::vector<std::unique_ptr<VMFace>> t_vmPool;
+
+void releaseVM(VMFace* _vm) noexcept
+{
+    if (t_vmPool.size() < c_maxPooledVMs)
+    {
+        try
+        {
+            t_vmPool.emplace_back(_vm);
+            return;
+        }
+        catch (...)
+        {
+        }
+    }
+    delete _vm;
+}
+}  // namespace
+
 VMPtr VMFactory::create()
 {
     return create(g_kind);
@@ -124,14 +150,19 @@ VMPtr VMFactory::create()
 
 VMPtr VMFactory::create(VMKind _kind)
 {
-    static const auto default_delete = [](VMFace * _vm) noexcept { delete _vm; };
+    if (!t_vmPool.empty())
+    {
+        VMFace* vm = t_vmPool.back().release();
+        t_vmPool.pop_back();
+        return {vm, releaseVM};
+    }
 
     switch (_kind)
     {
     case VMKind::Evmone:
-        return {new EVMC{evmc_create_evmone(), s_evmcOptions}, default_delete};
+        return {new EVMC{evmc_create_evmone(), s_evmcOptions}, releaseVM};
     default:
-        return {new EVMC{evmc_create_evmone(), s_evmcOptions}, default_delete};
+        return {new EVMC{evmc_create_evmone(), s_evmcOptions}, releaseVM};
     }
 }
 }  // namespace eth
@@ -34,7 +34,8 @@ public:
     /// Creates a VM instance of the global kind (controlled by the --vm command line option).
     static VMPtr create();
 
-    /// Creates a VM instance of the kind provided.
+    /// Creates a VM instance of the kind provided. VMs released on a thread are kept in a pool
+    /// and reused by its next calls to create, instead of being destroyed.
     static VMPtr create(VMKind _kind);
 };
 }  // namespace eth
@@ -5,11 +5,56 @@
 
 #include <stdexcept>
 
+#include <compat/compat.h>
 #include <flatfile.h>
 #include <logging.h>
 #include <tinyformat.h>
 #include <util/fs_helpers.h>
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+MappedFlatFile::MappedFlatFile(const fs::path& path)
+{
+#ifndef WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            m_data = static_cast<const unsigned char*>(data);
+            m_size = st.st_size;
+        } else {
+            LogPrintf("Unable to map file %s\n", fs::PathToString(path));
+        }
+    }
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+#endif
+}
+
+MappedFlatFile::~MappedFlatFile()
+{
+#ifndef WIN32
+    if (m_data) {
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+    }
+#endif
+}
+
+Span<const unsigned char> MappedFlatFile::Read(size_t pos, size_t len) const
+{
+    if (!Covers(pos, len)) {
+        return {};
+    }
+    return {m_data + pos, len};
+}
+
 FlatFileSeq::FlatFileSeq(fs::path dir, const char* prefix, size_t chunk_size) :
     m_dir(std::move(dir)),
     m_prefix(prefix),
@@ -30,7 +75,7 @@ fs::path FlatFileSeq::FileName(const FlatFilePos& pos) const
     return m_dir / fs::u8path(strprintf("%s%05u.dat", m_prefix, pos.nFile));
 }
 
-FILE* FlatFileSeq::Open(const FlatFilePos& pos, bool read_only)
+FILE* FlatFileSeq::Open(const FlatFilePos& pos, bool read_only) const
 {
     if (pos.IsNull()) {
         return nullptr;
@@ -52,6 +97,18 @@ FILE* FlatFileSeq::Open(const FlatFilePos& pos, bool read_only)
     return file;
 }
 
+std::shared_ptr<const MappedFlatFile> FlatFileSeq::Map(const FlatFilePos& pos) const
+{
+    if (pos.IsNull()) {
+        return nullptr;
+    }
+    auto mapped = std::make_shared<const MappedFlatFile>(FileName(pos));
+    if (mapped->IsNull()) {
+        return nullptr;
+    }
+    return mapped;
+}
+
 size_t FlatFileSeq::Allocate(const FlatFilePos& pos, size_t add_size, bool& out_of_space)
 {
     out_of_space = false;
@@ -78,6 +135,91 @@ size_t FlatFileSeq::Allocate(const FlatFilePos& pos, size_t add_size, bool& out_
     return 0;
 }
 
+FlatFileWriter::FlatFileWriter(size_t buffer_size) :
+    m_buffer_size(buffer_size)
+{}
+
+FlatFileWriter::~FlatFileWriter()
+{
+    Close();
+}
+
+bool FlatFileWriter::WriteBuffer()
+{
+    AssertLockHeld(m_mutex);
+    if (m_buffer.empty()) {
+        return true;
+    }
+    const bool written{fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) == m_buffer.size() && fflush(m_file) == 0};
+    if (!written) {
+        LogPrintf("Unable to write %u bytes at position %u of %s\n", m_buffer.size(), m_pos.nPos, fs::PathToString(m_path));
+        // The position of the handle is unknown after a short write
+        CloseFile();
+        return false;
+    }
+    m_pos.nPos += m_buffer.size();
+    m_buffer.clear();
+    return true;
+}
+
+void FlatFileWriter::CloseFile()
+{
+    AssertLockHeld(m_mutex);
+    if (m_file) {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+    m_path.clear();
+    m_pos = FlatFilePos();
+    m_buffer.clear();
+}
+
+bool FlatFileWriter::Write(const FlatFileSeq& seq, const FlatFilePos& pos, Span<const unsigned char> data)
+{
+    LOCK(m_mutex);
+    const bool same_file{m_file && m_pos.nFile == pos.nFile && m_path == seq.FileName(pos)};
+    if (!same_file || m_pos.nPos + m_buffer.size() != pos.nPos) {
+        if (!WriteBuffer()) {
+            return false;
+        }
+        if (same_file && m_file && fseek(m_file, pos.nPos, SEEK_SET) == 0) {
+            m_pos = pos;
+        } else {
+            CloseFile();
+        }
+    }
+    if (!m_file) {
+        m_file = seq.Open(pos);
+        if (!m_file) {
+            return false;
+        }
+        m_path = seq.FileName(pos);
+        m_pos = pos;
+    }
+    m_buffer.insert(m_buffer.end(), data.begin(), data.end());
+    return m_buffer.size() < m_buffer_size || WriteBuffer();
+}
+
+bool FlatFileWriter::Flush(int file)
+{
+    LOCK(m_mutex);
+    if (!m_file || (file != -1 && m_pos.nFile != file)) {
+        return true;
+    }
+    return WriteBuffer();
+}
+
+bool FlatFileWriter::Close(int file)
+{
+    LOCK(m_mutex);
+    if (!m_file || (file != -1 && m_pos.nFile != file)) {
+        return true;
+    }
+    const bool written{WriteBuffer()};
+    CloseFile();
+    return written;
+}
+
 bool FlatFileSeq::Flush(const FlatFilePos& pos, bool finalize)
 {
     FILE* file = Open(FlatFilePos(pos.nFile, 0)); // Avoid fseek to nPos
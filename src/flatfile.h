@@ -6,9 +6,13 @@
 #ifndef BITCOIN_FLATFILE_H
 #define BITCOIN_FLATFILE_H
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <serialize.h>
+#include <span.h>
+#include <sync.h>
 #include <util/fs.h>
 
 struct FlatFilePos
@@ -38,6 +42,36 @@ struct FlatFilePos
     std::string ToString() const;
 };
 
+/**
+ * A read-only memory mapping of a whole flat file, as it was when it was mapped.
+ * Reads are served straight from the mapped pages without any syscall or copy.
+ */
+class MappedFlatFile
+{
+private:
+    const unsigned char* m_data{nullptr};
+    size_t m_size{0};
+
+public:
+    /** Map the file at path. IsNull() when it could not be mapped, or mapping is not supported. */
+    explicit MappedFlatFile(const fs::path& path);
+    ~MappedFlatFile();
+
+    MappedFlatFile(const MappedFlatFile&) = delete;
+    MappedFlatFile& operator=(const MappedFlatFile&) = delete;
+
+    bool IsNull() const { return m_data == nullptr; }
+
+    /** Size of the file when it was mapped. */
+    size_t size() const { return m_size; }
+
+    /** Whether the bytes [pos, pos + len) of the file are all mapped. */
+    bool Covers(size_t pos, size_t len) const { return m_data && pos <= m_size && len <= m_size - pos; }
+
+    /** The bytes [pos, pos + len) of the file. An empty span when they are not all mapped. */
+    Span<const unsigned char> Read(size_t pos, size_t len) const;
+};
+
 /**
  * FlatFileSeq represents a sequence of numbered files storing raw data. This class facilitates
  * access to and efficient management of these files.
@@ -63,7 +97,10 @@ public:
     fs::path FileName(const FlatFilePos& pos) const;
 
     /** Open a handle to the file at the given position. */
-    FILE* Open(const FlatFilePos& pos, bool read_only = false);
+    FILE* Open(const FlatFilePos& pos, bool read_only = false) const;
+
+    /** Map the file at the given position for reading. nullptr when it could not be mapped. */
+    std::shared_ptr<const MappedFlatFile> Map(const FlatFilePos& pos) const;
 
     /**
      * Allocate additional space in a file after the given starting position. The amount allocated
@@ -86,4 +123,43 @@ public:
     bool Flush(const FlatFilePos& pos, bool finalize = false);
 };
 
+/**
+ * Appends records to the files of a FlatFileSeq through one handle kept open, coalescing the
+ * records written one after the other into writes of up to buffer_size bytes. What is buffered
+ * is not visible to other handles of the file until it is written by Flush(), which must be
+ * called before the file is read, flushed to disk or removed.
+ */
+class FlatFileWriter
+{
+private:
+    const size_t m_buffer_size;
+
+    Mutex m_mutex;
+    FILE* m_file GUARDED_BY(m_mutex){nullptr};
+    fs::path m_path GUARDED_BY(m_mutex);
+    //! Position in the open file of the first buffered byte
+    FlatFilePos m_pos GUARDED_BY(m_mutex);
+    std::vector<unsigned char> m_buffer GUARDED_BY(m_mutex);
+
+    bool WriteBuffer() EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void CloseFile() EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+public:
+    /** @param buffer_size Records are written once that many bytes are buffered, 0 writes each record at once. */
+    explicit FlatFileWriter(size_t buffer_size);
+    ~FlatFileWriter();
+
+    FlatFileWriter(const FlatFileWriter&) = delete;
+    FlatFileWriter& operator=(const FlatFileWriter&) = delete;
+
+    /** Write data at pos of a file of seq. */
+    bool Write(const FlatFileSeq& seq, const FlatFilePos& pos, Span<const unsigned char> data) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Write what is buffered for the given file, or for any file when file is -1. */
+    bool Flush(int file = -1) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Write what is buffered and close the handle if it is on the given file, or on any file when file is -1. */
+    bool Close(int file = -1) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+
 #endif // BITCOIN_FLATFILE_H
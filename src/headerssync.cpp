@@ -3,12 +3,15 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <headerssync.h>
+#include <checkqueue.h>
 #include <logging.h>
 #include <pow.h>
 #include <timedata.h>
 #include <util/check.h>
 #include <util/vector.h>
 
+#include <algorithm>
+
 // The two Bitcoin constants are computed using the simulation script on
 // https://gist.github.com/sipa/016ae445c132cdf65a2791534dfb7ae1
 // The two Qtum constants below are computed using the simulation script on
@@ -27,6 +30,54 @@ constexpr size_t REDOWNLOAD_BUFFER_SIZE{741}; // 741/59 = ~12.6 commitments
 // 160 bytes for a CompressedHeader is for ARM Linux
 static_assert(sizeof(CompressedHeader) == 176 || sizeof(CompressedHeader) == 160);
 
+//! Number of headers hashed and checked by one HeadersCheck.
+constexpr size_t HEADERS_CHECK_BATCH{100};
+
+namespace {
+// Closure representing the checks of a range of headers, run by the headers sync workers
+class HeadersCheck
+{
+private:
+    const Consensus::Params* params{nullptr};
+    const CBlockHeader* headers{nullptr};
+    size_t from{0}, to{0};
+    int64_t prev_height{0};
+    uint32_t prev_bits{0};
+    HeaderCheckResult* results{nullptr};
+
+public:
+    HeadersCheck() = default;
+    HeadersCheck(const Consensus::Params* params_, const CBlockHeader* headers_, size_t from_, size_t to_, int64_t prev_height_, uint32_t prev_bits_, HeaderCheckResult* results_) :
+        params(params_), headers(headers_), from(from_), to(to_), prev_height(prev_height_), prev_bits(prev_bits_), results(results_) {}
+
+    bool operator()()
+    {
+        for (size_t i = from; i < to; ++i) {
+            const CBlockHeader& header = headers[i];
+            const uint32_t bits = i > 0 ? headers[i - 1].nBits : prev_bits;
+            HeaderCheckResult& result = results[i];
+            result.hash = header.GetHash();
+            result.work = GetBlockProof(CBlockIndex(header));
+            result.permitted_difficulty = PermittedDifficultyTransition(*params, prev_height + 1 + i, bits, header.nBits);
+        }
+        // The failures are reported by the sync state, at the height where they happen
+        return true;
+    }
+};
+
+CCheckQueue<HeadersCheck> headerscheckqueue(1);
+} // namespace
+
+void StartHeadersSyncWorkerThreads(int threads_num)
+{
+    headerscheckqueue.StartWorkerThreads(threads_num, "hdrsync");
+}
+
+void StopHeadersSyncWorkerThreads()
+{
+    headerscheckqueue.StopWorkerThreads();
+}
+
 HeadersSyncState::HeadersSyncState(NodeId id, const Consensus::Params& consensus_params,
         const CBlockIndex* chain_start, const arith_uint256& minimum_required_work) :
     m_commit_offset(GetRand<unsigned>(HEADER_COMMITMENT_PERIOD)),
@@ -124,8 +175,10 @@ HeadersSyncState::ProcessingResult HeadersSyncState::ProcessNextHeaders(const
         // gets big enough (meaning that we've checked enough commitments),
         // we'll return a batch of headers to the caller for processing.
         ret.success = true;
-        for (const auto& hdr : received_headers) {
-            if (!ValidateAndStoreRedownloadedHeader(hdr)) {
+        const uint32_t prev_bits{m_redownloaded_headers.empty() ? m_chain_start->nBits : m_redownloaded_headers.back().nBits};
+        const std::vector<HeaderCheckResult> checks{CheckHeaders(received_headers, m_redownload_buffer_last_height, prev_bits)};
+        for (size_t i = 0; i < received_headers.size(); ++i) {
+            if (!ValidateAndStoreRedownloadedHeader(received_headers[i], checks[i])) {
                 // Something went wrong -- the peer gave us an unexpected chain.
                 // We could consider looking at the reason for failure and
                 // punishing the peer, but for now just give up on sync.
@@ -180,8 +233,9 @@ bool HeadersSyncState::ValidateAndStoreHeadersCommitments(const std::vector<CBlo
 
     // If it does connect, (minimally) validate and occasionally store
     // commitments.
-    for (const auto& hdr : headers) {
-        if (!ValidateAndProcessSingleHeader(hdr)) {
+    const std::vector<HeaderCheckResult> checks{CheckHeaders(headers, m_current_height, m_last_header_received.nBits)};
+    for (size_t i = 0; i < headers.size(); ++i) {
+        if (!ValidateAndProcessSingleHeader(headers[i], checks[i])) {
             return false;
         }
     }
@@ -198,7 +252,7 @@ bool HeadersSyncState::ValidateAndStoreHeadersCommitments(const std::vector<CBlo
     return true;
 }
 
-bool HeadersSyncState::ValidateAndProcessSingleHeader(const CBlockHeader& current)
+bool HeadersSyncState::ValidateAndProcessSingleHeader(const CBlockHeader& current, const HeaderCheckResult& check)
 {
     Assume(m_download_state == State::PRESYNC);
     if (m_download_state != State::PRESYNC) return false;
@@ -210,15 +264,14 @@ bool HeadersSyncState::ValidateAndProcessSingleHeader(const CBlockHeader& curren
     // work chain if they compress the work into as few blocks as possible,
     // so don't let anyone give a chain that would violate the difficulty
     // adjustment maximum.
-    if (!PermittedDifficultyTransition(m_consensus_params, next_height,
-                m_last_header_received.nBits, current.nBits)) {
+    if (!check.permitted_difficulty) {
         LogPrint(BCLog::NET, "Initial headers sync aborted with peer=%d: invalid difficulty transition at height=%i (presync phase)\n", m_id, next_height);
         return false;
     }
 
     if (next_height % HEADER_COMMITMENT_PERIOD == m_commit_offset) {
         // Add a commitment.
-        m_header_commitments.push_back(m_hasher(current.GetHash()) & 1);
+        m_header_commitments.push_back(m_hasher(check.hash) & 1);
         if (m_header_commitments.size() > m_max_commitments) {
             // The peer's chain is too long; give up.
             // It's possible the chain grew since we started the sync; so
@@ -229,14 +282,14 @@ bool HeadersSyncState::ValidateAndProcessSingleHeader(const CBlockHeader& curren
         }
     }
 
-    m_current_chain_work += GetBlockProof(CBlockIndex(current));
+    m_current_chain_work += check.work;
     m_last_header_received = current;
     m_current_height = next_height;
 
     return true;
 }
 
-bool HeadersSyncState::ValidateAndStoreRedownloadedHeader(const CBlockHeader& header)
+bool HeadersSyncState::ValidateAndStoreRedownloadedHeader(const CBlockHeader& header, const HeaderCheckResult& check)
 {
     Assume(m_download_state == State::REDOWNLOAD);
     if (m_download_state != State::REDOWNLOAD) return false;
@@ -251,21 +304,13 @@ bool HeadersSyncState::ValidateAndStoreRedownloadedHeader(const CBlockHeader& he
     }
 
     // Check that the difficulty adjustments are within our tolerance:
-    uint32_t previous_nBits{0};
-    if (!m_redownloaded_headers.empty()) {
-        previous_nBits = m_redownloaded_headers.back().nBits;
-    } else {
-        previous_nBits = m_chain_start->nBits;
-    }
-
-    if (!PermittedDifficultyTransition(m_consensus_params, next_height,
-                previous_nBits, header.nBits)) {
+    if (!check.permitted_difficulty) {
         LogPrint(BCLog::NET, "Initial headers sync aborted with peer=%d: invalid difficulty transition at height=%i (redownload phase)\n", m_id, next_height);
         return false;
     }
 
     // Track work on the redownloaded chain
-    m_redownload_chain_work += GetBlockProof(CBlockIndex(header));
+    m_redownload_chain_work += check.work;
 
     if (m_redownload_chain_work >= m_minimum_required_work) {
         m_process_all_remaining_headers = true;
@@ -284,7 +329,7 @@ bool HeadersSyncState::ValidateAndStoreRedownloadedHeader(const CBlockHeader& he
             // we've run out of commitments.
             return false;
         }
-        bool commitment = m_hasher(header.GetHash()) & 1;
+        bool commitment = m_hasher(check.hash) & 1;
         bool expected_commitment = m_header_commitments.front();
         m_header_commitments.pop_front();
         if (commitment != expected_commitment) {
@@ -296,11 +341,30 @@ bool HeadersSyncState::ValidateAndStoreRedownloadedHeader(const CBlockHeader& he
     // Store this header for later processing.
     m_redownloaded_headers.push_back(header);
     m_redownload_buffer_last_height = next_height;
-    m_redownload_buffer_last_hash = header.GetHash();
+    m_redownload_buffer_last_hash = check.hash;
 
     return true;
 }
 
+std::vector<HeaderCheckResult> HeadersSyncState::CheckHeaders(const std::vector<CBlockHeader>& headers, int64_t prev_height, uint32_t prev_bits) const
+{
+    std::vector<HeaderCheckResult> results(headers.size());
+    std::vector<HeadersCheck> checks;
+    for (size_t from = 0; from < headers.size(); from += HEADERS_CHECK_BATCH) {
+        checks.emplace_back(&m_consensus_params, headers.data(), from, std::min(from + HEADERS_CHECK_BATCH, headers.size()),
+                            prev_height, prev_bits, results.data());
+    }
+
+    if (checks.size() > 1 && headerscheckqueue.HasThreads()) {
+        CCheckQueueControl<HeadersCheck> control(&headerscheckqueue);
+        control.Add(std::move(checks));
+        control.Wait();
+    } else {
+        for (HeadersCheck& check : checks) check();
+    }
+    return results;
+}
+
 std::vector<CBlockHeader> HeadersSyncState::PopHeadersReadyForAcceptance()
 {
     std::vector<CBlockHeader> ret;
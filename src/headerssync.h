@@ -17,6 +17,20 @@
 #include <deque>
 #include <vector>
 
+/** Start the worker threads that hash and check the batches of headers of the initial headers sync */
+void StartHeadersSyncWorkerThreads(int threads_num);
+/** Stop the worker threads of the initial headers sync */
+void StopHeadersSyncWorkerThreads();
+
+/** What the checks that do not depend on the sync state found about a received header */
+struct HeaderCheckResult {
+    uint256 hash;
+    //! Work of the header, as it is counted in the chain work
+    arith_uint256 work;
+    //! Whether the difficulty transition from the previous header is permitted
+    bool permitted_difficulty{false};
+};
+
 // A compressed CBlockHeader, which leaves out the prevhash
 struct CompressedHeader {
     // header
@@ -214,11 +228,15 @@ private:
     bool ValidateAndStoreHeadersCommitments(const std::vector<CBlockHeader>& headers);
 
     /** In PRESYNC, process and update state for a single header */
-    bool ValidateAndProcessSingleHeader(const CBlockHeader& current);
+    bool ValidateAndProcessSingleHeader(const CBlockHeader& current, const HeaderCheckResult& check);
 
     /** In REDOWNLOAD, check a header's commitment (if applicable) and add to
      * buffer for later processing */
-    bool ValidateAndStoreRedownloadedHeader(const CBlockHeader& header);
+    bool ValidateAndStoreRedownloadedHeader(const CBlockHeader& header, const HeaderCheckResult& check);
+
+    /** Hash the headers that follow the header at @p prev_height with bits @p prev_bits, and
+     *  check their difficulty transitions, on the worker threads when they are started */
+    std::vector<HeaderCheckResult> CheckHeaders(const std::vector<CBlockHeader>& headers, int64_t prev_height, uint32_t prev_bits) const;
 
     /** Return a set of headers that satisfy our proof-of-work threshold */
     std::vector<CBlockHeader> PopHeadersReadyForAcceptance();
@@ -6,21 +6,31 @@
 
 #include <crypto/hmac_sha256.h>
 #include <httpserver.h>
+#include <node/context.h>
+#include <node/interface_ui.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
+#include <scheduler.h>
+#include <sync.h>
+#include <util/allocstats.h>
 #include <util/strencodings.h>
+#include <util/metrics.h>
 #include <util/string.h>
 #include <util/system.h>
 #include <walletinitinterface.h>
 
 #include <algorithm>
 #include <iterator>
+#include <list>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include <boost/signals2/connection.hpp>
+
 /** WWW-Authenticate to present with 401 Unauthorized response */
 static const char* WWW_AUTH_HEADER_DATA = "Basic realm=\"jsonrpc\"";
 
@@ -94,6 +104,175 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     }
 }
 
+/** Part of the result was already sent, all that is left is to cut the reply short */
+static bool StreamErrorReply(HTTPRequest* req, const std::string& message)
+{
+    LogPrintf("RPC call failed after sending part of its result: %s\n", message);
+    req->ChunkEnd();
+    return false;
+}
+
+/** A long-poll call waiting for the chain tip to move, without a worker thread of its own */
+struct ParkedRPCRequest
+{
+    std::unique_ptr<HTTPRequest> req;
+    JSONRPCRequestLong jreq;
+    //! Set when the call has to reply now: deadline passed, client gone or shutdown
+    bool expired{false};
+};
+
+static Mutex g_parked_mutex;
+//! Calls waiting for the next tip update
+static std::list<ParkedRPCRequest> g_parked GUARDED_BY(g_parked_mutex);
+//! Calls to check again on the long-poll work queue
+static std::list<ParkedRPCRequest> g_parked_ready GUARDED_BY(g_parked_mutex);
+//! Bumped on each tip update, tells whether a call was checked against the current tip
+static uint64_t g_parked_tip_generation GUARDED_BY(g_parked_mutex){0};
+//! Number of work items draining g_parked_ready
+static int g_parked_drainers GUARDED_BY(g_parked_mutex){0};
+static bool g_parking_stopped GUARDED_BY(g_parked_mutex){false};
+//! Runs the sweeps that expire and ping parked calls
+static CScheduler* g_parked_scheduler GUARDED_BY(g_parked_mutex){nullptr};
+static boost::signals2::connection g_parked_tip_connection;
+
+/** Run the check of a parked call and send its reply if it is done. Returns false to keep waiting. */
+static bool ResumeParkedRequest(ParkedRPCRequest& parked)
+{
+    HTTPRequest* req = parked.req.get();
+    JSONRPCRequestLong& jreq = parked.jreq;
+    try {
+        std::optional<UniValue> result = jreq.pollCheck(parked.expired);
+        if (!result) {
+            if (!parked.expired) return false;
+            result = NullUniValue;
+        }
+        if (jreq.isLongPolling) {
+            jreq.PollReply(*result);
+        } else {
+            req->WriteHeader("Content-Type", "application/json");
+            req->WriteReply(HTTP_OK, JSONRPCReply(*result, NullUniValue, jreq.id));
+        }
+    } catch (const UniValue& objError) {
+        JSONErrorReply(req, objError, jreq.id);
+    } catch (const std::exception& e) {
+        JSONErrorReply(req, JSONRPCError(RPC_MISC_ERROR, e.what()), jreq.id);
+    }
+    return true;
+}
+
+static void DrainParkedRequests();
+static void SweepParkedRequests();
+
+/** Queue work items on the long-poll work queue, up to one per long-poll thread, to check the ready calls */
+static void ScheduleParkedRequests() EXCLUSIVE_LOCKS_REQUIRED(!g_parked_mutex)
+{
+    static const int max_drainers = std::max((int)gArgs.GetIntArg("-rpclongpollthreads", DEFAULT_HTTP_LONGPOLL_THREADS), 1);
+    LOCK(g_parked_mutex);
+    while (!g_parking_stopped && g_parked_drainers < max_drainers && g_parked_drainers < (int)g_parked_ready.size()) {
+        // The queue might be full, the next sweep tries again then
+        if (!QueueHTTPWork(HTTPWorkClass::LONG_POLL, DrainParkedRequests)) break;
+        ++g_parked_drainers;
+    }
+}
+
+/**
+ * Park a call until the tip moves past the one it was checked against, or queue it
+ * right away if it already did. Returns false once parking stopped, the caller has to
+ * reply then.
+ */
+static bool ParkRequest(std::list<ParkedRPCRequest>& item, uint64_t tip_generation) EXCLUSIVE_LOCKS_REQUIRED(!g_parked_mutex)
+{
+    {
+        LOCK(g_parked_mutex);
+        if (g_parking_stopped) return false;
+        if (tip_generation == g_parked_tip_generation) {
+            const auto& deadline{item.front().jreq.pollDeadline};
+            if (deadline && g_parked_scheduler) {
+                // Don't wait for the next periodic sweep to time out
+                const auto delta{std::chrono::ceil<std::chrono::milliseconds>(*deadline - SteadyClock::now())};
+                g_parked_scheduler->scheduleFromNow(SweepParkedRequests, std::max(delta, std::chrono::milliseconds::zero()));
+            }
+            g_parked.splice(g_parked.end(), item);
+            return true;
+        }
+        g_parked_ready.splice(g_parked_ready.end(), item);
+    }
+    ScheduleParkedRequests();
+    return true;
+}
+
+static void DrainParkedRequests()
+{
+    while (true) {
+        std::list<ParkedRPCRequest> item;
+        uint64_t tip_generation;
+        {
+            LOCK(g_parked_mutex);
+            if (g_parked_ready.empty()) {
+                --g_parked_drainers;
+                return;
+            }
+            item.splice(item.end(), g_parked_ready, g_parked_ready.begin());
+            tip_generation = g_parked_tip_generation;
+        }
+        if (ResumeParkedRequest(item.front())) continue;
+        if (!ParkRequest(item, tip_generation)) {
+            item.front().expired = true;
+            ResumeParkedRequest(item.front());
+        }
+    }
+}
+
+/** Called on each tip update, after RPCNotifyBlockChange updated latestblock */
+static void WakeParkedRequests()
+{
+    {
+        LOCK(g_parked_mutex);
+        ++g_parked_tip_generation;
+        g_parked_ready.splice(g_parked_ready.end(), g_parked);
+    }
+    ScheduleParkedRequests();
+}
+
+/** Expire calls whose deadline passed or whose client is gone, and ping the live long-poll connections */
+static void SweepParkedRequests()
+{
+    {
+        LOCK(g_parked_mutex);
+        const auto now{SteadyClock::now()};
+        for (auto it = g_parked.begin(); it != g_parked.end();) {
+            auto next{std::next(it)};
+            JSONRPCRequestLong& jreq = it->jreq;
+            if ((jreq.pollDeadline && *jreq.pollDeadline <= now) || (jreq.isLongPolling && !jreq.PollAlive())) {
+                it->expired = true;
+                g_parked_ready.splice(g_parked_ready.end(), g_parked, it);
+            } else if (jreq.isLongPolling) {
+                jreq.PollPing();
+            }
+            it = next;
+        }
+    }
+    ScheduleParkedRequests();
+}
+
+/** Reply to all parked calls, they won't be woken anymore */
+static void StopParkedRequests()
+{
+    g_parked_tip_connection.disconnect();
+    std::list<ParkedRPCRequest> parked;
+    {
+        LOCK(g_parked_mutex);
+        g_parking_stopped = true;
+        g_parked_scheduler = nullptr;
+        parked.splice(parked.end(), g_parked);
+        parked.splice(parked.end(), g_parked_ready);
+    }
+    for (ParkedRPCRequest& item : parked) {
+        item.expired = true;
+        ResumeParkedRequest(item);
+    }
+}
+
 //This function checks username and password against -rpcauth
 //entries from config file.
 static bool multiUserAuthorized(std::string strUserPass)
@@ -149,8 +328,30 @@ static bool RPCAuthorized(const std::string& strAuth, std::string& strAuthUserna
     return multiUserAuthorized(strUserPass);
 }
 
+/** Methods that can take long to compute, served by their own worker threads */
+static const std::set<std::string_view> HEAVY_RPC_METHODS{
+    "callcontract", "callcontractbatch", "dumptxoutset", "estimategas", "getaddressbalance", "getaddressdeltas",
+    "getaddresstxids", "getaddressutxos", "getblockstats", "getdelegationsforstaker", "gettxoutsetinfo",
+    "importdescriptors", "importmulti", "listcontracts", "qrc20listtransactions", "rescanblockchain",
+    "scanblocks", "scantxoutset", "searchlogs", "searchlogspage", "verifychain",
+};
+
+/** Methods that wait for new blocks, served by their own worker threads */
+static const std::set<std::string_view> LONG_POLL_RPC_METHODS{
+    "waitforblock", "waitforblockheight", "waitforlogs", "waitfornewblock",
+};
+
+/** The work queue a method is served by */
+static HTTPWorkClass JSONRPCMethodClass(std::string_view method)
+{
+    if (LONG_POLL_RPC_METHODS.count(method)) return HTTPWorkClass::LONG_POLL;
+    if (HEAVY_RPC_METHODS.count(method)) return HTTPWorkClass::HEAVY;
+    return HTTPWorkClass::LIGHT;
+}
+
 static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
 {
+    AllocScope alloc_scope{AllocTag::RPC};
     // JSONRPC handles only POST
     if (req->GetRequestMethod() != HTTPRequest::POST) {
         req->WriteReply(HTTP_BAD_METHOD, "JSONRPC server handles only POST requests");
@@ -204,15 +405,39 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
                 req->WriteReply(HTTP_FORBIDDEN);
                 return false;
             }
+            const uint64_t tip_generation = WITH_LOCK(g_parked_mutex, return g_parked_tip_generation);
             UniValue result = tableRPC.execute(jreq);
 
+            if (jreq.isParked) {
+                // The call is resumed on tip updates, the reply is sent from there
+                LogPrint(BCLog::HTTPPOLL, "Parked %s call\n", jreq.strMethod);
+                req->Detach([jreq, tip_generation](std::unique_ptr<HTTPRequest> owned) {
+                    std::list<ParkedRPCRequest> item;
+                    item.push_back({std::move(owned), jreq});
+                    if (!ParkRequest(item, tip_generation)) {
+                        item.front().expired = true;
+                        ResumeParkedRequest(item.front());
+                    }
+                });
+                return true;
+            }
+
             if (jreq.isLongPolling) {
                 jreq.PollReply(result);
                 return true;
             }
 
+            if (jreq.isStreaming) {
+                jreq.StreamEnd();
+                return true;
+            }
+
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            if (jreq.resultJSON) {
+                strReply = "{\"result\":" + *jreq.resultJSON + ",\"error\":null,\"id\":" + jreq.id.write() + "}\n";
+            } else {
+                strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            }
 
         // array of requests
         } else if (valRequest.isArray()) {
@@ -232,7 +457,22 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
                     }
                 }
             }
-            strReply = JSONRPCExecBatch(jreq, valRequest.get_array());
+            // Spread the calls over the idle worker threads of the queue the batch was classified
+            // to, which is the slowest queue of its methods
+            static const int batch_threads = std::max((int)gArgs.GetIntArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS), 1);
+            HTTPWorkClass work_class{HTTPWorkClass::LIGHT};
+            for (const UniValue& call : valRequest.getValues()) {
+                const UniValue& method{find_value(call, "method")};
+                if (!method.isStr()) continue;
+                const HTTPWorkClass method_class{JSONRPCMethodClass(method.get_str())};
+                if (method_class == HTTPWorkClass::LONG_POLL || (method_class == HTTPWorkClass::HEAVY && work_class == HTTPWorkClass::LIGHT)) {
+                    work_class = method_class;
+                }
+            }
+            const auto dispatch = [work_class](std::function<void()> work) {
+                return QueueHTTPWork(work_class, std::move(work), /*spare_only=*/true);
+            };
+            strReply = JSONRPCExecBatch(jreq, valRequest.get_array(), dispatch, batch_threads);
         }
         else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
@@ -240,15 +480,43 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
+        if (jreq.isStreaming) return StreamErrorReply(req, find_value(objError, "message").getValStr());
         JSONErrorReply(req, objError, jreq.id);
         return false;
     } catch (const std::exception& e) {
+        if (jreq.isStreaming) return StreamErrorReply(req, e.what());
         JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
         return false;
     }
     return true;
 }
 
+/**
+ * Select the work queue of a JSON-RPC request from the methods it calls. This runs on
+ * the event loop thread, so the body is only scanned for the "method" members instead
+ * of being parsed. A batch goes to the slowest queue of its methods.
+ */
+static HTTPWorkClass ClassifyJSONRPCRequest(HTTPRequest* req)
+{
+    static constexpr std::string_view METHOD_KEY{"\"method\""};
+    const std::string_view body{req->PeekBody()};
+    HTTPWorkClass work_class{HTTPWorkClass::LIGHT};
+    for (size_t pos = body.find(METHOD_KEY); pos != std::string_view::npos; pos = body.find(METHOD_KEY, pos)) {
+        pos = body.find_first_not_of(" \t\r\n", pos + METHOD_KEY.size());
+        if (pos == std::string_view::npos || body[pos] != ':') continue;
+        pos = body.find_first_not_of(" \t\r\n", pos + 1);
+        if (pos == std::string_view::npos || body[pos] != '"') continue;
+        const size_t end = body.find('"', pos + 1);
+        if (end == std::string_view::npos) break;
+        const std::string_view method{body.substr(pos + 1, end - pos - 1)};
+        pos = end + 1;
+        const HTTPWorkClass method_class{JSONRPCMethodClass(method)};
+        if (method_class == HTTPWorkClass::LONG_POLL) return method_class;
+        if (method_class == HTTPWorkClass::HEAVY) work_class = method_class;
+    }
+    return work_class;
+}
+
 static bool InitRPCAuthentication()
 {
     if (gArgs.GetArg("-rpcpassword", "") == "")
@@ -309,14 +577,22 @@ bool StartHTTPRPC(const std::any& context)
         return false;
 
     auto handle_rpc = [context](HTTPRequest* req, const std::string&) { return HTTPReq_JSONRPC(context, req); };
-    RegisterHTTPHandler("/", true, handle_rpc);
+    RegisterHTTPHandler("/", true, handle_rpc, ClassifyJSONRPCRequest);
     if (g_wallet_init_interface.HasWalletSupport()) {
-        RegisterHTTPHandler("/wallet/", false, handle_rpc);
+        RegisterHTTPHandler("/wallet/", false, handle_rpc, ClassifyJSONRPCRequest);
     }
     struct event_base* eventBase = EventBase();
     assert(eventBase);
     httpRPCTimerInterface = std::make_unique<HTTPRPCTimerInterface>(eventBase);
     RPCSetTimerInterface(httpRPCTimerInterface.get());
+
+    // Connected after RPCNotifyBlockChange, so parked calls see the new latestblock
+    g_parked_tip_connection = uiInterface.NotifyBlockTip_connect([](SynchronizationState, const CBlockIndex*) { WakeParkedRequests(); });
+    auto node_context = util::AnyPtr<node::NodeContext>(context);
+    if (node_context && node_context->scheduler) {
+        WITH_LOCK(g_parked_mutex, g_parked_scheduler = node_context->scheduler.get());
+        node_context->scheduler->scheduleEvery(SweepParkedRequests, std::chrono::seconds{1});
+    }
     return true;
 }
 
@@ -336,4 +612,40 @@ void StopHTTPRPC()
         RPCUnsetTimerInterface(httpRPCTimerInterface.get());
         httpRPCTimerInterface.reset();
     }
+    StopParkedRequests();
+}
+
+static bool HTTPReq_Metrics(HTTPRequest* req, const std::string&)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "Only GET is supported\n");
+        return false;
+    }
+    // The metrics take the RPC credentials, like the JSON-RPC server
+    std::pair<bool, std::string> authHeader = req->GetHeader("authorization");
+    std::string authUser;
+    if (!authHeader.first || !RPCAuthorized(authHeader.second, authUser)) {
+        if (authHeader.first) {
+            LogPrintf("ThreadRPCServer incorrect password attempt from %s\n", req->GetPeer().ToStringAddrPort());
+            UninterruptibleSleep(std::chrono::milliseconds{250});
+        }
+        req->WriteHeader("WWW-Authenticate", WWW_AUTH_HEADER_DATA);
+        req->WriteReply(HTTP_UNAUTHORIZED);
+        return false;
+    }
+    // Rendered from the atomic counters only, no lock of the node is taken
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, g_metrics.Format());
+    return true;
+}
+
+void StartHTTPMetrics()
+{
+    LogPrint(BCLog::HTTP, "Serving metrics at /metrics\n");
+    RegisterHTTPHandler("/metrics", true, HTTPReq_Metrics);
+}
+
+void StopHTTPMetrics()
+{
+    UnregisterHTTPHandler("/metrics", true);
 }
@@ -31,4 +31,12 @@ void InterruptREST();
  */
 void StopREST();
 
+/** Start serving the in-process metrics at /metrics, to clients with the RPC credentials.
+ * Precondition; HTTP has been started.
+ */
+void StartHTTPMetrics();
+/** Stop serving the in-process metrics.
+ */
+void StopHTTPMetrics();
+
 #endif // BITCOIN_HTTPRPC_H
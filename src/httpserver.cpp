@@ -23,6 +23,7 @@
 #include <util/threadnames.h>
 #include <util/translation.h>
 
+#include <array>
 #include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
@@ -59,6 +60,10 @@ public:
     void operator()() override
     {
         func(req.get(), path);
+        if (req->detachedOwner) {
+            HTTPRequestOwner owner{std::move(req->detachedOwner)};
+            owner(std::move(req));
+        }
     }
 
     std::unique_ptr<HTTPRequest> req;
@@ -68,6 +73,17 @@ private:
     HTTPRequestHandler func;
 };
 
+/** Work queued by other modules with QueueHTTPWork */
+class HTTPWorkFunction final : public HTTPClosure
+{
+public:
+    explicit HTTPWorkFunction(std::function<void()> _work) : work(std::move(_work)) {}
+    void operator()() override { work(); }
+
+private:
+    std::function<void()> work;
+};
+
 /** Simple work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
  */
@@ -79,6 +95,8 @@ private:
     std::condition_variable cond GUARDED_BY(cs);
     std::deque<std::unique_ptr<WorkItem>> queue GUARDED_BY(cs);
     bool running GUARDED_BY(cs){true};
+    //! Threads waiting for work
+    size_t idle GUARDED_BY(cs){0};
     const size_t maxDepth;
 
 public:
@@ -88,13 +106,16 @@ public:
     /** Precondition: worker threads have all stopped (they have been joined).
      */
     ~WorkQueue() = default;
-    /** Enqueue a work item */
-    bool Enqueue(WorkItem* item) EXCLUSIVE_LOCKS_REQUIRED(!cs)
+    /** Enqueue a work item. With spare_only, only if a thread is idle to run it right away. */
+    bool Enqueue(WorkItem* item, bool spare_only = false) EXCLUSIVE_LOCKS_REQUIRED(!cs)
     {
         LOCK(cs);
         if (!running || queue.size() >= maxDepth) {
             return false;
         }
+        if (spare_only && idle <= queue.size()) {
+            return false;
+        }
         queue.emplace_back(std::unique_ptr<WorkItem>(item));
         cond.notify_one();
         return true;
@@ -106,8 +127,11 @@ public:
             std::unique_ptr<WorkItem> i;
             {
                 WAIT_LOCK(cs, lock);
-                while (running && queue.empty())
+                while (running && queue.empty()) {
+                    ++idle;
                     cond.wait(lock);
+                    --idle;
+                }
                 if (!running && queue.empty())
                     break;
                 i = std::move(queue.front());
@@ -127,13 +151,14 @@ public:
 
 struct HTTPPathHandler
 {
-    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
-        prefix(_prefix), exactMatch(_exactMatch), handler(_handler)
+    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler, HTTPRequestClassifier _classifier):
+        prefix(_prefix), exactMatch(_exactMatch), handler(_handler), classifier(_classifier)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPRequestClassifier classifier;
 };
 
 /** HTTP module state */
@@ -144,8 +169,8 @@ static struct event_base* eventBase = nullptr;
 static struct evhttp* eventHTTP = nullptr;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
-//! Work queue for handling longer requests off the event loop thread
-static std::unique_ptr<WorkQueue<HTTPClosure>> g_work_queue{nullptr};
+//! Work queues for handling longer requests off the event loop thread, one per HTTPWorkClass
+static std::array<std::unique_ptr<WorkQueue<HTTPClosure>>, 3> g_work_queues;
 //! Handlers for (sub)paths
 static GlobalMutex g_httppathhandlers_mutex;
 static std::vector<HTTPPathHandler> pathHandlers GUARDED_BY(g_httppathhandlers_mutex);
@@ -329,9 +354,11 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        const HTTPWorkClass work_class{i->classifier ? i->classifier(hreq.get()) : HTTPWorkClass::LIGHT};
+        const auto& work_queue{g_work_queues.at(static_cast<size_t>(work_class))};
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
-        assert(g_work_queue);
-        if (g_work_queue->Enqueue(item.get())) {
+        assert(work_queue);
+        if (work_queue->Enqueue(item.get())) {
             item.release(); /* if true, queue took ownership */
         } else {
             LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
@@ -403,9 +430,9 @@ static bool HTTPBindAddresses(struct evhttp* http)
 }
 
 /** Simple wrapper to set thread name and run work queue */
-static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue, int worker_num)
+static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue, const char* name, int worker_num)
 {
-    util::ThreadRename(strprintf("httpworker.%i", worker_num));
+    util::ThreadRename(strprintf("%s.%i", name, worker_num));
     SetSyscallSandboxPolicy(SyscallSandboxPolicy::NET_HTTP_SERVER_WORKER);
     queue->Run();
 }
@@ -469,9 +496,11 @@ bool InitHTTPServer()
 
     LogPrint(BCLog::HTTP, "Initialized HTTP server\n");
     int workQueueDepth = std::max((long)gArgs.GetIntArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintfCategory(BCLog::HTTP, "creating work queue of depth %d\n", workQueueDepth);
+    LogPrintfCategory(BCLog::HTTP, "creating work queues of depth %d\n", workQueueDepth);
 
-    g_work_queue = std::make_unique<WorkQueue<HTTPClosure>>(workQueueDepth);
+    for (auto& work_queue : g_work_queues) {
+        work_queue = std::make_unique<WorkQueue<HTTPClosure>>(workQueueDepth);
+    }
     // transfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
     eventHTTP = http_ctr.release();
@@ -493,11 +522,22 @@ void StartHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Starting HTTP server\n");
     int rpcThreads = std::max((long)gArgs.GetIntArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintfCategory(BCLog::HTTP, "starting %d worker threads\n", rpcThreads);
+    int heavyThreads = std::max((long)gArgs.GetIntArg("-rpcheavythreads", DEFAULT_HTTP_HEAVY_THREADS), 1L);
+    int longPollThreads = std::max((long)gArgs.GetIntArg("-rpclongpollthreads", DEFAULT_HTTP_LONGPOLL_THREADS), 1L);
+    LogPrintfCategory(BCLog::HTTP, "starting %d worker threads, %d for heavy and %d for long-poll requests\n", rpcThreads, heavyThreads, longPollThreads);
     g_thread_http = std::thread(ThreadHTTP, eventBase);
 
-    for (int i = 0; i < rpcThreads; i++) {
-        g_thread_http_workers.emplace_back(HTTPWorkQueueRun, g_work_queue.get(), i);
+    const std::pair<HTTPWorkClass, int> work_threads[]{
+        {HTTPWorkClass::LIGHT, rpcThreads},
+        {HTTPWorkClass::HEAVY, heavyThreads},
+        {HTTPWorkClass::LONG_POLL, longPollThreads},
+    };
+    for (const auto& [work_class, threads] : work_threads) {
+        static constexpr const char* names[]{"httpworker", "httpheavy", "httplongpoll"};
+        const size_t index{static_cast<size_t>(work_class)};
+        for (int i = 0; i < threads; i++) {
+            g_thread_http_workers.emplace_back(HTTPWorkQueueRun, g_work_queues.at(index).get(), names[index], i);
+        }
     }
 }
 
@@ -508,15 +548,15 @@ void InterruptHTTPServer()
         // Reject requests on current connections
         evhttp_set_gencb(eventHTTP, http_reject_request_cb, nullptr);
     }
-    if (g_work_queue) {
-        g_work_queue->Interrupt();
+    for (auto& work_queue : g_work_queues) {
+        if (work_queue) work_queue->Interrupt();
     }
 }
 
 void StopHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Stopping HTTP server\n");
-    if (g_work_queue) {
+    if (g_work_queues[0]) {
         LogPrint(BCLog::HTTP, "Waiting for HTTP worker threads to exit\n");
         for (auto& thread : g_thread_http_workers) {
             thread.join();
@@ -550,10 +590,22 @@ void StopHTTPServer()
         event_base_free(eventBase);
         eventBase = nullptr;
     }
-    g_work_queue.reset();
+    for (auto& work_queue : g_work_queues) {
+        work_queue.reset();
+    }
     LogPrint(BCLog::HTTP, "Stopped HTTP server\n");
 }
 
+bool QueueHTTPWork(HTTPWorkClass work_class, std::function<void()> work, bool spare_only)
+{
+    const auto& work_queue{g_work_queues.at(static_cast<size_t>(work_class))};
+    if (!work_queue) return false;
+    auto item{std::make_unique<HTTPWorkFunction>(std::move(work))};
+    if (!work_queue->Enqueue(item.get(), spare_only)) return false;
+    item.release(); /* queue took ownership */
+    return true;
+}
+
 struct event_base* EventBase()
 {
     return eventBase;
@@ -662,6 +714,11 @@ bool HTTPRequest::isChunkMode() {
     return startedChunkTransfer;
 }
 
+void HTTPRequest::Detach(HTTPRequestOwner owner)
+{
+    detachedOwner = std::move(owner);
+}
+
 std::pair<bool, std::string> HTTPRequest::GetHeader(const std::string& hdr) const
 {
     const struct evkeyvalq* headers = evhttp_request_get_input_headers(req);
@@ -693,6 +750,18 @@ std::string HTTPRequest::ReadBody()
     return rv;
 }
 
+std::string_view HTTPRequest::PeekBody()
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return {};
+    size_t size = evbuffer_get_length(buf);
+    const char* data = (const char*)evbuffer_pullup(buf, size);
+    if (!data) // returns nullptr in case of empty buffer
+        return {};
+    return {data, size};
+}
+
 bool HTTPRequest::ReplySent() {
     return replySent;
 }
@@ -857,11 +926,11 @@ std::optional<std::string> GetQueryParameterFromUri(const char* uri, const std::
     return result;
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPRequestClassifier &classifier)
 {
     LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
     LOCK(g_httppathhandlers_mutex);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, classifier));
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
@@ -6,12 +6,16 @@
 #define BITCOIN_HTTPSERVER_H
 
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <mutex>
 #include <condition_variable>
 
 static const int DEFAULT_HTTP_THREADS=4;
+static const int DEFAULT_HTTP_HEAVY_THREADS=2;
+static const int DEFAULT_HTTP_LONGPOLL_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
@@ -37,16 +41,35 @@ void StopHTTPServer();
 /** Change logging level for libevent. */
 void UpdateHTTPServerLogging(bool enable);
 
+/** Class of a request, each class has its own work queue and worker threads
+ * so that requests of one class do not wait behind those of another.
+ */
+enum class HTTPWorkClass {
+    LIGHT,     //!< Default, -rpcthreads
+    HEAVY,     //!< Requests that can take long to compute, -rpcheavythreads
+    LONG_POLL, //!< Requests that wait for an event, -rpclongpollthreads
+};
+
 /** Handler for requests to a certain HTTP path */
 typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Takes over a request detached from the work item running its handler */
+typedef std::function<void(std::unique_ptr<HTTPRequest> req)> HTTPRequestOwner;
+/** Selects the work queue of a request, called on the event loop thread so it has to be cheap */
+typedef std::function<HTTPWorkClass(HTTPRequest* req)> HTTPRequestClassifier;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Requests run on the LIGHT work queue unless a classifier is given.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPRequestClassifier &classifier = nullptr);
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Run work on the worker threads of a work queue.
+ * Returns false if the queue is full or the HTTP server is not running. With spare_only,
+ * also if no worker thread is idle to take the work right away.
+ */
+bool QueueHTTPWork(HTTPWorkClass work_class, std::function<void()> work, bool spare_only = false);
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -62,6 +85,8 @@ private:
     bool replySent;
     bool startedChunkTransfer;
     bool connClosed;
+    HTTPRequestOwner detachedOwner;
+    friend class HTTPWorkItem;
 
     std::mutex cs;
     std::condition_variable closeCv;
@@ -85,6 +110,14 @@ public:
     bool isConnClosed();
     bool isChunkMode();
 
+    /**
+     * Hand the request over to owner once the handler returns, instead of the
+     * work item running the handler replying to and freeing it.
+     *
+     * @note owner has to reply to the request.
+     */
+    void Detach(HTTPRequestOwner owner);
+
     /** Get requested URI.
      */
     std::string GetURI() const;
@@ -122,6 +155,13 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * View of the request body, without consuming it.
+     *
+     * @note The view is invalidated by ReadBody.
+     */
+    std::string_view PeekBody();
+
     /**
      * Write output header.
      *
@@ -0,0 +1,518 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addressindex.h>
+
+#include <chainparams.h>
+#include <coins.h>
+#include <dbwrapper.h>
+#include <logging.h>
+#include <node/blockstorage.h>
+#include <script/standard.h>
+#include <txdb.h>
+#include <undo.h>
+#include <util/system.h>
+#include <util/time.h>
+#include <util/trace.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <optional>
+
+using node::ReadBlockFromDisk;
+using node::UndoReadFromDisk;
+
+/* The keys and values are those the address, spent and timestamp indexes had in the block tree
+ * database, where they were written during block connection.
+ */
+constexpr uint8_t DB_ADDRESSINDEX{'a'};
+constexpr uint8_t DB_ADDRESSUNSPENTINDEX{'u'};
+constexpr uint8_t DB_TIMESTAMPINDEX{'S'};
+constexpr uint8_t DB_BLOCKHASHINDEX{'z'};
+constexpr uint8_t DB_SPENTINDEX{'p'};
+constexpr uint8_t DB_ADDRESSBALANCE{'b'};
+constexpr uint8_t DB_ADDRESSBALANCE_BUILT{'v'};
+
+std::unique_ptr<AddressIndex> g_addressindex;
+
+namespace {
+
+/** Get the address type and the address hash, padded to 32 bytes, the output is indexed under */
+bool GetAddressKey(const COutPoint& outpoint, const CScript& script, int& type, uint256& hash)
+{
+    CTxDestination dest;
+    if (!ExtractDestination(outpoint, script, dest)) return false;
+    valtype bytesID(std::visit(DataVisitor(), dest));
+    if (bytesID.empty()) return false;
+
+    valtype addressBytes(32);
+    std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
+    type = dest.index();
+    hash = uint256(addressBytes);
+    return true;
+}
+
+/** The changes to the running totals of the addresses touched by the blocks appended or rewound */
+using BalanceChanges = std::map<std::pair<uint8_t, uint256>, AddressBalance>;
+
+} // namespace
+
+/** Access to the address index database (indexes/addressindex/) */
+class AddressIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool ReadAddressIndex(const uint256& address_hash, int type, std::vector<std::pair<CAddressIndexKey, CAmount>>& deltas, int start, int end, size_t limit);
+
+    bool ReadAddressUnspentIndex(std::vector<std::pair<uint256, int>> addresses, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspent);
+
+    bool ReadTimestampIndex(unsigned int high, unsigned int low, std::vector<std::pair<uint256, unsigned int>>& hashes);
+
+    bool ReadAddressBalance(const uint256& address_hash, int type, AddressBalance& balance);
+
+    //! Add the changes to the running totals. The last height is set to height for appended blocks,
+    //! and for rewound ones to the height of the latest change left at or below height.
+    bool WriteBalanceChanges(CDBBatch& batch, const BalanceChanges& changes, int height, bool rewind);
+
+    //! Build the running totals of all the addresses from the balance changes and unspent outputs
+    bool BuildAddressBalances();
+};
+
+AddressIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(gArgs.GetDataDirNet() / "indexes" / "addressindex", n_cache_size, f_memory, f_wipe)
+{}
+
+bool AddressIndex::DB::ReadAddressIndex(const uint256& address_hash, int type, std::vector<std::pair<CAddressIndexKey, CAmount>>& deltas, int start, int end, size_t limit)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    std::pair<uint8_t, CAddressIndexKey> key;
+    auto match = [&]() {
+        return pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX &&
+               key.second.type == (uint8_t)type && key.second.hashBytes == address_hash;
+    };
+
+    // The keys of an address are sorted by height, the scans seek straight to the first or the last
+    // height asked for so they only read the entries returned
+    if (limit == 0) {
+        if (start > 0) {
+            pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, address_hash, start)));
+        } else {
+            pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, address_hash)));
+        }
+
+        for (; match(); pcursor->Next()) {
+            if (end > 0 && key.second.blockHeight > end) {
+                break;
+            }
+            CAmount value;
+            if (!pcursor->GetValue(value)) {
+                return error("%s: failed to get address index value", __func__);
+            }
+            deltas.emplace_back(key.second, value);
+        }
+        return true;
+    }
+
+    // Read the latest entries backwards, from the last key before the height past the end
+    const int past_end = end > 0 && end < std::numeric_limits<int>::max() ? end + 1 : std::numeric_limits<int>::max();
+    pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, address_hash, past_end)));
+    if (pcursor->Valid()) {
+        pcursor->Prev();
+    } else {
+        pcursor->SeekToLast();
+    }
+
+    const size_t first = deltas.size();
+    for (; deltas.size() - first < limit && match(); pcursor->Prev()) {
+        if (start > 0 && key.second.blockHeight < start) {
+            break;
+        }
+        CAmount value;
+        if (!pcursor->GetValue(value)) {
+            return error("%s: failed to get address index value", __func__);
+        }
+        deltas.emplace_back(key.second, value);
+    }
+    std::reverse(deltas.begin() + first, deltas.end());
+
+    return true;
+}
+
+bool AddressIndex::DB::ReadAddressUnspentIndex(std::vector<std::pair<uint256, int>> addresses, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspent)
+{
+    // The keys start with the type and the address hash, after sorting the addresses the entries of
+    // the next address often follow those of the previous one and the cursor does not have to seek
+    std::sort(addresses.begin(), addresses.end(), [](const std::pair<uint256, int>& a, const std::pair<uint256, int>& b) {
+        if (a.second != b.second) return (uint8_t)a.second < (uint8_t)b.second;
+        return a.first < b.first;
+    });
+    addresses.erase(std::unique(addresses.begin(), addresses.end()), addresses.end());
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    for (const auto& [address_hash, type] : addresses) {
+        std::pair<uint8_t, CAddressUnspentKey> key;
+        auto match = [&]() {
+            return pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX &&
+                   key.second.type == (uint8_t)type && key.second.hashBytes == address_hash;
+        };
+        if (!match()) {
+            pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, address_hash)));
+        }
+
+        while (match()) {
+            CAddressUnspentValue value;
+            if (!pcursor->GetValue(value)) {
+                return error("%s: failed to get address unspent value", __func__);
+            }
+            unspent.emplace_back(key.second, value);
+            pcursor->Next();
+        }
+    }
+
+    return true;
+}
+
+bool AddressIndex::DB::ReadTimestampIndex(unsigned int high, unsigned int low, std::vector<std::pair<uint256, unsigned int>>& hashes)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
+
+    while (pcursor->Valid()) {
+        std::pair<uint8_t, CTimestampIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_TIMESTAMPINDEX || key.second.timestamp >= high) {
+            break;
+        }
+        hashes.emplace_back(key.second.blockHash, key.second.timestamp);
+        pcursor->Next();
+    }
+
+    return true;
+}
+
+bool AddressIndex::DB::ReadAddressBalance(const uint256& address_hash, int type, AddressBalance& balance)
+{
+    const auto key = std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, address_hash));
+    if (!Read(key, balance)) {
+        if (Exists(key)) {
+            return error("%s: failed to get address balance", __func__);
+        }
+        balance = AddressBalance{};
+    }
+    return true;
+}
+
+bool AddressIndex::DB::WriteBalanceChanges(CDBBatch& batch, const BalanceChanges& changes, int height, bool rewind)
+{
+    for (const auto& [address, change] : changes) {
+        const auto& [type, address_hash] = address;
+        AddressBalance balance;
+        if (!ReadAddressBalance(address_hash, type, balance)) return false;
+
+        balance.balance += change.balance;
+        balance.received += change.received;
+        balance.utxos += change.utxos;
+        if (!rewind) {
+            balance.last_height = height;
+        } else {
+            std::vector<std::pair<CAddressIndexKey, CAmount>> latest;
+            if (height > 0 && !ReadAddressIndex(address_hash, type, latest, 0, height, 1)) return false;
+            balance.last_height = latest.empty() ? 0 : latest.back().first.blockHeight;
+        }
+
+        const auto key = std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, address_hash));
+        if (balance.last_height == 0) {
+            // No change is left for the address
+            batch.Erase(key);
+        } else {
+            batch.Write(key, balance);
+        }
+    }
+    return true;
+}
+
+bool AddressIndex::DB::BuildAddressBalances()
+{
+    static constexpr size_t batch_size = 16 << 20;
+    CDBBatch batch(*this);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    // The entries of each address follow each other, its totals are written when the next address starts
+    std::optional<std::pair<uint8_t, uint256>> current;
+    AddressBalance balance;
+    auto write_balance = [&]() {
+        if (current) {
+            batch.Write(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(current->first, current->second)), balance);
+        }
+        if (batch.SizeEstimate() > batch_size) {
+            if (!WriteBatch(batch)) return false;
+            batch.Clear();
+        }
+        return true;
+    };
+
+    std::pair<uint8_t, CAddressIndexKey> key;
+    for (pcursor->Seek(DB_ADDRESSINDEX); pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX; pcursor->Next()) {
+        const std::pair<uint8_t, uint256> address{key.second.type, key.second.hashBytes};
+        if (address != current) {
+            if (!write_balance()) return false;
+            current = address;
+            balance = AddressBalance{};
+        }
+        CAmount value;
+        if (!pcursor->GetValue(value)) {
+            return error("%s: failed to get address index value", __func__);
+        }
+        balance.balance += value;
+        if (value > 0) balance.received += value;
+        balance.last_height = std::max(balance.last_height, key.second.blockHeight);
+    }
+    if (!write_balance() || !WriteBatch(batch)) return false;
+    batch.Clear();
+
+    // Count the unspent outputs now that the totals of every address with one are written
+    current.reset();
+    std::pair<uint8_t, CAddressUnspentKey> unspent_key;
+    for (pcursor->Seek(DB_ADDRESSUNSPENTINDEX); pcursor->Valid() && pcursor->GetKey(unspent_key) && unspent_key.first == DB_ADDRESSUNSPENTINDEX; pcursor->Next()) {
+        const std::pair<uint8_t, uint256> address{unspent_key.second.type, unspent_key.second.hashBytes};
+        if (address != current) {
+            if (!write_balance()) return false;
+            current = address;
+            if (!ReadAddressBalance(address.second, address.first, balance)) return false;
+            balance.utxos = 0;
+        }
+        ++balance.utxos;
+    }
+    if (!write_balance()) return false;
+
+    batch.Write(DB_ADDRESSBALANCE_BUILT, true);
+    return WriteBatch(batch);
+}
+
+AddressIndex::AddressIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory, bool f_wipe)
+    : BaseIndex(std::move(chain), "addressindex"), m_db(std::make_unique<AddressIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AddressIndex::~AddressIndex() = default;
+
+bool AddressIndex::CustomInit(const std::optional<interfaces::BlockKey>& block)
+{
+    // The running totals of the addresses were added to an existing index, build them once from its entries
+    if (!m_db->Exists(DB_ADDRESSBALANCE_BUILT)) {
+        if (block) {
+            LogPrintf("%s: Building the address balances of the index at height %d\n", GetName(), block->height);
+        }
+        if (!m_db->BuildAddressBalances()) {
+            return error("%s: Failed to build the address balances", __func__);
+        }
+    }
+    return true;
+}
+
+bool AddressIndex::CustomAppend(const interfaces::BlockInfo& block)
+{
+    // The outputs of the genesis block cannot be spent, they were never indexed
+    if (block.height == 0) return true;
+
+    assert(block.data);
+    const auto time_start{SteadyClock::now()};
+    const CBlockIndex* pindex = WITH_LOCK(cs_main, return m_chainstate->m_blockman.LookupBlockIndex(block.hash));
+    CBlockUndo block_undo;
+    if (!UndoReadFromDisk(block_undo, pindex)) {
+        return error("%s: Failed to read undo data of block %s", __func__, block.hash.ToString());
+    }
+
+    // The entries are written in the order of the block, an output spent in its own block is then erased
+    CDBBatch batch(*m_db);
+    BalanceChanges changes;
+    uint64_t entries = 0;
+    for (size_t i = 0; i < block.data->vtx.size(); ++i) {
+        const CTransaction& tx = *block.data->vtx[i];
+        const uint256& txid = tx.GetHash();
+
+        // The coinbase tx has no undo data since no former output is spent
+        if (i > 0) {
+            const CTxUndo& tx_undo = block_undo.vtxundo.at(i - 1);
+            for (size_t j = 0; j < tx.vin.size(); ++j) {
+                const COutPoint& prevout = tx.vin[j].prevout;
+                const Coin& coin = tx_undo.vprevout.at(j);
+                int type;
+                uint256 hash;
+                if (!GetAddressKey(prevout, coin.out.scriptPubKey, type, hash)) continue;
+
+                // record spending activity
+                batch.Write(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(type, hash, block.height, i, txid, j, true)), coin.out.nValue * -1);
+                // remove address from unspent index
+                batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, hash, prevout.hash, prevout.n)));
+                batch.Write(std::make_pair(DB_SPENTINDEX, CSpentIndexKey(prevout.hash, prevout.n)), CSpentIndexValue(txid, j, block.height, coin.out.nValue, type, hash));
+
+                AddressBalance& change = changes[{type, hash}];
+                change.balance -= coin.out.nValue;
+                change.utxos -= 1;
+                entries++;
+            }
+        }
+
+        for (size_t k = 0; k < tx.vout.size(); ++k) {
+            const CTxOut& out = tx.vout[k];
+            int type;
+            uint256 hash;
+            if (!GetAddressKey(COutPoint(txid, k), out.scriptPubKey, type, hash)) continue;
+
+            // record receiving activity
+            batch.Write(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(type, hash, block.height, i, txid, k, false)), out.nValue);
+            // record unspent output
+            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, hash, txid, k)), CAddressUnspentValue(out.nValue, out.scriptPubKey, block.height, tx.IsCoinStake()));
+
+            AddressBalance& change = changes[{type, hash}];
+            change.balance += out.nValue;
+            change.received += out.nValue;
+            change.utxos += 1;
+            entries++;
+        }
+    }
+
+    // The logical timestamp is the block time, made greater than that of the previous block
+    unsigned int logical_ts = block.data->nTime;
+    CTimestampBlockIndexValue prev_logical_ts;
+    if (block.prev_hash && !m_db->Read(std::make_pair(DB_BLOCKHASHINDEX, CTimestampBlockIndexKey(*block.prev_hash)), prev_logical_ts)) {
+        LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
+    }
+    if (logical_ts <= prev_logical_ts.ltimestamp) {
+        logical_ts = prev_logical_ts.ltimestamp + 1;
+        LogPrint(BCLog::INDEX, "%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, block.data->nTime, prev_logical_ts.ltimestamp, logical_ts);
+    }
+    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexKey(logical_ts, block.hash)), 0);
+    batch.Write(std::make_pair(DB_BLOCKHASHINDEX, CTimestampBlockIndexKey(block.hash)), CTimestampBlockIndexValue(logical_ts));
+
+    bool written = m_db->WriteBalanceChanges(batch, changes, block.height, /*rewind=*/false) && m_db->WriteBatch(batch);
+    TRACE4(qtum, address_index_written,
+        block.hash.data(),
+        block.height,
+        entries,
+        Ticks<std::chrono::microseconds>(SteadyClock::now() - time_start)
+    );
+    return written;
+}
+
+bool AddressIndex::CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip)
+{
+    assert(current_tip.height >= new_tip.height);
+
+    std::vector<const CBlockIndex*> disconnected;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* iter_tip{m_chainstate->m_blockman.LookupBlockIndex(current_tip.hash)};
+        const CBlockIndex* new_tip_index{m_chainstate->m_blockman.LookupBlockIndex(new_tip.hash)};
+        for (; iter_tip && iter_tip != new_tip_index; iter_tip = iter_tip->pprev) {
+            disconnected.push_back(iter_tip);
+        }
+    }
+
+    // The blocks are undone from the top and their transactions in reverse order. The timestamp
+    // entries are kept, the lookups by timestamp can filter out the blocks of other chains.
+    CDBBatch batch(*m_db);
+    BalanceChanges changes;
+    const Consensus::Params& consensus_params = Params().GetConsensus();
+    for (const CBlockIndex* pindex : disconnected) {
+        if (pindex->nHeight == 0) continue;
+
+        CBlock block;
+        CBlockUndo block_undo;
+        if (!ReadBlockFromDisk(block, pindex, consensus_params) || !UndoReadFromDisk(block_undo, pindex)) {
+            return error("%s: Failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        }
+
+        for (size_t i = block.vtx.size(); i-- > 0;) {
+            const CTransaction& tx = *block.vtx[i];
+            const uint256& txid = tx.GetHash();
+
+            for (size_t k = tx.vout.size(); k-- > 0;) {
+                int type;
+                uint256 hash;
+                if (!GetAddressKey(COutPoint(txid, k), tx.vout[k].scriptPubKey, type, hash)) continue;
+
+                // undo receiving activity
+                batch.Erase(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(type, hash, pindex->nHeight, i, txid, k, false)));
+                // undo unspent index
+                batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, hash, txid, k)));
+
+                AddressBalance& change = changes[{type, hash}];
+                change.balance -= tx.vout[k].nValue;
+                change.received -= tx.vout[k].nValue;
+                change.utxos -= 1;
+            }
+
+            if (i == 0) continue;
+            const CTxUndo& tx_undo = block_undo.vtxundo.at(i - 1);
+            for (size_t j = tx.vin.size(); j-- > 0;) {
+                const COutPoint& prevout = tx.vin[j].prevout;
+                const Coin& coin = tx_undo.vprevout.at(j);
+                int type;
+                uint256 hash;
+                if (!GetAddressKey(prevout, coin.out.scriptPubKey, type, hash)) continue;
+
+                // undo spending activity
+                batch.Erase(std::make_pair(DB_ADDRESSINDEX, CAddressIndexKey(type, hash, pindex->nHeight, i, txid, j, true)));
+                // restore unspent index
+                batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, hash, prevout.hash, prevout.n)), CAddressUnspentValue(coin.out.nValue, coin.out.scriptPubKey, coin.nHeight, coin.fCoinStake));
+                batch.Erase(std::make_pair(DB_SPENTINDEX, CSpentIndexKey(prevout.hash, prevout.n)));
+
+                AddressBalance& change = changes[{type, hash}];
+                change.balance += coin.out.nValue;
+                change.utxos += 1;
+            }
+        }
+    }
+
+    return m_db->WriteBalanceChanges(batch, changes, new_tip.height, /*rewind=*/true) && m_db->WriteBatch(batch);
+}
+
+BaseIndex::DB& AddressIndex::GetDB() const { return *m_db; }
+
+bool AddressIndex::FindAddressDeltas(const uint256& address_hash, int type, std::vector<std::pair<CAddressIndexKey, CAmount>>& deltas, int start, int end, size_t limit) const
+{
+    return m_db->ReadAddressIndex(address_hash, type, deltas, start, end, limit);
+}
+
+bool AddressIndex::FindAddressBalance(const uint256& address_hash, int type, AddressBalance& balance) const
+{
+    return m_db->ReadAddressBalance(address_hash, type, balance);
+}
+
+bool AddressIndex::FindAddressUnspent(const uint256& address_hash, int type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspent) const
+{
+    return m_db->ReadAddressUnspentIndex({{address_hash, type}}, unspent);
+}
+
+bool AddressIndex::FindAddressUnspent(std::vector<std::pair<uint256, int>> addresses, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspent) const
+{
+    return m_db->ReadAddressUnspentIndex(std::move(addresses), unspent);
+}
+
+bool AddressIndex::FindSpentInfo(const CSpentIndexKey& key, CSpentIndexValue& value) const
+{
+    return m_db->Read(std::make_pair(DB_SPENTINDEX, key), value);
+}
+
+bool AddressIndex::FindBlocksByTimestamp(unsigned int high, unsigned int low, bool active_only, std::vector<std::pair<uint256, unsigned int>>& hashes) const
+{
+    std::vector<std::pair<uint256, unsigned int>> found;
+    if (!m_db->ReadTimestampIndex(high, low, found)) return false;
+
+    if (!active_only) {
+        hashes.insert(hashes.end(), found.begin(), found.end());
+        return true;
+    }
+    LOCK(cs_main);
+    for (const auto& entry : found) {
+        const CBlockIndex* pindex = m_chainstate->m_blockman.LookupBlockIndex(entry.first);
+        if (pindex && m_chainstate->m_chain.Contains(pindex)) {
+            hashes.push_back(entry);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_ADDRESSINDEX_H
+#define BITCOIN_INDEX_ADDRESSINDEX_H
+
+#include <consensus/amount.h>
+#include <index/base.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <utility>
+#include <vector>
+
+struct CAddressIndexKey;
+struct CAddressUnspentKey;
+struct CAddressUnspentValue;
+struct CSpentIndexKey;
+struct CSpentIndexValue;
+
+/** The running totals of an address, kept up to date with its balance changes */
+struct AddressBalance {
+    CAmount balance{0};
+    //! Sum of the outputs received, including change
+    CAmount received{0};
+    int64_t utxos{0};
+    //! Height of the latest block that changed the balance
+    int last_height{0};
+
+    SERIALIZE_METHODS(AddressBalance, obj) { READWRITE(obj.balance, obj.received, obj.utxos, obj.last_height); }
+};
+
+/**
+ * AddressIndex maintains the indexes of the block explorer RPCs, enabled with -addrindex:
+ * - the balance changes of each address, by height, transaction and input or output,
+ * - the balance, received total and unspent output count of each address,
+ * - the unspent outputs of each address,
+ * - the spending input of each spent output,
+ * - the blocks by logical timestamp, which is the block time made strictly increasing.
+ *
+ * The outputs spent by each block are read from its undo data, so the index is built in the
+ * background like the other indexes instead of during block connection.
+ */
+class AddressIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    bool AllowPrune() const override { return false; }
+
+protected:
+    bool CustomInit(const std::optional<interfaces::BlockKey>& block) override;
+
+    bool CustomAppend(const interfaces::BlockInfo& block) override;
+
+    bool CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddressIndex() override;
+
+    /// Look up the balance changes of an address in height order, from the height start and up to
+    /// the height end when they are set. With a limit, only the latest limit changes are returned.
+    bool FindAddressDeltas(const uint256& address_hash, int type, std::vector<std::pair<CAddressIndexKey, CAmount>>& deltas,
+                           int start = 0, int end = 0, size_t limit = 0) const;
+
+    /// Look up the running totals of an address, which are zero for an address never used.
+    bool FindAddressBalance(const uint256& address_hash, int type, AddressBalance& balance) const;
+
+    /// Look up the unspent outputs of an address.
+    bool FindAddressUnspent(const uint256& address_hash, int type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspent) const;
+
+    /// Look up the unspent outputs of many (address hash, type) in one pass over the index, in key order.
+    bool FindAddressUnspent(std::vector<std::pair<uint256, int>> addresses, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspent) const;
+
+    /// Look up the input that spent an output.
+    bool FindSpentInfo(const CSpentIndexKey& key, CSpentIndexValue& value) const;
+
+    /// Look up the blocks with a logical timestamp in [low, high), optionally only those of the active chain.
+    bool FindBlocksByTimestamp(unsigned int high, unsigned int low, bool active_only, std::vector<std::pair<uint256, unsigned int>>& hashes) const;
+};
+
+/// The global address index, used by the address, spent and timestamp RPCs. May be null.
+extern std::unique_ptr<AddressIndex> g_addressindex;
+
+#endif // BITCOIN_INDEX_ADDRESSINDEX_H
@@ -20,8 +20,17 @@
 #include <validation.h> // For g_chainman
 #include <warnings.h>
 
+#include <algorithm>
+#include <any>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 using node::ReadBlockFromDisk;
 
@@ -138,6 +147,99 @@ bool BaseIndex::Init()
     return true;
 }
 
+namespace {
+/**
+ * Blocks read from disk and prepared for an index on worker threads, handed back in the order they
+ * were added. Used by the sync thread of indices that allow it, see BaseIndex::AllowParallelPrepare.
+ */
+class PrepareQueue
+{
+public:
+    struct Job {
+        const CBlockIndex* pindex;
+        CBlock block;
+        std::any prepared;
+        bool done{false};
+        bool read{false};
+        bool ok{false};
+    };
+
+    using Prepare = std::function<bool(const interfaces::BlockInfo&, std::any&)>;
+
+    PrepareQueue(int threads_num, Prepare prepare) : m_prepare(std::move(prepare))
+    {
+        for (int n = 0; n < threads_num; ++n) {
+            m_threads.emplace_back([this, n]() {
+                util::TraceThread(strprintf("idxprep.%i", n), [this] { ThreadPrepare(); });
+            });
+        }
+    }
+
+    ~PrepareQueue()
+    {
+        WITH_LOCK(m_mutex, m_stop = true);
+        m_work_cv.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    void Add(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        auto job = std::make_shared<Job>();
+        job->pindex = pindex;
+        WITH_LOCK(m_mutex, m_jobs.push_back(std::move(job)));
+        m_work_cv.notify_one();
+    }
+
+    size_t Size() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex) { return WITH_LOCK(m_mutex, return m_jobs.size()); }
+
+    /** Wait for the oldest block to be prepared and take it */
+    std::shared_ptr<Job> TakeFront() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        m_done_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_jobs.front()->done; });
+        std::shared_ptr<Job> job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        --m_next;
+        return job;
+    }
+
+private:
+    void ThreadPrepare() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        const Consensus::Params& consensus_params = Params().GetConsensus();
+        while (true) {
+            std::shared_ptr<Job> job;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_work_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || m_next < m_jobs.size(); });
+                if (m_stop) return;
+                job = m_jobs[m_next++];
+            }
+
+            job->read = ReadBlockFromDisk(job->block, job->pindex, consensus_params);
+            if (job->read) {
+                interfaces::BlockInfo block_info = kernel::MakeBlockInfo(job->pindex, &job->block);
+                job->ok = m_prepare(block_info, job->prepared);
+            }
+            WITH_LOCK(m_mutex, job->done = true);
+            m_done_cv.notify_all();
+        }
+    }
+
+    const Prepare m_prepare;
+    mutable Mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_done_cv;
+    //! Blocks in chain order, those before m_next are taken by the workers
+    std::deque<std::shared_ptr<Job>> m_jobs GUARDED_BY(m_mutex);
+    size_t m_next GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+};
+} // namespace
+
 static const CBlockIndex* NextSyncBlock(const CBlockIndex* pindex_prev, CChain& chain) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(cs_main);
@@ -163,6 +265,31 @@ void BaseIndex::ThreadSync()
 
         std::chrono::steady_clock::time_point last_log_time{0s};
         std::chrono::steady_clock::time_point last_locator_write_time{0s};
+        auto note_progress = [&]() {
+            auto current_time{std::chrono::steady_clock::now()};
+            if (last_log_time + SYNC_LOG_INTERVAL < current_time) {
+                LogPrintf("Syncing %s with block chain from height %d\n",
+                          GetName(), pindex->nHeight);
+                last_log_time = current_time;
+            }
+
+            if (last_locator_write_time + SYNC_LOCATOR_WRITE_INTERVAL < current_time) {
+                SetBestBlockIndex(pindex->pprev);
+                last_locator_write_time = current_time;
+                // No need to handle errors in Commit. See rationale above.
+                Commit();
+            }
+        };
+
+        // The blocks ahead of the index are read and prepared on worker threads, then appended here in chain order
+        std::optional<PrepareQueue> queue;
+        const int threads_num{std::clamp<int>(gArgs.GetIntArg("-indexthreads", DEFAULT_INDEX_THREADS), 0, MAX_INDEX_THREADS)};
+        if (AllowParallelPrepare() && threads_num > 0) {
+            queue.emplace(threads_num, [this](const interfaces::BlockInfo& block, std::any& prepared) { return CustomPrepare(block, prepared); });
+        }
+        const size_t max_queued = size_t(threads_num) * INDEX_PREPARE_BLOCKS_PER_THREAD;
+        const CBlockIndex* last_queued = pindex;
+
         while (true) {
             if (m_interrupt) {
                 SetBestBlockIndex(pindex);
@@ -173,6 +300,35 @@ void BaseIndex::ThreadSync()
                 return;
             }
 
+            if (queue) {
+                // A reorganization or the end of the chain stops the queueing, the blocks queued are appended
+                // first and the sequential steps below take over
+                while (queue->Size() < max_queued) {
+                    LOCK(cs_main);
+                    const CBlockIndex* pindex_next = NextSyncBlock(last_queued, m_chainstate->m_chain);
+                    if (!pindex_next || pindex_next->pprev != last_queued) break;
+                    queue->Add(pindex_next);
+                    last_queued = pindex_next;
+                }
+                if (queue->Size() > 0) {
+                    std::shared_ptr<PrepareQueue::Job> job = queue->TakeFront();
+                    pindex = job->pindex;
+                    note_progress();
+                    if (!job->read) {
+                        FatalError("%s: Failed to read block %s from disk",
+                                   __func__, pindex->GetBlockHash().ToString());
+                        return;
+                    }
+                    interfaces::BlockInfo block_info = kernel::MakeBlockInfo(pindex, &job->block);
+                    if (!job->ok || !CustomAppendPrepared(block_info, job->prepared)) {
+                        FatalError("%s: Failed to write block %s to index database",
+                                   __func__, pindex->GetBlockHash().ToString());
+                        return;
+                    }
+                    continue;
+                }
+            }
+
             {
                 LOCK(cs_main);
                 const CBlockIndex* pindex_next = NextSyncBlock(pindex, m_chainstate->m_chain);
@@ -189,21 +345,10 @@ void BaseIndex::ThreadSync()
                     return;
                 }
                 pindex = pindex_next;
+                last_queued = pindex;
             }
 
-            auto current_time{std::chrono::steady_clock::now()};
-            if (last_log_time + SYNC_LOG_INTERVAL < current_time) {
-                LogPrintf("Syncing %s with block chain from height %d\n",
-                          GetName(), pindex->nHeight);
-                last_log_time = current_time;
-            }
-
-            if (last_locator_write_time + SYNC_LOCATOR_WRITE_INTERVAL < current_time) {
-                SetBestBlockIndex(pindex->pprev);
-                last_locator_write_time = current_time;
-                // No need to handle errors in Commit. See rationale above.
-                Commit();
-            }
+            note_progress();
 
             CBlock block;
             interfaces::BlockInfo block_info = kernel::MakeBlockInfo(pindex);
@@ -419,7 +564,9 @@ IndexSummary BaseIndex::GetSummary() const
     IndexSummary summary{};
     summary.name = GetName();
     summary.synced = m_synced;
-    summary.best_block_height = m_best_block_index ? m_best_block_index.load()->nHeight : 0;
+    const CBlockIndex* best_block_index = m_best_block_index.load();
+    summary.best_block_height = best_block_index ? best_block_index->nHeight : 0;
+    summary.best_block_hash = best_block_index ? best_block_index->GetBlockHash() : uint256();
     return summary;
 }
 
@@ -10,6 +10,7 @@
 #include <util/threadinterrupt.h>
 #include <validationinterface.h>
 
+#include <any>
 #include <string>
 
 class CBlock;
@@ -19,10 +20,17 @@ namespace interfaces {
 class Chain;
 } // namespace interfaces
 
+/** Number of threads preparing the blocks of an index that can prepare them in parallel while it syncs */
+static constexpr int DEFAULT_INDEX_THREADS{4};
+static constexpr int MAX_INDEX_THREADS{16};
+/** Number of blocks read ahead for each of these threads */
+static constexpr int INDEX_PREPARE_BLOCKS_PER_THREAD{8};
+
 struct IndexSummary {
     std::string name;
     bool synced{false};
     int best_block_height{0};
+    uint256 best_block_hash;
 };
 
 /**
@@ -109,6 +117,18 @@ protected:
     /// Write update index entries for a newly connected block.
     [[nodiscard]] virtual bool CustomAppend(const interfaces::BlockInfo& block) { return true; }
 
+    /// Whether the index splits CustomAppend into CustomPrepare and CustomAppendPrepared. While the
+    /// index syncs, the blocks ahead of it are then read and prepared on -indexthreads threads, and
+    /// only written on the sync thread, in chain order.
+    virtual bool AllowParallelPrepare() const { return false; }
+
+    /// Compute what the index writes for a block, from the block alone. Runs for several blocks at once
+    /// and must not read or change the state of the index.
+    [[nodiscard]] virtual bool CustomPrepare(const interfaces::BlockInfo& block, std::any& prepared) const { return true; }
+
+    /// Write the entries prepared by CustomPrepare for the next block of the index.
+    [[nodiscard]] virtual bool CustomAppendPrepared(const interfaces::BlockInfo& block, std::any& prepared) { return CustomAppend(block); }
+
     /// Virtual method called internally by Commit that can be overridden to atomically
     /// commit more index state.
     virtual bool CustomCommit(CDBBatch& batch) { return true; }
@@ -7,7 +7,9 @@
 #include <dbwrapper.h>
 #include <hash.h>
 #include <index/blockfilterindex.h>
+#include <libethcore/LogEntry.h>
 #include <node/blockstorage.h>
+#include <util/convert.h>
 #include <util/fs_helpers.h>
 #include <util/system.h>
 #include <validation.h>
@@ -215,9 +217,14 @@ size_t BlockFilterIndex::WriteFilterToDisk(FlatFilePos& pos, const BlockFilter&
 }
 
 bool BlockFilterIndex::CustomAppend(const interfaces::BlockInfo& block)
+{
+    std::any prepared;
+    return CustomPrepare(block, prepared) && CustomAppendPrepared(block, prepared);
+}
+
+bool BlockFilterIndex::CustomPrepare(const interfaces::BlockInfo& block, std::any& prepared) const
 {
     CBlockUndo block_undo;
-    uint256 prev_header;
 
     if (block.height > 0) {
         // pindex variable gives indexing code access to node internals. It
@@ -226,7 +233,43 @@ bool BlockFilterIndex::CustomAppend(const interfaces::BlockInfo& block)
         if (!UndoReadFromDisk(block_undo, pindex)) {
             return false;
         }
+    }
+
+    if (m_filter_type != BlockFilterType::CONTRACT) {
+        prepared = BlockFilter(m_filter_type, *Assert(block.data), block_undo);
+        return true;
+    }
+
+    GCSFilter::ElementSet contract_elements;
+    {
+        // The receipts storage is shared with block connection and the RPC, which use it under cs_main
+        LOCK(cs_main);
+        for (const auto& tx : block.data->vtx) {
+            if (!tx->HasCreateOrCall()) continue;
+            for (const TransactionReceiptInfo& receipt : pstorageresult->getResult(uintToh256(tx->GetHash()))) {
+                // A transaction that was reorganized into another block has receipts for both
+                if (receipt.blockHash != block.hash) continue;
+                if (receipt.contractAddress) {
+                    contract_elements.emplace(receipt.contractAddress.begin(), receipt.contractAddress.end());
+                }
+                for (const dev::eth::LogEntry& log : receipt.logs) {
+                    contract_elements.emplace(log.address.begin(), log.address.end());
+                    for (const dev::h256& topic : log.topics) {
+                        contract_elements.emplace(topic.begin(), topic.end());
+                    }
+                }
+            }
+        }
+    }
+    prepared = BlockFilter(m_filter_type, *Assert(block.data), block_undo, contract_elements);
+    return true;
+}
 
+bool BlockFilterIndex::CustomAppendPrepared(const interfaces::BlockInfo& block, std::any& prepared)
+{
+    uint256 prev_header;
+
+    if (block.height > 0) {
         std::pair<uint256, DBVal> read_out;
         if (!m_db->Read(DBHeightKey(block.height - 1), read_out)) {
             return false;
@@ -241,7 +284,7 @@ bool BlockFilterIndex::CustomAppend(const interfaces::BlockInfo& block)
         prev_header = read_out.second.header;
     }
 
-    BlockFilter filter(m_filter_type, *Assert(block.data), block_undo);
+    const BlockFilter& filter = std::any_cast<const BlockFilter&>(prepared);
 
     size_t bytes_written = WriteFilterToDisk(m_next_filter_pos, filter);
     if (bytes_written == 0) return false;
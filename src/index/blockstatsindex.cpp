@@ -0,0 +1,122 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/blockstatsindex.h>
+
+#include <chain.h>
+#include <dbwrapper.h>
+#include <node/blockstorage.h>
+#include <rpc/blockchain.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+using node::UndoReadFromDisk;
+
+/* The index database stores for each block of the chain its hash and statistics.
+ *
+ * Keys have the type [DB_BLOCK_HEIGHT, uint32 (BE)], so that the blocks of a range are
+ * read in sequence. The entries of the blocks disconnected in a reorg are removed, and
+ * the hash of an entry is checked against the block it is looked up for.
+ */
+constexpr uint8_t DB_BLOCK_HEIGHT{'t'};
+
+std::unique_ptr<BlockStatsIndex> g_block_stats_index;
+
+namespace {
+
+struct DBHeightKey {
+    int height;
+
+    explicit DBHeightKey(int height_in) : height(height_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_BLOCK_HEIGHT);
+        ser_writedata32be(s, height);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint8_t prefix{ser_readdata8(s)};
+        if (prefix != DB_BLOCK_HEIGHT) {
+            throw std::ios_base::failure("Invalid format for block stats index DB height key");
+        }
+        height = ser_readdata32be(s);
+    }
+};
+
+struct DBVal {
+    uint256 hash;
+    BlockStatistics stats;
+
+    SERIALIZE_METHODS(DBVal, obj) { READWRITE(obj.hash, obj.stats); }
+};
+
+} // namespace
+
+/** Access to the block stats index database (indexes/blockstatsindex/) */
+class BlockStatsIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+BlockStatsIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(gArgs.GetDataDirNet() / "indexes" / "blockstatsindex", n_cache_size, f_memory, f_wipe)
+{}
+
+BlockStatsIndex::BlockStatsIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory, bool f_wipe)
+    : BaseIndex(std::move(chain), "blockstatsindex"), m_db(std::make_unique<BlockStatsIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+BlockStatsIndex::~BlockStatsIndex() = default;
+
+bool BlockStatsIndex::CustomAppend(const interfaces::BlockInfo& block)
+{
+    std::any prepared;
+    return CustomPrepare(block, prepared) && CustomAppendPrepared(block, prepared);
+}
+
+bool BlockStatsIndex::CustomPrepare(const interfaces::BlockInfo& block, std::any& prepared) const
+{
+    assert(block.data);
+    const CBlockIndex* pindex = WITH_LOCK(cs_main, return m_chainstate->m_blockman.LookupBlockIndex(block.hash));
+    CBlockUndo block_undo;
+    // The genesis block has no undo data, since it spends no coins
+    if (block.height > 0 && !UndoReadFromDisk(block_undo, pindex)) {
+        return error("%s: Failed to read undo data of block %s", __func__, block.hash.ToString());
+    }
+    prepared = ComputeBlockStatistics(*block.data, block_undo, *pindex);
+    return true;
+}
+
+bool BlockStatsIndex::CustomAppendPrepared(const interfaces::BlockInfo& block, std::any& prepared)
+{
+    return m_db->Write(DBHeightKey(block.height), DBVal{block.hash, std::any_cast<BlockStatistics&>(prepared)});
+}
+
+bool BlockStatsIndex::CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip)
+{
+    assert(current_tip.height >= new_tip.height);
+
+    CDBBatch batch(*m_db);
+    for (int height = new_tip.height + 1; height <= current_tip.height; ++height) {
+        batch.Erase(DBHeightKey(height));
+    }
+    return m_db->WriteBatch(batch);
+}
+
+BaseIndex::DB& BlockStatsIndex::GetDB() const { return *m_db; }
+
+std::optional<BlockStatistics> BlockStatsIndex::LookUpStats(const CBlockIndex& block_index) const
+{
+    DBVal entry;
+    if (!m_db->Read(DBHeightKey(block_index.nHeight), entry) || entry.hash != block_index.GetBlockHash()) {
+        return std::nullopt;
+    }
+    return entry.stats;
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_BLOCKSTATSINDEX_H
+#define BITCOIN_INDEX_BLOCKSTATSINDEX_H
+
+#include <index/base.h>
+
+#include <optional>
+
+class CBlockIndex;
+struct BlockStatistics;
+
+static constexpr bool DEFAULT_BLOCKSTATSINDEX{false};
+
+/**
+ * BlockStatsIndex stores the statistics of each block reported by getblockstats, so that
+ * they are read from the index instead of computed from the block and its undo data.
+ */
+class BlockStatsIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    bool AllowPrune() const override { return true; }
+
+protected:
+    bool CustomAppend(const interfaces::BlockInfo& block) override;
+
+    bool AllowParallelPrepare() const override { return true; }
+
+    /** Compute the statistics of the block from the block and its undo data */
+    bool CustomPrepare(const interfaces::BlockInfo& block, std::any& prepared) const override;
+
+    bool CustomAppendPrepared(const interfaces::BlockInfo& block, std::any& prepared) override;
+
+    bool CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit BlockStatsIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~BlockStatsIndex() override;
+
+    /** Look up the statistics of a block, if the index has it in the chain of @p block_index */
+    std::optional<BlockStatistics> LookUpStats(const CBlockIndex& block_index) const;
+};
+
+/// The global block stats index. May be null.
+extern std::unique_ptr<BlockStatsIndex> g_block_stats_index;
+
+#endif // BITCOIN_INDEX_BLOCKSTATSINDEX_H
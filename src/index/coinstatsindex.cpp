@@ -101,6 +101,22 @@ struct DBHashKey {
     }
 };
 
+/** The changes of a block to the statistics, computed from the block alone */
+struct BlockStats {
+    MuHash3072 muhash;
+    uint64_t outputs_added{0};
+    uint64_t outputs_spent{0};
+    uint64_t bogo_size_added{0};
+    uint64_t bogo_size_spent{0};
+    CAmount amount_added{0};
+    CAmount prevout_spent_amount{0};
+    CAmount new_outputs_ex_coinbase_amount{0};
+    CAmount coinbase_amount{0};
+    CAmount unspendables_genesis_block{0};
+    CAmount unspendables_bip30{0};
+    CAmount unspendables_scripts{0};
+};
+
 }; // namespace
 
 std::unique_ptr<CoinStatsIndex> g_coin_stats_index;
@@ -116,12 +132,18 @@ CoinStatsIndex::CoinStatsIndex(std::unique_ptr<interfaces::Chain> chain, size_t
 
 bool CoinStatsIndex::CustomAppend(const interfaces::BlockInfo& block)
 {
-    CBlockUndo block_undo;
+    std::any prepared;
+    return CustomPrepare(block, prepared) && CustomAppendPrepared(block, prepared);
+}
+
+bool CoinStatsIndex::CustomPrepare(const interfaces::BlockInfo& block, std::any& prepared) const
+{
+    BlockStats stats;
     const CAmount block_subsidy{GetBlockSubsidy(block.height, Params().GetConsensus())};
-    m_total_subsidy += block_subsidy;
 
     // Ignore genesis block
     if (block.height > 0) {
+        CBlockUndo block_undo;
         // pindex variable gives indexing code access to node internals. It
         // will be removed in upcoming commit
         const CBlockIndex* pindex = WITH_LOCK(cs_main, return m_chainstate->m_blockman.LookupBlockIndex(block.hash));
@@ -129,22 +151,6 @@ bool CoinStatsIndex::CustomAppend(const interfaces::BlockInfo& block)
             return false;
         }
 
-        std::pair<uint256, DBVal> read_out;
-        if (!m_db->Read(DBHeightKey(block.height - 1), read_out)) {
-            return false;
-        }
-
-        uint256 expected_block_hash{*Assert(block.prev_hash)};
-        if (read_out.first != expected_block_hash) {
-            LogPrintf("WARNING: previous block header belongs to unexpected block %s; expected %s\n",
-                      read_out.first.ToString(), expected_block_hash.ToString());
-
-            if (!m_db->Read(DBHashKey(expected_block_hash), read_out)) {
-                return error("%s: previous block header not found; expected %s",
-                             __func__, expected_block_hash.ToString());
-            }
-        }
-
         // Add the new utxos created from the block
         assert(block.data);
         for (size_t i = 0; i < block.data->vtx.size(); ++i) {
@@ -152,8 +158,7 @@ bool CoinStatsIndex::CustomAppend(const interfaces::BlockInfo& block)
 
             // Skip duplicate txid coinbase transactions (BIP30).
             if (IsBIP30Unspendable(*pindex) && tx->IsCoinBase()) {
-                m_total_unspendable_amount += block_subsidy;
-                m_total_unspendables_bip30 += block_subsidy;
+                stats.unspendables_bip30 += block_subsidy;
                 continue;
             }
 
@@ -164,22 +169,21 @@ bool CoinStatsIndex::CustomAppend(const interfaces::BlockInfo& block)
 
                 // Skip unspendable coins
                 if (coin.out.scriptPubKey.IsUnspendable()) {
-                    m_total_unspendable_amount += coin.out.nValue;
-                    m_total_unspendables_scripts += coin.out.nValue;
+                    stats.unspendables_scripts += coin.out.nValue;
                     continue;
                 }
 
-                m_muhash.Insert(MakeUCharSpan(TxOutSer(outpoint, coin)));
+                stats.muhash.Insert(MakeUCharSpan(TxOutSer(outpoint, coin)));
 
                 if (tx->IsCoinBase()) {
-                    m_total_coinbase_amount += coin.out.nValue;
+                    stats.coinbase_amount += coin.out.nValue;
                 } else {
-                    m_total_new_outputs_ex_coinbase_amount += coin.out.nValue;
+                    stats.new_outputs_ex_coinbase_amount += coin.out.nValue;
                 }
 
-                ++m_transaction_output_count;
-                m_total_amount += coin.out.nValue;
-                m_bogo_size += GetBogoSize(coin.out.scriptPubKey);
+                ++stats.outputs_added;
+                stats.amount_added += coin.out.nValue;
+                stats.bogo_size_added += GetBogoSize(coin.out.scriptPubKey);
             }
 
             // The coinbase tx has no undo data since no former output is spent
@@ -190,22 +194,63 @@ bool CoinStatsIndex::CustomAppend(const interfaces::BlockInfo& block)
                     Coin coin{tx_undo.vprevout[j]};
                     COutPoint outpoint{tx->vin[j].prevout.hash, tx->vin[j].prevout.n};
 
-                    m_muhash.Remove(MakeUCharSpan(TxOutSer(outpoint, coin)));
+                    stats.muhash.Remove(MakeUCharSpan(TxOutSer(outpoint, coin)));
 
-                    m_total_prevout_spent_amount += coin.out.nValue;
+                    stats.prevout_spent_amount += coin.out.nValue;
 
-                    --m_transaction_output_count;
-                    m_total_amount -= coin.out.nValue;
-                    m_bogo_size -= GetBogoSize(coin.out.scriptPubKey);
+                    ++stats.outputs_spent;
+                    stats.bogo_size_spent += GetBogoSize(coin.out.scriptPubKey);
                 }
             }
         }
     } else {
         // genesis block
-        m_total_unspendable_amount += block_subsidy;
-        m_total_unspendables_genesis_block += block_subsidy;
+        stats.unspendables_genesis_block += block_subsidy;
     }
 
+    prepared = std::move(stats);
+    return true;
+}
+
+bool CoinStatsIndex::CustomAppendPrepared(const interfaces::BlockInfo& block, std::any& prepared)
+{
+    const CAmount block_subsidy{GetBlockSubsidy(block.height, Params().GetConsensus())};
+    m_total_subsidy += block_subsidy;
+
+    if (block.height > 0) {
+        std::pair<uint256, DBVal> read_out;
+        if (!m_db->Read(DBHeightKey(block.height - 1), read_out)) {
+            return false;
+        }
+
+        uint256 expected_block_hash{*Assert(block.prev_hash)};
+        if (read_out.first != expected_block_hash) {
+            LogPrintf("WARNING: previous block header belongs to unexpected block %s; expected %s\n",
+                      read_out.first.ToString(), expected_block_hash.ToString());
+
+            if (!m_db->Read(DBHashKey(expected_block_hash), read_out)) {
+                return error("%s: previous block header not found; expected %s",
+                             __func__, expected_block_hash.ToString());
+            }
+        }
+    }
+
+    // The set hash of the block is combined with the running one, as if its coins were inserted and removed here
+    const BlockStats& stats = std::any_cast<const BlockStats&>(prepared);
+    m_muhash *= stats.muhash;
+    m_transaction_output_count += stats.outputs_added;
+    m_transaction_output_count -= stats.outputs_spent;
+    m_bogo_size += stats.bogo_size_added;
+    m_bogo_size -= stats.bogo_size_spent;
+    m_total_amount += stats.amount_added - stats.prevout_spent_amount;
+    m_total_prevout_spent_amount += stats.prevout_spent_amount;
+    m_total_new_outputs_ex_coinbase_amount += stats.new_outputs_ex_coinbase_amount;
+    m_total_coinbase_amount += stats.coinbase_amount;
+    m_total_unspendable_amount += stats.unspendables_genesis_block + stats.unspendables_bip30 + stats.unspendables_scripts;
+    m_total_unspendables_genesis_block += stats.unspendables_genesis_block;
+    m_total_unspendables_bip30 += stats.unspendables_bip30;
+    m_total_unspendables_scripts += stats.unspendables_scripts;
+
     // If spent prevouts + block subsidy are still a higher amount than
     // new outputs + coinbase + current unspendable amount this means
     // the miner did not claim the full block reward. Unclaimed block
@@ -49,6 +49,13 @@ protected:
 
     bool CustomAppend(const interfaces::BlockInfo& block) override;
 
+    bool AllowParallelPrepare() const override { return true; }
+
+    /** Hash the coins created and spent by the block into a set hash of its own */
+    bool CustomPrepare(const interfaces::BlockInfo& block, std::any& prepared) const override;
+
+    bool CustomAppendPrepared(const interfaces::BlockInfo& block, std::any& prepared) override;
+
     bool CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip) override;
 
     BaseIndex::DB& GetDB() const override { return *m_db; }
@@ -0,0 +1,246 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/delegationindex.h>
+
+#include <dbwrapper.h>
+#include <libethcore/LogEntry.h>
+#include <logging.h>
+#include <qtum/qtumdelegation.h>
+#include <util/convert.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <map>
+
+/* The index database stores the current delegation of each delegate under [DB_DELEGATION, uint160],
+ * and the block whose state they are under DB_TIP. Both are written in the same batch, so that the
+ * delegations always are the state of a known block, which may be ahead of the best block locator
+ * when the node was not shut down cleanly.
+ *
+ * For each block that changed a delegation, the delegations it replaced are stored under
+ * [DB_UNDO, uint32 (BE)] to rewind it in a reorg. The undo data of the blocks far below the tip
+ * is kept, it is small since delegations rarely change.
+ */
+constexpr uint8_t DB_DELEGATION{'d'};
+constexpr uint8_t DB_UNDO{'u'};
+constexpr uint8_t DB_TIP{'T'};
+
+std::unique_ptr<DelegationIndex> g_delegationindex;
+
+namespace {
+
+struct DBHeightKey {
+    int height;
+
+    explicit DBHeightKey(int height_in) : height(height_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_UNDO);
+        ser_writedata32be(s, height);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint8_t prefix{ser_readdata8(s)};
+        if (prefix != DB_UNDO) {
+            throw std::ios_base::failure("Invalid format for delegation index DB height key");
+        }
+        height = ser_readdata32be(s);
+    }
+};
+
+struct DBDelegation {
+    Delegation delegation;
+
+    SERIALIZE_METHODS(DBDelegation, obj) { READWRITE(obj.delegation.staker, obj.delegation.fee, obj.delegation.blockHeight, obj.delegation.PoD); }
+};
+
+struct DBTip {
+    uint256 hash;
+    int height{-1};
+
+    SERIALIZE_METHODS(DBTip, obj) { READWRITE(obj.hash, obj.height); }
+};
+
+struct DBUndo {
+    uint256 hash;
+    //! Delegations replaced by the block, null if the delegate had none
+    std::vector<std::pair<uint160, DBDelegation>> entries;
+
+    SERIALIZE_METHODS(DBUndo, obj) { READWRITE(obj.hash, obj.entries); }
+};
+
+void WriteDelegation(CDBBatch& batch, const uint160& delegate, const Delegation& delegation)
+{
+    if (delegation.IsNull()) {
+        batch.Erase(std::make_pair(DB_DELEGATION, delegate));
+    } else {
+        batch.Write(std::make_pair(DB_DELEGATION, delegate), DBDelegation{delegation});
+    }
+}
+
+} // namespace
+
+/** Access to the delegation index database (indexes/delegationindex/) */
+class DelegationIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool ReadDelegation(const uint160& delegate, Delegation& delegation) const;
+};
+
+DelegationIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(gArgs.GetDataDirNet() / "indexes" / "delegationindex", n_cache_size, f_memory, f_wipe)
+{}
+
+bool DelegationIndex::DB::ReadDelegation(const uint160& delegate, Delegation& delegation) const
+{
+    DBDelegation value;
+    if (!Read(std::make_pair(DB_DELEGATION, delegate), value)) {
+        delegation = Delegation();
+        return false;
+    }
+    delegation = value.delegation;
+    return true;
+}
+
+DelegationIndex::DelegationIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory, bool f_wipe)
+    : BaseIndex(std::move(chain), "delegationindex"), m_db(std::make_unique<DelegationIndex::DB>(n_cache_size, f_memory, f_wipe)),
+      m_qtum_delegation(std::make_unique<QtumDelegation>())
+{}
+
+DelegationIndex::~DelegationIndex() = default;
+
+bool DelegationIndex::CustomInit(const std::optional<interfaces::BlockKey>& block)
+{
+    LOCK(m_mutex);
+    DBTip tip;
+    if (m_db->Read(DB_TIP, tip)) {
+        m_best_hash = tip.hash;
+        m_best_height = tip.height;
+    }
+
+    // The delegations may have been written for blocks above the best block locator
+    const int height = block ? block->height : -1;
+    const uint256 hash = block ? block->hash : uint256();
+    if (m_best_height > height && !RewindTo(height, hash)) {
+        return false;
+    }
+    if (m_best_height != height || m_best_hash != hash) {
+        return error("%s: %s is not at the best block %s, restart with -reindex to rebuild it",
+                     __func__, GetName(), hash.ToString());
+    }
+    return true;
+}
+
+bool DelegationIndex::CustomAppend(const interfaces::BlockInfo& block)
+{
+    assert(block.data);
+    std::vector<DelegationEvent> events;
+    {
+        // The receipts storage is shared with block connection and the RPC, which use it under cs_main
+        LOCK(cs_main);
+        for (const auto& tx : block.data->vtx) {
+            if (!tx->HasCreateOrCall()) continue;
+            for (const TransactionReceiptInfo& receipt : pstorageresult->getResult(uintToh256(tx->GetHash()))) {
+                // A transaction that was reorganized into another block has receipts for both
+                if (receipt.blockHash != block.hash) continue;
+                for (const dev::eth::LogEntry& log : receipt.logs) {
+                    DelegationEvent event;
+                    if (m_qtum_delegation->GetDelegationEvent(log, event)) {
+                        events.push_back(event);
+                    }
+                }
+            }
+        }
+    }
+
+    LOCK(m_mutex);
+    if (m_best_height != block.height - 1) {
+        return error("%s: %s is at height %d, cannot append block %s at height %d",
+                     __func__, GetName(), m_best_height, block.hash.ToString(), block.height);
+    }
+
+    // Same updates as QtumDelegation::UpdateDelegationsFromEvents, over the stored delegations
+    std::map<uint160, Delegation> changed;
+    DBUndo undo{block.hash, {}};
+    for (const DelegationEvent& event : events) {
+        const uint160& delegate = event.item.delegate;
+        auto it = changed.find(delegate);
+        if (it == changed.end()) {
+            Delegation previous;
+            m_db->ReadDelegation(delegate, previous);
+            undo.entries.emplace_back(delegate, DBDelegation{previous});
+            it = changed.emplace(delegate, previous).first;
+        }
+        if (event.type == DELEGATION_ADD) {
+            it->second = event.item;
+        } else if (event.type == DELEGATION_REMOVE) {
+            it->second = Delegation();
+        }
+    }
+
+    CDBBatch batch(*m_db);
+    for (const auto& [delegate, delegation] : changed) {
+        WriteDelegation(batch, delegate, delegation);
+    }
+    if (undo.entries.empty()) {
+        batch.Erase(DBHeightKey(block.height));
+    } else {
+        batch.Write(DBHeightKey(block.height), undo);
+    }
+    batch.Write(DB_TIP, DBTip{block.hash, block.height});
+    if (!m_db->WriteBatch(batch)) return false;
+
+    m_best_hash = block.hash;
+    m_best_height = block.height;
+    return true;
+}
+
+bool DelegationIndex::CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip)
+{
+    assert(current_tip.height >= new_tip.height);
+
+    LOCK(m_mutex);
+    return RewindTo(new_tip.height, new_tip.hash);
+}
+
+bool DelegationIndex::RewindTo(int height, const uint256& hash)
+{
+    AssertLockHeld(m_mutex);
+
+    // The blocks are undone from the top, so the last write of a delegation in the batch is its
+    // value before the lowest block that changed it
+    CDBBatch batch(*m_db);
+    for (int undo_height = m_best_height; undo_height > height; --undo_height) {
+        DBUndo undo;
+        if (!m_db->Read(DBHeightKey(undo_height), undo)) continue;
+        for (const auto& [delegate, previous] : undo.entries) {
+            WriteDelegation(batch, delegate, previous.delegation);
+        }
+        batch.Erase(DBHeightKey(undo_height));
+    }
+    batch.Write(DB_TIP, DBTip{hash, height});
+    if (!m_db->WriteBatch(batch)) return false;
+
+    m_best_hash = hash;
+    m_best_height = height;
+    return true;
+}
+
+BaseIndex::DB& DelegationIndex::GetDB() const { return *m_db; }
+
+bool DelegationIndex::LookupDelegation(const uint256& block_hash, const uint160& delegate, Delegation& delegation) const
+{
+    LOCK(m_mutex);
+    if (m_best_hash != block_hash) return false;
+
+    m_db->ReadDelegation(delegate, delegation);
+    return true;
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_DELEGATIONINDEX_H
+#define BITCOIN_INDEX_DELEGATIONINDEX_H
+
+#include <index/base.h>
+#include <qtum/posutils.h>
+#include <sync.h>
+#include <uint256.h>
+
+class QtumDelegation;
+
+static constexpr bool DEFAULT_DELEGATIONINDEX{false};
+
+/**
+ * DelegationIndex maintains the delegations of the delegation contract, delegate -> {staker, fee,
+ * block height, PoD}, by applying the AddDelegation and RemoveDelegation events emitted by each
+ * block. The delegations are then looked up without executing the contract in the EVM.
+ * The events are read from the -logevents storage, which this index requires.
+ */
+class DelegationIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+    const std::unique_ptr<QtumDelegation> m_qtum_delegation;
+
+    mutable Mutex m_mutex;
+    //! Block the stored delegations are the state of, written with them
+    uint256 m_best_hash GUARDED_BY(m_mutex);
+    int m_best_height GUARDED_BY(m_mutex){-1};
+
+    bool AllowPrune() const override { return true; }
+
+    /** Undo the blocks above @p height that have been applied, down to it */
+    bool RewindTo(int height, const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+protected:
+    bool CustomInit(const std::optional<interfaces::BlockKey>& block) override;
+
+    bool CustomAppend(const interfaces::BlockInfo& block) override;
+
+    bool CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit DelegationIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains unique_ptrs to incomplete types.
+    virtual ~DelegationIndex() override;
+
+    /**
+     * Look up the delegation of @p delegate in the state of block @p block_hash.
+     * A null delegation is returned when the address has not delegated.
+     *
+     * @returns false if the index is not at that block, the contract has to be called then.
+     */
+    bool LookupDelegation(const uint256& block_hash, const uint160& delegate, Delegation& delegation) const;
+};
+
+/// The global delegation index. May be null.
+extern std::unique_ptr<DelegationIndex> g_delegationindex;
+
+#endif // BITCOIN_INDEX_DELEGATIONINDEX_H
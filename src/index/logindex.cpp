@@ -0,0 +1,225 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/logindex.h>
+
+#include <dbwrapper.h>
+#include <libethcore/LogEntry.h>
+#include <logging.h>
+#include <util/convert.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <functional>
+
+/* The index database stores for each block with EVM logs its hash and the bloom filter over the
+ * addresses and topics of those logs. Blocks without logs have no entry. For each section of
+ * LOG_INDEX_SECTION_SIZE blocks it also stores the union of the block filters, so that a search
+ * only has to look at the block entries of the sections that may match.
+ *
+ * Section filters are only ever extended. Blocks disconnected in a reorg leave their bits behind,
+ * which can only cause false positives and keeps the rewind cheap.
+ *
+ * Keys for the block entries have the type [DB_BLOCK_HEIGHT, uint32 (BE)] and keys for the
+ * section filters the type [DB_SECTION, uint32 (BE)], so that sequential reads are fast.
+ */
+constexpr uint8_t DB_BLOCK_HEIGHT{'t'};
+constexpr uint8_t DB_SECTION{'S'};
+
+std::unique_ptr<LogIndex> g_logindex;
+
+namespace {
+
+struct DBHeightKey {
+    uint8_t prefix;
+    int height;
+
+    explicit DBHeightKey(uint8_t prefix_in, int height_in) : prefix(prefix_in), height(height_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, prefix);
+        ser_writedata32be(s, height);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        prefix = ser_readdata8(s);
+        if (prefix != DB_BLOCK_HEIGHT && prefix != DB_SECTION) {
+            throw std::ios_base::failure("Invalid format for log index DB height key");
+        }
+        height = ser_readdata32be(s);
+    }
+};
+
+struct DBBloom {
+    dev::eth::LogBloom bloom;
+
+    SERIALIZE_METHODS(DBBloom, obj) { READWRITE(Span{obj.bloom.data(), dev::eth::LogBloom::size}); }
+};
+
+struct DBVal {
+    uint256 hash;
+    DBBloom bloom;
+
+    SERIALIZE_METHODS(DBVal, obj) { READWRITE(obj.hash, obj.bloom); }
+};
+
+/** Bloom filter with the bits a log from @p addr (or with topic @p topic) sets */
+template <unsigned N>
+dev::eth::LogBloom ItemBloom(const dev::FixedHash<N>& item)
+{
+    dev::eth::LogBloom ret;
+    ret.shiftBloom<3>(dev::sha3(item.ref()));
+    return ret;
+}
+
+/** The filter matches if one of the addresses (any if empty) and one of the topics (any if empty) may be present */
+bool MatchBloom(const dev::eth::LogBloom& bloom, const std::vector<dev::eth::LogBloom>& addresses, const std::vector<dev::eth::LogBloom>& topics)
+{
+    auto contains = [&bloom](const std::vector<dev::eth::LogBloom>& items) {
+        if (items.empty()) return true;
+        for (const auto& item : items) {
+            if (bloom.contains(item)) return true;
+        }
+        return false;
+    };
+    return contains(addresses) && contains(topics);
+}
+
+} // namespace
+
+/** Access to the log index database (indexes/logindex/) */
+class LogIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+LogIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(gArgs.GetDataDirNet() / "indexes" / "logindex", n_cache_size, f_memory, f_wipe)
+{}
+
+LogIndex::LogIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory, bool f_wipe)
+    : BaseIndex(std::move(chain), "logindex"), m_db(std::make_unique<LogIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+LogIndex::~LogIndex() = default;
+
+bool LogIndex::CustomAppend(const interfaces::BlockInfo& block)
+{
+    assert(block.data);
+    dev::eth::LogBloom bloom;
+    bool has_logs = false;
+    {
+        // The receipts storage is shared with block connection and the RPC, which use it under cs_main
+        LOCK(cs_main);
+        for (const auto& tx : block.data->vtx) {
+            if (!tx->HasCreateOrCall()) continue;
+            for (const TransactionReceiptInfo& receipt : pstorageresult->getResult(uintToh256(tx->GetHash()))) {
+                // A transaction that was reorganized into another block has receipts for both
+                if (receipt.blockHash != block.hash || receipt.logs.empty()) continue;
+                bloom |= dev::eth::bloom(receipt.logs);
+                has_logs = true;
+            }
+        }
+    }
+
+    CDBBatch batch(*m_db);
+    if (!has_logs) {
+        batch.Erase(DBHeightKey(DB_BLOCK_HEIGHT, block.height));
+        return m_db->WriteBatch(batch);
+    }
+
+    const int section = block.height / LOG_INDEX_SECTION_SIZE;
+    DBBloom section_bloom;
+    if (!m_db->Read(DBHeightKey(DB_SECTION, section), section_bloom)) {
+        section_bloom.bloom = dev::eth::LogBloom();
+    }
+    section_bloom.bloom |= bloom;
+
+    batch.Write(DBHeightKey(DB_BLOCK_HEIGHT, block.height), DBVal{block.hash, DBBloom{bloom}});
+    batch.Write(DBHeightKey(DB_SECTION, section), section_bloom);
+    return m_db->WriteBatch(batch);
+}
+
+bool LogIndex::CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip)
+{
+    assert(current_tip.height >= new_tip.height);
+
+    // Only the block entries are removed, see the section filters description above
+    CDBBatch batch(*m_db);
+    for (int height = new_tip.height + 1; height <= current_tip.height; ++height) {
+        batch.Erase(DBHeightKey(DB_BLOCK_HEIGHT, height));
+    }
+    return m_db->WriteBatch(batch);
+}
+
+BaseIndex::DB& LogIndex::GetDB() const { return *m_db; }
+
+bool LogIndex::FindBlocks(int start_height, int stop_height, const std::set<dev::h160>& addresses,
+                          const std::vector<dev::h256>& topics, std::vector<int>& heights,
+                          std::vector<uint256>& hashes, int& last_height) const
+{
+    heights.clear();
+    hashes.clear();
+    last_height = 0;
+    if (start_height < 0 || stop_height < start_height) return false;
+
+    std::vector<dev::eth::LogBloom> address_blooms;
+    for (const auto& address : addresses) {
+        address_blooms.push_back(ItemBloom(address));
+    }
+    std::vector<dev::eth::LogBloom> topic_blooms;
+    for (const auto& topic : topics) {
+        topic_blooms.push_back(ItemBloom(topic));
+    }
+
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    auto scan_section = [&](int section, const std::function<void(int, const DBVal&)>& fn) {
+        const int first = std::max(start_height, section * LOG_INDEX_SECTION_SIZE);
+        const int last = std::min(stop_height, (section + 1) * LOG_INDEX_SECTION_SIZE - 1);
+        for (db_it->Seek(DBHeightKey(DB_BLOCK_HEIGHT, first)); db_it->Valid(); db_it->Next()) {
+            DBHeightKey key(DB_BLOCK_HEIGHT, 0);
+            if (!db_it->GetKey(key) || key.prefix != DB_BLOCK_HEIGHT || key.height > last) break;
+
+            DBVal value;
+            if (!db_it->GetValue(value)) {
+                return error("%s: unable to read value in %s at height %d", __func__, GetName(), key.height);
+            }
+            fn(key.height, value);
+        }
+        return true;
+    };
+
+    const int start_section = start_height / LOG_INDEX_SECTION_SIZE;
+    const int stop_section = stop_height / LOG_INDEX_SECTION_SIZE;
+    int last_section = -1;
+    for (int section = start_section; section <= stop_section; ++section) {
+        DBBloom section_bloom;
+        if (!m_db->Read(DBHeightKey(DB_SECTION, section), section_bloom)) {
+            // No block of the section has logs
+            continue;
+        }
+        last_section = section;
+        if (!MatchBloom(section_bloom.bloom, address_blooms, topic_blooms)) continue;
+
+        bool ok = scan_section(section, [&](int height, const DBVal& value) {
+            if (MatchBloom(value.bloom.bloom, address_blooms, topic_blooms)) {
+                heights.push_back(height);
+                hashes.push_back(value.hash);
+            }
+        });
+        if (!ok) return false;
+    }
+
+    // Only the sections with logs at the end of the range have to be scanned for the last height
+    for (int section = last_section; section >= start_section && last_height == 0; --section) {
+        if (section != last_section && !m_db->Exists(DBHeightKey(DB_SECTION, section))) continue;
+        if (!scan_section(section, [&](int height, const DBVal&) { last_height = height; })) return false;
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_LOGINDEX_H
+#define BITCOIN_INDEX_LOGINDEX_H
+
+#include <index/base.h>
+#include <libdevcore/FixedHash.h>
+
+#include <set>
+#include <vector>
+
+static constexpr bool DEFAULT_LOGINDEX{false};
+
+/** Number of consecutive blocks summarized by one section bloom filter */
+static constexpr int LOG_INDEX_SECTION_SIZE{4096};
+
+/**
+ * LogIndex maintains bloom filters over the contract addresses and topics of the EVM logs
+ * emitted by each block, and over sections of LOG_INDEX_SECTION_SIZE blocks, so that log
+ * searches can skip the blocks that cannot match without reading their receipts.
+ * The receipts themselves are read from the -logevents storage, which this index requires.
+ */
+class LogIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    bool AllowPrune() const override { return true; }
+
+protected:
+    bool CustomAppend(const interfaces::BlockInfo& block) override;
+
+    bool CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit LogIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~LogIndex() override;
+
+    /**
+     * Find the blocks in [start_height, stop_height] that may contain logs matching the filter.
+     * A block matches when it has a log from one of @p addresses (any address if empty) and, if
+     * @p topics is not empty, a log with one of @p topics. False positives have to be filtered
+     * by the caller, blocks with matching logs are never missed.
+     *
+     * @param[out] heights       Heights of the candidate blocks, in ascending order.
+     * @param[out] last_height   Highest height in the range with any log, 0 if there is none.
+     * @param[out] hashes        Hashes the candidate blocks were indexed with.
+     */
+    bool FindBlocks(int start_height, int stop_height, const std::set<dev::h160>& addresses,
+                    const std::vector<dev::h256>& topics, std::vector<int>& heights,
+                    std::vector<uint256>& hashes, int& last_height) const;
+};
+
+/// The global log index. May be null.
+extern std::unique_ptr<LogIndex> g_logindex;
+
+#endif // BITCOIN_INDEX_LOGINDEX_H
@@ -0,0 +1,238 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/qrc20index.h>
+
+#include <dbwrapper.h>
+#include <libethcore/ABI.h>
+#include <libethcore/LogEntry.h>
+#include <logging.h>
+#include <util/convert.h>
+#include <util/system.h>
+#include <validation.h>
+
+/* The index database stores one entry per token, holder and event, with the sender, receiver and
+ * amount of the event. A transfer is stored for both its sender and its receiver, a burn for its
+ * sender only. The events are ordered by height, then by the position of the transaction in the
+ * block and of the log in the transaction, which is the order they were emitted in.
+ *
+ * For each block with events it also stores the hash of the block and the keys of its events,
+ * so that they can be erased when the block is disconnected.
+ *
+ * Keys for the events have the type [DB_TRANSFER, token, holder, uint32 (BE) height,
+ * uint32 (BE) tx position, uint32 (BE) log position] and keys for the blocks the type
+ * [DB_BLOCK_HEIGHT, uint32 (BE)].
+ */
+constexpr uint8_t DB_TRANSFER{'q'};
+constexpr uint8_t DB_BLOCK_HEIGHT{'t'};
+
+const dev::h256 QRC20_TRANSFER_TOPIC{"ddf252ad1be2c89b69c2b068fc378daa952ba7f163c4a11628f55a4df523b3ef"};
+const dev::h256 QRC20_BURN_TOPIC{"cc16f5dbb4873280815c1ee09dbd06736cffcc184412cf7a71a0fdb75d397ca5"};
+
+std::unique_ptr<Qrc20Index> g_qrc20index;
+
+namespace {
+
+struct DBHeightKey {
+    int height;
+
+    explicit DBHeightKey(int height_in) : height(height_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_BLOCK_HEIGHT);
+        ser_writedata32be(s, height);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint8_t prefix{ser_readdata8(s)};
+        if (prefix != DB_BLOCK_HEIGHT) {
+            throw std::ios_base::failure("Invalid format for QRC20 index DB height key");
+        }
+        height = ser_readdata32be(s);
+    }
+};
+
+struct DBTransferKey {
+    dev::h160 token;
+    dev::h160 holder;
+    int height{0};
+    uint32_t tx_pos{0};
+    uint32_t log_pos{0};
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_TRANSFER);
+        s << Span{token.data(), dev::h160::size} << Span{holder.data(), dev::h160::size};
+        ser_writedata32be(s, height);
+        ser_writedata32be(s, tx_pos);
+        ser_writedata32be(s, log_pos);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint8_t prefix{ser_readdata8(s)};
+        if (prefix != DB_TRANSFER) {
+            throw std::ios_base::failure("Invalid format for QRC20 index DB transfer key");
+        }
+        s >> Span{token.data(), dev::h160::size} >> Span{holder.data(), dev::h160::size};
+        height = ser_readdata32be(s);
+        tx_pos = ser_readdata32be(s);
+        log_pos = ser_readdata32be(s);
+    }
+};
+
+struct DBTransferVal {
+    uint256 block_hash;
+    uint256 txid;
+    dev::h160 from;
+    dev::h160 to;
+    uint256 amount;
+    bool burn;
+
+    SERIALIZE_METHODS(DBTransferVal, obj)
+    {
+        READWRITE(obj.block_hash, obj.txid, Span{obj.from.data(), dev::h160::size},
+                  Span{obj.to.data(), dev::h160::size}, obj.amount, obj.burn);
+    }
+};
+
+struct DBBlockVal {
+    uint256 hash;
+    std::vector<DBTransferKey> keys;
+
+    SERIALIZE_METHODS(DBBlockVal, obj) { READWRITE(obj.hash, obj.keys); }
+};
+
+/** Amount of a Transfer or Burn event, the first word of the log data */
+uint256 EventAmount(const dev::bytes& data)
+{
+    dev::bytesConstRef ref(&data);
+    return u256Touint(dev::eth::ABIDeserialiser<dev::u256>::deserialise(ref));
+}
+
+} // namespace
+
+/** Access to the QRC20 transfer index database (indexes/qrc20index/) */
+class Qrc20Index::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+std::vector<Qrc20BlockEvent> ReadQrc20BlockEvents(const CBlock& block, const uint256& block_hash, int height)
+{
+    AssertLockHeld(cs_main);
+    std::vector<Qrc20BlockEvent> events;
+    for (uint32_t tx_pos = 0; tx_pos < block.vtx.size(); ++tx_pos) {
+        const CTransactionRef& tx = block.vtx[tx_pos];
+        if (!tx->HasCreateOrCall()) continue;
+        uint32_t log_pos = 0;
+        for (const TransactionReceiptInfo& receipt : pstorageresult->getResult(uintToh256(tx->GetHash()))) {
+            // A transaction that was reorganized into another block has receipts for both
+            if (receipt.blockHash != block_hash) continue;
+            for (const dev::eth::LogEntry& log : receipt.logs) {
+                const uint32_t pos = log_pos++;
+                Qrc20Transfer transfer;
+                if (log.topics.size() >= 3 && log.topics[0] == QRC20_TRANSFER_TOPIC) {
+                    transfer.to = dev::right160(log.topics[2]);
+                    transfer.burn = false;
+                } else if (log.topics.size() >= 2 && log.topics[0] == QRC20_BURN_TOPIC) {
+                    transfer.burn = true;
+                } else {
+                    continue;
+                }
+                transfer.height = height;
+                transfer.block_hash = block_hash;
+                transfer.txid = tx->GetHash();
+                transfer.from = dev::right160(log.topics[1]);
+                transfer.amount = EventAmount(log.data);
+                events.push_back({log.address, tx_pos, pos, transfer});
+            }
+        }
+    }
+    return events;
+}
+
+Qrc20Index::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(gArgs.GetDataDirNet() / "indexes" / "qrc20index", n_cache_size, f_memory, f_wipe)
+{}
+
+Qrc20Index::Qrc20Index(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory, bool f_wipe)
+    : BaseIndex(std::move(chain), "qrc20index"), m_db(std::make_unique<Qrc20Index::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+Qrc20Index::~Qrc20Index() = default;
+
+bool Qrc20Index::CustomAppend(const interfaces::BlockInfo& block)
+{
+    assert(block.data);
+    CDBBatch batch(*m_db);
+    DBBlockVal block_val{block.hash, {}};
+    // The receipts storage is shared with block connection and the RPC, which use it under cs_main
+    const std::vector<Qrc20BlockEvent> events{WITH_LOCK(cs_main, return ReadQrc20BlockEvents(*block.data, block.hash, block.height))};
+    for (const Qrc20BlockEvent& event : events) {
+        const Qrc20Transfer& transfer = event.transfer;
+        const DBTransferVal value{transfer.block_hash, transfer.txid, transfer.from, transfer.to, transfer.amount, transfer.burn};
+
+        DBTransferKey key{event.token, value.from, block.height, event.tx_pos, event.log_pos};
+        batch.Write(key, value);
+        block_val.keys.push_back(key);
+        if (!value.burn && value.to != value.from) {
+            key.holder = value.to;
+            batch.Write(key, value);
+            block_val.keys.push_back(key);
+        }
+    }
+
+    if (block_val.keys.empty()) {
+        batch.Erase(DBHeightKey(block.height));
+    } else {
+        batch.Write(DBHeightKey(block.height), block_val);
+    }
+    return m_db->WriteBatch(batch);
+}
+
+bool Qrc20Index::CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip)
+{
+    assert(current_tip.height >= new_tip.height);
+
+    CDBBatch batch(*m_db);
+    for (int height = new_tip.height + 1; height <= current_tip.height; ++height) {
+        DBBlockVal block_val;
+        if (!m_db->Read(DBHeightKey(height), block_val)) continue;
+        for (const DBTransferKey& key : block_val.keys) {
+            batch.Erase(key);
+        }
+        batch.Erase(DBHeightKey(height));
+    }
+    return m_db->WriteBatch(batch);
+}
+
+BaseIndex::DB& Qrc20Index::GetDB() const { return *m_db; }
+
+bool Qrc20Index::FindTransfers(const dev::h160& token, const dev::h160& holder, bool burn, int start_height,
+                               int stop_height, std::vector<Qrc20Transfer>& transfers) const
+{
+    if (start_height < 0 || stop_height < start_height) return false;
+
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    for (db_it->Seek(DBTransferKey{token, holder, start_height, 0, 0}); db_it->Valid(); db_it->Next()) {
+        DBTransferKey key;
+        if (!db_it->GetKey(key) || key.token != token || key.holder != holder || key.height > stop_height) break;
+
+        DBTransferVal value;
+        if (!db_it->GetValue(value)) {
+            return error("%s: unable to read value in %s at height %d", __func__, GetName(), key.height);
+        }
+        if (value.burn != burn) continue;
+        transfers.push_back({key.height, value.block_hash, value.txid, value.from, value.to, value.amount, value.burn});
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_QRC20INDEX_H
+#define BITCOIN_INDEX_QRC20INDEX_H
+
+#include <index/base.h>
+#include <libdevcore/FixedHash.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <vector>
+
+class CBlock;
+extern RecursiveMutex cs_main;
+
+static constexpr bool DEFAULT_QRC20INDEX{false};
+
+/** Topic of the QRC20 Transfer(address indexed from, address indexed to, uint256 value) event */
+extern const dev::h256 QRC20_TRANSFER_TOPIC;
+/** Topic of the QRC20 Burn(address indexed from, uint256 value) event */
+extern const dev::h256 QRC20_BURN_TOPIC;
+
+/** A QRC20 Transfer or Burn event emitted by a token contract */
+struct Qrc20Transfer {
+    int height{0};
+    uint256 block_hash;
+    uint256 txid;
+    dev::h160 from;
+    /// Null for a burn
+    dev::h160 to;
+    uint256 amount;
+    bool burn{false};
+};
+
+/** A QRC20 event of a connected block, with its token contract and position in the block */
+struct Qrc20BlockEvent {
+    dev::h160 token;
+    /// Position of the transaction in the block
+    uint32_t tx_pos{0};
+    /// Position of the log among the logs of the transaction
+    uint32_t log_pos{0};
+    Qrc20Transfer transfer;
+};
+
+/** Read the QRC20 Transfer and Burn events of a connected block from the -logevents storage */
+std::vector<Qrc20BlockEvent> ReadQrc20BlockEvents(const CBlock& block, const uint256& block_hash, int height) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+/**
+ * Qrc20Index maintains, for each token contract and token holder, the list of the QRC20 Transfer
+ * and Burn events the holder took part in, so that the token transactions of an address are read
+ * without searching the logs of every block of the range.
+ * The events are read from the -logevents storage, which this index requires.
+ */
+class Qrc20Index final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    bool AllowPrune() const override { return true; }
+
+protected:
+    bool CustomAppend(const interfaces::BlockInfo& block) override;
+
+    bool CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit Qrc20Index(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~Qrc20Index() override;
+
+    /**
+     * Find the Transfer (or Burn if @p burn is set) events of @p token in [start_height, stop_height]
+     * that have @p holder as sender or receiver, in the order they were emitted.
+     */
+    bool FindTransfers(const dev::h160& token, const dev::h160& holder, bool burn, int start_height,
+                       int stop_height, std::vector<Qrc20Transfer>& transfers) const;
+};
+
+/// The global QRC20 transfer index. May be null.
+extern std::unique_ptr<Qrc20Index> g_qrc20index;
+
+#endif // BITCOIN_INDEX_QRC20INDEX_H
@@ -4,18 +4,49 @@
 
 #include <index/txindex.h>
 
-#include <index/disktxpos.h>
+#include <interfaces/chain.h>
 #include <logging.h>
+#include <memusage.h>
 #include <node/blockstorage.h>
 #include <util/system.h>
 #include <validation.h>
 
 using node::OpenBlockFile;
 
+/** Legacy key of a transaction position, by full transaction hash. */
 constexpr uint8_t DB_TXINDEX{'t'};
+/** Key of a transaction position, by truncated transaction hash and position. */
+constexpr uint8_t DB_TXPOS{'T'};
 
 std::unique_ptr<TxIndex> g_txindex;
 
+namespace {
+/**
+ * The first 8 bytes of a transaction hash followed by the position of the transaction, which
+ * keeps the keys of transactions sharing a truncated hash apart. A lookup seeks to the truncated
+ * hash and reads the transactions at the positions that follow it.
+ */
+struct TxPosKey {
+    uint64_t txid_prefix{0};
+    CDiskTxPos pos;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata64(s, txid_prefix);
+        s << pos;
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        txid_prefix = ser_readdata64(s);
+        s >> pos;
+    }
+};
+
+uint64_t TxidPrefix(const uint256& txid) { return txid.GetUint64(0); }
+} // namespace
 
 /** Access to the txindex database (indexes/txindex/) */
 class TxIndex::DB : public BaseIndex::DB
@@ -23,39 +54,88 @@ class TxIndex::DB : public BaseIndex::DB
 public:
     explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
 
-    /// Read the disk location of the transaction data with the given hash. Returns false if the
-    /// transaction hash is not indexed.
-    bool ReadTxPos(const uint256& txid, CDiskTxPos& pos) const;
+    /// Read the disk locations of the transactions whose hash starts like the given one.
+    std::vector<CDiskTxPos> ReadTxPositions(const uint256& txid);
+
+    /// Read the disk location of the transaction data with the given hash from the legacy
+    /// entries. Returns false if the transaction hash is not indexed there.
+    bool ReadLegacyTxPos(const uint256& txid, CDiskTxPos& pos) const;
 
     /// Write a batch of transaction positions to the DB.
     bool WriteTxs(const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos);
+
+    //! Whether the index was built with the legacy full hash keys, which are still read
+    const bool m_has_legacy_entries;
+
+private:
+    bool HasLegacyEntries();
 };
 
 TxIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
-    BaseIndex::DB(gArgs.GetDataDirNet() / "indexes" / "txindex", n_cache_size, f_memory, f_wipe)
-{}
+    BaseIndex::DB(gArgs.GetDataDirNet() / "indexes" / "txindex", n_cache_size, f_memory, f_wipe),
+    m_has_legacy_entries(HasLegacyEntries())
+{
+    if (m_has_legacy_entries) {
+        LogPrintf("txindex: keeping the full hash entries of an older version, new blocks use truncated hashes\n");
+    }
+}
+
+bool TxIndex::DB::HasLegacyEntries()
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(DB_TXINDEX);
+    std::pair<uint8_t, uint256> key;
+    return pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_TXINDEX;
+}
 
-bool TxIndex::DB::ReadTxPos(const uint256 &txid, CDiskTxPos& pos) const
+std::vector<CDiskTxPos> TxIndex::DB::ReadTxPositions(const uint256& txid)
 {
-    return Read(std::make_pair(DB_TXINDEX, txid), pos);
+    std::vector<CDiskTxPos> positions;
+    const uint64_t txid_prefix = TxidPrefix(txid);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    std::pair<uint8_t, TxPosKey> key;
+    for (pcursor->Seek(std::make_pair(DB_TXPOS, txid_prefix));
+         pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_TXPOS && key.second.txid_prefix == txid_prefix;
+         pcursor->Next()) {
+        positions.push_back(key.second.pos);
+    }
+    return positions;
+}
+
+bool TxIndex::DB::ReadLegacyTxPos(const uint256& txid, CDiskTxPos& pos) const
+{
+    return m_has_legacy_entries && Read(std::make_pair(DB_TXINDEX, txid), pos);
 }
 
 bool TxIndex::DB::WriteTxs(const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos)
 {
     CDBBatch batch(*this);
-    for (const auto& tuple : v_pos) {
-        batch.Write(std::make_pair(DB_TXINDEX, tuple.first), tuple.second);
+    for (const auto& [txid, pos] : v_pos) {
+        batch.Write(std::make_pair(DB_TXPOS, TxPosKey{TxidPrefix(txid), pos}), uint8_t{0});
     }
     return WriteBatch(batch);
 }
 
-TxIndex::TxIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory, bool f_wipe)
-    : BaseIndex(std::move(chain), "txindex"), m_db(std::make_unique<TxIndex::DB>(n_cache_size, f_memory, f_wipe))
+/** Approximate memory of a hot cache entry, in the map node, its bucket and the eviction queue. */
+static size_t HotEntryUsage()
+{
+    return memusage::MallocUsage(sizeof(std::pair<const uint256, CDiskTxPos>) + 2 * sizeof(void*)) + sizeof(void*) + sizeof(uint256);
+}
+
+TxIndex::TxIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory, bool f_wipe, size_t hot_cache_size)
+    : BaseIndex(std::move(chain), "txindex"), m_db(std::make_unique<TxIndex::DB>(n_cache_size, f_memory, f_wipe)),
+      m_hot_max_entries(hot_cache_size / HotEntryUsage())
 {}
 
 TxIndex::~TxIndex() = default;
 
 bool TxIndex::CustomAppend(const interfaces::BlockInfo& block)
+{
+    std::any prepared;
+    return CustomPrepare(block, prepared) && CustomAppendPrepared(block, prepared);
+}
+
+bool TxIndex::CustomPrepare(const interfaces::BlockInfo& block, std::any& prepared) const
 {
     // Exclude genesis block transaction because outputs are not spendable.
     if (block.height == 0) return true;
@@ -68,35 +148,104 @@ bool TxIndex::CustomAppend(const interfaces::BlockInfo& block)
         vPos.emplace_back(tx->GetHash(), pos);
         pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
     }
-    return m_db->WriteTxs(vPos);
+    prepared = std::move(vPos);
+    return true;
 }
 
-BaseIndex::DB& TxIndex::GetDB() const { return *m_db; }
+bool TxIndex::CustomAppendPrepared(const interfaces::BlockInfo& block, std::any& prepared)
+{
+    if (block.height == 0) return true;
 
-bool TxIndex::FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const
+    const auto& positions = std::any_cast<const std::vector<std::pair<uint256, CDiskTxPos>>&>(prepared);
+    if (!m_db->WriteTxs(positions)) return false;
+
+    if (m_hot_max_entries > 0) {
+        LOCK(m_hot_mutex);
+        for (const auto& [txid, pos] : positions) CacheTxPos(txid, pos);
+    }
+    return true;
+}
+
+void TxIndex::CacheTxPos(const uint256& txid, const CDiskTxPos& pos) const
 {
-    CDiskTxPos postx;
-    if (!m_db->ReadTxPos(tx_hash, postx)) {
-        return false;
+    auto [it, inserted] = m_hot_positions.try_emplace(txid, pos);
+    if (!inserted) {
+        // A transaction indexed again, after a reorganization, is found at its latest position
+        it->second = pos;
+        return;
+    }
+    m_hot_order.push_back(txid);
+    if (m_hot_order.size() > m_hot_max_entries) {
+        m_hot_positions.erase(m_hot_order.front());
+        m_hot_order.pop_front();
     }
+}
 
-    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+BaseIndex::DB& TxIndex::GetDB() const { return *m_db; }
+
+bool TxIndex::ReadTx(const CDiskTxPos& pos, const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const
+{
+    CAutoFile file(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (file.IsNull()) {
         return error("%s: OpenBlockFile failed", __func__);
     }
     CBlockHeader header;
     try {
         file >> header;
-        if (fseek(file.Get(), postx.nTxOffset, SEEK_CUR)) {
+        if (fseek(file.Get(), pos.nTxOffset, SEEK_CUR)) {
             return error("%s: fseek(...) failed", __func__);
         }
         file >> tx;
     } catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s", __func__, e.what());
     }
+    // Another transaction sharing the truncated hash
     if (tx->GetHash() != tx_hash) {
-        return error("%s: txid mismatch", __func__);
+        return false;
     }
     block_hash = header.GetHash();
     return true;
 }
+
+bool TxIndex::FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const
+{
+    if (m_hot_max_entries > 0) {
+        std::optional<CDiskTxPos> hot_pos;
+        {
+            LOCK(m_hot_mutex);
+            auto it = m_hot_positions.find(tx_hash);
+            if (it != m_hot_positions.end()) hot_pos = it->second;
+        }
+        if (hot_pos && ReadTx(*hot_pos, tx_hash, block_hash, tx)) return true;
+    }
+
+    // A transaction that was reorganized into another block has a position in each of them,
+    // the one in the active chain is returned if there is one
+    std::optional<CDiskTxPos> found_pos;
+    const std::vector<CDiskTxPos> positions{m_db->ReadTxPositions(tx_hash)};
+    for (const CDiskTxPos& pos : positions) {
+        uint256 pos_block_hash;
+        CTransactionRef pos_tx;
+        if (!ReadTx(pos, tx_hash, pos_block_hash, pos_tx)) continue;
+        found_pos = pos;
+        block_hash = pos_block_hash;
+        tx = std::move(pos_tx);
+        if (positions.size() == 1) break;
+        bool in_active_chain{false};
+        if (m_chain->findBlock(block_hash, interfaces::FoundBlock().inActiveChain(in_active_chain)) && in_active_chain) break;
+    }
+
+    if (!found_pos) {
+        CDiskTxPos legacy_pos;
+        if (!m_db->ReadLegacyTxPos(tx_hash, legacy_pos) || !ReadTx(legacy_pos, tx_hash, block_hash, tx)) {
+            return false;
+        }
+        found_pos = legacy_pos;
+    }
+
+    if (m_hot_max_entries > 0) {
+        LOCK(m_hot_mutex);
+        CacheTxPos(tx_hash, *found_pos);
+    }
+    return true;
+}
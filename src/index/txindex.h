@@ -6,13 +6,22 @@
 #define BITCOIN_INDEX_TXINDEX_H
 
 #include <index/base.h>
+#include <index/disktxpos.h>
+#include <sync.h>
+#include <util/hasher.h>
+
+#include <deque>
+#include <unordered_map>
 
 static constexpr bool DEFAULT_TXINDEX{false};
+//! -txindexcache default (MiB), the in-memory positions of recently indexed and looked up transactions
+static constexpr int64_t DEFAULT_TXINDEX_HOT_CACHE{0};
 
 /**
  * TxIndex is used to look up transactions included in the blockchain by hash.
  * The index is written to a LevelDB database and records the filesystem
- * location of each transaction by transaction hash.
+ * location of each transaction under the first bytes of its hash, the
+ * transactions sharing them are told apart when they are read.
  */
 class TxIndex final : public BaseIndex
 {
@@ -22,16 +31,33 @@ protected:
 private:
     const std::unique_ptr<DB> m_db;
 
+    //! Positions of recently indexed and looked up transactions, the oldest are evicted first
+    mutable Mutex m_hot_mutex;
+    const size_t m_hot_max_entries;
+    mutable std::unordered_map<uint256, CDiskTxPos, SaltedTxidHasher> m_hot_positions GUARDED_BY(m_hot_mutex);
+    mutable std::deque<uint256> m_hot_order GUARDED_BY(m_hot_mutex);
+
+    void CacheTxPos(const uint256& txid, const CDiskTxPos& pos) const EXCLUSIVE_LOCKS_REQUIRED(m_hot_mutex);
+
+    /// Read the transaction at a position, returns false if it is not there or its hash differs.
+    bool ReadTx(const CDiskTxPos& pos, const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const;
+
     bool AllowPrune() const override { return false; }
 
 protected:
     bool CustomAppend(const interfaces::BlockInfo& block) override;
 
+    bool AllowParallelPrepare() const override { return true; }
+
+    bool CustomPrepare(const interfaces::BlockInfo& block, std::any& prepared) const override;
+
+    bool CustomAppendPrepared(const interfaces::BlockInfo& block, std::any& prepared) override;
+
     BaseIndex::DB& GetDB() const override;
 
 public:
     /// Constructs the index, which becomes available to be queried.
-    explicit TxIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+    explicit TxIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory = false, bool f_wipe = false, size_t hot_cache_size = 0);
 
     // Destructor is declared because this class contains a unique_ptr to an incomplete type.
     virtual ~TxIndex() override;
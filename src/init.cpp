@@ -21,10 +21,16 @@
 #include <consensus/amount.h>
 #include <deploymentstatus.h>
 #include <hash.h>
+#include <headerssync.h>
 #include <httprpc.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
+#include <index/blockstatsindex.h>
 #include <index/coinstatsindex.h>
+#include <index/delegationindex.h>
+#include <index/logindex.h>
+#include <index/qrc20index.h>
 #include <index/txindex.h>
 #include <init/common.h>
 #include <interfaces/chain.h>
@@ -39,15 +45,20 @@
 #include <netgroup.h>
 #include <node/blockmanager_args.h>
 #include <node/blockstorage.h>
+#include <node/cachetuner.h>
 #include <node/caches.h>
 #include <node/chainstate.h>
 #include <node/chainstatemanager_args.h>
 #include <node/context.h>
+#include <node/headerstore.h>
 #include <node/interface_ui.h>
 #include <node/mempool_args.h>
 #include <node/mempool_persist_args.h>
 #include <node/miner.h>
+#include <node/stakeestimator.h>
+#include <node/txpreverifier.h>
 #include <node/txreconciliation.h>
+#include <node/vmlog.h>
 #include <node/validation_cache_args.h>
 #include <policy/feerate.h>
 #include <policy/fees.h>
@@ -55,6 +66,8 @@
 #include <policy/policy.h>
 #include <policy/settings.h>
 #include <protocol.h>
+#include <qtum/qtumprofiler.h>
+#include <qtum/qtumstatepruner.h>
 #include <rpc/blockchain.h>
 #include <rpc/register.h>
 #include <rpc/server.h>
@@ -72,6 +85,7 @@
 #include <util/check.h>
 #include <util/fs.h>
 #include <util/fs_helpers.h>
+#include <util/metrics.h>
 #include <util/convert.h>
 #include <util/moneystr.h>
 #include <util/strencodings.h>
@@ -86,6 +100,7 @@
 #include <validation.h>
 #include <validationinterface.h>
 #include <walletinitinterface.h>
+#include <warnings.h>
 #ifdef ENABLE_WALLET
 #include <wallet/wallet.h>
 #include <interfaces/wallet.h>
@@ -98,6 +113,7 @@
 #include <cstdio>
 #include <fstream>
 #include <functional>
+#include <limits>
 #include <set>
 #include <string>
 #include <thread>
@@ -121,17 +137,32 @@ using kernel::DumpMempool;
 using kernel::ValidationCacheSizes;
 
 using node::ApplyArgsManOptions;
+using node::CacheTuner;
 using node::CacheSizes;
 using node::CalculateCacheSizes;
+using node::CACHE_TUNER_INTERVAL;
+using node::DEFAULT_ADAPTIVE_CACHES;
 using node::DEFAULT_PERSIST_MEMPOOL;
+using node::DEFAULT_BLOCK_CLUSTERS;
 using node::DEFAULT_PRINTPRIORITY;
 using node::DEFAULT_STOPAFTERBLOCKIMPORT;
+using node::DEFAULT_MMAP_BLOCK_FILES;
 using node::LoadChainstate;
 using node::MempoolPath;
 using node::ShouldPersistMempool;
+using node::StakeEstimator;
 using node::NodeContext;
+using node::GetNodeCaches;
 using node::ThreadImport;
 using node::VerifyLoadedChainstate;
+using node::fMmapBlockFiles;
+using node::g_block_file_chunk_size;
+using node::g_block_write_buffer_size;
+using node::g_undo_file_chunk_size;
+using node::BLOCKFILE_CHUNK_SIZE;
+using node::DEFAULT_BLOCK_WRITE_BUFFER;
+using node::MAX_BLOCKFILE_SIZE;
+using node::UNDOFILE_CHUNK_SIZE;
 using node::fReindex;
 
 static constexpr bool DEFAULT_PROXYRANDOMIZE{true};
@@ -232,6 +263,24 @@ void Interrupt(NodeContext& node)
     if (g_coin_stats_index) {
         g_coin_stats_index->Interrupt();
     }
+    if (g_block_stats_index) {
+        g_block_stats_index->Interrupt();
+    }
+    if (g_logindex) {
+        g_logindex->Interrupt();
+    }
+    if (g_qrc20index) {
+        g_qrc20index->Interrupt();
+    }
+    if (g_delegationindex) {
+        g_delegationindex->Interrupt();
+    }
+    if (g_addressindex) {
+        g_addressindex->Interrupt();
+    }
+    if (g_state_pruner) {
+        g_state_pruner->Interrupt();
+    }
 }
 
 void Shutdown(NodeContext& node)
@@ -266,6 +315,7 @@ void Shutdown(NodeContext& node)
 
     StopHTTPRPC();
     StopREST();
+    StopHTTPMetrics();
     StopRPC();
     StopHTTPServer();
     for (const auto& client : node.chain_clients) {
@@ -285,10 +335,16 @@ void Shutdown(NodeContext& node)
     if (node.scheduler) node.scheduler->stop();
     if (node.chainman && node.chainman->m_load_block.joinable()) node.chainman->m_load_block.join();
     StopScriptCheckWorkerThreads();
+    StopHeadersSyncWorkerThreads();
+    StopContractExecWorkerThreads();
+    g_state_pruner.reset();
+    // Drop the compactions not started yet, before the databases they compact are closed
+    GetCompactionController().Stop();
 
     // After the threads that potentially access these pointers have been stopped,
     // destruct and reset all to nullptr.
     node.peerman.reset();
+    g_header_store.reset();
     node.connman.reset();
     node.banman.reset();
     node.addrman.reset();
@@ -324,6 +380,26 @@ void Shutdown(NodeContext& node)
         g_coin_stats_index->Stop();
         g_coin_stats_index.reset();
     }
+    if (g_block_stats_index) {
+        g_block_stats_index->Stop();
+        g_block_stats_index.reset();
+    }
+    if (g_logindex) {
+        g_logindex->Stop();
+        g_logindex.reset();
+    }
+    if (g_qrc20index) {
+        g_qrc20index->Stop();
+        g_qrc20index.reset();
+    }
+    if (g_delegationindex) {
+        g_delegationindex->Stop();
+        g_delegationindex.reset();
+    }
+    if (g_addressindex) {
+        g_addressindex->Stop();
+        g_addressindex.reset();
+    }
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
     DestroyAllBlockFilterIndexes();
 
@@ -342,6 +418,7 @@ void Shutdown(NodeContext& node)
             }
         }
         pstorageresult.reset();
+        ResetContractCallSnapshot();
         globalState.reset();
         globalSealEngine.reset();
     }
@@ -360,9 +437,12 @@ void Shutdown(NodeContext& node)
     node.chain_clients.clear();
     UnregisterAllValidationInterfaces();
     GetMainSignals().UnregisterBackgroundSignalScheduler();
+    g_stake_estimator.reset();
+    g_vmlog_writer.reset();
     node.kernel.reset();
     node.mempool.reset();
     node.fee_estimator.reset();
+    node.cache_tuner.reset();
     node.chainman.reset();
     node.scheduler.reset();
 
@@ -375,6 +455,7 @@ void Shutdown(NodeContext& node)
     }
 
     LogPrintf("%s: done\n", __func__);
+    LogInstance().StopAsyncLogging();
 }
 
 /**
@@ -454,18 +535,26 @@ void SetupServerArgs(ArgsManager& argsman)
 #endif
     argsman.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s, signet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex(), signetChainParams->GetConsensus().defaultAssumeValid.GetHex()), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-blocksdir=<dir>", "Specify directory to hold blocks subdirectory for *.dat files (default: <datadir>)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-blockfilechunksize=<n>", strprintf("Pre-allocate block files on disk in chunks of <n> MiB (1 to %u, default: %u)", MAX_BLOCKFILE_SIZE >> 20, BLOCKFILE_CHUNK_SIZE >> 20), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-undofilechunksize=<n>", strprintf("Pre-allocate undo files on disk in chunks of <n> MiB (1 to %u, default: %u)", MAX_BLOCKFILE_SIZE >> 20, UNDOFILE_CHUNK_SIZE >> 20), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-blockwritebuffer=<n>", strprintf("Coalesce the writes of blocks and undo data into writes of up to <n> MiB, which are all written when the block files are flushed (0 to write each block at once, default: %u)", DEFAULT_BLOCK_WRITE_BUFFER), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-mmapblocks", strprintf("Read blocks and undo data from memory mappings of the block files instead of reading them with file I/O (default: %u)", DEFAULT_MMAP_BLOCK_FILES), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-fastprune", "Use smaller block files and lower minimum prune height for testing purposes", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
 #if HAVE_SYSTEM
     argsman.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
     argsman.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-blockstatsindex", strprintf("Maintain an index of the statistics of each block, used by the getblockstats rpc call (default: %u)", DEFAULT_BLOCKSTATSINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-blocksonly", strprintf("Whether to reject transactions from network peers. Automatic broadcast and rebroadcast of any transactions from inbound peers is disabled, unless the peer has the 'forcerelay' permission. RPC transactions are not affected. (default: %u)", DEFAULT_BLOCKSONLY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-coinstatsindex", strprintf("Maintain coinstats index used by the gettxoutsetinfo RPC (default: %u)", DEFAULT_COINSTATSINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-conf=<file>", strprintf("Specify path to read-only configuration file. Relative paths will be prefixed by datadir location (only useable from command line, not configuration file) (default: %s)", BITCOIN_CONF_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-datadir=<dir>", "Specify data directory", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     argsman.AddArg("-dbcache=<n>", strprintf("Maximum database cache size <n> MiB (%d to %d, default: %d). In addition, unused mempool memory is shared for this cache (see -maxmempool).", nMinDbCache, nMaxDbCache, nDefaultDbCache), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-headerstore", strprintf("Keep the headers of the active chain serialized in memory, about 250 bytes per block, to serve them to syncing peers and REST clients without building each of them (default: %u)", node::DEFAULT_HEADERSTORE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-indexthreads=<n>", strprintf("Set the number of threads reading and preparing the blocks of -txindex, -blockfilterindex, -coinstatsindex and -blockstatsindex while they sync (0 to %d, 0 = sequential, default: %d)",
+        MAX_INDEX_THREADS, DEFAULT_INDEX_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-loadblock=<file>", "Imports blocks from external file on startup", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE_MB), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -473,25 +562,40 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s, signet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex(), signetChainParams->GetConsensus().nMinimumChainWork.GetHex()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     argsman.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-parcontracts=<n>", strprintf("Set the number of threads used to speculatively execute the contract transactions of a block in parallel, also used by callcontractbatch (0 to %d, 0 = disabled, default: %d)",
+        MAX_CONTRACTEXEC_THREADS, DEFAULT_CONTRACTEXEC_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-parmempool=<n>", strprintf("Set the number of threads used to verify the scripts of the transactions received from peers before they are accepted to the mempool (0 to %d, 0 = disabled, default: %d)",
+        MAX_TXPREVERIFY_THREADS, DEFAULT_TXPREVERIFY_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
-            "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+            "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB, which includes the size of the contract state and receipt databases)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk. This will also rebuild active optional indexes.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead. Deactivate all optional indexes before running this.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-schedulerthreads=<n>", strprintf("Set the number of background scheduler threads, the validation interface callbacks of different subscribers such as wallets, indexes and ZMQ run on them in parallel (1 to %d, default: %d)",
+        MAX_SCHEDULER_THREADS, DEFAULT_SCHEDULER_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-settings=<file>", strprintf("Specify path to dynamic settings data file. Can be disabled with -nosettings. File is written at runtime and not meant to be edited by users (use %s instead for custom settings). Relative paths will be prefixed by datadir location. (default: %s)", BITCOIN_CONF_FILENAME, BITCOIN_SETTINGS_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
-    argsman.AddArg("-record-log-opcodes", "Logs all EVM LOG opcode operations to the file vmExecLogs.json", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-record-log-opcodes", "Logs all EVM LOG opcode operations to the vmlogs directory, as newline-delimited JSON (see contrib/vmlog)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-contractprofile", strprintf("Aggregate per contract statistics of the EVM executions of blocks and block templates, queried with getcontractprofile (default: %u)", DEFAULT_CONTRACT_PROFILE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #if HAVE_SYSTEM
     argsman.AddArg("-startupnotify=<cmd>", "Execute command on startup.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-shutdownnotify=<cmd>", "Execute command immediately before beginning shutdown. The need for shutdown may be urgent, so be careful not to delay it long (if the command doesn't require interaction with the server, consider having it fork into the background).", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
     argsman.AddArg("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-txindexcache=<n>", strprintf("Keep the -txindex positions of recently indexed and looked up transactions in <n> MiB of memory, in addition to the database cache (default: %d)", DEFAULT_TXINDEX_HOT_CACHE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-blockfilterindex=<type>",
                  strprintf("Maintain an index of compact filters by block (default: %s, values: %s).", DEFAULT_BLOCKFILTERINDEX, ListBlockFilterTypes()) +
-                 " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled.",
+                 " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled."
+                 " The contract type also commits the contract addresses and log topics of the block's receipts and requires -logevents.",
                  ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-logevents", strprintf("Maintain a full EVM log index, used by searchlogs and gettransactionreceipt rpc calls (default: %u)", DEFAULT_LOGEVENTS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-statepruning=<n>", strprintf("Erase the EVM and UTXO state trie nodes that are not reachable from the states of the last <n> blocks, in the background (0 = keep all states, otherwise at least the maximum reorganization depth of the chain, default: %u)", DEFAULT_STATE_PRUNING), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-statewritecache=<n>", strprintf("Memory of the contract state trie nodes kept during the initial block download to be written together with the chainstate in MiB, taken from -dbcache (0 = write them after each block, default: %d)", nDefaultStateWriteCache), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-statedbcache=<n>", strprintf("Memory of the block cache and write buffers of the contract state databases in MiB, taken from -dbcache (0 = LevelDB defaults, default: %d)", nDefaultStateDBCache), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-logindex", strprintf("Maintain bloom filters over the EVM logs of each block, used to speed up searchlogs and waitforlogs rpc calls, requires -logevents (default: %u)", DEFAULT_LOGINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-qrc20index", strprintf("Maintain the QRC20 token transfers of each token holder, used to speed up qrc20listtransactions rpc calls, requires -logevents (default: %u)", DEFAULT_QRC20INDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-delegationindex", strprintf("Maintain the delegations of the delegation contract, used to look them up without executing the contract when staking, requires -logevents (default: %u)", DEFAULT_DELEGATIONINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-addrindex", strprintf("Maintain a full address index (default: %u)", DEFAULT_ADDRINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-deleteblockchaindata", "Delete the local copy of the block chain data", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-forceinitialblocksdownloadmode", strprintf("Force initial blocks download mode for the node (default: %u)", DEFAULT_FORCE_INITIAL_BLOCKS_DOWNLOAD_MODE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -513,6 +617,7 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-maxconnections=<n>", strprintf("Maintain at most <n> connections to peers (default: %u). This limit does not apply to connections manually added via -addnode or the addnode RPC, which have a separate limit of %u.", DEFAULT_MAX_PEER_CONNECTIONS, MAX_ADDNODE_CONNECTIONS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-maxreceivebuffer=<n>", strprintf("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXRECEIVEBUFFER), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-maxsendbuffer=<n>", strprintf("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXSENDBUFFER), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    argsman.AddArg("-msghandlerthreads=<n>", strprintf("Number of threads to process peer messages, peers are spread over them (1 to %d, default: %d)", MAX_MSGHANDLER_THREADS, DEFAULT_MSGHANDLER_THREADS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::CONNECTION);
     argsman.AddArg("-maxtimeadjustment", strprintf("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by outbound peers forward or backward by this amount (default: %u seconds).", DEFAULT_MAX_TIME_ADJUSTMENT), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-maxuploadtarget=<n>", strprintf("Tries to keep outbound traffic under the given target per 24h. Limit does not apply to peers with 'download' permission or blocks created within past week. 0 = no limit (default: %s). Optional suffix units [k|K|m|M|g|G|t|T] (default: M). Lowercase is 1000 base while uppercase is 1024 base", DEFAULT_MAX_UPLOAD_TARGET), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-onion=<ip:port>", "Use separate SOCKS5 proxy to reach peers via Tor onion services, set -noonion to disable (default: -proxy)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
@@ -521,6 +626,7 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-onlynet=<net>", "Make automatic outbound connections only to network <net> (" + Join(GetNetworkNames(), ", ") + "). Inbound and manual connections are not affected by this option. It can be specified multiple times to allow multiple networks.", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-peerblockfilters", strprintf("Serve compact block filters to peers per BIP 157 (default: %u)", DEFAULT_PEERBLOCKFILTERS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    argsman.AddArg("-peercontractstate", strprintf("Serve the contract state to peers downloading it with synccontractstate (default: %u)", DEFAULT_PEERCONTRACTSTATE), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-txreconciliation", strprintf("Enable transaction reconciliations per BIP 330 (default: %d)", DEFAULT_TXRECONCILIATION_ENABLE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::CONNECTION);
     // TODO: remove the sentence "Nodes not using ... incoming connections." once the changes from
     // https://github.com/bitcoin/bitcoin/pull/23542 have become widespread.
@@ -536,6 +642,7 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-dgpstorage", "Receiving data from DGP via storage (default: -dgpevm)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-dgpevm", "Receiving data from DGP via a contract call (default: -dgpevm)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-hwitoolpath=<path>", "Specify HWI tool path", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-hwihelperpath=<path>", "Specify the path of a helper that keeps running and runs the HWI tool commands (contrib/hwi/hwi-helper.py), instead of starting the HWI tool for each command", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #ifdef USE_UPNP
 #if USE_UPNP
     argsman.AddArg("-upnp", "Use UPnP to map the listening port (default: 1 when listening and no -proxy)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
@@ -566,26 +673,35 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-zmqpubrawblock=<address>", "Enable publish raw block in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubrawtx=<address>", "Enable publish raw transaction in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubsequence=<address>", "Enable publish hash block and tx sequence in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubreceipt=<address>", "Enable publish contract receipts of connected blocks in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubcontractlog=<address>", "Enable publish contract log entries of connected blocks in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubhashblockhwm=<n>", strprintf("Set publish hash block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubhashtxhwm=<n>", strprintf("Set publish hash transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubrawblockhwm=<n>", strprintf("Set publish raw block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubrawtxhwm=<n>", strprintf("Set publish raw transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubsequencehwm=<n>", strprintf("Set publish hash sequence message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubreceipthwm=<n>", strprintf("Set publish contract receipt outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubcontractloghwm=<n>", strprintf("Set publish contract log outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
 #else
     hidden_args.emplace_back("-zmqpubhashblock=<address>");
     hidden_args.emplace_back("-zmqpubhashtx=<address>");
     hidden_args.emplace_back("-zmqpubrawblock=<address>");
     hidden_args.emplace_back("-zmqpubrawtx=<address>");
     hidden_args.emplace_back("-zmqpubsequence=<n>");
+    hidden_args.emplace_back("-zmqpubreceipt=<address>");
+    hidden_args.emplace_back("-zmqpubcontractlog=<address>");
     hidden_args.emplace_back("-zmqpubhashblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubhashtxhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawtxhwm=<n>");
     hidden_args.emplace_back("-zmqpubsequencehwm=<n>");
+    hidden_args.emplace_back("-zmqpubreceipthwm=<n>");
+    hidden_args.emplace_back("-zmqpubcontractloghwm=<n>");
 #endif
 
     argsman.AddArg("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-checklevel=<n>", strprintf("How thorough the block verification of -checkblocks is: %s (0-4, default: %u)", Join(CHECKLEVEL_DOC, ", "), DEFAULT_CHECKLEVEL), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    argsman.AddArg("-checkstateroots=<n>", strprintf("Check in the background after startup that the contract state roots of the last <n> blocks are stored and intact, without executing the blocks again (0 = disable, default: %u)", DEFAULT_CHECKSTATEROOTS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-checkblockindex", strprintf("Do a consistency check for the block tree, chainstate, and other validation data structures occasionally. (default: %u, regtest: %u)", defaultChainParams->DefaultConsistencyChecks(), regtestChainParams->DefaultConsistencyChecks()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-checkaddrman=<n>", strprintf("Run addrman consistency checks every <n> operations. Use 0 to disable. (default: %u)", DEFAULT_ADDRMAN_CONSISTENCY_CHECKS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-checkmempool=<n>", strprintf("Run mempool consistency checks every <n> transactions. Use 0 to disable. (default: %u, regtest: %u)", defaultChainParams->DefaultConsistencyChecks(), regtestChainParams->DefaultConsistencyChecks()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
@@ -600,7 +716,9 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-addrmantest", "Allows to test address relay on localhost", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-capturemessages", "Capture all P2P messages to disk", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-showevmlogs", strprintf("Print evm logs to console (default: %u)", DEFAULT_SHOWEVMLOGS), ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
+    argsman.AddArg("-lockstats", strprintf("Record the wait and hold times of the locks per source location, reported by getlockstats (default: %u)", DEFAULT_LOCK_STATS), ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-mocktime=<n>", "Replace actual time with " + UNIX_EPOCH_TIME + " (default: 0)", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    argsman.AddArg("-adaptivecaches", strprintf("Move memory between the signature, script execution, receipts and contract state caches by their hit rates, within their total size (default: %u)", DEFAULT_ADAPTIVE_CACHES), ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-maxsigcachesize=<n>", strprintf("Limit sum of signature cache and script execution cache sizes to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_BYTES >> 20), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-maxtipage=<n>",
                    strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)",
@@ -643,6 +761,7 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-whitelistrelay", strprintf("Add 'relay' permission to whitelisted inbound peers with default permissions. This will accept relayed transactions even when not relaying transactions (default: %d)", DEFAULT_WHITELISTRELAY), ArgsManager::ALLOW_ANY, OptionsCategory::NODE_RELAY);
 
 
+    argsman.AddArg("-blockclusters", strprintf("Select the block transactions from the linearized clusters of connected mempool transactions instead of their ancestor packages (default: %u)", DEFAULT_BLOCK_CLUSTERS), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     argsman.AddArg("-blockmaxweight=<n>", strprintf("Set maximum BIP141 block weight (default: %d)", DEFAULT_BLOCK_MAX_WEIGHT), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     argsman.AddArg("-blockmintxfee=<amt>", strprintf("Set lowest fee rate (in %s/kvB) for transactions to be included in block creation. (default: %s)", CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     argsman.AddArg("-blockversion=<n>", "Override block version to test forking scenarios", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::BLOCK_CREATION);
@@ -650,12 +769,15 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-staker-min-tx-gas-price=<amt>", "Any contract execution with a gas price below this will not be included in a block (defaults to the value specified by the DGP)", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     argsman.AddArg("-staker-max-tx-gas-limit=<n>", "Any contract execution with a gas limit over this amount will not be included in a block (defaults to soft block gas limit)", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     argsman.AddArg("-staker-soft-block-gas-limit=<n>", "After this amount of gas is surpassed in a block, no more contract executions will be added to the block (defaults to consensus-critical maximum block gas limit)", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-staker-prepare-template", strprintf("Select the transactions and execute the contracts of the next block as soon as a new tip is connected, so that the block is ready when a kernel is found (default: %u)", node::DEFAULT_STAKER_PREPARE_TEMPLATE), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     argsman.AddArg("-aggressive-staking", "Check more often to publish immediately when valid block is found.", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     argsman.AddArg("-emergencystaking", "Emergency staking without blockchain synchronization.", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
 
+    argsman.AddArg("-metrics", strprintf("Serve the node metrics in the Prometheus text format at /metrics on the RPC port, with the RPC authentication (default: %u)", DEFAULT_METRICS_ENABLE), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     argsman.AddArg("-rest", strprintf("Accept public REST requests (default: %u)", DEFAULT_REST_ENABLE), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     argsman.AddArg("-rpcallowip=<ip>", "Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     argsman.AddArg("-rpcauth=<userpw>", "Username and HMAC-SHA-256 hashed password for JSON-RPC connections. The field <userpw> comes in the format: <USERNAME>:<SALT>$<HASH>. A canonical python script is included in share/rpcauth. The client then connects normally using the rpcuser=<USERNAME>/rpcpassword=<PASSWORD> pair of arguments. This option can be specified multiple times", ArgsManager::ALLOW_ANY | ArgsManager::SENSITIVE, OptionsCategory::RPC);
+    argsman.AddArg("-rpcbatchthreads=<n>", strprintf("Set the number of threads that execute the calls of one JSON-RPC batch at the same time. Calls beyond the first are only handed to RPC threads that are idle. With more than one thread the calls of a batch run in no fixed order, so batches must not rely on the effects of their earlier calls (default: %d)", DEFAULT_RPC_BATCH_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     argsman.AddArg("-rpcbind=<addr>[:port]", "Bind to given address to listen for JSON-RPC connections. Do not expose the RPC server to untrusted networks such as the public internet! This option is ignored unless -rpcallowip is also passed. Port is optional and overrides -rpcport. Use [host]:port notation for IPv6. This option can be specified multiple times (default: 127.0.0.1 and ::1 i.e., localhost)", ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::RPC);
     argsman.AddArg("-rpcdoccheck", strprintf("Throw a non-fatal error at runtime if the documentation for an RPC is incorrect (default: %u)", DEFAULT_RPC_DOC_CHECK), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::RPC);
     argsman.AddArg("-rpccookiefile=<loc>", "Location of the auth cookie. Relative paths will be prefixed by a net-specific datadir location. (default: data dir)", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
@@ -664,10 +786,12 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-rpcserialversion", strprintf("Sets the serialization of raw transaction or block hex returned in non-verbose mode, non-segwit(0) or segwit(1) (default: %d)", DEFAULT_RPC_SERIALIZE_VERSION), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     argsman.AddArg("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::RPC);
     argsman.AddArg("-rpcthreads=<n>", strprintf("Set the number of threads to service RPC calls (default: %d)", DEFAULT_HTTP_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
+    argsman.AddArg("-rpcheavythreads=<n>", strprintf("Set the number of threads to service RPC calls that can take long to compute, like searchlogs or qrc20listtransactions (default: %d)", DEFAULT_HTTP_HEAVY_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
+    argsman.AddArg("-rpclongpollthreads=<n>", strprintf("Set the number of threads to service RPC calls that wait for new blocks, like waitforlogs (default: %d)", DEFAULT_HTTP_LONGPOLL_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     argsman.AddArg("-rpcuser=<user>", "Username for JSON-RPC connections", ArgsManager::ALLOW_ANY | ArgsManager::SENSITIVE, OptionsCategory::RPC);
     argsman.AddArg("-rpcwhitelist=<whitelist>", "Set a whitelist to filter incoming RPC calls for a specific user. The field <whitelist> comes in the format: <USERNAME>:<rpc 1>,<rpc 2>,...,<rpc n>. If multiple whitelists are set for a given user, they are set-intersected. See -rpcwhitelistdefault documentation for information on default whitelist behavior.", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     argsman.AddArg("-rpcwhitelistdefault", "Sets default behavior for rpc whitelisting. Unless rpcwhitelistdefault is set to 0, if any -rpcwhitelist is set, the rpc server acts as if all rpc users are subject to empty-unless-otherwise-specified whitelists. If rpcwhitelistdefault is set to 1 and no -rpcwhitelist is set, rpc server acts as if all rpc users are subject to empty whitelists.", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
-    argsman.AddArg("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::RPC);
+    argsman.AddArg("-rpcworkqueue=<n>", strprintf("Set the depth of each of the work queues to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::RPC);
     argsman.AddArg("-server", "Accept command line and JSON-RPC commands", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
 
 #if HAVE_DECL_FORK
@@ -745,6 +869,7 @@ static bool AppInitServers(NodeContext& node)
     if (!StartHTTPRPC(&node))
         return false;
     if (args.GetBoolArg("-rest", DEFAULT_REST_ENABLE)) StartREST(&node);
+    if (args.GetBoolArg("-metrics", DEFAULT_METRICS_ENABLE)) StartHTTPMetrics();
     StartHTTPServer();
     return true;
 }
@@ -965,8 +1090,11 @@ bool AppInitParameterInteraction(const ArgsManager& args, bool use_syscall_sandb
 
     // parse and validate enabled filter types
     std::string blockfilterindex_value = args.GetArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+    const bool log_events = args.GetBoolArg("-logevents", DEFAULT_LOGEVENTS);
     if (blockfilterindex_value == "" || blockfilterindex_value == "1") {
         g_enabled_filter_types = AllBlockFilterTypes();
+        // Contract filters are built from the receipts, only index them when those are kept
+        if (!log_events) g_enabled_filter_types.erase(BlockFilterType::CONTRACT);
     } else if (blockfilterindex_value != "0") {
         const std::vector<std::string> names = args.GetArgs("-blockfilterindex");
         for (const auto& name : names) {
@@ -974,6 +1102,9 @@ bool AppInitParameterInteraction(const ArgsManager& args, bool use_syscall_sandb
             if (!BlockFilterTypeByName(name, filter_type)) {
                 return InitError(strprintf(_("Unknown -blockfilterindex value %s."), name));
             }
+            if (filter_type == BlockFilterType::CONTRACT && !log_events) {
+                return InitError(_("-blockfilterindex=contract requires -logevents to be enabled."));
+            }
             g_enabled_filter_types.insert(filter_type);
         }
     }
@@ -987,9 +1118,22 @@ bool AppInitParameterInteraction(const ArgsManager& args, bool use_syscall_sandb
         nLocalServices = ServiceFlags(nLocalServices | NODE_COMPACT_FILTERS);
     }
 
+    if (args.GetBoolArg("-peercontractstate", DEFAULT_PEERCONTRACTSTATE)) {
+        nLocalServices = ServiceFlags(nLocalServices | NODE_CONTRACT_STATE);
+    }
+
+    const int64_t state_pruning = args.GetIntArg("-statepruning", DEFAULT_STATE_PRUNING);
+    // The states of every block a reorganization may disconnect have to be kept
+    const int64_t min_state_pruning = std::max<int64_t>(MIN_BLOCKS_TO_KEEP, chainparams.GetConsensus().MaxCheckpointSpan());
+    if (state_pruning < 0 || (state_pruning > 0 && state_pruning < min_state_pruning) || state_pruning > std::numeric_limits<int>::max()) {
+        return InitError(strprintf(_("-statepruning must be 0 or at least %d blocks."), min_state_pruning));
+    }
+
     if (args.GetIntArg("-prune", 0)) {
         if (args.GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX))
+            return InitError(_("Prune mode is incompatible with -addrindex."));
         if (args.GetBoolArg("-reindex-chainstate", false)) {
             return InitError(_("Prune mode is incompatible with -reindex-chainstate. Use full -reindex instead."));
         }
@@ -1037,6 +1181,8 @@ bool AppInitParameterInteraction(const ArgsManager& args, bool use_syscall_sandb
     init::SetLoggingCategories(args);
     init::SetLoggingLevel(args);
 
+    g_lock_stats = args.GetBoolArg("-lockstats", DEFAULT_LOCK_STATS);
+
     nConnectTimeout = args.GetIntArg("-timeout", DEFAULT_CONNECT_TIMEOUT);
     if (nConnectTimeout <= 0) {
         nConnectTimeout = DEFAULT_CONNECT_TIMEOUT;
@@ -1073,10 +1219,25 @@ bool AppInitParameterInteraction(const ArgsManager& args, bool use_syscall_sandb
 
     if (args.GetBoolArg("-reindex-chainstate", false)) {
         // indexes that must be deactivated to prevent index corruption, see #24630
+        if (args.GetBoolArg("-logindex", DEFAULT_LOGINDEX)) {
+            return InitError(_("-reindex-chainstate option is not compatible with -logindex. Please temporarily disable logindex while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
+        }
+        if (args.GetBoolArg("-qrc20index", DEFAULT_QRC20INDEX)) {
+            return InitError(_("-reindex-chainstate option is not compatible with -qrc20index. Please temporarily disable qrc20index while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
+        }
+        if (args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX)) {
+            return InitError(_("-reindex-chainstate option is not compatible with -addrindex. Please temporarily disable addrindex while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
+        }
+        if (args.GetBoolArg("-delegationindex", DEFAULT_DELEGATIONINDEX)) {
+            return InitError(_("-reindex-chainstate option is not compatible with -delegationindex. Please temporarily disable delegationindex while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
+        }
+        if (args.GetBoolArg("-blockstatsindex", DEFAULT_BLOCKSTATSINDEX)) {
+            return InitError(_("-reindex-chainstate option is not compatible with -blockstatsindex. Please temporarily disable blockstatsindex while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
+        }
         if (args.GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX)) {
             return InitError(_("-reindex-chainstate option is not compatible with -coinstatsindex. Please temporarily disable coinstatsindex while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
         }
-        if (g_enabled_filter_types.count(BlockFilterType::BASIC)) {
+        if (!g_enabled_filter_types.empty()) {
             return InitError(_("-reindex-chainstate option is not compatible with -blockfilterindex. Please temporarily disable blockfilterindex while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
         }
         if (args.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
@@ -1403,6 +1564,20 @@ bool AppInitInterfaces(NodeContext& node)
     return true;
 }
 
+/** Run the steps of @p verifier on the scheduler, one at a time so that they do not delay the other tasks */
+static void ScheduleStateRootCheck(CScheduler& scheduler, std::shared_ptr<StateRootVerifier> verifier, std::chrono::milliseconds delay)
+{
+    scheduler.scheduleFromNow([&scheduler, verifier] {
+        if (verifier->Step()) {
+            ScheduleStateRootCheck(scheduler, verifier, std::chrono::milliseconds{100});
+        } else if (verifier->Result() == VerifyDBResult::CORRUPTED_BLOCK_DB) {
+            SetMiscWarning(_("The contract state database is corrupted, restart with -reindex-chainstate to rebuild it."));
+        } else if (!ShutdownRequested()) {
+            LogPrintf("Verified %d contract state roots\n", verifier->Checked());
+        }
+    }, delay);
+}
+
 bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 {
     const ArgsManager& args = *Assert(node.args);
@@ -1463,13 +1638,24 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     LogPrintf("Script verification uses %d additional threads\n", script_threads);
     if (script_threads >= 1) {
         StartScriptCheckWorkerThreads(script_threads);
+        StartHeadersSyncWorkerThreads(script_threads);
+    }
+
+    int contract_threads = std::clamp<int>(args.GetIntArg("-parcontracts", DEFAULT_CONTRACTEXEC_THREADS), 0, MAX_CONTRACTEXEC_THREADS);
+    if (contract_threads >= 1) {
+        LogPrintf("Contract execution uses %d speculative threads\n", contract_threads);
+        StartContractExecWorkerThreads(contract_threads);
     }
 
     assert(!node.scheduler);
     node.scheduler = std::make_unique<CScheduler>();
 
-    // Start the lightweight task scheduler thread
+    // Start the lightweight task scheduler threads
     node.scheduler->m_service_thread = std::thread(util::TraceThread, "scheduler", [&] { node.scheduler->serviceQueue(); });
+    const int scheduler_threads = std::clamp<int>(args.GetIntArg("-schedulerthreads", DEFAULT_SCHEDULER_THREADS), 1, MAX_SCHEDULER_THREADS);
+    for (int i = 1; i < scheduler_threads; ++i) {
+        node.scheduler->m_extra_service_threads.emplace_back(util::TraceThread, strprintf("scheduler.%d", i), [&] { node.scheduler->serviceQueue(); });
+    }
 
     // Gather some entropy once per minute.
     node.scheduler->scheduleEvery([]{
@@ -1608,6 +1794,8 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         "-zmqpubrawblock",
         "-zmqpubrawtx",
         "-zmqpubsequence",
+        "-zmqpubreceipt",
+        "-zmqpubcontractlog",
     }) {
         for (const std::string& socket_addr : args.GetArgs(port_option)) {
             std::string host_out;
@@ -1759,6 +1947,10 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     // ********************************************************* Step 7: load block chain
 
     fReindex = args.GetBoolArg("-reindex", false);
+    fMmapBlockFiles = args.GetBoolArg("-mmapblocks", DEFAULT_MMAP_BLOCK_FILES);
+    g_block_file_chunk_size = std::clamp<int64_t>(args.GetIntArg("-blockfilechunksize", BLOCKFILE_CHUNK_SIZE >> 20), 1, MAX_BLOCKFILE_SIZE >> 20) << 20;
+    g_undo_file_chunk_size = std::clamp<int64_t>(args.GetIntArg("-undofilechunksize", UNDOFILE_CHUNK_SIZE >> 20), 1, MAX_BLOCKFILE_SIZE >> 20) << 20;
+    g_block_write_buffer_size = std::clamp<int64_t>(args.GetIntArg("-blockwritebuffer", DEFAULT_BLOCK_WRITE_BUFFER), 0, MAX_BLOCKFILE_SIZE >> 20) << 20;
     bool fReindexChainState = args.GetBoolArg("-reindex-chainstate", false);
     ChainstateManager::Options chainman_opts{
         .chainparams = chainparams,
@@ -1775,9 +1967,18 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1f MiB for block index database\n", cache_sizes.block_tree_db * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1f MiB for height, stake and delegate index database\n", cache_sizes.qtum_index_db * (1.0 / 1024 / 1024));
     if (args.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
         LogPrintf("* Using %.1f MiB for transaction index database\n", cache_sizes.tx_index * (1.0 / 1024 / 1024));
     }
+    if (args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX)) {
+        LogPrintf("* Using %.1f MiB for address index database\n", cache_sizes.address_index * (1.0 / 1024 / 1024));
+    }
+    if (args.GetBoolArg("-logevents", DEFAULT_LOGEVENTS)) {
+        LogPrintf("* Using %.1f MiB for transaction receipts cache\n", cache_sizes.receipts * (1.0 / 1024 / 1024));
+    }
+    LogPrintf("* Using %.1f MiB for contract state database\n", cache_sizes.state_db * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1f MiB for contract state writes\n", cache_sizes.state_writes * (1.0 / 1024 / 1024));
     for (BlockFilterType filter_type : g_enabled_filter_types) {
         LogPrintf("* Using %.1f MiB for %s block filter index database\n",
                   cache_sizes.filter_index * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
@@ -1829,7 +2030,11 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
             options.getting_values_dgp = false;
         }
         options.record_log_opcodes = args.IsArgSet("-record-log-opcodes");
-        options.addrindex = args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX);
+        if (options.record_log_opcodes && !g_vmlog_writer) {
+            g_vmlog_writer = std::make_unique<VMLogWriter>(args.GetDataDirNet() / "vmlogs");
+        }
+        g_contract_profiler.SetEnabled(args.GetBoolArg("-contractprofile", DEFAULT_CONTRACT_PROFILE));
+        fAddressIndex = args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX);
         options.logevents = args.GetBoolArg("-logevents", DEFAULT_LOGEVENTS);
 
         uiInterface.InitMessage(_("Loading block index…").translated);
@@ -1890,18 +2095,43 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 
     ChainstateManager& chainman = *Assert(node.chainman);
 
+    if (args.GetBoolArg("-adaptivecaches", DEFAULT_ADAPTIVE_CACHES)) {
+        node.cache_tuner = std::make_unique<CacheTuner>(GetNodeCaches());
+        LogPrintf("* Moving memory between the caches by their hit rates, within %.1f MiB\n", node.cache_tuner->Budget() * (1.0 / 1024 / 1024));
+        node.scheduler->scheduleEvery([tuner = node.cache_tuner.get()] { tuner->Adjust(); }, CACHE_TUNER_INTERVAL);
+    }
+
+    // The network stake weight and annual ROI are estimated once per connected block
+    g_stake_estimator = std::make_unique<StakeEstimator>(chainman.GetConsensus());
+    g_stake_estimator->Reset(WITH_LOCK(::cs_main, return chainman.ActiveChain().Tip()));
+    RegisterValidationInterface(g_stake_estimator.get());
+
     assert(!node.peerman);
     node.peerman = PeerManager::make(*node.connman, *node.addrman, node.banman.get(),
                                      chainman, *node.mempool, ignores_incoming_txs);
     RegisterValidationInterface(node.peerman.get());
 
+    if (args.GetBoolArg("-headerstore", node::DEFAULT_HEADERSTORE)) {
+        // The store catches up with the active chain a few headers at a time, ahead of the requests
+        g_header_store = std::make_unique<node::HeaderStore>();
+        node.scheduler->scheduleEvery([&chainman] {
+            LOCK(cs_main);
+            g_header_store->Sync(chainman.ActiveChain());
+        }, node::HEADERSTORE_SYNC_INTERVAL);
+    }
+
     // ********************************************************* Step 8: start indexers
+    if (!WITH_LOCK(cs_main, return EraseLegacyAddressIndex(*Assert(chainman.m_blockman.m_block_tree_db)))) {
+        return InitError(Untranslated("Failed to erase the legacy address index from the block index db"));
+    }
+
     if (args.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
         if (const auto error{WITH_LOCK(cs_main, return CheckLegacyTxindex(*Assert(chainman.m_blockman.m_block_tree_db)))}) {
             return InitError(*error);
         }
 
-        g_txindex = std::make_unique<TxIndex>(interfaces::MakeChain(node), cache_sizes.tx_index, false, fReindex);
+        const int64_t hot_cache_size = std::max<int64_t>(0, args.GetIntArg("-txindexcache", DEFAULT_TXINDEX_HOT_CACHE)) << 20;
+        g_txindex = std::make_unique<TxIndex>(interfaces::MakeChain(node), cache_sizes.tx_index, false, fReindex, hot_cache_size);
         if (!g_txindex->Start()) {
             return false;
         }
@@ -1921,6 +2151,61 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         }
     }
 
+    if (args.GetBoolArg("-blockstatsindex", DEFAULT_BLOCKSTATSINDEX)) {
+        g_block_stats_index = std::make_unique<BlockStatsIndex>(interfaces::MakeChain(node), /*cache_size=*/0, false, fReindex);
+        if (!g_block_stats_index->Start()) {
+            return false;
+        }
+    }
+
+    if (args.GetBoolArg("-logindex", DEFAULT_LOGINDEX)) {
+        if (!fLogEvents) {
+            return InitError(_("-logindex requires -logevents to be enabled."));
+        }
+        g_logindex = std::make_unique<LogIndex>(interfaces::MakeChain(node), /*cache_size=*/0, false, fReindex);
+        if (!g_logindex->Start()) {
+            return false;
+        }
+    }
+
+    if (args.GetBoolArg("-qrc20index", DEFAULT_QRC20INDEX)) {
+        if (!fLogEvents) {
+            return InitError(_("-qrc20index requires -logevents to be enabled."));
+        }
+        g_qrc20index = std::make_unique<Qrc20Index>(interfaces::MakeChain(node), /*cache_size=*/0, false, fReindex);
+        if (!g_qrc20index->Start()) {
+            return false;
+        }
+    }
+
+    if (args.GetBoolArg("-delegationindex", DEFAULT_DELEGATIONINDEX)) {
+        if (!fLogEvents) {
+            return InitError(_("-delegationindex requires -logevents to be enabled."));
+        }
+        g_delegationindex = std::make_unique<DelegationIndex>(interfaces::MakeChain(node), /*cache_size=*/0, false, fReindex);
+        if (!g_delegationindex->Start()) {
+            return false;
+        }
+    }
+
+    if (args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX)) {
+        g_addressindex = std::make_unique<AddressIndex>(interfaces::MakeChain(node), cache_sizes.address_index, false, fReindex);
+        if (!g_addressindex->Start()) {
+            return false;
+        }
+    }
+
+    if (const int64_t keep_blocks = args.GetIntArg("-statepruning", DEFAULT_STATE_PRUNING)) {
+        g_state_pruner = std::make_unique<StatePruner>(chainman, keep_blocks);
+        g_state_pruner->Start();
+    }
+
+    if (int check_depth = args.GetIntArg("-checkstateroots", DEFAULT_CHECKSTATEROOTS); check_depth > 0) {
+        // The states below the pruning depth are expected to be gone
+        if (g_state_pruner) check_depth = std::min(check_depth, g_state_pruner->KeepBlocks() - 1);
+        ScheduleStateRootCheck(*node.scheduler, std::make_shared<StateRootVerifier>(chainman.ActiveChainstate(), check_depth), std::chrono::seconds{1});
+    }
+
     // ********************************************************* Step 9: load wallet
     for (const auto& client : node.chain_clients) {
         if (!client->load()) {
@@ -2062,6 +2347,7 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     connOptions.nSendBufferMaxSize = 1000 * args.GetIntArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000 * args.GetIntArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
     connOptions.m_added_nodes = args.GetArgs("-addnode");
+    connOptions.m_msghandler_threads = args.GetIntArg("-msghandlerthreads", DEFAULT_MSGHANDLER_THREADS);
     connOptions.nMaxOutboundLimit = *opt_max_upload;
     connOptions.m_peer_connect_timeout = peer_connect_timeout;
 
@@ -38,6 +38,7 @@ void AddLoggingArgs(ArgsManager& argsman)
 #else
     argsman.AddHiddenArgs({"-logthreadnames"});
 #endif
+    argsman.AddArg("-logqueue=<n>", strprintf("Write the debug output on a separate thread, queueing up to <n> messages and dropping the messages that do not fit, which are counted in the log. Messages at the error level are written synchronously. 0 writes the debug output on the threads logging (default: %u)", DEFAULT_LOGQUEUE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-logsourcelocations", strprintf("Prepend debug output with name of the originating source location (source file, line number and function name) (default: %u)", DEFAULT_LOGSOURCELOCATIONS), ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-printtoconsole", "Send trace/debug info to console (default: 1 when no -daemon. To disable logging to file, set -nodebuglogfile)", ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
@@ -119,6 +120,9 @@ bool StartLogging(const ArgsManager& args)
             return InitError(strprintf(Untranslated("Could not open debug log file %s"),
                 fs::PathToString(LogInstance().m_file_path)));
     }
+    if (const int64_t log_queue{args.GetIntArg("-logqueue", DEFAULT_LOGQUEUE)}; log_queue > 0) {
+        LogInstance().StartAsyncLogging(log_queue);
+    }
 
 ////////////////////////////////////////////////////////////////////// // qtum
     dev::g_logPost(std::string("\n\n\n\n\n\n\n\n\n\n"), NULL);
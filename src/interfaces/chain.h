@@ -9,6 +9,7 @@
 #include <primitives/transaction.h> // For CTransactionRef
 #include <util/settings.h>          // For util::SettingsValue
 #include <netbase.h>                // For ConnectionDirection
+#include <uint256.h>                // For TokenTransfer
 
 #include <functional>
 #include <memory>
@@ -111,6 +112,17 @@ struct BlockInfo {
     BlockInfo(const uint256& hash LIFETIMEBOUND) : hash(hash) {}
 };
 
+//! QRC20 Transfer or Burn event of a connected block.
+struct TokenTransfer {
+    uint160 contract_address;
+    uint160 sender;
+    //! Null for a burn
+    uint160 receiver;
+    uint256 value;
+    uint256 txid;
+    bool burn{false};
+};
+
 //! Interface giving clients (wallet processes, maybe other analysis tools in
 //! the future) ability to access to the chain state, receive notifications,
 //! estimate fees, and submit transactions.
@@ -376,6 +388,10 @@ public:
     //! Get transaction gas fee.
     virtual CAmount getTxGasFee(const CMutableTransaction& tx) = 0;
 
+    //! Get the QRC20 Transfer and Burn events of a connected block, in the order they were
+    //! emitted. Empty when the receipts are not stored (-logevents is off).
+    virtual std::vector<TokenTransfer> getTokenTransfers(const CBlock& block, const uint256& block_hash, int height) = 0;
+
 #ifdef ENABLE_WALLET
     //! Start staking qtums.
     virtual void startStake(wallet::CWallet& wallet) = 0;
@@ -16,6 +16,7 @@
 
 #include <functional>
 #include <memory>
+#include <optional>
 #include <stddef.h>
 #include <stdint.h>
 #include <string>
@@ -55,6 +56,68 @@ struct BlockAndHeaderTipInfo
     double verification_progress;
 };
 
+//! Filter of a contract log query.
+struct LogQuery
+{
+    int from_block{0};
+    //! -1 for the chain tip
+    int to_block{-1};
+    int minconf{0};
+    //! Hex contract addresses, all the contracts if empty
+    std::vector<std::string> addresses;
+    //! Hex topics by position, one of which must match, empty strings match any topic
+    std::vector<std::string> topics;
+};
+
+//! Log entry of a receipt returned by a log query.
+struct LogQueryEntry
+{
+    std::string address;
+    std::vector<std::string> topics;
+    std::string data;
+};
+
+//! Receipt with logs returned by a log query.
+struct LogQueryReceipt
+{
+    uint256 block_hash;
+    int block_number{0};
+    uint256 tx_hash;
+    uint32_t tx_index{0};
+    uint32_t output_index{0};
+    std::string contract_address;
+    std::vector<LogQueryEntry> logs;
+};
+
+//! Position to continue a log query from.
+struct LogQueryCursor
+{
+    int block_number{0};
+    uint32_t tx_index{0};
+    uint32_t output_index{0};
+};
+
+//! Read-only contract call made by the GUI.
+struct ContractViewCall
+{
+    //! Hex contract address
+    std::string address;
+    //! Hex call data
+    std::string data;
+    //! Hex sender address, empty for none
+    std::string sender;
+};
+
+//! Result of a read-only contract call.
+struct ContractViewResult
+{
+    //! False when the contract does not exist or the call could not run
+    bool executed{false};
+    bool excepted{false};
+    //! Hex output of the call
+    std::string output;
+};
+
 //! External signer interface used by the GUI.
 class ExternalSigner
 {
@@ -243,6 +306,16 @@ public:
     //! Get PoS kernel PS
     virtual double getPoSKernelPS() = 0;
 
+    //! Search a page of at most limit receipts with logs matching the query, in chain order.
+    //! The search starts from the cursor, or from the first block of the query when it is empty,
+    //! and the cursor is set to the next page, or cleared when the search is complete.
+    //! Returns false if the log events are not indexed or the query is invalid.
+    virtual bool searchLogs(const LogQuery& query, size_t limit, std::optional<LogQueryCursor>& cursor, std::vector<LogQueryReceipt>& receipts) = 0;
+
+    //! Run read-only contract calls at the same tip, without holding cs_main while they run.
+    //! Returns the height of that tip, the results are in the order of the calls.
+    virtual int callContracts(const std::vector<ContractViewCall>& calls, std::vector<ContractViewResult>& results) = 0;
+
     //! Register handler for init messages.
     using InitMessageFn = std::function<void(const std::string& message)>;
     virtual std::unique_ptr<Handler> handleInitMessage(InitMessageFn fn) = 0;
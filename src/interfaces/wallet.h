@@ -194,6 +194,9 @@ public:
     //! Get list of all wallet transactions.
     virtual std::set<WalletTx> getWalletTxs() = 0;
 
+    //! Get the number of wallet transactions.
+    virtual size_t getWalletTxCount() = 0;
+
     //! Try to get updated status for a particular transaction, if possible without blocking.
     virtual bool tryGetTxStatus(const uint256& txid,
         WalletTxStatus& tx_status,
@@ -319,6 +322,9 @@ public:
     //! Get list of all wallet token transactions.
     virtual std::vector<TokenTx> getTokenTxs() = 0;
 
+    //! Get a page of the token transactions of a contract address and a sender or receiver address, most recent first.
+    virtual std::vector<TokenTx> getTokenTxs(const std::string& contract_address, const std::string& address, size_t offset, size_t count) = 0;
+
     //! Get token information.
     virtual TokenInfo getToken(const uint256& id) = 0;
 
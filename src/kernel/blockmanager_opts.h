@@ -5,6 +5,10 @@
 #ifndef BITCOIN_KERNEL_BLOCKMANAGER_OPTS_H
 #define BITCOIN_KERNEL_BLOCKMANAGER_OPTS_H
 
+#include <util/fs.h>
+
+#include <cstdint>
+
 namespace kernel {
 
 /**
@@ -13,6 +17,8 @@ namespace kernel {
  */
 struct BlockManagerOpts {
     uint64_t prune_target{0};
+    //! Directory of the Qtum state and receipt databases, whose size counts toward the prune target
+    fs::path qtum_state_dir{};
 };
 
 } // namespace kernel
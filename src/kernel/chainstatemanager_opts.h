@@ -13,9 +13,14 @@
 
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <optional>
+#include <vector>
 
+class CBlockIndex;
 class CChainParams;
+struct QtumContext;
+struct TransactionReceiptInfo;
 
 static constexpr bool DEFAULT_CHECKPOINTS_ENABLED{true};
 static constexpr auto DEFAULT_MAX_TIP_AGE{12h}; //Changed to 12 hours so that isInitialBlockDownload() is more accurate
@@ -42,6 +47,12 @@ struct ChainstateManagerOpts {
     DBOptions block_tree_db{};
     DBOptions coins_db{};
     CoinsViewOptions coins_view{};
+    //! Contract state, seal engine and receipt storage to validate with. If unset, the process-wide
+    //! context of globalState, globalSealEngine and pstorageresult is used.
+    std::shared_ptr<QtumContext> qtum_context{};
+    //! If set, called under cs_main with the receipts of each connected block that has contract
+    //! transactions, before the BlockReceiptsConnected notification is queued.
+    std::function<void(const CBlockIndex&, const std::vector<TransactionReceiptInfo>&)> receipts_callback{};
 };
 
 } // namespace kernel
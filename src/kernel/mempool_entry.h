@@ -22,6 +22,7 @@
 #include <stdint.h>
 
 class CBlockIndex;
+struct MempoolContractTxs;
 
 struct LockPoints {
     // Will be set to the blockchain height and median time past
@@ -84,6 +85,9 @@ private:
     CAmount m_modified_fee;         //!< Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints;          //!< Track the height and time at which tx was final
     CAmount nMinGasPrice{0};   //!< The minimum gas price among the contract outputs of the tx
+    uint64_t nGasLimit{0};     //!< The gas limit summed over the contract outputs of the tx
+    //! The contract transactions extracted from the tx on acceptance, reused by the block assembler and ConnectBlock
+    const std::shared_ptr<const MempoolContractTxs> m_contract_txs;
 
     // Information about descendants of this transaction that are in the
     // mempool; if we remove this transaction we must remove all of these
@@ -97,16 +101,18 @@ private:
     uint64_t nSizeWithAncestors;
     CAmount nModFeesWithAncestors;
     int64_t nSigOpCostWithAncestors;
+    uint64_t nGasLimitWithAncestors;
 
 public:
     CTxMemPoolEntry(const CTransactionRef& tx, CAmount fee,
                     int64_t time, unsigned int entry_height,
                     bool spends_coinbase,
-                    int64_t sigops_cost, LockPoints lp, CAmount min_gas_price = 0)
+                    int64_t sigops_cost, LockPoints lp, CAmount min_gas_price = 0, uint64_t gas_limit = 0,
+                    std::shared_ptr<const MempoolContractTxs> contract_txs = nullptr, size_t contract_txs_usage = 0)
         : tx{tx},
           nFee{fee},
           nTxWeight(GetTransactionWeight(*tx)),
-          nUsageSize{RecursiveDynamicUsage(tx)},
+          nUsageSize{RecursiveDynamicUsage(tx) + contract_txs_usage},
           nTime{time},
           entryHeight{entry_height},
           spendsCoinbase{spends_coinbase},
@@ -114,11 +120,14 @@ public:
           m_modified_fee{nFee},
           lockPoints{lp},
           nMinGasPrice{min_gas_price},
+          nGasLimit{gas_limit},
+          m_contract_txs{std::move(contract_txs)},
           nSizeWithDescendants{GetTxSize()},
           nModFeesWithDescendants{nFee},
           nSizeWithAncestors{GetTxSize()},
           nModFeesWithAncestors{nFee},
-          nSigOpCostWithAncestors{sigOpCost} {}
+          nSigOpCostWithAncestors{sigOpCost},
+          nGasLimitWithAncestors{gas_limit} {}
 
     const CTransaction& GetTx() const { return *this->tx; }
     CTransactionRef GetSharedTx() const { return this->tx; }
@@ -135,11 +144,13 @@ public:
     size_t DynamicMemoryUsage() const { return nUsageSize; }
     const LockPoints& GetLockPoints() const { return lockPoints; }
     const CAmount& GetMinGasPrice() const { return nMinGasPrice; }
+    uint64_t GetGasLimit() const { return nGasLimit; }
+    const std::shared_ptr<const MempoolContractTxs>& GetContractTxs() const { return m_contract_txs; }
 
     // Adjusts the descendant state.
     void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
     // Adjusts the ancestor state
-    void UpdateAncestorState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount, int64_t modifySigOps);
+    void UpdateAncestorState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount, int64_t modifySigOps, int64_t modifyGasLimit);
     // Updates the modified fees with descendants/ancestors.
     void UpdateModifiedFee(CAmount fee_diff)
     {
@@ -164,6 +175,8 @@ public:
     uint64_t GetSizeWithAncestors() const { return nSizeWithAncestors; }
     CAmount GetModFeesWithAncestors() const { return nModFeesWithAncestors; }
     int64_t GetSigOpCostWithAncestors() const { return nSigOpCostWithAncestors; }
+    //! The gas that the contract outputs of the tx and of its unconfirmed ancestors can use at most
+    uint64_t GetGasLimitWithAncestors() const { return nGasLimitWithAncestors; }
 
     const Parents& GetMemPoolParentsConst() const { return m_parents; }
     const Children& GetMemPoolChildrenConst() const { return m_children; }
@@ -19,6 +19,7 @@
 #include <util/time.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <cstdio>
@@ -36,6 +37,8 @@ using fsbridge::FopenFn;
 namespace kernel {
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+//! Maximum number of loaded transactions whose scripts are verified together
+static const size_t MEMPOOL_LOAD_BATCH_SIZE = 1000;
 
 bool LoadMempool(CTxMemPool& pool, const fs::path& load_path, Chainstate& active_chainstate, FopenFn mockable_fopen_function)
 {
@@ -61,6 +64,41 @@ bool LoadMempool(CTxMemPool& pool, const fs::path& load_path, Chainstate& active
         if (version != MEMPOOL_DUMP_VERSION) {
             return false;
         }
+
+        // The transactions are dumped parents first. They are accepted in batches of transactions
+        // that do not spend each other, whose scripts are verified together on the script check threads.
+        std::vector<CTransactionRef> batch;
+        std::vector<int64_t> batch_times;
+        std::set<uint256> batch_txids;
+        const auto accept_batch = [&]() {
+            if (batch.empty()) return true;
+            PreverifyTxScripts(active_chainstate, pool, batch);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                const CTransactionRef& tx = batch[i];
+                LOCK(cs_main);
+                const auto& accepted = AcceptToMemoryPool(active_chainstate, tx, batch_times[i], /*bypass_limits=*/false, /*test_accept=*/false);
+                if (accepted.m_result_type == MempoolAcceptResult::ResultType::VALID) {
+                    ++count;
+                } else {
+                    // mempool may contain the transaction already, e.g. from
+                    // wallet(s) having loaded it while we were processing
+                    // mempool transactions; consider these as valid, instead of
+                    // failed, but mark them as 'already there'
+                    if (pool.exists(GenTxid::Txid(tx->GetHash()))) {
+                        ++already_there;
+                    } else {
+                        ++failed;
+                    }
+                }
+                if (ShutdownRequested())
+                    return false;
+            }
+            batch.clear();
+            batch_times.clear();
+            batch_txids.clear();
+            return true;
+        };
+
         uint64_t num;
         file >> num;
         while (num) {
@@ -77,27 +115,24 @@ bool LoadMempool(CTxMemPool& pool, const fs::path& load_path, Chainstate& active
                 pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
             }
             if (nTime > TicksSinceEpoch<std::chrono::seconds>(now - pool.m_expiry)) {
-                LOCK(cs_main);
-                const auto& accepted = AcceptToMemoryPool(active_chainstate, tx, nTime, /*bypass_limits=*/false, /*test_accept=*/false);
-                if (accepted.m_result_type == MempoolAcceptResult::ResultType::VALID) {
-                    ++count;
-                } else {
-                    // mempool may contain the transaction already, e.g. from
-                    // wallet(s) having loaded it while we were processing
-                    // mempool transactions; consider these as valid, instead of
-                    // failed, but mark them as 'already there'
-                    if (pool.exists(GenTxid::Txid(tx->GetHash()))) {
-                        ++already_there;
-                    } else {
-                        ++failed;
-                    }
+                const bool spends_batch = std::any_of(tx->vin.begin(), tx->vin.end(), [&](const CTxIn& txin) {
+                    return batch_txids.count(txin.prevout.hash) > 0;
+                });
+                if ((spends_batch || batch.size() >= MEMPOOL_LOAD_BATCH_SIZE) && !accept_batch()) {
+                    return false;
                 }
+                batch.push_back(tx);
+                batch_times.push_back(nTime);
+                batch_txids.insert(tx->GetHash());
             } else {
                 ++expired;
             }
             if (ShutdownRequested())
                 return false;
         }
+        if (!accept_batch()) {
+            return false;
+        }
         std::map<uint256, CAmount> mapDeltas;
         file >> mapDeltas;
 
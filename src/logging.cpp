@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <mutex>
 #include <optional>
 
@@ -94,6 +95,7 @@ bool BCLog::Logger::StartLogging()
 
 void BCLog::Logger::DisconnectTestLogger()
 {
+    StopAsyncLogging();
     StdLockGuard scoped_lock(m_cs);
     m_buffering = true;
     if (m_fileout != nullptr) fclose(m_fileout);
@@ -408,9 +410,8 @@ namespace BCLog {
     }
 } // namespace BCLog
 
-void BCLog::Logger::LogPrintStr(const std::string& str, const std::string& logging_function, const std::string& source_file, int source_line, BCLog::LogFlags category, BCLog::Level level, bool useVMLog)
+std::string BCLog::Logger::FormatLogStr(const std::string& str, const std::string& logging_function, const std::string& source_file, int source_line, BCLog::LogFlags category, BCLog::Level level, bool useVMLog)
 {
-    StdLockGuard scoped_lock(m_cs);
     std::string str_prefixed = LogEscapeMessage(str);
 
     if ((category != LogFlags::NONE || level != Level::None) && m_started_new_line) {
@@ -451,6 +452,39 @@ void BCLog::Logger::LogPrintStr(const std::string& str, const std::string& loggi
 
     m_started_new_line = !str.empty() && str[str.size()-1] == '\n';
 
+    return str_prefixed;
+}
+
+void BCLog::Logger::LogPrintStr(const std::string& str, const std::string& logging_function, const std::string& source_file, int source_line, BCLog::LogFlags category, BCLog::Level level, bool useVMLog)
+{
+    if (m_async) {
+        // Format the message on this thread, for its timestamp and thread name, and leave
+        // the I/O to the writer thread
+        std::string str_prefixed = FormatLogStr(str, logging_function, source_file, source_line, category, level, useVMLog);
+        if (level == Level::Error) {
+            StdLockGuard scoped_lock(m_cs);
+            DrainQueue();
+            WriteLogStr(str_prefixed, useVMLog);
+            return;
+        }
+        if (!m_queue->TryPush(LogMsg(std::move(str_prefixed), useVMLog))) {
+            ++m_dropped;
+            return;
+        }
+        if (!m_async) {
+            // The writer thread was stopped meanwhile, and may not have seen the message
+            StdLockGuard scoped_lock(m_cs);
+            DrainQueue();
+        } else if (m_writer_waiting) {
+            StdLockGuard scoped_lock(m_writer_mutex);
+            m_writer_cv.notify_one();
+        }
+        return;
+    }
+
+    StdLockGuard scoped_lock(m_cs);
+    std::string str_prefixed = FormatLogStr(str, logging_function, source_file, source_line, category, level, useVMLog);
+
     if (m_buffering) {
         // buffer if we haven't started logging yet
         LogMsg logmsg(str_prefixed, useVMLog);
@@ -458,9 +492,13 @@ void BCLog::Logger::LogPrintStr(const std::string& str, const std::string& loggi
         return;
     }
 
+    WriteLogStr(str_prefixed, useVMLog);
+}
+
+void BCLog::Logger::WriteLogStr(const std::string& str_prefixed, bool useVMLog)
+{
     bool print_to_console = m_print_to_console;
     if(print_to_console && useVMLog && !m_show_evm_logs) print_to_console = false;
-
     if (print_to_console) {
         // print to console
         fwrite(str_prefixed.data(), 1, str_prefixed.size(), stdout);
@@ -501,6 +539,127 @@ void BCLog::Logger::LogPrintStr(const std::string& str, const std::string& loggi
     }
 }
 
+static size_t QueueMask(size_t capacity)
+{
+    size_t mask{1};
+    while (mask < capacity - 1) mask = (mask << 1) | 1;
+    return mask;
+}
+
+BCLog::LogQueue::LogQueue(size_t capacity)
+    : m_mask(QueueMask(std::max<size_t>(capacity, 2))), m_cells(new Cell[m_mask + 1])
+{
+    for (size_t i = 0; i <= m_mask; ++i) {
+        m_cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool BCLog::LogQueue::TryPush(LogMsg&& msg)
+{
+    size_t pos = m_push_pos.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = m_cells[pos & m_mask];
+        const size_t seq = cell.seq.load(std::memory_order_acquire);
+        if (seq == pos) {
+            if (m_push_pos.compare_exchange_weak(pos, pos + 1)) {
+                cell.msg = std::move(msg);
+                cell.seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (seq < pos) {
+            // The cell still holds the message from the previous round
+            return false;
+        } else {
+            pos = m_push_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool BCLog::LogQueue::TryPop(LogMsg& msg)
+{
+    size_t pos = m_pop_pos.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = m_cells[pos & m_mask];
+        const size_t seq = cell.seq.load(std::memory_order_acquire);
+        if (seq == pos + 1) {
+            if (m_pop_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                msg = std::move(cell.msg);
+                cell.seq.store(pos + m_mask + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (seq < pos + 1) {
+            return false;
+        } else {
+            pos = m_pop_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void BCLog::Logger::DrainQueue()
+{
+    if (!m_queue) return;
+    LogMsg logmsg{"", false};
+    while (m_queue->TryPop(logmsg)) {
+        WriteLogStr(logmsg.msg, logmsg.useVMLog);
+    }
+    const uint64_t dropped{m_dropped.load()};
+    if (dropped != m_dropped_reported) {
+        WriteLogStr(LogTimestampStr(strprintf("[logging] %u log messages were dropped because the log queue was full\n", dropped - m_dropped_reported)), false);
+        m_dropped_reported = dropped;
+    }
+}
+
+void BCLog::Logger::WriterThread()
+{
+    util::ThreadRename("logwriter");
+    while (true) {
+        {
+            StdLockGuard scoped_lock(m_cs);
+            DrainQueue();
+        }
+        std::unique_lock<std::mutex> lock(m_writer_mutex);
+        if (m_stop_writer) break;
+        m_writer_waiting = true;
+        if (m_queue->Empty()) {
+            // Woken up by the threads logging, the timeout is only a safety net
+            m_writer_cv.wait_for(lock, std::chrono::milliseconds{100});
+        }
+        m_writer_waiting = false;
+    }
+}
+
+void BCLog::Logger::StartAsyncLogging(size_t capacity)
+{
+    if (m_async) return;
+    if (!m_queue) m_queue = std::make_unique<LogQueue>(capacity);
+    {
+        StdLockGuard scoped_lock(m_writer_mutex);
+        m_stop_writer = false;
+    }
+    m_writer = std::thread(&BCLog::Logger::WriterThread, this);
+    m_async = true;
+}
+
+void BCLog::Logger::StopAsyncLogging()
+{
+    if (!m_async) return;
+    m_async = false;
+    {
+        StdLockGuard scoped_lock(m_writer_mutex);
+        m_stop_writer = true;
+    }
+    m_writer_cv.notify_one();
+    m_writer.join();
+    Flush();
+}
+
+void BCLog::Logger::Flush()
+{
+    StdLockGuard scoped_lock(m_cs);
+    DrainQueue();
+    if (m_print_to_console) fflush(stdout);
+}
+
 void BCLog::Logger::ShrinkDebugFile()
 {
     // Amount of debug.log to save at end when shrinking (must fit in memory)
@@ -12,11 +12,14 @@
 #include <util/string.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -26,6 +29,8 @@ static const bool DEFAULT_LOGTIMESTAMPS = true;
 static const bool DEFAULT_LOGTHREADNAMES = false;
 static const bool DEFAULT_LOGSOURCELOCATIONS = false;
 static const bool DEFAULT_SHOWEVMLOGS   = false;
+//! Messages queued for the log writer thread, 0 to write the log on the threads logging
+static const int64_t DEFAULT_LOGQUEUE   = 0;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 extern const char * const DEFAULT_DEBUGVMLOGFILE;
 
@@ -96,6 +101,35 @@ namespace BCLog {
         bool useVMLog;
     };
 
+    /**
+     * Bounded queue of formatted log messages, which the threads logging push to and the
+     * log writer thread pops from without taking a lock.
+     */
+    class LogQueue
+    {
+    private:
+        struct Cell {
+            //! Position of the push (or of the pop, plus one) the cell is ready for
+            std::atomic<size_t> seq;
+            LogMsg msg{"", false};
+        };
+
+        const size_t m_mask;
+        const std::unique_ptr<Cell[]> m_cells;
+        std::atomic<size_t> m_push_pos{0};
+        std::atomic<size_t> m_pop_pos{0};
+
+    public:
+        //! The capacity is rounded up to a power of two
+        explicit LogQueue(size_t capacity);
+
+        //! @returns false if the queue is full
+        bool TryPush(LogMsg&& msg);
+        //! @returns false if the queue is empty
+        bool TryPop(LogMsg& msg);
+        bool Empty() const { return m_pop_pos.load() == m_push_pos.load(); }
+    };
+
     class Logger
     {
     private:
@@ -128,6 +162,28 @@ namespace BCLog {
         /** Slots that connect to the print signal */
         std::list<std::function<void(const std::string&)>> m_print_callbacks GUARDED_BY(m_cs) {};
 
+        //! Queue of the messages to write, created by the first StartAsyncLogging and kept until exit
+        std::unique_ptr<LogQueue> m_queue;
+        //! Whether messages are queued for m_writer rather than written by the threads logging
+        std::atomic<bool> m_async{false};
+        //! Messages dropped because m_queue was full, and how many of them have been reported in the log
+        std::atomic<uint64_t> m_dropped{0};
+        uint64_t m_dropped_reported GUARDED_BY(m_cs){0};
+
+        std::thread m_writer;
+        StdMutex m_writer_mutex;
+        std::condition_variable m_writer_cv;
+        std::atomic<bool> m_writer_waiting{false};
+        bool m_stop_writer{false}; //!< Protected by m_writer_mutex
+
+        /** Add the prefixes and timestamp of the message */
+        std::string FormatLogStr(const std::string& str, const std::string& logging_function, const std::string& source_file, int source_line, BCLog::LogFlags category, BCLog::Level level, bool useVMLog);
+        /** Write a formatted message to the outputs */
+        void WriteLogStr(const std::string& str_prefixed, bool useVMLog) EXCLUSIVE_LOCKS_REQUIRED(m_cs);
+        /** Write the queued messages. The messages are popped under m_cs, so that they are written in order. */
+        void DrainQueue() EXCLUSIVE_LOCKS_REQUIRED(m_cs);
+        void WriterThread();
+
     public:
         bool m_print_to_console = false;
         bool m_print_to_file = false;
@@ -172,6 +228,19 @@ namespace BCLog {
         /** Only for testing */
         void DisconnectTestLogger();
 
+        /**
+         * Write the log on a writer thread from now on, so that the threads logging do not wait
+         * for the file I/O. Messages that do not fit in the queue of @p capacity are dropped and
+         * counted. Messages at the Error level are still written synchronously, after the queue.
+         */
+        void StartAsyncLogging(size_t capacity);
+        /** Write the queued messages, and write the log on the threads logging again */
+        void StopAsyncLogging();
+        /** Write the queued messages before returning, for when the process may be about to end */
+        void Flush();
+        /** Returns the number of messages dropped because the queue was full */
+        uint64_t DroppedMessages() const { return m_dropped.load(); }
+
         void ShrinkDebugFile();
 
         std::unordered_map<LogFlags, Level> CategoryLevels() const
@@ -26,7 +26,9 @@
 #include <protocol.h>
 #include <random.h>
 #include <scheduler.h>
+#include <util/allocstats.h>
 #include <util/fs.h>
+#include <util/metrics.h>
 #include <util/sock.h>
 #include <util/strencodings.h>
 #include <util/syscall_sandbox.h>
@@ -105,6 +107,9 @@ enum BindFlags {
 // The sleep time needs to be small to avoid new sockets stalling
 static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 50;
 
+/** Maximum number of queued headers and payloads passed to the socket in one send */
+static constexpr size_t MAX_SEND_BUFFERS{16};
+
 const std::string NET_MESSAGE_TYPE_OTHER = "*other*";
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
@@ -819,11 +824,11 @@ CNetMessage V1TransportDeserializer::GetMessage(const std::chrono::microseconds
 
 void V1TransportSerializer::prepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) const
 {
-    // create dbl-sha256 checksum
-    uint256 hash = Hash(msg.data);
+    // create dbl-sha256 checksum, computed once for a shared payload
+    const uint256 hash = msg.m_shared ? msg.m_shared->hash : Hash(msg.data);
 
     // create header
-    CMessageHeader hdr(Params().MessageStart(), msg.m_type.c_str(), msg.data.size());
+    CMessageHeader hdr(Params().MessageStart(), msg.m_type.c_str(), msg.Payload().size());
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
     // serialize header
@@ -837,8 +842,19 @@ size_t CConnman::SocketSendData(CNode& node) const
     size_t nSentSize = 0;
 
     while (it != node.vSendMsg.end()) {
-        const auto& data = *it;
-        assert(data.size() > node.nSendOffset);
+        // Gather the queued headers and payloads into one call
+        std::array<Span<const unsigned char>, MAX_SEND_BUFFERS> buffers;
+        size_t buffers_count{0};
+        size_t buffers_size{0};
+        for (auto buf = it; buf != node.vSendMsg.end() && buffers_count < buffers.size(); ++buf) {
+            Span<const unsigned char> data{**buf};
+            if (buffers_count == 0) {
+                assert(data.size() > node.nSendOffset);
+                data = data.subspan(node.nSendOffset);
+            }
+            buffers[buffers_count++] = data;
+            buffers_size += data.size();
+        }
         int nBytes = 0;
         {
             LOCK(node.m_sock_mutex);
@@ -847,24 +863,32 @@ size_t CConnman::SocketSendData(CNode& node) const
             }
             int flags = MSG_NOSIGNAL | MSG_DONTWAIT;
 #ifdef MSG_MORE
-            if (it + 1 != node.vSendMsg.end()) {
+            if (it + buffers_count != node.vSendMsg.end()) {
                 flags |= MSG_MORE;
             }
 #endif
-            nBytes = node.m_sock->Send(reinterpret_cast<const char*>(data.data()) + node.nSendOffset, data.size() - node.nSendOffset, flags);
+            nBytes = node.m_sock->SendMany(Span{buffers.data(), buffers_count}, flags);
         }
         if (nBytes > 0) {
             node.m_last_send = GetTime<std::chrono::seconds>();
             node.nSendBytes += nBytes;
-            node.nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (node.nSendOffset == data.size()) {
+            // Pop the fully sent buffers, and remember how much of the next one was sent
+            size_t remaining = nBytes;
+            while (remaining > 0) {
+                const size_t size = (*it)->size();
+                if (node.nSendOffset + remaining < size) {
+                    node.nSendOffset += remaining;
+                    break;
+                }
+                remaining -= size - node.nSendOffset;
                 node.nSendOffset = 0;
-                node.nSendSize -= data.size();
-                node.fPauseSend = node.nSendSize > nSendBufferMaxSize;
+                node.nSendSize -= size;
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            node.fPauseSend = node.nSendSize > nSendBufferMaxSize;
+            if ((size_t)nBytes < buffers_size) {
+                // could not send full messages; stop sending more
                 break;
             }
         } else {
@@ -1168,6 +1192,7 @@ void CConnman::NotifyNumConnectionsChanged()
     }
     if(nodes_size != nPrevNodeCount) {
         nPrevNodeCount = nodes_size;
+        g_metrics.peers.Set(nodes_size);
         if (m_client_interface) {
             m_client_interface->NotifyNumConnectionsChanged(nodes_size);
         }
@@ -1269,11 +1294,11 @@ void CConnman::SocketHandler()
         const auto timeout = std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS);
 
         // Check for the readiness of the already connected sockets and the
-        // listening sockets in one call ("readiness" as in poll(2) or
-        // select(2)). If none are ready, wait for a short while and return
+        // listening sockets in one call ("readiness" as in epoll(7), poll(2)
+        // or select(2)). If none are ready, wait for a short while and return
         // empty sets.
         events_per_sock = GenerateWaitSockets(snap.Nodes());
-        if (events_per_sock.empty() || !events_per_sock.begin()->first->WaitMany(timeout, events_per_sock)) {
+        if (!m_sock_poller.WaitMany(timeout, events_per_sock)) {
             interruptNet.sleep_for(timeout);
         }
 
@@ -1332,6 +1357,7 @@ void CConnman::SocketHandlerConnected(const std::vector<CNode*>& nodes,
                 }
                 RecordBytesRecv(nBytes);
                 if (notify) {
+                    pnode->ForEachReceivedMsg([&](const CNetMessage& msg) { m_msgproc->ReceivedMessage(*pnode, msg); });
                     pnode->MarkReceivedMsgsForProcessing();
                     WakeMessageHandler();
                 }
@@ -1386,6 +1412,7 @@ void CConnman::ThreadSocketHandler()
     AssertLockNotHeld(m_total_bytes_sent_mutex);
 
     SetSyscallSandboxPolicy(SyscallSandboxPolicy::NET);
+    AllocScope alloc_scope{AllocTag::NET};
     while (!interruptNet)
     {
         DisconnectNodes();
@@ -1398,9 +1425,9 @@ void CConnman::WakeMessageHandler()
 {
     {
         LOCK(mutexMsgProc);
-        fMsgProcWake = true;
+        ++m_msgproc_wake_seq;
     }
-    condMsgProc.notify_one();
+    condMsgProc.notify_all();
 }
 
 void CConnman::ThreadDNSAddressSeed()
@@ -2041,13 +2068,12 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     }
 }
 
-Mutex NetEventsInterface::g_msgproc_mutex;
-
-void CConnman::ThreadMessageHandler()
+void CConnman::ThreadMessageHandler(int shard)
 {
-    LOCK(NetEventsInterface::g_msgproc_mutex);
-
     SetSyscallSandboxPolicy(SyscallSandboxPolicy::MESSAGE_HANDLER);
+    // The validation of the blocks and transactions received is counted under its own tags
+    AllocScope alloc_scope{AllocTag::NET};
+    uint64_t wake_seq = WITH_LOCK(mutexMsgProc, return m_msgproc_wake_seq);
     while (!flagInterruptMsgProc)
     {
         bool fMoreWork = false;
@@ -2061,6 +2087,9 @@ void CConnman::ThreadMessageHandler()
             for (CNode* pnode : snap.Nodes()) {
                 if (pnode->fDisconnect)
                     continue;
+                // Every node is handled by a single thread, so its messages stay in order
+                if (pnode->GetId() % m_msghandler_threads != shard)
+                    continue;
 
                 // Receive messages
                 bool fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc);
@@ -2077,9 +2106,9 @@ void CConnman::ThreadMessageHandler()
 
         WAIT_LOCK(mutexMsgProc, lock);
         if (!fMoreWork) {
-            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this]() EXCLUSIVE_LOCKS_REQUIRED(mutexMsgProc) { return fMsgProcWake; });
+            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this, wake_seq]() EXCLUSIVE_LOCKS_REQUIRED(mutexMsgProc) { return m_msgproc_wake_seq != wake_seq; });
         }
-        fMsgProcWake = false;
+        wake_seq = m_msgproc_wake_seq;
     }
 }
 
@@ -2374,11 +2403,6 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     interruptNet.reset();
     flagInterruptMsgProc = false;
 
-    {
-        LOCK(mutexMsgProc);
-        fMsgProcWake = false;
-    }
-
     // Send and receive from sockets, accept connections
     threadSocketHandler = std::thread(&util::TraceThread, "net", [this] { ThreadSocketHandler(); });
 
@@ -2405,7 +2429,10 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     }
 
     // Process messages
-    threadMessageHandler = std::thread(&util::TraceThread, "msghand", [this] { ThreadMessageHandler(); });
+    for (int shard = 0; shard < m_msghandler_threads; ++shard) {
+        const std::string name = m_msghandler_threads == 1 ? "msghand" : strprintf("msghand.%d", shard);
+        m_thread_message_handlers.emplace_back(&util::TraceThread, name, [this, shard] { ThreadMessageHandler(shard); });
+    }
 
     if (m_i2p_sam_session) {
         threadI2PAcceptIncoming =
@@ -2462,8 +2489,11 @@ void CConnman::StopThreads()
     if (threadI2PAcceptIncoming.joinable()) {
         threadI2PAcceptIncoming.join();
     }
-    if (threadMessageHandler.joinable())
-        threadMessageHandler.join();
+    for (std::thread& thread : m_thread_message_handlers) {
+        if (thread.joinable())
+            thread.join();
+    }
+    m_thread_message_handlers.clear();
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -2672,6 +2702,7 @@ bool CConnman::DisconnectNode(NodeId id)
 void CConnman::RecordBytesRecv(uint64_t bytes)
 {
     nTotalBytesRecv += bytes;
+    g_metrics.net_bytes_recv.Inc(bytes);
 }
 
 void CConnman::RecordBytesSent(uint64_t bytes)
@@ -2680,6 +2711,7 @@ void CConnman::RecordBytesSent(uint64_t bytes)
     LOCK(m_total_bytes_sent_mutex);
 
     nTotalBytesSent += bytes;
+    g_metrics.net_bytes_sent.Inc(bytes);
 
     const auto now = GetTime<std::chrono::seconds>();
     if (nMaxOutboundCycleStartTime + MAX_UPLOAD_TIMEFRAME < now)
@@ -2853,10 +2885,10 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
     AssertLockNotHeld(m_total_bytes_sent_mutex);
-    size_t nMessageSize = msg.data.size();
+    size_t nMessageSize = msg.Payload().size();
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n", msg.m_type, nMessageSize, pnode->GetId());
     if (gArgs.GetBoolArg("-capturemessages", false)) {
-        CaptureMessage(pnode->addr, msg.m_type, msg.data, /*is_incoming=*/false);
+        CaptureMessage(pnode->addr, msg.m_type, msg.Payload(), /*is_incoming=*/false);
     }
 
     TRACE6(net, outbound_message,
@@ -2864,8 +2896,8 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         pnode->m_addr_name.c_str(),
         pnode->ConnectionTypeAsString().c_str(),
         msg.m_type.c_str(),
-        msg.data.size(),
-        msg.data.data()
+        msg.Payload().size(),
+        msg.Payload().data()
     );
 
     // make sure we use the appropriate network transport format
@@ -2883,8 +2915,13 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         pnode->nSendSize += nTotalSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize) pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize) pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->vSendMsg.push_back(std::make_shared<const std::vector<unsigned char>>(std::move(serializedHeader)));
+        if (msg.m_shared) {
+            // Queue the shared payload itself, it is not copied for every node
+            if (nMessageSize) pnode->vSendMsg.emplace_back(msg.m_shared, &msg.m_shared->data);
+        } else if (nMessageSize) {
+            pnode->vSendMsg.push_back(std::make_shared<const std::vector<unsigned char>>(std::move(msg.data)));
+        }
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend) nBytesSent = SocketSendData(*pnode);
@@ -29,6 +29,7 @@
 #include <util/sock.h>
 #include <util/threadinterrupt.h>
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <cstdint>
@@ -90,6 +91,10 @@ static constexpr bool DEFAULT_DNSSEED{true};
 static constexpr bool DEFAULT_FIXEDSEEDS{true};
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Default number of message handler threads, peers are spread over them by node id */
+static const int DEFAULT_MSGHANDLER_THREADS = 1;
+/** Maximum number of message handler threads */
+static const int MAX_MSGHANDLER_THREADS = 16;
 
 typedef int64_t NodeId;
 
@@ -104,6 +109,19 @@ struct AddedNodeInfo
 class CNodeStats;
 class CClientUIInterface;
 
+/**
+ * A serialized message payload that is shared between the send queues of many peers, so that
+ * a block relayed to all of them is serialized, hashed and stored once.
+ */
+struct SharedNetMsgPayload {
+    explicit SharedNetMsgPayload(std::vector<unsigned char>&& data_in)
+        : data{std::move(data_in)}, hash{Hash(data)} {}
+
+    const std::vector<unsigned char> data;
+    /** Double SHA256 of data, for the message checksum */
+    const uint256 hash;
+};
+
 struct CSerializedNetMsg {
     CSerializedNetMsg() = default;
     CSerializedNetMsg(CSerializedNetMsg&&) = default;
@@ -116,11 +134,30 @@ struct CSerializedNetMsg {
     {
         CSerializedNetMsg copy;
         copy.data = data;
+        copy.m_shared = m_shared;
         copy.m_type = m_type;
         return copy;
     }
 
+    /** Move the payload into a shared one, after which Copy() does not copy it. */
+    CSerializedNetMsg& Share()
+    {
+        if (!m_shared) {
+            m_shared = std::make_shared<const SharedNetMsgPayload>(std::move(data));
+            data.clear();
+        }
+        return *this;
+    }
+
+    /** The payload, in data or in the shared one */
+    Span<const unsigned char> Payload() const
+    {
+        return m_shared ? Span<const unsigned char>{m_shared->data} : Span<const unsigned char>{data};
+    }
+
     std::vector<unsigned char> data;
+    /** Shared payload, data is empty when set */
+    std::shared_ptr<const SharedNetMsgPayload> m_shared;
     std::string m_type;
 };
 
@@ -379,7 +416,8 @@ public:
     /** Offset inside the first vSendMsg already sent */
     size_t nSendOffset GUARDED_BY(cs_vSend){0};
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    /** Message headers and payloads to send, payloads may be shared with other nodes */
+    std::deque<std::shared_ptr<const std::vector<unsigned char>>> vSendMsg GUARDED_BY(cs_vSend);
     Mutex cs_vSend;
     Mutex m_sock_mutex;
     Mutex cs_vRecv;
@@ -423,6 +461,12 @@ public:
 
     const ConnectionType m_conn_type;
 
+    /** Call @p fn for every message of the received queue, before they are marked for processing. */
+    void ForEachReceivedMsg(const std::function<void(const CNetMessage&)>& fn) const
+    {
+        for (const CNetMessage& msg : vRecvMsg) fn(msg);
+    }
+
     /** Move all messages from the received queue to the processing queue. */
     void MarkReceivedMsgsForProcessing()
         EXCLUSIVE_LOCKS_REQUIRED(!m_msg_process_queue_mutex);
@@ -657,9 +701,6 @@ private:
 class NetEventsInterface
 {
 public:
-    /** Mutex for anything that is only accessed via the msg processing thread */
-    static Mutex g_msgproc_mutex;
-
     /** Initialize a peer (setup state, queue any initial messages) */
     virtual void InitializeNode(CNode& node, ServiceFlags our_services) = 0;
 
@@ -667,22 +708,32 @@ public:
     virtual void FinalizeNode(const CNode& node) = 0;
 
     /**
-    * Process protocol messages received from a given node
+    * Process protocol messages received from a given node. May be called concurrently
+    * for different nodes from the message handler threads, never for the same node.
     *
     * @param[in]   pnode           The node which we have received messages from.
     * @param[in]   interrupt       Interrupt condition for processing threads
     * @return                      True if there is more work to be done
     */
-    virtual bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex) = 0;
+    virtual bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) = 0;
 
     /**
-    * Send queued protocol messages to a given node.
+    * Send queued protocol messages to a given node. Called from the same message handler
+    * thread as ProcessMessages for that node.
     *
     * @param[in]   pnode           The node which we are sending messages to.
     * @return                      True if there is more work to be done
     */
-    virtual bool SendMessages(CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex) = 0;
+    virtual bool SendMessages(CNode* pnode) = 0;
 
+    /**
+    * Look at a message as soon as it has been received, on the socket handler thread and before it
+    * is queued for ProcessMessages. Must return quickly.
+    *
+    * @param[in]   node            The node which we have received the message from.
+    * @param[in]   msg             The received message.
+    */
+    virtual void ReceivedMessage(const CNode& node, const CNetMessage& msg) {}
 
 protected:
     /**
@@ -723,6 +774,7 @@ public:
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
         bool m_i2p_accept_incoming;
+        int m_msghandler_threads = DEFAULT_MSGHANDLER_THREADS;
     };
 
     void Init(const Options& connOptions) EXCLUSIVE_LOCKS_REQUIRED(!m_added_nodes_mutex, !m_total_bytes_sent_mutex)
@@ -753,6 +805,7 @@ public:
             m_added_nodes = connOptions.m_added_nodes;
         }
         m_onion_binds = connOptions.onion_binds;
+        m_msghandler_threads = std::clamp(connOptions.m_msghandler_threads, 1, MAX_MSGHANDLER_THREADS);
     }
 
     CConnman(uint64_t seed0, uint64_t seed1, AddrMan& addrman, const NetGroupManager& netgroupman,
@@ -918,7 +971,7 @@ private:
     void AddAddrFetch(const std::string& strDest) EXCLUSIVE_LOCKS_REQUIRED(!m_addr_fetches_mutex);
     void ProcessAddrFetch() EXCLUSIVE_LOCKS_REQUIRED(!m_addr_fetches_mutex, !m_unused_i2p_sessions_mutex);
     void ThreadOpenConnections(std::vector<std::string> connect) EXCLUSIVE_LOCKS_REQUIRED(!m_addr_fetches_mutex, !m_added_nodes_mutex, !m_nodes_mutex, !m_unused_i2p_sessions_mutex);
-    void ThreadMessageHandler() EXCLUSIVE_LOCKS_REQUIRED(!mutexMsgProc);
+    void ThreadMessageHandler(int shard) EXCLUSIVE_LOCKS_REQUIRED(!mutexMsgProc);
     void ThreadI2PAcceptIncoming();
     void AcceptConnection(const ListenSocket& hListenSocket);
 
@@ -1115,13 +1168,19 @@ private:
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
-    /** flag for waking the message processor. */
-    bool fMsgProcWake GUARDED_BY(mutexMsgProc);
+    /** Incremented for waking the message processors, every thread compares it to the value it last saw. */
+    uint64_t m_msgproc_wake_seq GUARDED_BY(mutexMsgProc){0};
+
+    /** Number of message handler threads, a node is handled by the thread of index (node id % threads). */
+    int m_msghandler_threads{DEFAULT_MSGHANDLER_THREADS};
 
     std::condition_variable condMsgProc;
     Mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc{false};
 
+    /** Keeps the sockets waited for by SocketHandler registered between its loops. */
+    SockPoller m_sock_poller;
+
     /**
      * This is signaled when network activity should cease.
      * A pointer to it is saved in `m_i2p_sam_session`, so make sure that
@@ -1141,7 +1200,7 @@ private:
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
-    std::thread threadMessageHandler;
+    std::vector<std::thread> m_thread_message_handlers;
     std::thread threadI2PAcceptIncoming;
 
     /** flag for deciding to connect to an extra outbound peer,
@@ -9,9 +9,11 @@
 #include <banman.h>
 #include <blockencodings.h>
 #include <blockfilter.h>
+#include <blockorphanage.h>
 #include <chainparams.h>
 #include <consensus/amount.h>
 #include <consensus/validation.h>
+#include <crypto/siphash.h>
 #include <deploymentstatus.h>
 #include <hash.h>
 #include <headerssync.h>
@@ -21,8 +23,11 @@
 #include <netbase.h>
 #include <netmessagemaker.h>
 #include <node/blockstorage.h>
+#include <node/headerstore.h>
+#include <node/txpreverifier.h>
 #include <node/txreconciliation.h>
 #include <policy/fees.h>
+#include <policy/packages.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
 #include <primitives/block.h>
@@ -31,6 +36,7 @@
 #include <reverse_iterator.h>
 #include <scheduler.h>
 #include <streams.h>
+#include <support/arena.h>
 #include <sync.h>
 #include <timedata.h>
 #include <tinyformat.h>
@@ -46,11 +52,13 @@
 #include <clientversion.h>
 #include <consensus/merkle.h>
 #include <pos.h>
+#include <qtum/qtumstatepruner.h>
+#include <qtum/qtumstatesync.h>
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
-#include <future>
 #include <memory>
 #include <optional>
 #include <typeinfo>
@@ -68,6 +76,8 @@ static constexpr auto HEADERS_DOWNLOAD_TIMEOUT_BASE = 15min;
 static constexpr auto HEADERS_DOWNLOAD_TIMEOUT_PER_HEADER = 1ms;
 /** How long to wait for a peer to respond to a getheaders request */
 static constexpr auto HEADERS_RESPONSE_TIME{2min};
+/** Maximum number of stale block indexes deleted by the block index cleanup for every hold of cs_main */
+static constexpr size_t CLEAN_BLOCK_INDEX_CHUNK_SIZE{1000};
 /** Protect at least this many outbound peers from disconnection due to slow/
  * behind headers chain.
  */
@@ -110,6 +120,8 @@ static constexpr auto NONPREF_PEER_TX_DELAY{2s};
 static constexpr auto OVERLOADED_PEER_TX_DELAY{2s};
 /** How long to wait before downloading a transaction from an additional peer */
 static constexpr auto GETDATA_TX_INTERVAL{60s};
+/** Maximum number of orphaned children tried in a package with a parent that failed on its own */
+static constexpr size_t MAX_ORPHAN_PACKAGE_CHILDREN{2};
 /** Limit to avoid sending big packets. Not used in processing incoming GETDATA for compatibility */
 static const unsigned int MAX_GETDATA_SZ = 1000;
 /** Number of blocks that can be requested at any given time from a single peer. */
@@ -175,6 +187,8 @@ static constexpr auto MAX_FEEFILTER_CHANGE_DELAY{5min};
 static constexpr uint32_t MAX_GETCFILTERS_SIZE = 1000;
 /** Maximum number of cf hashes that may be requested with one getcfheaders. See BIP 157. */
 static constexpr uint32_t MAX_GETCFHEADERS_SIZE = 2000;
+/** Time a peer has to answer a getstatedata before its items are asked from another peer. */
+static constexpr auto STATE_DATA_TIMEOUT{60s};
 /** the maximum percentage of addresses from our addrman to return in response to a getaddr message. */
 static constexpr size_t MAX_PCT_ADDR_TO_SEND = 23;
 /** The maximum number of address records permitted in an ADDR message. */
@@ -189,13 +203,6 @@ static constexpr size_t MAX_ADDR_PROCESSING_TOKEN_BUCKET{MAX_ADDR_TO_SEND};
 /** The compactblocks version we support. See BIP 152. */
 static constexpr uint64_t CMPCTBLOCKS_VERSION{2};
 
-struct COrphanBlock {
-    uint256 hashBlock;
-    uint256 hashPrev;
-    std::pair<COutPoint, unsigned int> stake;
-    std::vector<unsigned char> vchBlock;
-};
-
 // Internal stuff
 namespace {
 /** Blocks that are in flight, and that are in the queue to be downloaded. */
@@ -239,6 +246,10 @@ struct Peer {
     /** Services this peer offered to us. */
     std::atomic<ServiceFlags> m_their_services{NODE_NONE};
 
+    /** Held while the messages of this peer are processed or sent, by the message handler
+     *  thread the peer is assigned to. Protects the message processing state below. */
+    Mutex m_msgproc_mutex;
+
     /** Protects misbehavior data members */
     Mutex m_misbehavior_mutex;
     /** Accumulated misbehavior score for this peer */
@@ -277,10 +288,10 @@ struct Peer {
     /** The feerate in the most recent BIP133 `feefilter` message sent to the peer.
      *  It is *not* a p2p protocol violation for the peer to send us
      *  transactions with a lower fee rate than this. See BIP133. */
-    CAmount m_fee_filter_sent GUARDED_BY(NetEventsInterface::g_msgproc_mutex){0};
+    CAmount m_fee_filter_sent GUARDED_BY(m_msgproc_mutex){0};
     /** Timestamp after which we will send the next BIP133 `feefilter` message
       * to the peer. */
-    std::chrono::microseconds m_next_send_feefilter GUARDED_BY(NetEventsInterface::g_msgproc_mutex){0};
+    std::chrono::microseconds m_next_send_feefilter GUARDED_BY(m_msgproc_mutex){0};
 
     struct TxRelay {
         mutable RecursiveMutex m_bloom_filter_mutex;
@@ -289,10 +300,9 @@ struct Peer {
         /** A bloom filter for which transactions to announce to the peer. See BIP37. */
         std::unique_ptr<CBloomFilter> m_bloom_filter PT_GUARDED_BY(m_bloom_filter_mutex) GUARDED_BY(m_bloom_filter_mutex){nullptr};
 
-        /** A rolling bloom filter of all announced tx CInvs to this peer */
-        CRollingBloomFilter m_recently_announced_invs GUARDED_BY(NetEventsInterface::g_msgproc_mutex){INVENTORY_MAX_RECENT_RELAY, 0.000001};
-
         mutable RecursiveMutex m_tx_inventory_mutex;
+        /** A rolling bloom filter of all announced tx CInvs to this peer */
+        CRollingBloomFilter m_recently_announced_invs GUARDED_BY(m_tx_inventory_mutex){INVENTORY_MAX_RECENT_RELAY, 0.000001};
         /** A filter of all the txids and wtxids that the peer has announced to
          *  us or we have announced to the peer. We use this to avoid announcing
          *  the same txid/wtxid to a peer that already has the transaction. */
@@ -329,8 +339,10 @@ struct Peer {
         return WITH_LOCK(m_tx_relay_mutex, return m_tx_relay.get());
     };
 
+    /** Protects the addresses to send, which the address relay of other peers adds to. */
+    Mutex m_addr_send_mutex;
     /** A vector of addresses to send to the peer, limited to MAX_ADDR_TO_SEND. */
-    std::vector<CAddress> m_addrs_to_send GUARDED_BY(NetEventsInterface::g_msgproc_mutex);
+    std::vector<CAddress> m_addrs_to_send GUARDED_BY(m_addr_send_mutex);
     /** Probabilistic filter to track recent addr messages relayed with this
      *  peer. Used to avoid relaying redundant addresses to this peer.
      *
@@ -340,7 +352,7 @@ struct Peer {
      *
      *  Presence of this filter must correlate with m_addr_relay_enabled.
      **/
-    std::unique_ptr<CRollingBloomFilter> m_addr_known GUARDED_BY(NetEventsInterface::g_msgproc_mutex);
+    std::unique_ptr<CRollingBloomFilter> m_addr_known GUARDED_BY(m_addr_send_mutex);
     /** Whether we are participating in address relay with this connection.
      *
      *  We set this bool to true for outbound peers (other than
@@ -357,7 +369,7 @@ struct Peer {
      *  initialized.*/
     std::atomic_bool m_addr_relay_enabled{false};
     /** Whether a getaddr request to this peer is outstanding. */
-    bool m_getaddr_sent GUARDED_BY(NetEventsInterface::g_msgproc_mutex){false};
+    bool m_getaddr_sent GUARDED_BY(m_msgproc_mutex){false};
     /** Guards address sending timers. */
     mutable Mutex m_addr_send_times_mutex;
     /** Time point to send the next ADDR message to this peer. */
@@ -368,19 +380,19 @@ struct Peer {
      *  messages, indicating a preference to receive ADDRv2 instead of ADDR ones. */
     std::atomic_bool m_wants_addrv2{false};
     /** Whether this peer has already sent us a getaddr message. */
-    bool m_getaddr_recvd GUARDED_BY(NetEventsInterface::g_msgproc_mutex){false};
+    bool m_getaddr_recvd GUARDED_BY(m_msgproc_mutex){false};
     /** Number of addresses that can be processed from this peer. Start at 1 to
      *  permit self-announcement. */
-    double m_addr_token_bucket GUARDED_BY(NetEventsInterface::g_msgproc_mutex){1.0};
+    double m_addr_token_bucket GUARDED_BY(m_msgproc_mutex){1.0};
     /** When m_addr_token_bucket was last updated */
-    std::chrono::microseconds m_addr_token_timestamp GUARDED_BY(NetEventsInterface::g_msgproc_mutex){GetTime<std::chrono::microseconds>()};
+    std::chrono::microseconds m_addr_token_timestamp GUARDED_BY(m_msgproc_mutex){GetTime<std::chrono::microseconds>()};
     /** Total number of addresses that were dropped due to rate limiting. */
     std::atomic<uint64_t> m_addr_rate_limited{0};
     /** Total number of addresses that were processed (excludes rate-limited ones). */
     std::atomic<uint64_t> m_addr_processed{0};
 
     /** Whether we've sent this peer a getheaders in response to an inv prior to initial-headers-sync completing */
-    bool m_inv_triggered_getheaders_before_sync GUARDED_BY(NetEventsInterface::g_msgproc_mutex){false};
+    bool m_inv_triggered_getheaders_before_sync GUARDED_BY(m_msgproc_mutex){false};
 
     /** Protects m_getdata_requests **/
     Mutex m_getdata_requests_mutex;
@@ -388,7 +400,7 @@ struct Peer {
     std::deque<CInv> m_getdata_requests GUARDED_BY(m_getdata_requests_mutex);
 
     /** Time of the last getheaders message to this peer */
-    NodeClock::time_point m_last_getheaders_timestamp GUARDED_BY(NetEventsInterface::g_msgproc_mutex){};
+    NodeClock::time_point m_last_getheaders_timestamp GUARDED_BY(m_msgproc_mutex){};
 
     /** Protects m_headers_sync **/
     Mutex m_headers_sync_mutex;
@@ -400,13 +412,13 @@ struct Peer {
     std::atomic<bool> m_sent_sendheaders{false};
 
     /** Length of current-streak of unconnecting headers announcements */
-    int m_num_unconnecting_headers_msgs GUARDED_BY(NetEventsInterface::g_msgproc_mutex){0};
+    int m_num_unconnecting_headers_msgs GUARDED_BY(m_msgproc_mutex){0};
 
     /** When to potentially disconnect peer for stalling headers download */
-    std::chrono::microseconds m_headers_sync_timeout GUARDED_BY(NetEventsInterface::g_msgproc_mutex){0us};
+    std::chrono::microseconds m_headers_sync_timeout GUARDED_BY(m_msgproc_mutex){0us};
 
     /** Whether this peer wants invs or headers (when possible) for block announcements */
-    bool m_prefers_headers GUARDED_BY(NetEventsInterface::g_msgproc_mutex){false};
+    bool m_prefers_headers GUARDED_BY(m_msgproc_mutex){false};
 
     explicit Peer(NodeId id, ServiceFlags our_services)
         : m_id{id}
@@ -508,16 +520,10 @@ public:
         maxAvg = gArgs.GetIntArg("-headerspamfiltermaxavg", DEFAULT_HEADER_SPAM_FILTER_MAX_AVG);
     }
 
-    bool addHeaders(const CBlockIndex *pindexFirst, const CBlockIndex *pindexLast)
+    bool addHeaders(int nBegin, int nEnd)
     {
-        if(pindexFirst && pindexLast && maxSize && maxAvg)
+        if(nBegin >= 0 && nEnd >= nBegin && maxSize && maxAvg)
         {
-            // Get the begin block index
-            int nBegin = pindexFirst->nHeight;
-
-            // Get the end block index
-            int nEnd = pindexLast->nHeight;
-
             for(int point = nBegin; point<= nEnd; point++)
             {
                 addPoint(point);
@@ -584,6 +590,68 @@ private:
     size_t maxAvg;
 };
 
+/**
+ * The header spam filter records of the peer addresses. The addresses are split over shards
+ * by their IP, every shard with its own lock, so the HEADERS messages of different peers
+ * do not wait on each other nor on cs_main for this bookkeeping.
+ */
+class HeaderSpamFilter
+{
+public:
+    HeaderSpamFilter() :
+        m_k0(GetRand<uint64_t>()),
+        m_k1(GetRand<uint64_t>()),
+        m_ignore_port(gArgs.GetBoolArg("-headerspamfilterignoreport", DEFAULT_HEADER_SPAM_FILTER_IGNORE_PORT))
+    {}
+
+    /** Record the headers from height @p first to @p last received from @p address and update @p state if it is spamming */
+    bool Update(const CService& address, int first, int last, BlockValidationState& state, bool ret)
+    {
+        CService addr(address, m_ignore_port ? 0 : address.GetPort());
+        Shard& shard = GetShard(addr);
+        LOCK(shard.m_mutex);
+        CNodeHeaders& headers = shard.m_headers[addr];
+        headers.addHeaders(first, last);
+        return headers.updateState(state, ret);
+    }
+
+    /** Remove the records of all the ports of an address */
+    void Clean(const CAddress& addr)
+    {
+        CSubNet subNet(addr);
+        Shard& shard = GetShard(addr);
+        LOCK(shard.m_mutex);
+        for (std::map<CService, CNodeHeaders>::iterator it=shard.m_headers.begin(); it!=shard.m_headers.end();){
+            if(subNet.Match(it->first))
+            {
+                it = shard.m_headers.erase(it);
+            }
+            else{
+                it++;
+            }
+        }
+    }
+
+private:
+    static constexpr size_t SHARD_COUNT{16};
+
+    struct Shard {
+        Mutex m_mutex;
+        std::map<CService, CNodeHeaders> m_headers GUARDED_BY(m_mutex);
+    };
+
+    Shard& GetShard(const CNetAddr& addr)
+    {
+        // The port is left out so that all the ports of an address are in the same shard
+        const std::vector<unsigned char> bytes = addr.GetAddrBytes();
+        return m_shards[CSipHasher(m_k0, m_k1).Write(bytes.data(), bytes.size()).Finalize() % SHARD_COUNT];
+    }
+
+    const uint64_t m_k0, m_k1;
+    const bool m_ignore_port;
+    std::array<Shard, SHARD_COUNT> m_shards;
+};
+
 class PeerManagerImpl final : public PeerManager
 {
 public:
@@ -606,11 +674,12 @@ public:
 
     /** Implement NetEventsInterface */
     void InitializeNode(CNode& node, ServiceFlags our_services) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
-    void FinalizeNode(const CNode& node) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_headers_presync_mutex);
+    void FinalizeNode(const CNode& node) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_headers_presync_mutex, !m_state_sync_mutex);
     bool ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt) override
-        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, !m_headers_presync_mutex, g_msgproc_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, !m_headers_presync_mutex, !m_state_sync_mutex);
     bool SendMessages(CNode* pto) override
-        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, g_msgproc_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, !m_state_sync_mutex);
+    void ReceivedMessage(const CNode& node, const CNetMessage& msg) override;
 
     /** Implement PeerManager */
     void StartScheduledTasks(CScheduler& scheduler) override;
@@ -625,14 +694,21 @@ public:
     void UnitTestMisbehaving(NodeId peer_id, int howmuch) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex) { Misbehaving(*Assert(GetPeerRef(peer_id)), howmuch, ""); };
     void ProcessMessage(CNode& pfrom, const std::string& msg_type, CDataStream& vRecv,
                         const std::chrono::microseconds time_received, const std::atomic<bool>& interruptMsgProc) override
-        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, !m_headers_presync_mutex, g_msgproc_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, !m_headers_presync_mutex, !m_state_sync_mutex);
     void UpdateLastBlockAnnounceTime(NodeId node, int64_t time_in_seconds) override;
     void InitCleanBlockIndex() override;
     void StopCleanBlockIndex() override;
+    bool StartContractStateSync(const uint256& block_hash, std::string& error) override EXCLUSIVE_LOCKS_REQUIRED(!m_state_sync_mutex);
+    std::optional<qtum::ContractStateSyncStats> GetContractStateSyncStats() const override EXCLUSIVE_LOCKS_REQUIRED(!m_state_sync_mutex);
 
 private:
+    /** Process a message of @p peer, whose messages the calling thread is processing */
+    void ProcessMessage(CNode& pfrom, const PeerRef& peer, const std::string& msg_type, CDataStream& vRecv,
+                        const std::chrono::microseconds time_received, const std::atomic<bool>& interruptMsgProc)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, !m_headers_presync_mutex, !m_state_sync_mutex, peer->m_msgproc_mutex);
+
     /** Consider evicting an outbound peer based on the amount of time they've been behind our tip */
-    void ConsiderEviction(CNode& pto, Peer& peer, std::chrono::seconds time_in_seconds) EXCLUSIVE_LOCKS_REQUIRED(cs_main, g_msgproc_mutex);
+    void ConsiderEviction(CNode& pto, Peer& peer, std::chrono::seconds time_in_seconds) EXCLUSIVE_LOCKS_REQUIRED(cs_main, peer.m_msgproc_mutex);
 
     /** If we have extra outbound peers, try to disconnect the one with the oldest block announcement */
     void EvictExtraOutboundPeers(std::chrono::seconds now) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -696,7 +772,20 @@ private:
      *                     will be empty.
      */
     bool ProcessOrphanTx(Peer& peer)
-        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, g_msgproc_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, peer.m_msgproc_mutex);
+
+    /**
+     * Try a transaction that failed on its own for a mempool policy reason, such as a feerate below
+     * the mempool minimum, in a package with one of its orphaned children. The child with all of its
+     * unconfirmed parents is evaluated in one go by ProcessNewPackage(), instead of the child being
+     * reconsidered after each of its parents.
+     *
+     * @param[in]  parent   The transaction that failed on its own.
+     * @param[in]  peer     The peer that provided the transaction, its orphans are tried first.
+     * @return              True if a package was accepted to the mempool.
+     */
+    bool ProcessOrphanPackage(const CTransactionRef& parent, NodeId peer)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     /** Process a single headers message from a peer.
      *
@@ -708,7 +797,7 @@ private:
     void ProcessHeadersMessage(CNode& pfrom, Peer& peer,
                                std::vector<CBlockHeader>&& headers,
                                bool via_compact_block)
-        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_headers_presync_mutex, g_msgproc_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_headers_presync_mutex, peer.m_msgproc_mutex);
     /** Various helpers for headers processing, invoked by ProcessHeadersMessage() */
     /** Return true if headers are continuous and have valid proof-of-work and basic PoS checks (DoS points assigned on failure) */
     bool CheckHeadersSanity(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams, Peer& peer);
@@ -717,7 +806,7 @@ private:
     /** Deal with state tracking and headers sync for peers that send the
      * occasional non-connecting header (this can happen due to BIP 130 headers
      * announcements for blocks interacting with the 2hr (MAX_FUTURE_BLOCK_TIME) rule). */
-    void HandleFewUnconnectingHeaders(CNode& pfrom, Peer& peer, const std::vector<CBlockHeader>& headers) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex);
+    void HandleFewUnconnectingHeaders(CNode& pfrom, Peer& peer, const std::vector<CBlockHeader>& headers) EXCLUSIVE_LOCKS_REQUIRED(peer.m_msgproc_mutex);
     /** Return true if the headers connect to each other, false otherwise */
     bool CheckHeadersAreContinuous(const std::vector<CBlockHeader>& headers) const;
     /** Return true if the PoS headers connect to each other, false otherwise */
@@ -744,7 +833,7 @@ private:
      */
     bool IsContinuationOfLowWorkHeadersSync(Peer& peer, CNode& pfrom,
             std::vector<CBlockHeader>& headers)
-        EXCLUSIVE_LOCKS_REQUIRED(peer.m_headers_sync_mutex, !m_headers_presync_mutex, g_msgproc_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(peer.m_headers_sync_mutex, !m_headers_presync_mutex, peer.m_msgproc_mutex);
     /** Check work on a headers chain to be processed, and if insufficient,
      * initiate our anti-DoS headers sync mechanism.
      *
@@ -759,7 +848,7 @@ private:
     bool TryLowWorkHeadersSync(Peer& peer, CNode& pfrom,
                                   const CBlockIndex* chain_start_header,
                                   std::vector<CBlockHeader>& headers)
-        EXCLUSIVE_LOCKS_REQUIRED(!peer.m_headers_sync_mutex, !m_peer_mutex, !m_headers_presync_mutex, g_msgproc_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!peer.m_headers_sync_mutex, !m_peer_mutex, !m_headers_presync_mutex, peer.m_msgproc_mutex);
 
     /** Return true if the given header is an ancestor of
      *  m_chainman.m_best_header or our current tip */
@@ -769,12 +858,12 @@ private:
      * We don't issue a getheaders message if we have a recent one outstanding.
      * This returns true if a getheaders is actually sent, and false otherwise.
      */
-    bool MaybeSendGetHeaders(CNode& pfrom, const CBlockLocator& locator, Peer& peer) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex);
+    bool MaybeSendGetHeaders(CNode& pfrom, const CBlockLocator& locator, Peer& peer) EXCLUSIVE_LOCKS_REQUIRED(peer.m_msgproc_mutex);
     /** Potentially fetch blocks from this peer upon receipt of a new headers tip */
     void HeadersDirectFetchBlocks(CNode& pfrom, const Peer& peer, const CBlockIndex& last_header);
     /** Update peer state based on received headers message */
     void UpdatePeerStateForReceivedHeaders(CNode& pfrom, Peer& peer, const CBlockIndex& last_header, bool received_new_header, bool may_have_more_headers)
-        EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(peer.m_msgproc_mutex);
 
     void SendBlockTransactions(CNode& pfrom, Peer& peer, const CBlock& block, const BlockTransactionsRequest& req);
 
@@ -793,11 +882,14 @@ private:
      *  to time out. */
     void MaybeSendPing(CNode& node_to, Peer& peer, std::chrono::microseconds now);
 
+    /** Announce the transactions a reconciliation with the peer found it is missing. */
+    void AnnounceReconciledTxs(CNode& node, Peer& peer, const std::vector<uint256>& wtxids);
+
     /** Send `addr` messages on a regular schedule. */
-    void MaybeSendAddr(CNode& node, Peer& peer, std::chrono::microseconds current_time) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex);
+    void MaybeSendAddr(CNode& node, Peer& peer, std::chrono::microseconds current_time) EXCLUSIVE_LOCKS_REQUIRED(!peer.m_addr_send_mutex);
 
     /** Send a single `sendheaders` message, after we have completed headers sync with a peer. */
-    void MaybeSendSendHeaders(CNode& node, Peer& peer) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex);
+    void MaybeSendSendHeaders(CNode& node, Peer& peer) EXCLUSIVE_LOCKS_REQUIRED(peer.m_msgproc_mutex);
 
     /** Relay (gossip) an address to a few randomly chosen nodes.
      *
@@ -806,31 +898,25 @@ private:
      * @param[in] fReachable   Whether the address' network is reachable. We relay unreachable
      *                         addresses less.
      */
-    void RelayAddress(NodeId originator, const CAddress& addr, bool fReachable) EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, g_msgproc_mutex);
+    void RelayAddress(NodeId originator, const CAddress& addr, bool fReachable) EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
 
     /** Send `feefilter` message. */
-    void MaybeSendFeefilter(CNode& node, Peer& peer, std::chrono::microseconds current_time) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex);
+    void MaybeSendFeefilter(CNode& node, Peer& peer, std::chrono::microseconds current_time) EXCLUSIVE_LOCKS_REQUIRED(peer.m_msgproc_mutex);
 
     /** Process net block. */
     void PushGetBlocks(CNode& node, const CBlockIndex* pindexBegin, const uint256& hashEnd);
-    uint256 GetOrphanRoot(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
-    void PruneOrphanBlocks() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool ProcessNetBlockHeaders(CNode& node, const std::vector<CBlockHeader>& block, bool min_pow_checked, BlockValidationState& state, const CBlockIndex** ppindex=nullptr);
     bool ProcessNetBlock(const std::shared_ptr<const CBlock> pblock, bool force_processing, bool min_pow_checked, bool* new_block, CNode& node);
 
     /** Clean block index. */
     bool RemoveStateBlockIndex(CBlockIndex *pindex);
     bool RemoveNetBlockIndex(CBlockIndex *pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
-    bool NeedToEraseBlockIndex(const CBlockIndex *pindex, const CBlockIndex *pindexCheck) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    std::vector<CBlockIndex*> FindStaleBlockIndex() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool RemoveBlockIndex(CBlockIndex *pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     void CleanBlockIndex();
-    CNodeHeaders& ServiceHeaders(const CService& address) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
-    void CleanAddressHeaders(const CAddress& addr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-    std::map<uint256, COrphanBlock*> mapOrphanBlocks GUARDED_BY(cs_main);
-    std::multimap<uint256, COrphanBlock*> mapOrphanBlocksByPrev GUARDED_BY(cs_main);
-    std::set<std::pair<COutPoint, unsigned int>> setStakeSeenOrphan GUARDED_BY(cs_main);
-    size_t nOrphanBlocksSize = 0;
+    /** Storage for orphan blocks */
+    BlockOrphanage m_block_orphanage;
     std::thread threadCleanBlockIndex;
     std::atomic<bool> m_stop_thread_clean_block_index = false;
 
@@ -843,6 +929,8 @@ private:
     CTxMemPool& m_mempool;
     TxRequestTracker m_txrequest GUARDED_BY(::cs_main);
     std::unique_ptr<TxReconciliationTracker> m_txreconciliation;
+    /** Verifies the scripts of received transactions ahead of the message handler, with -parmempool */
+    std::unique_ptr<TxPreverifier> m_tx_preverifier;
 
     /** The height of the best chain */
     std::atomic<int> m_best_height{-1};
@@ -872,7 +960,7 @@ private:
 
     /** Map maintaining per-node state. */
     std::map<NodeId, CNodeState> m_node_states GUARDED_BY(cs_main);
-    std::map<CService, CNodeHeaders> m_service_headers GUARDED_BY(cs_main);
+    HeaderSpamFilter m_header_spam_filter;
 
     /** Get a pointer to a const CNodeState, used when not mutating the CNodeState object. */
     const CNodeState* State(NodeId pnode) const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -887,7 +975,7 @@ private:
     int nSyncStarted GUARDED_BY(cs_main) = 0;
 
     /** Hash of the last block we received via INV */
-    uint256 m_last_block_inv_triggering_headers_sync GUARDED_BY(g_msgproc_mutex){};
+    uint256 m_last_block_inv_triggering_headers_sync GUARDED_BY(cs_main){};
 
     /**
      * Sources of received blocks, saved to be able punish them when processing
@@ -982,6 +1070,17 @@ private:
     std::shared_ptr<const CBlock> m_most_recent_block GUARDED_BY(m_most_recent_block_mutex);
     std::shared_ptr<const CBlockHeaderAndShortTxIDs> m_most_recent_compact_block GUARDED_BY(m_most_recent_block_mutex);
     uint256 m_most_recent_block_hash GUARDED_BY(m_most_recent_block_mutex);
+    /** Shared serializations of the recent compact block, and of the recent block with and without witnesses */
+    std::optional<CSerializedNetMsg> m_most_recent_compact_block_msg GUARDED_BY(m_most_recent_block_mutex);
+    std::optional<CSerializedNetMsg> m_most_recent_block_msg GUARDED_BY(m_most_recent_block_mutex);
+    std::optional<CSerializedNetMsg> m_most_recent_block_msg_no_witness GUARDED_BY(m_most_recent_block_mutex);
+
+    /**
+     * Return the CMPCTBLOCK or BLOCK message of the most recent block, serialized once on first use
+     * and then shared by the send queues of all peers, or nullopt if @p hash is not the most recent block.
+     */
+    std::optional<CSerializedNetMsg> GetMostRecentBlockMsg(const uint256& hash, const std::string& msg_type, bool with_witness)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex);
 
     // Data about the low-work headers synchronization, aggregated from all peers' HeadersSyncStates.
     /** Mutex guarding the other m_headers_presync_* variables. */
@@ -1041,20 +1140,22 @@ private:
 
     /** Determine whether or not a peer can request a transaction, and return it (or nullptr if not found or not allowed). */
     CTransactionRef FindTxForGetData(const Peer::TxRelay& tx_relay, const GenTxid& gtxid, const std::chrono::seconds mempool_req, const std::chrono::seconds now)
-        EXCLUSIVE_LOCKS_REQUIRED(NetEventsInterface::g_msgproc_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_relay_mutex);
 
     void ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic<bool>& interruptMsgProc)
-        EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex, peer.m_getdata_requests_mutex, NetEventsInterface::g_msgproc_mutex)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex, peer.m_getdata_requests_mutex, !m_relay_mutex)
         LOCKS_EXCLUDED(::cs_main);
 
     /** Process a new block. Perform any post-processing housekeeping */
     void ProcessBlock(CNode& node, const std::shared_ptr<const CBlock>& block, bool force_processing, bool min_pow_checked);
 
+    /** Protects the relay map, shared by the message handler threads */
+    Mutex m_relay_mutex;
     /** Relay map (txid or wtxid -> CTransactionRef) */
     typedef std::map<uint256, CTransactionRef> MapRelay;
-    MapRelay mapRelay GUARDED_BY(NetEventsInterface::g_msgproc_mutex);
+    MapRelay mapRelay GUARDED_BY(m_relay_mutex);
     /** Expiration-time ordered list of (expire time, relay map entry) pairs. */
-    std::deque<std::pair<std::chrono::microseconds, MapRelay::iterator>> g_relay_expiration GUARDED_BY(NetEventsInterface::g_msgproc_mutex);
+    std::deque<std::pair<std::chrono::microseconds, MapRelay::iterator>> g_relay_expiration GUARDED_BY(m_relay_mutex);
 
     /**
      * When a peer sends us a valid block, instruct it to announce blocks to us
@@ -1073,14 +1174,16 @@ private:
     /** Storage for orphan information */
     TxOrphanage m_orphanage;
 
-    void AddToCompactExtraTransactions(const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex);
+    void AddToCompactExtraTransactions(const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(!m_extra_txn_mutex);
 
+    /** Protects the extra transactions for compact block reconstruction */
+    Mutex m_extra_txn_mutex;
     /** Orphan/conflicted/etc transactions that are kept for compact block reconstruction.
      *  The last -blockreconstructionextratxn/DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN of
      *  these are kept in a ring buffer */
-    std::vector<std::pair<uint256, CTransactionRef>> vExtraTxnForCompact GUARDED_BY(g_msgproc_mutex);
+    std::vector<std::pair<uint256, CTransactionRef>> vExtraTxnForCompact GUARDED_BY(m_extra_txn_mutex);
     /** Offset into vExtraTxnForCompact to insert the next tx */
-    size_t vExtraTxnForCompactIt GUARDED_BY(g_msgproc_mutex) = 0;
+    size_t vExtraTxnForCompactIt GUARDED_BY(m_extra_txn_mutex) = 0;
 
     /** Check whether the last unknown block a peer advertised is not yet known. */
     void ProcessBlockAvailability(NodeId nodeid) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -1153,16 +1256,37 @@ private:
      */
     void ProcessGetCFCheckPt(CNode& node, Peer& peer, CDataStream& vRecv);
 
+    /** Download of a contract state started by StartContractStateSync */
+    mutable Mutex m_state_sync_mutex;
+    std::unique_ptr<qtum::ContractStateSync> m_state_sync GUARDED_BY(m_state_sync_mutex);
+    /** Time at which the pending getstatedata of each peer times out */
+    std::map<NodeId, std::chrono::microseconds> m_state_sync_requests GUARDED_BY(m_state_sync_mutex);
+    /** Peers that did not answer a getstatedata or had none of its items, which are not asked again */
+    std::set<NodeId> m_state_sync_unusable GUARDED_BY(m_state_sync_mutex);
+
+    /**
+     * Handle a getstatedata request, served from the contract state databases.
+     *
+     * May disconnect from the peer in the case of a bad request.
+     */
+    void ProcessGetStateData(CNode& node, Peer& peer, CDataStream& vRecv);
+
+    /** Handle the statedata answer of a peer to our getstatedata */
+    void ProcessStateData(CNode& node, CDataStream& vRecv) EXCLUSIVE_LOCKS_REQUIRED(!m_state_sync_mutex);
+
+    /** Request the next items of the contract state download from a peer serving them */
+    void MaybeSendGetStateData(CNode& node, Peer& peer, std::chrono::microseconds current_time) EXCLUSIVE_LOCKS_REQUIRED(!m_state_sync_mutex);
+
     /** Checks if address relay is permitted with peer. If needed, initializes
      * the m_addr_known bloom filter and sets m_addr_relay_enabled to true.
      *
      *  @return   True if address relay is enabled with peer
      *            False if address relay is disallowed
      */
-    bool SetupAddressRelay(const CNode& node, Peer& peer) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex);
+    bool SetupAddressRelay(const CNode& node, Peer& peer) EXCLUSIVE_LOCKS_REQUIRED(!peer.m_addr_send_mutex);
 
-    void AddAddressKnown(Peer& peer, const CAddress& addr) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex);
-    void PushAddress(Peer& peer, const CAddress& addr, FastRandomContext& insecure_rand) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex);
+    void AddAddressKnown(Peer& peer, const CAddress& addr) EXCLUSIVE_LOCKS_REQUIRED(!peer.m_addr_send_mutex);
+    void PushAddress(Peer& peer, const CAddress& addr, FastRandomContext& insecure_rand) EXCLUSIVE_LOCKS_REQUIRED(!peer.m_addr_send_mutex);
 };
 
 const CNodeState* PeerManagerImpl::State(NodeId pnode) const EXCLUSIVE_LOCKS_REQUIRED(cs_main)
@@ -1190,6 +1314,7 @@ static bool IsAddrCompatible(const Peer& peer, const CAddress& addr)
 
 void PeerManagerImpl::AddAddressKnown(Peer& peer, const CAddress& addr)
 {
+    LOCK(peer.m_addr_send_mutex);
     assert(peer.m_addr_known);
     peer.m_addr_known->insert(addr.GetKey());
 }
@@ -1199,6 +1324,7 @@ void PeerManagerImpl::PushAddress(Peer& peer, const CAddress& addr, FastRandomCo
     // Known checking here is only to save space from duplicates.
     // Before sending, we'll filter it again for known addresses that were
     // added after addresses were pushed.
+    LOCK(peer.m_addr_send_mutex);
     assert(peer.m_addr_known);
     if (addr.IsValid() && !peer.m_addr_known->contains(addr.GetKey()) && IsAddrCompatible(peer, addr)) {
         if (peer.m_addrs_to_send.size() >= MAX_ADDR_TO_SEND) {
@@ -1218,6 +1344,29 @@ static void AddKnownTx(Peer& peer, const uint256& hash)
     tx_relay->m_tx_inventory_known_filter.insert(hash);
 }
 
+void PeerManagerImpl::AnnounceReconciledTxs(CNode& node, Peer& peer, const std::vector<uint256>& wtxids)
+{
+    auto tx_relay = peer.GetTxRelay();
+    if (!tx_relay || wtxids.empty()) return;
+
+    std::vector<CInv> vInv;
+    vInv.reserve(std::min<size_t>(wtxids.size(), MAX_INV_SZ));
+    const CNetMsgMaker msgMaker(node.GetCommonVersion());
+    {
+        LOCK(tx_relay->m_tx_inventory_mutex);
+        for (const uint256& wtxid : wtxids) {
+            tx_relay->m_recently_announced_invs.insert(wtxid);
+            tx_relay->m_tx_inventory_known_filter.insert(wtxid);
+            vInv.emplace_back(MSG_WTX, wtxid);
+            if (vInv.size() == MAX_INV_SZ) {
+                m_connman.PushMessage(&node, msgMaker.Make(NetMsgType::INV, vInv));
+                vInv.clear();
+            }
+        }
+    }
+    if (!vInv.empty()) m_connman.PushMessage(&node, msgMaker.Make(NetMsgType::INV, vInv));
+}
+
 /** Whether this peer can serve us blocks. */
 static bool CanServeBlocks(const Peer& peer)
 {
@@ -1238,26 +1387,6 @@ static bool CanServeWitnesses(const Peer& peer)
     return peer.m_their_services & NODE_WITNESS;
 }
 
-CNodeHeaders& PeerManagerImpl::ServiceHeaders(const CService& address) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
-    unsigned short port =
-            gArgs.GetBoolArg("-headerspamfilterignoreport", DEFAULT_HEADER_SPAM_FILTER_IGNORE_PORT) ? 0 : address.GetPort();
-    CService addr(address, port);
-    return m_service_headers[addr];
-}
-
-void PeerManagerImpl::CleanAddressHeaders(const CAddress& addr) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
-    CSubNet subNet(addr);
-    for (std::map<CService, CNodeHeaders>::iterator it=m_service_headers.begin(); it!=m_service_headers.end();){
-        if(subNet.Match(it->first))
-        {
-            it = m_service_headers.erase(it);
-        }
-        else{
-            it++;
-        }
-    }
-}
-
 std::chrono::microseconds PeerManagerImpl::NextInvToInbounds(std::chrono::microseconds now,
                                                              std::chrono::seconds average_interval)
 {
@@ -1590,15 +1719,12 @@ void PeerManagerImpl::PushNodeVersion(CNode& pnode, const Peer& peer)
 
 bool PeerManagerImpl::ProcessNetBlockHeaders(CNode& pfrom, const std::vector<CBlockHeader>& block, bool min_pow_checked, BlockValidationState& state, const CBlockIndex** ppindex)
 {
-    const CBlockIndex *pindexFirst = nullptr;
-    bool ret = m_chainman.ProcessNewBlockHeaders(block, min_pow_checked, state, ppindex, &pindexFirst);
+    // The heights are read under cs_main, the block indexes may be erased by CleanBlockIndex once it is released
+    std::pair<int, int> accepted_heights;
+    bool ret = m_chainman.ProcessNewBlockHeaders(block, min_pow_checked, state, ppindex, &accepted_heights);
     if(gArgs.GetBoolArg("-headerspamfilter", DEFAULT_HEADER_SPAM_FILTER))
     {
-        LOCK(cs_main);
-        CNodeHeaders& headers = ServiceHeaders(pfrom.GetAddrLocal());
-        const CBlockIndex *pindexLast = ppindex == nullptr ? nullptr : *ppindex;
-        headers.addHeaders(pindexFirst, pindexLast);
-        return headers.updateState(state, ret);
+        return m_header_spam_filter.Update(pfrom.GetAddrLocal(), accepted_heights.first, accepted_heights.second, state, ret);
     }
     return ret;
 }
@@ -1711,6 +1837,7 @@ void PeerManagerImpl::FinalizeNode(const CNode& node)
         }
     }
     m_orphanage.EraseForPeer(nodeid);
+    m_block_orphanage.EraseForPeer(nodeid);
     m_txrequest.DisconnectedPeer(nodeid);
     if (m_txreconciliation) m_txreconciliation->ForgetPeer(nodeid);
     m_num_preferred_download_peers -= state->fPreferredDownload;
@@ -1743,6 +1870,12 @@ void PeerManagerImpl::FinalizeNode(const CNode& node)
         LOCK(m_headers_presync_mutex);
         m_headers_presync_stats.erase(nodeid);
     }
+    {
+        LOCK(m_state_sync_mutex);
+        if (m_state_sync) m_state_sync->PeerDone(nodeid);
+        m_state_sync_requests.erase(nodeid);
+        m_state_sync_unusable.erase(nodeid);
+    }
     LogPrint(BCLog::NET, "Cleared nodestate for peer=%d\n", nodeid);
 }
 
@@ -1822,6 +1955,7 @@ void PeerManagerImpl::AddToCompactExtraTransactions(const CTransactionRef& tx)
     size_t max_extra_txn = gArgs.GetIntArg("-blockreconstructionextratxn", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN);
     if (max_extra_txn <= 0)
         return;
+    LOCK(m_extra_txn_mutex);
     if (!vExtraTxnForCompact.size())
         vExtraTxnForCompact.resize(max_extra_txn);
     vExtraTxnForCompact[vExtraTxnForCompactIt] = std::make_pair(tx->GetWitnessHash(), tx);
@@ -1999,7 +2133,8 @@ std::unique_ptr<PeerManager> PeerManager::make(CConnman& connman, AddrMan& addrm
 PeerManagerImpl::PeerManagerImpl(CConnman& connman, AddrMan& addrman,
                                  BanMan* banman, ChainstateManager& chainman,
                                  CTxMemPool& pool, bool ignore_incoming_txs)
-    : m_chainparams(chainman.GetParams()),
+    : m_block_orphanage(gArgs.GetIntArg("-maxorphanblocksmib", DEFAULT_MAX_ORPHAN_BLOCKS) * ((size_t) 1 << 20)),
+      m_chainparams(chainman.GetParams()),
       m_connman(connman),
       m_addrman(addrman),
       m_banman(banman),
@@ -2007,11 +2142,16 @@ PeerManagerImpl::PeerManagerImpl(CConnman& connman, AddrMan& addrman,
       m_mempool(pool),
       m_ignore_incoming_txs(ignore_incoming_txs)
 {
-    // While Erlay support is incomplete, it must be enabled explicitly via -txreconciliation.
-    // This argument can go away after Erlay support is complete.
+    // Erlay is off by default until it has seen more use, it is enabled via -txreconciliation.
     if (gArgs.GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION_ENABLE)) {
         m_txreconciliation = std::make_unique<TxReconciliationTracker>(TXRECONCILIATION_VERSION);
     }
+
+    const int preverify_threads = std::clamp<int>(gArgs.GetIntArg("-parmempool", DEFAULT_TXPREVERIFY_THREADS), 0, MAX_TXPREVERIFY_THREADS);
+    if (preverify_threads > 0 && !m_ignore_incoming_txs) {
+        LogPrintf("Relayed transaction verification uses %d threads\n", preverify_threads);
+        m_tx_preverifier = std::make_unique<TxPreverifier>(chainman, pool, preverify_threads);
+    }
 }
 
 void PeerManagerImpl::StartScheduledTasks(CScheduler& scheduler)
@@ -2094,7 +2234,6 @@ void PeerManagerImpl::BlockDisconnected(const std::shared_ptr<const CBlock> &blo
 void PeerManagerImpl::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock)
 {
     auto pcmpctblock = std::make_shared<const CBlockHeaderAndShortTxIDs>(*pblock);
-    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
 
     LOCK(cs_main);
 
@@ -2105,17 +2244,18 @@ void PeerManagerImpl::NewPoWValidBlock(const CBlockIndex *pindex, const std::sha
     if (!DeploymentActiveAt(*pindex, m_chainman, Consensus::DEPLOYMENT_SEGWIT)) return;
 
     uint256 hashBlock(pblock->GetHash());
-    const std::shared_future<CSerializedNetMsg> lazy_ser{
-        std::async(std::launch::deferred, [&] { return msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock); })};
 
     {
         LOCK(m_most_recent_block_mutex);
         m_most_recent_block_hash = hashBlock;
         m_most_recent_block = pblock;
         m_most_recent_compact_block = pcmpctblock;
+        m_most_recent_compact_block_msg.reset();
+        m_most_recent_block_msg.reset();
+        m_most_recent_block_msg_no_witness.reset();
     }
 
-    m_connman.ForEachNode([this, pindex, &lazy_ser, &hashBlock](CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
+    m_connman.ForEachNode([this, pindex, &hashBlock](CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
         AssertLockHeld(::cs_main);
 
         if (pnode->GetCommonVersion() < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
@@ -2129,13 +2269,38 @@ void PeerManagerImpl::NewPoWValidBlock(const CBlockIndex *pindex, const std::sha
             LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerManager::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->GetId());
 
-            const CSerializedNetMsg& ser_cmpctblock{lazy_ser.get()};
-            m_connman.PushMessage(pnode, ser_cmpctblock.Copy());
+            // The compact block is serialized for the first peer, and shared with the others
+            std::optional<CSerializedNetMsg> ser_cmpctblock{GetMostRecentBlockMsg(hashBlock, NetMsgType::CMPCTBLOCK, /*with_witness=*/true)};
+            if (!ser_cmpctblock) return;
+            m_connman.PushMessage(pnode, std::move(*ser_cmpctblock));
             state.pindexBestHeaderSent = pindex;
         }
     });
 }
 
+std::optional<CSerializedNetMsg> PeerManagerImpl::GetMostRecentBlockMsg(const uint256& hash, const std::string& msg_type, bool with_witness)
+{
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    LOCK(m_most_recent_block_mutex);
+    if (!m_most_recent_block || m_most_recent_block_hash != hash) return std::nullopt;
+
+    if (msg_type == NetMsgType::CMPCTBLOCK) {
+        if (!m_most_recent_compact_block) return std::nullopt;
+        if (!m_most_recent_compact_block_msg) {
+            m_most_recent_compact_block_msg = msgMaker.Make(NetMsgType::CMPCTBLOCK, *m_most_recent_compact_block);
+            m_most_recent_compact_block_msg->Share();
+        }
+        return m_most_recent_compact_block_msg->Copy();
+    }
+
+    std::optional<CSerializedNetMsg>& block_msg{with_witness ? m_most_recent_block_msg : m_most_recent_block_msg_no_witness};
+    if (!block_msg) {
+        block_msg = msgMaker.Make(with_witness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS, msg_type, *m_most_recent_block);
+        block_msg->Share();
+    }
+    return block_msg->Copy();
+}
+
 /**
  * Update our best height and announce any block hashes which weren't previously
  * in m_chainman.ActiveChain() to our peers.
@@ -2326,11 +2491,9 @@ void PeerManagerImpl::RelayAddress(NodeId originator,
 void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv& inv)
 {
     std::shared_ptr<const CBlock> a_recent_block;
-    std::shared_ptr<const CBlockHeaderAndShortTxIDs> a_recent_compact_block;
     {
         LOCK(m_most_recent_block_mutex);
         a_recent_block = m_most_recent_block;
-        a_recent_compact_block = m_most_recent_compact_block;
     }
 
     bool need_activate_chain = false;
@@ -2392,13 +2555,21 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
     std::shared_ptr<const CBlock> pblock;
     if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
         pblock = a_recent_block;
-    } else if (inv.IsMsgWitnessBlk()) {
+    } else if (inv.IsMsgWitnessBlk() || inv.IsMsgBlk()) {
         // Fast-path: in this case it is possible to serve the block directly from disk,
-        // as the network format matches the format on disk
+        // as the network format matches the format on disk. Peers that do not want the
+        // witnesses get them cut from the bytes, without deserializing the block.
         std::vector<uint8_t> block_data;
         if (!ReadRawBlockFromDisk(block_data, pindex->GetBlockPos(), m_chainparams.MessageStart())) {
             assert(!"cannot load block from disk");
         }
+        if (inv.IsMsgBlk()) {
+            std::vector<uint8_t> stripped_data;
+            if (!StripBlockWitnesses(block_data, stripped_data)) {
+                assert(!"cannot parse block from disk");
+            }
+            block_data.swap(stripped_data);
+        }
         m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, Span{block_data}));
         // Don't set pblock as we've sent the block
     } else {
@@ -2410,10 +2581,16 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
         pblock = pblockRead;
     }
     if (pblock) {
-        if (inv.IsMsgBlk()) {
-            m_connman.PushMessage(&pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
-        } else if (inv.IsMsgWitnessBlk()) {
-            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
+        if (inv.IsMsgBlk() || inv.IsMsgWitnessBlk()) {
+            // Many peers ask for the most recent block, they all get the same serialization
+            std::optional<CSerializedNetMsg> recent_msg{GetMostRecentBlockMsg(pblock->GetHash(), NetMsgType::BLOCK, inv.IsMsgWitnessBlk())};
+            if (recent_msg) {
+                m_connman.PushMessage(&pfrom, std::move(*recent_msg));
+            } else if (inv.IsMsgBlk()) {
+                m_connman.PushMessage(&pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
+            } else {
+                m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
+            }
         } else if (inv.IsMsgFilteredBlk()) {
             bool sendMerkleBlock = false;
             CMerkleBlock merkleBlock;
@@ -2444,8 +2621,9 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
             // and we don't feel like constructing the object for them, so
             // instead we respond with the full, non-compact block.
             if (CanDirectFetch() && pindex->nHeight >= m_chainman.ActiveChain().Height() - MAX_CMPCTBLOCK_DEPTH) {
-                if (a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
-                    m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
+                std::optional<CSerializedNetMsg> recent_msg{GetMostRecentBlockMsg(pindex->GetBlockHash(), NetMsgType::CMPCTBLOCK, /*with_witness=*/true)};
+                if (recent_msg) {
+                    m_connman.PushMessage(&pfrom, std::move(*recent_msg));
                 } else {
                     CBlockHeaderAndShortTxIDs cmpctblock{*pblock};
                     m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, cmpctblock));
@@ -2484,10 +2662,11 @@ CTransactionRef PeerManagerImpl::FindTxForGetData(const Peer::TxRelay& tx_relay,
     }
 
     // Otherwise, the transaction must have been announced recently.
-    if (tx_relay.m_recently_announced_invs.contains(gtxid.GetHash())) {
+    if (WITH_LOCK(tx_relay.m_tx_inventory_mutex, return tx_relay.m_recently_announced_invs.contains(gtxid.GetHash()))) {
         // If it was, it can be relayed from either the mempool...
         if (txinfo.tx) return std::move(txinfo.tx);
         // ... or the relay pool.
+        LOCK(m_relay_mutex);
         auto mi = mapRelay.find(gtxid.GetHash());
         if (mi != mapRelay.end()) return mi->second;
     }
@@ -2549,7 +2728,8 @@ void PeerManagerImpl::ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic
             }
             for (const uint256& parent_txid : parent_ids_to_add) {
                 // Relaying a transaction with a recent but unconfirmed parent.
-                if (WITH_LOCK(tx_relay->m_tx_inventory_mutex, return !tx_relay->m_tx_inventory_known_filter.contains(parent_txid))) {
+                LOCK(tx_relay->m_tx_inventory_mutex);
+                if (!tx_relay->m_tx_inventory_known_filter.contains(parent_txid)) {
                     tx_relay->m_recently_announced_invs.insert(parent_txid);
                 }
             }
@@ -3194,7 +3374,7 @@ void PeerManagerImpl::ProcessHeadersMessage(CNode& pfrom, Peer& peer,
 
 bool PeerManagerImpl::ProcessOrphanTx(Peer& peer)
 {
-    AssertLockHeld(g_msgproc_mutex);
+    AssertLockHeld(peer.m_msgproc_mutex);
     LOCK(cs_main);
 
     CTransactionRef porphanTx = nullptr;
@@ -3213,6 +3393,9 @@ bool PeerManagerImpl::ProcessOrphanTx(Peer& peer)
                 AddToCompactExtraTransactions(removedTx);
             }
             return true;
+        } else if (state.GetResult() == TxValidationResult::TX_MEMPOOL_POLICY && ProcessOrphanPackage(porphanTx, peer.m_id)) {
+            m_orphanage.EraseTx(orphanHash);
+            return true;
         } else if (state.GetResult() != TxValidationResult::TX_MISSING_INPUTS) {
             if (state.IsInvalid()) {
                 LogPrint(BCLog::MEMPOOL, "   invalid orphan tx %s from peer=%d. %s\n",
@@ -3262,6 +3445,65 @@ bool PeerManagerImpl::ProcessOrphanTx(Peer& peer)
     return false;
 }
 
+bool PeerManagerImpl::ProcessOrphanPackage(const CTransactionRef& parent, NodeId peer)
+{
+    AssertLockHeld(cs_main);
+
+    const auto children = m_orphanage.GetChildren(*parent, peer);
+    for (size_t i = 0; i < children.size() && i < MAX_ORPHAN_PACKAGE_CHILDREN; ++i) {
+        const CTransactionRef& child = children[i].first;
+
+        // The child's other unconfirmed parents are in the mempool, they go first in the package,
+        // sorted by their number of ancestors so that the package is sorted topologically
+        Package package;
+        {
+            LOCK(m_mempool.cs);
+            std::vector<std::pair<uint64_t, CTransactionRef>> mempool_parents;
+            std::set<uint256> parent_txids;
+            for (const CTxIn& txin : child->vin) {
+                const uint256& parent_txid = txin.prevout.hash;
+                if (parent_txid == parent->GetHash() || !parent_txids.insert(parent_txid).second) continue;
+                if (const auto it = m_mempool.GetIter(parent_txid)) {
+                    mempool_parents.emplace_back((*it)->GetCountWithAncestors(), (*it)->GetSharedTx());
+                }
+            }
+            std::sort(mempool_parents.begin(), mempool_parents.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (auto& [ancestors, mempool_parent] : mempool_parents) {
+                package.push_back(std::move(mempool_parent));
+            }
+        }
+        package.push_back(parent);
+        package.push_back(child);
+
+        const PackageMempoolAcceptResult result = ProcessNewPackage(m_chainman.ActiveChainstate(), m_mempool, package, /*test_accept=*/false);
+        if (result.m_state.IsInvalid()) {
+            LogPrint(BCLog::MEMPOOL, "   package of tx %s with orphan %s from peer=%d not accepted: %s\n",
+                parent->GetHash().ToString(), child->GetHash().ToString(), children[i].second, result.m_state.ToString());
+            continue;
+        }
+
+        for (const CTransactionRef& tx : package) {
+            const auto it = result.m_tx_results.find(tx->GetWitnessHash());
+            if (it == result.m_tx_results.end() || it->second.m_result_type != MempoolAcceptResult::ResultType::VALID) continue;
+            m_txrequest.ForgetTxHash(tx->GetHash());
+            m_txrequest.ForgetTxHash(tx->GetWitnessHash());
+            RelayTransaction(tx->GetHash(), tx->GetWitnessHash());
+            m_orphanage.AddChildrenToWorkSet(*tx);
+            if (it->second.m_replaced_transactions) {
+                for (const CTransactionRef& removedTx : it->second.m_replaced_transactions.value()) {
+                    AddToCompactExtraTransactions(removedTx);
+                }
+            }
+        }
+        m_orphanage.EraseTx(child->GetHash());
+        LogPrint(BCLog::MEMPOOL, "   accepted package of tx %s with orphan %s from peer=%d (poolsz %u txn, %u kB)\n",
+            parent->GetHash().ToString(), child->GetHash().ToString(), children[i].second,
+            m_mempool.size(), m_mempool.DynamicMemoryUsage() / 1000);
+        return true;
+    }
+    return false;
+}
+
 bool PeerManagerImpl::PrepareBlockFilterRequest(CNode& node, Peer& peer,
                                                 BlockFilterType filter_type, uint32_t start_height,
                                                 const uint256& stop_hash, uint32_t max_height_diff,
@@ -3269,8 +3511,9 @@ bool PeerManagerImpl::PrepareBlockFilterRequest(CNode& node, Peer& peer,
                                                 BlockFilterIndex*& filter_index)
 {
     const bool supported_filter_type =
-        (filter_type == BlockFilterType::BASIC &&
-         (peer.m_our_services & NODE_COMPACT_FILTERS));
+        (peer.m_our_services & NODE_COMPACT_FILTERS) &&
+        (filter_type == BlockFilterType::BASIC ||
+         (filter_type == BlockFilterType::CONTRACT && GetBlockFilterIndex(filter_type)));
     if (!supported_filter_type) {
         LogPrint(BCLog::NET, "peer %d requested unsupported block filter type: %d\n",
                  node.GetId(), static_cast<uint8_t>(filter_type));
@@ -3430,6 +3673,115 @@ void PeerManagerImpl::ProcessGetCFCheckPt(CNode& node, Peer& peer, CDataStream&
     m_connman.PushMessage(&node, std::move(msg));
 }
 
+void PeerManagerImpl::ProcessGetStateData(CNode& node, Peer& peer, CDataStream& vRecv)
+{
+    if (!(peer.m_our_services & NODE_CONTRACT_STATE)) {
+        LogPrint(BCLog::NET, "peer %d requested contract state, which is not served\n", node.GetId());
+        node.fDisconnect = true;
+        return;
+    }
+
+    std::vector<qtum::StateItemRequest> requests;
+    vRecv >> requests;
+    if (requests.size() > qtum::MAX_STATE_DATA_ITEMS) {
+        Misbehaving(peer, 20, strprintf("getstatedata message size = %u", requests.size()));
+        return;
+    }
+
+    std::shared_ptr<const ContractCallSnapshot> snapshot = GetContractCallSnapshot(m_chainman.ActiveChainstate());
+    if (!snapshot) return;
+    const std::vector<qtum::StateItem> items = qtum::ReadStateItems(snapshot->view, requests);
+    m_connman.PushMessage(&node, CNetMsgMaker(node.GetCommonVersion()).Make(NetMsgType::STATEDATA, items));
+}
+
+void PeerManagerImpl::ProcessStateData(CNode& node, CDataStream& vRecv)
+{
+    std::vector<qtum::StateItem> items;
+    vRecv >> items;
+
+    LOCK(m_state_sync_mutex);
+    if (!m_state_sync || !m_state_sync_requests.erase(node.GetId())) {
+        LogPrint(BCLog::NET, "unrequested statedata from peer=%d\n", node.GetId());
+        return;
+    }
+
+    const size_t needed = m_state_sync->ProcessItems(node.GetId(), items);
+    if (needed == 0) {
+        // The peer does not have the state of the block, or not anymore
+        LogPrint(BCLog::NET, "peer=%d has none of the contract state items requested\n", node.GetId());
+        m_state_sync_unusable.insert(node.GetId());
+    }
+    if (m_state_sync->IsComplete()) {
+        const qtum::ContractStateSyncStats stats = m_state_sync->GetStats();
+        LogPrintf("Contract state of block %s downloaded: %u nodes, %u bytes\n", stats.block_hash.ToString(), stats.nodes + stats.aux, stats.bytes);
+    }
+}
+
+void PeerManagerImpl::MaybeSendGetStateData(CNode& node, Peer& peer, std::chrono::microseconds current_time)
+{
+    if (!(peer.m_their_services & NODE_CONTRACT_STATE) || node.fDisconnect) return;
+
+    LOCK(m_state_sync_mutex);
+    if (!m_state_sync || m_state_sync->IsComplete() || m_state_sync_unusable.count(node.GetId())) return;
+
+    auto it = m_state_sync_requests.find(node.GetId());
+    if (it != m_state_sync_requests.end()) {
+        if (current_time < it->second) return;
+        LogPrint(BCLog::NET, "getstatedata timeout for peer=%d\n", node.GetId());
+        m_state_sync->PeerDone(node.GetId());
+        m_state_sync_requests.erase(it);
+        m_state_sync_unusable.insert(node.GetId());
+        return;
+    }
+
+    const std::vector<qtum::StateItemRequest> requests = m_state_sync->NextRequests(node.GetId(), qtum::MAX_STATE_DATA_ITEMS);
+    if (requests.empty()) return;
+    m_state_sync_requests.emplace(node.GetId(), current_time + STATE_DATA_TIMEOUT);
+    m_connman.PushMessage(&node, CNetMsgMaker(node.GetCommonVersion()).Make(NetMsgType::GETSTATEDATA, requests));
+}
+
+bool PeerManagerImpl::StartContractStateSync(const uint256& block_hash, std::string& error)
+{
+    if (g_state_pruner) {
+        error = "The contract state cannot be downloaded while -statepruning is enabled";
+        return false;
+    }
+
+    std::unique_ptr<QtumState> state;
+    uint256 state_root, utxo_root;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindex = m_chainman.m_blockman.LookupBlockIndex(block_hash);
+        if (!pindex) {
+            error = "Block not found";
+            return false;
+        }
+        state_root = pindex->hashStateRoot;
+        utxo_root = pindex->hashUTXORoot;
+        // The tries are downloaded into the shared databases, on a state of their own
+        state = std::make_unique<QtumState>(*globalState);
+    }
+
+    LOCK(m_state_sync_mutex);
+    if (m_state_sync && !m_state_sync->IsComplete()) {
+        if (m_state_sync->GetStats().block_hash == block_hash) return true;
+        error = "The contract state of block " + m_state_sync->GetStats().block_hash.ToString() + " is being downloaded";
+        return false;
+    }
+    m_state_sync = std::make_unique<qtum::ContractStateSync>(std::move(state), block_hash, state_root, utxo_root);
+    m_state_sync_requests.clear();
+    m_state_sync_unusable.clear();
+    LogPrintf("Downloading the contract state of block %s\n", block_hash.ToString());
+    return true;
+}
+
+std::optional<qtum::ContractStateSyncStats> PeerManagerImpl::GetContractStateSyncStats() const
+{
+    LOCK(m_state_sync_mutex);
+    if (!m_state_sync) return std::nullopt;
+    return m_state_sync->GetStats();
+}
+
 void PeerManagerImpl::ProcessBlock(CNode& node, const std::shared_ptr<const CBlock>& block, bool force_processing, bool min_pow_checked)
 {
     bool new_block{false};
@@ -3451,13 +3803,21 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                                      const std::chrono::microseconds time_received,
                                      const std::atomic<bool>& interruptMsgProc)
 {
-    AssertLockHeld(g_msgproc_mutex);
-
-    LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(msg_type), vRecv.size(), pfrom.GetId());
-
     PeerRef peer = GetPeerRef(pfrom.GetId());
     if (peer == nullptr) return;
 
+    LOCK(peer->m_msgproc_mutex);
+    ProcessMessage(pfrom, peer, msg_type, vRecv, time_received, interruptMsgProc);
+}
+
+void PeerManagerImpl::ProcessMessage(CNode& pfrom, const PeerRef& peer, const std::string& msg_type, CDataStream& vRecv,
+                                     const std::chrono::microseconds time_received,
+                                     const std::atomic<bool>& interruptMsgProc)
+{
+    AssertLockHeld(peer->m_msgproc_mutex);
+
+    LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(msg_type), vRecv.size(), pfrom.GetId());
+
     if (msg_type == NetMsgType::VERSION) {
         if (pfrom.nVersion != 0) {
             LogPrint(BCLog::NET, "redundant version message from peer=%d\n", pfrom.GetId());
@@ -3874,6 +4234,48 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         return;
     }
 
+    if (msg_type == NetMsgType::REQRECON || msg_type == NetMsgType::SKETCH || msg_type == NetMsgType::RECONCILDIFF) {
+        if (!m_txreconciliation || !m_txreconciliation->IsPeerRegistered(pfrom.GetId())) {
+            LogPrintLevel(BCLog::NET, BCLog::Level::Debug, "%s from peer=%d ignored, as we do not reconcile transactions with it\n", msg_type, pfrom.GetId());
+            return;
+        }
+
+        if (msg_type == NetMsgType::REQRECON) {
+            uint16_t peer_set_size, peer_q;
+            vRecv >> peer_set_size >> peer_q;
+            const std::optional<std::vector<uint8_t>> skdata{m_txreconciliation->HandleReconciliationRequest(pfrom.GetId(), peer_set_size, peer_q)};
+            if (!skdata) {
+                LogPrintLevel(BCLog::NET, BCLog::Level::Debug, "txreconciliation protocol violation from peer=%d (unexpected reqrecon); disconnecting\n", pfrom.GetId());
+                pfrom.fDisconnect = true;
+                return;
+            }
+            m_connman.PushMessage(&pfrom, CNetMsgMaker(pfrom.GetCommonVersion()).Make(NetMsgType::SKETCH, *skdata));
+        } else if (msg_type == NetMsgType::SKETCH) {
+            std::vector<uint8_t> skdata;
+            vRecv >> skdata;
+            const std::optional<ReconciliationResult> result{m_txreconciliation->HandleSketch(pfrom.GetId(), skdata)};
+            if (!result) {
+                LogPrintLevel(BCLog::NET, BCLog::Level::Debug, "txreconciliation protocol violation from peer=%d (unexpected or invalid sketch); disconnecting\n", pfrom.GetId());
+                pfrom.fDisconnect = true;
+                return;
+            }
+            m_connman.PushMessage(&pfrom, CNetMsgMaker(pfrom.GetCommonVersion()).Make(NetMsgType::RECONCILDIFF, uint8_t{result->m_success}, result->m_ask_short_ids));
+            AnnounceReconciledTxs(pfrom, *peer, result->m_announce_wtxids);
+        } else {
+            uint8_t success;
+            std::vector<uint32_t> ask_short_ids;
+            vRecv >> success >> ask_short_ids;
+            const std::optional<std::vector<uint256>> announce{m_txreconciliation->HandleReconciliationDifference(pfrom.GetId(), success != 0, ask_short_ids)};
+            if (!announce) {
+                LogPrintLevel(BCLog::NET, BCLog::Level::Debug, "txreconciliation protocol violation from peer=%d (unexpected reconcildiff); disconnecting\n", pfrom.GetId());
+                pfrom.fDisconnect = true;
+                return;
+            }
+            AnnounceReconciledTxs(pfrom, *peer, *announce);
+        }
+        return;
+    }
+
     if (msg_type == NetMsgType::ADDR || msg_type == NetMsgType::ADDRV2) {
         int stream_version = vRecv.GetVersion();
         if (msg_type == NetMsgType::ADDRV2) {
@@ -4023,6 +4425,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                 LogPrint(BCLog::NET, "got inv: %s  %s peer=%d\n", inv.ToString(), fAlreadyHave ? "have" : "new", pfrom.GetId());
 
                 AddKnownTx(*peer, inv.hash);
+                if (m_txreconciliation && inv.IsMsgWtx()) m_txreconciliation->TryRemovingFromSet(pfrom.GetId(), inv.hash);
                 if (!fAlreadyHave && !m_chainman.ActiveChainstate().IsInitialBlockDownload()) {
                     AddTxAnnouncement(pfrom, gtxid, current_time);
                 }
@@ -4258,10 +4661,30 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                 pindex = m_chainman.ActiveChain().Next(pindex);
         }
 
+        LogPrint(BCLog::NET, "getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.IsNull() ? "end" : hashStop.ToString(), pfrom.GetId());
+        if (g_header_store && pindex && m_chainman.ActiveChain().Contains(pindex)) {
+            // Serve the headers already serialized in the store, up to the same last header as below
+            const CChain& active_chain = m_chainman.ActiveChain();
+            int last = std::min<int>(pindex->nHeight + MAX_HEADERS_RESULTS - 1, active_chain.Height());
+            const CBlockIndex* stop = hashStop.IsNull() ? nullptr : m_chainman.m_blockman.LookupBlockIndex(hashStop);
+            if (stop && active_chain.Contains(stop) && stop->nHeight >= pindex->nHeight) {
+                last = std::min(last, stop->nHeight);
+            }
+            g_header_store->Sync(active_chain);
+            CSerializedNetMsg msg;
+            msg.m_type = NetMsgType::HEADERS;
+            CVectorWriter{SER_NETWORK, PROTOCOL_VERSION, msg.data, 0} << COMPACTSIZE(uint64_t(last - pindex->nHeight + 1));
+            if (g_header_store->Read(pindex->nHeight, last + 1, msg.data, /*tx_counts=*/true)) {
+                // As below, reset the best header sent to the last one
+                nodestate->pindexBestHeaderSent = active_chain[last];
+                m_connman.PushMessage(&pfrom, std::move(msg));
+                return;
+            }
+        }
+
         // we must use CBlocks, as CBlockHeaders won't include the 0x00 nTx count at the end
         std::vector<CBlock> vHeaders;
         int nLimit = MAX_HEADERS_RESULTS;
-        LogPrint(BCLog::NET, "getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.IsNull() ? "end" : hashStop.ToString(), pfrom.GetId());
         for (; pindex; pindex = m_chainman.ActiveChain().Next(pindex))
         {
             vHeaders.push_back(pindex->GetBlockHeader());
@@ -4306,6 +4729,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
 
         const uint256& hash = peer->m_wtxid_relay ? wtxid : txid;
         AddKnownTx(*peer, hash);
+        if (m_txreconciliation) m_txreconciliation->TryRemovingFromSet(pfrom.GetId(), wtxid);
         if (peer->m_wtxid_relay && txid != wtxid) {
             // Insert txid into m_tx_inventory_known_filter, even for
             // wtxidrelay peers. This prevents re-adding of
@@ -4427,6 +4851,8 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                 m_txrequest.ForgetTxHash(tx.GetHash());
                 m_txrequest.ForgetTxHash(tx.GetWitnessHash());
             }
+        } else if (state.GetResult() == TxValidationResult::TX_MEMPOOL_POLICY && ProcessOrphanPackage(ptx, pfrom.GetId())) {
+            pfrom.m_last_tx_time = GetTime<std::chrono::seconds>();
         } else {
             if (state.GetResult() != TxValidationResult::TX_WITNESS_STRIPPED) {
                 // We can add the wtxid of this transaction to our reject filter.
@@ -4619,7 +5045,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                 }
 
                 PartiallyDownloadedBlock& partialBlock = *(*queuedBlockIt)->partialBlock;
-                ReadStatus status = partialBlock.InitData(cmpctblock, vExtraTxnForCompact);
+                ReadStatus status = WITH_LOCK(m_extra_txn_mutex, return partialBlock.InitData(cmpctblock, vExtraTxnForCompact));
                 if (status == READ_STATUS_INVALID) {
                     RemoveBlockRequest(pindex->GetBlockHash(), pfrom.GetId()); // Reset in-flight state in case Misbehaving does not result in a disconnect
                     Misbehaving(*peer, 100, "invalid compact block");
@@ -4674,7 +5100,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                 // Optimistically try to reconstruct anyway since we might be
                 // able to without any round trips.
                 PartiallyDownloadedBlock tempBlock(&m_mempool, &m_chainman);
-                ReadStatus status = tempBlock.InitData(cmpctblock, vExtraTxnForCompact);
+                ReadStatus status = WITH_LOCK(m_extra_txn_mutex, return tempBlock.InitData(cmpctblock, vExtraTxnForCompact));
                 if (status != READ_STATUS_OK) {
                     // TODO: don't ignore failures
                     return;
@@ -4701,7 +5127,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         } // cs_main
 
         if (fProcessBLOCKTXN) {
-            return ProcessMessage(pfrom, NetMsgType::BLOCKTXN, blockTxnMsg, time_received, interruptMsgProc);
+            return ProcessMessage(pfrom, peer, NetMsgType::BLOCKTXN, blockTxnMsg, time_received, interruptMsgProc);
         }
 
         if (fRevertToHeaderProcessing) {
@@ -4891,7 +5317,12 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         }
 
         std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-        vRecv >> *pblock;
+        {
+            // The scripts of the block take their buffers from a few chunks sized after the message
+            DeserializeArena arena{vRecv.size()};
+            DeserializeArenaScope arena_scope{arena};
+            vRecv >> *pblock;
+        }
 
         LogPrint(BCLog::NET, "received block %s peer=%d\n", pblock->GetHash().ToString(), pfrom.GetId());
 
@@ -4942,7 +5373,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         }
         peer->m_getaddr_recvd = true;
 
-        peer->m_addrs_to_send.clear();
+        WITH_LOCK(peer->m_addr_send_mutex, peer->m_addrs_to_send.clear());
         std::vector<CAddress> vAddr;
         if (pfrom.HasPermission(NetPermissionFlags::Addr)) {
             vAddr = m_connman.GetAddresses(MAX_ADDR_TO_SEND, MAX_PCT_ADDR_TO_SEND, /*network=*/std::nullopt);
@@ -5158,6 +5589,16 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         return;
     }
 
+    if (msg_type == NetMsgType::GETSTATEDATA) {
+        ProcessGetStateData(pfrom, *peer, vRecv);
+        return;
+    }
+
+    if (msg_type == NetMsgType::STATEDATA) {
+        ProcessStateData(pfrom, vRecv);
+        return;
+    }
+
     if (msg_type == NetMsgType::NOTFOUND) {
         std::vector<CInv> vInv;
         vRecv >> vInv;
@@ -5215,19 +5656,26 @@ bool PeerManagerImpl::MaybeDiscourageAndDisconnect(CNode& pnode, Peer& peer)
     LogPrint(BCLog::NET, "Disconnecting and discouraging peer %d!\n", peer.m_id);
     if (m_banman) m_banman->Discourage(pnode.addr);
     m_connman.DisconnectNode(pnode.addr);
-    LOCK(cs_main);
     // Remove all data from the header spam filter when the address is banned
-    CleanAddressHeaders(pnode.addr);
+    m_header_spam_filter.Clean(pnode.addr);
     return true;
 }
 
-bool PeerManagerImpl::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
+void PeerManagerImpl::ReceivedMessage(const CNode& node, const CNetMessage& msg)
 {
-    AssertLockHeld(g_msgproc_mutex);
+    // The scripts are verified while the message waits for ProcessMessages and cs_main
+    if (m_tx_preverifier && msg.m_type == NetMsgType::TX && !RejectIncomingTxs(node)) {
+        m_tx_preverifier->Submit(msg.m_recv);
+    }
+}
 
+bool PeerManagerImpl::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
+{
     PeerRef peer = GetPeerRef(pfrom->GetId());
     if (peer == nullptr) return false;
 
+    LOCK(peer->m_msgproc_mutex);
+
     {
         LOCK(peer->m_getdata_requests_mutex);
         if (!peer->m_getdata_requests.empty()) {
@@ -5277,7 +5725,7 @@ bool PeerManagerImpl::ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt
     msg.SetVersion(pfrom->GetCommonVersion());
 
     try {
-        ProcessMessage(*pfrom, msg.m_type, msg.m_recv, msg.m_time, interruptMsgProc);
+        ProcessMessage(*pfrom, peer, msg.m_type, msg.m_recv, msg.m_time, interruptMsgProc);
         if (interruptMsgProc) return false;
         {
             LOCK(peer->m_getdata_requests_mutex);
@@ -5545,6 +5993,7 @@ void PeerManagerImpl::MaybeSendAddr(CNode& node, Peer& peer, std::chrono::micros
         // bandwidth cost that we can incur by doing this (which happens
         // once a day on average).
         if (peer.m_next_local_addr_send != 0us) {
+            LOCK(peer.m_addr_send_mutex);
             peer.m_addr_known->reset();
         }
         if (std::optional<CService> local_service = GetLocalAddrForPeer(node)) {
@@ -5560,6 +6009,7 @@ void PeerManagerImpl::MaybeSendAddr(CNode& node, Peer& peer, std::chrono::micros
 
     peer.m_next_addr_send = GetExponentialRand(current_time, AVG_ADDRESS_BROADCAST_INTERVAL);
 
+    LOCK(peer.m_addr_send_mutex);
     if (!Assume(peer.m_addrs_to_send.size() <= MAX_ADDR_TO_SEND)) {
         // Should be impossible since we always check size before adding to
         // m_addrs_to_send. Recover by trimming the vector.
@@ -5568,7 +6018,7 @@ void PeerManagerImpl::MaybeSendAddr(CNode& node, Peer& peer, std::chrono::micros
 
     // Remove addr records that the peer already knows about, and add new
     // addrs to the m_addr_known filter on the same pass.
-    auto addr_already_known = [&peer](const CAddress& addr) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex) {
+    auto addr_already_known = [&peer](const CAddress& addr) EXCLUSIVE_LOCKS_REQUIRED(peer.m_addr_send_mutex) {
         bool ret = peer.m_addr_known->contains(addr.GetKey());
         if (!ret) peer.m_addr_known->insert(addr.GetKey());
         return ret;
@@ -5699,6 +6149,7 @@ bool PeerManagerImpl::SetupAddressRelay(const CNode& node, Peer& peer)
     // information of addr traffic to infer the link.
     if (node.IsBlockOnlyConn()) return false;
 
+    LOCK(peer.m_addr_send_mutex);
     if (!peer.m_addr_relay_enabled.exchange(true)) {
         // During version message processing (non-block-relay-only outbound peers)
         // or on first addr-related message we have received (inbound peers), initialize
@@ -5711,10 +6162,9 @@ bool PeerManagerImpl::SetupAddressRelay(const CNode& node, Peer& peer)
 
 bool PeerManagerImpl::SendMessages(CNode* pto)
 {
-    AssertLockHeld(g_msgproc_mutex);
-
     PeerRef peer = GetPeerRef(pto->GetId());
     if (!peer) return false;
+    LOCK(peer->m_msgproc_mutex);
     const Consensus::Params& consensusParams = m_chainparams.GetConsensus();
 
     // We must call MaybeDiscourageAndDisconnect first, to ensure that we'll
@@ -5878,13 +6328,7 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                     LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", __func__,
                             vHeaders.front().GetHash().ToString(), pto->GetId());
 
-                    std::optional<CSerializedNetMsg> cached_cmpctblock_msg;
-                    {
-                        LOCK(m_most_recent_block_mutex);
-                        if (m_most_recent_block_hash == pBestIndex->GetBlockHash()) {
-                            cached_cmpctblock_msg = msgMaker.Make(NetMsgType::CMPCTBLOCK, *m_most_recent_compact_block);
-                        }
-                    }
+                    std::optional<CSerializedNetMsg> cached_cmpctblock_msg{GetMostRecentBlockMsg(pBestIndex->GetBlockHash(), NetMsgType::CMPCTBLOCK, /*with_witness=*/true)};
                     if (cached_cmpctblock_msg.has_value()) {
                         m_connman.PushMessage(pto, std::move(cached_cmpctblock_msg.value()));
                     } else {
@@ -6050,11 +6494,15 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                             continue;
                         }
                         if (tx_relay->m_bloom_filter && !tx_relay->m_bloom_filter->IsRelevantAndUpdate(*txinfo.tx)) continue;
-                        // Send
+                        // Send, or add to the set to reconcile with the peer unless it is flooded to them
                         tx_relay->m_recently_announced_invs.insert(hash);
-                        vInv.push_back(inv);
+                        const bool reconcile{m_txreconciliation && peer->m_wtxid_relay &&
+                                             !m_txreconciliation->ShouldFanoutTo(pto->GetId(), wtxid) &&
+                                             m_txreconciliation->AddToSet(pto->GetId(), wtxid)};
+                        if (!reconcile) vInv.push_back(inv);
                         nRelayedTransactions++;
                         {
+                            LOCK(m_relay_mutex);
                             // Expire old relay messages
                             while (!g_relay_expiration.empty() && g_relay_expiration.front().first < current_time)
                             {
@@ -6091,6 +6539,13 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
         if (!vInv.empty())
             m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
 
+        // Start a reconciliation round with an outbound peer once the interval has passed
+        if (m_txreconciliation) {
+            if (const auto request{m_txreconciliation->MaybeRequestReconciliation(pto->GetId(), current_time)}) {
+                m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::REQRECON, request->first, request->second));
+            }
+        }
+
         // Detect whether we're stalling
         auto stalling_timeout = m_block_stalling_timeout.load();
         if (state.m_stalling_since.count() && state.m_stalling_since < current_time - stalling_timeout) {
@@ -6212,6 +6667,7 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
             m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::GETDATA, vGetData));
     } // release cs_main
     MaybeSendFeefilter(*pto, *peer, current_time);
+    MaybeSendGetStateData(*pto, *peer, current_time);
     return true;
 }
 
@@ -6221,52 +6677,6 @@ void PeerManagerImpl::PushGetBlocks(CNode& node, const CBlockIndex* pindexBegin,
     m_connman.PushMessage(&node, msgMaker.Make(NetMsgType::GETBLOCKS, GetLocator(pindexBegin), hashEnd));
 }
 
-uint256 PeerManagerImpl::GetOrphanRoot(const uint256& hash)
-{
-    AssertLockHeld(cs_main);
-    std::map<uint256, COrphanBlock*>::iterator it = mapOrphanBlocks.find(hash);
-    if (it == mapOrphanBlocks.end())
-        return hash;
-
-    // Work back to the first block in the orphan chain
-    do {
-        std::map<uint256, COrphanBlock*>::iterator it2 = mapOrphanBlocks.find(it->second->hashPrev);
-        if (it2 == mapOrphanBlocks.end())
-            return it->first;
-        it = it2;
-    } while(true);
-}
-
-// Remove a random orphan block (which does not have any dependent orphans).
-void PeerManagerImpl::PruneOrphanBlocks()
-{
-    AssertLockHeld(cs_main);
-    size_t nMaxOrphanBlocksSize = gArgs.GetIntArg("-maxorphanblocksmib", DEFAULT_MAX_ORPHAN_BLOCKS) * ((size_t) 1 << 20);
-    while (nOrphanBlocksSize > nMaxOrphanBlocksSize)
-    {
-        // Pick a random orphan block.
-        uint256 randomhash = GetRandHash();
-        std::multimap<uint256, COrphanBlock*>::iterator it = mapOrphanBlocksByPrev.lower_bound(randomhash);
-        if (it == mapOrphanBlocksByPrev.end())
-            it = mapOrphanBlocksByPrev.begin();
-
-        // As long as this block has other orphans depending on it, move to one of those successors.
-        do {
-            std::multimap<uint256, COrphanBlock*>::iterator it2 = mapOrphanBlocksByPrev.find(it->second->hashBlock);
-            if (it2 == mapOrphanBlocksByPrev.end())
-                break;
-            it = it2;
-        } while(1);
-
-        setStakeSeenOrphan.erase(it->second->stake);
-        uint256 hash = it->second->hashBlock;
-        nOrphanBlocksSize -= it->second->vchBlock.size();
-        delete it->second;
-        mapOrphanBlocksByPrev.erase(it);
-        mapOrphanBlocks.erase(hash);
-    }
-}
-
 bool PeerManagerImpl::ProcessNetBlock(const std::shared_ptr<const CBlock> pblock, bool force_processing, bool min_pow_checked, bool* new_block, CNode& pfrom)
 {
     PeerRef peer = GetPeerRef(pfrom.GetId());
@@ -6285,7 +6695,7 @@ bool PeerManagerImpl::ProcessNetBlock(const std::shared_ptr<const CBlock> pblock
         // Duplicate stake allowed only when there is orphan child block
         // if the block header is already known, allow it (to account for headers being sent before the block itself)
         hash = pblock->GetHash();
-        if (!m_chainman.m_blockman.LoadingBlocks() && pblock->IsProofOfStake() && setStakeSeen.count(pblock->GetProofOfStake()) && !m_chainman.BlockIndex().count(hash) && !mapOrphanBlocksByPrev.count(hash))
+        if (!m_chainman.m_blockman.LoadingBlocks() && pblock->IsProofOfStake() && setStakeSeen.count(pblock->GetProofOfStake()) && !m_chainman.BlockIndex().count(hash) && !m_block_orphanage.HaveChildren(hash))
             return error("ProcessNetBlock() : duplicate proof-of-stake (%s, %d) for block %s", pblock->GetProofOfStake().first.ToString(), pblock->GetProofOfStake().second, hash.ToString());
     }
 
@@ -6301,7 +6711,7 @@ bool PeerManagerImpl::ProcessNetBlock(const std::shared_ptr<const CBlock> pblock
 
     {
         LOCK(cs_main);
-        if (mapOrphanBlocks.count(hash))
+        if (m_block_orphanage.HaveBlock(hash))
             return error("ProcessNetBlock() : already have block (orphan) %s", hash.ToString());
 
         // Check for the checkpoint
@@ -6328,7 +6738,7 @@ bool PeerManagerImpl::ProcessNetBlock(const std::shared_ptr<const CBlock> pblock
         // If we don't already have its previous block, shunt it off to holding area until we get it
         if (!m_chainman.BlockIndex().count(pblock->hashPrevBlock))
         {
-            LogPrintf("ProcessNetBlock: ORPHAN BLOCK %lu, prev=%s\n", (unsigned long)mapOrphanBlocks.size(), pblock->hashPrevBlock.ToString());
+            LogPrintf("ProcessNetBlock: ORPHAN BLOCK %lu, prev=%s\n", (unsigned long)m_block_orphanage.Size(), pblock->hashPrevBlock.ToString());
 
             // Accept orphans as long as there is a node to request its parents from
             // ppcoin: check proof-of-stake
@@ -6336,28 +6746,14 @@ bool PeerManagerImpl::ProcessNetBlock(const std::shared_ptr<const CBlock> pblock
             {
                 // Limited duplicity on stake: prevents block flood attack
                 // Duplicate stake allowed only when there is orphan child block
-                if (setStakeSeenOrphan.count(pblock->GetProofOfStake()) && !mapOrphanBlocksByPrev.count(hash))
+                if (m_block_orphanage.HaveStake(pblock->GetProofOfStake()) && !m_block_orphanage.HaveChildren(hash))
                     return error("ProcessNetBlock() : duplicate proof-of-stake (%s, %d) for orphan block %s", pblock->GetProofOfStake().first.ToString(), pblock->GetProofOfStake().second, hash.ToString());
             }
-            PruneOrphanBlocks();
-            COrphanBlock* pblock2 = new COrphanBlock();
-            {
-                CDataStream ss(SER_DISK, CLIENT_VERSION);
-                ss << *pblock;
-                Span<const uint8_t> cs = MakeUCharSpan(ss);
-                pblock2->vchBlock = std::vector<unsigned char>(cs.begin(), cs.end());
-            }
-            pblock2->hashBlock = hash;
-            pblock2->hashPrev = pblock->hashPrevBlock;
-            pblock2->stake = pblock->GetProofOfStake();
-            nOrphanBlocksSize += pblock2->vchBlock.size();
-            mapOrphanBlocks.insert(std::make_pair(hash, pblock2));
-            mapOrphanBlocksByPrev.insert(std::make_pair(pblock2->hashPrev, pblock2));
-            if (pblock->IsProofOfStake())
-                setStakeSeenOrphan.insert(pblock->GetProofOfStake());
+            if (!m_block_orphanage.AddBlock(*pblock, pfrom.GetId()))
+                LogPrint(BCLog::NET, "not keeping orphan block %s from peer=%d\n", hash.ToString(), pfrom.GetId());
 
             // Ask this guy to fill in what we're missing
-            PushGetBlocks(pfrom, m_chainman.m_best_header, GetOrphanRoot(hash));
+            PushGetBlocks(pfrom, m_chainman.m_best_header, m_block_orphanage.GetRoot(hash));
             return true;
         }
     }
@@ -6369,32 +6765,15 @@ bool PeerManagerImpl::ProcessNetBlock(const std::shared_ptr<const CBlock> pblock
     vWorkQueue.push_back(pblock->GetHash());
     for (unsigned int i = 0; i < vWorkQueue.size(); i++)
     {
-        uint256 hashPrev = vWorkQueue[i];
-        for (std::multimap<uint256, COrphanBlock*>::iterator mi = mapOrphanBlocksByPrev.lower_bound(hashPrev);
-             mi != mapOrphanBlocksByPrev.upper_bound(hashPrev);
-             ++mi)
+        for (CBlock& block : m_block_orphanage.TakeChildren(vWorkQueue[i]))
         {
-            CBlock block;
-            {
-                CDataStream ss(mi->second->vchBlock, SER_DISK, CLIENT_VERSION);
-                ss >> block;
-            }
             block.hashMerkleRoot = BlockMerkleRoot(block);
 
             bool new_blockOrphan = false;
-            std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(block);
+            std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(std::move(block));
             if (m_chainman.ProcessNewBlock(shared_pblock, force_processing, min_pow_checked, &new_blockOrphan))
-                vWorkQueue.push_back(mi->second->hashBlock);
-
-            LOCK(cs_main);
-            mapOrphanBlocks.erase(mi->second->hashBlock);
-            setStakeSeenOrphan.erase(block.GetProofOfStake());
-            nOrphanBlocksSize -= mi->second->vchBlock.size();
-            delete mi->second;
+                vWorkQueue.push_back(shared_pblock->GetHash());
         }
-
-        LOCK(cs_main);
-        mapOrphanBlocksByPrev.erase(hashPrev);
     }
 
     return true;
@@ -6432,20 +6811,30 @@ bool PeerManagerImpl::RemoveNetBlockIndex(CBlockIndex *pindex)
     return true;
 }
 
-bool PeerManagerImpl::NeedToEraseBlockIndex(const CBlockIndex *pindex, const CBlockIndex *pindexCheck)
+std::vector<CBlockIndex*> PeerManagerImpl::FindStaleBlockIndex()
 {
     AssertLockHeld(cs_main);
-    if(!m_chainman.ActiveChain().Contains(pindex))
+    std::vector<CBlockIndex*> stale;
+    int nHeight = m_chainman.ActiveChain().Height();
+    int checkpointSpan = Params().GetConsensus().CheckpointSpan(nHeight);
+    const CBlockIndex *pindexCheck = m_chainman.ActiveChain()[nHeight - checkpointSpan -1];
+    if(!pindexCheck) return stale;
+
+    // The blocks out of the active chain up to the checkpoint height are stale, as well as
+    // their descendants, which come next in height order
+    std::set<const CBlockIndex*> erased;
+    int maxHeight = pindexCheck->nHeight;
+    for (const auto& [height, pindex] : m_chainman.m_stale_block_index)
     {
-        if(pindex->nHeight <= pindexCheck->nHeight) return true;
-        const CBlockIndex *pindexBlock = pindex;
-        while(pindexBlock)
+        if(height > maxHeight + 1) break;
+        if(height <= pindexCheck->nHeight || erased.count(pindex->pprev))
         {
-           pindexBlock = pindexBlock->pprev;
-           if(pindexBlock->nHeight == pindexCheck->nHeight) return pindexBlock != pindexCheck;
+            stale.push_back(pindex);
+            erased.insert(pindex);
+            maxHeight = std::max(maxHeight, height);
         }
     }
-    return false;
+    return stale;
 }
 
 bool PeerManagerImpl::RemoveBlockIndex(CBlockIndex *pindex)
@@ -6465,46 +6854,31 @@ void PeerManagerImpl::CleanBlockIndex()
     {
         if(!m_chainman.ActiveChainstate().IsInitialBlockDownload())
         {
-            // Select block indexes to delete
-            std::vector<uint256> indexNeedErase;
-            {
-                LOCK(cs_main);
-                int nHeight = m_chainman.ActiveChain().Height();
-                int checkpointSpan = Params().GetConsensus().CheckpointSpan(nHeight);
-                const CBlockIndex *pindexCheck = m_chainman.ActiveChain()[nHeight - checkpointSpan -1];
-                if(pindexCheck)
-                {
-                    for (node::BlockMap::iterator it=m_chainman.BlockIndex().begin(); it!=m_chainman.BlockIndex().end(); it++)
-                    {
-                        CBlockIndex *pindex = &((*it).second);
-                        if(NeedToEraseBlockIndex(pindex, pindexCheck))
-                        {
-                            indexNeedErase.push_back(pindex->GetBlockHash());
-                        }
-                    }
-                }
-            }
+            WITH_LOCK(cs_main, m_chainman.SeedStaleBlockIndex());
 
-            // Delete selected block indexes
-            if(indexNeedErase.size() > 0)
+            // Delete the stale block indexes in chunks, releasing cs_main between them
+            while(!m_stop_thread_clean_block_index && !WITH_LOCK(cs_main, return FindStaleBlockIndex().empty()))
             {
                 SyncWithValidationInterfaceQueue();
 
                 LOCK(cs_main);
+                std::vector<CBlockIndex*> indexNeedErase = FindStaleBlockIndex();
+                // Take the highest ones and delete them children first, so no block index is left
+                // with a deleted parent
+                if(indexNeedErase.size() > CLEAN_BLOCK_INDEX_CHUNK_SIZE)
+                    indexNeedErase.erase(indexNeedErase.begin(), indexNeedErase.end() - CLEAN_BLOCK_INDEX_CHUNK_SIZE);
+
                 std::vector<uint256> indexEraseDB;
-                for(uint256 blockHash : indexNeedErase)
+                for(auto it = indexNeedErase.rbegin(); it != indexNeedErase.rend(); it++)
                 {
-                    node::BlockMap::iterator it=m_chainman.BlockIndex().find(blockHash);
-                    if(it!=m_chainman.BlockIndex().end())
+                    CBlockIndex *pindex = *it;
+                    uint256 blockHash = pindex->GetBlockHash();
+                    if(RemoveBlockIndex(pindex))
                     {
-                        CBlockIndex *pindex = &((*it).second);
-                        if(RemoveBlockIndex(pindex))
-                        {
-                            // The map contain instance of CBlockIndex 
-                            // which is deleted when the iterator is deleted
-                            m_chainman.BlockIndex().erase(it);
-                            indexEraseDB.push_back(blockHash);
-                        }
+                        // The map contain instance of CBlockIndex 
+                        // which is deleted when the iterator is deleted
+                        m_chainman.BlockIndex().erase(blockHash);
+                        indexEraseDB.push_back(blockHash);
                     }
                 }
 
@@ -7,6 +7,7 @@
 #define BITCOIN_NET_PROCESSING_H
 
 #include <net.h>
+#include <qtum/qtumstatesync.h>
 #include <validationinterface.h>
 
 class AddrMan;
@@ -20,6 +21,8 @@ static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
 static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
 static const bool DEFAULT_PEERBLOOMFILTERS = false;
 static const bool DEFAULT_PEERBLOCKFILTERS = false;
+/** Default for -peercontractstate, serve the contract state to the peers downloading it */
+static const bool DEFAULT_PEERCONTRACTSTATE = false;
 /** Threshold for marking a node to be discouraged, e.g. disconnected and added to the discouragement filter. */
 static const int DISCOURAGEMENT_THRESHOLD{100};
 /** Maximum number of outstanding CMPCTBLOCK requests for the same block. */
@@ -102,7 +105,7 @@ public:
 
     /** Process a single message from a peer. Public for fuzz testing */
     virtual void ProcessMessage(CNode& pfrom, const std::string& msg_type, CDataStream& vRecv,
-                                const std::chrono::microseconds time_received, const std::atomic<bool>& interruptMsgProc) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex) = 0;
+                                const std::chrono::microseconds time_received, const std::atomic<bool>& interruptMsgProc) = 0;
 
     /** This function is used for testing the stale tip eviction logic, see denialofservice_tests.cpp */
     virtual void UpdateLastBlockAnnounceTime(NodeId node, int64_t time_in_seconds) = 0;
@@ -112,6 +115,17 @@ public:
 
     /** Stop clean block index thread */
     virtual void StopCleanBlockIndex() = 0;
+
+    /**
+     * Start downloading the contract state of the block @p block_hash from the peers serving it.
+     * A download that was interrupted is resumed when it is started again for the same block.
+     *
+     * @returns false with @p error set if the download cannot be started
+     */
+    virtual bool StartContractStateSync(const uint256& block_hash, std::string& error) = 0;
+
+    /** Progress of the last download of a contract state, std::nullopt if none was started */
+    virtual std::optional<qtum::ContractStateSyncStats> GetContractStateSyncStats() const = 0;
 };
 
 /** Default for -headerspamfiltermaxsize, maximum size of the list of indexes in the header spam filter */
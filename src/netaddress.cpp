@@ -1062,18 +1062,7 @@ std::string CSubNet::ToString() const
     switch (network.m_net) {
     case NET_IPV4:
     case NET_IPV6: {
-        assert(network.m_addr.size() <= sizeof(netmask));
-
-        uint8_t cidr = 0;
-
-        for (size_t i = 0; i < network.m_addr.size(); ++i) {
-            if (netmask[i] == 0x00) {
-                break;
-            }
-            cidr += NetmaskBits(netmask[i]);
-        }
-
-        suffix = strprintf("/%u", cidr);
+        suffix = strprintf("/%u", GetPrefixLength());
         break;
     }
     case NET_ONION:
@@ -1088,6 +1077,22 @@ std::string CSubNet::ToString() const
     return network.ToStringAddr() + suffix;
 }
 
+uint8_t CSubNet::GetPrefixLength() const
+{
+    assert(network.m_addr.size() <= sizeof(netmask));
+
+    uint8_t cidr = 0;
+
+    for (size_t i = 0; i < network.m_addr.size(); ++i) {
+        if (netmask[i] == 0x00) {
+            break;
+        }
+        cidr += NetmaskBits(netmask[i]);
+    }
+
+    return cidr;
+}
+
 bool CSubNet::IsValid() const
 {
     return valid;
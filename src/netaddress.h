@@ -510,6 +510,12 @@ public:
     std::string ToString() const;
     bool IsValid() const;
 
+    /** The network start address, the sole address of the subnets of networks other than IPv4 and IPv6 */
+    const CNetAddr& GetBaseAddress() const { return network; }
+
+    /** The number of leading 1-bits of the netmask (CIDR mask) of an IPv4 or IPv6 subnet */
+    uint8_t GetPrefixLength() const;
+
     friend bool operator==(const CSubNet& a, const CSubNet& b);
     friend bool operator!=(const CSubNet& a, const CSubNet& b) { return !(a == b); }
     friend bool operator<(const CSubNet& a, const CSubNet& b);
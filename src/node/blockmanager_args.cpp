@@ -24,6 +24,9 @@ std::optional<bilingual_str> ApplyArgsManOptions(const ArgsManager& args, BlockM
         }
     }
     opts.prune_target = nPruneTarget;
+    if (nPruneTarget && nPruneTarget != BlockManager::PRUNE_TARGET_MANUAL) {
+        opts.qtum_state_dir = args.GetDataDirNet() / "stateQtum";
+    }
 
     return std::nullopt;
 }
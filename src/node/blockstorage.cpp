@@ -7,6 +7,7 @@
 #include <chain.h>
 #include <clientversion.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
 #include <flatfile.h>
 #include <hash.h>
 #include <logging.h>
@@ -21,14 +22,23 @@
 #include <util/fs.h>
 #include <util/syscall_sandbox.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <validation.h>
 #include <chainparams.h>
 
+#include <algorithm>
+#include <chrono>
+#include <list>
 #include <map>
+#include <thread>
 #include <unordered_map>
 
 namespace node {
 std::atomic_bool fReindex(false);
+std::atomic_bool fMmapBlockFiles(DEFAULT_MMAP_BLOCK_FILES);
+std::atomic<unsigned int> g_block_file_chunk_size{BLOCKFILE_CHUNK_SIZE};
+std::atomic<unsigned int> g_undo_file_chunk_size{UNDOFILE_CHUNK_SIZE};
+std::atomic<size_t> g_block_write_buffer_size{DEFAULT_BLOCK_WRITE_BUFFER << 20};
 
 bool CBlockIndexWorkComparator::operator()(const CBlockIndex* pa, const CBlockIndex* pb) const
 {
@@ -58,6 +68,95 @@ static FILE* OpenUndoFile(const FlatFilePos& pos, bool fReadOnly = false);
 static FlatFileSeq BlockFileSeq();
 static FlatFileSeq UndoFileSeq();
 
+/** The writer of the block files, what it buffers is written before a block file is opened or mapped */
+static FlatFileWriter& BlockFileWriter()
+{
+    static FlatFileWriter writer{g_block_write_buffer_size};
+    return writer;
+}
+
+/** The writer of the undo files */
+static FlatFileWriter& UndoFileWriter()
+{
+    static FlatFileWriter writer{g_block_write_buffer_size};
+    return writer;
+}
+
+/** The most recently used mappings of the block or of the undo files */
+class MappedFileCache
+{
+private:
+    Mutex m_mutex;
+    std::list<std::pair<int, std::shared_ptr<const MappedFlatFile>>> m_files GUARDED_BY(m_mutex);
+
+public:
+    /** A mapping of the file of pos that covers [pos, pos + len), nullptr when the file cannot be mapped. */
+    std::shared_ptr<const MappedFlatFile> Get(const FlatFileSeq& seq, const FlatFilePos& pos, size_t len) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        for (auto it = m_files.begin(); it != m_files.end(); ++it) {
+            if (it->first != pos.nFile) continue;
+            if (it->second->Covers(pos.nPos, len)) {
+                m_files.splice(m_files.begin(), m_files, it);
+                return it->second;
+            }
+            // The file grew since it was mapped
+            m_files.erase(it);
+            break;
+        }
+        std::shared_ptr<const MappedFlatFile> mapped = seq.Map(pos);
+        if (!mapped || !mapped->Covers(pos.nPos, len)) {
+            return nullptr;
+        }
+        m_files.emplace_front(pos.nFile, mapped);
+        if (m_files.size() > MAX_MAPPED_BLOCK_FILES) {
+            m_files.pop_back();
+        }
+        return mapped;
+    }
+
+    /** Drop the mapping of a file that is truncated or removed. Readers holding it keep it until they are done. */
+    void Erase(int file) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        m_files.remove_if([file](const auto& entry) { return entry.first == file; });
+    }
+};
+
+static MappedFileCache g_mapped_block_files;
+static MappedFileCache g_mapped_undo_files;
+
+/**
+ * The record at pos of a mapped file, whose size is written right before it, followed by
+ * extra trailing bytes. An empty span when it cannot be mapped, mapped keeps it alive.
+ */
+static Span<const unsigned char> MapRecord(MappedFileCache& cache, const FlatFilePos& pos, size_t extra, bool undo, std::shared_ptr<const MappedFlatFile>& mapped)
+{
+    if (pos.IsNull() || pos.nPos < sizeof(uint32_t)) {
+        return {};
+    }
+    const FlatFilePos size_pos(pos.nFile, pos.nPos - sizeof(uint32_t));
+    const FlatFileSeq seq = undo ? UndoFileSeq() : BlockFileSeq();
+    if (!(undo ? UndoFileWriter() : BlockFileWriter()).Flush(pos.nFile)) {
+        return {};
+    }
+    mapped = cache.Get(seq, size_pos, sizeof(uint32_t));
+    if (!mapped) {
+        return {};
+    }
+    const uint32_t size = ReadLE32(mapped->Read(size_pos.nPos, sizeof(uint32_t)).data());
+    if (size > MAX_SIZE) {
+        return {};
+    }
+    if (!mapped->Covers(pos.nPos, size + extra)) {
+        mapped = cache.Get(seq, pos, size + extra);
+        if (!mapped) {
+            return {};
+        }
+    }
+    return mapped->Read(pos.nPos, size + extra);
+}
+
 std::vector<CBlockIndex*> BlockManager::GetAllBlockIndices()
 {
     AssertLockHeld(cs_main);
@@ -189,7 +288,9 @@ void BlockManager::FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPr
     }
 
     unsigned int nLastBlockWeCanPrune{(unsigned)std::min(prune_height, chain_tip_height - static_cast<int>(MIN_BLOCKS_TO_KEEP))};
-    uint64_t nCurrentUsage = CalculateCurrentUsage();
+    // The Qtum state and receipt databases take their share of the target, they are pruned by -statepruning
+    const uint64_t qtum_state_usage{m_background_pruner ? m_background_pruner->QtumStateUsage() : 0};
+    uint64_t nCurrentUsage = CalculateCurrentUsage() + qtum_state_usage;
     // We don't check to prune until after we've allocated new space for files
     // So we should leave a buffer under our target to account for another allocation
     // before the next pruning.
@@ -231,8 +332,8 @@ void BlockManager::FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPr
         }
     }
 
-    LogPrint(BCLog::PRUNE, "target=%dMiB actual=%dMiB diff=%dMiB max_prune_height=%d removed %d blk/rev pairs\n",
-             GetPruneTarget() / 1024 / 1024, nCurrentUsage / 1024 / 1024,
+    LogPrint(BCLog::PRUNE, "target=%dMiB actual=%dMiB (state=%dMiB) diff=%dMiB max_prune_height=%d removed %d blk/rev pairs\n",
+             GetPruneTarget() / 1024 / 1024, nCurrentUsage / 1024 / 1024, qtum_state_usage / 1024 / 1024,
              (int64_t(GetPruneTarget()) - int64_t(nCurrentUsage)) / 1024 / 1024,
              nLastBlockWeCanPrune, count);
 }
@@ -269,9 +370,29 @@ bool BlockManager::LoadBlockIndex(const Consensus::Params& consensus_params)
     std::sort(vSortedByHeight.begin(), vSortedByHeight.end(),
               CBlockIndexHeightOnlyComparator());
 
-    for (CBlockIndex* pindex : vSortedByHeight) {
+    // The proof of each block does not depend on the other blocks, compute them on several threads
+    // and only sum them up in height order. The skip pointers are built from the skip pointers of
+    // the ancestors, so they stay in the ordered pass.
+    std::vector<arith_uint256> proofs(vSortedByHeight.size());
+    auto compute_proofs = [&](size_t from, size_t to) {
+        for (size_t pos = from; pos < to; ++pos) {
+            proofs[pos] = GetBlockProof(*vSortedByHeight[pos]);
+        }
+    };
+    const size_t num_threads = std::clamp(GetNumCores(), 1, MAX_BLOCK_INDEX_LOAD_THREADS);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; ++i) {
+        threads.emplace_back(compute_proofs, i * proofs.size() / num_threads, (i + 1) * proofs.size() / num_threads);
+    }
+    compute_proofs(0, proofs.size() / num_threads);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t pos = 0; pos < vSortedByHeight.size(); ++pos) {
         if (ShutdownRequested()) return false;
-        pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
+        CBlockIndex* pindex = vSortedByHeight[pos];
+        pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + proofs[pos];
         pindex->nTimeMax = (pindex->pprev ? std::max(pindex->pprev->nTimeMax, pindex->nTime) : pindex->nTime);
 
         // We can link the chain of blocks for which we've received transactions at some point, or
@@ -372,10 +493,6 @@ bool BlockManager::LoadBlockIndexDB(const Consensus::Params& consensus_params)
     m_block_tree_db->ReadReindexing(fReindexing);
     if (fReindexing) fReindex = true;
 
-    ///////////////////////////////////////////////////////////// // qtum
-    m_block_tree_db->ReadFlag("addrindex", fAddressIndex);
-    LogPrintf("LoadBlockIndexDB(): address index %s\n", fAddressIndex ? "enabled" : "disabled");
-    /////////////////////////////////////////////////////////////
     // Check whether we have a transaction index
     m_block_tree_db->ReadFlag("logevents", fLogEvents);
     LogPrintf("%s: log events index %s\n", __func__, fLogEvents ? "enabled" : "disabled");
@@ -514,29 +631,22 @@ CBlockFileInfo* BlockManager::GetBlockFileInfo(size_t n)
 
 static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
 {
-    // Open history file to append
-    AutoFile fileout{OpenUndoFile(pos)};
-    if (fileout.IsNull()) {
-        return error("%s: OpenUndoFile failed", __func__);
-    }
-
-    // Write index header
+    // Serialize index header and undo data, appended to the history file with the undo data written before
     unsigned int nSize = GetSerializeSize(blockundo, CLIENT_VERSION);
-    fileout << messageStart << nSize;
-
-    // Write undo data
-    long fileOutPos = ftell(fileout.Get());
-    if (fileOutPos < 0) {
-        return error("%s: ftell failed", __func__);
-    }
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
+    DataStream data{};
+    data.reserve(BLOCK_SERIALIZATION_HEADER_SIZE + nSize + uint256::size());
+    data << messageStart << nSize << blockundo;
 
     // calculate & write checksum
     HashWriter hasher{};
     hasher << hashBlock;
-    hasher << blockundo;
-    fileout << hasher.GetHash();
+    hasher.write(Span{data}.subspan(BLOCK_SERIALIZATION_HEADER_SIZE));
+    data << hasher.GetHash();
+
+    if (!UndoFileWriter().Write(UndoFileSeq(), pos, MakeUCharSpan(data))) {
+        return error("%s: write failed", __func__);
+    }
+    pos.nPos += BLOCK_SERIALIZATION_HEADER_SIZE;
 
     return true;
 }
@@ -545,10 +655,35 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
 {
     const FlatFilePos pos{WITH_LOCK(::cs_main, return pindex->GetUndoPos())};
 
+    return UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash());
+}
+
+bool UndoReadFromDisk(CBlockUndo& blockundo, const FlatFilePos& pos, const uint256& prev_hash)
+{
     if (pos.IsNull()) {
         return error("%s: no undo data available", __func__);
     }
 
+    // Read from the mapped file, anything unexpected is left to the file read below to report
+    if (fMmapBlockFiles) {
+        std::shared_ptr<const MappedFlatFile> mapped;
+        Span<const unsigned char> record = MapRecord(g_mapped_undo_files, pos, uint256::size(), /*undo=*/true, mapped);
+        if (!record.empty()) {
+            Span<const unsigned char> data = record.first(record.size() - uint256::size());
+            HashWriter hasher{};
+            hasher << prev_hash;
+            hasher.write(MakeByteSpan(data));
+            if (hasher.GetHash() == uint256(record.last(uint256::size()))) {
+                try {
+                    SpanReader{SER_DISK, CLIENT_VERSION, data} >> blockundo;
+                    return true;
+                } catch (const std::exception&) {
+                    blockundo = CBlockUndo();
+                }
+            }
+        }
+    }
+
     // Open history file to read
     AutoFile filein{OpenUndoFile(pos, true)};
     if (filein.IsNull()) {
@@ -559,7 +694,7 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
     uint256 hashChecksum;
     HashVerifier verifier{filein}; // Use HashVerifier as reserializing may lose data, c.f. commit d342424301013ec47dc146a4beb49d5c9319d80a
     try {
-        verifier << pindex->pprev->GetBlockHash();
+        verifier << prev_hash;
         verifier >> blockundo;
         filein >> hashChecksum;
     } catch (const std::exception& e) {
@@ -577,9 +712,11 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
 void BlockManager::FlushUndoFile(int block_file, bool finalize)
 {
     FlatFilePos undo_pos_old(block_file, m_blockfile_info[block_file].nUndoSize);
-    if (!UndoFileSeq().Flush(undo_pos_old, finalize)) {
+    if (!(finalize ? UndoFileWriter().Close(block_file) : UndoFileWriter().Flush(block_file)) || !UndoFileSeq().Flush(undo_pos_old, finalize)) {
         AbortNode("Flushing undo file to disk failed. This is likely the result of an I/O error.");
     }
+    // Finalizing truncates the file, a mapping of it may cover pages that are gone
+    if (finalize) g_mapped_undo_files.Erase(block_file);
 }
 
 void BlockManager::FlushBlockFile(bool fFinalize, bool finalize_undo)
@@ -595,15 +732,93 @@ void BlockManager::FlushBlockFile(bool fFinalize, bool finalize_undo)
     }
     assert(static_cast<int>(m_blockfile_info.size()) > m_last_blockfile);
 
+    // Everything buffered is written, before the block index refers to it
+    if (!UndoFileWriter().Flush()) {
+        AbortNode("Writing undo data to disk failed. This is likely the result of an I/O error.");
+    }
     FlatFilePos block_pos_old(m_last_blockfile, m_blockfile_info[m_last_blockfile].nSize);
-    if (!BlockFileSeq().Flush(block_pos_old, fFinalize)) {
+    if (!(fFinalize ? BlockFileWriter().Close() : BlockFileWriter().Flush()) || !BlockFileSeq().Flush(block_pos_old, fFinalize)) {
         AbortNode("Flushing block file to disk failed. This is likely the result of an I/O error.");
     }
+    if (fFinalize) g_mapped_block_files.Erase(m_last_blockfile);
     // we do not always flush the undo file, as the chain tip may be lagging behind the incoming blocks,
     // e.g. during IBD or a sync after a node going offline
     if (!fFinalize || finalize_undo) FlushUndoFile(m_last_blockfile, finalize_undo);
 }
 
+BackgroundPruner::BackgroundPruner(fs::path qtum_state_dir)
+    : m_qtum_state_dir{std::move(qtum_state_dir)}
+{
+    m_thread = std::thread(&util::TraceThread, "prune", [this] { ThreadPrune(); });
+}
+
+BackgroundPruner::~BackgroundPruner()
+{
+    WITH_LOCK(m_mutex, m_stop = true);
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+void BackgroundPruner::Unlink(const std::set<int>& files)
+{
+    WITH_LOCK(m_mutex, m_files.insert(files.begin(), files.end()));
+    m_cv.notify_all();
+}
+
+void BackgroundPruner::Wait()
+{
+    WAIT_LOCK(m_mutex, lock);
+    m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_files.empty() && !m_unlinking; });
+}
+
+void BackgroundPruner::ThreadPrune()
+{
+    //! How often the size of the Qtum state and receipt databases is measured
+    constexpr auto QTUM_STATE_USAGE_INTERVAL{std::chrono::minutes{1}};
+
+    while (true) {
+        if (!m_qtum_state_dir.empty()) {
+            uint64_t usage{0};
+            std::error_code ec;
+            for (auto it = fs::recursive_directory_iterator(m_qtum_state_dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+                // The databases delete files while they compact, skip those that are gone
+                std::error_code file_ec;
+                const auto size{it->file_size(file_ec)};
+                if (!file_ec && it->is_regular_file(file_ec)) usage += size;
+            }
+            m_qtum_state_usage = usage;
+        }
+
+        std::set<int> files;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cv.wait_for(lock, QTUM_STATE_USAGE_INTERVAL, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_files.empty(); });
+            if (m_stop && m_files.empty()) break;
+            files.swap(m_files);
+            m_unlinking = !files.empty();
+        }
+        if (!files.empty()) {
+            node::UnlinkPrunedFiles(files);
+            WITH_LOCK(m_mutex, m_unlinking = false);
+            m_cv.notify_all();
+        }
+    }
+}
+
+void BlockManager::UnlinkPrunedFiles(const std::set<int>& files)
+{
+    if (m_background_pruner) {
+        m_background_pruner->Unlink(files);
+    } else {
+        node::UnlinkPrunedFiles(files);
+    }
+}
+
+void BlockManager::WaitForPrunedFiles()
+{
+    if (m_background_pruner) m_background_pruner->Wait();
+}
+
 uint64_t BlockManager::CalculateCurrentUsage()
 {
     LOCK(cs_LastBlockFile);
@@ -620,6 +835,10 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
     std::error_code ec;
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         FlatFilePos pos(*it, 0);
+        g_mapped_block_files.Erase(*it);
+        g_mapped_undo_files.Erase(*it);
+        BlockFileWriter().Close(*it);
+        UndoFileWriter().Close(*it);
         const bool removed_blockfile{fs::remove(BlockFileSeq().FileName(pos), ec)};
         const bool removed_undofile{fs::remove(UndoFileSeq().FileName(pos), ec)};
         if (removed_blockfile || removed_undofile) {
@@ -630,22 +849,28 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 
 static FlatFileSeq BlockFileSeq()
 {
-    return FlatFileSeq(gArgs.GetBlocksDirPath(), "blk", gArgs.GetBoolArg("-fastprune", false) ? 0x4000 /* 16kb */ : BLOCKFILE_CHUNK_SIZE);
+    return FlatFileSeq(gArgs.GetBlocksDirPath(), "blk", gArgs.GetBoolArg("-fastprune", false) ? 0x4000 /* 16kb */ : g_block_file_chunk_size.load());
 }
 
 static FlatFileSeq UndoFileSeq()
 {
-    return FlatFileSeq(gArgs.GetBlocksDirPath(), "rev", UNDOFILE_CHUNK_SIZE);
+    return FlatFileSeq(gArgs.GetBlocksDirPath(), "rev", g_undo_file_chunk_size.load());
 }
 
 FILE* OpenBlockFile(const FlatFilePos& pos, bool fReadOnly)
 {
+    if (!BlockFileWriter().Flush(pos.nFile)) {
+        return nullptr;
+    }
     return BlockFileSeq().Open(pos, fReadOnly);
 }
 
 /** Open an undo file (rev?????.dat) */
 static FILE* OpenUndoFile(const FlatFilePos& pos, bool fReadOnly)
 {
+    if (!UndoFileWriter().Flush(pos.nFile)) {
+        return nullptr;
+    }
     return UndoFileSeq().Open(pos, fReadOnly);
 }
 
@@ -733,23 +958,16 @@ bool BlockManager::FindUndoPos(BlockValidationState& state, int nFile, FlatFileP
 
 static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessageHeader::MessageStartChars& messageStart)
 {
-    // Open history file to append
-    CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull()) {
-        return error("WriteBlockToDisk: OpenBlockFile failed");
-    }
-
-    // Write index header
-    unsigned int nSize = GetSerializeSize(block, fileout.GetVersion());
-    fileout << messageStart << nSize;
-
-    // Write block
-    long fileOutPos = ftell(fileout.Get());
-    if (fileOutPos < 0) {
-        return error("WriteBlockToDisk: ftell failed");
+    // Serialize index header and block, appended to the history file with the blocks written before
+    CDataStream data(SER_DISK, CLIENT_VERSION);
+    unsigned int nSize = GetSerializeSize(block, data.GetVersion());
+    data.reserve(BLOCK_SERIALIZATION_HEADER_SIZE + nSize);
+    data << messageStart << nSize << block;
+
+    if (!BlockFileWriter().Write(BlockFileSeq(), pos, MakeUCharSpan(data))) {
+        return error("WriteBlockToDisk: write failed");
     }
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
+    pos.nPos += BLOCK_SERIALIZATION_HEADER_SIZE;
 
     return true;
 }
@@ -789,17 +1007,34 @@ bool ReadBlockFromDisk(Block& block, const FlatFilePos& pos, const Consensus::Pa
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull()) {
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    // Read block, from the mapped file when possible
+    bool read = false;
+    if (fMmapBlockFiles) {
+        std::shared_ptr<const MappedFlatFile> mapped;
+        Span<const unsigned char> data = MapRecord(g_mapped_block_files, pos, 0, /*undo=*/false, mapped);
+        if (!data.empty()) {
+            try {
+                SpanReader{SER_DISK, CLIENT_VERSION, data} >> block;
+                read = true;
+            } catch (const std::exception&) {
+                // The file read below reports the error
+                block.SetNull();
+            }
+        }
     }
 
-    // Read block
-    try {
-        filein >> block;
-    } catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    if (!read) {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull()) {
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+        }
+
+        try {
+            filein >> block;
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
     }
 
     // Check the header
@@ -833,6 +1068,15 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
 
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
 {
+    if (fMmapBlockFiles && pos.nPos >= BLOCK_SERIALIZATION_HEADER_SIZE) {
+        std::shared_ptr<const MappedFlatFile> mapped;
+        Span<const unsigned char> data = MapRecord(g_mapped_block_files, pos, 0, /*undo=*/false, mapped);
+        if (!data.empty() && memcmp(mapped->Read(pos.nPos - BLOCK_SERIALIZATION_HEADER_SIZE, CMessageHeader::MESSAGE_START_SIZE).data(), message_start, CMessageHeader::MESSAGE_START_SIZE) == 0) {
+            block.assign(data.begin(), data.end());
+            return true;
+        }
+    }
+
     FlatFilePos hpos = pos;
     hpos.nPos -= 8; // Seek back 8 bytes for meta header
     AutoFile filein{OpenBlockFile(hpos, true)};
@@ -15,7 +15,11 @@
 #include <util/fs.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <memory>
+#include <set>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -36,6 +40,9 @@ struct Params;
 
 namespace node {
 static constexpr bool DEFAULT_STOPAFTERBLOCKIMPORT{false};
+static constexpr bool DEFAULT_MMAP_BLOCK_FILES{false};
+/** Maximum number of block and of undo files that are kept mapped with -mmapblocks */
+static constexpr size_t MAX_MAPPED_BLOCK_FILES{8};
 
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
 static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
@@ -43,11 +50,20 @@ static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
+/** Default for -blockwritebuffer, in MiB */
+static constexpr unsigned int DEFAULT_BLOCK_WRITE_BUFFER{4};
 
 /** Size of header written by WriteBlockToDisk before a serialized CBlock */
 static constexpr size_t BLOCK_SERIALIZATION_HEADER_SIZE = CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int);
 
 extern std::atomic_bool fReindex;
+/** Whether blocks and undo data are read from memory mappings of their files (-mmapblocks) */
+extern std::atomic_bool fMmapBlockFiles;
+/** The pre-allocation chunk sizes of the block and of the undo files (-blockfilechunksize, -undofilechunksize) */
+extern std::atomic<unsigned int> g_block_file_chunk_size;
+extern std::atomic<unsigned int> g_undo_file_chunk_size;
+/** Number of bytes of blocks and of undo data buffered before they are written (-blockwritebuffer) */
+extern std::atomic<size_t> g_block_write_buffer_size;
 
 // Because validation code takes pointers to the map's CBlockIndex objects, if
 // we ever switch to another associative container, we need to either use a
@@ -75,6 +91,41 @@ struct PruneLockInfo {
  * This data is used mostly in `Chainstate` - information about, e.g.,
  * candidate tips is not maintained here.
  */
+/**
+ * Unlinks the files of pruned blocks on a background thread, so that the thread flushing the
+ * chainstate does not wait on the filesystem to delete them. It also measures the size of the
+ * Qtum state and receipt databases now and then, which the prune target covers too.
+ */
+class BackgroundPruner
+{
+private:
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    //! Files to unlink, and whether the thread is unlinking files it took from it
+    std::set<int> m_files GUARDED_BY(m_mutex);
+    bool m_unlinking GUARDED_BY(m_mutex){false};
+    bool m_stop GUARDED_BY(m_mutex){false};
+
+    const fs::path m_qtum_state_dir;
+    std::atomic<uint64_t> m_qtum_state_usage{0};
+
+    std::thread m_thread;
+
+    void ThreadPrune() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+public:
+    explicit BackgroundPruner(fs::path qtum_state_dir);
+    //! Unlinks the files left before returning
+    ~BackgroundPruner();
+
+    /** Queue the block and undo files @p files for unlinking */
+    void Unlink(const std::set<int>& files) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Wait until the files queued are unlinked */
+    void Wait() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Size in bytes of the Qtum state and receipt databases when they were last measured */
+    uint64_t QtumStateUsage() const { return m_qtum_state_usage; }
+};
+
 class BlockManager
 {
     friend Chainstate;
@@ -140,12 +191,16 @@ private:
 
     const kernel::BlockManagerOpts m_opts;
 
+    //! Unlinks the pruned files in prune mode
+    const std::unique_ptr<BackgroundPruner> m_background_pruner;
+
 public:
     using Options = kernel::BlockManagerOpts;
 
     explicit BlockManager(Options opts)
         : m_prune_mode{opts.prune_target > 0},
-          m_opts{std::move(opts)} {};
+          m_opts{std::move(opts)},
+          m_background_pruner{m_prune_mode ? std::make_unique<BackgroundPruner>(m_opts.qtum_state_dir) : nullptr} {};
 
     std::atomic<bool> m_importing{false};
 
@@ -160,6 +215,7 @@ public:
     std::multimap<CBlockIndex*, CBlockIndex*> m_blocks_unlinked;
 
     std::unique_ptr<CBlockTreeDB> m_block_tree_db GUARDED_BY(::cs_main);
+    std::unique_ptr<CQtumIndexDB> m_qtum_index_db GUARDED_BY(::cs_main); // qtum
 
     bool WriteBlockIndexDB() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
     bool LoadBlockIndexDB(const Consensus::Params& consensus_params) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
@@ -202,6 +258,11 @@ public:
     /** Calculate the amount of disk space the block & undo files currently use */
     uint64_t CalculateCurrentUsage();
 
+    /** Unlink the block and undo files of pruned blocks, on the background pruner in prune mode */
+    void UnlinkPrunedFiles(const std::set<int>& files);
+    /** Wait until the files passed to UnlinkPrunedFiles are unlinked */
+    void WaitForPrunedFiles();
+
     //! Returns last CBlockIndex* that is a checkpoint
     const CBlockIndex* GetLastCheckpoint(const CCheckpointData& data) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -246,6 +307,8 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
+/** Read the undo data at pos, which must follow the block with hash prev_hash. Does not take cs_main. */
+bool UndoReadFromDisk(CBlockUndo& blockundo, const FlatFilePos& pos, const uint256& prev_hash);
 
 void ThreadImport(ChainstateManager& chainman, std::vector<fs::path> vImportFiles, const ArgsManager& args, const fs::path& mempool_path);
 } // namespace node
@@ -17,13 +17,20 @@ CacheSizes CalculateCacheSizes(const ArgsManager& args, size_t n_indexes)
     nTotalCache = std::min(nTotalCache, nMaxDbCache << 20); // total cache cannot be greater than nMaxDbcache
     CacheSizes sizes;
     sizes.block_tree_db = std::min(nTotalCache / 8, nMaxBlockDBCache << 20);
-    if (args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX)) {
-        // enable 3/4 of the cache if addressindex and/or spentindex is enabled
-        sizes.block_tree_db = nTotalCache * 3 / 4;
-    }
     nTotalCache -= sizes.block_tree_db;
+    sizes.qtum_index_db = std::min(nTotalCache / 8, nMaxBlockDBCache << 20);
+    nTotalCache -= sizes.qtum_index_db;
+    // the address index is the largest database when it is enabled, give it 3/4 of the cache
+    sizes.address_index = args.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX) ? nTotalCache * 3 / 4 : 0;
+    nTotalCache -= sizes.address_index;
     sizes.tx_index = std::min(nTotalCache / 8, args.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxTxIndexCache << 20 : 0);
     nTotalCache -= sizes.tx_index;
+    sizes.receipts = std::min(nTotalCache / 8, args.GetBoolArg("-logevents", DEFAULT_LOGEVENTS) ? nMaxReceiptsCache << 20 : 0);
+    nTotalCache -= sizes.receipts;
+    sizes.state_db = std::min(nTotalCache / 4, std::max<int64_t>(0, args.GetIntArg("-statedbcache", nDefaultStateDBCache)) << 20);
+    nTotalCache -= sizes.state_db;
+    sizes.state_writes = std::min(nTotalCache / 4, std::max<int64_t>(0, args.GetIntArg("-statewritecache", nDefaultStateWriteCache)) << 20);
+    nTotalCache -= sizes.state_writes;
     sizes.filter_index = 0;
     if (n_indexes > 0) {
         int64_t max_cache = std::min(nTotalCache / 8, max_filter_index_cache << 20);
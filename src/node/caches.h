@@ -13,10 +13,15 @@ class ArgsManager;
 namespace node {
 struct CacheSizes {
     int64_t block_tree_db;
+    int64_t qtum_index_db;
     int64_t coins_db;
     int64_t coins;
     int64_t tx_index;
     int64_t filter_index;
+    int64_t receipts;
+    int64_t address_index;
+    int64_t state_db;
+    int64_t state_writes;
 };
 CacheSizes CalculateCacheSizes(const ArgsManager& args, size_t n_indexes = 0);
 } // namespace node
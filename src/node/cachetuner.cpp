@@ -0,0 +1,97 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/cachetuner.h>
+
+#include <libdevcore/LevelDB.h>
+#include <libethereum/FlatStateCache.h>
+#include <logging.h>
+#include <script/sigcache.h>
+#include <validation.h>
+
+#include <algorithm>
+
+namespace node {
+std::vector<NodeCache> GetNodeCaches()
+{
+    std::vector<NodeCache> caches{
+        {"signature", &GetSignatureCacheStats, &InitSignatureCache},
+        {"script", &GetScriptExecutionCacheStats, [](size_t bytes) { return WITH_LOCK(::cs_main, return ResizeScriptExecutionCache(bytes)); }},
+        {"state", [] {
+             const auto stats{dev::eth::FlatStateCache::instance().stats()};
+             return CacheStats{stats.hits, stats.misses, stats.evictions, stats.maxBytes};
+         },
+         [](size_t bytes) {
+             dev::eth::FlatStateCache::instance().setMaxBytes(bytes);
+             return true;
+         }},
+        {"statedb", [] {
+             const auto stats{dev::db::LevelDB::cacheStats()};
+             return CacheStats{stats.hits, stats.misses, stats.evictions, stats.maxBytes};
+         },
+         {}},
+    };
+    if (fLogEvents) {
+        caches.push_back({"receipts", [] { return WITH_LOCK(::cs_main, return pstorageresult ? pstorageresult->getCacheStats() : CacheStats{}); },
+                          [](size_t bytes) {
+                              LOCK(::cs_main);
+                              if (!pstorageresult) return false;
+                              pstorageresult->setCacheSize(bytes);
+                              return true;
+                          }});
+    }
+    return caches;
+}
+
+/** The block cache of LevelDB can not be resized, the caches of a fixed size keep their memory */
+static std::vector<NodeCache> ResizableCaches(std::vector<NodeCache> caches)
+{
+    caches.erase(std::remove_if(caches.begin(), caches.end(), [](const NodeCache& cache) { return !cache.resize; }), caches.end());
+    return caches;
+}
+
+std::optional<std::pair<size_t, size_t>> PickCacheTransfer(const std::vector<CacheStats>& interval, size_t step)
+{
+    const auto hits_per_byte = [](const CacheStats& stats) { return stats.max_bytes ? double(stats.hits) / stats.max_bytes : 0; };
+    std::optional<size_t> from, to;
+    for (size_t i = 0; i < interval.size(); ++i) {
+        if (interval[i].evictions > 0 && (!to || hits_per_byte(interval[i]) > hits_per_byte(interval[*to]))) to = i;
+    }
+    if (!to) return std::nullopt;
+    for (size_t i = 0; i < interval.size(); ++i) {
+        if (i == *to || interval[i].max_bytes < 2 * step) continue;
+        if (!from || hits_per_byte(interval[i]) < hits_per_byte(interval[*from])) from = i;
+    }
+    if (!from || hits_per_byte(interval[*to]) < 2 * hits_per_byte(interval[*from])) return std::nullopt;
+    return std::make_pair(*from, *to);
+}
+
+CacheTuner::CacheTuner(std::vector<NodeCache> caches) : m_caches(ResizableCaches(std::move(caches)))
+{
+    for (const NodeCache& cache : m_caches) {
+        m_last.push_back(cache.stats());
+        m_budget += m_last.back().max_bytes;
+    }
+}
+
+void CacheTuner::Adjust()
+{
+    LOCK(m_mutex);
+    std::vector<CacheStats> interval;
+    for (size_t i = 0; i < m_caches.size(); ++i) {
+        const CacheStats stats{m_caches[i].stats()};
+        interval.push_back({stats.hits - m_last[i].hits, stats.misses - m_last[i].misses, stats.evictions - m_last[i].evictions, stats.max_bytes});
+        m_last[i] = stats;
+    }
+
+    const size_t step{m_budget / 16};
+    const auto transfer{PickCacheTransfer(interval, step)};
+    if (!transfer) return;
+    const auto [from, to] = *transfer;
+    LogPrintf("Moving %u KiB of cache memory from the %s cache to the %s cache\n", step >> 10, m_caches[from].name, m_caches[to].name);
+    if (!m_caches[from].resize(interval[from].max_bytes - step) || !m_caches[to].resize(interval[to].max_bytes + step)) {
+        LogPrintf("Failed to resize the %s and %s caches\n", m_caches[from].name, m_caches[to].name);
+    }
+}
+} // namespace node
@@ -0,0 +1,64 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QTUM_NODE_CACHETUNER_H
+#define QTUM_NODE_CACHETUNER_H
+
+#include <sync.h>
+#include <util/cachestats.h>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace node {
+/** Default for -adaptivecaches */
+static constexpr bool DEFAULT_ADAPTIVE_CACHES{false};
+/** How often -adaptivecaches moves memory between the caches */
+static constexpr std::chrono::minutes CACHE_TUNER_INTERVAL{10};
+
+/** A cache of the node, with its lookup counts and a way to change its memory budget */
+struct NodeCache {
+    std::string name;
+    std::function<CacheStats()> stats;
+    //! Empty when the cache keeps the size it started with
+    std::function<bool(size_t)> resize;
+};
+
+/** The signature, script execution, receipts, contract state and state database caches */
+std::vector<NodeCache> GetNodeCaches();
+
+/**
+ * Pick the cache to move @p step bytes from and the one to move them to, given the lookups of
+ * each cache over the last interval and its current budget. The memory goes to the cache with
+ * the most hits per byte that had to evict entries, from the one with the fewest hits per byte
+ * that keeps at least @p step bytes, and only if the receiver does at least twice as well:
+ * resizing some caches drops their entries, so they should not move back and forth.
+ */
+std::optional<std::pair<size_t, size_t>> PickCacheTransfer(const std::vector<CacheStats>& interval, size_t step);
+
+/** Moves memory between caches within the total budget they started with */
+class CacheTuner
+{
+public:
+    explicit CacheTuner(std::vector<NodeCache> caches);
+
+    /** Move one step of memory if the lookups since the last call warrant it */
+    void Adjust() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    size_t Budget() const { return m_budget; }
+
+private:
+    Mutex m_mutex;
+    const std::vector<NodeCache> m_caches;
+    std::vector<CacheStats> m_last GUARDED_BY(m_mutex);
+    size_t m_budget{0};
+};
+} // namespace node
+
+#endif // QTUM_NODE_CACHETUNER_H
@@ -21,10 +21,12 @@
 #include <util/translation.h>
 #include <validation.h>
 #include <chainparams.h>
+#include <libdevcore/LevelDB.h>
 
 #include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <future>
 #include <limits>
 #include <memory>
 #include <vector>
@@ -38,18 +40,49 @@ static ChainstateLoadResult CompleteChainstateInitialization(
     const ChainstateLoadOptions& options) EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
 {
     auto& pblocktree{chainman.m_blockman.m_block_tree_db};
+    auto& pqtumindex{chainman.m_blockman.m_qtum_index_db};
+    QtumContext& qtum{chainman.Qtum()};
     // new CBlockTreeDB tries to delete the existing file, which
     // fails if it's still open from the previous loop. Close it first:
     pblocktree.reset();
-    pstorageresult.reset();
-    globalState.reset();
-    globalSealEngine.reset();
+    pqtumindex.reset();
+    qtum.storageResults.reset();
+    ResetContractCallSnapshot();
+    qtum.state.reset();
+    qtum.sealEngine.reset();
     pblocktree = std::make_unique<CBlockTreeDB>(DBParams{
         .path = chainman.m_options.datadir / "blocks" / "index",
         .cache_bytes = static_cast<size_t>(cache_sizes.block_tree_db),
         .memory_only = options.block_tree_db_in_memory,
         .wipe_data = options.reindex,
         .options = chainman.m_options.block_tree_db});
+    pqtumindex = std::make_unique<CQtumIndexDB>(DBParams{
+        .path = chainman.m_options.datadir / "qtumindex",
+        .cache_bytes = static_cast<size_t>(cache_sizes.qtum_index_db),
+        .memory_only = options.block_tree_db_in_memory,
+        .wipe_data = options.reindex,
+        .options = chainman.m_options.block_tree_db});
+
+    if (!options.reindex && !MigrateQtumIndexes(*pblocktree, *pqtumindex)) {
+        return {ChainstateLoadStatus::FAILURE, _("Error moving the height, stake and delegate indexes out of the block database")};
+    }
+
+    // The Qtum state and receipt databases do not depend on the block index, open them on their own
+    // threads while the block index and the coins database load
+    fs::path qtumStateDir = chainman.m_options.datadir / "stateQtum";
+    bool fStatus = fs::exists(qtumStateDir);
+    const std::string dirQtum = PathToString(qtumStateDir);
+    fs::create_directories(qtumStateDir);
+    dev::db::LevelDB::setCacheSize(cache_sizes.state_db);
+    dev::db::LevelDB::setEnv(GetCompactionController().SharedMonitorEnv("stateQtum"));
+    std::future<std::unique_ptr<QtumState>> open_state = std::async(std::launch::async, [&] {
+        const dev::h256 hashDB(dev::sha3(dev::rlp("")));
+        dev::eth::BaseState existsQtumstate = fStatus ? dev::eth::BaseState::PreExisting : dev::eth::BaseState::Empty;
+        return std::make_unique<QtumState>(dev::u256(0), QtumState::openDB(dirQtum, hashDB, dev::WithExisting::Trust), dirQtum, existsQtumstate);
+    });
+    std::future<std::unique_ptr<StorageResults>> open_results = std::async(std::launch::async, [&] {
+        return std::make_unique<StorageResults>(dirQtum, cache_sizes.receipts);
+    });
 
     if (options.reindex) {
         pblocktree->WriteReindexing(true);
@@ -149,45 +182,35 @@ static ChainstateLoadResult CompleteChainstateInitialization(
     fGettingValuesDGP = options.getting_values_dgp;
 
     dev::eth::NoProof::init();
-    fs::path qtumStateDir = gArgs.GetDataDirNet() / "stateQtum";
-    bool fStatus = fs::exists(qtumStateDir);
-    const std::string dirQtum = PathToString(qtumStateDir);
-    const dev::h256 hashDB(dev::sha3(dev::rlp("")));
-    dev::eth::BaseState existsQtumstate = fStatus ? dev::eth::BaseState::PreExisting : dev::eth::BaseState::Empty;
-    globalState = std::unique_ptr<QtumState>(new QtumState(dev::u256(0), QtumState::openDB(dirQtum, hashDB, dev::WithExisting::Trust), dirQtum, existsQtumstate));
+    qtum.state = open_state.get();
+    qtum.state->setDeferredWritesBudget(cache_sizes.state_writes);
     const CChainParams& chainparams = Params();
     dev::eth::ChainParams cp(chainparams.EVMGenesisInfo());
-    globalSealEngine = std::unique_ptr<dev::eth::SealEngineFace>(cp.createSealEngine());
+    qtum.sealEngine = std::unique_ptr<dev::eth::SealEngineFace>(cp.createSealEngine());
 
-    pstorageresult.reset(new StorageResults(PathToString(qtumStateDir)));
+    qtum.storageResults = open_results.get();
     if (options.reindex) {
-        pstorageresult->wipeResults();
+        qtum.storageResults->wipeResults();
     }
 
     {
         LOCK(cs_main);
         CChain& active_chain = chainman.ActiveChain();
         if(active_chain.Tip() != nullptr){
-        globalState->setRoot(uintToh256(active_chain.Tip()->hashStateRoot));
-        globalState->setRootUTXO(uintToh256(active_chain.Tip()->hashUTXORoot));
+        qtum.state->setRoot(uintToh256(active_chain.Tip()->hashStateRoot));
+        qtum.state->setRootUTXO(uintToh256(active_chain.Tip()->hashUTXORoot));
         } else {
-            globalState->setRoot(dev::sha3(dev::rlp("")));
-            globalState->setRootUTXO(uintToh256(chainparams.GenesisBlock().hashUTXORoot));
-            globalState->populateFrom(cp.genesisState);
+            qtum.state->setRoot(dev::sha3(dev::rlp("")));
+            qtum.state->setRootUTXO(uintToh256(chainparams.GenesisBlock().hashUTXORoot));
+            qtum.state->populateFrom(cp.genesisState);
         }
-        globalState->db().commit();
-        globalState->dbUtxo().commit();
+        qtum.state->db().commit();
+        qtum.state->dbUtxo().commit();
     }
 
     fRecordLogOpcodes = options.record_log_opcodes;
-    fIsVMlogFile = fs::exists(gArgs.GetDataDirNet() / "vmExecLogs.json");
     ///////////////////////////////////////////////////////////
 
-    /////////////////////////////////////////////////////////////// // qtum
-    if (fAddressIndex != options.addrindex) {
-        return {ChainstateLoadStatus::FAILURE, _("You need to rebuild the database using -reindex to change -addrindex")};
-    }
-    ///////////////////////////////////////////////////////////////
     // Check for changed -logevents state
     if (fLogEvents != options.logevents && !fLogEvents) {
         return {ChainstateLoadStatus::FAILURE, _("You need to rebuild the database using -reindex to enable -logevents")};
@@ -195,11 +218,25 @@ static ChainstateLoadResult CompleteChainstateInitialization(
 
     if (!options.logevents)
     {
-        pstorageresult->wipeResults();
-        pblocktree->WipeHeightIndex();
+        qtum.storageResults->wipeResults();
+        pqtumindex->WipeHeightIndex();
+        pqtumindex->WipeContractIndex();
         fLogEvents = false;
         pblocktree->WriteFlag("logevents", fLogEvents);
     }
+    else if (chainman.ActiveChain().Tip() == nullptr)
+    {
+        // The contract index lists every contract only when it is kept from the genesis block,
+        // starting with the contracts of the genesis state
+        std::vector<CContractIndexEntry> genesisContracts;
+        for (const auto& account : qtum.state->addresses()) {
+            genesisContracts.push_back({account.first, 0, uint256(), h256Touint(qtum.state->codeHash(account.first))});
+        }
+        std::sort(genesisContracts.begin(), genesisContracts.end(), [](const CContractIndexEntry& a, const CContractIndexEntry& b) { return a.address < b.address; });
+        if (!pqtumindex->StartContractIndex() || !pqtumindex->WriteContractIndex(genesisContracts)) {
+            return {ChainstateLoadStatus::FAILURE, _("Error initializing the contract index")};
+        }
+    }
 
     if (!options.reindex) {
         auto chainstates{chainman.GetAll()};
@@ -305,8 +342,8 @@ ChainstateLoadResult VerifyLoadedChainstate(ChainstateManager& chainman, const C
     LOCK(cs_main);
 
     CChain& active_chain = chainman.ActiveChain();
-    QtumDGP qtumDGP(globalState.get(), chainman.ActiveChainstate(), fGettingValuesDGP);
-    globalSealEngine->setQtumSchedule(qtumDGP.getGasSchedule(active_chain.Height() + (active_chain.Height()+1 >= chainman.GetConsensus().QIP7Height ? 0 : 1) ));
+    QtumDGP qtumDGP(chainman.Qtum().state.get(), chainman.ActiveChainstate(), fGettingValuesDGP);
+    chainman.Qtum().sealEngine->setQtumSchedule(qtumDGP.getGasSchedule(active_chain.Height() + (active_chain.Height()+1 >= chainman.GetConsensus().QIP7Height ? 0 : 1) ));
 
     for (Chainstate* chainstate : chainman.GetAll()) {
         if (!is_coinsview_empty(chainstate)) {
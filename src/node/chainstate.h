@@ -36,7 +36,6 @@ struct ChainstateLoadOptions {
     std::function<void()> coins_error_cb;
     bool getting_values_dgp{false};
     bool record_log_opcodes{false};
-    bool addrindex{false};
     bool logevents{false};
 };
 
@@ -30,6 +30,8 @@ class WalletLoader;
 } // namespace interfaces
 
 namespace node {
+class CacheTuner;
+
 //! NodeContext struct containing references to chain state and connection
 //! state.
 //!
@@ -61,6 +63,8 @@ struct NodeContext {
     //! opened by the gui.
     interfaces::WalletLoader* wallet_loader{nullptr};
     std::unique_ptr<CScheduler> scheduler;
+    //! Moves memory between the validation caches, only with -adaptivecaches
+    std::unique_ptr<CacheTuner> cache_tuner;
     std::function<void()> rpc_interruption_point = [] {};
 
     //! Declare default constructor and destructor that are not inline, so code
@@ -9,13 +9,18 @@
 #include <chrono>
 #include <cstdint>
 #include <functional>
-#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 
-static bool ReverseCompareNodeMinPingTime(const NodeEvictionCandidate &a, const NodeEvictionCandidate &b)
+// The protection criteria are expressed as sort keys, computed once per candidate when selecting the candidates
+// to protect. A candidate with a greater key is more worthy of protection.
+
+static std::chrono::microseconds::rep KeyNodeMinPingTime(const NodeEvictionCandidate& n)
 {
-    return a.m_min_ping_time > b.m_min_ping_time;
+    return -n.m_min_ping_time.count();
 }
 
 static bool ReverseCompareNodeTimeConnected(const NodeEvictionCandidate &a, const NodeEvictionCandidate &b)
@@ -23,65 +28,69 @@ static bool ReverseCompareNodeTimeConnected(const NodeEvictionCandidate &a, cons
     return a.m_connected > b.m_connected;
 }
 
-static bool CompareNetGroupKeyed(const NodeEvictionCandidate &a, const NodeEvictionCandidate &b) {
-    return a.nKeyedNetGroup < b.nKeyedNetGroup;
+static uint64_t KeyNetGroupKeyed(const NodeEvictionCandidate& n)
+{
+    return n.nKeyedNetGroup;
 }
 
-static bool CompareNodeBlockTime(const NodeEvictionCandidate &a, const NodeEvictionCandidate &b)
+static auto KeyNodeBlockTime(const NodeEvictionCandidate& n)
 {
     // There is a fall-through here because it is common for a node to have many peers which have not yet relayed a block.
-    if (a.m_last_block_time != b.m_last_block_time) return a.m_last_block_time < b.m_last_block_time;
-    if (a.fRelevantServices != b.fRelevantServices) return b.fRelevantServices;
-    return a.m_connected > b.m_connected;
+    return std::make_tuple(n.m_last_block_time, n.fRelevantServices, -n.m_connected.count());
 }
 
-static bool CompareNodeTXTime(const NodeEvictionCandidate &a, const NodeEvictionCandidate &b)
+static auto KeyNodeTXTime(const NodeEvictionCandidate& n)
 {
     // There is a fall-through here because it is common for a node to have more than a few peers that have not yet relayed txn.
-    if (a.m_last_tx_time != b.m_last_tx_time) return a.m_last_tx_time < b.m_last_tx_time;
-    if (a.m_relay_txs != b.m_relay_txs) return b.m_relay_txs;
-    if (a.fBloomFilter != b.fBloomFilter) return a.fBloomFilter;
-    return a.m_connected > b.m_connected;
+    return std::make_tuple(n.m_last_tx_time, n.m_relay_txs, !n.fBloomFilter, -n.m_connected.count());
 }
 
 // Pick out the potential block-relay only peers, and sort them by last block time.
-static bool CompareNodeBlockRelayOnlyTime(const NodeEvictionCandidate &a, const NodeEvictionCandidate &b)
+static auto KeyNodeBlockRelayOnlyTime(const NodeEvictionCandidate& n)
 {
-    if (a.m_relay_txs != b.m_relay_txs) return a.m_relay_txs;
-    if (a.m_last_block_time != b.m_last_block_time) return a.m_last_block_time < b.m_last_block_time;
-    if (a.fRelevantServices != b.fRelevantServices) return b.fRelevantServices;
-    return a.m_connected > b.m_connected;
+    return std::make_tuple(!n.m_relay_txs, n.m_last_block_time, n.fRelevantServices, -n.m_connected.count());
 }
 
 /**
- * Sort eviction candidates by network/localhost and connection uptime.
- * Candidates near the beginning are more likely to be evicted, and those
- * near the end are more likely to be protected, e.g. less likely to be evicted.
+ * Sort key of eviction candidates by network/localhost and connection uptime.
+ * Candidates with lower keys are more likely to be evicted, and those
+ * with higher keys are more likely to be protected, e.g. less likely to be evicted.
  * - First, nodes that are not `is_local` and that do not belong to `network`,
  *   sorted by increasing uptime (from most recently connected to connected longer).
  * - Then, nodes that are `is_local` or belong to `network`, sorted by increasing uptime.
  */
-struct CompareNodeNetworkTime {
-    const bool m_is_local;
-    const Network m_network;
-    CompareNodeNetworkTime(bool is_local, Network network) : m_is_local(is_local), m_network(network) {}
-    bool operator()(const NodeEvictionCandidate& a, const NodeEvictionCandidate& b) const
-    {
-        if (m_is_local && a.m_is_local != b.m_is_local) return b.m_is_local;
-        if ((a.m_network == m_network) != (b.m_network == m_network)) return b.m_network == m_network;
-        return a.m_connected > b.m_connected;
-    };
-};
+static auto KeyNodeNetworkTime(const NodeEvictionCandidate& n, bool is_local, Network network)
+{
+    return std::make_tuple(is_local && n.m_is_local, n.m_network == network, -n.m_connected.count());
+}
 
-//! Sort an array by the specified comparator, then erase the last K elements where predicate is true.
-template <typename T, typename Comparator>
+//! Erase the elements where predicate is true among the K elements with the greatest keys. Only these K elements
+//! are selected, the others are not sorted and keep their order.
+template <typename KeyFunction>
 static void EraseLastKElements(
-    std::vector<T>& elements, Comparator comparator, size_t k,
+    std::vector<NodeEvictionCandidate>& elements, KeyFunction key_function, size_t k,
     std::function<bool(const NodeEvictionCandidate&)> predicate = [](const NodeEvictionCandidate& n) { return true; })
 {
-    std::sort(elements.begin(), elements.end(), comparator);
-    size_t eraseSize = std::min(k, elements.size());
-    elements.erase(std::remove_if(elements.end() - eraseSize, elements.end(), predicate), elements.end());
+    const size_t eraseSize = std::min(k, elements.size());
+    if (eraseSize == 0) return;
+    // Ties are broken by position
+    std::vector<std::pair<decltype(key_function(elements.front())), size_t>> keys;
+    keys.reserve(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i) {
+        keys.emplace_back(key_function(elements[i]), i);
+    }
+    std::nth_element(keys.begin(), keys.end() - eraseSize, keys.end());
+    std::vector<bool> erase(elements.size(), false);
+    for (auto it = keys.end() - eraseSize; it != keys.end(); ++it) {
+        erase[it->second] = predicate(elements[it->second]);
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (erase[i]) continue;
+        if (kept != i) elements[kept] = std::move(elements[i]);
+        ++kept;
+    }
+    elements.erase(elements.begin() + kept, elements.end());
 }
 
 void ProtectNoBanConnections(std::vector<NodeEvictionCandidate>& eviction_candidates)
@@ -148,7 +157,7 @@ void ProtectEvictionCandidatesByRatio(std::vector<NodeEvictionCandidate>& evicti
         for (Net& n : networks) {
             if (n.count == 0) continue;
             const size_t before = eviction_candidates.size();
-            EraseLastKElements(eviction_candidates, CompareNodeNetworkTime(n.is_local, n.id),
+            EraseLastKElements(eviction_candidates, [&n](const NodeEvictionCandidate& c) { return KeyNodeNetworkTime(c, n.is_local, n.id); },
                                protect_per_network, [&n](const NodeEvictionCandidate& c) {
                                    return n.is_local ? c.m_is_local : c.m_network == n.id;
                                });
@@ -171,8 +180,10 @@ void ProtectEvictionCandidatesByRatio(std::vector<NodeEvictionCandidate>& evicti
     // Calculate how many we removed, and update our total number of peers that
     // we want to protect based on uptime accordingly.
     assert(num_protected == initial_size - eviction_candidates.size());
+    // The remaining candidates are left sorted by uptime, SelectNodeToEvict relies on it.
     const size_t remaining_to_protect{total_protect_size - num_protected};
-    EraseLastKElements(eviction_candidates, ReverseCompareNodeTimeConnected, remaining_to_protect);
+    std::sort(eviction_candidates.begin(), eviction_candidates.end(), ReverseCompareNodeTimeConnected);
+    eviction_candidates.erase(eviction_candidates.end() - std::min(remaining_to_protect, eviction_candidates.size()), eviction_candidates.end());
 }
 
 [[nodiscard]] std::optional<NodeId> SelectNodeToEvict(std::vector<NodeEvictionCandidate>&& vEvictionCandidates)
@@ -185,20 +196,20 @@ void ProtectEvictionCandidatesByRatio(std::vector<NodeEvictionCandidate>& evicti
 
     // Deterministically select 4 peers to protect by netgroup.
     // An attacker cannot predict which netgroups will be protected
-    EraseLastKElements(vEvictionCandidates, CompareNetGroupKeyed, 4);
+    EraseLastKElements(vEvictionCandidates, KeyNetGroupKeyed, 4);
     // Protect the 8 nodes with the lowest minimum ping time.
     // An attacker cannot manipulate this metric without physically moving nodes closer to the target.
-    EraseLastKElements(vEvictionCandidates, ReverseCompareNodeMinPingTime, 8);
+    EraseLastKElements(vEvictionCandidates, KeyNodeMinPingTime, 8);
     // Protect 4 nodes that most recently sent us novel transactions accepted into our mempool.
     // An attacker cannot manipulate this metric without performing useful work.
-    EraseLastKElements(vEvictionCandidates, CompareNodeTXTime, 4);
+    EraseLastKElements(vEvictionCandidates, KeyNodeTXTime, 4);
     // Protect up to 8 non-tx-relay peers that have sent us novel blocks.
-    EraseLastKElements(vEvictionCandidates, CompareNodeBlockRelayOnlyTime, 8,
+    EraseLastKElements(vEvictionCandidates, KeyNodeBlockRelayOnlyTime, 8,
                        [](const NodeEvictionCandidate& n) { return !n.m_relay_txs && n.fRelevantServices; });
 
     // Protect 4 nodes that most recently sent us novel blocks.
     // An attacker cannot manipulate this metric without performing useful work.
-    EraseLastKElements(vEvictionCandidates, CompareNodeBlockTime, 4);
+    EraseLastKElements(vEvictionCandidates, KeyNodeBlockTime, 4);
 
     // Protect some of the remaining eviction candidates by ratios of desirable
     // or disadvantaged characteristics.
@@ -216,25 +227,30 @@ void ProtectEvictionCandidatesByRatio(std::vector<NodeEvictionCandidate>& evicti
 
     // Identify the network group with the most connections and youngest member.
     // (vEvictionCandidates is already sorted by reverse connect time)
+    struct NetGroup {
+        unsigned int count{0};
+        std::chrono::seconds first_connected{0};
+        NodeId first_id{0};
+    };
     uint64_t naMostConnections;
     unsigned int nMostConnections = 0;
     std::chrono::seconds nMostConnectionsTime{0};
-    std::map<uint64_t, std::vector<NodeEvictionCandidate> > mapNetGroupNodes;
+    std::unordered_map<uint64_t, NetGroup> mapNetGroupNodes;
     for (const NodeEvictionCandidate &node : vEvictionCandidates) {
-        std::vector<NodeEvictionCandidate> &group = mapNetGroupNodes[node.nKeyedNetGroup];
-        group.push_back(node);
-        const auto grouptime{group[0].m_connected};
+        NetGroup& group = mapNetGroupNodes[node.nKeyedNetGroup];
+        if (group.count++ == 0) {
+            group.first_connected = node.m_connected;
+            group.first_id = node.id;
+        }
+        const auto grouptime{group.first_connected};
 
-        if (group.size() > nMostConnections || (group.size() == nMostConnections && grouptime > nMostConnectionsTime)) {
-            nMostConnections = group.size();
+        if (group.count > nMostConnections || (group.count == nMostConnections && grouptime > nMostConnectionsTime)) {
+            nMostConnections = group.count;
             nMostConnectionsTime = grouptime;
             naMostConnections = node.nKeyedNetGroup;
         }
     }
 
-    // Reduce to the network group with the most connections
-    vEvictionCandidates = std::move(mapNetGroupNodes[naMostConnections]);
-
-    // Disconnect from the network group with the most connections
-    return vEvictionCandidates.front().id;
+    // Disconnect the youngest member of the network group with the most connections
+    return mapNetGroupNodes[naMostConnections].first_id;
 }
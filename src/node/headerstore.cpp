@@ -0,0 +1,62 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/headerstore.h>
+
+#include <chain.h>
+#include <streams.h>
+#include <version.h>
+
+#include <algorithm>
+
+std::unique_ptr<node::HeaderStore> g_header_store;
+
+namespace node {
+
+void HeaderStore::Sync(const CChain& chain)
+{
+    AssertLockHeld(cs_main);
+    LOCK(m_mutex);
+
+    // Headers past the fork point with the active chain are not in it anymore
+    int height = std::min<int>(m_blocks.size(), chain.Height() + 1);
+    while (height > 0 && chain[height - 1] != m_blocks[height - 1]) {
+        --height;
+    }
+    m_blocks.resize(height);
+    m_offsets.resize(height + 1);
+    m_data.resize(m_offsets.back());
+
+    CVectorWriter writer{SER_NETWORK, PROTOCOL_VERSION, m_data, m_data.size()};
+    const int end = std::min(chain.Height() + 1, height + MAX_HEADERSTORE_SYNC);
+    for (; height < end; ++height) {
+        const CBlockIndex* pindex = chain[height];
+        writer << pindex->GetBlockHeader() << uint8_t{0};
+        m_blocks.push_back(pindex);
+        m_offsets.push_back(m_data.size());
+    }
+}
+
+int HeaderStore::Height() const
+{
+    LOCK(m_mutex);
+    return static_cast<int>(m_blocks.size()) - 1;
+}
+
+bool HeaderStore::Read(int begin, int end, std::vector<unsigned char>& out, bool tx_counts) const
+{
+    LOCK(m_mutex);
+    if (begin < 0 || end < begin || end > static_cast<int>(m_blocks.size())) return false;
+    if (tx_counts) {
+        out.insert(out.end(), m_data.begin() + m_offsets[begin], m_data.begin() + m_offsets[end]);
+        return true;
+    }
+    out.reserve(out.size() + m_offsets[end] - m_offsets[begin] - (end - begin));
+    for (int height = begin; height < end; ++height) {
+        out.insert(out.end(), m_data.begin() + m_offsets[height], m_data.begin() + m_offsets[height + 1] - 1);
+    }
+    return true;
+}
+
+} // namespace node
@@ -0,0 +1,67 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_HEADERSTORE_H
+#define BITCOIN_NODE_HEADERSTORE_H
+
+#include <sync.h>
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class CBlockIndex;
+class CChain;
+
+extern RecursiveMutex cs_main;
+
+namespace node {
+
+static constexpr bool DEFAULT_HEADERSTORE{false};
+//! Maximum number of headers a Sync appends, so that catching up does not hold cs_main for long
+static constexpr int MAX_HEADERSTORE_SYNC{50000};
+//! How often the store is synced with the active chain, besides when headers are read
+static constexpr auto HEADERSTORE_SYNC_INTERVAL{std::chrono::seconds{1}};
+
+/**
+ * The headers of the active chain, serialized one after the other as in a headers message, so
+ * that ranges of them are served to peers and REST clients by copying bytes instead of building
+ * each header, with its proof of stake fields and signature, from its CBlockIndex.
+ *
+ * The store is append-only: Sync truncates it to the fork point with the active chain after a
+ * reorg and appends the headers connected since.
+ */
+class HeaderStore
+{
+private:
+    mutable Mutex m_mutex;
+    //! Serialized headers, each followed by the zero transaction count of a headers message
+    std::vector<unsigned char> m_data GUARDED_BY(m_mutex);
+    //! Offset in m_data of the header at each height, and of the end of the last header
+    std::vector<size_t> m_offsets GUARDED_BY(m_mutex){0};
+    //! Block index of the header at each height, to find the fork point with the active chain
+    std::vector<const CBlockIndex*> m_blocks GUARDED_BY(m_mutex);
+
+public:
+    /** Truncate the store to the fork point with @p chain, and append up to MAX_HEADERSTORE_SYNC headers of it */
+    void Sync(const CChain& chain) EXCLUSIVE_LOCKS_REQUIRED(cs_main, !m_mutex);
+
+    /** Returns the height of the last header in the store, -1 if it is empty */
+    int Height() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /**
+     * Append the serialized headers from height @p begin to @p end excluded to @p out, each
+     * followed by a zero transaction count if @p tx_counts.
+     * @returns false if the store does not have all of them
+     */
+    bool Read(int begin, int end, std::vector<unsigned char>& out, bool tx_counts) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+
+} // namespace node
+
+/// The global header store. May be null.
+extern std::unique_ptr<node::HeaderStore> g_header_store;
+
+#endif // BITCOIN_NODE_HEADERSTORE_H
@@ -10,6 +10,7 @@
 #include <deploymentstatus.h>
 #include <external_signer.h>
 #include <index/blockfilterindex.h>
+#include <index/qrc20index.h>
 #include <init.h>
 #include <interfaces/chain.h>
 #include <interfaces/handler.h>
@@ -32,8 +33,10 @@
 #include <policy/policy.h>
 #include <policy/rbf.h>
 #include <policy/settings.h>
+#include <pos.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
+#include <rpc/contract_util.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <shutdown.h>
@@ -44,6 +47,8 @@
 #include <uint256.h>
 #include <univalue.h>
 #include <util/check.h>
+#include <util/convert.h>
+#include <util/strencodings.h>
 #include <util/system.h>
 #include <util/translation.h>
 #include <validation.h>
@@ -74,8 +79,15 @@ using interfaces::BlockTip;
 using interfaces::Chain;
 using interfaces::FoundBlock;
 using interfaces::Handler;
+using interfaces::ContractViewCall;
+using interfaces::ContractViewResult;
+using interfaces::LogQuery;
+using interfaces::LogQueryCursor;
+using interfaces::LogQueryEntry;
+using interfaces::LogQueryReceipt;
 using interfaces::MakeSignalHandler;
 using interfaces::Node;
+using interfaces::TokenTransfer;
 using interfaces::WalletLoader;
 
 namespace node {
@@ -416,6 +428,95 @@ public:
     {
         return GetPoSKernelPS(chainman());
     }
+    bool searchLogs(const LogQuery& query, size_t limit, std::optional<LogQueryCursor>& cursor, std::vector<LogQueryReceipt>& receipts) override
+    {
+        if (!fLogEvents || limit == 0) return false;
+
+        std::set<dev::h160> addresses;
+        for (const std::string& address : query.addresses) {
+            if (address.size() != 40 || !IsHex(address)) return false;
+            addresses.insert(dev::h160(address));
+        }
+        std::vector<boost::optional<dev::h256>> topics;
+        for (const std::string& topic : query.topics) {
+            if (topic.empty()) {
+                topics.emplace_back();
+                continue;
+            }
+            if (topic.size() != 64 || !IsHex(topic)) return false;
+            topics.emplace_back(dev::h256(topic));
+        }
+
+        const int to_block = query.to_block < 0 ? WITH_LOCK(::cs_main, return chainman().ActiveChain().Height()) : query.to_block;
+        SearchLogsCursor from{(uint32_t)std::max(query.from_block, 0), 0, 0};
+        if (cursor) {
+            from = {(uint32_t)cursor->block_number, cursor->tx_index, cursor->output_index};
+        }
+
+        std::vector<TransactionReceiptInfo> found;
+        std::optional<SearchLogsCursor> next;
+        if (!SearchLogsPage(to_block, query.minconf, addresses, topics, from, limit, chainman(), found, next)) {
+            return false;
+        }
+
+        for (const TransactionReceiptInfo& info : found) {
+            LogQueryReceipt receipt;
+            receipt.block_hash = info.blockHash;
+            receipt.block_number = info.blockNumber;
+            receipt.tx_hash = info.transactionHash;
+            receipt.tx_index = info.transactionIndex;
+            receipt.output_index = info.outputIndex;
+            receipt.contract_address = info.contractAddress.hex();
+            for (const dev::eth::LogEntry& log : info.logs) {
+                LogQueryEntry entry;
+                entry.address = log.address.hex();
+                for (const dev::h256& topic : log.topics) {
+                    entry.topics.push_back(topic.hex());
+                }
+                entry.data = HexStr(log.data);
+                receipt.logs.push_back(std::move(entry));
+            }
+            receipts.push_back(std::move(receipt));
+        }
+        cursor.reset();
+        if (next) {
+            cursor = LogQueryCursor{(int)next->height, next->transactionIndex, next->outputIndex};
+        }
+        return true;
+    }
+    int callContracts(const std::vector<ContractViewCall>& calls, std::vector<ContractViewResult>& results) override
+    {
+        std::shared_ptr<const ContractCallSnapshot> snapshot = GetContractCallSnapshot(chainman().ActiveChainstate());
+        std::unique_ptr<QtumState> state = snapshot->view.makeState();
+
+        // Only the calls to existing contracts are run, the others stay not executed
+        results.assign(calls.size(), {});
+        std::vector<ContractCall> run;
+        std::vector<size_t> positions;
+        for (size_t i = 0; i < calls.size(); ++i) {
+            const ContractViewCall& call = calls[i];
+            if (call.address.size() != 40 || !IsHex(call.address) || (!call.data.empty() && !IsHex(call.data))) continue;
+            if (!call.sender.empty() && (call.sender.size() != 40 || !IsHex(call.sender))) continue;
+            ContractCall contract_call;
+            contract_call.addrContract = dev::Address(call.address);
+            if (!state->addressInUse(contract_call.addrContract)) continue;
+            contract_call.opcode = ParseHex(call.data);
+            if (!call.sender.empty()) contract_call.sender = dev::Address(call.sender);
+            run.push_back(std::move(contract_call));
+            positions.push_back(i);
+        }
+
+        std::vector<std::vector<ResultExecute>> exec_results = CallContracts(run, *snapshot);
+        for (size_t i = 0; i < positions.size(); ++i) {
+            if (exec_results[i].empty()) continue;
+            const dev::eth::ExecutionResult& exec_res = exec_results[i][0].execRes;
+            ContractViewResult& result = results[positions[i]];
+            result.executed = true;
+            result.excepted = exec_res.excepted != dev::eth::TransactionException::None;
+            result.output = HexStr(exec_res.output);
+        }
+        return snapshot->pindex->nHeight;
+    }
     std::unique_ptr<Handler> handleInitMessage(InitMessageFn fn) override
     {
         return MakeSignalHandler(::uiInterface.InitMessage_connect(fn));
@@ -905,6 +1006,17 @@ public:
     {
         return GetTxGasFee(tx, mempool(), chainman().ActiveChainstate());
     }
+    std::vector<TokenTransfer> getTokenTransfers(const CBlock& block, const uint256& block_hash, int height) override
+    {
+        std::vector<TokenTransfer> transfers;
+        if (!fLogEvents) return transfers;
+        LOCK(::cs_main);
+        for (const Qrc20BlockEvent& event : ReadQrc20BlockEvents(block, block_hash, height)) {
+            const Qrc20Transfer& transfer = event.transfer;
+            transfers.push_back({h160Touint(event.token), h160Touint(transfer.from), h160Touint(transfer.to), transfer.amount, transfer.txid, transfer.burn});
+        }
+        return transfers;
+    }
 #ifdef ENABLE_WALLET
     void startStake(wallet::CWallet& wallet) override
     {
@@ -941,7 +1053,7 @@ public:
     }
     bool verifyDelegation(const uint160& address, const Delegation& delegation) override
     {
-        return QtumDelegation::VerifyDelegation(address, delegation);
+        return VerifyStakeDelegation(address, delegation);
     }
 
     NodeContext& m_node;
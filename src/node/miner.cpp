@@ -14,16 +14,23 @@
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
 #include <deploymentstatus.h>
+#include <index/addressindex.h>
+#include <node/txclusters.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
 #include <pow.h>
 #include <pos.h>
 #include <primitives/transaction.h>
 #include <timedata.h>
+#include <util/allocstats.h>
 #include <util/moneystr.h>
 #include <util/system.h>
 #include <validation.h>
+#include <validationinterface.h>
+#include <checkqueue.h>
+#include <util/thread.h>
 #include <util/threadnames.h>
+#include <util/trace.h>
 #include <key_io.h>
 #include <qtum/qtumledger.h>
 #include <qtum/qtumdelegation.h>
@@ -34,6 +41,10 @@
 #endif
 
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <set>
+#include <thread>
 #include <utility>
 
 namespace node {
@@ -119,6 +130,7 @@ void ApplyArgsManOptions(const ArgsManager& args, BlockAssembler::Options& optio
     if (const auto blockmintxfee{args.GetArg("-blockmintxfee")}) {
         if (const auto parsed{ParseMoney(*blockmintxfee)}) options.blockMinFeeRate = CFeeRate{*parsed};
     }
+    options.cluster_selection = args.GetBoolArg("-blockclusters", options.cluster_selection);
 }
 static BlockAssembler::Options ConfiguredOptions()
 {
@@ -141,6 +153,8 @@ BlockAssembler::BlockAssembler(Chainstate& chainstate, const CTxMemPool* mempool
 void BlockAssembler::resetBlock()
 {
     inBlock.clear();
+    m_selected.clear();
+    m_out_of_time = false;
 
     // Reserve space for coinbase tx
     nBlockWeight = 4000;
@@ -261,8 +275,8 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     }
 
     //////////////////////////////////////////////////////// qtum
-    QtumDGP qtumDGP(globalState.get(), m_chainstate, fGettingValuesDGP);
-    globalSealEngine->setQtumSchedule(qtumDGP.getGasSchedule(nHeight));
+    QtumDGP qtumDGP(m_chainstate.m_chainman.Qtum().state.get(), m_chainstate, fGettingValuesDGP);
+    m_chainstate.m_chainman.Qtum().sealEngine->setQtumSchedule(qtumDGP.getGasSchedule(nHeight));
     uint32_t blockSizeDGP = qtumDGP.getBlockSize(nHeight);
     minGasPrice = qtumDGP.getMinGasPrice(nHeight);
     if(gArgs.IsArgSet("-staker-min-tx-gas-price")) {
@@ -276,23 +290,35 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
     m_options.nBlockMaxWeight = blockSizeDGP ? blockSizeDGP * WITNESS_SCALE_FACTOR : m_options.nBlockMaxWeight;
     
-    dev::h256 oldHashStateRoot(globalState->rootHash());
-    dev::h256 oldHashUTXORoot(globalState->rootHashUTXO());
+    templateState = std::make_unique<QtumState>(*m_chainstate.m_chainman.Qtum().state);
+    ContractExecResultCache::instance().BeginTemplate(pindexPrev->GetBlockHash());
     ////////////////////////////////////////////////// deploy offline staking contract
     if(nHeight == chainparams.GetConsensus().nOfflineStakeHeight){
-        globalState->deployDelegationsContract();
+        templateState->deployDelegationsContract();
     }
     /////////////////////////////////////////////////
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
     if (m_mempool) {
         LOCK(m_mempool->cs);
-        addPackageTxs(*m_mempool, nPackagesSelected, nDescendantsUpdated, minGasPrice, pblock);
+        if (!m_selection || !addSelectedTxs(*m_mempool, *m_selection, pindexPrev->GetBlockHash(), minGasPrice, pblock)) {
+            if (m_options.cluster_selection) {
+                addClusterTxs(*m_mempool, nPackagesSelected, minGasPrice, pblock);
+            } else {
+                addPackageTxs(*m_mempool, nPackagesSelected, nDescendantsUpdated, minGasPrice, pblock);
+            }
+        }
+        if (m_selection) {
+            m_selection->tip = pindexPrev->GetBlockHash();
+            m_selection->mempool_updates = m_mempool->GetTransactionsUpdated();
+            m_selection->txids = m_selected;
+            m_selection->complete = !m_out_of_time;
+        }
     }
-    pblock->hashStateRoot = uint256(h256Touint(dev::h256(globalState->rootHash())));
-    pblock->hashUTXORoot = uint256(h256Touint(dev::h256(globalState->rootHashUTXO())));
-    globalState->setRoot(oldHashStateRoot);
-    globalState->setRootUTXO(oldHashUTXORoot);
+    pblock->hashStateRoot = uint256(h256Touint(dev::h256(templateState->rootHash())));
+    pblock->hashUTXORoot = uint256(h256Touint(dev::h256(templateState->rootHashUTXO())));
+    templateState.reset();
+    ContractExecResultCache::instance().EndTemplate();
 
     //this should already be populated by AddBlock in case of contracts, but if no contracts
     //then it won't get populated
@@ -407,8 +433,8 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateEmptyBlock(const CScript&
 
     //////////////////////////////////////////////////////// qtum
     //state shouldn't change here for an empty block, but if it's not valid it'll fail in CheckBlock later
-    pblock->hashStateRoot = uint256(h256Touint(dev::h256(globalState->rootHash())));
-    pblock->hashUTXORoot = uint256(h256Touint(dev::h256(globalState->rootHashUTXO())));
+    pblock->hashStateRoot = uint256(h256Touint(dev::h256(m_chainstate.m_chainman.Qtum().state->rootHash())));
+    pblock->hashUTXORoot = uint256(h256Touint(dev::h256(m_chainstate.m_chainman.Qtum().state->rootHashUTXO())));
 
     RebuildRefundTransaction(pblock);
     ////////////////////////////////////////////////////////
@@ -460,6 +486,23 @@ bool BlockAssembler::TestPackage(uint64_t packageSize, int64_t packageSigOpsCost
     return true;
 }
 
+bool BlockAssembler::TestPackageGas(CTxMemPool::txiter iter, uint64_t packageGasLimit, uint64_t minTxGasLimit) const
+{
+    if (packageGasLimit == 0) {
+        // No contract tx in the package
+        return true;
+    }
+    // The gas used by the block only grows and every contract output has at least the mempool minimum
+    // gas limit, so once it does not fit under the soft limit no contract tx can be added anymore
+    if (bceResult.usedGas + minTxGasLimit > softBlockGasLimit) {
+        return false;
+    }
+    if (iter->GetGasLimit() > 0 && (iter->GetGasLimit() > txGasLimit || (uint64_t)iter->GetMinGasPrice() < minGasPrice)) {
+        return false;
+    }
+    return true;
+}
+
 // Perform transaction-level checks before adding to block:
 // - transaction finality (locktime)
 bool BlockAssembler::TestPackageTransactions(const CTxMemPool::setEntries& package) const
@@ -474,6 +517,7 @@ bool BlockAssembler::TestPackageTransactions(const CTxMemPool::setEntries& packa
 
 bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64_t minGasPrice, CBlock* pblock) {
     if (nTimeLimit != 0 && GetAdjustedTimeSeconds() >= nTimeLimit - nBytecodeTimeBuffer) {
+        m_out_of_time = true;
         return false;
     }
     if (gArgs.GetBoolArg("-disablecontractstaking", false))
@@ -482,25 +526,29 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
         return false;
     }
     
-    dev::h256 oldHashStateRoot(globalState->rootHash());
-    dev::h256 oldHashUTXORoot(globalState->rootHashUTXO());
+    const QtumState::Checkpoint checkpoint = templateState->checkpoint();
     // operate on local vars first, then later apply to `this`
     uint64_t nBlockWeight = this->nBlockWeight;
     uint64_t nBlockSigOpsCost = this->nBlockSigOpsCost;
 
     unsigned int contractflags = GetContractScriptFlags(nHeight, chainparams.GetConsensus());
-    QtumTxConverter convert(iter->GetTx(), m_chainstate, m_mempool, NULL, &pblock->vtx, contractflags);
 
+    // The extraction made when the tx entered the mempool is reused while the contract flags are the same
     ExtractQtumTX resultConverter;
-    if(!convert.extractionQtumTransactions(resultConverter)){
-        //this check already happens when accepting txs into mempool
-        //therefore, this can only be triggered by using raw transactions on the staker itself
-        LogPrintf("AttemptToAddContractToBlock(): Fail to extract contacts from tx %s\n", iter->GetTx().GetHash().ToString());
-        return false;
+    const std::shared_ptr<const MempoolContractTxs>& mempoolContractTxs = iter->GetContractTxs();
+    if(mempoolContractTxs && mempoolContractTxs->flags == contractflags){
+        resultConverter.first = mempoolContractTxs->extracted.first;
+    }else{
+        QtumTxConverter convert(iter->GetTx(), m_chainstate, m_mempool, NULL, &pblock->vtx, contractflags);
+        if(!convert.extractionQtumTransactions(resultConverter)){
+            //this check already happens when accepting txs into mempool
+            //therefore, this can only be triggered by using raw transactions on the staker itself
+            LogPrintf("AttemptToAddContractToBlock(): Fail to extract contacts from tx %s\n", iter->GetTx().GetHash().ToString());
+            return false;
+        }
     }
-    std::vector<QtumTransaction> qtumTransactions = resultConverter.first;
     dev::u256 txGas = 0;
-    for(QtumTransaction qtumTransaction : qtumTransactions){
+    for(const QtumTransaction& qtumTransaction : resultConverter.first){
         txGas += qtumTransaction.gas();
         if(txGas > txGasLimit) {
             // Limit the tx gas limit by the soft limit if such a limit has been specified.
@@ -521,28 +569,36 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
             return false;
         }
     }
+    // Skip the contracts predicted to run past the time limit, cheaper ones may still fit
+    if (nTimeLimit != 0) {
+        const std::chrono::microseconds predicted = ContractExecTimeModel::instance().Predict(resultConverter.first);
+        if (GetAdjustedTime() + predicted >= NodeClock::time_point{std::chrono::seconds{nTimeLimit}}) {
+            m_out_of_time = true;
+            LogPrint(BCLog::BENCH, "AttemptToAddContractToBlock(): The contract tx %s is predicted to execute in %.2fms, past the time limit\n", iter->GetTx().GetHash().ToString(), Ticks<MillisecondsDouble>(predicted));
+            return false;
+        }
+    }
     // We need to pass the DGP's block gas limit (not the soft limit) since it is consensus critical.
-    ByteCodeExec exec(*pblock, qtumTransactions, hardBlockGasLimit, m_chainstate.m_chain.Tip(), m_chainstate.m_chain);
+    ByteCodeExec exec(*pblock, std::move(resultConverter.first), hardBlockGasLimit, m_chainstate.m_chain.Tip(), m_chainstate.m_chain, m_chainstate.m_chainman.Qtum());
+    exec.setTemplateState(templateState.get());
+    exec.setResultCache(&ContractExecResultCache::instance());
     if(!exec.performByteCode()){
         //error, don't add contract
-        globalState->setRoot(oldHashStateRoot);
-        globalState->setRootUTXO(oldHashUTXORoot);
+        templateState->revertToCheckpoint(checkpoint);
         LogPrintf("AttemptToAddContractToBlock(): Perform byte code fails for the contract tx %s\n", iter->GetTx().GetHash().ToString());
         return false;
     }
 
     ByteCodeExecResult testExecResult;
     if(!exec.processingResults(testExecResult)){
-        globalState->setRoot(oldHashStateRoot);
-        globalState->setRootUTXO(oldHashUTXORoot);
+        templateState->revertToCheckpoint(checkpoint);
         LogPrintf("AttemptToAddContractToBlock(): Processing results fails for the contract tx %s\n", iter->GetTx().GetHash().ToString());
         return false;
     }
 
     if(bceResult.usedGas + testExecResult.usedGas > softBlockGasLimit){
         // If this transaction could cause block gas limit to be exceeded, then don't add it
-        globalState->setRoot(oldHashStateRoot);
-        globalState->setRootUTXO(oldHashUTXORoot);
+        templateState->revertToCheckpoint(checkpoint);
         // Log if the contract is the only contract tx
         if(bceResult.usedGas == 0)
             LogPrintf("AttemptToAddContractToBlock(): The gas used is bigger than -staker-soft-block-gas-limit for the contract tx %s\n", iter->GetTx().GetHash().ToString());
@@ -553,7 +609,7 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
     nBlockWeight += iter->GetTxWeight();
     nBlockSigOpsCost += iter->GetSigOpCost();
     //apply value-transfer txs to local state
-    for (CTransaction &t : testExecResult.valueTransfers) {
+    for (const CTransaction &t : testExecResult.valueTransfers) {
         nBlockWeight += GetTransactionWeight(t);
         nBlockSigOpsCost += GetLegacySigOpCount(t);
     }
@@ -581,8 +637,7 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
     if (nBlockSigOpsCost * WITNESS_SCALE_FACTOR > (uint64_t)dgpMaxBlockSigOps ||
             nBlockWeight > dgpMaxBlockWeight) {
         //contract will not be added to block, so revert state to before we tried
-        globalState->setRoot(oldHashStateRoot);
-        globalState->setRootUTXO(oldHashUTXORoot);
+        templateState->revertToCheckpoint(checkpoint);
         return false;
     }
 
@@ -602,11 +657,12 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
     this->nBlockSigOpsCost += iter->GetSigOpCost();
     nFees += iter->GetFee();
     inBlock.insert(iter);
+    m_selected.push_back(iter->GetTx().GetHash());
 
     for (CTransaction &t : bceResult.valueTransfers) {
-        pblock->vtx.emplace_back(MakeTransactionRef(std::move(t)));
         this->nBlockWeight += GetTransactionWeight(t);
         this->nBlockSigOpsCost += GetLegacySigOpCount(t);
+        pblock->vtx.emplace_back(MakeTransactionRef(std::move(t)));
         ++nBlockTx;
     }
     //calculate sigops from new refund/proof tx
@@ -629,6 +685,7 @@ void BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
     nBlockSigOpsCost += iter->GetSigOpCost();
     nFees += iter->GetFee();
     inBlock.insert(iter);
+    m_selected.push_back(iter->GetTx().GetHash());
 
     bool fPrintPriority = gArgs.GetBoolArg("-printpriority", DEFAULT_PRINTPRIORITY);
     if (fPrintPriority) {
@@ -699,6 +756,10 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
     // Keep track of entries that failed inclusion, to avoid duplicate work
     CTxMemPool::setEntries failedTx;
 
+    // Start by adding all descendants of the transactions of the previous template to mapModifiedTx
+    // and modifying them for their already included ancestors
+    nDescendantsUpdated += UpdatePackagesForAdded(mempool, inBlock, mapModifiedTx);
+
     CTxMemPool::indexed_transaction_set::index<ancestor_score_or_gas_price>::type::iterator mi = mempool.mapTx.get<ancestor_score_or_gas_price>().begin();
     CTxMemPool::txiter iter;
 
@@ -708,9 +769,12 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
     const int64_t MAX_CONSECUTIVE_FAILURES = 1000;
     int64_t nConsecutiveFailed = 0;
 
+    const uint64_t minTxGasLimit = gArgs.GetIntArg("-minmempoolgaslimit", MEMPOOL_MIN_GAS_LIMIT);
+
     while (mi != mempool.mapTx.get<ancestor_score_or_gas_price>().end() || !mapModifiedTx.empty()) {
         if(nTimeLimit != 0 && GetAdjustedTimeSeconds() >= nTimeLimit){
             //no more time to add transactions, just exit
+            m_out_of_time = true;
             return;
         }
         // First try to find a new transaction in mapTx to evaluate.
@@ -768,10 +832,12 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
         uint64_t packageSize = iter->GetSizeWithAncestors();
         CAmount packageFees = iter->GetModFeesWithAncestors();
         int64_t packageSigOpsCost = iter->GetSigOpCostWithAncestors();
+        uint64_t packageGasLimit = iter->GetGasLimitWithAncestors();
         if (fUsingModified) {
             packageSize = modit->nSizeWithAncestors;
             packageFees = modit->nModFeesWithAncestors;
             packageSigOpsCost = modit->nSigOpCostWithAncestors;
+            packageGasLimit = modit->nGasLimitWithAncestors;
         }
 
         if (packageFees < m_options.blockMinFeeRate.GetFee(packageSize)) {
@@ -798,6 +864,16 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
             continue;
         }
 
+        // Skip the packages that would fail on gas before their ancestors are calculated and their
+        // contract txs are converted
+        if (!TestPackageGas(iter, packageGasLimit, minTxGasLimit)) {
+            if (fUsingModified) {
+                mapModifiedTx.get<ancestor_score_or_gas_price>().erase(modit);
+                failedTx.insert(iter);
+            }
+            continue;
+        }
+
         auto ancestors{mempool.AssumeCalculateMemPoolAncestors(__func__, *iter, CTxMemPool::Limits::NoLimits(), /*fSearchForParents=*/false)};
 
         onlyUnconfirmed(ancestors);
@@ -823,6 +899,7 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
         for (size_t i = 0; i < sortedEntries.size(); ++i) {
             if(!wasAdded || (nTimeLimit != 0 && GetAdjustedTimeSeconds() >= nTimeLimit))
             {
+                if(wasAdded) m_out_of_time = true;
                 //if out of time, or earlier ancestor failed, then skip the rest of the transactions
                 mapModifiedTx.erase(sortedEntries[i]);
                 wasAdded=false;
@@ -859,6 +936,135 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
     }
 }
 
+// This transaction selection algorithm groups the mempool into clusters of transactions connected
+// by their spends, and linearizes every cluster into chunks of non-increasing feerate. The
+// linearizations are kept from template to template for the clusters that did not change. The
+// first chunks left of the clusters are merged in the order of the ancestor packages, so nothing
+// needs to be updated for the descendants of the transactions added. When a chunk cannot be added,
+// the rest of its cluster is left out, since it may depend on the chunk.
+void BlockAssembler::addClusterTxs(const CTxMemPool& mempool, int& nPackagesSelected, uint64_t minGasPrice, CBlock* pblock)
+{
+    AssertLockHeld(mempool.cs);
+
+    // The transactions of the previous template are not part of the clusters
+    const std::vector<std::vector<TxChunk>> clusters{GetTxClusters(mempool, inBlock)};
+    // The position of the next chunk of every cluster
+    std::vector<size_t> next(clusters.size(), 0);
+    const auto mined_before = [&](size_t a, size_t b) {
+        return ChunkMinedBefore(clusters[a][next[a]], clusters[b][next[b]]);
+    };
+    std::set<size_t, decltype(mined_before)> queue(mined_before);
+    for (size_t i = 0; i < clusters.size(); ++i) {
+        queue.insert(i);
+    }
+
+    // Limit the number of attempts to add transactions to the block when it is
+    // close to full, like addPackageTxs does
+    const int64_t MAX_CONSECUTIVE_FAILURES = 1000;
+    int64_t nConsecutiveFailed = 0;
+
+    const uint64_t minTxGasLimit = gArgs.GetIntArg("-minmempoolgaslimit", MEMPOOL_MIN_GAS_LIMIT);
+
+    while (!queue.empty()) {
+        if (nTimeLimit != 0 && GetAdjustedTimeSeconds() >= nTimeLimit) {
+            //no more time to add transactions, just exit
+            m_out_of_time = true;
+            return;
+        }
+        const size_t cluster = *queue.begin();
+        queue.erase(queue.begin());
+        const TxChunk& chunk = clusters[cluster][next[cluster]];
+
+        if (chunk.fee < m_options.blockMinFeeRate.GetFee(chunk.size)) {
+            // Everything else we might consider has a lower fee rate
+            return;
+        }
+
+        if (!TestPackage(chunk.size, chunk.sigops)) {
+            ++nConsecutiveFailed;
+
+            if (nConsecutiveFailed > MAX_CONSECUTIVE_FAILURES && nBlockWeight >
+                    m_options.nBlockMaxWeight - 4000) {
+                // Give up if we're close to full and haven't succeeded in a while
+                break;
+            }
+            continue;
+        }
+
+        bool fitsGas = true;
+        for (CTxMemPool::txiter it : chunk.txs) {
+            if (it->GetGasLimit() > 0 && !TestPackageGas(it, chunk.gas_limit, minTxGasLimit)) {
+                fitsGas = false;
+                break;
+            }
+        }
+        if (!fitsGas || !TestPackageTransactions(CTxMemPool::setEntries(chunk.txs.begin(), chunk.txs.end()))) {
+            continue;
+        }
+
+        // This chunk will make it in; reset the failed counter.
+        nConsecutiveFailed = 0;
+
+        bool wasAdded = true;
+        for (CTxMemPool::txiter it : chunk.txs) {
+            if (nTimeLimit != 0 && GetAdjustedTimeSeconds() >= nTimeLimit) {
+                m_out_of_time = true;
+                return;
+            }
+            if (it->GetTx().HasCreateOrCall()) {
+                if (!AttemptToAddContractToBlock(it, minGasPrice, pblock)) {
+                    wasAdded = false;
+                    break;
+                }
+            } else {
+                AddToBlock(it);
+            }
+        }
+        if (!wasAdded) {
+            continue;
+        }
+
+        ++nPackagesSelected;
+
+        if (++next[cluster] < clusters[cluster].size()) {
+            queue.insert(cluster);
+        }
+    }
+}
+
+bool BlockAssembler::addSelectedTxs(const CTxMemPool& mempool, const TemplateSelection& selection, const uint256& tip, uint64_t minGasPrice, CBlock* pblock)
+{
+    AssertLockHeld(mempool.cs);
+
+    if (selection.tip != tip) {
+        return false;
+    }
+    // The selection is in block order, so the transactions before the first one that cannot be added
+    // again have all their mempool ancestors in the block
+    for (const uint256& txid : selection.txids) {
+        if (nTimeLimit != 0 && GetAdjustedTimeSeconds() >= nTimeLimit) {
+            m_out_of_time = true;
+            return false;
+        }
+        const std::optional<CTxMemPool::txiter> it = mempool.GetIter(txid);
+        if (!it) {
+            return false;
+        }
+        const CTxMemPool::txiter iter = *it;
+        if (!TestPackage(iter->GetTxSize(), iter->GetSigOpCost()) || !TestPackageTransactions({iter})) {
+            return false;
+        }
+        if (iter->GetTx().HasCreateOrCall()) {
+            if (!AttemptToAddContractToBlock(iter, minGasPrice, pblock)) {
+                return false;
+            }
+        } else {
+            AddToBlock(iter);
+        }
+    }
+    return selection.complete && selection.mempool_updates == mempool.GetTransactionsUpdated();
+}
+
 bool CanStake()
 {
     bool canStake = gArgs.GetBoolArg("-staking", DEFAULT_STAKE);
@@ -878,6 +1084,11 @@ bool CanStake()
 // Proof of Stake miner
 //
 
+// The transactions of the last block template of the stakers, shared by the stakers of all the loaded wallets,
+// so that on the same tip and mempool only the first of them selects the transactions. It is only accessed
+// by BlockAssembler::CreateNewBlock, under cs_main.
+static TemplateSelection g_stake_template_selection;
+
 //
 // Looking for suitable coins for creating new block.
 //
@@ -1123,7 +1334,7 @@ public:
                 {
                     Delegation delegation;
                     uint160 address = item.first;
-                    if(qtumDelegations.GetDelegation(address, delegation, pwallet->chain().chainman().ActiveChainstate()) && QtumDelegation::VerifyDelegation(address, delegation))
+                    if(qtumDelegations.GetDelegation(address, delegation, pwallet->chain().chainman().ActiveChainstate()) && VerifyStakeDelegation(address, delegation))
                     {
                         cacheMyDelegations[address] = delegation;
                     }
@@ -1134,6 +1345,9 @@ public:
                 cacheHeight = nHeight;
             }
         }
+
+        // The coins of the addresses delegated to other stakers do not count in the stake weight
+        pwallet->MarkStakeWeightDirty();
     }
 
     void SelectAddress(std::map<uint160, bool>& mapAddress, int32_t nHeight)
@@ -1202,7 +1416,17 @@ bool CheckStake(const std::shared_ptr<const CBlock> pblock, wallet::CWallet& wal
 
     // Process this block the same as if we had received it from another node
     bool fNewBlock = false;
-    if (!wallet.chain().chainman().ProcessNewBlock(pblock, true, true, &fNewBlock))
+    const auto time_start{SteadyClock::now()};
+    const bool accepted = wallet.chain().chainman().ProcessNewBlock(pblock, true, true, &fNewBlock);
+    const auto duration{std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - time_start)};
+    wallet.m_staking_metrics.AddTiming(wallet::StakingPhase::PROCESS_BLOCK, duration);
+    wallet.m_staking_metrics.AddSubmittedBlock(accepted);
+    TRACE3(staker, process_block,
+        hashBlock.data(),
+        accepted,
+        duration.count()
+    );
+    if (!accepted)
         return error("CheckStake() : ProcessBlock, block not accepted");
 
     return true;
@@ -1317,7 +1541,7 @@ bool SignBlockLedger(std::shared_ptr<CBlock> pblock, wallet::CWallet& wallet)
 }
 
 // novacoin: attempt to generate suitable proof-of-stake
-bool SignBlock(std::shared_ptr<CBlock> pblock, wallet::CWallet& wallet, const CAmount& nTotalFees, uint32_t nTime, std::set<std::pair<const wallet::CWalletTx*,unsigned int> >& setCoins, std::vector<COutPoint>& setSelectedCoins, std::vector<COutPoint>& setDelegateCoins, bool selectedOnly = false, bool tryOnly = false)
+bool SignBlock(std::shared_ptr<CBlock> pblock, wallet::CWallet& wallet, const CAmount& nTotalFees, uint32_t nTime, std::set<std::pair<const wallet::CWalletTx*,unsigned int> >& setCoins, std::vector<COutPoint>& setSelectedCoins, std::vector<COutPoint>& setDelegateCoins, bool selectedOnly = false, bool tryOnly = false, bool deferDeviceSign = false)
 {
     // if we are trying to sign
     //    something except proof-of-stake block template
@@ -1375,6 +1599,10 @@ bool SignBlock(std::shared_ptr<CBlock> pblock, wallet::CWallet& wallet, const CA
                 if(vchPoD.size() > 0)
                     pblock->SetProofOfDelegation(vchPoD);
 
+                // the hardware device signs the block later, out of the wallet lock
+                if(privateKeysDisabled && deferDeviceSign)
+                    return true;
+
                 // append a signature to our block, ensure that is compact and check block header
                 bool isSigned = privateKeysDisabled ? SignBlockLedger(pblock, wallet) : wallet.SignBlockStake(*pblock, pkhash, true);
                 return isSigned && CheckHeaderProof(*pblock, consensusParams, wallet.chain().chainman().ActiveChainstate());
@@ -1392,6 +1620,206 @@ bool SignBlock(std::shared_ptr<CBlock> pblock, wallet::CWallet& wallet, const CA
     return false;
 }
 
+/**
+ * @brief The StakeDeviceSigner class signs the candidate blocks with the hardware device in its own thread,
+ * so the staker keeps searching kernels for the next block times while the device is busy.
+ * The first candidate that is signed is kept for the staker, the other queued candidates are dropped.
+ */
+class StakeDeviceSigner
+{
+public:
+    StakeDeviceSigner(wallet::CWallet& wallet, const std::string& threadName):
+        m_wallet(wallet)
+    {
+        m_thread = std::thread(&util::TraceThread, threadName, [this] { ThreadSign(); });
+    }
+
+    ~StakeDeviceSigner()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        m_thread.join();
+    }
+
+    /** Queue a candidate block with its coinstake created, returns false if the queue is full */
+    bool Push(std::shared_ptr<CBlock> pblock, uint32_t blockTime) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        {
+            LOCK(m_mutex);
+            if(m_signed || m_queue.size() >= STAKER_MAX_QUEUED_DEVICE_SIGNATURES) return false;
+            m_queue.emplace_back(std::move(pblock), blockTime);
+        }
+        m_cond.notify_one();
+        return true;
+    }
+
+    /** Take the signed block, if a candidate has been signed */
+    std::shared_ptr<CBlock> PopSigned() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        return std::move(m_signed);
+    }
+
+    /** Drop the queued candidates and the signed block, the candidate being signed is dropped when done */
+    void Clear() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        m_queue.clear();
+        m_signed.reset();
+        ++m_generation;
+    }
+
+private:
+    void ThreadSign() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        const Consensus::Params& consensusParams = Params().GetConsensus();
+        while(true)
+        {
+            std::shared_ptr<CBlock> pblock;
+            uint32_t blockTime = 0;
+            uint64_t generation = 0;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_queue.empty(); });
+                if(m_stop) return;
+                std::tie(pblock, blockTime) = std::move(m_queue.front());
+                m_queue.pop_front();
+                generation = m_generation;
+            }
+
+            if(m_wallet.IsStakeClosing()) continue;
+            {
+                LOCK(cs_main);
+                if(pblock->hashPrevBlock != m_wallet.chain().getTip()->GetBlockHash()) continue;
+            }
+
+            const auto time_start{SteadyClock::now()};
+            bool isSigned = SignBlockLedger(pblock, m_wallet) && CheckHeaderProof(*pblock, consensusParams, m_wallet.chain().chainman().ActiveChainstate());
+            const auto duration{std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - time_start)};
+            m_wallet.m_staking_metrics.AddTiming(wallet::StakingPhase::SIGN_BLOCK, duration);
+            TRACE3(staker, phase,
+                wallet::StakingPhaseName(wallet::StakingPhase::SIGN_BLOCK),
+                blockTime,
+                duration.count()
+            );
+            if(!isSigned) continue;
+
+            LOCK(m_mutex);
+            if(generation == m_generation && !m_signed)
+            {
+                m_signed = std::move(pblock);
+                m_queue.clear();
+            }
+        }
+    }
+
+    wallet::CWallet& m_wallet;
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<std::pair<std::shared_ptr<CBlock>, uint32_t>> m_queue GUARDED_BY(m_mutex);
+    std::shared_ptr<CBlock> m_signed GUARDED_BY(m_mutex);
+    uint64_t m_generation GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::thread m_thread;
+};
+
+/**
+ * @brief The StakeTemplatePreparer class assembles a block template in its own thread as soon as a new tip
+ * is connected, before the staker finds a kernel on it. The template is dropped, what is kept is the
+ * transaction selection and the contract execution results it leaves in g_stake_template_selection and
+ * ContractExecResultCache: the template of a winning kernel then reuses them instead of selecting the
+ * transactions and executing the contracts again. The results are kept by block author, so the template
+ * is made for the author of the last block the staker created.
+ */
+class StakeTemplatePreparer final : public CValidationInterface
+{
+public:
+    StakeTemplatePreparer(wallet::CWallet& wallet, const std::string& threadName):
+        m_wallet(wallet)
+    {
+        m_thread = std::thread(&util::TraceThread, threadName, [this] { ThreadPrepare(); });
+    }
+
+    ~StakeTemplatePreparer()
+    {
+        Stop();
+    }
+
+    void Stop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        if(m_thread.joinable()) m_thread.join();
+    }
+
+    /** Prepare the next templates for the author paid by @p script */
+    void SetAuthor(const CScript& script) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        m_script = script;
+    }
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        if(fInitialDownload) return;
+        {
+            LOCK(m_mutex);
+            if(m_script.empty()) return;
+            m_tip = pindexNew->GetBlockHash();
+        }
+        m_cond.notify_one();
+    }
+
+private:
+    void ThreadPrepare() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        const Consensus::Params& consensusParams = Params().GetConsensus();
+        while(true)
+        {
+            CScript script;
+            uint256 tip;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_tip.IsNull(); });
+                if(m_stop) return;
+                script = m_script;
+                tip = m_tip;
+                m_tip.SetNull();
+            }
+
+            if(m_wallet.IsStakeClosing()) continue;
+            int nHeight = 0;
+            {
+                LOCK(cs_main);
+                // Another block was connected meanwhile, the template is prepared for it next
+                if(tip != m_wallet.chain().getTip()->GetBlockHash()) continue;
+                nHeight = m_wallet.chain().getHeight().value_or(0) + 1;
+            }
+
+            const auto time_start{SteadyClock::now()};
+            BlockAssembler assembler(m_wallet.chain().chainman().ActiveChainstate(), &(m_wallet.chain().mempool()), &m_wallet);
+            assembler.SetTemplateSelection(&g_stake_template_selection);
+            if(!assembler.CreateNewBlock(script, true, nullptr, 0, FutureDrift(GetAdjustedTimeSeconds(), nHeight, consensusParams) - nStakeTimeBuffer)) continue;
+            LogPrint(BCLog::BENCH, "StakeTemplatePreparer: prepared the template of block %d in %.2fms\n", nHeight, Ticks<MillisecondsDouble>(SteadyClock::now() - time_start));
+        }
+    }
+
+    wallet::CWallet& m_wallet;
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    CScript m_script GUARDED_BY(m_mutex);
+    uint256 m_tip GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::thread m_thread;
+};
+
 /**
  * @brief The IStakeMiner class Miner interface
  */
@@ -1444,9 +1872,10 @@ public:
     bool fAggressiveStaking = false;
     bool fError = false;
     int numThreads = 1;
-    boost::thread_group threads;
-    mutable RecursiveMutex cs_worker;
+    CCheckQueue<StakeKernelCheck> kernelCheckQueue{STAKE_KERNEL_QUEUE_BATCH_SIZE};
     bool privateKeysDisabled = false;;
+    std::unique_ptr<StakeDeviceSigner> deviceSigner;
+    std::shared_ptr<StakeTemplatePreparer> templatePreparer;
 
 public:
     DelegationsStaker delegationsStaker;
@@ -1465,6 +1894,7 @@ public:
     std::vector<COutPoint> setSelectedCoins;
     std::vector<COutPoint> setDelegateCoins;
     std::vector<COutPoint> prevouts;
+    std::unique_ptr<StakeKernelSearch> kernelSearch;
     std::map<uint32_t, bool> mapSolveBlockTime;
     std::multimap<uint256, SolveItem> mapSolvedBlock;
     std::map<uint32_t, std::vector<COutPoint>> mapSolveSelectedCoins;
@@ -1508,6 +1938,30 @@ public:
         }
         if(pwallet) numThreads = pwallet->m_num_threads;
         if(pwallet) privateKeysDisabled = pwallet->IsWalletFlagSet(wallet::WALLET_FLAG_DISABLE_PRIVATE_KEYS);
+
+        // The kernel search workers are kept for the life of the staker, the staking thread is one of them
+        if(numThreads > 1) kernelCheckQueue.StartWorkerThreads(numThreads - 1, threadName + "-kernel");
+
+        // The hardware device is slow to sign, so it signs the candidates while the staker keeps searching
+        if(pwallet && privateKeysDisabled) deviceSigner = std::make_unique<StakeDeviceSigner>(*pwallet, threadName + "-signer");
+
+        // Select the transactions and execute the contracts of the next block as soon as a tip is connected
+        if(pwallet && gArgs.GetBoolArg("-staker-prepare-template", DEFAULT_STAKER_PREPARE_TEMPLATE))
+        {
+            templatePreparer = std::make_shared<StakeTemplatePreparer>(*pwallet, threadName + "-prepare");
+            RegisterSharedValidationInterface(templatePreparer);
+        }
+    }
+
+    ~StakeMinerPriv()
+    {
+        if(templatePreparer)
+        {
+            UnregisterSharedValidationInterface(templatePreparer);
+            templatePreparer->Stop();
+        }
+        deviceSigner.reset();
+        kernelCheckQueue.StopWorkerThreads();
     }
 
     void clearCache()
@@ -1524,6 +1978,7 @@ public:
         setSelectedCoins.clear();
         setDelegateCoins.clear();
         prevouts.clear();
+        kernelSearch.reset();
         mapSolveBlockTime.clear();
         mapSolvedBlock.clear();
         mapSolveSelectedCoins.clear();
@@ -1576,6 +2031,9 @@ public:
 
                 for(uint32_t blockTime = d->beginningTime; blockTime < d->endingTime; blockTime += d->stakeTimestampMask+1)
                 {
+                    // Submit the block signed by the hardware device
+                    if(SubmitDeviceSignedBlock()) break;
+
                     // Update status bar
                     UpdateStatusBar(blockTime);
 
@@ -1587,12 +2045,20 @@ public:
                     if(CanCreateBlock(blockTime))
                     {
                         // Create new block
-                        if(!CreateNewBlock(blockTime)) break;
+                        if(!CreateNewBlock(blockTime))
+                        {
+                            MissedSlot(blockTime);
+                            break;
+                        }
 
                         // Sign new block
                         if(SignNewBlock(blockTime)) break;
+                        if(!d->deviceSigner) MissedSlot(blockTime);
                     }
                 }
+
+                // Submit the block signed by the hardware device during the search
+                SubmitDeviceSignedBlock();
             }
 
             // Miner sleep before the next try
@@ -1740,6 +2206,12 @@ protected:
     bool UpdateData()
     {
         if(d->pwallet->IsStakeClosing()) return false;
+        if(d->fSuperStake && g_addressindex)
+        {
+            // The delegated coins are read from the address index, wait for it to catch up with the tip
+            // before locking the wallet, the wallet notifications waited for need cs_wallet
+            g_addressindex->BlockUntilSyncedToCurrentChain();
+        }
         LOCK(d->pwallet->cs_wallet);
 
         d->clearCache();
@@ -1792,6 +2264,7 @@ protected:
 
             LOCK(cs_main);
             UpdateMinerStakeCache(*d->pwallet, true, d->prevouts, d->pindexPrev);
+            d->kernelSearch = std::make_unique<StakeKernelSearch>(d->pindexPrev, d->pblock->nBits, d->prevouts, d->pwallet->minerStakeCache);
         }
 
         d->beginningTime = GetAdjustedTimeSeconds();
@@ -1801,11 +2274,39 @@ protected:
         return true;
     }
 
+    void AddTiming(wallet::StakingPhase phase, const SteadyClock::time_point& start, const uint32_t& blockTime)
+    {
+        const auto duration{std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - start)};
+        d->pwallet->m_staking_metrics.AddTiming(phase, duration);
+        TRACE3(staker, phase,
+            wallet::StakingPhaseName(phase),
+            blockTime,
+            duration.count()
+        );
+    }
+
+    void MissedSlot(const uint32_t& blockTime)
+    {
+        // A kernel was found for the block time but no block was submitted for it
+        d->pwallet->m_staking_metrics.AddMissedSlot();
+        TRACE2(staker, missed_slot,
+            blockTime,
+            d->nHeight
+        );
+        LogPrint(BCLog::COINSTAKE, "ThreadStakeMiner(): No block submitted for the solved block time %d at height %d\n", blockTime, d->nHeight);
+    }
+
     bool CacheData()
     {
         if(IsCachedDataOld())
         {
-            if(!UpdateData())
+            // The candidates for the previous tip are stale
+            if(d->deviceSigner) d->deviceSigner->Clear();
+
+            const auto time_start{SteadyClock::now()};
+            const bool updated = UpdateData();
+            AddTiming(wallet::StakingPhase::UPDATE_DATA, time_start, 0);
+            if(!updated)
                 return false;
         }
 
@@ -1826,50 +2327,16 @@ protected:
         if(searchInterval > 0) d->pwallet->m_last_coin_stake_search_interval = searchInterval;
     }
 
-    void SloveBlock(uint32_t blockTime, size_t delegateSize, size_t from, size_t to)
-    {
-        std::multimap<uint256, SolveItem> tmpSolvedBlock;
-        for(size_t i = from; i < to; i++)
-        {
-            const COutPoint &prevoutStake = d->prevouts[i];
-            uint256 hashProofOfStake;
-            if (CheckKernelCache(d->pindexPrev, d->pblock->nBits, blockTime, prevoutStake, d->pwallet->minerStakeCache, hashProofOfStake))
-            {
-                bool delegate = i < delegateSize;
-                tmpSolvedBlock.insert(std::make_pair(hashProofOfStake, SolveItem(prevoutStake, blockTime, delegate)));
-            }
-        }
-
-        if(tmpSolvedBlock.size() > 0)
-        {
-            LOCK(d->cs_worker);
-            d->mapSolveBlockTime[blockTime] = true;
-            d->mapSolvedBlock.insert(tmpSolvedBlock.begin(), tmpSolvedBlock.end());
-        }
-    }
-
     void SloveBlock(const uint32_t& blockTime)
     {
-        // Init variables
-        size_t listSize = d->prevouts.size();
-        size_t delegateSize = d->setDelegateCoins.size();
-
         // Solve block
-        int numThreads = std::min(d->numThreads, (int)listSize);
-        if(listSize < 1000 || numThreads < 2)
-        {
-            SloveBlock(blockTime, delegateSize, 0, listSize);
-        }
-        else
+        size_t delegateSize = d->setDelegateCoins.size();
+        CCheckQueue<StakeKernelCheck>* queue = d->kernelCheckQueue.HasThreads() ? &d->kernelCheckQueue : nullptr;
+        for(const StakeKernelSearch::Kernel& kernel : d->kernelSearch->Search(blockTime, queue))
         {
-            size_t chunk = listSize / numThreads;
-            for(int i = 0; i < numThreads; i++)
-            {
-                size_t from = i * chunk;
-                size_t to = i == (numThreads -1) ? listSize : from + chunk;
-                d->threads.create_thread([this, blockTime, delegateSize, from, to]{SloveBlock(blockTime, delegateSize, from, to);});
-            }
-            d->threads.join_all();
+            bool delegate = kernel.index < delegateSize;
+            d->mapSolveBlockTime[blockTime] = true;
+            d->mapSolvedBlock.insert(std::make_pair(kernel.hashProofOfStake, SolveItem(d->prevouts[kernel.index], blockTime, delegate)));
         }
 
         // Populate the list with the potential solwed blocks
@@ -1893,7 +2360,10 @@ protected:
         if(d->mapSolveBlockTime.find(blockTime) == d->mapSolveBlockTime.end())
         {
             d->mapSolveBlockTime[blockTime] = false;
+            const auto time_start{SteadyClock::now()};
             SloveBlock(blockTime);
+            AddTiming(wallet::StakingPhase::KERNEL_SEARCH, time_start, blockTime);
+            d->pwallet->m_staking_metrics.AddSlot(d->mapSolveBlockTime[blockTime]);
         }
 
         return d->mapSolveBlockTime[blockTime];
@@ -1910,14 +2380,20 @@ protected:
             return false;
         }
 
+        const auto time_start{SteadyClock::now()};
+
         // Try to create an empty PoS block to get the address of the block creator for contracts
         if (!SignBlock(d->pblock, *(d->pwallet), d->nTotalFees, blockTime, d->setCoins, d->mapSolveSelectedCoins[blockTime], d->mapSolveDelegateCoins[blockTime], true, true))
             return false;
 
-        // Create a block that's properly populated with transactions
+        if(d->templatePreparer) d->templatePreparer->SetAuthor(d->pblock->vtx[1]->vout[1].scriptPubKey);
+
+        // Create a block that's properly populated with transactions, starting from those of the previous one
+        BlockAssembler assembler(d->pwallet->chain().chainman().ActiveChainstate(), &(d->pwallet->chain().mempool()), d->pwallet);
+        assembler.SetTemplateSelection(&g_stake_template_selection);
         d->pblocktemplatefilled = std::unique_ptr<CBlockTemplate>(
-                BlockAssembler(d->pwallet->chain().chainman().ActiveChainstate(), &(d->pwallet->chain().mempool()), d->pwallet).CreateNewBlock(d->pblock->vtx[1]->vout[1].scriptPubKey, true, &(d->nTotalFees),
-                                                        blockTime, FutureDrift(GetAdjustedTimeSeconds(), d->nHeight, d->consensusParams) - nStakeTimeBuffer));
+                assembler.CreateNewBlock(d->pblock->vtx[1]->vout[1].scriptPubKey, true, &(d->nTotalFees),
+                                         blockTime, FutureDrift(GetAdjustedTimeSeconds(), d->nHeight, d->consensusParams) - nStakeTimeBuffer));
         if (!d->pblocktemplatefilled.get()) {
             d->fError = true;
             return false;
@@ -1931,6 +2407,7 @@ protected:
 
         // Sign the full block and use the timestamp from earlier for a valid stake
         d->pblockfilled = std::make_shared<CBlock>(d->pblocktemplatefilled->block);
+        AddTiming(wallet::StakingPhase::CREATE_BLOCK, time_start, blockTime);
 
         return true;
     }
@@ -1940,44 +2417,28 @@ protected:
         // Try to sign the block once at specific time with the same cached data
         d->mapSolveBlockTime[blockTime] = false;
 
-        if (SignBlock(d->pblockfilled, *(d->pwallet), d->nTotalFees, blockTime, d->setCoins, d->mapSolveSelectedCoins[blockTime], d->mapSolveDelegateCoins[blockTime], true)) {
-            // Should always reach here unless we spent too much time processing transactions and the timestamp is now invalid
-            // CheckStake also does CheckBlock and AcceptBlock to propagate it to the network
-            bool validBlock = false;
-            while(!validBlock) {
-                if (IsStale(d->pblockfilled)) {
-                    //another block was received while building ours, scrap progress
-                    LogPrintf("ThreadStakeMiner(): Valid future PoS block was orphaned before becoming valid\n");
-                    break;
-                }
-                //check timestamps
-                if (d->pblockfilled->GetBlockTime() <= d->pindexPrev->GetBlockTime() ||
-                    FutureDrift(d->pblockfilled->GetBlockTime(), d->nHeight, d->consensusParams) < d->pindexPrev->GetBlockTime()) {
-                    LogPrintf("ThreadStakeMiner(): Valid PoS block took too long to create and has expired\n");
-                    break; //timestamp too late, so ignore
-                }
-                if (d->pblockfilled->GetBlockTime() > FutureDrift(GetAdjustedTimeSeconds(), d->nHeight, d->consensusParams)) {
-                    if (d->fAggressiveStaking) {
-                        //if being agressive, then check more often to publish immediately when valid. This might allow you to find more blocks,
-                        //but also increases the chance of broadcasting invalid blocks and getting DoS banned by nodes,
-                        //or receiving more stale/orphan blocks than normal. Use at your own risk.
-                        if(!Sleep(100)) break;
-                    }else{
-                        //too early, so wait 3 seconds and try again
-                        if(!Sleep(nMinerWaitWalidBlock)) break;
-                    }
-                    continue;
+        if(d->deviceSigner)
+        {
+            // Create the coinstake and queue the block to the hardware device, then keep searching
+            if(SignBlock(d->pblockfilled, *(d->pwallet), d->nTotalFees, blockTime, d->setCoins, d->mapSolveSelectedCoins[blockTime], d->mapSolveDelegateCoins[blockTime], true, false, true)) {
+                if(!d->deviceSigner->Push(d->pblockfilled, blockTime)) {
+                    MissedSlot(blockTime);
                 }
-                //if there is mined block by other staker wait for it to download
-                if(!SyncWithMiners()) break;
-                validBlock=true;
-            }
-            if(validBlock) {
-                if(!CheckStake(d->pblockfilled, *(d->pwallet)))
-                    d->forceUpdate = true;
-                // Update the search time when new valid block is created, needed for status bar icon
-                d->pwallet->m_last_coin_stake_search_time = d->pblockfilled->GetBlockTime();
+            } else {
+                MissedSlot(blockTime);
             }
+
+            //return back to low priority
+            SetThreadPriority(THREAD_PRIORITY_LOWEST);
+            return false;
+        }
+
+        const auto time_start{SteadyClock::now()};
+        const bool signedBlock = SignBlock(d->pblockfilled, *(d->pwallet), d->nTotalFees, blockTime, d->setCoins, d->mapSolveSelectedCoins[blockTime], d->mapSolveDelegateCoins[blockTime], true);
+        AddTiming(wallet::StakingPhase::SIGN_BLOCK, time_start, blockTime);
+
+        if (signedBlock) {
+            SubmitBlock(d->pblockfilled);
             return true;
         }
 
@@ -1986,6 +2447,64 @@ protected:
         return false;
     }
 
+    bool SubmitDeviceSignedBlock()
+    {
+        if(!d->deviceSigner)
+            return false;
+
+        std::shared_ptr<CBlock> pblockSigned = d->deviceSigner->PopSigned();
+        if(!pblockSigned)
+            return false;
+
+        SetThreadPriority(THREAD_PRIORITY_ABOVE_NORMAL);
+        SubmitBlock(pblockSigned);
+        SetThreadPriority(THREAD_PRIORITY_LOWEST);
+        return true;
+    }
+
+    void SubmitBlock(const std::shared_ptr<CBlock>& pblockSigned)
+    {
+        // Should always reach here unless we spent too much time processing transactions and the timestamp is now invalid
+        // CheckStake also does CheckBlock and AcceptBlock to propagate it to the network
+        bool validBlock = false;
+        while(!validBlock) {
+            if (IsStale(pblockSigned)) {
+                //another block was received while building ours, scrap progress
+                LogPrintf("ThreadStakeMiner(): Valid future PoS block was orphaned before becoming valid\n");
+                break;
+            }
+            //check timestamps
+            if (pblockSigned->GetBlockTime() <= d->pindexPrev->GetBlockTime() ||
+                FutureDrift(pblockSigned->GetBlockTime(), d->nHeight, d->consensusParams) < d->pindexPrev->GetBlockTime()) {
+                LogPrintf("ThreadStakeMiner(): Valid PoS block took too long to create and has expired\n");
+                break; //timestamp too late, so ignore
+            }
+            if (pblockSigned->GetBlockTime() > FutureDrift(GetAdjustedTimeSeconds(), d->nHeight, d->consensusParams)) {
+                if (d->fAggressiveStaking) {
+                    //if being agressive, then check more often to publish immediately when valid. This might allow you to find more blocks,
+                    //but also increases the chance of broadcasting invalid blocks and getting DoS banned by nodes,
+                    //or receiving more stale/orphan blocks than normal. Use at your own risk.
+                    if(!Sleep(100)) break;
+                }else{
+                    //too early, so wait 3 seconds and try again
+                    if(!Sleep(nMinerWaitWalidBlock)) break;
+                }
+                continue;
+            }
+            //if there is mined block by other staker wait for it to download
+            if(!SyncWithMiners()) break;
+            validBlock=true;
+        }
+        if(!validBlock) {
+            MissedSlot(pblockSigned->nTime);
+        } else {
+            if(!CheckStake(pblockSigned, *(d->pwallet)))
+                d->forceUpdate = true;
+            // Update the search time when new valid block is created, needed for status bar icon
+            d->pwallet->m_last_coin_stake_search_time = pblockSigned->GetBlockTime();
+        }
+    }
+
     bool isLedgerConnected()
     {
         if(d->pwallet->IsStakeClosing())
@@ -2020,6 +2539,7 @@ IStakeMiner *createMiner()
 
 void ThreadStakeMiner(wallet::CWallet *pwallet)
 {
+    AllocScope alloc_scope{AllocTag::WALLET};
     IStakeMiner* miner = createMiner();
     miner->Init(pwallet);
     miner->Run();
@@ -31,6 +31,8 @@ namespace Consensus { struct Params; };
 
 namespace node {
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Default for -blockclusters, whether the block transactions are selected from cluster chunks */
+static const bool DEFAULT_BLOCK_CLUSTERS = false;
 
 static const bool DEFAULT_STAKE = true;
 
@@ -40,6 +42,9 @@ static const bool DEFAULT_SUPER_STAKE = false;
 
 static const bool ENABLE_HARDWARE_STAKE = false;
 
+//Whether to assemble the template of the next block as soon as a tip is connected, before a kernel is found
+static const bool DEFAULT_STAKER_PREPARE_TEMPLATE = true;
+
 //How many seconds to look ahead and prepare a block for staking
 //Look ahead up to 3 "timeslots" in the future, 48 seconds
 //Reduce this to reduce computational waste for stakers, increase this to increase the amount of time available to construct full blocks
@@ -65,6 +70,9 @@ static const int32_t STAKER_WAIT_FOR_WALID_BLOCK = 3000;
 //How much time to wait for best block header to be downloaded to the blockchain
 static const int32_t STAKER_WAIT_FOR_BEST_BLOCK_HEADER = 250;
 
+//How many candidate blocks can wait to be signed by the hardware device
+static const int32_t STAKER_MAX_QUEUED_DEVICE_SIGNATURES = 3;
+
 //How much max time to wait for best block header to be downloaded to the blockchain
 static const int32_t DEFAULT_MAX_STAKER_WAIT_FOR_BEST_BLOCK_HEADER = 4000;
 
@@ -88,6 +96,7 @@ struct CTxMemPoolModifiedEntry {
         nSizeWithAncestors = entry->GetSizeWithAncestors();
         nModFeesWithAncestors = entry->GetModFeesWithAncestors();
         nSigOpCostWithAncestors = entry->GetSigOpCostWithAncestors();
+        nGasLimitWithAncestors = entry->GetGasLimitWithAncestors();
     }
 
     CAmount GetModifiedFee() const { return iter->GetModifiedFee(); }
@@ -100,6 +109,7 @@ struct CTxMemPoolModifiedEntry {
     uint64_t nSizeWithAncestors;
     CAmount nModFeesWithAncestors;
     int64_t nSigOpCostWithAncestors;
+    uint64_t nGasLimitWithAncestors;
 };
 
 /** Comparator for CTxMemPool::txiter objects.
@@ -223,11 +233,22 @@ struct update_for_parent_inclusion
         e.nModFeesWithAncestors -= iter->GetModifiedFee();
         e.nSizeWithAncestors -= iter->GetTxSize();
         e.nSigOpCostWithAncestors -= iter->GetSigOpCost();
+        e.nGasLimitWithAncestors -= iter->GetGasLimit();
     }
 
     CTxMemPool::txiter iter;
 };
 
+/** The mempool transactions selected for the last block template, in block order */
+struct TemplateSelection {
+    uint256 tip;
+    //! CTxMemPool::GetTransactionsUpdated() when the selection was made, it changes with every transaction added or removed
+    unsigned int mempool_updates{0};
+    std::vector<uint256> txids;
+    //! Set unless the selection was cut short by the time limit of the template
+    bool complete{false};
+};
+
 /** Generate a new block, without valid proof-of-work */
 class BlockAssembler
 {
@@ -260,6 +281,8 @@ public:
         CFeeRate blockMinFeeRate{DEFAULT_BLOCK_MIN_TX_FEE};
         // Whether to call TestBlockValidity() at the end of CreateNewBlock().
         bool test_block_validity{true};
+        // Whether to select the transactions from the chunks of the mempool clusters instead of ancestor packages
+        bool cluster_selection{DEFAULT_BLOCK_CLUSTERS};
     };
 
     explicit BlockAssembler(Chainstate& chainstate, const CTxMemPool* mempool);
@@ -270,6 +293,9 @@ public:
 
 ///////////////////////////////////////////// // qtum
     ByteCodeExecResult bceResult;
+    // The contract transactions of the template are executed on this copy of the contract state, whose memory
+    // overlay keeps the accepted executions until the template is finished
+    std::unique_ptr<QtumState> templateState;
     uint64_t minGasPrice = 1;
     uint64_t hardBlockGasLimit;
     uint64_t softBlockGasLimit;
@@ -289,9 +315,19 @@ public:
     inline static std::optional<int64_t> m_last_block_num_txs{};
     inline static std::optional<int64_t> m_last_block_weight{};
 
+    /** Start from the transactions of the previous template on the same tip and record the new selection
+     *  into @p selection, so that only the mempool changes since are selected again. */
+    void SetTemplateSelection(TemplateSelection* selection) { m_selection = selection; }
+
 private:
     const Options m_options;
 
+    TemplateSelection* m_selection{nullptr};
+    // The mempool transactions added to the block, in block order
+    std::vector<uint256> m_selected;
+    // Set when transactions were left out because the time limit was reached
+    bool m_out_of_time{false};
+
     // utility functions
     /** Clear the block's state and prepare for assembling a new block */
     void resetBlock();
@@ -305,6 +341,12 @@ private:
       * Increments nPackagesSelected / nDescendantsUpdated with corresponding
       * statistics from the package selection (for logging statistics). */
     void addPackageTxs(const CTxMemPool& mempool, int& nPackagesSelected, int& nDescendantsUpdated, uint64_t minGasPrice, CBlock* pblock) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
+    /** Add transactions by merging the chunks of the linearized mempool clusters, see node/txclusters.h.
+      * Increments nPackagesSelected with the number of chunks added. */
+    void addClusterTxs(const CTxMemPool& mempool, int& nPackagesSelected, uint64_t minGasPrice, CBlock* pblock) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
+    /** Add the transactions of the previous template again, until one is no longer in the mempool or does not fit.
+      * Returns true if all were added and the mempool did not change since, so nothing else needs to be selected. */
+    bool addSelectedTxs(const CTxMemPool& mempool, const TemplateSelection& selection, const uint256& tip, uint64_t minGasPrice, CBlock* pblock) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
 
     /** Rebuild the coinbase/coinstake transaction to account for new gas refunds **/
     void RebuildRefundTransaction(CBlock* pblock);
@@ -313,6 +355,9 @@ private:
     void onlyUnconfirmed(CTxMemPool::setEntries& testSet);
     /** Test if a new package would "fit" in the block */
     bool TestPackage(uint64_t packageSize, int64_t packageSigOpsCost) const;
+    /** Test if a package with contract txs can still fit under the soft block gas limit, and if the
+      * contract tx at its end passes the gas checks of the staker, before the package is evaluated */
+    bool TestPackageGas(CTxMemPool::txiter iter, uint64_t packageGasLimit, uint64_t minTxGasLimit) const;
     /** Perform checks on each transaction in a package:
       * locktime, premature-witness, serialized size (if necessary)
       * These checks should always succeed, and they're here
@@ -333,7 +378,7 @@ int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParam
 /** Update an old GenerateCoinbaseCommitment from CreateNewBlock after the block txs have changed */
 void RegenerateCommitments(CBlock& block, ChainstateManager& chainman);
 
-/** Apply -blockmintxfee and -blockmaxweight options from ArgsManager to BlockAssembler options. */
+/** Apply -blockmintxfee, -blockmaxweight and -blockclusters options from ArgsManager to BlockAssembler options. */
 void ApplyArgsManOptions(const ArgsManager& gArgs, BlockAssembler::Options& options);
 
 /** Check if staking is enabled */
@@ -0,0 +1,136 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/stakeestimator.h>
+
+#include <chain.h>
+#include <consensus/params.h>
+#include <rpc/blockchain.h>
+#include <util/metrics.h>
+#include <validation.h>
+
+std::unique_ptr<node::StakeEstimator> g_stake_estimator;
+
+namespace node {
+static double KernelsTried(const CBlockIndex* pindex)
+{
+    return GetDifficulty(pindex) * 4294967296.0;
+}
+
+void StakeEstimator::Reset(const CBlockIndex* tip)
+{
+    std::deque<Interval> window;
+    double kernels_sum{0};
+    int64_t time_sum{0};
+    const CBlockIndex* last_stake{nullptr};
+    const CBlockIndex* later_stake{nullptr};
+    for (const CBlockIndex* pindex = tip; pindex && window.size() < STAKE_WINDOW; pindex = pindex->pprev) {
+        if (!pindex->IsProofOfStake()) continue;
+        if (later_stake) {
+            Interval interval{KernelsTried(later_stake), (int64_t)later_stake->nTime - pindex->nTime};
+            window.push_front(interval);
+            kernels_sum += interval.kernels;
+            time_sum += interval.time;
+        } else {
+            last_stake = pindex;
+        }
+        later_stake = pindex;
+    }
+
+    LOCK(m_mutex);
+    m_tip = tip;
+    m_last_stake = last_stake;
+    m_window = std::move(window);
+    m_kernels_sum = kernels_sum;
+    m_time_sum = time_sum;
+    g_metrics.network_stake_weight.Set((int64_t)NetworkWeightLocked());
+}
+
+void StakeEstimator::Connect(const CBlockIndex* pindex)
+{
+    {
+        LOCK(m_mutex);
+        if (m_tip && pindex->pprev == m_tip) {
+            m_tip = pindex;
+            if (pindex->IsProofOfStake()) {
+                if (m_last_stake) {
+                    Push({KernelsTried(pindex), (int64_t)pindex->nTime - m_last_stake->nTime});
+                }
+                m_last_stake = pindex;
+            }
+            g_metrics.network_stake_weight.Set((int64_t)NetworkWeightLocked());
+            return;
+        }
+    }
+    Reset(pindex);
+}
+
+void StakeEstimator::Push(const Interval& interval)
+{
+    m_window.push_back(interval);
+    m_kernels_sum += interval.kernels;
+    m_time_sum += interval.time;
+    if (m_window.size() > STAKE_WINDOW) {
+        m_kernels_sum -= m_window.front().kernels;
+        m_time_sum -= m_window.front().time;
+        m_window.pop_front();
+    }
+    // The floating point sum drifts as intervals come and go, recompute it once per window
+    if (++m_pushes % STAKE_WINDOW == 0) {
+        m_kernels_sum = 0;
+        for (const Interval& i : m_window) m_kernels_sum += i.kernels;
+    }
+}
+
+bool StakeEstimator::Ready() const
+{
+    LOCK(m_mutex);
+    return m_tip != nullptr;
+}
+
+double StakeEstimator::NetworkWeightLocked() const
+{
+    if (!m_tip) return 0;
+    const int height = m_tip->nHeight;
+    const bool dynamic_stake_spacing = height < m_params.QIP9Height;
+    // Using a fixed denominator reduces the variation spikes
+    const int64_t time = dynamic_stake_spacing ? m_time_sum : m_params.TargetSpacing(height) * (int64_t)m_window.size();
+    if (time == 0) return 0;
+    return m_kernels_sum / time * (m_params.StakeTimestampMask(height) + 1);
+}
+
+double StakeEstimator::NetworkWeight() const
+{
+    LOCK(m_mutex);
+    return NetworkWeightLocked();
+}
+
+double StakeEstimator::AnnualROI() const
+{
+    LOCK(m_mutex);
+    const double network_weight = NetworkWeightLocked();
+    if (network_weight <= 0) return 0;
+    const int height = m_tip->nHeight;
+    const double subsidy = GetBlockSubsidy(height, m_params);
+    // Formula: 100 * 675 blocks/day * 365 days * subsidy) / Network Weight
+    return m_params.BlocktimeDownscaleFactor(height) * 24637500 * subsidy / network_weight;
+}
+
+uint64_t StakeEstimator::ExpectedTime(uint64_t weight) const
+{
+    LOCK(m_mutex);
+    if (!m_tip || weight == 0) return 0;
+    return m_params.TargetSpacing(m_tip->nHeight) * (uint64_t)NetworkWeightLocked() / weight;
+}
+
+void StakeEstimator::BlockConnected(const std::shared_ptr<const CBlock>&, const CBlockIndex* pindex)
+{
+    Connect(pindex);
+}
+
+void StakeEstimator::BlockDisconnected(const std::shared_ptr<const CBlock>&, const CBlockIndex* pindex)
+{
+    Reset(pindex->pprev);
+}
+} // namespace node
@@ -0,0 +1,76 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QTUM_NODE_STAKEESTIMATOR_H
+#define QTUM_NODE_STAKEESTIMATOR_H
+
+#include <sync.h>
+#include <validationinterface.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+class CBlockIndex;
+namespace Consensus {
+struct Params;
+} // namespace Consensus
+
+namespace node {
+/**
+ * Network stake weight, expected time to stake and annual ROI of the active chain, estimated from
+ * the last STAKE_WINDOW intervals between proof-of-stake blocks. The window slides by one block for
+ * each connected block, so reading the estimates does not walk the block index.
+ */
+class StakeEstimator final : public CValidationInterface
+{
+public:
+    static constexpr size_t STAKE_WINDOW{72};
+
+    explicit StakeEstimator(const Consensus::Params& params) : m_params(params) {}
+
+    /** Rebuild the window from the blocks before @p tip */
+    void Reset(const CBlockIndex* tip) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Slide the window to @p pindex, the window is rebuilt if it does not extend the current tip */
+    void Connect(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Whether the window has been built from a tip */
+    bool Ready() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Estimated network stake weight, in satoshis */
+    double NetworkWeight() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Estimated annual ROI in percent */
+    double AnnualROI() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Expected seconds to stake a block with @p weight, 0 without weight */
+    uint64_t ExpectedTime(uint64_t weight) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+protected:
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex) override;
+
+private:
+    struct Interval {
+        //! Kernels tried for the later stake of the interval
+        double kernels;
+        //! Seconds between the two stakes
+        int64_t time;
+    };
+
+    void Push(const Interval& interval) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    double NetworkWeightLocked() const EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    const Consensus::Params& m_params;
+    mutable Mutex m_mutex;
+    const CBlockIndex* m_tip GUARDED_BY(m_mutex){nullptr};
+    const CBlockIndex* m_last_stake GUARDED_BY(m_mutex){nullptr};
+    //! Intervals between the stakes, the latest at the back
+    std::deque<Interval> m_window GUARDED_BY(m_mutex);
+    double m_kernels_sum GUARDED_BY(m_mutex){0};
+    int64_t m_time_sum GUARDED_BY(m_mutex){0};
+    uint64_t m_pushes GUARDED_BY(m_mutex){0};
+};
+} // namespace node
+
+extern std::unique_ptr<node::StakeEstimator> g_stake_estimator;
+
+#endif // QTUM_NODE_STAKEESTIMATOR_H
@@ -0,0 +1,235 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txclusters.h>
+
+#include <hash.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+namespace node {
+
+//! The linearizations of the clusters of the last GetTxClusters call, as positions in the cluster sorted by wtxid
+static GlobalMutex g_linearizations_mutex;
+static std::map<uint256, std::vector<uint32_t>> g_linearizations GUARDED_BY(g_linearizations_mutex);
+
+static bool HigherFeerate(CAmount a_fee, uint64_t a_size, CAmount b_fee, uint64_t b_size)
+{
+    return (double)a_fee * b_size > (double)b_fee * a_size;
+}
+
+/** Whether the package of @p a_fee and @p a_size ending with @p a is mined before the one ending with @p b */
+static bool PackageMinedBefore(CTxMemPool::txiter a, CAmount a_fee, uint64_t a_size, CTxMemPool::txiter b, CAmount b_fee, uint64_t b_size)
+{
+    const int a_op = a->GetTx().GetCreateOrCall();
+    const int b_op = b->GetTx().GetCreateOrCall();
+    if (a_op || b_op) {
+        // Non-contract txs first, then contract creates before contract calls
+        if ((a_op > CTransaction::OpNone) != (b_op > CTransaction::OpNone)) {
+            return a_op == CTransaction::OpNone;
+        }
+        if (a_op != b_op && (a_op == CTransaction::OpCall || b_op == CTransaction::OpCall)) {
+            return a_op != CTransaction::OpCall;
+        }
+        // Then the contract txs without ancestors left, by gas price and size
+        const bool a_alone = a_size == a->GetTxSize();
+        const bool b_alone = b_size == b->GetTxSize();
+        if (a_alone != b_alone) {
+            return a_alone;
+        }
+        if (a->GetMinGasPrice() != b->GetMinGasPrice()) {
+            return a->GetMinGasPrice() > b->GetMinGasPrice();
+        }
+        if (a->GetTxSize() != b->GetTxSize()) {
+            return a->GetTxSize() < b->GetTxSize();
+        }
+        return CompareIteratorByHash()(a, b);
+    }
+    if (HigherFeerate(a_fee, a_size, b_fee, b_size)) return true;
+    if (HigherFeerate(b_fee, b_size, a_fee, a_size)) return false;
+    return CompareIteratorByHash()(a, b);
+}
+
+bool ChunkMinedBefore(const TxChunk& a, const TxChunk& b)
+{
+    return PackageMinedBefore(a.txs.back(), a.fee, a.size, b.txs.back(), b.fee, b.size);
+}
+
+std::vector<CTxMemPool::txiter> LinearizeCluster(const CTxMemPool& mempool, const std::vector<CTxMemPool::txiter>& cluster)
+{
+    AssertLockHeld(mempool.cs);
+
+    const size_t count = cluster.size();
+    std::map<CTxMemPool::txiter, size_t, CompareIteratorByHash> positions;
+    for (size_t i = 0; i < count; ++i) {
+        positions.emplace(cluster[i], i);
+    }
+    std::vector<std::vector<size_t>> parents(count), children(count);
+    for (size_t i = 0; i < count; ++i) {
+        for (const CTxMemPoolEntry& parent : cluster[i]->GetMemPoolParentsConst()) {
+            const auto it = positions.find(mempool.mapTx.iterator_to(parent));
+            if (it == positions.end()) continue;
+            parents[i].push_back(it->second);
+            children[it->second].push_back(i);
+        }
+    }
+
+    std::vector<bool> done(count, false);
+    std::vector<uint64_t> marks(count, 0);
+    uint64_t mark = 0;
+    // The transactions reached from @p start through @p links, not walking through the linearized ones if @p skip_done
+    const auto walk = [&](size_t start, const std::vector<std::vector<size_t>>& links, bool skip_done) {
+        std::vector<size_t> reached{start};
+        marks[start] = ++mark;
+        for (size_t i = 0; i < reached.size(); ++i) {
+            for (size_t next : links[reached[i]]) {
+                if (marks[next] == mark || (skip_done && done[next])) continue;
+                marks[next] = mark;
+                reached.push_back(next);
+            }
+        }
+        return reached;
+    };
+
+    // The fee and size of every transaction with its ancestors that are not linearized yet
+    std::vector<CAmount> fees(count);
+    std::vector<uint64_t> sizes(count);
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t ancestor : walk(i, parents, /*skip_done=*/false)) {
+            fees[i] += cluster[ancestor]->GetModifiedFee();
+            sizes[i] += cluster[ancestor]->GetTxSize();
+        }
+    }
+
+    const auto mined_before = [&](size_t a, size_t b) {
+        return PackageMinedBefore(cluster[a], fees[a], sizes[a], cluster[b], fees[b], sizes[b]);
+    };
+    std::set<size_t, decltype(mined_before)> candidates(mined_before);
+    for (size_t i = 0; i < count; ++i) {
+        candidates.insert(i);
+    }
+
+    std::vector<CTxMemPool::txiter> linearization;
+    linearization.reserve(count);
+    while (!candidates.empty()) {
+        // The best candidate goes with its ancestors, sorted by ancestor count so that parents come first
+        std::vector<size_t> package = walk(*candidates.begin(), parents, /*skip_done=*/true);
+        std::sort(package.begin(), package.end(), [&](size_t a, size_t b) {
+            if (cluster[a]->GetCountWithAncestors() != cluster[b]->GetCountWithAncestors()) {
+                return cluster[a]->GetCountWithAncestors() < cluster[b]->GetCountWithAncestors();
+            }
+            return CompareIteratorByHash()(cluster[a], cluster[b]);
+        });
+        for (size_t i : package) {
+            candidates.erase(i);
+            done[i] = true;
+            linearization.push_back(cluster[i]);
+        }
+        // The packages of the descendants left no longer include it
+        for (size_t i : package) {
+            for (size_t descendant : walk(i, children, /*skip_done=*/false)) {
+                if (done[descendant]) continue;
+                candidates.erase(descendant);
+                fees[descendant] -= cluster[i]->GetModifiedFee();
+                sizes[descendant] -= cluster[i]->GetTxSize();
+                candidates.insert(descendant);
+            }
+        }
+    }
+    return linearization;
+}
+
+std::vector<TxChunk> ChunkLinearization(const std::vector<CTxMemPool::txiter>& linearization)
+{
+    std::vector<TxChunk> chunks;
+    for (CTxMemPool::txiter it : linearization) {
+        TxChunk chunk;
+        chunk.txs.push_back(it);
+        chunk.fee = it->GetModifiedFee();
+        chunk.size = it->GetTxSize();
+        chunk.sigops = it->GetSigOpCost();
+        chunk.gas_limit = it->GetGasLimit();
+        // A transaction with a higher feerate than the chunk before is mined with it
+        while (!chunks.empty() && HigherFeerate(chunk.fee, chunk.size, chunks.back().fee, chunks.back().size)) {
+            TxChunk& previous = chunks.back();
+            previous.txs.insert(previous.txs.end(), chunk.txs.begin(), chunk.txs.end());
+            previous.fee += chunk.fee;
+            previous.size += chunk.size;
+            previous.sigops += chunk.sigops;
+            previous.gas_limit += chunk.gas_limit;
+            chunk = std::move(previous);
+            chunks.pop_back();
+        }
+        chunks.push_back(std::move(chunk));
+    }
+    return chunks;
+}
+
+std::vector<std::vector<TxChunk>> GetTxClusters(const CTxMemPool& mempool, const CTxMemPool::setEntries& excluded)
+{
+    AssertLockHeld(mempool.cs);
+
+    LOCK(g_linearizations_mutex);
+    std::map<uint256, std::vector<uint32_t>> linearizations;
+    std::vector<std::vector<TxChunk>> clusters;
+    CTxMemPool::setEntries visited;
+    for (CTxMemPool::txiter start = mempool.mapTx.begin(); start != mempool.mapTx.end(); ++start) {
+        if (excluded.count(start) || !visited.insert(start).second) continue;
+
+        std::vector<CTxMemPool::txiter> cluster{start};
+        const auto add = [&](const CTxMemPoolEntry& entry) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs) {
+            const CTxMemPool::txiter it = mempool.mapTx.iterator_to(entry);
+            if (!excluded.count(it) && visited.insert(it).second) {
+                cluster.push_back(it);
+            }
+        };
+        for (size_t i = 0; i < cluster.size(); ++i) {
+            for (const CTxMemPoolEntry& parent : cluster[i]->GetMemPoolParentsConst()) add(parent);
+            for (const CTxMemPoolEntry& child : cluster[i]->GetMemPoolChildrenConst()) add(child);
+        }
+        if (cluster.size() == 1) {
+            clusters.push_back(ChunkLinearization(cluster));
+            continue;
+        }
+
+        // A cluster is linearized again only when its transactions or their fees changed
+        std::sort(cluster.begin(), cluster.end(), [](CTxMemPool::txiter a, CTxMemPool::txiter b) {
+            return a->GetTx().GetWitnessHash() < b->GetTx().GetWitnessHash();
+        });
+        HashWriter hasher{};
+        for (CTxMemPool::txiter it : cluster) {
+            hasher << it->GetTx().GetWitnessHash() << it->GetModifiedFee();
+        }
+        const uint256 key = hasher.GetHash();
+
+        std::vector<CTxMemPool::txiter> linearization;
+        std::vector<uint32_t> order;
+        const auto cached = g_linearizations.find(key);
+        if (cached != g_linearizations.end()) {
+            order = cached->second;
+            for (uint32_t pos : order) {
+                linearization.push_back(cluster[pos]);
+            }
+        } else {
+            linearization = LinearizeCluster(mempool, cluster);
+            std::map<CTxMemPool::txiter, uint32_t, CompareIteratorByHash> positions;
+            for (uint32_t pos = 0; pos < cluster.size(); ++pos) {
+                positions.emplace(cluster[pos], pos);
+            }
+            for (CTxMemPool::txiter it : linearization) {
+                order.push_back(positions.at(it));
+            }
+        }
+        linearizations.emplace(key, std::move(order));
+        clusters.push_back(ChunkLinearization(linearization));
+    }
+    g_linearizations = std::move(linearizations);
+    return clusters;
+}
+
+} // namespace node
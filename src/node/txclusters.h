@@ -0,0 +1,52 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_TXCLUSTERS_H
+#define BITCOIN_NODE_TXCLUSTERS_H
+
+#include <consensus/amount.h>
+#include <sync.h>
+#include <txmempool.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace node {
+
+/** Transactions of a cluster linearization that are best mined together, in a valid block order */
+struct TxChunk {
+    std::vector<CTxMemPool::txiter> txs;
+    CAmount fee{0};
+    uint64_t size{0};
+    int64_t sigops{0};
+    uint64_t gas_limit{0};
+};
+
+/**
+ * Whether chunk @p a is mined before chunk @p b. Chunks are ordered by their last transaction like
+ * CompareTxMemPoolEntryByAncestorFeeOrGasPrice orders ancestor packages: the chunks that end with a
+ * contract tx come after the others and are ordered by gas price, the others by feerate.
+ */
+bool ChunkMinedBefore(const TxChunk& a, const TxChunk& b);
+
+/**
+ * Order the transactions of a cluster, the connected mempool transactions in @p cluster, for block
+ * inclusion. The ancestors of the transaction whose package is the best candidate are taken first,
+ * as the ancestor package selection of the miner does within the cluster.
+ */
+std::vector<CTxMemPool::txiter> LinearizeCluster(const CTxMemPool& mempool, const std::vector<CTxMemPool::txiter>& cluster) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
+
+/** Split a linearization into chunks of non-increasing feerate */
+std::vector<TxChunk> ChunkLinearization(const std::vector<CTxMemPool::txiter>& linearization);
+
+/**
+ * Group the mempool transactions, except those in @p excluded, into clusters of transactions
+ * connected by their spends, and return the chunks of every cluster. The linearizations are kept
+ * until the next call, which reuses those of the clusters whose transactions and fees did not change.
+ */
+std::vector<std::vector<TxChunk>> GetTxClusters(const CTxMemPool& mempool, const CTxMemPool::setEntries& excluded) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
+
+} // namespace node
+
+#endif // BITCOIN_NODE_TXCLUSTERS_H
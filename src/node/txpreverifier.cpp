@@ -0,0 +1,111 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txpreverifier.h>
+
+#include <coins.h>
+#include <consensus/tx_check.h>
+#include <consensus/validation.h>
+#include <logging.h>
+#include <policy/policy.h>
+#include <script/interpreter.h>
+#include <tinyformat.h>
+#include <txmempool.h>
+#include <util/thread.h>
+#include <validation.h>
+
+#include <exception>
+#include <optional>
+
+TxPreverifier::TxPreverifier(ChainstateManager& chainman, CTxMemPool& mempool, int threads_num)
+    : m_chainstate(chainman.ActiveChainstate()), m_mempool(mempool)
+{
+    for (int n = 0; n < threads_num; ++n) {
+        m_threads.emplace_back([this, n]() {
+            util::TraceThread(strprintf("txverify.%i", n), [this] { ThreadVerify(); });
+        });
+    }
+}
+
+TxPreverifier::~TxPreverifier()
+{
+    WITH_LOCK(m_mutex, m_stop = true);
+    m_cv.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void TxPreverifier::Submit(const CDataStream& tx_data)
+{
+    {
+        LOCK(m_mutex);
+        if (m_queue.size() >= MAX_TXPREVERIFY_QUEUE) {
+            ++m_dropped;
+            return;
+        }
+        m_queue.push_back(tx_data);
+    }
+    m_cv.notify_one();
+}
+
+void TxPreverifier::ThreadVerify()
+{
+    while (true) {
+        std::optional<CDataStream> tx_data;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_queue.empty(); });
+            if (m_stop) return;
+            tx_data.emplace(std::move(m_queue.front()));
+            m_queue.pop_front();
+        }
+
+        // Malformed messages are dealt with, and their peer punished, by the message handler
+        CTransactionRef tx;
+        try {
+            *tx_data >> tx;
+        } catch (const std::exception&) {
+            continue;
+        }
+        if (Verify(*tx)) ++m_verified;
+    }
+}
+
+bool TxPreverifier::Verify(const CTransaction& tx)
+{
+    TxValidationState state;
+    if (tx.IsCoinBase() || tx.IsCoinStake() || !CheckTransaction(tx, state)) return false;
+    if (m_mempool.exists(GenTxid::Wtxid(tx.GetWitnessHash()))) return false;
+
+    // The inputs come from the mempool or from the coins cache, neither needs cs_main
+    std::vector<CTxOut> spent_outputs;
+    spent_outputs.reserve(tx.vin.size());
+    for (const CTxIn& txin : tx.vin) {
+        if (CTransactionRef parent = m_mempool.get(txin.prevout.hash)) {
+            if (txin.prevout.n >= parent->vout.size()) return false;
+            spent_outputs.push_back(parent->vout[txin.prevout.n]);
+            continue;
+        }
+        Coin coin;
+        uint256 best_block;
+        if (!m_chainstate.GetCoinConcurrent(txin.prevout, coin, best_block) || coin.IsSpent()) return false;
+        spent_outputs.push_back(coin.out);
+    }
+
+    // Checked like PolicyScriptChecks does, storing the verified signatures in the signature cache
+    PrecomputedTransactionData txdata;
+    txdata.Init(tx, std::move(spent_outputs));
+    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+        CScriptCheck check(txdata.m_spent_outputs[i], tx, i, STANDARD_SCRIPT_VERIFY_FLAGS, /*cacheIn=*/true, &txdata);
+        if (!check()) return false;
+    }
+    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+        if (tx.vout[i].scriptPubKey.HasOpSender()) {
+            CScriptCheck check(tx, i, 0, /*cacheIn=*/true, &txdata);
+            if (!check()) return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_TXPREVERIFIER_H
+#define BITCOIN_NODE_TXPREVERIFIER_H
+
+#include <primitives/transaction.h>
+#include <streams.h>
+#include <sync.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <thread>
+#include <vector>
+
+class Chainstate;
+class ChainstateManager;
+class CTxMemPool;
+
+/** -parmempool default, the number of threads verifying relayed transactions ahead of mempool acceptance */
+static constexpr int DEFAULT_TXPREVERIFY_THREADS{0};
+/** Maximum number of threads verifying relayed transactions ahead of mempool acceptance */
+static constexpr int MAX_TXPREVERIFY_THREADS{15};
+/** Maximum number of received transactions waiting to be verified, the ones above are left to the mempool */
+static constexpr size_t MAX_TXPREVERIFY_QUEUE{1000};
+
+/**
+ * Verifies the scripts of the transactions received from peers on a pool of worker threads, as
+ * soon as the socket thread has received them and ahead of the message handler thread.
+ *
+ * The signatures that verify are stored in the signature cache, so the script checks that
+ * AcceptToMemoryPool later runs under cs_main and the mempool lock are cache hits. The inputs are
+ * read from the mempool and from the coins cache without cs_main. Nothing is decided here: a
+ * transaction that fails, or whose inputs are not found, is left to AcceptToMemoryPool as before.
+ */
+class TxPreverifier
+{
+public:
+    TxPreverifier(ChainstateManager& chainman, CTxMemPool& mempool, int threads_num);
+    ~TxPreverifier();
+
+    /** Queue the payload of a tx message for the workers. Does nothing when the queue is full. */
+    void Submit(const CDataStream& tx_data) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Verify the scripts of @p tx on the calling thread. Returns whether all of them verified. */
+    bool Verify(const CTransaction& tx);
+
+    uint64_t GetVerified() const { return m_verified; }
+    uint64_t GetDropped() const { return m_dropped; }
+
+private:
+    /** The chainstate active at startup, its coins are only used to warm the signature cache */
+    Chainstate& m_chainstate;
+    CTxMemPool& m_mempool;
+
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<CDataStream> m_queue GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    std::atomic<uint64_t> m_verified{0};
+    std::atomic<uint64_t> m_dropped{0};
+
+    void ThreadVerify() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+
+#endif // BITCOIN_NODE_TXPREVERIFIER_H
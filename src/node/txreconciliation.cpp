@@ -4,9 +4,15 @@
 
 #include <node/txreconciliation.h>
 
+#include <crypto/siphash.h>
+#include <node/minisketchwrapper.h>
 #include <util/check.h>
 #include <util/system.h>
 
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <set>
 #include <unordered_map>
 #include <variant>
 
@@ -28,6 +34,18 @@ uint256 ComputeSalt(uint64_t salt1, uint64_t salt2)
     return (HashWriter(RECON_SALT_HASHER) << std::min(salt1, salt2) << std::max(salt1, salt2)).GetSHA256();
 }
 
+/**
+ * Estimate the capacity of the sketch needed to find the difference between two sets of the
+ * given sizes, see BIP-330.
+ */
+uint32_t EstimateSketchCapacity(size_t local_set_size, size_t remote_set_size, double q)
+{
+    const size_t set_size_diff{local_set_size > remote_set_size ? local_set_size - remote_set_size : remote_set_size - local_set_size};
+    const size_t min_size{std::min(local_set_size, remote_set_size)};
+    const size_t capacity{set_size_diff + static_cast<size_t>(q * min_size) + 1};
+    return std::min<size_t>(capacity, MAX_SKETCH_CAPACITY);
+}
+
 /**
  * Keeps track of txreconciliation-related per-peer state.
  */
@@ -35,9 +53,6 @@ class TxReconciliationState
 {
 public:
     /**
-     * TODO: This field is public to ignore -Wunused-private-field. Make private once used in
-     * the following commits.
-     *
      * Reconciliation protocol assumes using one role consistently: either a reconciliation
      * initiator (requesting sketches), or responder (sending sketches). This defines our role,
      * based on the direction of the p2p connection.
@@ -46,14 +61,50 @@ public:
     bool m_we_initiate;
 
     /**
-     * TODO: These fields are public to ignore -Wunused-private-field. Make private once used in
-     * the following commits.
-     *
      * These values are used to salt short IDs, which is necessary for transaction reconciliations.
      */
     uint64_t m_k0, m_k1;
 
+    /** The transactions to reconcile with the peer (wtxids). */
+    std::set<uint256> m_local_set;
+
+    /** Initiator: whether we requested a sketch that the peer did not send yet. */
+    bool m_sketch_requested{false};
+
+    /** Initiator: when to request the next reconciliation. */
+    std::chrono::microseconds m_next_request{0};
+
+    /** Responder: our set when we sent a sketch of it, until the peer sends the difference. */
+    std::optional<std::set<uint256>> m_sketched_set;
+
     TxReconciliationState(bool we_initiate, uint64_t k0, uint64_t k1) : m_we_initiate(we_initiate), m_k0(k0), m_k1(k1) {}
+
+    /** Short id of a transaction, see BIP-330. Never 0, which minisketch does not accept. */
+    uint32_t ComputeShortID(const uint256& wtxid) const
+    {
+        const uint64_t s{SipHashUint256(m_k0, m_k1, wtxid)};
+        return 1 + (s % 0xFFFFFFFF);
+    }
+
+    /** Sketch the short ids of a set of transactions. */
+    Minisketch ComputeSketch(const std::set<uint256>& set, uint32_t capacity) const
+    {
+        Minisketch sketch{node::MakeMinisketch32(capacity)};
+        for (const uint256& wtxid : set) {
+            sketch.Add(ComputeShortID(wtxid));
+        }
+        return sketch;
+    }
+
+    /** Index a set of transactions by short id. */
+    std::map<uint32_t, uint256> ShortIDs(const std::set<uint256>& set) const
+    {
+        std::map<uint32_t, uint256> short_ids;
+        for (const uint256& wtxid : set) {
+            short_ids.emplace(ComputeShortID(wtxid), wtxid);
+        }
+        return short_ids;
+    }
 };
 
 } // namespace
@@ -141,6 +192,150 @@ public:
         return (recon_state != m_states.end() &&
                 std::holds_alternative<TxReconciliationState>(recon_state->second));
     }
+
+    bool AddToSet(NodeId peer_id, const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        TxReconciliationState* state{GetRegisteredState(peer_id)};
+        if (!state) return false;
+        if (state->m_local_set.size() >= MAX_RECONSET_SIZE) {
+            LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Reconciliation set of peer=%d is full, flooding %s\n",
+                          peer_id, wtxid.ToString());
+            return false;
+        }
+        state->m_local_set.insert(wtxid);
+        return true;
+    }
+
+    bool TryRemovingFromSet(NodeId peer_id, const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        TxReconciliationState* state{GetRegisteredState(peer_id)};
+        return state && state->m_local_set.erase(wtxid) > 0;
+    }
+
+    bool ShouldFanoutTo(NodeId peer_id, const uint256& wtxid) const EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        auto recon_state = m_states.find(peer_id);
+        if (recon_state == m_states.end()) return false;
+        const auto* state{std::get_if<TxReconciliationState>(&recon_state->second)};
+        if (!state || !state->m_we_initiate) return false;
+        // Use the bits of the salted hash that the short id does not use
+        return (SipHashUint256(state->m_k0, state->m_k1, wtxid) >> 32) % OUTBOUND_FANOUT_DIVISOR == 0;
+    }
+
+    std::optional<std::pair<uint16_t, uint16_t>> MaybeRequestReconciliation(NodeId peer_id, std::chrono::microseconds now)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        TxReconciliationState* state{GetRegisteredState(peer_id)};
+        if (!state || !state->m_we_initiate || state->m_sketch_requested) return std::nullopt;
+        if (state->m_next_request > now) return std::nullopt;
+
+        state->m_sketch_requested = true;
+        state->m_next_request = now + RECON_REQUEST_INTERVAL;
+        const uint16_t set_size{static_cast<uint16_t>(std::min<size_t>(state->m_local_set.size(), std::numeric_limits<uint16_t>::max()))};
+        LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Request reconciliation from peer=%d with %u transactions\n",
+                      peer_id, set_size);
+        return std::make_pair(set_size, static_cast<uint16_t>(RECON_Q * Q_PRECISION));
+    }
+
+    std::optional<std::vector<uint8_t>> HandleReconciliationRequest(NodeId peer_id, uint16_t peer_set_size, uint16_t peer_q)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        TxReconciliationState* state{GetRegisteredState(peer_id)};
+        if (!state || state->m_we_initiate || state->m_sketched_set) return std::nullopt;
+
+        const double q{double(peer_q) / Q_PRECISION};
+        const uint32_t capacity{EstimateSketchCapacity(state->m_local_set.size(), peer_set_size, q)};
+        std::vector<uint8_t> skdata{state->ComputeSketch(state->m_local_set, capacity).Serialize()};
+        LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Send sketch of %u transactions (capacity %u) to peer=%d\n",
+                      state->m_local_set.size(), capacity, peer_id);
+
+        // New transactions go in a fresh set while this one is reconciled
+        state->m_sketched_set = std::move(state->m_local_set);
+        state->m_local_set.clear();
+        return skdata;
+    }
+
+    std::optional<ReconciliationResult> HandleSketch(NodeId peer_id, Span<const uint8_t> skdata) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        TxReconciliationState* state{GetRegisteredState(peer_id)};
+        if (!state || !state->m_we_initiate || !state->m_sketch_requested) return std::nullopt;
+        if (skdata.size() % BYTES_PER_SKETCH_CAPACITY != 0) return std::nullopt;
+        const uint32_t capacity(skdata.size() / BYTES_PER_SKETCH_CAPACITY);
+        if (capacity > MAX_SKETCH_CAPACITY) return std::nullopt;
+
+        state->m_sketch_requested = false;
+        ReconciliationResult result;
+        std::optional<std::vector<uint64_t>> differences;
+        if (capacity > 0) {
+            Minisketch remote_sketch{node::MakeMinisketch32(capacity)};
+            remote_sketch.Deserialize(skdata);
+            differences = state->ComputeSketch(state->m_local_set, capacity).Merge(remote_sketch).Decode(capacity);
+        }
+
+        if (differences) {
+            result.m_success = true;
+            const std::map<uint32_t, uint256> local_short_ids{state->ShortIDs(state->m_local_set)};
+            for (const uint64_t difference : *differences) {
+                const auto local = local_short_ids.find(difference);
+                if (local != local_short_ids.end()) {
+                    result.m_announce_wtxids.push_back(local->second);
+                } else {
+                    result.m_ask_short_ids.push_back(static_cast<uint32_t>(difference));
+                }
+            }
+        } else {
+            // Without the difference, fall back to announcing the whole set
+            result.m_announce_wtxids.assign(state->m_local_set.begin(), state->m_local_set.end());
+        }
+        LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug,
+                      "Reconciliation with peer=%d %s: %u transactions to request, %u to announce out of %u\n",
+                      peer_id, result.m_success ? "succeeded" : "failed", result.m_ask_short_ids.size(),
+                      result.m_announce_wtxids.size(), state->m_local_set.size());
+        state->m_local_set.clear();
+        return result;
+    }
+
+    std::optional<std::vector<uint256>> HandleReconciliationDifference(NodeId peer_id, bool success, const std::vector<uint32_t>& ask_short_ids)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        TxReconciliationState* state{GetRegisteredState(peer_id)};
+        if (!state || state->m_we_initiate || !state->m_sketched_set) return std::nullopt;
+
+        std::vector<uint256> announce;
+        if (success) {
+            const std::map<uint32_t, uint256> sketched_short_ids{state->ShortIDs(*state->m_sketched_set)};
+            for (const uint32_t short_id : ask_short_ids) {
+                const auto it = sketched_short_ids.find(short_id);
+                if (it != sketched_short_ids.end()) announce.push_back(it->second);
+            }
+        } else {
+            announce.assign(state->m_sketched_set->begin(), state->m_sketched_set->end());
+        }
+        state->m_sketched_set.reset();
+        return announce;
+    }
+
+private:
+    TxReconciliationState* GetRegisteredState(NodeId peer_id) EXCLUSIVE_LOCKS_REQUIRED(m_txreconciliation_mutex)
+    {
+        auto recon_state = m_states.find(peer_id);
+        if (recon_state == m_states.end()) return nullptr;
+        return std::get_if<TxReconciliationState>(&recon_state->second);
+    }
 };
 
 TxReconciliationTracker::TxReconciliationTracker(uint32_t recon_version) : m_impl{std::make_unique<TxReconciliationTracker::Impl>(recon_version)} {}
@@ -167,3 +362,39 @@ bool TxReconciliationTracker::IsPeerRegistered(NodeId peer_id) const
 {
     return m_impl->IsPeerRegistered(peer_id);
 }
+
+bool TxReconciliationTracker::AddToSet(NodeId peer_id, const uint256& wtxid)
+{
+    return m_impl->AddToSet(peer_id, wtxid);
+}
+
+bool TxReconciliationTracker::TryRemovingFromSet(NodeId peer_id, const uint256& wtxid)
+{
+    return m_impl->TryRemovingFromSet(peer_id, wtxid);
+}
+
+bool TxReconciliationTracker::ShouldFanoutTo(NodeId peer_id, const uint256& wtxid) const
+{
+    return m_impl->ShouldFanoutTo(peer_id, wtxid);
+}
+
+std::optional<std::pair<uint16_t, uint16_t>> TxReconciliationTracker::MaybeRequestReconciliation(NodeId peer_id, std::chrono::microseconds now)
+{
+    return m_impl->MaybeRequestReconciliation(peer_id, now);
+}
+
+std::optional<std::vector<uint8_t>> TxReconciliationTracker::HandleReconciliationRequest(NodeId peer_id, uint16_t peer_set_size, uint16_t peer_q)
+{
+    return m_impl->HandleReconciliationRequest(peer_id, peer_set_size, peer_q);
+}
+
+std::optional<ReconciliationResult> TxReconciliationTracker::HandleSketch(NodeId peer_id, Span<const uint8_t> skdata)
+{
+    return m_impl->HandleSketch(peer_id, skdata);
+}
+
+std::optional<std::vector<uint256>> TxReconciliationTracker::HandleReconciliationDifference(NodeId peer_id, bool success,
+                                                                                           const std::vector<uint32_t>& ask_short_ids)
+{
+    return m_impl->HandleReconciliationDifference(peer_id, success, ask_short_ids);
+}
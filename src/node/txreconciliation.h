@@ -6,15 +6,37 @@
 #define BITCOIN_NODE_TXRECONCILIATION_H
 
 #include <net.h>
+#include <span.h>
 #include <sync.h>
+#include <uint256.h>
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <tuple>
+#include <vector>
 
 /** Whether transaction reconciliation protocol should be enabled by default. */
 static constexpr bool DEFAULT_TXRECONCILIATION_ENABLE{false};
 /** Supported transaction reconciliation protocol version */
 static constexpr uint32_t TXRECONCILIATION_VERSION{1};
+/** Maximum number of transactions in the set to reconcile with a peer. Once the set is full, the
+ *  transactions are flooded to the peer instead. */
+static constexpr size_t MAX_RECONSET_SIZE{3000};
+/** Interval between the reconciliations we initiate with every outbound peer. */
+static constexpr std::chrono::seconds RECON_REQUEST_INTERVAL{8};
+/** Coefficient used to estimate the set difference from the set sizes, see BIP-330. */
+static constexpr double RECON_Q{0.25};
+/** q is sent as an integer with this precision, see BIP-330. */
+static constexpr uint16_t Q_PRECISION{(2 << 14) - 1};
+/** Maximum capacity of a sketch, which bounds the cost of decoding it. */
+static constexpr uint32_t MAX_SKETCH_CAPACITY{2 << 12};
+/** Size of a sketch per element of capacity, short ids are 32 bits. */
+static constexpr uint32_t BYTES_PER_SKETCH_CAPACITY{4};
+/** A transaction is still flooded to one in this many outbound reconciling peers, so that it
+ *  propagates without waiting for the reconciliations. */
+static constexpr uint32_t OUTBOUND_FANOUT_DIVISOR{10};
 
 enum class ReconciliationRegisterResult {
     NOT_FOUND,
@@ -23,6 +45,16 @@ enum class ReconciliationRegisterResult {
     PROTOCOL_VIOLATION,
 };
 
+/** Outcome of a reconciliation on the initiator side, after receiving the sketch of the peer. */
+struct ReconciliationResult {
+    /** Whether the set difference could be decoded from the sketches */
+    bool m_success{false};
+    /** Short ids of the transactions only the peer has, to request in RECONCILDIFF */
+    std::vector<uint32_t> m_ask_short_ids;
+    /** The transactions only we have, to announce to the peer (all of our set on failure) */
+    std::vector<uint256> m_announce_wtxids;
+};
+
 /**
  * Transaction reconciliation is a way for nodes to efficiently announce transactions.
  * This object keeps track of all txreconciliation-related communications with the peers.
@@ -34,10 +66,8 @@ enum class ReconciliationRegisterResult {
  * 3.  Once the initiator received a sketch from the peer, the initiator computes a local sketch,
  *     and combines the two sketches to attempt finding the difference in *sets*.
  * 4a. If the difference was not larger than estimated, see SUCCESS below.
- * 4b. If the difference was larger than estimated, initial txreconciliation fails. The initiator
- *     requests a larger sketch via an extension round (allowed only once).
- *     - If extension succeeds (a larger sketch is sufficient), see SUCCESS below.
- *     - If extension fails (a larger sketch is insufficient), see FAILURE below.
+ * 4b. If the difference was larger than estimated, txreconciliation fails, see FAILURE below.
+ *     (BIP-330 allows one extension round with a larger sketch, which we do not request yet.)
  *
  * SUCCESS. The initiator knows full symmetrical difference and can request what the initiator is
  *          missing and announce to the peer what the peer is missing.
@@ -49,6 +79,8 @@ enum class ReconciliationRegisterResult {
  * This is a modification of the Erlay protocol (https://arxiv.org/abs/1905.10518) with two
  * changes (sketch extensions instead of bisections, and an extra INV exchange round), both
  * are motivated in BIP-330.
+ *
+ * We initiate reconciliations with our outbound peers and respond to our inbound peers.
  */
 class TxReconciliationTracker
 {
@@ -86,6 +118,52 @@ public:
      * Check if a peer is registered to reconcile transactions with us.
      */
     bool IsPeerRegistered(NodeId peer_id) const;
+
+    /**
+     * Step 1. Add a transaction to the set to reconcile with the peer, instead of announcing it.
+     * Returns false if the peer is not registered or its set is full, in which case the
+     * transaction is flooded to the peer.
+     */
+    bool AddToSet(NodeId peer_id, const uint256& wtxid);
+
+    /**
+     * Remove a transaction from the set to reconcile with the peer, eg because the peer announced
+     * it to us. Returns whether it was there.
+     */
+    bool TryRemovingFromSet(NodeId peer_id, const uint256& wtxid);
+
+    /**
+     * Whether to flood a transaction to a registered peer anyway. A transaction is flooded to a
+     * pseudo-random fraction of the outbound peers we reconcile with, and not to inbound ones.
+     */
+    bool ShouldFanoutTo(NodeId peer_id, const uint256& wtxid) const;
+
+    /**
+     * Step 2 (initiator). If it is time to reconcile with the peer, returns the size of our set
+     * and the q coefficient to send in REQRECON.
+     */
+    std::optional<std::pair<uint16_t, uint16_t>> MaybeRequestReconciliation(NodeId peer_id, std::chrono::microseconds now);
+
+    /**
+     * Step 2 (responder). Handle a REQRECON from the peer and return the sketch of our set to send
+     * in SKETCH. Our set is kept aside until the reconciliation ends. Returns nullopt if the
+     * request is not expected.
+     */
+    std::optional<std::vector<uint8_t>> HandleReconciliationRequest(NodeId peer_id, uint16_t peer_set_size, uint16_t peer_q);
+
+    /**
+     * Step 3 (initiator). Handle the SKETCH of the peer, combine it with our own and find the set
+     * difference. Our set is cleared. Returns nullopt if the sketch is not expected or invalid.
+     */
+    std::optional<ReconciliationResult> HandleSketch(NodeId peer_id, Span<const uint8_t> skdata);
+
+    /**
+     * Step 4 (responder). Handle the RECONCILDIFF of the peer, ending the reconciliation. Returns
+     * the transactions to announce: the ones the peer asked for, or our whole set on failure.
+     * Returns nullopt if the message is not expected.
+     */
+    std::optional<std::vector<uint256>> HandleReconciliationDifference(NodeId peer_id, bool success,
+                                                                        const std::vector<uint32_t>& ask_short_ids);
 };
 
 #endif // BITCOIN_NODE_TXRECONCILIATION_H
@@ -4,6 +4,7 @@
 
 #include <node/utxo_snapshot.h>
 
+#include <hash.h>
 #include <logging.h>
 #include <streams.h>
 #include <sync.h>
@@ -21,6 +22,129 @@
 
 namespace node {
 
+uint256 EncodeSnapshotChunk(const SnapshotCoins& coins, DataStream& chunk)
+{
+    // Coins are sorted by outpoint, so the outputs of a transaction follow each other
+    for (auto it = coins.begin(); it != coins.end();) {
+        const uint256 txid = it->first.hash;
+        const auto end = std::find_if(it, coins.end(), [&](const auto& entry) { return entry.first.hash != txid; });
+        chunk << txid;
+        WriteCompactSize(chunk, std::distance(it, end));
+        for (; it != end; ++it) {
+            chunk << VARINT(it->first.n) << it->second;
+        }
+    }
+    return Hash(chunk);
+}
+
+SnapshotCoins DecodeSnapshotChunk(const SnapshotChunkHeader& header, DataStream chunk)
+{
+    if (chunk.size() != header.m_size || Hash(chunk) != header.m_hash) {
+        throw std::ios_base::failure("Snapshot chunk does not match its hash");
+    }
+
+    SnapshotCoins coins;
+    coins.reserve(std::min(header.m_coins, SNAPSHOT_CHUNK_COINS));
+    while (!chunk.empty()) {
+        uint256 txid;
+        chunk >> txid;
+        const uint64_t outputs = ReadCompactSize(chunk);
+        if (outputs == 0 || outputs > header.m_coins - coins.size()) {
+            throw std::ios_base::failure("Snapshot chunk has more coins than its header");
+        }
+        for (uint64_t i = 0; i < outputs; ++i) {
+            uint32_t n;
+            Coin coin;
+            chunk >> VARINT(n) >> coin;
+            coins.emplace_back(COutPoint{txid, n}, std::move(coin));
+        }
+    }
+    if (coins.size() != header.m_coins) {
+        throw std::ios_base::failure("Snapshot chunk has fewer coins than its header");
+    }
+    return coins;
+}
+
+SnapshotChunkWriter::SnapshotChunkWriter(AutoFile& file, int threads) :
+    m_file{file}, m_max_in_flight{static_cast<size_t>(std::max(threads, 1))}
+{
+    m_coins.reserve(SNAPSHOT_CHUNK_COINS);
+}
+
+void SnapshotChunkWriter::Add(const COutPoint& outpoint, const Coin& coin)
+{
+    m_coins.emplace_back(outpoint, coin);
+    if (m_coins.size() >= SNAPSHOT_CHUNK_COINS) Flush();
+}
+
+void SnapshotChunkWriter::Flush()
+{
+    if (m_coins.empty()) return;
+    if (m_encoding.size() >= m_max_in_flight) WriteChunk();
+
+    m_encoding.push_back(std::async(std::launch::async, [coins = std::move(m_coins)] {
+        EncodedChunk chunk;
+        chunk.first.m_coins = coins.size();
+        chunk.first.m_hash = EncodeSnapshotChunk(coins, chunk.second);
+        chunk.first.m_size = chunk.second.size();
+        return chunk;
+    }));
+    m_coins = {};
+    m_coins.reserve(SNAPSHOT_CHUNK_COINS);
+}
+
+void SnapshotChunkWriter::WriteChunk()
+{
+    const EncodedChunk chunk = m_encoding.front().get();
+    m_encoding.pop_front();
+    m_file << chunk.first;
+    m_file.write(MakeByteSpan(chunk.second));
+}
+
+void SnapshotChunkWriter::Finish()
+{
+    Flush();
+    while (!m_encoding.empty()) WriteChunk();
+    m_file << SnapshotChunkHeader{};
+}
+
+SnapshotChunkReader::SnapshotChunkReader(AutoFile& file, int threads) :
+    m_file{file}, m_max_in_flight{static_cast<size_t>(std::max(threads, 1))}
+{
+}
+
+void SnapshotChunkReader::Fill()
+{
+    while (!m_end && m_decoding.size() < m_max_in_flight) {
+        SnapshotChunkHeader header;
+        m_file >> header;
+        if (header.m_coins == 0) {
+            if (header.m_size != 0) throw std::ios_base::failure("Snapshot end has data");
+            m_end = true;
+            break;
+        }
+        if (header.m_size > MAX_SNAPSHOT_CHUNK_SIZE) {
+            throw std::ios_base::failure("Snapshot chunk is too large");
+        }
+
+        DataStream chunk;
+        chunk.resize(header.m_size);
+        m_file.read(MakeWritableByteSpan(chunk));
+        m_decoding.push_back(std::async(std::launch::async, [header, chunk = std::move(chunk)]() mutable {
+            return DecodeSnapshotChunk(header, std::move(chunk));
+        }));
+    }
+}
+
+bool SnapshotChunkReader::Next(SnapshotCoins& coins)
+{
+    Fill();
+    if (m_decoding.empty()) return false;
+    coins = m_decoding.front().get();
+    m_decoding.pop_front();
+    return true;
+}
+
 bool WriteSnapshotBaseBlockhash(Chainstate& snapshot_chainstate)
 {
     AssertLockHeld(::cs_main);
@@ -6,19 +6,43 @@
 #ifndef BITCOIN_NODE_UTXO_SNAPSHOT_H
 #define BITCOIN_NODE_UTXO_SNAPSHOT_H
 
+#include <coins.h>
 #include <kernel/cs_main.h>
+#include <primitives/transaction.h>
 #include <serialize.h>
+#include <streams.h>
 #include <sync.h>
+#include <tinyformat.h>
 #include <uint256.h>
 #include <util/fs.h>
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <deque>
+#include <future>
+#include <ios>
 #include <optional>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 class Chainstate;
 
 namespace node {
+//! Snapshots written as a stream of serialized coins, without a header
+static constexpr uint16_t SNAPSHOT_VERSION_LEGACY{1};
+//! Snapshots written in hashed chunks of coins grouped by txid, see SnapshotChunkWriter
+static constexpr uint16_t SNAPSHOT_VERSION_CHUNKED{2};
+//! Bytes heading the snapshots that have a version. Legacy snapshots start with the base blockhash.
+static constexpr std::array<uint8_t, 6> SNAPSHOT_MAGIC_BYTES{'q', 'u', 't', 'x', 'o', 0xff};
+//! Number of coins written in a chunk of a chunked snapshot
+static constexpr uint32_t SNAPSHOT_CHUNK_COINS{32768};
+//! Size above which a chunk is rejected, far above what SNAPSHOT_CHUNK_COINS coins take
+static constexpr uint32_t MAX_SNAPSHOT_CHUNK_SIZE{256 * 1024 * 1024};
+//! Maximum number of threads encoding or decoding the chunks of a snapshot
+static constexpr int MAX_SNAPSHOT_THREADS{8};
+
 //! Metadata describing a serialized version of a UTXO set from which an
 //! assumeutxo Chainstate can be constructed.
 class SnapshotMetadata
@@ -32,15 +56,122 @@ public:
     //! during snapshot load to estimate progress of UTXO set reconstruction.
     uint64_t m_coins_count = 0;
 
+    //! Format of the coins following the metadata. Legacy snapshots are written
+    //! without the magic bytes and version, so that older nodes can load them.
+    uint16_t m_version = SNAPSHOT_VERSION_LEGACY;
+
     SnapshotMetadata() { }
     SnapshotMetadata(
         const uint256& base_blockhash,
         uint64_t coins_count,
-        unsigned int nchaintx) :
+        unsigned int nchaintx,
+        uint16_t version = SNAPSHOT_VERSION_LEGACY) :
             m_base_blockhash(base_blockhash),
-            m_coins_count(coins_count) { }
+            m_coins_count(coins_count),
+            m_version(version) { }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        if (m_version != SNAPSHOT_VERSION_LEGACY) {
+            s << Span{SNAPSHOT_MAGIC_BYTES} << m_version;
+        }
+        s << m_base_blockhash << m_coins_count;
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        // The magic bytes cannot be told apart from the start of a legacy base blockhash until they are read
+        std::array<uint8_t, SNAPSHOT_MAGIC_BYTES.size()> magic;
+        s >> Span{magic};
+        if (magic == SNAPSHOT_MAGIC_BYTES) {
+            s >> m_version;
+            if (m_version <= SNAPSHOT_VERSION_LEGACY || m_version > SNAPSHOT_VERSION_CHUNKED) {
+                throw std::ios_base::failure(strprintf("Unsupported snapshot version %d", m_version));
+            }
+            s >> m_base_blockhash;
+        } else {
+            m_version = SNAPSHOT_VERSION_LEGACY;
+            std::copy(magic.begin(), magic.end(), m_base_blockhash.begin());
+            s >> Span<unsigned char>{m_base_blockhash}.subspan(magic.size());
+        }
+        s >> m_coins_count;
+    }
+};
+
+//! Header of a chunk of a chunked snapshot. The last chunk has no coins and marks the end of the snapshot.
+struct SnapshotChunkHeader
+{
+    uint32_t m_coins{0};
+    //! Size of the coins following the header
+    uint32_t m_size{0};
+    //! Hash of the coins, checked before any of them is loaded
+    uint256 m_hash;
+
+    SERIALIZE_METHODS(SnapshotChunkHeader, obj) { READWRITE(obj.m_coins, obj.m_size, obj.m_hash); }
+};
+
+using SnapshotCoins = std::vector<std::pair<COutPoint, Coin>>;
+
+/** Serialize @p coins into a chunk, the outputs of a transaction sharing its txid. @returns the hash of the chunk. */
+uint256 EncodeSnapshotChunk(const SnapshotCoins& coins, DataStream& chunk);
+
+/**
+ * Deserialize the coins of a chunk after checking it against @p header.
+ * Throws std::ios_base::failure when the chunk is malformed or does not match the header.
+ */
+SnapshotCoins DecodeSnapshotChunk(const SnapshotChunkHeader& header, DataStream chunk);
+
+/**
+ * Write the coins of a chunked snapshot to a file, after its metadata. Chunks are
+ * encoded and hashed on up to @p threads threads while the next coins are collected,
+ * and written in order. Coins must be added in the order of the coins database.
+ */
+class SnapshotChunkWriter
+{
+public:
+    SnapshotChunkWriter(AutoFile& file, int threads);
+
+    void Add(const COutPoint& outpoint, const Coin& coin);
+    /** Write the remaining coins and the end of the snapshot */
+    void Finish();
+
+private:
+    using EncodedChunk = std::pair<SnapshotChunkHeader, DataStream>;
+
+    AutoFile& m_file;
+    const size_t m_max_in_flight;
+    SnapshotCoins m_coins;
+    std::deque<std::future<EncodedChunk>> m_encoding;
+
+    void Flush();
+    void WriteChunk();
+};
+
+/**
+ * Read the coins of a chunked snapshot from a file, after its metadata. While the
+ * coins of a chunk are loaded, the following chunks are read and checked against
+ * their hash on up to @p threads threads.
+ */
+class SnapshotChunkReader
+{
+public:
+    SnapshotChunkReader(AutoFile& file, int threads);
+
+    /**
+     * Move the coins of the next chunk into @p coins. @returns false at the end of the snapshot.
+     * Throws std::ios_base::failure when the snapshot is truncated or a chunk is malformed.
+     */
+    bool Next(SnapshotCoins& coins);
+
+private:
+    AutoFile& m_file;
+    const size_t m_max_in_flight;
+    std::deque<std::future<SnapshotCoins>> m_decoding;
+    bool m_end{false};
 
-    SERIALIZE_METHODS(SnapshotMetadata, obj) { READWRITE(obj.m_base_blockhash, obj.m_coins_count); }
+    void Fill();
 };
 
 //! The file in the snapshot chainstate dir which stores the base blockhash. This is
@@ -0,0 +1,137 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/vmlog.h>
+
+#include <logging.h>
+#include <tinyformat.h>
+#include <univalue.h>
+#include <util/strencodings.h>
+#include <util/thread.h>
+
+#include <algorithm>
+
+std::unique_ptr<VMLogWriter> g_vmlog_writer;
+
+UniValue VMLogRecord::ToJSON() const
+{
+    UniValue result(UniValue::VOBJ);
+    if (txid) result.pushKV("txid", txid->GetHex());
+    result.pushKV("address", address.hex());
+    result.pushKV("time", time);
+    if (block_hash) result.pushKV("blockhash", block_hash->GetHex());
+    result.pushKV("blockheight", block_height);
+    UniValue entries(UniValue::VARR);
+    for (const dev::eth::LogEntry& log : logs) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("address", log.address.hex());
+        UniValue topics(UniValue::VARR);
+        for (const dev::h256& topic : log.topics) {
+            UniValue topic_pair(UniValue::VOBJ);
+            topic_pair.pushKV("raw", topic.hex());
+            topics.push_back(topic_pair);
+        }
+        UniValue data_pair(UniValue::VOBJ);
+        data_pair.pushKV("raw", HexStr(log.data));
+        entry.pushKV("data", data_pair);
+        entry.pushKV("topics", topics);
+        entries.push_back(entry);
+    }
+    result.pushKV("entries", entries);
+    return result;
+}
+
+fs::path VMLogWriter::SegmentPath(const fs::path& dir, int segment)
+{
+    return dir / fs::u8path(strprintf("vmlog_%05d.ndjson", segment));
+}
+
+VMLogWriter::VMLogWriter(fs::path dir, uint64_t segment_size, size_t max_queue)
+    : m_dir(std::move(dir)), m_segment_size(segment_size), m_max_queue(std::max<size_t>(max_queue, 1))
+{
+    // Continue the last segment of a previous run
+    fs::create_directories(m_dir);
+    while (fs::exists(SegmentPath(m_dir, m_segment + 1))) ++m_segment;
+    m_thread = std::thread([this] { util::TraceThread("vmlog", [this] { ThreadWrite(); }); });
+}
+
+VMLogWriter::~VMLogWriter()
+{
+    WITH_LOCK(m_mutex, m_stop = true);
+    m_cv_queued.notify_all();
+    m_thread.join();
+    if (m_file) fclose(m_file);
+}
+
+void VMLogWriter::Enqueue(std::vector<VMLogRecord>&& records)
+{
+    if (records.empty()) return;
+    {
+        WAIT_LOCK(m_mutex, lock);
+        m_cv_written.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_queue.size() < m_max_queue; });
+        for (VMLogRecord& record : records) {
+            m_queue.push_back(std::move(record));
+        }
+        m_queued += records.size();
+    }
+    m_cv_queued.notify_one();
+}
+
+void VMLogWriter::Flush()
+{
+    WAIT_LOCK(m_mutex, lock);
+    const uint64_t queued{m_queued};
+    m_cv_written.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_written >= queued; });
+}
+
+void VMLogWriter::ThreadWrite()
+{
+    while (true) {
+        std::deque<VMLogRecord> batch;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cv_queued.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_queue.empty(); });
+            // The records queued before stopping are written first
+            if (m_queue.empty()) return;
+            batch.swap(m_queue);
+        }
+        m_cv_written.notify_all();
+
+        for (const VMLogRecord& record : batch) {
+            Write(record.ToJSON().write() + "\n");
+        }
+        if (m_file) fflush(m_file);
+
+        WITH_LOCK(m_mutex, m_written += batch.size());
+        m_cv_written.notify_all();
+    }
+}
+
+void VMLogWriter::Write(const std::string& line)
+{
+    if (m_failed) return;
+    if (!m_file && !OpenSegment(m_segment)) return;
+    if (m_segment_bytes >= m_segment_size && !OpenSegment(m_segment + 1)) return;
+    if (fwrite(line.data(), 1, line.size(), m_file) != line.size()) {
+        LogPrintf("Error writing the VM log to %s, it is no longer recorded\n", fs::PathToString(SegmentPath(m_dir, m_segment)));
+        m_failed = true;
+        return;
+    }
+    m_segment_bytes += line.size();
+}
+
+bool VMLogWriter::OpenSegment(int segment)
+{
+    if (m_file) fclose(m_file);
+    const fs::path path{SegmentPath(m_dir, segment)};
+    m_file = fsbridge::fopen(path, "ab");
+    if (!m_file) {
+        LogPrintf("Error opening the VM log segment %s, the VM log is no longer recorded\n", fs::PathToString(path));
+        m_failed = true;
+        return false;
+    }
+    m_segment = segment;
+    m_segment_bytes = fs::exists(path) ? fs::file_size(path) : 0;
+    return true;
+}
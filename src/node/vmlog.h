@@ -0,0 +1,100 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QTUM_NODE_VMLOG_H
+#define QTUM_NODE_VMLOG_H
+
+#include <sync.h>
+#include <uint256.h>
+#include <util/fs.h>
+
+#include <libethcore/LogEntry.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+class UniValue;
+
+/** Size above which the writer continues in a new segment of the VM log */
+static constexpr uint64_t DEFAULT_VMLOG_SEGMENT_SIZE{128 * 1024 * 1024};
+/** Maximum number of records waiting to be written, the threads logging more wait for the writer */
+static constexpr size_t MAX_VMLOG_QUEUE{10000};
+
+/** The EVM LOG operations of a contract execution, with where and when it was executed */
+struct VMLogRecord {
+    //! Not set for the executions of callcontract
+    std::optional<uint256> txid;
+    dev::Address address;
+    int64_t time{0};
+    //! Not set for the executions of callcontract
+    std::optional<uint256> block_hash;
+    int block_height{0};
+    dev::eth::LogEntries logs;
+
+    /** The record as it used to be written to vmExecLogs.json */
+    UniValue ToJSON() const;
+};
+
+/**
+ * Writes the -record-log-opcodes log on a background thread, so that logging the executions of a
+ * block only costs its validation thread the copies of their logs.
+ *
+ * The log is a directory of append-only segments vmlog_NNNNN.ndjson of one JSON record per line,
+ * a segment being continued in the next one once it exceeds the segment size. A node restarted
+ * continues the last segment. contrib/vmlog/vmlog-to-json.py converts the segments to the single
+ * JSON document of vmExecLogs.json.
+ */
+class VMLogWriter
+{
+public:
+    explicit VMLogWriter(fs::path dir, uint64_t segment_size = DEFAULT_VMLOG_SEGMENT_SIZE, size_t max_queue = MAX_VMLOG_QUEUE);
+    /** Writes the records still queued before returning */
+    ~VMLogWriter();
+
+    /** Queue records for the writer, waiting while the queue is full */
+    void Enqueue(std::vector<VMLogRecord>&& records) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Wait until the records queued so far are written */
+    void Flush() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    static fs::path SegmentPath(const fs::path& dir, int segment);
+
+private:
+    const fs::path m_dir;
+    const uint64_t m_segment_size;
+    const size_t m_max_queue;
+
+    Mutex m_mutex;
+    //! Signals the writer that records were queued or that it should stop
+    std::condition_variable m_cv_queued;
+    //! Signals the waiting threads that the writer took records from the queue
+    std::condition_variable m_cv_written;
+    std::deque<VMLogRecord> m_queue GUARDED_BY(m_mutex);
+    uint64_t m_queued GUARDED_BY(m_mutex){0};
+    uint64_t m_written GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+
+    //! Only used by the writer thread once it started
+    FILE* m_file{nullptr};
+    int m_segment{0};
+    uint64_t m_segment_bytes{0};
+    bool m_failed{false};
+
+    std::thread m_thread;
+
+    void ThreadWrite() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void Write(const std::string& line);
+    bool OpenSegment(int segment);
+};
+
+extern std::unique_ptr<VMLogWriter> g_vmlog_writer;
+
+#endif // QTUM_NODE_VMLOG_H
@@ -100,13 +100,25 @@ private:
 
     double decay;
 
+    // The averages above are decayed lazily: their values are the stored values times
+    // decayFactor, the product of the decays since they were last normalized. A new data
+    // point is stored divided by decayFactor, so decaying all averages is one multiplication.
+    double decayFactor{1};
+    static constexpr double MIN_DECAY_FACTOR{1e-32};
+
+    /** Apply decayFactor to the stored averages */
+    void Normalize();
+    /** The stored average @p v with decayFactor applied */
+    std::vector<double> Decayed(const std::vector<double>& v) const;
+
     // Resolution (# of blocks) with which confirmations are tracked
     unsigned int scale;
 
     // Mempool counts of outstanding transactions
     // For each bucket X, track the number of transactions in the mempool
     // that are unconfirmed for each possible confirmation value Y
-    std::vector<std::vector<int> > unconfTxs;  //unconfTxs[Y][X]
+    // The counts of a bucket are adjacent, for the scan of a bucket in EstimateMedianVal
+    std::vector<int> unconfTxs;  //unconfTxs[X * GetMaxConfirms() + Y]
     // transactions still unconfirmed after GetMaxConfirms for each bucket
     std::vector<int> oldUnconfTxs;
 
@@ -193,9 +205,8 @@ TxConfirmStats::TxConfirmStats(const std::vector<double>& defaultBuckets,
 
 void TxConfirmStats::resizeInMemoryCounters(size_t newbuckets) {
     // newbuckets must be passed in because the buckets referred to during Read have not been updated yet.
-    unconfTxs.resize(GetMaxConfirms());
-    for (unsigned int i = 0; i < unconfTxs.size(); i++) {
-        unconfTxs[i].resize(newbuckets);
+    if (unconfTxs.size() != newbuckets * GetMaxConfirms()) {
+        unconfTxs.assign(newbuckets * GetMaxConfirms(), 0);
     }
     oldUnconfTxs.resize(newbuckets);
 }
@@ -203,9 +214,11 @@ void TxConfirmStats::resizeInMemoryCounters(size_t newbuckets) {
 // Roll the unconfirmed txs circular buffer
 void TxConfirmStats::ClearCurrent(unsigned int nBlockHeight)
 {
+    const unsigned int bins = GetMaxConfirms();
     for (unsigned int j = 0; j < buckets.size(); j++) {
-        oldUnconfTxs[j] += unconfTxs[nBlockHeight % unconfTxs.size()][j];
-        unconfTxs[nBlockHeight%unconfTxs.size()][j] = 0;
+        int& current = unconfTxs[j * bins + nBlockHeight % bins];
+        oldUnconfTxs[j] += current;
+        current = 0;
     }
 }
 
@@ -217,24 +230,38 @@ void TxConfirmStats::Record(int blocksToConfirm, double feerate)
         return;
     int periodsToConfirm = (blocksToConfirm + scale - 1) / scale;
     unsigned int bucketindex = bucketMap.lower_bound(feerate)->second;
+    const double weight = 1 / decayFactor;
     for (size_t i = periodsToConfirm; i <= confAvg.size(); i++) {
-        confAvg[i - 1][bucketindex]++;
+        confAvg[i - 1][bucketindex] += weight;
     }
-    txCtAvg[bucketindex]++;
-    m_feerate_avg[bucketindex] += feerate;
+    txCtAvg[bucketindex] += weight;
+    m_feerate_avg[bucketindex] += feerate * weight;
 }
 
 void TxConfirmStats::UpdateMovingAverages()
+{
+    decayFactor *= decay;
+    // Keep the weight of new data points far from overflowing
+    if (decayFactor < MIN_DECAY_FACTOR) Normalize();
+}
+
+void TxConfirmStats::Normalize()
 {
     assert(confAvg.size() == failAvg.size());
-    for (unsigned int j = 0; j < buckets.size(); j++) {
-        for (unsigned int i = 0; i < confAvg.size(); i++) {
-            confAvg[i][j] *= decay;
-            failAvg[i][j] *= decay;
-        }
-        m_feerate_avg[j] *= decay;
-        txCtAvg[j] *= decay;
+    for (unsigned int i = 0; i < confAvg.size(); i++) {
+        confAvg[i] = Decayed(confAvg[i]);
+        failAvg[i] = Decayed(failAvg[i]);
     }
+    m_feerate_avg = Decayed(m_feerate_avg);
+    txCtAvg = Decayed(txCtAvg);
+    decayFactor = 1;
+}
+
+std::vector<double> TxConfirmStats::Decayed(const std::vector<double>& v) const
+{
+    std::vector<double> decayed(v.size());
+    std::transform(v.begin(), v.end(), decayed.begin(), [this](double d) { return d * decayFactor; });
+    return decayed;
 }
 
 // returns -1 on error conditions
@@ -249,6 +276,8 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     double failNum = 0; // Number of tx's that were never confirmed but removed from the mempool after confTarget
     const int periodTarget = (confTarget + scale - 1) / scale;
     const int maxbucketindex = buckets.size() - 1;
+    const std::vector<double>& periodConfAvg = confAvg[periodTarget - 1];
+    const std::vector<double>& periodFailAvg = failAvg[periodTarget - 1];
 
     // We'll combine buckets until we have enough samples.
     // The near and far variables will define the range we've combined
@@ -261,7 +290,7 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     unsigned int bestFarBucket = maxbucketindex;
 
     bool foundAnswer = false;
-    unsigned int bins = unconfTxs.size();
+    unsigned int bins = GetMaxConfirms();
     bool newBucketRange = true;
     bool passing = true;
     EstimatorBucket passBucket;
@@ -274,11 +303,12 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
             newBucketRange = false;
         }
         curFarBucket = bucket;
-        nConf += confAvg[periodTarget - 1][bucket];
-        totalNum += txCtAvg[bucket];
-        failNum += failAvg[periodTarget - 1][bucket];
-        for (unsigned int confct = confTarget; confct < GetMaxConfirms(); confct++)
-            extraNum += unconfTxs[(nBlockHeight - confct) % bins][bucket];
+        nConf += periodConfAvg[bucket] * decayFactor;
+        totalNum += txCtAvg[bucket] * decayFactor;
+        failNum += periodFailAvg[bucket] * decayFactor;
+        const int* bucketUnconfTxs = &unconfTxs[bucket * bins];
+        for (unsigned int confct = confTarget; confct < bins; confct++)
+            extraNum += bucketUnconfTxs[(nBlockHeight - confct) % bins];
         extraNum += oldUnconfTxs[bucket];
         // If we have enough transaction data points in this range of buckets,
         // we can test for success
@@ -333,6 +363,7 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     // and reporting the average which is less accurate
     unsigned int minBucket = std::min(bestNearBucket, bestFarBucket);
     unsigned int maxBucket = std::max(bestNearBucket, bestFarBucket);
+    // The stored averages are used here, the ratios do not depend on decayFactor
     for (unsigned int j = minBucket; j <= maxBucket; j++) {
         txSum += txCtAvg[j];
     }
@@ -395,10 +426,15 @@ void TxConfirmStats::Write(AutoFile& fileout) const
 {
     fileout << Using<EncodedDoubleFormatter>(decay);
     fileout << scale;
-    fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(m_feerate_avg);
-    fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(txCtAvg);
-    fileout << Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(confAvg);
-    fileout << Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(failAvg);
+    fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(Decayed(m_feerate_avg));
+    fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(Decayed(txCtAvg));
+    std::vector<std::vector<double>> decayedConfAvg, decayedFailAvg;
+    for (unsigned int i = 0; i < confAvg.size(); i++) {
+        decayedConfAvg.push_back(Decayed(confAvg[i]));
+        decayedFailAvg.push_back(Decayed(failAvg[i]));
+    }
+    fileout << Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(decayedConfAvg);
+    fileout << Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(decayedFailAvg);
 }
 
 void TxConfirmStats::Read(AutoFile& filein, int nFileVersion, size_t numBuckets)
@@ -449,6 +485,9 @@ void TxConfirmStats::Read(AutoFile& filein, int nFileVersion, size_t numBuckets)
         }
     }
 
+    // The file holds the decayed averages
+    decayFactor = 1;
+
     // Resize the current block variables which aren't stored in the data file
     // to match the number of confirms and buckets
     resizeInMemoryCounters(numBuckets);
@@ -460,8 +499,8 @@ void TxConfirmStats::Read(AutoFile& filein, int nFileVersion, size_t numBuckets)
 unsigned int TxConfirmStats::NewTx(unsigned int nBlockHeight, double val)
 {
     unsigned int bucketindex = bucketMap.lower_bound(val)->second;
-    unsigned int blockIndex = nBlockHeight % unconfTxs.size();
-    unconfTxs[blockIndex][bucketindex]++;
+    unsigned int blockIndex = nBlockHeight % GetMaxConfirms();
+    unconfTxs[bucketindex * GetMaxConfirms() + blockIndex]++;
     return bucketindex;
 }
 
@@ -476,7 +515,7 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
         return;  //This can't happen because we call this with our best seen height, no entries can have higher
     }
 
-    if (blocksAgo >= (int)unconfTxs.size()) {
+    if (blocksAgo >= (int)GetMaxConfirms()) {
         if (oldUnconfTxs[bucketindex] > 0) {
             oldUnconfTxs[bucketindex]--;
         } else {
@@ -485,9 +524,10 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
         }
     }
     else {
-        unsigned int blockIndex = entryHeight % unconfTxs.size();
-        if (unconfTxs[blockIndex][bucketindex] > 0) {
-            unconfTxs[blockIndex][bucketindex]--;
+        unsigned int blockIndex = entryHeight % GetMaxConfirms();
+        int& unconf = unconfTxs[bucketindex * GetMaxConfirms() + blockIndex];
+        if (unconf > 0) {
+            unconf--;
         } else {
             LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy error, mempool tx removed from blockIndex=%u,bucketIndex=%u already\n",
                      blockIndex, bucketindex);
@@ -497,7 +537,7 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
         assert(scale != 0);
         unsigned int periodsAgo = blocksAgo / scale;
         for (size_t i = 0; i < periodsAgo && i < failAvg.size(); i++) {
-            failAvg[i][bucketindex]++;
+            failAvg[i][bucketindex] += 1 / decayFactor;
         }
     }
 }
@@ -518,9 +558,17 @@ bool CBlockPolicyEstimator::_removeTx(const uint256& hash, bool inBlock)
     AssertLockHeld(m_cs_fee_estimator);
     std::map<uint256, TxStatsInfo>::iterator pos = mapMemPoolTxs.find(hash);
     if (pos != mapMemPoolTxs.end()) {
-        feeStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
-        shortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
-        longStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
+        // Transactions of the current height are not counted by the estimates yet
+        if (pos->second.blockHeight < nBestSeenHeight) ClearEstimates();
+        if (pos->second.contract) {
+            gasStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
+            gasShortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
+            gasLongStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
+        } else {
+            feeStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
+            shortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
+            longStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
+        }
         mapMemPoolTxs.erase(hash);
         return true;
     } else {
@@ -542,9 +590,21 @@ CBlockPolicyEstimator::CBlockPolicyEstimator(const fs::path& estimation_filepath
     bucketMap[INF_FEERATE] = bucketIndex;
     assert(bucketMap.size() == buckets.size());
 
+    bucketIndex = 0;
+    for (double bucketBoundary = MIN_BUCKET_GAS_PRICE; bucketBoundary <= MAX_BUCKET_GAS_PRICE; bucketBoundary *= FEE_SPACING, bucketIndex++) {
+        gasBuckets.push_back(bucketBoundary);
+        gasBucketMap[bucketBoundary] = bucketIndex;
+    }
+    gasBuckets.push_back(INF_FEERATE);
+    gasBucketMap[INF_FEERATE] = bucketIndex;
+    assert(gasBucketMap.size() == gasBuckets.size());
+
     feeStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
     shortStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
     longStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
+    gasStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(gasBuckets, gasBucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
+    gasShortStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(gasBuckets, gasBucketMap, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
+    gasLongStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(gasBuckets, gasBucketMap, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
 
     AutoFile est_file{fsbridge::fopen(m_estimation_filepath, "rb")};
 
@@ -595,10 +655,24 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     }
     trackedTxs++;
 
+    mapMemPoolTxs[hash].blockHeight = txHeight;
+
+    // Contract transactions are tracked by their gas price instead of their feerate
+    if (entry.GetTx().HasCreateOrCall()) {
+        const double gasPrice = entry.GetMinGasPrice();
+        mapMemPoolTxs[hash].contract = true;
+        unsigned int bucketIndex = gasStats->NewTx(txHeight, gasPrice);
+        mapMemPoolTxs[hash].bucketIndex = bucketIndex;
+        unsigned int bucketIndex2 = gasShortStats->NewTx(txHeight, gasPrice);
+        assert(bucketIndex == bucketIndex2);
+        unsigned int bucketIndex3 = gasLongStats->NewTx(txHeight, gasPrice);
+        assert(bucketIndex == bucketIndex3);
+        return;
+    }
+
     // Feerates are stored and reported as BTC-per-kb:
     CFeeRate feeRate(entry.GetFee(), entry.GetTxSize());
 
-    mapMemPoolTxs[hash].blockHeight = txHeight;
     unsigned int bucketIndex = feeStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
     mapMemPoolTxs[hash].bucketIndex = bucketIndex;
     unsigned int bucketIndex2 = shortStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
@@ -615,11 +689,6 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
         return false;
     }
 
-    if(entry->GetTx().HasCreateOrCall()){
-    	//Exclude contract transactions
-    	return false;
-    }
-
     // How many blocks did it take for miners to include this transaction?
     // blocksToConfirm is 1-based, so a transaction included in the earliest
     // possible block has confirmation count of 1
@@ -631,6 +700,15 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
         return false;
     }
 
+    if (entry->GetTx().HasCreateOrCall()) {
+        // Contract transactions are recorded by their gas price only
+        const double gasPrice = entry->GetMinGasPrice();
+        gasStats->Record(blocksToConfirm, gasPrice);
+        gasShortStats->Record(blocksToConfirm, gasPrice);
+        gasLongStats->Record(blocksToConfirm, gasPrice);
+        return true;
+    }
+
     // Feerates are stored and reported as BTC-per-kb:
     CFeeRate feeRate(entry->GetFee(), entry->GetTxSize());
 
@@ -657,16 +735,23 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     // calls to removeTx (via processBlockTx) correctly calculate age
     // of unconfirmed txs to remove from tracking.
     nBestSeenHeight = nBlockHeight;
+    ClearEstimates();
 
     // Update unconfirmed circular buffer
     feeStats->ClearCurrent(nBlockHeight);
     shortStats->ClearCurrent(nBlockHeight);
     longStats->ClearCurrent(nBlockHeight);
+    gasStats->ClearCurrent(nBlockHeight);
+    gasShortStats->ClearCurrent(nBlockHeight);
+    gasLongStats->ClearCurrent(nBlockHeight);
 
     // Decay all exponential averages
     feeStats->UpdateMovingAverages();
     shortStats->UpdateMovingAverages();
     longStats->UpdateMovingAverages();
+    gasStats->UpdateMovingAverages();
+    gasShortStats->UpdateMovingAverages();
+    gasLongStats->UpdateMovingAverages();
 
     unsigned int countedTxs = 0;
     // Update averages with data points from current block
@@ -779,32 +864,32 @@ unsigned int CBlockPolicyEstimator::MaxUsableEstimate() const
  * time horizon which tracks confirmations up to the desired target.  If
  * checkShorterHorizon is requested, also allow short time horizon estimates
  * for a lower target to reduce the given answer */
-double CBlockPolicyEstimator::estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const
+double CBlockPolicyEstimator::estimateCombinedFee(const HorizonStats& stats, unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const
 {
     double estimate = -1;
-    if (confTarget >= 1 && confTarget <= longStats->GetMaxConfirms()) {
+    if (confTarget >= 1 && confTarget <= stats.longStats.GetMaxConfirms()) {
         // Find estimate from shortest time horizon possible
-        if (confTarget <= shortStats->GetMaxConfirms()) { // short horizon
-            estimate = shortStats->EstimateMedianVal(confTarget, SUFFICIENT_TXS_SHORT, successThreshold, nBestSeenHeight, result);
+        if (confTarget <= stats.shortStats.GetMaxConfirms()) { // short horizon
+            estimate = stats.shortStats.EstimateMedianVal(confTarget, SUFFICIENT_TXS_SHORT, successThreshold, nBestSeenHeight, result);
         }
-        else if (confTarget <= feeStats->GetMaxConfirms()) { // medium horizon
-            estimate = feeStats->EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, successThreshold, nBestSeenHeight, result);
+        else if (confTarget <= stats.medStats.GetMaxConfirms()) { // medium horizon
+            estimate = stats.medStats.EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, successThreshold, nBestSeenHeight, result);
         }
         else { // long horizon
-            estimate = longStats->EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, successThreshold, nBestSeenHeight, result);
+            estimate = stats.longStats.EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, successThreshold, nBestSeenHeight, result);
         }
         if (checkShorterHorizon) {
             EstimationResult tempResult;
             // If a lower confTarget from a more recent horizon returns a lower answer use it.
-            if (confTarget > feeStats->GetMaxConfirms()) {
-                double medMax = feeStats->EstimateMedianVal(feeStats->GetMaxConfirms(), SUFFICIENT_FEETXS, successThreshold, nBestSeenHeight, &tempResult);
+            if (confTarget > stats.medStats.GetMaxConfirms()) {
+                double medMax = stats.medStats.EstimateMedianVal(stats.medStats.GetMaxConfirms(), SUFFICIENT_FEETXS, successThreshold, nBestSeenHeight, &tempResult);
                 if (medMax > 0 && (estimate == -1 || medMax < estimate)) {
                     estimate = medMax;
                     if (result) *result = tempResult;
                 }
             }
-            if (confTarget > shortStats->GetMaxConfirms()) {
-                double shortMax = shortStats->EstimateMedianVal(shortStats->GetMaxConfirms(), SUFFICIENT_TXS_SHORT, successThreshold, nBestSeenHeight, &tempResult);
+            if (confTarget > stats.shortStats.GetMaxConfirms()) {
+                double shortMax = stats.shortStats.EstimateMedianVal(stats.shortStats.GetMaxConfirms(), SUFFICIENT_TXS_SHORT, successThreshold, nBestSeenHeight, &tempResult);
                 if (shortMax > 0 && (estimate == -1 || shortMax < estimate)) {
                     estimate = shortMax;
                     if (result) *result = tempResult;
@@ -818,15 +903,15 @@ double CBlockPolicyEstimator::estimateCombinedFee(unsigned int confTarget, doubl
 /** Ensure that for a conservative estimate, the DOUBLE_SUCCESS_PCT is also met
  * at 2 * target for any longer time horizons.
  */
-double CBlockPolicyEstimator::estimateConservativeFee(unsigned int doubleTarget, EstimationResult *result) const
+double CBlockPolicyEstimator::estimateConservativeFee(const HorizonStats& stats, unsigned int doubleTarget, EstimationResult *result) const
 {
     double estimate = -1;
     EstimationResult tempResult;
-    if (doubleTarget <= shortStats->GetMaxConfirms()) {
-        estimate = feeStats->EstimateMedianVal(doubleTarget, SUFFICIENT_FEETXS, DOUBLE_SUCCESS_PCT, nBestSeenHeight, result);
+    if (doubleTarget <= stats.shortStats.GetMaxConfirms()) {
+        estimate = stats.medStats.EstimateMedianVal(doubleTarget, SUFFICIENT_FEETXS, DOUBLE_SUCCESS_PCT, nBestSeenHeight, result);
     }
-    if (doubleTarget <= feeStats->GetMaxConfirms()) {
-        double longEstimate = longStats->EstimateMedianVal(doubleTarget, SUFFICIENT_FEETXS, DOUBLE_SUCCESS_PCT, nBestSeenHeight, &tempResult);
+    if (doubleTarget <= stats.medStats.GetMaxConfirms()) {
+        double longEstimate = stats.longStats.EstimateMedianVal(doubleTarget, SUFFICIENT_FEETXS, DOUBLE_SUCCESS_PCT, nBestSeenHeight, &tempResult);
         if (longEstimate > estimate) {
             estimate = longEstimate;
             if (result) *result = tempResult;
@@ -845,6 +930,39 @@ double CBlockPolicyEstimator::estimateConservativeFee(unsigned int doubleTarget,
 CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative) const
 {
     LOCK(m_cs_fee_estimator);
+    double median = estimateSmartMedian(FeeHorizons(), confTarget, feeCalc, conservative);
+
+    if (median < 0) return CFeeRate(0); // error condition
+
+    return CFeeRate(llround(median));
+}
+
+CAmount CBlockPolicyEstimator::estimateSmartGasPrice(int confTarget, FeeCalculation *feeCalc, bool conservative) const
+{
+    LOCK(m_cs_fee_estimator);
+    double median = estimateSmartMedian(GasHorizons(), confTarget, feeCalc, conservative);
+
+    if (median < 0) return 0; // error condition
+
+    return llround(median);
+}
+
+double CBlockPolicyEstimator::estimateSmartMedian(const HorizonStats& stats, int confTarget, FeeCalculation *feeCalc, bool conservative) const
+{
+    AssertLockHeld(m_cs_fee_estimator);
+    auto it = stats.estimates.find({confTarget, conservative});
+    if (it == stats.estimates.end()) {
+        CachedEstimate estimate;
+        estimate.median = calculateSmartMedian(stats, confTarget, &estimate.feeCalc, conservative);
+        it = stats.estimates.emplace(std::make_pair(confTarget, conservative), estimate).first;
+    }
+    if (feeCalc) *feeCalc = it->second.feeCalc;
+    return it->second.median;
+}
+
+double CBlockPolicyEstimator::calculateSmartMedian(const HorizonStats& stats, int confTarget, FeeCalculation *feeCalc, bool conservative) const
+{
+    AssertLockHeld(m_cs_fee_estimator);
 
     if (feeCalc) {
         feeCalc->desiredTarget = confTarget;
@@ -855,8 +973,8 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
     EstimationResult tempResult;
 
     // Return failure if trying to analyze a target we're not tracking
-    if (confTarget <= 0 || (unsigned int)confTarget > longStats->GetMaxConfirms()) {
-        return CFeeRate(0);  // error condition
+    if (confTarget <= 0 || (unsigned int)confTarget > stats.longStats.GetMaxConfirms()) {
+        return -1;  // error condition
     }
 
     // It's not possible to get reasonable estimates for confTarget of 1
@@ -868,7 +986,7 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
     }
     if (feeCalc) feeCalc->returnedTarget = confTarget;
 
-    if (confTarget <= 1) return CFeeRate(0); // error condition
+    if (confTarget <= 1) return -1; // error condition
 
     assert(confTarget > 0); //estimateCombinedFee and estimateConservativeFee take unsigned ints
     /** true is passed to estimateCombined fee for target/2 and target so
@@ -881,13 +999,13 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
      * the purpose of conservative estimates is not to let short term
      * fluctuations lower our estimates by too much.
      */
-    double halfEst = estimateCombinedFee(confTarget/2, HALF_SUCCESS_PCT, true, &tempResult);
+    double halfEst = estimateCombinedFee(stats, confTarget/2, HALF_SUCCESS_PCT, true, &tempResult);
     if (feeCalc) {
         feeCalc->est = tempResult;
         feeCalc->reason = FeeReason::HALF_ESTIMATE;
     }
     median = halfEst;
-    double actualEst = estimateCombinedFee(confTarget, SUCCESS_PCT, true, &tempResult);
+    double actualEst = estimateCombinedFee(stats, confTarget, SUCCESS_PCT, true, &tempResult);
     if (actualEst > median) {
         median = actualEst;
         if (feeCalc) {
@@ -895,7 +1013,7 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
             feeCalc->reason = FeeReason::FULL_ESTIMATE;
         }
     }
-    double doubleEst = estimateCombinedFee(2 * confTarget, DOUBLE_SUCCESS_PCT, !conservative, &tempResult);
+    double doubleEst = estimateCombinedFee(stats, 2 * confTarget, DOUBLE_SUCCESS_PCT, !conservative, &tempResult);
     if (doubleEst > median) {
         median = doubleEst;
         if (feeCalc) {
@@ -905,7 +1023,7 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
     }
 
     if (conservative || median == -1) {
-        double consEst =  estimateConservativeFee(2 * confTarget, &tempResult);
+        double consEst =  estimateConservativeFee(stats, 2 * confTarget, &tempResult);
         if (consEst > median) {
             median = consEst;
             if (feeCalc) {
@@ -915,9 +1033,7 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
         }
     }
 
-    if (median < 0) return CFeeRate(0); // error condition
-
-    return CFeeRate(llround(median));
+    return median;
 }
 
 void CBlockPolicyEstimator::Flush() {
@@ -952,6 +1068,11 @@ bool CBlockPolicyEstimator::Write(AutoFile& fileout) const
         feeStats->Write(fileout);
         shortStats->Write(fileout);
         longStats->Write(fileout);
+        // Gas price stats of contract transactions, older versions stop reading before them
+        fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(gasBuckets);
+        gasStats->Write(fileout);
+        gasShortStats->Write(fileout);
+        gasLongStats->Write(fileout);
     }
     catch (const std::exception&) {
         LogPrintf("CBlockPolicyEstimator::Write(): unable to write policy estimator data (non-fatal)\n");
@@ -997,6 +1118,26 @@ bool CBlockPolicyEstimator::Read(AutoFile& filein)
             fileShortStats->Read(filein, nVersionThatWrote, numBuckets);
             fileLongStats->Read(filein, nVersionThatWrote, numBuckets);
 
+            // Files written by older versions end here, the gas price estimates then start empty
+            std::vector<double> fileGasBuckets;
+            std::unique_ptr<TxConfirmStats> fileGasStats, fileGasShortStats, fileGasLongStats;
+            try {
+                filein >> Using<VectorFormatter<EncodedDoubleFormatter>>(fileGasBuckets);
+                size_t numGasBuckets = fileGasBuckets.size();
+                if (numGasBuckets <= 1 || numGasBuckets > 1000) {
+                    throw std::runtime_error("Corrupt estimates file. Must have between 2 and 1000 gas price buckets");
+                }
+                fileGasStats.reset(new TxConfirmStats(gasBuckets, gasBucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
+                fileGasShortStats.reset(new TxConfirmStats(gasBuckets, gasBucketMap, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
+                fileGasLongStats.reset(new TxConfirmStats(gasBuckets, gasBucketMap, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
+                fileGasStats->Read(filein, nVersionThatWrote, numGasBuckets);
+                fileGasShortStats->Read(filein, nVersionThatWrote, numGasBuckets);
+                fileGasLongStats->Read(filein, nVersionThatWrote, numGasBuckets);
+            } catch (const std::exception& e) {
+                LogPrint(BCLog::ESTIMATEFEE, "%s: no gas price estimates read: %s\n", __func__, e.what());
+                fileGasBuckets.clear();
+            }
+
             // Fee estimates file parsed correctly
             // Copy buckets from file and refresh our bucketmap
             buckets = fileBuckets;
@@ -1010,9 +1151,21 @@ bool CBlockPolicyEstimator::Read(AutoFile& filein)
             shortStats = std::move(fileShortStats);
             longStats = std::move(fileLongStats);
 
+            if (!fileGasBuckets.empty()) {
+                gasBuckets = fileGasBuckets;
+                gasBucketMap.clear();
+                for (unsigned int i = 0; i < gasBuckets.size(); i++) {
+                    gasBucketMap[gasBuckets[i]] = i;
+                }
+                gasStats = std::move(fileGasStats);
+                gasShortStats = std::move(fileGasShortStats);
+                gasLongStats = std::move(fileGasLongStats);
+            }
+
             nBestSeenHeight = nFileBestSeenHeight;
             historicalFirst = nFileHistoricalFirst;
             historicalBest = nFileHistoricalBest;
+            ClearEstimates();
         }
     }
     catch (const std::exception& e) {
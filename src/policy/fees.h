@@ -193,6 +193,14 @@ private:
      */
     static constexpr double FEE_SPACING = 1.05;
 
+    /** Track the confirmation of contract transactions by the minimum gas price of their
+     * contract outputs, in satoshis per gas. The miner orders contract transactions by gas price
+     * rather than by feerate, so their feerate says little about when they confirm. The buckets
+     * are spaced by FEE_SPACING and start below the default minimum gas price of 40.
+     */
+    static constexpr double MIN_BUCKET_GAS_PRICE = 10;
+    static constexpr double MAX_BUCKET_GAS_PRICE = 1e5;
+
     const fs::path m_estimation_filepath;
 public:
     /** Create new BlockPolicyEstimator and initialize stats tracking classes with default values */
@@ -232,6 +240,13 @@ public:
                             EstimationResult* result = nullptr) const
         EXCLUSIVE_LOCKS_REQUIRED(!m_cs_fee_estimator);
 
+    /** Estimate the gas price, in satoshis per gas, a contract transaction needs to be included
+     *  in a block within confTarget blocks, in the same way as estimateSmartFee. Returns 0 if
+     *  there is not enough data.
+     */
+    CAmount estimateSmartGasPrice(int confTarget, FeeCalculation *feeCalc, bool conservative) const
+        EXCLUSIVE_LOCKS_REQUIRED(!m_cs_fee_estimator);
+
     /** Write estimation data to a file */
     bool Write(AutoFile& fileout) const
         EXCLUSIVE_LOCKS_REQUIRED(!m_cs_fee_estimator);
@@ -271,6 +286,8 @@ private:
     {
         unsigned int blockHeight{0};
         unsigned int bucketIndex{0};
+        //! Whether bucketIndex is a gas price bucket of a contract transaction
+        bool contract{false};
         TxStatsInfo() {}
     };
 
@@ -282,19 +299,57 @@ private:
     std::unique_ptr<TxConfirmStats> shortStats PT_GUARDED_BY(m_cs_fee_estimator);
     std::unique_ptr<TxConfirmStats> longStats PT_GUARDED_BY(m_cs_fee_estimator);
 
+    /** The same horizons tracking the gas prices of the contract transactions */
+    std::unique_ptr<TxConfirmStats> gasStats PT_GUARDED_BY(m_cs_fee_estimator);
+    std::unique_ptr<TxConfirmStats> gasShortStats PT_GUARDED_BY(m_cs_fee_estimator);
+    std::unique_ptr<TxConfirmStats> gasLongStats PT_GUARDED_BY(m_cs_fee_estimator);
+
     unsigned int trackedTxs GUARDED_BY(m_cs_fee_estimator){0};
     unsigned int untrackedTxs GUARDED_BY(m_cs_fee_estimator){0};
 
     std::vector<double> buckets GUARDED_BY(m_cs_fee_estimator); // The upper-bound of the range for the bucket (inclusive)
     std::map<double, unsigned int> bucketMap GUARDED_BY(m_cs_fee_estimator); // Map of bucket upper-bound to index into all vectors by bucket
+    std::vector<double> gasBuckets GUARDED_BY(m_cs_fee_estimator);
+    std::map<double, unsigned int> gasBucketMap GUARDED_BY(m_cs_fee_estimator);
+
+    /** A smart estimate and how it was found, by confirmation target and conservative mode */
+    struct CachedEstimate {
+        double median;
+        FeeCalculation feeCalc;
+    };
+    using EstimateCache = std::map<std::pair<int, bool>, CachedEstimate>;
+
+    /** Smart estimates since the last change of the stats. The stats only change with a block,
+     *  or when a transaction that entered the mempool before the last block leaves it. */
+    mutable EstimateCache m_fee_estimates GUARDED_BY(m_cs_fee_estimator);
+    mutable EstimateCache m_gas_estimates GUARDED_BY(m_cs_fee_estimator);
+
+    /** The stats of the short, medium and long horizons */
+    struct HorizonStats {
+        const TxConfirmStats& shortStats;
+        const TxConfirmStats& medStats;
+        const TxConfirmStats& longStats;
+        EstimateCache& estimates;
+    };
+    HorizonStats FeeHorizons() const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator) { return {*shortStats, *feeStats, *longStats, m_fee_estimates}; }
+    HorizonStats GasHorizons() const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator) { return {*gasShortStats, *gasStats, *gasLongStats, m_gas_estimates}; }
+    void ClearEstimates() EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator)
+    {
+        m_fee_estimates.clear();
+        m_gas_estimates.clear();
+    }
 
     /** Process a transaction confirmed in a block*/
     bool processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry) EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
 
-    /** Helper for estimateSmartFee */
-    double estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
-    /** Helper for estimateSmartFee */
-    double estimateConservativeFee(unsigned int doubleTarget, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    /** Helper for estimateSmartFee and estimateSmartGasPrice, looks the estimate up in the cache first */
+    double estimateSmartMedian(const HorizonStats& stats, int confTarget, FeeCalculation *feeCalc, bool conservative) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    /** Helper for estimateSmartMedian */
+    double calculateSmartMedian(const HorizonStats& stats, int confTarget, FeeCalculation *feeCalc, bool conservative) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    /** Helper for estimateSmartMedian */
+    double estimateCombinedFee(const HorizonStats& stats, unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    /** Helper for estimateSmartMedian */
+    double estimateConservativeFee(const HorizonStats& stats, unsigned int doubleTarget, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Number of blocks of data recorded while fee estimates have been running */
     unsigned int BlockSpan() const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Number of blocks of recorded fee estimate data represented in saved data file */
@@ -9,12 +9,14 @@
 #include <txdb.h>
 #include <validation.h>
 #include <arith_uint256.h>
+#include <checkqueue.h>
 #include <hash.h>
 #include <timedata.h>
 #include <chainparams.h>
 #include <script/sign.h>
 #include <consensus/consensus.h>
 #include <util/signstr.h>
+#include <script/sigcache.h>
 #include <qtum/qtumdelegation.h>
 #include <script/standard.h>
 
@@ -27,6 +29,25 @@ QtumDelegation& GetQtumDelegation()
     return qtumDelegation;
 }
 
+bool VerifyProofOfDelegation(const uint160& address, const uint160& staker, const std::vector<unsigned char>& vchPoD)
+{
+    // The same proof is checked for every block its staker creates, only valid proofs are remembered
+    if(DelegationProofCacheGet(address, staker, vchPoD))
+        return true;
+    if(!SignStr::VerifyMessage(CKeyID(address), staker.GetReverseHex(), vchPoD))
+        return false;
+    DelegationProofCacheSet(address, staker, vchPoD);
+    return true;
+}
+
+bool VerifyStakeDelegation(const uint160& address, const Delegation& delegation)
+{
+    if(address == uint160() || delegation.IsNull() || delegation.fee > 100)
+        return false;
+
+    return VerifyProofOfDelegation(address, delegation.staker, delegation.PoD);
+}
+
 // Stake Modifier (hash modifier of proof-of-stake):
 // The purpose of stake modifier is to prevent a txout (coin) owner from
 // computing future proof-of-stake generated by this txout at the time
@@ -198,7 +219,7 @@ bool CheckProofOfStake(CBlockIndex* pindexPrev, BlockValidationState& state, con
     {
         ////////////////////////////////////////////////// deploy offline staking contract
         if(nHeight == nOfflineStakeHeight){
-            globalState->deployDelegationsContract();
+            chainstate.m_chainman.Qtum().state->deployDelegationsContract();
         }
         /////////////////////////////////////////////////
 
@@ -215,7 +236,7 @@ bool CheckProofOfStake(CBlockIndex* pindexPrev, BlockValidationState& state, con
         }
 
         // Verify delegation received from the contract
-        bool verifiedDelegation = qtumDelegation.VerifyDelegation(address, delegation);
+        bool verifiedDelegation = VerifyStakeDelegation(address, delegation);
         bool hasDelegationProof = vchPoD.size() > 0;
 
         // Check that if PoD is present then the delegation received from the contract can be verified
@@ -234,7 +255,7 @@ bool CheckProofOfStake(CBlockIndex* pindexPrev, BlockValidationState& state, con
             // Check that the staker have the permission to use that coin to create the coinstake transaction
             CScript stakerPubKey = tx.vout[1].scriptPubKey;
             uint160 staker = uint160(ExtractPublicKeyHash(stakerPubKey));
-            if(!SignStr::VerifyMessage(CKeyID(address), staker.GetReverseHex(), vchPoD))
+            if(!VerifyProofOfDelegation(address, staker, vchPoD))
                 return state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "stake-verify-delegation-failed", strprintf("CheckProofOfStake() : VerifyDelegation failed on coinstake %s", tx.GetHash().ToString()));
 
             // Check the super staker min utxo value
@@ -325,6 +346,10 @@ bool CheckRecoveredPubKeyFromBlockSignature(CBlockIndex* pindexPrev, const CBloc
         }
     }
 
+    return CheckRecoveredPubKeyFromBlockSignature(pindexPrev->nHeight + 1, block, coinPrev.out.scriptPubKey);
+}
+
+bool CheckRecoveredPubKeyFromBlockSignature(int nHeight, const CBlockHeader& block, const CScript& scriptPubKey) {
     uint256 hash = block.GetHashWithoutSign();
     CPubKey pubkey;
     std::vector<unsigned char> vchBlockSig = block.GetBlockSignature();
@@ -336,7 +361,7 @@ bool CheckRecoveredPubKeyFromBlockSignature(CBlockIndex* pindexPrev, const CBloc
     }
 
     // Recover the public key
-    if (pindexPrev->nHeight + 1 >= Params().GetConsensus().nOfflineStakeHeight)
+    if (nHeight >= Params().GetConsensus().nOfflineStakeHeight)
     {
         // Recover the public key from compact signature
         if(hasDelegation)
@@ -345,9 +370,9 @@ bool CheckRecoveredPubKeyFromBlockSignature(CBlockIndex* pindexPrev, const CBloc
             CTxDestination address;
             TxoutType txType=TxoutType::NONSTANDARD;
             if(pubkey.RecoverCompact(hash, vchBlockSig) &&
-                    ExtractDestination(coinPrev.out.scriptPubKey, address, &txType)){
+                    ExtractDestination(scriptPubKey, address, &txType)){
                 if ((txType == TxoutType::PUBKEY || txType == TxoutType::PUBKEYHASH) && std::holds_alternative<PKHash>(address)) {
-                    if(SignStr::VerifyMessage(ToKeyID(std::get<PKHash>(address)), pubkey.GetID().GetReverseHex(), vchPoD)) {
+                    if(VerifyProofOfDelegation(ToKeyID(std::get<PKHash>(address)), pubkey.GetID(), vchPoD)) {
                         return true;
                     }
                 }
@@ -359,7 +384,7 @@ bool CheckRecoveredPubKeyFromBlockSignature(CBlockIndex* pindexPrev, const CBloc
             CTxDestination address;
             TxoutType txType=TxoutType::NONSTANDARD;
             if(pubkey.RecoverCompact(hash, vchBlockSig) &&
-                    ExtractDestination(coinPrev.out.scriptPubKey, address, &txType)){
+                    ExtractDestination(scriptPubKey, address, &txType)){
                 if ((txType == TxoutType::PUBKEY || txType == TxoutType::PUBKEYHASH) && std::holds_alternative<PKHash>(address)) {
                     if(pubkey.GetID() == ToKeyID(std::get<PKHash>(address))) {
                         return true;
@@ -379,7 +404,7 @@ bool CheckRecoveredPubKeyFromBlockSignature(CBlockIndex* pindexPrev, const CBloc
 
                 CTxDestination address;
                 TxoutType txType=TxoutType::NONSTANDARD;
-                if(ExtractDestination(coinPrev.out.scriptPubKey, address, &txType)){
+                if(ExtractDestination(scriptPubKey, address, &txType)){
                     if ((txType == TxoutType::PUBKEY || txType == TxoutType::PUBKEYHASH) && std::holds_alternative<PKHash>(address)) {
                         if(pubkey.GetID() == ToKeyID(std::get<PKHash>(address))) {
                             return true;
@@ -395,42 +420,41 @@ bool CheckRecoveredPubKeyFromBlockSignature(CBlockIndex* pindexPrev, const CBloc
 
 bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint& prevout, CCoinsViewCache& view, CChain& chain)
 {
-    std::map<COutPoint, CStakeCache> tmp;
-    return CheckKernel(pindexPrev, nBits, nTimeBlock, prevout, view, tmp, chain);
+    uint256 hashProofOfStake, targetProofOfStake;
+    Coin coinPrev;
+    if(!view.GetCoin(prevout, coinPrev)){
+        if(!GetSpentCoinFromMainChain(pindexPrev, prevout, &coinPrev, chain)) {
+            return error("CheckKernel(): Could not find coin and it was not at the tip");
+        }
+    }
+
+    int nHeight = pindexPrev->nHeight + 1;
+    int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(nHeight);
+    if(nHeight - coinPrev.nHeight < coinbaseMaturity){
+        return error("CheckKernel(): Coin not matured");
+    }
+    CBlockIndex* blockFrom = pindexPrev->GetAncestor(coinPrev.nHeight);
+    if(!blockFrom) {
+        return error("CheckKernel(): Could not find block");
+    }
+    if(coinPrev.IsSpent()){
+        return error("CheckKernel(): Coin is spent");
+    }
+
+    return CheckStakeKernelHash(pindexPrev, nBits, blockFrom->nTime, coinPrev.out.nValue, prevout,
+                                nTimeBlock, hashProofOfStake, targetProofOfStake);
 }
 
-bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint& prevout, CCoinsViewCache& view, const std::map<COutPoint, CStakeCache>& cache, CChain& chain)
+bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint& prevout, CCoinsViewCache& view, const CStakeCacheMap& cache, CChain& chain)
 {
     uint256 hashProofOfStake, targetProofOfStake;
-    auto it=cache.find(prevout);
-    if(it == cache.end()) {
+    const CStakeCache* stake = cache.find(prevout);
+    if(!stake) {
         //not found in cache (shouldn't happen during staking, only during verification which does not use cache)
-        Coin coinPrev;
-        if(!view.GetCoin(prevout, coinPrev)){
-            if(!GetSpentCoinFromMainChain(pindexPrev, prevout, &coinPrev, chain)) {
-                return error("CheckKernel(): Could not find coin and it was not at the tip");
-            }
-        }
-
-        int nHeight = pindexPrev->nHeight + 1;
-        int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(nHeight);
-        if(nHeight - coinPrev.nHeight < coinbaseMaturity){
-            return error("CheckKernel(): Coin not matured");
-        }
-        CBlockIndex* blockFrom = pindexPrev->GetAncestor(coinPrev.nHeight);
-        if(!blockFrom) {
-            return error("CheckKernel(): Could not find block");
-        }
-        if(coinPrev.IsSpent()){
-            return error("CheckKernel(): Coin is spent");
-        }
-
-        return CheckStakeKernelHash(pindexPrev, nBits, blockFrom->nTime, coinPrev.out.nValue, prevout,
-                                    nTimeBlock, hashProofOfStake, targetProofOfStake);
+        return CheckKernel(pindexPrev, nBits, nTimeBlock, prevout, view, chain);
     }else{
         //found in cache
-        const CStakeCache& stake = it->second;
-        if(CheckStakeKernelHash(pindexPrev, nBits, stake.blockFromTime, stake.amount, prevout,
+        if(CheckStakeKernelHash(pindexPrev, nBits, stake->blockFromTime, stake->amount, prevout,
                                     nTimeBlock, hashProofOfStake, targetProofOfStake)){
             //Cache could potentially cause false positive stakes in the event of deep reorgs, so check without cache also
             return CheckKernel(pindexPrev, nBits, nTimeBlock, prevout, view, chain);
@@ -439,20 +463,113 @@ bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBloc
     return false;
 }
 
-bool CheckKernelCache(CBlockIndex *pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint &prevout, const std::map<COutPoint, CStakeCache> &cache, uint256& hashProofOfStake)
+bool CheckKernelCache(CBlockIndex *pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint &prevout, const CStakeCacheMap& cache, uint256& hashProofOfStake)
 {
     uint256 targetProofOfStake;
-    auto it=cache.find(prevout);
-    if(it != cache.end()) {
-        const CStakeCache& stake = it->second;
-        return CheckStakeKernelHash(pindexPrev, nBits, stake.blockFromTime, stake.amount, prevout,
+    const CStakeCache* stake = cache.find(prevout);
+    if(stake) {
+        return CheckStakeKernelHash(pindexPrev, nBits, stake->blockFromTime, stake->amount, prevout,
                                     nTimeBlock, hashProofOfStake, targetProofOfStake);
     }
     return false;
 }
 
-void CacheKernel(std::map<COutPoint, CStakeCache>& cache, const COutPoint& prevout, CBlockIndex* pindexPrev, CCoinsViewCache& view){
-    if(cache.find(prevout) != cache.end()){
+StakeKernelSearch::StakeKernelSearch(const CBlockIndex* pindexPrev, unsigned int nBits, const std::vector<COutPoint>& prevouts, const CStakeCacheMap& cache)
+{
+    int nHeight = pindexPrev->nHeight + 1;
+    fNoBNOverflow = nHeight >= Params().GetConsensus().nReduceBlocktimeHeight;
+    bnTarget.SetCompact(nBits);
+    HashWriter modifierHasher;
+    modifierHasher << pindexPrev->nStakeModifier;
+
+    m_coins.reserve(prevouts.size());
+    for(size_t i = 0; i < prevouts.size(); i++)
+    {
+        const CStakeCache* stake = cache.find(prevouts[i]);
+        if(stake)
+        {
+            HashWriter kernelHasher = modifierHasher;
+            kernelHasher << stake->blockFromTime << prevouts[i].hash << prevouts[i].n;
+            m_coins.push_back(Coin{kernelHasher, stake->blockFromTime, stake->amount, (uint32_t)i});
+        }
+    }
+}
+
+void StakeKernelSearch::Search(uint32_t nTimeBlock, size_t from, size_t to, std::vector<Kernel>& kernels) const
+{
+    // Same computation as CheckStakeKernelHash()
+    for(size_t i = from; i < to; i++)
+    {
+        const Coin& coin = m_coins[i];
+        if(nTimeBlock < coin.blockFromTime)
+            continue;
+
+        HashWriter ss = coin.kernelHasher;
+        ss << nTimeBlock;
+        uint256 hashProofOfStake = ss.GetHash();
+
+        arith_uint256 bnWeight = arith_uint256(coin.amount);
+        arith_uint256 bnProofOfStake = UintToArith256(hashProofOfStake);
+        bool fMeetsTarget = false;
+        if(fNoBNOverflow)
+        {
+            bnProofOfStake /= bnWeight;
+            fMeetsTarget = bnProofOfStake <= bnTarget;
+        }
+        else
+        {
+            fMeetsTarget = bnProofOfStake <= bnTarget * bnWeight;
+        }
+
+        if(fMeetsTarget)
+        {
+            kernels.push_back(Kernel{hashProofOfStake, coin.index});
+        }
+    }
+}
+
+std::vector<StakeKernelSearch::Kernel> StakeKernelSearch::Search(uint32_t nTimeBlock, CCheckQueue<StakeKernelCheck>* queue) const
+{
+    std::vector<Kernel> kernels;
+    if(!queue || m_coins.size() <= STAKE_KERNEL_CHECK_COINS)
+    {
+        Search(nTimeBlock, 0, m_coins.size(), kernels);
+        return kernels;
+    }
+
+    // The workers take the checks from the queue as they become idle, the calling thread joins them in Wait()
+    Mutex kernelsMutex;
+    CCheckQueueControl<StakeKernelCheck> control(queue);
+    std::vector<StakeKernelCheck> checks;
+    for(size_t from = 0; from < m_coins.size(); from += STAKE_KERNEL_CHECK_COINS)
+    {
+        size_t to = std::min(from + STAKE_KERNEL_CHECK_COINS, m_coins.size());
+        checks.emplace_back(this, nTimeBlock, from, to, &kernels, &kernelsMutex);
+    }
+    control.Add(std::move(checks));
+    control.Wait();
+    return kernels;
+}
+
+bool HeaderSignatureCheck::operator()()
+{
+    return CheckRecoveredPubKeyFromBlockSignature(nHeight, *block, scriptPubKey);
+}
+
+bool StakeKernelCheck::operator()()
+{
+    std::vector<StakeKernelSearch::Kernel> found;
+    search->Search(nTimeBlock, from, to, found);
+    if(found.size() > 0)
+    {
+        LOCK(*kernelsMutex);
+        kernels->insert(kernels->end(), found.begin(), found.end());
+    }
+    return true;
+}
+
+void CacheKernel(CStakeCacheMap& cache, const COutPoint& prevout, CBlockIndex* pindexPrev, CCoinsViewCache& view){
+    if(cache.touch(prevout)){
         //already in cache
         return;
     }
@@ -473,7 +590,7 @@ void CacheKernel(std::map<COutPoint, CStakeCache>& cache, const COutPoint& prevo
     }
 
     CStakeCache c(blockFrom->nTime, coinPrev.out.nValue);
-    cache.insert({prevout, c});
+    cache.insert(prevout, c);
 }
 
 /**
@@ -492,16 +609,53 @@ struct BlockScript{
     {}
 };
 
-struct ScriptsElement{
-    BlockScript script;
-    uint256 hash;
-};
-
 /**
- * Cache of the recent mpos scripts for the block reward recipients
- * The max size of the map is 2 * nCacheScripts - nMPoSRewardRecipients, so in this case it is 20
+ * Ring buffer of the mpos scripts of the recent blocks by height, filled when the blocks are connected.
+ * An entry is only used for the block it was made from, so reorganized blocks are missed without
+ * having to clean the cache. Misses are read from the stake and delegate index.
  */
-std::map<int, ScriptsElement> scriptsMap;
+class MPoSScriptCache
+{
+public:
+    bool Read(int nHeight, const uint256& hash, BlockScript& script) const
+    {
+        LOCK(m_mutex);
+        const Entry& entry = m_entries[nHeight % MPOS_SCRIPT_CACHE_SIZE];
+        if(entry.height != nHeight || entry.hash != hash)
+            return false;
+        script = entry.script;
+        return true;
+    }
+
+    void Write(int nHeight, const uint256& hash, const BlockScript& script)
+    {
+        LOCK(m_mutex);
+        Entry& entry = m_entries[nHeight % MPOS_SCRIPT_CACHE_SIZE];
+        entry.height = nHeight;
+        entry.hash = hash;
+        entry.script = script;
+    }
+
+    void Erase(int nHeight, const uint256& hash)
+    {
+        LOCK(m_mutex);
+        Entry& entry = m_entries[nHeight % MPOS_SCRIPT_CACHE_SIZE];
+        if(entry.height == nHeight && entry.hash == hash)
+            entry = Entry();
+    }
+
+private:
+    struct Entry{
+        int height{-1};
+        uint256 hash;
+        BlockScript script;
+    };
+
+    mutable Mutex m_mutex;
+    std::vector<Entry> m_entries GUARDED_BY(m_mutex){MPOS_SCRIPT_CACHE_SIZE};
+};
+
+MPoSScriptCache mposScriptCache;
 
 unsigned int GetStakeMaxCombineInputs() { return 100; }
 
@@ -545,7 +699,7 @@ bool GetDelegationFeeFromContract(const uint160& address, uint8_t& fee, Chainsta
     Delegation delegation;
     QtumDelegation& qtumDelegation = GetQtumDelegation();
     bool ret = qtumDelegation.GetDelegation(address, delegation, chainstate);
-    if(ret) ret &= qtumDelegation.VerifyDelegation(address, delegation);
+    if(ret) ret &= VerifyStakeDelegation(address, delegation);
     if(ret)
     {
         fee = delegation.fee;
@@ -553,64 +707,46 @@ bool GetDelegationFeeFromContract(const uint160& address, uint8_t& fee, Chainsta
     return ret;
 }
 
-bool NeedToEraseScriptFromCache(int nBlockHeight, int nCacheScripts, int nScriptHeight, const ScriptsElement& scriptElement, CChain& chain)
+BlockScript MakeMPoSScript(const uint160& stakeAddress, bool hasDelegate, const uint160& delegateAddress, uint8_t fee)
 {
-    // Erase element from cache if not in range [nBlockHeight - nCacheScripts, nBlockHeight + nCacheScripts]
-    if(nScriptHeight < (nBlockHeight - nCacheScripts) ||
-            nScriptHeight > (nBlockHeight + nCacheScripts))
-        return true;
-
-    // Erase element from cache if hash different
-    CBlockIndex* pblockindex = chain[nScriptHeight];
-    if(pblockindex && pblockindex->GetBlockHash() != scriptElement.hash)
-        return true;
-
-    return false;
-}
-
-void CleanScriptCache(int nHeight, const Consensus::Params &consensusParams, CChain& chain)
-{
-    int nCacheScripts = consensusParams.nMPoSRewardRecipients * 1.5;
-
-    // Remove the scripts from cache that are not used
-    for (std::map<int, ScriptsElement>::iterator it=scriptsMap.begin(); it!=scriptsMap.end();){
-        if(NeedToEraseScriptFromCache(nHeight, nCacheScripts, it->first, it->second, chain))
-        {
-            it = scriptsMap.erase(it);
-        }
-        else{
-            it++;
-        }
+    BlockScript blockScript;
+    if(stakeAddress == uint160())
+    {
+        LogPrint(BCLog::COINSTAKE, "Fail to solve script for mpos reward recipient\n");
+        //This should never fail, but in case it somehow did we don't want it to bring the network to a halt
+        //So, use an OP_RETURN script to burn the coins for the unknown staker
+        blockScript = CScript() << OP_RETURN;
+    }else{
+        // Make public key hash script
+        blockScript = CScript() << OP_DUP << OP_HASH160 << ToByteVector(stakeAddress) << OP_EQUALVERIFY << OP_CHECKSIG;
     }
-}
-
-bool ReadFromScriptCache(BlockScript &script, CBlockIndex* pblockindex, int nHeight, const Consensus::Params &consensusParams, CChain& chain)
-{
-    CleanScriptCache(nHeight, consensusParams, chain);
 
-    // Find the script in the cache
-    std::map<int, ScriptsElement>::iterator it = scriptsMap.find(nHeight);
-    if(it != scriptsMap.end())
+    if(hasDelegate)
     {
-        if(it->second.hash == pblockindex->GetBlockHash())
+        if(delegateAddress == uint160())
         {
-            script = it->second.script;
-            return true;
+            LogPrint(BCLog::COINSTAKE, "Fail to solve script for mpos delegate reward recipient\n");
+            blockScript.delegateScript = CScript() << OP_RETURN;
+        }else{
+            // Make public key hash script
+            blockScript.delegateScript = CScript() << OP_DUP << OP_HASH160 << ToByteVector(delegateAddress) << OP_EQUALVERIFY << OP_CHECKSIG;
         }
+
+        blockScript.fee = fee;
+        blockScript.hasDelegate = true;
     }
 
-    return false;
+    return blockScript;
 }
 
-void AddToScriptCache(BlockScript script, CBlockIndex* pblockindex, int nHeight, const Consensus::Params &consensusParams, CChain& chain)
+void AddMPoSScriptToCache(const CBlockIndex* pindex, const uint160& stakeAddress, bool hasDelegate, const uint160& delegateAddress, uint8_t fee)
 {
-    CleanScriptCache(nHeight, consensusParams, chain);
+    mposScriptCache.Write(pindex->nHeight, pindex->GetBlockHash(), MakeMPoSScript(stakeAddress, hasDelegate, delegateAddress, fee));
+}
 
-    // Add the script into the cache
-    ScriptsElement listElement;
-    listElement.script = script;
-    listElement.hash = pblockindex->GetBlockHash();
-    scriptsMap.insert(std::pair<int, ScriptsElement>(nHeight, listElement));
+void RemoveMPoSScriptFromCache(const CBlockIndex* pindex)
+{
+    mposScriptCache.Erase(pindex->nHeight, pindex->GetBlockHash());
 }
 
 bool AddMPoSScript(std::vector<BlockScript> &mposScriptList, int nHeight, const Consensus::Params &consensusParams, CChain& chain, node::BlockManager& blockman)
@@ -625,58 +761,34 @@ bool AddMPoSScript(std::vector<BlockScript> &mposScriptList, int nHeight, const
 
     // Try find the script from the cache
     BlockScript blockScript;
-    if(ReadFromScriptCache(blockScript, pblockindex, nHeight, consensusParams, chain))
+    if(mposScriptCache.Read(nHeight, pblockindex->GetBlockHash(), blockScript))
     {
         mposScriptList.push_back(blockScript);
         return true;
     }
 
-    // Read the block
+    // Read the block recipients from the index
     uint160 stakeAddress;
-    if(!blockman.m_block_tree_db->ReadStakeIndex(nHeight, stakeAddress)){
+    if(!blockman.m_qtum_index_db->ReadStakeIndex(nHeight, stakeAddress)){
         return false;
     }
 
     // The block reward for PoS is in the second transaction (coinstake) and the second or third output
     if(pblockindex->IsProofOfStake())
     {
-        if(stakeAddress == uint160())
-        {
-            LogPrint(BCLog::COINSTAKE, "Fail to solve script for mpos reward recipient\n");
-            //This should never fail, but in case it somehow did we don't want it to bring the network to a halt
-            //So, use an OP_RETURN script to burn the coins for the unknown staker
-            blockScript = CScript() << OP_RETURN;
-        }else{
-            // Make public key hash script
-            blockScript = CScript() << OP_DUP << OP_HASH160 << ToByteVector(stakeAddress) << OP_EQUALVERIFY << OP_CHECKSIG;
-        }
-
-        if(pblockindex->HasProofOfDelegation())
-        {
-            uint160 delegateAddress;
-            uint8_t fee;
-            if(!blockman.m_block_tree_db->ReadDelegateIndex(nHeight, delegateAddress, fee)){
-                return false;
-            }
-
-            if(delegateAddress == uint160())
-            {
-                LogPrint(BCLog::COINSTAKE, "Fail to solve script for mpos delegate reward recipient\n");
-                blockScript.delegateScript = CScript() << OP_RETURN;
-            }else{
-                // Make public key hash script
-                blockScript.delegateScript = CScript() << OP_DUP << OP_HASH160 << ToByteVector(delegateAddress) << OP_EQUALVERIFY << OP_CHECKSIG;
-            }
-
-            blockScript.fee = fee;
-            blockScript.hasDelegate = true;
+        uint160 delegateAddress;
+        uint8_t fee = 0;
+        bool hasDelegate = pblockindex->HasProofOfDelegation();
+        if(hasDelegate && !blockman.m_qtum_index_db->ReadDelegateIndex(nHeight, delegateAddress, fee)){
+            return false;
         }
+        blockScript = MakeMPoSScript(stakeAddress, hasDelegate, delegateAddress, fee);
 
         // Add the script into the list
         mposScriptList.push_back(blockScript);
 
         // Update script cache
-        AddToScriptCache(blockScript, pblockindex, nHeight, consensusParams, chain);
+        mposScriptCache.Write(nHeight, pblockindex->GetBlockHash(), blockScript);
     }
     else
     {
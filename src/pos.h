@@ -17,7 +17,18 @@
 #include <consensus/consensus.h>
 #include <qtum/posutils.h>
 
-void CacheKernel(std::map<COutPoint, CStakeCache>& cache, const COutPoint& prevout, CBlockIndex* pindexPrev, CCoinsViewCache& view);
+class QtumDelegation;
+
+// Delegation contract shared by the proof-of-stake checks
+QtumDelegation& GetQtumDelegation();
+
+// Verify that PoD is the proof that address delegates to staker, through the signature cache
+bool VerifyProofOfDelegation(const uint160& address, const uint160& staker, const std::vector<unsigned char>& vchPoD);
+
+// QtumDelegation::VerifyDelegation with the proof of delegation verified through the signature cache
+bool VerifyStakeDelegation(const uint160& address, const Delegation& delegation);
+
+void CacheKernel(CStakeCacheMap& cache, const COutPoint& prevout, CBlockIndex* pindexPrev, CCoinsViewCache& view);
 
 // Compute the hash modifier for proof-of-stake
 uint256 ComputeStakeModifier(const CBlockIndex* pindexPrev, const uint256& kernel);
@@ -42,13 +53,99 @@ bool CheckBlockInputPubKeyMatchesOutputPubKey(const CBlock& block, CCoinsViewCac
 
 // Recover the pubkey and check that it matches the prevoutStake's scriptPubKey.
 bool CheckRecoveredPubKeyFromBlockSignature(CBlockIndex* pindexPrev, const CBlockHeader& block, CCoinsViewCache& view, CChain& chain);
+// Same check, for a block at height nHeight whose prevoutStake has scriptPubKey
+bool CheckRecoveredPubKeyFromBlockSignature(int nHeight, const CBlockHeader& block, const CScript& scriptPubKey);
 
 // Wrapper around CheckStakeKernelHash()
 // Also checks existence of kernel input and min age
 // Convenient for searching a kernel
 bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint& prevout, CCoinsViewCache& view, CChain& chain);
-bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint& prevout, CCoinsViewCache& view, const std::map<COutPoint, CStakeCache>& cache, CChain& chain);
-bool CheckKernelCache(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint& prevout, const std::map<COutPoint, CStakeCache>& cache, uint256& hashProofOfStake);
+bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint& prevout, CCoinsViewCache& view, const CStakeCacheMap& cache, CChain& chain);
+bool CheckKernelCache(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const COutPoint& prevout, const CStakeCacheMap& cache, uint256& hashProofOfStake);
+
+class StakeKernelCheck;
+template <typename T>
+class CCheckQueue;
+
+// Number of coins checked by one StakeKernelCheck
+static const size_t STAKE_KERNEL_CHECK_COINS = 256;
+// Maximum number of checks taken at once by a kernel search worker
+static const unsigned int STAKE_KERNEL_QUEUE_BATCH_SIZE = 8;
+
+// Kernel search over the staking coins of a wallet for one tip.
+// The coins are kept in a flat array with their cached stake data, and the stake modifier
+// and target are read once. The kernel of a coin only differs by the block time, which is
+// serialized last, so each coin keeps the hasher with the rest of its kernel written and
+// checking it for a block time only finalizes that hash.
+// The results are the same as the ones of CheckKernelCache() for each coin.
+class StakeKernelSearch
+{
+public:
+    struct Coin
+    {
+        HashWriter kernelHasher; // Hasher that has the kernel written up to the block time
+        uint32_t blockFromTime;
+        CAmount amount;
+        uint32_t index; // Position of the coin in the searched prevouts
+    };
+
+    struct Kernel
+    {
+        uint256 hashProofOfStake;
+        uint32_t index;
+    };
+
+    // The prevouts that are not in the cache can not stake and are left out
+    StakeKernelSearch(const CBlockIndex* pindexPrev, unsigned int nBits, const std::vector<COutPoint>& prevouts, const CStakeCacheMap& cache);
+
+    size_t Size() const { return m_coins.size(); }
+
+    // Find the kernels of the coins in [from, to) that meet the target at nTimeBlock
+    void Search(uint32_t nTimeBlock, size_t from, size_t to, std::vector<Kernel>& kernels) const;
+
+    // Find the kernels of all coins at nTimeBlock, split into checks run by the queue workers when queue is set
+    std::vector<Kernel> Search(uint32_t nTimeBlock, CCheckQueue<StakeKernelCheck>* queue) const;
+
+private:
+    bool fNoBNOverflow;
+    arith_uint256 bnTarget;
+    std::vector<Coin> m_coins;
+};
+
+// Closure representing a range of coins searched by StakeKernelSearch
+class StakeKernelCheck
+{
+private:
+    const StakeKernelSearch* search{nullptr};
+    uint32_t nTimeBlock{0};
+    size_t from{0};
+    size_t to{0};
+    std::vector<StakeKernelSearch::Kernel>* kernels{nullptr};
+    Mutex* kernelsMutex{nullptr};
+
+public:
+    StakeKernelCheck() = default;
+    StakeKernelCheck(const StakeKernelSearch* search_, uint32_t nTimeBlock_, size_t from_, size_t to_, std::vector<StakeKernelSearch::Kernel>* kernels_, Mutex* kernelsMutex_) :
+        search(search_), nTimeBlock(nTimeBlock_), from(from_), to(to_), kernels(kernels_), kernelsMutex(kernelsMutex_) {}
+
+    bool operator()();
+};
+
+// Closure representing the block signature check of a header, run by the header signature check workers
+class HeaderSignatureCheck
+{
+private:
+    const CBlockHeader* block{nullptr};
+    int nHeight{0};
+    CScript scriptPubKey;
+
+public:
+    HeaderSignatureCheck() = default;
+    HeaderSignatureCheck(const CBlockHeader* block_, int nHeight_, const CScript& scriptPubKey_) :
+        block(block_), nHeight(nHeight_), scriptPubKey(scriptPubKey_) {}
+
+    bool operator()();
+};
 
 unsigned int GetStakeMaxCombineInputs();
 
@@ -66,6 +163,15 @@ unsigned int GetStakeSplitOutputs();
 
 int64_t GetStakeSplitThreshold();
 
+/** Number of recent blocks whose mpos reward scripts are cached, it covers the coinbase maturity and the recipients */
+static constexpr int MPOS_SCRIPT_CACHE_SIZE = 2048;
+
+/** Cache the mpos reward scripts of a connected block, from the stake and delegate index data */
+void AddMPoSScriptToCache(const CBlockIndex* pindex, const uint160& stakeAddress, bool hasDelegate, const uint160& delegateAddress, uint8_t fee);
+
+/** Remove the mpos reward scripts of a disconnected block from the cache */
+void RemoveMPoSScriptFromCache(const CBlockIndex* pindex);
+
 bool GetMPoSOutputs(std::vector<CTxOut>& mposOutputList, int64_t nRewardPiece, int nHeight, const Consensus::Params& consensusParams, CChain& chain, node::BlockManager& blockman);
 
 bool CreateMPoSOutputs(CMutableTransaction& txNew, int64_t nRewardPiece, int nHeight, const Consensus::Params& consensusParams, CChain& chain, node::BlockManager& blockman);
@@ -5,6 +5,8 @@
 #ifndef BITCOIN_PREVECTOR_H
 #define BITCOIN_PREVECTOR_H
 
+#include <support/arena.h>
+
 #include <assert.h>
 #include <cstdlib>
 #include <stdint.h>
@@ -32,10 +34,14 @@
  *
  *  The data type T must be movable by memmove/realloc(). Once we switch to C++,
  *  move constructors can be used instead.
+ *
+ *  While the thread has a DeserializeArenaScope, the indirect allocations are
+ *  taken from its arena. The top bit of the capacity marks these buffers.
  */
 template<unsigned int N, typename T, typename Size = uint32_t, typename Diff = int32_t>
 class prevector {
     static_assert(std::is_trivially_copyable_v<T>);
+    static_assert(std::is_unsigned_v<Size>);
 
 public:
     typedef Size size_type;
@@ -169,32 +175,65 @@ private:
     const T* indirect_ptr(difference_type pos) const { return reinterpret_cast<const T*>(_union.indirect_contents.indirect) + pos; }
     bool is_direct() const { return _size <= N; }
 
+    //! Set in the capacity of a buffer taken from a DeserializeArena
+    static constexpr size_type ARENA_BUFFER = size_type(size_type(1) << (sizeof(size_type) * 8 - 1));
+
+    bool is_arena_buffer() const { return _union.indirect_contents.capacity & ARENA_BUFFER; }
+
+    /** Allocate a buffer of new_capacity elements, from the thread's arena if any. Returns it with its capacity field. */
+    static std::pair<char*, size_type> allocate_indirect(size_type new_capacity) {
+        assert(!(new_capacity & ARENA_BUFFER));
+        if (DeserializeArena* arena = DeserializeArena::Current()) {
+            return {static_cast<char*>(arena->Allocate(((size_t)sizeof(T)) * new_capacity)), size_type(new_capacity | ARENA_BUFFER)};
+        }
+        /* FIXME: Because malloc/realloc here won't call new_handler if allocation fails, assert
+            success. These should instead use an allocator or new/delete so that handlers
+            are called as necessary, but performance would be slightly degraded by doing so. */
+        char* new_indirect = static_cast<char*>(malloc(((size_t)sizeof(T)) * new_capacity));
+        assert(new_indirect);
+        return {new_indirect, new_capacity};
+    }
+
+    static void free_indirect(char* indirect, bool arena_buffer) {
+        if (arena_buffer) {
+            DeserializeArena::Release(indirect);
+        } else {
+            free(indirect);
+        }
+    }
+
     void change_capacity(size_type new_capacity) {
         if (new_capacity <= N) {
             if (!is_direct()) {
                 T* indirect = indirect_ptr(0);
+                const bool arena_buffer = is_arena_buffer();
                 T* src = indirect;
                 T* dst = direct_ptr(0);
                 memcpy(dst, src, size() * sizeof(T));
-                free(indirect);
+                free_indirect(reinterpret_cast<char*>(indirect), arena_buffer);
                 _size -= N + 1;
             }
         } else {
             if (!is_direct()) {
-                /* FIXME: Because malloc/realloc here won't call new_handler if allocation fails, assert
-                    success. These should instead use an allocator or new/delete so that handlers
-                    are called as necessary, but performance would be slightly degraded by doing so. */
-                _union.indirect_contents.indirect = static_cast<char*>(realloc(_union.indirect_contents.indirect, ((size_t)sizeof(T)) * new_capacity));
-                assert(_union.indirect_contents.indirect);
-                _union.indirect_contents.capacity = new_capacity;
+                if (!is_arena_buffer() && !DeserializeArena::Current()) {
+                    _union.indirect_contents.indirect = static_cast<char*>(realloc(_union.indirect_contents.indirect, ((size_t)sizeof(T)) * new_capacity));
+                    assert(_union.indirect_contents.indirect);
+                    _union.indirect_contents.capacity = new_capacity;
+                } else {
+                    // Arena buffers are not resized in place, the elements move to a new buffer
+                    const auto [new_indirect, capacity] = allocate_indirect(new_capacity);
+                    memcpy(new_indirect, _union.indirect_contents.indirect, size() * sizeof(T));
+                    free_indirect(_union.indirect_contents.indirect, is_arena_buffer());
+                    _union.indirect_contents.indirect = new_indirect;
+                    _union.indirect_contents.capacity = capacity;
+                }
             } else {
-                char* new_indirect = static_cast<char*>(malloc(((size_t)sizeof(T)) * new_capacity));
-                assert(new_indirect);
+                const auto [new_indirect, capacity] = allocate_indirect(new_capacity);
                 T* src = direct_ptr(0);
                 T* dst = reinterpret_cast<T*>(new_indirect);
                 memcpy(dst, src, size() * sizeof(T));
                 _union.indirect_contents.indirect = new_indirect;
-                _union.indirect_contents.capacity = new_capacity;
+                _union.indirect_contents.capacity = capacity;
                 _size += N + 1;
             }
         }
@@ -303,7 +342,7 @@ public:
         if (is_direct()) {
             return N;
         } else {
-            return _union.indirect_contents.capacity;
+            return _union.indirect_contents.capacity & ~ARENA_BUFFER;
         }
     }
 
@@ -460,7 +499,7 @@ public:
 
     ~prevector() {
         if (!is_direct()) {
-            free(_union.indirect_contents.indirect);
+            free_indirect(_union.indirect_contents.indirect, is_arena_buffer());
             _union.indirect_contents.indirect = nullptr;
         }
     }
@@ -513,10 +552,15 @@ public:
         if (is_direct()) {
             return 0;
         } else {
-            return ((size_t)(sizeof(T))) * _union.indirect_contents.capacity;
+            return ((size_t)(sizeof(T))) * (_union.indirect_contents.capacity & ~ARENA_BUFFER);
         }
     }
 
+    //! Whether the elements are in a buffer taken from a DeserializeArena
+    bool arena_allocated() const {
+        return !is_direct() && is_arena_buffer();
+    }
+
     value_type* data() {
         return item_ptr(0);
     }
@@ -144,3 +144,74 @@ void CBlockHeader::SetProofOfDelegation(const std::vector<unsigned char> &vchPoD
     vchBlockSigDlgt = vchSign;
     vchBlockSigDlgt.insert(vchBlockSigDlgt.end(), vchPoD.begin(), vchPoD.end());
 }
+
+namespace {
+void SkipInputs(SpanReader& s, uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++) {
+        s.ignore(sizeof(uint256) + sizeof(uint32_t)); // prevout
+        s.ignore(ReadCompactSize(s)); // scriptSig
+        s.ignore(sizeof(uint32_t)); // nSequence
+    }
+}
+
+void SkipOutputs(SpanReader& s, uint64_t count)
+{
+    for (uint64_t i = 0; i < count; i++) {
+        s.ignore(sizeof(CAmount)); // nValue
+        s.ignore(ReadCompactSize(s)); // scriptPubKey
+    }
+}
+} // namespace
+
+bool StripBlockWitnesses(Span<const unsigned char> block, std::vector<unsigned char>& stripped)
+{
+    stripped.clear();
+    stripped.reserve(block.size());
+    try {
+        SpanReader s{SER_NETWORK, PROTOCOL_VERSION, block};
+        auto offset = [&] { return block.size() - s.size(); };
+        auto append = [&](size_t begin, size_t end) { stripped.insert(stripped.end(), block.begin() + begin, block.begin() + end); };
+
+        CBlockHeader header;
+        s >> header;
+        const uint64_t tx_count = ReadCompactSize(s);
+        append(0, offset());
+        for (uint64_t i = 0; i < tx_count; i++) {
+            const size_t tx_begin = offset();
+            s.ignore(sizeof(int32_t)); // nVersion
+            uint64_t vin_count = ReadCompactSize(s);
+            if (vin_count != 0) {
+                // No witness, the transaction is copied as is
+                SkipInputs(s, vin_count);
+                SkipOutputs(s, ReadCompactSize(s));
+                s.ignore(sizeof(uint32_t)); // nLockTime
+                append(tx_begin, offset());
+                continue;
+            }
+
+            // Extended format: the dummy vin and the flags are dropped with the witnesses
+            uint8_t flags;
+            s >> flags;
+            if (flags != 1) return false;
+            append(tx_begin, tx_begin + sizeof(int32_t));
+            const size_t body_begin = offset();
+            vin_count = ReadCompactSize(s);
+            SkipInputs(s, vin_count);
+            SkipOutputs(s, ReadCompactSize(s));
+            append(body_begin, offset());
+            for (uint64_t j = 0; j < vin_count; j++) {
+                const uint64_t stack_size = ReadCompactSize(s);
+                for (uint64_t k = 0; k < stack_size; k++) {
+                    s.ignore(ReadCompactSize(s));
+                }
+            }
+            const size_t locktime_begin = offset();
+            s.ignore(sizeof(uint32_t)); // nLockTime
+            append(locktime_begin, offset());
+        }
+        return s.empty();
+    } catch (const std::ios_base::failure&) {
+        return false;
+    }
+}
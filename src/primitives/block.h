@@ -214,4 +214,10 @@ struct CBlockLocator
     }
 };
 
+/**
+ * Rewrite a block serialized with witnesses into its serialization without them,
+ * working on the bytes only. Returns false when block is not a valid serialization.
+ */
+bool StripBlockWitnesses(Span<const unsigned char> block, std::vector<unsigned char>& stripped);
+
 #endif // BITCOIN_PRIMITIVES_BLOCK_H
@@ -9,6 +9,7 @@
 #include <hash.h>
 #include <script/script.h>
 #include <serialize.h>
+#include <support/arena.h>
 #include <tinyformat.h>
 #include <uint256.h>
 #include <util/strencodings.h>
@@ -99,6 +100,25 @@ CAmount CTransaction::GetValueOut() const
     return nValueOut;
 }
 
+bool CTransaction::HasArenaScripts() const
+{
+    for (const CTxIn& txin : vin) {
+        if (txin.scriptSig.arena_allocated()) return true;
+    }
+    for (const CTxOut& txout : vout) {
+        if (txout.scriptPubKey.arena_allocated()) return true;
+    }
+    return false;
+}
+
+CTransactionRef UnshareArenaScripts(const CTransactionRef& tx)
+{
+    if (!tx || !tx->HasArenaScripts()) return tx;
+    // Copy with the default allocator even when called under a DeserializeArenaScope
+    DeserializeArenaScope no_arena{nullptr};
+    return MakeTransactionRef(CMutableTransaction(*tx));
+}
+
 unsigned int CTransaction::GetTotalSize() const
 {
     return ::GetSerializeSize(*this, PROTOCOL_VERSION);
@@ -381,6 +381,9 @@ public:
     }
     bool HasOpSender() const;
 
+    //! Whether a script of the transaction has its buffer in a DeserializeArena
+    bool HasArenaScripts() const;
+
     bool IsCoinBase() const
     {
         return (vin.size() == 1 && vin[0].prevout.IsNull() && vout.size() >= 1);
@@ -471,6 +474,12 @@ struct CMutableTransaction
 typedef std::shared_ptr<const CTransaction> CTransactionRef;
 template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
 
+/**
+ * Return @p tx, or a copy of it with the default allocator if its scripts are in a DeserializeArena.
+ * A transaction kept past its block is unshared so that it does not pin the chunks of the block.
+ */
+CTransactionRef UnshareArenaScripts(const CTransactionRef& tx);
+
 /** A generic txid reference (txid or wtxid). */
 class GenTxid
 {
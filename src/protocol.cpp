@@ -45,6 +45,11 @@ const char *GETCFCHECKPT="getcfcheckpt";
 const char *CFCHECKPT="cfcheckpt";
 const char *WTXIDRELAY="wtxidrelay";
 const char *SENDTXRCNCL="sendtxrcncl";
+const char *REQRECON="reqrecon";
+const char *SKETCH="sketch";
+const char *RECONCILDIFF="reconcildiff";
+const char *GETSTATEDATA="getstatedata";
+const char *STATEDATA="statedata";
 } // namespace NetMsgType
 
 /** All known message types. Keep this in the same order as the list of
@@ -86,6 +91,11 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::CFCHECKPT,
     NetMsgType::WTXIDRELAY,
     NetMsgType::SENDTXRCNCL,
+    NetMsgType::REQRECON,
+    NetMsgType::SKETCH,
+    NetMsgType::RECONCILDIFF,
+    NetMsgType::GETSTATEDATA,
+    NetMsgType::STATEDATA,
 };
 const static std::vector<std::string> allNetMessageTypesVec(std::begin(allNetMessageTypes), std::end(allNetMessageTypes));
 
@@ -198,6 +208,7 @@ static std::string serviceFlagToStr(size_t bit)
     case NODE_WITNESS:         return "WITNESS";
     case NODE_COMPACT_FILTERS: return "COMPACT_FILTERS";
     case NODE_NETWORK_LIMITED: return "NETWORK_LIMITED";
+    case NODE_CONTRACT_STATE:  return "CONTRACT_STATE";
     // Not using default, so we get warned when a case is missing
     }
 
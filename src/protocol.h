@@ -264,6 +264,32 @@ extern const char* WTXIDRELAY;
  * txreconciliation, as described by BIP 330.
  */
 extern const char* SENDTXRCNCL;
+/**
+ * Requests a sketch of the transactions to reconcile. Contains the size of the set of the
+ * requester and the coefficient q used to estimate the set difference, as described by BIP 330.
+ */
+extern const char* REQRECON;
+/**
+ * Contains a sketch of the short ids of the transactions to reconcile, in reply to a reqrecon,
+ * as described by BIP 330.
+ */
+extern const char* SKETCH;
+/**
+ * Ends a reconciliation: whether the set difference was found, and the short ids of the
+ * transactions the sender is missing, as described by BIP 330.
+ */
+extern const char* RECONCILDIFF;
+/**
+ * getstatedata requests items of the contract state, trie nodes, contract code and the keys
+ * of trie leaves, by the hash of their data.
+ * Only available with service bit NODE_CONTRACT_STATE.
+ */
+extern const char* GETSTATEDATA;
+/**
+ * statedata is a response to a getstatedata request containing the requested items the node
+ * has, in the order of the request.
+ */
+extern const char* STATEDATA;
 }; // namespace NetMsgType
 
 /* Get a vector of all valid message types (see above) */
@@ -291,6 +317,9 @@ enum ServiceFlags : uint64_t {
     // serving the last 288 (2 day) blocks
     // See BIP159 for details on how this is implemented.
     NODE_NETWORK_LIMITED = (1 << 10),
+    // NODE_CONTRACT_STATE means the node will serve the trie nodes of its contract state,
+    // for peers to download the contract state of a block.
+    NODE_CONTRACT_STATE = (1 << 24),
 
     // Bits 24-31 are reserved for temporary experiments. Just pick a bit that
     // isn't getting used, or one not being used much, and notify the
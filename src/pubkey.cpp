@@ -217,6 +217,28 @@ bool XOnlyPubKey::VerifySchnorr(const uint256& msg, Span<const unsigned char> si
     return secp256k1_schnorrsig_verify(secp256k1_context_static, sigbytes.data(), msg.begin(), 32, &pubkey);
 }
 
+bool XOnlyPubKey::VerifySchnorrBatch(Span<const XOnlyPubKey> pubkeys, Span<const uint256> msgs, Span<const std::array<unsigned char, 64>> sigs)
+{
+    assert(pubkeys.size() == msgs.size() && msgs.size() == sigs.size());
+    std::vector<secp256k1_xonly_pubkey> parsed(pubkeys.size());
+    std::vector<const secp256k1_xonly_pubkey*> pubkey_ptrs(pubkeys.size());
+    std::vector<const unsigned char*> msg_ptrs(pubkeys.size());
+    std::vector<const unsigned char*> sig_ptrs(pubkeys.size());
+    for (size_t i = 0; i < pubkeys.size(); ++i) {
+        if (!secp256k1_xonly_pubkey_parse(secp256k1_context_static, &parsed[i], pubkeys[i].data())) return false;
+        pubkey_ptrs[i] = &parsed[i];
+        msg_ptrs[i] = msgs[i].begin();
+        sig_ptrs[i] = sigs[i].data();
+    }
+    // Room for the multiplication of all the points at once up to a few thousand signatures,
+    // larger batches are multiplied in parts
+    const size_t scratch_size = std::min<size_t>(4096 + 2 * 1024 * pubkeys.size(), 4 << 20);
+    secp256k1_scratch_space* scratch = secp256k1_scratch_space_create(secp256k1_context_static, scratch_size);
+    const int ret = secp256k1_schnorrsig_verify_batch(secp256k1_context_static, scratch, sig_ptrs.data(), msg_ptrs.data(), pubkey_ptrs.data(), pubkeys.size());
+    secp256k1_scratch_space_destroy(secp256k1_context_static, scratch);
+    return ret;
+}
+
 static const HashWriter HASHER_TAPTWEAK{TaggedHash("TapTweak")};
 
 uint256 XOnlyPubKey::ComputeTapTweakHash(const uint256* merkle_root) const
@@ -12,6 +12,7 @@
 #include <span.h>
 #include <uint256.h>
 
+#include <array>
 #include <cstring>
 #include <optional>
 #include <vector>
@@ -261,6 +262,13 @@ public:
      */
     bool VerifySchnorr(const uint256& msg, Span<const unsigned char> sigbytes) const;
 
+    /** Verify Schnorr signatures together, which is faster than one by one.
+     *
+     * The i-th signature is checked against pubkeys[i] and msgs[i]. Returns false if
+     * any of them is invalid.
+     */
+    static bool VerifySchnorrBatch(Span<const XOnlyPubKey> pubkeys, Span<const uint256> msgs, Span<const std::array<unsigned char, 64>> sigs);
+
     /** Compute the Taproot tweak as specified in BIP341, with *this as internal
      * key:
      *  - if merkle_root == nullptr: H_TapTweak(xonly_pubkey)
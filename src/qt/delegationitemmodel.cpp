@@ -100,7 +100,10 @@ private Q_SLOTS:
 
         // No delegation contract, no update
         if(!details.c_contract_return)
+        {
+            Q_EMIT itemSkipped(hash);
             return;
+        }
 
         if(details.w_hash.ToString() == sHash)
         {
@@ -195,6 +198,8 @@ private Q_SLOTS:
 Q_SIGNALS:
     // Signal that item in changed
     void itemChanged(QString hash, qint64 balance, qint64 stake, qint64 weight, qint32 status);
+    // Signal that item could not be read
+    void itemSkipped(QString hash);
 };
 
 #include <qt/delegationitemmodel.moc>
@@ -323,6 +328,7 @@ DelegationItemModel::DelegationItemModel(WalletModel *parent):
     worker = new DelegationWorker(walletModel);
     worker->moveToThread(&(t));
     connect(worker, &DelegationWorker::itemChanged, this, &DelegationItemModel::itemChanged);
+    connect(worker, &DelegationWorker::itemSkipped, this, &DelegationItemModel::itemSkipped);
 
     t.start();
 
@@ -477,6 +483,11 @@ void DelegationItemModel::checkDelegationChanged()
     for(int i = 0; i < priv->cachedDelegationItem.size(); i++)
     {
         DelegationItemEntry delegationEntry = priv->cachedDelegationItem[i];
+        // A refresh still queued reads the latest data, skip it when blocks come faster than they are read
+        QString hash = QString::fromStdString(delegationEntry.hash.ToString());
+        if(pendingUpdates.contains(hash))
+            continue;
+        pendingUpdates.insert(hash);
         updateDelegationData(delegationEntry);
     }
 }
@@ -548,6 +559,7 @@ void DelegationItemModel::itemChanged(QString hash, qint64 balance, qint64 stake
     if(!priv)
         return;
 
+    pendingUpdates.remove(hash);
     uint256 updated;
     updated.SetHex(hash.toStdString());
 
@@ -557,6 +569,11 @@ void DelegationItemModel::itemChanged(QString hash, qint64 balance, qint64 stake
         DelegationItemEntry delegationEntry = priv->cachedDelegationItem[i];
         if(delegationEntry.hash == updated)
         {
+            // Most blocks change nothing, do not notify the views then
+            if(delegationEntry.balance == balance && delegationEntry.stake == stake &&
+                    delegationEntry.weight == weight && delegationEntry.status == status)
+                break;
+
             delegationEntry.balance = balance;
             delegationEntry.stake = stake;
             delegationEntry.weight = weight;
@@ -567,6 +584,11 @@ void DelegationItemModel::itemChanged(QString hash, qint64 balance, qint64 stake
     }
 }
 
+void DelegationItemModel::itemSkipped(QString hash)
+{
+    pendingUpdates.remove(hash);
+}
+
 void DelegationItemModel::join()
 {
     if(t.isRunning())
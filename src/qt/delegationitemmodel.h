@@ -2,6 +2,7 @@
 #define DELEGATIONITEMMODEL_H
 
 #include <QAbstractItemModel>
+#include <QSet>
 #include <QStringList>
 #include <QThread>
 #include <QtGlobal>
@@ -76,6 +77,7 @@ public:
 public Q_SLOTS:
     void checkDelegationChanged();
     void itemChanged(QString hash, qint64 balance, qint64 stake, qint64 weight, qint32 status);
+    void itemSkipped(QString hash);
 
 private Q_SLOTS:
     void updateDelegationData(const QString &hash, int status, bool showDelegation);
@@ -92,6 +94,8 @@ private:
     DelegationItemPriv* priv;
     DelegationWorker* worker;
     QThread t;
+    // Items whose data is queued to be read by the worker
+    QSet<QString> pendingUpdates;
     std::unique_ptr<interfaces::Handler> m_handler_delegation_changed;
 
     friend class DelegationItemPriv;
@@ -1,71 +1,20 @@
 #include <qt/eventlog.h>
-#include <qt/execrpccommand.h>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <uint256.h>
 
 namespace EventLog_NS
 {
-static const QString RPC_SERACH_LOGS = "searchlogs";
-static const QString PARAM_FROM_BLOCK = "fromBlock";
-static const QString PARAM_TO_BLOCK = "toBlock";
-static const QString PARAM_ADDRESSES = "address";
-static const QString PARAM_TOPICS = "topics";
-static const QString PARAM_MINCONF = "minconf";
+// Number of receipts read from the node at once, the node is not locked between the pages
+static const size_t SEARCH_PAGE_SIZE = 1000;
 }
 using namespace EventLog_NS;
 
-QString createJsonString(std::string key, const std::vector<std::string> value)
-{
-    QJsonObject json;
-    QJsonArray array;
-    for(size_t i = 0; i < value.size(); i++)
-    {
-        array.append(QJsonValue(QString::fromStdString(value[i])));
-    }
-    json.insert(QString::fromStdString(key), array);
-
-    QJsonDocument doc(json);
-    QString retString(doc.toJson(QJsonDocument::Compact));
-    retString.insert(0, "'");
-    retString.append("'");
-
-    return retString;
-}
-
-EventLog::EventLog():
-    m_RPCCommand(0)
-{
-    // Create new searchlogs command line interface
-    QStringList lstMandatory;
-    lstMandatory.append(PARAM_FROM_BLOCK);
-    lstMandatory.append(PARAM_TO_BLOCK);
-    QStringList lstOptional;
-    lstOptional.append(PARAM_ADDRESSES);
-    lstOptional.append(PARAM_TOPICS);
-    lstOptional.append(PARAM_MINCONF);
-    m_RPCCommand = new ExecRPCCommand(RPC_SERACH_LOGS, lstMandatory, lstOptional, QMap<QString, QString>());
-}
-
-EventLog::~EventLog()
-{
-    if(m_RPCCommand)
-    {
-        delete m_RPCCommand;
-        m_RPCCommand = 0;
-    }
-}
-
-bool EventLog::searchTokenTx(interfaces::Node& node, const WalletModel* wallet_model, int64_t fromBlock, int64_t toBlock, int64_t minconf, std::string eventName, std::string strContractAddress, std::string strSenderAddress, int numTopics, QVariant &result)
+bool EventLog::searchTokenTx(interfaces::Node& node, int64_t fromBlock, int64_t toBlock, int64_t minconf, std::string eventName, std::string strContractAddress, std::string strSenderAddress, int numTopics, const PageFn& fn)
 {
     std::vector<std::string> addresses;
     addresses.push_back(strContractAddress);
 
     std::vector<std::string> topics;
     // Skip the event type check
-    static std::string nullRecord = uint256().ToString();
-    topics.push_back(nullRecord);
+    topics.push_back(std::string());
     if(numTopics > 1)
     {
         // Match the log with sender address
@@ -77,46 +26,27 @@ bool EventLog::searchTokenTx(interfaces::Node& node, const WalletModel* wallet_m
         topics.push_back(strSenderAddress);
     }
 
-    return search(node, wallet_model, fromBlock, toBlock, minconf, addresses, topics, result);
+    return search(node, fromBlock, toBlock, minconf, addresses, topics, fn);
 }
 
-bool EventLog::search(interfaces::Node& node, const WalletModel* wallet_model, int64_t fromBlock, int64_t toBlock, int64_t minconf, const std::vector<std::string> addresses, const std::vector<std::string> topics, QVariant &result)
+bool EventLog::search(interfaces::Node& node, int64_t fromBlock, int64_t toBlock, int64_t minconf, const std::vector<std::string>& addresses, const std::vector<std::string>& topics, const PageFn& fn)
 {
-    setStartBlock(fromBlock);
-    setEndBlock(toBlock);
-    setAddresses(addresses);
-    setTopics(topics);
-    setMinconf(minconf);
+    interfaces::LogQuery query;
+    query.from_block = fromBlock;
+    query.to_block = toBlock;
+    query.minconf = minconf;
+    query.addresses = addresses;
+    query.topics = topics;
 
-    QString resultJson;
-    QString errorMessage;
-    if(!m_RPCCommand->exec(node, wallet_model, m_lstParams, result, resultJson, errorMessage))
-        return false;
-    return true;
-}
-
-void EventLog::setStartBlock(int64_t fromBlock)
-{
-    m_lstParams[PARAM_FROM_BLOCK] = QString::number(fromBlock);
-}
-
-void EventLog::setEndBlock(int64_t toBlock)
-{
-    m_lstParams[PARAM_TO_BLOCK] = QString::number(toBlock);
-}
-
-void EventLog::setAddresses(const std::vector<std::string> addresses)
-{
-    m_lstParams[PARAM_ADDRESSES] = createJsonString("addresses", addresses);
-}
-
-void EventLog::setTopics(const std::vector<std::string> topics)
-{
-    m_lstParams[PARAM_TOPICS] = createJsonString("topics", topics);
-}
+    std::optional<interfaces::LogQueryCursor> cursor;
+    do
+    {
+        std::vector<interfaces::LogQueryReceipt> receipts;
+        if(!node.searchLogs(query, SEARCH_PAGE_SIZE, cursor, receipts))
+            return false;
+        if(!fn(receipts) || node.shutdownRequested())
+            break;
+    } while(cursor);
 
-void EventLog::setMinconf(int64_t minconf)
-{
-    m_lstParams[PARAM_MINCONF] = QString::number(minconf);
+    return true;
 }
-
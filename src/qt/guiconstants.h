@@ -13,6 +13,9 @@ using namespace std::chrono_literals;
 /* A delay between model updates */
 static constexpr auto MODEL_UPDATE_DELAY{2000ms};
 
+/* A delay over which the wallet transaction changes are batched for the models */
+static constexpr auto TRANSACTION_NOTIFY_DELAY{250ms};
+
 /* A delay between shutdown pollings */
 static constexpr auto SHUTDOWN_POLLING_DELAY{200ms};
 
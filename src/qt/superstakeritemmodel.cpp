@@ -374,6 +374,11 @@ void SuperStakerItemModel::checkSuperStakerChanged()
     for(int i = 0; i < priv->cachedSuperStakerItem.size(); i++)
     {
         SuperStakerItemEntry superStakerEntry = priv->cachedSuperStakerItem[i];
+        // A refresh still queued reads the latest data, skip it when blocks come faster than they are read
+        QString hash = QString::fromStdString(superStakerEntry.hash.ToString());
+        if(pendingUpdates.contains(hash))
+            continue;
+        pendingUpdates.insert(hash);
         updateSuperStakerData(superStakerEntry);
     }
 }
@@ -442,6 +447,7 @@ void SuperStakerItemModel::itemChanged(QString hash, qint64 balance, qint64 stak
     if(!priv)
         return;
 
+    pendingUpdates.remove(hash);
     uint256 updated;
     updated.SetHex(hash.toStdString());
 
@@ -451,6 +457,11 @@ void SuperStakerItemModel::itemChanged(QString hash, qint64 balance, qint64 stak
         SuperStakerItemEntry superStakerEntry = priv->cachedSuperStakerItem[i];
         if(superStakerEntry.hash == updated)
         {
+            // Most blocks change nothing, do not notify the views then
+            if(superStakerEntry.balance == balance && superStakerEntry.stake == stake && superStakerEntry.weight == weight &&
+                    superStakerEntry.delegationsWeight == delegationsWeight && superStakerEntry.staking == staking)
+                break;
+
             superStakerEntry.balance = balance;
             superStakerEntry.stake = stake;
             superStakerEntry.weight = weight;
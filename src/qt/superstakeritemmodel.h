@@ -2,6 +2,7 @@
 #define SUPERSTAKERITEMMODEL_H
 
 #include <QAbstractItemModel>
+#include <QSet>
 #include <QStringList>
 #include <QThread>
 
@@ -78,6 +79,8 @@ private:
     SuperStakerItemPriv* priv;
     SuperStakerWorker* worker;
     QThread t;
+    // Items whose data is queued to be read by the worker
+    QSet<QString> pendingUpdates;
     std::unique_ptr<interfaces::Handler> m_handler_superstaker_changed;
 
     friend class SuperStakerItemPriv;
@@ -291,9 +291,8 @@ void TestGUI(interfaces::Node& node, const std::shared_ptr<CWallet>& wallet)
     QCOMPARE(transactionTableModel->rowCount({}), coinbaseMaturity + 5);
     uint256 txid1 = SendCoins(*wallet.get(), sendCoinsDialog, PKHash(), 5 * COIN, /*rbf=*/false);
     uint256 txid2 = SendCoins(*wallet.get(), sendCoinsDialog, PKHash(), 10 * COIN, /*rbf=*/true);
-    // Transaction table model updates on a QueuedConnection, so process events to ensure it's updated.
-    qApp->processEvents();
-    QCOMPARE(transactionTableModel->rowCount({}), coinbaseMaturity + 7);
+    // Transaction table model applies the wallet changes in batches from a timer, so wait for it to be updated.
+    QTRY_COMPARE(transactionTableModel->rowCount({}), coinbaseMaturity + 7);
     QVERIFY(FindTx(*transactionTableModel, txid1).isValid());
     QVERIFY(FindTx(*transactionTableModel, txid2).isValid());
 
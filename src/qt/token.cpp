@@ -139,50 +139,43 @@ bool Token::exec(const bool &sendTo, const std::map<std::string, std::string> &l
 
 bool Token::execEvents(const int64_t &fromBlock, const int64_t &toBlock, const int64_t &minconf, const std::string &eventName, const std::string &contractAddress, const std::string &senderAddress, const int &numTopics, std::vector<TokenEvent> &result)
 {
-    QVariant resultVar;
-    if(!(d->eventLog->searchTokenTx(d->model->node(), d->model, fromBlock, toBlock, minconf, eventName, contractAddress, senderAddress, numTopics, resultVar)))
-        return false;
-
-    QList<QVariant> list = resultVar.toList();
-    for(int i = 0; i < list.size(); i++)
-    {
-        // Search the log for events
-        QVariantMap variantMap = list[i].toMap();
-        QList<QVariant> listLog = variantMap.value("log").toList();
-        for(int i = 0; i < listLog.size(); i++)
+    // The events are parsed page by page as the node reads them
+    return d->eventLog->searchTokenTx(d->model->node(), fromBlock, toBlock, minconf, eventName, contractAddress, senderAddress, numTopics,
+                                      [&](const std::vector<interfaces::LogQueryReceipt>& receipts) {
+        for(const interfaces::LogQueryReceipt& receipt : receipts)
         {
-            // Skip the not needed events
-            QVariantMap variantLog = listLog[i].toMap();
-            QList<QVariant> topicsList = variantLog.value("topics").toList();
-            if(topicsList.count() < numTopics) continue;
-            if(topicsList[0].toString().toStdString() != eventName) continue;
-
-            // Create new event
-            TokenEvent tokenEvent;
-            tokenEvent.address = variantMap.value("contractAddress").toString().toStdString();
-            if(numTopics > 1)
-            {
-                tokenEvent.sender = topicsList[1].toString().toStdString().substr(24);
-                Token::ToQtumAddress(tokenEvent.sender, tokenEvent.sender);
-            }
-            if(numTopics > 2)
+            // Search the log for events
+            for(const interfaces::LogQueryEntry& log : receipt.logs)
             {
-                tokenEvent.receiver = topicsList[2].toString().toStdString().substr(24);
-                Token::ToQtumAddress(tokenEvent.receiver, tokenEvent.receiver);
+                // Skip the not needed events
+                if((int)log.topics.size() < numTopics) continue;
+                if(log.topics[0] != eventName) continue;
+
+                // Create new event
+                TokenEvent tokenEvent;
+                tokenEvent.address = receipt.contract_address;
+                if(numTopics > 1)
+                {
+                    tokenEvent.sender = log.topics[1].substr(24);
+                    Token::ToQtumAddress(tokenEvent.sender, tokenEvent.sender);
+                }
+                if(numTopics > 2)
+                {
+                    tokenEvent.receiver = log.topics[2].substr(24);
+                    Token::ToQtumAddress(tokenEvent.receiver, tokenEvent.receiver);
+                }
+                tokenEvent.blockHash = receipt.block_hash;
+                tokenEvent.blockNumber = receipt.block_number;
+                tokenEvent.transactionHash = receipt.tx_hash;
+
+                // Parse data
+                tokenEvent.value = Token::ToUint256(log.data);
+
+                result.push_back(tokenEvent);
             }
-            tokenEvent.blockHash = uint256S(variantMap.value("blockHash").toString().toStdString());
-            tokenEvent.blockNumber = variantMap.value("blockNumber").toLongLong();
-            tokenEvent.transactionHash = uint256S(variantMap.value("transactionHash").toString().toStdString());
-
-            // Parse data
-            std::string data = variantLog.value("data").toString().toStdString();
-            tokenEvent.value = Token::ToUint256(data);
-
-            result.push_back(tokenEvent);
         }
-    }
-
-    return true;
+        return true;
+    });
 }
 
 bool Token::privateKeysDisabled()
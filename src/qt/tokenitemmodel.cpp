@@ -14,6 +14,9 @@
 #include <QFont>
 #include <QDebug>
 #include <QThread>
+#include <QTimer>
+
+#include <utility>
 
 class TokenItemEntry
 {
@@ -42,6 +45,7 @@ public:
         decimals = obj.decimals;
         senderAddress = obj.senderAddress;
         balance = obj.balance;
+        balanceHeight = obj.balanceHeight;
     }
 
     ~TokenItemEntry()
@@ -55,6 +59,8 @@ public:
     quint8 decimals;
     QString senderAddress;
     int256_t balance;
+    // Height of the tip the balance was read at, -1 when not read yet
+    int balanceHeight{-1};
 };
 
 class TokenTxWorker : public QObject
@@ -153,24 +159,45 @@ private Q_SLOTS:
         if(walletModel) walletModel->wallet().cleanTokenTxEntries();
     }
 
-    void updateBalance(QString hash, QString contractAddress, QString senderAddress)
+    void updateBalances(QStringList hashes, QStringList contractAddresses, QStringList senderAddresses)
     {
         if(walletModel && walletModel->node().shutdownRequested())
             return;
 
-        tokenAbi.setAddress(contractAddress.toStdString());
-        tokenAbi.setSender(senderAddress.toStdString());
-        std::string strBalance;
-        if(tokenAbi.balanceOf(strBalance))
+        // Read the balances with one batch of calls at the same tip
+        std::vector<interfaces::ContractViewCall> calls(hashes.size());
+        for(int i = 0; i < hashes.size(); i++)
         {
-            QString balance = QString::fromStdString(strBalance);
-            Q_EMIT balanceChanged(hash, balance);
+            std::string sender;
+            if(!tokenAbi.balanceOfData(senderAddresses[i].toStdString(), calls[i].data) ||
+                    !QtumToken::ToHash160(senderAddresses[i].toStdString(), sender))
+                continue;
+            calls[i].address = contractAddresses[i].toStdString();
+            calls[i].sender = sender;
         }
+        std::vector<interfaces::ContractViewResult> results;
+        int height = walletModel->node().callContracts(calls, results);
+
+        // The balances that could not be read are kept until the next block
+        QStringList balances;
+        for(size_t i = 0; i < results.size(); i++)
+        {
+            std::string strBalance;
+            if(results[i].executed && !results[i].excepted && tokenAbi.balanceOfResult(results[i].output, strBalance))
+            {
+                balances.append(QString::fromStdString(strBalance));
+            }
+            else
+            {
+                balances.append(QString());
+            }
+        }
+        Q_EMIT balancesChanged(hashes, balances, height);
     }
 
 Q_SIGNALS:
-    // Signal that balance in token changed
-    void balanceChanged(QString hash, QString balance);
+    // Signal that the balances of the tokens were read at the height
+    void balancesChanged(QStringList hashes, QStringList balances, int height);
 };
 
 #include <qt/tokenitemmodel.moc>
@@ -204,14 +231,10 @@ public:
     {
         cachedTokenItem.clear();
         {
+            // The balances are read when the views ask for them
             for(interfaces::TokenInfo token : wallet.getTokens())
             {
-                TokenItemEntry tokenItem(token);
-                if(parent)
-                {
-                    parent->updateBalance(tokenItem);
-                }
-                cachedTokenItem.append(tokenItem);
+                cachedTokenItem.append(TokenItemEntry(token));
             }
         }
         std::sort(cachedTokenItem.begin(), cachedTokenItem.end(), TokenItemEntryLessThan());
@@ -231,6 +254,7 @@ public:
         item = _item;
         if(inModel)
         {
+            // Show the last balance until the updated token is read again
             item.balance = cachedTokenItem[lowerIndex].balance;
         }
 
@@ -268,24 +292,30 @@ public:
         }
     }
 
-    int updateBalance(QString hash, QString balance)
+    int updateBalance(const uint256 &hash, const QString &balance, int height)
     {
-        uint256 updated;
-        updated.SetHex(hash.toStdString());
+        QList<TokenItemEntry>::iterator it = std::lower_bound(
+            cachedTokenItem.begin(), cachedTokenItem.end(), hash, TokenItemEntryLessThan());
+        if(it == cachedTokenItem.end() || it->hash != hash)
+            return -1;
+
+        it->balanceHeight = height;
+        if(balance.isEmpty())
+            return -1;
         int256_t val(balance.toStdString());
+        if(it->balance == val)
+            return -1;
+        it->balance = val;
+        return it - cachedTokenItem.begin();
+    }
 
-        for(int i = 0; i < cachedTokenItem.size(); i++)
-        {
-            TokenItemEntry item = cachedTokenItem[i];
-            if(item.hash == updated && item.balance != val)
-            {
-                item.balance = val;
-                cachedTokenItem[i] = item;
-                return i;
-            }
-        }
-
-        return -1;
+    TokenItemEntry *find(const uint256 &hash)
+    {
+        QList<TokenItemEntry>::iterator it = std::lower_bound(
+            cachedTokenItem.begin(), cachedTokenItem.end(), hash, TokenItemEntryLessThan());
+        if(it == cachedTokenItem.end() || it->hash != hash)
+            return 0;
+        return &(*it);
     }
 
     int size()
@@ -311,17 +341,19 @@ TokenItemModel::TokenItemModel(WalletModel *parent):
     walletModel(parent),
     priv(0),
     worker(0),
-    tokenTxCleaned(false)
+    tokenTxCleaned(false),
+    tipHeight(-1)
 {
     columns << tr("Token Name") << tr("Token Symbol") << tr("Balance");
 
     priv = new TokenItemPriv(this);
     priv->refreshTokenItem(walletModel->wallet());
+    tipHeight = walletModel->node().getNumBlocks();
 
     worker = new TokenTxWorker(walletModel);
     worker->tokenAbi.setModel(walletModel);
     worker->moveToThread(&(t));
-    connect(worker, &TokenTxWorker::balanceChanged, this, &TokenItemModel::balanceChanged);
+    connect(worker, &TokenTxWorker::balancesChanged, this, &TokenItemModel::balancesChanged);
 
     t.start();
 
@@ -386,6 +418,7 @@ QVariant TokenItemModel::data(const QModelIndex &index, int role) const
         case Symbol:
             return rec->tokenSymbol;
         case Balance:
+            requestBalance(rec);
             return BitcoinUnits::formatToken(rec->decimals, rec->balance, false, BitcoinUnits::SeparatorStyle::ALWAYS);
         default:
             break;
@@ -410,9 +443,11 @@ QVariant TokenItemModel::data(const QModelIndex &index, int role) const
         return rec->senderAddress;
         break;
     case TokenItemModel::BalanceRole:
+        requestBalance(rec);
         return BitcoinUnits::formatToken(rec->decimals, rec->balance, false, BitcoinUnits::SeparatorStyle::ALWAYS);
         break;
     case TokenItemModel::RawBalanceRole:
+        requestBalance(rec);
         return QString::fromStdString(rec->balance.str());
         break;
     default:
@@ -434,13 +469,16 @@ void TokenItemModel::updateToken(const QString &hash, int status, bool showToken
     if(showToken)
     {
         tokenEntry = TokenItemEntry(token);
-        updateBalance(tokenEntry);
     }
     else
     {
         tokenEntry.hash = updated;
     }
     priv->updateEntry(tokenEntry, status);
+
+    // A new token is searched in the logs with the next check
+    if(status != CT_UPDATED)
+        tokenTxSynced.remove(hash);
 }
 
 void TokenItemModel::checkTokenBalanceChanged()
@@ -448,21 +486,25 @@ void TokenItemModel::checkTokenBalanceChanged()
     if(!priv)
         return;
 
-    // Update token balance
-    for(int i = 0; i < priv->cachedTokenItem.size(); i++)
+    // The balances read before the new tip are read again when the views ask for them
+    tipHeight = walletModel->node().getNumBlocks();
+    if(priv->size() > 0)
     {
-        TokenItemEntry tokenEntry = priv->cachedTokenItem[i];
-        updateBalance(tokenEntry);
+        Q_EMIT dataChanged(index(0, Balance, QModelIndex()), index(priv->size()-1, Balance, QModelIndex()));
     }
 
     // Update token transactions
     if(fLogEvents)
     {
-        // Search for token transactions
+        // Search for the token transactions up to the tip once per token, the wallet
+        // adds the transactions of the blocks connected after that
         for(int i = 0; i < priv->cachedTokenItem.size(); i++)
         {
             TokenItemEntry tokenEntry = priv->cachedTokenItem[i];
             QString hash = QString::fromStdString(tokenEntry.hash.ToString());
+            if(tokenTxSynced.contains(hash))
+                continue;
+            tokenTxSynced.insert(hash);
             QMetaObject::invokeMethod(worker, "updateTokenTx", Qt::QueuedConnection,
                                       Q_ARG(QString, hash));
         }
@@ -522,20 +564,66 @@ void TokenItemModel::unsubscribeFromCoreSignals()
     m_handler_token_changed->disconnect();
 }
 
-void TokenItemModel::balanceChanged(QString hash, QString balance)
+void TokenItemModel::balancesChanged(QStringList hashes, QStringList balances, int height)
 {
-    int index = priv->updateBalance(hash, balance);
-    if(index > -1)
+    if(!priv)
+        return;
+
+    for(int i = 0; i < hashes.size() && i < balances.size(); i++)
     {
-        emitDataChanged(index);
+        uint256 updated;
+        updated.SetHex(hashes[i].toStdString());
+        balanceRequests.erase(updated);
+        int index = priv->updateBalance(updated, balances[i], height);
+        if(index > -1)
+        {
+            emitDataChanged(index);
+        }
+
+        // Read again the balances asked for at a newer tip while they were read
+        TokenItemEntry *entry = height < tipHeight ? priv->find(updated) : 0;
+        if(entry)
+        {
+            requestBalance(entry);
+        }
     }
 }
 
-void TokenItemModel::updateBalance(const TokenItemEntry &entry)
+void TokenItemModel::requestBalance(const TokenItemEntry *entry) const
 {
-    QString hash = QString::fromStdString(entry.hash.ToString());
-    QMetaObject::invokeMethod(worker, "updateBalance", Qt::QueuedConnection,
-                              Q_ARG(QString, hash), Q_ARG(QString, entry.contractAddress), Q_ARG(QString, entry.senderAddress));
+    // Read each balance once per tip, and only for the tokens that are shown
+    if(entry->balanceHeight >= tipHeight || !balanceRequests.insert(entry->hash).second)
+        return;
+
+    // Send the balances asked for by the views in one batch
+    balanceQueue.push_back(entry->hash);
+    if(balanceQueue.size() == 1)
+    {
+        QTimer::singleShot(0, const_cast<TokenItemModel*>(this), &TokenItemModel::sendBalanceRequests);
+    }
+}
+
+void TokenItemModel::sendBalanceRequests()
+{
+    QStringList hashes, contractAddresses, senderAddresses;
+    for(const uint256& hash : std::exchange(balanceQueue, {}))
+    {
+        TokenItemEntry *entry = priv ? priv->find(hash) : 0;
+        if(!entry)
+        {
+            balanceRequests.erase(hash);
+            continue;
+        }
+        hashes.append(QString::fromStdString(hash.ToString()));
+        contractAddresses.append(entry->contractAddress);
+        senderAddresses.append(entry->senderAddress);
+    }
+
+    if(!hashes.isEmpty())
+    {
+        QMetaObject::invokeMethod(worker, "updateBalances", Qt::QueuedConnection,
+                                  Q_ARG(QStringList, hashes), Q_ARG(QStringList, contractAddresses), Q_ARG(QStringList, senderAddresses));
+    }
 }
 
 void TokenItemModel::join()
@@ -2,10 +2,15 @@
 #define TOKENITEMMODEL_H
 
 #include <QAbstractItemModel>
+#include <QSet>
 #include <QStringList>
 #include <QThread>
 
+#include <uint256.h>
+
 #include <memory>
+#include <set>
+#include <vector>
 
 namespace interfaces {
 class Handler;
@@ -51,21 +56,23 @@ public:
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     /*@}*/
     
-    void updateBalance(const TokenItemEntry& entry);
     void join();
 
 public Q_SLOTS:
     void checkTokenBalanceChanged();
-    void balanceChanged(QString hash, QString balance);
+    void balancesChanged(QStringList hashes, QStringList balances, int height);
 
 private Q_SLOTS:
     void updateToken(const QString &hash, int status, bool showToken);
+    void sendBalanceRequests();
 
 private:
     /** Notify listeners that data changed. */
     void emitDataChanged(int index);
     void subscribeToCoreSignals();
     void unsubscribeFromCoreSignals();
+    /** Queue reading the balance of a token shown by a view, when it was not read at the tip */
+    void requestBalance(const TokenItemEntry *entry) const;
 
     Token *tokenAbi;
     QStringList columns;
@@ -75,6 +82,13 @@ private:
     QThread t;
     std::unique_ptr<interfaces::Handler> m_handler_token_changed;
     bool tokenTxCleaned;
+    // Tokens whose transactions were searched in the logs, the wallet adds the new ones
+    QSet<QString> tokenTxSynced;
+    // Height of the tip the balances are read at
+    int tipHeight;
+    // Tokens whose balances are queued or being read, and the ones not sent to the worker yet
+    mutable std::set<uint256> balanceRequests;
+    mutable std::vector<uint256> balanceQueue;
 
     friend class TokenItemPriv;
 };
@@ -8,6 +8,7 @@
 #include <qt/platformstyle.h>
 #include <qt/tokentransactiondesc.h>
 #include <qt/tokentransactionrecord.h>
+#include <qt/transactionchangebatch.h>
 #include <qt/walletmodel.h>
 
 #include <core_io.h>
@@ -24,6 +25,13 @@
 #include <QDebug>
 #include <QIcon>
 #include <QList>
+#include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <set>
 
 // Amount column is right-aligned it contains numbers
 static int column_alignments[] = {
@@ -35,6 +43,12 @@ static int column_alignments[] = {
         Qt::AlignRight|Qt::AlignVCenter /* amount */
     };
 
+// Number of token transactions read from the wallet at once
+static constexpr size_t TOKEN_TX_PAGE_SIZE = 1000;
+
+// Batches of more changes than this reset the model instead of moving the rows
+static constexpr size_t TOKEN_TX_RESET_THRESHOLD = 100;
+
 // Comparison operator for sort/binary search of model tx list
 struct TokenTxLessThan
 {
@@ -69,6 +83,15 @@ public:
      */
     QList<TokenTransactionRecord> cachedWallet;
 
+    /** True when token transactions are being notified, for instance when scanning */
+    std::atomic<bool> m_loading{false};
+    /** Changes notified by the wallet, applied by the GUI thread at most every TRANSACTION_NOTIFY_DELAY */
+    TransactionChangeBatch m_changes;
+
+    void NotifyTokenTransactionChanged(const uint256 &hash, ChangeType status);
+    void ScheduleDispatch();
+    void DispatchNotifications();
+
     /* Query entire wallet anew from core.
      */
     void refreshWallet(interfaces::Node& node, interfaces::Wallet& wallet)
@@ -76,28 +99,43 @@ public:
         qDebug() << "TokenTransactionTablePriv::refreshWallet";
         cachedWallet.clear();
         {
-            for(interfaces::TokenTx wtokenTx : wallet.getTokenTxs())
+            // Only the transactions of the wallet tokens are shown, read them a page at a time
+            // so the wallet is not locked for long
+            std::set<uint256> added;
+            for(const interfaces::TokenInfo& token : wallet.getTokens())
             {
-                // Update token transaction time if the block time is changed
-                int64_t time = node.getBlockTime(wtokenTx.block_number);
-                if(time && time != wtokenTx.time)
+                for(size_t offset = 0;; offset += TOKEN_TX_PAGE_SIZE)
                 {
-                    wtokenTx.time = time;
-                    wallet.addTokenTxEntry(wtokenTx, false);
+                    std::vector<interfaces::TokenTx> page = wallet.getTokenTxs(token.contract_address, token.sender_address, offset, TOKEN_TX_PAGE_SIZE);
+                    for(interfaces::TokenTx& wtokenTx : page)
+                    {
+                        if(!added.insert(wtokenTx.hash).second) continue;
+
+                        // Update token transaction time if the block time is changed
+                        int64_t time = node.getBlockTime(wtokenTx.block_number);
+                        if(time && time != wtokenTx.time)
+                        {
+                            wtokenTx.time = time;
+                            wallet.addTokenTxEntry(wtokenTx, false);
+                        }
+
+                        // Add token tx to the cache
+                        cachedWallet.append(TokenTransactionRecord::decomposeTransaction(wallet, wtokenTx));
+                    }
+                    if(page.size() < TOKEN_TX_PAGE_SIZE) break;
                 }
-
-                // Add token tx to the cache
-                cachedWallet.append(TokenTransactionRecord::decomposeTransaction(wallet, wtokenTx));
             }
+            std::sort(cachedWallet.begin(), cachedWallet.end(), TokenTxLessThan());
         }
     }
 
     /* Update our model of the wallet incrementally, to synchronize our model of the wallet
        with that of the core.
 
-       Call with transaction that was added, removed or changed.
+       Call with transaction that was added, removed or changed. The row signals are not emitted
+       when notify is false, the caller resets the model instead.
      */
-    void updateWallet(interfaces::Wallet& wallet, const uint256 &hash, int status, bool showTransaction)
+    void updateWallet(interfaces::Wallet& wallet, const uint256 &hash, int status, bool showTransaction, bool notify = true)
     {
         qDebug() << "TokenTransactionTablePriv::updateWallet: " + QString::fromStdString(hash.ToString()) + " " + QString::number(status);
 
@@ -153,14 +191,14 @@ public:
                         TokenTransactionRecord::decomposeTransaction(wallet, wtokenTx);
                 if(!toInsert.isEmpty()) /* only if something to insert */
                 {
-                    parent->beginInsertRows(QModelIndex(), lowerIndex, lowerIndex+toInsert.size()-1);
+                    if (notify) parent->beginInsertRows(QModelIndex(), lowerIndex, lowerIndex+toInsert.size()-1);
                     int insert_idx = lowerIndex;
                     Q_FOREACH(const TokenTransactionRecord &rec, toInsert)
                     {
                         cachedWallet.insert(insert_idx, rec);
                         insert_idx += 1;
                     }
-                    parent->endInsertRows();
+                    if (notify) parent->endInsertRows();
                 }
             }
             break;
@@ -171,9 +209,9 @@ public:
                 break;
             }
             // Removed -- remove entire transaction from table
-            parent->beginRemoveRows(QModelIndex(), lowerIndex, upperIndex-1);
+            if (notify) parent->beginRemoveRows(QModelIndex(), lowerIndex, upperIndex-1);
             cachedWallet.erase(lower, upper);
-            parent->endRemoveRows();
+            if (notify) parent->endRemoveRows();
             break;
         case CT_UPDATED:
             if(!inModel)
@@ -197,7 +235,7 @@ public:
                     Q_FOREACH(const TokenTransactionRecord &rec, toUpdate)
                     {
                         cachedWallet[update_idx] = rec;
-                        parent->emitDataChanged(update_idx);
+                        if (notify) parent->emitDataChanged(update_idx);
                         update_idx += 1;
                     }
                 }
@@ -675,70 +713,59 @@ void TokenTransactionTableModel::emitDataChanged(int idx)
     Q_EMIT dataChanged(index(idx, 0, QModelIndex()), index(idx, columns.length()-1, QModelIndex()));
 }
 
-// queue notifications to show a non freezing progress dialog e.g. for rescan
-struct TokenTransactionNotification
+void TokenTransactionTablePriv::NotifyTokenTransactionChanged(const uint256 &hash, ChangeType status)
 {
-public:
-    TokenTransactionNotification() {}
-    TokenTransactionNotification(uint256 _hash, ChangeType _status, bool _showTransaction):
-        hash(_hash), status(_status), showTransaction(_showTransaction) {}
-
-    void invoke(QObject *ttm)
-    {
-        QString strHash = QString::fromStdString(hash.GetHex());
-        qDebug() << "NotifyTokenTransactionChanged: " + strHash + " status= " + QString::number(status);
-        QMetaObject::invokeMethod(ttm, "updateTransaction", Qt::QueuedConnection,
-                                  Q_ARG(QString, strHash),
-                                  Q_ARG(int, status),
-                                  Q_ARG(bool, showTransaction));
+    // Only the first change of a batch schedules the dispatch, the next ones are coalesced with it
+    if (m_changes.Add(hash, status)) {
+        ScheduleDispatch();
     }
-private:
-    uint256 hash;
-    ChangeType status;
-    bool showTransaction;
-};
-
-static bool fQueueNotifications = false;
-static std::vector< TokenTransactionNotification > vQueueNotifications;
+}
 
-static void NotifyTokenTransactionChanged(TokenTransactionTableModel *ttm, const uint256 &hash, ChangeType status)
+void TokenTransactionTablePriv::ScheduleDispatch()
 {
-    TokenTransactionNotification notification(hash, status, true);
-
-    if (fQueueNotifications)
-    {
-        vQueueNotifications.push_back(notification);
-        return;
-    }
-    notification.invoke(ttm);
+    // The timer is started from the GUI thread, the wallet threads have no event loop
+    bool invoked = QMetaObject::invokeMethod(parent, [this] {
+        QTimer::singleShot(TRANSACTION_NOTIFY_DELAY, parent, [this] { DispatchNotifications(); });
+    }, Qt::QueuedConnection);
+    assert(invoked);
 }
 
-static void ShowProgress(TokenTransactionTableModel *ttm, const std::string &title, int nProgress)
+void TokenTransactionTablePriv::DispatchNotifications()
 {
-    if (nProgress == 0)
-        fQueueNotifications = true;
-
-    if (nProgress == 100)
-    {
-        fQueueNotifications = false;
-        if (vQueueNotifications.size() > 10) // prevent balloon spam, show maximum 10 balloons
-            QMetaObject::invokeMethod(ttm, "setProcessingQueuedTransactions", Qt::QueuedConnection, Q_ARG(bool, true));
-        for (unsigned int i = 0; i < vQueueNotifications.size(); ++i)
-        {
-            if (vQueueNotifications.size() - i <= 10)
-                QMetaObject::invokeMethod(ttm, "setProcessingQueuedTransactions", Qt::QueuedConnection, Q_ARG(bool, false));
-
-            vQueueNotifications[i].invoke(ttm);
+    // The changes stay in the batch until scanning is over
+    if (m_loading) return;
+
+    const std::map<uint256, ChangeType> changes = m_changes.Take();
+    if (changes.empty()) return;
+
+    interfaces::Wallet& wallet = parent->walletModel->wallet();
+    if (changes.size() > TOKEN_TX_RESET_THRESHOLD) {
+        // Many changes, reset the model once instead of moving the rows for each of them
+        parent->beginResetModel();
+        for (const auto& [hash, status] : changes) {
+            updateWallet(wallet, hash, status, true, /*notify=*/false);
         }
-        std::vector<TokenTransactionNotification >().swap(vQueueNotifications); // clear
+        parent->endResetModel();
+        return;
+    }
+
+    size_t remaining = changes.size();
+    for (const auto& [hash, status] : changes) {
+        // prevent balloon spam, show maximum 10 balloons
+        parent->setProcessingQueuedTransactions(remaining-- > 10);
+        updateWallet(wallet, hash, status, true);
     }
+    parent->setProcessingQueuedTransactions(false);
 }
 
 void TokenTransactionTableModel::subscribeToCoreSignals()
 {
     // Connect signals to wallet
-    m_handler_token_transaction_changed = walletModel->wallet().handleTokenTransactionChanged(boost::bind(NotifyTokenTransactionChanged, this, boost::placeholders::_1, boost::placeholders::_2));
-    m_handler_show_progress = walletModel->wallet().handleShowProgress(boost::bind(ShowProgress, this, boost::placeholders::_1, boost::placeholders::_2));
+    m_handler_token_transaction_changed = walletModel->wallet().handleTokenTransactionChanged(std::bind(&TokenTransactionTablePriv::NotifyTokenTransactionChanged, priv, std::placeholders::_1, std::placeholders::_2));
+    m_handler_show_progress = walletModel->wallet().handleShowProgress([this](const std::string&, int progress) {
+        priv->m_loading = progress < 100;
+        if (!priv->m_loading) priv->ScheduleDispatch();
+    });
 }
 
 void TokenTransactionTableModel::unsubscribeFromCoreSignals()
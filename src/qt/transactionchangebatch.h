@@ -0,0 +1,57 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_QT_TRANSACTIONCHANGEBATCH_H
+#define BITCOIN_QT_TRANSACTIONCHANGEBATCH_H
+
+#include <sync.h>
+#include <uint256.h>
+#include <util/ui_change_type.h>
+
+#include <map>
+#include <utility>
+
+/**
+ * Transaction changes notified by the wallet, coalesced by hash until the GUI thread takes them.
+ * During a rescan or while staking the wallet notifies thousands of changes, the models apply
+ * them in one step instead of handling a queued call for each of them.
+ */
+class TransactionChangeBatch
+{
+public:
+    /** Record a change. Returns true when the batch was empty, the caller then schedules a flush. */
+    bool Add(const uint256& hash, ChangeType status) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        const bool was_empty = m_changes.empty();
+        auto [it, inserted] = m_changes.try_emplace(hash, status);
+        if (!inserted) {
+            if (status == CT_DELETED) {
+                // Added and removed before the GUI saw it
+                if (it->second == CT_NEW) {
+                    m_changes.erase(it);
+                } else {
+                    it->second = CT_DELETED;
+                }
+            } else if (it->second == CT_DELETED) {
+                // Removed and added back, let the model look the transaction up
+                it->second = CT_UPDATED;
+            }
+        }
+        return was_empty;
+    }
+
+    /** Take the changes recorded so far */
+    std::map<uint256, ChangeType> Take() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        return std::exchange(m_changes, {});
+    }
+
+private:
+    Mutex m_mutex;
+    std::map<uint256, ChangeType> m_changes GUARDED_BY(m_mutex);
+};
+
+#endif // BITCOIN_QT_TRANSACTIONCHANGEBATCH_H
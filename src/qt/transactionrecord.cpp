@@ -263,9 +263,18 @@ void TransactionRecord::updateStatus(const interfaces::WalletTxStatus& wtx, cons
             status.status = TransactionStatus::Confirmed;
         }
     }
+    status.settled_height = status.status == TransactionStatus::Confirmed && wtx.is_in_main_chain ? wtx.block_height : -1;
     status.needsUpdate = false;
 }
 
+bool TransactionRecord::updateSettledStatus(const uint256& block_hash, int numBlocks)
+{
+    if (status.settled_height < 0 || status.needsUpdate || numBlocks < status.settled_height) return false;
+    status.depth = numBlocks - status.settled_height + 1;
+    status.m_cur_block_hash = block_hash;
+    return true;
+}
+
 bool TransactionRecord::statusUpdateNeeded(const uint256& block_hash) const
 {
     assert(!block_hash.IsNull());
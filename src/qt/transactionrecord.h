@@ -52,6 +52,11 @@ struct TransactionStatus {
     /** Current block hash (to know whether cached status is still valid) */
     uint256 m_cur_block_hash{};
 
+    /** Height of the block of a confirmed and mature transaction, -1 for the others. The status of such
+        a transaction only changes with its depth, which follows from the tip height, unless a reorg takes it
+        out of the chain, which the wallet notifies. */
+    int settled_height{-1};
+
     bool needsUpdate{false};
 };
 
@@ -130,6 +135,11 @@ public:
      */
     void updateStatus(const interfaces::WalletTxStatus& wtx, const uint256& block_hash, int numBlocks, int64_t block_time);
 
+    /** Update the depth of a settled transaction from the tip height, without asking the wallet.
+        Return false if the status has to be updated from the wallet instead.
+     */
+    bool updateSettledStatus(const uint256& block_hash, int numBlocks);
+
     /** Return whether a status update is needed.
      */
     bool statusUpdateNeeded(const uint256& block_hash) const;
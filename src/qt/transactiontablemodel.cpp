@@ -12,6 +12,7 @@
 #include <qt/optionsmodel.h>
 #include <qt/styleSheet.h>
 #include <qt/platformstyle.h>
+#include <qt/transactionchangebatch.h>
 #include <qt/transactiondesc.h>
 #include <qt/transactionrecord.h>
 #include <qt/walletmodel.h>
@@ -22,7 +23,10 @@
 #include <uint256.h>
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
+#include <map>
+#include <set>
 
 #include <QColor>
 #include <QDateTime>
@@ -33,6 +37,8 @@
 #include <QList>
 #include <QApplication>
 #include <QPointer>
+#include <QThread>
+#include <QTimer>
 
 
 // Amount column is right-aligned it contains numbers
@@ -45,6 +51,10 @@ static int column_alignments[] = {
         Qt::AlignRight|Qt::AlignVCenter /* amount */
     };
 static int dataChangedChunk = 500;
+// Wallets with more transactions are loaded by a worker thread, in chunks of this many transactions
+static const size_t backgroundLoadChunk = 2000;
+// Batches of more changes than this reset the model instead of moving the rows
+static const size_t transactionResetThreshold = 100;
 
 // Comparison operator for sort/binary search of model tx list
 struct TxLessThan
@@ -63,30 +73,6 @@ struct TxLessThan
     }
 };
 
-// queue notifications to show a non freezing progress dialog e.g. for rescan
-struct TransactionNotification
-{
-public:
-    TransactionNotification() = default;
-    TransactionNotification(uint256 _hash, ChangeType _status, bool _showTransaction):
-        hash(_hash), status(_status), showTransaction(_showTransaction) {}
-
-    void invoke(QObject *ttm)
-    {
-        QString strHash = QString::fromStdString(hash.GetHex());
-        qDebug() << "NotifyTransactionChanged: " + strHash + " status= " + QString::number(status);
-        bool invoked = QMetaObject::invokeMethod(ttm, "updateTransaction", Qt::QueuedConnection,
-                                  Q_ARG(QString, strHash),
-                                  Q_ARG(int, status),
-                                  Q_ARG(bool, showTransaction));
-        assert(invoked);
-    }
-private:
-    uint256 hash;
-    ChangeType status;
-    bool showTransaction;
-};
-
 // Private implementation
 class TransactionTablePriv
 {
@@ -96,6 +82,11 @@ public:
     {
     }
 
+    ~TransactionTablePriv()
+    {
+        join();
+    }
+
     TransactionTableModel *parent;
 
     /* Local cache of wallet.
@@ -108,34 +99,84 @@ public:
     /** True when model finishes loading all wallet transactions on start */
     bool m_loaded = false;
     /** True when transactions are being notified, for instance when scanning */
-    bool m_loading = false;
-    std::vector< TransactionNotification > vQueueNotifications;
+    std::atomic<bool> m_loading{false};
+    /** Changes notified by the wallet, applied by the GUI thread at most every TRANSACTION_NOTIFY_DELAY */
+    TransactionChangeBatch m_changes;
 
     void NotifyTransactionChanged(const uint256 &hash, ChangeType status);
+    void ScheduleDispatch();
     void DispatchNotifications();
 
+    /** Worker thread decomposing the transactions of a large wallet */
+    QThread* m_load_thread{nullptr};
+    std::atomic<bool> m_stop_loading{false};
+
     /* Query entire wallet anew from core.
+       The transactions come sorted by hash. Large wallets are decomposed by a worker thread and
+       appended in chunks, so that the GUI stays responsive while they load. The notifications
+       are queued until the last chunk is in.
      */
     void refreshWallet(interfaces::Wallet& wallet)
     {
         assert(!m_loaded);
-        {
+        if (wallet.getWalletTxCount() <= backgroundLoadChunk) {
             for (const auto& wtx : wallet.getWalletTxs()) {
                 if (TransactionRecord::showTransaction(wtx)) { 
                     cachedWallet.append(TransactionRecord::decomposeTransaction(wtx));
                 }
             }
+            finishLoading();
+            return;
         }
+
+        m_load_thread = QThread::create([this, &wallet] {
+            const std::set<interfaces::WalletTx> wtxs = wallet.getWalletTxs();
+            QList<TransactionRecord> chunk;
+            size_t count = 0;
+            for (auto it = wtxs.begin(); it != wtxs.end() && !m_stop_loading; ++it) {
+                if (TransactionRecord::showTransaction(*it)) {
+                    chunk.append(TransactionRecord::decomposeTransaction(*it));
+                }
+                if (++count % backgroundLoadChunk == 0 || std::next(it) == wtxs.end()) {
+                    QMetaObject::invokeMethod(parent, [this, chunk = std::move(chunk)] { appendRecords(chunk); }, Qt::QueuedConnection);
+                    chunk.clear();
+                }
+            }
+            QMetaObject::invokeMethod(parent, [this] { finishLoading(); }, Qt::QueuedConnection);
+        });
+        m_load_thread->start();
+    }
+
+    void appendRecords(const QList<TransactionRecord>& records)
+    {
+        if (records.isEmpty()) return;
+        parent->beginInsertRows(QModelIndex(), cachedWallet.size(), cachedWallet.size() + records.size() - 1);
+        cachedWallet.append(records);
+        parent->endInsertRows();
+    }
+
+    void finishLoading()
+    {
         m_loaded = true;
         DispatchNotifications();
     }
 
+    void join()
+    {
+        if (!m_load_thread) return;
+        m_stop_loading = true;
+        m_load_thread->wait();
+        delete m_load_thread;
+        m_load_thread = nullptr;
+    }
+
     /* Update our model of the wallet incrementally, to synchronize our model of the wallet
        with that of the core.
 
-       Call with transaction that was added, removed or changed.
+       Call with transaction that was added, removed or changed. The row signals are not emitted
+       when notify is false, the caller resets the model instead.
      */
-    void updateWallet(interfaces::Wallet& wallet, const uint256 &hash, int status, bool showTransaction)
+    void updateWallet(interfaces::Wallet& wallet, const uint256 &hash, int status, bool showTransaction, bool notify = true)
     {
         // Find transaction in wallet
         interfaces::WalletTx wtx = wallet.getWalletTx(hash);
@@ -184,14 +225,14 @@ public:
                         TransactionRecord::decomposeTransaction(wtx);
                 if(!toInsert.isEmpty()) /* only if something to insert */
                 {
-                    parent->beginInsertRows(QModelIndex(), lowerIndex, lowerIndex+toInsert.size()-1);
+                    if (notify) parent->beginInsertRows(QModelIndex(), lowerIndex, lowerIndex+toInsert.size()-1);
                     int insert_idx = lowerIndex;
                     for (const TransactionRecord &rec : toInsert)
                     {
                         cachedWallet.insert(insert_idx, rec);
                         insert_idx += 1;
                     }
-                    parent->endInsertRows();
+                    if (notify) parent->endInsertRows();
                 }
             }
             break;
@@ -202,9 +243,9 @@ public:
                 break;
             }
             // Removed -- remove entire transaction from table
-            parent->beginRemoveRows(QModelIndex(), lowerIndex, upperIndex-1);
+            if (notify) parent->beginRemoveRows(QModelIndex(), lowerIndex, upperIndex-1);
             cachedWallet.erase(lower, upper);
-            parent->endRemoveRows();
+            if (notify) parent->endRemoveRows();
             break;
         case CT_UPDATED:
             // Miscellaneous updates -- nothing to do, status update will take care of this, and is only computed for
@@ -222,19 +263,21 @@ public:
         return cachedWallet.size();
     }
 
-    TransactionRecord* index(interfaces::Wallet& wallet, const uint256& cur_block_hash, const int idx)
+    TransactionRecord* index(interfaces::Wallet& wallet, const uint256& cur_block_hash, int cur_num_blocks, const int idx)
     {
         if (idx >= 0 && idx < cachedWallet.size()) {
             TransactionRecord *rec = &cachedWallet[idx];
             if(!isDataLoading)
             {
                 // If a status update is needed (blocks came in since last check),
+                // take the depth of a settled transaction from the tip height, or
                 // try to update the status of this transaction from the wallet.
                 // Otherwise, simply re-use the cached status.
                 interfaces::WalletTxStatus wtx;
                 int numBlocks;
                 int64_t block_time;
-                if (!cur_block_hash.IsNull() && rec->statusUpdateNeeded(cur_block_hash) && wallet.tryGetTxStatus(rec->hash, wtx, numBlocks, block_time)) {
+                if (!cur_block_hash.IsNull() && rec->statusUpdateNeeded(cur_block_hash) && !rec->updateSettledStatus(cur_block_hash, cur_num_blocks) &&
+                    wallet.tryGetTxStatus(rec->hash, wtx, numBlocks, block_time)) {
                     rec->updateStatus(wtx, cur_block_hash, numBlocks, block_time);
                 }
             }
@@ -285,6 +328,11 @@ TransactionTableModel::~TransactionTableModel()
     delete priv;
 }
 
+void TransactionTableModel::join()
+{
+    priv->join();
+}
+
 /** Updates the column title to "Amount (DisplayUnit)" and emits headerDataChanged() signal for table headers to react. */
 void TransactionTableModel::updateAmountColumnTitle()
 {
@@ -719,7 +767,7 @@ QVariant TransactionTableModel::headerData(int section, Qt::Orientation orientat
 QModelIndex TransactionTableModel::index(int row, int column, const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
-    TransactionRecord* data = priv->index(walletModel->wallet(), walletModel->getLastBlockProcessed(), row);
+    TransactionRecord* data = priv->index(walletModel->wallet(), walletModel->getLastBlockProcessed(), walletModel->clientModel().getNumBlocks(), row);
     if(data)
     {
         return createIndex(row, column, data);
@@ -736,34 +784,49 @@ void TransactionTableModel::updateDisplayUnit()
 
 void TransactionTablePriv::NotifyTransactionChanged(const uint256 &hash, ChangeType status)
 {
-    TransactionNotification notification(hash, status, true);
-
-    if (!m_loaded || m_loading)
-    {
-        vQueueNotifications.push_back(notification);
-        return;
+    // Only the first change of a batch schedules the dispatch, the next ones are coalesced with it
+    if (m_changes.Add(hash, status)) {
+        ScheduleDispatch();
     }
-    notification.invoke(parent);
+}
+
+void TransactionTablePriv::ScheduleDispatch()
+{
+    // The timer is started from the GUI thread, the wallet threads have no event loop
+    bool invoked = QMetaObject::invokeMethod(parent, [this] {
+        QTimer::singleShot(TRANSACTION_NOTIFY_DELAY, parent, [this] { DispatchNotifications(); });
+    }, Qt::QueuedConnection);
+    assert(invoked);
 }
 
 void TransactionTablePriv::DispatchNotifications()
 {
+    // The changes stay in the batch until loading or scanning is over
     if (!m_loaded || m_loading) return;
 
-    if (vQueueNotifications.size() > 10) { // prevent balloon spam, show maximum 10 balloons
-        bool invoked = QMetaObject::invokeMethod(parent, "setProcessingQueuedTransactions", Qt::QueuedConnection, Q_ARG(bool, true));
-        assert(invoked);
-    }
-    for (unsigned int i = 0; i < vQueueNotifications.size(); ++i)
-    {
-        if (vQueueNotifications.size() - i <= 10) {
-            bool invoked = QMetaObject::invokeMethod(parent, "setProcessingQueuedTransactions", Qt::QueuedConnection, Q_ARG(bool, false));
-            assert(invoked);
+    const std::map<uint256, ChangeType> changes = m_changes.Take();
+    if (changes.empty()) return;
+    qDebug() << "TransactionTablePriv::DispatchNotifications: " + QString::number(changes.size()) + " changes";
+
+    interfaces::Wallet& wallet = parent->walletModel->wallet();
+    if (changes.size() > transactionResetThreshold) {
+        // Many changes, for instance after a rescan: reset the model once instead of
+        // moving the rows for each of them. No incoming transaction balloon is shown.
+        parent->beginResetModel();
+        for (const auto& [hash, status] : changes) {
+            updateWallet(wallet, hash, status, true, /*notify=*/false);
         }
+        parent->endResetModel();
+        return;
+    }
 
-        vQueueNotifications[i].invoke(parent);
+    size_t remaining = changes.size();
+    for (const auto& [hash, status] : changes) {
+        // prevent balloon spam, show maximum 10 balloons
+        parent->setProcessingQueuedTransactions(remaining-- > 10);
+        updateWallet(wallet, hash, status, true);
     }
-    vQueueNotifications.clear();
+    parent->setProcessingQueuedTransactions(false);
 }
 
 void TransactionTableModel::subscribeToCoreSignals()
@@ -772,7 +835,7 @@ void TransactionTableModel::subscribeToCoreSignals()
     m_handler_transaction_changed = walletModel->wallet().handleTransactionChanged(std::bind(&TransactionTablePriv::NotifyTransactionChanged, priv, std::placeholders::_1, std::placeholders::_2));
     m_handler_show_progress = walletModel->wallet().handleShowProgress([this](const std::string&, int progress) {
         priv->m_loading = progress < 100;
-        priv->DispatchNotifications();
+        if (!priv->m_loading) priv->ScheduleDispatch();
     });
 }
 
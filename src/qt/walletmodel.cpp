@@ -246,6 +246,7 @@ void WalletModel::checkSuperStakerChanged()
 void WalletModel::updateTransaction()
 {
     // Balance and number of transactions might have changed
+    m_transaction_update_pending = false;
     fForceCheckBalanceChanged = true;
 }
 
@@ -551,10 +552,12 @@ static void NotifyAddressBookChanged(WalletModel *walletmodel,
     assert(invoked);
 }
 
-static void NotifyTransactionChanged(WalletModel *walletmodel, const uint256 &hash, ChangeType status)
+static void NotifyTransactionChanged(WalletModel *walletmodel, std::atomic<bool>& update_pending, const uint256 &hash, ChangeType status)
 {
     Q_UNUSED(hash);
     Q_UNUSED(status);
+    // One queued update covers all the changes notified until it runs
+    if (update_pending.exchange(true)) return;
     bool invoked = QMetaObject::invokeMethod(walletmodel, "updateTransaction", Qt::QueuedConnection);
     assert(invoked);
 }
@@ -603,7 +606,7 @@ void WalletModel::subscribeToCoreSignals()
     m_handler_unload = m_wallet->handleUnload(std::bind(&NotifyUnload, this));
     m_handler_status_changed = m_wallet->handleStatusChanged(std::bind(&NotifyKeyStoreStatusChanged, this));
     m_handler_address_book_changed = m_wallet->handleAddressBookChanged(std::bind(NotifyAddressBookChanged, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, std::placeholders::_5));
-    m_handler_transaction_changed = m_wallet->handleTransactionChanged(std::bind(NotifyTransactionChanged, this, std::placeholders::_1, std::placeholders::_2));
+    m_handler_transaction_changed = m_wallet->handleTransactionChanged(std::bind(NotifyTransactionChanged, this, std::ref(m_transaction_update_pending), std::placeholders::_1, std::placeholders::_2));
     m_handler_show_progress = m_wallet->handleShowProgress(std::bind(ShowProgress, this, std::placeholders::_1, std::placeholders::_2));
     m_handler_watch_only_changed = m_wallet->handleWatchOnlyChanged(std::bind(NotifyWatchonlyChanged, this, std::placeholders::_1));
     m_handler_can_get_addrs_changed = m_wallet->handleCanGetAddressesChanged(std::bind(NotifyCanGetAddressesChanged, this));
@@ -1113,6 +1116,8 @@ void WalletModel::join()
     }
 
     // Join models
+    if(transactionTableModel)
+        transactionTableModel->join();
     if(tokenItemModel)
         tokenItemModel->join();
     if(delegationItemModel)
@@ -217,6 +217,8 @@ private:
 
     bool fHaveWatchOnly;
     bool fForceCheckBalanceChanged{false};
+    /** Set while an updateTransaction call is queued, the next transaction changes are coalesced with it */
+    std::atomic<bool> m_transaction_update_pending{false};
 
     // Wallet has an options model for wallet-specific options
     // (transaction fee, for example)
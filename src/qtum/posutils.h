@@ -3,6 +3,10 @@
 
 #include <uint256.h>
 #include <consensus/amount.h>
+#include <primitives/transaction.h>
+#include <util/hasher.h>
+
+#include <vector>
 
 struct CStakeCache{
     CStakeCache(uint32_t blockFromTime_, CAmount amount_) : blockFromTime(blockFromTime_), amount(amount_){
@@ -11,6 +15,106 @@ struct CStakeCache{
     CAmount amount;
 };
 
+/** Maximum number of slots of a CStakeCacheMap, at most three quarters of them are used */
+static const size_t MAX_STAKE_CACHE_SLOTS = 1 << 20;
+
+/**
+ * Open addressing hash table of the stake data of coins, keyed by outpoint with linear probing.
+ * Each entry is tagged with the generation in which it was last inserted or touched. The miner starts
+ * a generation on each new tip, and the entries that were not used in the current or the previous
+ * generation are dropped when the table is rehashed. The table never grows past MAX_STAKE_CACHE_SLOTS,
+ * new coins are not cached when it is full.
+ */
+class CStakeCacheMap
+{
+public:
+    const CStakeCache* find(const COutPoint& prevout) const
+    {
+        size_t slot = 0;
+        return findSlot(prevout, slot) ? &m_slots[slot].stake : nullptr;
+    }
+
+    /** Mark the coin as used in the current generation, returns false if it is not cached */
+    bool touch(const COutPoint& prevout)
+    {
+        size_t slot = 0;
+        if(!findSlot(prevout, slot)) return false;
+        m_slots[slot].generation = m_generation;
+        return true;
+    }
+
+    /** Cache the coin if it is not already cached and there is room for it */
+    void insert(const COutPoint& prevout, const CStakeCache& stake)
+    {
+        // A full table of the maximum size is rehashed at most once per generation
+        if((m_size + 1) * 4 > m_slots.size() * 3 && (m_slots.size() < MAX_STAKE_CACHE_SLOTS || m_rehash_generation != m_generation)) rehash();
+        size_t slot = 0;
+        if(findSlot(prevout, slot) || (m_size + 1) * 4 > m_slots.size() * 3) return;
+        m_slots[slot] = Entry{prevout, stake, m_generation};
+        m_size++;
+    }
+
+    void newGeneration() { m_generation++; }
+
+    void clear()
+    {
+        m_slots.clear();
+        m_size = 0;
+    }
+
+    size_t size() const { return m_size; }
+    size_t memoryUsage() const { return m_slots.capacity() * sizeof(Entry); }
+
+private:
+    struct Entry
+    {
+        COutPoint prevout;
+        CStakeCache stake{0, 0};
+        uint32_t generation{0}; //!< 0 for an empty slot
+    };
+
+    /** Find the slot of the coin, or the empty slot where it would be inserted */
+    bool findSlot(const COutPoint& prevout, size_t& slot) const
+    {
+        if(m_slots.empty()) return false;
+        const size_t mask = m_slots.size() - 1;
+        for(slot = m_hasher(prevout) & mask; m_slots[slot].generation != 0; slot = (slot + 1) & mask)
+        {
+            if(m_slots[slot].prevout == prevout) return true;
+        }
+        return false;
+    }
+
+    /** Rebuild the table without the unused entries, with twice as many slots as the entries kept */
+    void rehash()
+    {
+        std::vector<Entry> kept;
+        for(const Entry& entry : m_slots)
+        {
+            if(entry.generation != 0 && entry.generation + 1 >= m_generation) kept.push_back(entry);
+        }
+        size_t slots = 16;
+        while(slots < kept.size() * 2 && slots < MAX_STAKE_CACHE_SLOTS) slots *= 2;
+
+        m_slots.assign(slots, Entry{});
+        m_size = 0;
+        m_rehash_generation = m_generation;
+        for(const Entry& entry : kept)
+        {
+            size_t slot = 0;
+            if(findSlot(entry.prevout, slot) || (m_size + 1) * 4 > m_slots.size() * 3) continue;
+            m_slots[slot] = entry;
+            m_size++;
+        }
+    }
+
+    std::vector<Entry> m_slots;
+    size_t m_size{0};
+    uint32_t m_generation{1};
+    uint32_t m_rehash_generation{0};
+    SaltedOutpointHasher m_hasher;
+};
+
 struct Delegation
 {
     Delegation():
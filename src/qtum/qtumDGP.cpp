@@ -1,5 +1,36 @@
 #include <qtum/qtumDGP.h>
 #include <chainparams.h>
+#include <sync.h>
+
+namespace {
+/** Upper bound for the number of entries of each DGP cache map, they are simply cleared when exceeded */
+static const size_t MAX_DGP_CACHE_ENTRIES = 256;
+
+using DGPStorage = std::map<dev::h256, std::pair<dev::u256, dev::u256>>;
+using DGPParamsInstance = std::vector<std::pair<unsigned int, dev::Address>>;
+
+/**
+ * Process-wide cache of the data decoded from the DGP contracts.
+ *
+ * Entries are keyed by the hash of the committed account of the contract they were read from,
+ * which covers its code and storage root. Blocks that do not touch a DGP contract keep hitting
+ * the same entries, a block that changes one (or a reorg that undoes it) simply selects other
+ * entries, so nothing ever has to be invalidated explicitly. The manager contract entries hold
+ * the activation heights of the parameter contracts, the template entries their parameters.
+ */
+Mutex cs_dgpcache;
+std::map<std::pair<dev::Address, dev::h256>, DGPParamsInstance> cacheParamsInstance GUARDED_BY(cs_dgpcache);
+std::map<std::pair<dev::Address, dev::h256>, DGPStorage> cacheStorageTemplate GUARDED_BY(cs_dgpcache);
+std::map<std::tuple<dev::Address, dev::h256, std::vector<unsigned char>>, std::vector<unsigned char>> cacheDataTemplate GUARDED_BY(cs_dgpcache);
+
+template <typename K, typename V>
+void insertDGPCache(std::map<K, V>& cache, const K& key, const V& value) EXCLUSIVE_LOCKS_REQUIRED(cs_dgpcache)
+{
+    if(cache.size() >= MAX_DGP_CACHE_ENTRIES)
+        cache.clear();
+    cache[key] = value;
+}
+}
 
 std::vector<uint32_t> createDataSchedule(const dev::eth::EVMSchedule& schedule)
 {
@@ -19,14 +50,14 @@ std::vector<uint32_t> createDataSchedule(const dev::eth::EVMSchedule& schedule)
     return tempData;
 }
 
-std::vector<uint32_t> scheduleDataForBlockNumber(unsigned int blockHeight)
+std::vector<uint32_t> scheduleDataForBlockNumber(const dev::eth::SealEngineFace& sealEngine, unsigned int blockHeight)
 {
-    dev::eth::EVMSchedule schedule = globalSealEngine->chainParams().scheduleForBlockNumber(blockHeight);
+    dev::eth::EVMSchedule schedule = sealEngine.chainParams().scheduleForBlockNumber(blockHeight);
     return createDataSchedule(schedule);
 }
 
 void QtumDGP::initDataSchedule(){
-    dataSchedule = scheduleDataForBlockNumber(0);
+    dataSchedule = scheduleDataForBlockNumber(*chainstate.m_chainman.Qtum().sealEngine, 0);
 }
 
 bool QtumDGP::checkLimitSchedule(const std::vector<uint32_t>& defaultData, const std::vector<uint32_t>& checkData, int blockHeight){
@@ -47,8 +78,9 @@ bool QtumDGP::checkLimitSchedule(const std::vector<uint32_t>& defaultData, const
 
 dev::eth::EVMSchedule QtumDGP::getGasSchedule(int blockHeight){
     clear();
-    dataSchedule = scheduleDataForBlockNumber(blockHeight);
-    dev::eth::EVMSchedule schedule = globalSealEngine->chainParams().scheduleForBlockNumber(blockHeight);
+    const dev::eth::SealEngineFace& sealEngine = *chainstate.m_chainman.Qtum().sealEngine;
+    dataSchedule = scheduleDataForBlockNumber(sealEngine, blockHeight);
+    dev::eth::EVMSchedule schedule = sealEngine.chainParams().scheduleForBlockNumber(blockHeight);
     if(initStorages(GasScheduleDGP, blockHeight, ParseHex("26fadbe2"))){
         schedule = createEVMSchedule(schedule, blockHeight);
     }
@@ -98,8 +130,26 @@ uint64_t QtumDGP::getBlockGasLimit(unsigned int blockHeight){
 }
 
 bool QtumDGP::initStorages(const dev::Address& addr, unsigned int blockHeight, std::vector<unsigned char> data){
-    initStorageDGP(addr);
-    createParamsInstance();
+    dev::h256 accountHash;
+    bool cached = committedAccountHash(addr, accountHash);
+    std::pair<dev::Address, dev::h256> key(addr, accountHash);
+    bool found = false;
+    if(cached){
+        LOCK(cs_dgpcache);
+        auto it = cacheParamsInstance.find(key);
+        if(it != cacheParamsInstance.end()){
+            paramsInstance = it->second;
+            found = true;
+        }
+    }
+    if(!found){
+        initStorageDGP(addr);
+        createParamsInstance();
+        if(cached){
+            LOCK(cs_dgpcache);
+            insertDGPCache(cacheParamsInstance, key, paramsInstance);
+        }
+    }
     dev::Address address = getAddressForBlock(blockHeight);
     if(address != dev::Address()){
         if(!dgpevm){
@@ -117,11 +167,53 @@ void QtumDGP::initStorageDGP(const dev::Address& addr){
 }
 
 void QtumDGP::initStorageTemplate(const dev::Address& addr){
+    dev::h256 accountHash;
+    if(!committedAccountHash(addr, accountHash)){
+        storageTemplate = state->storage(addr);
+        return;
+    }
+    std::pair<dev::Address, dev::h256> key(addr, accountHash);
+    {
+        LOCK(cs_dgpcache);
+        auto it = cacheStorageTemplate.find(key);
+        if(it != cacheStorageTemplate.end()){
+            storageTemplate = it->second;
+            return;
+        }
+    }
     storageTemplate = state->storage(addr);
+    LOCK(cs_dgpcache);
+    insertDGPCache(cacheStorageTemplate, key, storageTemplate);
 }
 
 void QtumDGP::initDataTemplate(const dev::Address& addr, std::vector<unsigned char>& data){
+    dev::h256 accountHash;
+    if(!committedAccountHash(addr, accountHash)){
+        dataTemplate = CallContract(addr, data, chainstate)[0].execRes.output;
+        return;
+    }
+    // The parameter contracts are plain getters, their output only depends on their own code and storage
+    std::tuple<dev::Address, dev::h256, std::vector<unsigned char>> key(addr, accountHash, data);
+    {
+        LOCK(cs_dgpcache);
+        auto it = cacheDataTemplate.find(key);
+        if(it != cacheDataTemplate.end()){
+            dataTemplate = it->second;
+            return;
+        }
+    }
+    // Not locked while executing, CallContract builds a QtumDGP of its own
     dataTemplate = CallContract(addr, data, chainstate)[0].execRes.output;
+    LOCK(cs_dgpcache);
+    insertDGPCache(cacheDataTemplate, key, dataTemplate);
+}
+
+bool QtumDGP::committedAccountHash(const dev::Address& addr, dev::h256& hash){
+    // Uncommitted changes are not covered by the trie leaf, such lookups bypass the cache
+    if(state->isAccountDirty(addr))
+        return false;
+    hash = dev::sha3(state->committedAccount(addr));
+    return true;
 }
 
 void QtumDGP::createParamsInstance(){
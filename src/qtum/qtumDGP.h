@@ -46,6 +46,8 @@ private:
 
     void initStorageTemplate(const dev::Address& addr);
 
+    bool committedAccountHash(const dev::Address& addr, dev::h256& hash);
+
     void initDataTemplate(const dev::Address& addr, std::vector<unsigned char>& data);
 
     void initDataSchedule();
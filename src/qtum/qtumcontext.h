@@ -0,0 +1,26 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QTUM_QTUMCONTEXT_H
+#define QTUM_QTUMCONTEXT_H
+
+#include <qtum/qtumstate.h>
+
+#include <memory>
+
+class StorageResults;
+
+/**
+ * What a ChainstateManager validates contracts with: the contract state, the seal engine and the
+ * receipt storage. The node's ChainstateManager uses the process-wide context that globalState,
+ * globalSealEngine and pstorageresult refer to, while a validation engine embedded in another
+ * process can give each of its ChainstateManagers a context of its own.
+ */
+struct QtumContext {
+    std::unique_ptr<QtumState> state;
+    std::shared_ptr<dev::eth::SealEngineFace> sealEngine;
+    std::unique_ptr<StorageResults> storageResults;
+};
+
+#endif // QTUM_QTUMCONTEXT_H
@@ -1,5 +1,6 @@
 #include <qtum/qtumdelegation.h>
 #include <chainparams.h>
+#include <index/delegationindex.h>
 #include <util/contractabi.h>
 #include <util/convert.h>
 #include <validation.h>
@@ -178,6 +179,29 @@ bool QtumDelegation::GetDelegation(const uint160 &address, Delegation &delegatio
     if(!priv->m_pfDelegations)
         return error("Get delegation ABI does not exist");
 
+    // The delegation cache has the delegations of the current state without executing the contract
+    uint256 stateRoot;
+    {
+        LOCK(cs_main);
+        stateRoot = h256Touint(chainstate.m_chainman.Qtum().state->rootHash());
+    }
+    DelegationCache& cache = GetDelegationCache();
+    if(cache.Lookup(stateRoot, address, delegation))
+        return true;
+
+    // The delegation index has the delegations of the tip without executing the contract
+    if(g_delegationindex)
+    {
+        LOCK(cs_main);
+        const CBlockIndex* tip = chainstate.m_chain.Tip();
+        if(tip && chainstate.m_chainman.Qtum().state && chainstate.m_chainman.Qtum().state->rootHash() == uintToh256(tip->hashStateRoot) &&
+                g_delegationindex->LookupDelegation(tip->GetBlockHash(), address, delegation))
+        {
+            cache.Insert(tip->hashStateRoot, address, delegation);
+            return true;
+        }
+    }
+
     // Serialize the input parameters for get delegation
     std::vector<std::vector<std::string>> inputValues;
     std::vector<std::string> paramAddress;
@@ -192,6 +216,7 @@ bool QtumDelegation::GetDelegation(const uint160 &address, Delegation &delegatio
     std::vector<ResultExecute> execResults;
     {
         LOCK(cs_main);
+        stateRoot = h256Touint(chainstate.m_chainman.Qtum().state->rootHash());
         execResults = CallContract(priv->delegationsAddress, ParseHex(inputData), chainstate);
     }
     if(execResults.size() < 1)
@@ -245,6 +270,8 @@ bool QtumDelegation::GetDelegation(const uint160 &address, Delegation &delegatio
         return error("Parsing failed for get delegation outputs");
     }
 
+    cache.Insert(stateRoot, address, delegation);
+
     return true;
 }
 
@@ -256,6 +283,11 @@ bool QtumDelegation::VerifyDelegation(const uint160 &address, const Delegation &
     return SignStr::VerifyMessage(CKeyID(address), delegation.staker.GetReverseHex(), delegation.PoD);
 }
 
+bool QtumDelegation::GetDelegationEvent(const dev::eth::LogEntry &log, DelegationEvent &event) const
+{
+    return priv->GetDelegationEvent(log, event);
+}
+
 bool QtumDelegation::FilterDelegationEvents(std::vector<DelegationEvent> &events, const IDelegationFilter &filter, ChainstateManager &chainman, int fromBlock, int toBlock, int minconf) const
 {
     // Check if log events are enabled
@@ -279,7 +311,7 @@ bool QtumDelegation::FilterDelegationEvents(std::vector<DelegationEvent> &events
     std::set<dev::h160> addresses;
     addresses.insert(priv->delegationsAddress);
     std::vector<std::vector<uint256>> hashesToBlock;
-    curheight = chainman.m_blockman.m_block_tree_db->ReadHeightIndex(fromBlock, toBlock, minconf, hashesToBlock, addresses, chainman);
+    curheight = chainman.m_blockman.m_qtum_index_db->ReadHeightIndex(fromBlock, toBlock, minconf, hashesToBlock, addresses, chainman);
 
     if (curheight == -1) {
         return error("Incorrect params");
@@ -475,3 +507,113 @@ bool QtumDelegation::SetSignedStaker(std::vector<unsigned char> &data, const std
 
     return true;
 }
+
+bool DelegationCache::Lookup(const uint256 &stateRoot, const uint160 &address, Delegation &delegation) const
+{
+    LOCK(m_mutex);
+    if(stateRoot != m_state_root)
+        return false;
+
+    auto it = m_delegations.find(address);
+    if(it == m_delegations.end())
+        return false;
+
+    delegation = it->second;
+    return true;
+}
+
+void DelegationCache::Insert(const uint256 &stateRoot, const uint160 &address, const Delegation &delegation)
+{
+    LOCK(m_mutex);
+    // An empty cache starts at the state root of its first entry
+    if(m_delegations.empty() && m_undo.empty())
+        m_state_root = stateRoot;
+    if(stateRoot != m_state_root)
+        return;
+
+    if(m_delegations.size() >= MAX_DELEGATION_CACHE_SIZE)
+        Reset(stateRoot);
+    m_delegations[address] = delegation;
+}
+
+void DelegationCache::ConnectBlock(const uint256 &stateRootBefore, const uint256 &stateRootAfter, const std::vector<DelegationEvent> &events)
+{
+    LOCK(m_mutex);
+    if(stateRootBefore != m_state_root)
+    {
+        Reset(stateRootAfter);
+        return;
+    }
+
+    BlockUndo undo;
+    undo.stateRootBefore = stateRootBefore;
+    undo.stateRootAfter = stateRootAfter;
+    for(const DelegationEvent& event : events)
+    {
+        if(event.type != DELEGATION_ADD && event.type != DELEGATION_REMOVE)
+            continue;
+
+        const uint160& address = event.item.delegate;
+        auto it = m_delegations.find(address);
+        undo.previous.emplace_back(address, it != m_delegations.end() ? std::optional<Delegation>(it->second) : std::nullopt);
+
+        // The contract returns a null delegation for the removed ones
+        m_delegations[address] = event.type == DELEGATION_ADD ? Delegation(event.item) : Delegation();
+    }
+
+    m_state_root = stateRootAfter;
+    m_undo.push_back(std::move(undo));
+    if(m_undo.size() > DELEGATION_CACHE_UNDO_DEPTH)
+        m_undo.erase(m_undo.begin());
+    if(m_delegations.size() > MAX_DELEGATION_CACHE_SIZE)
+        Reset(stateRootAfter);
+}
+
+void DelegationCache::DisconnectBlock(const uint256 &stateRootAfter, const uint256 &stateRootBefore)
+{
+    LOCK(m_mutex);
+    if(stateRootAfter != m_state_root || m_undo.empty() ||
+            m_undo.back().stateRootAfter != stateRootAfter || m_undo.back().stateRootBefore != stateRootBefore)
+    {
+        Reset(stateRootBefore);
+        return;
+    }
+
+    // Restore the previous delegations in reverse order, for the addresses changed more than once
+    const BlockUndo& undo = m_undo.back();
+    for(auto it = undo.previous.rbegin(); it != undo.previous.rend(); ++it)
+    {
+        if(it->second)
+            m_delegations[it->first] = *it->second;
+        else
+            m_delegations.erase(it->first);
+    }
+
+    m_state_root = stateRootBefore;
+    m_undo.pop_back();
+}
+
+void DelegationCache::Clear()
+{
+    LOCK(m_mutex);
+    Reset(uint256());
+}
+
+size_t DelegationCache::Size() const
+{
+    LOCK(m_mutex);
+    return m_delegations.size();
+}
+
+void DelegationCache::Reset(const uint256 &stateRoot)
+{
+    m_state_root = stateRoot;
+    m_delegations.clear();
+    m_undo.clear();
+}
+
+DelegationCache& GetDelegationCache()
+{
+    static DelegationCache cache;
+    return cache;
+}
@@ -3,14 +3,17 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <optional>
 #include <stdint.h>
 #include <uint256.h>
+#include <sync.h>
 #include <qtum/posutils.h>
 
 class QtumDelegationPriv;
 class ContractABI;
 class ChainstateManager;
 class Chainstate;
+namespace dev { namespace eth { struct LogEntry; } }
 
 extern const std::string strDelegationsABI;
 const ContractABI &DelegationABI();
@@ -87,6 +90,14 @@ public:
      */
     static bool VerifyDelegation(const uint160& address, const Delegation& delegation);
 
+    /**
+     * @brief GetDelegationEvent Parse a delegation event
+     * @param log Log emitted by a contract
+     * @param event Output delegation event
+     * @return true if the log is an event of the delegation contract
+     */
+    bool GetDelegationEvent(const dev::eth::LogEntry& log, DelegationEvent& event) const;
+
     /**
      * @brief FilterDelegationEvents Filter delegation events
      * @param events Output list of delegation events for the filter
@@ -164,4 +175,74 @@ private:
     QtumDelegation& operator=(const QtumDelegation&);
     QtumDelegationPriv* priv;
 };
+
+//! Maximum number of addresses the delegation cache holds before it is emptied
+static constexpr size_t MAX_DELEGATION_CACHE_SIZE = 100000;
+//! Number of connected blocks the delegation cache can be moved back over
+static constexpr size_t DELEGATION_CACHE_UNDO_DEPTH = 100;
+
+/**
+ * @brief The DelegationCache class Native cache of the delegations of the delegation contract
+ *
+ * The cache holds delegations of the contract state of one state root, so that looking them up
+ * does not call the contract in the EVM. The entries are filled from the contract calls, then
+ * follow the chain with the AddDelegation and RemoveDelegation events of the connected blocks
+ * and go back with the disconnected ones. A block that does not follow the state root of the
+ * cache empties it.
+ */
+class DelegationCache
+{
+public:
+    /**
+     * @brief Lookup Get the cached delegation for an address
+     * @param stateRoot State root the delegation is looked up in
+     * @param address Public key hash address
+     * @param delegation Delegation information for an address, null if the address has not delegated
+     * @return true if the delegation of the address is cached for that state root
+     */
+    bool Lookup(const uint256& stateRoot, const uint160& address, Delegation& delegation) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /**
+     * @brief Insert Cache the delegation read from the contract at a state root
+     */
+    void Insert(const uint256& stateRoot, const uint160& address, const Delegation& delegation) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /**
+     * @brief ConnectBlock Move the cache to the state root of a connected block
+     * @param stateRootBefore State root the block is connected on
+     * @param stateRootAfter State root of the block
+     * @param events Delegation events emitted by the block, in block order
+     */
+    void ConnectBlock(const uint256& stateRootBefore, const uint256& stateRootAfter, const std::vector<DelegationEvent>& events) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /**
+     * @brief DisconnectBlock Move the cache back to the state root before a disconnected block
+     */
+    void DisconnectBlock(const uint256& stateRootAfter, const uint256& stateRootBefore) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    void Clear() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    size_t Size() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    struct BlockUndo
+    {
+        uint256 stateRootBefore;
+        uint256 stateRootAfter;
+        //! Cached delegations before the block of the addresses it changed, nullopt if not cached
+        std::vector<std::pair<uint160, std::optional<Delegation>>> previous;
+    };
+
+    void Reset(const uint256& stateRoot) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    mutable Mutex m_mutex;
+    uint256 m_state_root GUARDED_BY(m_mutex);
+    std::map<uint160, Delegation> m_delegations GUARDED_BY(m_mutex);
+    std::vector<BlockUndo> m_undo GUARDED_BY(m_mutex);
+};
+
+/**
+ * @brief GetDelegationCache Delegation cache of the node
+ */
+DelegationCache& GetDelegationCache();
 #endif
@@ -123,6 +123,121 @@ bool isPyPath(const std::string& str)
 }
 #endif
 
+// Long-lived helper process that runs the HWI commands it reads from its standard input
+class CHelperProcess
+{
+public:
+    ~CHelperProcess()
+    {
+        stop();
+    }
+
+    // Set helper params
+    void setProgram(const std::string& prog, const std::vector<std::string> &arg)
+    {
+        stop();
+        m_program = prog;
+        m_arguments = arg;
+    }
+
+    bool isConfigured() const
+    {
+        return !m_program.empty();
+    }
+
+    // Run a command, the helper is started again once when it is not running or stopped answering
+    bool request(const std::vector<std::string>& command, std::string& result)
+    {
+        UniValue args(UniValue::VARR);
+        for(const std::string& arg : command)
+            args.push_back(arg);
+        const std::string payload = args.write();
+
+        for(int attempt = 0; attempt < 2; attempt++)
+        {
+            if(!m_child && !start())
+                return false;
+            if(exchange(payload, result))
+                return true;
+            LogPrintf("QtumLedger(): HWI helper %s stopped answering, restarting it\n", m_program);
+            stop();
+        }
+        return false;
+    }
+
+private:
+    bool start()
+    {
+        try
+        {
+            m_in = std::make_unique<boost::process::opstream>();
+            m_out = std::make_unique<boost::process::ipstream>();
+    #ifdef WIN32
+            m_child = std::make_unique<boost::process::child>(m_program, ::boost::process::windows::create_no_window, boost::process::args(m_arguments),
+                                                              boost::process::std_in < *m_in, boost::process::std_out > *m_out, boost::process::std_err > boost::process::null);
+    #else
+            m_child = std::make_unique<boost::process::child>(m_program, boost::process::args(m_arguments),
+                                                              boost::process::std_in < *m_in, boost::process::std_out > *m_out, boost::process::std_err > boost::process::null);
+    #endif
+            return true;
+        }
+        catch(...)
+        {
+            LogPrintf("QtumLedger(): Fail to create HWI helper process for: %s\n", m_program);
+            stop();
+            return false;
+        }
+    }
+
+    void stop()
+    {
+        if(m_child)
+        {
+            std::error_code ec;
+            if(m_child->running(ec))
+                m_child->terminate(ec);
+            else
+                m_child->wait(ec);
+        }
+        m_child.reset();
+        m_in.reset();
+        m_out.reset();
+    }
+
+    // Write the request frame and read the response frame, each one is the payload size on a line followed by the payload
+    bool exchange(const std::string& payload, std::string& result)
+    {
+        try
+        {
+            std::error_code ec;
+            if(!m_child->running(ec))
+                return false;
+
+            *m_in << payload.size() << '\n' << payload << std::flush;
+            std::string line;
+            if(!*m_in || !std::getline(*m_out, line))
+                return false;
+
+            uint64_t size = 0;
+            if(!ParseUInt64(line, &size))
+                return false;
+            result.resize(size);
+            return size == 0 || m_out->read(result.data(), size);
+        }
+        catch(...)
+        {
+            return false;
+        }
+    }
+
+private:
+    std::string m_program;
+    std::vector<std::string> m_arguments;
+    std::unique_ptr<boost::process::child> m_child;
+    std::unique_ptr<boost::process::opstream> m_in;
+    std::unique_ptr<boost::process::ipstream> m_out;
+};
+
 // Start process from qtumd
 class CProcess
 {
@@ -140,9 +255,24 @@ public:
         m_arguments = arg;
     }
 
+    // Run the commands with a helper process, the arguments that select the tool are skipped
+    void setHelper(CHelperProcess* helper, size_t skip)
+    {
+        m_helper = helper;
+        m_helper_skip = skip;
+    }
+
     // Start and wait for it to finish
     void waitForFinished()
     {
+        // The helper avoids starting the tool for each command, the tool is started when the helper fails
+        if(m_helper && m_helper->isConfigured())
+        {
+            std::vector<std::string> command(m_arguments.begin() + std::min(m_helper_skip, m_arguments.size()), m_arguments.end());
+            if(m_helper->request(command, m_std_out))
+                return;
+        }
+
         try
         {
             boost::asio::io_service svc;
@@ -201,6 +331,8 @@ private:
     std::vector<std::string> m_arguments;
     std::string m_std_out;
     std::string m_std_err;
+    CHelperProcess* m_helper = nullptr;
+    size_t m_helper_skip = 0;
 };
 }
 using namespace QtumLedger_NS;
@@ -211,6 +343,7 @@ public:
     QtumLedgerPriv()
     {
         toolPath = gArgs.GetArg("-hwitoolpath", "");
+        const std::string hwiPath = toolPath;
         toolExists = boost::filesystem::exists(toolPath);
         initToolPath();
 
@@ -225,6 +358,37 @@ public:
         {
             LogPrintf("QtumLedger(): HWI tool not found %s\n", toolPath);
         }
+
+        initHelper(hwiPath);
+    }
+
+    void initHelper(const std::string& hwiPath)
+    {
+        std::string helperPath = gArgs.GetArg("-hwihelperpath", "");
+        if(!toolExists || helperPath.empty())
+            return;
+
+        if(!boost::filesystem::exists(helperPath))
+        {
+            LogPrintf("QtumLedger(): HWI helper not found %s\n", helperPath);
+            return;
+        }
+
+        std::vector<std::string> arg;
+#ifdef WIN32
+        // The helper script is run with the interpreter of the tool
+        if(scriptArguments > 0)
+        {
+            arg << helperPath << hwiPath;
+            helper.setProgram(toolPath, arg);
+        }
+        else
+#endif
+        {
+            arg << hwiPath;
+            helper.setProgram(helperPath, arg);
+        }
+        process.setHelper(&helper, scriptArguments);
     }
 
 #ifdef WIN32
@@ -258,6 +422,7 @@ public:
                 endsWith(toolPath, ".pY"))
         {
             arguments << toolPath;
+            scriptArguments = arguments.size();
             if(!getToolPath("python3"))
                 getToolPath("python");
         }
@@ -265,11 +430,13 @@ public:
     }
 
     std::atomic<bool> fStarted{false};
+    CHelperProcess helper;
     CProcess process;
     std::string strStdout;
     std::string strError;
     std::string toolPath;
     std::vector<std::string> arguments;
+    size_t scriptArguments = 0;
     bool toolExists = false;
     bool ledgerMainPath = true;
 };
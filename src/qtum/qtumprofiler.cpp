@@ -0,0 +1,93 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qtum/qtumprofiler.h>
+
+ContractProfiler g_contract_profiler;
+
+//! The profiled execution running on this thread, if any
+static thread_local ContractProfiler::Execution* t_execution{nullptr};
+
+void ContractProfile::Add(const ContractProfile& other)
+{
+    calls += other.calls;
+    gas_used += other.gas_used;
+    sloads += other.sloads;
+    sstores += other.sstores;
+    precompile_calls += other.precompile_calls;
+    precompile_time += other.precompile_time;
+    wall_time += other.wall_time;
+}
+
+ContractProfiler::Execution::Execution(bool profile)
+{
+    // Nested executions are part of the outer one
+    if (!profile || !g_contract_profiler.IsEnabled() || t_execution) return;
+    m_active = true;
+    m_start = std::chrono::steady_clock::now();
+    t_execution = this;
+}
+
+ContractProfiler::Execution::~Execution()
+{
+    if (!m_active) return;
+    t_execution = nullptr;
+    if (m_finished) {
+        m_profiles[m_contract].Add(m_total);
+        g_contract_profiler.Merge(m_profiles);
+    }
+}
+
+void ContractProfiler::Execution::Finish(const dev::Address& contract, uint64_t gas_used)
+{
+    if (!m_active) return;
+    m_finished = true;
+    m_contract = contract;
+    m_total.calls = 1;
+    m_total.gas_used = gas_used;
+    m_total.wall_time = std::chrono::steady_clock::now() - m_start;
+}
+
+bool ContractProfiler::Active()
+{
+    return t_execution != nullptr;
+}
+
+void ContractProfiler::RecordStorageRead(const dev::Address& contract)
+{
+    if (t_execution) ++t_execution->m_profiles[contract].sloads;
+}
+
+void ContractProfiler::RecordStorageWrite(const dev::Address& contract)
+{
+    if (t_execution) ++t_execution->m_profiles[contract].sstores;
+}
+
+void ContractProfiler::RecordPrecompile(const dev::Address& caller, std::chrono::nanoseconds time)
+{
+    if (!t_execution) return;
+    ContractProfile& profile = t_execution->m_profiles[caller];
+    ++profile.precompile_calls;
+    profile.precompile_time += time;
+}
+
+std::map<dev::Address, ContractProfile> ContractProfiler::GetProfiles() const
+{
+    LOCK(m_mutex);
+    return std::map<dev::Address, ContractProfile>(m_profiles.begin(), m_profiles.end());
+}
+
+void ContractProfiler::Reset()
+{
+    LOCK(m_mutex);
+    m_profiles.clear();
+}
+
+void ContractProfiler::Merge(const std::unordered_map<dev::Address, ContractProfile>& profiles)
+{
+    LOCK(m_mutex);
+    for (const auto& [contract, profile] : profiles) {
+        m_profiles[contract].Add(profile);
+    }
+}
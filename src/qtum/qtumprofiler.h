@@ -0,0 +1,100 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QTUM_QTUMPROFILER_H
+#define QTUM_QTUMPROFILER_H
+
+#include <libdevcore/Address.h>
+#include <sync.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+/** Default for -contractprofile */
+static constexpr bool DEFAULT_CONTRACT_PROFILE{false};
+
+/** Execution statistics of a contract */
+struct ContractProfile
+{
+    //! Transactions that called or created the contract
+    uint64_t calls{0};
+    //! Gas used by those transactions
+    uint64_t gas_used{0};
+    //! Storage reads and writes done by the code of the contract, including nested calls into it
+    uint64_t sloads{0};
+    uint64_t sstores{0};
+    //! Precompiles called by the code of the contract, and the time spent in them
+    uint64_t precompile_calls{0};
+    std::chrono::nanoseconds precompile_time{0};
+    //! Time spent executing the transactions to the contract
+    std::chrono::nanoseconds wall_time{0};
+
+    void Add(const ContractProfile& other);
+};
+
+/**
+ * ContractProfiler aggregates per contract statistics of the EVM executions committed by
+ * ConnectBlock and the miner, to find the contracts that make blocks slow to validate.
+ *
+ * An execution records into a profile of its own, reachable from a thread local pointer, so
+ * the VM hooks neither lock nor do any work when profiling is off. The profile is merged when
+ * the execution finishes.
+ */
+class ContractProfiler
+{
+public:
+    /** Profile of a single transaction execution, active while it is in scope */
+    class Execution
+    {
+    public:
+        explicit Execution(bool profile);
+        ~Execution();
+
+        Execution(const Execution&) = delete;
+        Execution& operator=(const Execution&) = delete;
+
+        /** Set the contract the transaction called or created, and the gas it used */
+        void Finish(const dev::Address& contract, uint64_t gas_used);
+
+    private:
+        friend class ContractProfiler;
+
+        bool m_active{false};
+        bool m_finished{false};
+        dev::Address m_contract;
+        ContractProfile m_total;
+        std::unordered_map<dev::Address, ContractProfile> m_profiles;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    void SetEnabled(bool enabled) { m_enabled = enabled; }
+    bool IsEnabled() const { return m_enabled; }
+
+    /** Whether the current thread is running a profiled execution */
+    static bool Active();
+
+    static void RecordStorageRead(const dev::Address& contract);
+    static void RecordStorageWrite(const dev::Address& contract);
+    static void RecordPrecompile(const dev::Address& caller, std::chrono::nanoseconds time);
+
+    /** Return the statistics aggregated since startup or the last reset */
+    std::map<dev::Address, ContractProfile> GetProfiles() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    void Reset() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    void Merge(const std::unordered_map<dev::Address, ContractProfile>& profiles) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    std::atomic<bool> m_enabled{DEFAULT_CONTRACT_PROFILE};
+
+    mutable Mutex m_mutex;
+    std::unordered_map<dev::Address, ContractProfile> m_profiles GUARDED_BY(m_mutex);
+};
+
+extern ContractProfiler g_contract_profiler;
+
+#endif // QTUM_QTUMPROFILER_H
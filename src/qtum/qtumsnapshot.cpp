@@ -0,0 +1,186 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qtum/qtumsnapshot.h>
+
+#include <qtum/qtumstate.h>
+#include <streams.h>
+#include <tinyformat.h>
+#include <util/convert.h>
+
+#include <ios>
+
+namespace qtum {
+
+/* After the metadata the snapshot holds the accounts, each preceded by a non-zero byte and
+ * terminated by a zero byte, then the vins of the UTXO trie in the same way. The leaves are
+ * written in the order of the hashed keys, which is not needed to rebuild the tries but keeps
+ * the export of a given state deterministic.
+ */
+static constexpr uint8_t SNAPSHOT_ENTRY{1};
+static constexpr uint8_t SNAPSHOT_END{0};
+
+/** Number of accounts read per page while writing, and of accounts or vins committed at once while loading */
+static constexpr size_t SNAPSHOT_BATCH_SIZE{1000};
+
+namespace {
+
+struct SnapshotAccount {
+    uint160 address;
+    uint256 nonce;
+    uint256 balance;
+    uint256 version;
+    std::vector<unsigned char> code;
+    std::vector<std::pair<uint256, uint256>> storage;
+
+    SERIALIZE_METHODS(SnapshotAccount, obj) { READWRITE(obj.address, obj.nonce, obj.balance, obj.version, obj.code, obj.storage); }
+};
+
+struct SnapshotVin {
+    uint160 address;
+    uint256 hash;
+    uint32_t nVout;
+    uint256 value;
+    uint8_t alive;
+
+    SERIALIZE_METHODS(SnapshotVin, obj) { READWRITE(obj.address, obj.hash, obj.nVout, obj.value, obj.alive); }
+};
+
+dev::u256 ToU256(const uint256& in)
+{
+    return dev::u256(uintToh256(in));
+}
+
+} // namespace
+
+bool WriteContractStateSnapshot(AutoFile& afile, const ContractStateSnapshotMetadata& metadata, const QtumStateView& view,
+                                ContractStateSnapshotStats& stats, const std::function<void()>& interruption_point)
+{
+    std::unique_ptr<QtumState> state = view.makeState();
+    stats = ContractStateSnapshotStats{};
+    afile << metadata;
+
+    dev::h256 next;
+    do {
+        interruption_point();
+        auto page = state->addresses(next, SNAPSHOT_BATCH_SIZE);
+        for (const auto& entry : page.first) {
+            const dev::Address& addr = entry.second;
+            SnapshotAccount account;
+            account.address = h160Touint(addr);
+            account.nonce = u256Touint(state->getNonce(addr));
+            account.balance = u256Touint(state->balance(addr));
+            account.version = u256Touint(state->version(addr));
+            account.code = state->code(addr);
+            for (const auto& slot : state->storage(addr)) {
+                if (slot.second.second == 0) continue;
+                account.storage.emplace_back(u256Touint(slot.second.first), u256Touint(slot.second.second));
+            }
+            afile << SNAPSHOT_ENTRY << account;
+            ++stats.accounts;
+            stats.storage_slots += account.storage.size();
+        }
+        next = page.second;
+        // The pages read through the account cache, which is not needed afterwards
+        state->setRoot(state->rootHash());
+    } while (next != dev::h256());
+    afile << SNAPSHOT_END;
+
+    bool iterated = state->forEachCommittedVin([&](const dev::Address& addr, const Vin& vin) {
+        if (stats.vins % 5000 == 0) interruption_point();
+        afile << SNAPSHOT_ENTRY << SnapshotVin{h160Touint(addr), h256Touint(vin.hash), vin.nVout, u256Touint(vin.value), vin.alive};
+        ++stats.vins;
+    });
+    afile << SNAPSHOT_END;
+
+    // A non-empty state has at least one account, which the iteration would have found
+    return iterated && (stats.accounts > 0 || view.rootHash() == dev::EmptyTrie);
+}
+
+bool LoadContractStateSnapshot(AutoFile& afile, const ContractStateSnapshotMetadata& metadata, QtumState& state,
+                               ContractStateSnapshotStats& stats, std::string& error, const std::function<void()>& interruption_point)
+{
+    stats = ContractStateSnapshotStats{};
+    state.setRoot(dev::EmptyTrie);
+    state.setRootUTXO(dev::EmptyTrie);
+
+    try {
+        uint8_t marker;
+        dev::eth::AccountMap accounts;
+        auto commitAccounts = [&]() {
+            state.populateFrom(accounts);
+            state.db().commit();
+            accounts.clear();
+        };
+        while (true) {
+            afile >> marker;
+            if (marker == SNAPSHOT_END) break;
+            if (marker != SNAPSHOT_ENTRY) {
+                error = "invalid account entry";
+                return false;
+            }
+            SnapshotAccount account;
+            afile >> account;
+            dev::Address addr(uintToh160(account.address));
+            if (accounts.count(addr)) {
+                error = strprintf("duplicate account %s", addr.hex());
+                return false;
+            }
+            dev::eth::Account& acc = accounts.emplace(std::piecewise_construct, std::forward_as_tuple(addr),
+                std::forward_as_tuple(ToU256(account.nonce), ToU256(account.balance), dev::EmptyTrie, dev::EmptySHA3, ToU256(account.version), dev::eth::Account::Changed)).first->second;
+            if (!account.code.empty()) {
+                acc.setCode(std::move(account.code), ToU256(account.version));
+            }
+            for (const auto& slot : account.storage) {
+                acc.setStorage(ToU256(slot.first), ToU256(slot.second));
+            }
+            ++stats.accounts;
+            stats.storage_slots += account.storage.size();
+            if (accounts.size() >= SNAPSHOT_BATCH_SIZE) {
+                interruption_point();
+                commitAccounts();
+            }
+        }
+        commitAccounts();
+
+        std::unordered_map<dev::Address, Vin> vins;
+        auto commitVins = [&]() {
+            state.importVins(vins);
+            state.dbUtxo().commit();
+            vins.clear();
+        };
+        while (true) {
+            afile >> marker;
+            if (marker == SNAPSHOT_END) break;
+            if (marker != SNAPSHOT_ENTRY) {
+                error = "invalid vin entry";
+                return false;
+            }
+            SnapshotVin vin;
+            afile >> vin;
+            vins[uintToh160(vin.address)] = Vin{uintToh256(vin.hash), vin.nVout, ToU256(vin.value), vin.alive};
+            ++stats.vins;
+            if (vins.size() >= SNAPSHOT_BATCH_SIZE) {
+                interruption_point();
+                commitVins();
+            }
+        }
+        commitVins();
+    } catch (const std::ios_base::failure& e) {
+        error = strprintf("bad snapshot format or truncated snapshot: %s", e.what());
+        return false;
+    }
+
+    if (h256Touint(state.rootHash()) != metadata.m_state_root) {
+        error = strprintf("state root %s does not match the snapshot metadata %s", state.rootHash().hex(), metadata.m_state_root.GetHex());
+        return false;
+    }
+    if (h256Touint(state.rootHashUTXO()) != metadata.m_utxo_root) {
+        error = strprintf("UTXO root %s does not match the snapshot metadata %s", state.rootHashUTXO().hex(), metadata.m_utxo_root.GetHex());
+        return false;
+    }
+    return true;
+}
+
+} // namespace qtum
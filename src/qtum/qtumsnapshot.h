@@ -0,0 +1,66 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QTUM_QTUMSNAPSHOT_H
+#define QTUM_QTUMSNAPSHOT_H
+
+#include <serialize.h>
+#include <uint256.h>
+
+#include <functional>
+#include <string>
+
+class AutoFile;
+class QtumState;
+class QtumStateView;
+
+namespace qtum {
+
+//! Metadata of a serialized contract state: the EVM accounts with their storage and the
+//! Qtum UTXO trie at one block, whose header commits to both roots.
+class ContractStateSnapshotMetadata
+{
+public:
+    //! The block whose hashStateRoot and hashUTXORoot the snapshot reproduces.
+    uint256 m_base_blockhash;
+    uint256 m_state_root;
+    uint256 m_utxo_root;
+
+    ContractStateSnapshotMetadata() { }
+    ContractStateSnapshotMetadata(const uint256& base_blockhash, const uint256& state_root, const uint256& utxo_root) :
+        m_base_blockhash(base_blockhash), m_state_root(state_root), m_utxo_root(utxo_root) { }
+
+    SERIALIZE_METHODS(ContractStateSnapshotMetadata, obj) { READWRITE(obj.m_base_blockhash, obj.m_state_root, obj.m_utxo_root); }
+};
+
+//! Number of entries written to or read from a contract state snapshot.
+struct ContractStateSnapshotStats
+{
+    uint64_t accounts{0};
+    uint64_t storage_slots{0};
+    uint64_t vins{0};
+};
+
+/**
+ * Stream all account and storage leaves of @p view, then all its vins, to @p afile after @p metadata.
+ * The view is read without cs_main. @p interruption_point is called regularly and may throw.
+ *
+ * @returns false if the state cannot be iterated, which needs ETH_FATDB.
+ */
+bool WriteContractStateSnapshot(AutoFile& afile, const ContractStateSnapshotMetadata& metadata, const QtumStateView& view,
+                                ContractStateSnapshotStats& stats, const std::function<void()>& interruption_point);
+
+/**
+ * Rebuild the tries of a snapshot from @p afile into the databases of @p state, after its metadata was
+ * read into @p metadata. @p state is reset to empty roots first and has the roots of the snapshot on success.
+ *
+ * @returns false with @p error set if the snapshot is malformed or its leaves do not hash to the roots in
+ *          the metadata. The caller has to check the metadata against the header of the base block.
+ */
+bool LoadContractStateSnapshot(AutoFile& afile, const ContractStateSnapshotMetadata& metadata, QtumState& state,
+                               ContractStateSnapshotStats& stats, std::string& error, const std::function<void()>& interruption_point);
+
+} // namespace qtum
+
+#endif // QTUM_QTUMSNAPSHOT_H
@@ -1,9 +1,11 @@
+#include <algorithm>
 #include <sstream>
 #include <util/system.h>
 #include <validation.h>
 #include <chainparams.h>
 #include <script/script.h>
 #include <qtum/qtumstate.h>
+#include <qtum/qtumprofiler.h>
 #include <libevm/VMFace.h>
 #include <validation.h>
 
@@ -17,20 +19,33 @@ QtumState::QtumState(u256 const& _accountStartNonce, OverlayDB const& _db, const
 	        stateUTXO = SecureTrieDB<Address, OverlayDB>(&dbUTXO);
 }
 
+QtumState::QtumState(QtumState const& _s) : State(_s), dbUTXO(_s.dbUTXO), stateUTXO(&dbUTXO, _s.stateUTXO.root(), Verification::Skip), cacheUTXO(_s.cacheUTXO) {}
+
+QtumState::QtumState(u256 const& _accountStartNonce, OverlayDB const& _db, OverlayDB const& _dbUtxo, h256 const& _stateRoot, h256 const& _utxoRoot) :
+        State(_accountStartNonce, _db, BaseState::PreExisting), dbUTXO(_dbUtxo), stateUTXO(&dbUTXO, _utxoRoot, Verification::Skip) {
+    setRoot(_stateRoot);
+}
+
 QtumState::QtumState() : dev::eth::State(dev::Invalid256, dev::OverlayDB(), dev::eth::BaseState::PreExisting) {
     dbUTXO = OverlayDB();
     stateUTXO = SecureTrieDB<Address, OverlayDB>(&dbUTXO);
 }
 
-ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const& _sealEngine, QtumTransaction const& _t, CChain& _chain, Permanence _p, OnOpFunc const& _onOp){
+ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const& _sealEngine, QtumTransaction const& _t, int _chainHeight, Permanence _p, OnOpFunc const& _onOp){
 
     assert(_t.getVersion().toRaw() == VersionVM::GetEVMDefault().toRaw());
 
+    // Only the executions of blocks and block templates are profiled, not the calls of the RPC
+    ContractProfiler::Execution profile(_p == Permanence::Committed);
+
     addBalance(_t.sender(), _t.value() + (_t.gas() * _t.gasPrice()));
     newAddress = _t.isCreation() ? createQtumAddress(_t.getHashWith(), _t.getNVout()) : dev::Address();
 
     _sealEngine.deleteAddresses.insert({_t.sender(), _envInfo.author()});
 
+    if(writeSetCapture)
+        writeSetCapture->complete = false;
+
     h256 oldStateRoot = rootHash();
     h256 oldUTXORoot = rootHashUTXO();
     bool voutLimit = false;
@@ -58,7 +73,7 @@ ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const&
         startGasUsed = _envInfo.gasUsed();
         if (!e.execute()){
             e.go(onOp);
-            if(_chain.Height() >= consensusParams.QIP7Height){
+            if(_chainHeight >= consensusParams.QIP7Height){
             	validateTransfersWithChangeLog();
             }
         } else {
@@ -87,17 +102,27 @@ ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const&
                 printfErrorLog(res.excepted);
             }
 
+            bool removeEmptyAccounts = _envInfo.number() >= _sealEngine.chainParams().EIP158ForkBlock;
+            if(writeSetCapture){
+                writeSetCapture->accounts = m_cache;
+                writeSetCapture->vins = cacheUTXO;
+                writeSetCapture->removeEmptyAccounts = removeEmptyAccounts;
+                writeSetCapture->complete = true;
+            }
+
+            noteCreatedContracts();
             qtum::commit(cacheUTXO, stateUTXO, m_cache);
             cacheUTXO.clear();
-            bool removeEmptyAccounts = _envInfo.number() >= _sealEngine.chainParams().EIP158ForkBlock;
             commit(removeEmptyAccounts ? State::CommitBehaviour::RemoveEmptyAccounts : State::CommitBehaviour::KeepEmptyAccounts);
         }
     }
     catch(Exception const& _e){
+        if(writeSetCapture)
+            writeSetCapture->complete = false;
         printfErrorLog(dev::eth::toTransactionException(_e));
         res.excepted = dev::eth::toTransactionException(_e);
         res.gasUsed = _t.gas();
-        if(_chain.Height() < consensusParams.nFixUTXOCacheHFHeight  && _p != Permanence::Reverted){
+        if(_chainHeight < consensusParams.nFixUTXOCacheHFHeight  && _p != Permanence::Reverted){
             deleteAccounts(_sealEngine.deleteAddresses);
             commit(CommitBehaviour::RemoveEmptyAccounts);
         } else {
@@ -109,6 +134,7 @@ ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const&
     if(!_t.isCreation())
         res.newAddress = _t.receiveAddress();
     newAddress = dev::Address();
+    profile.Finish(res.newAddress, voutLimit ? (uint64_t)_t.gas() : (uint64_t)res.gasUsed);
     transfers.clear();
     if(voutLimit){
         //use old and empty states to create virtual Out Of Gas exception
@@ -161,6 +187,9 @@ Vin const* QtumState::vin(dev::Address const& _a) const
 
 Vin* QtumState::vin(dev::Address const& _addr)
 {
+    if(accessedVins)
+        accessedVins->insert(_addr);
+
     auto it = cacheUTXO.find(_addr);
     if (it == cacheUTXO.end()){
         std::string stateBack = stateUTXO.at(_addr);
@@ -291,19 +320,106 @@ void QtumState::validateTransfersWithChangeLog(){
 	transfers=validatedTransfers;
 }
 
+void QtumState::applyWriteSet(ExecutionWriteSet const& _writeSet){
+    assert(_writeSet.complete);
+    for(auto const& i : _writeSet.accounts){
+        m_cache[i.first] = i.second;
+        m_nonExistingAccountsCache.erase(i.first);
+    }
+    for(auto const& i : _writeSet.vins)
+        cacheUTXO[i.first] = i.second;
+
+    noteCreatedContracts();
+    qtum::commit(cacheUTXO, stateUTXO, m_cache);
+    cacheUTXO.clear();
+    commit(_writeSet.removeEmptyAccounts ? State::CommitBehaviour::RemoveEmptyAccounts : State::CommitBehaviour::KeepEmptyAccounts);
+}
+
+void QtumState::noteCreatedContracts(){
+    if(!createdContracts)
+        return;
+    // The code of an account is only set when it is created, the cache is unordered so sort them
+    std::vector<dev::Address> created;
+    for(auto const& i : m_cache){
+        if(i.second.isAlive() && i.second.hasNewCode())
+            created.push_back(i.first);
+    }
+    std::sort(created.begin(), created.end());
+    createdContracts->insert(createdContracts->end(), created.begin(), created.end());
+}
+
+std::string QtumState::committedAccountAt(dev::h256 const& _root, dev::Address const& _addr) const{
+    dev::eth::SecureTrieDB<dev::Address, dev::OverlayDB> trie(const_cast<dev::OverlayDB*>(&m_db), _root);
+    return trie.at(_addr);
+}
+
+std::string QtumState::committedVinAt(dev::h256 const& _utxoRoot, dev::Address const& _addr) const{
+    dev::eth::SecureTrieDB<dev::Address, dev::OverlayDB> trie(const_cast<dev::OverlayDB*>(&dbUTXO), _utxoRoot);
+    return trie.at(_addr);
+}
+
+bool QtumState::forEachCommittedVin(std::function<void(dev::Address const&, Vin const&)> const& _f) const{
+#if ETH_FATDB
+    for (auto it = stateUTXO.hashedBegin(); it != stateUTXO.hashedEnd(); ++it){
+        dev::RLP state((*it).second);
+        _f(dev::Address(it.key()), Vin{state[0].toHash<dev::h256>(), state[1].toInt<uint32_t>(), state[2].toInt<dev::u256>(), state[3].toInt<uint8_t>()});
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
 void QtumState::deployDelegationsContract(){
     dev::Address delegationsAddress = uintToh160(Params().GetConsensus().delegationsAddress);
     if(!QtumState::addressInUse(delegationsAddress)){
         QtumState::createContract(delegationsAddress);
         QtumState::setCode(delegationsAddress, bytes{fromHex(DELEGATIONS_CONTRACT_CODE)}, QtumState::version(delegationsAddress));
+        noteCreatedContracts();
         commit(CommitBehaviour::RemoveEmptyAccounts);
         db().commit();
     }
 }
+
+void QtumState::commitDB(){
+    if(!deferWrites || deferredWritesBudget == 0){
+        flushDB();
+        return;
+    }
+    db().stage();
+    dbUTXO.stage();
+    // Write out early rather than going over the memory budget
+    if(deferredWritesUsage() > deferredWritesBudget){
+        flushDB();
+    }
+}
+
+void QtumState::flushDB(){
+    db().commit();
+    dbUTXO.commit();
+}
+
+static bool isCommitted(OverlayDB const& _db, h256 const& _root){
+    return _root == EmptyTrie || _db.exists(_root);
+}
+
+static QtumState viewState(QtumState const& _s, h256 const& _stateRoot, h256 const& _utxoRoot){
+    OverlayDB db = _s.db().diskView();
+    OverlayDB dbUtxo = _s.dbUtxo().diskView();
+    // Roots executed but not committed yet, like those of a test block, are only in the memory overlays
+    if(!isCommitted(db, _stateRoot) || !isCommitted(dbUtxo, _utxoRoot)){
+        db = _s.db();
+        dbUtxo = _s.dbUtxo();
+    }
+    return QtumState(_s.accountStartNonce(), db, dbUtxo, _stateRoot, _utxoRoot);
+}
+
+QtumStateView::QtumStateView(QtumState const& _s, dev::h256 const& _stateRoot, dev::h256 const& _utxoRoot) :
+        base(viewState(_s, _stateRoot, _utxoRoot)) {}
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 CTransaction CondensingTX::createCondensingTX(){
-    selectionVin();
-    calculatePlusAndMinus();
+    processTransfers();
     if(!createNewBalances())
         return CTransaction();
     CMutableTransaction tx;
@@ -314,72 +430,84 @@ CTransaction CondensingTX::createCondensingTX(){
 
 std::unordered_map<dev::Address, Vin> CondensingTX::createVin(const CTransaction& tx){
     std::unordered_map<dev::Address, Vin> vins;
-    for(auto& b : balances){
-        if(b.first == transaction.sender())
+    for(const CondensingEntry& e : entries){
+        if(e.address == transaction.sender())
             continue;
 
-        if(b.second > 0){
-            vins[b.first] = Vin{uintToh256(tx.GetHash()), nVouts[b.first], b.second, 1};
+        if(e.balance > 0){
+            vins[e.address] = Vin{uintToh256(tx.GetHash()), e.nVout, intxToU256(e.balance), 1};
         } else {
-            vins[b.first] = Vin{uintToh256(tx.GetHash()), 0, 0, 0};
+            vins[e.address] = Vin{uintToh256(tx.GetHash()), 0, 0, 0};
         }
     }
     return vins;
 }
 
-void CondensingTX::selectionVin(){
-    for(const TransferInfo& ti : transfers){
-        if(!vins.count(ti.from)){
-            if(auto a = state->vin(ti.from))
-                vins[ti.from] = *a;
-            if(ti.from == transaction.sender() && transaction.value() > 0){
-                vins[ti.from] = Vin{transaction.getHashWith(), transaction.getNVout(), transaction.value(), 1};
-            }
-        }
+CondensingTX::CondensingEntry& CondensingTX::entry(dev::Address const& address){
+    auto it = std::lower_bound(entries.begin(), entries.end(), address, [](const CondensingEntry& e, dev::Address const& a) { return e.address < a; });
+    assert(it != entries.end() && it->address == address);
+    return *it;
+}
 
-        if(!vins.count(ti.to)){
-            if(auto a = state->vin(ti.to))
-                vins[ti.to] = *a;
+void CondensingTX::selectVin(CondensingEntry& e, bool sender){
+    if(e.hasVin)
+        return;
+    // The output of an address is read once, from the UTXO cache of the state when it is there
+    if(!e.lookedUp){
+        e.lookedUp = true;
+        if(auto a = state->vin(e.address)){
+            e.vin = *a;
+            e.hasVin = true;
         }
     }
+    if(sender && transaction.value() > 0){
+        e.vin = Vin{transaction.getHashWith(), transaction.getNVout(), transaction.value(), 1};
+        e.hasVin = true;
+    }
 }
 
-void CondensingTX::calculatePlusAndMinus(){
+void CondensingTX::processTransfers(){
+    entries.clear();
+    entries.reserve(transfers.size() * 2);
     for(const TransferInfo& ti : transfers){
-        if(!plusMinusInfo.count(ti.from)){
-            plusMinusInfo[ti.from] = std::make_pair(0, ti.value);
-        } else {
-            plusMinusInfo[ti.from] = std::make_pair(plusMinusInfo[ti.from].first, plusMinusInfo[ti.from].second + ti.value);
-        }
+        entries.emplace_back().address = ti.from;
+        entries.emplace_back().address = ti.to;
+    }
+    std::sort(entries.begin(), entries.end(), [](const CondensingEntry& a, const CondensingEntry& b) { return a.address < b.address; });
+    entries.erase(std::unique(entries.begin(), entries.end(), [](const CondensingEntry& a, const CondensingEntry& b) { return a.address == b.address; }), entries.end());
 
-        if(!plusMinusInfo.count(ti.to)){
-            plusMinusInfo[ti.to] = std::make_pair(ti.value, 0);
-        } else {
-            plusMinusInfo[ti.to] = std::make_pair(plusMinusInfo[ti.to].first + ti.value, plusMinusInfo[ti.to].second);
-        }
+    for(const TransferInfo& ti : transfers){
+        const intx::uint256 value = u256ToIntx(ti.value);
+        CondensingEntry& from = entry(ti.from);
+        selectVin(from, ti.from == transaction.sender());
+        from.minus += value;
+        CondensingEntry& to = entry(ti.to);
+        selectVin(to, false);
+        to.plus += value;
     }
 }
 
 bool CondensingTX::createNewBalances(){
-    for(auto& p : plusMinusInfo){
-        dev::u256 balance = 0;
-        if((vins.count(p.first) && vins[p.first].alive) || (!vins[p.first].alive && !checkDeleteAddress(p.first))){
-            balance = vins[p.first].value;
+    for(CondensingEntry& e : entries){
+        intx::uint256 balance = 0;
+        if(e.vin.alive || !checkDeleteAddress(e.address)){
+            balance = u256ToIntx(e.vin.value);
         }
-        balance += p.second.first;
-        if(balance < p.second.second)
+        balance += e.plus;
+        if(balance < e.minus)
             return false;
-        balance -= p.second.second;
-        balances[p.first] = balance;
+        balance -= e.minus;
+        e.balance = balance;
     }
     return true;
 }
 
 std::vector<CTxIn> CondensingTX::createVins(){
     std::vector<CTxIn> ins;
-    for(auto& v : vins){
-        if((v.second.value > 0 && v.second.alive) || (v.second.value > 0 && !vins[v.first].alive && !checkDeleteAddress(v.first)))
-            ins.push_back(CTxIn(h256Touint(v.second.hash), v.second.nVout, CScript() << OP_SPEND));
+    for(const CondensingEntry& e : entries){
+        const Vin& v = e.vin;
+        if((v.value > 0 && v.alive) || (v.value > 0 && !v.alive && !checkDeleteAddress(e.address)))
+            ins.push_back(CTxIn(h256Touint(v.hash), v.nVout, CScript() << OP_SPEND));
     }
     return ins;
 }
@@ -387,18 +515,18 @@ std::vector<CTxIn> CondensingTX::createVins(){
 std::vector<CTxOut> CondensingTX::createVout(){
     size_t count = 0;
     std::vector<CTxOut> outs;
-    for(auto& b : balances){
-        if(b.second > 0){
+    for(CondensingEntry& e : entries){
+        if(e.balance > 0){
             CScript script;
-            auto* a = state->account(b.first);
+            auto* a = state->account(e.address);
             if(a && a->isAlive()){
                 //create a no-exec contract output
-                script = CScript() << valtype{0} << valtype{0} << valtype{0} << valtype{0} << b.first.asBytes() << OP_CALL;
+                script = CScript() << valtype{0} << valtype{0} << valtype{0} << valtype{0} << e.address.asBytes() << OP_CALL;
             } else {
-                script = CScript() << OP_DUP << OP_HASH160 << b.first.asBytes() << OP_EQUALVERIFY << OP_CHECKSIG;
+                script = CScript() << OP_DUP << OP_HASH160 << e.address.asBytes() << OP_EQUALVERIFY << OP_CHECKSIG;
             }
-            outs.push_back(CTxOut(CAmount(b.second), script));
-            nVouts[b.first] = count;
+            outs.push_back(CTxOut(intxToAmount(e.balance), script));
+            e.nVout = count;
             count++;
         }
         if(count > MAX_CONTRACT_VOUTS){
@@ -13,11 +13,8 @@
 #include <libethereum/Executive.h>
 #include <libethcore/SealEngine.h>
 
-class CChain;
-
 using OnOpFunc = std::function<void(uint64_t, uint64_t, dev::eth::Instruction, dev::bigint, dev::bigint, 
     dev::bigint, dev::eth::VMFace const*, dev::eth::ExtVMFace const*)>;
-using plusAndMinus = std::pair<dev::u256, dev::u256>;
 using valtype = std::vector<unsigned char>;
 
 struct TransferInfo{
@@ -51,24 +48,48 @@ struct ResultExecute{
 };
 
 namespace qtum{
+    /// Write the vins of @p _cache to the UTXO trie, in one pass over the trie for all of them.
     template <class DB>
     dev::AddressHash commit(std::unordered_map<dev::Address, Vin> const& _cache, dev::eth::SecureTrieDB<dev::Address, DB>& _state, std::unordered_map<dev::Address, dev::eth::Account> const& _cacheAcc)
     {
         dev::AddressHash ret;
+        std::vector<dev::bytesConstRef> keys;
+        std::vector<dev::bytes> values;
+        keys.reserve(_cache.size());
+        values.reserve(_cache.size());
         for (auto const& i: _cache){
+            keys.push_back(i.first.ref());
             if(i.second.alive == 0){
-                 _state.remove(i.first);
+                values.emplace_back();
             } else {
                 dev::RLPStream s(4);
                 s << i.second.hash << i.second.nVout << i.second.value << i.second.alive;
-                _state.insert(i.first, &s.out());
+                values.push_back(s.out());
             }
             ret.insert(i.first);
         }
+
+        std::vector<dev::h256> const hashes = dev::sha3Batch(keys);
+        std::vector<dev::HashedTrieChange> changes;
+        changes.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); i++){
+            changes.push_back({keys[i], hashes[i], dev::bytesConstRef(&values[i])});
+        }
+        _state.updateHashed(changes);
         return ret;
     }
 }
 
+/** Contents of the account and UTXO caches right before a contract execution is committed.
+ *  Replaying it through QtumState::applyWriteSet commits exactly what the execution would have,
+ *  provided every address the execution read still holds the same value. */
+struct ExecutionWriteSet{
+    std::unordered_map<dev::Address, dev::eth::Account> accounts;
+    std::unordered_map<dev::Address, Vin> vins;
+    bool removeEmptyAccounts = false;
+    bool complete = false;
+};
+
 class CondensingTX;
 
 class QtumState : public dev::eth::State {
@@ -79,16 +100,40 @@ public:
 
     QtumState(dev::u256 const& _accountStartNonce, dev::OverlayDB const& _db, const std::string& _path, dev::eth::BaseState _bs = dev::eth::BaseState::PreExisting);
 
-    ResultExecute execute(dev::eth::EnvInfo const& _envInfo, dev::eth::SealEngineFace const& _sealEngine, QtumTransaction const& _t, CChain& _chain, dev::eth::Permanence _p = dev::eth::Permanence::Committed, dev::eth::OnOpFunc const& _onOp = OnOpFunc());
+    /// Copy the state, the copy has its own UTXO trie overlay over the same database.
+    QtumState(QtumState const& _s);
+
+    /// Open the state at the given roots over the databases @p _db and @p _dbUtxo, without caches.
+    QtumState(dev::u256 const& _accountStartNonce, dev::OverlayDB const& _db, dev::OverlayDB const& _dbUtxo, dev::h256 const& _stateRoot, dev::h256 const& _utxoRoot);
+
+    QtumState& operator=(QtumState const& _s) = delete;
+
+    /// @param _chainHeight  Height of the active chain, which selects the consensus rules of the execution.
+    ResultExecute execute(dev::eth::EnvInfo const& _envInfo, dev::eth::SealEngineFace const& _sealEngine, QtumTransaction const& _t, int _chainHeight, dev::eth::Permanence _p = dev::eth::Permanence::Committed, dev::eth::OnOpFunc const& _onOp = OnOpFunc());
 
     void setRootUTXO(dev::h256 const& _r) { cacheUTXO.clear(); stateUTXO.setRoot(_r); }
 
+    /// The committed roots of the state and UTXO tries, to return to with revertToCheckpoint().
+    struct Checkpoint{
+        dev::h256 stateRoot;
+        dev::h256 utxoRoot;
+    };
+
+    Checkpoint checkpoint() const { return Checkpoint{rootHash(), rootHashUTXO()}; }
+
+    /// Drop the changes committed since @p _c was taken. The tries are content-addressed, so the nodes
+    /// of the checkpoint are still in the memory overlay or the database and nothing has to be undone.
+    void revertToCheckpoint(Checkpoint const& _c) { setRoot(_c.stateRoot); setRootUTXO(_c.utxoRoot); }
+
     void setCacheUTXO(dev::Address const& address, Vin const& vin) { cacheUTXO.insert(std::make_pair(address, vin)); }
 
     dev::h256 rootHashUTXO() const { return stateUTXO.root(); }
 
     std::unordered_map<dev::Address, Vin> vins() const; // temp
 
+    /// @returns the vin of @p _a, nullptr if the address has none.
+    Vin const* vin(dev::Address const& _a) const;
+
     dev::OverlayDB const& dbUtxo() const { return dbUTXO; }
 
     dev::OverlayDB& dbUtxo() { return dbUTXO; }
@@ -112,6 +157,51 @@ public:
 
     void deployDelegationsContract();
 
+    /// Capture the caches of the next committed execution into @p _writeSet, nullptr disables it.
+    void setWriteSetCapture(ExecutionWriteSet* _writeSet) { writeSetCapture = _writeSet; }
+
+    /// Record every address looked up in the UTXO trie into @p _accessed, nullptr disables it.
+    void setAccessedVins(dev::AddressHash* _accessed) const { accessedVins = _accessed; }
+
+    /// Append the address of every contract whose code is committed to @p _created, nullptr disables it.
+    void setCreatedContracts(std::vector<dev::Address>* _created) { createdContracts = _created; }
+
+    /// @returns the RLP of the vin as committed to the UTXO trie, ignoring the cache.
+    std::string committedVin(dev::Address const& _addr) const { return stateUTXO.at(_addr); }
+
+    /// @returns the RLP of the account and of the vin of @p _addr in the tries with the given roots, which
+    /// must be present in the databases of this state, like those of an earlier checkpoint.
+    std::string committedAccountAt(dev::h256 const& _root, dev::Address const& _addr) const;
+    std::string committedVinAt(dev::h256 const& _utxoRoot, dev::Address const& _addr) const;
+
+    /// @returns true if the cache holds changes to the account of @p _addr not yet committed to the trie.
+    bool isAccountDirty(dev::Address const& _addr) const { auto it = m_cache.find(_addr); return it != m_cache.end() && it->second.isDirty(); }
+
+    /// Commit a write set captured on another state as if the execution had run here.
+    void applyWriteSet(ExecutionWriteSet const& _writeSet);
+
+    /// Call @p _f for every vin committed to the UTXO trie, ordered by the hash of the address.
+    /// @returns false without calling @p _f when the trie cannot be iterated (built without ETH_FATDB).
+    bool forEachCommittedVin(std::function<void(dev::Address const&, Vin const&)> const& _f) const;
+
+    /// Commit @p _vins straight to the UTXO trie, used to rebuild the trie from its leaves.
+    void importVins(std::unordered_map<dev::Address, Vin> const& _vins) { qtum::commit(_vins, stateUTXO, m_cache); }
+
+    /// Write the trie nodes of the committed executions to the databases. While writes are deferred, they are
+    /// kept in memory instead, and only written once they take more than the budget or by flushDB().
+    void commitDB();
+
+    /// Write the trie nodes kept by commitDB() to the databases.
+    void flushDB();
+
+    /// Keep up to @p _budget bytes of trie nodes in memory while writes are deferred, 0 never defers them.
+    void setDeferredWritesBudget(size_t _budget) { deferredWritesBudget = _budget; }
+
+    void setDeferWrites(bool _defer) { deferWrites = _defer; }
+
+    /// @returns the memory taken by the trie nodes kept by commitDB().
+    size_t deferredWritesUsage() const { return db().stagedMemoryUsage() + dbUTXO.stagedMemoryUsage(); }
+
     virtual ~QtumState(){}
 
     friend CondensingTX;
@@ -120,8 +210,6 @@ private:
 
     void transferBalance(dev::Address const& _from, dev::Address const& _to, dev::u256 const& _value) override;
 
-    Vin const* vin(dev::Address const& _a) const;
-
     Vin* vin(dev::Address const& _addr);
 
     // void commit(CommitBehaviour _commitBehaviour);
@@ -136,6 +224,8 @@ private:
 
     void printfErrorLog(const dev::eth::TransactionException er);
 
+    void noteCreatedContracts();
+
     dev::Address newAddress;
 
     std::vector<TransferInfo> transfers;
@@ -146,35 +236,44 @@ private:
 
 	std::unordered_map<dev::Address, Vin> cacheUTXO;
 
+    ExecutionWriteSet* writeSetCapture = nullptr;
+
+    mutable dev::AddressHash* accessedVins = nullptr;
+
+    std::vector<dev::Address>* createdContracts = nullptr;
+
+    size_t deferredWritesBudget = 0;
+
+    bool deferWrites = false;
+
 	void validateTransfersWithChangeLog();
 };
 
 
-struct TemporaryState{
-    std::unique_ptr<QtumState>& globalStateRef;
-    dev::h256 oldHashStateRoot;
-    dev::h256 oldHashUTXORoot;
+/** Immutable view of the contract state at one state and UTXO root.
+ *  The view reads the disk databases of the state it was taken from, whose trie nodes are never removed
+ *  (unless -statepruning drops old states), through overlays of its own. Neither the caches nor the memory
+ *  overlays of that state are copied for committed roots, so the view of any stored root is cheap, and it can
+ *  be used from any thread without cs_main while that state keeps changing. Even const reads fill the account caches
+ *  of a state, so every reader works on a private state from makeState(). */
+class QtumStateView{
 
-    TemporaryState(std::unique_ptr<QtumState>& _globalStateRef) : 
-        globalStateRef(_globalStateRef),
-        oldHashStateRoot(globalStateRef->rootHash()), 
-        oldHashUTXORoot(globalStateRef->rootHashUTXO()) {}
-                
-    void SetRoot(dev::h256 newHashStateRoot, dev::h256 newHashUTXORoot)
-    {
-        globalStateRef->setRoot(newHashStateRoot);
-        globalStateRef->setRootUTXO(newHashUTXORoot);
-    }
+public:
 
-    ~TemporaryState(){
-        globalStateRef->setRoot(oldHashStateRoot);
-        globalStateRef->setRootUTXO(oldHashUTXORoot);
-    }
-    TemporaryState() = delete;
-    TemporaryState(const TemporaryState&) = delete;
-    TemporaryState& operator=(const TemporaryState&) = delete;
-    TemporaryState(TemporaryState&&) = delete;
-    TemporaryState& operator=(TemporaryState&&) = delete;
+    /// Take a view of the databases of @p _s pinned to the given roots, the caller has to hold the lock of @p _s.
+    /// The memory overlays of @p _s are only copied when the roots have not been committed to disk yet.
+    QtumStateView(QtumState const& _s, dev::h256 const& _stateRoot, dev::h256 const& _utxoRoot);
+
+    /// @returns a private state at the roots of the view, for reads and for executions with Permanence::Reverted that are never committed.
+    std::unique_ptr<QtumState> makeState() const { return std::make_unique<QtumState>(base); }
+
+    dev::h256 rootHash() const { return base.rootHash(); }
+
+    dev::h256 rootHashUTXO() const { return base.rootHashUTXO(); }
+
+private:
+
+    QtumState base;
 };
 
 
@@ -193,9 +292,24 @@ public:
 
 private:
 
-    void selectionVin();
+    /** An address that sends or receives value in the transfers */
+    struct CondensingEntry{
+        dev::Address address;
+        //! The contract output of the address, a null one if it has none
+        Vin vin{};
+        bool hasVin = false;
+        bool lookedUp = false;
+        intx::uint256 plus;
+        intx::uint256 minus;
+        intx::uint256 balance;
+        uint32_t nVout = 0;
+    };
+
+    CondensingEntry& entry(dev::Address const& address);
+
+    void selectVin(CondensingEntry& e, bool sender);
 
-    void calculatePlusAndMinus();
+    void processTransfers();
 
     bool createNewBalances();
 
@@ -205,13 +319,8 @@ private:
 
     bool checkDeleteAddress(dev::Address addr);
 
-    std::map<dev::Address, plusAndMinus> plusMinusInfo;
-
-    std::map<dev::Address, dev::u256> balances;
-
-    std::map<dev::Address, uint32_t> nVouts;
-
-    std::map<dev::Address, Vin> vins;
+    //! Sorted by address, which is the order of the inputs and outputs of the condensing transaction
+    std::vector<CondensingEntry> entries;
 
     const std::vector<TransferInfo>& transfers;
 
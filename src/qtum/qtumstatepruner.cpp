@@ -0,0 +1,239 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qtum/qtumstatepruner.h>
+
+#include <dbwrapper.h>
+#include <libdevcore/OverlayDB.h>
+#include <libdevcore/RLP.h>
+#include <libdevcore/TrieCommon.h>
+#include <logging.h>
+#include <qtum/qtumstate.h>
+#include <util/convert.h>
+#include <util/thread.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <algorithm>
+
+std::unique_ptr<StatePruner> g_state_pruner;
+
+namespace {
+
+enum class NodeKind {
+    ACCOUNT_TRIE, //!< Node of an account trie, whose leaves refer to storage tries and code
+    TRIE,         //!< Node of a storage or UTXO trie
+    CODE,         //!< Contract code, stored under its hash
+};
+
+using PendingNodes = std::vector<std::pair<dev::h256, NodeKind>>;
+
+void VisitNode(const dev::RLP& node, NodeKind kind, PendingNodes& pending);
+
+/** Children are stored under their hash, or inline when their RLP is shorter than a hash */
+void VisitChild(const dev::RLP& item, NodeKind kind, PendingNodes& pending)
+{
+    if (item.isData() && item.size() == 32) {
+        pending.emplace_back(item.toHash<dev::h256>(), kind);
+    } else if (item.isList()) {
+        VisitNode(item, kind, pending);
+    }
+}
+
+void VisitLeaf(const dev::RLP& value, NodeKind kind, PendingNodes& pending)
+{
+    if (kind != NodeKind::ACCOUNT_TRIE) return;
+    dev::RLP account(value.payload());
+    if (!account.isList() || account.itemCount() < 4) return;
+    pending.emplace_back(account[2].toHash<dev::h256>(), NodeKind::TRIE);
+    const dev::h256 code_hash = account[3].toHash<dev::h256>();
+    if (code_hash != dev::EmptySHA3) {
+        pending.emplace_back(code_hash, NodeKind::CODE);
+    }
+}
+
+void VisitNode(const dev::RLP& node, NodeKind kind, PendingNodes& pending)
+{
+    if (!node.isList()) return;
+    if (node.itemCount() == 17) {
+        for (unsigned i = 0; i < 16; ++i) {
+            VisitChild(node[i], kind, pending);
+        }
+        if (!node[16].isEmpty()) VisitLeaf(node[16], kind, pending);
+    } else if (node.itemCount() == 2) {
+        if (dev::isLeaf(node)) {
+            VisitLeaf(node[1], kind, pending);
+        } else {
+            VisitChild(node[1], kind, pending);
+        }
+    }
+}
+
+} // namespace
+
+void StateTrieMarker::MarkState(const dev::OverlayDB& db, const dev::h256& root)
+{
+    Mark(db, root, true);
+}
+
+void StateTrieMarker::MarkTrie(const dev::OverlayDB& db, const dev::h256& root)
+{
+    Mark(db, root, false);
+}
+
+void StateTrieMarker::Mark(const dev::OverlayDB& db, const dev::h256& root, bool account_trie)
+{
+    // The whole subtree of a marked node is marked, so the walk stops at the nodes marked before
+    PendingNodes pending{{root, account_trie ? NodeKind::ACCOUNT_TRIE : NodeKind::TRIE}};
+    while (!pending.empty()) {
+        const auto [hash, kind] = pending.back();
+        pending.pop_back();
+        if (!m_marked.insert(hash).second || kind == NodeKind::CODE || hash == dev::EmptyTrie) continue;
+
+        const std::string node = db.lookup(hash);
+        if (node.empty()) {
+            ++m_missing;
+            continue;
+        }
+        VisitNode(dev::RLP(node), kind, pending);
+    }
+}
+
+uint64_t SweepTrieNodes(dev::OverlayDB& db, const StateTrieMarker& marker, const std::function<bool(std::vector<dev::h256>&)>& erase_batch)
+{
+    uint64_t erased{0};
+    bool stop{false};
+    std::vector<dev::h256> nodes;
+    auto erase = [&]() {
+        stop = !erase_batch(nodes);
+        erased += nodes.size();
+        nodes.clear();
+    };
+    db.forEachDiskNode([&](const dev::h256& key) {
+        if (!marker.IsMarked(key)) nodes.push_back(key);
+        if (nodes.size() >= STATE_PRUNE_BATCH_SIZE) erase();
+        return !stop;
+    });
+    if (!stop && !nodes.empty()) erase();
+    return erased;
+}
+
+StatePruner::StatePruner(ChainstateManager& chainman, int keep_blocks) : m_chainman(chainman), m_keep_blocks(keep_blocks) {}
+
+StatePruner::~StatePruner()
+{
+    Interrupt();
+    Stop();
+}
+
+void StatePruner::Start()
+{
+    m_thread = std::thread(&util::TraceThread, "statepruner", [this] { ThreadPrune(); });
+}
+
+void StatePruner::Interrupt()
+{
+    m_interrupt();
+}
+
+void StatePruner::Stop()
+{
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    GetCompactionController().Cancel(this);
+}
+
+std::vector<std::pair<dev::h256, dev::h256>> StatePruner::KeptRoots() const
+{
+    AssertLockHeld(cs_main);
+    std::vector<std::pair<dev::h256, dev::h256>> roots;
+    const CChain& chain = m_chainman.ActiveChain();
+    for (int height = std::max(0, chain.Height() - m_keep_blocks + 1); height <= chain.Height(); ++height) {
+        roots.emplace_back(uintToh256(chain[height]->hashStateRoot), uintToh256(chain[height]->hashUTXORoot));
+    }
+    roots.emplace_back(globalState->rootHash(), globalState->rootHashUTXO());
+    return roots;
+}
+
+bool StatePruner::Prune(StatePruneStats& stats)
+{
+    stats = StatePruneStats{};
+    std::unique_ptr<dev::OverlayDB> state_db;
+    std::unique_ptr<dev::OverlayDB> utxo_db;
+    std::vector<std::pair<dev::h256, dev::h256>> roots;
+    {
+        LOCK(cs_main);
+        if (!globalState || !m_chainman.ActiveChain().Tip()) return false;
+        // The copies share the databases of the global state, without its memory overlay
+        state_db = std::make_unique<dev::OverlayDB>(globalState->db());
+        utxo_db = std::make_unique<dev::OverlayDB>(globalState->dbUtxo());
+        roots = KeptRoots();
+    }
+
+    StateTrieMarker state_marker;
+    StateTrieMarker utxo_marker;
+    auto mark = [&](const std::vector<std::pair<dev::h256, dev::h256>>& kept) {
+        for (const auto& [state_root, utxo_root] : kept) {
+            state_marker.MarkState(*state_db, state_root);
+            utxo_marker.MarkTrie(*utxo_db, utxo_root);
+        }
+    };
+    for (const auto& root : roots) {
+        if (m_interrupt) return false;
+        mark({root});
+    }
+
+    // Blocks connected since the roots were read may have written unmarked nodes again, so the
+    // new states are marked and the batch erased under the same lock that block connection holds.
+    // The live databases are pruned, so that the nodes still referenced by their memory overlay
+    // or waiting to be written are kept as well.
+    auto erase_batch = [&](bool utxo, const StateTrieMarker& marker, std::vector<dev::h256>& nodes) {
+        LOCK(cs_main);
+        if (!globalState) {
+            nodes.clear();
+            return false;
+        }
+        mark(KeptRoots());
+        dev::OverlayDB& db = utxo ? globalState->dbUtxo() : globalState->db();
+        db.prune(nodes, [&](const dev::h256& node) { return marker.IsMarked(node); });
+        return !m_interrupt;
+    };
+    stats.state_nodes_erased = SweepTrieNodes(*state_db, state_marker, [&](std::vector<dev::h256>& nodes) { return erase_batch(false, state_marker, nodes); });
+    if (m_interrupt) return false;
+    stats.utxo_nodes_erased = SweepTrieNodes(*utxo_db, utxo_marker, [&](std::vector<dev::h256>& nodes) { return erase_batch(true, utxo_marker, nodes); });
+    stats.state_nodes_kept = state_marker.Size();
+    stats.utxo_nodes_kept = utxo_marker.Size();
+
+    // The erased nodes only free their space once their tables are compacted, which the views of
+    // the compaction keep open even if the state is closed first
+    if (stats.state_nodes_erased || stats.utxo_nodes_erased) {
+        GetCompactionController().Request(this, "stateQtum", [state = state_db->diskView(), utxo = utxo_db->diskView()]() mutable {
+            state.compact();
+            utxo.compact();
+        });
+    }
+
+    if (state_marker.Missing() || utxo_marker.Missing()) {
+        LogPrintf("%s: %u state and %u UTXO trie nodes of the kept states are missing, the state database may be corrupted\n",
+                  __func__, state_marker.Missing(), utxo_marker.Missing());
+    }
+    return !m_interrupt;
+}
+
+void StatePruner::ThreadPrune()
+{
+    do {
+        const int height = WITH_LOCK(cs_main, return m_chainman.ActiveHeight());
+        if (m_last_prune_height >= 0 && height < m_last_prune_height + STATE_PRUNE_INTERVAL) continue;
+
+        const auto start = SteadyClock::now();
+        StatePruneStats stats;
+        if (!Prune(stats)) continue;
+        m_last_prune_height = height;
+        LogPrintf("State pruning: erased %u state and %u UTXO trie nodes, kept %u and %u, in %ds\n",
+                  stats.state_nodes_erased, stats.utxo_nodes_erased, stats.state_nodes_kept, stats.utxo_nodes_kept,
+                  Ticks<std::chrono::seconds>(SteadyClock::now() - start));
+    } while (m_interrupt.sleep_for(std::chrono::seconds{10}));
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QTUM_QTUMSTATEPRUNER_H
+#define QTUM_QTUMSTATEPRUNER_H
+
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/TrieCommon.h>
+#include <sync.h>
+#include <util/threadinterrupt.h>
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace dev {
+class OverlayDB;
+}
+class ChainstateManager;
+extern RecursiveMutex cs_main;
+
+/** Number of recent blocks whose EVM and UTXO state is kept (0 = keep all states, the default) */
+static constexpr int64_t DEFAULT_STATE_PRUNING{0};
+/** Number of blocks connected between two pruning cycles */
+static constexpr int STATE_PRUNE_INTERVAL{1000};
+/** Number of unreachable nodes erased at once, while cs_main is held */
+static constexpr size_t STATE_PRUNE_BATCH_SIZE{10000};
+
+/** The trie nodes and contract code reachable from a set of state roots. */
+class StateTrieMarker
+{
+public:
+    //! The empty trie is always kept, states are reset to it
+    StateTrieMarker() { m_marked.insert(dev::EmptyTrie); }
+
+    /** Mark the account trie at @p root with the storage tries and code of its accounts */
+    void MarkState(const dev::OverlayDB& db, const dev::h256& root);
+    /** Mark a trie whose leaves do not refer to other nodes, like the UTXO trie */
+    void MarkTrie(const dev::OverlayDB& db, const dev::h256& root);
+
+    bool IsMarked(const dev::h256& hash) const { return m_marked.count(hash); }
+    size_t Size() const { return m_marked.size(); }
+    /** Number of reachable nodes that were not found in the database */
+    uint64_t Missing() const { return m_missing; }
+
+private:
+    void Mark(const dev::OverlayDB& db, const dev::h256& root, bool account_trie);
+
+    std::unordered_set<dev::h256> m_marked;
+    uint64_t m_missing{0};
+};
+
+struct StatePruneStats
+{
+    uint64_t state_nodes_kept{0};
+    uint64_t state_nodes_erased{0};
+    uint64_t utxo_nodes_kept{0};
+    uint64_t utxo_nodes_erased{0};
+};
+
+/**
+ * Erase the nodes of the disk database of @p db that are not marked in @p marker. The unmarked nodes
+ * are passed to @p erase_batch in batches of at most STATE_PRUNE_BATCH_SIZE, which erases those still
+ * unreachable with dev::OverlayDB::prune, leaves the erased ones in the batch and returns false to stop
+ * the sweep.
+ *
+ * @returns the number of nodes erased.
+ */
+uint64_t SweepTrieNodes(dev::OverlayDB& db, const StateTrieMarker& marker, const std::function<bool(std::vector<dev::h256>&)>& erase_batch);
+
+/**
+ * StatePruner reclaims the trie nodes of the stateQtum databases that are no longer reachable from the
+ * states of the last -statepruning blocks of the active chain, which covers the reorganizations those
+ * blocks allow. Trie nodes are never removed when a state changes, so the databases otherwise only grow.
+ *
+ * A cycle runs at startup and then every STATE_PRUNE_INTERVAL blocks in a background thread. The kept
+ * states are marked without cs_main. The databases are then swept, and before each batch of unreachable
+ * nodes is erased the states of the blocks connected meanwhile are marked under cs_main, so that nodes
+ * written again by those blocks are kept. Nothing is persisted, an interrupted cycle simply runs again.
+ */
+class StatePruner
+{
+public:
+    StatePruner(ChainstateManager& chainman, int keep_blocks);
+    ~StatePruner();
+
+    void Start();
+    void Interrupt();
+    void Stop();
+
+    /** States of blocks at or below the tip height minus this are not kept */
+    int KeepBlocks() const { return m_keep_blocks; }
+
+    /** Run a pruning cycle, returns false if it was interrupted or there is no state to prune */
+    bool Prune(StatePruneStats& stats);
+
+private:
+    /** State and UTXO roots of the blocks in the kept window of the active chain, and of the current state */
+    std::vector<std::pair<dev::h256, dev::h256>> KeptRoots() const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    void ThreadPrune();
+
+    ChainstateManager& m_chainman;
+    const int m_keep_blocks;
+    int m_last_prune_height{-1};
+    CThreadInterrupt m_interrupt;
+    std::thread m_thread;
+};
+
+/// The global state pruner, null unless -statepruning is set.
+extern std::unique_ptr<StatePruner> g_state_pruner;
+
+#endif // QTUM_QTUMSTATEPRUNER_H
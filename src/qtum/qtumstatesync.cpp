@@ -0,0 +1,288 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qtum/qtumstatesync.h>
+
+#include <libdevcore/OverlayDB.h>
+#include <libdevcore/RLP.h>
+#include <libdevcore/SHA3.h>
+#include <libdevcore/TrieCommon.h>
+#include <qtum/qtumstate.h>
+#include <util/convert.h>
+
+namespace qtum {
+
+namespace {
+
+constexpr uint8_t DATABASE_STATE{static_cast<uint8_t>(StateDatabase::STATE)};
+constexpr uint8_t DATABASE_UTXO{static_cast<uint8_t>(StateDatabase::UTXO)};
+constexpr uint8_t ITEM_NODE{static_cast<uint8_t>(StateItemType::NODE)};
+constexpr uint8_t ITEM_AUX{static_cast<uint8_t>(StateItemType::AUX)};
+
+//! Number of nibbles of the hashed keys of the secure tries
+constexpr size_t KEY_NIBBLES{64};
+
+bool IsValidRequest(uint8_t database, uint8_t type)
+{
+    return database <= DATABASE_UTXO && type <= ITEM_AUX;
+}
+
+dev::bytesConstRef ToBytesRef(const std::string& data)
+{
+    return dev::bytesConstRef(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+} // namespace
+
+std::vector<StateItem> ReadStateItems(const QtumStateView& view, const std::vector<StateItemRequest>& requests)
+{
+    std::unique_ptr<QtumState> state = view.makeState();
+    std::vector<StateItem> items;
+    size_t bytes{0};
+    for (const StateItemRequest& request : requests) {
+        if (!IsValidRequest(request.database, request.type)) continue;
+        const dev::OverlayDB& db = request.database == DATABASE_STATE ? state->db() : state->dbUtxo();
+        const dev::h256 hash = uintToh256(request.hash);
+
+        StateItem item{request.database, request.type, {}};
+        if (request.type == ITEM_AUX) {
+            if (!db.existsAux(hash)) continue;
+            item.data = db.lookupAux(hash);
+        } else {
+            const std::string data = db.lookup(hash);
+            item.data.assign(data.begin(), data.end());
+        }
+        if (item.data.empty()) continue;
+
+        bytes += item.data.size();
+        items.push_back(std::move(item));
+        if (bytes >= MAX_STATE_DATA_BYTES) break;
+    }
+    return items;
+}
+
+ContractStateSync::ContractStateSync(std::unique_ptr<QtumState> state, const uint256& block_hash, const uint256& state_root, const uint256& utxo_root) :
+    m_state(std::move(state)), m_block_hash(block_hash), m_state_root(state_root), m_utxo_root(utxo_root)
+{
+    Need({DATABASE_STATE, ITEM_NODE, state_root}, ItemKind::ACCOUNT_TRIE, {}, nullptr);
+    Need({DATABASE_UTXO, ITEM_NODE, utxo_root}, ItemKind::TRIE, {}, nullptr);
+}
+
+ContractStateSync::~ContractStateSync()
+{
+    // The nodes written so far are kept for the download to be resumed
+    Flush();
+}
+
+bool ContractStateSync::IsStored(const Key& key) const
+{
+    const auto& [database, type, hash] = key;
+    const dev::OverlayDB& db = database == DATABASE_STATE ? m_state->db() : m_state->dbUtxo();
+    if (type == ITEM_AUX) return db.existsAux(uintToh256(hash));
+    return uintToh256(hash) == dev::EmptyTrie || db.exists(uintToh256(hash));
+}
+
+bool ContractStateSync::Need(const Key& key, ItemKind kind, std::vector<uint8_t> path, const Key* parent)
+{
+    auto it = m_requests.find(key);
+    if (it == m_requests.end()) {
+        if (IsStored(key)) return false;
+        it = m_requests.emplace(key, Request{}).first;
+        it->second.kind = kind;
+        it->second.path = std::move(path);
+        m_queue.push_back(key);
+    }
+    if (parent) it->second.parents.push_back(*parent);
+    return true;
+}
+
+std::vector<StateItemRequest> ContractStateSync::NextRequests(NodeId peer, size_t max)
+{
+    std::vector<StateItemRequest> requests;
+    while (requests.size() < max && !m_queue.empty()) {
+        const Key key = m_queue.back();
+        m_queue.pop_back();
+        // Items are left in the queue when they are received from another peer than the one asked
+        auto it = m_requests.find(key);
+        if (it == m_requests.end() || it->second.requested || it->second.received) continue;
+
+        it->second.requested = true;
+        m_in_flight[peer].insert(key);
+        requests.push_back({std::get<0>(key), std::get<1>(key), std::get<2>(key)});
+    }
+    return requests;
+}
+
+size_t ContractStateSync::ProcessItems(NodeId peer, const std::vector<StateItem>& items)
+{
+    size_t needed{0};
+    for (const StateItem& item : items) {
+        if (!IsValidRequest(item.database, item.type)) continue;
+        const Key key{item.database, item.type, h256Touint(dev::sha3(item.data))};
+        auto it = m_requests.find(key);
+        if (it == m_requests.end() || it->second.received) continue;
+
+        for (auto& [id, keys] : m_in_flight) keys.erase(key);
+        Request& request = it->second;
+        request.received = true;
+        request.data.assign(item.data.begin(), item.data.end());
+        m_bytes += item.data.size();
+        ++needed;
+
+        if (request.kind == ItemKind::ACCOUNT_TRIE || request.kind == ItemKind::TRIE) {
+            Expand(key);
+        } else {
+            Write(key);
+        }
+    }
+    PeerDone(peer);
+    return needed;
+}
+
+void ContractStateSync::PeerDone(NodeId peer)
+{
+    auto flight = m_in_flight.find(peer);
+    if (flight == m_in_flight.end()) return;
+    for (const Key& key : flight->second) {
+        auto it = m_requests.find(key);
+        if (it == m_requests.end() || it->second.received) continue;
+        it->second.requested = false;
+        m_queue.push_back(key);
+    }
+    m_in_flight.erase(flight);
+}
+
+void ContractStateSync::VisitNode(const dev::RLP& node, const std::vector<uint8_t>& path, ItemKind kind, uint8_t database, std::vector<Child>& children)
+{
+    if (!node.isList()) return;
+    if (node.itemCount() == 17) {
+        for (uint8_t i = 0; i < 16; ++i) {
+            if (node[i].isEmpty()) continue;
+            std::vector<uint8_t> child_path{path};
+            child_path.push_back(i);
+            VisitChild(node[i], child_path, kind, database, children);
+        }
+        if (!node[16].isEmpty()) VisitLeaf(node[16], path, kind, database, children);
+    } else if (node.itemCount() == 2) {
+        const dev::NibbleSlice suffix = dev::keyOf(node);
+        std::vector<uint8_t> child_path{path};
+        for (unsigned i = 0; i < suffix.size(); ++i) {
+            child_path.push_back(suffix[i]);
+        }
+        if (dev::isLeaf(node)) {
+            VisitLeaf(node[1], child_path, kind, database, children);
+        } else {
+            VisitChild(node[1], child_path, kind, database, children);
+        }
+    }
+}
+
+void ContractStateSync::VisitChild(const dev::RLP& item, const std::vector<uint8_t>& path, ItemKind kind, uint8_t database, std::vector<Child>& children)
+{
+    if (item.isData() && item.size() == 32) {
+        children.push_back({{database, ITEM_NODE, h256Touint(item.toHash<dev::h256>())}, kind, path});
+    } else if (item.isList()) {
+        VisitNode(item, path, kind, database, children);
+    }
+}
+
+void ContractStateSync::VisitLeaf(const dev::RLP& value, const std::vector<uint8_t>& path, ItemKind kind, uint8_t database, std::vector<Child>& children)
+{
+    if (path.size() == KEY_NIBBLES) {
+        dev::h256 key_hash;
+        for (size_t i = 0; i < KEY_NIBBLES; ++i) {
+            key_hash[i / 2] |= i % 2 ? path[i] : path[i] << 4;
+        }
+        children.push_back({{database, ITEM_AUX, h256Touint(key_hash)}, ItemKind::AUX, {}});
+    }
+
+    if (kind != ItemKind::ACCOUNT_TRIE) return;
+    dev::RLP account(value.payload());
+    if (!account.isList() || account.itemCount() < 4) return;
+    const dev::h256 storage_root = account[2].toHash<dev::h256>();
+    if (storage_root != dev::EmptyTrie) {
+        children.push_back({{database, ITEM_NODE, h256Touint(storage_root)}, ItemKind::TRIE, {}});
+    }
+    const dev::h256 code_hash = account[3].toHash<dev::h256>();
+    if (code_hash != dev::EmptySHA3) {
+        children.push_back({{database, ITEM_NODE, h256Touint(code_hash)}, ItemKind::CODE, {}});
+    }
+}
+
+void ContractStateSync::Expand(const Key& key)
+{
+    std::vector<Child> children;
+    {
+        const Request& request = m_requests.at(key);
+        try {
+            VisitNode(dev::RLP(request.data), request.path, request.kind, std::get<0>(key), children);
+        } catch (const dev::Exception&) {
+            // The node hashes to a node of the trie, so it cannot be malformed unless the trie is
+        }
+    }
+
+    size_t dependencies{0};
+    for (Child& child : children) {
+        if (Need(child.key, child.kind, std::move(child.path), &key)) ++dependencies;
+    }
+    m_requests.at(key).dependencies = dependencies;
+    if (dependencies == 0) Write(key);
+}
+
+void ContractStateSync::Write(const Key& key)
+{
+    std::vector<Key> complete{key};
+    while (!complete.empty()) {
+        const Key item = complete.back();
+        complete.pop_back();
+        auto it = m_requests.find(item);
+        if (it == m_requests.end()) continue;
+
+        const auto& [database, type, hash] = item;
+        dev::OverlayDB& db = database == DATABASE_STATE ? m_state->db() : m_state->dbUtxo();
+        if (type == ITEM_AUX) {
+            db.insertAux(uintToh256(hash), ToBytesRef(it->second.data));
+            ++m_aux;
+        } else {
+            db.insert(uintToh256(hash), ToBytesRef(it->second.data));
+            ++m_nodes;
+        }
+        ++m_unflushed;
+
+        for (const Key& parent : it->second.parents) {
+            auto p = m_requests.find(parent);
+            if (p != m_requests.end() && --p->second.dependencies == 0) complete.push_back(parent);
+        }
+        m_requests.erase(it);
+    }
+
+    if (m_unflushed >= STATE_SYNC_FLUSH_ITEMS || IsComplete()) Flush();
+}
+
+void ContractStateSync::Flush()
+{
+    if (m_unflushed == 0) return;
+    m_state->db().commit();
+    m_state->dbUtxo().commit();
+    m_unflushed = 0;
+}
+
+ContractStateSyncStats ContractStateSync::GetStats() const
+{
+    ContractStateSyncStats stats;
+    stats.block_hash = m_block_hash;
+    stats.state_root = m_state_root;
+    stats.utxo_root = m_utxo_root;
+    stats.nodes = m_nodes;
+    stats.aux = m_aux;
+    stats.bytes = m_bytes;
+    stats.pending = m_requests.size();
+    for (const auto& [peer, keys] : m_in_flight) {
+        stats.in_flight += keys.size();
+    }
+    stats.complete = IsComplete();
+    return stats;
+}
+
+} // namespace qtum
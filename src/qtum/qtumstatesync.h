@@ -0,0 +1,185 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QTUM_QTUMSTATESYNC_H
+#define QTUM_QTUMSTATESYNC_H
+
+#include <net.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+class QtumState;
+class QtumStateView;
+namespace dev { class RLP; }
+
+namespace qtum {
+
+//! Maximum number of items asked for in one getstatedata message
+static constexpr size_t MAX_STATE_DATA_ITEMS{384};
+//! Size of the items above which no more are added to a statedata message
+static constexpr size_t MAX_STATE_DATA_BYTES{2 * 1024 * 1024};
+//! Number of items downloaded between two writes of the databases to disk
+static constexpr size_t STATE_SYNC_FLUSH_ITEMS{20000};
+
+//! Database an item of the contract state is stored in
+enum class StateDatabase : uint8_t {
+    STATE = 0, //!< Account and storage tries, and contract code
+    UTXO = 1,  //!< UTXO trie of the contracts
+};
+
+//! Kind of an item of the contract state, which is stored under the hash of its data
+enum class StateItemType : uint8_t {
+    NODE = 0, //!< Trie node or contract code
+    AUX = 1,  //!< Key of a trie leaf, hashed into its path, which the databases keep to iterate the tries
+};
+
+struct StateItemRequest {
+    uint8_t database;
+    uint8_t type;
+    uint256 hash;
+
+    SERIALIZE_METHODS(StateItemRequest, obj) { READWRITE(obj.database, obj.type, obj.hash); }
+};
+
+struct StateItem {
+    uint8_t database;
+    uint8_t type;
+    std::vector<unsigned char> data;
+
+    SERIALIZE_METHODS(StateItem, obj) { READWRITE(obj.database, obj.type, obj.data); }
+};
+
+/**
+ * Read the items of @p requests from the databases of @p view, in order, skipping those it does not have.
+ * The items are read straight from the databases: any stored item is served, whatever the root of the view.
+ * No more items are added once MAX_STATE_DATA_BYTES are read.
+ */
+std::vector<StateItem> ReadStateItems(const QtumStateView& view, const std::vector<StateItemRequest>& requests);
+
+struct ContractStateSyncStats {
+    uint256 block_hash;
+    uint256 state_root;
+    uint256 utxo_root;
+    //! Items downloaded and written to the databases
+    uint64_t nodes{0};
+    uint64_t aux{0};
+    uint64_t bytes{0};
+    //! Items to download, of which some are requested from peers
+    size_t pending{0};
+    size_t in_flight{0};
+    bool complete{false};
+};
+
+/**
+ * Download of the contract state of a block from peers, a trie node at a time like the state
+ * download of Ethereum fast sync. Starting from the state and UTXO roots of the block header,
+ * the items are requested by hash and every downloaded item is checked against its hash, so each
+ * one is verified on arrival and can be asked from any peer. The peers serve them straight from
+ * their databases, without executing any contract.
+ *
+ * A node is only written to the databases once its whole subtree is, so a node found in the
+ * databases is complete and the download skips it: a download that was interrupted resumes from
+ * where it stopped when it is started again. The nodes still waiting for their children are kept
+ * in memory.
+ *
+ * The class is not thread safe.
+ */
+class ContractStateSync
+{
+public:
+    /** Download the tries at @p state_root and @p utxo_root into the databases of @p state */
+    ContractStateSync(std::unique_ptr<QtumState> state, const uint256& block_hash, const uint256& state_root, const uint256& utxo_root);
+    ~ContractStateSync();
+
+    /** Items to request from @p peer, at most @p max, none of which are requested from another peer */
+    std::vector<StateItemRequest> NextRequests(NodeId peer, size_t max);
+
+    /**
+     * Process the items received from @p peer. Items that are not needed anymore are ignored, and those
+     * requested from the peer that it did not send are requested again from another peer.
+     *
+     * @returns the number of items needed among @p items
+     */
+    size_t ProcessItems(NodeId peer, const std::vector<StateItem>& items);
+
+    /** Request again the items in flight from @p peer, which disconnected or did not answer */
+    void PeerDone(NodeId peer);
+
+    bool IsComplete() const { return m_requests.empty(); }
+
+    ContractStateSyncStats GetStats() const;
+
+private:
+    enum class ItemKind {
+        ACCOUNT_TRIE, //!< Node of an account trie, whose leaves refer to storage tries and code
+        TRIE,         //!< Node of a storage or UTXO trie
+        CODE,
+        AUX,
+    };
+
+    using Key = std::tuple<uint8_t, uint8_t, uint256>;
+
+    struct Request {
+        ItemKind kind;
+        //! Nibbles of the path from the root of the trie to the node, to hash the keys of its leaves. A subtree
+        //! shared by several paths of the tries is downloaded once, with the key preimages of its first path.
+        std::vector<uint8_t> path;
+        //! Nodes waiting for this item to be written
+        std::vector<Key> parents;
+        //! Children of this node that are not written yet
+        size_t dependencies{0};
+        std::string data;
+        bool requested{false};
+        bool received{false};
+    };
+
+    std::unique_ptr<QtumState> m_state;
+    const uint256 m_block_hash;
+    const uint256 m_state_root;
+    const uint256 m_utxo_root;
+
+    std::map<Key, Request> m_requests;
+    //! Items to request, the last first so that the subtrees are completed one after the other
+    std::deque<Key> m_queue;
+    std::map<NodeId, std::set<Key>> m_in_flight;
+
+    uint64_t m_nodes{0};
+    uint64_t m_aux{0};
+    uint64_t m_bytes{0};
+    size_t m_unflushed{0};
+
+    struct Child {
+        Key key;
+        ItemKind kind;
+        std::vector<uint8_t> path;
+    };
+
+    /** Schedule the item @p key for @p parent, unless it is stored already. @returns whether @p parent has to wait for it. */
+    bool Need(const Key& key, ItemKind kind, std::vector<uint8_t> path, const Key* parent);
+    bool IsStored(const Key& key) const;
+
+    /** Collect the children of a node of a trie of @p database, found at @p path from its root */
+    static void VisitNode(const dev::RLP& node, const std::vector<uint8_t>& path, ItemKind kind, uint8_t database, std::vector<Child>& children);
+    /** Children are stored under their hash, or inline when their RLP is shorter than a hash */
+    static void VisitChild(const dev::RLP& item, const std::vector<uint8_t>& path, ItemKind kind, uint8_t database, std::vector<Child>& children);
+    /** The leaf at @p path needs the preimage of its key, and those of an account trie its storage trie and code */
+    static void VisitLeaf(const dev::RLP& value, const std::vector<uint8_t>& path, ItemKind kind, uint8_t database, std::vector<Child>& children);
+    /** Schedule the children of the received trie node @p key, and write it if they are all stored */
+    void Expand(const Key& key);
+    /** Write the item @p key and the parents it completes */
+    void Write(const Key& key);
+    void Flush();
+};
+
+} // namespace qtum
+
+#endif // QTUM_QTUMSTATESYNC_H
@@ -442,6 +442,33 @@ bool QtumToken::balanceOf(const std::string &_spender, std::string &result, bool
     return true;
 }
 
+bool QtumToken::balanceOfData(const std::string &_spender, std::string &data)
+{
+    std::string spender = _spender;
+    if(!ToHash160(spender, spender))
+    {
+        return false;
+    }
+
+    std::vector<std::vector<std::string>> values;
+    values.push_back({spender});
+    std::vector<ParameterABI::ErrorType> errors;
+    return d->ABI->functions[d->funcBalanceOf].abiIn(values, data, errors);
+}
+
+bool QtumToken::balanceOfResult(const std::string &output, std::string &result)
+{
+    std::vector<std::vector<std::string>> values;
+    std::vector<ParameterABI::ErrorType> errors;
+    if(!d->ABI->functions[d->funcBalanceOf].abiOut(output, values, errors))
+        return false;
+
+    if(values.size() == 0 || values[0].size() == 0)
+        return false;
+    result = values[0][0];
+    return true;
+}
+
 bool QtumToken::burnFrom(const std::string &_from, const std::string &_value, bool &success, bool sendTo)
 {
     std::string from = _from;
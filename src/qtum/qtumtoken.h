@@ -82,6 +82,10 @@ public:
     bool approveAndCall(const std::string& _spender, const std::string& _value, const std::string& _extraData, bool& success, bool sendTo = false);
     bool allowance(const std::string& _from, const std::string& _to, std::string& result, bool sendTo = false);
 
+    // Encode and decode the balanceOf call, for running it in a batch of calls
+    bool balanceOfData(const std::string& spender, std::string& data);
+    bool balanceOfResult(const std::string& output, std::string& result);
+
     // ABI Events
     bool transferEvents(std::vector<TokenEvent>& tokenEvents, int64_t fromBlock = 0, int64_t toBlock = -1, int64_t minconf = 0);
     bool burnEvents(std::vector<TokenEvent>& tokenEvents, int64_t fromBlock = 0, int64_t toBlock = -1, int64_t minconf = 0);
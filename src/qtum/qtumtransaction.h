@@ -17,8 +17,8 @@ struct VersionVM{
     // CONSENSUS CRITICAL!
     // Do not add any other fields to this struct
 
-    uint32_t toRaw(){
-        return *(uint32_t*)this;
+    uint32_t toRaw() const{
+        return *(const uint32_t*)this;
     }
     static VersionVM fromRaw(uint32_t val){
         VersionVM x = *(VersionVM*)&val;
@@ -3,9 +3,96 @@
 #include <pubkey.h>
 #include <util/convert.h>
 #include <chainparams.h>
+#include <crypto/sha256.h>
+#include <cuckoocache.h>
+#include <random.h>
+#include <util/hasher.h>
+
+#include <mutex>
+#include <shared_mutex>
 
 using namespace dev;
 
+namespace {
+//! Memory used by the public key recovery cache
+static constexpr size_t RECOVER_CACHE_BYTES{4 << 20};
+
+struct RecoverCacheElement
+{
+    uint256 entry;
+    h256 key;
+    bool recovered{false};
+
+    //! Elements are looked up by entry only, the key is the cached value
+    bool operator==(const RecoverCacheElement& other) const { return entry == other.entry; }
+};
+
+class RecoverCacheHasher
+{
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const RecoverCacheElement& element) const
+    {
+        return SignatureCacheHasher().operator()<hash_select>(element.entry);
+    }
+};
+
+/**
+ * Cache of the public keys recovered by the ecrecover precompiles, contracts that check
+ * signed messages often recover the same signature again when a block is assembled,
+ * validated and when the contract is called
+ */
+class CRecoverCache
+{
+private:
+    //! Entries are SHA256(nonce || precompile type || 31 zero bytes || input)
+    CSHA256 m_salted_hasher;
+    CuckooCache::cache<RecoverCacheElement, RecoverCacheHasher> m_results;
+    std::shared_mutex cs_recovercache;
+
+public:
+    CRecoverCache()
+    {
+        uint256 nonce = GetRandHash();
+        m_salted_hasher.Write(nonce.begin(), 32);
+        m_results.setup_bytes(RECOVER_CACHE_BYTES);
+    }
+
+    h256 ComputeEntry(qtumutils::RecoverType type, bytesConstRef in) const
+    {
+        unsigned char padding[32] = {(unsigned char)type};
+        h256 entry;
+        CSHA256 hasher = m_salted_hasher;
+        hasher.Write(padding, 32).Write(in.data(), in.size()).Finalize(entry.data());
+        return entry;
+    }
+
+    bool Get(const h256& entry, bool& recovered, h256& key)
+    {
+        RecoverCacheElement element;
+        element.entry = h256Touint(entry);
+        std::shared_lock<std::shared_mutex> lock(cs_recovercache);
+        const RecoverCacheElement* found = m_results.find(element, false);
+        if (!found) return false;
+        recovered = found->recovered;
+        key = found->key;
+        return true;
+    }
+
+    void Set(const h256& entry, bool recovered, const h256& key)
+    {
+        RecoverCacheElement element;
+        element.entry = h256Touint(entry);
+        element.key = key;
+        element.recovered = recovered;
+        std::unique_lock<std::shared_mutex> lock(cs_recovercache);
+        m_results.insert(element);
+    }
+};
+
+static CRecoverCache recoverCache;
+} // namespace
+
 bool qtumutils::btc_ecrecover(const dev::h256 &hash, const dev::u256 &v, const dev::h256 &r, const dev::h256 &s, dev::h256 &key)
 {
     // Check input parameters
@@ -39,6 +126,21 @@ bool qtumutils::btc_ecrecover(const dev::h256 &hash, const dev::u256 &v, const d
     return false;
 }
 
+h256 qtumutils::recover_cache_entry(RecoverType type, bytesConstRef in)
+{
+    return recoverCache.ComputeEntry(type, in);
+}
+
+bool qtumutils::recover_cache_get(const h256 &entry, bool &recovered, h256 &key)
+{
+    return recoverCache.Get(entry, recovered, key);
+}
+
+void qtumutils::recover_cache_set(const h256 &entry, bool recovered, const h256 &key)
+{
+    recoverCache.Set(entry, recovered, key);
+}
+
 struct EthChainIdCache
 {
     EthChainIdCache() {}
@@ -14,6 +14,40 @@ namespace qtumutils
  */
 bool btc_ecrecover(dev::h256 const& hash, dev::u256 const& v, dev::h256 const& r, dev::h256 const& s, dev::h256 & key);
 
+/**
+ * @brief The RecoverType enum Precompiles that share the public key recovery cache
+ */
+enum class RecoverType : unsigned char
+{
+    BTC = 'B',
+    ETH = 'E',
+};
+
+/**
+ * @brief recover_cache_entry Compute the salted cache entry of a public key recovery
+ * @param type Precompile that does the recovery
+ * @param in Input of the precompile (hash, v, r, s), padded to 128 bytes
+ * @return cache entry
+ */
+dev::h256 recover_cache_entry(RecoverType type, dev::bytesConstRef in);
+
+/**
+ * @brief recover_cache_get Look up a cached public key recovery
+ * @param entry Cache entry
+ * @param recovered Set to whether the recovery succeeded
+ * @param key Set to the recovered key when it succeeded
+ * @return true if the entry is in the cache
+ */
+bool recover_cache_get(dev::h256 const& entry, bool& recovered, dev::h256& key);
+
+/**
+ * @brief recover_cache_set Add the result of a public key recovery to the cache
+ * @param entry Cache entry
+ * @param recovered Whether the recovery succeeded
+ * @param key Recovered key
+ */
+void recover_cache_set(dev::h256 const& entry, bool recovered, dev::h256 const& key);
+
 
 /**
  * @brief The ChainIdType enum Chain Id values for the networks
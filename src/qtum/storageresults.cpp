@@ -1,7 +1,10 @@
 #include <qtum/storageresults.h>
 #include <util/convert.h>
+#include <leveldb/write_batch.h>
+#include <clientversion.h>
+#include <streams.h>
 
-StorageResults::StorageResults(std::string const& _path){
+StorageResults::StorageResults(std::string const& _path, size_t _cacheSize) : cacheSize(_cacheSize){
 	path = _path + "/resultsDB";
     leveldb::Options options;
     options.create_if_missing = true;
@@ -12,6 +15,7 @@ StorageResults::StorageResults(std::string const& _path){
 
 StorageResults::~StorageResults()
 {
+    flushResults();
     delete db;
     db = NULL;
 }
@@ -26,6 +30,12 @@ void StorageResults::clearCacheResult(){
 
 void StorageResults::wipeResults(){
     LogPrintf("Wiping LevelDB in %s\n", path);
+    m_cache_result.clear();
+    m_dirty_result.clear();
+    dirtyUsage = 0;
+    m_read_cache.clear();
+    readOrder.clear();
+    readUsage = 0;
     bool opened = db;
     if (opened) {
         delete db;
@@ -41,74 +51,249 @@ void StorageResults::wipeResults(){
 
 void StorageResults::deleteResults(std::vector<CTransactionRef> const& txs){
 
-    for(CTransactionRef tx : txs){
+    leveldb::WriteBatch batch;
+    for(CTransactionRef const& tx : txs){
         dev::h256 hashTx = uintToh256(tx->GetHash());
         m_cache_result.erase(hashTx);
+        auto it = m_dirty_result.find(hashTx);
+        if(it != m_dirty_result.end()){
+            dirtyUsage -= resultMemoryUsage(it->second);
+            m_dirty_result.erase(it);
+        }
+        eraseReadCache(hashTx);
 
-        std::string keyTemp = hashTx.hex();
-	    leveldb::Slice key(keyTemp);
-        leveldb::Status status = db->Delete(leveldb::WriteOptions(), key);
-        assert(status.ok());
+        batch.Delete(hashTx.hex());
     }
+    leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+    assert(status.ok());
 }
 
 std::vector<TransactionReceiptInfo> StorageResults::getResult(dev::h256 const& hashTx){
     std::vector<TransactionReceiptInfo> result;
 	auto it = m_cache_result.find(hashTx);
-	if (it == m_cache_result.end()){
-		if(readResult(hashTx, result))
-			m_cache_result.insert(std::make_pair(hashTx, result));
-    } else {
-		result = it->second;
+	if (it != m_cache_result.end()){
+        ++cacheHits;
+		return it->second;
+    }
+    auto itDirty = m_dirty_result.find(hashTx);
+    if (itDirty != m_dirty_result.end()){
+        ++cacheHits;
+        return itDirty->second;
+    }
+    auto itRead = m_read_cache.find(hashTx);
+    if (itRead != m_read_cache.end()){
+        ++cacheHits;
+        readOrder.splice(readOrder.begin(), readOrder, itRead->second.second);
+        return itRead->second.first;
     }
+    ++cacheMisses;
+	if(readResult(hashTx, result))
+		touchReadCache(hashTx, result);
 	return result;
 }
 
 void StorageResults::commitResults(){
-    if(m_cache_result.size()){
-
-        for (auto const& i: m_cache_result){
-            std::string valueTemp;
-            std::string keyTemp = i.first.hex();
-            leveldb::Slice key(keyTemp);
-            leveldb::Status status = db->Get(leveldb::ReadOptions(), key, &valueTemp);
-
-            if(status.IsNotFound()){
-
-                TransactionReceiptInfoSerialized tris;
-
-                for(size_t j = 0; j < i.second.size(); j++){
-                    tris.blockHashes.push_back(uintToh256(i.second[j].blockHash));
-                    tris.blockNumbers.push_back(i.second[j].blockNumber);
-                    tris.transactionHashes.push_back(uintToh256(i.second[j].transactionHash));
-                    tris.transactionIndexes.push_back(i.second[j].transactionIndex);
-                    tris.senders.push_back(i.second[j].from);
-                    tris.receivers.push_back(i.second[j].to);
-                    tris.cumulativeGasUsed.push_back(dev::u256(i.second[j].cumulativeGasUsed));
-                    tris.gasUsed.push_back(dev::u256(i.second[j].gasUsed));
-                    tris.contractAddresses.push_back(i.second[j].contractAddress);
-                    tris.logs.push_back(logEntriesSerialization(i.second[j].logs));
-                    tris.excepted.push_back(uint32_t(static_cast<int>(i.second[j].excepted)));
-                    tris.exceptedMessage.push_back(i.second[j].exceptedMessage);
-                    tris.outputIndexes.push_back(i.second[j].outputIndex);
-                    tris.blooms.push_back(i.second[j].bloom);
-                    tris.stateRoots.push_back(i.second[j].stateRoot);
-                    tris.utxoRoots.push_back(i.second[j].utxoRoot);
-                }
-
-                dev::RLPStream streamRLP(16);
-                streamRLP << tris.blockHashes << tris.blockNumbers << tris.transactionHashes << tris.transactionIndexes << tris.senders;
-                streamRLP << tris.receivers << tris.cumulativeGasUsed << tris.gasUsed << tris.contractAddresses << tris.logs << tris.excepted << tris.exceptedMessage << tris.outputIndexes << tris.blooms << tris.stateRoots << tris.utxoRoots;
-
-                dev::bytes data = streamRLP.out();
-                std::string stringData(data.begin(), data.end());
-                leveldb::Slice value(stringData);
-                status = db->Put(leveldb::WriteOptions(), key, value);
-                assert(status.ok());
+    for (auto& i: m_cache_result){
+        eraseReadCache(i.first);
+        auto it = m_dirty_result.find(i.first);
+        if(it != m_dirty_result.end()){
+            dirtyUsage -= resultMemoryUsage(it->second);
+        }
+        dirtyUsage += resultMemoryUsage(i.second);
+        m_dirty_result[i.first] = std::move(i.second);
+    }
+    m_cache_result.clear();
+
+    // Write out early rather than going over the memory budget
+    if(dirtyUsage > cacheSize){
+        flushResults();
+    } else {
+        trimReadCache();
+    }
+}
+
+void StorageResults::flushResults(){
+    if(m_dirty_result.empty())
+        return;
+
+    leveldb::WriteBatch batch;
+    for (auto const& i: m_dirty_result){
+        batch.Put(i.first.hex(), serializeResult(i.second));
+    }
+    leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+    assert(status.ok());
+    m_dirty_result.clear();
+    dirtyUsage = 0;
+}
+
+namespace {
+/**
+ * Leading byte of the compact receipts encoding. Entries written by older versions are an
+ * RLP list, which always starts with a byte of at least 0xc0.
+ */
+const unsigned char RECEIPTS_FORMAT_COMPACT = 0x01;
+
+/** Flags of a receipt in the compact encoding */
+const unsigned char RECEIPT_EXPLICIT_BLOOM = 0x01;
+
+template <typename Stream, unsigned N>
+void writeHash(Stream& s, dev::FixedHash<N> const& hash){
+    s << Span{hash.data(), N};
+}
+
+template <typename Stream, unsigned N>
+void readHash(Stream& s, dev::FixedHash<N>& hash){
+    Span<unsigned char> span{hash.data(), N};
+    s >> span;
+}
+}
+
+std::string StorageResults::serializeResult(std::vector<TransactionReceiptInfo> const& _result){
+    // All the receipts of a transaction share the block and transaction fields, they are stored once
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << RECEIPTS_FORMAT_COMPACT;
+    ss << VARINT(uint64_t(_result.size()));
+    if(_result.empty())
+        return ss.str();
+
+    const TransactionReceiptInfo& first = _result.front();
+    ss << first.blockHash << VARINT(first.blockNumber) << first.transactionHash << VARINT(first.transactionIndex);
+    for(auto const& tri : _result){
+        unsigned char flags = 0;
+        if(tri.bloom != dev::eth::bloom(tri.logs))
+            flags |= RECEIPT_EXPLICIT_BLOOM;
+        ss << flags;
+        writeHash(ss, tri.from);
+        writeHash(ss, tri.to);
+        ss << VARINT(tri.cumulativeGasUsed) << VARINT(tri.gasUsed);
+        writeHash(ss, tri.contractAddress);
+        ss << VARINT(uint64_t(tri.logs.size()));
+        for(auto const& log : tri.logs){
+            writeHash(ss, log.address);
+            ss << VARINT(uint64_t(log.topics.size()));
+            for(auto const& topic : log.topics)
+                writeHash(ss, topic);
+            ss << log.data;
+        }
+        ss << VARINT(uint32_t(static_cast<int>(tri.excepted))) << tri.exceptedMessage << VARINT(tri.outputIndex);
+        if(flags & RECEIPT_EXPLICIT_BLOOM)
+            writeHash(ss, tri.bloom);
+        writeHash(ss, tri.stateRoot);
+        writeHash(ss, tri.utxoRoot);
+    }
+    return ss.str();
+}
+
+bool StorageResults::deserializeResult(std::string const& _value, std::vector<TransactionReceiptInfo>& _result){
+    try {
+        CDataStream ss(MakeByteSpan(_value), SER_DISK, CLIENT_VERSION);
+        unsigned char version;
+        uint64_t count;
+        ss >> version >> VARINT(count);
+        if(version != RECEIPTS_FORMAT_COMPACT)
+            return false;
+        if(count == 0)
+            return true;
+
+        TransactionReceiptInfo base{};
+        ss >> base.blockHash >> VARINT(base.blockNumber) >> base.transactionHash >> VARINT(base.transactionIndex);
+        for(uint64_t j = 0; j < count; j++){
+            TransactionReceiptInfo tri = base;
+            unsigned char flags;
+            ss >> flags;
+            readHash(ss, tri.from);
+            readHash(ss, tri.to);
+            ss >> VARINT(tri.cumulativeGasUsed) >> VARINT(tri.gasUsed);
+            readHash(ss, tri.contractAddress);
+            uint64_t logs;
+            ss >> VARINT(logs);
+            for(uint64_t k = 0; k < logs; k++){
+                dev::Address address;
+                readHash(ss, address);
+                uint64_t topicsCount;
+                ss >> VARINT(topicsCount);
+                dev::h256s topics(topicsCount);
+                for(auto& topic : topics)
+                    readHash(ss, topic);
+                dev::bytes data;
+                ss >> data;
+                tri.logs.push_back(dev::eth::LogEntry(address, topics, std::move(data)));
             }
+            uint32_t excepted;
+            ss >> VARINT(excepted) >> tri.exceptedMessage >> VARINT(tri.outputIndex);
+            tri.excepted = static_cast<dev::eth::TransactionException>(excepted);
+            if(flags & RECEIPT_EXPLICIT_BLOOM)
+                readHash(ss, tri.bloom);
+            else
+                tri.bloom = dev::eth::bloom(tri.logs);
+            readHash(ss, tri.stateRoot);
+            readHash(ss, tri.utxoRoot);
+            _result.push_back(std::move(tri));
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("%s: Deserialize error - %s\n", __func__, e.what());
+        _result.clear();
+        return false;
+    }
+    return true;
+}
+
+size_t StorageResults::resultMemoryUsage(std::vector<TransactionReceiptInfo> const& _result){
+    // Rough estimate of the heap usage, used for the cache budget only
+    size_t usage = sizeof(dev::h256) + sizeof(TransactionReceiptInfo) * _result.size();
+    for(auto const& tri : _result){
+        usage += tri.exceptedMessage.size();
+        for(auto const& log : tri.logs){
+            usage += sizeof(dev::eth::LogEntry) + log.topics.size() * sizeof(dev::h256) + log.data.size();
         }
-        m_cache_result.clear();
     }
+    return usage;
+}
+
+void StorageResults::upgradeResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo> const& _result){
+    // Legacy entries are migrated in place as they are read, without a full database rewrite
+    if(m_dirty_result.count(_key) || dirtyUsage > cacheSize)
+        return;
+    dirtyUsage += resultMemoryUsage(_result);
+    m_dirty_result[_key] = _result;
+}
+
+void StorageResults::touchReadCache(dev::h256 const& _key, std::vector<TransactionReceiptInfo> const& _result){
+    eraseReadCache(_key);
+    if(m_dirty_result.count(_key))
+        return;
+    readOrder.push_front(_key);
+    m_read_cache.emplace(_key, std::make_pair(_result, readOrder.begin()));
+    readUsage += resultMemoryUsage(_result);
+    trimReadCache();
+}
+
+void StorageResults::eraseReadCache(dev::h256 const& _key){
+    auto it = m_read_cache.find(_key);
+    if(it == m_read_cache.end())
+        return;
+    readUsage -= resultMemoryUsage(it->second.first);
+    readOrder.erase(it->second.second);
+    m_read_cache.erase(it);
+}
+
+void StorageResults::trimReadCache(){
+    while(!readOrder.empty() && dirtyUsage + readUsage > cacheSize){
+        eraseReadCache(readOrder.back());
+        ++cacheEvictions;
+    }
+}
+
+void StorageResults::setCacheSize(size_t _cacheSize){
+    cacheSize = _cacheSize;
+    if(dirtyUsage > cacheSize){
+        flushResults();
+    }
+    trimReadCache();
+}
+
+CacheStats StorageResults::getCacheStats() const{
+    return {cacheHits, cacheMisses, cacheEvictions, cacheSize};
 }
 
 bool StorageResults::readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result){
@@ -119,7 +304,10 @@ bool StorageResults::readResult(dev::h256 const& _key, std::vector<TransactionRe
     leveldb::Status s = db->Get(leveldb::ReadOptions(), key, &value);
 
 	if(!s.IsNotFound() && s.ok()){
-        
+        if(!value.empty() && (unsigned char)value[0] == RECEIPTS_FORMAT_COMPACT)
+            return deserializeResult(value, _result);
+
+        // Entries written before the compact encoding, they are rewritten with it by the next flush
         TransactionReceiptInfoSerialized tris;
 
 		dev::RLP state(value);
@@ -167,19 +355,12 @@ bool StorageResults::readResult(dev::h256 const& _key, std::vector<TransactionRe
             };
             _result.push_back(tri);
         }
+        upgradeResult(_key, _result);
 		return true;
 	}
 	return false;
 }
 
-logEntriesSerialize StorageResults::logEntriesSerialization(dev::eth::LogEntries const& _logs){
-	logEntriesSerialize result;
-	for(dev::eth::LogEntry i : _logs){
-		result.push_back(std::make_pair(i.address, std::make_pair(i.topics, i.data)));
-	}
-	return result;
-}
-
 dev::eth::LogEntries StorageResults::logEntriesDeserialize(logEntriesSerialize const& _logs){
 	dev::eth::LogEntries result;
 	for(std::pair<dev::Address, std::pair<dev::h256s, dev::bytes>> i : _logs){
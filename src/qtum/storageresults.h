@@ -3,8 +3,11 @@
 #include <libethereum/State.h>
 #include <libethereum/Transaction.h>
 #include <leveldb/db.h>
+#include <util/cachestats.h>
 #include <util/system.h>
 
+#include <list>
+
 using logEntriesSerialize = std::vector<std::pair<dev::Address, std::pair<dev::h256s, dev::bytes>>>;
 
 struct TransactionReceiptInfo{
@@ -45,36 +48,81 @@ struct TransactionReceiptInfoSerialized{
     std::vector<dev::h256> utxoRoots;
 };
 
+/** Default and maximum memory for the receipts cache of StorageResults, in MiB */
+static const int64_t nDefaultReceiptsCache = 32;
+static const int64_t nMaxReceiptsCache = 256;
+
 class StorageResults{
 
 public:
 
-	StorageResults(std::string const& _path);
+	StorageResults(std::string const& _path, size_t _cacheSize = nDefaultReceiptsCache << 20);
     ~StorageResults();
 
 	void addResult(dev::h256 hashTx, std::vector<TransactionReceiptInfo>& result);
 
+    /// Delete the results of the transactions, in one write to the database.
     void deleteResults(std::vector<CTransactionRef> const& txs);
 
     std::vector<TransactionReceiptInfo> getResult(dev::h256 const& hashTx);
 
+    /// Accept the results added for the connected block, they are written by the next flushResults.
 	void commitResults();
 
+    /// Write all the committed results to the database in one batch.
+    void flushResults();
+
+    /// Drop the results added since the last commitResults.
     void clearCacheResult();
 
     void wipeResults();
 
+    /// Change the memory budget, trimming the read cache to it.
+    void setCacheSize(size_t _cacheSize);
+
+    /// Lookups of getResult, answered from memory or read from the database.
+    CacheStats getCacheStats() const;
+
 private:
 
 	bool readResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo>& _result);
 
-	logEntriesSerialize logEntriesSerialization(dev::eth::LogEntries const& _logs);
-
 	dev::eth::LogEntries logEntriesDeserialize(logEntriesSerialize const& _logs);
 
+    std::string serializeResult(std::vector<TransactionReceiptInfo> const& _result);
+
+    bool deserializeResult(std::string const& _value, std::vector<TransactionReceiptInfo>& _result);
+
+    void upgradeResult(dev::h256 const& _key, std::vector<TransactionReceiptInfo> const& _result);
+
+    static size_t resultMemoryUsage(std::vector<TransactionReceiptInfo> const& _result);
+
+    void touchReadCache(dev::h256 const& _key, std::vector<TransactionReceiptInfo> const& _result);
+
+    void eraseReadCache(dev::h256 const& _key);
+
+    void trimReadCache();
+
 	std::string path;
 
     leveldb::DB* db;
 
+    /// Memory budget shared by the committed results not yet written and the read cache
+    size_t cacheSize;
+
+    /// Results of the block being connected
 	std::unordered_map<dev::h256, std::vector<TransactionReceiptInfo>> m_cache_result;
+
+    /// Results of connected blocks waiting for flushResults
+    std::unordered_map<dev::h256, std::vector<TransactionReceiptInfo>> m_dirty_result;
+    size_t dirtyUsage = 0;
+
+    /// Results read from the database, the least recently used at the back of readOrder
+    std::list<dev::h256> readOrder;
+    std::unordered_map<dev::h256, std::pair<std::vector<TransactionReceiptInfo>, std::list<dev::h256>::iterator>> m_read_cache;
+    size_t readUsage = 0;
+
+    uint64_t cacheHits = 0;
+    uint64_t cacheMisses = 0;
+    uint64_t cacheEvictions = 0;
 };
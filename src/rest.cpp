@@ -14,9 +14,13 @@
 #include <index/txindex.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
+#include <node/headerstore.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
+#include <qtum/qtumstate.h>
+#include <qtum/qtumstatepruner.h>
 #include <rpc/blockchain.h>
+#include <rpc/contract_util.h>
 #include <rpc/mempool.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
@@ -25,11 +29,14 @@
 #include <sync.h>
 #include <txmempool.h>
 #include <util/check.h>
+#include <util/convert.h>
+#include <util/strencodings.h>
 #include <util/system.h>
 #include <validation.h>
 #include <version.h>
 
 #include <any>
+#include <optional>
 #include <string>
 
 #include <univalue.h>
@@ -39,7 +46,9 @@ using node::NodeContext;
 using node::ReadBlockFromDisk;
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const int MAX_GETUTXOS_CONCURRENT_ATTEMPTS = 3; //read the coins again if a block was connected, before taking cs_main
 static constexpr unsigned int MAX_REST_HEADERS_RESULTS = 2000;
+static constexpr int MAX_REST_LOGS_BLOCKS = 1000; //allow a max of 1000 blocks to be searched for logs at once
 
 static const struct {
     RESTResponseFormat rf;
@@ -65,6 +74,31 @@ struct CCoin {
     }
 };
 
+/** Binary encoding of a contract receipt and its log entries, for the rest receipt and logs endpoints */
+struct CReceipt {
+    const TransactionReceiptInfo& info;
+
+    explicit CReceipt(const TransactionReceiptInfo& in) : info(in) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << info.blockHash << info.blockNumber << info.transactionHash << info.transactionIndex << info.outputIndex;
+        s << h160Touint(info.from) << h160Touint(info.to) << h160Touint(info.contractAddress);
+        s << info.cumulativeGasUsed << info.gasUsed << uint32_t(info.excepted) << info.exceptedMessage;
+        s << Span<const unsigned char>{info.bloom.data(), info.bloom.size} << h256Touint(info.stateRoot) << h256Touint(info.utxoRoot);
+        WriteCompactSize(s, info.logs.size());
+        for (const dev::eth::LogEntry& log : info.logs) {
+            s << h160Touint(log.address);
+            WriteCompactSize(s, log.topics.size());
+            for (const dev::h256& topic : log.topics) {
+                s << h256Touint(topic);
+            }
+            s << log.data;
+        }
+    }
+};
+
 static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, std::string message)
 {
     req->WriteHeader("Content-Type", "text/plain");
@@ -221,6 +255,8 @@ static bool rest_headers(const std::any& context,
     const CBlockIndex* tip = nullptr;
     std::vector<const CBlockIndex*> headers;
     headers.reserve(*parsed_count);
+    // The serialized headers, read from the header store when there is one
+    DataStream ssHeader{};
     {
         ChainstateManager* maybe_chainman = GetChainman(context, req);
         if (!maybe_chainman) return false;
@@ -236,13 +272,21 @@ static bool rest_headers(const std::any& context,
             }
             pindex = active_chain.Next(pindex);
         }
+        if (g_header_store && rf != RESTResponseFormat::JSON && !headers.empty()) {
+            g_header_store->Sync(active_chain);
+            std::vector<unsigned char> stored;
+            if (g_header_store->Read(headers.front()->nHeight, headers.back()->nHeight + 1, stored, /*tx_counts=*/false)) {
+                ssHeader.write(MakeByteSpan(stored));
+            }
+        }
     }
 
     switch (rf) {
     case RESTResponseFormat::BINARY: {
-        DataStream ssHeader{};
-        for (const CBlockIndex *pindex : headers) {
-            ssHeader << pindex->GetBlockHeader();
+        if (ssHeader.empty()) {
+            for (const CBlockIndex *pindex : headers) {
+                ssHeader << pindex->GetBlockHeader();
+            }
         }
 
         std::string binaryHeader = ssHeader.str();
@@ -252,9 +296,10 @@ static bool rest_headers(const std::any& context,
     }
 
     case RESTResponseFormat::HEX: {
-        DataStream ssHeader{};
-        for (const CBlockIndex *pindex : headers) {
-            ssHeader << pindex->GetBlockHeader();
+        if (ssHeader.empty()) {
+            for (const CBlockIndex *pindex : headers) {
+                ssHeader << pindex->GetBlockHeader();
+            }
         }
 
         std::string strHex = HexStr(ssHeader) + "\n";
@@ -882,8 +927,39 @@ static bool rest_getutxos(const std::any& context, HTTPRequest* req, const std::
             CCoinsViewMemPool viewMempool(&viewChain, *mempool);
             process_utxos(viewMempool, mempool);
         } else {
-            LOCK(cs_main);
-            process_utxos(chainman.ActiveChainstate().CoinsTip(), nullptr);
+            // Read the coins cache without cs_main, which is only taken for the tip. The coins are
+            // only reported when they were all read at that tip, blocks connected meanwhile make
+            // the reads start over, and the last attempt reads them under cs_main.
+            Chainstate& chainstate = chainman.ActiveChainstate();
+            bool consistent{false};
+            for (int attempt = 0; attempt < MAX_GETUTXOS_CONCURRENT_ATTEMPTS && !consistent; ++attempt) {
+                hits.clear();
+                outs.clear();
+                std::optional<uint256> read_block;
+                consistent = true;
+                for (const COutPoint& vOutPoint : vOutPoints) {
+                    Coin coin;
+                    uint256 best_block;
+                    bool hit = chainstate.GetCoinConcurrent(vOutPoint, coin, best_block);
+                    if (read_block && *read_block != best_block) {
+                        consistent = false;
+                        break;
+                    }
+                    read_block = best_block;
+                    hits.push_back(hit);
+                    if (hit) outs.emplace_back(std::move(coin));
+                }
+                LOCK(cs_main);
+                active_height = chainman.ActiveHeight();
+                active_hash = chainman.ActiveTip()->GetBlockHash();
+                consistent = consistent && (!read_block || *read_block == active_hash);
+            }
+            if (!consistent) {
+                hits.clear();
+                outs.clear();
+                LOCK(cs_main);
+                process_utxos(chainstate.CoinsTip(), nullptr);
+            }
         }
 
         for (size_t i = 0; i < hits.size(); ++i) {
@@ -1001,6 +1077,224 @@ static bool rest_blockhash_by_height(const std::any& context, HTTPRequest* req,
     }
 }
 
+static bool WriteReceipts(HTTPRequest* req, RESTResponseFormat rf, const std::vector<TransactionReceiptInfo>& receipts)
+{
+    switch (rf) {
+    case RESTResponseFormat::BINARY:
+    case RESTResponseFormat::HEX: {
+        DataStream ssReceipts{};
+        WriteCompactSize(ssReceipts, receipts.size());
+        for (const TransactionReceiptInfo& receipt : receipts) {
+            ssReceipts << CReceipt{receipt};
+        }
+
+        if (rf == RESTResponseFormat::BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssReceipts.str());
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssReceipts) + "\n");
+        }
+        return true;
+    }
+    case RESTResponseFormat::JSON: {
+        UniValue result(UniValue::VARR);
+        for (const TransactionReceiptInfo& receipt : receipts) {
+            UniValue tri(UniValue::VOBJ);
+            transactionReceiptInfoToJSON(receipt, tri);
+            result.push_back(tri);
+        }
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, result.write() + "\n");
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+static bool rest_receipt(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string hashStr;
+    const RESTResponseFormat rf = ParseDataFormat(hashStr, strURIPart);
+
+    uint256 hash;
+    if (!ParseHashStr(hashStr, hash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
+
+    if (!fLogEvents)
+        return RESTERR(req, HTTP_NOT_FOUND, "Events indexing disabled (-logevents)");
+
+    // Transactions without contract executions have no receipts
+    const std::vector<TransactionReceiptInfo> receipts = WITH_LOCK(cs_main, return pstorageresult->getResult(uintToh256(hash)));
+    return WriteReceipts(req, rf, receipts);
+}
+
+static bool rest_logs(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RESTResponseFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path = SplitString(param, '/');
+
+    if (path.size() != 2) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/logs/<from>/<to>.<ext>?address=<address>&topic=<topic>");
+    }
+
+    int32_t fromBlock = -1, toBlock = -1;
+    if (!ParseInt32(path[0], &fromBlock) || !ParseInt32(path[1], &toBlock) || fromBlock < 0 || toBlock < fromBlock) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid block range: " + SanitizeString(param));
+    }
+    if (toBlock - fromBlock >= MAX_REST_LOGS_BLOCKS) {
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Block range too large (max: %d)", MAX_REST_LOGS_BLOCKS));
+    }
+
+    // Comma separated addresses, and topics by position where an empty topic matches any
+    std::set<dev::h160> addresses;
+    std::vector<boost::optional<dev::h256>> topics;
+    try {
+        const std::string raw_addresses = req->GetQueryParameter("address").value_or("");
+        if (!raw_addresses.empty()) {
+            for (const std::string& address : SplitString(raw_addresses, ',')) {
+                if (address.size() != 40 || !IsHex(address)) {
+                    return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + SanitizeString(address));
+                }
+                addresses.insert(dev::h160(address));
+            }
+        }
+        const std::string raw_topics = req->GetQueryParameter("topic").value_or("");
+        if (!raw_topics.empty()) {
+            for (const std::string& topic : SplitString(raw_topics, ',')) {
+                if (topic.empty()) {
+                    topics.push_back(boost::none);
+                    continue;
+                }
+                if (topic.size() != 64 || !IsHex(topic)) {
+                    return RESTERR(req, HTTP_BAD_REQUEST, "Invalid topic: " + SanitizeString(topic));
+                }
+                topics.push_back(dev::h256(topic));
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        return RESTERR(req, HTTP_BAD_REQUEST, e.what());
+    }
+
+    if (!fLogEvents)
+        return RESTERR(req, HTTP_NOT_FOUND, "Events indexing disabled (-logevents)");
+
+    ChainstateManager* maybe_chainman = GetChainman(context, req);
+    if (!maybe_chainman) return false;
+    ChainstateManager& chainman = *maybe_chainman;
+
+    std::vector<TransactionReceiptInfo> receipts;
+    {
+        LOCK(cs_main);
+        std::vector<std::vector<uint256>> hashesToBlock;
+        if (ReadLogHeightIndex(fromBlock, toBlock, 0, hashesToBlock, addresses, topics, chainman) == -1) {
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid block range: " + SanitizeString(param));
+        }
+
+        std::set<uint256> dupes;
+        for (const auto& hashesTx : hashesToBlock) {
+            for (const uint256& hash : hashesTx) {
+                if (!dupes.insert(hash).second) continue;
+                for (TransactionReceiptInfo& receipt : pstorageresult->getResult(uintToh256(hash))) {
+                    if (receipt.logs.empty() || !MatchLogTopics(receipt, topics)) continue;
+                    receipts.push_back(std::move(receipt));
+                }
+            }
+        }
+    }
+    return WriteReceipts(req, rf, receipts);
+}
+
+static bool rest_storage(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string addressStr;
+    const RESTResponseFormat rf = ParseDataFormat(addressStr, strURIPart);
+
+    if (addressStr.size() != 40 || !IsHex(addressStr))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + SanitizeString(addressStr));
+
+    std::string raw_height;
+    try {
+        raw_height = req->GetQueryParameter("height").value_or("");
+    } catch (const std::runtime_error& e) {
+        return RESTERR(req, HTTP_BAD_REQUEST, e.what());
+    }
+    int32_t height = -1;
+    if (!raw_height.empty() && (!ParseInt32(raw_height, &height) || height < 0)) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + SanitizeString(raw_height));
+    }
+
+    ChainstateManager* maybe_chainman = GetChainman(context, req);
+    if (!maybe_chainman) return false;
+    ChainstateManager& chainman = *maybe_chainman;
+
+    // The storage is read from a view of the state, without holding cs_main
+    std::unique_ptr<QtumStateView> view;
+    {
+        LOCK(cs_main);
+        const CChain& active_chain = chainman.ActiveChain();
+        if (height > active_chain.Height()) {
+            return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range");
+        }
+        const CBlockIndex* pblockindex = height == -1 ? active_chain.Tip() : active_chain[height];
+        if (g_state_pruner && pblockindex->nHeight <= active_chain.Height() - g_state_pruner->KeepBlocks()) {
+            return RESTERR(req, HTTP_NOT_FOUND, "State of the block has been pruned (-statepruning)");
+        }
+        view = std::make_unique<QtumStateView>(*globalState, uintToh256(pblockindex->hashStateRoot), uintToh256(pblockindex->hashUTXORoot));
+    }
+    std::unique_ptr<QtumState> state = view->makeState();
+
+    dev::Address addrAccount(addressStr);
+    if (!state->addressInUse(addrAccount))
+        return RESTERR(req, HTTP_NOT_FOUND, addressStr + " not found");
+
+    const auto storage(state->storage(addrAccount));
+
+    switch (rf) {
+    case RESTResponseFormat::BINARY:
+    case RESTResponseFormat::HEX: {
+        // <32 byte slot hash><32 byte slot><32 byte value> per entry, as in getstorage
+        DataStream ssStorage{};
+        WriteCompactSize(ssStorage, storage.size());
+        for (const auto& entry : storage) {
+            ssStorage << h256Touint(entry.first) << h256Touint(dev::h256(entry.second.first)) << h256Touint(dev::h256(entry.second.second));
+        }
+
+        if (rf == RESTResponseFormat::BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssStorage.str());
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssStorage) + "\n");
+        }
+        return true;
+    }
+    case RESTResponseFormat::JSON: {
+        UniValue result(UniValue::VOBJ);
+        for (const auto& entry : storage) {
+            UniValue e(UniValue::VOBJ);
+            e.pushKV(dev::toHex(dev::h256(entry.second.first)), dev::toHex(dev::h256(entry.second.second)));
+            result.pushKV(entry.first.hex(), e);
+        }
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, result.write() + "\n");
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(const std::any& context, HTTPRequest* req, const std::string& strReq);
@@ -1017,6 +1311,9 @@ static const struct {
       {"/rest/deploymentinfo/", rest_deploymentinfo},
       {"/rest/deploymentinfo", rest_deploymentinfo},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/receipt/", rest_receipt},
+      {"/rest/logs/", rest_logs},
+      {"/rest/storage/", rest_storage},
 };
 
 void StartREST(const std::any& context)
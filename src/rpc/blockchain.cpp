@@ -17,6 +17,7 @@
 #include <deploymentstatus.h>
 #include <hash.h>
 #include <index/blockfilterindex.h>
+#include <index/blockstatsindex.h>
 #include <index/coinstatsindex.h>
 #include <kernel/coinstats.h>
 #include <logging/timer.h>
@@ -24,6 +25,7 @@
 #include <net_processing.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
+#include <node/stakeestimator.h>
 #include <node/transaction.h>
 #include <node/utxo_snapshot.h>
 #include <key_io.h>
@@ -40,6 +42,7 @@
 #include <univalue.h>
 #include <util/check.h>
 #include <util/fs.h>
+#include <util/hasher.h>
 #include <util/strencodings.h>
 #include <util/system.h>
 #include <util/translation.h>
@@ -53,14 +56,21 @@
 #include <txdb.h>
 #include <util/convert.h>
 #include <qtum/qtumdelegation.h>
+#include <qtum/qtumprofiler.h>
+#include <qtum/qtumsnapshot.h>
+#include <qtum/qtumstatepruner.h>
 #include <util/tokenstr.h>
 #include <rpc/contract_util.h>
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <condition_variable>
+#include <future>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <unordered_set>
 
 using kernel::CCoinsStats;
 using kernel::CoinStatsHashType;
@@ -126,7 +136,12 @@ double GetPoWMHashPS(ChainstateManager& chainman)
 
 double GetPoSKernelPS(ChainstateManager& chainman)
 {
-    int nPoSInterval = 72;
+    // The estimator slides its window for each connected block
+    if (g_stake_estimator && g_stake_estimator->Ready()) {
+        return g_stake_estimator->NetworkWeight();
+    }
+
+    int nPoSInterval = node::StakeEstimator::STAKE_WINDOW;
     double dStakeKernelsTriedAvg = 0;
     int nStakesHandled = 0, nStakesTime = 0;
 
@@ -177,6 +192,10 @@ double GetPoSKernelPS(ChainstateManager& chainman)
 
 double GetEstimatedAnnualROI(ChainstateManager& chainman)
 {
+    if (g_stake_estimator && g_stake_estimator->Ready()) {
+        return g_stake_estimator->AnnualROI();
+    }
+
     double result = 0;
     double networkWeight = GetPoSKernelPS(chainman);
     CChain& active_chain = chainman.ActiveChain();
@@ -283,19 +302,21 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
     return result;
 }
 
-UniValue blockToJSON(BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity)
+void blockToJSON(BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity, RPCResultWriter& writer)
 {
-    UniValue result = blockheaderToJSON(tip, blockindex);
+    writer.BeginObject();
+    writer.KVs(blockheaderToJSON(tip, blockindex));
 
-    result.pushKV("strippedsize", (int)::GetSerializeSize(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
-    result.pushKV("size", (int)::GetSerializeSize(block, PROTOCOL_VERSION));
-    result.pushKV("weight", (int)::GetBlockWeight(block));
-    UniValue txs(UniValue::VARR);
+    writer.KV("strippedsize", (int)::GetSerializeSize(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
+    writer.KV("size", (int)::GetSerializeSize(block, PROTOCOL_VERSION));
+    writer.KV("weight", (int)::GetBlockWeight(block));
+    writer.Key("tx");
+    writer.BeginArray();
 
     switch (verbosity) {
         case TxVerbosity::SHOW_TXID:
             for (const CTransactionRef& tx : block.vtx) {
-                txs.push_back(tx->GetHash().GetHex());
+                writer.Value(tx->GetHash().GetHex());
             }
             break;
 
@@ -311,14 +332,20 @@ UniValue blockToJSON(BlockManager& blockman, const CBlock& block, const CBlockIn
                 const CTxUndo* txundo = (have_undo && i > 0) ? &blockUndo.vtxundo.at(i - 1) : nullptr;
                 UniValue objTx(UniValue::VOBJ);
                 TxToUniv(*tx, /*block_hash=*/uint256(), /*entry=*/objTx, /*include_hex=*/true, RPCSerializationFlags(), txundo, verbosity);
-                txs.push_back(objTx);
+                writer.Value(objTx);
             }
             break;
     }
 
-    result.pushKV("tx", txs);
+    writer.EndArray();
+    writer.EndObject();
+}
 
-    return result;
+UniValue blockToJSON(BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity)
+{
+    RPCResultWriter writer;
+    blockToJSON(blockman, block, tip, blockindex, verbosity, writer);
+    return writer.Finish();
 }
 
 static RPCHelpMan getestimatedannualroi()
@@ -410,16 +437,32 @@ static RPCHelpMan waitfornewblock()
                     HelpExampleCli("waitfornewblock", "1000")
             + HelpExampleRpc("waitfornewblock", "1000")
                 },
-        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request_) -> UniValue
 {
     int timeout = 0;
-    if (!request.params[0].isNull())
-        timeout = request.params[0].getInt<int>();
+    if (!request_.params[0].isNull())
+        timeout = request_.params[0].getInt<int>();
+
+    // this is a long poll function. force cast to non const pointer
+    JSONRPCRequest& request = (JSONRPCRequest&) request_;
+    const CUpdatedBlock start_block = WITH_LOCK(cs_blockchange, return latestblock);
+    std::optional<SteadyClock::time_point> deadline;
+    if (timeout) deadline = SteadyClock::now() + std::chrono::milliseconds{timeout};
+    if (request.PollPark([start_block](bool expired) -> std::optional<UniValue> {
+            const CUpdatedBlock block = WITH_LOCK(cs_blockchange, return latestblock);
+            if (!expired && block.height == start_block.height && block.hash == start_block.hash) return std::nullopt;
+            UniValue ret(UniValue::VOBJ);
+            ret.pushKV("hash", block.hash.GetHex());
+            ret.pushKV("height", block.height);
+            return ret;
+        }, deadline)) {
+        return NullUniValue;
+    }
 
     CUpdatedBlock block;
     {
         WAIT_LOCK(cs_blockchange, lock);
-        block = latestblock;
+        block = start_block;
         if(timeout)
             cond_blockchange.wait_for(lock, std::chrono::milliseconds(timeout), [&block]() EXCLUSIVE_LOCKS_REQUIRED(cs_blockchange) {return latestblock.height != block.height || latestblock.hash != block.hash || !IsRPCRunning(); });
         else
@@ -657,12 +700,37 @@ static RPCHelpMan getblockhash()
     };
 }
 
+/** View of the contract state after the block at height @p blocknum of the active chain, -1 or null for the tip */
+static std::unique_ptr<QtumStateView> ContractStateView(ChainstateManager& chainman, const UniValue& blocknum)
+{
+    LOCK(cs_main);
+    CChain& active_chain = chainman.ActiveChain();
+    const CBlockIndex* pblockindex = active_chain.Tip();
+    if (!blocknum.isNull())
+    {
+        if (!blocknum.isNum())
+            throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect block number");
+
+        auto blockNum = blocknum.getInt<int>();
+        if((blockNum < 0 && blockNum != -1) || blockNum > active_chain.Height())
+            throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect block number");
+
+        if(blockNum != -1)
+            pblockindex = active_chain[blockNum];
+
+        if(g_state_pruner && pblockindex->nHeight <= active_chain.Height() - g_state_pruner->KeepBlocks())
+            throw JSONRPCError(RPC_MISC_ERROR, "State of the block has been pruned (-statepruning)");
+    }
+    return std::make_unique<QtumStateView>(*globalState, uintToh256(pblockindex->hashStateRoot), uintToh256(pblockindex->hashUTXORoot));
+}
+
 static RPCHelpMan getaccountinfo()
 {
     return RPCHelpMan{"getaccountinfo",
                 "\nGet contract details including balance, storage data and code.\n",
                 {
                     {"address", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The contract address"},
+                    {"blocknum", RPCArg::Type::NUM, RPCArg::Default{-1}, "Number of block to get state from."},
                 },
                 RPCResult{
                     RPCResult::Type::OBJ, "", "",
@@ -686,27 +754,31 @@ static RPCHelpMan getaccountinfo()
                     }},
                 RPCExamples{
                     HelpExampleCli("getaccountinfo", "eb23c0b3e6042821da281a2e2364feb22dd543e3")
+            + HelpExampleCli("getaccountinfo", "eb23c0b3e6042821da281a2e2364feb22dd543e3 1000")
             + HelpExampleRpc("getaccountinfo", "eb23c0b3e6042821da281a2e2364feb22dd543e3")
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
 
-    LOCK(cs_main);
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
 
     std::string strAddr = request.params[0].get_str();
     if(strAddr.size() != 40 || !CheckHex(strAddr))
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Incorrect address");
 
+    // The account is read from a view of the state, without holding cs_main
+    std::unique_ptr<QtumState> state = ContractStateView(chainman, request.params[1])->makeState();
+
     dev::Address addrAccount(strAddr);
-    if(!globalState->addressInUse(addrAccount))
+    if(!state->addressInUse(addrAccount))
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
     
     UniValue result(UniValue::VOBJ);
 
     result.pushKV("address", strAddr);
-    result.pushKV("balance", CAmount(globalState->balance(addrAccount)));
-    std::vector<uint8_t> code(globalState->code(addrAccount));
-    auto storage(globalState->storage(addrAccount));
+    result.pushKV("balance", CAmount(state->balance(addrAccount)));
+    std::vector<uint8_t> code(state->code(addrAccount));
+    auto storage(state->storage(addrAccount));
 
     UniValue storageUV(UniValue::VOBJ);
     for (auto j: storage)
@@ -720,14 +792,14 @@ static RPCHelpMan getaccountinfo()
 
     result.pushKV("code", HexStr(code));
 
-    std::unordered_map<dev::Address, Vin> vins = globalState->vins();
-    if(vins.count(addrAccount)){
+    const Vin* accountVin = static_cast<const QtumState&>(*state).vin(addrAccount);
+    if(accountVin && accountVin->alive){
         UniValue vin(UniValue::VOBJ);
-        valtype vchHash(vins[addrAccount].hash.asBytes());
+        valtype vchHash(accountVin->hash.asBytes());
         std::reverse(vchHash.begin(), vchHash.end());
         vin.pushKV("hash", HexStr(vchHash));
-        vin.pushKV("nVout", uint64_t(vins[addrAccount].nVout));
-        vin.pushKV("value", uint64_t(vins[addrAccount].value));
+        vin.pushKV("nVout", uint64_t(accountVin->nVout));
+        vin.pushKV("value", uint64_t(accountVin->value));
         result.pushKV("vin", vin);
     }
     return result;
@@ -735,58 +807,129 @@ static RPCHelpMan getaccountinfo()
     };
 }
 
-static RPCHelpMan getstorage()
+static RPCHelpMan getcontractprofile()
 {
-    return RPCHelpMan{"getstorage",
-                "\nGet contract storage data.\n",
+    return RPCHelpMan{"getcontractprofile",
+                "\nGet the per contract statistics of the EVM executions of blocks and block templates, aggregated since startup or the last reset.\n"
+                "Requires -contractprofile.\n",
                 {
-                    {"address", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The contract address"},
-                    {"blocknum", RPCArg::Type::NUM,  RPCArg::Default{-1}, "Number of block to get state from."},
-                    {"index", RPCArg::Type::NUM, RPCArg::Optional::OMITTED, "Zero-based index position of the storage"},
+                    {"count", RPCArg::Type::NUM, RPCArg::Default{0}, "Return only the contracts that used the most gas (0 = all)"},
+                    {"reset", RPCArg::Type::BOOL, RPCArg::Default{false}, "Reset the statistics after they are returned"},
                 },
                 RPCResult{
-                    RPCResult::Type::OBJ_DYN, "", "The storage data of the contract",
+                    RPCResult::Type::ARR, "", "The contracts, by gas used",
                     {
-                        {RPCResult::Type::OBJ_DYN, "data", "The storage data entry",
+                        {RPCResult::Type::OBJ, "", "",
                         {
-                            {RPCResult::Type::STR_HEX, "hex", "The hex data"},
+                            {RPCResult::Type::STR_HEX, "address", "The contract address"},
+                            {RPCResult::Type::NUM, "calls", "Transactions that called or created the contract"},
+                            {RPCResult::Type::NUM, "gasused", "Gas used by those transactions"},
+                            {RPCResult::Type::NUM, "sload", "Storage reads of the contract code"},
+                            {RPCResult::Type::NUM, "sstore", "Storage writes of the contract code"},
+                            {RPCResult::Type::NUM, "precompilecalls", "Precompiles called by the contract code"},
+                            {RPCResult::Type::NUM, "precompiletime", "Time spent in those precompiles, in microseconds"},
+                            {RPCResult::Type::NUM, "walltime", "Time spent executing the transactions, in microseconds"},
                         }},
                     }
                 },
+                RPCExamples{
+                    HelpExampleCli("getcontractprofile", "10")
+            + HelpExampleRpc("getcontractprofile", "10, true")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    if (!g_contract_profiler.IsEnabled())
+        throw JSONRPCError(RPC_MISC_ERROR, "Contract profiling is disabled (-contractprofile)");
+
+    int count = request.params[0].isNull() ? 0 : request.params[0].getInt<int>();
+    if (count < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
+
+    std::map<dev::Address, ContractProfile> profiles = g_contract_profiler.GetProfiles();
+    if (!request.params[1].isNull() && request.params[1].get_bool())
+        g_contract_profiler.Reset();
+
+    std::vector<std::pair<dev::Address, ContractProfile>> sorted(profiles.begin(), profiles.end());
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.second.gas_used > b.second.gas_used;
+    });
+    if (count > 0 && sorted.size() > (size_t)count)
+        sorted.resize(count);
+
+    UniValue result(UniValue::VARR);
+    for (const auto& [address, profile] : sorted) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("address", address.hex());
+        entry.pushKV("calls", profile.calls);
+        entry.pushKV("gasused", profile.gas_used);
+        entry.pushKV("sload", profile.sloads);
+        entry.pushKV("sstore", profile.sstores);
+        entry.pushKV("precompilecalls", profile.precompile_calls);
+        entry.pushKV("precompiletime", (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(profile.precompile_time).count());
+        entry.pushKV("walltime", (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(profile.wall_time).count());
+        result.push_back(entry);
+    }
+    return result;
+},
+    };
+}
+
+static RPCHelpMan getstorage()
+{
+    return RPCHelpMan{"getstorage",
+                "\nGet contract storage data.\n"
+                "The slots are ordered by their hashed keys. With start or limit, one page of them is returned with\n"
+                "the hashed key to start the next page from, without reading the rest of the storage.\n",
+                {
+                    {"address", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The contract address"},
+                    {"blocknum", RPCArg::Type::NUM,  RPCArg::Default{-1}, "Number of block to get state from."},
+                    {"index", RPCArg::Type::NUM, RPCArg::Optional::OMITTED, "Zero-based index position of the storage, from start"},
+                    {"start", RPCArg::Type::STR_HEX, RPCArg::Optional::OMITTED, "The hashed key to start from, the \"next\" value of the previous page"},
+                    {"limit", RPCArg::Type::NUM, RPCArg::DefaultHint{strprintf("%u with start, otherwise all", DEFAULT_STORAGE_PAGE_SIZE)}, strprintf("The maximum number of slots of the page, at most %u", MAX_STORAGE_PAGE_SIZE)},
+                },
+                {
+                    RPCResult{"without start and limit",
+                        RPCResult::Type::OBJ_DYN, "", "The storage data of the contract",
+                        {
+                            {RPCResult::Type::OBJ_DYN, "data", "The storage data entry",
+                            {
+                                {RPCResult::Type::STR_HEX, "hex", "The hex data"},
+                            }},
+                        }
+                    },
+                    RPCResult{"with start or limit",
+                        RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::OBJ_DYN, "storage", "The storage data of the page, as above",
+                            {
+                                {RPCResult::Type::OBJ_DYN, "data", "The storage data entry",
+                                {
+                                    {RPCResult::Type::STR_HEX, "hex", "The hex data"},
+                                }},
+                            }},
+                            {RPCResult::Type::STR_HEX, "next", /*optional=*/true, "The hashed key the next page starts from, omitted after the last page"},
+                        }
+                    },
+                },
                 RPCExamples{
                     HelpExampleCli("getstorage", "eb23c0b3e6042821da281a2e2364feb22dd543e3")
+            + HelpExampleCli("getstorage", "eb23c0b3e6042821da281a2e2364feb22dd543e3 -1 null \"\" 100")
             + HelpExampleRpc("getstorage", "eb23c0b3e6042821da281a2e2364feb22dd543e3")
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
 
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
-    LOCK(cs_main);
 
-    CChain& active_chain = chainman.ActiveChain();
     std::string strAddr = request.params[0].get_str();
     if(strAddr.size() != 40 || !CheckHex(strAddr))
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Incorrect address"); 
 
-    TemporaryState ts(globalState);
-    if (!request.params[1].isNull())
-    {
-        if (request.params[1].isNum())
-        {
-            auto blockNum = request.params[1].getInt<int>();
-            if((blockNum < 0 && blockNum != -1) || blockNum > active_chain.Height())
-                throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect block number");
-
-            if(blockNum != -1)
-                ts.SetRoot(uintToh256(active_chain[blockNum]->hashStateRoot), uintToh256(active_chain[blockNum]->hashUTXORoot));
-                
-        } else {
-            throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect block number");
-        }
-    }
+    // The storage is read from a view of the state, without holding cs_main
+    std::unique_ptr<QtumState> state = ContractStateView(chainman, request.params[1])->makeState();
 
     dev::Address addrAccount(strAddr);
-    if(!globalState->addressInUse(addrAccount))
+    if(!state->addressInUse(addrAccount))
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
     
     UniValue result(UniValue::VOBJ);
@@ -796,7 +939,24 @@ static RPCHelpMan getstorage()
     if (onlyIndex)
         index = request.params[2].getInt<int>();
 
-    auto storage(globalState->storage(addrAccount));
+    const bool paged = !request.params[3].isNull() || !request.params[4].isNull();
+    dev::h256 start;
+    if (!request.params[3].isNull() && !request.params[3].get_str().empty()) {
+        const std::string& strStart = request.params[3].get_str();
+        if (strStart.size() != 64 || !CheckHex(strStart))
+            throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect start, expected a hashed key of 64 hex characters");
+        start = dev::h256(strStart);
+    }
+    size_t limit = paged ? DEFAULT_STORAGE_PAGE_SIZE : std::numeric_limits<size_t>::max();
+    if (!request.params[4].isNull()) {
+        const int64_t requested = request.params[4].getInt<int64_t>();
+        if (requested <= 0 || requested > MAX_STORAGE_PAGE_SIZE)
+            throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("Limit must be between 1 and %u", MAX_STORAGE_PAGE_SIZE));
+        limit = requested;
+    }
+
+    // Only the slots up to the index are read
+    auto [storage, next] = state->storage(addrAccount, start, onlyIndex ? std::min<size_t>(limit, size_t{index} + 1) : limit);
 
     if (onlyIndex)
     {
@@ -807,17 +967,22 @@ static RPCHelpMan getstorage()
             throw JSONRPCError(RPC_INVALID_PARAMS, stringStream.str());
         }
         auto elem = std::next(storage.begin(), index);
-        UniValue e(UniValue::VOBJ);
-
         storage = {{elem->first, {elem->second.first, elem->second.second}}};
-    } 
+    }
     for (const auto& j: storage)
     {
         UniValue e(UniValue::VOBJ);
         e.pushKV(dev::toHex(dev::h256(j.second.first)), dev::toHex(dev::h256(j.second.second)));
         result.pushKV(j.first.hex(), e);
     }
-    return result;
+    if (!paged)
+        return result;
+
+    UniValue page(UniValue::VOBJ);
+    page.pushKV("storage", result);
+    if (!onlyIndex && next)
+        page.pushKV("next", next.hex());
+    return page;
 },
     };
 }
@@ -1089,7 +1254,9 @@ static RPCHelpMan getblock()
         tx_verbosity = TxVerbosity::SHOW_DETAILS_AND_PREVOUT;
     }
 
-    return blockToJSON(chainman.m_blockman, block, tip, pblockindex, tx_verbosity);
+    RPCResultWriter writer{request};
+    blockToJSON(chainman.m_blockman, block, tip, pblockindex, tx_verbosity, writer);
+    return writer.Finish();
 },
     };
 }
@@ -1157,6 +1324,121 @@ RPCHelpMan callcontract()
     };
 }
 
+RPCHelpMan callcontractbatch()
+{
+    return RPCHelpMan{"callcontractbatch",
+                "\nExecute several contract calls offline against the same chain state.\n"
+                "Equivalent to calling callcontract for each entry, but the block and consensus parameters are only "
+                "prepared once and the calls are executed in parallel when -parcontracts is enabled.\n",
+                {
+                    {"calls", RPCArg::Type::ARR, RPCArg::Optional::NO, "The contract calls, at most " + ToString(MAX_CALLCONTRACT_BATCH),
+                        {
+                            {"", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "",
+                                {
+                                    {"address", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The contract address, or empty address \"\""},
+                                    {"data", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The data hex string"},
+                                    {"senderaddress", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "The sender address string"},
+                                    {"gaslimit", RPCArg::Type::NUM, RPCArg::Optional::OMITTED, "The gas limit for executing the contract."},
+                                    {"amount", RPCArg::Type::AMOUNT, RPCArg::Optional::OMITTED, "The amount in " + CURRENCY_UNIT + " to send. eg 0.1, default: 0"},
+                                },
+                            },
+                        },
+                    },
+                },
+                RPCResult{
+                    RPCResult::Type::ARR, "", "The results in the order of the calls, as returned by callcontract",
+                    {
+                        {RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::STR, "address", "The address of the contract"},
+                            {RPCResult::Type::OBJ, "executionResult", "The method execution result",
+                                {
+                                    {RPCResult::Type::NUM, "gasUsed", "The gas used"},
+                                    {RPCResult::Type::STR, "excepted", "The thrown exception"},
+                                    {RPCResult::Type::STR_HEX, "newAddress", "The new address of the contract"},
+                                    {RPCResult::Type::STR_HEX, "output", "The returned data from the method"},
+                                    {RPCResult::Type::NUM, "codeDeposit", "The code deposit"},
+                                    {RPCResult::Type::NUM, "gasRefunded", "The gas refunded"},
+                                    {RPCResult::Type::NUM, "depositSize", "The deposit size"},
+                                    {RPCResult::Type::NUM, "gasForDeposit", "The gas for deposit"},
+                                    {RPCResult::Type::STR, "exceptedMessage", "The thrown exception message"},
+                                }},
+                            {RPCResult::Type::OBJ, "transactionReceipt", "The transaction receipt",
+                                {
+                                    {RPCResult::Type::STR_HEX, "stateRoot", "The state root hash"},
+                                    {RPCResult::Type::STR_HEX, "utxoRoot", "The utxo root hash"},
+                                    {RPCResult::Type::NUM, "gasUsed", "The gas used"},
+                                    {RPCResult::Type::STR_HEX, "bloom", "The bloom"},
+                                    {RPCResult::Type::ARR, "log", "The logs from the receipt",
+                                        {
+                                            {RPCResult::Type::OBJ, "", "",
+                                                {
+                                                    {RPCResult::Type::STR_HEX, "address", "The contract address"},
+                                                    {RPCResult::Type::ARR, "topics", "The topic",
+                                                        {{RPCResult::Type::STR_HEX, "topic", "The topic"}}},
+                                                    {RPCResult::Type::STR_HEX, "data", "The logged data"},
+                                                }
+                                            }
+                                        }
+                                    },
+                                }},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("callcontractbatch", "\"[{\\\"address\\\":\\\"eb23c0b3e6042821da281a2e2364feb22dd543e3\\\",\\\"data\\\":\\\"06fdde03\\\"},{\\\"address\\\":\\\"eb23c0b3e6042821da281a2e2364feb22dd543e3\\\",\\\"data\\\":\\\"95d89b41\\\"}]\"")
+            + HelpExampleRpc("callcontractbatch", "[{\"address\":\"eb23c0b3e6042821da281a2e2364feb22dd543e3\",\"data\":\"06fdde03\"},{\"address\":\"eb23c0b3e6042821da281a2e2364feb22dd543e3\",\"data\":\"95d89b41\"}]")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    return CallToContracts(request.params, chainman);
+},
+    };
+}
+
+RPCHelpMan estimategas()
+{
+    return RPCHelpMan{"estimategas",
+                "\nEstimate the lowest gas limit with which a contract call or deployment succeeds, as executed offline by callcontract.\n"
+                "The limit is found by binary search over executions on the same copy of the chain state, and is cached until the next block.\n",
+                {
+                    {"address", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The contract address, or empty address \"\""},
+                    {"data", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The data hex string"},
+                    {"senderaddress", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "The sender address string"},
+                    {"gaslimit", RPCArg::Type::NUM, RPCArg::DefaultHint{"the block gas limit"}, "The highest gas limit to search."},
+                    {"amount", RPCArg::Type::AMOUNT, RPCArg::Optional::OMITTED, "The amount in " + CURRENCY_UNIT + " to send. eg 0.1, default: 0"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::STR, "address", "The address of the contract"},
+                        {RPCResult::Type::NUM, "gasLimit", "The lowest gas limit with which the call succeeds"},
+                        {RPCResult::Type::OBJ, "executionResult", "The execution result with the highest gas limit, as returned by callcontract",
+                            {
+                                {RPCResult::Type::NUM, "gasUsed", "The gas used"},
+                                {RPCResult::Type::STR, "excepted", "The thrown exception"},
+                                {RPCResult::Type::STR_HEX, "newAddress", "The new address of the contract"},
+                                {RPCResult::Type::STR_HEX, "output", "The returned data from the method"},
+                                {RPCResult::Type::NUM, "codeDeposit", "The code deposit"},
+                                {RPCResult::Type::NUM, "gasRefunded", "The gas refunded"},
+                                {RPCResult::Type::NUM, "depositSize", "The deposit size"},
+                                {RPCResult::Type::NUM, "gasForDeposit", "The gas for deposit"},
+                                {RPCResult::Type::STR, "exceptedMessage", "The thrown exception message"},
+                            }},
+                        {RPCResult::Type::BOOL, "cached", "Whether the estimate was computed earlier for the same block"},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("estimategas", "eb23c0b3e6042821da281a2e2364feb22dd543e3 06fdde03")
+            + HelpExampleRpc("estimategas", "eb23c0b3e6042821da281a2e2364feb22dd543e3 06fdde03")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    return EstimateContractGas(request.params, chainman);
+},
+    };
+}
+
 class WaitForLogsParams {
 public:
     int fromBlock;
@@ -1190,6 +1472,99 @@ private:
     }
 };
 
+/**
+ * Read the log entries waitforlogs returns, std::nullopt while there are none yet.
+ */
+static std::optional<UniValue> ReadWaitForLogs(const WaitForLogsParams& params, ChainstateManager& chainman)
+{
+    std::vector<std::vector<uint256>> hashesToBlock;
+
+    auto& addresses = params.addresses;
+    auto& filterTopics = params.topics;
+
+    LOCK(cs_main);
+
+    int curheight = ReadLogHeightIndex(params.fromBlock, params.toBlock, params.minconf,
+            hashesToBlock, addresses, filterTopics, chainman);
+
+    // if curheight >= fromBlock. Blockchain extended with new log entries. Return next block height to client.
+    //    nextBlock = curheight + 1
+    // if curheight == 0. No log entry found in index. Wait for new block then try again.
+    //    nextBlock = fromBlock
+    // if curheight == -1. Incorrect parameters has entered.
+    //
+    // if curheight advanced, but all filtered out, API should return empty array, but advancing the cursor anyway.
+
+    if (curheight == -1) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Incorrect params");
+    }
+
+    if (curheight == 0) {
+        return std::nullopt;
+    }
+
+    UniValue jsonLogs(UniValue::VARR);
+
+    std::set<uint256> dupes;
+
+    for (const auto& txHashes : hashesToBlock) {
+        for (const auto& txHash : txHashes) {
+
+            if(dupes.find(txHash) != dupes.end()) {
+                continue;
+            }
+            dupes.insert(txHash);
+
+            std::vector<TransactionReceiptInfo> receipts = pstorageresult->getResult(
+                    uintToh256(txHash));
+
+            for (const auto& receipt : receipts) {
+                for (const auto& log : receipt.logs) {
+
+                    bool includeLog = true;
+
+                    if (!filterTopics.empty()) {
+                        for (size_t i = 0; i < filterTopics.size(); i++) {
+                            auto filterTopic = filterTopics[i];
+
+                            if (!filterTopic) {
+                                continue;
+                            }
+
+                            auto filterTopicContent = filterTopic.get();
+                            auto topicContent = log.topics[i];
+
+                            if (topicContent != filterTopicContent) {
+                                includeLog = false;
+                                break;
+                            }
+                        }
+                    }
+
+
+                    if (!includeLog) {
+                        continue;
+                    }
+
+                    UniValue jsonLog(UniValue::VOBJ);
+
+                    assignJSON(jsonLog, receipt);
+                    assignJSON(jsonLog, log, false);
+
+                    jsonLogs.push_back(jsonLog);
+                }
+            }
+        }
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("entries", jsonLogs);
+    result.pushKV("count", (int) jsonLogs.size());
+    result.pushKV("nextblock", curheight + 1);
+
+    return result;
+}
+
 RPCHelpMan waitforlogs()
 {
     return RPCHelpMan{"waitforlogs",
@@ -1271,120 +1646,44 @@ RPCHelpMan waitforlogs()
 
     request.PollStart();
 
-    std::vector<std::vector<uint256>> hashesToBlock;
-
-    int curheight = 0;
-
-    auto& addresses = params.addresses;
-    auto& filterTopics = params.topics;
-
-    while (curheight == 0) {
-        {
-            LOCK(cs_main);
-            curheight = chainman.m_blockman.m_block_tree_db->ReadHeightIndex(params.fromBlock, params.toBlock, params.minconf,
-                    hashesToBlock, addresses, chainman);
-        }
-
-        // if curheight >= fromBlock. Blockchain extended with new log entries. Return next block height to client.
-        //    nextBlock = curheight + 1
-        // if curheight == 0. No log entry found in index. Wait for new block then try again.
-        //    nextBlock = fromBlock
-        // if curheight == -1. Incorrect parameters has entered.
-        //
-        // if curheight advanced, but all filtered out, API should return empty array, but advancing the cursor anyway.
-
-        if (curheight > 0) {
-            break;
-        }
+    if (auto result = ReadWaitForLogs(params, chainman)) {
+        return *result;
+    }
 
-        if (curheight == -1) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Incorrect params");
-        }
+    // park the call until a new block arrives, instead of holding this thread
+    if (request.PollPark([params, &chainman](bool expired) -> std::optional<UniValue> {
+            if (expired) {
+                LogPrintf("waitforlogs client disconnected\n");
+                return NullUniValue;
+            }
+            return ReadWaitForLogs(params, chainman);
+        })) {
+        return NullUniValue;
+    }
 
-        // wait for a new block to arrive
+    // wait for a new block to arrive
+    while (true) {
         {
-            while (true) {
-                std::unique_lock<std::mutex> lock(cs_blockchange);
-                auto blockHeight = latestblock.height;
+            std::unique_lock<std::mutex> lock(cs_blockchange);
+            auto blockHeight = latestblock.height;
 
-                request.PollPing();
-
-                cond_blockchange.wait_for(lock, std::chrono::milliseconds(1000));
-                if (latestblock.height > blockHeight) {
-                    break;
-                }
+            request.PollPing();
 
+            cond_blockchange.wait_for(lock, std::chrono::milliseconds(1000));
+            if (latestblock.height <= blockHeight) {
                 // TODO: maybe just merge `IsRPCRunning` this into PollAlive
                 if (!request.PollAlive() || !IsRPCRunning()) {
                     LogPrintf("waitforlogs client disconnected\n");
                     return NullUniValue;
                 }
-            }
-        }
-    }
-
-    LOCK(cs_main);
-
-    UniValue jsonLogs(UniValue::VARR);
-
-    std::set<uint256> dupes;
-
-    for (const auto& txHashes : hashesToBlock) {
-        for (const auto& txHash : txHashes) {
-
-            if(dupes.find(txHash) != dupes.end()) {
                 continue;
             }
-            dupes.insert(txHash);
-
-            std::vector<TransactionReceiptInfo> receipts = pstorageresult->getResult(
-                    uintToh256(txHash));
-
-            for (const auto& receipt : receipts) {
-                for (const auto& log : receipt.logs) {
-
-                    bool includeLog = true;
-
-                    if (!filterTopics.empty()) {
-                        for (size_t i = 0; i < filterTopics.size(); i++) {
-                            auto filterTopic = filterTopics[i];
-
-                            if (!filterTopic) {
-                                continue;
-                            }
-
-                            auto filterTopicContent = filterTopic.get();
-                            auto topicContent = log.topics[i];
-
-                            if (topicContent != filterTopicContent) {
-                                includeLog = false;
-                                break;
-                            }
-                        }
-                    }
-
-
-                    if (!includeLog) {
-                        continue;
-                    }
-
-                    UniValue jsonLog(UniValue::VOBJ);
-
-                    assignJSON(jsonLog, receipt);
-                    assignJSON(jsonLog, log, false);
+        }
 
-                    jsonLogs.push_back(jsonLog);
-                }
-            }
+        if (auto result = ReadWaitForLogs(params, chainman)) {
+            return *result;
         }
     }
-
-    UniValue result(UniValue::VOBJ);
-    result.pushKV("entries", jsonLogs);
-    result.pushKV("count", (int) jsonLogs.size());
-    result.pushKV("nextblock", curheight + 1);
-
-    return result;
 },
     };
 }
@@ -1444,18 +1743,101 @@ RPCHelpMan searchlogs()
                                             {RPCResult::Type::STR_HEX, "data", "The logged data"},
                                         }
                                     }
-                                }
-                            },
-                        }}
+                                }
+                            },
+                        }}
+                }},
+                RPCExamples{
+                    HelpExampleCli("searchlogs", "0 100 '{\"addresses\": [\"12ae42729af478ca92c8c66773a3e32115717be4\"]}' '{\"topics\": [null,\"b436c2bf863ccd7b8f63171201efd4792066b4ce8e543dde9c3e9e9ab98e216c\"]}'")
+            + HelpExampleRpc("searchlogs", "0 100 '{\"addresses\": [\"12ae42729af478ca92c8c66773a3e32115717be4\"]} {\"topics\": [null,\"b436c2bf863ccd7b8f63171201efd4792066b4ce8e543dde9c3e9e9ab98e216c\"]}'")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    RPCResultWriter writer{request};
+    SearchLogs(request.params, chainman, writer);
+    return writer.Finish();
+},
+    };
+}
+
+RPCHelpMan searchlogspage()
+{
+    return RPCHelpMan{"searchlogspage",
+                "\nSearch logs one page at a time, requires -logevents to be enabled.\n"
+                "Returns at most limit receipts, ordered by block, transaction and output, with a cursor to get the next page.\n",
+                {
+                    {"fromblock", RPCArg::Type::NUM, RPCArg::Optional::NO, "The number of the earliest block (latest may be given to mean the most recent block)."},
+                    {"toblock", RPCArg::Type::NUM, RPCArg::Optional::NO, "The number of the latest block (-1 may be given to mean the most recent block)."},
+                    {"addressfilter", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "Addresses filter conditions for logs.",
+                    {
+                        {"addresses", RPCArg::Type::ARR, RPCArg::Optional::OMITTED, "An address or a list of addresses to only get logs from particular account(s).",
+                            {
+                                {"address", RPCArg::Type::STR_HEX, RPCArg::Optional::OMITTED, ""},
+                            },
+                        },
+                    }},
+                    {"topicfilter", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "Topics filter conditions for logs.",
+                    {
+                        {"topics", RPCArg::Type::ARR, RPCArg::Optional::OMITTED, "An array of values from which at least one must appear in the log entries. The order is important, if you want to leave topics out use null, e.g. [null, \"0x00...\"].",
+                            {
+                                {"topic", RPCArg::Type::STR_HEX, RPCArg::Optional::OMITTED, ""},
+                            },
+                        },
+                    }},
+                    {"minconf", RPCArg::Type::NUM, RPCArg::Default{0}, "Minimal number of confirmations before a log is returned"},
+                    {"options", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "Paging options",
+                    {
+                        {"limit", RPCArg::Type::NUM, RPCArg::Default{(int)DEFAULT_SEARCHLOGS_PAGE_SIZE}, "The maximum number of receipts to return, at most " + ToString(MAX_SEARCHLOGS_PAGE_SIZE)},
+                        {"cursor", RPCArg::Type::STR_HEX, RPCArg::Optional::OMITTED, "The cursor returned by the previous page, to continue the search from"},
+                    }},
+                },
+                RPCResult{
+            RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::ARR, "receipts", "The matching receipts, same as searchlogs",
+                        {
+                        {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::STR_HEX, "blockHash", "The block hash"},
+                                {RPCResult::Type::NUM, "blockNumber", "The block number"},
+                                {RPCResult::Type::STR_HEX, "transactionHash", "The transaction hash"},
+                                {RPCResult::Type::NUM, "transactionIndex", "The transaction index"},
+                                {RPCResult::Type::NUM, "outputIndex", "The output index"},
+                                {RPCResult::Type::STR_HEX, "from", "The from address"},
+                                {RPCResult::Type::STR_HEX, "to", "The to address"},
+                                {RPCResult::Type::NUM, "cumulativeGasUsed", "The cumulative gas used"},
+                                {RPCResult::Type::NUM, "gasUsed", "The gas used"},
+                                {RPCResult::Type::STR_HEX, "contractAddress", "The contract address"},
+                                {RPCResult::Type::STR, "excepted", "The thrown exception"},
+                                {RPCResult::Type::STR, "exceptedMessage", "The thrown exception message"},
+                                {RPCResult::Type::STR_HEX, "bloom", "Bloom filter for light clients to quickly retrieve related logs"},
+                                {RPCResult::Type::STR_HEX, "stateRoot", "The hash state root"},
+                                {RPCResult::Type::STR_HEX, "utxoRoot", "The hash UTXO root"},
+                                {RPCResult::Type::ARR, "log", "The logs from the receipt",
+                                    {
+                                        {RPCResult::Type::OBJ, "", "",
+                                            {
+                                                {RPCResult::Type::STR_HEX, "address", "The contract address"},
+                                                {RPCResult::Type::ARR, "topics", "The topic",
+                                                    {{RPCResult::Type::STR_HEX, "topic", "The topic"}}},
+                                                {RPCResult::Type::STR_HEX, "data", "The logged data"},
+                                            }
+                                        }
+                                    }
+                                },
+                            }}
+                    }},
+                    {RPCResult::Type::STR_HEX, "cursor", /*optional=*/true, "The cursor to pass to get the next page, omitted when the search is complete"},
                 }},
                 RPCExamples{
-                    HelpExampleCli("searchlogs", "0 100 '{\"addresses\": [\"12ae42729af478ca92c8c66773a3e32115717be4\"]}' '{\"topics\": [null,\"b436c2bf863ccd7b8f63171201efd4792066b4ce8e543dde9c3e9e9ab98e216c\"]}'")
-            + HelpExampleRpc("searchlogs", "0 100 '{\"addresses\": [\"12ae42729af478ca92c8c66773a3e32115717be4\"]} {\"topics\": [null,\"b436c2bf863ccd7b8f63171201efd4792066b4ce8e543dde9c3e9e9ab98e216c\"]}'")
+                    HelpExampleCli("searchlogspage", "0 100000 '{\"addresses\": [\"12ae42729af478ca92c8c66773a3e32115717be4\"]}' null 0 '{\"limit\": 1000}'")
+            + HelpExampleRpc("searchlogspage", "0, 100000, {\"addresses\": [\"12ae42729af478ca92c8c66773a3e32115717be4\"]}, null, 0, {\"limit\": 1000}")
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
-    return SearchLogs(request.params, chainman);
+    return SearchLogsPage(request.params, chainman);
 },
     };
 }
@@ -1715,7 +2097,9 @@ RPCHelpMan getdelegationsforstaker()
 RPCHelpMan listcontracts()
 {
     return RPCHelpMan{"listcontracts",
-                "\nGet the contracts list.\n",
+                "\nGet the contracts list.\n"
+                "With -logevents the contracts are listed in the order they were created,\n"
+                "otherwise every account of the state is listed in no particular order.\n",
                 {
                     {"start", RPCArg::Type::NUM, RPCArg::Default{1}, "The starting account index"},
                     {"maxdisplay", RPCArg::Type::NUM, RPCArg::Default{20}, "Max accounts to list"},
@@ -1748,7 +2132,37 @@ RPCHelpMan listcontracts()
 			throw JSONRPCError(RPC_TYPE_ERROR, "Invalid maxDisplay");
 	}
 
-	UniValue result(UniValue::VOBJ);
+	RPCResultWriter writer{request};
+
+	// Page through the contract index when it is kept, instead of walking the whole state trie
+	ChainstateManager& chainman = EnsureAnyChainman(request.context);
+	unsigned int indexCount = 0;
+	if (fLogEvents && chainman.m_blockman.m_qtum_index_db->ReadContractCount(indexCount))
+	{
+		if (indexCount>0 && (unsigned int)start > indexCount)
+			throw JSONRPCError(RPC_TYPE_ERROR, "start greater than max index "+ i64tostr(indexCount));
+
+		writer.BeginObject();
+
+		// Skip the contracts that have been destroyed since
+		int i=0;
+		for (unsigned int position = start-1; position < indexCount && i < maxDisplay; )
+		{
+			std::vector<CContractIndexEntry> contracts;
+			if (!chainman.m_blockman.m_qtum_index_db->ReadContractIndex(position, maxDisplay-i, contracts) || contracts.empty())
+				throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the contract index");
+			position += contracts.size();
+			for (const CContractIndexEntry& contract : contracts)
+			{
+				if (!globalState->addressInUse(contract.address)) continue;
+				writer.KV(contract.address.hex(),ValueFromAmount(CAmount(globalState->balance(contract.address))));
+				i++;
+			}
+		}
+
+		writer.EndObject();
+		return writer.Finish();
+	}
 
 	auto map = globalState->addresses();
 	int contractsCount=(int)map.size();
@@ -1756,16 +2170,19 @@ RPCHelpMan listcontracts()
 	if (contractsCount>0 && start > contractsCount)
 		throw JSONRPCError(RPC_TYPE_ERROR, "start greater than max index "+ i64tostr(contractsCount));
 
+	writer.BeginObject();
+
 	int itStartPos=std::min(start-1,contractsCount);
 	int i=0;
 	for (auto it = std::next(map.begin(),itStartPos); it!=map.end(); it++)
 	{
-		result.pushKV(it->first.hex(),ValueFromAmount(CAmount(globalState->balance(it->first))));
+		writer.KV(it->first.hex(),ValueFromAmount(CAmount(globalState->balance(it->first))));
 		i++;
 		if(i==maxDisplay)break;
 	}
 
-	return result;
+	writer.EndObject();
+	return writer.Finish();
 },
     };
 }
@@ -2066,7 +2483,6 @@ static RPCHelpMan gettxout()
 {
     NodeContext& node = EnsureAnyNodeContext(request.context);
     ChainstateManager& chainman = EnsureChainman(node);
-    LOCK(cs_main);
 
     UniValue ret(UniValue::VOBJ);
 
@@ -2077,23 +2493,27 @@ static RPCHelpMan gettxout()
         fMempool = request.params[2].get_bool();
 
     Coin coin;
+    uint256 best_block;
     Chainstate& active_chainstate = chainman.ActiveChainstate();
-    CCoinsViewCache* coins_view = &active_chainstate.CoinsTip();
 
     if (fMempool) {
+        LOCK(cs_main);
+        CCoinsViewCache* coins_view = &active_chainstate.CoinsTip();
         const CTxMemPool& mempool = EnsureMemPool(node);
         LOCK(mempool.cs);
         CCoinsViewMemPool view(coins_view, mempool);
         if (!view.GetCoin(out, coin) || mempool.isSpent(out)) {
             return UniValue::VNULL;
         }
+        best_block = coins_view->GetBestBlock();
     } else {
-        if (!coins_view->GetCoin(out, coin)) {
+        // Only the coins cache is read, so this does not wait for cs_main while blocks are connected
+        if (!active_chainstate.GetCoinConcurrent(out, coin, best_block)) {
             return UniValue::VNULL;
         }
     }
 
-    const CBlockIndex* pindex = active_chainstate.m_blockman.LookupBlockIndex(coins_view->GetBestBlock());
+    const CBlockIndex* pindex = WITH_LOCK(cs_main, return active_chainstate.m_blockman.LookupBlockIndex(best_block));
     ret.pushKV("bestblock", pindex->GetBlockHash().GetHex());
     if (coin.nHeight == MEMPOOL_HEIGHT) {
         ret.pushKV("confirmations", 0);
@@ -2740,22 +3160,126 @@ void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES],
     }
 }
 
-template<typename T>
-static inline bool SetHasKeys(const std::set<T>& set) {return false;}
-template<typename T, typename Tk, typename... Args>
-static inline bool SetHasKeys(const std::set<T>& set, const Tk& key, const Args&... args)
-{
-    return (set.count(key) != 0) || SetHasKeys(set, args...);
-}
-
 // outpoint (needed for the utxo index) + nHeight + fCoinBase
 static constexpr size_t PER_UTXO_OVERHEAD = sizeof(COutPoint) + sizeof(uint32_t) + sizeof(bool);
 
+BlockStatistics ComputeBlockStatistics(const CBlock& block, const CBlockUndo& blockUndo, const CBlockIndex& pindex)
+{
+    BlockStatistics stats;
+    CAmount minfee = MAX_MONEY;
+    CAmount minfeerate = MAX_MONEY;
+    int64_t mintxsize = std::numeric_limits<int64_t>::max();
+    int64_t utxos = 0;
+    std::vector<CAmount> fee_array;
+    std::vector<std::pair<CAmount, int64_t>> feerate_array;
+    std::vector<int64_t> txsize_array;
+
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const auto& tx = block.vtx.at(i);
+        stats.outs += tx->vout.size();
+
+        if (tx->HasCreateOrCall()) {
+            ++stats.contract_txs;
+            if (tx->HasOpCreate()) ++stats.contract_creates;
+            if (tx->HasOpCall()) ++stats.contract_calls;
+        }
+
+        CAmount tx_total_out = 0;
+        for (const CTxOut& out : tx->vout) {
+            tx_total_out += out.nValue;
+
+            size_t out_size = GetSerializeSize(out, PROTOCOL_VERSION) + PER_UTXO_OVERHEAD;
+            stats.utxo_size_inc += out_size;
+
+            // The Genesis block and the repeated BIP30 block coinbases don't change the UTXO
+            // set counts, so they have to be excluded from the statistics
+            if (pindex.nHeight == 0 || (IsBIP30Repeat(pindex) && tx->IsCoinBase())) continue;
+            // Skip unspendable outputs since they are not included in the UTXO set
+            if (out.scriptPubKey.IsUnspendable()) continue;
+
+            ++utxos;
+            stats.utxo_size_inc_actual += out_size;
+        }
+
+        if (tx->IsCoinBase() || tx->IsCoinStake()) {
+            continue;
+        }
+
+        stats.ins += tx->vin.size(); // Don't count coinbase's fake input
+        stats.total_out += tx_total_out; // Don't count coinbase reward
+
+        const int64_t tx_size = tx->GetTotalSize();
+        txsize_array.push_back(tx_size);
+        stats.maxtxsize = std::max(stats.maxtxsize, tx_size);
+        mintxsize = std::min(mintxsize, tx_size);
+        stats.total_size += tx_size;
+
+        const int64_t weight = GetTransactionWeight(*tx);
+        stats.total_weight += weight;
+
+        if (tx->HasWitness()) {
+            ++stats.swtxs;
+            stats.swtotal_size += tx_size;
+            stats.swtotal_weight += weight;
+        }
+
+        CAmount tx_total_in = 0;
+        const auto& txundo = blockUndo.vtxundo.at(i - 1);
+        for (const Coin& coin: txundo.vprevout) {
+            const CTxOut& prevoutput = coin.out;
+
+            tx_total_in += prevoutput.nValue;
+            size_t prevout_size = GetSerializeSize(prevoutput, PROTOCOL_VERSION) + PER_UTXO_OVERHEAD;
+            stats.utxo_size_inc -= prevout_size;
+            stats.utxo_size_inc_actual -= prevout_size;
+        }
+
+        CAmount txfee = tx_total_in - tx_total_out;
+        CHECK_NONFATAL(MoneyRange(txfee));
+        fee_array.push_back(txfee);
+        stats.maxfee = std::max(stats.maxfee, txfee);
+        minfee = std::min(minfee, txfee);
+        stats.totalfee += txfee;
+
+        // New feerate uses satoshis per virtual byte instead of per serialized byte
+        CAmount feerate = weight ? (txfee * WITNESS_SCALE_FACTOR) / weight : 0;
+        feerate_array.emplace_back(std::make_pair(feerate, weight));
+        stats.maxfeerate = std::max(stats.maxfeerate, feerate);
+        minfeerate = std::min(minfeerate, feerate);
+    }
+
+    CalculatePercentilesByWeight(stats.feerate_percentiles.data(), feerate_array, stats.total_weight);
+
+    stats.txs = block.vtx.size();
+    stats.medianfee = CalculateTruncatedMedian(fee_array);
+    stats.mediantxsize = CalculateTruncatedMedian(txsize_array);
+    stats.minfee = (minfee == MAX_MONEY) ? 0 : minfee;
+    stats.minfeerate = (minfeerate == MAX_MONEY) ? 0 : minfeerate;
+    stats.mintxsize = (mintxsize == std::numeric_limits<int64_t>::max()) ? 0 : mintxsize;
+    stats.utxo_increase = stats.outs - stats.ins;
+    stats.utxo_increase_actual = utxos - stats.ins;
+
+    if (fLogEvents && stats.contract_txs > 0) {
+        // The receipts storage is shared with block connection, which uses it under cs_main
+        LOCK(cs_main);
+        const uint256 hash = pindex.GetBlockHash();
+        for (const auto& tx : block.vtx) {
+            if (!tx->HasCreateOrCall()) continue;
+            for (const TransactionReceiptInfo& receipt : pstorageresult->getResult(uintToh256(tx->GetHash()))) {
+                // A transaction that was reorganized into another block has receipts for both
+                if (receipt.blockHash == hash) stats.gas_used += receipt.gasUsed;
+            }
+        }
+    }
+    stats.gas_used_known = fLogEvents;
+    return stats;
+}
+
 static RPCHelpMan getblockstats()
 {
     return RPCHelpMan{"getblockstats",
                 "\nCompute per block statistics for a given window. All amounts are in satoshis.\n"
-                "It won't work for some heights with pruning.\n",
+                "It won't work for some heights with pruning, unless they are in -blockstatsindex.\n",
                 {
                     {"hash_or_height", RPCArg::Type::NUM, RPCArg::Optional::NO, "The block hash or height of the target block",
                      RPCArgOptions{
@@ -2776,6 +3300,9 @@ static RPCHelpMan getblockstats()
                 {RPCResult::Type::NUM, "avgfeerate", /*optional=*/true, "Average feerate (in satoshis per virtual byte)"},
                 {RPCResult::Type::NUM, "avgtxsize", /*optional=*/true, "Average transaction size"},
                 {RPCResult::Type::STR_HEX, "blockhash", /*optional=*/true, "The block hash (to check for potential reorgs)"},
+                {RPCResult::Type::NUM, "contract_calls", /*optional=*/true, "The number of transactions calling contracts"},
+                {RPCResult::Type::NUM, "contract_creates", /*optional=*/true, "The number of transactions creating contracts"},
+                {RPCResult::Type::NUM, "contract_txs", /*optional=*/true, "The number of transactions with contract outputs"},
                 {RPCResult::Type::ARR_FIXED, "feerate_percentiles", /*optional=*/true, "Feerates at the 10th, 25th, 50th, 75th, and 90th percentile weight unit (in satoshis per virtual byte)",
                 {
                     {RPCResult::Type::NUM, "10th_percentile_feerate", "The 10th percentile feerate"},
@@ -2784,6 +3311,7 @@ static RPCHelpMan getblockstats()
                     {RPCResult::Type::NUM, "75th_percentile_feerate", "The 75th percentile feerate"},
                     {RPCResult::Type::NUM, "90th_percentile_feerate", "The 90th percentile feerate"},
                 }},
+                {RPCResult::Type::NUM, "gasused", /*optional=*/true, "The gas used by the contracts of the block (only present with -logevents)"},
                 {RPCResult::Type::NUM, "height", /*optional=*/true, "The height of the block"},
                 {RPCResult::Type::NUM, "ins", /*optional=*/true, "The number of inputs (excluding coinbase)"},
                 {RPCResult::Type::NUM, "maxfee", /*optional=*/true, "Maximum fee in the block"},
@@ -2831,168 +3359,63 @@ static RPCHelpMan getblockstats()
         }
     }
 
-    const CBlock& block = GetBlockChecked(chainman.m_blockman, &pindex);
-    const CBlockUndo& blockUndo = GetUndoChecked(chainman.m_blockman, &pindex);
-
-    const bool do_all = stats.size() == 0; // Calculate everything if nothing selected (default)
-    const bool do_mediantxsize = do_all || stats.count("mediantxsize") != 0;
-    const bool do_medianfee = do_all || stats.count("medianfee") != 0;
-    const bool do_feerate_percentiles = do_all || stats.count("feerate_percentiles") != 0;
-    const bool loop_inputs = do_all || do_medianfee || do_feerate_percentiles ||
-        SetHasKeys(stats, "utxo_increase", "utxo_increase_actual", "utxo_size_inc", "utxo_size_inc_actual", "totalfee", "avgfee", "avgfeerate", "minfee", "maxfee", "minfeerate", "maxfeerate");
-    const bool loop_outputs = do_all || loop_inputs || stats.count("total_out");
-    const bool do_calculate_size = do_mediantxsize ||
-        SetHasKeys(stats, "total_size", "avgtxsize", "mintxsize", "maxtxsize", "swtotal_size");
-    const bool do_calculate_weight = do_all || SetHasKeys(stats, "total_weight", "avgfeerate", "swtotal_weight", "avgfeerate", "feerate_percentiles", "minfeerate", "maxfeerate");
-    const bool do_calculate_sw = do_all || SetHasKeys(stats, "swtxs", "swtotal_size", "swtotal_weight");
-
-    CAmount maxfee = 0;
-    CAmount maxfeerate = 0;
-    CAmount minfee = MAX_MONEY;
-    CAmount minfeerate = MAX_MONEY;
-    CAmount total_out = 0;
-    CAmount totalfee = 0;
-    int64_t inputs = 0;
-    int64_t maxtxsize = 0;
-    int64_t mintxsize = dgpMaxBlockSerSize;
-    int64_t outputs = 0;
-    int64_t swtotal_size = 0;
-    int64_t swtotal_weight = 0;
-    int64_t swtxs = 0;
-    int64_t total_size = 0;
-    int64_t total_weight = 0;
-    int64_t utxos = 0;
-    int64_t utxo_size_inc = 0;
-    int64_t utxo_size_inc_actual = 0;
-    std::vector<CAmount> fee_array;
-    std::vector<std::pair<CAmount, int64_t>> feerate_array;
-    std::vector<int64_t> txsize_array;
-
-    for (size_t i = 0; i < block.vtx.size(); ++i) {
-        const auto& tx = block.vtx.at(i);
-        outputs += tx->vout.size();
-
-        CAmount tx_total_out = 0;
-        if (loop_outputs) {
-            for (const CTxOut& out : tx->vout) {
-                tx_total_out += out.nValue;
-
-                size_t out_size = GetSerializeSize(out, PROTOCOL_VERSION) + PER_UTXO_OVERHEAD;
-                utxo_size_inc += out_size;
-
-                // The Genesis block and the repeated BIP30 block coinbases don't change the UTXO
-                // set counts, so they have to be excluded from the statistics
-                if (pindex.nHeight == 0 || (IsBIP30Repeat(pindex) && tx->IsCoinBase())) continue;
-                // Skip unspendable outputs since they are not included in the UTXO set
-                if (out.scriptPubKey.IsUnspendable()) continue;
-
-                ++utxos;
-                utxo_size_inc_actual += out_size;
-            }
-        }
-
-        if (tx->IsCoinBase() || tx->IsCoinStake()) {
-            continue;
-        }
-
-        inputs += tx->vin.size(); // Don't count coinbase's fake input
-        total_out += tx_total_out; // Don't count coinbase reward
-
-        int64_t tx_size = 0;
-        if (do_calculate_size) {
-
-            tx_size = tx->GetTotalSize();
-            if (do_mediantxsize) {
-                txsize_array.push_back(tx_size);
-            }
-            maxtxsize = std::max(maxtxsize, tx_size);
-            mintxsize = std::min(mintxsize, tx_size);
-            total_size += tx_size;
-        }
-
-        int64_t weight = 0;
-        if (do_calculate_weight) {
-            weight = GetTransactionWeight(*tx);
-            total_weight += weight;
-        }
-
-        if (do_calculate_sw && tx->HasWitness()) {
-            ++swtxs;
-            swtotal_size += tx_size;
-            swtotal_weight += weight;
-        }
-
-        if (loop_inputs) {
-            CAmount tx_total_in = 0;
-            const auto& txundo = blockUndo.vtxundo.at(i - 1);
-            for (const Coin& coin: txundo.vprevout) {
-                const CTxOut& prevoutput = coin.out;
-
-                tx_total_in += prevoutput.nValue;
-                size_t prevout_size = GetSerializeSize(prevoutput, PROTOCOL_VERSION) + PER_UTXO_OVERHEAD;
-                utxo_size_inc -= prevout_size;
-                utxo_size_inc_actual -= prevout_size;
-            }
-
-            CAmount txfee = tx_total_in - tx_total_out;
-            CHECK_NONFATAL(MoneyRange(txfee));
-            if (do_medianfee) {
-                fee_array.push_back(txfee);
-            }
-            maxfee = std::max(maxfee, txfee);
-            minfee = std::min(minfee, txfee);
-            totalfee += txfee;
-
-            // New feerate uses satoshis per virtual byte instead of per serialized byte
-            CAmount feerate = weight ? (txfee * WITNESS_SCALE_FACTOR) / weight : 0;
-            if (do_feerate_percentiles) {
-                feerate_array.emplace_back(std::make_pair(feerate, weight));
-            }
-            maxfeerate = std::max(maxfeerate, feerate);
-            minfeerate = std::min(minfeerate, feerate);
-        }
+    // The stats of the blocks indexed in the active chain are read from the index
+    std::optional<BlockStatistics> block_stats;
+    if (g_block_stats_index) {
+        block_stats = g_block_stats_index->LookUpStats(pindex);
+    }
+    if (!block_stats) {
+        const CBlock& block = GetBlockChecked(chainman.m_blockman, &pindex);
+        const CBlockUndo& blockUndo = GetUndoChecked(chainman.m_blockman, &pindex);
+        block_stats = ComputeBlockStatistics(block, blockUndo, pindex);
     }
+    const BlockStatistics& block_stat{*block_stats};
 
-    CAmount feerate_percentiles[NUM_GETBLOCKSTATS_PERCENTILES] = { 0 };
-    CalculatePercentilesByWeight(feerate_percentiles, feerate_array, total_weight);
+    const bool do_all = stats.size() == 0; // Calculate everything if nothing selected (default)
 
     UniValue feerates_res(UniValue::VARR);
-    for (int64_t i = 0; i < NUM_GETBLOCKSTATS_PERCENTILES; i++) {
-        feerates_res.push_back(feerate_percentiles[i]);
+    for (const CAmount feerate : block_stat.feerate_percentiles) {
+        feerates_res.push_back(feerate);
     }
 
     UniValue ret_all(UniValue::VOBJ);
-    ret_all.pushKV("avgfee", (block.vtx.size() > 1) ? totalfee / (block.vtx.size() - 1) : 0);
-    ret_all.pushKV("avgfeerate", total_weight ? (totalfee * WITNESS_SCALE_FACTOR) / total_weight : 0); // Unit: sat/vbyte
-    ret_all.pushKV("avgtxsize", (block.vtx.size() > 1) ? total_size / (block.vtx.size() - 1) : 0);
+    ret_all.pushKV("avgfee", (block_stat.txs > 1) ? block_stat.totalfee / (block_stat.txs - 1) : 0);
+    ret_all.pushKV("avgfeerate", block_stat.total_weight ? (block_stat.totalfee * WITNESS_SCALE_FACTOR) / block_stat.total_weight : 0); // Unit: sat/vbyte
+    ret_all.pushKV("avgtxsize", (block_stat.txs > 1) ? block_stat.total_size / (block_stat.txs - 1) : 0);
     ret_all.pushKV("blockhash", pindex.GetBlockHash().GetHex());
+    ret_all.pushKV("contract_calls", block_stat.contract_calls);
+    ret_all.pushKV("contract_creates", block_stat.contract_creates);
+    ret_all.pushKV("contract_txs", block_stat.contract_txs);
     ret_all.pushKV("feerate_percentiles", feerates_res);
+    if (block_stat.gas_used_known) {
+        ret_all.pushKV("gasused", block_stat.gas_used);
+    }
     ret_all.pushKV("height", (int64_t)pindex.nHeight);
-    ret_all.pushKV("ins", inputs);
-    ret_all.pushKV("maxfee", maxfee);
-    ret_all.pushKV("maxfeerate", maxfeerate);
-    ret_all.pushKV("maxtxsize", maxtxsize);
-    ret_all.pushKV("medianfee", CalculateTruncatedMedian(fee_array));
+    ret_all.pushKV("ins", block_stat.ins);
+    ret_all.pushKV("maxfee", block_stat.maxfee);
+    ret_all.pushKV("maxfeerate", block_stat.maxfeerate);
+    ret_all.pushKV("maxtxsize", block_stat.maxtxsize);
+    ret_all.pushKV("medianfee", block_stat.medianfee);
     ret_all.pushKV("mediantime", pindex.GetMedianTimePast());
-    ret_all.pushKV("mediantxsize", CalculateTruncatedMedian(txsize_array));
-    ret_all.pushKV("minfee", (minfee == MAX_MONEY) ? 0 : minfee);
-    ret_all.pushKV("minfeerate", (minfeerate == MAX_MONEY) ? 0 : minfeerate);
-    ret_all.pushKV("mintxsize", mintxsize == dgpMaxBlockSerSize ? 0 : mintxsize);
-    ret_all.pushKV("outs", outputs);
+    ret_all.pushKV("mediantxsize", block_stat.mediantxsize);
+    ret_all.pushKV("minfee", block_stat.minfee);
+    ret_all.pushKV("minfeerate", block_stat.minfeerate);
+    ret_all.pushKV("mintxsize", block_stat.mintxsize);
+    ret_all.pushKV("outs", block_stat.outs);
     ret_all.pushKV("subsidy", GetBlockSubsidy(pindex.nHeight, chainman.GetParams().GetConsensus()));
-    ret_all.pushKV("swtotal_size", swtotal_size);
-    ret_all.pushKV("swtotal_weight", swtotal_weight);
-    ret_all.pushKV("swtxs", swtxs);
+    ret_all.pushKV("swtotal_size", block_stat.swtotal_size);
+    ret_all.pushKV("swtotal_weight", block_stat.swtotal_weight);
+    ret_all.pushKV("swtxs", block_stat.swtxs);
     ret_all.pushKV("time", pindex.GetBlockTime());
-    ret_all.pushKV("total_out", total_out);
-    ret_all.pushKV("total_size", total_size);
-    ret_all.pushKV("total_weight", total_weight);
-    ret_all.pushKV("totalfee", totalfee);
-    ret_all.pushKV("txs", (int64_t)block.vtx.size());
-    ret_all.pushKV("utxo_increase", outputs - inputs);
-    ret_all.pushKV("utxo_size_inc", utxo_size_inc);
-    ret_all.pushKV("utxo_increase_actual", utxos - inputs);
-    ret_all.pushKV("utxo_size_inc_actual", utxo_size_inc_actual);
+    ret_all.pushKV("total_out", block_stat.total_out);
+    ret_all.pushKV("total_size", block_stat.total_size);
+    ret_all.pushKV("total_weight", block_stat.total_weight);
+    ret_all.pushKV("totalfee", block_stat.totalfee);
+    ret_all.pushKV("txs", block_stat.txs);
+    ret_all.pushKV("utxo_increase", block_stat.utxo_increase);
+    ret_all.pushKV("utxo_size_inc", block_stat.utxo_size_inc);
+    ret_all.pushKV("utxo_increase_actual", block_stat.utxo_increase_actual);
+    ret_all.pushKV("utxo_size_inc_actual", block_stat.utxo_size_inc_actual);
 
     if (do_all) {
         return ret_all;
@@ -3012,33 +3435,51 @@ static RPCHelpMan getblockstats()
 }
 
 namespace {
-//! Search for a given set of pubkey scripts
-bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>& should_abort, int64_t& count, CCoinsViewCursor* cursor, const std::set<CScript>& needles, std::map<COutPoint, Coin>& out_results, std::function<void()>& interruption_point)
+//! Maximum number of threads that scan the coins database for scantxoutset
+constexpr int MAX_SCAN_TXOUTSET_THREADS{8};
+//! Number of txid ranges per scanning thread, so that the threads finish close together
+constexpr int SCAN_TXOUTSET_RANGES_PER_THREAD{4};
+//! Number of values of the first two bytes of a txid, by which the coins database is split in ranges
+constexpr uint32_t TXID_PREFIXES{0x10000};
+
+using ScriptSet = std::unordered_set<CScript, SaltedSipHasher>;
+
+uint32_t TxidPrefix(const uint256& txid)
+{
+    return 0x100 * *txid.begin() + *(txid.begin() + 1);
+}
+
+//! Search for a given set of pubkey scripts among the coins of @p cursor whose txid prefix is before @p end,
+//! adding to @p scanned_prefixes the prefixes from @p begin that are done
+bool FindScriptPubKey(std::atomic<int>& scanned_prefixes, const std::atomic<bool>& should_abort, std::atomic<int64_t>& count, CCoinsViewCursor* cursor, uint32_t begin, uint32_t end, const ScriptSet& needles, std::map<COutPoint, Coin>& out_results)
 {
-    scan_progress = 0;
-    count = 0;
+    uint32_t scanned = begin;
+    int64_t range_count = 0;
     while (cursor->Valid()) {
         COutPoint key;
         Coin coin;
         if (!cursor->GetKey(key) || !cursor->GetValue(coin)) return false;
-        if (++count % 8192 == 0) {
-            interruption_point();
+        const uint32_t prefix = TxidPrefix(key.hash);
+        if (prefix >= end) break;
+        if (++range_count % 8192 == 0) {
             if (should_abort) {
                 // allow to abort the scan via the abort reference
                 return false;
             }
         }
-        if (count % 256 == 0) {
+        if (range_count % 256 == 0) {
             // update progress reference every 256 item
-            uint32_t high = 0x100 * *key.hash.begin() + *(key.hash.begin() + 1);
-            scan_progress = (int)(high * 100.0 / 65536.0 + 0.5);
+            count += 256;
+            scanned_prefixes += prefix - scanned;
+            scanned = prefix;
         }
         if (needles.count(coin.out.scriptPubKey)) {
             out_results.emplace(key, coin);
         }
         cursor->Next();
     }
-    scan_progress = 100;
+    count += range_count % 256;
+    scanned_prefixes += end - scanned;
     return true;
 }
 } // namespace
@@ -3195,7 +3636,7 @@ static RPCHelpMan scantxoutset()
             throw JSONRPCError(RPC_MISC_ERROR, "scanobjects argument is required for the start action");
         }
 
-        std::set<CScript> needles;
+        ScriptSet needles;
         std::map<CScript, std::string> descriptors;
         CAmount total_in = 0;
 
@@ -3215,8 +3656,11 @@ static RPCHelpMan scantxoutset()
         std::vector<CTxOut> input_txos;
         std::map<COutPoint, Coin> coins;
         g_should_abort_scan = false;
-        int64_t count = 0;
-        std::unique_ptr<CCoinsViewCursor> pcursor;
+
+        // The coins database is split in ranges of txids, scanned by several threads with a cursor each
+        const int num_threads = std::clamp(GetNumCores(), 1, MAX_SCAN_TXOUTSET_THREADS);
+        const uint32_t num_ranges = num_threads * SCAN_TXOUTSET_RANGES_PER_THREAD;
+        std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
         const CBlockIndex* tip;
         NodeContext& node = EnsureAnyNodeContext(request.context);
         {
@@ -3224,12 +3668,60 @@ static RPCHelpMan scantxoutset()
             LOCK(cs_main);
             Chainstate& active_chainstate = chainman.ActiveChainstate();
             active_chainstate.ForceFlushStateToDisk();
-            pcursor = CHECK_NONFATAL(active_chainstate.CoinsDB().Cursor());
+            // The cursors are made together under cs_main, so that they all see the flushed coins
+            for (uint32_t range = 0; range < num_ranges; ++range) {
+                uint256 start;
+                const uint32_t prefix = range * TXID_PREFIXES / num_ranges;
+                *start.begin() = prefix >> 8;
+                *(start.begin() + 1) = prefix & 0xff;
+                cursors.push_back(CHECK_NONFATAL(active_chainstate.CoinsDB().Cursor(COutPoint(start, 0))));
+            }
             tip = CHECK_NONFATAL(active_chainstate.m_chain.Tip());
         }
-        bool res = FindScriptPubKey(g_scan_progress, g_should_abort_scan, count, pcursor.get(), needles, coins, node.rpc_interruption_point);
+
+        g_scan_progress = 0;
+        std::atomic<int> scanned_prefixes{0};
+        std::atomic<int64_t> count{0};
+        std::atomic<uint32_t> next_range{0};
+        std::atomic<bool> stop{false};
+        std::vector<std::map<COutPoint, Coin>> range_coins(num_ranges);
+        std::vector<std::future<bool>> scans;
+        for (int i = 0; i < num_threads; ++i) {
+            scans.push_back(std::async(std::launch::async, [&] {
+                bool success = true;
+                for (uint32_t range = next_range++; range < num_ranges && success; range = next_range++) {
+                    const uint32_t begin = range * TXID_PREFIXES / num_ranges;
+                    const uint32_t end = (range + 1) * TXID_PREFIXES / num_ranges;
+                    success = FindScriptPubKey(scanned_prefixes, stop, count, cursors[range].get(), begin, end, needles, range_coins[range]);
+                }
+                if (!success) stop = true;
+                return success;
+            }));
+        }
+        bool res = true;
+        try {
+            for (auto& scan : scans) {
+                while (scan.wait_for(std::chrono::milliseconds{100}) != std::future_status::ready) {
+                    node.rpc_interruption_point();
+                    if (g_should_abort_scan) stop = true;
+                    g_scan_progress = (int)(scanned_prefixes * 100.0 / TXID_PREFIXES + 0.5);
+                }
+                res = scan.get() && res;
+            }
+        } catch (...) {
+            // The threads use the cursors and the results of this frame
+            stop = true;
+            for (auto& scan : scans) {
+                if (scan.valid()) scan.wait();
+            }
+            throw;
+        }
+        if (res) g_scan_progress = 100;
+        for (auto& found : range_coins) {
+            coins.merge(found);
+        }
         result.pushKV("success", res);
-        result.pushKV("txouts", count);
+        result.pushKV("txouts", count.load());
         result.pushKV("height", tip->nHeight);
         result.pushKV("bestblock", tip->GetBlockHash().GetHex());
 
@@ -3592,6 +4084,7 @@ static RPCHelpMan dumptxoutset()
         "Write the serialized UTXO set to disk.",
         {
             {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "Path to the output file. If relative, will be prefixed by datadir."},
+            {"format", RPCArg::Type::STR, RPCArg::Default{"legacy"}, "Format of the coins in the snapshot. Options: 'legacy' (loadable by older nodes), 'chunked' (hashed chunks of coins grouped by transaction, encoded and loaded on several threads)."},
         },
         RPCResult{
             RPCResult::Type::OBJ, "", "",
@@ -3606,10 +4099,15 @@ static RPCHelpMan dumptxoutset()
         },
         RPCExamples{
             HelpExampleCli("dumptxoutset", "utxo.dat")
+    + HelpExampleCli("dumptxoutset", "utxo.dat chunked")
         },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
     const ArgsManager& args{EnsureAnyArgsman(request.context)};
+    const std::string format{request.params[1].isNull() ? "legacy" : request.params[1].get_str()};
+    if (format != "legacy" && format != "chunked") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown snapshot format: " + format);
+    }
     const fs::path path = fsbridge::AbsPathJoin(args.GetDataDirNet(), fs::u8path(request.params[0].get_str()));
     // Write to a temporary path and then move into `path` on completion
     // to avoid confusion due to an interruption.
@@ -3632,7 +4130,7 @@ static RPCHelpMan dumptxoutset()
 
     NodeContext& node = EnsureAnyNodeContext(request.context);
     UniValue result = CreateUTXOSnapshot(
-        node, node.chainman->ActiveChainstate(), afile, path, temppath);
+        node, node.chainman->ActiveChainstate(), afile, path, temppath, format == "chunked");
     fs::rename(temppath, path);
 
     result.pushKV("path", path.u8string());
@@ -3646,7 +4144,8 @@ UniValue CreateUTXOSnapshot(
     Chainstate& chainstate,
     AutoFile& afile,
     const fs::path& path,
-    const fs::path& temppath)
+    const fs::path& temppath,
+    bool chunked)
 {
     std::unique_ptr<CCoinsViewCursor> pcursor;
     std::optional<CCoinsStats> maybe_stats;
@@ -3682,10 +4181,14 @@ UniValue CreateUTXOSnapshot(
         tip->nHeight, tip->GetBlockHash().ToString(),
         fs::PathToString(path), fs::PathToString(temppath)));
 
-    SnapshotMetadata metadata{tip->GetBlockHash(), maybe_stats->coins_count, tip->nChainTx};
+    SnapshotMetadata metadata{tip->GetBlockHash(), maybe_stats->coins_count, tip->nChainTx,
+                              chunked ? node::SNAPSHOT_VERSION_CHUNKED : node::SNAPSHOT_VERSION_LEGACY};
 
     afile << metadata;
 
+    std::optional<node::SnapshotChunkWriter> writer;
+    if (chunked) writer.emplace(afile, std::clamp(GetNumCores(), 1, node::MAX_SNAPSHOT_THREADS));
+
     COutPoint key;
     Coin coin;
     unsigned int iter{0};
@@ -3694,12 +4197,17 @@ UniValue CreateUTXOSnapshot(
         if (iter % 5000 == 0) node.rpc_interruption_point();
         ++iter;
         if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
-            afile << key;
-            afile << coin;
+            if (writer) {
+                writer->Add(key, coin);
+            } else {
+                afile << key;
+                afile << coin;
+            }
         }
 
         pcursor->Next();
     }
+    if (writer) writer->Finish();
 
     afile.fclose();
 
@@ -3715,6 +4223,234 @@ UniValue CreateUTXOSnapshot(
     return result;
 }
 
+/**
+ * Serialize the contract state of the tip to a file for loading elsewhere.
+ *
+ * @see qtum::ContractStateSnapshotMetadata
+ */
+static RPCHelpMan dumpcontractstate()
+{
+    return RPCHelpMan{
+        "dumpcontractstate",
+        "Write the contract state of the tip, the EVM accounts with their storage and the UTXO trie, to disk.",
+        {
+            {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "Path to the output file. If relative, will be prefixed by datadir."},
+        },
+        RPCResult{
+            RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::NUM, "accounts_written", "the number of accounts written in the snapshot"},
+                    {RPCResult::Type::NUM, "storage_slots_written", "the number of storage slots written in the snapshot"},
+                    {RPCResult::Type::NUM, "vins_written", "the number of UTXO trie entries written in the snapshot"},
+                    {RPCResult::Type::STR_HEX, "base_hash", "the hash of the base of the snapshot"},
+                    {RPCResult::Type::NUM, "base_height", "the height of the base of the snapshot"},
+                    {RPCResult::Type::STR_HEX, "hashStateRoot", "the state root of the base block"},
+                    {RPCResult::Type::STR_HEX, "hashUTXORoot", "the UTXO root of the base block"},
+                    {RPCResult::Type::STR, "path", "the absolute path that the snapshot was written to"},
+                }
+        },
+        RPCExamples{
+            HelpExampleCli("dumpcontractstate", "contracts.dat")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const ArgsManager& args{EnsureAnyArgsman(request.context)};
+    const fs::path path = fsbridge::AbsPathJoin(args.GetDataDirNet(), fs::u8path(request.params[0].get_str()));
+    // Write to a temporary path and then move into `path` on completion
+    // to avoid confusion due to an interruption.
+    const fs::path temppath = fsbridge::AbsPathJoin(args.GetDataDirNet(), fs::u8path(request.params[0].get_str() + ".incomplete"));
+
+    if (fs::exists(path)) {
+        throw JSONRPCError(
+            RPC_INVALID_PARAMETER,
+            path.u8string() + " already exists. If you are sure this is what you want, "
+            "move it out of the way first");
+    }
+
+    FILE* file{fsbridge::fopen(temppath, "wb")};
+    AutoFile afile{file};
+    if (afile.IsNull()) {
+        throw JSONRPCError(
+            RPC_INVALID_PARAMETER,
+            "Couldn't open file " + temppath.u8string() + " for writing.");
+    }
+
+    NodeContext& node = EnsureAnyNodeContext(request.context);
+    // The state is read from a view of the tip, without holding cs_main
+    std::shared_ptr<const ContractCallSnapshot> snapshot = GetContractCallSnapshot(node.chainman->ActiveChainstate());
+    const CBlockIndex* tip = snapshot->pindex;
+    qtum::ContractStateSnapshotMetadata metadata{tip->GetBlockHash(), tip->hashStateRoot, tip->hashUTXORoot};
+
+    LOG_TIME_SECONDS(strprintf("writing contract state snapshot at height %s (%s) to file %s (via %s)",
+        tip->nHeight, tip->GetBlockHash().ToString(),
+        fs::PathToString(path), fs::PathToString(temppath)));
+
+    qtum::ContractStateSnapshotStats stats;
+    if (!qtum::WriteContractStateSnapshot(afile, metadata, snapshot->view, stats, node.rpc_interruption_point)) {
+        afile.fclose();
+        fs::remove(temppath);
+        throw JSONRPCError(RPC_MISC_ERROR, "The contract state cannot be iterated by this build");
+    }
+    afile.fclose();
+    fs::rename(temppath, path);
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("accounts_written", stats.accounts);
+    result.pushKV("storage_slots_written", stats.storage_slots);
+    result.pushKV("vins_written", stats.vins);
+    result.pushKV("base_hash", tip->GetBlockHash().ToString());
+    result.pushKV("base_height", tip->nHeight);
+    result.pushKV("hashStateRoot", tip->hashStateRoot.GetHex());
+    result.pushKV("hashUTXORoot", tip->hashUTXORoot.GetHex());
+    result.pushKV("path", path.u8string());
+    return result;
+},
+    };
+}
+
+static RPCHelpMan loadcontractstate()
+{
+    return RPCHelpMan{
+        "loadcontractstate",
+        "Rebuild the contract state of a block from a file written by dumpcontractstate.\n"
+        "The snapshot is checked against the state and UTXO roots in the header of its base block, which has to be known. "
+        "The state database then holds the state of that block without replaying its contracts.",
+        {
+            {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "Path to the snapshot file. If relative, will be prefixed by datadir."},
+        },
+        RPCResult{
+            RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::NUM, "accounts_loaded", "the number of accounts loaded from the snapshot"},
+                    {RPCResult::Type::NUM, "storage_slots_loaded", "the number of storage slots loaded from the snapshot"},
+                    {RPCResult::Type::NUM, "vins_loaded", "the number of UTXO trie entries loaded from the snapshot"},
+                    {RPCResult::Type::STR_HEX, "base_hash", "the hash of the base of the snapshot"},
+                    {RPCResult::Type::NUM, "base_height", "the height of the base of the snapshot"},
+                    {RPCResult::Type::BOOL, "in_active_chain", "whether the base block is in the active chain"},
+                }
+        },
+        RPCExamples{
+            HelpExampleCli("loadcontractstate", "contracts.dat")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const ArgsManager& args{EnsureAnyArgsman(request.context)};
+    const fs::path path = fsbridge::AbsPathJoin(args.GetDataDirNet(), fs::u8path(request.params[0].get_str()));
+
+    FILE* file{fsbridge::fopen(path, "rb")};
+    AutoFile afile{file};
+    if (afile.IsNull()) {
+        throw JSONRPCError(
+            RPC_INVALID_PARAMETER,
+            "Couldn't open file " + path.u8string() + " for reading.");
+    }
+
+    qtum::ContractStateSnapshotMetadata metadata;
+    try {
+        afile >> metadata;
+    } catch (const std::ios_base::failure& e) {
+        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, strprintf("Unable to parse metadata: %s", e.what()));
+    }
+
+    NodeContext& node = EnsureAnyNodeContext(request.context);
+    ChainstateManager& chainman = *node.chainman;
+    const CBlockIndex* pindex;
+    std::unique_ptr<QtumState> state;
+    {
+        LOCK(cs_main);
+        pindex = chainman.m_blockman.LookupBlockIndex(metadata.m_base_blockhash);
+        if (!pindex) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "The base block " + metadata.m_base_blockhash.GetHex() + " of the snapshot is not known");
+        }
+        if (pindex->hashStateRoot != metadata.m_state_root || pindex->hashUTXORoot != metadata.m_utxo_root) {
+            throw JSONRPCError(RPC_VERIFY_ERROR, "The snapshot roots do not match the header of its base block");
+        }
+        // The tries are rebuilt into the shared databases, on a state of their own
+        state = std::make_unique<QtumState>(*globalState);
+    }
+
+    LOG_TIME_SECONDS(strprintf("loading contract state snapshot at height %s (%s) from file %s",
+        pindex->nHeight, pindex->GetBlockHash().ToString(), fs::PathToString(path)));
+
+    qtum::ContractStateSnapshotStats stats;
+    std::string error;
+    if (!qtum::LoadContractStateSnapshot(afile, metadata, *state, stats, error, node.rpc_interruption_point)) {
+        throw JSONRPCError(RPC_VERIFY_ERROR, "Invalid contract state snapshot: " + error);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("accounts_loaded", stats.accounts);
+    result.pushKV("storage_slots_loaded", stats.storage_slots);
+    result.pushKV("vins_loaded", stats.vins);
+    result.pushKV("base_hash", pindex->GetBlockHash().ToString());
+    result.pushKV("base_height", pindex->nHeight);
+    result.pushKV("in_active_chain", WITH_LOCK(cs_main, return chainman.ActiveChain().Contains(pindex)));
+    return result;
+},
+    };
+}
+
+static RPCHelpMan synccontractstate()
+{
+    return RPCHelpMan{
+        "synccontractstate",
+        "Download the contract state of a block from the peers serving it (-peercontractstate).\n"
+        "Every trie node is checked against its hash, starting from the state and UTXO roots in the header of the block, "
+        "which has to be known. A download that was interrupted resumes where it stopped when it is started again.\n"
+        "Without blockhash, returns the progress of the last download.",
+        {
+            {"blockhash", RPCArg::Type::STR_HEX, RPCArg::Optional::OMITTED, "The hash of the block whose contract state to download"},
+        },
+        RPCResult{
+            RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::STR_HEX, "blockhash", "the hash of the block whose contract state is downloaded"},
+                    {RPCResult::Type::STR_HEX, "hashStateRoot", "the root of its state trie"},
+                    {RPCResult::Type::STR_HEX, "hashUTXORoot", "the root of its UTXO trie"},
+                    {RPCResult::Type::NUM, "nodes", "the number of trie nodes and code written"},
+                    {RPCResult::Type::NUM, "keys", "the number of trie keys written"},
+                    {RPCResult::Type::NUM, "bytes", "the number of bytes downloaded"},
+                    {RPCResult::Type::NUM, "pending", "the number of items left to download"},
+                    {RPCResult::Type::NUM, "in_flight", "the number of items requested from peers"},
+                    {RPCResult::Type::BOOL, "complete", "whether the whole contract state is downloaded"},
+                }
+        },
+        RPCExamples{
+            HelpExampleCli("synccontractstate", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+            + HelpExampleCli("synccontractstate", "")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const NodeContext& node = EnsureAnyNodeContext(request.context);
+    PeerManager& peerman = EnsurePeerman(node);
+
+    if (!request.params[0].isNull()) {
+        std::string error;
+        if (!peerman.StartContractStateSync(ParseHashV(request.params[0], "blockhash"), error)) {
+            throw JSONRPCError(RPC_MISC_ERROR, error);
+        }
+    }
+
+    const std::optional<qtum::ContractStateSyncStats> stats = peerman.GetContractStateSyncStats();
+    if (!stats) {
+        throw JSONRPCError(RPC_MISC_ERROR, "No contract state download was started");
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("blockhash", stats->block_hash.GetHex());
+    result.pushKV("hashStateRoot", stats->state_root.GetHex());
+    result.pushKV("hashUTXORoot", stats->utxo_root.GetHex());
+    result.pushKV("nodes", stats->nodes);
+    result.pushKV("keys", stats->aux);
+    result.pushKV("bytes", stats->bytes);
+    result.pushKV("pending", (uint64_t)stats->pending);
+    result.pushKV("in_flight", (uint64_t)stats->in_flight);
+    result.pushKV("complete", stats->complete);
+    return result;
+},
+    };
+}
+
 static RPCHelpMan qrc20name()
 {
     return RPCHelpMan{"qrc20name",
@@ -3993,7 +4729,8 @@ static RPCHelpMan qrc20listtransactions()
         throw JSONRPCError(RPC_MISC_ERROR, "Fail to get decimals");
 
     // Create transaction list
-    UniValue res(UniValue::VARR);
+    RPCResultWriter writer{request};
+    writer.BeginArray();
     for(const auto& event : result){
         UniValue obj(UniValue::VOBJ);
 
@@ -4014,10 +4751,11 @@ static RPCHelpMan qrc20listtransactions()
         obj.pushKV("blockNumber", event.blockNumber);
         obj.pushKV("blocktime", active_chain[event.blockNumber]->GetBlockTime());
         obj.pushKV("transactionHash", event.transactionHash.GetHex());
-        res.push_back(obj);
+        writer.Value(obj);
     }
+    writer.EndArray();
 
-    return res;
+    return writer.Finish();
 },
     };
 }
@@ -4043,11 +4781,14 @@ void RegisterBlockchainRPCCommands(CRPCTable& t)
         {"blockchain", &verifychain},
         {"blockchain", &getaccountinfo},
         {"blockchain", &getstorage},
+        {"blockchain", &getcontractprofile},
         {"blockchain", &preciousblock},
         {"blockchain", &scantxoutset},
         {"blockchain", &scanblocks},
         {"blockchain", &getblockfilter},
         {"blockchain", &callcontract},
+        {"blockchain", &callcontractbatch},
+        {"blockchain", &estimategas},
         {"blockchain", &qrc20name},
         {"blockchain", &qrc20symbol},
         {"blockchain", &qrc20totalsupply},
@@ -4058,6 +4799,7 @@ void RegisterBlockchainRPCCommands(CRPCTable& t)
         {"blockchain", &listcontracts},
         {"blockchain", &gettransactionreceipt},
         {"blockchain", &searchlogs},
+        {"blockchain", &searchlogspage},
         {"blockchain", &waitforlogs},
         {"blockchain", &getestimatedannualroi},
         {"blockchain", &getdelegationinfoforaddress},
@@ -4069,6 +4811,9 @@ void RegisterBlockchainRPCCommands(CRPCTable& t)
         {"hidden", &waitforblockheight},
         {"hidden", &syncwithvalidationinterfacequeue},
         {"hidden", &dumptxoutset},
+        {"hidden", &dumpcontractstate},
+        {"hidden", &loadcontractstate},
+        {"hidden", &synccontractstate},
     };
     for (const auto& c : commands) {
         t.appendCommand(c.name, &c);
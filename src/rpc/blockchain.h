@@ -13,18 +13,25 @@
 #include <validation.h>
 
 #include <any>
+#include <array>
 #include <stdint.h>
 #include <vector>
 
 class CBlock;
 class CBlockIndex;
+class CBlockUndo;
 class Chainstate;
+class RPCResultWriter;
 class UniValue;
 namespace node {
 struct NodeContext;
 } // namespace node
 
 static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
+/** Number of storage slots of a getstorage page when only its start is given */
+static constexpr int DEFAULT_STORAGE_PAGE_SIZE{100};
+/** Maximum number of storage slots of a getstorage page */
+static constexpr int MAX_STORAGE_PAGE_SIZE{10000};
 
 /**
  * Get the difficulty of the net wrt to the given block index.
@@ -39,6 +46,8 @@ void RPCNotifyBlockChange(const CBlockIndex*);
 
 /** Block description to JSON */
 UniValue blockToJSON(node::BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity) LOCKS_EXCLUDED(cs_main);
+/** Block description to JSON, one transaction at a time */
+void blockToJSON(node::BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity, RPCResultWriter& writer) LOCKS_EXCLUDED(cs_main);
 
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex) LOCKS_EXCLUDED(cs_main);
@@ -46,8 +55,71 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
 /** Used by getblockstats to get feerates at different percentiles by weight  */
 void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES], std::vector<std::pair<CAmount, int64_t>>& scores, int64_t total_weight);
 
+/**
+ * Statistics of a block that getblockstats reports along with those of its index entry,
+ * see getblockstats for their description. The block stats index stores them.
+ */
+struct BlockStatistics {
+    int64_t txs{0};
+    int64_t ins{0};
+    int64_t outs{0};
+    CAmount total_out{0};
+    CAmount totalfee{0};
+    CAmount minfee{0};
+    CAmount maxfee{0};
+    CAmount medianfee{0};
+    CAmount minfeerate{0};
+    CAmount maxfeerate{0};
+    std::array<CAmount, NUM_GETBLOCKSTATS_PERCENTILES> feerate_percentiles{};
+    int64_t total_size{0};
+    int64_t total_weight{0};
+    int64_t mintxsize{0};
+    int64_t maxtxsize{0};
+    int64_t mediantxsize{0};
+    int64_t swtxs{0};
+    int64_t swtotal_size{0};
+    int64_t swtotal_weight{0};
+    int64_t utxo_increase{0};
+    int64_t utxo_size_inc{0};
+    int64_t utxo_increase_actual{0};
+    int64_t utxo_size_inc_actual{0};
+    //! Transactions with contract outputs, and those of them creating and calling contracts
+    int64_t contract_txs{0};
+    int64_t contract_creates{0};
+    int64_t contract_calls{0};
+    //! Gas used by the contracts of the block, only known from the receipts of -logevents
+    bool gas_used_known{false};
+    uint64_t gas_used{0};
+
+    SERIALIZE_METHODS(BlockStatistics, obj)
+    {
+        READWRITE(VARINT_MODE(obj.txs, VarIntMode::NONNEGATIVE_SIGNED), VARINT_MODE(obj.ins, VarIntMode::NONNEGATIVE_SIGNED),
+                  VARINT_MODE(obj.outs, VarIntMode::NONNEGATIVE_SIGNED), VARINT_MODE(obj.total_out, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT_MODE(obj.totalfee, VarIntMode::NONNEGATIVE_SIGNED), VARINT_MODE(obj.minfee, VarIntMode::NONNEGATIVE_SIGNED),
+                  VARINT_MODE(obj.maxfee, VarIntMode::NONNEGATIVE_SIGNED), VARINT_MODE(obj.medianfee, VarIntMode::NONNEGATIVE_SIGNED),
+                  VARINT_MODE(obj.minfeerate, VarIntMode::NONNEGATIVE_SIGNED), VARINT_MODE(obj.maxfeerate, VarIntMode::NONNEGATIVE_SIGNED));
+        for (auto& feerate : obj.feerate_percentiles) {
+            READWRITE(VARINT_MODE(feerate, VarIntMode::NONNEGATIVE_SIGNED));
+        }
+        READWRITE(VARINT_MODE(obj.total_size, VarIntMode::NONNEGATIVE_SIGNED), VARINT_MODE(obj.total_weight, VarIntMode::NONNEGATIVE_SIGNED),
+                  VARINT_MODE(obj.mintxsize, VarIntMode::NONNEGATIVE_SIGNED), VARINT_MODE(obj.maxtxsize, VarIntMode::NONNEGATIVE_SIGNED),
+                  VARINT_MODE(obj.mediantxsize, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT_MODE(obj.swtxs, VarIntMode::NONNEGATIVE_SIGNED), VARINT_MODE(obj.swtotal_size, VarIntMode::NONNEGATIVE_SIGNED),
+                  VARINT_MODE(obj.swtotal_weight, VarIntMode::NONNEGATIVE_SIGNED));
+        // The UTXO set shrinks in blocks spending more outputs than they create
+        READWRITE(obj.utxo_increase, obj.utxo_size_inc, obj.utxo_increase_actual, obj.utxo_size_inc_actual);
+        READWRITE(VARINT_MODE(obj.contract_txs, VarIntMode::NONNEGATIVE_SIGNED), VARINT_MODE(obj.contract_creates, VarIntMode::NONNEGATIVE_SIGNED),
+                  VARINT_MODE(obj.contract_calls, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(obj.gas_used_known, VARINT(obj.gas_used));
+    }
+};
+
+/** Compute the statistics of @p block, connected at @p pindex, whose spent coins are in @p block_undo */
+BlockStatistics ComputeBlockStatistics(const CBlock& block, const CBlockUndo& block_undo, const CBlockIndex& pindex) LOCKS_EXCLUDED(cs_main);
+
 /**
  * Helper to create UTXO snapshots given a chainstate and a file handle.
+ * @param chunked write the coins in hashed chunks instead of the legacy format
  * @return a UniValue map containing metadata about the snapshot.
  */
 UniValue CreateUTXOSnapshot(
@@ -55,6 +127,7 @@ UniValue CreateUTXOSnapshot(
     Chainstate& chainstate,
     AutoFile& afile,
     const fs::path& path,
-    const fs::path& tmppath);
+    const fs::path& tmppath,
+    bool chunked = false);
 
 #endif // BITCOIN_RPC_BLOCKCHAIN_H
@@ -52,6 +52,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "splitutxosforaddress", 2, "maxvalue" },
     { "splitutxosforaddress", 3, "maxoutputs" },
     { "splitutxosforaddress", 4, "psbt" },
+    { "splitutxosforaddress", 5, "maxtransactions" },
     { "settxfee", 0, "amount" },
     { "sethdseed", 0, "newkeypool" },
     { "getsubsidy", 0, "height" },
@@ -121,6 +122,12 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "searchlogs", 2, "addressfilter"},
     { "searchlogs", 3, "topicfilter"},
     { "searchlogs", 4, "minconf"},
+    { "searchlogspage", 0, "fromblock"},
+    { "searchlogspage", 1, "toblock"},
+    { "searchlogspage", 2, "addressfilter"},
+    { "searchlogspage", 3, "topicfilter"},
+    { "searchlogspage", 4, "minconf"},
+    { "searchlogspage", 5, "options"},
     { "waitforlogs", 0, "fromblock"},
     { "waitforlogs", 1, "toblock"},
     { "waitforlogs", 2, "filter"},
@@ -214,6 +221,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getrawmempool", 0, "verbose" },
     { "getrawmempool", 1, "mempool_sequence" },
     { "estimatesmartfee", 0, "conf_target" },
+    { "estimategasprice", 0, "conf_target" },
     { "estimaterawfee", 0, "conf_target" },
     { "estimaterawfee", 1, "threshold" },
     { "prioritisetransaction", 1, "dummy" },
@@ -229,6 +237,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "psbtbumpfee", 1, "options" },
     { "logging", 0, "include" },
     { "logging", 1, "exclude" },
+    { "getlockstats", 0, "reset" },
+    { "getlockstats", 1, "enable" },
     { "disconnectnode", 1, "nodeid" },
     { "upgradewallet", 0, "version" },
     { "createcontract", 1, "gaslimit" },
@@ -263,14 +273,22 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "qrc20burnfrom", 4, "gaslimit" },
     { "qrc20burnfrom", 5, "gasprice" },
     { "qrc20burnfrom", 6, "checkoutputs" },
+    { "getcontractprofile", 0, "count" },
+    { "getcontractprofile", 1, "reset" },
     { "callcontract", 3, "gaslimit" },
     { "callcontract", 4, "amount" },
+    { "callcontractbatch", 0, "calls" },
+    { "estimategas", 3, "gaslimit" },
+    { "estimategas", 4, "amount" },
     { "reservebalance", 0, "reserve"},
     { "reservebalance", 1, "amount"},
+    { "getstakingmetrics", 0, "reset" },
     { "listcontracts", 0, "start" },
     { "listcontracts", 1, "maxdisplay" },
+    { "getaccountinfo", 1, "blocknum" },
     { "getstorage", 2, "index" },
     { "getstorage", 1, "blocknum" },
+    { "getstorage", 4, "limit" },
     // Echo with conversion (For testing only)
     { "echojson", 0, "arg0" },
     { "echojson", 1, "arg1" },
@@ -4,6 +4,8 @@
 #include <key_io.h>
 #include <rpc/server.h>
 #include <txdb.h>
+#include <index/logindex.h>
+#include <index/qrc20index.h>
 
 UniValue executionResultToJSON(const dev::eth::ExecutionResult& exRes)
 {
@@ -46,54 +48,52 @@ UniValue transactionReceiptToJSON(const QtumTransactionReceipt& txRec)
     return result;
 }
 
-UniValue CallToContract(const UniValue& params, ChainstateManager &chainman)
+static ContractCall ParseContractCall(const UniValue& address, const UniValue& hexData, const UniValue& sender, const UniValue& gasLimit, const UniValue& amount, const QtumState& state)
 {
-    LOCK(cs_main);
-
-    std::string strAddr = params[0].get_str();
-    std::string data = params[1].get_str();
+    std::string strAddr = address.get_str();
+    std::string data = hexData.get_str();
 
     if(data.size() % 2 != 0 || !CheckHex(data))
         throw JSONRPCError(RPC_TYPE_ERROR, "Invalid data (data not hex)");
 
-    dev::Address addrAccount;
+    ContractCall call;
     if(strAddr.size() > 0)
     {
         if(strAddr.size() != 40 || !CheckHex(strAddr))
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Incorrect address");
 
-        addrAccount = dev::Address(strAddr);
-        if(!globalState->addressInUse(addrAccount))
+        call.addrContract = dev::Address(strAddr);
+        if(!state.addressInUse(call.addrContract))
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
     }
+    call.opcode = ParseHex(data);
 
-    dev::Address senderAddress;
-    if(!params[2].isNull()){
-        CTxDestination qtumSenderAddress = DecodeDestination(params[2].get_str());
+    if(!sender.isNull()){
+        CTxDestination qtumSenderAddress = DecodeDestination(sender.get_str());
         if (IsValidDestination(qtumSenderAddress)) {
             PKHash keyid = std::get<PKHash>(qtumSenderAddress);
-            senderAddress = dev::Address(HexStr(valtype(keyid.begin(),keyid.end())));
+            call.sender = dev::Address(HexStr(valtype(keyid.begin(),keyid.end())));
         }else{
-            senderAddress = dev::Address(params[2].get_str());
+            call.sender = dev::Address(sender.get_str());
         }
 
     }
-    uint64_t gasLimit=0;
-    if(!params[3].isNull()){
-        gasLimit = params[3].getInt<int64_t>();
+    if(!gasLimit.isNull()){
+        call.gasLimit = gasLimit.getInt<int64_t>();
     }
 
-    CAmount nAmount = 0;
-    if (!params[4].isNull()){
-        nAmount = AmountFromValue(params[4]);
-        if (nAmount < 0)
+    if (!amount.isNull()){
+        call.nAmount = AmountFromValue(amount);
+        if (call.nAmount < 0)
             throw JSONRPCError(RPC_TYPE_ERROR, "Invalid amount for send");
     }
+    return call;
+}
 
-
-    std::vector<ResultExecute> execResults = CallContract(addrAccount, ParseHex(data), chainman.ActiveChainstate(), senderAddress, gasLimit, nAmount);
-
+static UniValue CallResultToJSON(const std::string& strAddr, const std::vector<ResultExecute>& execResults, ChainstateManager &chainman)
+{
     if(fRecordLogOpcodes){
+        LOCK(cs_main);
         writeVMlog(execResults, chainman.ActiveChain());
     }
 
@@ -105,6 +105,83 @@ UniValue CallToContract(const UniValue& params, ChainstateManager &chainman)
     return result;
 }
 
+UniValue CallToContract(const UniValue& params, ChainstateManager &chainman)
+{
+    // The call runs on a snapshot of the tip and does not hold cs_main
+    std::shared_ptr<const ContractCallSnapshot> snapshot = GetContractCallSnapshot(chainman.ActiveChainstate());
+
+    ContractCall call = ParseContractCall(params[0], params[1], params[2], params[3], params[4], *snapshot->view.makeState());
+
+    std::vector<std::vector<ResultExecute>> execResults = CallContracts({call}, *snapshot);
+    if(execResults[0].empty())
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "The call could not be executed");
+
+    return CallResultToJSON(params[0].get_str(), execResults[0], chainman);
+}
+
+UniValue CallToContracts(const UniValue& params, ChainstateManager &chainman)
+{
+    const UniValue& list = params[0].get_array();
+    if(list.size() > MAX_CALLCONTRACT_BATCH)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("At most %d calls can be batched", MAX_CALLCONTRACT_BATCH));
+
+    std::shared_ptr<const ContractCallSnapshot> snapshot = GetContractCallSnapshot(chainman.ActiveChainstate());
+    std::unique_ptr<QtumState> state = snapshot->view.makeState();
+
+    std::vector<ContractCall> calls;
+    for(size_t i = 0; i < list.size(); i++)
+    {
+        const UniValue& entry = list[i].get_obj();
+        RPCTypeCheckObj(entry,
+            {
+                {"address", UniValueType(UniValue::VSTR)},
+                {"data", UniValueType(UniValue::VSTR)},
+            }, false, false);
+        RPCTypeCheckObj(entry,
+            {
+                {"address", UniValueType(UniValue::VSTR)},
+                {"data", UniValueType(UniValue::VSTR)},
+                {"senderaddress", UniValueType(UniValue::VSTR)},
+                {"gaslimit", UniValueType(UniValue::VNUM)},
+                {"amount", UniValueType()},
+            }, true, true);
+        calls.push_back(ParseContractCall(find_value(entry, "address"), find_value(entry, "data"), find_value(entry, "senderaddress"), find_value(entry, "gaslimit"), find_value(entry, "amount"), *state));
+    }
+
+    std::vector<std::vector<ResultExecute>> execResults = CallContracts(calls, *snapshot);
+
+    UniValue result(UniValue::VARR);
+    for(size_t i = 0; i < calls.size(); i++)
+    {
+        if(execResults[i].empty())
+            throw JSONRPCError(RPC_INTERNAL_ERROR, strprintf("Call %d could not be executed", i));
+        result.push_back(CallResultToJSON(find_value(list[i], "address").get_str(), execResults[i], chainman));
+    }
+    return result;
+}
+
+UniValue EstimateContractGas(const UniValue& params, ChainstateManager &chainman)
+{
+    std::shared_ptr<const ContractCallSnapshot> snapshot = GetContractCallSnapshot(chainman.ActiveChainstate());
+
+    ContractCall call = ParseContractCall(params[0], params[1], params[2], params[3], params[4], *snapshot->view.makeState());
+
+    std::optional<GasEstimate> estimate = EstimateGas(call, *snapshot);
+    if(!estimate)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "The call could not be executed");
+
+    const dev::eth::ExecutionResult& exRes = estimate->result.execRes;
+    if(estimate->gasLimit == 0)
+        throw JSONRPCError(RPC_MISC_ERROR, strprintf("The call fails with the highest gas limit: %s", exceptedMessage(exRes.excepted, exRes.output)));
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("address", params[0].get_str());
+    result.pushKV("gasLimit", estimate->gasLimit);
+    result.pushKV("executionResult", executionResultToJSON(exRes));
+    result.pushKV("cached", estimate->trials == 0);
+    return result;
+}
+
 void assignJSON(UniValue& entry, const TransactionReceiptInfo& resExec) {
     entry.pushKV("blockHash", resExec.blockHash.GetHex());
     entry.pushKV("blockNumber", uint64_t(resExec.blockNumber));
@@ -310,7 +387,96 @@ private:
 
 };
 
-UniValue SearchLogs(const UniValue& _params, ChainstateManager &chainman)
+int ReadLogHeightIndex(int low, int high, int minconf, std::vector<std::vector<uint256>> &blocksOfHashes,
+        std::set<dev::h160> const &addresses, std::vector<boost::optional<dev::h256>> const &topics,
+        ChainstateManager &chainman)
+{
+    AssertLockHeld(cs_main);
+
+    CQtumIndexDB& qtumIndex = *chainman.m_blockman.m_qtum_index_db;
+    if (!g_logindex || (high < low && high > -1) || (high == 0 && low == 0) || (high < -1 || low < 0)) {
+        return qtumIndex.ReadHeightIndex(low, high, minconf, blocksOfHashes, addresses, chainman);
+    }
+
+    CChain& active = chainman.ActiveChain();
+    int stop = high == -1 ? active.Height() : std::min(high, active.Height());
+    if (minconf > 0) {
+        stop = std::min(stop, active.Height() - minconf);
+    }
+
+    // The index can only be trusted up to the point it shares with the active chain
+    int indexed = -1;
+    const CBlockIndex* indexBest = chainman.m_blockman.LookupBlockIndex(g_logindex->GetSummary().best_block_hash);
+    if (indexBest) {
+        const CBlockIndex* fork = active.FindFork(indexBest);
+        indexed = fork ? fork->nHeight : -1;
+    }
+
+    std::vector<dev::h256> filterTopics;
+    for (const auto& topic : topics) {
+        if (topic) {
+            filterTopics.push_back(topic.get());
+        }
+    }
+
+    int curheight = 0;
+    std::vector<int> heights;
+    std::vector<uint256> hashes;
+    // The genesis block has no logs and can not be queried on its own from the height index
+    int indexStart = std::max(low, 1);
+    int indexStop = std::min(stop, indexed);
+    if (indexStart <= indexStop && g_logindex->FindBlocks(indexStart, indexStop, addresses, filterTopics, heights, hashes, curheight)) {
+        for (int height : heights) {
+            qtumIndex.ReadHeightIndex(height, height, 0, blocksOfHashes, addresses, chainman);
+        }
+    } else {
+        curheight = 0;
+        indexed = std::max(low, 1) - 1;
+    }
+
+    // Blocks the index has not caught up with yet are read from the height index
+    int remainingStart = std::max(std::max(low, 1), indexed + 1);
+    if (remainingStart <= stop) {
+        int remainingHeight = qtumIndex.ReadHeightIndex(remainingStart, stop, 0, blocksOfHashes, addresses, chainman);
+        if (remainingHeight > 0) {
+            curheight = remainingHeight;
+        }
+    }
+
+    return curheight;
+}
+
+bool MatchLogTopics(const TransactionReceiptInfo& receipt, const std::vector<boost::optional<dev::h256>>& topics)
+{
+    if (topics.empty()) {
+        return true;
+    }
+
+    for (size_t i = 0; i < topics.size(); i++) {
+        const auto& tc = topics[i];
+
+        if (!tc) {
+            continue;
+        }
+
+        for (const auto& log: receipt.logs) {
+            auto filterTopicContent = tc.get();
+
+            if (i >= log.topics.size()) {
+                continue;
+            }
+
+            if (filterTopicContent == log.topics[i]) {
+                return true;
+            }
+        }
+    }
+
+    // None of the topics are matched
+    return false;
+}
+
+void SearchLogs(const UniValue& _params, ChainstateManager &chainman, RPCResultWriter& writer)
 {
     if(!fLogEvents)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Events indexing disabled");
@@ -323,13 +489,13 @@ UniValue SearchLogs(const UniValue& _params, ChainstateManager &chainman)
 
     std::vector<std::vector<uint256>> hashesToBlock;
 
-    curheight = chainman.m_blockman.m_block_tree_db->ReadHeightIndex(params.fromBlock, params.toBlock, params.minconf, hashesToBlock, params.addresses, chainman);
+    curheight = ReadLogHeightIndex(params.fromBlock, params.toBlock, params.minconf, hashesToBlock, params.addresses, params.topics, chainman);
 
     if (curheight == -1) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Incorrect params");
     }
 
-    UniValue result(UniValue::VARR);
+    writer.BeginArray();
 
     auto topics = params.topics;
 
@@ -352,40 +518,143 @@ UniValue SearchLogs(const UniValue& _params, ChainstateManager &chainman)
                     continue;
                 }
 
-                if (!topics.empty()) {
-                    for (size_t i = 0; i < topics.size(); i++) {
-                        const auto& tc = topics[i];
+                // Skip the log if none of the topics are matched
+                if(!MatchLogTopics(receipt, topics)) {
+                    continue;
+                }
 
-                        if (!tc) {
-                            continue;
-                        }
+                UniValue tri(UniValue::VOBJ);
+                transactionReceiptInfoToJSON(receipt, tri);
+                writer.Value(tri);
+            }
+        }
+    }
 
-                        for (const auto& log: receipt.logs) {
-                            auto filterTopicContent = tc.get();
+    writer.EndArray();
+}
 
-                            if (i >= log.topics.size()) {
-                                continue;
-                            }
+UniValue SearchLogs(const UniValue& params, ChainstateManager &chainman)
+{
+    RPCResultWriter writer;
+    SearchLogs(params, chainman, writer);
+    return writer.Finish();
+}
 
-                            if (filterTopicContent == log.topics[i]) {
-                                goto push;
-                            }
-                        }
+bool SearchLogsPage(int toBlock, int minconf, const std::set<dev::h160>& addresses, const std::vector<boost::optional<dev::h256>>& topics,
+        const SearchLogsCursor& cursor, size_t limit, ChainstateManager& chainman,
+        std::vector<TransactionReceiptInfo>& receipts, std::optional<SearchLogsCursor>& next)
+{
+    next.reset();
+    int height = cursor.height;
+    while (!next && height <= toBlock) {
+        // cs_main is only held for a bounded number of blocks at a time, so that block validation
+        // is not stalled by wide searches
+        std::vector<std::pair<SearchLogsCursor, TransactionReceiptInfo>> found;
+        int stop = std::min(toBlock, height + SEARCHLOGS_PAGE_BLOCKS - 1);
+        {
+            LOCK(cs_main);
+            if (height > chainman.ActiveChain().Height() - minconf) {
+                break;
+            }
+            std::vector<std::vector<uint256>> hashesToBlock;
+            if (ReadLogHeightIndex(height, stop, minconf, hashesToBlock, addresses, topics, chainman) == -1) {
+                return false;
+            }
+
+            std::set<uint256> dupes;
+            for (const auto& hashesTx : hashesToBlock) {
+                for (const auto& e : hashesTx) {
+                    if (!dupes.insert(e).second) {
+                        continue;
                     }
 
-                    // Skip the log if none of the topics are matched
-                    continue;
+                    for (const auto& receipt : pstorageresult->getResult(uintToh256(e))) {
+                        // Receipts of blocks that have been reorganized out of the active chain are skipped
+                        const CBlockIndex* pindex = chainman.ActiveChain()[receipt.blockNumber];
+                        if (!pindex || pindex->GetBlockHash() != receipt.blockHash) {
+                            continue;
+                        }
+                        if (receipt.logs.empty() || !MatchLogTopics(receipt, topics)) {
+                            continue;
+                        }
+                        SearchLogsCursor position{receipt.blockNumber, receipt.transactionIndex, receipt.outputIndex};
+                        if (position < cursor) {
+                            continue;
+                        }
+                        found.emplace_back(position, receipt);
+                    }
                 }
+            }
+        }
+
+        std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (auto& [position, receipt] : found) {
+            if (receipts.size() == limit) {
+                next = position;
+                break;
+            }
+            receipts.push_back(std::move(receipt));
+        }
+        height = stop + 1;
+    }
+    return true;
+}
 
-            push:
+UniValue SearchLogsPage(const UniValue& _params, ChainstateManager &chainman)
+{
+    if(!fLogEvents)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Events indexing disabled");
 
-                UniValue tri(UniValue::VOBJ);
-                transactionReceiptInfoToJSON(receipt, tri);
-                result.push_back(tri);
+    SearchLogsParams params(_params);
+
+    const UniValue& options = _params[5];
+    size_t limit = DEFAULT_SEARCHLOGS_PAGE_SIZE;
+    SearchLogsCursor cursor;
+    cursor.height = params.fromBlock;
+    if (!options.isNull()) {
+        RPCTypeCheckObj(options,
+            {
+                {"limit", UniValueType(UniValue::VNUM)},
+                {"cursor", UniValueType(UniValue::VSTR)},
+            }, true, true);
+        limit = parseUInt(options["limit"], DEFAULT_SEARCHLOGS_PAGE_SIZE);
+        if (limit == 0 || limit > MAX_SEARCHLOGS_PAGE_SIZE) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("limit must be between 1 and %d", MAX_SEARCHLOGS_PAGE_SIZE));
+        }
+        if (options.exists("cursor")) {
+            const std::string& cursorStr = options["cursor"].get_str();
+            std::vector<unsigned char> cursorData = ParseHex(cursorStr);
+            if (!IsHex(cursorStr) || cursorData.size() != 3 * sizeof(uint32_t)) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+            }
+            CDataStream ss(cursorData, SER_NETWORK, PROTOCOL_VERSION);
+            ss >> cursor;
+            if (cursor.height < params.fromBlock) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor is outside of the block range");
             }
         }
     }
 
+    std::vector<TransactionReceiptInfo> found;
+    std::optional<SearchLogsCursor> next;
+    if (!SearchLogsPage(params.toBlock, params.minconf, params.addresses, params.topics, cursor, limit, chainman, found, next)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Incorrect params");
+    }
+
+    UniValue receipts(UniValue::VARR);
+    for (const TransactionReceiptInfo& receipt : found) {
+        UniValue tri(UniValue::VOBJ);
+        transactionReceiptInfoToJSON(receipt, tri);
+        receipts.push_back(tri);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("receipts", receipts);
+    if (next) {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << *next;
+        result.pushKV("cursor", HexStr(MakeUCharSpan(ss)));
+    }
     return result;
 }
 
@@ -472,10 +741,73 @@ bool CallToken::exec(const bool &sendTo, const std::map<std::string, std::string
     return true;
 }
 
+/**
+ * Read the token events of [fromBlock, toBlock] from the QRC20 index, up to the point it shares with
+ * the active chain. Returns whether the whole range was read, otherwise searchFrom is set to the
+ * first height that still has to be searched in the logs.
+ */
+static bool ReadQrc20Index(const int64_t &fromBlock, const int64_t &toBlock, const int64_t &minconf, const std::string &eventName, const std::string &contractAddress, const std::string &senderAddress, std::vector<TokenEvent> &result, int64_t &searchFrom, ChainstateManager &chainman)
+{
+    searchFrom = fromBlock;
+    if(!g_qrc20index || fromBlock < 0 || (toBlock > -1 && toBlock < fromBlock))
+        return false;
+    if(contractAddress.size() != 40 || !CheckHex(contractAddress) || senderAddress.size() != 64 || !CheckHex(senderAddress))
+        return false;
+
+    dev::h256 eventTopic(eventName);
+    bool burn = eventTopic == QRC20_BURN_TOPIC;
+    if(!burn && eventTopic != QRC20_TRANSFER_TOPIC)
+        return false;
+
+    int stop, indexed = -1;
+    {
+        LOCK(cs_main);
+        CChain& active = chainman.ActiveChain();
+        stop = toBlock < 0 ? active.Height() : std::min<int64_t>(toBlock, active.Height());
+        if(minconf > 0)
+            stop = std::min<int64_t>(stop, active.Height() - minconf);
+
+        // The index can only be trusted up to the point it shares with the active chain
+        const CBlockIndex* indexBest = chainman.m_blockman.LookupBlockIndex(g_qrc20index->GetSummary().best_block_hash);
+        if(indexBest)
+        {
+            const CBlockIndex* fork = active.FindFork(indexBest);
+            indexed = fork ? fork->nHeight : -1;
+        }
+    }
+
+    int indexStop = std::min(stop, indexed);
+    std::vector<Qrc20Transfer> transfers;
+    if(fromBlock > indexStop || !g_qrc20index->FindTransfers(dev::h160(contractAddress), dev::h160(senderAddress.substr(24)), burn, fromBlock, indexStop, transfers))
+        return false;
+
+    for(const Qrc20Transfer& transfer : transfers)
+    {
+        TokenEvent tokenEvent;
+        tokenEvent.address = dev::h160(contractAddress).hex();
+        QtumToken::ToQtumAddress(transfer.from.hex(), tokenEvent.sender);
+        if(!burn)
+            QtumToken::ToQtumAddress(transfer.to.hex(), tokenEvent.receiver);
+        tokenEvent.blockHash = transfer.block_hash;
+        tokenEvent.blockNumber = transfer.height;
+        tokenEvent.transactionHash = transfer.txid;
+        tokenEvent.value = transfer.amount;
+        result.push_back(tokenEvent);
+    }
+
+    searchFrom = indexStop + 1;
+    return indexStop == stop;
+}
+
 bool CallToken::execEvents(const int64_t &fromBlock, const int64_t &toBlock, const int64_t& minconf, const std::string &eventName, const std::string &contractAddress, const std::string &senderAddress, const int &numTopics, std::vector<TokenEvent> &result)
 {
+    // Blocks the QRC20 index has not caught up with yet are searched in the logs
+    int64_t searchFrom;
+    if(ReadQrc20Index(fromBlock, toBlock, minconf, eventName, contractAddress, senderAddress, result, searchFrom, chainman))
+        return true;
+
     UniValue resultVar;
-    if(!searchTokenTx(fromBlock, toBlock, minconf, eventName, contractAddress, senderAddress, numTopics, resultVar))
+    if(!searchTokenTx(searchFrom, toBlock, minconf, eventName, contractAddress, senderAddress, numTopics, resultVar))
         return false;
 
     const UniValue& list = resultVar.get_array();
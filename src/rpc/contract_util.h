@@ -5,11 +5,72 @@
 #include <validation.h>
 #include <qtum/qtumtoken.h>
 
+#include <optional>
+#include <tuple>
+
 class ChainstateManager;
+class RPCResultWriter;
 
 UniValue CallToContract(const UniValue& params, ChainstateManager &chainman);
 
+/** Maximum number of calls of one callcontractbatch request */
+static const size_t MAX_CALLCONTRACT_BATCH = 1000;
+
+UniValue CallToContracts(const UniValue& params, ChainstateManager &chainman);
+
+/** The lowest gas limit of a callcontract call, see EstimateGas */
+UniValue EstimateContractGas(const UniValue& params, ChainstateManager &chainman);
+
 UniValue SearchLogs(const UniValue& params, ChainstateManager &chainman);
+/** SearchLogs, writing the receipts one at a time */
+void SearchLogs(const UniValue& params, ChainstateManager &chainman, RPCResultWriter& writer);
+
+/** Default and maximum number of receipts returned by one page of searchlogspage */
+static const size_t DEFAULT_SEARCHLOGS_PAGE_SIZE = 100;
+static const size_t MAX_SEARCHLOGS_PAGE_SIZE = 10000;
+/** Number of blocks searched while holding cs_main by searchlogspage */
+static const int SEARCHLOGS_PAGE_BLOCKS = 1000;
+
+/** Position of a receipt in the chain, the continuation cursor of SearchLogsPage */
+struct SearchLogsCursor {
+    uint32_t height{0};
+    uint32_t transactionIndex{0};
+    uint32_t outputIndex{0};
+
+    SERIALIZE_METHODS(SearchLogsCursor, obj) { READWRITE(obj.height, obj.transactionIndex, obj.outputIndex); }
+
+    bool operator<(const SearchLogsCursor& other) const {
+        return std::tie(height, transactionIndex, outputIndex) < std::tie(other.height, other.transactionIndex, other.outputIndex);
+    }
+};
+
+/**
+ * Append to receipts at most limit receipts with logs matching the addresses and topics, from the cursor
+ * to toBlock in chain order. next is set to the position of the first matching receipt left out, and is
+ * empty when the search is complete. cs_main is released between the block ranges searched.
+ * Returns false if the block range is invalid.
+ */
+bool SearchLogsPage(int toBlock, int minconf, const std::set<dev::h160>& addresses, const std::vector<boost::optional<dev::h256>>& topics,
+        const SearchLogsCursor& cursor, size_t limit, ChainstateManager& chainman,
+        std::vector<TransactionReceiptInfo>& receipts, std::optional<SearchLogsCursor>& next) LOCKS_EXCLUDED(cs_main);
+
+/**
+ * Paginated variant of SearchLogs, with an options object as 6th parameter holding the
+ * maximum number of receipts to return and the cursor returned by the previous page.
+ * cs_main is released between the block ranges searched for a page.
+ */
+UniValue SearchLogsPage(const UniValue& params, ChainstateManager &chainman);
+
+/**
+ * Same as CQtumIndexDB::ReadHeightIndex, but skips the blocks that the log index
+ * (if enabled) shows cannot have logs matching the addresses and topics.
+ */
+int ReadLogHeightIndex(int low, int high, int minconf, std::vector<std::vector<uint256>> &blocksOfHashes,
+        std::set<dev::h160> const &addresses, std::vector<boost::optional<dev::h256>> const &topics,
+        ChainstateManager &chainman) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+/** Whether a log entry of the receipt has one of the topics that are set, at the same position */
+bool MatchLogTopics(const TransactionReceiptInfo& receipt, const std::vector<boost::optional<dev::h256>>& topics);
 
 void assignJSON(UniValue& entry, const TransactionReceiptInfo& resExec);
 
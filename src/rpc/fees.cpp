@@ -14,6 +14,7 @@
 #include <txmempool.h>
 #include <univalue.h>
 #include <util/fees.h>
+#include <validation.h>
 
 #include <algorithm>
 #include <array>
@@ -97,6 +98,75 @@ static RPCHelpMan estimatesmartfee()
     };
 }
 
+static RPCHelpMan estimategasprice()
+{
+    return RPCHelpMan{"estimategasprice",
+        "\nEstimates the approximate gas price needed for a contract transaction to begin\n"
+        "confirmation within conf_target blocks if possible and return the number of blocks\n"
+        "for which the estimate is valid. The estimate is based on the confirmation times of\n"
+        "the contract transactions seen in the mempool, by the gas price of their contract outputs.\n",
+        {
+            {"conf_target", RPCArg::Type::NUM, RPCArg::Optional::NO, "Confirmation target in blocks (1 - 1008)"},
+            {"estimate_mode", RPCArg::Type::STR, RPCArg::Default{"conservative"}, "The fee estimate mode, as for estimatesmartfee. Must be one of (case insensitive):\n"
+             "\"" + FeeModes("\"\n\"") + "\""},
+        },
+        RPCResult{
+            RPCResult::Type::OBJ, "", "",
+            {
+                {RPCResult::Type::NUM, "gasprice", /*optional=*/true, "estimate gas price in " + CURRENCY_UNIT + " per gas, not below the current minimum gas price (only present if no errors were encountered)"},
+                {RPCResult::Type::ARR, "errors", /*optional=*/true, "Errors encountered during processing (if there are any)",
+                    {
+                        {RPCResult::Type::STR, "", "error"},
+                    }},
+                {RPCResult::Type::NUM, "blocks", "block number where estimate was found\n"
+                "The request target will be clamped between 2 and the highest target\n"
+                "fee estimation is able to return based on how long it has been running.\n"
+                "An error is returned if not enough contract transactions and blocks\n"
+                "have been observed to make an estimate for any number of blocks."},
+        }},
+        RPCExamples{
+            HelpExampleCli("estimategasprice", "6") +
+            HelpExampleRpc("estimategasprice", "6")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+        {
+            CBlockPolicyEstimator& fee_estimator = EnsureAnyFeeEstimator(request.context);
+            ChainstateManager& chainman = EnsureAnyChainman(request.context);
+
+            unsigned int max_target = fee_estimator.HighestTargetTracked(FeeEstimateHorizon::LONG_HALFLIFE);
+            unsigned int conf_target = ParseConfirmTarget(request.params[0], max_target);
+            bool conservative = true;
+            if (!request.params[1].isNull()) {
+                FeeEstimateMode fee_mode;
+                if (!FeeModeFromString(request.params[1].get_str(), fee_mode)) {
+                    throw JSONRPCError(RPC_INVALID_PARAMETER, InvalidEstimateModeErrorMessage());
+                }
+                if (fee_mode == FeeEstimateMode::ECONOMICAL) conservative = false;
+            }
+
+            UniValue result(UniValue::VOBJ);
+            UniValue errors(UniValue::VARR);
+            FeeCalculation feeCalc;
+            CAmount gasPrice{fee_estimator.estimateSmartGasPrice(conf_target, &feeCalc, conservative)};
+            if (gasPrice != 0) {
+                CAmount minGasPrice;
+                {
+                    LOCK(cs_main);
+                    QtumDGP qtumDGP(globalState.get(), chainman.ActiveChainstate(), fGettingValuesDGP);
+                    minGasPrice = CAmount(qtumDGP.getMinGasPrice(chainman.ActiveChain().Height()));
+                }
+                gasPrice = std::max(gasPrice, minGasPrice);
+                result.pushKV("gasprice", ValueFromAmount(gasPrice));
+            } else {
+                errors.push_back("Insufficient data or no gas price found");
+                result.pushKV("errors", errors);
+            }
+            result.pushKV("blocks", feeCalc.returnedTarget);
+            return result;
+        },
+    };
+}
+
 static RPCHelpMan estimaterawfee()
 {
     return RPCHelpMan{"estimaterawfee",
@@ -219,6 +289,7 @@ void RegisterFeeRPCCommands(CRPCTable& t)
 {
     static const CRPCCommand commands[]{
         {"util", &estimatesmartfee},
+        {"util", &estimategasprice},
         {"hidden", &estimaterawfee},
     };
     for (const auto& c : commands) {
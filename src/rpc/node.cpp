@@ -4,21 +4,30 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chainparams.h>
+#include <dbwrapper.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
+#include <index/blockstatsindex.h>
 #include <index/coinstatsindex.h>
+#include <index/delegationindex.h>
+#include <index/logindex.h>
+#include <index/qrc20index.h>
 #include <index/txindex.h>
 #include <interfaces/chain.h>
 #include <interfaces/echo.h>
 #include <interfaces/init.h>
 #include <interfaces/ipc.h>
 #include <kernel/cs_main.h>
+#include <node/cachetuner.h>
 #include <node/context.h>
 #include <rpc/server.h>
 #include <rpc/server_util.h>
 #include <rpc/util.h>
 #include <scheduler.h>
+#include <sync.h>
 #include <univalue.h>
+#include <util/allocstats.h>
 #include <util/check.h>
 #include <util/syscall_sandbox.h>
 #include <util/system.h>
@@ -31,6 +40,7 @@
 #include <malloc.h>
 #endif
 
+using node::GetNodeCaches;
 using node::NodeContext;
 
 static RPCHelpMan setmocktime()
@@ -166,7 +176,8 @@ static RPCHelpMan getmemoryinfo()
                 {
                     {"mode", RPCArg::Type::STR, RPCArg::Default{"stats"}, "determines what kind of information is returned.\n"
             "  - \"stats\" returns general statistics about memory usage in the daemon.\n"
-            "  - \"mallocinfo\" returns an XML string describing low-level heap state (only available if compiled with glibc 2.10+)."},
+            "  - \"mallocinfo\" returns an XML string describing low-level heap state (only available if compiled with glibc 2.10+).\n"
+            "  - \"allocs\" returns the heap allocations made by each subsystem since the start (only available if compiled with --enable-alloc-tracking)."},
                 },
                 {
                     RPCResult{"mode \"stats\"",
@@ -186,6 +197,16 @@ static RPCHelpMan getmemoryinfo()
                     RPCResult{"mode \"mallocinfo\"",
                         RPCResult::Type::STR, "", "\"<malloc version=\"1\">...\""
                     },
+                    RPCResult{"mode \"allocs\"",
+                        RPCResult::Type::OBJ_DYN, "", "keys are the subsystems, \"other\" counting the allocations outside of the tagged ones",
+                        {
+                            {RPCResult::Type::OBJ, "subsystem", "",
+                            {
+                                {RPCResult::Type::NUM, "count", "Number of allocations"},
+                                {RPCResult::Type::NUM, "bytes", "Number of bytes allocated, not deducting the ones freed"},
+                            }},
+                        }
+                    },
                 },
                 RPCExamples{
                     HelpExampleCli("getmemoryinfo", "")
@@ -204,6 +225,19 @@ static RPCHelpMan getmemoryinfo()
 #else
         throw JSONRPCError(RPC_INVALID_PARAMETER, "mallocinfo mode not available");
 #endif
+    } else if (mode == "allocs") {
+        if (!ALLOC_TRACKING) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "allocs mode not available");
+        }
+        const auto stats{GetAllocStats()};
+        UniValue obj(UniValue::VOBJ);
+        for (size_t i = 0; i < stats.size(); ++i) {
+            UniValue entry(UniValue::VOBJ);
+            entry.pushKV("count", stats[i].count);
+            entry.pushKV("bytes", stats[i].bytes);
+            obj.pushKV(AllocTagName(AllocTag(i)), entry);
+        }
+        return obj;
     } else {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "unknown mode " + mode);
     }
@@ -289,6 +323,141 @@ static RPCHelpMan logging()
     };
 }
 
+static UniValue LockHistogramToJSON(const std::array<uint64_t, LockSiteStats::BUCKETS>& histogram)
+{
+    UniValue ret(UniValue::VARR);
+    for (uint64_t count : histogram) {
+        ret.push_back(count);
+    }
+    return ret;
+}
+
+static RPCHelpMan getlockstats()
+{
+    const std::string histogram_doc{strprintf("Count of the durations under 1, 2, 4, ... microseconds, the last of the %u buckets counting the longer ones", LockSiteStats::BUCKETS)};
+    return RPCHelpMan{"getlockstats",
+                "Returns the wait and hold times of the locks, per source location taking them, by decreasing total hold time.\n"
+                "Nothing is recorded unless the node was started with -lockstats or the recording was enabled here.\n"
+                "The hold time of a lock waited on with a condition variable includes the waits.\n",
+                {
+                    {"reset", RPCArg::Type::BOOL, RPCArg::Default{false}, "Clear the stats after returning them"},
+                    {"enable", RPCArg::Type::BOOL, RPCArg::Optional::OMITTED, "Start (true) or stop (false) the recording"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::BOOL, "enabled", "Whether the recording is enabled"},
+                        {RPCResult::Type::ARR, "locks", "",
+                        {
+                            {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::STR, "name", "The expression of the locked mutex"},
+                                {RPCResult::Type::STR, "file", "The source file taking the lock"},
+                                {RPCResult::Type::NUM, "line", "The source line taking the lock"},
+                                {RPCResult::Type::NUM, "count", "Number of acquisitions"},
+                                {RPCResult::Type::NUM, "contended", "Number of acquisitions that waited for another holder"},
+                                {RPCResult::Type::NUM, "wait_us", "Total time waited, in microseconds"},
+                                {RPCResult::Type::NUM, "max_wait_us", "Longest wait, in microseconds"},
+                                {RPCResult::Type::NUM, "hold_us", "Total time held, in microseconds"},
+                                {RPCResult::Type::NUM, "max_hold_us", "Longest hold, in microseconds"},
+                                {RPCResult::Type::ARR_FIXED, "wait_histogram", histogram_doc, {{RPCResult::Type::NUM, "", ""}}},
+                                {RPCResult::Type::ARR_FIXED, "hold_histogram", histogram_doc, {{RPCResult::Type::NUM, "", ""}}},
+                            }},
+                        }},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("getlockstats", "")
+            + HelpExampleCli("getlockstats", "true true")
+            + HelpExampleRpc("getlockstats", "false, true")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const bool reset{!request.params[0].isNull() && request.params[0].get_bool()};
+    if (!request.params[1].isNull()) {
+        g_lock_stats = request.params[1].get_bool();
+    }
+
+    UniValue locks(UniValue::VARR);
+    for (const LockSiteStats& stats : GetLockStats()) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("name", stats.name);
+        entry.pushKV("file", stats.file);
+        entry.pushKV("line", stats.line);
+        entry.pushKV("count", stats.count);
+        entry.pushKV("contended", stats.contended);
+        entry.pushKV("wait_us", count_microseconds(stats.wait_total));
+        entry.pushKV("max_wait_us", count_microseconds(stats.wait_max));
+        entry.pushKV("hold_us", count_microseconds(stats.hold_total));
+        entry.pushKV("max_hold_us", count_microseconds(stats.hold_max));
+        entry.pushKV("wait_histogram", LockHistogramToJSON(stats.wait_histogram));
+        entry.pushKV("hold_histogram", LockHistogramToJSON(stats.hold_histogram));
+        locks.push_back(entry);
+    }
+    if (reset) ResetLockStats();
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("enabled", g_lock_stats.load());
+    result.pushKV("locks", locks);
+    return result;
+},
+    };
+}
+
+static RPCHelpMan getcacheinfo()
+{
+    return RPCHelpMan{"getcacheinfo",
+                "Returns the lookups of the signature, script execution, receipts, contract state and state database block caches since the start, and their sizes.\n"
+                "The receipts cache is only in use with -logevents. With -adaptivecaches, memory moves between the caches by their hit rates, except for the state database cache set by -statedbcache.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::BOOL, "adaptive", "Whether memory moves between the caches"},
+                        {RPCResult::Type::NUM, "budget", /*optional=*/true, "Total size of the caches in bytes, if adaptive"},
+                        {RPCResult::Type::OBJ_DYN, "caches", "",
+                        {
+                            {RPCResult::Type::OBJ, "name", "",
+                            {
+                                {RPCResult::Type::NUM, "size", "Memory the cache may use, in bytes"},
+                                {RPCResult::Type::NUM, "hits", "Lookups found in the cache"},
+                                {RPCResult::Type::NUM, "misses", "Lookups not found in the cache"},
+                                {RPCResult::Type::NUM, "evictions", "Entries dropped to make room for new ones"},
+                                {RPCResult::Type::NUM, "hitrate", "Share of the lookups found in the cache"},
+                            }},
+                        }},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("getcacheinfo", "")
+            + HelpExampleRpc("getcacheinfo", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const NodeContext& node = EnsureAnyNodeContext(request.context);
+
+    UniValue caches(UniValue::VOBJ);
+    for (const node::NodeCache& cache : GetNodeCaches()) {
+        const CacheStats stats{cache.stats()};
+        const uint64_t lookups{stats.hits + stats.misses};
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("size", (uint64_t)stats.max_bytes);
+        entry.pushKV("hits", stats.hits);
+        entry.pushKV("misses", stats.misses);
+        entry.pushKV("evictions", stats.evictions);
+        entry.pushKV("hitrate", lookups ? double(stats.hits) / lookups : 0.0);
+        caches.pushKV(cache.name, entry);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("adaptive", node.cache_tuner != nullptr);
+    if (node.cache_tuner) result.pushKV("budget", (uint64_t)node.cache_tuner->Budget());
+    result.pushKV("caches", caches);
+    return result;
+},
+    };
+}
+
 static RPCHelpMan echo(const std::string& name)
 {
     return RPCHelpMan{name,
@@ -411,6 +580,26 @@ static RPCHelpMan getindexinfo()
         result.pushKVs(SummaryToJSON(g_coin_stats_index->GetSummary(), index_name));
     }
 
+    if (g_block_stats_index) {
+        result.pushKVs(SummaryToJSON(g_block_stats_index->GetSummary(), index_name));
+    }
+
+    if (g_logindex) {
+        result.pushKVs(SummaryToJSON(g_logindex->GetSummary(), index_name));
+    }
+
+    if (g_qrc20index) {
+        result.pushKVs(SummaryToJSON(g_qrc20index->GetSummary(), index_name));
+    }
+
+    if (g_delegationindex) {
+        result.pushKVs(SummaryToJSON(g_delegationindex->GetSummary(), index_name));
+    }
+
+    if (g_addressindex) {
+        result.pushKVs(SummaryToJSON(g_addressindex->GetSummary(), index_name));
+    }
+
     ForEachBlockFilterIndex([&result, &index_name](const BlockFilterIndex& index) {
         result.pushKVs(SummaryToJSON(index.GetSummary(), index_name));
     });
@@ -420,6 +609,67 @@ static RPCHelpMan getindexinfo()
     };
 }
 
+static RPCHelpMan getdbinfo()
+{
+    return RPCHelpMan{"getdbinfo",
+                "\nReturns the write and compaction activity of one or all databases since the node started.\n"
+                "Compactions requested by the node are deferred during initial block download and shortly after a new tip.\n",
+                {
+                    {"db_name", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "Filter results for a database with a specific name."},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ_DYN, "", "", {
+                        {
+                            RPCResult::Type::OBJ, "name", "The name of the database",
+                            {
+                                {RPCResult::Type::NUM, "writes", "The number of batches written"},
+                                {RPCResult::Type::NUM, "slow_writes", "The number of batches that took more than " + ToString(count_milliseconds(DB_SLOW_WRITE)) + " ms to write"},
+                                {RPCResult::Type::NUM, "write_time", "The time spent writing batches, in seconds"},
+                                {RPCResult::Type::NUM, "write_slowdowns", "The number of writes delayed because compaction lagged behind"},
+                                {RPCResult::Type::NUM, "write_slowdown_time", "The time writes were delayed, in seconds"},
+                                {RPCResult::Type::NUM, "background_compactions", "The number of compactions and memtable flushes run by LevelDB"},
+                                {RPCResult::Type::NUM, "background_compaction_time", "The time spent in them, in seconds"},
+                                {RPCResult::Type::NUM, "compactions", "The number of compactions requested by the node that ran"},
+                                {RPCResult::Type::NUM, "compaction_time", "The time spent in them, in seconds"},
+                                {RPCResult::Type::NUM, "deferred_compactions", "The number of requested compactions that waited for validation to be idle"},
+                                {RPCResult::Type::NUM, "pending_compactions", "The number of requested compactions waiting to run"},
+                            }
+                        },
+                    },
+                },
+                RPCExamples{
+                    HelpExampleCli("getdbinfo", "")
+                  + HelpExampleRpc("getdbinfo", "")
+                  + HelpExampleCli("getdbinfo", "chainstate")
+                  + HelpExampleRpc("getdbinfo", "chainstate")
+                },
+                [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    UniValue result(UniValue::VOBJ);
+    const std::string db_name = request.params[0].isNull() ? "" : request.params[0].get_str();
+
+    for (const auto& [name, stats] : GetCompactionController().GetStats()) {
+        if (!db_name.empty() && db_name != name) continue;
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("writes", stats.writes);
+        entry.pushKV("slow_writes", stats.slow_writes);
+        entry.pushKV("write_time", Ticks<SecondsDouble>(stats.write_time));
+        entry.pushKV("write_slowdowns", stats.write_slowdowns);
+        entry.pushKV("write_slowdown_time", Ticks<SecondsDouble>(stats.write_slowdown_time));
+        entry.pushKV("background_compactions", stats.background_compactions);
+        entry.pushKV("background_compaction_time", Ticks<SecondsDouble>(stats.background_compaction_time));
+        entry.pushKV("compactions", stats.compactions);
+        entry.pushKV("compaction_time", Ticks<SecondsDouble>(stats.compaction_time));
+        entry.pushKV("deferred_compactions", stats.deferred_compactions);
+        entry.pushKV("pending_compactions", stats.pending_compactions);
+        result.pushKV(name, entry);
+    }
+
+    return result;
+},
+    };
+}
+
 static RPCHelpMan getdgpinfo()
 {
     return RPCHelpMan{"getdgpinfo",
@@ -519,6 +769,10 @@ static RPCHelpMan getblockhashes()
     std::vector<std::pair<uint256, unsigned int> > blockHashes;
     bool found = false;
 
+    if (g_addressindex) {
+        g_addressindex->BlockUntilSyncedToCurrentChain();
+    }
+
     found = GetTimestampIndex(high, low, fActiveOnly, blockHashes, chainman);
 
     if (!found) {
@@ -620,6 +874,7 @@ static RPCHelpMan getaddressdeltas()
                         },
                         {"start", RPCArg::Type::NUM, RPCArg::Optional::OMITTED, "The start block height"},
                         {"end", RPCArg::Type::NUM, RPCArg::Optional::OMITTED, "The end block height"},
+                        {"limit", RPCArg::Type::NUM, RPCArg::Optional::OMITTED, "Only return the latest limit changes of each address"},
                         {"chainInfo", RPCArg::Type::BOOL, RPCArg::Optional::OMITTED, "Include chain info in results, only applies if start and end specified"},
                     }
                 }
@@ -671,7 +926,9 @@ static RPCHelpMan getaddressdeltas()
                 HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"QD1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\"]}'")
         + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"QD1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\"]}") +
                 HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"QD1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\"], \"start\": 5000, \"end\": 5500, \"chainInfo\": true}'")
-        + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"QD1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\"], \"start\": 5000, \"end\": 5500, \"chainInfo\": true}")
+        + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"QD1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\"], \"start\": 5000, \"end\": 5500, \"chainInfo\": true}") +
+                HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"QD1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\"], \"limit\": 100}'")
+        + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"QD1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\"], \"limit\": 100}")
             },
     [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
@@ -679,6 +936,7 @@ static RPCHelpMan getaddressdeltas()
 
     UniValue startValue = find_value(request.params[0].get_obj(), "start");
     UniValue endValue = find_value(request.params[0].get_obj(), "end");
+    UniValue limitValue = find_value(request.params[0].get_obj(), "limit");
 
     UniValue chainInfo = find_value(request.params[0].get_obj(), "chainInfo");
     bool includeChainInfo = false;
@@ -698,6 +956,19 @@ static RPCHelpMan getaddressdeltas()
         if (end < start) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "End value is expected to be greater than start");
         }
+    } else if (startValue.isNum()) {
+        start = startValue.getInt<int>();
+        if (start <= 0) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Start is expected to be greater than zero");
+        }
+    }
+
+    size_t limit = 0;
+    if (limitValue.isNum()) {
+        if (limitValue.getInt<int>() <= 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be greater than zero");
+        }
+        limit = limitValue.getInt<int>();
     }
 
     std::vector<std::pair<uint256, int> > addresses;
@@ -706,17 +977,15 @@ static RPCHelpMan getaddressdeltas()
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    if (g_addressindex) {
+        g_addressindex->BlockUntilSyncedToCurrentChain();
+    }
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint256, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, chainman.m_blockman, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, chainman.m_blockman)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
+        if (!GetAddressIndex((*it).first, (*it).second, addressIndex, chainman.m_blockman, start, end, limit)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
     }
 
@@ -810,28 +1079,34 @@ static RPCHelpMan getaddressbalance()
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint256, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex, chainman.m_blockman)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
+    if (g_addressindex) {
+        g_addressindex->BlockUntilSyncedToCurrentChain();
     }
 
     CAmount balance = 0;
     CAmount received = 0;
     CAmount immature = 0;
 
-    LOCK(cs_main);
-    CChain& active_chain = chainman.ActiveChain();
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
+    // The totals are kept by the index, only the changes of the blocks that are not mature yet are read
+    int nHeight = WITH_LOCK(cs_main, return chainman.ActiveChain().Height());
+    int immatureStart = std::max(1, nHeight - Params().GetConsensus().CoinbaseMaturity(nHeight) + 1);
+    for (std::vector<std::pair<uint256, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        AddressBalance addressBalance;
+        if (!GetAddressBalance((*it).first, (*it).second, addressBalance, chainman.m_blockman)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+        balance += addressBalance.balance;
+        received += addressBalance.received;
+
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+        if (addressBalance.last_height >= immatureStart &&
+            !GetAddressIndex((*it).first, (*it).second, addressIndex, chainman.m_blockman, immatureStart)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+            if (it->first.txindex == 1)
+                immature += it->second; //immature stake outputs
         }
-        balance += it->second;
-        int nHeight = active_chain.Height();
-        if (it->first.txindex == 1 && ((nHeight - it->first.blockHeight) < Params().GetConsensus().CoinbaseMaturity(nHeight)))
-            immature += it->second; //immature stake outputs
     }
 
     UniValue result(UniValue::VOBJ);
@@ -921,6 +1196,10 @@ static RPCHelpMan getaddressutxos()
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    if (g_addressindex) {
+        g_addressindex->BlockUntilSyncedToCurrentChain();
+    }
+
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
     for (std::vector<std::pair<uint256, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
@@ -1090,6 +1369,10 @@ static RPCHelpMan getspentinfo()
     CSpentIndexKey key(txid, outputIndex);
     CSpentIndexValue value;
 
+    if (g_addressindex) {
+        g_addressindex->BlockUntilSyncedToCurrentChain();
+    }
+
     if (!GetSpentIndex(key, value, mempool, chainman.m_blockman)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
     }
@@ -1148,23 +1431,23 @@ static RPCHelpMan getaddresstxids()
     if (request.params[0].isObject()) {
         UniValue startValue = find_value(request.params[0].get_obj(), "start");
         UniValue endValue = find_value(request.params[0].get_obj(), "end");
-        if (startValue.isNum() && endValue.isNum()) {
+        if (startValue.isNum()) {
             start = startValue.getInt<int>();
+        }
+        if (startValue.isNum() && endValue.isNum()) {
             end = endValue.getInt<int>();
         }
     }
 
+    if (g_addressindex) {
+        g_addressindex->BlockUntilSyncedToCurrentChain();
+    }
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint256, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, chainman.m_blockman, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, chainman.m_blockman)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
+        if (!GetAddressIndex((*it).first, (*it).second, addressIndex, chainman.m_blockman, start, end)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
     }
 
@@ -1269,8 +1552,11 @@ void RegisterNodeRPCCommands(CRPCTable& t)
     static const CRPCCommand commands[]{
         {"control", &getmemoryinfo},
         {"control", &logging},
+        {"control", &getlockstats},
+        {"control", &getcacheinfo},
         {"control", &getdgpinfo},
         {"util", &getindexinfo},
+        {"util", &getdbinfo},
         {"util", &getblockhashes},
         {"util", &getaddresstxids},
         {"util", &getaddressdeltas},
@@ -9,6 +9,7 @@
 #include <consensus/amount.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <index/addressindex.h>
 #include <index/txindex.h>
 #include <key_io.h>
 #include <node/blockstorage.h>
@@ -512,6 +513,9 @@ static RPCHelpMan getrawtransaction()
     int nConfirmations = 0;
     int nBlockTime = 0;
     if(fAddressIndex) {
+        if (g_addressindex) {
+            g_addressindex->BlockUntilSyncedToCurrentChain();
+        }
         LOCK(cs_main);
         node::BlockMap::iterator mi = chainman.BlockIndex().find(hash_block);
         if (mi != chainman.BlockIndex().end()) {
@@ -198,3 +198,9 @@ void JSONRPCRequest::PollPing() {}
 void JSONRPCRequest::PollCancel() {}
 
 void JSONRPCRequest::PollReply(const UniValue& result) {}
+
+bool JSONRPCRequest::PollPark(PollCheck check, std::optional<SteadyClock::time_point> deadline) { return false; }
+
+bool JSONRPCRequest::CanStream() const { return false; }
+
+void JSONRPCRequest::StreamWrite(const std::string& json) {}
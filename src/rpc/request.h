@@ -7,9 +7,12 @@
 #define BITCOIN_RPC_REQUEST_H
 
 #include <any>
+#include <functional>
+#include <optional>
 #include <string>
 
 #include <univalue.h>
+#include <util/time.h>
 
 UniValue JSONRPCRequestObj(const std::string& strMethod, const UniValue& params, const UniValue& id);
 UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const UniValue& id);
@@ -28,6 +31,13 @@ std::vector<UniValue> JSONRPCProcessBatchReply(const UniValue& in);
 class JSONRPCRequest
 {
 public:
+    /**
+     * Check of a parked long-poll call, run each time the chain tip moves.
+     * Returns the result once the call is done, std::nullopt to keep waiting.
+     * When expired is set (deadline passed, client gone or shutdown) it has to return a result.
+     */
+    using PollCheck = std::function<std::optional<UniValue>(bool expired)>;
+
     UniValue id;
     std::string strMethod;
     UniValue params;
@@ -37,6 +47,12 @@ public:
     std::string peerAddr;
     std::any context;
     bool isLongPolling = false;
+    bool isParked = false;
+    bool isStreaming = false;
+    //! Result written as JSON by an RPCResultWriter, replied instead of the returned value
+    std::optional<std::string> resultJSON;
+    PollCheck pollCheck;
+    std::optional<SteadyClock::time_point> pollDeadline;
     void *httpreq = nullptr;
 
     void parse(const UniValue& valRequest);
@@ -65,6 +81,24 @@ public:
      * Return the JSON result of a long poll request
      */
     virtual void PollReply(const UniValue& result);
+
+    /**
+     * Park a long-poll call instead of blocking the thread running it, the result is
+     * sent when check returns one. The RPC method returns right away, its return value
+     * is ignored.
+     * Returns false if the call can't be parked, the method has to wait itself then.
+     */
+    virtual bool PollPark(PollCheck check, std::optional<SteadyClock::time_point> deadline = std::nullopt);
+
+    /**
+     * Whether the result can be sent in chunks while it is written, see RPCResultWriter.
+     */
+    virtual bool CanStream() const;
+
+    /**
+     * Send the next piece of the result JSON, the first call starts the chunked reply.
+     */
+    virtual void StreamWrite(const std::string& json);
 };
 
 #endif // BITCOIN_RPC_REQUEST_H
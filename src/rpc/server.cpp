@@ -10,14 +10,19 @@
 #include <sync.h>
 #include <util/strencodings.h>
 #include <util/string.h>
+#include <util/metrics.h>
 #include <util/system.h>
 #include <util/time.h>
 #include <httpserver.h>
 
 #include <boost/signals2/signal.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
+#include <exception>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
@@ -49,13 +54,19 @@ static RPCServerInfo g_rpc_server_info;
 struct RPCCommandExecution
 {
     std::list<RPCCommandExecutionInfo>::iterator it;
-    explicit RPCCommandExecution(const std::string& method)
+    SteadyClock::time_point start;
+    //! Exceptions in flight when the command started, a command unwinding with more failed
+    int uncaught_exceptions;
+    explicit RPCCommandExecution(const std::string& method) : start(SteadyClock::now()), uncaught_exceptions(std::uncaught_exceptions())
     {
         LOCK(g_rpc_server_info.mutex);
-        it = g_rpc_server_info.active_commands.insert(g_rpc_server_info.active_commands.end(), {method, SteadyClock::now()});
+        it = g_rpc_server_info.active_commands.insert(g_rpc_server_info.active_commands.end(), {method, start});
     }
     ~RPCCommandExecution()
     {
+        g_metrics.rpc_requests.Inc();
+        if (std::uncaught_exceptions() > uncaught_exceptions) g_metrics.rpc_errors.Inc();
+        g_metrics.rpc_request_time.Observe(std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - start));
         LOCK(g_rpc_server_info.mutex);
         g_rpc_server_info.active_commands.erase(it);
     }
@@ -381,6 +392,35 @@ void JSONRPCRequestLong::PollReply(const UniValue& result) {
     req()->ChunkEnd();
 }
 
+bool JSONRPCRequestLong::PollPark(PollCheck check, std::optional<SteadyClock::time_point> deadline) {
+    assert(!isParked);
+    pollCheck = std::move(check);
+    pollDeadline = deadline;
+    isParked = true;
+    return true;
+}
+
+bool JSONRPCRequestLong::CanStream() const {
+    return !isLongPolling;
+}
+
+void JSONRPCRequestLong::StreamWrite(const std::string& json) {
+    assert(!isLongPolling);
+    if (!isStreaming) {
+        req()->WriteHeader("Content-Type", "application/json");
+        req()->WriteHeader("Connection", "close");
+        req()->Chunk("{\"result\":");
+        isStreaming = true;
+    }
+    req()->Chunk(json);
+}
+
+void JSONRPCRequestLong::StreamEnd() {
+    assert(isStreaming);
+    req()->Chunk(",\"error\":null,\"id\":" + id.write() + "}\n");
+    req()->ChunkEnd();
+}
+
 HTTPRequest* JSONRPCRequestLong::req() {
     return (HTTPRequest*)httpreq;
 }
@@ -415,11 +455,50 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
+/** The calls of a batch, taken one by one by the threads executing them */
+struct BatchExecution {
+    const JSONRPCRequest& jreq;
+    const UniValue& vReq;
+    std::vector<UniValue> replies;
+    std::atomic<size_t> next{0};
+    Mutex mutex;
+    std::condition_variable cond;
+    size_t done GUARDED_BY(mutex){0};
+
+    BatchExecution(const JSONRPCRequest& _jreq, const UniValue& _vReq) : jreq(_jreq), vReq(_vReq), replies(_vReq.size()) {}
+
+    /** Execute calls until none is left. A helper that starts after the batch was
+     *  finished does not touch jreq or vReq, they are gone by then. */
+    void Run() EXCLUSIVE_LOCKS_REQUIRED(!mutex)
+    {
+        for (size_t i = next++; i < replies.size(); i = next++) {
+            replies[i] = JSONRPCExecOne(jreq, vReq[i]);
+            LOCK(mutex);
+            if (++done == replies.size()) cond.notify_all();
+        }
+    }
+};
+
+std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, const RPCBatchDispatcher& dispatch, int max_threads)
 {
+    auto batch{std::make_shared<BatchExecution>(jreq, vReq)};
+    if (dispatch) {
+        const size_t helpers{std::min<size_t>(std::max(max_threads, 1) - 1, vReq.size() ? vReq.size() - 1 : 0)};
+        for (size_t i = 0; i < helpers; ++i) {
+            if (!dispatch([batch] { batch->Run(); })) break;
+        }
+    }
+    batch->Run();
+    {
+        // Wait for the calls the helpers are still executing
+        WAIT_LOCK(batch->mutex, lock);
+        while (batch->done < batch->replies.size()) batch->cond.wait(lock);
+    }
+
     UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+    for (UniValue& reply : batch->replies) {
+        ret.push_back(std::move(reply));
+    }
 
     return ret.write() + "\n";
 }
@@ -22,6 +22,7 @@
 #include <util/system.h>
 
 static const unsigned int DEFAULT_RPC_SERIALIZE_VERSION = 1;
+static const int DEFAULT_RPC_BATCH_THREADS = 1;
 
 class CRPCCommand;
 class ChainstateManager;
@@ -63,6 +64,20 @@ public:
      */
     void PollReply(const UniValue& result) override;
 
+    /**
+     * Park the call until the chain tip moves, without holding a worker thread.
+     */
+    bool PollPark(PollCheck check, std::optional<SteadyClock::time_point> deadline) override;
+
+    bool CanStream() const override;
+
+    void StreamWrite(const std::string& json) override;
+
+    /**
+     * Close the result JSON sent by StreamWrite with the rest of the reply and end it.
+     */
+    void StreamEnd();
+
     /**
      * Return the http request
      */
@@ -216,7 +231,15 @@ extern double GetEstimatedAnnualROI(ChainstateManager& chainman);
 void StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq);
+
+/** Runs a function on another thread, returns false if no thread can take it */
+using RPCBatchDispatcher = std::function<bool(std::function<void()>)>;
+/**
+ * Execute the calls of a batch and return the replies in the order of the calls. Up to
+ * max_threads - 1 helpers are handed to dispatch to execute calls alongside the calling
+ * thread, so the calls of a batch may run concurrently and in any order.
+ */
+std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, const RPCBatchDispatcher& dispatch = nullptr, int max_threads = 1);
 
 // Retrieves any serialization flags requested in command line argument
 int RPCSerializationFlags();
@@ -578,7 +578,8 @@ UniValue RPCHelpMan::HandleRequest(const JSONRPCRequest& request) const
         throw JSONRPCError(RPC_TYPE_ERROR, strprintf("Wrong type passed:\n%s", arg_mismatch.write(4)));
     }
     UniValue ret = m_fun(*this, request);
-    if (gArgs.GetBoolArg("-rpcdoccheck", DEFAULT_RPC_DOC_CHECK)) {
+    // The result of a parked call is sent later, a written one is already JSON
+    if (!request.isParked && !request.isStreaming && !request.resultJSON && gArgs.GetBoolArg("-rpcdoccheck", DEFAULT_RPC_DOC_CHECK)) {
         UniValue mismatch{UniValue::VARR};
         for (const auto& res : m_results.m_results) {
             UniValue match{res.MatchesType(ret)};
@@ -1207,3 +1208,117 @@ void PushWarnings(const std::vector<bilingual_str>& warnings, UniValue& obj)
     if (warnings.empty()) return;
     obj.pushKV("warnings", BilingualStringsToUniValue(warnings));
 }
+
+RPCResultWriter::RPCResultWriter(const JSONRPCRequest& request)
+{
+    if (request.CanStream()) {
+        // The writer only changes how the reply is sent, like the long-poll calls
+        m_request = const_cast<JSONRPCRequest*>(&request);
+    }
+}
+
+void RPCResultWriter::Separate()
+{
+    if (m_after_key || m_empty.empty()) {
+        m_after_key = false;
+        return;
+    }
+    if (!m_empty.back()) m_json += ',';
+    m_empty.back() = false;
+}
+
+void RPCResultWriter::Add(UniValue value)
+{
+    if (m_stack.empty()) {
+        m_result = std::move(value);
+    } else if (m_stack.back().isObject()) {
+        m_stack.back().pushKV(std::move(m_key), std::move(value));
+    } else {
+        m_stack.back().push_back(std::move(value));
+    }
+}
+
+void RPCResultWriter::Begin(UniValue::VType type)
+{
+    if (!m_request) {
+        m_stack_keys.push_back(std::move(m_key));
+        m_stack.emplace_back(type);
+        return;
+    }
+    Separate();
+    m_json += type == UniValue::VOBJ ? '{' : '[';
+    m_empty.push_back(true);
+}
+
+void RPCResultWriter::End()
+{
+    if (!m_request) {
+        UniValue value{std::move(m_stack.back())};
+        m_stack.pop_back();
+        m_key = std::move(m_stack_keys.back());
+        m_stack_keys.pop_back();
+        Add(std::move(value));
+        return;
+    }
+    m_empty.pop_back();
+}
+
+void RPCResultWriter::BeginObject() { Begin(UniValue::VOBJ); }
+
+void RPCResultWriter::BeginArray() { Begin(UniValue::VARR); }
+
+void RPCResultWriter::EndObject()
+{
+    if (m_request) m_json += '}';
+    End();
+}
+
+void RPCResultWriter::EndArray()
+{
+    if (m_request) m_json += ']';
+    End();
+}
+
+void RPCResultWriter::Key(const std::string& key)
+{
+    if (!m_request) {
+        m_key = key;
+        return;
+    }
+    Separate();
+    m_json += UniValue{key}.write();
+    m_json += ':';
+    m_after_key = true;
+}
+
+void RPCResultWriter::Value(const UniValue& value)
+{
+    if (!m_request) {
+        Add(value);
+        return;
+    }
+    Separate();
+    m_json += value.write();
+    if (m_json.size() >= RPC_RESULT_CHUNK_SIZE) {
+        m_request->StreamWrite(m_json);
+        m_json.clear();
+    }
+}
+
+void RPCResultWriter::KVs(const UniValue& obj)
+{
+    for (size_t i = 0; i < obj.size(); ++i) {
+        KV(obj.getKeys()[i], obj.getValues()[i]);
+    }
+}
+
+UniValue RPCResultWriter::Finish()
+{
+    if (!m_request) return std::move(m_result);
+    if (m_request->isStreaming) {
+        m_request->StreamWrite(m_json);
+    } else {
+        m_request->resultJSON = std::move(m_json);
+    }
+    return NullUniValue;
+}
@@ -395,6 +395,63 @@ private:
     const RPCExamples m_examples;
 };
 
+/**
+ * Writes the result of an RPC method value by value. When the request can stream,
+ * the JSON is written directly and sent in chunks of RPC_RESULT_CHUNK_SIZE as it
+ * grows, so a large result is neither built as a UniValue tree nor held as a whole;
+ * smaller results are replied in one piece. Otherwise the UniValue result is built.
+ *
+ * Anything that can fail should be checked before the first value is written: once
+ * chunks were sent, an error cuts the reply short.
+ */
+class RPCResultWriter
+{
+public:
+    /** Write the result of request */
+    explicit RPCResultWriter(const JSONRPCRequest& request);
+    /** Build the result as a UniValue */
+    RPCResultWriter() = default;
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    /** Key of the next value or container, inside an object */
+    void Key(const std::string& key);
+    void Value(const UniValue& value);
+    void KV(const std::string& key, const UniValue& value)
+    {
+        Key(key);
+        Value(value);
+    }
+    /** Write the keys and values of an object into the current object */
+    void KVs(const UniValue& obj);
+
+    /** Value for the RPC method to return: the built result, or null when it was written as JSON */
+    UniValue Finish();
+
+private:
+    //! The request the JSON is written for, nullptr when building the UniValue
+    JSONRPCRequest* m_request{nullptr};
+    std::string m_json;
+    //! For each open container, whether nothing was written into it yet
+    std::vector<bool> m_empty;
+    bool m_after_key{false};
+
+    std::vector<UniValue> m_stack;
+    std::vector<std::string> m_stack_keys;
+    std::string m_key;
+    UniValue m_result;
+
+    void Begin(UniValue::VType type);
+    void End();
+    void Separate();
+    void Add(UniValue value);
+};
+
+/** Size of the chunks a streamed RPC result is sent in */
+static constexpr size_t RPC_RESULT_CHUNK_SIZE{64 * 1024};
+
 /**
  * Push warning messages to an RPC "warnings" field as a JSON array of strings.
  *
@@ -17,6 +17,11 @@
 #include <map>
 #include <thread>
 #include <utility>
+#include <vector>
+
+/** -schedulerthreads default, the validation interface callbacks of different subscribers run on them in parallel */
+static constexpr int DEFAULT_SCHEDULER_THREADS{2};
+static constexpr int MAX_SCHEDULER_THREADS{8};
 
 /**
  * Simple class for background tasks that should be run
@@ -42,6 +47,8 @@ public:
     ~CScheduler();
 
     std::thread m_service_thread;
+    //! Threads running serviceQueue besides m_service_thread, joined by stop() and StopWhenDrained()
+    std::vector<std::thread> m_extra_service_threads;
 
     typedef std::function<void()> Function;
 
@@ -79,14 +86,14 @@ public:
     {
         WITH_LOCK(newTaskMutex, stopRequested = true);
         newTaskScheduled.notify_all();
-        if (m_service_thread.joinable()) m_service_thread.join();
+        JoinServiceThreads();
     }
     /** Tell any threads running serviceQueue to stop when there is no work left to be done */
     void StopWhenDrained() EXCLUSIVE_LOCKS_REQUIRED(!newTaskMutex)
     {
         WITH_LOCK(newTaskMutex, stopWhenEmpty = true);
         newTaskScheduled.notify_all();
-        if (m_service_thread.joinable()) m_service_thread.join();
+        JoinServiceThreads();
     }
 
     /**
@@ -101,6 +108,15 @@ public:
     bool AreThreadsServicingQueue() const EXCLUSIVE_LOCKS_REQUIRED(!newTaskMutex);
 
 private:
+    void JoinServiceThreads()
+    {
+        if (m_service_thread.joinable()) m_service_thread.join();
+        for (std::thread& thread : m_extra_service_threads) {
+            if (thread.joinable()) thread.join();
+        }
+        m_extra_service_threads.clear();
+    }
+
     mutable Mutex newTaskMutex;
     std::condition_variable newTaskScheduled;
     std::multimap<std::chrono::steady_clock::time_point, Function> taskQueue GUARDED_BY(newTaskMutex);
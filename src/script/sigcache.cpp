@@ -5,14 +5,18 @@
 
 #include <script/sigcache.h>
 
+#include <primitives/transaction.h>
 #include <pubkey.h>
 #include <random.h>
 #include <uint256.h>
 #include <util/system.h>
 
+#include <crypto/common.h>
 #include <cuckoocache.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <mutex>
 #include <optional>
 #include <shared_mutex>
@@ -30,9 +34,17 @@ private:
      //! Entries are SHA256(nonce || 'E' or 'S' || 31 zero bytes || signature hash || public key || signature):
     CSHA256 m_salted_hasher_ecdsa;
     CSHA256 m_salted_hasher_schnorr;
+    //! ... and SHA256(nonce || 'O' || 31 zero bytes || wtxid || output index || flags) for the sender signatures of outputs
+    CSHA256 m_salted_hasher_sender;
+    //! ... and SHA256(nonce || 'D' || 31 zero bytes || delegate address || staker address || PoD) for the proofs of delegation
+    CSHA256 m_salted_hasher_delegation;
     typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
     map_type setValid;
     std::shared_mutex cs_sigcache;
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+    std::atomic<uint64_t> m_evictions{0};
+    std::atomic<size_t> m_bytes{0};
 
 public:
     CSignatureCache()
@@ -44,10 +56,16 @@ public:
         // 'S' for Schnorr (followed by 0 bytes).
         static constexpr unsigned char PADDING_ECDSA[32] = {'E'};
         static constexpr unsigned char PADDING_SCHNORR[32] = {'S'};
+        static constexpr unsigned char PADDING_SENDER[32] = {'O'};
+        static constexpr unsigned char PADDING_DELEGATION[32] = {'D'};
         m_salted_hasher_ecdsa.Write(nonce.begin(), 32);
         m_salted_hasher_ecdsa.Write(PADDING_ECDSA, 32);
         m_salted_hasher_schnorr.Write(nonce.begin(), 32);
         m_salted_hasher_schnorr.Write(PADDING_SCHNORR, 32);
+        m_salted_hasher_sender.Write(nonce.begin(), 32);
+        m_salted_hasher_sender.Write(PADDING_SENDER, 32);
+        m_salted_hasher_delegation.Write(nonce.begin(), 32);
+        m_salted_hasher_delegation.Write(PADDING_DELEGATION, 32);
     }
 
     void
@@ -64,21 +82,49 @@ public:
         hasher.Write(hash.begin(), 32).Write(pubkey.data(), pubkey.size()).Write(sig.data(), sig.size()).Finalize(entry.begin());
     }
 
+    void
+    ComputeEntrySender(uint256& entry, const uint256& wtxid, uint32_t n_out, uint32_t flags) const
+    {
+        unsigned char buf[8];
+        WriteLE32(buf, n_out);
+        WriteLE32(buf + 4, flags);
+        CSHA256 hasher = m_salted_hasher_sender;
+        hasher.Write(wtxid.begin(), 32).Write(buf, sizeof(buf)).Finalize(entry.begin());
+    }
+
+    void
+    ComputeEntryDelegation(uint256& entry, const uint160& address, const uint160& staker, const std::vector<unsigned char>& PoD) const
+    {
+        CSHA256 hasher = m_salted_hasher_delegation;
+        hasher.Write(address.begin(), address.size()).Write(staker.begin(), staker.size()).Write(PoD.data(), PoD.size()).Finalize(entry.begin());
+    }
+
     bool
     Get(const uint256& entry, const bool erase)
     {
         std::shared_lock<std::shared_mutex> lock(cs_sigcache);
-        return setValid.contains(entry, erase);
+        const bool found{setValid.contains(entry, erase)};
+        (found ? m_hits : m_misses).fetch_add(1, std::memory_order_relaxed);
+        return found;
     }
 
     void Set(const uint256& entry)
     {
         std::unique_lock<std::shared_mutex> lock(cs_sigcache);
-        setValid.insert(entry);
+        if (!setValid.insert(entry)) m_evictions.fetch_add(1, std::memory_order_relaxed);
     }
     std::optional<std::pair<uint32_t, size_t>> setup_bytes(size_t n)
     {
-        return setValid.setup_bytes(n);
+        std::unique_lock<std::shared_mutex> lock(cs_sigcache);
+        auto setup_results = setValid.setup_bytes(n);
+        if (setup_results) m_bytes = setup_results->second;
+        return setup_results;
+    }
+
+    CacheStats Stats() const
+    {
+        return {m_hits.load(std::memory_order_relaxed), m_misses.load(std::memory_order_relaxed),
+                m_evictions.load(std::memory_order_relaxed), m_bytes.load()};
     }
 };
 
@@ -104,6 +150,39 @@ bool InitSignatureCache(size_t max_size_bytes)
     return true;
 }
 
+CacheStats GetSignatureCacheStats()
+{
+    return signatureCache.Stats();
+}
+
+bool SenderSignatureCacheGet(const CTransaction& tx, unsigned int n_out, unsigned int flags, bool store)
+{
+    uint256 entry;
+    signatureCache.ComputeEntrySender(entry, tx.GetWitnessHash(), n_out, flags);
+    return signatureCache.Get(entry, !store);
+}
+
+void SenderSignatureCacheSet(const CTransaction& tx, unsigned int n_out, unsigned int flags)
+{
+    uint256 entry;
+    signatureCache.ComputeEntrySender(entry, tx.GetWitnessHash(), n_out, flags);
+    signatureCache.Set(entry);
+}
+
+bool DelegationProofCacheGet(const uint160& address, const uint160& staker, const std::vector<unsigned char>& PoD)
+{
+    uint256 entry;
+    signatureCache.ComputeEntryDelegation(entry, address, staker, PoD);
+    return signatureCache.Get(entry, /*erase=*/false);
+}
+
+void DelegationProofCacheSet(const uint160& address, const uint160& staker, const std::vector<unsigned char>& PoD)
+{
+    uint256 entry;
+    signatureCache.ComputeEntryDelegation(entry, address, staker, PoD);
+    signatureCache.Set(entry);
+}
+
 bool CachingTransactionSignatureChecker::VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
@@ -122,11 +201,44 @@ bool CachingTransactionSignatureChecker::VerifySchnorrSignature(Span<const unsig
     uint256 entry;
     signatureCache.ComputeEntrySchnorr(entry, sighash, sig, pubkey);
     if (signatureCache.Get(entry, !store)) return true;
+    if (m_batch) {
+        m_batch->Add(sig, pubkey, sighash, entry, store);
+        return true;
+    }
     if (!TransactionSignatureChecker::VerifySchnorrSignature(sig, pubkey, sighash)) return false;
     if (store) signatureCache.Set(entry);
     return true;
 }
 
+void BatchSchnorrVerifier::Add(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash, const uint256& cache_entry, bool store)
+{
+    assert(sig.size() == 64);
+    m_pubkeys.push_back(pubkey);
+    m_sighashes.push_back(sighash);
+    std::copy(sig.begin(), sig.end(), m_sigs.emplace_back().begin());
+    if (store) m_cache_entries.push_back(cache_entry);
+}
+
+bool BatchSchnorrVerifier::Verify()
+{
+    bool ret = XOnlyPubKey::VerifySchnorrBatch(m_pubkeys, m_sighashes, m_sigs);
+    if (!ret) {
+        // Check one by one, so that a block is only rejected for a signature VerifySchnorr rejects
+        ret = true;
+        for (size_t i = 0; i < m_pubkeys.size() && ret; ++i) {
+            ret = m_pubkeys[i].VerifySchnorr(m_sighashes[i], m_sigs[i]);
+        }
+    }
+    if (ret) {
+        for (const uint256& entry : m_cache_entries) signatureCache.Set(entry);
+    }
+    m_pubkeys.clear();
+    m_sighashes.clear();
+    m_sigs.clear();
+    m_cache_entries.clear();
+    return ret;
+}
+
 bool CachingTransactionSignatureOutputChecker::VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
@@ -6,10 +6,14 @@
 #ifndef BITCOIN_SCRIPT_SIGCACHE_H
 #define BITCOIN_SCRIPT_SIGCACHE_H
 
+#include <pubkey.h>
 #include <script/interpreter.h>
 #include <span.h>
+#include <uint256.h>
+#include <util/cachestats.h>
 #include <util/hasher.h>
 
+#include <array>
 #include <optional>
 #include <vector>
 
@@ -20,13 +24,38 @@ static constexpr size_t DEFAULT_MAX_SIG_CACHE_BYTES{32 << 20};
 
 class CPubKey;
 
+/**
+ * Schnorr signatures collected from the scripts of a block, to be verified together once
+ * the scripts ran. BIP340 signatures verified as a batch share one multi-scalar
+ * multiplication, which is cheaper than verifying them one by one. Not thread safe.
+ */
+class BatchSchnorrVerifier
+{
+public:
+    void Add(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash, const uint256& cache_entry, bool store);
+
+    /** Verify the collected signatures and forget them, storing the valid ones in the signature cache */
+    bool Verify();
+
+    size_t Size() const { return m_pubkeys.size(); }
+
+private:
+    std::vector<XOnlyPubKey> m_pubkeys;
+    std::vector<uint256> m_sighashes;
+    std::vector<std::array<unsigned char, 64>> m_sigs;
+    //! The signature cache entries to set once the batch is valid
+    std::vector<uint256> m_cache_entries;
+};
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
     bool store;
+    //! Defer the Schnorr signature checks to this batch if set
+    BatchSchnorrVerifier* m_batch;
 
 public:
-    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, PrecomputedTransactionData& txdataIn) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn, MissingDataBehavior::ASSERT_FAIL), store(storeIn) {}
+    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, PrecomputedTransactionData& txdataIn, BatchSchnorrVerifier* batch = nullptr) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn, MissingDataBehavior::ASSERT_FAIL), store(storeIn), m_batch(batch) {}
 
     bool VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
     bool VerifySchnorrSignature(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash) const override;
@@ -43,6 +72,24 @@ public:
     bool VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
 };
 
+/**
+ * Whether the sender signature of output @p n_out of @p tx verified with @p flags, as remembered
+ * in the signature cache by SenderSignatureCacheSet(). The entry is erased unless @p store, like
+ * the signatures found while connecting a block.
+ */
+bool SenderSignatureCacheGet(const CTransaction& tx, unsigned int n_out, unsigned int flags, bool store);
+void SenderSignatureCacheSet(const CTransaction& tx, unsigned int n_out, unsigned int flags);
+
+/**
+ * Whether @p PoD was verified as the proof that @p address delegates to @p staker, as remembered
+ * in the signature cache by DelegationProofCacheSet(). A proof is checked for every block its
+ * staker creates, so the entry is kept when it is found.
+ */
+bool DelegationProofCacheGet(const uint160& address, const uint160& staker, const std::vector<unsigned char>& PoD);
+void DelegationProofCacheSet(const uint160& address, const uint160& staker, const std::vector<unsigned char>& PoD);
+
+/** Set up the signature cache with @p max_size_bytes, dropping its entries if it was in use */
 [[nodiscard]] bool InitSignatureCache(size_t max_size_bytes);
+CacheStats GetSignatureCacheStats();
 
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -175,6 +175,33 @@ SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorrsig_verify(
     const secp256k1_xonly_pubkey *pubkey
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(5);
 
+/** Verify a batch of Schnorr signatures of 32-byte messages.
+ *
+ *  The signatures are checked together with one multi-scalar multiplication
+ *  of randomized linear combinations, which is faster than verifying them one
+ *  by one. The randomizers are derived from a hash of all the inputs.
+ *
+ *  Returns: 1: all signatures are correct (or n_sigs is 0)
+ *           0: at least one signature is incorrect, or the multiplication
+ *              could not be carried out; verify the signatures one by one to
+ *              find out which
+ *  Args:    ctx: a secp256k1 context object.
+ *       scratch: scratch space for the multiplication. With NULL or a space too
+ *                small for it the points are multiplied one by one.
+ *  In:    sig64: array of n_sigs pointers to 64-byte signatures
+ *         msg32: array of n_sigs pointers to the 32-byte messages
+ *        pubkey: array of n_sigs pointers to the x-only public keys to verify with
+ *        n_sigs: number of signatures
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorrsig_verify_batch(
+    const secp256k1_context *ctx,
+    secp256k1_scratch_space *scratch,
+    const unsigned char *const *sig64,
+    const unsigned char *const *msg32,
+    const secp256k1_xonly_pubkey *const *pubkey,
+    size_t n_sigs
+) SECP256K1_ARG_NONNULL(1);
+
 #ifdef __cplusplus
 }
 #endif
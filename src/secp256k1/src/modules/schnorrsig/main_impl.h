@@ -264,4 +264,117 @@ int secp256k1_schnorrsig_verify(const secp256k1_context* ctx, const unsigned cha
            secp256k1_fe_equal_var(&rx, &r.x);
 }
 
+typedef struct {
+    const secp256k1_context *ctx;
+    const unsigned char *const *sig64;
+    const unsigned char *const *msg32;
+    const secp256k1_xonly_pubkey *const *pubkey;
+    unsigned char seed[32];
+} secp256k1_schnorrsig_verify_batch_data;
+
+/* Randomizer a_i of the i-th signature. a_0 is 1, the others are hashes of the
+ * seed and i. */
+static void secp256k1_schnorrsig_batch_randomizer(secp256k1_scalar *a, const unsigned char *seed32, size_t i) {
+    unsigned char buf[32];
+    secp256k1_sha256 sha;
+    int j;
+
+    if (i == 0) {
+        secp256k1_scalar_set_int(a, 1);
+        return;
+    }
+    for (j = 0; j < 8; j++) {
+        buf[j] = (i >> (8 * j)) & 0xff;
+    }
+    secp256k1_sha256_initialize(&sha);
+    secp256k1_sha256_write(&sha, seed32, 32);
+    secp256k1_sha256_write(&sha, buf, 8);
+    secp256k1_sha256_finalize(&sha, buf);
+    secp256k1_scalar_set_b32(a, buf, NULL);
+}
+
+/* Points of the batch: -a_i*R_i at index 2*i and -a_i*e_i*P_i at index 2*i+1 */
+static int secp256k1_schnorrsig_verify_batch_cb(secp256k1_scalar *sc, secp256k1_ge *pt, size_t idx, void *cbdata) {
+    const secp256k1_schnorrsig_verify_batch_data *data = (const secp256k1_schnorrsig_verify_batch_data *)cbdata;
+    const size_t i = idx / 2;
+
+    secp256k1_schnorrsig_batch_randomizer(sc, data->seed, i);
+    if (idx % 2 == 0) {
+        secp256k1_fe rx;
+        if (!secp256k1_fe_set_b32(&rx, &data->sig64[i][0])) {
+            return 0;
+        }
+        /* R_i is the point with x coordinate r and an even y */
+        if (!secp256k1_ge_set_xo_var(pt, &rx, 0)) {
+            return 0;
+        }
+    } else {
+        unsigned char buf[32];
+        secp256k1_scalar e;
+        if (!secp256k1_xonly_pubkey_load(data->ctx, pt, data->pubkey[i])) {
+            return 0;
+        }
+        secp256k1_fe_get_b32(buf, &pt->x);
+        secp256k1_schnorrsig_challenge(&e, &data->sig64[i][0], data->msg32[i], 32, buf);
+        secp256k1_scalar_mul(sc, sc, &e);
+    }
+    secp256k1_scalar_negate(sc, sc);
+    return 1;
+}
+
+int secp256k1_schnorrsig_verify_batch(const secp256k1_context *ctx, secp256k1_scratch_space *scratch, const unsigned char *const *sig64, const unsigned char *const *msg32, const secp256k1_xonly_pubkey *const *pubkey, size_t n_sigs) {
+    secp256k1_schnorrsig_verify_batch_data data;
+    secp256k1_sha256 sha;
+    secp256k1_scalar s_sum;
+    secp256k1_gej rj;
+    size_t i;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(n_sigs == 0 || sig64 != NULL);
+    ARG_CHECK(n_sigs == 0 || msg32 != NULL);
+    ARG_CHECK(n_sigs == 0 || pubkey != NULL);
+    ARG_CHECK(n_sigs <= SIZE_MAX / 2);
+
+    if (n_sigs == 0) {
+        return 1;
+    }
+
+    /* The randomizers depend on every signature, message and key of the batch,
+     * so they cannot be known when the signatures are made. */
+    secp256k1_sha256_initialize(&sha);
+    for (i = 0; i < n_sigs; i++) {
+        ARG_CHECK(sig64[i] != NULL && msg32[i] != NULL && pubkey[i] != NULL);
+        secp256k1_sha256_write(&sha, sig64[i], 64);
+        secp256k1_sha256_write(&sha, msg32[i], 32);
+        secp256k1_sha256_write(&sha, pubkey[i]->data, sizeof(pubkey[i]->data));
+    }
+    secp256k1_sha256_finalize(&sha, data.seed);
+    data.ctx = ctx;
+    data.sig64 = sig64;
+    data.msg32 = msg32;
+    data.pubkey = pubkey;
+
+    /* s_sum = sum(a_i*s_i) */
+    secp256k1_scalar_set_int(&s_sum, 0);
+    for (i = 0; i < n_sigs; i++) {
+        secp256k1_scalar s;
+        secp256k1_scalar a;
+        int overflow;
+        secp256k1_scalar_set_b32(&s, &sig64[i][32], &overflow);
+        if (overflow) {
+            return 0;
+        }
+        secp256k1_schnorrsig_batch_randomizer(&a, data.seed, i);
+        secp256k1_scalar_mul(&s, &s, &a);
+        secp256k1_scalar_add(&s_sum, &s_sum, &s);
+    }
+
+    /* Every s_i*G = R_i + e_i*P_i holds, up to a negligible probability, if
+     * s_sum*G - sum(a_i*R_i) - sum(a_i*e_i*P_i) is the point at infinity. */
+    if (!secp256k1_ecmult_multi_var(&ctx->error_callback, scratch, &rj, &s_sum, secp256k1_schnorrsig_verify_batch_cb, &data, 2 * n_sigs)) {
+        return 0;
+    }
+    return secp256k1_gej_is_infinity(&rj);
+}
+
 #endif
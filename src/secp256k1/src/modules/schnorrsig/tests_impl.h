@@ -231,12 +231,14 @@ static void test_schnorrsig_bip_vectors_check_signing(const unsigned char *sk, c
 }
 
 /* Helper function for schnorrsig_bip_vectors
- * Checks that both verify and verify_batch (TODO) return the same value as expected. */
+ * Checks that both verify and verify_batch return the same value as expected. */
 static void test_schnorrsig_bip_vectors_check_verify(const unsigned char *pk_serialized, const unsigned char *msg32, const unsigned char *sig, int expected) {
     secp256k1_xonly_pubkey pk;
+    const secp256k1_xonly_pubkey *pk_ptr = &pk;
 
     CHECK(secp256k1_xonly_pubkey_parse(CTX, &pk, pk_serialized));
     CHECK(expected == secp256k1_schnorrsig_verify(CTX, sig, msg32, 32, &pk));
+    CHECK(expected == secp256k1_schnorrsig_verify_batch(CTX, NULL, &sig, &msg32, &pk_ptr, 1));
 }
 
 /* Test vectors according to BIP-340 ("Schnorr Signatures for secp256k1"). See
@@ -746,9 +748,8 @@ static void test_schnorrsig_sign(void) {
 }
 
 #define N_SIGS 3
-/* Creates N_SIGS valid signatures and verifies them with verify and
- * verify_batch (TODO). Then flips some bits and checks that verification now
- * fails. */
+/* Creates N_SIGS valid signatures and verifies them with verify. Then flips
+ * some bits and checks that verification now fails. */
 static void test_schnorrsig_sign_verify(void) {
     unsigned char sk[32];
     unsigned char msg[N_SIGS][32];
@@ -770,7 +771,7 @@ static void test_schnorrsig_sign_verify(void) {
 
     {
         /* Flip a few bits in the signature and in the message and check that
-         * verify and verify_batch (TODO) fail */
+         * verify fails */
         size_t sig_idx = secp256k1_testrand_int(N_SIGS);
         size_t byte_idx = secp256k1_testrand_bits(5);
         unsigned char xorbyte = secp256k1_testrand_int(254)+1;
@@ -826,6 +827,77 @@ static void test_schnorrsig_sign_verify(void) {
 }
 #undef N_SIGS
 
+#define N_SIGS 20
+/* Creates N_SIGS valid signatures with different keys and checks that
+ * verify_batch accepts them, with or without a scratch space, and fails as
+ * soon as one of them is wrong. */
+static void test_schnorrsig_verify_batch(void) {
+    unsigned char sk[32];
+    unsigned char msg[N_SIGS][32];
+    unsigned char sig[N_SIGS][64];
+    secp256k1_xonly_pubkey pk[N_SIGS];
+    const unsigned char *sig_ptr[N_SIGS];
+    const unsigned char *msg_ptr[N_SIGS];
+    const secp256k1_xonly_pubkey *pk_ptr[N_SIGS];
+    secp256k1_scratch_space *scratch;
+    secp256k1_scratch_space *small_scratch;
+    size_t i;
+
+    for (i = 0; i < N_SIGS; i++) {
+        secp256k1_keypair keypair;
+        secp256k1_testrand256(sk);
+        CHECK(secp256k1_keypair_create(CTX, &keypair, sk));
+        CHECK(secp256k1_keypair_xonly_pub(CTX, &pk[i], NULL, &keypair));
+        secp256k1_testrand256(msg[i]);
+        CHECK(secp256k1_schnorrsig_sign32(CTX, sig[i], msg[i], &keypair, NULL));
+        sig_ptr[i] = sig[i];
+        msg_ptr[i] = msg[i];
+        pk_ptr[i] = &pk[i];
+    }
+
+    scratch = secp256k1_scratch_space_create(CTX, 1024 * 1024);
+    small_scratch = secp256k1_scratch_space_create(CTX, 1);
+    CHECK(secp256k1_schnorrsig_verify_batch(CTX, scratch, NULL, NULL, NULL, 0) == 1);
+    for (i = 1; i <= N_SIGS; i++) {
+        CHECK(secp256k1_schnorrsig_verify_batch(CTX, scratch, sig_ptr, msg_ptr, pk_ptr, i) == 1);
+    }
+    CHECK(secp256k1_schnorrsig_verify_batch(CTX, NULL, sig_ptr, msg_ptr, pk_ptr, N_SIGS) == 1);
+    CHECK(secp256k1_schnorrsig_verify_batch(CTX, small_scratch, sig_ptr, msg_ptr, pk_ptr, N_SIGS) == 1);
+
+    {
+        /* Flip a bit of one signature, message or key and check that the batch fails */
+        size_t sig_idx = secp256k1_testrand_int(N_SIGS);
+        size_t byte_idx = secp256k1_testrand_bits(5);
+        unsigned char xorbyte = secp256k1_testrand_int(254)+1;
+        secp256k1_xonly_pubkey pk_tmp = pk[sig_idx];
+
+        sig[sig_idx][byte_idx] ^= xorbyte;
+        CHECK(secp256k1_schnorrsig_verify_batch(CTX, scratch, sig_ptr, msg_ptr, pk_ptr, N_SIGS) == 0);
+        CHECK(secp256k1_schnorrsig_verify_batch(CTX, NULL, sig_ptr, msg_ptr, pk_ptr, N_SIGS) == 0);
+        sig[sig_idx][byte_idx] ^= xorbyte;
+
+        sig[sig_idx][32+byte_idx] ^= xorbyte;
+        CHECK(secp256k1_schnorrsig_verify_batch(CTX, scratch, sig_ptr, msg_ptr, pk_ptr, N_SIGS) == 0);
+        sig[sig_idx][32+byte_idx] ^= xorbyte;
+
+        msg[sig_idx][byte_idx] ^= xorbyte;
+        CHECK(secp256k1_schnorrsig_verify_batch(CTX, scratch, sig_ptr, msg_ptr, pk_ptr, N_SIGS) == 0);
+        msg[sig_idx][byte_idx] ^= xorbyte;
+
+        pk[sig_idx] = pk[(sig_idx + 1) % N_SIGS];
+        CHECK(secp256k1_schnorrsig_verify_batch(CTX, scratch, sig_ptr, msg_ptr, pk_ptr, N_SIGS) == 0);
+        pk[sig_idx] = pk_tmp;
+
+        /* Overflowing s */
+        memset(&sig[sig_idx][32], 0xFF, 32);
+        CHECK(secp256k1_schnorrsig_verify_batch(CTX, scratch, sig_ptr, msg_ptr, pk_ptr, N_SIGS) == 0);
+    }
+
+    secp256k1_scratch_space_destroy(CTX, small_scratch);
+    secp256k1_scratch_space_destroy(CTX, scratch);
+}
+#undef N_SIGS
+
 static void test_schnorrsig_taproot(void) {
     unsigned char sk[32];
     secp256k1_keypair keypair;
@@ -872,6 +944,7 @@ static void run_schnorrsig_tests(void) {
     for (i = 0; i < COUNT; i++) {
         test_schnorrsig_sign();
         test_schnorrsig_sign_verify();
+        test_schnorrsig_verify_batch();
     }
     test_schnorrsig_taproot();
 }
@@ -24,6 +24,7 @@ bool AbortNode(const std::string& strMessage, bilingual_str user_message)
 {
     SetMiscWarning(Untranslated(strMessage));
     LogPrintf("*** %s\n", strMessage);
+    LogInstance().Flush();
     if (user_message.empty()) {
         user_message = _("A fatal internal error occurred, see debug.log for details");
     }
@@ -0,0 +1,137 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QTUM_SUPPORT_ARENA_H
+#define QTUM_SUPPORT_ARENA_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+/**
+ * Bump allocator for the buffers of the objects deserialized together, such as the scripts of
+ * the transactions of a block. The buffers are carved from a few large chunks instead of being
+ * allocated one by one, and releasing them is a reference count decrement instead of a free.
+ *
+ * Each buffer holds a reference to its chunk, so the objects may outlive the arena: a chunk is
+ * freed with the last of its buffers. An object kept long after the others pins the whole chunk,
+ * so the arena is meant for data whose objects go away together, like the transactions of a
+ * block once it is connected. Objects kept past the others are copied out of the arena first.
+ *
+ * prevector takes its heap buffers from the arena of the thread's DeserializeArenaScope, if any.
+ */
+class DeserializeArena
+{
+public:
+    //! Chunk size when the size of the deserialized data is not known
+    static constexpr size_t DEFAULT_CHUNK_SIZE{256 * 1024};
+    static constexpr size_t MIN_CHUNK_SIZE{4 * 1024};
+
+    /** @param[in] chunk_size  Size of the chunks, the size of the serialized data is a good fit */
+    explicit DeserializeArena(size_t chunk_size = DEFAULT_CHUNK_SIZE) : m_chunk_size{std::max(chunk_size, MIN_CHUNK_SIZE)} {}
+    ~DeserializeArena()
+    {
+        if (m_chunk) Unref(m_chunk);
+    }
+
+    DeserializeArena(const DeserializeArena&) = delete;
+    DeserializeArena& operator=(const DeserializeArena&) = delete;
+
+    /** Allocate @p size bytes aligned for a pointer. The buffer is given back with Release(). */
+    void* Allocate(size_t size)
+    {
+        const size_t need = RoundUp(sizeof(Chunk*) + size);
+        Chunk* chunk;
+        size_t offset{0};
+        if (need > m_chunk_size / 4) {
+            // Large buffers get a chunk of their own, the current chunk keeps serving the small ones
+            chunk = NewChunk(need);
+        } else {
+            if (!m_chunk || m_chunk->size - m_used < need) {
+                if (m_chunk) Unref(m_chunk);
+                m_chunk = NewChunk(m_chunk_size);
+                m_used = 0;
+            }
+            chunk = m_chunk;
+            chunk->refs.fetch_add(1, std::memory_order_relaxed);
+            offset = m_used;
+            m_used += need;
+        }
+        char* buffer = Data(chunk) + offset;
+        std::memcpy(buffer, &chunk, sizeof(Chunk*));
+        return buffer + sizeof(Chunk*);
+    }
+
+    /** Give back a buffer of Allocate(), from any thread */
+    static void Release(void* p)
+    {
+        Chunk* chunk;
+        std::memcpy(&chunk, static_cast<char*>(p) - sizeof(Chunk*), sizeof(Chunk*));
+        Unref(chunk);
+    }
+
+    /** The arena of the innermost DeserializeArenaScope of the thread, nullptr if there is none */
+    static DeserializeArena* Current() { return g_current; }
+
+private:
+    friend class DeserializeArenaScope;
+
+    struct Chunk {
+        //! The buffers carved from the chunk, plus one while it is the current chunk of the arena
+        std::atomic<size_t> refs{1};
+        const size_t size;
+
+        explicit Chunk(size_t size_in) : size{size_in} {}
+    };
+
+    static constexpr size_t ALIGNMENT{alignof(void*)};
+    static constexpr size_t HEADER_SIZE{(sizeof(Chunk) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT};
+
+    static size_t RoundUp(size_t size) { return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+    static char* Data(Chunk* chunk) { return reinterpret_cast<char*>(chunk) + HEADER_SIZE; }
+
+    static Chunk* NewChunk(size_t size)
+    {
+        // Asserted like the allocations of prevector, which call no new_handler either
+        void* mem = std::malloc(HEADER_SIZE + size);
+        assert(mem);
+        return new (mem) Chunk(size);
+    }
+
+    static void Unref(Chunk* chunk)
+    {
+        if (chunk->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            chunk->~Chunk();
+            std::free(chunk);
+        }
+    }
+
+    static inline thread_local DeserializeArena* g_current{nullptr};
+
+    const size_t m_chunk_size;
+    Chunk* m_chunk{nullptr};
+    size_t m_used{0};
+};
+
+/** Makes the prevectors deserialized by the thread take their buffers from @a arena while in scope */
+class DeserializeArenaScope
+{
+public:
+    explicit DeserializeArenaScope(DeserializeArena& arena) : m_prev{DeserializeArena::g_current} { DeserializeArena::g_current = &arena; }
+    //! Makes the prevectors of the thread use the default allocator while in scope
+    explicit DeserializeArenaScope(std::nullptr_t) : m_prev{DeserializeArena::g_current} { DeserializeArena::g_current = nullptr; }
+    ~DeserializeArenaScope() { DeserializeArena::g_current = m_prev; }
+
+    DeserializeArenaScope(const DeserializeArenaScope&) = delete;
+    DeserializeArenaScope& operator=(const DeserializeArenaScope&) = delete;
+
+private:
+    DeserializeArena* const m_prev;
+};
+
+#endif // QTUM_SUPPORT_ARENA_H
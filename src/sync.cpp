@@ -13,11 +13,13 @@
 #include <util/strencodings.h>
 #include <util/threadnames.h>
 
+#include <algorithm>
 #include <map>
 #include <mutex>
 #include <set>
 #include <system_error>
 #include <thread>
+#include <tuple>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -324,3 +326,168 @@ bool LockStackEmpty()
 bool g_debug_lockorder_abort = true;
 
 #endif /* DEBUG_LOCKORDER */
+
+std::atomic<bool> g_lock_stats{false};
+
+namespace {
+struct LockSiteKey {
+    const char* name;
+    const char* file;
+    int line;
+
+    bool operator==(const LockSiteKey& other) const { return name == other.name && file == other.file && line == other.line; }
+};
+
+struct LockSiteKeyHasher {
+    size_t operator()(const LockSiteKey& key) const
+    {
+        return std::hash<const void*>{}(key.file) ^ (std::hash<const void*>{}(key.name) << 1) ^ std::hash<int>{}(key.line);
+    }
+};
+
+using LockSites = std::unordered_map<LockSiteKey, LockSiteStats, LockSiteKeyHasher>;
+
+/** The stats recorded by one thread, so that threads do not contend on recording */
+struct LockStatsShard {
+    std::mutex mutex;
+    LockSites sites;
+};
+
+struct LockStatsData {
+    //! Guards the set of the shards and the stats of the exited threads, taken before a shard mutex
+    std::mutex mutex;
+    std::set<LockStatsShard*> shards;
+    LockSites retired;
+};
+
+LockStatsData& GetLockStatsData()
+{
+    // Leaked on purpose, so that threads exiting late in the shutdown can still retire their stats
+    static LockStatsData& data = *new LockStatsData;
+    return data;
+}
+
+size_t DurationBucket(std::chrono::microseconds duration)
+{
+    size_t bucket{0};
+    for (int64_t us = duration.count(); us > 0 && bucket + 1 < LockSiteStats::BUCKETS; us >>= 1) {
+        ++bucket;
+    }
+    return bucket;
+}
+
+void MergeLockSiteStats(LockSiteStats& to, const LockSiteStats& from)
+{
+    to.count += from.count;
+    to.contended += from.contended;
+    to.wait_total += from.wait_total;
+    to.wait_max = std::max(to.wait_max, from.wait_max);
+    to.hold_total += from.hold_total;
+    to.hold_max = std::max(to.hold_max, from.hold_max);
+    for (size_t i = 0; i < LockSiteStats::BUCKETS; ++i) {
+        to.wait_histogram[i] += from.wait_histogram[i];
+        to.hold_histogram[i] += from.hold_histogram[i];
+    }
+}
+
+void MergeLockSites(LockSites& to, const LockSites& from)
+{
+    for (const auto& [key, stats] : from) {
+        auto [it, inserted] = to.try_emplace(key, stats);
+        if (!inserted) MergeLockSiteStats(it->second, stats);
+    }
+}
+
+//! Set when the stats of the thread are retired, after which its locks (in the destructors of
+//! the objects with static storage for the main thread) are not recorded
+thread_local bool g_thread_lock_stats_retired{false};
+
+class ThreadLockStats
+{
+public:
+    ThreadLockStats()
+    {
+        LockStatsData& data = GetLockStatsData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        data.shards.insert(&m_shard);
+    }
+
+    ~ThreadLockStats()
+    {
+        LockStatsData& data = GetLockStatsData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        std::lock_guard<std::mutex> shard_lock(m_shard.mutex);
+        MergeLockSites(data.retired, m_shard.sites);
+        data.shards.erase(&m_shard);
+        g_thread_lock_stats_retired = true;
+    }
+
+    LockStatsShard m_shard;
+};
+} // namespace
+
+void RecordLockStats(const char* pszName, const char* pszFile, int nLine, bool contended, std::chrono::microseconds wait, std::chrono::microseconds hold)
+{
+    if (g_thread_lock_stats_retired) return;
+    static thread_local ThreadLockStats thread_stats;
+    LockStatsShard& shard = thread_stats.m_shard;
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto [it, inserted] = shard.sites.try_emplace(LockSiteKey{pszName, pszFile, nLine});
+    LockSiteStats& stats = it->second;
+    if (inserted) {
+        stats.name = pszName;
+        stats.file = pszFile;
+        stats.line = nLine;
+    }
+    ++stats.count;
+    if (contended) ++stats.contended;
+    stats.wait_total += wait;
+    stats.wait_max = std::max(stats.wait_max, wait);
+    stats.hold_total += hold;
+    stats.hold_max = std::max(stats.hold_max, hold);
+    ++stats.wait_histogram[DurationBucket(wait)];
+    ++stats.hold_histogram[DurationBucket(hold)];
+}
+
+std::vector<LockSiteStats> GetLockStats()
+{
+    LockSites sites;
+    {
+        LockStatsData& data = GetLockStatsData();
+        std::lock_guard<std::mutex> lock(data.mutex);
+        sites = data.retired;
+        for (LockStatsShard* shard : data.shards) {
+            std::lock_guard<std::mutex> shard_lock(shard->mutex);
+            MergeLockSites(sites, shard->sites);
+        }
+    }
+
+    // A header locking a mutex has a copy of its string literals in every translation unit
+    // including it, so the sites are merged by their strings
+    std::map<std::tuple<std::string, std::string, int>, LockSiteStats> merged;
+    for (const auto& [key, stats] : sites) {
+        auto [it, inserted] = merged.try_emplace(std::make_tuple(stats.name, stats.file, stats.line), stats);
+        if (!inserted) MergeLockSiteStats(it->second, stats);
+    }
+
+    std::vector<LockSiteStats> result;
+    result.reserve(merged.size());
+    for (auto& [key, stats] : merged) {
+        result.push_back(std::move(stats));
+    }
+    std::sort(result.begin(), result.end(), [](const LockSiteStats& a, const LockSiteStats& b) {
+        return a.hold_total > b.hold_total;
+    });
+    return result;
+}
+
+void ResetLockStats()
+{
+    LockStatsData& data = GetLockStatsData();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    data.retired.clear();
+    for (LockStatsShard* shard : data.shards) {
+        std::lock_guard<std::mutex> shard_lock(shard->mutex);
+        shard->sites.clear();
+    }
+}
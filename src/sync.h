@@ -14,10 +14,14 @@
 #include <threadsafety.h> // IWYU pragma: export
 #include <util/macros.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 ////////////////////////////////////////////////
 //                                            //
@@ -84,6 +88,40 @@ inline void DeleteLock(void* cs) {}
 inline bool LockStackEmpty() { return true; }
 #endif
 
+/**
+ * Whether the wait and hold times of the locks taken by UniqueLock (LOCK, LOCK2, TRY_LOCK,
+ * WAIT_LOCK) are recorded per lock site, see -lockstats. When false, locking only pays for
+ * loading it.
+ */
+extern std::atomic<bool> g_lock_stats;
+/** Default for -lockstats */
+static constexpr bool DEFAULT_LOCK_STATS{false};
+
+/** Wait and hold times of the locks taken at one source location */
+struct LockSiteStats {
+    //! Bucket 0 counts the durations under 1µs, bucket i those under 2^i µs, the last one the longer
+    static constexpr size_t BUCKETS{24};
+
+    std::string name;
+    std::string file;
+    int line{0};
+    uint64_t count{0};
+    //! Acquisitions that found the lock taken and had to wait
+    uint64_t contended{0};
+    std::chrono::microseconds wait_total{0};
+    std::chrono::microseconds wait_max{0};
+    std::chrono::microseconds hold_total{0};
+    std::chrono::microseconds hold_max{0};
+    std::array<uint64_t, BUCKETS> wait_histogram{};
+    std::array<uint64_t, BUCKETS> hold_histogram{};
+};
+
+/** Record one acquisition of the lock @a pszName at @a pszFile:@a nLine, whose strings must be literals */
+void RecordLockStats(const char* pszName, const char* pszFile, int nLine, bool contended, std::chrono::microseconds wait, std::chrono::microseconds hold);
+/** The stats recorded since the start or the last reset, by decreasing hold time */
+std::vector<LockSiteStats> GetLockStats();
+void ResetLockStats();
+
 /**
  * Template mixin that adds -Wthread-safety locking annotations and lock order
  * checking to a subset of the mutex API.
@@ -154,20 +192,61 @@ class SCOPED_LOCKABLE UniqueLock : public MutexType::unique_lock
 private:
     using Base = typename MutexType::unique_lock;
 
+    //! Site and times of the acquisition, set when lock stats are recorded
+    const char* m_stats_name{nullptr};
+    const char* m_stats_file{nullptr};
+    int m_stats_line{0};
+    bool m_stats_contended{false};
+    std::chrono::microseconds m_stats_wait{0};
+    std::chrono::steady_clock::time_point m_stats_locked;
+
+    void StartStats(const char* pszName, const char* pszFile, int nLine, bool contended, std::chrono::steady_clock::time_point start)
+    {
+        m_stats_name = pszName;
+        m_stats_file = pszFile;
+        m_stats_line = nLine;
+        m_stats_contended = contended;
+        m_stats_locked = std::chrono::steady_clock::now();
+        m_stats_wait = std::chrono::duration_cast<std::chrono::microseconds>(m_stats_locked - start);
+    }
+
+    void StopStats()
+    {
+        if (!m_stats_file) return;
+        const auto hold{std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_stats_locked)};
+        RecordLockStats(m_stats_name, m_stats_file, m_stats_line, m_stats_contended, m_stats_wait, hold);
+        m_stats_file = nullptr;
+    }
+
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, Base::mutex());
+        if (!g_lock_stats.load(std::memory_order_relaxed)) {
 #ifdef DEBUG_LOCKCONTENTION
-        if (Base::try_lock()) return;
-        LOG_TIME_MICROS_WITH_CATEGORY(strprintf("lock contention %s, %s:%d", pszName, pszFile, nLine), BCLog::LOCK);
+            if (Base::try_lock()) return;
+            LOG_TIME_MICROS_WITH_CATEGORY(strprintf("lock contention %s, %s:%d", pszName, pszFile, nLine), BCLog::LOCK);
 #endif
-        Base::lock();
+            Base::lock();
+            return;
+        }
+        const auto start{std::chrono::steady_clock::now()};
+        const bool contended{!Base::try_lock()};
+        if (contended) {
+#ifdef DEBUG_LOCKCONTENTION
+            LOG_TIME_MICROS_WITH_CATEGORY(strprintf("lock contention %s, %s:%d", pszName, pszFile, nLine), BCLog::LOCK);
+#endif
+            Base::lock();
+        }
+        StartStats(pszName, pszFile, nLine, contended, start);
     }
 
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, Base::mutex(), true);
         if (Base::try_lock()) {
+            if (g_lock_stats.load(std::memory_order_relaxed)) {
+                StartStats(pszName, pszFile, nLine, /*contended=*/false, std::chrono::steady_clock::now());
+            }
             return true;
         }
         LeaveCritical();
@@ -196,8 +275,10 @@ public:
 
     ~UniqueLock() UNLOCK_FUNCTION()
     {
-        if (Base::owns_lock())
+        if (Base::owns_lock()) {
+            StopStats();
             LeaveCritical();
+        }
     }
 
     operator bool()
@@ -217,6 +298,8 @@ public:
     public:
         explicit reverse_lock(UniqueLock& _lock, const char* _guardname, const char* _file, int _line) : lock(_lock), file(_file), line(_line) {
             CheckLastCritical((void*)lock.mutex(), lockname, _guardname, _file, _line);
+            // The lock is held again after the reverse lock, the stats only cover the first hold
+            lock.StopStats();
             lock.unlock();
             LeaveCritical();
             lock.swap(templock);
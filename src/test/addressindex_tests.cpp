@@ -0,0 +1,156 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <index/addressindex.h>
+#include <interfaces/chain.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** The address type and padded hash an output to @p script is indexed under */
+std::pair<int, uint256> AddressKey(const CScript& script)
+{
+    CTxDestination dest;
+    BOOST_REQUIRE(ExtractDestination(COutPoint(), script, dest));
+    valtype bytes(std::visit(DataVisitor(), dest));
+    bytes.resize(32);
+    return {int(dest.index()), uint256(bytes)};
+}
+
+void WaitUntilSynced(AddressIndex& index)
+{
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+}
+
+size_t CountDeltas(const AddressIndex& index, const std::pair<int, uint256>& address)
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount>> deltas;
+    BOOST_CHECK(index.FindAddressDeltas(address.second, address.first, deltas));
+    return deltas.size();
+}
+
+size_t CountUnspent(const AddressIndex& index, const std::pair<int, uint256>& address)
+{
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspent;
+    BOOST_CHECK(index.FindAddressUnspent(address.second, address.first, unspent));
+    return unspent.size();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(addressindex_initial_sync, TestChain100Setup)
+{
+    AddressIndex index(interfaces::MakeChain(m_node), 1 << 20, true);
+    const CScript coinbase_script = GetScriptForRawPubKey(coinbaseKey.GetPubKey());
+    const auto coinbase_address = AddressKey(coinbase_script);
+
+    // BlockUntilSyncedToCurrentChain should return false before the index is started.
+    BOOST_CHECK(!index.BlockUntilSyncedToCurrentChain());
+
+    BOOST_REQUIRE(index.Start());
+    WaitUntilSynced(index);
+
+    // The coinbases of the chain the index was started on are indexed
+    BOOST_CHECK_EQUAL(CountDeltas(index, coinbase_address), m_coinbase_txns.size());
+    BOOST_CHECK_EQUAL(CountUnspent(index, coinbase_address), m_coinbase_txns.size());
+    CAmount total{0};
+    for (const auto& tx : m_coinbase_txns) {
+        total += tx->vout[0].nValue;
+    }
+    AddressBalance balance;
+    BOOST_CHECK(index.FindAddressBalance(coinbase_address.second, coinbase_address.first, balance));
+    BOOST_CHECK_EQUAL(balance.balance, total);
+    BOOST_CHECK_EQUAL(balance.utxos, (int64_t)m_coinbase_txns.size());
+
+    // The blocks appended afterwards are indexed, with the outputs they spend
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript dest_script = GetScriptForDestination(PKHash(key.GetPubKey()));
+    const auto dest_address = AddressKey(dest_script);
+    const CMutableTransaction spend = CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 0, coinbaseKey, dest_script, 1 * COIN, /*submit=*/false);
+    const int spend_height = WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Height()) + 1;
+    CreateAndProcessBlock({spend}, coinbase_script);
+    BOOST_CHECK(index.BlockUntilSyncedToCurrentChain());
+
+    BOOST_CHECK_EQUAL(CountDeltas(index, dest_address), 1U);
+    BOOST_CHECK_EQUAL(CountUnspent(index, dest_address), 1U);
+    // The spent coinbase and the new coinbase are a debit and a credit of the coinbase address
+    BOOST_CHECK_EQUAL(CountDeltas(index, coinbase_address), m_coinbase_txns.size() + 2);
+    BOOST_CHECK_EQUAL(CountUnspent(index, coinbase_address), m_coinbase_txns.size());
+    CSpentIndexValue spent;
+    BOOST_CHECK(index.FindSpentInfo(CSpentIndexKey(m_coinbase_txns[0]->GetHash(), 0), spent));
+    BOOST_CHECK(spent.txid == spend.GetHash());
+    BOOST_CHECK_EQUAL(spent.blockHeight, spend_height);
+
+    SyncWithValidationInterfaceQueue();
+    index.Stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_rewind_reorg, TestChain100Setup)
+{
+    AddressIndex index(interfaces::MakeChain(m_node), 1 << 20, true);
+    BOOST_REQUIRE(index.Start());
+    WaitUntilSynced(index);
+
+    const CScript coinbase_script = GetScriptForRawPubKey(coinbaseKey.GetPubKey());
+    const auto coinbase_address = AddressKey(coinbase_script);
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript dest_script = GetScriptForDestination(PKHash(key.GetPubKey()));
+    const auto dest_address = AddressKey(dest_script);
+    const CMutableTransaction spend = CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 0, coinbaseKey, dest_script, 1 * COIN, /*submit=*/false);
+    CreateAndProcessBlock({spend}, coinbase_script);
+    BOOST_CHECK(index.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK_EQUAL(CountDeltas(index, dest_address), 1U);
+
+    // The index rewinds the disconnected block when the first block of the new branch is connected,
+    // the coinbase it spent is unspent again
+    {
+        BlockValidationState state;
+        m_node.chainman->ActiveChainstate().InvalidateBlock(state, WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Tip()));
+        BOOST_CHECK(state.IsValid());
+    }
+    CKey other_key;
+    other_key.MakeNewKey(true);
+    const CScript other_script = GetScriptForDestination(PKHash(other_key.GetPubKey()));
+    const auto other_address = AddressKey(other_script);
+    for (int i = 0; i < 2; ++i) {
+        CreateAndProcessBlock({}, other_script);
+    }
+    BOOST_CHECK(index.BlockUntilSyncedToCurrentChain());
+
+    BOOST_CHECK_EQUAL(CountDeltas(index, dest_address), 0U);
+    BOOST_CHECK_EQUAL(CountUnspent(index, dest_address), 0U);
+    AddressBalance balance;
+    BOOST_CHECK(index.FindAddressBalance(dest_address.second, dest_address.first, balance));
+    BOOST_CHECK_EQUAL(balance.balance, 0);
+    BOOST_CHECK_EQUAL(balance.last_height, 0);
+    BOOST_CHECK_EQUAL(CountDeltas(index, coinbase_address), m_coinbase_txns.size());
+    BOOST_CHECK_EQUAL(CountUnspent(index, coinbase_address), m_coinbase_txns.size());
+    CSpentIndexValue spent;
+    BOOST_CHECK(!index.FindSpentInfo(CSpentIndexKey(m_coinbase_txns[0]->GetHash(), 0), spent));
+
+    // The blocks of the new branch are indexed instead
+    BOOST_CHECK_EQUAL(CountDeltas(index, other_address), 2U);
+    BOOST_CHECK_EQUAL(CountUnspent(index, other_address), 2U);
+
+    SyncWithValidationInterfaceQueue();
+    index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
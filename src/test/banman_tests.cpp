@@ -40,4 +40,57 @@ BOOST_AUTO_TEST_CASE(file)
     }
 }
 
+BOOST_AUTO_TEST_CASE(is_banned)
+{
+    SetMockTime(1000s);
+    const fs::path banlist_path{m_args.GetDataDirBase() / "banlist_match"};
+    BanMan banman{banlist_path, /*client_interface=*/nullptr, /*default_ban_time=*/60 * 60 * 24};
+
+    const auto addr = [](const std::string& str) {
+        CNetAddr addr;
+        BOOST_REQUIRE(LookupHost(str, addr, /*fAllowLookup=*/false));
+        return addr;
+    };
+    const auto subnet = [](const std::string& str) {
+        CSubNet subnet;
+        BOOST_REQUIRE(LookupSubNet(str, subnet));
+        return subnet;
+    };
+
+    banman.Ban(addr("1.2.3.4"), /*ban_time_offset=*/100, /*since_unix_epoch=*/false);
+    banman.Ban(subnet("10.20.0.0/16"), /*ban_time_offset=*/100, /*since_unix_epoch=*/false);
+    banman.Ban(subnet("172.16.0.0/12"), /*ban_time_offset=*/200, /*since_unix_epoch=*/false);
+    banman.Ban(subnet("2001:db8::/32"), /*ban_time_offset=*/100, /*since_unix_epoch=*/false);
+    banman.Ban(addr("2001:db9::1"), /*ban_time_offset=*/100, /*since_unix_epoch=*/false);
+    banman.Ban(addr("pg6mmjiyjmcrsslvykfwnntlaru7p5svn6y2ymmju6nubxndf4pscryd.onion"), /*ban_time_offset=*/100, /*since_unix_epoch=*/false);
+    banman.Ban(addr("ukeu3k5oycgaauneqgtnvselmt4yemvoilkln7jpvamvfx7dnkdq.b32.i2p"), /*ban_time_offset=*/100, /*since_unix_epoch=*/false);
+
+    BOOST_CHECK(banman.IsBanned(addr("1.2.3.4")));
+    BOOST_CHECK(!banman.IsBanned(addr("1.2.3.5")));
+    BOOST_CHECK(banman.IsBanned(addr("10.20.255.1")));
+    BOOST_CHECK(!banman.IsBanned(addr("10.21.0.1")));
+    BOOST_CHECK(banman.IsBanned(addr("172.31.0.1")));
+    BOOST_CHECK(!banman.IsBanned(addr("172.32.0.1")));
+    BOOST_CHECK(banman.IsBanned(addr("2001:db8:ffff::1")));
+    BOOST_CHECK(!banman.IsBanned(addr("2001:db9::2")));
+    BOOST_CHECK(banman.IsBanned(addr("2001:db9::1")));
+    BOOST_CHECK(banman.IsBanned(addr("pg6mmjiyjmcrsslvykfwnntlaru7p5svn6y2ymmju6nubxndf4pscryd.onion")));
+    BOOST_CHECK(banman.IsBanned(addr("ukeu3k5oycgaauneqgtnvselmt4yemvoilkln7jpvamvfx7dnkdq.b32.i2p")));
+
+    // Matches follow the changes to the ban list
+    BOOST_CHECK(banman.Unban(subnet("10.20.0.0/16")));
+    BOOST_CHECK(!banman.IsBanned(addr("10.20.255.1")));
+    banman.Ban(subnet("10.0.0.0/8"), /*ban_time_offset=*/100, /*since_unix_epoch=*/false);
+    BOOST_CHECK(banman.IsBanned(addr("10.20.255.1")));
+
+    // Bans expire
+    SetMockTime(1150s);
+    BOOST_CHECK(!banman.IsBanned(addr("1.2.3.4")));
+    BOOST_CHECK(!banman.IsBanned(addr("2001:db8:ffff::1")));
+    BOOST_CHECK(banman.IsBanned(addr("172.31.0.1")));
+
+    banman.ClearBanned();
+    BOOST_CHECK(!banman.IsBanned(addr("172.31.0.1")));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
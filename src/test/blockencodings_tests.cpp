@@ -371,4 +371,82 @@ BOOST_AUTO_TEST_CASE(TransactionsRequestDeserializationOverflowTest) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(ProofOfStakePrefilledTest)
+{
+    CTxMemPool& pool = *Assert(m_node.mempool);
+    TestMemPoolEntryHelper entry;
+    CBlock block(BuildBlockTestCase());
+
+    // Turn the second tx into a coinstake and add an OP_SPEND tx, neither is in the mempool
+    block.prevoutStake = COutPoint(InsecureRand256(), 0);
+    CMutableTransaction coinstake(*block.vtx[1]);
+    coinstake.vin[0].prevout = block.prevoutStake;
+    coinstake.vout.resize(2);
+    coinstake.vout[0].SetEmpty();
+    coinstake.vout[1].nValue = 42;
+    block.vtx[1] = MakeTransactionRef(coinstake);
+    CMutableTransaction spend;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+    spend.vin[0].scriptSig = CScript() << OP_SPEND;
+    spend.vout.resize(1);
+    spend.vout[0].nValue = 42;
+    block.vtx.push_back(MakeTransactionRef(spend));
+    BOOST_CHECK(block.IsProofOfStake() && block.vtx[1]->IsCoinStake() && block.vtx[3]->HasOpSpend());
+
+    LOCK2(cs_main, pool.cs);
+    pool.addUnchecked(entry.FromTx(block.vtx[2]));
+
+    CBlockHeaderAndShortTxIDs shortIDs{block};
+    TestHeaderAndShortIDs test_ids(shortIDs);
+    BOOST_REQUIRE_EQUAL(test_ids.prefilledtxn.size(), 3U);
+    BOOST_CHECK_EQUAL(test_ids.prefilledtxn[0].index, 0);
+    BOOST_CHECK_EQUAL(test_ids.prefilledtxn[1].index, 0);
+    BOOST_CHECK_EQUAL(test_ids.prefilledtxn[2].index, 1);
+    BOOST_CHECK_EQUAL(test_ids.shorttxids.size(), 1U);
+
+    // The block is rebuilt from the mempool without asking for the txs made by the staker
+    PartiallyDownloadedBlock partialBlock(&pool, &*m_node.chainman);
+    partialBlock.m_check_block_mock = [](const CBlock&, BlockValidationState&, const Consensus::Params&, Chainstate&, bool, bool, bool) { return true; };
+    BOOST_CHECK(partialBlock.InitData(shortIDs, extra_txn) == READ_STATUS_OK);
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        BOOST_CHECK(partialBlock.IsTxAvailable(i));
+    }
+
+    CBlock block2;
+    BOOST_CHECK(partialBlock.FillBlock(block2, {}) == READ_STATUS_OK);
+    BOOST_CHECK_EQUAL(block.GetHash().ToString(), block2.GetHash().ToString());
+    bool mutated;
+    BOOST_CHECK_EQUAL(BlockMerkleRoot(block, &mutated).ToString(), BlockMerkleRoot(block2, &mutated).ToString());
+}
+
+BOOST_AUTO_TEST_CASE(StripBlockWitnessesTest) {
+    CBlock block(BuildBlockTestCase());
+    block.vchBlockSigDlgt = {1, 2, 3};
+    // Give the second transaction a witness, the others stay in the plain format
+    CMutableTransaction tx(*block.vtx[1]);
+    tx.vin[0].scriptWitness.stack = {{4, 5}, {}, std::vector<unsigned char>(300, 6)};
+    block.vtx[1] = MakeTransactionRef(tx);
+
+    CDataStream with_witness(SER_NETWORK, PROTOCOL_VERSION);
+    with_witness << block;
+    CDataStream without_witness(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    without_witness << block;
+    BOOST_CHECK(with_witness.size() > without_witness.size());
+
+    std::vector<unsigned char> stripped;
+    BOOST_CHECK(StripBlockWitnesses(MakeUCharSpan(with_witness), stripped));
+    BOOST_CHECK(Span{stripped} == MakeUCharSpan(without_witness));
+
+    // A block without witnesses is copied as is
+    std::vector<unsigned char> copied;
+    BOOST_CHECK(StripBlockWitnesses(MakeUCharSpan(without_witness), copied));
+    BOOST_CHECK(copied == stripped);
+
+    // Truncated or trailing data is not a block
+    BOOST_CHECK(!StripBlockWitnesses(MakeUCharSpan(with_witness).first(with_witness.size() - 1), stripped));
+    with_witness << uint8_t{0};
+    BOOST_CHECK(!StripBlockWitnesses(MakeUCharSpan(with_witness), stripped));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -179,14 +179,48 @@ BOOST_AUTO_TEST_CASE(blockfilters_json_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(blockfilter_contract_test)
+{
+    const CScript script = CScript() << OP_1;
+    CMutableTransaction tx;
+    tx.vout.emplace_back(100, script);
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(tx));
+    CBlockUndo block_undo;
+
+    const GCSFilter::Element address(20, 0x11);
+    const GCSFilter::Element topic(32, 0x22);
+    const GCSFilter::ElementSet contract_elements{address, topic};
+
+    BlockFilter contract_filter(BlockFilterType::CONTRACT, block, block_undo, contract_elements);
+    BOOST_CHECK(contract_filter.GetFilter().Match(GCSFilter::Element(script.begin(), script.end())));
+    BOOST_CHECK(contract_filter.GetFilter().Match(address));
+    BOOST_CHECK(contract_filter.GetFilter().Match(topic));
+
+    // Basic filters do not commit the receipts and match those of the plain constructor
+    BlockFilter basic_filter(BlockFilterType::BASIC, block, block_undo, contract_elements);
+    BOOST_CHECK(!basic_filter.GetFilter().Match(address));
+    BOOST_CHECK(basic_filter.GetEncodedFilter() == BlockFilter(BlockFilterType::BASIC, block, block_undo).GetEncodedFilter());
+
+    BlockFilter contract_filter2;
+    DataStream stream{};
+    stream << contract_filter;
+    stream >> contract_filter2;
+    BOOST_CHECK_EQUAL(contract_filter2.GetFilterType(), BlockFilterType::CONTRACT);
+    BOOST_CHECK(contract_filter2.GetFilter().Match(topic));
+}
+
 BOOST_AUTO_TEST_CASE(blockfilter_type_names)
 {
     BOOST_CHECK_EQUAL(BlockFilterTypeName(BlockFilterType::BASIC), "basic");
+    BOOST_CHECK_EQUAL(BlockFilterTypeName(BlockFilterType::CONTRACT), "contract");
     BOOST_CHECK_EQUAL(BlockFilterTypeName(static_cast<BlockFilterType>(255)), "");
 
     BlockFilterType filter_type;
     BOOST_CHECK(BlockFilterTypeByName("basic", filter_type));
     BOOST_CHECK_EQUAL(filter_type, BlockFilterType::BASIC);
+    BOOST_CHECK(BlockFilterTypeByName("contract", filter_type));
+    BOOST_CHECK_EQUAL(filter_type, BlockFilterType::CONTRACT);
 
     BOOST_CHECK(!BlockFilterTypeByName("unknown", filter_type));
 }
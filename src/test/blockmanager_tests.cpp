@@ -5,11 +5,15 @@
 #include <chainparams.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
+#include <txdb.h>
 #include <validation.h>
 
 #include <boost/test/unit_test.hpp>
 #include <test/util/setup_common.h>
 
+#include <deque>
+#include <fstream>
+
 using node::BlockManager;
 using node::BLOCK_SERIALIZATION_HEADER_SIZE;
 using node::MAX_BLOCKFILE_SIZE;
@@ -41,6 +45,54 @@ BOOST_AUTO_TEST_CASE(blockmanager_find_block_pos)
     BOOST_CHECK_EQUAL(actual.nPos, BLOCK_SERIALIZATION_HEADER_SIZE + ::GetSerializeSize(params->GenesisBlock(), CLIENT_VERSION) + BLOCK_SERIALIZATION_HEADER_SIZE);
 }
 
+BOOST_AUTO_TEST_CASE(blocktreedb_load_block_index)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    CBlockTreeDB db{DBParams{.path = m_args.GetDataDirNet() / "loadindex", .cache_bytes = 1 << 20, .memory_only = true}};
+
+    // A chain of stakes, whose hashes spread over all the parts the keys are read in
+    const size_t length = 2000;
+    std::vector<uint256> hashes(length);
+    std::deque<CBlockIndex> blocks;
+    std::vector<const CBlockIndex*> to_write;
+    for (size_t i = 0; i < length; ++i) {
+        CBlockHeader header;
+        header.nVersion = 4;
+        header.hashPrevBlock = i ? hashes[i - 1] : uint256();
+        header.nTime = 1000 + i;
+        header.nBits = 0x1d00ffff;
+        header.prevoutStake = COutPoint(uint256::ONE, i);
+        header.vchBlockSigDlgt = {uint8_t(i), 0x01};
+        hashes[i] = header.GetHash();
+        CBlockIndex& index = blocks.emplace_back(header);
+        index.phashBlock = &hashes[i];
+        index.pprev = i ? &blocks[i - 1] : nullptr;
+        index.nHeight = i;
+        to_write.push_back(&index);
+    }
+    BOOST_REQUIRE(db.WriteBatchSync({}, 0, to_write));
+
+    node::BlockMap loaded;
+    {
+        LOCK(cs_main);
+        BOOST_REQUIRE(db.LoadBlockIndexGuts(params, [&](const uint256& hash) -> CBlockIndex* {
+            if (hash.IsNull()) return nullptr;
+            const auto [it, inserted]{loaded.try_emplace(hash)};
+            if (inserted) it->second.phashBlock = &it->first;
+            return &it->second;
+        }));
+    }
+
+    BOOST_CHECK_EQUAL(loaded.size(), length);
+    for (size_t i = 0; i < length; ++i) {
+        const CBlockIndex& index = loaded.at(hashes[i]);
+        BOOST_CHECK_EQUAL(index.nHeight, (int)i);
+        BOOST_CHECK(index.pprev == (i ? &loaded.at(hashes[i - 1]) : nullptr));
+        BOOST_CHECK(index.prevoutStake == blocks[i].prevoutStake);
+        BOOST_CHECK(index.vchBlockSigDlgt == blocks[i].vchBlockSigDlgt);
+    }
+}
+
 BOOST_FIXTURE_TEST_CASE(blockmanager_scan_unlink_already_pruned_files, TestChain100Setup)
 {
     // Cap last block file size, and mine new block in a new block file.
@@ -82,4 +134,31 @@ BOOST_FIXTURE_TEST_CASE(blockmanager_scan_unlink_already_pruned_files, TestChain
     BOOST_CHECK(!AutoFile(OpenBlockFile(new_pos, true)).IsNull());
 }
 
+BOOST_AUTO_TEST_CASE(blockmanager_background_pruner)
+{
+    const fs::path state_dir{m_args.GetDataDirNet() / "stateQtum"};
+    fs::create_directories(state_dir / "resultsDB");
+    {
+        std::ofstream file{state_dir / "resultsDB" / "000001.ldb", std::ios::binary};
+        file << std::string(1000, 'x');
+    }
+
+    const auto params{CreateChainParams(ArgsManager{}, CBaseChainParams::MAIN)};
+    BlockManager blockman{{.prune_target = MIN_DISK_SPACE_FOR_BLOCK_FILES, .qtum_state_dir = state_dir}};
+    CChain chain{};
+    blockman.SaveBlockToDisk(params->GenesisBlock(), 0, chain, *params, nullptr);
+    const FlatFilePos pos{0, 0};
+    BOOST_CHECK(!AutoFile(OpenBlockFile(pos, true)).IsNull());
+
+    // The files are unlinked on the background thread, which measured the state databases before
+    blockman.UnlinkPrunedFiles({0});
+    blockman.WaitForPrunedFiles();
+    BOOST_CHECK(AutoFile(OpenBlockFile(pos, true)).IsNull());
+
+    node::BackgroundPruner pruner{state_dir};
+    pruner.Unlink({1});
+    pruner.Wait();
+    BOOST_CHECK_EQUAL(pruner.QtumStateUsage(), 1000U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,98 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockorphanage.h>
+#include <clientversion.h>
+#include <serialize.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(blockorphanage_tests, BasicTestingSetup)
+
+static CBlock MakeBlock(const uint256& prev, uint32_t nonce)
+{
+    CBlock block;
+    block.hashPrevBlock = prev;
+    block.nNonce = nonce;
+    return block;
+}
+
+static size_t BlockBytes()
+{
+    return ::GetSerializeSize(MakeBlock(uint256(), 0), CLIENT_VERSION);
+}
+
+BOOST_AUTO_TEST_CASE(blockorphanage_chain)
+{
+    BlockOrphanage orphanage(100 * BlockBytes());
+    const uint256 missing = InsecureRand256();
+
+    // A chain of three orphans, and a proof-of-stake sibling of the first one
+    const CBlock a = MakeBlock(missing, 1);
+    const CBlock b = MakeBlock(a.GetHash(), 2);
+    const CBlock c = MakeBlock(b.GetHash(), 3);
+    CBlock staked = MakeBlock(missing, 4);
+    staked.prevoutStake = COutPoint(InsecureRand256(), 0);
+    BOOST_CHECK(orphanage.AddBlock(c, 0));
+    BOOST_CHECK(orphanage.AddBlock(a, 0));
+    BOOST_CHECK(orphanage.AddBlock(b, 1));
+    BOOST_CHECK(orphanage.AddBlock(staked, 1));
+    BOOST_CHECK(!orphanage.AddBlock(b, 0));
+    BOOST_CHECK_EQUAL(orphanage.Size(), 4U);
+    BOOST_CHECK_EQUAL(orphanage.TotalBytes(), 3 * BlockBytes() + ::GetSerializeSize(staked, CLIENT_VERSION));
+
+    BOOST_CHECK(orphanage.HaveChildren(missing));
+    BOOST_CHECK(orphanage.HaveChildren(a.GetHash()));
+    BOOST_CHECK(!orphanage.HaveChildren(c.GetHash()));
+    BOOST_CHECK(orphanage.HaveStake(staked.GetProofOfStake()));
+    BOOST_CHECK(orphanage.GetRoot(c.GetHash()) == a.GetHash());
+    BOOST_CHECK(orphanage.GetRoot(missing) == missing);
+
+    // Taking the children of the missing block leaves the rest of the chain
+    std::vector<CBlock> children = orphanage.TakeChildren(missing);
+    BOOST_REQUIRE_EQUAL(children.size(), 2U);
+    for (const CBlock& child : children) {
+        BOOST_CHECK(child.GetHash() == a.GetHash() || child.GetHash() == staked.GetHash());
+    }
+    BOOST_CHECK(!orphanage.HaveBlock(a.GetHash()));
+    BOOST_CHECK(!orphanage.HaveStake(staked.GetProofOfStake()));
+    BOOST_CHECK(orphanage.GetRoot(c.GetHash()) == b.GetHash());
+    BOOST_CHECK_EQUAL(orphanage.Size(), 2U);
+
+    // Only the orphans of the disconnected peer are erased
+    orphanage.EraseForPeer(0);
+    BOOST_CHECK(orphanage.HaveBlock(b.GetHash()));
+    BOOST_CHECK(!orphanage.HaveBlock(c.GetHash()));
+    orphanage.EraseForPeer(1);
+    BOOST_CHECK_EQUAL(orphanage.Size(), 0U);
+    BOOST_CHECK_EQUAL(orphanage.TotalBytes(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(blockorphanage_limits)
+{
+    // Every peer may use a quarter of the pool, two blocks
+    BlockOrphanage orphanage(8 * BlockBytes());
+    const uint256 missing = InsecureRand256();
+
+    const CBlock parent = MakeBlock(missing, 0);
+    const CBlock child = MakeBlock(parent.GetHash(), 1);
+    BOOST_CHECK(orphanage.AddBlock(parent, 0));
+    BOOST_CHECK(orphanage.AddBlock(child, 0));
+    BOOST_CHECK(!orphanage.AddBlock(MakeBlock(missing, 2), 0));
+    BOOST_CHECK_EQUAL(orphanage.Size(), 2U);
+
+    // Filling the pool from other peers evicts orphans without orphan children only
+    for (uint32_t i = 0; i < 100; ++i) {
+        orphanage.AddBlock(MakeBlock(InsecureRand256(), 3 + i), 1 + i / 2);
+        BOOST_CHECK(orphanage.TotalBytes() <= 8 * BlockBytes());
+        BOOST_CHECK(!orphanage.HaveBlock(child.GetHash()) || orphanage.HaveBlock(parent.GetHash()));
+    }
+    BOOST_CHECK_EQUAL(orphanage.Size(), 8U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,87 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <libdevcore/LevelDB.h>
+#include <node/cachetuner.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+using node::CacheTuner;
+using node::NodeCache;
+using node::PickCacheTransfer;
+
+BOOST_FIXTURE_TEST_SUITE(cachetuner_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(pick_cache_transfer)
+{
+    constexpr size_t STEP{1 << 20};
+    // hits, misses, evictions, max_bytes
+    std::vector<CacheStats> interval{
+        {40, 10, 0, 16 * STEP},
+        {100, 500, 50, 4 * STEP},
+        {10, 900, 0, 8 * STEP},
+    };
+    // The second cache evicts and hits the most per byte, the third one hits the fewest per byte
+    auto transfer{PickCacheTransfer(interval, STEP)};
+    BOOST_REQUIRE(transfer);
+    BOOST_CHECK_EQUAL(transfer->first, 2U);
+    BOOST_CHECK_EQUAL(transfer->second, 1U);
+
+    // Caches are not shrunk below two steps
+    interval[2].max_bytes = STEP;
+    transfer = PickCacheTransfer(interval, STEP);
+    BOOST_REQUIRE(transfer);
+    BOOST_CHECK_EQUAL(transfer->first, 0U);
+    BOOST_CHECK_EQUAL(transfer->second, 1U);
+
+    // Nothing moves unless the receiver does twice as well
+    interval[1].hits = 16;
+    BOOST_CHECK(!PickCacheTransfer(interval, STEP));
+
+    // Nor to a cache that does not evict
+    interval[1].hits = 100;
+    interval[1].evictions = 0;
+    BOOST_CHECK(!PickCacheTransfer(interval, STEP));
+}
+
+BOOST_AUTO_TEST_CASE(fixed_size_caches)
+{
+    std::vector<NodeCache> caches{
+        {"resizable", [] { return CacheStats{0, 0, 0, 3 << 20}; }, [](size_t) { return true; }},
+        {"fixed", [] { return CacheStats{0, 0, 0, 5 << 20}; }, {}},
+    };
+    // The cache that can not be resized is left out of the budget
+    CacheTuner tuner(caches);
+    BOOST_CHECK_EQUAL(tuner.Budget(), size_t{3 << 20});
+}
+
+BOOST_AUTO_TEST_CASE(state_db_block_cache)
+{
+    dev::db::LevelDB::setCacheSize(1 << 20);
+    {
+        dev::db::LevelDB db(fs::PathToString(m_path_root / "statedb"));
+        // More than the write buffer, so that the first values are read from the tables
+        const std::string value(256, 'v');
+        for (int i = 0; i < 2000; ++i) {
+            const std::string key{"key" + ToString(i)};
+            db.insert(dev::db::Slice(key.data(), key.size()), dev::db::Slice(value.data(), value.size()));
+        }
+        for (int i = 0; i < 2000; ++i) {
+            const std::string key{"key" + ToString(i)};
+            BOOST_CHECK(db.lookup(dev::db::Slice(key.data(), key.size())) == value);
+        }
+    }
+    const auto stats{dev::db::LevelDB::cacheStats()};
+    BOOST_CHECK_EQUAL(stats.maxBytes, size_t{1 << 19});
+    BOOST_CHECK(stats.hits + stats.misses > 0);
+
+    dev::db::LevelDB::setCacheSize(0);
+    BOOST_CHECK_EQUAL(dev::db::LevelDB::cacheStats().maxBytes, 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
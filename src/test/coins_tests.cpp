@@ -13,7 +13,9 @@
 #include <undo.h>
 #include <util/strencodings.h>
 
+#include <atomic>
 #include <map>
+#include <thread>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -1076,4 +1078,99 @@ BOOST_AUTO_TEST_CASE(ccoins_flush_behavior)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_fetch_coins)
+{
+    CCoinsViewDB base{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {}};
+    std::vector<COutPoint> outpoints;
+    {
+        CCoinsViewCacheTest cache{&base};
+        cache.SetBestBlock(InsecureRand256());
+        for (size_t i = 0; i < 2 * MIN_PARALLEL_COIN_FETCH; i++) {
+            outpoints.emplace_back(InsecureRand256(), i);
+            Coin coin;
+            coin.out.nValue = i + 1;
+            coin.nHeight = i;
+            cache.AddCoin(outpoints.back(), std::move(coin), false);
+        }
+        BOOST_CHECK(cache.Flush());
+    }
+    // Outpoints without a coin are not cached
+    const COutPoint missing{InsecureRand256(), 0};
+    std::vector<COutPoint> requested{outpoints};
+    requested.push_back(missing);
+
+    StartCoinFetchThreads(2);
+    for (size_t count : {MIN_PARALLEL_COIN_FETCH / 2, requested.size()}) {
+        CCoinsViewCacheTest cache{&base};
+        CCoinsViewCacheTest stacked{&cache};
+        Span<const COutPoint> fetch{Span{requested}.last(count)};
+        stacked.FetchCoins(fetch);
+        for (const COutPoint& outpoint : fetch) {
+            const bool exists = outpoint != missing;
+            BOOST_CHECK_EQUAL(stacked.HaveCoinInCache(outpoint), exists);
+            BOOST_CHECK_EQUAL(cache.HaveCoinInCache(outpoint), exists);
+            if (exists) BOOST_CHECK_EQUAL(stacked.AccessCoin(outpoint).out.nValue, CAmount(outpoint.n + 1));
+        }
+        stacked.SelfTest();
+        cache.SelfTest();
+
+        std::vector<Coin> coins;
+        base.GetCoins(fetch, coins);
+        BOOST_REQUIRE_EQUAL(coins.size(), fetch.size());
+        BOOST_CHECK(coins.back().IsSpent());
+        BOOST_CHECK(coins.front().nHeight == fetch.front().n);
+    }
+    StopCoinFetchThreads();
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_concurrent_reads)
+{
+    CCoinsViewDB base{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {}};
+    const uint256 flushed_block{InsecureRand256()};
+    const COutPoint flushed{InsecureRand256(), 0};
+    {
+        CCoinsViewCacheTest cache{&base};
+        cache.SetBestBlock(flushed_block);
+        Coin coin;
+        coin.out.nValue = 1;
+        cache.AddCoin(flushed, std::move(coin), false);
+        BOOST_CHECK(cache.Flush());
+    }
+
+    CCoinsViewCacheTest cache{&base};
+    cache.EnableConcurrentReads();
+    Coin coin;
+    uint256 best_block;
+    // Uncached coins are read from the base without caching them
+    BOOST_CHECK(cache.GetCoinConcurrent(flushed, coin, best_block));
+    BOOST_CHECK_EQUAL(coin.out.nValue, CAmount{1});
+    BOOST_CHECK(best_block == flushed_block);
+    BOOST_CHECK(!cache.HaveCoinInCache(flushed));
+
+    // Changes that are not flushed yet are seen, including spends
+    const uint256 tip_block{InsecureRand256()};
+    const COutPoint added{InsecureRand256(), 1};
+    BOOST_CHECK(cache.SpendCoin(flushed));
+    Coin new_coin;
+    new_coin.out.nValue = 2;
+    cache.AddCoin(added, std::move(new_coin), false);
+    cache.SetBestBlock(tip_block);
+
+    std::vector<std::thread> readers;
+    std::atomic<int> failures{0};
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&] {
+            for (int j = 0; j < 100; j++) {
+                Coin read;
+                uint256 block;
+                if (cache.GetCoinConcurrent(flushed, read, block)) ++failures;
+                if (!cache.GetCoinConcurrent(added, read, block) || read.out.nValue != 2 || block != tip_block) ++failures;
+            }
+        });
+    }
+    for (auto& reader : readers) reader.join();
+    BOOST_CHECK_EQUAL(failures, 0);
+    cache.SelfTest();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
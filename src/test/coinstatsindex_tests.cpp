@@ -88,6 +88,32 @@ BOOST_FIXTURE_TEST_CASE(coinstatsindex_initial_sync, TestChain100Setup)
     coin_stats_index.Stop();
 }
 
+static std::optional<kernel::CCoinsStats> SyncedTipStats(node::NodeContext& node, int index_threads)
+{
+    gArgs.ForceSetArg("-indexthreads", ToString(index_threads));
+    CoinStatsIndex index{interfaces::MakeChain(node), 1 << 20, true};
+    BOOST_REQUIRE(index.Start());
+    IndexWaitSynced(index);
+    const CBlockIndex* tip{WITH_LOCK(cs_main, return node.chainman->ActiveChain().Tip())};
+    std::optional<kernel::CCoinsStats> stats{index.LookUpStats(*tip)};
+    index.Stop();
+    return stats;
+}
+
+// The statistics of the blocks prepared on several threads add up to those of a sequential sync
+BOOST_FIXTURE_TEST_CASE(coinstatsindex_parallel_sync, TestChain100Setup)
+{
+    const std::optional<kernel::CCoinsStats> sequential{SyncedTipStats(m_node, 0)};
+    const std::optional<kernel::CCoinsStats> parallel{SyncedTipStats(m_node, 4)};
+    gArgs.ForceSetArg("-indexthreads", ToString(DEFAULT_INDEX_THREADS));
+    BOOST_REQUIRE(sequential && parallel);
+    BOOST_CHECK_EQUAL(parallel->hashSerialized, sequential->hashSerialized);
+    BOOST_CHECK_EQUAL(parallel->nTransactionOutputs, sequential->nTransactionOutputs);
+    BOOST_CHECK_EQUAL(parallel->nBogoSize, sequential->nBogoSize);
+    BOOST_CHECK_EQUAL(*parallel->total_amount, *sequential->total_amount);
+    BOOST_CHECK_EQUAL(parallel->total_unspendable_amount, sequential->total_unspendable_amount);
+}
+
 // Test shutdown between BlockConnected and ChainStateFlushed notifications,
 // make sure index is not corrupted and is able to reload.
 BOOST_FIXTURE_TEST_CASE(coinstatsindex_unclean_shutdown, TestChain100Setup)
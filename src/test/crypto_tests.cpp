@@ -895,6 +895,28 @@ BOOST_AUTO_TEST_CASE(keccak_tests)
     BOOST_CHECK_EQUAL(out.ToString(), "5f4a7f2eca7d57740ef9f1a077b4fc67328092ec62620447fe27ad8ed5f7e34f");
 }
 
+BOOST_AUTO_TEST_CASE(keccak_4way_tests)
+{
+    uint64_t state[4][25];
+    uint64_t state4[25][4];
+    for (int j = 0; j < 4; ++j) {
+        for (int i = 0; i < 25; ++i) {
+            state[j][i] = state4[i][j] = InsecureRandBits(64);
+        }
+    }
+    for (int round = 0; round < 4; ++round) {
+        for (int j = 0; j < 4; ++j) {
+            KeccakF(state[j]);
+        }
+        KeccakF_4way(state4);
+        for (int j = 0; j < 4; ++j) {
+            for (int i = 0; i < 25; ++i) {
+                BOOST_CHECK_EQUAL(state[j][i], state4[i][j]);
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(sha3_256_tests)
 {
     // Test vectors from https://csrc.nist.gov/CSRC/media/Projects/Cryptographic-Algorithm-Validation-Program/documents/sha3/sha-3bytetestvectors.zip
@@ -1045,6 +1067,29 @@ BOOST_AUTO_TEST_CASE(muhash_tests)
     uint256 out4;
     overflowchk.Finalize(out4);
     BOOST_CHECK_EQUAL(HexStr(out4), "3a31e6903aff0de9f62f9a9f7f8b861de76ce2cda09822b90014319ae5dc2271");
+
+    // Test Num3072 division against multiplication, including a divisor above the modulus
+    for (int iter = 0; iter < 16; ++iter) {
+        unsigned char data[Num3072::DATA_BYTE_SIZE];
+        const std::vector<unsigned char> random_a{g_insecure_rand_ctx.randbytes(Num3072::DATA_BYTE_SIZE)};
+        std::copy(random_a.begin(), random_a.end(), data);
+        const Num3072 a{data};
+        const std::vector<unsigned char> random_b{g_insecure_rand_ctx.randbytes(Num3072::DATA_BYTE_SIZE)};
+        std::copy(random_b.begin(), random_b.end(), data);
+        if (iter == 0) std::fill(std::begin(data), std::end(data), 0xff);
+        const Num3072 b{data};
+
+        Num3072 quotient = a;
+        quotient.Divide(b);
+        quotient.Multiply(b);
+        Num3072 reduced = a;
+        reduced.Multiply(Num3072{});
+
+        unsigned char quotient_bytes[Num3072::DATA_BYTE_SIZE], reduced_bytes[Num3072::DATA_BYTE_SIZE];
+        quotient.ToBytes(quotient_bytes);
+        reduced.ToBytes(reduced_bytes);
+        BOOST_CHECK(std::equal(std::begin(quotient_bytes), std::end(quotient_bytes), std::begin(reduced_bytes)));
+    }
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -49,6 +49,46 @@ BOOST_AUTO_TEST_CASE(test_cuckoocache_no_fakes)
     }
 };
 
+/* Test that find returns the stored element, so elements can carry a value
+ * besides the fields they are compared by.
+ */
+struct KeyValue {
+    uint256 key;
+    uint32_t value{0};
+    bool operator==(const KeyValue& other) const { return key == other.key; }
+};
+
+struct KeyValueHasher {
+    template <uint8_t hash_select>
+    uint32_t operator()(const KeyValue& e) const
+    {
+        return SignatureCacheHasher().operator()<hash_select>(e.key);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(test_cuckoocache_find)
+{
+    SeedInsecureRand(SeedRand::ZEROS);
+    CuckooCache::cache<KeyValue, KeyValueHasher> cc{};
+    cc.setup_bytes(1 << 20);
+    std::vector<KeyValue> elements(1000);
+    for (uint32_t x = 0; x < elements.size(); ++x) {
+        elements[x].key = InsecureRand256();
+        elements[x].value = x;
+        cc.insert(elements[x]);
+    }
+    for (const KeyValue& e : elements) {
+        KeyValue probe;
+        probe.key = e.key;
+        const KeyValue* found = cc.find(probe, false);
+        BOOST_REQUIRE(found != nullptr);
+        BOOST_CHECK_EQUAL(found->value, e.value);
+    }
+    KeyValue missing;
+    missing.key = InsecureRand256();
+    BOOST_CHECK(cc.find(missing, false) == nullptr);
+}
+
 /** This helper returns the hit rate when megabytes*load worth of entries are
  * inserted into a megabytes sized cache
  */
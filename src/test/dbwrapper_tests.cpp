@@ -8,6 +8,8 @@
 #include <uint256.h>
 #include <util/string.h>
 
+#include <atomic>
+#include <functional>
 #include <memory>
 
 #include <boost/test/unit_test.hpp>
@@ -397,5 +399,67 @@ BOOST_AUTO_TEST_CASE(unicodepath)
     BOOST_CHECK(fs::exists(lockPath));
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_activity)
+{
+    CDBWrapper dbw({.path = m_args.GetDataDirBase() / "dbwrapper_activity", .cache_bytes = 1 << 20, .memory_only = true});
+    const uint64_t writes{GetCompactionController().GetStats()["dbwrapper_activity"].writes};
+
+    CDBBatch batch(dbw);
+    for (uint8_t key{0}; key < 10; ++key) {
+        batch.Write(key, InsecureRand256());
+    }
+    BOOST_CHECK(dbw.WriteBatch(batch));
+    BOOST_CHECK(dbw.Write(uint8_t{10}, InsecureRand256()));
+    BOOST_CHECK(dbw.Erase(uint8_t{0}));
+    BOOST_CHECK_EQUAL(GetCompactionController().GetStats()["dbwrapper_activity"].writes, writes + 3);
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_compaction_controller)
+{
+    CompactionController controller{std::chrono::milliseconds{50}};
+    std::atomic<int> runs{0};
+    // Wait for the stats of the test database to satisfy a condition, checked by the caller
+    auto wait_for = [&](const std::function<bool(const DBCompactionStats&)>& condition) {
+        for (int i = 0; i < 1000 && !condition(controller.GetStats()["test"]); ++i) {
+            UninterruptibleSleep(std::chrono::milliseconds{10});
+        }
+        return controller.GetStats()["test"];
+    };
+
+    // Compactions are deferred during initial block download
+    controller.NotifyTip(/*ibd=*/true);
+    controller.Request(&controller, "test", [&] { ++runs; });
+    DBCompactionStats stats{wait_for([](const DBCompactionStats& stats) { return stats.deferred_compactions > 0; })};
+    BOOST_CHECK_EQUAL(stats.deferred_compactions, 1U);
+    BOOST_CHECK_EQUAL(stats.pending_compactions, 1U);
+    BOOST_CHECK_EQUAL(runs, 0);
+
+    // and run after the quiet period that follows the last tip
+    controller.NotifyTip(/*ibd=*/false);
+    stats = wait_for([](const DBCompactionStats& stats) { return stats.compactions > 0; });
+    BOOST_CHECK_EQUAL(stats.compactions, 1U);
+    BOOST_CHECK_EQUAL(stats.pending_compactions, 0U);
+    BOOST_CHECK_EQUAL(runs, 1);
+
+    // The requests of an owner are dropped when it is cancelled
+    int owner;
+    controller.NotifyTip(/*ibd=*/true);
+    controller.Request(&owner, "test", [&] { runs += 10; });
+    controller.Request(&controller, "test", [&] { ++runs; });
+    controller.Cancel(&owner);
+    BOOST_CHECK_EQUAL(controller.GetStats()["test"].pending_compactions, 1U);
+    controller.NotifyTip(/*ibd=*/false);
+    stats = wait_for([](const DBCompactionStats& stats) { return stats.compactions > 1; });
+    BOOST_CHECK_EQUAL(stats.compactions, 2U);
+    BOOST_CHECK_EQUAL(runs, 2);
+
+    // Nothing runs once the controller is stopped
+    controller.NotifyTip(/*ibd=*/true);
+    controller.Request(&controller, "test", [&] { ++runs; });
+    controller.Stop();
+    controller.Request(&controller, "test", [&] { ++runs; });
+    BOOST_CHECK_EQUAL(controller.GetStats()["test"].pending_compactions, 0U);
+    BOOST_CHECK_EQUAL(runs, 2);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
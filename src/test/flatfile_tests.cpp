@@ -10,6 +10,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+
 BOOST_FIXTURE_TEST_SUITE(flatfile_tests, BasicTestingSetup)
 
 BOOST_AUTO_TEST_CASE(flatfile_filename)
@@ -126,4 +128,79 @@ BOOST_AUTO_TEST_CASE(flatfile_flush)
     BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(0, 1))), 1U);
 }
 
+BOOST_AUTO_TEST_CASE(flatfile_map)
+{
+    const auto data_dir = m_args.GetDataDirBase();
+    FlatFileSeq seq(data_dir, "a", 16 * 1024);
+
+    // Files that do not exist are not mapped
+    BOOST_CHECK(!seq.Map(FlatFilePos(1, 0)));
+
+    std::string line("Commerce on the Internet has come to rely almost exclusively on financial "
+                     "institutions serving as trusted third parties to process electronic payments.");
+    {
+        AutoFile file{seq.Open(FlatFilePos(1, 0))};
+        file << LIMITED_STRING(line, 256);
+    }
+    const size_t size = GetSerializeSize(line, CLIENT_VERSION);
+
+    auto mapped = seq.Map(FlatFilePos(1, 0));
+#ifndef WIN32
+    BOOST_REQUIRE(mapped);
+    BOOST_CHECK_EQUAL(mapped->size(), size);
+    BOOST_CHECK(mapped->Covers(0, size));
+    BOOST_CHECK(!mapped->Covers(1, size));
+    BOOST_CHECK(mapped->Read(size, 1).empty());
+
+    std::string text;
+    SpanReader{SER_DISK, CLIENT_VERSION, mapped->Read(0, size)} >> LIMITED_STRING(text, 256);
+    BOOST_CHECK_EQUAL(text, line);
+#else
+    BOOST_CHECK(!mapped);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(flatfile_writer)
+{
+    const auto data_dir = m_args.GetDataDirBase();
+    FlatFileSeq seq(data_dir, "a", 100);
+    const std::vector<unsigned char> record(10, 0x42);
+    const FlatFilePos pos(0, 0);
+
+    // The records written one after the other are buffered until there are enough of them
+    FlatFileWriter writer(25);
+    BOOST_CHECK(writer.Write(seq, FlatFilePos(0, 0), record));
+    BOOST_CHECK(writer.Write(seq, FlatFilePos(0, 10), record));
+    BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(pos)), 0U);
+    BOOST_CHECK(writer.Write(seq, FlatFilePos(0, 20), record));
+    BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(pos)), 30U);
+
+    // Flushing another file leaves the buffer, a record out of sequence writes it first
+    BOOST_CHECK(writer.Write(seq, FlatFilePos(0, 30), record));
+    BOOST_CHECK(writer.Flush(1));
+    BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(pos)), 30U);
+    BOOST_CHECK(writer.Write(seq, FlatFilePos(0, 50), record));
+    BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(pos)), 40U);
+    BOOST_CHECK(writer.Flush(0));
+    BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(pos)), 60U);
+
+    // A record of another file goes through a handle on that file
+    BOOST_CHECK(writer.Write(seq, FlatFilePos(1, 0), record));
+    BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(1, 0))), 0U);
+    BOOST_CHECK(writer.Close());
+    BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(1, 0))), 10U);
+
+    // Without a buffer every record is written at once
+    FlatFileWriter unbuffered(0);
+    BOOST_CHECK(unbuffered.Write(seq, FlatFilePos(2, 0), record));
+    BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(2, 0))), 10U);
+
+    std::vector<unsigned char> read(60);
+    AutoFile file{seq.Open(pos, /*read_only=*/true)};
+    file.read(MakeWritableByteSpan(read));
+    BOOST_CHECK(std::all_of(read.begin(), read.begin() + 40, [](unsigned char c) { return c == 0x42; }));
+    BOOST_CHECK(std::all_of(read.begin() + 40, read.begin() + 50, [](unsigned char c) { return c == 0; }));
+    BOOST_CHECK(std::all_of(read.begin() + 50, read.end(), [](unsigned char c) { return c == 0x42; }));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -57,12 +57,15 @@ FUZZ_TARGET_INIT(partially_downloaded_block, initialize_pdb)
 
     // Set of available transactions (mempool or extra_txn)
     std::set<uint16_t> available;
-    // The coinbase is always available
+    // The coinbase, and the coinstake and OP_SPEND txs are always available
     available.insert(0);
 
     std::vector<std::pair<uint256, CTransactionRef>> extra_txn;
     for (size_t i = 1; i < block->vtx.size(); ++i) {
         auto tx{block->vtx[i]};
+        if (CBlockHeaderAndShortTxIDs::IsPrefilled(*block, i)) {
+            available.insert(i);
+        }
 
         bool add_to_extra_txn{fuzzed_data_provider.ConsumeBool()};
         bool add_to_mempool{fuzzed_data_provider.ConsumeBool()};
@@ -76,8 +76,6 @@ void fuzz_target(FuzzBufferType buffer, const std::string& LIMIT_TO_MESSAGE_TYPE
     SetMockTime(1610000000); // any time to successfully reset ibd
     chainstate.ResetIbd();
 
-    LOCK(NetEventsInterface::g_msgproc_mutex);
-
     const std::string random_message_type{fuzzed_data_provider.ConsumeBytesAsString(CMessageHeader::COMMAND_SIZE).c_str()};
     if (!LIMIT_TO_MESSAGE_TYPE.empty() && random_message_type != LIMIT_TO_MESSAGE_TYPE) {
         return;
@@ -123,6 +121,7 @@ FUZZ_TARGET_MSG(getcfheaders);
 FUZZ_TARGET_MSG(getcfilters);
 FUZZ_TARGET_MSG(getdata);
 FUZZ_TARGET_MSG(getheaders);
+FUZZ_TARGET_MSG(getstatedata);
 FUZZ_TARGET_MSG(headers);
 FUZZ_TARGET_MSG(inv);
 FUZZ_TARGET_MSG(mempool);
@@ -130,10 +129,14 @@ FUZZ_TARGET_MSG(merkleblock);
 FUZZ_TARGET_MSG(notfound);
 FUZZ_TARGET_MSG(ping);
 FUZZ_TARGET_MSG(pong);
+FUZZ_TARGET_MSG(reconcildiff);
+FUZZ_TARGET_MSG(reqrecon);
 FUZZ_TARGET_MSG(sendaddrv2);
 FUZZ_TARGET_MSG(sendcmpct);
 FUZZ_TARGET_MSG(sendheaders);
 FUZZ_TARGET_MSG(sendtxrcncl);
+FUZZ_TARGET_MSG(sketch);
+FUZZ_TARGET_MSG(statedata);
 FUZZ_TARGET_MSG(tx);
 FUZZ_TARGET_MSG(verack);
 FUZZ_TARGET_MSG(version);
@@ -101,6 +101,7 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "disconnectnode",
     "echo",
     "echojson",
+    "estimategasprice",
     "estimaterawfee",
     "estimatesmartfee",
     "finalizepsbt",
@@ -117,13 +118,16 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "getblockfrompeer", // when no peers are connected, no p2p message is sent
     "getblockstats",
     "getblocktemplate",
+    "getcacheinfo",
     "getchaintips",
     "getchaintxstats",
     "getconnectioncount",
+    "getdbinfo",
     "getdeploymentinfo",
     "getdescriptorinfo",
     "getdifficulty",
     "getindexinfo",
+    "getlockstats",
     "getmemoryinfo",
     "getmempoolancestors",
     "getmempooldescendants",
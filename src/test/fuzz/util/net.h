@@ -53,6 +53,8 @@ public:
 
     ssize_t Send(const void* data, size_t len, int flags) const override;
 
+    ssize_t SendMany(Span<const Span<const unsigned char>> buffers, int flags) const override;
+
     ssize_t Recv(void* buf, size_t len, int flags) const override;
 
     int Connect(const sockaddr*, socklen_t) const override;
@@ -136,6 +138,6 @@ auto ConsumeNode(FuzzedDataProvider& fuzzed_data_provider, const std::optional<N
 }
 inline std::unique_ptr<CNode> ConsumeNodeAsUniquePtr(FuzzedDataProvider& fdp, const std::optional<NodeId>& node_id_in = std::nullopt) { return ConsumeNode<true>(fdp, node_id_in); }
 
-void FillNode(FuzzedDataProvider& fuzzed_data_provider, ConnmanTestMsg& connman, CNode& node) noexcept EXCLUSIVE_LOCKS_REQUIRED(NetEventsInterface::g_msgproc_mutex);
+void FillNode(FuzzedDataProvider& fuzzed_data_provider, ConnmanTestMsg& connman, CNode& node) noexcept;
 
 #endif // BITCOIN_TEST_FUZZ_UTIL_NET_H
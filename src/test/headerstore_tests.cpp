@@ -0,0 +1,71 @@
+// Copyright (c) 2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <node/headerstore.h>
+#include <streams.h>
+#include <sync.h>
+#include <validation.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+using node::HeaderStore;
+
+namespace {
+
+/** Headers of the chain from height @p begin to @p end excluded, serialized from their block index */
+std::vector<unsigned char> SerializeHeaders(const CChain& chain, int begin, int end, bool tx_counts) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    std::vector<unsigned char> data;
+    CVectorWriter writer{SER_NETWORK, PROTOCOL_VERSION, data, 0};
+    for (int height = begin; height < end; ++height) {
+        writer << chain[height]->GetBlockHeader();
+        if (tx_counts) writer << uint8_t{0};
+    }
+    return data;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(headerstore_tests, TestChain100Setup)
+
+BOOST_AUTO_TEST_CASE(headerstore_sync)
+{
+    HeaderStore store;
+    BOOST_CHECK_EQUAL(store.Height(), -1);
+
+    const CChain& active = WITH_LOCK(cs_main, return m_node.chainman->ActiveChain());
+    const int orig_height = WITH_LOCK(cs_main, return active.Height());
+    WITH_LOCK(cs_main, store.Sync(active));
+    BOOST_CHECK_EQUAL(store.Height(), orig_height);
+
+    std::vector<unsigned char> data;
+    BOOST_CHECK(store.Read(0, orig_height + 1, data, /*tx_counts=*/true));
+    BOOST_CHECK(data == WITH_LOCK(cs_main, return SerializeHeaders(active, 0, orig_height + 1, true)));
+    data.clear();
+    BOOST_CHECK(store.Read(10, 20, data, /*tx_counts=*/false));
+    BOOST_CHECK(data == WITH_LOCK(cs_main, return SerializeHeaders(active, 10, 20, false)));
+    BOOST_CHECK(!store.Read(10, orig_height + 2, data, /*tx_counts=*/true));
+
+    // After a reorg, the store is truncated to the fork point and the new headers appended
+    for (int i = 0; i < 5; ++i) {
+        BlockValidationState state;
+        m_node.chainman->ActiveChainstate().InvalidateBlock(state, WITH_LOCK(cs_main, return active.Tip()));
+    }
+    WITH_LOCK(cs_main, store.Sync(active));
+    BOOST_CHECK_EQUAL(store.Height(), orig_height - 5);
+    for (int i = 0; i < 10; ++i) {
+        CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    }
+    LOCK(cs_main);
+    store.Sync(active);
+    BOOST_CHECK_EQUAL(store.Height(), orig_height + 5);
+    data.clear();
+    BOOST_CHECK(store.Read(0, active.Height() + 1, data, /*tx_counts=*/true));
+    BOOST_CHECK(data == SerializeHeaders(active, 0, active.Height() + 1, true));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
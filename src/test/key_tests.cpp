@@ -5,6 +5,7 @@
 #include <key.h>
 
 #include <key_io.h>
+#include <script/sigcache.h>
 #include <streams.h>
 #include <test/util/random.h>
 #include <test/util/setup_common.h>
@@ -14,6 +15,7 @@
 #include <util/system.h>
 
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -344,4 +346,32 @@ BOOST_AUTO_TEST_CASE(bip340_test_vectors)
     }
 }
 
+BOOST_AUTO_TEST_CASE(batch_schnorr_verifier)
+{
+    BatchSchnorrVerifier batch;
+    BOOST_CHECK(batch.Verify());
+
+    std::vector<std::tuple<XOnlyPubKey, uint256, std::vector<unsigned char>>> sigs;
+    for (int i = 0; i < 4; ++i) {
+        CKey key;
+        key.MakeNewKey(true);
+        const uint256 msg = InsecureRand256();
+        std::vector<unsigned char> sig(64);
+        BOOST_CHECK(key.SignSchnorr(msg, sig, nullptr, InsecureRand256()));
+        sigs.emplace_back(XOnlyPubKey(key.GetPubKey()), msg, sig);
+    }
+
+    for (const auto& [pubkey, msg, sig] : sigs) batch.Add(sig, pubkey, msg, InsecureRand256(), false);
+    BOOST_CHECK_EQUAL(batch.Size(), sigs.size());
+    BOOST_CHECK(batch.Verify());
+    BOOST_CHECK_EQUAL(batch.Size(), 0U);
+
+    // One signature of another message fails the whole batch
+    for (const auto& [pubkey, msg, sig] : sigs) batch.Add(sig, pubkey, msg, InsecureRand256(), false);
+    const auto& [pubkey, msg, sig] = sigs.front();
+    batch.Add(sig, pubkey, InsecureRand256(), InsecureRand256(), false);
+    BOOST_CHECK(!batch.Verify());
+    BOOST_CHECK_EQUAL(batch.Size(), 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
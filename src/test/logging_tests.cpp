@@ -245,4 +245,55 @@ BOOST_FIXTURE_TEST_CASE(logging_Conf, LogSetup)
     }
 }
 
+BOOST_AUTO_TEST_CASE(logging_LogQueue)
+{
+    // The capacity is rounded up to a power of two
+    BCLog::LogQueue queue{5};
+    BOOST_CHECK(queue.Empty());
+    for (int i = 0; i < 8; ++i) {
+        BOOST_CHECK(queue.TryPush(BCLog::LogMsg(ToString(i), i % 2 == 0)));
+    }
+    BOOST_CHECK(!queue.TryPush(BCLog::LogMsg("full", false)));
+
+    // Messages are popped in order, and free their cell for a new message
+    BCLog::LogMsg msg{"", false};
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 8; ++i) {
+            BOOST_REQUIRE(queue.TryPop(msg));
+            BOOST_CHECK_EQUAL(msg.msg, ToString(i));
+            BOOST_CHECK_EQUAL(msg.useVMLog, i % 2 == 0);
+            BOOST_CHECK(queue.TryPush(BCLog::LogMsg(ToString(i), i % 2 == 0)));
+        }
+    }
+    for (int i = 0; i < 8; ++i) {
+        BOOST_CHECK(queue.TryPop(msg));
+    }
+    BOOST_CHECK(!queue.TryPop(msg));
+    BOOST_CHECK(queue.Empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(logging_AsyncLogging, LogSetup)
+{
+    LogInstance().StartAsyncLogging(1024);
+    std::vector<std::string> expected;
+    for (int i = 0; i < 100; ++i) {
+        LogPrintf("async %d\n", i);
+        expected.push_back(strprintf("async %d", i));
+    }
+    // An error is written after the messages queued before it
+    LogPrintLevel(BCLog::NET, BCLog::Level::Error, "async error\n");
+    expected.push_back("[net:error] async error");
+    LogPrintf("async after error\n");
+    expected.push_back("async after error");
+    LogInstance().StopAsyncLogging();
+    BOOST_CHECK_EQUAL(LogInstance().DroppedMessages(), 0U);
+
+    std::ifstream file{tmp_log_path};
+    std::vector<std::string> log_lines;
+    for (std::string log; std::getline(file, log);) {
+        log_lines.push_back(log);
+    }
+    BOOST_CHECK_EQUAL_COLLECTIONS(log_lines.begin(), log_lines.end(), expected.begin(), expected.end());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,7 +2,11 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <coins.h>
+#include <key.h>
 #include <policy/policy.h>
+#include <script/standard.h>
+#include <test/util/random.h>
 #include <test/util/txmempool.h>
 #include <txmempool.h>
 #include <util/system.h>
@@ -426,6 +430,50 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
     CheckSort<ancestor_score>(pool, sortedOrder);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolGasLimitWithAncestorsTest)
+{
+    CTxMemPool& pool = *Assert(m_node.mempool);
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // tx1 (contract) -> tx2 (contract) -> tx3
+    CMutableTransaction tx1 = CMutableTransaction();
+    tx1.vout.resize(1);
+    tx1.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx1.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(entry.Fee(10000LL).GasLimit(100000).FromTx(tx1));
+
+    CMutableTransaction tx2 = CMutableTransaction();
+    tx2.vin.resize(1);
+    tx2.vin[0].prevout = COutPoint(tx1.GetHash(), 0);
+    tx2.vin[0].scriptSig = CScript() << OP_11;
+    tx2.vout.resize(1);
+    tx2.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx2.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(entry.Fee(10000LL).GasLimit(50000).FromTx(tx2));
+
+    CMutableTransaction tx3 = CMutableTransaction();
+    tx3.vin.resize(1);
+    tx3.vin[0].prevout = COutPoint(tx2.GetHash(), 0);
+    tx3.vin[0].scriptSig = CScript() << OP_11;
+    tx3.vout.resize(1);
+    tx3.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx3.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(entry.Fee(10000LL).GasLimit(0).FromTx(tx3));
+
+    BOOST_CHECK_EQUAL(pool.GetIter(tx1.GetHash()).value()->GetGasLimitWithAncestors(), 100000U);
+    BOOST_CHECK_EQUAL(pool.GetIter(tx2.GetHash()).value()->GetGasLimitWithAncestors(), 150000U);
+    BOOST_CHECK_EQUAL(pool.GetIter(tx3.GetHash()).value()->GetGasLimitWithAncestors(), 150000U);
+    BOOST_CHECK_EQUAL(pool.GetIter(tx3.GetHash()).value()->GetGasLimit(), 0U);
+
+    // The gas of a mined ancestor is no longer counted
+    std::vector<CTransactionRef> vtx;
+    vtx.push_back(MakeTransactionRef(tx1));
+    pool.removeForBlock(vtx, 1);
+    BOOST_CHECK_EQUAL(pool.GetIter(tx2.GetHash()).value()->GetGasLimitWithAncestors(), 50000U);
+    BOOST_CHECK_EQUAL(pool.GetIter(tx3.GetHash()).value()->GetGasLimitWithAncestors(), 50000U);
+}
+
 
 BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
 {
@@ -800,4 +848,58 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTestsDiamond)
     BOOST_CHECK_EQUAL(descendants, 4ULL);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolAddressIndexTest)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const PKHash dest(key.GetPubKey());
+    const CScript script = GetScriptForDestination(dest);
+    uint256 address_hash;
+    std::copy(dest.begin(), dest.end(), address_hash.begin());
+    const int address_type = CTxDestination(dest).index();
+
+    CCoinsView base;
+    CCoinsViewCache view(&base);
+    const COutPoint prevout(InsecureRand256(), 1);
+    view.AddCoin(prevout, Coin(CTxOut(10 * COIN, script), 1, false, false), false);
+
+    CMutableTransaction tx;
+    tx.vin.emplace_back(prevout);
+    tx.vout.emplace_back(4 * COIN, script);
+    tx.vout.emplace_back(5 * COIN, CScript() << OP_TRUE);
+    const CTxMemPoolEntry entry = TestMemPoolEntryHelper().FromTx(tx);
+
+    MempoolAddressIndex index;
+    index.AddAddresses(entry, view);
+    index.AddSpent(entry, view);
+
+    // A batch of addresses returns the deltas of those in the mempool
+    const std::vector<std::pair<uint256, int>> addresses{{InsecureRand256(), address_type}, {address_hash, address_type}, {address_hash, address_type + 1}};
+    std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>> deltas;
+    index.GetAddressDeltas(addresses, deltas);
+    BOOST_REQUIRE_EQUAL(deltas.size(), 2U);
+    // The output comes first, as the deltas of a transaction are ordered by index and then spending
+    BOOST_CHECK(deltas[0].first.txhash == tx.GetHash());
+    BOOST_CHECK_EQUAL(deltas[0].first.spending, 0);
+    BOOST_CHECK_EQUAL(deltas[0].second.amount, 4 * COIN);
+    BOOST_CHECK_EQUAL(deltas[1].first.spending, 1);
+    BOOST_CHECK_EQUAL(deltas[1].second.amount, -10 * COIN);
+    BOOST_CHECK(deltas[1].second.prevhash == prevout.hash);
+
+    CSpentIndexValue value;
+    BOOST_CHECK(index.GetSpent(CSpentIndexKey(prevout.hash, prevout.n), value));
+    BOOST_CHECK(value.txid == tx.GetHash());
+    BOOST_CHECK_EQUAL(value.satoshis, 10 * COIN);
+    BOOST_CHECK(value.addressHash == address_hash);
+    BOOST_CHECK(!index.GetSpent(CSpentIndexKey(prevout.hash, 0), value));
+
+    // Nothing is left once the transaction is removed
+    index.RemoveAddresses(tx.GetHash());
+    index.RemoveSpent(tx.GetHash());
+    deltas.clear();
+    index.GetAddressDeltas(addresses, deltas);
+    BOOST_CHECK(deltas.empty());
+    BOOST_CHECK(!index.GetSpent(CSpentIndexKey(prevout.hash, prevout.n), value));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
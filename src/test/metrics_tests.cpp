@@ -0,0 +1,53 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/metrics.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <string>
+
+using namespace std::chrono_literals;
+
+BOOST_FIXTURE_TEST_SUITE(metrics_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(histogram_buckets)
+{
+    metrics::Histogram histogram;
+    histogram.Observe(500us);
+    histogram.Observe(1ms);
+    histogram.Observe(3ms);
+    histogram.Observe(1h);
+
+    BOOST_CHECK_EQUAL(histogram.Count(), 4U);
+    BOOST_CHECK_EQUAL(histogram.Bucket(0), 1U);
+    BOOST_CHECK_EQUAL(histogram.Bucket(1), 1U);
+    BOOST_CHECK_EQUAL(histogram.Bucket(2), 1U);
+    BOOST_CHECK_EQUAL(histogram.Bucket(metrics::Histogram::BUCKETS - 1), 1U);
+    BOOST_CHECK(histogram.Sum() == 500us + 1ms + 3ms + 1h);
+}
+
+BOOST_AUTO_TEST_CASE(registry_format)
+{
+    metrics::Registry registry;
+    registry.blocks_connected.Inc(3);
+    registry.chain_height.Set(42);
+    registry.rpc_request_time.Observe(2ms);
+    registry.rpc_request_time.Observe(1h);
+
+    const std::string text = registry.Format();
+    BOOST_CHECK(text.find("# TYPE qtum_blocks_connected_total counter\nqtum_blocks_connected_total 3\n") != std::string::npos);
+    BOOST_CHECK(text.find("# TYPE qtum_chain_height gauge\nqtum_chain_height 42\n") != std::string::npos);
+    BOOST_CHECK(text.find("# TYPE qtum_rpc_request_seconds histogram\n") != std::string::npos);
+    // The buckets are cumulative
+    BOOST_CHECK(text.find("qtum_rpc_request_seconds_bucket{le=\"0.001\"} 0\n") != std::string::npos);
+    BOOST_CHECK(text.find("qtum_rpc_request_seconds_bucket{le=\"0.002\"} 1\n") != std::string::npos);
+    BOOST_CHECK(text.find("qtum_rpc_request_seconds_bucket{le=\"+Inf\"} 2\n") != std::string::npos);
+    BOOST_CHECK(text.find("qtum_rpc_request_seconds_sum 3600.002000\nqtum_rpc_request_seconds_count 2\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
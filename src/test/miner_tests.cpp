@@ -35,6 +35,7 @@ struct MinerTestingSetup : public TestingSetup {
     void TestPackageSelection(const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
     void TestBasicMining(const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst, int baseheight) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
     void TestPrioritisedMining(const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+    void TestTemplateSelection(const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
     bool TestSequenceLocks(const CTransaction& tx, CTxMemPool& tx_mempool) EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
     {
         CCoinsViewMemPool view_mempool{&m_node.chainman->ActiveChainstate().CoinsTip(), tx_mempool};
@@ -328,6 +329,65 @@ void MinerTestingSetup::TestPackageSelection(const CScript& scriptPubKey, const
     BOOST_CHECK(pblocktemplate->block.vtx[8]->GetHash() == hashLowFeeTx2);
 }
 
+void MinerTestingSetup::TestTemplateSelection(const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst)
+{
+    CTxMemPool& tx_mempool{MakeMempool()};
+    LOCK(tx_mempool.cs);
+    TestMemPoolEntryHelper entry;
+    node::TemplateSelection selection;
+    auto create = [&]() {
+        BlockAssembler assembler{AssemblerForTest(tx_mempool)};
+        assembler.SetTemplateSelection(&selection);
+        return assembler.CreateNewBlock(scriptPubKey);
+    };
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << OP_1;
+    tx.vin[0].prevout.hash = txFirst[0]->GetHash();
+    tx.vin[0].prevout.n = 0;
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 5000000000LL - 400000;
+    const CTransaction parentTx{tx};
+    tx_mempool.addUnchecked(entry.Fee(400000).Time(Now<NodeSeconds>()).SpendsCoinbase(true).FromTx(tx));
+    tx.vin[0].prevout.hash = parentTx.GetHash();
+    tx.vout[0].nValue = 5000000000LL - 400000 * 50;
+    const uint256 hashChildTx = tx.GetHash();
+    tx_mempool.addUnchecked(entry.Fee(400000 * 49).Time(Now<NodeSeconds>()).SpendsCoinbase(false).FromTx(tx));
+
+    std::unique_ptr<CBlockTemplate> pblocktemplate = create();
+    BOOST_REQUIRE_EQUAL(pblocktemplate->block.vtx.size(), 3U);
+    BOOST_CHECK(selection.tip == m_node.chainman->ActiveChain().Tip()->GetBlockHash());
+    BOOST_CHECK(selection.complete);
+    BOOST_REQUIRE_EQUAL(selection.txids.size(), 2U);
+    BOOST_CHECK(selection.txids[0] == parentTx.GetHash());
+    BOOST_CHECK(selection.txids[1] == hashChildTx);
+
+    // Nothing changed, the same transactions are added again
+    pblocktemplate = create();
+    BOOST_REQUIRE_EQUAL(pblocktemplate->block.vtx.size(), 3U);
+    BOOST_CHECK(pblocktemplate->block.vtx[1]->GetHash() == parentTx.GetHash());
+    BOOST_CHECK(pblocktemplate->block.vtx[2]->GetHash() == hashChildTx);
+
+    // A new transaction is selected after those of the previous template, even with a higher fee rate
+    tx.vin[0].prevout.hash = txFirst[1]->GetHash();
+    tx.vout[0].nValue = 5000000000LL - 400000 * 100;
+    const uint256 hashHighFeeTx = tx.GetHash();
+    tx_mempool.addUnchecked(entry.Fee(400000 * 100).Time(Now<NodeSeconds>()).SpendsCoinbase(true).FromTx(tx));
+    pblocktemplate = create();
+    BOOST_REQUIRE_EQUAL(pblocktemplate->block.vtx.size(), 4U);
+    BOOST_CHECK(pblocktemplate->block.vtx[1]->GetHash() == parentTx.GetHash());
+    BOOST_CHECK(pblocktemplate->block.vtx[3]->GetHash() == hashHighFeeTx);
+    BOOST_CHECK_EQUAL(selection.txids.size(), 3U);
+
+    // The previous selection stops at the first transaction that left the mempool
+    tx_mempool.removeRecursive(parentTx, MemPoolRemovalReason::CONFLICT);
+    pblocktemplate = create();
+    BOOST_REQUIRE_EQUAL(pblocktemplate->block.vtx.size(), 2U);
+    BOOST_CHECK(pblocktemplate->block.vtx[1]->GetHash() == hashHighFeeTx);
+    BOOST_REQUIRE_EQUAL(selection.txids.size(), 1U);
+}
+
 CAmount calculateReward(const CBlock& block, ChainstateManager& chainman){
     LOCK(cs_main);
     CAmount sumVout = 0, fee = 0;
@@ -791,6 +851,11 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     SetMockTime(0);
 
     TestPrioritisedMining(scriptPubKey, txFirst);
+
+    m_node.chainman->ActiveChain().Tip()->nHeight--;
+    SetMockTime(0);
+
+    TestTemplateSelection(scriptPubKey, txFirst);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -803,10 +803,32 @@ BOOST_AUTO_TEST_CASE(LocalAddress_BasicLifecycle)
     BOOST_CHECK(!IsLocal(addr));
 }
 
-BOOST_AUTO_TEST_CASE(initial_advertise_from_version_message)
+BOOST_AUTO_TEST_CASE(shared_net_msg_payload)
 {
-    LOCK(NetEventsInterface::g_msgproc_mutex);
+    const CNetMsgMaker msg_maker(PROTOCOL_VERSION);
+    CSerializedNetMsg msg{msg_maker.Make(NetMsgType::PING, uint64_t{42})};
+    const std::vector<unsigned char> payload{msg.data};
+
+    std::vector<unsigned char> header;
+    V1TransportSerializer serializer;
+    serializer.prepareForTransport(msg, header);
+
+    // Sharing moves the payload, and copies of the message point to the same one
+    msg.Share();
+    BOOST_CHECK(msg.data.empty());
+    BOOST_CHECK(Span<const unsigned char>{payload} == msg.Payload());
+    const CSerializedNetMsg copy{msg.Copy()};
+    BOOST_CHECK(copy.m_shared == msg.m_shared);
+    BOOST_CHECK_EQUAL(copy.m_type, NetMsgType::PING);
+
+    // The header, and its checksum, are the same as without sharing
+    std::vector<unsigned char> shared_header;
+    serializer.prepareForTransport(msg, shared_header);
+    BOOST_CHECK(header == shared_header);
+}
 
+BOOST_AUTO_TEST_CASE(initial_advertise_from_version_message)
+{
     // Tests the following scenario:
     // * -bind=3.4.5.6:20001 is specified
     // * we make an outbound connection to a peer
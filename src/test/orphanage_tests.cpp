@@ -137,4 +137,56 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     BOOST_CHECK(orphanage.CountOrphans() == 0);
 }
 
+static CTransactionRef MakeSpend(const std::vector<COutPoint>& prevouts, unsigned int outputs)
+{
+    CMutableTransaction tx;
+    for (const COutPoint& prevout : prevouts) {
+        tx.vin.emplace_back(prevout);
+        tx.vin.back().scriptSig << OP_1;
+    }
+    tx.vout.resize(outputs);
+    for (CTxOut& txout : tx.vout) {
+        txout.nValue = 1 * CENT;
+        txout.scriptPubKey = CScript() << OP_TRUE;
+    }
+    return MakeTransactionRef(tx);
+}
+
+BOOST_AUTO_TEST_CASE(children_of_parent)
+{
+    TxOrphanageTest orphanage;
+    const CTransactionRef parent1 = MakeSpend({COutPoint(InsecureRand256(), 0)}, 4);
+    const CTransactionRef parent2 = MakeSpend({COutPoint(InsecureRand256(), 0)}, 1);
+    // Spends two outputs of parent1 and the output of parent2, which is an orphan itself
+    const CTransactionRef child1 = MakeSpend({COutPoint(parent1->GetHash(), 0), COutPoint(parent2->GetHash(), 0), COutPoint(parent1->GetHash(), 1)}, 1);
+    const CTransactionRef child2 = MakeSpend({COutPoint(parent1->GetHash(), 3)}, 1);
+    const CTransactionRef unrelated = MakeSpend({COutPoint(InsecureRand256(), 0)}, 1);
+    BOOST_CHECK(orphanage.AddTx(parent2, 0));
+    BOOST_CHECK(orphanage.AddTx(child1, 0));
+    BOOST_CHECK(orphanage.AddTx(child2, 1));
+    BOOST_CHECK(orphanage.AddTx(unrelated, 1));
+
+    // The orphans of the asking peer come first, each child once
+    auto children = orphanage.GetChildren(*parent1, 1);
+    BOOST_REQUIRE_EQUAL(children.size(), 2U);
+    BOOST_CHECK(children[0].first == child2 && children[0].second == 1);
+    BOOST_CHECK(children[1].first == child1 && children[1].second == 0);
+    children = orphanage.GetChildren(*parent1, 0);
+    BOOST_REQUIRE_EQUAL(children.size(), 2U);
+    BOOST_CHECK(children[0].first == child1);
+    BOOST_CHECK(orphanage.GetChildren(*child2, 0).empty());
+
+    // child1 still waits on the orphaned parent2, only child2 is reconsidered
+    orphanage.AddChildrenToWorkSet(*parent1);
+    BOOST_CHECK(!orphanage.HaveTxToReconsider(0));
+    BOOST_CHECK(orphanage.GetTxToReconsider(1) == child2);
+    BOOST_CHECK(!orphanage.HaveTxToReconsider(1));
+
+    // Once parent2 is accepted, child1 is reconsidered
+    orphanage.AddChildrenToWorkSet(*parent2);
+    orphanage.EraseTx(parent2->GetHash());
+    BOOST_CHECK(orphanage.GetTxToReconsider(0) == child1);
+    BOOST_CHECK(!orphanage.HaveTxToReconsider(0));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
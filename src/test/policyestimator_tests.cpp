@@ -4,6 +4,8 @@
 
 #include <policy/fees.h>
 #include <policy/policy.h>
+#include <script/script.h>
+#include <streams.h>
 #include <test/util/txmempool.h>
 #include <txmempool.h>
 #include <uint256.h>
@@ -182,4 +184,71 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
     }
 }
 
+BOOST_AUTO_TEST_CASE(GasPriceEstimates)
+{
+    CBlockPolicyEstimator& feeEst = *Assert(m_node.fee_estimator);
+    CTxMemPool& mpool = *Assert(m_node.mempool);
+    LOCK2(cs_main, mpool.cs);
+    TestMemPoolEntryHelper entry;
+    CAmount basefee(2000);
+    CAmount baseGasPrice(40);
+
+    // Every contract transaction has a twin without contract output, whose fee rises
+    // in the same steps as the gas price. Both are mined in the same block, so the
+    // gas price estimates follow the feerate estimates.
+    std::vector<uint256> txHashes[10];
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 0LL;
+    CMutableTransaction contractTx{tx};
+    contractTx.vout[0].scriptPubKey = CScript() << CScriptNum(4) << CScriptNum(250000) << CScriptNum(baseGasPrice) << std::vector<unsigned char>(4, 0) << std::vector<unsigned char>(20, 1) << OP_CALL;
+    CFeeRate baseRate(basefee, GetVirtualTransactionSize(CTransaction(tx)));
+
+    std::vector<CTransactionRef> block;
+    int blocknum = 0;
+    while (blocknum < 200) {
+        for (int j = 0; j < 10; j++) {
+            for (int k = 0; k < 4; k++) {
+                tx.vin[0].prevout.n = 10000*blocknum+100*j+k;
+                contractTx.vin[0].prevout.n = 10000*blocknum+100*j+k;
+                mpool.addUnchecked(entry.Fee(basefee * (j+1)).GasPrice(0).Time(Now<NodeSeconds>()).Height(blocknum).FromTx(tx));
+                mpool.addUnchecked(entry.Fee(basefee).GasPrice(baseGasPrice * (j+1)).FromTx(contractTx));
+                txHashes[j].push_back(tx.GetHash());
+                txHashes[j].push_back(contractTx.GetHash());
+            }
+        }
+        for (int h = 0; h <= blocknum%10; h++) {
+            while (txHashes[9-h].size()) {
+                CTransactionRef ptx = mpool.get(txHashes[9-h].back());
+                if (ptx)
+                    block.push_back(ptx);
+                txHashes[9-h].pop_back();
+            }
+        }
+        mpool.removeForBlock(block, ++blocknum);
+        block.clear();
+    }
+
+    for (int i = 2; i < 10; i++) {
+        for (bool conservative : {false, true}) {
+            double feeMult = (double)feeEst.estimateSmartFee(i, nullptr, conservative).GetFeePerK() / baseRate.GetFeePerK();
+            CAmount gasPrice = feeEst.estimateSmartGasPrice(i, nullptr, conservative);
+            BOOST_CHECK(gasPrice > baseGasPrice);
+            BOOST_CHECK_CLOSE((double)gasPrice / baseGasPrice, feeMult, 1);
+        }
+    }
+
+    // The gas price estimates are kept in the estimates file
+    const fs::path est_path = m_args.GetDataDirBase() / "gas_estimates.dat";
+    {
+        AutoFile est_file{fsbridge::fopen(est_path, "wb")};
+        BOOST_CHECK(feeEst.Write(est_file));
+    }
+    CBlockPolicyEstimator readEst(est_path, /*read_stale_estimates=*/true);
+    for (int i = 2; i < 10; i++) {
+        BOOST_CHECK_EQUAL(readEst.estimateSmartGasPrice(i, nullptr, false), feeEst.estimateSmartGasPrice(i, nullptr, false));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
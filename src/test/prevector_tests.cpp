@@ -8,6 +8,7 @@
 #include <reverse_iterator.h>
 #include <serialize.h>
 #include <streams.h>
+#include <support/arena.h>
 
 #include <test/util/random.h>
 #include <test/util/setup_common.h>
@@ -294,4 +295,52 @@ BOOST_AUTO_TEST_CASE(PrevectorTestInt)
     }
 }
 
+BOOST_AUTO_TEST_CASE(PrevectorArena)
+{
+    typedef prevector<8, int> pretype;
+    std::vector<pretype> pre_vectors;
+    std::vector<std::vector<int>> real_vectors;
+    {
+        // Chunks small enough for the vectors to span several of them, and some to get their own
+        DeserializeArena arena{DeserializeArena::MIN_CHUNK_SIZE};
+        DeserializeArenaScope arena_scope{arena};
+        for (int i = 0; i < 1000; i++) {
+            const unsigned int size = InsecureRandBool() ? InsecureRandRange(16) : InsecureRandRange(2048);
+            pretype pre_vector;
+            std::vector<int> real_vector;
+            for (unsigned int j = 0; j < size; j++) {
+                const int value = int(InsecureRand32());
+                pre_vector.push_back(value);
+                real_vector.push_back(value);
+            }
+            if (InsecureRandBits(2) == 0) pre_vector.shrink_to_fit();
+            BOOST_CHECK(pre_vector.capacity() >= pre_vector.size());
+            pre_vectors.push_back(std::move(pre_vector));
+            real_vectors.push_back(std::move(real_vector));
+        }
+        // Free some buffers while the arena is still alive
+        for (size_t i = 0; i < pre_vectors.size(); i += 3) {
+            pre_vectors[i].clear();
+            pre_vectors[i].shrink_to_fit();
+            real_vectors[i].clear();
+        }
+    }
+
+    // The buffers outlive the arena, and grow and shrink from the heap once out of scope
+    for (size_t i = 0; i < pre_vectors.size(); i++) {
+        BOOST_CHECK(std::equal(pre_vectors[i].begin(), pre_vectors[i].end(), real_vectors[i].begin(), real_vectors[i].end()));
+        pretype copy{pre_vectors[i]};
+        BOOST_CHECK(copy == pre_vectors[i]);
+        if (InsecureRandBool()) {
+            pre_vectors[i].insert(pre_vectors[i].end(), pretype::size_type{100}, 7);
+            real_vectors[i].resize(real_vectors[i].size() + 100, 7);
+        } else {
+            pre_vectors[i].resize(pre_vectors[i].size() / 2);
+            real_vectors[i].resize(real_vectors[i].size() / 2);
+            pre_vectors[i].shrink_to_fit();
+        }
+        BOOST_CHECK(std::equal(pre_vectors[i].begin(), pre_vectors[i].end(), real_vectors[i].begin(), real_vectors[i].end()));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,10 @@
 #include <test/util/setup_common.h>
 #include <qtumtests/test_utils.h>
 #include <chainparams.h>
+#include <libethereum/CodeCache.h>
+#include <libethereum/FlatStateCache.h>
+#include <libevm/CodeAnalysisCache.h>
+#include <qtum/qtumprofiler.h>
 
 namespace ButecodeExecTest{
 
@@ -148,6 +152,29 @@ BOOST_AUTO_TEST_CASE(bytecodeexec_create_contract){
     checkBCEResult(result.second, 69382, 430618, 1, CAmount(GASLIMIT));
 }
 
+BOOST_AUTO_TEST_CASE(bytecodeexec_contract_profile){
+    genesisLoading();
+    g_contract_profiler.SetEnabled(true);
+    g_contract_profiler.Reset();
+    QtumTransaction txEth = createQtumTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address());
+    std::vector<QtumTransaction> txs(1, txEth);
+    executeBC(txs, *m_node.chainman);
+
+    dev::Address addr = createQtumAddress(txs[0].getHashWith(), txs[0].getNVout());
+    std::map<dev::Address, ContractProfile> profiles = g_contract_profiler.GetProfiles();
+    BOOST_CHECK_EQUAL(profiles.size(), 1U);
+    BOOST_CHECK_EQUAL(profiles[addr].calls, 1U);
+    BOOST_CHECK_EQUAL(profiles[addr].gas_used, 69382U);
+    BOOST_CHECK(profiles[addr].wall_time.count() > 0);
+
+    // Nothing is recorded when profiling is off
+    g_contract_profiler.SetEnabled(false);
+    g_contract_profiler.Reset();
+    txs[0] = createQtumTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), dev::h256(ParseHex("bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb")), dev::Address());
+    executeBC(txs, *m_node.chainman);
+    BOOST_CHECK(g_contract_profiler.GetProfiles().empty());
+}
+
 BOOST_AUTO_TEST_CASE(bytecodeexec_create_contract_OutOfGasIntrinsic){
     genesisLoading();
     QtumTransaction txEth = createQtumTransaction(CODE[0], 0, dev::u256(100), dev::u256(1), HASHTX, dev::Address());
@@ -387,6 +414,408 @@ BOOST_AUTO_TEST_CASE(bytecodeexec_contract_create_contracts){
     BOOST_CHECK(result.second.valueTransfers.size() == 0);
 }
 
+BOOST_AUTO_TEST_CASE(bytecodeexec_speculative_matches_sequential){
+    genesisLoading();
+    CBlock block(generateBlock());
+    CChain& chain = m_node.chainman->ActiveChain();
+    QtumDGP qtumDGP(globalState.get(), m_node.chainman->ActiveChainstate(), fGettingValuesDGP);
+    uint64_t blockGasLimit = qtumDGP.getBlockGasLimit(chain.Tip()->nHeight + 1);
+
+    // Independent contract creations followed by a call to the first contract, which conflicts
+    std::vector<std::vector<QtumTransaction>> blockTxs;
+    dev::h256 hash(HASHTX);
+    for(size_t i = 0; i < 4; i++){
+        blockTxs.push_back(std::vector<QtumTransaction>(1, createQtumTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), hash, dev::Address())));
+        ++hash;
+    }
+    dev::Address firstContract(createQtumAddress(blockTxs[0][0].getHashWith(), blockTxs[0][0].getNVout()));
+    blockTxs.push_back(std::vector<QtumTransaction>(1, createQtumTransaction(valtype(), 0, GASLIMIT, dev::u256(1), hash, firstContract)));
+
+    dev::h256 oldHashStateRoot(globalState->rootHash());
+    dev::h256 oldHashUTXORoot(globalState->rootHashUTXO());
+    std::vector<std::vector<ResultExecute>> sequential;
+    for(const std::vector<QtumTransaction>& txs : blockTxs){
+        ByteCodeExec exec(block, txs, blockGasLimit, chain.Tip(), chain, m_node.chainman->Qtum());
+        BOOST_CHECK(exec.performByteCode());
+        sequential.push_back(exec.getResult());
+    }
+    dev::h256 sequentialStateRoot(globalState->rootHash());
+    dev::h256 sequentialUTXORoot(globalState->rootHashUTXO());
+
+    globalState->setRoot(oldHashStateRoot);
+    globalState->setRootUTXO(oldHashUTXORoot);
+    StartContractExecWorkerThreads(2);
+    ContractExecSpeculation speculation(block, blockGasLimit, chain.Tip(), chain, m_node.chainman->Qtum());
+    for(std::vector<QtumTransaction> txs : blockTxs){
+        speculation.Add(std::move(txs));
+    }
+    speculation.Run();
+    for(size_t i = 0; i < blockTxs.size(); i++){
+        ByteCodeExec exec(block, blockTxs[i], blockGasLimit, chain.Tip(), chain, m_node.chainman->Qtum(), &speculation);
+        BOOST_CHECK(exec.performByteCode());
+        std::vector<ResultExecute>& result = exec.getResult();
+        BOOST_CHECK(result.size() == sequential[i].size());
+        for(size_t j = 0; j < result.size(); j++){
+            BOOST_CHECK(result[j].execRes.excepted == sequential[i][j].execRes.excepted);
+            BOOST_CHECK(result[j].execRes.gasUsed == sequential[i][j].execRes.gasUsed);
+            BOOST_CHECK(result[j].execRes.newAddress == sequential[i][j].execRes.newAddress);
+            BOOST_CHECK(result[j].txRec.stateRoot() == sequential[i][j].txRec.stateRoot());
+            BOOST_CHECK(result[j].txRec.utxoRoot() == sequential[i][j].txRec.utxoRoot());
+        }
+    }
+    StopContractExecWorkerThreads();
+
+    BOOST_CHECK(globalState->rootHash() == sequentialStateRoot);
+    BOOST_CHECK(globalState->rootHashUTXO() == sequentialUTXORoot);
+    BOOST_CHECK_EQUAL(speculation.nApplied, 4U);
+    BOOST_CHECK_EQUAL(speculation.nReexecuted, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(bytecodeexec_state_view_pinned){
+    genesisLoading();
+    QtumTransaction txEthCreate = createQtumTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address());
+    std::vector<QtumTransaction> txsCreate(1, txEthCreate);
+    executeBC(txsCreate, *m_node.chainman);
+    dev::Address contract(createQtumAddress(txsCreate[0].getHashWith(), txsCreate[0].getNVout()));
+
+    QtumStateView view(*globalState, globalState->rootHash(), globalState->rootHashUTXO());
+    QtumTransaction txEthCall = createQtumTransaction(ParseHex("00"), 1300, GASLIMIT, dev::u256(1), HASHTX, contract);
+    executeBC(std::vector<QtumTransaction>(1, txEthCall), *m_node.chainman);
+    BOOST_CHECK(globalState->balance(contract) == 1300);
+
+    // The view keeps the roots it was taken at while the global state moves on
+    BOOST_CHECK(view.rootHash() != globalState->rootHash());
+    std::unique_ptr<QtumState> state = view.makeState();
+    BOOST_CHECK(state->addressInUse(contract));
+    BOOST_CHECK(state->balance(contract) == 0);
+    BOOST_CHECK(state->rootHashUTXO() == view.rootHashUTXO());
+}
+
+BOOST_AUTO_TEST_CASE(bytecodeexec_state_view_historical){
+    genesisLoading();
+    QtumTransaction txEthCreate = createQtumTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address());
+    std::vector<QtumTransaction> txsCreate(1, txEthCreate);
+    executeBC(txsCreate, *m_node.chainman);
+    dev::Address contract(createQtumAddress(txsCreate[0].getHashWith(), txsCreate[0].getNVout()));
+    const dev::h256 oldRoot = globalState->rootHash();
+    const dev::h256 oldRootUTXO = globalState->rootHashUTXO();
+
+    QtumTransaction txEthCall = createQtumTransaction(ParseHex("00"), 1300, GASLIMIT, dev::u256(1), HASHTX, contract);
+    executeBC(std::vector<QtumTransaction>(1, txEthCall), *m_node.chainman);
+
+    // A view of an earlier committed root is opened later without moving the global state
+    QtumStateView view(*globalState, oldRoot, oldRootUTXO);
+    BOOST_CHECK(view.makeState()->balance(contract) == 0);
+    BOOST_CHECK(globalState->balance(contract) == 1300);
+
+    // Changes only in the memory overlay are seen by a view of their root
+    static_cast<dev::eth::State&>(*globalState).addBalance(contract, 5);
+    globalState->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    QtumStateView uncommitted(*globalState, globalState->rootHash(), globalState->rootHashUTXO());
+    BOOST_CHECK(uncommitted.makeState()->balance(contract) == 1305);
+    BOOST_CHECK(QtumStateView(*globalState, oldRoot, oldRootUTXO).makeState()->balance(contract) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(bytecodeexec_estimate_gas){
+    genesisLoading();
+    std::shared_ptr<const ContractCallSnapshot> snapshot = GetContractCallSnapshot(m_node.chainman->ActiveChainstate());
+    ContractCall call;
+    call.opcode = CODE[0];
+    std::optional<GasEstimate> estimate = EstimateGas(call, *snapshot);
+    BOOST_REQUIRE(estimate);
+    BOOST_CHECK(estimate->trials > 1);
+    BOOST_CHECK(estimate->result.execRes.excepted == dev::eth::TransactionException::None);
+    BOOST_CHECK(estimate->gasLimit >= uint64_t(estimate->result.execRes.gasUsed));
+
+    // The call succeeds with the estimate and fails with less
+    ContractCall atLimit = call;
+    atLimit.gasLimit = estimate->gasLimit;
+    ContractCall belowLimit = call;
+    belowLimit.gasLimit = estimate->gasLimit - 1;
+    std::vector<std::vector<ResultExecute>> results = CallContracts({atLimit, belowLimit}, *snapshot);
+    BOOST_CHECK(results[0][0].execRes.excepted == dev::eth::TransactionException::None);
+    BOOST_CHECK(results[1][0].execRes.excepted != dev::eth::TransactionException::None);
+
+    std::optional<GasEstimate> cached = EstimateGas(call, *snapshot);
+    BOOST_REQUIRE(cached);
+    BOOST_CHECK_EQUAL(cached->trials, 0U);
+    BOOST_CHECK_EQUAL(cached->gasLimit, estimate->gasLimit);
+
+    // A constructor that never returns fails with any limit
+    ContractCall loop;
+    loop.opcode = CODE[1];
+    loop.gasLimit = 100000;
+    std::optional<GasEstimate> failing = EstimateGas(loop, *snapshot);
+    BOOST_REQUIRE(failing);
+    BOOST_CHECK_EQUAL(failing->gasLimit, 0U);
+    BOOST_CHECK_EQUAL(failing->trials, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(bytecodeexec_flat_state_cache){
+    genesisLoading();
+    const dev::Address contract("0202020202020202020202020202020202020202");
+    const dev::u256 key(7);
+    globalState->createContract(contract);
+    globalState->setStorage(contract, key, 1);
+    globalState->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    dev::h256 firstRoot(globalState->rootHash());
+    dev::h256 firstStorageRoot(globalState->storageRoot(contract));
+
+    globalState->setStorage(contract, key, 2);
+    globalState->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    dev::h256 secondRoot(globalState->rootHash());
+    dev::h256 secondStorageRoot(globalState->storageRoot(contract));
+    globalState->db().commit();
+
+    // The committed slots and accounts are cached under their new roots
+    dev::u256 value;
+    std::string rlp;
+    BOOST_CHECK(dev::eth::FlatStateCache::instance().storage(firstStorageRoot, key, value) && value == 1);
+    BOOST_CHECK(dev::eth::FlatStateCache::instance().storage(secondStorageRoot, key, value) && value == 2);
+    BOOST_CHECK(dev::eth::FlatStateCache::instance().account(secondRoot, contract, rlp) && !rlp.empty());
+
+    // Going back to an older root, as when a block is disconnected, reads the values of that root
+    globalState->setRoot(firstRoot);
+    BOOST_CHECK(globalState->storage(contract, key) == 1);
+    globalState->setRoot(secondRoot);
+    BOOST_CHECK(globalState->storage(contract, key) == 2);
+    BOOST_CHECK(globalState->storage(contract, dev::u256(8)) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(bytecodeexec_code_analysis_cache){
+    genesisLoading();
+    QtumTransaction txEthCreate = createQtumTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address());
+    std::vector<QtumTransaction> txsCreate(1, txEthCreate);
+    executeBC(txsCreate, *m_node.chainman);
+    dev::Address addr = createQtumAddress(txsCreate[0].getHashWith(), txsCreate[0].getNVout());
+    dev::h256 codeHash = globalState->codeHash(addr);
+
+    // The analysis of the called code is kept for the next calls, which give the same result
+    for(int i = 0; i < 2; i++){
+        QtumTransaction txEthCall = createQtumTransaction(ParseHex("00"), 1300, GASLIMIT, dev::u256(1), HASHTX, addr);
+        std::vector<QtumTransaction> txsCall(1, txEthCall);
+        auto result = executeBC(txsCall, *m_node.chainman);
+        checkBCEResult(result.second, 21037, 478963, 1, CAmount(GASLIMIT), 1);
+        BOOST_CHECK(dev::eth::CodeAnalysisCache::instance().contains(codeHash));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bytecodeexec_code_cache){
+    genesisLoading();
+    const dev::Address contract("0303030303030303030303030303030303030303");
+    const dev::bytes code = ParseHex("60606040525b600b5b5b565b00");
+    globalState->createContract(contract);
+    globalState->setCode(contract, dev::bytes(code), 0);
+    globalState->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    globalState->db().commit();
+    dev::h256 codeHash = dev::sha3(code);
+
+    // The committed code is cached and states with an empty account cache read it from there
+    dev::eth::CodeCache::Code cached = dev::eth::CodeCache::instance().get(codeHash);
+    BOOST_CHECK(cached && *cached == code);
+    QtumState state(*globalState);
+    state.setRoot(globalState->rootHash());
+    BOOST_CHECK(state.code(contract) == code);
+    BOOST_CHECK(dev::eth::CodeCache::instance().get(codeHash) == cached);
+}
+
+BOOST_AUTO_TEST_CASE(bytecodeexec_template_state_checkpoint){
+    genesisLoading();
+    QtumState templateState(*globalState);
+    const QtumState::Checkpoint checkpoint = templateState.checkpoint();
+
+    // The execution stays in the memory overlay of the template state
+    QtumTransaction txEthCreate = createQtumTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address());
+    std::vector<QtumTransaction> txsCreate(1, txEthCreate);
+    CBlock block(generateBlock());
+    ByteCodeExec exec(block, txsCreate, GASLIMIT.convert_to<uint64_t>() * 10, m_node.chainman->ActiveChain().Tip(), m_node.chainman->ActiveChain(), m_node.chainman->Qtum());
+    exec.setTemplateState(&templateState);
+    BOOST_CHECK(exec.performByteCode());
+    dev::Address addr = createQtumAddress(txsCreate[0].getHashWith(), txsCreate[0].getNVout());
+    BOOST_CHECK(templateState.addressInUse(addr));
+    BOOST_CHECK(templateState.rootHash() != checkpoint.stateRoot);
+    BOOST_CHECK(!globalState->addressInUse(addr));
+    BOOST_CHECK(!globalState->db().exists(templateState.rootHash()));
+
+    // Reverting drops the execution, and the template can move on from the checkpoint
+    const QtumState::Checkpoint executed = templateState.checkpoint();
+    templateState.revertToCheckpoint(checkpoint);
+    BOOST_CHECK(templateState.rootHash() == checkpoint.stateRoot);
+    BOOST_CHECK(templateState.rootHashUTXO() == checkpoint.utxoRoot);
+    BOOST_CHECK(!templateState.addressInUse(addr));
+    templateState.revertToCheckpoint(executed);
+    BOOST_CHECK(templateState.addressInUse(addr));
+}
+
+BOOST_AUTO_TEST_CASE(bytecodeexec_template_result_cache){
+    genesisLoading();
+    ContractExecResultCache& cache = ContractExecResultCache::instance();
+    cache.BeginTemplate(GetRandHash());
+    const unsigned int applied = cache.nApplied;
+    const unsigned int executed = cache.nExecuted;
+    auto execute = [&](QtumState& state, const CBlock& block, const std::vector<QtumTransaction>& txs) {
+        ByteCodeExec exec(block, txs, GASLIMIT.convert_to<uint64_t>() * 10, m_node.chainman->ActiveChain().Tip(), m_node.chainman->ActiveChain(), m_node.chainman->Qtum());
+        exec.setTemplateState(&state);
+        exec.setResultCache(&cache);
+        BOOST_CHECK(exec.performByteCode());
+        return state.rootHash();
+    };
+
+    QtumTransaction txEthCreate = createQtumTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address());
+    std::vector<QtumTransaction> txsCreate(1, txEthCreate);
+    dev::Address addr = createQtumAddress(txsCreate[0].getHashWith(), txsCreate[0].getNVout());
+    CBlock block(generateBlock());
+    CBlock later(block);
+    later.nTime = block.nTime + 16;
+
+    // The first template executes the transaction, the next one reuses the result
+    QtumState first(*globalState);
+    const dev::h256 root = execute(first, block, txsCreate);
+    BOOST_CHECK_EQUAL(cache.nExecuted, executed + 1);
+    BOOST_CHECK_EQUAL(cache.Size(), 1U);
+    QtumState second(*globalState);
+    BOOST_CHECK(execute(second, later, txsCreate) == root);
+    BOOST_CHECK_EQUAL(cache.nApplied, applied + 1);
+    BOOST_CHECK(second.addressInUse(addr));
+
+    // The result of a constructor that reads the block time holds only for the same block time
+    QtumTransaction txEthTime = createQtumTransaction(valtype{0x42, 0x60, 0x00, 0x55, 0x00}, 0, GASLIMIT, dev::u256(1), dev::h256(ParseHex("bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb")), dev::Address());
+    std::vector<QtumTransaction> txsTime(1, txEthTime);
+    QtumState third(*globalState);
+    const dev::h256 rootTime = execute(third, block, txsTime);
+    QtumState fourth(*globalState);
+    BOOST_CHECK(execute(fourth, later, txsTime) != rootTime);
+    BOOST_CHECK_EQUAL(cache.nExecuted, executed + 3);
+
+    // An account the execution read has changed since
+    QtumState fifth(*globalState);
+    static_cast<dev::eth::State&>(fifth).addBalance(addr, dev::u256(1));
+    fifth.commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    BOOST_CHECK(execute(fifth, block, txsCreate) != root);
+    BOOST_CHECK_EQUAL(cache.nExecuted, executed + 4);
+    BOOST_CHECK_EQUAL(cache.nApplied, applied + 1);
+
+    // The results are kept by block author, a template of another author does not drop them
+    CBlock otherAuthor(block);
+    CMutableTransaction coinbase(*otherAuthor.vtx[0]);
+    coinbase.vout[0].scriptPubKey = CScript() << OP_DUP << OP_HASH160 << ParseHex("cdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd") << OP_EQUALVERIFY << OP_CHECKSIG;
+    otherAuthor.vtx[0] = MakeTransactionRef(std::move(coinbase));
+    const uint256 tip = GetRandHash();
+    cache.BeginTemplate(tip);
+    QtumState sixth(*globalState);
+    execute(sixth, block, txsCreate);
+    cache.EndTemplate();
+    cache.BeginTemplate(tip);
+    QtumState seventh(*globalState);
+    execute(seventh, otherAuthor, txsCreate);
+    cache.EndTemplate();
+    BOOST_CHECK_EQUAL(cache.Size(), 2U);
+    const unsigned int appliedAuthors = cache.nApplied;
+    cache.BeginTemplate(tip);
+    QtumState eighth(*globalState);
+    execute(eighth, block, txsCreate);
+    cache.EndTemplate();
+    BOOST_CHECK_EQUAL(cache.nApplied, appliedAuthors + 1);
+    BOOST_CHECK_EQUAL(cache.Size(), 2U);
+
+    // The results the last template did not look up are dropped
+    cache.BeginTemplate(GetRandHash());
+    cache.EndTemplate();
+    BOOST_CHECK_EQUAL(cache.Size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(bytecodeexec_connected_block){
+    genesisLoading();
+    auto execute = [&](QtumState& state, const ConnectedBlockExec* reconnect, ConnectedBlockExec* connected, const std::vector<QtumTransaction>& txs) {
+        CBlock block(generateBlock());
+        ByteCodeExec exec(block, txs, GASLIMIT.convert_to<uint64_t>() * 10, m_node.chainman->ActiveChain().Tip(), m_node.chainman->ActiveChain(), m_node.chainman->Qtum());
+        exec.setTemplateState(&state);
+        exec.setConnectedBlock(reconnect, connected);
+        BOOST_CHECK(exec.performByteCode());
+        return exec.getResult();
+    };
+
+    QtumTransaction txEthCreate = createQtumTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), HASHTX, dev::Address());
+    std::vector<QtumTransaction> txsCreate(1, txEthCreate);
+    dev::Address addr = createQtumAddress(txsCreate[0].getHashWith(), txsCreate[0].getNVout());
+
+    // The first connection captures the write sets of the transaction
+    ConnectedBlockExec connected;
+    QtumState first(*globalState);
+    connected.parentStateRoot = first.rootHash();
+    connected.parentUTXORoot = first.rootHashUTXO();
+    const std::vector<ResultExecute> result = execute(first, nullptr, &connected, txsCreate);
+    BOOST_CHECK_EQUAL(connected.execs.size(), 1U);
+
+    // Connected again from the same state, they are replayed to the same roots and receipts
+    QtumState second(*globalState);
+    const std::vector<ResultExecute> replayed = execute(second, &connected, nullptr, txsCreate);
+    BOOST_CHECK(second.rootHash() == first.rootHash());
+    BOOST_CHECK(second.rootHashUTXO() == first.rootHashUTXO());
+    BOOST_CHECK(second.addressInUse(addr));
+    BOOST_REQUIRE_EQUAL(replayed.size(), 1U);
+    BOOST_CHECK(replayed[0].execRes.newAddress == result[0].execRes.newAddress);
+    BOOST_CHECK(replayed[0].txRec.stateRoot() == result[0].txRec.stateRoot());
+    BOOST_CHECK(replayed[0].txRec.utxoRoot() == result[0].txRec.utxoRoot());
+
+    // Transactions that differ from the ones connected are executed
+    QtumState third(*globalState);
+    std::vector<ResultExecute> none;
+    std::vector<QtumTransaction> txsChanged(1, createQtumTransaction(CODE[0], 0, GASLIMIT + 1, dev::u256(1), HASHTX, dev::Address()));
+    BOOST_CHECK(!connected.Apply(txsChanged, third, *m_node.chainman->Qtum().sealEngine, none));
+    std::vector<QtumTransaction> txsOther(1, createQtumTransaction(CODE[0], 0, GASLIMIT, dev::u256(1), dev::h256(ParseHex("cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc")), dev::Address()));
+    BOOST_CHECK(!connected.Apply(txsOther, third, *m_node.chainman->Qtum().sealEngine, none));
+    BOOST_CHECK(none.empty());
+    BOOST_CHECK(third.rootHash() == connected.parentStateRoot);
+
+    // Write sets that were not completely captured are not kept
+    ConnectedBlockExec incomplete;
+    incomplete.Add(txsCreate, result, std::vector<ExecutionWriteSet>(1));
+    BOOST_CHECK(incomplete.execs.empty());
+
+    // The blocks are found from the state they were connected on, the oldest are dropped
+    ConnectedBlockCache cache;
+    auto exec = std::make_shared<const ConnectedBlockExec>(connected);
+    cache.Store(uint256::ONE, exec);
+    BOOST_CHECK(cache.Find(uint256::ONE, connected.parentStateRoot, connected.parentUTXORoot) == exec);
+    BOOST_CHECK(!cache.Find(uint256::ONE, first.rootHash(), connected.parentUTXORoot));
+    BOOST_CHECK(!cache.Find(uint256::ZERO, connected.parentStateRoot, connected.parentUTXORoot));
+    for(size_t i = 0; i < CONNECTED_BLOCK_CACHE_BLOCKS; i++){
+        cache.Store(GetRandHash(), exec);
+    }
+    BOOST_CHECK_EQUAL(cache.Size(), CONNECTED_BLOCK_CACHE_BLOCKS);
+    BOOST_CHECK(!cache.Find(uint256::ONE, connected.parentStateRoot, connected.parentUTXORoot));
+}
+
+BOOST_AUTO_TEST_CASE(bytecodeexec_time_model){
+    ContractExecTimeModel model;
+    const dev::Address slow(dev::u160(1)), fast(dev::u160(2)), unknown(dev::u160(3));
+    std::vector<QtumTransaction> txs{createQtumTransaction(ParseHex("00"), 0, dev::u256(1000), dev::u256(1), HASHTX, slow)};
+    BOOST_CHECK(model.Predict(txs).count() == 0);
+
+    // 1us and 10ns per unit of gas
+    model.Record(slow, 1000, std::chrono::milliseconds{1});
+    model.Record(fast, 1000, std::chrono::microseconds{10});
+    BOOST_CHECK_EQUAL(model.Predict(txs).count(), 1000);
+    txs.push_back(createQtumTransaction(ParseHex("00"), 0, dev::u256(100000), dev::u256(1), HASHTX, fast));
+    BOOST_CHECK_EQUAL(model.Predict(txs).count(), 2000);
+
+    // The rate moves towards the recent executions
+    model.Record(slow, 1000, std::chrono::microseconds{200});
+    BOOST_CHECK(model.Predict({txs[0]}).count() < 1000);
+    // Other contracts and creations use the average rate
+    const std::chrono::microseconds average = model.Predict({createQtumTransaction(CODE[0], 0, dev::u256(1000), dev::u256(1), HASHTX, dev::Address())});
+    BOOST_CHECK(average.count() > 0);
+    BOOST_CHECK(model.Predict({createQtumTransaction(ParseHex("00"), 0, dev::u256(1000), dev::u256(1), HASHTX, unknown)}) == average);
+
+    // The contracts executed the longest ago are forgotten
+    for(unsigned i = 0; i < MAX_CONTRACT_TIME_RATES; i++){
+        model.Record(dev::Address(dev::u160(i + 10)), 1000, std::chrono::microseconds{10});
+    }
+    BOOST_CHECK(model.Size() <= MAX_CONTRACT_TIME_RATES);
+    BOOST_CHECK(model.Predict({txs[0]}) == model.Predict({createQtumTransaction(ParseHex("00"), 0, dev::u256(1000), dev::u256(1), HASHTX, unknown)}));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
@@ -342,4 +342,15 @@ BOOST_AUTO_TEST_CASE(condensingtransactionpaytopubkeyhash_tests){
     BOOST_CHECK(result.second.valueTransfers[0].vout[1].scriptPubKey.HasOpCall());
 }
 
+BOOST_AUTO_TEST_CASE(condensingtransaction_intx_conversion){
+    const dev::u256 values[] = {0, 1, dev::u256(1) << 63, (dev::u256(1) << 64) + 3, dev::u256(-1)};
+    for(const dev::u256& value : values){
+        intx::uint256 x = u256ToIntx(value);
+        BOOST_CHECK(intxToU256(x) == value);
+        BOOST_CHECK(intxToU256(x * x + x) == value * value + value);
+        // Amounts saturate like CAmount(dev::u256)
+        BOOST_CHECK_EQUAL(intxToAmount(x), CAmount(value));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
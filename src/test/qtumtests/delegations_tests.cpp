@@ -3,6 +3,8 @@
 #include <script/standard.h>
 #include <chainparams.h>
 #include <qtum/qtumdelegation.h>
+#include <pos.h>
+#include <script/sigcache.h>
 
 namespace DelegationTest{
 
@@ -66,6 +68,34 @@ BOOST_AUTO_TEST_CASE(checking_verify_delegation){
     BOOST_CHECK(QtumDelegation::VerifyDelegation(address, delegation) == false);
 }
 
+BOOST_AUTO_TEST_CASE(checking_verify_delegation_cache){
+    // Valid proofs of delegation are remembered in the signature cache
+    uint160 address(ParseHex(DELEGATE_ADDRESS_HEX));
+    uint160 staker(ParseHex(STAKER_ADDRESS_HEX));
+    std::vector<unsigned char> PoD = ParseHex(POD_HEX);
+    BOOST_CHECK(!DelegationProofCacheGet(address, staker, PoD));
+    BOOST_CHECK(VerifyProofOfDelegation(address, staker, PoD));
+    BOOST_CHECK(DelegationProofCacheGet(address, staker, PoD));
+    // The entry is kept after it is found
+    BOOST_CHECK(DelegationProofCacheGet(address, staker, PoD));
+
+    Delegation delegation;
+    delegation.staker = staker;
+    delegation.fee = STAKER_FEE;
+    delegation.PoD = PoD;
+    BOOST_CHECK(VerifyStakeDelegation(address, delegation));
+    delegation.fee = 101;
+    BOOST_CHECK(!VerifyStakeDelegation(address, delegation));
+
+    // Invalid proofs and other stakers are verified and not remembered
+    uint160 otherStaker(ParseHex(DELEGATE_ADDRESS_HEX));
+    BOOST_CHECK(!DelegationProofCacheGet(address, otherStaker, PoD));
+    BOOST_CHECK(!VerifyProofOfDelegation(address, otherStaker, PoD));
+    PoD[0] = 20;
+    BOOST_CHECK(!VerifyProofOfDelegation(address, staker, PoD));
+    BOOST_CHECK(!DelegationProofCacheGet(address, staker, PoD));
+}
+
 BOOST_AUTO_TEST_CASE(checking_delegations_from_events){
     // Initialize event
     DelegationEvent event;
@@ -153,6 +183,58 @@ BOOST_AUTO_TEST_CASE(checking_delegations_contract){
     BOOST_CHECK(QtumDelegation::VerifyDelegation(address, delegation) == false);
 }
 
+BOOST_AUTO_TEST_CASE(checking_delegation_cache){
+    DelegationCache cache;
+    uint160 address(ParseHex(DELEGATE_ADDRESS_HEX));
+    uint256 root0 = uint256S("01"), root1 = uint256S("02"), root2 = uint256S("03");
+
+    // Initialize events
+    DelegationEvent add;
+    add.type = DELEGATION_ADD;
+    add.item.delegate = address;
+    add.item.staker = uint160(ParseHex(STAKER_ADDRESS_HEX));
+    add.item.fee = STAKER_FEE;
+    add.item.PoD = ParseHex(POD_HEX);
+    DelegationEvent remove = add;
+    remove.type = DELEGATION_REMOVE;
+
+    // The cache is filled with the delegations read from the contract
+    Delegation delegation;
+    BOOST_CHECK(cache.Lookup(root0, address, delegation) == false);
+    cache.Insert(root0, address, Delegation());
+    BOOST_CHECK(cache.Lookup(root0, address, delegation) == true);
+    BOOST_CHECK(delegation.IsNull());
+
+    // The connected blocks move the cache with their events
+    cache.ConnectBlock(root0, root1, {add});
+    BOOST_CHECK(cache.Lookup(root0, address, delegation) == false);
+    BOOST_CHECK(cache.Lookup(root1, address, delegation) == true);
+    BOOST_CHECK(delegation.staker == add.item.staker);
+    BOOST_CHECK(delegation.fee == STAKER_FEE);
+    cache.ConnectBlock(root1, root2, {remove, add, remove});
+    BOOST_CHECK(cache.Lookup(root2, address, delegation) == true);
+    BOOST_CHECK(delegation.IsNull());
+
+    // The disconnected blocks move it back
+    cache.DisconnectBlock(root2, root1);
+    BOOST_CHECK(cache.Lookup(root1, address, delegation) == true);
+    BOOST_CHECK(delegation.staker == add.item.staker);
+    cache.DisconnectBlock(root1, root0);
+    BOOST_CHECK(cache.Lookup(root0, address, delegation) == true);
+    BOOST_CHECK(delegation.IsNull());
+
+    // A block that does not follow the cache empties it
+    cache.ConnectBlock(root1, root2, {});
+    BOOST_CHECK(cache.Size() == 0);
+    BOOST_CHECK(cache.Lookup(root2, address, delegation) == false);
+
+    // Only the delegations of the state root of the cache are inserted
+    cache.Insert(root2, address, Delegation());
+    cache.Insert(root0, add.item.staker, Delegation());
+    BOOST_CHECK(cache.Size() == 1);
+    BOOST_CHECK(cache.Lookup(root0, add.item.staker, delegation) == false);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
@@ -361,6 +361,50 @@ void checkValue(T value, T value1, T value2, T value3, T value4, size_t i, std::
         BOOST_CHECK(func(value, value1));
 }
 
+/**
+ * Deploy the parameters contract @p paramsCode for the DGP @p dgpAddress, then switch the global state back
+ * to the root before the deployment and forward again, as DisconnectBlock and ConnectBlock do. The values
+ * read through the process-wide DGP caches must follow the state root: @p check gets whether the new
+ * parameters are expected.
+ */
+void checkDisconnectReconnect(const valtype& paramsCode, dev::Address dgpAddress, ChainstateManager& chainman, std::function<void(QtumDGP&, bool)> check){
+    const dev::h256 oldHashStateRoot = globalState->rootHash();
+    const dev::h256 oldHashUTXORoot = globalState->rootHashUTXO();
+    {
+        QtumDGP qtumDGP(globalState.get(), chainman.ActiveChainstate());
+        check(qtumDGP, false);
+    }
+
+    dev::h256 hashTemp(hash);
+    std::vector<QtumTransaction> txs;
+    txs.push_back(createQtumTransaction(code[0], 0, dev::u256(500000), dev::u256(1), hashTemp, dgpAddress, 0));
+    txs.push_back(createQtumTransaction(paramsCode, 0, dev::u256(500000), dev::u256(1), ++hashTemp, dev::Address(), 0));
+    txs.push_back(createQtumTransaction(code[2], 0, dev::u256(500000), dev::u256(1), ++hashTemp, dgpAddress, 0));
+    auto result = executeBC(txs, chainman);
+    const dev::h256 newHashStateRoot = globalState->rootHash();
+    const dev::h256 newHashUTXORoot = globalState->rootHashUTXO();
+    {
+        QtumDGP qtumDGP(globalState.get(), chainman.ActiveChainstate());
+        check(qtumDGP, true);
+    }
+
+    // Disconnect the block that deployed the parameters
+    globalState->setRoot(oldHashStateRoot);
+    globalState->setRootUTXO(oldHashUTXORoot);
+    {
+        QtumDGP qtumDGP(globalState.get(), chainman.ActiveChainstate());
+        check(qtumDGP, false);
+    }
+
+    // Connect it again
+    globalState->setRoot(newHashStateRoot);
+    globalState->setRootUTXO(newHashUTXORoot);
+    {
+        QtumDGP qtumDGP(globalState.get(), chainman.ActiveChainstate());
+        check(qtumDGP, true);
+    }
+}
+
 BOOST_FIXTURE_TEST_SUITE(dgp_tests, TestChain100Setup)
 
 BOOST_AUTO_TEST_CASE(gas_schedule_default_state_test1){
@@ -450,6 +494,16 @@ BOOST_AUTO_TEST_CASE(gas_schedule_passage_from_130_to_0_three_paramsInstance_tes
     }
 }
 
+BOOST_AUTO_TEST_CASE(gas_schedule_disconnect_reconnect_test){
+    initState();
+    contractLoading();
+    int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(0);
+    checkDisconnectReconnect(code[1], GasScheduleDGP, *m_node.chainman, [&](QtumDGP& qtumDGP, bool deployed){
+        dev::eth::EVMSchedule schedule = qtumDGP.getGasSchedule(coinbaseMaturity + 2);
+        BOOST_CHECK(compareEVMSchedule(schedule, deployed ? EVMScheduleContractGasSchedule : dev::eth::EIP158Schedule));
+    });
+}
+
 BOOST_AUTO_TEST_CASE(block_size_default_state_test1){
     initState();
     contractLoading();
@@ -535,6 +589,17 @@ BOOST_AUTO_TEST_CASE(block_size_passage_from_130_to_0_three_paramsInstance_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(block_size_disconnect_reconnect_test){
+    initState();
+    contractLoading();
+    int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(0);
+    uint32_t blocktimeDownscaleFactor = Params().GetConsensus().BlocktimeDownscaleFactor(coinbaseMaturity + 2);
+    checkDisconnectReconnect(code[7], BlockSizeDGP, *m_node.chainman, [&](QtumDGP& qtumDGP, bool deployed){
+        uint32_t blockSize = qtumDGP.getBlockSize(coinbaseMaturity + 2);
+        BOOST_CHECK(blockSize == (deployed ? 1000000 : DEFAULT_BLOCK_SIZE_DGP / blocktimeDownscaleFactor));
+    });
+}
+
 BOOST_AUTO_TEST_CASE(min_gas_price_default_state_test1){
     initState();
     contractLoading();
@@ -612,6 +677,16 @@ BOOST_AUTO_TEST_CASE(min_gas_price_passage_from_130_to_0_three_paramsInstance_te
     }
 }
 
+BOOST_AUTO_TEST_CASE(min_gas_price_disconnect_reconnect_test){
+    initState();
+    contractLoading();
+    int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(0);
+    checkDisconnectReconnect(code[10], GasPriceDGP, *m_node.chainman, [&](QtumDGP& qtumDGP, bool deployed){
+        uint64_t minGasPrice = qtumDGP.getMinGasPrice(coinbaseMaturity + 2);
+        BOOST_CHECK(minGasPrice == (deployed ? 13 : DEFAULT_MIN_GAS_PRICE_DGP));
+    });
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
@@ -0,0 +1,44 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <libdevcrypto/ModExp.h>
+
+namespace modexp_tests {
+
+dev::bigint randomBigint(size_t bits){
+    dev::bigint ret = 0;
+    for(size_t i = 0; i < bits; i += 64){
+        ret = (ret << 64) | InsecureRandBits(64);
+    }
+    return ret >> ((bits + 63) / 64 * 64 - bits);
+}
+
+BOOST_FIXTURE_TEST_SUITE(modexp_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(modexp_fixed_width){
+    // The fixed-width kernels give the results of powm for odd moduli of each width
+    for(size_t bits : {2, 64, 65, 255, 256, 300, 512, 1000, 1024, 2047, 2048, 4000, 4096}){
+        for(int i = 0; i < 5; i++){
+            const dev::bigint mod = randomBigint(bits) | 1 | (dev::bigint(1) << (bits - 1));
+            dev::bigint base = randomBigint(bits + 64 * i);
+            if(i == 1) base = 0;
+            if(i == 2) base = mod - 1;
+            const dev::bigint exp = i == 3 ? dev::bigint(0) : randomBigint(1 + InsecureRandRange(600));
+
+            dev::bigint result;
+            BOOST_REQUIRE(dev::crypto::modexpFixedWidth(base, exp, mod, result));
+            BOOST_CHECK(result == boost::multiprecision::powm(base, exp, mod));
+        }
+    }
+
+    // Even moduli, moduli of 0 and 1 and moduli wider than 4096 bits are left to powm
+    dev::bigint result;
+    BOOST_CHECK(!dev::crypto::modexpFixedWidth(3, 5, 0, result));
+    BOOST_CHECK(!dev::crypto::modexpFixedWidth(3, 5, 1, result));
+    BOOST_CHECK(!dev::crypto::modexpFixedWidth(3, 5, 1024, result));
+    BOOST_CHECK(!dev::crypto::modexpFixedWidth(3, 5, (dev::bigint(1) << 4096) + 1, result));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
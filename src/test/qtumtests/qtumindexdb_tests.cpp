@@ -0,0 +1,98 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+#include <validation.h>
+
+namespace qtumindexdb_tests {
+
+BOOST_FIXTURE_TEST_SUITE(qtumindexdb_tests, ChainTestingSetup)
+
+BOOST_AUTO_TEST_CASE(qtumindexdb_migration){
+    CBlockTreeDB block_tree_db(DBParams{.path = m_path_root / "blocktree", .cache_bytes = 1 << 20, .memory_only = true});
+    CQtumIndexDB qtum_index_db(DBParams{.path = m_path_root / "qtumindex", .cache_bytes = 1 << 20, .memory_only = true});
+
+    // Entries as older versions wrote them in the block tree database
+    const dev::h160 contract(1);
+    const uint160 staker = uint160S("0101010101010101010101010101010101010101");
+    const uint160 delegate = uint160S("0202020202020202020202020202020202020202");
+    const std::vector<uint256> hashes{uint256S("aa"), uint256S("bb")};
+    BOOST_CHECK(block_tree_db.Write(std::make_pair(uint8_t{'h'}, CHeightTxIndexKey(5, contract)), hashes));
+    BOOST_CHECK(block_tree_db.Write(std::make_pair(uint8_t{'s'}, 5U), staker));
+    BOOST_CHECK(block_tree_db.Write(std::make_pair(uint8_t{'d'}, 5U), std::make_pair(delegate, uint8_t{10})));
+    BOOST_CHECK(block_tree_db.WriteFlag("logevents", true));
+
+    BOOST_CHECK(MigrateQtumIndexes(block_tree_db, qtum_index_db));
+
+    // The entries are read from the new database and gone from the old one
+    std::vector<std::vector<uint256>> blocksOfHashes;
+    BOOST_CHECK_EQUAL(qtum_index_db.ReadHeightIndex(5, 5, 0, blocksOfHashes, {}, *m_node.chainman), 5);
+    BOOST_CHECK(blocksOfHashes == std::vector<std::vector<uint256>>{hashes});
+    uint160 address;
+    uint8_t fee = 0;
+    BOOST_CHECK(qtum_index_db.ReadStakeIndex(5, address));
+    BOOST_CHECK(address == staker);
+    BOOST_CHECK(qtum_index_db.ReadDelegateIndex(5, address, fee));
+    BOOST_CHECK(address == delegate);
+    BOOST_CHECK_EQUAL(fee, 10);
+
+    BOOST_CHECK(!block_tree_db.Exists(std::make_pair(uint8_t{'h'}, CHeightTxIndexKey(5, contract))));
+    BOOST_CHECK(!block_tree_db.Exists(std::make_pair(uint8_t{'s'}, 5U)));
+    BOOST_CHECK(!block_tree_db.Exists(std::make_pair(uint8_t{'d'}, 5U)));
+    bool logevents = false;
+    BOOST_CHECK(block_tree_db.ReadFlag("logevents", logevents) && logevents);
+
+    // Nothing is left to move on the next start
+    BOOST_CHECK(MigrateQtumIndexes(block_tree_db, qtum_index_db));
+    uint160 stake_address;
+    BOOST_CHECK(qtum_index_db.ReadStakeIndex(5, stake_address));
+    BOOST_CHECK(stake_address == staker);
+}
+
+BOOST_AUTO_TEST_CASE(qtumindexdb_contract_index){
+    CQtumIndexDB qtum_index_db(DBParams{.path = m_path_root / "qtumindex", .cache_bytes = 1 << 20, .memory_only = true});
+
+    // The index is not available until it is started
+    unsigned int count = 0;
+    const CContractIndexEntry genesis{dev::h160(1), 0, uint256(), uint256S("01")};
+    BOOST_CHECK(qtum_index_db.WriteContractIndex({genesis}));
+    BOOST_CHECK(!qtum_index_db.ReadContractCount(count));
+
+    BOOST_CHECK(qtum_index_db.StartContractIndex());
+    BOOST_CHECK(qtum_index_db.WriteContractIndex({genesis}));
+    const CContractIndexEntry first{dev::h160(2), 10, uint256S("aa"), uint256S("02")};
+    const CContractIndexEntry second{dev::h160(3), 11, uint256S("bb"), uint256S("03")};
+    BOOST_CHECK(qtum_index_db.WriteContractIndex({first}));
+    BOOST_CHECK(qtum_index_db.WriteContractIndex({second}));
+
+    // A contract created again at the same address keeps its first position
+    BOOST_CHECK(qtum_index_db.WriteContractIndex({CContractIndexEntry{dev::h160(2), 12, uint256S("cc"), uint256S("04")}}));
+    BOOST_CHECK(qtum_index_db.ReadContractCount(count));
+    BOOST_CHECK_EQUAL(count, 3U);
+
+    std::vector<CContractIndexEntry> contracts;
+    BOOST_CHECK(qtum_index_db.ReadContractIndex(1, 5, contracts));
+    BOOST_REQUIRE_EQUAL(contracts.size(), 2U);
+    BOOST_CHECK(contracts[0].address == first.address && contracts[0].height == 10 && contracts[0].txid == first.txid && contracts[0].codeHash == first.codeHash);
+    BOOST_CHECK(contracts[1].address == second.address && contracts[1].height == 11);
+
+    // Disconnecting blocks erases the contracts they created, which can then be created again
+    BOOST_CHECK(qtum_index_db.EraseContractIndexes({12, 11}));
+    BOOST_CHECK(qtum_index_db.ReadContractCount(count));
+    BOOST_CHECK_EQUAL(count, 2U);
+    BOOST_CHECK(qtum_index_db.WriteContractIndex({CContractIndexEntry{dev::h160(3), 11, uint256S("dd"), uint256S("03")}}));
+    contracts.clear();
+    BOOST_CHECK(qtum_index_db.ReadContractIndex(0, 2, contracts));
+    BOOST_REQUIRE_EQUAL(contracts.size(), 2U);
+    BOOST_CHECK(contracts[0].address == genesis.address && contracts[1].address == first.address);
+    contracts.clear();
+    BOOST_CHECK(qtum_index_db.ReadContractIndex(2, 2, contracts));
+    BOOST_REQUIRE_EQUAL(contracts.size(), 1U);
+    BOOST_CHECK(contracts[0].txid == uint256S("dd"));
+
+    BOOST_CHECK(qtum_index_db.WipeContractIndex());
+    BOOST_CHECK(!qtum_index_db.ReadContractCount(count));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
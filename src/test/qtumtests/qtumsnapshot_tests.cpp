@@ -0,0 +1,87 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/setup_common.h>
+#include <qtum/qtumsnapshot.h>
+#include <streams.h>
+#include <validation.h>
+
+namespace qtumsnapshot_tests {
+
+const dev::Address CONTRACT("0303030303030303030303030303030303030303");
+const dev::Address ACCOUNT("0404040404040404040404040404040404040404");
+
+void fillState(QtumState& state){
+    state.createContract(CONTRACT);
+    state.setCode(CONTRACT, dev::bytes{0x60, 0x00}, 0);
+    for(unsigned i = 1; i <= 50; i++){
+        state.setStorage(CONTRACT, dev::u256(i), dev::u256(i * 1000));
+    }
+    static_cast<dev::eth::State&>(state).addBalance(ACCOUNT, dev::u256(12345));
+    state.commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    std::unordered_map<dev::Address, Vin> vins;
+    vins[CONTRACT] = Vin{dev::h256(7), 1, dev::u256(500), 1};
+    state.importVins(vins);
+    state.db().commit();
+    state.dbUtxo().commit();
+}
+
+std::unique_ptr<QtumState> emptyState(const fs::path& dir){
+    fs::create_directories(dir);
+    const dev::h256 hashDB(dev::sha3(dev::rlp("")));
+    return std::make_unique<QtumState>(dev::u256(0), QtumState::openDB(PathToString(dir), hashDB, dev::WithExisting::Trust), PathToString(dir / "qtumDB"), dev::eth::BaseState::Empty);
+}
+
+BOOST_FIXTURE_TEST_SUITE(qtumsnapshot_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(qtumsnapshot_roundtrip){
+    std::unique_ptr<QtumState> source = emptyState(m_path_root / "source");
+    fillState(*source);
+    QtumStateView view(*source, source->rootHash(), source->rootHashUTXO());
+    qtum::ContractStateSnapshotMetadata metadata(uint256::ONE, h256Touint(view.rootHash()), h256Touint(view.rootHashUTXO()));
+    auto noInterruption = []() {};
+
+    const fs::path path = m_path_root / "contracts.dat";
+    {
+        AutoFile afile{fsbridge::fopen(path, "wb")};
+        qtum::ContractStateSnapshotStats stats;
+        BOOST_CHECK(qtum::WriteContractStateSnapshot(afile, metadata, view, stats, noInterruption));
+        BOOST_CHECK_EQUAL(stats.accounts, 2U);
+        BOOST_CHECK_EQUAL(stats.storage_slots, 50U);
+        BOOST_CHECK_EQUAL(stats.vins, 1U);
+    }
+
+    // The tries are rebuilt in an empty database and hash to the roots of the source
+    {
+        std::unique_ptr<QtumState> target = emptyState(m_path_root / "target");
+        AutoFile afile{fsbridge::fopen(path, "rb")};
+        qtum::ContractStateSnapshotMetadata read;
+        afile >> read;
+        BOOST_CHECK(read.m_base_blockhash == uint256::ONE);
+        qtum::ContractStateSnapshotStats stats;
+        std::string error;
+        BOOST_CHECK(qtum::LoadContractStateSnapshot(afile, read, *target, stats, error, noInterruption));
+        BOOST_CHECK(error.empty());
+        BOOST_CHECK_EQUAL(stats.accounts, 2U);
+        BOOST_CHECK(target->rootHash() == source->rootHash());
+        BOOST_CHECK(target->rootHashUTXO() == source->rootHashUTXO());
+        BOOST_CHECK(target->storage(CONTRACT, dev::u256(20)) == 20000);
+        BOOST_CHECK(target->code(CONTRACT) == source->code(CONTRACT));
+        BOOST_CHECK(target->balance(ACCOUNT) == 12345);
+    }
+
+    // Leaves that do not hash to the roots of the metadata are rejected
+    {
+        std::unique_ptr<QtumState> target = emptyState(m_path_root / "tampered");
+        AutoFile afile{fsbridge::fopen(path, "rb")};
+        qtum::ContractStateSnapshotMetadata read;
+        afile >> read;
+        read.m_state_root = uint256::ONE;
+        qtum::ContractStateSnapshotStats stats;
+        std::string error;
+        BOOST_CHECK(!qtum::LoadContractStateSnapshot(afile, read, *target, stats, error, noInterruption));
+        BOOST_CHECK(error.find("state root") != std::string::npos);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,109 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/setup_common.h>
+#include <qtum/qtumstatesync.h>
+#include <validation.h>
+
+namespace qtumstatesync_tests {
+
+const dev::Address CONTRACT("0303030303030303030303030303030303030303");
+const dev::Address ACCOUNT("0404040404040404040404040404040404040404");
+
+void fillState(QtumState& state){
+    state.createContract(CONTRACT);
+    state.setCode(CONTRACT, dev::bytes{0x60, 0x00}, 0);
+    for(unsigned i = 1; i <= 50; i++){
+        state.setStorage(CONTRACT, dev::u256(i), dev::u256(i * 1000));
+    }
+    static_cast<dev::eth::State&>(state).addBalance(ACCOUNT, dev::u256(12345));
+    state.commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    std::unordered_map<dev::Address, Vin> vins;
+    vins[CONTRACT] = Vin{dev::h256(7), 1, dev::u256(500), 1};
+    state.importVins(vins);
+    state.db().commit();
+    state.dbUtxo().commit();
+}
+
+std::unique_ptr<QtumState> openState(const fs::path& dir){
+    fs::create_directories(dir);
+    const dev::h256 hashDB(dev::sha3(dev::rlp("")));
+    return std::make_unique<QtumState>(dev::u256(0), QtumState::openDB(PathToString(dir), hashDB, dev::WithExisting::Trust), PathToString(dir / "qtumDB"), dev::eth::BaseState::Empty);
+}
+
+/** Answer the requests of the sync from the view, @returns the number of rounds */
+size_t download(qtum::ContractStateSync& sync, const QtumStateView& view, NodeId peer, size_t max_rounds){
+    size_t rounds = 0;
+    while(!sync.IsComplete() && rounds < max_rounds){
+        std::vector<qtum::StateItemRequest> requests = sync.NextRequests(peer, 4);
+        BOOST_REQUIRE(!requests.empty());
+        sync.ProcessItems(peer, qtum::ReadStateItems(view, requests));
+        rounds++;
+    }
+    return rounds;
+}
+
+BOOST_FIXTURE_TEST_SUITE(qtumstatesync_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(qtumstatesync_download){
+    std::unique_ptr<QtumState> source = openState(m_path_root / "source");
+    fillState(*source);
+    QtumStateView view(*source, source->rootHash(), source->rootHashUTXO());
+    const uint256 stateRoot = h256Touint(source->rootHash());
+    const uint256 utxoRoot = h256Touint(source->rootHashUTXO());
+    const fs::path dir = m_path_root / "target";
+
+    // Items that were not requested or do not hash to a requested item are ignored
+    uint64_t written;
+    {
+        qtum::ContractStateSync sync(openState(dir), uint256::ONE, stateRoot, utxoRoot);
+        BOOST_CHECK(!sync.IsComplete());
+        BOOST_CHECK_EQUAL(sync.ProcessItems(0, {qtum::StateItem{0, 0, {1, 2, 3}}}), 0U);
+
+        // The items of a peer that left are requested from another peer
+        std::vector<qtum::StateItemRequest> requests = sync.NextRequests(1, 2);
+        BOOST_CHECK_EQUAL(requests.size(), 2U);
+        BOOST_CHECK(sync.NextRequests(2, 2).empty());
+        BOOST_CHECK_EQUAL(sync.GetStats().in_flight, 2U);
+        sync.PeerDone(1);
+        BOOST_CHECK_EQUAL(sync.NextRequests(2, 2).size(), 2U);
+        sync.PeerDone(2);
+
+        // Interrupted after a few items, the nodes whose subtrees are complete are kept
+        download(sync, view, 0, 5);
+        BOOST_CHECK(!sync.IsComplete());
+        written = sync.GetStats().nodes;
+    }
+
+    // Started again, the download skips the subtrees written and completes
+    {
+        qtum::ContractStateSync sync(openState(dir), uint256::ONE, stateRoot, utxoRoot);
+        download(sync, view, 0, 1000);
+        BOOST_CHECK(sync.IsComplete());
+        qtum::ContractStateSyncStats stats = sync.GetStats();
+        BOOST_CHECK(stats.complete);
+        BOOST_CHECK_EQUAL(stats.pending, 0U);
+        BOOST_CHECK(stats.aux > 0);
+        BOOST_CHECK(written > 0);
+        BOOST_CHECK(stats.nodes > 0);
+    }
+
+    std::unique_ptr<QtumState> target = openState(dir);
+    target->setRoot(uintToh256(stateRoot));
+    target->setRootUTXO(uintToh256(utxoRoot));
+    BOOST_CHECK(target->rootHash() == source->rootHash());
+    BOOST_CHECK(target->storage(CONTRACT, dev::u256(20)) == 20000);
+    BOOST_CHECK(target->code(CONTRACT) == source->code(CONTRACT));
+    BOOST_CHECK(target->balance(ACCOUNT) == 12345);
+    const Vin* vin = static_cast<const QtumState&>(*target).vin(CONTRACT);
+    BOOST_CHECK(vin && vin->value == 500);
+    // The key preimages were downloaded with the leaves, so the tries can be iterated
+    BOOST_CHECK_EQUAL(target->addresses().size(), 2U);
+    BOOST_CHECK_EQUAL(target->storage(CONTRACT).size(), 50U);
+
+    // A completed download has nothing left to request
+    qtum::ContractStateSync sync(std::move(target), uint256::ONE, stateRoot, utxoRoot);
+    BOOST_CHECK(sync.IsComplete());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
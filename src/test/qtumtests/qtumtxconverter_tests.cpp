@@ -35,7 +35,7 @@ void checkResult(bool isCreation, std::vector<QtumTransaction> results, uint256
             BOOST_CHECK(!results[i].isCreation());
             BOOST_CHECK(results[i].receiveAddress() == dev::Address(address));
         }
-        BOOST_CHECK(results[i].data() == data);
+        BOOST_CHECK(dev::bytes(results[i].data().begin(), results[i].data().end()) == data);
         BOOST_CHECK(results[i].value() == value);
         BOOST_CHECK(results[i].gasPrice() == gasPrice);
         BOOST_CHECK(results[i].gas() == gasLimit);
@@ -0,0 +1,120 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <checkqueue.h>
+#include <pos.h>
+
+namespace stakekernel_tests {
+
+void checkSearch(int nHeight, unsigned int nBits)
+{
+    CBlockIndex index;
+    index.nHeight = nHeight - 1;
+    index.nStakeModifier = InsecureRand256();
+
+    std::vector<COutPoint> prevouts;
+    CStakeCacheMap cache;
+    for(uint32_t i = 0; i < 2000; i++)
+    {
+        COutPoint prevout(InsecureRand256(), i % 4);
+        prevouts.push_back(prevout);
+        // Some coins are not cached and can not stake
+        if(i % 10 == 0) continue;
+        cache.insert(prevout, CStakeCache(1000 + i, (1 + InsecureRandRange(1000)) * COIN));
+    }
+
+    StakeKernelSearch search(&index, nBits, prevouts, cache);
+    BOOST_CHECK_EQUAL(search.Size(), 1800U);
+
+    CCheckQueue<StakeKernelCheck> queue(STAKE_KERNEL_QUEUE_BATCH_SIZE);
+    queue.StartWorkerThreads(3);
+    size_t found = 0;
+    for(uint32_t nTimeBlock = 2000; nTimeBlock < 3040; nTimeBlock += 16)
+    {
+        std::map<uint32_t, uint256> expected;
+        for(size_t i = 0; i < prevouts.size(); i++)
+        {
+            uint256 hashProofOfStake;
+            if(CheckKernelCache(&index, nBits, nTimeBlock, prevouts[i], cache, hashProofOfStake))
+                expected[i] = hashProofOfStake;
+        }
+        found += expected.size();
+
+        for(CCheckQueue<StakeKernelCheck>* pqueue : {(CCheckQueue<StakeKernelCheck>*)nullptr, &queue})
+        {
+            std::map<uint32_t, uint256> kernels;
+            for(const StakeKernelSearch::Kernel& kernel : search.Search(nTimeBlock, pqueue))
+                BOOST_CHECK(kernels.emplace(kernel.index, kernel.hashProofOfStake).second);
+            BOOST_CHECK(kernels == expected);
+        }
+    }
+    queue.StopWorkerThreads();
+
+    // Some kernels meet the target and most do not
+    BOOST_CHECK(found > 0);
+    BOOST_CHECK(found < 1800 * 65 / 2);
+}
+
+BOOST_FIXTURE_TEST_SUITE(stakekernel_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(stakekernel_search_weighted_target){
+    checkSearch(Params().GetConsensus().nReduceBlocktimeHeight - 1, 0x1c00ffff);
+}
+
+BOOST_AUTO_TEST_CASE(stakekernel_search_divided_proof){
+    checkSearch(Params().GetConsensus().nReduceBlocktimeHeight, 0x1c00ffff);
+}
+
+BOOST_AUTO_TEST_CASE(stakekernel_cache_generations){
+    CStakeCacheMap cache;
+    std::vector<COutPoint> prevouts;
+    for(uint32_t i = 0; i < 1000; i++)
+    {
+        prevouts.emplace_back(InsecureRand256(), i);
+        cache.insert(prevouts.back(), CStakeCache(i, i * COIN));
+    }
+    BOOST_CHECK_EQUAL(cache.size(), 1000U);
+    for(uint32_t i = 0; i < 1000; i++)
+    {
+        const CStakeCache* stake = cache.find(prevouts[i]);
+        BOOST_REQUIRE(stake);
+        BOOST_CHECK_EQUAL(stake->blockFromTime, i);
+        BOOST_CHECK_EQUAL(stake->amount, i * COIN);
+    }
+    BOOST_CHECK(!cache.find(COutPoint(InsecureRand256(), 0)));
+
+    // Coins already cached are not replaced
+    cache.insert(prevouts[0], CStakeCache(5, 5));
+    BOOST_CHECK_EQUAL(cache.find(prevouts[0])->blockFromTime, 0U);
+
+    // Only the first half of the coins stays in use for two generations
+    for(int generation = 0; generation < 2; generation++)
+    {
+        cache.newGeneration();
+        for(uint32_t i = 0; i < 500; i++)
+            BOOST_CHECK(cache.touch(prevouts[i]));
+    }
+
+    // The unused coins are dropped when the table is rehashed to make room for new ones
+    std::vector<COutPoint> added;
+    for(uint32_t i = 0; i < 1000; i++)
+    {
+        added.emplace_back(InsecureRand256(), i);
+        cache.insert(added.back(), CStakeCache(i, COIN));
+    }
+    BOOST_CHECK_EQUAL(cache.size(), 1500U);
+    for(uint32_t i = 0; i < 1000; i++)
+    {
+        BOOST_CHECK_EQUAL(cache.find(prevouts[i]) != nullptr, i < 500);
+        BOOST_CHECK(cache.find(added[i]));
+    }
+    BOOST_CHECK(cache.memoryUsage() > 0);
+
+    cache.clear();
+    BOOST_CHECK_EQUAL(cache.size(), 0U);
+    BOOST_CHECK(!cache.find(prevouts[0]));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,188 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/setup_common.h>
+#include <libdevcore/OverlayDB.h>
+#include <libethereum/HotSlotCache.h>
+#include <qtum/qtumstate.h>
+
+namespace statecommit_tests {
+
+const unsigned CONTRACTS = 20;
+const unsigned SLOTS = 10;
+
+std::unique_ptr<QtumState> emptyState(const fs::path& dir){
+    fs::create_directories(dir);
+    const dev::h256 hashDB(dev::sha3(dev::rlp("")));
+    return std::make_unique<QtumState>(dev::u256(0), QtumState::openDB(PathToString(dir), hashDB, dev::WithExisting::Trust), PathToString(dir / "qtumDB"), dev::eth::BaseState::Empty);
+}
+
+dev::Address contract(unsigned i){
+    return dev::Address(dev::u160(i + 1));
+}
+
+// Write the slots of all the contracts in one commit, or commit each contract on its own
+void setSlots(QtumState& state, unsigned offset, bool together){
+    for(unsigned i = 0; i < CONTRACTS; i++){
+        if(offset == 0) state.createContract(contract(i));
+        for(unsigned j = 0; j < SLOTS; j++){
+            // Every other slot is cleared on the second round
+            state.setStorage(contract(i), dev::u256(j), (offset && j % 2) ? dev::u256(0) : dev::u256(i * 1000 + j + offset));
+        }
+        if(!together) state.commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    }
+    if(together) state.commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    state.db().commit();
+}
+
+BOOST_FIXTURE_TEST_SUITE(statecommit_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(statecommit_storage_tries){
+    // A commit of many contracts updates their storage tries on several threads
+    BOOST_REQUIRE(CONTRACTS >= dev::eth::c_parallelCommitMinAccounts);
+    std::unique_ptr<QtumState> together = emptyState(m_path_root / "together");
+    std::unique_ptr<QtumState> apart = emptyState(m_path_root / "apart");
+    for(unsigned offset : {0, 500}){
+        setSlots(*together, offset, true);
+        setSlots(*apart, offset, false);
+        BOOST_CHECK(together->rootHash() == apart->rootHash());
+    }
+
+    // The storage is complete under the new root
+    for(unsigned i = 0; i < CONTRACTS; i++){
+        BOOST_CHECK(together->storageRoot(contract(i)) == apart->storageRoot(contract(i)));
+        for(unsigned j = 0; j < SLOTS; j++){
+            BOOST_CHECK(together->storage(contract(i), dev::u256(j)) == ((j % 2) ? dev::u256(0) : dev::u256(i * 1000 + j + 500)));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(statecommit_sha3_batch){
+    // Lengths around the Keccak block size, so that inputs of several block counts are batched
+    std::vector<dev::bytes> inputs;
+    for(size_t size : {0, 1, 20, 32, 32, 32, 135, 136, 137, 20, 32, 271, 272, 300, 20, 20}){
+        inputs.push_back(dev::bytes(size, (dev::byte)inputs.size()));
+    }
+    std::vector<dev::bytesConstRef> refs;
+    for(const dev::bytes& input : inputs){
+        refs.push_back(&input);
+    }
+    std::vector<dev::h256> hashes = dev::sha3Batch(refs);
+    for(size_t i = 0; i < inputs.size(); i++){
+        BOOST_CHECK(hashes[i] == dev::sha3(inputs[i]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(statecommit_hot_slots){
+    // A commit notes the slots the contracts loaded, for the prefetch of the next block
+    std::unique_ptr<QtumState> state = emptyState(m_path_root / "hotslots");
+    setSlots(*state, 0, true);
+    for(unsigned j = 0; j < SLOTS; j++){
+        state->storage(contract(0), dev::u256(j));
+    }
+    state->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    std::vector<dev::u256> slots = dev::eth::HotSlotCache::instance().slots(contract(0));
+    BOOST_CHECK_EQUAL(slots.size(), SLOTS);
+
+    // Prefetching only fills the caches
+    dev::h256 root = state->rootHash();
+    state->prefetch({contract(0), contract(1), contract(CONTRACTS)});
+    BOOST_CHECK(state->rootHash() == root);
+    BOOST_CHECK(state->storage(contract(0), dev::u256(1)) == dev::u256(1));
+}
+
+BOOST_AUTO_TEST_CASE(statecommit_storage_pages){
+    std::unique_ptr<QtumState> state = emptyState(m_path_root / "pages");
+    setSlots(*state, 0, true);
+    setSlots(*state, 500, true);
+    // A slot written and one cleared in the cache, not committed
+    state->setStorage(contract(0), dev::u256(SLOTS), dev::u256(7));
+    state->setStorage(contract(0), dev::u256(0), dev::u256(0));
+    const auto all = state->storage(contract(0));
+    BOOST_CHECK_EQUAL(all.size(), SLOTS / 2);
+
+    // The pages cover the storage in order
+    for(size_t limit : {1, 2, 3, 100}){
+        std::map<dev::h256, std::pair<dev::u256, dev::u256>> paged;
+        dev::h256 next;
+        do{
+            auto [page, pageNext] = state->storage(contract(0), next, limit);
+            BOOST_CHECK(page.size() <= limit);
+            paged.insert(page.begin(), page.end());
+            next = pageNext;
+        }while(next);
+        BOOST_CHECK(paged == all);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(statecommit_utxo_batch){
+    // A batch of vins is written in one pass over the UTXO trie, to the root of writing them one by one
+    dev::OverlayDB dbBatch, dbApart;
+    dev::eth::SecureTrieDB<dev::Address, dev::OverlayDB> batch(&dbBatch), apart(&dbApart);
+    batch.init();
+    apart.init();
+    for(unsigned round = 0; round < 3; round++){
+        std::vector<dev::bytes> values;
+        std::vector<dev::h256> hashes;
+        for(unsigned i = 0; i < CONTRACTS * 2; i++){
+            values.push_back(dev::rlpList(dev::u256(i), dev::u256(round)));
+            hashes.push_back(dev::sha3(contract(i)));
+        }
+        std::vector<dev::HashedTrieChange> changes;
+        for(unsigned i = 0; i < CONTRACTS * 2; i++){
+            // Vins are spent on later rounds, some of them never written
+            dev::bytesConstRef value = round && i % (round + 1) == 0 ? dev::bytesConstRef() : dev::bytesConstRef(&values[i]);
+            changes.push_back({contract(i).ref(), hashes[i], value});
+            if(value.empty()) apart.remove(contract(i));
+            else apart.insert(contract(i), value);
+        }
+        batch.updateHashed(changes);
+        BOOST_CHECK(batch.root() == apart.root());
+        for(unsigned i = 0; i < CONTRACTS * 2; i++){
+            BOOST_CHECK(batch.at(contract(i)) == apart.at(contract(i)));
+        }
+    }
+
+    // Nothing to change leaves the root as it is
+    const dev::h256 root = batch.root();
+    batch.updateHashed({{contract(CONTRACTS * 3).ref(), dev::sha3(contract(CONTRACTS * 3)), dev::bytesConstRef()}});
+    BOOST_CHECK(batch.root() == root);
+}
+
+BOOST_AUTO_TEST_CASE(statecommit_deferred_writes){
+    std::unique_ptr<QtumState> state = emptyState(m_path_root / "deferred");
+    state->setDeferredWritesBudget(1 << 20);
+    state->setDeferWrites(true);
+
+    // The nodes of each block are kept in memory, readable from the copies of the state
+    std::vector<dev::h256> roots;
+    for(unsigned block = 0; block < 3; block++){
+        state->createContract(contract(0));
+        state->setStorage(contract(0), dev::u256(1), dev::u256(block + 1));
+        state->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+        state->commitDB();
+        roots.push_back(state->rootHash());
+        BOOST_CHECK(!state->db().diskView().exists(roots.back()));
+        QtumState copy(*state);
+        BOOST_CHECK(copy.storage(contract(0), dev::u256(1)) == block + 1);
+    }
+    BOOST_CHECK(state->deferredWritesUsage() > 0);
+
+    // Flushed together, the roots of every block can be read from disk
+    state->flushDB();
+    BOOST_CHECK_EQUAL(state->deferredWritesUsage(), 0U);
+    for(unsigned block = 0; block < roots.size(); block++){
+        QtumState disk(dev::u256(0), state->db().diskView(), state->dbUtxo().diskView(), roots[block], state->rootHashUTXO());
+        BOOST_CHECK(disk.storage(contract(0), dev::u256(1)) == block + 1);
+    }
+
+    // Over the budget the nodes are written right away
+    state->setDeferredWritesBudget(1);
+    state->setStorage(contract(0), dev::u256(2), dev::u256(2));
+    state->commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    state->commitDB();
+    BOOST_CHECK_EQUAL(state->deferredWritesUsage(), 0U);
+    BOOST_CHECK(state->db().diskView().exists(state->rootHash()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
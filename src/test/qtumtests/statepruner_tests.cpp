@@ -0,0 +1,119 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/setup_common.h>
+#include <libdevcore/OverlayDB.h>
+#include <qtum/qtumstate.h>
+#include <qtum/qtumstatepruner.h>
+
+namespace statepruner_tests {
+
+const dev::Address CONTRACT("0505050505050505050505050505050505050505");
+const dev::bytes CODE{0x60, 0x01, 0x60, 0x00, 0x55};
+
+std::unique_ptr<QtumState> emptyState(const fs::path& dir){
+    fs::create_directories(dir);
+    const dev::h256 hashDB(dev::sha3(dev::rlp("")));
+    return std::make_unique<QtumState>(dev::u256(0), QtumState::openDB(PathToString(dir), hashDB, dev::WithExisting::Trust), PathToString(dir / "qtumDB"), dev::eth::BaseState::Empty);
+}
+
+void setSlots(QtumState& state, unsigned offset){
+    for(unsigned i = 1; i <= 100; i++){
+        state.setStorage(CONTRACT, dev::u256(i), dev::u256(i + offset));
+    }
+    state.commit(dev::eth::State::CommitBehaviour::KeepEmptyAccounts);
+    state.db().commit();
+}
+
+uint64_t sweep(dev::OverlayDB& db, const StateTrieMarker& marker){
+    return SweepTrieNodes(db, marker, [&](std::vector<dev::h256>& nodes) {
+        db.prune(nodes, [&](const dev::h256& node) { return marker.IsMarked(node); });
+        return true;
+    });
+}
+
+BOOST_FIXTURE_TEST_SUITE(statepruner_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(statepruner_sweep_unreachable){
+    std::unique_ptr<QtumState> state = emptyState(m_path_root / "state");
+    state->createContract(CONTRACT);
+    state->setCode(CONTRACT, dev::bytes(CODE), 0);
+    setSlots(*state, 1000);
+    const dev::h256 oldRoot = state->rootHash();
+    setSlots(*state, 2000);
+    const dev::h256 newRoot = state->rootHash();
+    BOOST_CHECK(oldRoot != newRoot);
+
+    // Both states are reachable from their roots, nothing is erased
+    StateTrieMarker both;
+    both.MarkState(state->db(), oldRoot);
+    both.MarkState(state->db(), newRoot);
+    BOOST_CHECK_EQUAL(both.Missing(), 0U);
+    BOOST_CHECK_EQUAL(sweep(state->db(), both), 0U);
+
+    // Only the nodes of the old state are erased
+    StateTrieMarker kept;
+    kept.MarkState(state->db(), newRoot);
+    BOOST_CHECK(kept.Size() < both.Size());
+    BOOST_CHECK_GE(sweep(state->db(), kept), both.Size() - kept.Size());
+    BOOST_CHECK(!state->db().exists(oldRoot));
+    BOOST_CHECK_EQUAL(sweep(state->db(), kept), 0U);
+
+    // The kept state is complete
+    std::unique_ptr<QtumState> reloaded = std::make_unique<QtumState>(*state);
+    reloaded->setRoot(newRoot);
+    for(unsigned i = 1; i <= 100; i++){
+        BOOST_CHECK(reloaded->storage(CONTRACT, dev::u256(i)) == dev::u256(i + 2000));
+    }
+    BOOST_CHECK(reloaded->code(CONTRACT) == CODE);
+}
+
+BOOST_AUTO_TEST_CASE(statepruner_prune_keeps_referenced){
+    std::unique_ptr<QtumState> state = emptyState(m_path_root / "referenced");
+    dev::OverlayDB& db = state->db();
+    const dev::bytes value{0x01, 0x02, 0x03};
+    const dev::h256 node = dev::sha3(value);
+    db.insert(node, &value);
+    db.commit();
+
+    // A node reachable from a kept root is not erased
+    std::vector<dev::h256> nodes{node};
+    db.prune(nodes, [&](const dev::h256& h) { return h == node; });
+    BOOST_CHECK(nodes.empty());
+    BOOST_CHECK(db.exists(node));
+
+    // Neither is a node referenced again by the memory overlay
+    db.insert(node, &value);
+    nodes = {node};
+    db.prune(nodes, [](const dev::h256&) { return false; });
+    BOOST_CHECK(nodes.empty());
+    db.commit();
+    BOOST_CHECK(db.exists(node));
+
+    nodes = {node};
+    db.prune(nodes, [](const dev::h256&) { return false; });
+    BOOST_CHECK_EQUAL(nodes.size(), 1U);
+    BOOST_CHECK(!db.exists(node));
+}
+
+BOOST_AUTO_TEST_CASE(statepruner_utxo_trie){
+    std::unique_ptr<QtumState> state = emptyState(m_path_root / "utxo");
+    std::unordered_map<dev::Address, Vin> vins;
+    vins[CONTRACT] = Vin{dev::h256(1), 0, dev::u256(100), 1};
+    state->importVins(vins);
+    state->dbUtxo().commit();
+    const dev::h256 oldRoot = state->rootHashUTXO();
+    vins[CONTRACT] = Vin{dev::h256(2), 1, dev::u256(50), 1};
+    state->importVins(vins);
+    state->dbUtxo().commit();
+
+    StateTrieMarker kept;
+    kept.MarkTrie(state->dbUtxo(), state->rootHashUTXO());
+    BOOST_CHECK_EQUAL(sweep(state->dbUtxo(), kept), 1U);
+    BOOST_CHECK(!state->dbUtxo().exists(oldRoot));
+    dev::u256 value;
+    BOOST_CHECK(state->forEachCommittedVin([&](const dev::Address&, const Vin& vin) { value = vin.value; }));
+    BOOST_CHECK(value == 50);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
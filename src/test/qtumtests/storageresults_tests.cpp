@@ -0,0 +1,180 @@
+#include <boost/test/unit_test.hpp>
+#include <test/util/setup_common.h>
+#include <validation.h>
+#include <util/convert.h>
+#include <libdevcore/RLP.h>
+
+namespace storageresults_tests {
+
+std::vector<TransactionReceiptInfo> makeResult(uint32_t blockNumber, size_t logs){
+    TransactionReceiptInfo tri{};
+    tri.blockNumber = blockNumber;
+    tri.outputIndex = 0;
+    for(size_t i = 0; i < logs; i++){
+        tri.logs.push_back(dev::eth::LogEntry(dev::Address(i + 1), {dev::h256(i)}, dev::bytes(64, 0x42)));
+    }
+    return {tri};
+}
+
+BOOST_FIXTURE_TEST_SUITE(storageresults_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(storageresults_pending_committed_flushed){
+    fs::path dir = m_path_root / "receipts";
+    fs::create_directories(dir);
+    dev::h256 hashA(1), hashB(2);
+    {
+        StorageResults storage(PathToString(dir));
+
+        // Results of a block that fails to connect are dropped
+        std::vector<TransactionReceiptInfo> result = makeResult(10, 1);
+        storage.addResult(hashA, result);
+        BOOST_CHECK_EQUAL(storage.getResult(hashA).size(), 1U);
+        storage.clearCacheResult();
+        BOOST_CHECK(storage.getResult(hashA).empty());
+
+        // Committed results are visible before they are written
+        storage.addResult(hashA, result);
+        storage.commitResults();
+        storage.clearCacheResult();
+        BOOST_CHECK_EQUAL(storage.getResult(hashA)[0].blockNumber, 10U);
+
+        result = makeResult(11, 2);
+        storage.addResult(hashB, result);
+        storage.commitResults();
+        storage.flushResults();
+        BOOST_CHECK_EQUAL(storage.getResult(hashB)[0].logs.size(), 2U);
+
+        // Disconnected results disappear from the cache and the database
+        CMutableTransaction mtx;
+        mtx.nLockTime = 1;
+        CTransactionRef tx = MakeTransactionRef(mtx);
+        dev::h256 hashTx = uintToh256(tx->GetHash());
+        storage.addResult(hashTx, result);
+        storage.commitResults();
+        storage.deleteResults({tx});
+        BOOST_CHECK(storage.getResult(hashTx).empty());
+    }
+
+    // Everything committed is written when the storage is closed
+    StorageResults storage(PathToString(dir));
+    BOOST_CHECK_EQUAL(storage.getResult(hashA)[0].blockNumber, 10U);
+    BOOST_CHECK_EQUAL(storage.getResult(hashB)[0].blockNumber, 11U);
+}
+
+BOOST_AUTO_TEST_CASE(storageresults_bounded_read_cache){
+    fs::path dir = m_path_root / "receipts";
+    fs::create_directories(dir);
+
+    // A budget far below the total size still returns every result
+    StorageResults storage(PathToString(dir), 4096);
+    for(uint32_t i = 0; i < 100; i++){
+        std::vector<TransactionReceiptInfo> result = makeResult(i, 3);
+        storage.addResult(dev::h256(i), result);
+        storage.commitResults();
+    }
+    for(int pass = 0; pass < 2; pass++){
+        for(uint32_t i = 0; i < 100; i++){
+            std::vector<TransactionReceiptInfo> result = storage.getResult(dev::h256(i));
+            BOOST_REQUIRE_EQUAL(result.size(), 1U);
+            BOOST_CHECK_EQUAL(result[0].blockNumber, i);
+            BOOST_CHECK_EQUAL(result[0].logs.size(), 3U);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(storageresults_compact_encoding){
+    fs::path dir = m_path_root / "receipts";
+    fs::create_directories(dir);
+
+    std::vector<TransactionReceiptInfo> result = makeResult(12, 2);
+    result.push_back(makeResult(12, 0)[0]);
+    for(size_t i = 0; i < result.size(); i++){
+        result[i].blockHash = uint256S("0x1234");
+        result[i].transactionHash = uint256S("0x5678");
+        result[i].transactionIndex = 3;
+        result[i].gasUsed = 21000 + i;
+        result[i].cumulativeGasUsed = 1000000 + i;
+        result[i].outputIndex = i;
+        result[i].excepted = dev::eth::TransactionException::OutOfGas;
+        result[i].exceptedMessage = "out of gas";
+        result[i].bloom = dev::eth::bloom(result[i].logs);
+        result[i].stateRoot = dev::h256(7);
+    }
+    // A bloom that does not match the logs is kept as is
+    result[1].bloom = dev::h2048();
+    {
+        StorageResults storage(PathToString(dir));
+        storage.addResult(dev::h256(1), result);
+        storage.commitResults();
+    }
+
+    StorageResults storage(PathToString(dir));
+    std::vector<TransactionReceiptInfo> read = storage.getResult(dev::h256(1));
+    BOOST_REQUIRE_EQUAL(read.size(), result.size());
+    for(size_t i = 0; i < result.size(); i++){
+        BOOST_CHECK(read[i].blockHash == result[i].blockHash);
+        BOOST_CHECK_EQUAL(read[i].blockNumber, result[i].blockNumber);
+        BOOST_CHECK(read[i].transactionHash == result[i].transactionHash);
+        BOOST_CHECK_EQUAL(read[i].transactionIndex, result[i].transactionIndex);
+        BOOST_CHECK_EQUAL(read[i].gasUsed, result[i].gasUsed);
+        BOOST_CHECK_EQUAL(read[i].cumulativeGasUsed, result[i].cumulativeGasUsed);
+        BOOST_CHECK_EQUAL(read[i].outputIndex, result[i].outputIndex);
+        BOOST_CHECK(read[i].excepted == result[i].excepted);
+        BOOST_CHECK_EQUAL(read[i].exceptedMessage, result[i].exceptedMessage);
+        BOOST_CHECK(read[i].bloom == result[i].bloom);
+        BOOST_CHECK(read[i].stateRoot == result[i].stateRoot);
+        BOOST_REQUIRE_EQUAL(read[i].logs.size(), result[i].logs.size());
+        for(size_t j = 0; j < result[i].logs.size(); j++){
+            BOOST_CHECK(read[i].logs[j].address == result[i].logs[j].address);
+            BOOST_CHECK(read[i].logs[j].topics == result[i].logs[j].topics);
+            BOOST_CHECK(read[i].logs[j].data == result[i].logs[j].data);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(storageresults_legacy_encoding){
+    fs::path dir = m_path_root / "receipts";
+    fs::create_directories(dir);
+    dev::h256 hashTx(5);
+    {
+        // Entry in the RLP encoding of older versions
+        leveldb::DB* db;
+        leveldb::Options options;
+        options.create_if_missing = true;
+        BOOST_REQUIRE(leveldb::DB::Open(options, PathToString(dir / "resultsDB"), &db).ok());
+        std::vector<dev::h256> hashes{dev::h256(9)};
+        std::vector<uint32_t> numbers{42};
+        std::vector<dev::h160> addresses{dev::h160(1)};
+        std::vector<dev::u256> gas{dev::u256(30000)};
+        std::vector<logEntriesSerialize> logs{{std::make_pair(dev::h160(2), std::make_pair(dev::h256s{dev::h256(3)}, dev::bytes{1, 2}))}};
+        dev::RLPStream streamRLP(10);
+        streamRLP << hashes << numbers << hashes << numbers << addresses << addresses << gas << gas << addresses << logs;
+        dev::bytes data = streamRLP.out();
+        BOOST_REQUIRE(db->Put(leveldb::WriteOptions(), hashTx.hex(), std::string(data.begin(), data.end())).ok());
+        delete db;
+    }
+    {
+        StorageResults storage(PathToString(dir));
+        std::vector<TransactionReceiptInfo> read = storage.getResult(hashTx);
+        BOOST_REQUIRE_EQUAL(read.size(), 1U);
+        BOOST_CHECK_EQUAL(read[0].blockNumber, 42U);
+        BOOST_CHECK_EQUAL(read[0].gasUsed, 30000U);
+        BOOST_CHECK_EQUAL(read[0].outputIndex, 0xffffffff);
+        BOOST_REQUIRE_EQUAL(read[0].logs.size(), 1U);
+        BOOST_CHECK(read[0].logs[0].address == dev::h160(2));
+    }
+
+    // The entry read above was rewritten in the compact encoding
+    leveldb::DB* db;
+    BOOST_REQUIRE(leveldb::DB::Open(leveldb::Options(), PathToString(dir / "resultsDB"), &db).ok());
+    std::string value;
+    BOOST_REQUIRE(db->Get(leveldb::ReadOptions(), hashTx.hex(), &value).ok());
+    BOOST_CHECK_EQUAL(value[0], 0x01);
+    delete db;
+    StorageResults storage(PathToString(dir));
+    BOOST_CHECK_EQUAL(storage.getResult(hashTx)[0].blockNumber, 42U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -9,8 +9,6 @@
 #include <boost/filesystem/operations.hpp>
 #include <util/fs.h>
 
-extern std::unique_ptr<QtumState> globalState;
-
 inline void initState(){
     boost::filesystem::path pathTemp;		
     pathTemp = fs::temp_directory_path() / strprintf("test_bitcoin_%lu_%i", (unsigned long)GetTime(), (int)(GetRand(100000)));
@@ -67,7 +65,7 @@ inline std::pair<std::vector<ResultExecute>, ByteCodeExecResult> executeBC(std::
     CBlock block(generateBlock());
     QtumDGP qtumDGP(globalState.get(), chainman.ActiveChainstate(), fGettingValuesDGP);
     uint64_t blockGasLimit = qtumDGP.getBlockGasLimit(chainman.ActiveChain().Tip()->nHeight + 1);
-    ByteCodeExec exec(block, txs, blockGasLimit, chainman.ActiveChain().Tip(), chainman.ActiveChain());
+    ByteCodeExec exec(block, txs, blockGasLimit, chainman.ActiveChain().Tip(), chainman.ActiveChain(), chainman.Qtum());
     exec.performByteCode();
     std::vector<ResultExecute> res = exec.getResult();
     ByteCodeExecResult bceExecRes;
@@ -14,6 +14,7 @@
 #include <util/time.h>
 
 #include <any>
+#include <thread>
 
 #include <boost/test/unit_test.hpp>
 
@@ -543,4 +544,106 @@ BOOST_AUTO_TEST_CASE(help_example)
     BOOST_CHECK_NE(HelpExampleRpcNamed("foo", {{"arg", true}}), HelpExampleRpcNamed("foo", {{"arg", "true"}}));
 }
 
+/** Request that collects the JSON its result is streamed as */
+class StreamingRequest : public JSONRPCRequest
+{
+public:
+    std::string streamed;
+    bool CanStream() const override { return true; }
+    void StreamWrite(const std::string& json) override
+    {
+        isStreaming = true;
+        streamed += json;
+    }
+};
+
+static void WriteTestResult(RPCResultWriter& writer, int num_entries)
+{
+    UniValue header(UniValue::VOBJ);
+    header.pushKV("hash", "00ff");
+    header.pushKV("height", 7);
+    writer.BeginObject();
+    writer.KVs(header);
+    writer.KV("quote\"key", "line\nbreak");
+    writer.Key("empty");
+    writer.BeginArray();
+    writer.EndArray();
+    writer.Key("entries");
+    writer.BeginArray();
+    for (int i = 0; i < num_entries; ++i) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("index", i);
+        entry.pushKV("data", std::string(100, 'a'));
+        writer.Value(entry);
+    }
+    writer.BeginObject();
+    writer.EndObject();
+    writer.EndArray();
+    writer.EndObject();
+}
+
+BOOST_AUTO_TEST_CASE(rpc_result_writer)
+{
+    for (int num_entries : {0, 3, 2000}) {
+        RPCResultWriter builder;
+        WriteTestResult(builder, num_entries);
+        const UniValue built{builder.Finish()};
+        BOOST_CHECK(built.isObject());
+        BOOST_CHECK_EQUAL(built["entries"].size(), size_t(num_entries + 1));
+        BOOST_CHECK_EQUAL(built["quote\"key"].get_str(), "line\nbreak");
+
+        StreamingRequest request;
+        RPCResultWriter writer{request};
+        WriteTestResult(writer, num_entries);
+        BOOST_CHECK(writer.Finish().isNull());
+        // Small results are replied in one piece, large ones are sent in chunks
+        const bool large{num_entries * 100 > (int)RPC_RESULT_CHUNK_SIZE};
+        BOOST_CHECK_EQUAL(request.isStreaming, large);
+        BOOST_CHECK_EQUAL(request.resultJSON.has_value(), !large);
+        BOOST_CHECK_EQUAL(large ? request.streamed : *request.resultJSON, built.write());
+    }
+
+    // Requests that can't stream get the built result
+    JSONRPCRequest request;
+    RPCResultWriter writer{request};
+    WriteTestResult(writer, 1);
+    BOOST_CHECK_EQUAL(writer.Finish()["entries"].size(), 2U);
+    BOOST_CHECK(!request.resultJSON);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_batch)
+{
+    if (RPCIsInWarmup(nullptr)) SetRPCWarmupFinished();
+    JSONRPCRequest jreq;
+    jreq.context = &m_node;
+    UniValue batch(UniValue::VARR);
+    for (int i = 0; i < 50; ++i) {
+        batch.push_back(JSON(strprintf(R"({"method":"echo","params":[%d],"id":%d})", i, i)));
+    }
+    batch.push_back(JSON(R"({"method":"nosuchmethod","id":"last"})"));
+    const UniValue sequential{JSON(JSONRPCExecBatch(jreq, batch))};
+    BOOST_CHECK_EQUAL(sequential.size(), 51U);
+    BOOST_CHECK_EQUAL(sequential[7]["result"].write(), "[7]");
+    BOOST_CHECK_EQUAL(sequential[7]["id"].getInt<int>(), 7);
+    BOOST_CHECK_EQUAL(find_value(sequential[50]["error"], "code").getInt<int>(), RPC_METHOD_NOT_FOUND);
+
+    // Helpers run the calls alongside the calling thread until the dispatcher refuses one,
+    // the replies keep the order of the calls
+    std::vector<std::thread> helpers;
+    int refused{0};
+    const auto dispatch = [&](std::function<void()> work) {
+        if (helpers.size() == 2) {
+            ++refused;
+            return false;
+        }
+        helpers.emplace_back(std::move(work));
+        return true;
+    };
+    const std::string parallel{JSONRPCExecBatch(jreq, batch, dispatch, /*max_threads=*/8)};
+    for (auto& helper : helpers) helper.join();
+    BOOST_CHECK_EQUAL(helpers.size(), 2U);
+    BOOST_CHECK_EQUAL(refused, 1);
+    BOOST_CHECK_EQUAL(JSON(parallel).write(), sequential.write());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1853,4 +1853,23 @@ BOOST_AUTO_TEST_CASE(compute_tapleaf)
     BOOST_CHECK_EQUAL(ComputeTapleafHash(0xc2, Span(script)), tlc2);
 }
 
+BOOST_AUTO_TEST_CASE(sender_signature_cache)
+{
+    CMutableTransaction mtx;
+    mtx.vout.resize(2);
+    mtx.vout[0].nValue = 1;
+    const CTransaction tx{mtx};
+
+    BOOST_CHECK(!SenderSignatureCacheGet(tx, 0, 0, /*store=*/true));
+    SenderSignatureCacheSet(tx, 0, 0);
+    BOOST_CHECK(SenderSignatureCacheGet(tx, 0, 0, /*store=*/true));
+    // Entries are per output and flags
+    BOOST_CHECK(!SenderSignatureCacheGet(tx, 1, 0, /*store=*/true));
+    BOOST_CHECK(!SenderSignatureCacheGet(tx, 0, SCRIPT_VERIFY_P2SH, /*store=*/true));
+
+    // Reading without storing, as when connecting a block, erases the entry
+    BOOST_CHECK(SenderSignatureCacheGet(tx, 0, 0, /*store=*/false));
+    BOOST_CHECK(!SenderSignatureCacheGet(tx, 0, 0, /*store=*/true));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -11,6 +11,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <cassert>
+#include <memory>
 #include <thread>
 
 using namespace std::chrono_literals;
@@ -128,6 +129,42 @@ BOOST_AUTO_TEST_CASE(wait)
     waiter.join();
 }
 
+BOOST_AUTO_TEST_CASE(poller_wait_many)
+{
+    int s[2];
+    CreateSocketPair(s);
+    int t[2];
+    CreateSocketPair(t);
+
+    auto sock_a = std::make_shared<const Sock>(s[0]);
+    auto sock_b = std::make_shared<const Sock>(t[0]);
+    Sock peer_a(s[1]);
+    Sock peer_b(t[1]);
+
+    SockPoller poller;
+    Sock::EventsPerSock events_per_sock;
+    events_per_sock.emplace(sock_a, Sock::Events{Sock::RECV});
+    events_per_sock.emplace(sock_b, Sock::Events{Sock::RECV});
+
+    // Nothing to read yet
+    BOOST_REQUIRE(poller.WaitMany(0ms, events_per_sock));
+    BOOST_CHECK_EQUAL(events_per_sock.at(sock_a).occurred, 0);
+    BOOST_CHECK_EQUAL(events_per_sock.at(sock_b).occurred, 0);
+
+    // Only the socket with data is ready
+    BOOST_REQUIRE_EQUAL(peer_b.Send("a", 1, 0), 1);
+    BOOST_REQUIRE(poller.WaitMany(1min, events_per_sock));
+    BOOST_CHECK_EQUAL(events_per_sock.at(sock_a).occurred, 0);
+    BOOST_CHECK_EQUAL(events_per_sock.at(sock_b).occurred, Sock::RECV);
+
+    // Changing the requested events and dropping a socket is taken into account
+    events_per_sock.erase(sock_b);
+    events_per_sock.at(sock_a).requested = Sock::SEND;
+    BOOST_REQUIRE(poller.WaitMany(1min, events_per_sock));
+    BOOST_CHECK_EQUAL(events_per_sock.size(), 1U);
+    BOOST_CHECK_EQUAL(events_per_sock.at(sock_a).occurred, Sock::SEND);
+}
+
 BOOST_AUTO_TEST_CASE(recv_until_terminator_limit)
 {
     constexpr auto timeout = 1min; // High enough so that it is never hit.
@@ -0,0 +1,101 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <node/stakeestimator.h>
+#include <rpc/blockchain.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+using node::StakeEstimator;
+
+BOOST_FIXTURE_TEST_SUITE(stakeestimator_tests, BasicTestingSetup)
+
+/** A chain with a proof-of-work block every fifth block, the stakes at varying intervals and targets */
+static std::vector<CBlockIndex> MakeChain(size_t length)
+{
+    std::vector<CBlockIndex> blocks(length);
+    for (size_t i = 0; i < length; ++i) {
+        blocks[i].nHeight = i;
+        blocks[i].pprev = i ? &blocks[i - 1] : nullptr;
+        blocks[i].nTime = 1000000 + 32 * i + 16 * (i % 3);
+        blocks[i].nBits = i % 2 ? 0x1d00ffff : 0x1c7fffff;
+        if (i % 5) {
+            blocks[i].prevoutStake = COutPoint(uint256::ONE, i);
+        }
+    }
+    return blocks;
+}
+
+BOOST_AUTO_TEST_CASE(stake_interval)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    std::vector<CBlockIndex> blocks = MakeChain(3);
+    blocks[0].prevoutStake = COutPoint(uint256::ONE, 0);
+
+    StakeEstimator estimator(params);
+    BOOST_CHECK(!estimator.Ready());
+    BOOST_CHECK_EQUAL(estimator.NetworkWeight(), 0);
+
+    // Two stakes, with a proof-of-work block between them
+    blocks[1].prevoutStake.SetNull();
+    estimator.Reset(&blocks[2]);
+    BOOST_CHECK(estimator.Ready());
+    const double expected = GetDifficulty(&blocks[2]) * 4294967296.0 / (blocks[2].nTime - blocks[0].nTime) * (params.StakeTimestampMask(2) + 1);
+    BOOST_CHECK_CLOSE(estimator.NetworkWeight(), expected, 1e-9);
+    BOOST_CHECK_EQUAL(estimator.ExpectedTime(0), 0U);
+    BOOST_CHECK_CLOSE((double)estimator.ExpectedTime(1000), params.TargetSpacing(2) * expected / 1000, 1e-6);
+    BOOST_CHECK(estimator.AnnualROI() > 0);
+}
+
+BOOST_AUTO_TEST_CASE(sliding_window_matches_rebuild)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    const std::vector<CBlockIndex> blocks = MakeChain(5 * StakeEstimator::STAKE_WINDOW);
+
+    StakeEstimator sliding(params);
+    sliding.Reset(&blocks[0]);
+    for (size_t i = 1; i < blocks.size(); ++i) {
+        sliding.Connect(&blocks[i]);
+        if (i % 37 == 0 || i + 1 == blocks.size()) {
+            StakeEstimator rebuilt(params);
+            rebuilt.Reset(&blocks[i]);
+            BOOST_CHECK_CLOSE(sliding.NetworkWeight(), rebuilt.NetworkWeight(), 1e-9);
+            BOOST_CHECK_CLOSE(sliding.AnnualROI(), rebuilt.AnnualROI(), 1e-9);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(reorganization)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    const std::vector<CBlockIndex> blocks = MakeChain(2 * StakeEstimator::STAKE_WINDOW);
+    std::vector<CBlockIndex> fork = MakeChain(2 * StakeEstimator::STAKE_WINDOW);
+    // The fork leaves the chain at the middle block with slower stakes
+    const size_t fork_height = StakeEstimator::STAKE_WINDOW;
+    fork[fork_height + 1].pprev = const_cast<CBlockIndex*>(&blocks[fork_height]);
+    for (size_t i = fork_height + 1; i < fork.size(); ++i) {
+        fork[i].nTime += 64 * (i - fork_height);
+    }
+
+    StakeEstimator estimator(params);
+    estimator.Reset(&blocks.back());
+    // A block that does not extend the tip rebuilds the window
+    estimator.Connect(&fork.back());
+
+    StakeEstimator rebuilt(params);
+    rebuilt.Reset(&fork.back());
+    BOOST_CHECK_CLOSE(estimator.NetworkWeight(), rebuilt.NetworkWeight(), 1e-9);
+
+    StakeEstimator original(params);
+    original.Reset(&blocks.back());
+    BOOST_CHECK(estimator.NetworkWeight() < original.NetworkWeight());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
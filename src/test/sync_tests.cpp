@@ -4,11 +4,15 @@
 
 #include <sync.h>
 #include <test/util/setup_common.h>
+#include <util/time.h>
 
 #include <boost/test/unit_test.hpp>
 
 #include <mutex>
+#include <numeric>
 #include <stdexcept>
+#include <string>
+#include <thread>
 
 namespace {
 template <typename MutexType>
@@ -140,4 +144,49 @@ BOOST_AUTO_TEST_CASE(inconsistent_lock_order_detected)
 #endif // DEBUG_LOCKORDER
 }
 
+BOOST_AUTO_TEST_CASE(lock_stats)
+{
+    const bool prev{g_lock_stats};
+    g_lock_stats = true;
+    ResetLockStats();
+
+    Mutex lock_stats_mutex;
+    std::thread waiter;
+    {
+        LOCK(lock_stats_mutex);
+        // Contended acquisition by another thread, recorded when its stats are retired at its exit
+        waiter = std::thread{[&] { LOCK(lock_stats_mutex); }};
+        UninterruptibleSleep(std::chrono::milliseconds{10});
+    }
+    waiter.join();
+    {
+        TRY_LOCK(lock_stats_mutex, locked);
+        BOOST_CHECK(static_cast<bool>(locked));
+    }
+    g_lock_stats = false;
+    {
+        LOCK(lock_stats_mutex);
+    }
+
+    uint64_t count{0};
+    uint64_t contended{0};
+    size_t sites{0};
+    for (const LockSiteStats& stats : GetLockStats()) {
+        if (stats.name != "lock_stats_mutex") continue;
+        BOOST_CHECK(stats.file.find("sync_tests.cpp") != std::string::npos);
+        BOOST_CHECK(stats.hold_max <= stats.hold_total);
+        BOOST_CHECK_EQUAL(std::accumulate(stats.hold_histogram.begin(), stats.hold_histogram.end(), uint64_t{0}), stats.count);
+        count += stats.count;
+        contended += stats.contended;
+        if (stats.contended) BOOST_CHECK(stats.wait_max.count() > 0);
+        ++sites;
+    }
+    BOOST_CHECK_EQUAL(sites, 3U);
+    BOOST_CHECK_EQUAL(count, 3U);
+    BOOST_CHECK_EQUAL(contended, 1U);
+
+    ResetLockStats();
+    g_lock_stats = prev;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
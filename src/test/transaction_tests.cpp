@@ -21,6 +21,7 @@
 #include <script/signingprovider.h>
 #include <script/standard.h>
 #include <streams.h>
+#include <support/arena.h>
 #include <test/util/json.h>
 #include <test/util/random.h>
 #include <test/util/script.h>
@@ -996,4 +997,35 @@ BOOST_AUTO_TEST_CASE(test_IsStandard)
     }
 }
 
+BOOST_AUTO_TEST_CASE(unshare_arena_scripts)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, 1) << std::vector<unsigned char>(33, 2);
+    mtx.vout.resize(1);
+    mtx.vout[0].scriptPubKey = CScript() << OP_RETURN << std::vector<unsigned char>(80, 3);
+    const CTransactionRef heap_tx = MakeTransactionRef(mtx);
+    BOOST_CHECK(!heap_tx->HasArenaScripts());
+    BOOST_CHECK(UnshareArenaScripts(heap_tx) == heap_tx);
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << heap_tx;
+    CTransactionRef arena_tx;
+    {
+        DeserializeArena arena;
+        DeserializeArenaScope arena_scope{arena};
+        stream >> arena_tx;
+        BOOST_CHECK(arena_tx->HasArenaScripts());
+
+        // The copy does not come from the arena, even under its scope
+        const CTransactionRef unshared = UnshareArenaScripts(arena_tx);
+        BOOST_CHECK(!unshared->HasArenaScripts());
+        BOOST_CHECK(unshared->GetWitnessHash() == arena_tx->GetWitnessHash());
+    }
+    const CTransactionRef unshared = UnshareArenaScripts(arena_tx);
+    BOOST_CHECK(unshared != arena_tx);
+    BOOST_CHECK(!unshared->HasArenaScripts());
+    BOOST_CHECK(unshared->GetHash() == heap_tx->GetHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txclusters.h>
+#include <test/util/setup_common.h>
+#include <test/util/txmempool.h>
+#include <txmempool.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+using node::ChunkMinedBefore;
+using node::GetTxClusters;
+using node::TxChunk;
+
+BOOST_FIXTURE_TEST_SUITE(txclusters_tests, TestingSetup)
+
+static CMutableTransaction MakeTx(const uint256& prev_hash, uint32_t prev_n, int outputs)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << OP_11;
+    tx.vin[0].prevout.hash = prev_hash;
+    tx.vin[0].prevout.n = prev_n;
+    tx.vout.resize(outputs);
+    for (int i = 0; i < outputs; i++) {
+        tx.vout[i].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx.vout[i].nValue = 10000LL;
+    }
+    return tx;
+}
+
+static std::vector<uint256> Txids(const TxChunk& chunk)
+{
+    std::vector<uint256> txids;
+    for (CTxMemPool::txiter it : chunk.txs) {
+        txids.push_back(it->GetTx().GetHash());
+    }
+    return txids;
+}
+
+BOOST_AUTO_TEST_CASE(txclusters_chunks)
+{
+    TestMemPoolEntryHelper entry;
+    CTxMemPool& pool = *Assert(m_node.mempool);
+    LOCK2(::cs_main, pool.cs);
+
+    // A parent paid for by one of its two children, and a transaction unrelated to them
+    const CMutableTransaction parent = MakeTx(uint256S("01"), 0, 2);
+    const CMutableTransaction paying_child = MakeTx(parent.GetHash(), 0, 1);
+    const CMutableTransaction cheap_child = MakeTx(parent.GetHash(), 1, 1);
+    const CMutableTransaction unrelated = MakeTx(uint256S("02"), 0, 1);
+    pool.addUnchecked(entry.Fee(1000).FromTx(parent));
+    pool.addUnchecked(entry.Fee(20000).FromTx(paying_child));
+    pool.addUnchecked(entry.Fee(100).FromTx(cheap_child));
+    pool.addUnchecked(entry.Fee(5000).FromTx(unrelated));
+
+    for (int call = 0; call < 2; ++call) {
+        // The second call reuses the linearization of the first one
+        const std::vector<std::vector<TxChunk>> clusters = GetTxClusters(pool, {});
+        BOOST_REQUIRE_EQUAL(clusters.size(), 2U);
+        const std::vector<TxChunk>& family = clusters[0].size() == 2 ? clusters[0] : clusters[1];
+        const std::vector<TxChunk>& single = clusters[0].size() == 2 ? clusters[1] : clusters[0];
+
+        BOOST_REQUIRE_EQUAL(family.size(), 2U);
+        BOOST_CHECK(Txids(family[0]) == std::vector<uint256>({parent.GetHash(), paying_child.GetHash()}));
+        BOOST_CHECK(Txids(family[1]) == std::vector<uint256>({cheap_child.GetHash()}));
+        BOOST_CHECK_EQUAL(family[0].fee, 21000);
+        BOOST_REQUIRE_EQUAL(single.size(), 1U);
+        BOOST_CHECK(Txids(single[0]) == std::vector<uint256>({unrelated.GetHash()}));
+
+        // The paying child makes its parent mined before the unrelated transaction, the cheap one does not
+        BOOST_CHECK(ChunkMinedBefore(family[0], single[0]));
+        BOOST_CHECK(ChunkMinedBefore(single[0], family[1]));
+    }
+
+    // Without the parent, the children are no longer connected
+    const CTxMemPool::setEntries excluded{*pool.GetIter(parent.GetHash())};
+    const std::vector<std::vector<TxChunk>> clusters = GetTxClusters(pool, excluded);
+    BOOST_CHECK_EQUAL(clusters.size(), 3U);
+    for (const std::vector<TxChunk>& cluster : clusters) {
+        BOOST_REQUIRE_EQUAL(cluster.size(), 1U);
+        BOOST_CHECK_EQUAL(cluster[0].txs.size(), 1U);
+        BOOST_CHECK(cluster[0].txs[0]->GetTx().GetHash() != parent.GetHash());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -81,4 +81,39 @@ BOOST_FIXTURE_TEST_CASE(txindex_initial_sync, TestChain100Setup)
     txindex.Stop();
 }
 
+BOOST_FIXTURE_TEST_CASE(txindex_hot_cache, TestChain100Setup)
+{
+    // Room for a few positions only, the older ones are evicted and read from the database
+    TxIndex txindex(interfaces::MakeChain(m_node), 1 << 20, true, false, 2048);
+    BOOST_REQUIRE(txindex.Start());
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!txindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    // Twice, the second time the last positions looked up are in memory
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t i = 0; i < m_coinbase_txns.size(); ++i) {
+            CTransactionRef tx_disk;
+            uint256 block_hash;
+            BOOST_REQUIRE(txindex.FindTx(m_coinbase_txns[i]->GetHash(), block_hash, tx_disk));
+            BOOST_CHECK_EQUAL(tx_disk->GetHash(), m_coinbase_txns[i]->GetHash());
+            BOOST_CHECK_EQUAL(block_hash, WITH_LOCK(::cs_main, return m_node.chainman->ActiveChain()[i + 1]->GetBlockHash()));
+        }
+    }
+
+    // A hash sharing the truncated hash of an indexed transaction is not found
+    uint256 other_hash = m_coinbase_txns[0]->GetHash();
+    *(other_hash.end() - 1) ^= 1;
+    CTransactionRef tx_disk;
+    uint256 block_hash;
+    BOOST_CHECK(!txindex.FindTx(other_hash, block_hash, tx_disk));
+
+    SyncWithValidationInterfaceQueue();
+    txindex.Stop();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,68 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <key.h>
+#include <node/txpreverifier.h>
+#include <script/interpreter.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <validation.h>
+#include <version.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(txpreverifier_tests)
+
+BOOST_FIXTURE_TEST_CASE(txpreverifier_verify, TestChain100Setup)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    const auto spend = [&](const COutPoint& prevout) {
+        CMutableTransaction tx;
+        tx.nVersion = 1;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = prevout;
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 11 * CENT;
+        tx.vout[0].scriptPubKey = scriptPubKey;
+
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        tx.vin[0].scriptSig << vchSig;
+        return tx;
+    };
+
+    TxPreverifier preverifier(*m_node.chainman, *m_node.mempool, /*threads_num=*/1);
+
+    // The input is read from the coins cache
+    const CMutableTransaction valid = spend(COutPoint(m_coinbase_txns[0]->GetHash(), 0));
+    BOOST_CHECK(preverifier.Verify(CTransaction(valid)));
+
+    // A signature that does not match is left to the mempool
+    CMutableTransaction bad_signature = valid;
+    bad_signature.vout[0].nValue = 12 * CENT;
+    BOOST_CHECK(!preverifier.Verify(CTransaction(bad_signature)));
+
+    // So is a transaction whose input is not found
+    BOOST_CHECK(!preverifier.Verify(CTransaction(spend(COutPoint(uint256S("01"), 0)))));
+
+    // Transactions submitted as received in a tx message are verified by the workers
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << valid;
+    preverifier.Submit(stream);
+    for (int i = 0; i < 500 && preverifier.GetVerified() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    BOOST_CHECK_EQUAL(preverifier.GetVerified(), 1U);
+    BOOST_CHECK_EQUAL(preverifier.GetDropped(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
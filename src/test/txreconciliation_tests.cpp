@@ -4,10 +4,13 @@
 
 #include <node/txreconciliation.h>
 
+#include <test/util/random.h>
 #include <test/util/setup_common.h>
 
 #include <boost/test/unit_test.hpp>
 
+#include <set>
+
 BOOST_FIXTURE_TEST_SUITE(txreconciliation_tests, BasicTestingSetup)
 
 BOOST_AUTO_TEST_CASE(RegisterPeerTest)
@@ -81,4 +84,90 @@ BOOST_AUTO_TEST_CASE(IsPeerRegisteredTest)
     BOOST_CHECK(!tracker.IsPeerRegistered(peer_id0));
 }
 
+/** Register peer 0 with both trackers, the initiator connected to the responder. */
+static void RegisterPair(TxReconciliationTracker& initiator, TxReconciliationTracker& responder)
+{
+    const uint64_t initiator_salt{initiator.PreRegisterPeer(0)};
+    const uint64_t responder_salt{responder.PreRegisterPeer(0)};
+    BOOST_REQUIRE_EQUAL(initiator.RegisterPeer(0, /*is_peer_inbound=*/false, 1, responder_salt), ReconciliationRegisterResult::SUCCESS);
+    BOOST_REQUIRE_EQUAL(responder.RegisterPeer(0, /*is_peer_inbound=*/true, 1, initiator_salt), ReconciliationRegisterResult::SUCCESS);
+}
+
+BOOST_AUTO_TEST_CASE(ReconcileTest)
+{
+    TxReconciliationTracker initiator(TXRECONCILIATION_VERSION);
+    TxReconciliationTracker responder(TXRECONCILIATION_VERSION);
+    RegisterPair(initiator, responder);
+
+    // Both sides know 20 transactions, the initiator has 3 more and the responder 2 more
+    std::set<uint256> initiator_only, responder_only;
+    for (int i = 0; i < 20; ++i) {
+        const uint256 wtxid{InsecureRand256()};
+        BOOST_CHECK(initiator.AddToSet(0, wtxid));
+        BOOST_CHECK(responder.AddToSet(0, wtxid));
+    }
+    for (int i = 0; i < 3; ++i) {
+        const uint256 initiator_wtxid{*initiator_only.insert(InsecureRand256()).first};
+        BOOST_CHECK(initiator.AddToSet(0, initiator_wtxid));
+    }
+    for (int i = 0; i < 2; ++i) {
+        const uint256 responder_wtxid{*responder_only.insert(InsecureRand256()).first};
+        BOOST_CHECK(responder.AddToSet(0, responder_wtxid));
+    }
+
+    // Only the initiator requests, and only once per round
+    BOOST_CHECK(!responder.MaybeRequestReconciliation(0, std::chrono::seconds{1}));
+    const auto request{initiator.MaybeRequestReconciliation(0, std::chrono::seconds{1})};
+    BOOST_REQUIRE(request);
+    BOOST_CHECK_EQUAL(request->first, 23);
+    BOOST_CHECK(!initiator.MaybeRequestReconciliation(0, std::chrono::seconds{100}));
+
+    const auto skdata{responder.HandleReconciliationRequest(0, request->first, request->second)};
+    BOOST_REQUIRE(skdata);
+    BOOST_CHECK(!responder.HandleSketch(0, *skdata));
+    const auto result{initiator.HandleSketch(0, *skdata)};
+    BOOST_REQUIRE(result);
+    BOOST_CHECK(result->m_success);
+    BOOST_CHECK(std::set<uint256>(result->m_announce_wtxids.begin(), result->m_announce_wtxids.end()) == initiator_only);
+    BOOST_CHECK_EQUAL(result->m_ask_short_ids.size(), 2U);
+
+    BOOST_CHECK(!initiator.HandleReconciliationDifference(0, true, result->m_ask_short_ids));
+    const auto announce{responder.HandleReconciliationDifference(0, true, result->m_ask_short_ids)};
+    BOOST_REQUIRE(announce);
+    BOOST_CHECK(std::set<uint256>(announce->begin(), announce->end()) == responder_only);
+
+    // The round is over on both sides
+    BOOST_CHECK(!initiator.HandleSketch(0, *skdata));
+    BOOST_CHECK(!responder.HandleReconciliationDifference(0, true, {}));
+}
+
+BOOST_AUTO_TEST_CASE(ReconcileFailureTest)
+{
+    TxReconciliationTracker initiator(TXRECONCILIATION_VERSION);
+    TxReconciliationTracker responder(TXRECONCILIATION_VERSION);
+    RegisterPair(initiator, responder);
+
+    std::set<uint256> initiator_set, responder_set;
+    for (int i = 0; i < 10; ++i) {
+        const uint256 initiator_wtxid{*initiator_set.insert(InsecureRand256()).first};
+        BOOST_CHECK(initiator.AddToSet(0, initiator_wtxid));
+        const uint256 responder_wtxid{*responder_set.insert(InsecureRand256()).first};
+        BOOST_CHECK(responder.AddToSet(0, responder_wtxid));
+    }
+
+    // With q = 0 the sketch is far too small for 20 differences, both sides announce their set
+    BOOST_REQUIRE(initiator.MaybeRequestReconciliation(0, std::chrono::seconds{1}));
+    const auto skdata{responder.HandleReconciliationRequest(0, 10, 0)};
+    BOOST_REQUIRE(skdata);
+    const auto result{initiator.HandleSketch(0, *skdata)};
+    BOOST_REQUIRE(result);
+    BOOST_CHECK(!result->m_success);
+    BOOST_CHECK(result->m_ask_short_ids.empty());
+    BOOST_CHECK(std::set<uint256>(result->m_announce_wtxids.begin(), result->m_announce_wtxids.end()) == initiator_set);
+
+    const auto announce{responder.HandleReconciliationDifference(0, false, {})};
+    BOOST_REQUIRE(announce);
+    BOOST_CHECK(std::set<uint256>(announce->begin(), announce->end()) == responder_set);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -44,10 +44,9 @@ struct ConnmanTestMsg : public CConnman {
                    ServiceFlags remote_services,
                    ServiceFlags local_services,
                    int32_t version,
-                   bool relay_txs)
-        EXCLUSIVE_LOCKS_REQUIRED(NetEventsInterface::g_msgproc_mutex);
+                   bool relay_txs);
 
-    void ProcessMessagesOnce(CNode& node) EXCLUSIVE_LOCKS_REQUIRED(NetEventsInterface::g_msgproc_mutex) { m_msgproc->ProcessMessages(&node, flagInterruptMsgProc); }
+    void ProcessMessagesOnce(CNode& node) { m_msgproc->ProcessMessages(&node, flagInterruptMsgProc); }
 
     void NodeReceiveMsgBytes(CNode& node, Span<const uint8_t> msg_bytes, bool& complete) const;
 
@@ -119,6 +118,15 @@ public:
 
     ssize_t Send(const void*, size_t len, int) const override { return len; }
 
+    ssize_t SendMany(Span<const Span<const unsigned char>> buffers, int) const override
+    {
+        ssize_t len{0};
+        for (const auto& buffer : buffers) {
+            len += buffer.size();
+        }
+        return len;
+    }
+
     ssize_t Recv(void* buf, size_t len, int flags) const override
     {
         const size_t consume_bytes{std::min(len, m_contents.size() - m_consumed)};
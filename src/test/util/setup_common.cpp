@@ -14,6 +14,7 @@
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
+#include <headerssync.h>
 #include <init.h>
 #include <init/common.h>
 #include <interfaces/chain.h>
@@ -212,15 +213,21 @@ ChainTestingSetup::ChainTestingSetup(const std::string& chainName, const std::ve
         .path = m_args.GetDataDirNet() / "blocks" / "index",
         .cache_bytes = static_cast<size_t>(m_cache_sizes.block_tree_db),
         .memory_only = true});
+    m_node.chainman->m_blockman.m_qtum_index_db = std::make_unique<CQtumIndexDB>(DBParams{
+        .path = m_args.GetDataDirNet() / "qtumindex",
+        .cache_bytes = static_cast<size_t>(m_cache_sizes.qtum_index_db),
+        .memory_only = true});
 
     constexpr int script_check_threads = 2;
     StartScriptCheckWorkerThreads(script_check_threads);
+    StartHeadersSyncWorkerThreads(script_check_threads);
 }
 
 ChainTestingSetup::~ChainTestingSetup()
 {
     if (m_node.scheduler) m_node.scheduler->stop();
     StopScriptCheckWorkerThreads();
+    StopHeadersSyncWorkerThreads();
     GetMainSignals().FlushBackgroundCallbacks();
     GetMainSignals().UnregisterBackgroundSignalScheduler();
     m_node.connman.reset();
@@ -233,6 +240,7 @@ ChainTestingSetup::~ChainTestingSetup()
     m_node.chainman.reset();
 
 /////////////////////////////////////////////// // qtum
+    ResetContractCallSnapshot();
     delete globalState.release();
     globalSealEngine.reset();
 ///////////////////////////////////////////////
@@ -22,6 +22,8 @@ struct TestMemPoolEntryHelper {
     bool spendsCoinbase{false};
     unsigned int sigOpCost{4};
     LockPoints lp;
+    uint64_t gasLimit{0};
+    CAmount minGasPrice{0};
 
     CTxMemPoolEntry FromTx(const CMutableTransaction& tx) const;
     CTxMemPoolEntry FromTx(const CTransactionRef& tx) const;
@@ -32,6 +34,8 @@ struct TestMemPoolEntryHelper {
     TestMemPoolEntryHelper& Height(unsigned int _height) { nHeight = _height; return *this; }
     TestMemPoolEntryHelper& SpendsCoinbase(bool _flag) { spendsCoinbase = _flag; return *this; }
     TestMemPoolEntryHelper& SigOpsCost(unsigned int _sigopsCost) { sigOpCost = _sigopsCost; return *this; }
+    TestMemPoolEntryHelper& GasLimit(uint64_t _gasLimit) { gasLimit = _gasLimit; return *this; }
+    TestMemPoolEntryHelper& GasPrice(CAmount _minGasPrice) { minGasPrice = _minGasPrice; return *this; }
 };
 
 #endif // BITCOIN_TEST_UTIL_TXMEMPOOL_H
@@ -234,6 +234,31 @@ BOOST_AUTO_TEST_CASE(util_HexStr)
     }
 }
 
+BOOST_AUTO_TEST_CASE(util_hex_blocks)
+{
+    // Lengths around the blocks of the vector kernels, with whitespace and invalid digits in every position
+    for (size_t len = 0; len < 200; ++len) {
+        const std::vector<uint8_t> data{g_insecure_rand_ctx.randbytes(len)};
+        const std::string hex{HexStr(data)};
+        BOOST_REQUIRE_EQUAL(hex.size(), 2 * len);
+        for (size_t i = 0; i < len; ++i) {
+            BOOST_CHECK_EQUAL(HexDigit(hex[2 * i]), data[i] >> 4);
+            BOOST_CHECK_EQUAL(HexDigit(hex[2 * i + 1]), data[i] & 15);
+        }
+        BOOST_CHECK(TryParseHex<uint8_t>(hex) == data);
+        BOOST_CHECK(TryParseHex<uint8_t>(ToUpper(hex)) == data);
+
+        for (size_t pos = 0; pos < hex.size(); ++pos) {
+            std::string spaced{hex};
+            spaced.insert(pos, " ");
+            BOOST_CHECK(TryParseHex<uint8_t>(spaced).has_value() == (pos % 2 == 0));
+            std::string invalid{hex};
+            invalid[pos] = "g/:@G`"[pos % 6];
+            BOOST_CHECK(!TryParseHex<uint8_t>(invalid).has_value());
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(span_write_bytes)
 {
     std::array mut_arr{uint8_t{0xaa}, uint8_t{0xbb}};
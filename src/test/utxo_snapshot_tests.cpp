@@ -0,0 +1,123 @@
+// Copyright (c) 2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/utxo_snapshot.h>
+#include <script/script.h>
+#include <streams.h>
+#include <util/fs.h>
+
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+using node::SnapshotChunkReader;
+using node::SnapshotChunkWriter;
+using node::SnapshotCoins;
+using node::SnapshotMetadata;
+
+namespace {
+
+/** Coins sorted by outpoint, with a few outputs for each transaction */
+SnapshotCoins MakeCoins(size_t count)
+{
+    SnapshotCoins coins;
+    uint256 txid;
+    for (size_t i = 0; i < count; ++i) {
+        if (i % 3 == 0) txid = InsecureRand256();
+        CTxOut out{static_cast<CAmount>(InsecureRandRange(1000000)), CScript() << OP_DUP << ToByteVector(InsecureRand256())};
+        coins.emplace_back(COutPoint{txid, static_cast<uint32_t>(i % 3)}, Coin{std::move(out), static_cast<int>(i), i % 7 == 0, i % 5 == 0});
+    }
+    return coins;
+}
+
+void WriteSnapshot(const fs::path& path, const SnapshotCoins& coins)
+{
+    AutoFile file{fsbridge::fopen(path, "wb")};
+    file << SnapshotMetadata{uint256::ONE, coins.size(), 0, node::SNAPSHOT_VERSION_CHUNKED};
+    SnapshotChunkWriter writer{file, 4};
+    for (const auto& [outpoint, coin] : coins) {
+        writer.Add(outpoint, coin);
+    }
+    writer.Finish();
+}
+
+SnapshotCoins ReadSnapshot(const fs::path& path)
+{
+    AutoFile file{fsbridge::fopen(path, "rb")};
+    SnapshotMetadata metadata;
+    file >> metadata;
+    BOOST_CHECK_EQUAL(metadata.m_version, node::SNAPSHOT_VERSION_CHUNKED);
+    BOOST_CHECK(metadata.m_base_blockhash == uint256::ONE);
+
+    SnapshotCoins coins;
+    SnapshotCoins chunk;
+    SnapshotChunkReader reader{file, 4};
+    while (reader.Next(chunk)) {
+        coins.insert(coins.end(), chunk.begin(), chunk.end());
+    }
+    BOOST_CHECK_EQUAL(coins.size(), metadata.m_coins_count);
+    return coins;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(utxo_snapshot_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(snapshot_metadata)
+{
+    // Legacy snapshots are written without magic bytes, as older nodes read them
+    DataStream legacy{};
+    legacy << SnapshotMetadata{uint256::ONE, 42, 0};
+    BOOST_CHECK_EQUAL(legacy.size(), 40U);
+    SnapshotMetadata metadata;
+    legacy >> metadata;
+    BOOST_CHECK_EQUAL(metadata.m_version, node::SNAPSHOT_VERSION_LEGACY);
+    BOOST_CHECK(metadata.m_base_blockhash == uint256::ONE);
+    BOOST_CHECK_EQUAL(metadata.m_coins_count, 42U);
+
+    DataStream chunked{};
+    chunked << SnapshotMetadata{uint256::ONE, 42, 0, node::SNAPSHOT_VERSION_CHUNKED};
+    chunked >> metadata;
+    BOOST_CHECK_EQUAL(metadata.m_version, node::SNAPSHOT_VERSION_CHUNKED);
+    BOOST_CHECK(metadata.m_base_blockhash == uint256::ONE);
+    BOOST_CHECK_EQUAL(metadata.m_coins_count, 42U);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_chunks)
+{
+    const fs::path path = m_path_root / "snapshot.dat";
+    const SnapshotCoins coins = MakeCoins(node::SNAPSHOT_CHUNK_COINS * 2 + 100);
+    WriteSnapshot(path, coins);
+
+    const SnapshotCoins read = ReadSnapshot(path);
+    BOOST_REQUIRE_EQUAL(read.size(), coins.size());
+    for (size_t i = 0; i < coins.size(); ++i) {
+        BOOST_CHECK(read[i].first == coins[i].first);
+        BOOST_CHECK(read[i].second.out == coins[i].second.out);
+        BOOST_CHECK_EQUAL(uint32_t{read[i].second.nHeight}, uint32_t{coins[i].second.nHeight});
+        BOOST_CHECK_EQUAL(read[i].second.IsCoinBase(), coins[i].second.IsCoinBase());
+        BOOST_CHECK_EQUAL(read[i].second.IsCoinStake(), coins[i].second.IsCoinStake());
+    }
+
+    // A corrupted chunk does not match its hash
+    const uintmax_t size = fs::file_size(path);
+    {
+        FILE* file = fsbridge::fopen(path, "r+b");
+        BOOST_REQUIRE(file);
+        std::fseek(file, size / 2, SEEK_SET);
+        const int byte = std::fgetc(file);
+        std::fseek(file, size / 2, SEEK_SET);
+        std::fputc(byte ^ 0xff, file);
+        std::fclose(file);
+    }
+    BOOST_CHECK_THROW(ReadSnapshot(path), std::ios_base::failure);
+
+    // A snapshot without its end is truncated
+    WriteSnapshot(path, coins);
+    fs::resize_file(path, size - 1);
+    BOOST_CHECK_THROW(ReadSnapshot(path), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
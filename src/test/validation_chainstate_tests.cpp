@@ -136,4 +136,27 @@ BOOST_FIXTURE_TEST_CASE(chainstate_update_tip, TestChain100Setup)
     BOOST_CHECK_EQUAL(curr_tip, ::g_best_block);
 }
 
+//! Test that StateRootVerifier accepts the stored state roots and reports a missing one.
+BOOST_FIXTURE_TEST_CASE(state_root_verifier, TestChain100Setup)
+{
+    Chainstate& chainstate = m_node.chainman->ActiveChainstate();
+    StateRootVerifier verifier(chainstate, DEFAULT_CHECKSTATEROOTS);
+    while (verifier.Step()) {}
+    BOOST_CHECK(verifier.Result() == VerifyDBResult::SUCCESS);
+
+    CBlockIndex* pindex = WITH_LOCK(::cs_main, return chainstate.m_chain[chainstate.m_chain.Height() - 80]);
+    const uint256 state_root = pindex->hashStateRoot;
+    pindex->hashStateRoot = uint256::ONE;
+    // The block is deeper than the samples of the first step
+    StateRootVerifier corrupted(chainstate, DEFAULT_CHECKSTATEROOTS);
+    BOOST_CHECK(corrupted.Step());
+    BOOST_CHECK(!corrupted.Step());
+    BOOST_CHECK(corrupted.Result() == VerifyDBResult::CORRUPTED_BLOCK_DB);
+    // Blocks below the checked depth are not sampled
+    StateRootVerifier shallow(chainstate, 10);
+    while (shallow.Step()) {}
+    BOOST_CHECK(shallow.Result() == VerifyDBResult::SUCCESS);
+    pindex->hashStateRoot = state_root;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
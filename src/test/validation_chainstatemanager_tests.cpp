@@ -694,4 +694,23 @@ BOOST_FIXTURE_TEST_CASE(chainstatemanager_snapshot_completion_hash_mismatch, Sna
     }
 }
 
+//! The chainstate managers of the node share the process-wide contract context, others can have their own.
+BOOST_AUTO_TEST_CASE(chainstatemanager_qtum_context)
+{
+    BOOST_CHECK(&m_node.chainman->Qtum().state == &globalState);
+    BOOST_CHECK(&m_node.chainman->Qtum().sealEngine == &globalSealEngine);
+    BOOST_CHECK(&m_node.chainman->Qtum().storageResults == &pstorageresult);
+
+    auto context = std::make_shared<QtumContext>();
+    const ChainstateManager::Options chainman_opts{
+        .chainparams = ::Params(),
+        .datadir = m_args.GetDataDirNet(),
+        .adjusted_time_callback = GetAdjustedTime,
+        .qtum_context = context,
+    };
+    ChainstateManager chainman{chainman_opts, node::BlockManager::Options{}};
+    BOOST_CHECK(&chainman.Qtum() == context.get());
+    BOOST_CHECK(&chainman.Qtum() != &m_node.chainman->Qtum());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,8 +7,10 @@
 #include <net.h>
 #include <signet.h>
 #include <uint256.h>
+#include <util/convert.h>
 #include <validation.h>
 
+#include <test/util/random.h>
 #include <test/util/setup_common.h>
 
 #include <boost/test/unit_test.hpp>
@@ -180,4 +182,50 @@ BOOST_AUTO_TEST_CASE(test_assumeutxo)
     BOOST_CHECK_EQUAL(out210.nChainTx, 2100U);
 }
 
+BOOST_AUTO_TEST_CASE(last_hashes)
+{
+    std::vector<uint256> hashes(600);
+    std::vector<CBlockIndex> blocks(600);
+    for (size_t i = 0; i < blocks.size(); i++) {
+        hashes[i] = InsecureRand256();
+        blocks[i].phashBlock = &hashes[i];
+        blocks[i].nHeight = i;
+        blocks[i].pprev = i ? &blocks[i - 1] : nullptr;
+        blocks[i].BuildSkip();
+    }
+
+    const auto check = [&](const LastHashes& last_hashes, int tip) {
+        for (int index : {0, 1, 100, 255}) {
+            const dev::h256 expected{index <= tip ? uintToh256(hashes[tip - index]) : dev::h256()};
+            BOOST_CHECK(last_hashes.precedingHash(dev::h256(), index) == expected);
+        }
+        BOOST_CHECK(last_hashes.precedingHash(dev::h256(), 256) == dev::h256());
+        BOOST_CHECK(last_hashes.precedingHashes(dev::h256())[7] == last_hashes.precedingHash(dev::h256(), 7));
+    };
+
+    // The tips follow the chain as blocks are connected, disconnected and reorganized
+    LastHashes last_hashes;
+    for (int tip : {0, 1, 2, 300, 301, 302, 301, 300, 301, 599, 10}) {
+        last_hashes.set(&blocks[tip]);
+        check(last_hashes, tip);
+    }
+
+    // An environment built on an earlier tip still gets the hashes of its own chain
+    LastHashes earlier;
+    earlier.set(&blocks[400]);
+    last_hashes.set(&blocks[500]);
+    check(earlier, 400);
+    check(last_hashes, 500);
+
+    // A block index erased and reused for another block at the same address gets the hashes of its own chain
+    last_hashes.set(&blocks[300]);
+    uint256 reused_hash{InsecureRand256()};
+    std::swap(hashes[300], reused_hash);
+    last_hashes.set(&blocks[300]);
+    check(last_hashes, 300);
+    std::swap(hashes[300], reused_hash);
+    last_hashes.set(&blocks[301]);
+    check(last_hashes, 301);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -6,10 +6,14 @@
 #include <consensus/validation.h>
 #include <primitives/block.h>
 #include <scheduler.h>
+#include <test/util/random.h>
 #include <test/util/setup_common.h>
 #include <util/check.h>
+#include <util/time.h>
 #include <validationinterface.h>
 
+#include <future>
+
 BOOST_FIXTURE_TEST_SUITE(validationinterface_tests, TestingSetup)
 
 struct TestSubscriberNoop final : public CValidationInterface {
@@ -91,4 +95,66 @@ BOOST_AUTO_TEST_CASE(unregister_all_during_call)
     BOOST_CHECK(destroyed);
 }
 
+/** Records the locators of the ChainStateFlushed events, after calling m_on_flush */
+class FlushRecorder : public CValidationInterface
+{
+public:
+    explicit FlushRecorder(std::function<void()> on_flush = nullptr) : m_on_flush(std::move(on_flush)) {}
+
+    std::vector<uint256> Flushed() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        return m_flushed;
+    }
+
+protected:
+    void ChainStateFlushed(const CBlockLocator& locator) override EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        if (m_on_flush) m_on_flush();
+        LOCK(m_mutex);
+        m_flushed.push_back(locator.vHave.front());
+    }
+
+private:
+    const std::function<void()> m_on_flush;
+    Mutex m_mutex;
+    std::vector<uint256> m_flushed GUARDED_BY(m_mutex);
+};
+
+BOOST_AUTO_TEST_CASE(slow_subscriber_does_not_delay_others)
+{
+    // A second scheduler thread lets the queues of the subscribers run in parallel
+    m_node.scheduler->m_extra_service_threads.emplace_back([&] { m_node.scheduler->serviceQueue(); });
+
+    std::promise<void> release;
+    std::shared_future<void> released{release.get_future().share()};
+    auto slow = std::make_shared<FlushRecorder>([released] { released.wait(); });
+    auto fast = std::make_shared<FlushRecorder>();
+    RegisterSharedValidationInterface(slow);
+    RegisterSharedValidationInterface(fast);
+
+    std::vector<uint256> hashes;
+    for (int i = 0; i < 100; ++i) {
+        hashes.push_back(InsecureRand256());
+        GetMainSignals().ChainStateFlushed(CBlockLocator{{hashes.back()}});
+    }
+
+    // The fast subscriber gets every event while the slow one is stuck in the first
+    while (fast->Flushed().size() < hashes.size()) {
+        UninterruptibleSleep(std::chrono::milliseconds{1});
+    }
+    BOOST_CHECK(slow->Flushed().empty());
+    BOOST_CHECK(GetMainSignals().CallbacksPending() >= hashes.size() - 1);
+
+    // Syncing waits for every subscriber, each got the events in order
+    release.set_value();
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK(slow->Flushed() == hashes);
+    BOOST_CHECK(fast->Flushed() == hashes);
+    BOOST_CHECK_EQUAL(GetMainSignals().CallbacksPending(), 0U);
+
+    UnregisterSharedValidationInterface(slow);
+    UnregisterSharedValidationInterface(fast);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
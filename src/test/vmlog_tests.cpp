@@ -0,0 +1,84 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/vmlog.h>
+#include <test/util/setup_common.h>
+#include <univalue.h>
+#include <util/fs.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(vmlog_tests, BasicTestingSetup)
+
+static VMLogRecord MakeRecord(int height)
+{
+    VMLogRecord record;
+    record.txid = uint256::ONE;
+    record.address = dev::Address{"0x00000000000000000000000000000000000000aa"};
+    record.time = 1000 + height;
+    record.block_hash = uint256::ZERO;
+    record.block_height = height;
+    record.logs.emplace_back(dev::Address{"0x00000000000000000000000000000000000000bb"}, dev::h256s{dev::h256{7}}, dev::bytes{1, 2, 3});
+    return record;
+}
+
+static std::vector<std::string> ReadLines(const fs::path& path)
+{
+    std::vector<std::string> lines;
+    std::ifstream file{path};
+    for (std::string line; std::getline(file, line);) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+BOOST_AUTO_TEST_CASE(vmlog_segments)
+{
+    const fs::path dir{m_args.GetDataDirNet() / "vmlogs"};
+    const std::string line{MakeRecord(1).ToJSON().write()};
+    {
+        // Segments of about three records, with a queue shorter than the records logged at once
+        VMLogWriter writer{dir, /*segment_size=*/line.size() * 3, /*max_queue=*/2};
+        for (int height = 1; height <= 7; ++height) {
+            std::vector<VMLogRecord> records;
+            records.push_back(MakeRecord(height));
+            writer.Enqueue(std::move(records));
+        }
+        writer.Flush();
+        BOOST_CHECK_EQUAL(ReadLines(VMLogWriter::SegmentPath(dir, 0)).size(), 3U);
+        BOOST_CHECK_EQUAL(ReadLines(VMLogWriter::SegmentPath(dir, 1)).size(), 3U);
+        BOOST_CHECK_EQUAL(ReadLines(VMLogWriter::SegmentPath(dir, 2)).size(), 1U);
+    }
+
+    // A restarted writer continues the last segment, and writes what is queued when it stops
+    {
+        VMLogWriter writer{dir, /*segment_size=*/line.size() * 3};
+        std::vector<VMLogRecord> records;
+        records.push_back(MakeRecord(8));
+        records.push_back(MakeRecord(9));
+        records.push_back(MakeRecord(10));
+        writer.Enqueue(std::move(records));
+    }
+    const std::vector<std::string> last{ReadLines(VMLogWriter::SegmentPath(dir, 2))};
+    BOOST_CHECK_EQUAL(last.size(), 3U);
+    BOOST_CHECK_EQUAL(ReadLines(VMLogWriter::SegmentPath(dir, 3)).size(), 1U);
+
+    // Each line is a record of the former vmExecLogs.json
+    UniValue record;
+    BOOST_REQUIRE(record.read(last[0]));
+    BOOST_CHECK_EQUAL(record["blockheight"].getInt<int>(), 7);
+    BOOST_CHECK_EQUAL(record["time"].getInt<int64_t>(), 1007);
+    BOOST_CHECK_EQUAL(record["txid"].get_str(), uint256::ONE.GetHex());
+    BOOST_CHECK_EQUAL(record["address"].get_str(), "00000000000000000000000000000000000000aa");
+    const UniValue& entry = record["entries"][0];
+    BOOST_CHECK_EQUAL(entry["address"].get_str(), "00000000000000000000000000000000000000bb");
+    BOOST_CHECK_EQUAL(entry["data"]["raw"].get_str(), "010203");
+    BOOST_CHECK_EQUAL(entry["topics"][0]["raw"].get_str(), dev::h256{7}.hex());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
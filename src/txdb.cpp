@@ -6,17 +6,24 @@
 #include <txdb.h>
 
 #include <chain.h>
+#include <checkqueue.h>
 #include <logging.h>
 #include <pow.h>
 #include <random.h>
 #include <shutdown.h>
 #include <uint256.h>
+#include <util/convert.h>
+#include <util/system.h>
 #include <util/translation.h>
 #include <util/vector.h>
 #include <validation.h>
 #include <chainparams.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <set>
 #include <stdint.h>
+#include <thread>
 
 static constexpr uint8_t DB_COIN{'C'};
 static constexpr uint8_t DB_BLOCK_FILES{'f'};
@@ -26,6 +33,9 @@ static constexpr uint8_t DB_BLOCK_INDEX{'b'};
 static constexpr uint8_t DB_HEIGHTINDEX{'h'};
 static constexpr uint8_t DB_STAKEINDEX{'s'};
 static constexpr uint8_t DB_DELEGATEINDEX{'d'};
+static constexpr uint8_t DB_CONTRACTINDEX{'k'};
+static constexpr uint8_t DB_CONTRACTCOUNT{'K'};
+static constexpr uint8_t DB_CONTRACTADDRESS{'A'};
 //////////////////////////////////////////
 
 static constexpr uint8_t DB_BEST_BLOCK{'B'};
@@ -35,6 +45,7 @@ static constexpr uint8_t DB_REINDEX_FLAG{'R'};
 static constexpr uint8_t DB_LAST_BLOCK{'l'};
 
 ////////////////////////////////////////// // qtum
+// Keys of the address, spent and timestamp indexes, kept by AddressIndex since, that might still be found in the DB:
 static constexpr uint8_t DB_ADDRESSINDEX{'a'};
 static constexpr uint8_t DB_ADDRESSUNSPENTINDEX{'u'};
 static constexpr uint8_t DB_TIMESTAMPINDEX{'S'};
@@ -65,6 +76,46 @@ std::optional<bilingual_str> CheckLegacyTxindex(CBlockTreeDB& block_tree_db)
     return std::nullopt;
 }
 
+namespace {
+/** Erase the entries of the block index db whose keys are a @p prefix followed by a K */
+template <typename K>
+bool EraseLegacyIndexEntries(CBlockTreeDB& block_tree_db, uint8_t prefix)
+{
+    std::unique_ptr<CDBIterator> cursor{block_tree_db.NewIterator()};
+    cursor->Seek(prefix);
+    CDBBatch batch(block_tree_db);
+    std::pair<uint8_t, K> key;
+    for (; cursor->Valid() && cursor->GetKey(key) && key.first == prefix; cursor->Next()) {
+        batch.Erase(key);
+        if (batch.SizeEstimate() > (1 << 24)) {
+            if (!block_tree_db.WriteBatch(batch)) return false;
+            batch.Clear();
+        }
+    }
+    if (!block_tree_db.WriteBatch(batch)) return false;
+    block_tree_db.CompactRange(prefix, uint8_t(prefix + 1));
+    return true;
+}
+} // namespace
+
+bool EraseLegacyAddressIndex(CBlockTreeDB& block_tree_db)
+{
+    bool addrindex_legacy_flag{false};
+    block_tree_db.ReadFlag("addrindex", addrindex_legacy_flag);
+    if (!addrindex_legacy_flag) return true;
+
+    LogPrintf("Erasing the legacy address index from the block index db...\n");
+    if (!EraseLegacyIndexEntries<CAddressIndexKey>(block_tree_db, DB_ADDRESSINDEX) ||
+        !EraseLegacyIndexEntries<CAddressUnspentKey>(block_tree_db, DB_ADDRESSUNSPENTINDEX) ||
+        !EraseLegacyIndexEntries<CTimestampIndexKey>(block_tree_db, DB_TIMESTAMPINDEX) ||
+        !EraseLegacyIndexEntries<CTimestampBlockIndexKey>(block_tree_db, DB_BLOCKHASHINDEX) ||
+        !EraseLegacyIndexEntries<CSpentIndexKey>(block_tree_db, DB_SPENTINDEX)) {
+        return false;
+    }
+    // The flag is cleared last, so that an interrupted upgrade is resumed at the next startup
+    return block_tree_db.WriteFlag("addrindex", false);
+}
+
 bool CCoinsViewDB::NeedsUpgrade()
 {
     std::unique_ptr<CDBIterator> cursor{m_db->NewIterator()};
@@ -133,6 +184,60 @@ bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
     return m_db->Exists(CoinEntry(&outpoint));
 }
 
+namespace {
+/** Read of one coin for CCoinsViewDB::GetCoins, run by the coin fetch threads */
+class CoinFetch
+{
+    const CCoinsViewDB* m_view;
+    const COutPoint* m_outpoint;
+    Coin* m_coin;
+
+public:
+    CoinFetch(const CCoinsViewDB* view, const COutPoint* outpoint, Coin* coin) : m_view(view), m_outpoint(outpoint), m_coin(coin) {}
+
+    bool operator()()
+    {
+        try {
+            if (!m_view->GetCoin(*m_outpoint, *m_coin)) m_coin->Clear();
+            return true;
+        } catch (const std::runtime_error&) {
+            // Read again by the caller, which handles the error
+            return false;
+        }
+    }
+};
+
+CCheckQueue<CoinFetch> coinfetchqueue(8);
+} // namespace
+
+void StartCoinFetchThreads(int threads_num)
+{
+    coinfetchqueue.StartWorkerThreads(threads_num, "coinfetch");
+}
+
+void StopCoinFetchThreads()
+{
+    coinfetchqueue.StopWorkerThreads();
+}
+
+void CCoinsViewDB::GetCoins(Span<const COutPoint> outpoints, std::vector<Coin>& coins) const {
+    if (outpoints.size() < MIN_PARALLEL_COIN_FETCH || !coinfetchqueue.HasThreads()) {
+        return CCoinsView::GetCoins(outpoints, coins);
+    }
+
+    coins.assign(outpoints.size(), Coin());
+    CCheckQueueControl<CoinFetch> control(&coinfetchqueue);
+    std::vector<CoinFetch> fetches;
+    fetches.reserve(outpoints.size());
+    for (size_t i = 0; i < outpoints.size(); i++) {
+        fetches.emplace_back(this, &outpoints[i], &coins[i]);
+    }
+    control.Add(std::move(fetches));
+    if (!control.Wait()) {
+        CCoinsView::GetCoins(outpoints, coins);
+    }
+}
+
 uint256 CCoinsViewDB::GetBestBlock() const {
     uint256 hashBestChain;
     if (!m_db->Read(DB_BEST_BLOCK, hashBestChain))
@@ -254,13 +359,18 @@ private:
 };
 
 std::unique_ptr<CCoinsViewCursor> CCoinsViewDB::Cursor() const
+{
+    return Cursor(COutPoint(uint256(), 0));
+}
+
+std::unique_ptr<CCoinsViewCursor> CCoinsViewDB::Cursor(const COutPoint& start) const
 {
     auto i = std::make_unique<CCoinsViewDBCursor>(
         const_cast<CDBWrapper&>(*m_db).NewIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
-    i->pcursor->Seek(DB_COIN);
+    i->pcursor->Seek(CoinEntry(&start));
     // Cache key of first record
     if (i->pcursor->Valid()) {
         CoinEntry entry(&i->keyTmp.second);
@@ -328,13 +438,13 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
 }
 
 /////////////////////////////////////////////////////// // qtum
-bool CBlockTreeDB::WriteHeightIndex(const CHeightTxIndexKey &heightIndex, const std::vector<uint256>& hash) {
+bool CQtumIndexDB::WriteHeightIndex(const CHeightTxIndexKey &heightIndex, const std::vector<uint256>& hash) {
     CDBBatch batch(*this);
     batch.Write(std::make_pair(DB_HEIGHTINDEX, heightIndex), hash);
     return WriteBatch(batch);
 }
 
-int CBlockTreeDB::ReadHeightIndex(int low, int high, int minconf,
+int CQtumIndexDB::ReadHeightIndex(int low, int high, int minconf,
         std::vector<std::vector<uint256>> &blocksOfHashes,
         std::set<dev::h160> const &addresses, ChainstateManager &chainman) {
 
@@ -389,27 +499,34 @@ int CBlockTreeDB::ReadHeightIndex(int low, int high, int minconf,
     return curheight;
 }
 
-bool CBlockTreeDB::EraseHeightIndex(const unsigned int &height) {
+bool CQtumIndexDB::EraseHeightIndex(const unsigned int &height) {
+
+    return EraseHeightIndexes({height});
+}
+
+bool CQtumIndexDB::EraseHeightIndexes(const std::vector<unsigned int> &heights) {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
     CDBBatch batch(*this);
 
-    pcursor->Seek(std::make_pair(DB_HEIGHTINDEX, CHeightTxIndexIteratorKey(height)));
+    for (const unsigned int height : heights) {
+        pcursor->Seek(std::make_pair(DB_HEIGHTINDEX, CHeightTxIndexIteratorKey(height)));
 
-    while (pcursor->Valid()) {
-        std::pair<uint8_t, CHeightTxIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_HEIGHTINDEX && key.second.height == height) {
-            batch.Erase(key);
-            pcursor->Next();
-        } else {
-            break;
+        while (pcursor->Valid()) {
+            std::pair<uint8_t, CHeightTxIndexKey> key;
+            if (pcursor->GetKey(key) && key.first == DB_HEIGHTINDEX && key.second.height == height) {
+                batch.Erase(key);
+                pcursor->Next();
+            } else {
+                break;
+            }
         }
     }
 
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::WipeHeightIndex() {
+bool CQtumIndexDB::WipeHeightIndex() {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
     CDBBatch batch(*this);
@@ -426,17 +543,20 @@ bool CBlockTreeDB::WipeHeightIndex() {
         }
     }
 
-    return WriteBatch(batch);
+    if (batch.SizeEstimate() == 0) return true;
+    if (!WriteBatch(batch)) return false;
+    CompactRange(DB_HEIGHTINDEX, uint8_t(DB_HEIGHTINDEX + 1));
+    return true;
 }
 
 
-bool CBlockTreeDB::WriteStakeIndex(unsigned int height, uint160 address) {
+bool CQtumIndexDB::WriteStakeIndex(unsigned int height, uint160 address) {
     CDBBatch batch(*this);
     batch.Write(std::make_pair(DB_STAKEINDEX, height), address);
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadStakeIndex(unsigned int height, uint160& address){
+bool CQtumIndexDB::ReadStakeIndex(unsigned int height, uint160& address){
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_STAKEINDEX, height));
@@ -453,7 +573,7 @@ bool CBlockTreeDB::ReadStakeIndex(unsigned int height, uint160& address){
     }
     return false;
 }
-bool CBlockTreeDB::ReadStakeIndex(unsigned int high, unsigned int low, std::vector<uint160> addresses){
+bool CQtumIndexDB::ReadStakeIndex(unsigned int high, unsigned int low, std::vector<uint160> addresses){
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_STAKEINDEX, low));
@@ -474,7 +594,7 @@ bool CBlockTreeDB::ReadStakeIndex(unsigned int high, unsigned int low, std::vect
     return true;
 }
 
-bool CBlockTreeDB::EraseStakeIndex(unsigned int height) {
+bool CQtumIndexDB::EraseStakeIndex(unsigned int height) {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
     CDBBatch batch(*this);
@@ -494,13 +614,13 @@ bool CBlockTreeDB::EraseStakeIndex(unsigned int height) {
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::WriteDelegateIndex(unsigned int height, uint160 address, uint8_t fee) {
+bool CQtumIndexDB::WriteDelegateIndex(unsigned int height, uint160 address, uint8_t fee) {
     CDBBatch batch(*this);
     batch.Write(std::make_pair(DB_DELEGATEINDEX, height), DelegateEntry(address, fee));
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadDelegateIndex(unsigned int height, uint160& address, uint8_t& fee){
+bool CQtumIndexDB::ReadDelegateIndex(unsigned int height, uint160& address, uint8_t& fee){
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_DELEGATEINDEX, height));
@@ -521,7 +641,7 @@ bool CBlockTreeDB::ReadDelegateIndex(unsigned int height, uint160& address, uint
     return false;
 }
 
-bool CBlockTreeDB::EraseDelegateIndex(unsigned int height) {
+bool CQtumIndexDB::EraseDelegateIndex(unsigned int height) {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
     CDBBatch batch(*this);
@@ -541,215 +661,311 @@ bool CBlockTreeDB::EraseDelegateIndex(unsigned int height) {
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
-}
+namespace {
+/** Key of the contract index, the position of the contract in big endian so that the contracts are kept in order */
+struct CContractIndexKey {
+    unsigned int position;
 
-bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
+    explicit CContractIndexKey(unsigned int _position = 0) : position(_position) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, DB_CONTRACTINDEX);
+        ser_writedata32be(s, position);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        if (ser_readdata8(s) != DB_CONTRACTINDEX) {
+            throw std::ios_base::failure("Invalid format for contract index key");
+        }
+        position = ser_readdata32be(s);
+    }
+};
+} // namespace
+
+bool CQtumIndexDB::StartContractIndex() {
+    if (!WipeContractIndex()) return false;
+    return Write(DB_CONTRACTCOUNT, uint32_t{0});
 }
 
-bool CBlockTreeDB::ReadAddressIndex(uint256 addressHash, int type,
-                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
+bool CQtumIndexDB::WipeContractIndex() {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    CDBBatch batch(*this);
 
-    if (start > 0 && end > 0) {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
-    } else {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    for (pcursor->Seek(DB_CONTRACTINDEX); pcursor->Valid(); pcursor->Next()) {
+        CContractIndexKey key;
+        if (!pcursor->GetKey(key)) {
+            break;
+        }
+        batch.Erase(key);
     }
-
-    while (pcursor->Valid()) {
-        std::pair<uint8_t,CAddressIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash) {
-            if (end > 0 && key.second.blockHeight > end) {
-                break;
-            }
-            CAmount nValue;
-            if (pcursor->GetValue(nValue)) {
-                addressIndex.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address index value");
-            }
-        } else {
+    for (pcursor->Seek(DB_CONTRACTADDRESS); pcursor->Valid(); pcursor->Next()) {
+        std::pair<uint8_t, uint160> key;
+        if (!pcursor->GetKey(key) || key.first != DB_CONTRACTADDRESS) {
             break;
         }
+        batch.Erase(key);
     }
+    const bool erased_entries = batch.SizeEstimate() > 0;
+    batch.Erase(DB_CONTRACTCOUNT);
 
+    if (!WriteBatch(batch)) return false;
+    if (erased_entries) {
+        CompactRange(DB_CONTRACTINDEX, uint8_t(DB_CONTRACTINDEX + 1));
+        CompactRange(DB_CONTRACTADDRESS, uint8_t(DB_CONTRACTADDRESS + 1));
+    }
     return true;
 }
 
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
+bool CQtumIndexDB::ReadContractCount(unsigned int& count) {
+    uint32_t value;
+    if (!Read(DB_CONTRACTCOUNT, value)) return false;
+    count = value;
+    return true;
+}
+
+bool CQtumIndexDB::WriteContractIndex(const std::vector<CContractIndexEntry>& contracts) {
+    unsigned int count;
+    if (contracts.empty() || !ReadContractCount(count)) return true;
+
+    // A contract destroyed and created again at the same address keeps its first position
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
-        } else {
-            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
-        }
+    std::set<uint160> written;
+    for (const CContractIndexEntry& contract : contracts) {
+        const auto address_key = std::make_pair(DB_CONTRACTADDRESS, h160Touint(contract.address));
+        if (!written.insert(address_key.second).second || Exists(address_key)) continue;
+        batch.Write(address_key, uint32_t{count});
+        batch.Write(CContractIndexKey(count++), contract);
     }
+    batch.Write(DB_CONTRACTCOUNT, uint32_t{count});
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint256 addressHash, int type,
-                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+bool CQtumIndexDB::ReadContractIndex(unsigned int start, unsigned int max_count, std::vector<CContractIndexEntry>& contracts) {
+    unsigned int count;
+    if (!ReadContractCount(count)) return false;
 
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
-
-    while (pcursor->Valid()) {
-        std::pair<uint8_t,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
-            CAddressUnspentValue nValue;
-            if (pcursor->GetValue(nValue)) {
-                unspentOutputs.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address unspent value");
-            }
-        } else {
-            break;
-        }
+    for (unsigned int position = start; position < count && contracts.size() < max_count; position++) {
+        CContractIndexEntry contract;
+        if (!Read(CContractIndexKey(position), contract)) return false;
+        contracts.push_back(contract);
     }
-
     return true;
 }
 
-bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
+bool CQtumIndexDB::EraseContractIndexes(const std::vector<unsigned int>& heights) {
+    unsigned int count;
+    if (heights.empty() || !ReadContractCount(count)) return true;
+
+    // Blocks are disconnected from the tip, so the contracts they created are the last ones
+    const unsigned int low = *std::min_element(heights.begin(), heights.end());
     CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
+    while (count > 0) {
+        CContractIndexEntry contract;
+        if (!Read(CContractIndexKey(count - 1), contract)) return false;
+        if (contract.height < low) break;
+        batch.Erase(std::make_pair(DB_CONTRACTADDRESS, h160Touint(contract.address)));
+        batch.Erase(CContractIndexKey(--count));
+    }
+    batch.Write(DB_CONTRACTCOUNT, uint32_t{count});
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes, ChainstateManager &chainman) {
-
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+/** Move the entries with a key prefix from the block tree database, returns the number moved or -1 on failure */
+template <typename Key, typename Value>
+static int64_t MoveIndexEntries(CBlockTreeDB& block_tree_db, CQtumIndexDB& qtum_index_db, uint8_t prefix)
+{
+    static constexpr size_t batch_size = 16 << 20;
+
+    std::unique_ptr<CDBIterator> pcursor(block_tree_db.NewIterator());
+    CDBBatch batch_to(qtum_index_db);
+    CDBBatch batch_from(block_tree_db);
+    int64_t count = 0;
+
+    // The entries are written to the new database before they are erased from the old one,
+    // so an interrupted migration is completed on the next start
+    auto flush = [&]() {
+        if (!qtum_index_db.WriteBatch(batch_to, true) || !block_tree_db.WriteBatch(batch_from)) return false;
+        batch_to.Clear();
+        batch_from.Clear();
+        return true;
+    };
+
+    for (pcursor->Seek(prefix); pcursor->Valid(); pcursor->Next()) {
+        std::pair<uint8_t, Key> key;
+        if (!pcursor->GetKey(key) || key.first != prefix) break;
+        Value value;
+        if (!pcursor->GetValue(value)) {
+            LogPrintf("%s: Cannot parse the value of an index entry\n", __func__);
+            return -1;
+        }
+        batch_to.Write(key, value);
+        batch_from.Erase(key);
+        ++count;
 
-    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
+        if (batch_to.SizeEstimate() > batch_size && !flush()) return -1;
+    }
 
-    while (pcursor->Valid()) {
-        std::pair<uint8_t, CTimestampIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp < high) {
-            if (fActiveOnly) {
-                if (blockOnchainActive(key.second.blockHash, chainman)) {
-                    hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
-                }
-            } else {
-                hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
-            }
+    return flush() ? count : -1;
+}
 
-            pcursor->Next();
-        } else {
-            break;
-        }
+bool MigrateQtumIndexes(CBlockTreeDB& block_tree_db, CQtumIndexDB& qtum_index_db)
+{
+    const int64_t heights = MoveIndexEntries<CHeightTxIndexKey, std::vector<uint256>>(block_tree_db, qtum_index_db, DB_HEIGHTINDEX);
+    const int64_t stakes = MoveIndexEntries<unsigned int, uint160>(block_tree_db, qtum_index_db, DB_STAKEINDEX);
+    const int64_t delegates = MoveIndexEntries<unsigned int, DelegateEntry>(block_tree_db, qtum_index_db, DB_DELEGATEINDEX);
+    if (heights < 0 || stakes < 0 || delegates < 0) {
+        return false;
     }
 
+    if (heights > 0 || stakes > 0 || delegates > 0) {
+        LogPrintf("Moved %d height, %d stake and %d delegate index entries from the block tree database\n", heights, stakes, delegates);
+    }
     return true;
 }
 
-bool CBlockTreeDB::WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts) {
-    CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_BLOCKHASHINDEX, blockhashIndex), logicalts);
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &ltimestamp) {
+///////////////////////////////////////////////////////
 
-    CTimestampBlockIndexValue lts;
-    if (!Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
-       return false;
+namespace {
+/** Block index entry read from the database, with the block hash computed by the reading thread */
+struct LoadedBlockIndex
+{
+    uint256 hash;
+    CDiskBlockIndex diskindex;
+};
 
-    ltimestamp = lts.ltimestamp;
-    return true;
-}
+/** Number of parts the block index keys are split in, by the first byte of the block hash */
+static constexpr int BLOCK_INDEX_PARTS{256};
+} // namespace
 
-bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(std::make_pair(DB_SPENTINDEX, key), value);
-}
+/** Read the block index entries of a part of the keys */
+static bool ReadBlockIndexPart(CDBWrapper& db, int part, std::vector<LoadedBlockIndex>& entries)
+{
+    // The key of a part starts with its byte in the serialized hash
+    uint256 start;
+    *start.begin() = part;
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, start));
 
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_SPENTINDEX, it->first));
-        } else {
-            batch.Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
+    while (pcursor->Valid()) {
+        if (ShutdownRequested()) return false;
+        std::pair<uint8_t, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() != part) {
+            break;
+        }
+        LoadedBlockIndex entry;
+        if (!pcursor->GetValue(entry.diskindex)) {
+            return error("%s: failed to read value", __func__);
         }
+        entry.hash = entry.diskindex.ConstructBlockHash();
+        entries.push_back(std::move(entry));
+        pcursor->Next();
     }
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::blockOnchainActive(const uint256 &hash, ChainstateManager &chainman) {
-    LOCK(cs_main);
-    node::BlockMap::iterator mi = chainman.BlockIndex().find(hash);
-    if (mi == chainman.BlockIndex().end())
-        return false;
-
-    CBlockIndex* pblockindex = &(*mi).second;
-    return pblockindex && chainman.ActiveChain().Contains(pblockindex);
+    return true;
 }
-///////////////////////////////////////////////////////
 
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
     AssertLockHeld(::cs_main);
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
-    // Load m_block_index
-    while (pcursor->Valid()) {
-        if (ShutdownRequested()) return false;
-        std::pair<uint8_t, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.ConstructBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nMoneySupply   = diskindex.nMoneySupply;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-                pindexNew->hashStateRoot  = diskindex.hashStateRoot; // qtum
-                pindexNew->hashUTXORoot   = diskindex.hashUTXORoot; // qtum
-                pindexNew->nStakeModifier = diskindex.nStakeModifier;
-                pindexNew->prevoutStake   = diskindex.prevoutStake;
-                pindexNew->vchBlockSigDlgt    = diskindex.vchBlockSigDlgt; // qtum
-
-                if (!CheckIndexProof(*pindexNew, consensusParams)) {
-                    return error("%s: CheckIndexProof failed: %s", __func__, pindexNew->ToString());
-                }
+    // Reading and hashing the entries runs on several threads, part by part, while this thread
+    // links the parts into m_block_index in key order. Only a few parts are read ahead to bound
+    // the memory held by the entries not linked yet.
+    const int num_threads = std::clamp(GetNumCores(), 1, MAX_BLOCK_INDEX_LOAD_THREADS);
+    const int read_ahead = 2 * num_threads;
+    Mutex mutex;
+    std::condition_variable cond;
+    std::vector<std::vector<LoadedBlockIndex>> parts(BLOCK_INDEX_PARTS);
+    std::vector<bool> ready(BLOCK_INDEX_PARTS);
+    int next_part = 0;
+    int linked_parts = 0;
+    bool failed = false;
+
+    auto read = [&] {
+        while (true) {
+            int part;
+            {
+                WAIT_LOCK(mutex, lock);
+                cond.wait(lock, [&] { return failed || next_part >= BLOCK_INDEX_PARTS || next_part < linked_parts + read_ahead; });
+                if (failed || next_part >= BLOCK_INDEX_PARTS) return;
+                part = next_part++;
+            }
+            std::vector<LoadedBlockIndex> entries;
+            const bool read_ok = ReadBlockIndexPart(*this, part, entries);
+            {
+                LOCK(mutex);
+                failed |= !read_ok;
+                parts[part] = std::move(entries);
+                ready[part] = true;
+            }
+            cond.notify_all();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(read);
+    }
 
-                // NovaCoin: build setStakeSeen
-                if (pindexNew->IsProofOfStake())
-                    setStakeSeen.insert(std::make_pair(pindexNew->prevoutStake, pindexNew->nTime));
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
+    // Load m_block_index
+    bool ok = true;
+    for (int part = 0; part < BLOCK_INDEX_PARTS && ok; ++part) {
+        std::vector<LoadedBlockIndex> entries;
+        {
+            WAIT_LOCK(mutex, lock);
+            cond.wait(lock, [&] { return failed || ready[part]; });
+            if (failed) {
+                ok = false;
+                break;
             }
-        } else {
-            break;
+            entries = std::move(parts[part]);
+            linked_parts = part + 1;
+        }
+        cond.notify_all();
+
+        for (LoadedBlockIndex& entry : entries) {
+            const CDiskBlockIndex& diskindex = entry.diskindex;
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(entry.hash);
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nMoneySupply   = diskindex.nMoneySupply;
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nTx            = diskindex.nTx;
+            pindexNew->hashStateRoot  = diskindex.hashStateRoot; // qtum
+            pindexNew->hashUTXORoot   = diskindex.hashUTXORoot; // qtum
+            pindexNew->nStakeModifier = diskindex.nStakeModifier;
+            pindexNew->prevoutStake   = diskindex.prevoutStake;
+            pindexNew->vchBlockSigDlgt    = std::move(entry.diskindex.vchBlockSigDlgt); // qtum
+
+            if (!CheckIndexProof(*pindexNew, consensusParams)) {
+                ok = error("%s: CheckIndexProof failed: %s", __func__, pindexNew->ToString());
+                break;
+            }
+
+            // NovaCoin: build setStakeSeen
+            if (pindexNew->IsProofOfStake())
+                setStakeSeen.insert(std::make_pair(pindexNew->prevoutStake, pindexNew->nTime));
         }
     }
 
-    return true;
+    {
+        LOCK(mutex);
+        failed |= !ok;
+    }
+    cond.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return !failed;
 }
 
 bool CBlockTreeDB::EraseBlockIndex(const std::vector<uint256> &vect)
@@ -67,6 +67,10 @@ static const int64_t nMaxTxIndexCache = 1024;
 static const int64_t max_filter_index_cache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! -statedbcache default, memory of the block cache and write buffers of the contract state databases (MiB)
+static const int64_t nDefaultStateDBCache = 64;
+//! -statewritecache default, memory of the contract state trie nodes kept between writes during the initial block download (MiB)
+static const int64_t nDefaultStateWriteCache = 128;
 
 //! User-controlled performance and debug options.
 struct CoinsViewOptions {
@@ -89,10 +93,15 @@ public:
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
+    //! Reads the coins in parallel on the coin fetch threads, when they are started and there are enough of them
+    void GetCoins(Span<const COutPoint> outpoints, std::vector<Coin>& coins) const override;
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase = true) override;
     std::unique_ptr<CCoinsViewCursor> Cursor() const override;
+    //! Cursor over the coins from @p start on, in the order of their database keys, that is by txid bytes then output index.
+    //! The cursors made without the database being written in between see the same coins.
+    std::unique_ptr<CCoinsViewCursor> Cursor(const COutPoint& start) const;
 
     //! Whether an unsupported database format is used.
     bool NeedsUpgrade();
@@ -105,6 +114,16 @@ public:
     std::optional<fs::path> StoragePath() { return m_db->StoragePath(); }
 };
 
+/** Minimum number of coins that CCoinsViewDB::GetCoins reads in parallel */
+static const size_t MIN_PARALLEL_COIN_FETCH = 32;
+
+/** Start and stop the threads that read coins for CCoinsViewDB::GetCoins */
+void StartCoinFetchThreads(int threads_num);
+void StopCoinFetchThreads();
+
+/** Maximum number of threads that read the block index at startup */
+static constexpr int MAX_BLOCK_INDEX_LOAD_THREADS{8};
+
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CDBWrapper
 {
@@ -121,6 +140,35 @@ public:
         EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
     ////////////////////////////////////////////////////////////////////////////// // qtum
+    bool EraseBlockIndex(const std::vector<uint256>&vect);
+    //////////////////////////////////////////////////////////////////////////////
+};
+
+std::optional<bilingual_str> CheckLegacyTxindex(CBlockTreeDB& block_tree_db);
+
+/** Erase the address, spent and timestamp indexes written to the block index db before they were kept by AddressIndex */
+bool EraseLegacyAddressIndex(CBlockTreeDB& block_tree_db);
+
+////////////////////////////////////////////////////////////////////////////// // qtum
+/** A contract as kept in the contract index, the txid is null for the contracts not created by a transaction */
+struct CContractIndexEntry {
+    dev::h160 address;
+    unsigned int height{0};
+    uint256 txid;
+    uint256 codeHash;
+
+    SERIALIZE_METHODS(CContractIndexEntry, obj)
+    {
+        READWRITE(Span{obj.address.data(), dev::h160::size}, obj.height, obj.txid, obj.codeHash);
+    }
+};
+
+/** Access to the height, stake, delegate and contract indexes (qtumindex/) */
+class CQtumIndexDB : public CDBWrapper
+{
+public:
+    using CDBWrapper::CDBWrapper;
+
     bool WriteHeightIndex(const CHeightTxIndexKey &heightIndex, const std::vector<uint256>& hash);
 
     /**
@@ -138,9 +186,9 @@ public:
             std::vector<std::vector<uint256>> &blocksOfHashes,
             std::set<dev::h160> const &addresses, ChainstateManager &chainman);
     bool EraseHeightIndex(const unsigned int &height);
+    bool EraseHeightIndexes(const std::vector<unsigned int> &heights);
     bool WipeHeightIndex();
 
-
     bool WriteStakeIndex(unsigned int height, uint160 address);
     bool ReadStakeIndex(unsigned int height, uint160& address);
     bool ReadStakeIndex(unsigned int high, unsigned int low, std::vector<uint160> addresses);
@@ -150,29 +198,29 @@ public:
     bool ReadDelegateIndex(unsigned int height, uint160& address, uint8_t& fee);
     bool EraseDelegateIndex(unsigned int height);
 
-    bool EraseBlockIndex(const std::vector<uint256>&vect);
-
-    // Block explorer database functions
-    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
-    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
-    bool ReadAddressIndex(uint256 addressHash, int type,
-                        std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                        int start = 0, int end = 0);
-    bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
-    bool ReadAddressUnspentIndex(uint256 addressHash, int type,
-                                std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
-    bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
-    bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect, ChainstateManager & chainman);
-    bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
-    bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
-    bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
-    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
-    bool blockOnchainActive(const uint256 &hash, ChainstateManager &chainman);
-
-    //////////////////////////////////////////////////////////////////////////////
+    /**
+     * The contract index is the list of the contracts in the order they were created, starting
+     * with those of the genesis state. It is only complete when kept from the genesis block, so it
+     * is started when the chain is empty and is not available otherwise.
+     */
+    bool StartContractIndex();
+    bool WipeContractIndex();
+    /** Read the number of contracts in the index, returns false if the index is not available */
+    bool ReadContractCount(unsigned int& count);
+    /** Append the contracts created by a block, does nothing if the index is not available */
+    bool WriteContractIndex(const std::vector<CContractIndexEntry>& contracts);
+    /** Read at most max_count contracts starting from position start, the first contract being at 0 */
+    bool ReadContractIndex(unsigned int start, unsigned int max_count, std::vector<CContractIndexEntry>& contracts);
+    /** Erase the contracts created at or above the lowest of the disconnected heights */
+    bool EraseContractIndexes(const std::vector<unsigned int>& heights);
 };
 
-std::optional<bilingual_str> CheckLegacyTxindex(CBlockTreeDB& block_tree_db);
+/**
+ * Move the height, stake and delegate index entries that older versions kept in the block
+ * tree database to the qtum index database. Does nothing when there are none left to move.
+ */
+bool MigrateQtumIndexes(CBlockTreeDB& block_tree_db, CQtumIndexDB& qtum_index_db);
+//////////////////////////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////// // qtum
 struct CHeightTxIndexIteratorKey {
@@ -15,6 +15,7 @@
 #include <policy/settings.h>
 #include <reverse_iterator.h>
 #include <util/check.h>
+#include <util/metrics.h>
 #include <util/moneystr.h>
 #include <util/overflow.h>
 #include <util/result.h>
@@ -88,7 +89,7 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap& cachedDescendan
             cachedDescendants[updateIt].insert(mapTx.iterator_to(descendant));
             // Update ancestor state for each descendant
             mapTx.modify(mapTx.iterator_to(descendant), [=](CTxMemPoolEntry& e) {
-              e.UpdateAncestorState(updateIt->GetTxSize(), updateIt->GetModifiedFee(), 1, updateIt->GetSigOpCost());
+              e.UpdateAncestorState(updateIt->GetTxSize(), updateIt->GetModifiedFee(), 1, updateIt->GetSigOpCost(), updateIt->GetGasLimit());
             });
             // Don't directly remove the transaction here -- doing so would
             // invalidate iterators in cachedDescendants. Mark it for removal
@@ -294,12 +295,14 @@ void CTxMemPool::UpdateEntryForAncestors(txiter it, const setEntries &setAncesto
     int64_t updateSize = 0;
     CAmount updateFee = 0;
     int64_t updateSigOpsCost = 0;
+    int64_t updateGasLimit = 0;
     for (txiter ancestorIt : setAncestors) {
         updateSize += ancestorIt->GetTxSize();
         updateFee += ancestorIt->GetModifiedFee();
         updateSigOpsCost += ancestorIt->GetSigOpCost();
+        updateGasLimit += ancestorIt->GetGasLimit();
     }
-    mapTx.modify(it, [=](CTxMemPoolEntry& e){ e.UpdateAncestorState(updateSize, updateFee, updateCount, updateSigOpsCost); });
+    mapTx.modify(it, [=](CTxMemPoolEntry& e){ e.UpdateAncestorState(updateSize, updateFee, updateCount, updateSigOpsCost, updateGasLimit); });
 }
 
 void CTxMemPool::UpdateChildrenForRemoval(txiter it)
@@ -328,8 +331,9 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
             int64_t modifySize = -((int64_t)removeIt->GetTxSize());
             CAmount modifyFee = -removeIt->GetModifiedFee();
             int modifySigOps = -removeIt->GetSigOpCost();
+            int64_t modifyGasLimit = -((int64_t)removeIt->GetGasLimit());
             for (txiter dit : setDescendants) {
-                mapTx.modify(dit, [=](CTxMemPoolEntry& e){ e.UpdateAncestorState(modifySize, modifyFee, -1, modifySigOps); });
+                mapTx.modify(dit, [=](CTxMemPoolEntry& e){ e.UpdateAncestorState(modifySize, modifyFee, -1, modifySigOps, modifyGasLimit); });
             }
         }
     }
@@ -376,7 +380,7 @@ void CTxMemPoolEntry::UpdateDescendantState(int64_t modifySize, CAmount modifyFe
     assert(int64_t(nCountWithDescendants) > 0);
 }
 
-void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount, int64_t modifySigOps)
+void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount, int64_t modifySigOps, int64_t modifyGasLimit)
 {
     nSizeWithAncestors += modifySize;
     assert(int64_t(nSizeWithAncestors) > 0);
@@ -385,6 +389,8 @@ void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee,
     assert(int64_t(nCountWithAncestors) > 0);
     nSigOpCostWithAncestors += modifySigOps;
     assert(int(nSigOpCostWithAncestors) >= 0);
+    nGasLimitWithAncestors += modifyGasLimit;
+    assert(int64_t(nGasLimitWithAncestors) >= 0);
 }
 
 CTxMemPool::CTxMemPool(const Options& opts)
@@ -469,6 +475,8 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
 
     vTxHashes.emplace_back(tx.GetWitnessHash(), newit);
     newit->vTxHashesIdx = vTxHashes.size() - 1;
+    g_metrics.mempool_txs.Set(mapTx.size());
+    g_metrics.mempool_bytes.Set(totalTxSize);
 
     TRACE3(mempool, added,
         entry.GetTx().GetHash().data(),
@@ -504,6 +512,12 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 
     RemoveUnbroadcastTx(hash, true /* add logging because unchecked */ );
 
+    // Whatever the reason of the removal, so that evicted and replaced transactions leave no entries
+    if (fAddressIndex) {
+        removeAddressIndex(hash);
+        removeSpentIndex(hash);
+    }
+
     if (vTxHashes.size() > 1) {
         vTxHashes[it->vTxHashesIdx] = std::move(vTxHashes.back());
         vTxHashes[it->vTxHashesIdx].second->vTxHashesIdx = it->vTxHashesIdx;
@@ -520,6 +534,8 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     mapTx.erase(it);
     nTransactionsUpdated++;
     if (minerPolicyEstimator) {minerPolicyEstimator->removeTx(hash, false);}
+    g_metrics.mempool_txs.Set(mapTx.size());
+    g_metrics.mempool_bytes.Set(totalTxSize);
 }
 
 // Calculates descendants of entry that are not already in setDescendants, and adds to
@@ -646,10 +662,6 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
         }
         removeConflicts(*tx);
         ClearPrioritisation(tx->GetHash());
-        if(fAddressIndex) {
-            removeAddressIndex(tx->GetHash());
-            removeSpentIndex(tx->GetHash());
-        }
     }
     lastRollingFeeUpdate = GetTime();
     blockSinceLastRollingFeeBump = true;
@@ -708,17 +720,20 @@ void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendhei
         uint64_t nSizeCheck = it->GetTxSize();
         CAmount nFeesCheck = it->GetModifiedFee();
         int64_t nSigOpCheck = it->GetSigOpCost();
+        uint64_t nGasLimitCheck = it->GetGasLimit();
 
         for (txiter ancestorIt : ancestors) {
             nSizeCheck += ancestorIt->GetTxSize();
             nFeesCheck += ancestorIt->GetModifiedFee();
             nSigOpCheck += ancestorIt->GetSigOpCost();
+            nGasLimitCheck += ancestorIt->GetGasLimit();
         }
 
         assert(it->GetCountWithAncestors() == nCountCheck);
         assert(it->GetSizeWithAncestors() == nSizeCheck);
         assert(it->GetSigOpCostWithAncestors() == nSigOpCheck);
         assert(it->GetModFeesWithAncestors() == nFeesCheck);
+        assert(it->GetGasLimitWithAncestors() == nGasLimitCheck);
         // Sanity check: we are walking in ascending ancestor count order.
         assert(prev_ancestor_count <= it->GetCountWithAncestors());
         prev_ancestor_count = it->GetCountWithAncestors();
@@ -878,7 +893,7 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
             CalculateDescendants(it, setDescendants);
             setDescendants.erase(it);
             for (txiter descendantIt : setDescendants) {
-                mapTx.modify(descendantIt, [=](CTxMemPoolEntry& e){ e.UpdateAncestorState(0, nFeeDelta, 0, 0); });
+                mapTx.modify(descendantIt, [=](CTxMemPoolEntry& e){ e.UpdateAncestorState(0, nFeeDelta, 0, 0, 0); });
             }
             ++nTransactionsUpdated;
         }
@@ -1175,11 +1190,10 @@ std::string RemovalReasonToString(const MemPoolRemovalReason& r) noexcept
 }
 
 /////////////////////////////////////////////////////// // qtum
-void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
+void MempoolAddressIndex::AddAddresses(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
 {
-    LOCK(cs);
     const CTransaction& tx = entry.GetTx();
-    std::vector<CMempoolAddressDeltaKey> inserted;
+    std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>> deltas;
 
     uint256 txhash = tx.GetHash();
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
@@ -1196,8 +1210,7 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
             std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
             CMempoolAddressDeltaKey key(dest.index(), uint256(addressBytes), txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime().count(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            deltas.emplace_back(key, delta);
         }
     }
 
@@ -1213,49 +1226,72 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
             valtype addressBytes(32);
             std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
             CMempoolAddressDeltaKey key(dest.index(), uint256(addressBytes), txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime().count(), out.nValue)));
-            inserted.push_back(key);
+            deltas.emplace_back(key, CMempoolAddressDelta(entry.GetTime().count(), out.nValue));
         }
     }
 
-    mapAddressInserted.insert(std::make_pair(txhash, inserted));
+    std::vector<CMempoolAddressDeltaKey> inserted;
+    inserted.reserve(deltas.size());
+    for (const auto& [key, delta] : deltas) {
+        AddressShard& shard = m_address_shards[AddressShardIndex(key.addressBytes)];
+        LOCK(shard.mutex);
+        shard.deltas[key.addressBytes].insert(std::make_pair(key, delta));
+        inserted.push_back(key);
+    }
+
+    LOCK(m_inserted_mutex);
+    m_address_inserted.emplace(txhash, std::move(inserted));
 }
 
-bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint256, int> > &addresses, std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results)
+void MempoolAddressIndex::GetAddressDeltas(const std::vector<std::pair<uint256, int>>& addresses,
+                                           std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>>& results) const
 {
-    LOCK(cs);
-    for (std::vector<std::pair<uint256, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
-            results.push_back(*ait);
-            ait++;
+    // The addresses are grouped by shard, so that each shard is locked once for the batch
+    std::array<std::vector<const std::pair<uint256, int>*>, SHARDS> by_shard;
+    for (const auto& address : addresses) {
+        by_shard[AddressShardIndex(address.first)].push_back(&address);
+    }
+    for (size_t i = 0; i < SHARDS; i++) {
+        if (by_shard[i].empty()) continue;
+        const AddressShard& shard = m_address_shards[i];
+        LOCK(shard.mutex);
+        for (const std::pair<uint256, int>* address : by_shard[i]) {
+            auto it = shard.deltas.find(address->first);
+            if (it == shard.deltas.end()) continue;
+            addressDeltaMap::const_iterator ait = it->second.lower_bound(CMempoolAddressDeltaKey(address->second, address->first));
+            while (ait != it->second.end() && ait->first.type == address->second) {
+                results.push_back(*ait);
+                ait++;
+            }
         }
     }
-    return true;
 }
 
-bool CTxMemPool::removeAddressIndex(const uint256 txhash)
+void MempoolAddressIndex::RemoveAddresses(const uint256& txhash)
 {
-    LOCK(cs);
-    addressDeltaMapInserted::iterator it = mapAddressInserted.find(txhash);
-
-    if (it != mapAddressInserted.end()) {
-        std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
-        for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapAddress.erase(*mit);
-        }
-        mapAddressInserted.erase(it);
+    std::vector<CMempoolAddressDeltaKey> keys;
+    {
+        LOCK(m_inserted_mutex);
+        auto it = m_address_inserted.find(txhash);
+        if (it == m_address_inserted.end()) return;
+        keys = std::move(it->second);
+        m_address_inserted.erase(it);
     }
 
-    return true;
+    for (const CMempoolAddressDeltaKey& key : keys) {
+        AddressShard& shard = m_address_shards[AddressShardIndex(key.addressBytes)];
+        LOCK(shard.mutex);
+        auto it = shard.deltas.find(key.addressBytes);
+        if (it == shard.deltas.end()) continue;
+        it->second.erase(key);
+        if (it->second.empty()) shard.deltas.erase(it);
+    }
 }
 
-void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
+void MempoolAddressIndex::AddSpent(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
 {
-    LOCK(cs);
-
     const CTransaction& tx = entry.GetTx();
-    std::vector<CSpentIndexKey> inserted;
+    std::vector<COutPoint> inserted;
 
     uint256 txhash = tx.GetHash();
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
@@ -1292,42 +1328,79 @@ void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCac
             addressType = 0;
         }
 
-        CSpentIndexKey key = CSpentIndexKey(input.prevout.hash, input.prevout.n);
         CSpentIndexValue value = CSpentIndexValue(txhash, j, -1, prevout.nValue, addressType, addressHash);
 
-        mapSpent.insert(std::make_pair(key, value));
-        inserted.push_back(key);
+        SpentShard& shard = m_spent_shards[SpentShardIndex(input.prevout)];
+        LOCK(shard.mutex);
+        shard.spent.insert(std::make_pair(input.prevout, value));
+        inserted.push_back(input.prevout);
     }
 
-    mapSpentInserted.insert(std::make_pair(txhash, inserted));
+    LOCK(m_inserted_mutex);
+    m_spent_inserted.emplace(txhash, std::move(inserted));
 }
 
-bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) const
+bool MempoolAddressIndex::GetSpent(const CSpentIndexKey& key, CSpentIndexValue& value) const
 {
-    LOCK(cs);
-    mapSpentIndex::const_iterator it;
-
-    it = mapSpent.find(key);
-    if (it != mapSpent.end()) {
+    const COutPoint outpoint(key.txid, key.outputIndex);
+    const SpentShard& shard = m_spent_shards[SpentShardIndex(outpoint)];
+    LOCK(shard.mutex);
+    auto it = shard.spent.find(outpoint);
+    if (it != shard.spent.end()) {
         value = it->second;
         return true;
     }
     return false;
 }
 
-bool CTxMemPool::removeSpentIndex(const uint256 txhash)
+void MempoolAddressIndex::RemoveSpent(const uint256& txhash)
 {
-    LOCK(cs);
-    mapSpentIndexInserted::iterator it = mapSpentInserted.find(txhash);
+    std::vector<COutPoint> keys;
+    {
+        LOCK(m_inserted_mutex);
+        auto it = m_spent_inserted.find(txhash);
+        if (it == m_spent_inserted.end()) return;
+        keys = std::move(it->second);
+        m_spent_inserted.erase(it);
+    }
 
-    if (it != mapSpentInserted.end()) {
-        std::vector<CSpentIndexKey> keys = (*it).second;
-        for (std::vector<CSpentIndexKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapSpent.erase(*mit);
-        }
-        mapSpentInserted.erase(it);
+    for (const COutPoint& key : keys) {
+        SpentShard& shard = m_spent_shards[SpentShardIndex(key)];
+        LOCK(shard.mutex);
+        shard.spent.erase(key);
     }
+}
+
+void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
+{
+    m_address_index.AddAddresses(entry, view);
+}
+
+bool CTxMemPool::getAddressIndex(const std::vector<std::pair<uint256, int> > &addresses, std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results) const
+{
+    m_address_index.GetAddressDeltas(addresses, results);
+    return true;
+}
+
+bool CTxMemPool::removeAddressIndex(const uint256 txhash)
+{
+    m_address_index.RemoveAddresses(txhash);
+    return true;
+}
+
+void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
+{
+    m_address_index.AddSpent(entry, view);
+}
 
+bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) const
+{
+    return m_address_index.GetSpent(key, value);
+}
+
+bool CTxMemPool::removeSpentIndex(const uint256 txhash)
+{
+    m_address_index.RemoveSpent(txhash);
     return true;
 }
 ///////////////////////////////////////////////////////
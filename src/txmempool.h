@@ -6,12 +6,14 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <array>
 #include <atomic>
 #include <map>
 #include <optional>
 #include <set>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -338,6 +340,54 @@ struct ancestor_score {};
 struct index_by_wtxid {};
 struct ancestor_score_or_gas_price {};
 
+/**
+ * Address and spent indexes of the mempool transactions, kept with -addrindex. They are locked apart
+ * from the mempool, in shards selected by the hash of the address or of the spent outpoint, so that
+ * the queries of many addresses do not contend with the acceptance of transactions on mempool.cs.
+ */
+class MempoolAddressIndex
+{
+public:
+    static constexpr size_t SHARDS{16};
+
+    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
+
+    void AddAddresses(const CTxMemPoolEntry& entry, const CCoinsViewCache& view);
+    void RemoveAddresses(const uint256& txhash);
+    /** Append the deltas of the (address hash, type) pairs @p addresses to @p results, locking each shard once */
+    void GetAddressDeltas(const std::vector<std::pair<uint256, int>>& addresses,
+                          std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>>& results) const;
+
+    void AddSpent(const CTxMemPoolEntry& entry, const CCoinsViewCache& view);
+    void RemoveSpent(const uint256& txhash);
+    bool GetSpent(const CSpentIndexKey& key, CSpentIndexValue& value) const;
+
+private:
+    struct AddressShard {
+        mutable Mutex mutex;
+        //! The deltas of each address hash, for all address types
+        std::unordered_map<uint256, addressDeltaMap, SaltedTxidHasher> deltas GUARDED_BY(mutex);
+    };
+
+    struct SpentShard {
+        mutable Mutex mutex;
+        std::unordered_map<COutPoint, CSpentIndexValue, SaltedOutpointHasher> spent GUARDED_BY(mutex);
+    };
+
+    size_t AddressShardIndex(const uint256& address_hash) const { return (m_address_hasher(address_hash) >> 32) % SHARDS; }
+    size_t SpentShardIndex(const COutPoint& outpoint) const { return (m_outpoint_hasher(outpoint) >> 32) % SHARDS; }
+
+    const SaltedTxidHasher m_address_hasher;
+    const SaltedOutpointHasher m_outpoint_hasher;
+    std::array<AddressShard, SHARDS> m_address_shards;
+    std::array<SpentShard, SHARDS> m_spent_shards;
+
+    //! The keys inserted for each transaction, to remove them with it
+    mutable Mutex m_inserted_mutex;
+    std::unordered_map<uint256, std::vector<CMempoolAddressDeltaKey>, SaltedTxidHasher> m_address_inserted GUARDED_BY(m_inserted_mutex);
+    std::unordered_map<uint256, std::vector<COutPoint>, SaltedTxidHasher> m_spent_inserted GUARDED_BY(m_inserted_mutex);
+};
+
 class CBlockPolicyEstimator;
 
 /**
@@ -559,17 +609,7 @@ private:
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
     //////////////////////////////////////////////////////////////// // qtum
-    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
-    addressDeltaMap mapAddress;
-
-    typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
-    addressDeltaMapInserted mapAddressInserted;
-
-    typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
-    mapSpentIndex mapSpent;
-
-    typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
-    mapSpentIndexInserted mapSpentInserted;
+    MempoolAddressIndex m_address_index;
     ////////////////////////////////////////////////////////////////
 
     void UpdateParent(txiter entry, txiter parent, bool add) EXCLUSIVE_LOCKS_REQUIRED(cs);
@@ -644,9 +684,10 @@ public:
     void addUnchecked(const CTxMemPoolEntry& entry, setEntries& setAncestors, bool validFeeEstimate = true) EXCLUSIVE_LOCKS_REQUIRED(cs, cs_main);
 
     ///////////////////////////////////////////////////////// // qtum
+    // The address and spent indexes have their own locks, the queries do not take cs
     void addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
-    bool getAddressIndex(std::vector<std::pair<uint256, int> > &addresses,
-                         std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results);
+    bool getAddressIndex(const std::vector<std::pair<uint256, int> > &addresses,
+                         std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results) const;
     bool removeAddressIndex(const uint256 txhash);
 
     void addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
@@ -8,6 +8,7 @@
 #include <logging.h>
 #include <policy/policy.h>
 
+#include <algorithm>
 #include <cassert>
 
 /** Expiration time for orphan transactions in seconds */
@@ -145,23 +146,49 @@ void TxOrphanage::LimitOrphans(unsigned int max_orphans)
     if (nEvicted > 0) LogPrint(BCLog::MEMPOOL, "orphanage overflow, removed %u tx\n", nEvicted);
 }
 
+std::set<TxOrphanage::OrphanMap::iterator, TxOrphanage::IteratorComparator> TxOrphanage::_GetChildren(const uint256& txid) const
+{
+    AssertLockHeld(m_mutex);
+
+    std::set<OrphanMap::iterator, IteratorComparator> children;
+    // The outpoints of txid are adjacent in the index, starting at its first output
+    for (auto it = m_outpoint_to_orphan_it.lower_bound(COutPoint(txid, 0));
+         it != m_outpoint_to_orphan_it.end() && it->first.hash == txid; ++it) {
+        children.insert(it->second.begin(), it->second.end());
+    }
+    return children;
+}
+
 void TxOrphanage::AddChildrenToWorkSet(const CTransaction& tx)
 {
     LOCK(m_mutex);
 
+    for (const auto& elem : _GetChildren(tx.GetHash())) {
+        // An orphan that still waits on another orphaned parent would fail on its missing inputs
+        const auto waits_on_orphan = [&](const CTxIn& txin) {
+            return txin.prevout.hash != tx.GetHash() && m_orphans.count(txin.prevout.hash);
+        };
+        const auto& vin = elem->second.tx->vin;
+        if (std::any_of(vin.begin(), vin.end(), waits_on_orphan)) continue;
+
+        // Get this source peer's work set, emplacing an empty set if it didn't exist
+        // (note: if this peer wasn't still connected, we would have removed the orphan tx already)
+        std::set<uint256>& orphan_work_set = m_peer_work_set.try_emplace(elem->second.fromPeer).first->second;
+        // Add this tx to the work set
+        orphan_work_set.insert(elem->first);
+    }
+}
 
-    for (unsigned int i = 0; i < tx.vout.size(); i++) {
-        const auto it_by_prev = m_outpoint_to_orphan_it.find(COutPoint(tx.GetHash(), i));
-        if (it_by_prev != m_outpoint_to_orphan_it.end()) {
-            for (const auto& elem : it_by_prev->second) {
-                // Get this source peer's work set, emplacing an empty set if it didn't exist
-                // (note: if this peer wasn't still connected, we would have removed the orphan tx already)
-                std::set<uint256>& orphan_work_set = m_peer_work_set.try_emplace(elem->second.fromPeer).first->second;
-                // Add this tx to the work set
-                orphan_work_set.insert(elem->first);
-            }
-        }
+std::vector<std::pair<CTransactionRef, NodeId>> TxOrphanage::GetChildren(const CTransaction& tx, NodeId peer) const
+{
+    LOCK(m_mutex);
+
+    std::vector<std::pair<CTransactionRef, NodeId>> children;
+    for (const auto& elem : _GetChildren(tx.GetHash())) {
+        children.emplace_back(elem->second.tx, elem->second.fromPeer);
     }
+    std::stable_partition(children.begin(), children.end(), [peer](const auto& child) { return child.second == peer; });
+    return children;
 }
 
 bool TxOrphanage::HaveTx(const GenTxid& gtxid) const
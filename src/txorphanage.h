@@ -12,6 +12,8 @@
 
 #include <map>
 #include <set>
+#include <utility>
+#include <vector>
 
 /** A class to track orphan transactions (failed on TX_MISSING_INPUTS)
  * Since we cannot distinguish orphans from bad transactions with
@@ -45,9 +47,15 @@ public:
     /** Limit the orphanage to the given maximum */
     void LimitOrphans(unsigned int max_orphans) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
 
-    /** Add any orphans that list a particular tx as a parent into the from peer's work set */
+    /** Add any orphans that list a particular tx as a parent into the from peer's work set. Orphans
+     *  with another parent that is still an orphan are left out, they are added once that parent
+     *  is accepted instead of failing on its missing inputs again. */
     void AddChildrenToWorkSet(const CTransaction& tx) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);;
 
+    /** Orphans that spend an output of a particular tx, with the peers that provided them. The
+     *  orphans provided by @p peer come first. */
+    std::vector<std::pair<CTransactionRef, NodeId>> GetChildren(const CTransaction& tx, NodeId peer) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
     /** Does this peer have any work to do? */
     bool HaveTxToReconsider(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);;
 
@@ -88,7 +96,9 @@ protected:
     };
 
     /** Index from the parents' COutPoint into the m_orphans. Used
-     *  to remove orphan transactions from the m_orphans */
+     *  to remove orphan transactions from the m_orphans. The outpoints
+     *  are ordered by txid, so the orphans spending any output of a tx
+     *  are found with a single lookup. */
     std::map<COutPoint, std::set<OrphanMap::iterator, IteratorComparator>> m_outpoint_to_orphan_it GUARDED_BY(m_mutex);
 
     /** Orphan transactions in vector for quick random eviction */
@@ -100,6 +110,9 @@ protected:
 
     /** Erase an orphan by txid */
     int _EraseTx(const uint256& txid) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    /** Orphans that spend an output of @p txid */
+    std::set<OrphanMap::iterator, IteratorComparator> _GetChildren(const uint256& txid) const EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
 };
 
 #endif // BITCOIN_TXORPHANAGE_H
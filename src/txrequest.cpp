@@ -9,11 +9,12 @@
 #include <primitives/transaction.h>
 #include <random.h>
 #include <uint256.h>
+#include <util/hasher.h>
 
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-
+#include <algorithm>
 #include <chrono>
+#include <map>
+#include <optional>
 #include <unordered_map>
 #include <utility>
 
@@ -24,7 +25,7 @@ namespace {
 /** The various states a (txhash,peer) pair can be in.
  *
  * Note that CANDIDATE is split up into 3 substates (DELAYED, BEST, READY), allowing more efficient implementation.
- * Also note that the sorting order of ByTxHashView relies on the specific order of values in this enum.
+ * Also note that the sorting order of the announcements of a txhash relies on the specific order of values in this enum.
  *
  * Expected behaviour is:
  *   - When first announced by a peer, the state is CANDIDATE_DELAYED until reqtime is reached.
@@ -53,26 +54,37 @@ enum class State : uint8_t {
 //! Type alias for sequence numbers.
 using SequenceNumber = uint64_t;
 
+//! Type alias for priorities.
+using Priority = uint64_t;
+
+//! Position of an announcement in the slab of announcements.
+using AnnId = uint32_t;
+
 /** An announcement. This is the data we track for each txid or wtxid that is announced to us by each peer. */
 struct Announcement {
     /** Txid or wtxid that was announced. */
-    const uint256 m_txhash;
+    uint256 m_txhash;
     /** For CANDIDATE_{DELAYED,BEST,READY} the reqtime; for REQUESTED the expiry. */
     std::chrono::microseconds m_time;
     /** What peer the request was from. */
-    const NodeId m_peer;
+    NodeId m_peer;
+    /** The priority of the announcement, cached as it only depends on the txhash, peer and preferredness. */
+    Priority m_priority;
     /** What sequence number this announcement has. */
-    const SequenceNumber m_sequence : 59;
+    SequenceNumber m_sequence : 58;
     /** Whether the request is preferred. */
-    const bool m_preferred : 1;
+    bool m_preferred : 1;
     /** Whether this is a wtxid request. */
-    const bool m_is_wtxid : 1;
+    bool m_is_wtxid : 1;
 
     /** What state this announcement is in.
      *  This is a uint8_t instead of a State to silence a GCC warning in versions prior to 8.4 and 9.3.
      *  See https://gcc.gnu.org/bugzilla/show_bug.cgi?id=61414 */
     uint8_t m_state : 3;
 
+    /** Whether the slot holds an announcement, the free slots are reused by the next announcements. */
+    bool m_alive : 1;
+
     /** Convert m_state to a State enum. */
     State GetState() const { return static_cast<State>(m_state); }
 
@@ -99,14 +111,12 @@ struct Announcement {
 
     /** Construct a new announcement from scratch, initially in CANDIDATE_DELAYED state. */
     Announcement(const GenTxid& gtxid, NodeId peer, bool preferred, std::chrono::microseconds reqtime,
-        SequenceNumber sequence) :
-        m_txhash(gtxid.GetHash()), m_time(reqtime), m_peer(peer), m_sequence(sequence), m_preferred(preferred),
-        m_is_wtxid(gtxid.IsWtxid()), m_state(static_cast<uint8_t>(State::CANDIDATE_DELAYED)) {}
+        SequenceNumber sequence, Priority priority) :
+        m_txhash(gtxid.GetHash()), m_time(reqtime), m_peer(peer), m_priority(priority), m_sequence(sequence),
+        m_preferred(preferred), m_is_wtxid(gtxid.IsWtxid()), m_state(static_cast<uint8_t>(State::CANDIDATE_DELAYED)),
+        m_alive(true) {}
 };
 
-//! Type alias for priorities.
-using Priority = uint64_t;
-
 /** A functor with embedded salt that computes priority of an announcement.
  *
  * Higher priorities are selected first.
@@ -123,60 +133,27 @@ public:
         uint64_t low_bits = CSipHasher(m_k0, m_k1).Write(txhash.begin(), txhash.size()).Write(peer).Finalize() >> 1;
         return low_bits | uint64_t{preferred} << 63;
     }
-
-    Priority operator()(const Announcement& ann) const
-    {
-        return operator()(ann.m_txhash, ann.m_peer, ann.m_preferred);
-    }
 };
 
-// Definitions for the 3 indexes used in the main data structure.
+// The announcements live in a slab (a vector with a free list), and the structures below refer to them by their
+// AnnId:
 //
-// Each index has a By* type to identify it, a By*View data type to represent the view of announcement it is sorted
-// by, and an By*ViewExtractor type to convert an announcement into the By*View type.
-// See https://www.boost.org/doc/libs/1_58_0/libs/multi_index/doc/reference/key_extraction.html#key_extractors
-// for more information about the key extraction concept.
-
-// The ByPeer index is sorted by (peer, state == CANDIDATE_BEST, txhash)
+// * Per txhash, a vector of its announcements sorted by (state, priority), with priority == 0 whenever
+//   state != CANDIDATE_READY. It is used for:
+//   - Deleting all announcements with a given txhash in ForgetTxHash.
+//   - Finding the best CANDIDATE_READY to convert to CANDIDATE_BEST, when no other CANDIDATE_READY or REQUESTED
+//     announcement exists for that txhash.
+//   - Determining when no more non-COMPLETED announcements for a given txhash exist, so the COMPLETED ones can be
+//     deleted.
+//   A txhash is announced by a few peers at most, so keeping the vector sorted costs a short memmove.
 //
-// Uses:
-// * Looking up existing announcements by peer/txhash, by checking both (peer, false, txhash) and
-//   (peer, true, txhash).
-// * Finding all CANDIDATE_BEST announcements for a given peer in GetRequestable.
-struct ByPeer {};
-using ByPeerView = std::tuple<NodeId, bool, const uint256&>;
-struct ByPeerViewExtractor
-{
-    using result_type = ByPeerView;
-    result_type operator()(const Announcement& ann) const
-    {
-        return ByPeerView{ann.m_peer, ann.GetState() == State::CANDIDATE_BEST, ann.m_txhash};
-    }
-};
-
-// The ByTxHash index is sorted by (txhash, state, priority).
+// * Per peer, a map from txhash to its announcement, and the vector of its CANDIDATE_BEST announcements sorted by
+//   sequence number, which GetRequestable returns as is.
 //
-// Note: priority == 0 whenever state != CANDIDATE_READY.
-//
-// Uses:
-// * Deleting all announcements with a given txhash in ForgetTxHash.
-// * Finding the best CANDIDATE_READY to convert to CANDIDATE_BEST, when no other CANDIDATE_READY or REQUESTED
-//   announcement exists for that txhash.
-// * Determining when no more non-COMPLETED announcements for a given txhash exist, so the COMPLETED ones can be
-//   deleted.
-struct ByTxHash {};
-using ByTxHashView = std::tuple<const uint256&, State, Priority>;
-class ByTxHashViewExtractor {
-    const PriorityComputer& m_computer;
-public:
-    explicit ByTxHashViewExtractor(const PriorityComputer& computer) : m_computer(computer) {}
-    using result_type = ByTxHashView;
-    result_type operator()(const Announcement& ann) const
-    {
-        const Priority prio = (ann.GetState() == State::CANDIDATE_READY) ? m_computer(ann) : 0;
-        return ByTxHashView{ann.m_txhash, ann.GetState(), prio};
-    }
-};
+// * Two heaps of (time, announcement) events: the earliest reqtime or expiry of the CANDIDATE_DELAYED and REQUESTED
+//   announcements, and the latest reqtime of the CANDIDATE_READY and CANDIDATE_BEST ones (for when the clock time
+//   went backwards). The entries are not removed when their announcement changes, they are skipped when they no
+//   longer match it.
 
 enum class WaitState {
     //! Used for announcements that need efficient testing of "is their timestamp in the future?".
@@ -194,45 +171,25 @@ WaitState GetWaitState(const Announcement& ann)
     return WaitState::NO_EVENT;
 }
 
-// The ByTime index is sorted by (wait_state, time).
-//
-// All announcements with a timestamp in the future can be found by iterating the index forward from the beginning.
-// All announcements with a timestamp in the past can be found by iterating the index backwards from the end.
-//
-// Uses:
-// * Finding CANDIDATE_DELAYED announcements whose reqtime has passed, and REQUESTED announcements whose expiry has
-//   passed.
-// * Finding CANDIDATE_READY/BEST announcements whose reqtime is in the future (when the clock time went backwards).
-struct ByTime {};
-using ByTimeView = std::pair<WaitState, std::chrono::microseconds>;
-struct ByTimeViewExtractor
-{
-    using result_type = ByTimeView;
-    result_type operator()(const Announcement& ann) const
-    {
-        return ByTimeView{GetWaitState(ann), ann.m_time};
-    }
+/** An entry of the time heaps, current as long as its announcement has the same sequence number and time. */
+struct TimeEvent {
+    std::chrono::microseconds m_time;
+    SequenceNumber m_sequence;
+    AnnId m_id;
 };
 
-/** Data type for the main data structure (Announcement objects with ByPeer/ByTxHash/ByTime indexes). */
-using Index = boost::multi_index_container<
-    Announcement,
-    boost::multi_index::indexed_by<
-        boost::multi_index::ordered_unique<boost::multi_index::tag<ByPeer>, ByPeerViewExtractor>,
-        boost::multi_index::ordered_non_unique<boost::multi_index::tag<ByTxHash>, ByTxHashViewExtractor>,
-        boost::multi_index::ordered_non_unique<boost::multi_index::tag<ByTime>, ByTimeViewExtractor>
-    >
->;
-
-/** Helper type to simplify syntax of iterator types. */
-template<typename Tag>
-using Iter = typename Index::index<Tag>::type::iterator;
-
-/** Per-peer statistics object. */
+/** The announcements of a txhash, sorted by (state, priority of the CANDIDATE_READY ones). */
+using TxHashAnns = std::vector<AnnId>;
+
+/** Per-peer statistics and announcements. */
 struct PeerInfo {
     size_t m_total = 0; //!< Total number of announcements for this peer.
     size_t m_completed = 0; //!< Number of COMPLETED announcements for this peer.
     size_t m_requested = 0; //!< Number of REQUESTED announcements for this peer.
+    //! The announcements of this peer by txhash.
+    std::unordered_map<uint256, AnnId, SaltedTxidHasher> m_anns;
+    //! The CANDIDATE_BEST announcements of this peer, sorted by sequence number.
+    std::vector<std::pair<SequenceNumber, AnnId>> m_best;
 };
 
 /** Per-txhash statistics object. Only used for sanity checking. */
@@ -261,11 +218,12 @@ bool operator==(const PeerInfo& a, const PeerInfo& b)
            std::tie(b.m_total, b.m_completed, b.m_requested);
 };
 
-/** (Re)compute the PeerInfo map from the index. Only used for sanity checking. */
-std::unordered_map<NodeId, PeerInfo> RecomputePeerInfo(const Index& index)
+/** (Re)compute the PeerInfo statistics from the announcements. Only used for sanity checking. */
+std::unordered_map<NodeId, PeerInfo> RecomputePeerInfo(const std::vector<Announcement>& anns)
 {
     std::unordered_map<NodeId, PeerInfo> ret;
-    for (const Announcement& ann : index) {
+    for (const Announcement& ann : anns) {
+        if (!ann.m_alive) continue;
         PeerInfo& info = ret[ann.m_peer];
         ++info.m_total;
         info.m_requested += (ann.GetState() == State::REQUESTED);
@@ -275,10 +233,11 @@ std::unordered_map<NodeId, PeerInfo> RecomputePeerInfo(const Index& index)
 }
 
 /** Compute the TxHashInfo map. Only used for sanity checking. */
-std::map<uint256, TxHashInfo> ComputeTxHashInfo(const Index& index, const PriorityComputer& computer)
+std::map<uint256, TxHashInfo> ComputeTxHashInfo(const std::vector<Announcement>& anns, const PriorityComputer& computer)
 {
     std::map<uint256, TxHashInfo> ret;
-    for (const Announcement& ann : index) {
+    for (const Announcement& ann : anns) {
+        if (!ann.m_alive) continue;
         TxHashInfo& info = ret[ann.m_txhash];
         // Classify how many announcements of each state we have for this txhash.
         info.m_candidate_delayed += (ann.GetState() == State::CANDIDATE_DELAYED);
@@ -286,11 +245,12 @@ std::map<uint256, TxHashInfo> ComputeTxHashInfo(const Index& index, const Priori
         info.m_candidate_best += (ann.GetState() == State::CANDIDATE_BEST);
         info.m_requested += (ann.GetState() == State::REQUESTED);
         // And track the priority of the best CANDIDATE_READY/CANDIDATE_BEST announcements.
+        const Priority priority = computer(ann.m_txhash, ann.m_peer, ann.m_preferred);
         if (ann.GetState() == State::CANDIDATE_BEST) {
-            info.m_priority_candidate_best = computer(ann);
+            info.m_priority_candidate_best = priority;
         }
         if (ann.GetState() == State::CANDIDATE_READY) {
-            info.m_priority_best_candidate_ready = std::max(info.m_priority_best_candidate_ready, computer(ann));
+            info.m_priority_best_candidate_ready = std::max(info.m_priority_best_candidate_ready, priority);
         }
         // Also keep track of which peers this txhash has an announcement for (so we can detect duplicates).
         info.m_peers.push_back(ann.m_peer);
@@ -314,21 +274,75 @@ class TxRequestTracker::Impl {
     //! This tracker's priority computer.
     const PriorityComputer m_computer;
 
-    //! This tracker's main data structure. See SanityCheck() for the invariants that apply to it.
-    Index m_index;
+    //! The slab of announcements. See SanityCheck() for the invariants that apply to it and the structures below.
+    std::vector<Announcement> m_anns;
+
+    //! The free slots of m_anns.
+    std::vector<AnnId> m_free;
+
+    //! Number of announcements in m_anns.
+    size_t m_size{0};
 
-    //! Map with this tracker's per-peer statistics.
+    //! The announcements of each txhash.
+    std::unordered_map<uint256, TxHashAnns, SaltedTxidHasher> m_txhash_anns;
+
+    //! Map with this tracker's per-peer statistics and announcements.
     std::unordered_map<NodeId, PeerInfo> m_peerinfo;
 
+    //! Min-heap of the times of the CANDIDATE_DELAYED and REQUESTED announcements.
+    std::vector<TimeEvent> m_future_events;
+
+    //! Max-heap of the times of the CANDIDATE_READY and CANDIDATE_BEST announcements.
+    std::vector<TimeEvent> m_past_events;
+
+    static bool LaterEvent(const TimeEvent& a, const TimeEvent& b) { return a.m_time > b.m_time; }
+    static bool EarlierEvent(const TimeEvent& a, const TimeEvent& b) { return a.m_time < b.m_time; }
+
+    /** Sort key of an announcement within the announcements of its txhash. */
+    std::pair<State, Priority> TxHashKey(AnnId id) const
+    {
+        const Announcement& ann = m_anns[id];
+        return {ann.GetState(), ann.GetState() == State::CANDIDATE_READY ? ann.m_priority : 0};
+    }
+
 public:
     void SanityCheck() const
     {
-        // Recompute m_peerdata from m_index. This verifies the data in it as it should just be caching statistics
-        // on m_index. It also verifies the invariant that no PeerInfo announcements with m_total==0 exist.
-        assert(m_peerinfo == RecomputePeerInfo(m_index));
+        // Recompute m_peerdata from m_anns. This verifies the data in it as it should just be caching statistics
+        // on m_anns. It also verifies the invariant that no PeerInfo announcements with m_total==0 exist.
+        assert(m_peerinfo == RecomputePeerInfo(m_anns));
+        assert(m_size + m_free.size() == m_anns.size());
+
+        // Verify that the per-peer and per-txhash structures hold exactly the announcements.
+        size_t total{0};
+        for (const auto& [peer, info] : m_peerinfo) {
+            assert(info.m_anns.size() == info.m_total);
+            size_t best{0};
+            for (const auto& [txhash, id] : info.m_anns) {
+                assert(m_anns[id].m_alive && m_anns[id].m_peer == peer && m_anns[id].m_txhash == txhash);
+                best += m_anns[id].GetState() == State::CANDIDATE_BEST;
+            }
+            assert(info.m_best.size() == best);
+            assert(std::is_sorted(info.m_best.begin(), info.m_best.end()));
+            for (const auto& [sequence, id] : info.m_best) {
+                assert(m_anns[id].m_sequence == sequence && m_anns[id].GetState() == State::CANDIDATE_BEST);
+            }
+            total += info.m_total;
+        }
+        assert(total == m_size);
+        total = 0;
+        for (const auto& [txhash, anns] : m_txhash_anns) {
+            assert(!anns.empty());
+            for (size_t i = 0; i < anns.size(); ++i) {
+                assert(m_anns[anns[i]].m_alive && m_anns[anns[i]].m_txhash == txhash);
+                if (i > 0) assert(TxHashKey(anns[i - 1]) <= TxHashKey(anns[i]));
+            }
+            total += anns.size();
+        }
+        assert(total == m_size);
 
-        // Calculate per-txhash statistics from m_index, and validate invariants.
-        for (auto& item : ComputeTxHashInfo(m_index, m_computer)) {
+        // Calculate per-txhash statistics from m_anns, and validate invariants.
+        for (auto& item : ComputeTxHashInfo(m_anns, m_computer)) {
             TxHashInfo& info = item.second;
 
             // Cannot have only COMPLETED peer (txhash should have been forgotten already)
@@ -357,7 +371,8 @@ public:
 
     void PostGetRequestableSanityCheck(std::chrono::microseconds now) const
     {
-        for (const Announcement& ann : m_index) {
+        for (const Announcement& ann : m_anns) {
+            if (!ann.m_alive) continue;
             if (ann.IsWaiting()) {
                 // REQUESTED and CANDIDATE_DELAYED must have a time in the future (they should have been converted
                 // to COMPLETED/CANDIDATE_READY respectively).
@@ -371,116 +386,184 @@ public:
     }
 
 private:
-    //! Wrapper around Index::...::erase that keeps m_peerinfo up to date.
-    template<typename Tag>
-    Iter<Tag> Erase(Iter<Tag> it)
+    //! Add the time of an announcement to the heap of its wait state, if any.
+    void ScheduleEvent(AnnId id)
     {
-        auto peerit = m_peerinfo.find(it->m_peer);
-        peerit->second.m_completed -= it->GetState() == State::COMPLETED;
-        peerit->second.m_requested -= it->GetState() == State::REQUESTED;
-        if (--peerit->second.m_total == 0) m_peerinfo.erase(peerit);
-        return m_index.get<Tag>().erase(it);
+        const Announcement& ann = m_anns[id];
+        const WaitState wait_state = GetWaitState(ann);
+        if (wait_state == WaitState::NO_EVENT) return;
+        auto& events = wait_state == WaitState::FUTURE_EVENT ? m_future_events : m_past_events;
+        const auto compare = wait_state == WaitState::FUTURE_EVENT ? LaterEvent : EarlierEvent;
+        // The outdated entries of the past events are only dropped when the clock goes backwards, drop them here
+        // once they outnumber the announcements.
+        if (events.size() >= 2 * m_size + 64) {
+            events.erase(std::remove_if(events.begin(), events.end(), [&](const TimeEvent& event) {
+                return !IsCurrent(event, wait_state);
+            }), events.end());
+            std::make_heap(events.begin(), events.end(), compare);
+        }
+        events.push_back(TimeEvent{ann.m_time, ann.m_sequence, id});
+        std::push_heap(events.begin(), events.end(), compare);
     }
 
-    //! Wrapper around Index::...::modify that keeps m_peerinfo up to date.
-    template<typename Tag, typename Modifier>
-    void Modify(Iter<Tag> it, Modifier modifier)
+    //! Whether a heap entry still describes its announcement.
+    bool IsCurrent(const TimeEvent& event, WaitState wait_state) const
     {
-        auto peerit = m_peerinfo.find(it->m_peer);
-        peerit->second.m_completed -= it->GetState() == State::COMPLETED;
-        peerit->second.m_requested -= it->GetState() == State::REQUESTED;
-        m_index.get<Tag>().modify(it, std::move(modifier));
-        peerit->second.m_completed += it->GetState() == State::COMPLETED;
-        peerit->second.m_requested += it->GetState() == State::REQUESTED;
+        const Announcement& ann = m_anns[event.m_id];
+        return ann.m_alive && ann.m_sequence == event.m_sequence && ann.m_time == event.m_time &&
+               GetWaitState(ann) == wait_state;
+    }
+
+    //! Position of an announcement in the announcements of its txhash.
+    TxHashAnns::iterator Find(TxHashAnns& anns, AnnId id)
+    {
+        const auto key = TxHashKey(id);
+        auto it = std::lower_bound(anns.begin(), anns.end(), key, [&](AnnId a, const auto& k) { return TxHashKey(a) < k; });
+        while (*it != id) ++it;
+        return it;
+    }
+
+    //! Insert an announcement in the announcements of its txhash, after those with the same sort key.
+    void Insert(TxHashAnns& anns, AnnId id)
+    {
+        const auto key = TxHashKey(id);
+        anns.insert(std::upper_bound(anns.begin(), anns.end(), key, [&](const auto& k, AnnId a) { return k < TxHashKey(a); }), id);
+    }
+
+    //! Change the state (and time) of an announcement, keeping the txhash, peer and time structures up to date.
+    void Modify(TxHashAnns& anns, AnnId id, State state, std::chrono::microseconds time)
+    {
+        Announcement& ann = m_anns[id];
+        PeerInfo& peerinfo = m_peerinfo.find(ann.m_peer)->second;
+        const State old_state = ann.GetState();
+        const WaitState old_wait_state = GetWaitState(ann);
+        const bool time_changed = ann.m_time != time;
+
+        anns.erase(Find(anns, id));
+        peerinfo.m_completed -= old_state == State::COMPLETED;
+        peerinfo.m_requested -= old_state == State::REQUESTED;
+        if (old_state == State::CANDIDATE_BEST) {
+            peerinfo.m_best.erase(std::lower_bound(peerinfo.m_best.begin(), peerinfo.m_best.end(), std::make_pair(SequenceNumber{ann.m_sequence}, id)));
+        }
+
+        ann.SetState(state);
+        ann.m_time = time;
+
+        Insert(anns, id);
+        peerinfo.m_completed += state == State::COMPLETED;
+        peerinfo.m_requested += state == State::REQUESTED;
+        if (state == State::CANDIDATE_BEST) {
+            const auto entry = std::make_pair(SequenceNumber{ann.m_sequence}, id);
+            peerinfo.m_best.insert(std::lower_bound(peerinfo.m_best.begin(), peerinfo.m_best.end(), entry), entry);
+        }
+        if (time_changed || GetWaitState(ann) != old_wait_state) ScheduleEvent(id);
+    }
+
+    void Modify(TxHashAnns& anns, AnnId id, State state) { Modify(anns, id, state, m_anns[id].m_time); }
+
+    //! Delete an announcement, except from the announcements of its txhash which the caller updates.
+    void Erase(AnnId id)
+    {
+        Announcement& ann = m_anns[id];
+        auto peerit = m_peerinfo.find(ann.m_peer);
+        PeerInfo& peerinfo = peerit->second;
+        peerinfo.m_completed -= ann.GetState() == State::COMPLETED;
+        peerinfo.m_requested -= ann.GetState() == State::REQUESTED;
+        if (ann.GetState() == State::CANDIDATE_BEST) {
+            peerinfo.m_best.erase(std::lower_bound(peerinfo.m_best.begin(), peerinfo.m_best.end(), std::make_pair(SequenceNumber{ann.m_sequence}, id)));
+        }
+        peerinfo.m_anns.erase(ann.m_txhash);
+        if (--peerinfo.m_total == 0) m_peerinfo.erase(peerit);
+        ann.m_alive = false;
+        m_free.push_back(id);
+        --m_size;
+    }
+
+    //! The best CANDIDATE_READY announcement of a txhash, if any.
+    std::optional<AnnId> BestReady(const TxHashAnns& anns) const
+    {
+        // The CANDIDATE_READY announcements are sorted by priority and followed by the CANDIDATE_BEST, REQUESTED
+        // and COMPLETED ones.
+        auto it = std::partition_point(anns.begin(), anns.end(), [&](AnnId a) { return m_anns[a].GetState() <= State::CANDIDATE_READY; });
+        if (it == anns.begin() || m_anns[*std::prev(it)].GetState() != State::CANDIDATE_READY) return std::nullopt;
+        return *std::prev(it);
+    }
+
+    //! The CANDIDATE_BEST or REQUESTED announcement of a txhash, if any.
+    std::optional<AnnId> Selected(const TxHashAnns& anns) const
+    {
+        auto it = std::partition_point(anns.begin(), anns.end(), [&](AnnId a) { return m_anns[a].GetState() < State::CANDIDATE_BEST; });
+        if (it == anns.end() || !m_anns[*it].IsSelected()) return std::nullopt;
+        return *it;
     }
 
     //! Convert a CANDIDATE_DELAYED announcement into a CANDIDATE_READY. If this makes it the new best
     //! CANDIDATE_READY (and no REQUESTED exists) and better than the CANDIDATE_BEST (if any), it becomes the new
     //! CANDIDATE_BEST.
-    void PromoteCandidateReady(Iter<ByTxHash> it)
+    void PromoteCandidateReady(TxHashAnns& anns, AnnId id)
     {
-        assert(it != m_index.get<ByTxHash>().end());
-        assert(it->GetState() == State::CANDIDATE_DELAYED);
+        assert(m_anns[id].GetState() == State::CANDIDATE_DELAYED);
         // Convert CANDIDATE_DELAYED to CANDIDATE_READY first.
-        Modify<ByTxHash>(it, [](Announcement& ann){ ann.SetState(State::CANDIDATE_READY); });
-        // The following code relies on the fact that the ByTxHash is sorted by txhash, and then by state (first
-        // _DELAYED, then _READY, then _BEST/REQUESTED). Within the _READY announcements, the best one (highest
-        // priority) comes last. Thus, if an existing _BEST exists for the same txhash that this announcement may
-        // be preferred over, it must immediately follow the newly created _READY.
-        auto it_next = std::next(it);
-        if (it_next == m_index.get<ByTxHash>().end() || it_next->m_txhash != it->m_txhash ||
-            it_next->GetState() == State::COMPLETED) {
-            // This is the new best CANDIDATE_READY, and there is no IsSelected() announcement for this txhash
-            // already.
-            Modify<ByTxHash>(it, [](Announcement& ann){ ann.SetState(State::CANDIDATE_BEST); });
-        } else if (it_next->GetState() == State::CANDIDATE_BEST) {
-            Priority priority_old = m_computer(*it_next);
-            Priority priority_new = m_computer(*it);
-            if (priority_new > priority_old) {
-                // There is a CANDIDATE_BEST announcement already, but this one is better.
-                Modify<ByTxHash>(it_next, [](Announcement& ann){ ann.SetState(State::CANDIDATE_READY); });
-                Modify<ByTxHash>(it, [](Announcement& ann){ ann.SetState(State::CANDIDATE_BEST); });
-            }
+        Modify(anns, id, State::CANDIDATE_READY);
+        const std::optional<AnnId> selected = Selected(anns);
+        if (!selected) {
+            // There is no IsSelected() announcement for this txhash, so there were no other CANDIDATE_READY
+            // announcements either: this is the best one.
+            Modify(anns, id, State::CANDIDATE_BEST);
+        } else if (m_anns[*selected].GetState() == State::CANDIDATE_BEST &&
+                   m_anns[id].m_priority > m_anns[*selected].m_priority) {
+            // There is a CANDIDATE_BEST announcement already, but this one is better.
+            Modify(anns, *selected, State::CANDIDATE_READY);
+            Modify(anns, id, State::CANDIDATE_BEST);
         }
     }
 
     //! Change the state of an announcement to something non-IsSelected(). If it was IsSelected(), the next best
     //! announcement will be marked CANDIDATE_BEST.
-    void ChangeAndReselect(Iter<ByTxHash> it, State new_state)
+    void ChangeAndReselect(TxHashAnns& anns, AnnId id, State new_state)
     {
         assert(new_state == State::COMPLETED || new_state == State::CANDIDATE_DELAYED);
-        assert(it != m_index.get<ByTxHash>().end());
-        if (it->IsSelected() && it != m_index.get<ByTxHash>().begin()) {
-            auto it_prev = std::prev(it);
-            // The next best CANDIDATE_READY, if any, immediately precedes the REQUESTED or CANDIDATE_BEST
-            // announcement in the ByTxHash index.
-            if (it_prev->m_txhash == it->m_txhash && it_prev->GetState() == State::CANDIDATE_READY) {
-                // If one such CANDIDATE_READY exists (for this txhash), convert it to CANDIDATE_BEST.
-                Modify<ByTxHash>(it_prev, [](Announcement& ann){ ann.SetState(State::CANDIDATE_BEST); });
-            }
+        if (m_anns[id].IsSelected()) {
+            // If a CANDIDATE_READY exists (for this txhash), convert the best one to CANDIDATE_BEST.
+            if (const std::optional<AnnId> ready = BestReady(anns)) Modify(anns, *ready, State::CANDIDATE_BEST);
         }
-        Modify<ByTxHash>(it, [new_state](Announcement& ann){ ann.SetState(new_state); });
+        Modify(anns, id, new_state);
     }
 
-    //! Check if 'it' is the only announcement for a given txhash that isn't COMPLETED.
-    bool IsOnlyNonCompleted(Iter<ByTxHash> it)
+    //! Check if 'id' is the only announcement for a given txhash that isn't COMPLETED.
+    bool IsOnlyNonCompleted(const TxHashAnns& anns, AnnId id) const
     {
-        assert(it != m_index.get<ByTxHash>().end());
-        assert(it->GetState() != State::COMPLETED); // Not allowed to call this on COMPLETED announcements.
-
-        // This announcement has a predecessor that belongs to the same txhash. Due to ordering, and the
-        // fact that 'it' is not COMPLETED, its predecessor cannot be COMPLETED here.
-        if (it != m_index.get<ByTxHash>().begin() && std::prev(it)->m_txhash == it->m_txhash) return false;
-
-        // This announcement has a successor that belongs to the same txhash, and is not COMPLETED.
-        if (std::next(it) != m_index.get<ByTxHash>().end() && std::next(it)->m_txhash == it->m_txhash &&
-            std::next(it)->GetState() != State::COMPLETED) return false;
+        assert(m_anns[id].GetState() != State::COMPLETED); // Not allowed to call this on COMPLETED announcements.
+        // The COMPLETED announcements come last, so 'id' is the only other one iff it comes first and the second
+        // one, if any, is COMPLETED.
+        return anns.size() == 1 || m_anns[anns[1]].GetState() == State::COMPLETED;
+    }
 
-        return true;
+    //! Delete all announcements for a txhash.
+    void EraseTxHash(std::unordered_map<uint256, TxHashAnns, SaltedTxidHasher>::iterator it)
+    {
+        for (AnnId id : it->second) Erase(id);
+        m_txhash_anns.erase(it);
     }
 
     /** Convert any announcement to a COMPLETED one. If there are no non-COMPLETED announcements left for this
      *  txhash, they are deleted. If this was a REQUESTED announcement, and there are other CANDIDATEs left, the
      *  best one is made CANDIDATE_BEST. Returns whether the announcement still exists. */
-    bool MakeCompleted(Iter<ByTxHash> it)
+    bool MakeCompleted(AnnId id)
     {
-        assert(it != m_index.get<ByTxHash>().end());
-
         // Nothing to be done if it's already COMPLETED.
-        if (it->GetState() == State::COMPLETED) return true;
+        if (m_anns[id].GetState() == State::COMPLETED) return true;
 
-        if (IsOnlyNonCompleted(it)) {
+        auto txhashit = m_txhash_anns.find(m_anns[id].m_txhash);
+        if (IsOnlyNonCompleted(txhashit->second, id)) {
             // This is the last non-COMPLETED announcement for this txhash. Delete all.
-            uint256 txhash = it->m_txhash;
-            do {
-                it = Erase<ByTxHash>(it);
-            } while (it != m_index.get<ByTxHash>().end() && it->m_txhash == txhash);
+            EraseTxHash(txhashit);
             return false;
         }
 
         // Mark the announcement COMPLETED, and select the next best announcement (the first CANDIDATE_READY) if
         // needed.
-        ChangeAndReselect(it, State::COMPLETED);
+        ChangeAndReselect(txhashit->second, id, State::COMPLETED);
 
         return true;
     }
@@ -495,100 +578,93 @@ private:
 
         // Iterate over all CANDIDATE_DELAYED and REQUESTED from old to new, as long as they're in the past,
         // and convert them to CANDIDATE_READY and COMPLETED respectively.
-        while (!m_index.empty()) {
-            auto it = m_index.get<ByTime>().begin();
-            if (it->GetState() == State::CANDIDATE_DELAYED && it->m_time <= now) {
-                PromoteCandidateReady(m_index.project<ByTxHash>(it));
-            } else if (it->GetState() == State::REQUESTED && it->m_time <= now) {
-                if (expired) expired->emplace_back(it->m_peer, ToGenTxid(*it));
-                MakeCompleted(m_index.project<ByTxHash>(it));
+        while (!m_future_events.empty() && m_future_events.front().m_time <= now) {
+            const TimeEvent event = m_future_events.front();
+            std::pop_heap(m_future_events.begin(), m_future_events.end(), LaterEvent);
+            m_future_events.pop_back();
+            if (!IsCurrent(event, WaitState::FUTURE_EVENT)) continue;
+            const Announcement& ann = m_anns[event.m_id];
+            if (ann.GetState() == State::CANDIDATE_DELAYED) {
+                PromoteCandidateReady(m_txhash_anns.find(ann.m_txhash)->second, event.m_id);
             } else {
-                break;
+                if (expired) expired->emplace_back(ann.m_peer, ToGenTxid(ann));
+                MakeCompleted(event.m_id);
             }
         }
 
-        while (!m_index.empty()) {
-            // If time went backwards, we may need to demote CANDIDATE_BEST and CANDIDATE_READY announcements back
-            // to CANDIDATE_DELAYED. This is an unusual edge case, and unlikely to matter in production. However,
-            // it makes it much easier to specify and test TxRequestTracker::Impl's behaviour.
-            auto it = std::prev(m_index.get<ByTime>().end());
-            if (it->IsSelectable() && it->m_time > now) {
-                ChangeAndReselect(m_index.project<ByTxHash>(it), State::CANDIDATE_DELAYED);
-            } else {
-                break;
-            }
+        // If time went backwards, we may need to demote CANDIDATE_BEST and CANDIDATE_READY announcements back
+        // to CANDIDATE_DELAYED. This is an unusual edge case, and unlikely to matter in production. However,
+        // it makes it much easier to specify and test TxRequestTracker::Impl's behaviour.
+        while (!m_past_events.empty() && m_past_events.front().m_time > now) {
+            const TimeEvent event = m_past_events.front();
+            std::pop_heap(m_past_events.begin(), m_past_events.end(), EarlierEvent);
+            m_past_events.pop_back();
+            if (!IsCurrent(event, WaitState::PAST_EVENT)) continue;
+            ChangeAndReselect(m_txhash_anns.find(m_anns[event.m_id].m_txhash)->second, event.m_id, State::CANDIDATE_DELAYED);
         }
     }
 
 public:
     explicit Impl(bool deterministic) :
-        m_computer(deterministic),
-        // Explicitly initialize m_index as we need to pass a reference to m_computer to ByTxHashViewExtractor.
-        m_index(boost::make_tuple(
-            boost::make_tuple(ByPeerViewExtractor(), std::less<ByPeerView>()),
-            boost::make_tuple(ByTxHashViewExtractor(m_computer), std::less<ByTxHashView>()),
-            boost::make_tuple(ByTimeViewExtractor(), std::less<ByTimeView>())
-        )) {}
-
-    // Disable copying and assigning (a default copy won't work due the stateful ByTxHashViewExtractor).
+        m_computer(deterministic) {}
+
+    // Disable copying and assigning.
     Impl(const Impl&) = delete;
     Impl& operator=(const Impl&) = delete;
 
     void DisconnectedPeer(NodeId peer)
     {
-        auto& index = m_index.get<ByPeer>();
-        auto it = index.lower_bound(ByPeerView{peer, false, uint256::ZERO});
-        while (it != index.end() && it->m_peer == peer) {
-            // Check what to continue with after this iteration. 'it' will be deleted in what follows, so we need to
-            // decide what to continue with afterwards. There are a number of cases to consider:
-            // - std::next(it) is end() or belongs to a different peer. In that case, this is the last iteration
-            //   of the loop (denote this by setting it_next to end()).
-            // - 'it' is not the only non-COMPLETED announcement for its txhash. This means it will be deleted, but
-            //   no other Announcement objects will be modified. Continue with std::next(it) if it belongs to the
-            //   same peer, but decide this ahead of time (as 'it' may change position in what follows).
-            // - 'it' is the only non-COMPLETED announcement for its txhash. This means it will be deleted along
-            //   with all other announcements for the same txhash - which may include std::next(it). However, other
-            //   than 'it', no announcements for the same peer can be affected (due to (peer, txhash) uniqueness).
-            //   In other words, the situation where std::next(it) is deleted can only occur if std::next(it)
-            //   belongs to a different peer but the same txhash as 'it'. This is covered by the first bulletpoint
-            //   already, and we'll have set it_next to end().
-            auto it_next = (std::next(it) == index.end() || std::next(it)->m_peer != peer) ? index.end() :
-                std::next(it);
+        auto it = m_peerinfo.find(peer);
+        if (it == m_peerinfo.end()) return;
+        // Deleting an announcement of the peer deletes at most the other announcements of the same txhash, which
+        // belong to other peers, so the announcements collected here stay valid throughout the loop.
+        std::vector<AnnId> ids;
+        ids.reserve(it->second.m_anns.size());
+        for (const auto& entry : it->second.m_anns) ids.push_back(entry.second);
+        for (AnnId id : ids) {
             // If the announcement isn't already COMPLETED, first make it COMPLETED (which will mark other
             // CANDIDATEs as CANDIDATE_BEST, or delete all of a txhash's announcements if no non-COMPLETED ones are
             // left).
-            if (MakeCompleted(m_index.project<ByTxHash>(it))) {
-                // Then actually delete the announcement (unless it was already deleted by MakeCompleted).
-                Erase<ByPeer>(it);
+            if (MakeCompleted(id)) {
+                // Then actually delete the announcement (unless it was already deleted by MakeCompleted). Other
+                // non-COMPLETED announcements remain for its txhash.
+                TxHashAnns& anns = m_txhash_anns.find(m_anns[id].m_txhash)->second;
+                anns.erase(Find(anns, id));
+                Erase(id);
             }
-            it = it_next;
         }
     }
 
     void ForgetTxHash(const uint256& txhash)
     {
-        auto it = m_index.get<ByTxHash>().lower_bound(ByTxHashView{txhash, State::CANDIDATE_DELAYED, 0});
-        while (it != m_index.get<ByTxHash>().end() && it->m_txhash == txhash) {
-            it = Erase<ByTxHash>(it);
-        }
+        auto it = m_txhash_anns.find(txhash);
+        if (it != m_txhash_anns.end()) EraseTxHash(it);
     }
 
     void ReceivedInv(NodeId peer, const GenTxid& gtxid, bool preferred,
         std::chrono::microseconds reqtime)
     {
-        // Bail out if we already have a CANDIDATE_BEST announcement for this (txhash, peer) combination. The case
-        // where there is a non-CANDIDATE_BEST announcement already will be caught by the uniqueness property of the
-        // ByPeer index when we try to emplace the new object below.
-        if (m_index.get<ByPeer>().count(ByPeerView{peer, true, gtxid.GetHash()})) return;
-
-        // Try creating the announcement with CANDIDATE_DELAYED state (which will fail due to the uniqueness
-        // of the ByPeer index if a non-CANDIDATE_BEST announcement already exists with the same txhash and peer).
-        // Bail out in that case.
-        auto ret = m_index.get<ByPeer>().emplace(gtxid, peer, preferred, reqtime, m_current_sequence);
-        if (!ret.second) return;
+        // Bail out if we already have an announcement for this (txhash, peer) combination.
+        PeerInfo& peerinfo = m_peerinfo[peer];
+        if (peerinfo.m_anns.count(gtxid.GetHash())) return;
+
+        const Announcement ann{gtxid, peer, preferred, reqtime, m_current_sequence, m_computer(gtxid.GetHash(), peer, preferred)};
+        AnnId id;
+        if (m_free.empty()) {
+            id = m_anns.size();
+            m_anns.push_back(ann);
+        } else {
+            id = m_free.back();
+            m_free.pop_back();
+            m_anns[id] = ann;
+        }
+        ++m_size;
+        peerinfo.m_anns.emplace(gtxid.GetHash(), id);
+        Insert(m_txhash_anns[gtxid.GetHash()], id);
+        ScheduleEvent(id);
 
         // Update accounting metadata.
-        ++m_peerinfo[peer].m_total;
+        ++peerinfo.m_total;
         ++m_current_sequence;
     }
 
@@ -599,41 +675,33 @@ public:
         // Move time.
         SetTimePoint(now, expired);
 
-        // Find all CANDIDATE_BEST announcements for this peer.
-        std::vector<const Announcement*> selected;
-        auto it_peer = m_index.get<ByPeer>().lower_bound(ByPeerView{peer, true, uint256::ZERO});
-        while (it_peer != m_index.get<ByPeer>().end() && it_peer->m_peer == peer &&
-            it_peer->GetState() == State::CANDIDATE_BEST) {
-            selected.emplace_back(&*it_peer);
-            ++it_peer;
-        }
-
-        // Sort by sequence number.
-        std::sort(selected.begin(), selected.end(), [](const Announcement* a, const Announcement* b) {
-            return a->m_sequence < b->m_sequence;
-        });
-
-        // Convert to GenTxid and return.
+        // Return all CANDIDATE_BEST announcements for this peer, which are kept sorted by sequence number.
         std::vector<GenTxid> ret;
-        ret.reserve(selected.size());
-        std::transform(selected.begin(), selected.end(), std::back_inserter(ret), [](const Announcement* ann) {
-            return ToGenTxid(*ann);
-        });
+        auto it = m_peerinfo.find(peer);
+        if (it == m_peerinfo.end()) return ret;
+        ret.reserve(it->second.m_best.size());
+        for (const auto& entry : it->second.m_best) {
+            ret.push_back(ToGenTxid(m_anns[entry.second]));
+        }
         return ret;
     }
 
     void RequestedTx(NodeId peer, const uint256& txhash, std::chrono::microseconds expiry)
     {
-        auto it = m_index.get<ByPeer>().find(ByPeerView{peer, true, txhash});
-        if (it == m_index.get<ByPeer>().end()) {
+        auto peerit = m_peerinfo.find(peer);
+        if (peerit == m_peerinfo.end()) return;
+        auto annit = peerit->second.m_anns.find(txhash);
+        if (annit == peerit->second.m_anns.end()) return;
+        const AnnId id = annit->second;
+        TxHashAnns& anns = m_txhash_anns.find(txhash)->second;
+
+        if (m_anns[id].GetState() != State::CANDIDATE_BEST) {
             // There is no CANDIDATE_BEST announcement, look for a _READY or _DELAYED instead. If the caller only
             // ever invokes RequestedTx with the values returned by GetRequestable, and no other non-const functions
             // other than ForgetTxHash and GetRequestable in between, this branch will never execute (as txhashes
             // returned by GetRequestable always correspond to CANDIDATE_BEST announcements).
 
-            it = m_index.get<ByPeer>().find(ByPeerView{peer, false, txhash});
-            if (it == m_index.get<ByPeer>().end() || (it->GetState() != State::CANDIDATE_DELAYED &&
-                                                      it->GetState() != State::CANDIDATE_READY)) {
+            if (m_anns[id].GetState() != State::CANDIDATE_DELAYED && m_anns[id].GetState() != State::CANDIDATE_READY) {
                 // There is no CANDIDATE announcement tracked for this peer, so we have nothing to do. Either this
                 // txhash wasn't tracked at all (and the caller should have called ReceivedInv), or it was already
                 // requested and/or completed for other reasons and this is just a superfluous RequestedTx call.
@@ -643,38 +711,32 @@ public:
             // Look for an existing CANDIDATE_BEST or REQUESTED with the same txhash. We only need to do this if the
             // found announcement had a different state than CANDIDATE_BEST. If it did, invariants guarantee that no
             // other CANDIDATE_BEST or REQUESTED can exist.
-            auto it_old = m_index.get<ByTxHash>().lower_bound(ByTxHashView{txhash, State::CANDIDATE_BEST, 0});
-            if (it_old != m_index.get<ByTxHash>().end() && it_old->m_txhash == txhash) {
-                if (it_old->GetState() == State::CANDIDATE_BEST) {
+            if (const std::optional<AnnId> selected = Selected(anns)) {
+                if (m_anns[*selected].GetState() == State::CANDIDATE_BEST) {
                     // The data structure's invariants require that there can be at most one CANDIDATE_BEST or one
                     // REQUESTED announcement per txhash (but not both simultaneously), so we have to convert any
                     // existing CANDIDATE_BEST to another CANDIDATE_* when constructing another REQUESTED.
                     // It doesn't matter whether we pick CANDIDATE_READY or _DELAYED here, as SetTimePoint()
                     // will correct it at GetRequestable() time. If time only goes forward, it will always be
                     // _READY, so pick that to avoid extra work in SetTimePoint().
-                    Modify<ByTxHash>(it_old, [](Announcement& ann) { ann.SetState(State::CANDIDATE_READY); });
-                } else if (it_old->GetState() == State::REQUESTED) {
+                    Modify(anns, *selected, State::CANDIDATE_READY);
+                } else {
                     // As we're no longer waiting for a response to the previous REQUESTED announcement, convert it
                     // to COMPLETED. This also helps guaranteeing progress.
-                    Modify<ByTxHash>(it_old, [](Announcement& ann) { ann.SetState(State::COMPLETED); });
+                    Modify(anns, *selected, State::COMPLETED);
                 }
             }
         }
 
-        Modify<ByPeer>(it, [expiry](Announcement& ann) {
-            ann.SetState(State::REQUESTED);
-            ann.m_time = expiry;
-        });
+        Modify(anns, id, State::REQUESTED, expiry);
     }
 
     void ReceivedResponse(NodeId peer, const uint256& txhash)
     {
-        // We need to search the ByPeer index for both (peer, false, txhash) and (peer, true, txhash).
-        auto it = m_index.get<ByPeer>().find(ByPeerView{peer, false, txhash});
-        if (it == m_index.get<ByPeer>().end()) {
-            it = m_index.get<ByPeer>().find(ByPeerView{peer, true, txhash});
-        }
-        if (it != m_index.get<ByPeer>().end()) MakeCompleted(m_index.project<ByTxHash>(it));
+        auto peerit = m_peerinfo.find(peer);
+        if (peerit == m_peerinfo.end()) return;
+        auto annit = peerit->second.m_anns.find(txhash);
+        if (annit != peerit->second.m_anns.end()) MakeCompleted(annit->second);
     }
 
     size_t CountInFlight(NodeId peer) const
@@ -699,7 +761,7 @@ public:
     }
 
     //! Count how many announcements are being tracked in total across all peers and transactions.
-    size_t Size() const { return m_index.size(); }
+    size_t Size() const { return m_size; }
 
     uint64_t ComputePriority(const uint256& txhash, NodeId peer, bool preferred) const
     {
@@ -90,8 +90,9 @@
  * Complexity:
  * - Memory usage is proportional to the total number of tracked announcements (Size()) plus the number of
  *   peers with a nonzero number of tracked announcements.
- * - CPU usage is generally logarithmic in the total number of tracked announcements, plus the number of
- *   announcements affected by an operation (amortized O(1) per announcement).
+ * - CPU usage is generally constant (hash table lookups) plus linear in the number of announcements for the same
+ *   txhash, which are kept in a small sorted vector, and in the number of announcements affected by an operation.
+ *   The time events are kept in heaps, logarithmic in the number of announcements.
  */
 class TxRequestTracker {
     // Avoid littering this header file with implementation details.
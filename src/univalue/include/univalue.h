@@ -10,10 +10,12 @@
 #include <cstdint>
 #include <cstring>
 #include <map>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 class UniValue {
@@ -99,13 +101,34 @@ public:
     bool read(std::string_view raw) { return read(raw.data(), raw.size()); }
 
 private:
+    //! Objects with this many keys also index them in a hash map, key lookups stay fast in wide objects
+    static constexpr size_t KEY_INDEX_MIN_KEYS{32};
+
+    /** Position of the first occurrence of each key, copies of the object copy the index */
+    struct KeyIndex {
+        std::unique_ptr<std::unordered_map<std::string, size_t>> map;
+
+        KeyIndex() = default;
+        KeyIndex(const KeyIndex& other) : map{other.map ? std::make_unique<std::unordered_map<std::string, size_t>>(*other.map) : nullptr} {}
+        KeyIndex(KeyIndex&&) noexcept = default;
+        KeyIndex& operator=(const KeyIndex& other)
+        {
+            map = other.map ? std::make_unique<std::unordered_map<std::string, size_t>>(*other.map) : nullptr;
+            return *this;
+        }
+        KeyIndex& operator=(KeyIndex&&) noexcept = default;
+    };
+
     UniValue::VType typ;
     std::string val;                       // numbers are stored as C++ strings
     std::vector<std::string> keys;
     std::vector<UniValue> values;
+    KeyIndex keyIndex;
 
     void checkType(const VType& expected) const;
+    void pushKey(std::string key);
     bool findKey(const std::string& key, size_t& retIdx) const;
+    void writeValue(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
 
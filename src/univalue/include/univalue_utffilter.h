@@ -45,6 +45,14 @@ public:
                 push_back_u(codepoint);
         }
     }
+    // Write a run of 7-bit ASCII chars
+    void append(const char* begin, const char* end)
+    {
+        if (state) // Not a continuation, invalid
+            is_valid = false;
+        else
+            str.append(begin, end);
+    }
     // Write codepoint directly, possibly collating surrogate pairs
     void push_back_u(unsigned int codepoint_)
     {
@@ -21,6 +21,7 @@ void UniValue::clear()
     val.clear();
     keys.clear();
     values.clear();
+    keyIndex.map.reset();
 }
 
 void UniValue::setNull()
@@ -119,7 +120,7 @@ void UniValue::__pushKV(std::string key, UniValue val)
 {
     checkType(VOBJ);
 
-    keys.push_back(std::move(key));
+    pushKey(std::move(key));
     values.push_back(std::move(val));
 }
 
@@ -153,8 +154,28 @@ void UniValue::getObjMap(std::map<std::string,UniValue>& kv) const
         kv[keys[i]] = values[i];
 }
 
+void UniValue::pushKey(std::string key)
+{
+    keys.push_back(std::move(key));
+    if (keyIndex.map) {
+        keyIndex.map->emplace(keys.back(), keys.size() - 1);
+    } else if (keys.size() >= KEY_INDEX_MIN_KEYS) {
+        keyIndex.map = std::make_unique<std::unordered_map<std::string, size_t>>(keys.size() * 2);
+        for (size_t i = 0; i < keys.size(); i++)
+            keyIndex.map->emplace(keys[i], i);
+    }
+}
+
 bool UniValue::findKey(const std::string& key, size_t& retIdx) const
 {
+    if (keyIndex.map) {
+        const auto it = keyIndex.map->find(key);
+        if (it == keyIndex.map->end())
+            return false;
+        retIdx = it->second;
+        return true;
+    }
+
     for (size_t i = 0; i < keys.size(); i++) {
         if (keys[i] == key) {
             retIdx = i;
@@ -232,10 +253,10 @@ const char *uvTypeName(UniValue::VType t)
 
 const UniValue& find_value(const UniValue& obj, const std::string& name)
 {
-    for (unsigned int i = 0; i < obj.keys.size(); i++)
-        if (obj.keys[i] == name)
-            return obj.values.at(i);
+    size_t index;
+    if (!obj.findKey(name, index))
+        return NullUniValue;
 
-    return NullUniValue;
+    return obj.values.at(index);
 }
 
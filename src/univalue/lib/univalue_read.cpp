@@ -9,8 +9,13 @@
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <utility>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /*
  * According to stackexchange, the original json test suite wanted
  * to limit depth to 22.  Widely-deployed PHP bails at depth 512,
@@ -51,6 +56,37 @@ static const char *hatoui(const char *first, const char *last,
     return first;
 }
 
+/**
+ * Skip a run of string characters that are copied as they are: printable
+ * 7-bit ASCII other than the quote and the backslash. Returns the first
+ * character that ends the run, or end.
+ */
+static const char *json_scan_plain(const char *raw, const char *end)
+{
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(0x20);
+    while (end - raw >= 16) {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw));
+        // The signed comparison also catches the bytes of UTF-8 sequences
+        const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, quote), _mm_cmpeq_epi8(chars, backslash)),
+                                             _mm_cmplt_epi8(chars, space));
+        const int mask = _mm_movemask_epi8(special);
+        if (mask)
+            return raw + __builtin_ctz(mask);
+        raw += 16;
+    }
+#endif
+    while (raw < end) {
+        unsigned char ch = static_cast<unsigned char>(*raw);
+        if (ch < 0x20 || ch >= 0x80 || ch == '"' || ch == '\\')
+            break;
+        raw++;
+    }
+    return raw;
+}
+
 enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
                             const char *raw, const char *end)
 {
@@ -123,8 +159,6 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
     case '8':
     case '9': {
         // part 1: int
-        std::string numStr;
-
         const char *first = raw;
 
         const char *firstDigit = first;
@@ -133,49 +167,38 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
         if ((*firstDigit == '0') && json_isdigit(firstDigit[1]))
             return JTOK_ERR;
 
-        numStr += *raw;                       // copy first char
-        raw++;
+        raw++;                                // skip first char
 
         if ((*first == '-') && (raw < end) && (!json_isdigit(*raw)))
             return JTOK_ERR;
 
-        while (raw < end && json_isdigit(*raw)) {  // copy digits
-            numStr += *raw;
+        while (raw < end && json_isdigit(*raw))  // skip digits
             raw++;
-        }
 
         // part 2: frac
         if (raw < end && *raw == '.') {
-            numStr += *raw;                   // copy .
-            raw++;
+            raw++;                            // skip .
 
             if (raw >= end || !json_isdigit(*raw))
                 return JTOK_ERR;
-            while (raw < end && json_isdigit(*raw)) { // copy digits
-                numStr += *raw;
+            while (raw < end && json_isdigit(*raw)) // skip digits
                 raw++;
-            }
         }
 
         // part 3: exp
         if (raw < end && (*raw == 'e' || *raw == 'E')) {
-            numStr += *raw;                   // copy E
-            raw++;
+            raw++;                            // skip E
 
-            if (raw < end && (*raw == '-' || *raw == '+')) { // copy +/-
-                numStr += *raw;
+            if (raw < end && (*raw == '-' || *raw == '+')) // skip +/-
                 raw++;
-            }
 
             if (raw >= end || !json_isdigit(*raw))
                 return JTOK_ERR;
-            while (raw < end && json_isdigit(*raw)) { // copy digits
-                numStr += *raw;
+            while (raw < end && json_isdigit(*raw)) // skip digits
                 raw++;
-            }
         }
 
-        tokenVal = numStr;
+        tokenVal.assign(first, raw);          // copy the number at once
         consumed = (raw - rawStart);
         return JTOK_NUMBER;
         }
@@ -183,10 +206,15 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
     case '"': {
         raw++;                                // skip "
 
-        std::string valStr;
-        JSONUTF8StringFilter writer(valStr);
+        JSONUTF8StringFilter writer(tokenVal);
 
         while (true) {
+            const char *run = json_scan_plain(raw, end);
+            if (run != raw) {
+                writer.append(raw, run);      // copy plain chars at once
+                raw = run;
+            }
+
             if (raw >= end || (unsigned char)*raw < 0x20)
                 return JTOK_ERR;
 
@@ -237,7 +265,6 @@ enum jtokentype getJsonToken(std::string& tokenVal, unsigned int& consumed,
 
         if (!writer.finalize())
             return JTOK_ERR;
-        tokenVal = valStr;
         consumed = (raw - rawStart);
         return JTOK_STRING;
         }
@@ -326,9 +353,8 @@ bool UniValue::read(const char *raw, size_t size)
                     setArray();
                 stack.push_back(this);
             } else {
-                UniValue tmpVal(utyp);
                 UniValue *top = stack.back();
-                top->values.push_back(tmpVal);
+                top->values.emplace_back(utyp);
 
                 UniValue *newTop = &(top->values.back());
                 stack.push_back(newTop);
@@ -408,21 +434,21 @@ bool UniValue::read(const char *raw, size_t size)
             }
 
             UniValue *top = stack.back();
-            top->values.push_back(tmpVal);
+            top->values.push_back(std::move(tmpVal));
 
             setExpect(NOT_VALUE);
             break;
             }
 
         case JTOK_NUMBER: {
-            UniValue tmpVal(VNUM, tokenVal);
+            UniValue tmpVal(VNUM, std::move(tokenVal));
             if (!stack.size()) {
-                *this = tmpVal;
+                *this = std::move(tmpVal);
                 break;
             }
 
             UniValue *top = stack.back();
-            top->values.push_back(tmpVal);
+            top->values.push_back(std::move(tmpVal));
 
             setExpect(NOT_VALUE);
             break;
@@ -431,17 +457,17 @@ bool UniValue::read(const char *raw, size_t size)
         case JTOK_STRING: {
             if (expect(OBJ_NAME)) {
                 UniValue *top = stack.back();
-                top->keys.push_back(tokenVal);
+                top->pushKey(std::move(tokenVal));
                 clearExpect(OBJ_NAME);
                 setExpect(COLON);
             } else {
-                UniValue tmpVal(VSTR, tokenVal);
+                UniValue tmpVal(VSTR, std::move(tokenVal));
                 if (!stack.size()) {
-                    *this = tmpVal;
+                    *this = std::move(tmpVal);
                     break;
                 }
                 UniValue *top = stack.back();
-                top->values.push_back(tmpVal);
+                top->values.push_back(std::move(tmpVal));
             }
 
             setExpect(NOT_VALUE);
@@ -9,22 +9,22 @@
 #include <string>
 #include <vector>
 
-static std::string json_escape(const std::string& inS)
+// Append inS to s as a quoted JSON string, copying the runs that need no escaping at once
+static void json_escape(const std::string& inS, std::string& s)
 {
-    std::string outS;
-    outS.reserve(inS.size() * 2);
-
-    for (unsigned int i = 0; i < inS.size(); i++) {
-        unsigned char ch = static_cast<unsigned char>(inS[i]);
-        const char *escStr = escapes[ch];
-
-        if (escStr)
-            outS += escStr;
-        else
-            outS += static_cast<char>(ch);
+    s += '"';
+    const char* run = inS.data();
+    const char* end = inS.data() + inS.size();
+    for (const char* p = run; p != end; p++) {
+        const char *escStr = escapes[static_cast<unsigned char>(*p)];
+        if (escStr) {
+            s.append(run, p);
+            s += escStr;
+            run = p + 1;
+        }
     }
-
-    return outS;
+    s.append(run, end);
+    s += '"';
 }
 
 std::string UniValue::write(unsigned int prettyIndent,
@@ -33,6 +33,16 @@ std::string UniValue::write(unsigned int prettyIndent,
     std::string s;
     s.reserve(1024);
 
+    writeValue(prettyIndent, indentLevel, s);
+
+    return s;
+}
+
+// Children are written into the caller's string, the output of a large
+// document grows a single buffer instead of concatenating one per value
+void UniValue::writeValue(unsigned int prettyIndent,
+                          unsigned int indentLevel, std::string& s) const
+{
     unsigned int modIndent = indentLevel;
     if (modIndent == 0)
         modIndent = 1;
@@ -48,7 +58,7 @@ std::string UniValue::write(unsigned int prettyIndent,
         writeArray(prettyIndent, modIndent, s);
         break;
     case VSTR:
-        s += "\"" + json_escape(val) + "\"";
+        json_escape(val, s);
         break;
     case VNUM:
         s += val;
@@ -57,8 +67,6 @@ std::string UniValue::write(unsigned int prettyIndent,
         s += (val == "1" ? "true" : "false");
         break;
     }
-
-    return s;
 }
 
 static void indentStr(unsigned int prettyIndent, unsigned int indentLevel, std::string& s)
@@ -75,7 +83,7 @@ void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, s
     for (unsigned int i = 0; i < values.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += values[i].write(prettyIndent, indentLevel + 1);
+        values[i].writeValue(prettyIndent, indentLevel + 1, s);
         if (i != (values.size() - 1)) {
             s += ",";
         }
@@ -97,10 +105,11 @@ void UniValue::writeObject(unsigned int prettyIndent, unsigned int indentLevel,
     for (unsigned int i = 0; i < keys.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += "\"" + json_escape(keys[i]) + "\":";
+        json_escape(keys[i], s);
+        s += ":";
         if (prettyIndent)
             s += " ";
-        s += values.at(i).write(prettyIndent, indentLevel + 1);
+        values.at(i).writeValue(prettyIndent, indentLevel + 1, s);
         if (i != (values.size() - 1))
             s += ",";
         if (prettyIndent)
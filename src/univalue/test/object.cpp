@@ -428,6 +428,81 @@ void univalue_readwrite()
     BOOST_CHECK(!v.read("{} 42"));
 }
 
+void univalue_wide_object()
+{
+    // Wide objects look their keys up in a hash index, the results match the small objects
+    UniValue obj(UniValue::VOBJ);
+    for (int i = 0; i < 100; i++) {
+        obj.pushKV("key" + std::to_string(i), i);
+    }
+    BOOST_CHECK_EQUAL(obj.size(), 100);
+    BOOST_CHECK_EQUAL(obj["key0"].getInt<int>(), 0);
+    BOOST_CHECK_EQUAL(obj["key99"].getInt<int>(), 99);
+    BOOST_CHECK(obj["key100"].isNull());
+    BOOST_CHECK(obj.exists("key42"));
+    BOOST_CHECK_EQUAL(find_value(obj, "key42").getInt<int>(), 42);
+
+    // Replacing a value keeps the key in place, a duplicate pushed with __pushKV is not found
+    obj.pushKV("key7", "seven");
+    BOOST_CHECK_EQUAL(obj.size(), 100);
+    BOOST_CHECK_EQUAL(obj["key7"].get_str(), "seven");
+    obj.__pushKV("key8", "eight");
+    BOOST_CHECK_EQUAL(obj.size(), 101);
+    BOOST_CHECK_EQUAL(obj["key8"].getInt<int>(), 8);
+
+    // Copies keep their own index
+    UniValue copy = obj;
+    copy.pushKV("extra", true);
+    BOOST_CHECK(copy["extra"].isTrue());
+    BOOST_CHECK(obj["extra"].isNull());
+    BOOST_CHECK_EQUAL(copy["key99"].getInt<int>(), 99);
+
+    UniValue moved = std::move(copy);
+    BOOST_CHECK(moved["extra"].isTrue());
+
+    std::map<std::string, UniValue::VType> memberTypes{{"key1", UniValue::VNUM}, {"key7", UniValue::VSTR}};
+    BOOST_CHECK(obj.checkObject(memberTypes));
+
+    // A wide object read back from its JSON finds the same values
+    UniValue parsed;
+    BOOST_CHECK(parsed.read(obj.write()));
+    BOOST_CHECK_EQUAL(parsed.write(), obj.write());
+    BOOST_CHECK_EQUAL(parsed["key8"].getInt<int>(), 8);
+    BOOST_CHECK_EQUAL(parsed["key99"].getInt<int>(), 99);
+
+    obj.setObject();
+    BOOST_CHECK(obj["key1"].isNull());
+    obj.pushKV("key1", 1);
+    BOOST_CHECK_EQUAL(obj["key1"].getInt<int>(), 1);
+}
+
+void univalue_long_strings()
+{
+    // Strings longer than a scan block, with escapes and UTF-8 at every offset
+    for (size_t pos = 0; pos < 40; pos++) {
+        for (const std::string special : {"\"", "\\", "\n", "\u0001", "\xc3\xa9", "\xe2\x82\xac", "\x7f"}) {
+            std::string str(40, 'a');
+            str.insert(pos, special);
+            UniValue v(UniValue::VARR);
+            v.push_back(str);
+            v.push_back(UniValue(UniValue::VNUM, "-12345678901234567890.125e+17"));
+            UniValue parsed;
+            BOOST_CHECK(parsed.read(v.write()));
+            BOOST_CHECK_EQUAL(parsed[0].get_str(), str);
+            BOOST_CHECK_EQUAL(parsed[1].getValStr(), "-12345678901234567890.125e+17");
+        }
+    }
+
+    UniValue v;
+    // Control characters, broken UTF-8 and unterminated strings are still rejected after a long run
+    BOOST_CHECK(!v.read("[\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\x01\"]"));
+    BOOST_CHECK(!v.read("[\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\xc3" "aaaaaaaaaaaaaaaaaaaa\"]"));
+    BOOST_CHECK(!v.read("[\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\xa9\"]"));
+    BOOST_CHECK(!v.read("[\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"));
+    BOOST_CHECK(v.read("[\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\\u00e9aaaaaaaaaaaaaaaaaaa\"]"));
+    BOOST_CHECK_EQUAL(v[0].get_str(), "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\xc3\xa9" "aaaaaaaaaaaaaaaaaaa");
+}
+
 int main(int argc, char* argv[])
 {
     univalue_constructor();
@@ -437,5 +512,7 @@ int main(int argc, char* argv[])
     univalue_array();
     univalue_object();
     univalue_readwrite();
+    univalue_wide_object();
+    univalue_long_strings();
     return 0;
 }
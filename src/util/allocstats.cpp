@@ -0,0 +1,85 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/allocstats.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+const char* AllocTagName(AllocTag tag)
+{
+    switch (tag) {
+    case AllocTag::OTHER: return "other";
+    case AllocTag::VALIDATION: return "validation";
+    case AllocTag::EVM: return "evm";
+    case AllocTag::MEMPOOL: return "mempool";
+    case AllocTag::NET: return "net";
+    case AllocTag::RPC: return "rpc";
+    case AllocTag::WALLET: return "wallet";
+    case AllocTag::COUNT: break;
+    } // no default case, so the compiler can warn about missing cases
+    return "unknown";
+}
+
+#ifdef ENABLE_ALLOC_TRACKING
+namespace allocstats {
+thread_local AllocTag g_tag{AllocTag::OTHER};
+
+namespace {
+//! Counters of one tag, on their own cache line so that the subsystems do not contend
+struct alignas(64) TagCounters {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+// Constant initialized, so usable by the allocations done before main()
+TagCounters g_counters[size_t(AllocTag::COUNT)];
+
+void Record(std::size_t size) noexcept
+{
+    TagCounters& counters = g_counters[size_t(g_tag)];
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+} // namespace
+} // namespace allocstats
+
+// The other forms of operator new and delete of the standard library call these ones
+void* operator new(std::size_t size)
+{
+    allocstats::Record(size);
+    for (;;) {
+        if (void* p = std::malloc(size ? size : 1)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+std::array<AllocStats, size_t(AllocTag::COUNT)> GetAllocStats()
+{
+    std::array<AllocStats, size_t(AllocTag::COUNT)> stats;
+    for (size_t i = 0; i < stats.size(); ++i) {
+        stats[i].count = allocstats::g_counters[i].count.load(std::memory_order_relaxed);
+        stats[i].bytes = allocstats::g_counters[i].bytes.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+#else
+std::array<AllocStats, size_t(AllocTag::COUNT)> GetAllocStats()
+{
+    return {};
+}
+#endif // ENABLE_ALLOC_TRACKING
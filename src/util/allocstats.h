@@ -0,0 +1,72 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QTUM_UTIL_ALLOCSTATS_H
+#define QTUM_UTIL_ALLOCSTATS_H
+
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/** Subsystems the heap allocations are counted for */
+enum class AllocTag : uint8_t {
+    OTHER,
+    VALIDATION,
+    EVM,
+    MEMPOOL,
+    NET,
+    RPC,
+    WALLET,
+    COUNT,
+};
+
+const char* AllocTagName(AllocTag tag);
+
+struct AllocStats {
+    uint64_t count{0};
+    uint64_t bytes{0};
+};
+
+#ifdef ENABLE_ALLOC_TRACKING
+//! Whether operator new counts the allocations, see --enable-alloc-tracking
+static constexpr bool ALLOC_TRACKING{true};
+
+namespace allocstats {
+extern thread_local AllocTag g_tag;
+} // namespace allocstats
+
+/**
+ * Counts the heap allocations of the thread under @a tag while in scope. The innermost scope
+ * wins, so that the contracts executed while connecting a block are counted under EVM.
+ */
+class AllocScope
+{
+public:
+    explicit AllocScope(AllocTag tag) noexcept : m_prev(allocstats::g_tag) { allocstats::g_tag = tag; }
+    ~AllocScope() { allocstats::g_tag = m_prev; }
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+
+private:
+    const AllocTag m_prev;
+};
+#else
+static constexpr bool ALLOC_TRACKING{false};
+
+class AllocScope
+{
+public:
+    explicit AllocScope(AllocTag) noexcept {}
+};
+#endif // ENABLE_ALLOC_TRACKING
+
+/** Allocations and allocated bytes per tag since the start, all zero unless ALLOC_TRACKING */
+std::array<AllocStats, size_t(AllocTag::COUNT)> GetAllocStats();
+
+#endif // QTUM_UTIL_ALLOCSTATS_H
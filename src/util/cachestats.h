@@ -0,0 +1,20 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QTUM_UTIL_CACHESTATS_H
+#define QTUM_UTIL_CACHESTATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/** Lookups of a cache since the start, and the memory it may use */
+struct CacheStats {
+    uint64_t hits{0};
+    uint64_t misses{0};
+    //! Entries dropped to make room for new ones
+    uint64_t evictions{0};
+    size_t max_bytes{0};
+};
+
+#endif // QTUM_UTIL_CACHESTATS_H
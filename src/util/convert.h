@@ -6,18 +6,19 @@
 #include <libdevcore/Common.h>
 #include <libdevcore/CommonData.h>
 #include <libdevcore/FixedHash.h>
+#include <intx/intx.hpp>
 
+#include <limits>
+
+// The hashes are converted for every transaction and receipt of a block, copy them without a temporary vector
 inline dev::h256 uintToh256(const uint256& in)
 {
-    std::vector<unsigned char> vHashBlock;
-    vHashBlock.assign(in.begin(), in.end());
-    return dev::h256(vHashBlock);
+    return dev::h256(in.data(), dev::h256::ConstructFromPointer);
 }
 
 inline uint256 h256Touint(const dev::h256& in)
 {
-	std::vector<unsigned char> vHashBlock = in.asBytes();
-	return uint256(vHashBlock);
+    return uint256(Span<const unsigned char>(in.data(), dev::h256::size));
 }
 
 inline dev::u256 uintTou256(const uint256& in)
@@ -36,15 +37,12 @@ inline uint256 u256Touint(const dev::u256& in)
 
 inline dev::h160 uintToh160(const uint160& in)
 {
-    std::vector<unsigned char> vHashBlock;
-    vHashBlock.assign(in.begin(), in.end());
-    return dev::h160(vHashBlock);
+    return dev::h160(in.data(), dev::h160::ConstructFromPointer);
 }
 
 inline uint160 h160Touint(const dev::h160& in)
 {
-	std::vector<unsigned char> vHashBlock = in.asBytes();
-	return uint160(vHashBlock);
+    return uint160(Span<const unsigned char>(in.data(), dev::h160::size));
 }
 
 inline dev::u160 uintTou160(const uint160& in)
@@ -60,6 +58,41 @@ inline uint160 u160Touint(const dev::u160& in)
     dev::toBigEndian<dev::u160, dev::bytes>(in, rawValue);
 	return uint160(rawValue);
 }
+
+/** Fixed width copy of a dev::u256, for arithmetic on inline 64-bit words. Both wrap around at 2^256. */
+inline intx::uint256 u256ToIntx(const dev::u256& in)
+{
+    using limb_type = boost::multiprecision::limb_type;
+    constexpr unsigned limb_bits = sizeof(limb_type) * 8;
+    intx::uint256 ret;
+    const auto& backend = in.backend();
+    for (unsigned i = 0; i < backend.size(); i++) {
+        if constexpr (limb_bits == 64)
+            ret[i] = backend.limbs()[i];
+        else
+            ret |= intx::uint256(backend.limbs()[i]) << (i * limb_bits);
+    }
+    return ret;
+}
+
+inline dev::u256 intxToU256(const intx::uint256& in)
+{
+    dev::u256 ret;
+    for (int i = intx::uint256::num_words - 1; i >= 0; i--) {
+        ret <<= 64;
+        ret |= in[i];
+    }
+    return ret;
+}
+
+/** Convert to an amount like CAmount(dev::u256) does, which saturates the values too large for it */
+inline int64_t intxToAmount(const intx::uint256& in)
+{
+    constexpr int64_t max_amount = std::numeric_limits<int64_t>::max();
+    if (in > intx::uint256(max_amount))
+        return max_amount;
+    return static_cast<int64_t>(in[0]);
+}
 //////////////////////////////////////////////////////
 
 #endif // QTUM_CONVERT_H
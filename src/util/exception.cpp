@@ -37,5 +37,6 @@ void PrintExceptionContinue(const std::exception* pex, std::string_view thread_n
 {
     std::string message = FormatException(pex, thread_name);
     LogPrintf("\n\n************************\n%s\n", message);
+    LogInstance().Flush();
     tfm::format(std::cerr, "\n\n************************\n%s\n", message);
 }
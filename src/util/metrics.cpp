@@ -0,0 +1,78 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/metrics.h>
+
+#include <tinyformat.h>
+
+metrics::Registry g_metrics;
+
+namespace metrics {
+void Histogram::Observe(std::chrono::microseconds duration) noexcept
+{
+    size_t bucket{0};
+    for (int64_t ms = duration.count() / 1000; ms > 0 && bucket + 1 < BUCKETS; ms >>= 1) {
+        ++bucket;
+    }
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum_us.fetch_add(duration.count(), std::memory_order_relaxed);
+}
+
+Registry::Registry()
+{
+    m_entries = {
+        {"qtum_blocks_connected_total", "Blocks connected to the active chain", &blocks_connected, nullptr, nullptr},
+        {"qtum_block_connect_seconds", "Time spent connecting a block", nullptr, nullptr, &block_connect_time},
+        {"qtum_chain_height", "Height of the active chain tip", nullptr, &chain_height, nullptr},
+        {"qtum_validation_callbacks_pending", "Validation interface callbacks queued for all the subscribers", nullptr, &validation_callbacks_pending, nullptr},
+        {"qtum_validation_callbacks_backlog", "Validation interface callbacks queued for the subscriber furthest behind, when the last event was queued", nullptr, &validation_callbacks_backlog, nullptr},
+        {"qtum_contract_txs_total", "Contract executions in connected blocks", &contract_txs, nullptr, nullptr},
+        {"qtum_contract_gas_used_total", "Gas used by the contract executions in connected blocks", &contract_gas_used, nullptr, nullptr},
+        {"qtum_mempool_txs", "Transactions in the mempool", nullptr, &mempool_txs, nullptr},
+        {"qtum_mempool_bytes", "Virtual size of the transactions in the mempool", nullptr, &mempool_bytes, nullptr},
+        {"qtum_mempool_accepted_total", "Transactions accepted to the mempool", &mempool_accepted, nullptr, nullptr},
+        {"qtum_mempool_rejected_total", "Transactions rejected from the mempool", &mempool_rejected, nullptr, nullptr},
+        {"qtum_peers", "Connected peers", nullptr, &peers, nullptr},
+        {"qtum_net_bytes_recv_total", "Bytes received from peers", &net_bytes_recv, nullptr, nullptr},
+        {"qtum_net_bytes_sent_total", "Bytes sent to peers", &net_bytes_sent, nullptr, nullptr},
+        {"qtum_staker_slots_searched_total", "Block times the staker searched for a kernel", &staker_slots_searched, nullptr, nullptr},
+        {"qtum_staker_slots_solved_total", "Block times the staker found a kernel for", &staker_slots_solved, nullptr, nullptr},
+        {"qtum_staker_slots_missed_total", "Solved block times no block was submitted for", &staker_slots_missed, nullptr, nullptr},
+        {"qtum_staker_blocks_submitted_total", "Staked blocks passed to block validation", &staker_blocks_submitted, nullptr, nullptr},
+        {"qtum_staker_blocks_accepted_total", "Staked blocks accepted by block validation", &staker_blocks_accepted, nullptr, nullptr},
+        {"qtum_staker_kernel_search_seconds", "Time spent searching a block time for a kernel", nullptr, nullptr, &staker_kernel_search_time},
+        {"qtum_network_stake_weight", "Estimated network stake weight in satoshis", nullptr, &network_stake_weight, nullptr},
+        {"qtum_rpc_requests_total", "RPC commands executed", &rpc_requests, nullptr, nullptr},
+        {"qtum_rpc_errors_total", "RPC commands that failed", &rpc_errors, nullptr, nullptr},
+        {"qtum_rpc_request_seconds", "Time spent executing an RPC command", nullptr, nullptr, &rpc_request_time},
+    };
+}
+
+std::string Registry::Format() const
+{
+    std::string out;
+    for (const Entry& entry : m_entries) {
+        if (entry.counter) {
+            out += strprintf("# HELP %s %s\n# TYPE %s counter\n%s %u\n", entry.name, entry.help, entry.name, entry.name, entry.counter->Get());
+        } else if (entry.gauge) {
+            out += strprintf("# HELP %s %s\n# TYPE %s gauge\n%s %d\n", entry.name, entry.help, entry.name, entry.name, entry.gauge->Get());
+        } else if (entry.histogram) {
+            out += strprintf("# HELP %s %s\n# TYPE %s histogram\n", entry.name, entry.help, entry.name);
+            // The buckets are read one by one while observations go on, their sum is the count
+            uint64_t cumulative{0};
+            for (size_t i = 0; i < Histogram::BUCKETS; ++i) {
+                cumulative += entry.histogram->Bucket(i);
+                if (i + 1 < Histogram::BUCKETS) {
+                    out += strprintf("%s_bucket{le=\"%.3f\"} %u\n", entry.name, (1 << i) / 1000.0, cumulative);
+                } else {
+                    out += strprintf("%s_bucket{le=\"+Inf\"} %u\n", entry.name, cumulative);
+                }
+            }
+            out += strprintf("%s_sum %.6f\n%s_count %u\n", entry.name, entry.histogram->Sum().count() / 1e6, entry.name, cumulative);
+        }
+    }
+    return out;
+}
+} // namespace metrics
@@ -0,0 +1,136 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QTUM_UTIL_METRICS_H
+#define QTUM_UTIL_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** Default for -metrics */
+static constexpr bool DEFAULT_METRICS_ENABLE{false};
+
+/**
+ * In-process metrics, updated from the hot paths with relaxed atomic operations and read
+ * without taking any lock, so that monitoring does not contend with validation. They are
+ * served in the Prometheus text format at the /metrics HTTP endpoint.
+ */
+namespace metrics {
+class Counter
+{
+public:
+    void Inc(uint64_t n = 1) noexcept { m_value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Get() const noexcept { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> m_value{0};
+};
+
+class Gauge
+{
+public:
+    void Set(int64_t value) noexcept { m_value.store(value, std::memory_order_relaxed); }
+    void Add(int64_t n) noexcept { m_value.fetch_add(n, std::memory_order_relaxed); }
+    int64_t Get() const noexcept { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> m_value{0};
+};
+
+/** Durations counted in buckets of 1ms to 2^14ms, the last bucket the longer durations */
+class Histogram
+{
+public:
+    static constexpr size_t BUCKETS{16};
+
+    void Observe(std::chrono::microseconds duration) noexcept;
+
+    uint64_t Bucket(size_t i) const noexcept { return m_buckets[i].load(std::memory_order_relaxed); }
+    uint64_t Count() const noexcept { return m_count.load(std::memory_order_relaxed); }
+    std::chrono::microseconds Sum() const noexcept { return std::chrono::microseconds{m_sum_us.load(std::memory_order_relaxed)}; }
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> m_buckets{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<int64_t> m_sum_us{0};
+};
+
+/** Times a scope into a histogram */
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Histogram& histogram) : m_histogram(histogram), m_start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() { m_histogram.Observe(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start)); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/** The metrics of the node. Their list is fixed at construction, reading it needs no lock. */
+struct Registry
+{
+    // validation
+    Counter blocks_connected;
+    Histogram block_connect_time;
+    Gauge chain_height;
+    Gauge validation_callbacks_pending;
+    Gauge validation_callbacks_backlog;
+    Counter contract_txs;
+    Counter contract_gas_used;
+
+    // mempool
+    Gauge mempool_txs;
+    Gauge mempool_bytes;
+    Counter mempool_accepted;
+    Counter mempool_rejected;
+
+    // net
+    Gauge peers;
+    Counter net_bytes_recv;
+    Counter net_bytes_sent;
+
+    // staker
+    Counter staker_slots_searched;
+    Counter staker_slots_solved;
+    Counter staker_slots_missed;
+    Counter staker_blocks_submitted;
+    Counter staker_blocks_accepted;
+    Histogram staker_kernel_search_time;
+    Gauge network_stake_weight;
+
+    // rpc
+    Counter rpc_requests;
+    Counter rpc_errors;
+    Histogram rpc_request_time;
+
+    Registry();
+    Registry(const Registry&) = delete;
+    Registry& operator=(const Registry&) = delete;
+
+    /** Render the metrics in the Prometheus text exposition format */
+    std::string Format() const;
+
+private:
+    struct Entry {
+        const char* name;
+        const char* help;
+        const Counter* counter;
+        const Gauge* gauge;
+        const Histogram* histogram;
+    };
+    std::vector<Entry> m_entries;
+};
+} // namespace metrics
+
+extern metrics::Registry g_metrics;
+
+#endif // QTUM_UTIL_METRICS_H
@@ -14,6 +14,7 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #ifdef WIN32
 #include <codecvt>
@@ -24,6 +25,10 @@
 #include <poll.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 static inline bool IOErrorIsPermanent(int err)
 {
     return err != WSAEAGAIN && err != WSAEINTR && err != WSAEWOULDBLOCK && err != WSAEINPROGRESS;
@@ -56,6 +61,26 @@ ssize_t Sock::Send(const void* data, size_t len, int flags) const
     return send(m_socket, static_cast<const char*>(data), len, flags);
 }
 
+ssize_t Sock::SendMany(Span<const Span<const unsigned char>> buffers, int flags) const
+{
+    if (buffers.empty()) {
+        return 0;
+    }
+#ifdef WIN32
+    return Send(buffers[0].data(), buffers[0].size(), flags);
+#else
+    std::vector<iovec> iov(buffers.size());
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        iov[i].iov_base = const_cast<unsigned char*>(buffers[i].data());
+        iov[i].iov_len = buffers[i].size();
+    }
+    msghdr msg{};
+    msg.msg_iov = iov.data();
+    msg.msg_iovlen = iov.size();
+    return sendmsg(m_socket, &msg, flags);
+#endif
+}
+
 ssize_t Sock::Recv(void* buf, size_t len, int flags) const
 {
     return recv(m_socket, static_cast<char*>(buf), len, flags);
@@ -416,6 +441,120 @@ void Sock::Close()
     m_socket = INVALID_SOCKET;
 }
 
+SockPoller::SockPoller()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd == -1) {
+        LogPrintf("epoll_create1() failed, waiting for the sockets with WaitMany(): %s\n", NetworkErrorString(errno));
+    }
+#endif
+}
+
+SockPoller::~SockPoller()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (m_epoll_fd != -1) {
+        close(m_epoll_fd);
+    }
+#endif
+}
+
+bool SockPoller::Register(const std::shared_ptr<const Sock>& sock, Sock::Event requested)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    const SOCKET s{sock->Get()};
+    auto it = m_registered.find(s);
+    const bool known{it != m_registered.end() && it->second.sock.lock() == sock};
+    if (known && it->second.requested == requested) {
+        return true;
+    }
+
+    epoll_event ev{};
+    ev.data.fd = s;
+    if (requested & Sock::RECV) {
+        ev.events |= EPOLLIN;
+    }
+    if (requested & Sock::SEND) {
+        ev.events |= EPOLLOUT;
+    }
+
+    // Closing a socket unregisters it, and a new socket may get the same file descriptor
+    int op{known ? EPOLL_CTL_MOD : EPOLL_CTL_ADD};
+    if (epoll_ctl(m_epoll_fd, op, s, &ev) != 0) {
+        if (errno == EEXIST) {
+            op = EPOLL_CTL_MOD;
+        } else if (errno == ENOENT) {
+            op = EPOLL_CTL_ADD;
+        } else {
+            return false;
+        }
+        if (epoll_ctl(m_epoll_fd, op, s, &ev) != 0) {
+            return false;
+        }
+    }
+    m_registered[s] = Registration{sock, requested};
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool SockPoller::WaitMany(std::chrono::milliseconds timeout, Sock::EventsPerSock& events_per_sock)
+{
+    if (events_per_sock.empty()) {
+        return false;
+    }
+
+#ifdef HAVE_SYS_EPOLL_H
+    std::unordered_map<SOCKET, Sock::Events*> events_by_socket;
+    bool registered{m_epoll_fd != -1};
+    for (auto& [sock, events] : events_per_sock) {
+        if (!registered) break;
+        events.occurred = 0;
+        events_by_socket.emplace(sock->Get(), &events);
+        registered = Register(sock, events.requested);
+    }
+
+    if (registered) {
+        for (auto it = m_registered.begin(); it != m_registered.end();) {
+            if (events_by_socket.count(it->first)) {
+                ++it;
+                continue;
+            }
+            // Fails if the socket has been closed already, which unregistered it
+            epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, it->first, nullptr);
+            it = m_registered.erase(it);
+        }
+
+        std::vector<epoll_event> ready(events_by_socket.size());
+        const int n_ready{epoll_wait(m_epoll_fd, ready.data(), ready.size(), count_milliseconds(timeout))};
+        if (n_ready == SOCKET_ERROR) {
+            return false;
+        }
+        for (int i = 0; i < n_ready; ++i) {
+            const auto it = events_by_socket.find(ready[i].data.fd);
+            if (it == events_by_socket.end()) {
+                continue;
+            }
+            Sock::Events& events = *it->second;
+            if (ready[i].events & EPOLLIN) {
+                events.occurred |= Sock::RECV;
+            }
+            if (ready[i].events & EPOLLOUT) {
+                events.occurred |= Sock::SEND;
+            }
+            if (ready[i].events & (EPOLLERR | EPOLLHUP)) {
+                events.occurred |= Sock::ERR;
+            }
+        }
+        return true;
+    }
+#endif
+
+    return events_per_sock.begin()->first->WaitMany(timeout, events_per_sock);
+}
+
 #ifdef WIN32
 std::string NetworkErrorString(int err)
 {
@@ -6,6 +6,7 @@
 #define BITCOIN_UTIL_SOCK_H
 
 #include <compat/compat.h>
+#include <span.h>
 #include <util/threadinterrupt.h>
 #include <util/time.h>
 
@@ -74,6 +75,14 @@ public:
      */
     [[nodiscard]] virtual ssize_t Send(const void* data, size_t len, int flags) const;
 
+    /**
+     * sendmsg(2) wrapper, sends the buffers one after the other in one call. Where sendmsg(2) is
+     * not available only the first buffer is sent. Returns the number of bytes sent, like `Send()`.
+     * Code that uses this wrapper can be unit tested if this method is overridden by a mock Sock
+     * implementation.
+     */
+    [[nodiscard]] virtual ssize_t SendMany(Span<const Span<const unsigned char>> buffers, int flags) const;
+
     /**
      * recv(2) wrapper. Equivalent to `recv(this->Get(), buf, len, flags);`. Code that uses this
      * wrapper can be unit tested if this method is overridden by a mock Sock implementation.
@@ -279,6 +288,45 @@ private:
     void Close();
 };
 
+/**
+ * Wait for the readiness of a set of sockets that changes little between calls, like the
+ * connected peers. On Linux the sockets stay registered in an epoll(7) instance, so a socket is
+ * only passed to the kernel when it is new or the events requested on it change, and waiting
+ * costs the number of ready sockets instead of the number of watched ones. Elsewhere, or when a
+ * socket cannot be registered (eg a mocked `Sock`), this falls back to `Sock::WaitMany()`.
+ */
+class SockPoller
+{
+public:
+    SockPoller();
+    ~SockPoller();
+
+    SockPoller(const SockPoller&) = delete;
+    SockPoller& operator=(const SockPoller&) = delete;
+
+    /**
+     * Same as `Sock::WaitMany()`. The sockets registered by a previous call that are missing from
+     * `events_per_sock` are unregistered.
+     */
+    [[nodiscard]] bool WaitMany(std::chrono::milliseconds timeout, Sock::EventsPerSock& events_per_sock);
+
+private:
+    struct Registration {
+        /** Tells a socket apart from a later one that reuses its file descriptor */
+        std::weak_ptr<const Sock> sock;
+        Sock::Event requested;
+    };
+
+    /** The epoll file descriptor, or -1 when not available */
+    int m_epoll_fd{-1};
+
+    /** The registered sockets, by file descriptor */
+    std::unordered_map<SOCKET, Registration> m_registered;
+
+    /** Register a socket or update the events requested on it */
+    bool Register(const std::shared_ptr<const Sock>& sock, Sock::Event requested);
+};
+
 /** Return readable error string for a network error code */
 std::string NetworkErrorString(int err);
 
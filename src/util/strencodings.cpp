@@ -3,10 +3,16 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
 #include <span.h>
 #include <util/strencodings.h>
 #include <tinyformat.h>
+#include <compat/cpuid.h>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstring>
@@ -16,6 +22,64 @@
 #include <string>
 #include <vector>
 
+namespace hex_sse41
+{
+void Encode(char* out, const uint8_t* in, size_t blocks);
+size_t Decode(uint8_t* out, const char* in, size_t blocks);
+}
+
+namespace hex_avx2
+{
+void Encode(char* out, const uint8_t* in, size_t blocks);
+size_t Decode(uint8_t* out, const char* in, size_t blocks);
+}
+
+namespace {
+/** Hex encoding and decoding of whole blocks with vector instructions */
+struct HexKernel {
+    //! Bytes in a block, twice as many hex digits
+    size_t block_size;
+    void (*encode)(char* out, const uint8_t* in, size_t blocks);
+    //! Returns the number of blocks decoded before the first one that is not all hex digits
+    size_t (*decode)(uint8_t* out, const char* in, size_t blocks);
+};
+
+const HexKernel* HexKernelAutoDetect()
+{
+#if defined(USE_ASM) && defined(HAVE_GETCPUID) && !defined(BUILD_BITCOIN_INTERNAL)
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    [[maybe_unused]] const bool have_ssse3 = (ecx >> 9) & 1;
+    [[maybe_unused]] const bool have_sse4 = (ecx >> 19) & 1;
+#if defined(ENABLE_AVX2)
+    const bool have_xsave = (ecx >> 27) & 1;
+    const bool have_avx = (ecx >> 28) & 1;
+    if (have_xsave && have_avx) {
+        // Check whether the OS has enabled AVX registers
+        uint32_t a, d;
+        __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        const bool have_avx2 = (ebx >> 5) & 1;
+        static constexpr HexKernel avx2{32, hex_avx2::Encode, hex_avx2::Decode};
+        if ((a & 6) == 6 && have_avx2) return &avx2;
+    }
+#endif
+#if defined(ENABLE_SSE41)
+    static constexpr HexKernel sse41{16, hex_sse41::Encode, hex_sse41::Decode};
+    if (have_ssse3 && have_sse4) return &sse41;
+#endif
+#endif
+    return nullptr;
+}
+
+/** The kernel for this CPU, nullptr when there is none */
+const HexKernel* GetHexKernel()
+{
+    static const HexKernel* const kernel = HexKernelAutoDetect();
+    return kernel;
+}
+} // namespace
+
 static const std::string CHARS_ALPHA_NUM = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
 
 static const std::string SAFE_CHARS[] =
@@ -82,8 +146,21 @@ template <typename Byte>
 std::optional<std::vector<Byte>> TryParseHex(std::string_view str)
 {
     std::vector<Byte> vch;
+    vch.reserve(str.size() / 2);
+    const HexKernel* kernel = GetHexKernel();
     auto it = str.begin();
     while (it != str.end()) {
+        if (kernel) {
+            // Decode runs of hex digits in whole blocks, whitespace and the tail go through the loop below
+            uint8_t buf[256];
+            const size_t blocks = std::min<size_t>(str.end() - it, 2 * sizeof(buf)) / (2 * kernel->block_size);
+            const size_t decoded = blocks ? kernel->decode(buf, &*it, blocks) * kernel->block_size : 0;
+            if (decoded) {
+                vch.insert(vch.end(), reinterpret_cast<const Byte*>(buf), reinterpret_cast<const Byte*>(buf + decoded));
+                it += 2 * decoded;
+                continue;
+            }
+        }
         if (IsSpace(*it)) {
             ++it;
             continue;
@@ -502,7 +579,14 @@ std::string HexStr(const Span<const uint8_t> s)
     static_assert(sizeof(byte_to_hex) == 512);
 
     char* it = rv.data();
-    for (uint8_t v : s) {
+    size_t pos = 0;
+    if (const HexKernel* kernel = GetHexKernel()) {
+        const size_t blocks = s.size() / kernel->block_size;
+        kernel->encode(it, s.data(), blocks);
+        pos = blocks * kernel->block_size;
+        it += 2 * pos;
+    }
+    for (uint8_t v : s.subspan(pos)) {
         std::memcpy(it, byte_to_hex[v].data(), 2);
         it += 2;
     }
@@ -898,6 +898,9 @@ void SetSyscallSandboxPolicy(SyscallSandboxPolicy syscall_policy)
         break;
     case SyscallSandboxPolicy::VALIDATION_SCRIPT_CHECK: // Thread: scriptch.<N>
         break;
+    case SyscallSandboxPolicy::VALIDATION_CONTRACT_EXEC: // Threads: contrexec.<N>, contrcall.<N>
+        seccomp_policy_builder.AllowFileSystem();
+        break;
     case SyscallSandboxPolicy::SHUTOFF: // Thread: main thread (state: shutoff)
         seccomp_policy_builder.AllowFileSystem();
         break;
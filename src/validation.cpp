@@ -21,14 +21,17 @@
 #include <cuckoocache.h>
 #include <flatfile.h>
 #include <hash.h>
+#include <index/addressindex.h>
 #include <kernel/chainparams.h>
 #include <kernel/mempool_entry.h>
 #include <logging.h>
 #include <logging/timer.h>
+#include <memusage.h>
 #include <node/blockstorage.h>
 #include <node/interface_ui.h>
 #include <node/utxo_snapshot.h>
 #include <node/transaction.h>
+#include <node/vmlog.h>
 #include <policy/policy.h>
 #include <policy/rbf.h>
 #include <policy/settings.h>
@@ -42,20 +45,24 @@
 #include <script/sigcache.h>
 #include <shutdown.h>
 #include <signet.h>
+#include <support/arena.h>
 #include <timedata.h>
 #include <tinyformat.h>
 #include <txdb.h>
 #include <txmempool.h>
 #include <uint256.h>
 #include <undo.h>
+#include <util/allocstats.h>
 #include <util/check.h> // For NDEBUG compile time check
 #include <util/fs.h>
 #include <util/fs_helpers.h>
 #include <util/hasher.h>
+#include <util/metrics.h>
 #include <util/moneystr.h>
 #include <util/rbf.h>
 #include <util/strencodings.h>
 #include <util/system.h>
+#include <util/threadnames.h>
 #include <util/time.h>
 #include <util/trace.h>
 #include <util/translation.h>
@@ -65,15 +72,19 @@
 #include <libethcore/ABI.h>
 #include <univalue.h>
 #include <util/signstr.h>
+#include <qtum/qtumdelegation.h>
 #include <qtum/qtumutils.h>
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <numeric>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <fstream>
 
@@ -91,7 +102,6 @@ using node::fReindex;
 using node::ReadBlockFromDisk;
 using node::SnapshotMetadata;
 using node::UndoReadFromDisk;
-using node::UnlinkPrunedFiles;
 
 /** Maximum kilobytes for transactions to store for processing during reorg */
 static const unsigned int MAX_DISCONNECTED_TX_POOL_SIZE = 20000;
@@ -116,11 +126,11 @@ const std::vector<std::string> CHECKLEVEL_DOC {
  * */
 static constexpr int PRUNE_LOCK_BUFFER{10};
 
-std::unique_ptr<QtumState> globalState;
-std::shared_ptr<dev::eth::SealEngineFace> globalSealEngine;
-std::unique_ptr<StorageResults> pstorageresult;
+static const std::shared_ptr<QtumContext> g_qtum_context{std::make_shared<QtumContext>()};
+std::unique_ptr<QtumState>& globalState{g_qtum_context->state};
+std::shared_ptr<dev::eth::SealEngineFace>& globalSealEngine{g_qtum_context->sealEngine};
+std::unique_ptr<StorageResults>& pstorageresult{g_qtum_context->storageResults};
 bool fRecordLogOpcodes = false;
-bool fIsVMlogFile = false;
 bool fGettingValuesDGP = false;
 std::set<std::pair<COutPoint, unsigned int>> setStakeSeen;
 
@@ -153,7 +163,8 @@ const CBlockIndex* Chainstate::FindForkInGlobalIndex(const CBlockLocator& locato
 bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
                        const CCoinsViewCache& inputs, unsigned int flags, bool cacheSigStore,
                        bool cacheFullScriptStore, PrecomputedTransactionData& txdata,
-                       std::vector<CScriptCheck>* pvChecks = nullptr)
+                       std::vector<CScriptCheck>* pvChecks = nullptr,
+                       BatchSchnorrVerifier* batch = nullptr)
                        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 int64_t FutureDrift(uint32_t nTime, int nHeight, const Consensus::Params& consensusParams)
@@ -866,6 +877,9 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
     int64_t nSigOpsCost = GetTransactionSigOpCost(tx, m_view, STANDARD_SCRIPT_VERIFY_FLAGS);
 
     dev::u256 txMinGasPrice = 0;
+    uint64_t txGasLimit = 0;
+    std::shared_ptr<const MempoolContractTxs> mempoolContractTxs;
+    size_t contractTxsUsage = 0;
 
     //////////////////////////////////////////////////////////// // qtum
     if(!CheckOpSender(tx, chainparams, m_active_chainstate.m_chain.Height() + 1)){
@@ -877,24 +891,26 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
             return state.Invalid(TxValidationResult::TX_INVALID_SENDER_SCRIPT, "bad-txns-invalid-sender-script");
         }
 
-        QtumDGP qtumDGP(globalState.get(), m_active_chainstate, fGettingValuesDGP);
+        QtumDGP qtumDGP(m_active_chainstate.m_chainman.Qtum().state.get(), m_active_chainstate, fGettingValuesDGP);
         uint64_t minGasPrice = qtumDGP.getMinGasPrice(m_active_chainstate.m_chain.Tip()->nHeight + 1);
         uint64_t blockGasLimit = qtumDGP.getBlockGasLimit(m_active_chainstate.m_chain.Tip()->nHeight + 1);
         size_t count = 0;
         for(const CTxOut& o : tx.vout)
             count += o.scriptPubKey.HasOpCreate() || o.scriptPubKey.HasOpCall() ? 1 : 0;
         unsigned int contractflags = GetContractScriptFlags(m_active_chainstate.m_chain.Height() + 1, chainparams.GetConsensus());
-        QtumTxConverter converter(tx, m_active_chainstate, &m_pool, NULL, NULL, contractflags);
-        ExtractQtumTX resultConverter;
-        if(!converter.extractionQtumTransactions(resultConverter)){
+        // The senders are read from the spent coins as ConnectBlock does, so that it can reuse the extraction
+        auto contractTxs = std::make_shared<MempoolContractTxs>();
+        contractTxs->flags = contractflags;
+        QtumTxConverter converter(tx, m_active_chainstate, &m_pool, &m_view, NULL, contractflags);
+        if(!converter.extractionQtumTransactions(contractTxs->extracted)){
             return state.Invalid(TxValidationResult::TX_CONSENSUS, "bad-tx-bad-contract-format", "AcceptToMempool(): Contract transaction of the wrong format");
         }
-        std::vector<QtumTransaction> qtumTransactions = resultConverter.first;
-        std::vector<EthTransactionParams> qtumETP = resultConverter.second;
+        const std::vector<QtumTransaction>& qtumTransactions = contractTxs->extracted.first;
+        const std::vector<EthTransactionParams>& qtumETP = contractTxs->extracted.second;
 
         dev::u256 sumGas = dev::u256(0);
         dev::u256 gasAllTxs = dev::u256(0);
-        for(QtumTransaction qtumTransaction : qtumTransactions){
+        for(const QtumTransaction& qtumTransaction : qtumTransactions){
             sumGas += qtumTransaction.gas() * qtumTransaction.gasPrice();
 
             if(sumGas > dev::u256(INT64_MAX)) {
@@ -945,6 +961,14 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
 
         if(count > qtumTransactions.size())
             return state.Invalid(TxValidationResult::TX_CONSENSUS, "bad-txns-incorrect-format");
+
+        txGasLimit = (uint64_t)gasAllTxs;
+
+        // Counted in the memory usage of the entry, the code of the contracts is held twice
+        contractTxsUsage = memusage::MallocUsage(sizeof(MempoolContractTxs)) + memusage::DynamicUsage(qtumTransactions) + memusage::DynamicUsage(qtumETP);
+        for(const EthTransactionParams& etp : qtumETP)
+            contractTxsUsage += 2 * memusage::MallocUsage(etp.code.size());
+        mempoolContractTxs = std::move(contractTxs);
     }
     ////////////////////////////////////////////////////////////
 
@@ -964,7 +988,8 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
     }
 
     entry.reset(new CTxMemPoolEntry(ptx, ws.m_base_fees, nAcceptTime, m_active_chainstate.m_chain.Height(),
-                                    fSpendsCoinbase, nSigOpsCost, lock_points.value(), CAmount(txMinGasPrice)));
+                                    fSpendsCoinbase, nSigOpsCost, lock_points.value(), CAmount(txMinGasPrice), txGasLimit,
+                                    std::move(mempoolContractTxs), contractTxsUsage));
     ws.m_vsize = entry->GetTxSize();
 
     if (nSigOpsCost > dgpMaxTxSigOps)
@@ -1616,6 +1641,7 @@ MempoolAcceptResult AcceptToMemoryPool(Chainstate& active_chainstate, const CTra
     EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
 {
     AssertLockHeld(::cs_main);
+    AllocScope alloc_scope{AllocTag::MEMPOOL};
     const CChainParams& chainparams{active_chainstate.m_chainman.GetParams()};
     assert(active_chainstate.GetMempool() != nullptr);
     CTxMemPool& pool{*active_chainstate.GetMempool()};
@@ -1635,6 +1661,9 @@ MempoolAcceptResult AcceptToMemoryPool(Chainstate& active_chainstate, const CTra
                 tx->GetHash().data(),
                 result.m_state.GetRejectReason().c_str()
         );
+        g_metrics.mempool_rejected.Inc();
+    } else if (!test_accept) {
+        g_metrics.mempool_accepted.Inc();
     }
     // After we've (potentially) uncached entries, ensure our coins cache is still within its size limits
     BlockValidationState state_dummy;
@@ -1646,6 +1675,7 @@ PackageMempoolAcceptResult ProcessNewPackage(Chainstate& active_chainstate, CTxM
                                                    const Package& package, bool test_accept)
 {
     AssertLockHeld(cs_main);
+    AllocScope alloc_scope{AllocTag::MEMPOOL};
     assert(!package.empty());
     assert(std::all_of(package.cbegin(), package.cend(), [](const auto& tx){return tx != nullptr;}));
 
@@ -1705,7 +1735,9 @@ bool CheckHeaderPoS(const CBlockHeader& block, const Consensus::Params& consensu
     // Check the kernel hash
     CBlockIndex* pindexPrev = &((*mi).second);
 
-    if(pindexPrev->nHeight >= consensusParams.nEnableHeaderSignatureHeight && !CheckRecoveredPubKeyFromBlockSignature(pindexPrev, block, chainstate.CoinsTip(), chainstate.m_chain)) {
+    if(pindexPrev->nHeight >= consensusParams.nEnableHeaderSignatureHeight &&
+            !chainstate.m_chainman.m_verified_header_signatures.count(block.GetHash()) &&
+            !CheckRecoveredPubKeyFromBlockSignature(pindexPrev, block, chainstate.CoinsTip(), chainstate.m_chain)) {
         return error("Failed signature check");
     }
 
@@ -1763,6 +1795,7 @@ void CoinsViews::InitCache()
 {
     AssertLockHeld(::cs_main);
     m_cacheview = std::make_unique<CCoinsViewCache>(&m_catcherview);
+    m_cacheview->EnableConcurrentReads();
 }
 
 Chainstate::Chainstate(
@@ -1930,21 +1963,45 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txund
 bool CScriptCheck::operator()() {
     if(checkOutput())
     {
+        // The sender signatures verified on mempool acceptance are not checked again in blocks
+        if(SenderSignatureCacheGet(*ptxTo, nOut, nFlags, cacheStore))
+            return true;
+
         // Check the sender signature inside the output, used to identify VM sender
         CScript senderPubKey, senderSig;
         if(!ExtractSenderData(ptxTo->vout[nOut].scriptPubKey, &senderPubKey, &senderSig))
             return false;
-        return VerifyScript(senderSig, senderPubKey, nullptr, nFlags, CachingTransactionSignatureOutputChecker(ptxTo, nOut, ptxTo->vout[nOut].nValue, cacheStore, *txdata), &error);
+        if(!VerifyScript(senderSig, senderPubKey, nullptr, nFlags, CachingTransactionSignatureOutputChecker(ptxTo, nOut, ptxTo->vout[nOut].nValue, cacheStore, *txdata), &error))
+            return false;
+        if(cacheStore)
+            SenderSignatureCacheSet(*ptxTo, nOut, nFlags);
+        return true;
     }
 
     // Check the input signature
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
     const CScriptWitness *witness = &ptxTo->vin[nIn].scriptWitness;
-    return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata), &error);
+    return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata, m_batch), &error);
 }
 
 static CuckooCache::cache<uint256, SignatureCacheHasher> g_scriptExecutionCache;
 static CSHA256 g_scriptExecutionCacheHasher;
+static std::atomic<uint64_t> g_scriptExecutionCacheHits{0};
+static std::atomic<uint64_t> g_scriptExecutionCacheMisses{0};
+static std::atomic<uint64_t> g_scriptExecutionCacheEvictions{0};
+static std::atomic<size_t> g_scriptExecutionCacheBytes{0};
+
+static bool SetupScriptExecutionCache(size_t max_size_bytes)
+{
+    auto setup_results = g_scriptExecutionCache.setup_bytes(max_size_bytes);
+    if (!setup_results) return false;
+
+    const auto [num_elems, approx_size_bytes] = *setup_results;
+    g_scriptExecutionCacheBytes = approx_size_bytes;
+    LogPrintf("Using %zu MiB out of %zu MiB requested for script execution cache, able to store %zu elements\n",
+              approx_size_bytes >> 20, max_size_bytes >> 20, num_elems);
+    return true;
+}
 
 bool InitScriptExecutionCache(size_t max_size_bytes)
 {
@@ -1953,16 +2010,32 @@ bool InitScriptExecutionCache(size_t max_size_bytes)
     // We want the nonce to be 64 bytes long to force the hasher to process
     // this chunk, which makes later hash computations more efficient. We
     // just write our 32-byte entropy twice to fill the 64 bytes.
+    g_scriptExecutionCacheHasher = CSHA256();
     g_scriptExecutionCacheHasher.Write(nonce.begin(), 32);
     g_scriptExecutionCacheHasher.Write(nonce.begin(), 32);
 
-    auto setup_results = g_scriptExecutionCache.setup_bytes(max_size_bytes);
-    if (!setup_results) return false;
+    return SetupScriptExecutionCache(max_size_bytes);
+}
 
-    const auto [num_elems, approx_size_bytes] = *setup_results;
-    LogPrintf("Using %zu MiB out of %zu MiB requested for script execution cache, able to store %zu elements\n",
-              approx_size_bytes >> 20, max_size_bytes >> 20, num_elems);
-    return true;
+bool ResizeScriptExecutionCache(size_t max_size_bytes)
+{
+    AssertLockHeld(cs_main);
+    return SetupScriptExecutionCache(max_size_bytes);
+}
+
+CacheStats GetScriptExecutionCacheStats()
+{
+    return {g_scriptExecutionCacheHits.load(std::memory_order_relaxed), g_scriptExecutionCacheMisses.load(std::memory_order_relaxed),
+            g_scriptExecutionCacheEvictions.load(std::memory_order_relaxed), g_scriptExecutionCacheBytes.load()};
+}
+
+/** The script execution cache entry of @p tx verified under @p flags */
+static uint256 ScriptExecutionCacheEntry(const CTransaction& tx, unsigned int flags)
+{
+    uint256 hashCacheEntry;
+    CSHA256 hasher = g_scriptExecutionCacheHasher;
+    hasher.Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
+    return hashCacheEntry;
 }
 
 /**
@@ -1975,6 +2048,9 @@ bool InitScriptExecutionCache(size_t max_size_bytes)
  * script checks which are not necessary (eg due to script execution cache hits) are, obviously,
  * not pushed onto pvChecks/run.
  *
+ * If batch is not nullptr, the Schnorr signatures of the scripts performed inline are added to it
+ * instead of being verified, and the caller has to verify the batch before accepting the transaction.
+ *
  * Setting cacheSigStore/cacheFullScriptStore to false will remove elements from the corresponding cache
  * which are matched. This is useful for checking blocks where we will likely never need the cache
  * entry again.
@@ -1987,7 +2063,8 @@ bool InitScriptExecutionCache(size_t max_size_bytes)
 bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
                        const CCoinsViewCache& inputs, unsigned int flags, bool cacheSigStore,
                        bool cacheFullScriptStore, PrecomputedTransactionData& txdata,
-                       std::vector<CScriptCheck>* pvChecks)
+                       std::vector<CScriptCheck>* pvChecks,
+                       BatchSchnorrVerifier* batch)
 {
     if (tx.IsCoinBase()) return true;
 
@@ -2000,13 +2077,13 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
     // correct (ie that the transaction hash which is in tx's prevouts
     // properly commits to the scriptPubKey in the inputs view of that
     // transaction).
-    uint256 hashCacheEntry;
-    CSHA256 hasher = g_scriptExecutionCacheHasher;
-    hasher.Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
+    const uint256 hashCacheEntry = ScriptExecutionCacheEntry(tx, flags);
     AssertLockHeld(cs_main); //TODO: Remove this requirement by making CuckooCache not require external locks
     if (g_scriptExecutionCache.contains(hashCacheEntry, !cacheFullScriptStore)) {
+        g_scriptExecutionCacheHits.fetch_add(1, std::memory_order_relaxed);
         return true;
     }
+    g_scriptExecutionCacheMisses.fetch_add(1, std::memory_order_relaxed);
 
     if (!txdata.m_spent_outputs_ready) {
         std::vector<CTxOut> spent_outputs;
@@ -2031,7 +2108,7 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
         // spent being checked as a part of CScriptCheck.
 
         // Verify signature
-        CScriptCheck check(txdata.m_spent_outputs[i], tx, i, flags, cacheSigStore, &txdata);
+        CScriptCheck check(txdata.m_spent_outputs[i], tx, i, flags, cacheSigStore, &txdata, pvChecks ? nullptr : batch);
         if (pvChecks) {
             pvChecks->emplace_back(std::move(check));
         } else if (!check()) {
@@ -2075,10 +2152,13 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
         }
     }
 
-    if (cacheFullScriptStore && !pvChecks) {
+    if (cacheFullScriptStore && !pvChecks && !batch) {
         // We executed all of the provided scripts, and were told to
-        // cache the result. Do so now.
-        g_scriptExecutionCache.insert(hashCacheEntry);
+        // cache the result. Do so now. With a batch the signatures
+        // are not verified yet.
+        if (!g_scriptExecutionCache.insert(hashCacheEntry)) {
+            g_scriptExecutionCacheEvictions.fetch_add(1, std::memory_order_relaxed);
+        }
     }
 
     return true;
@@ -2125,9 +2205,70 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
+/**
+ * Hashes of the outpoints spent by the recent blocks of the active chain, by height. They are looked
+ * up before reading a block and its undo data from disk when searching for a spent stake coin, which
+ * otherwise reads every block down to the fork. Blocks that are not in the table, like those connected
+ * before startup, are read from disk. Hash collisions only cause a disk read.
+ */
+class RecentSpentOutpoints
+{
+public:
+    void Add(const CBlockIndex* pindex, const CBlock& block)
+    {
+        LOCK(m_mutex);
+        if(!m_hasher) m_hasher.emplace();
+        Entry& entry = m_entries[pindex->nHeight % RECENT_SPENT_OUTPOINTS_BLOCKS];
+        entry.height = pindex->nHeight;
+        entry.hash = pindex->GetBlockHash();
+        entry.spent.clear();
+        for(size_t j = 1; j < block.vtx.size(); ++j) {
+            for(const CTxIn& txin : block.vtx[j]->vin) {
+                entry.spent.push_back((*m_hasher)(txin.prevout));
+            }
+        }
+        std::sort(entry.spent.begin(), entry.spent.end());
+        entry.spent.shrink_to_fit();
+    }
+
+    void Remove(const CBlockIndex* pindex)
+    {
+        LOCK(m_mutex);
+        Entry& entry = m_entries[pindex->nHeight % RECENT_SPENT_OUTPOINTS_BLOCKS];
+        if(entry.height == pindex->nHeight && entry.hash == pindex->GetBlockHash())
+            entry = Entry();
+    }
+
+    /** Returns false if the block is not in the table, otherwise sets whether it may spend @p prevout */
+    bool Find(const CBlockIndex* pindex, const COutPoint& prevout, bool& maySpend) const
+    {
+        LOCK(m_mutex);
+        const Entry& entry = m_entries[pindex->nHeight % RECENT_SPENT_OUTPOINTS_BLOCKS];
+        if(!m_hasher || entry.height != pindex->nHeight || entry.hash != pindex->GetBlockHash())
+            return false;
+        maySpend = std::binary_search(entry.spent.begin(), entry.spent.end(), (*m_hasher)(prevout));
+        return true;
+    }
+
+private:
+    struct Entry {
+        int height{-1};
+        uint256 hash;
+        std::vector<uint64_t> spent;
+    };
+
+    mutable Mutex m_mutex;
+    //! Created on first use, the salt has to be drawn after the random generator is initialized
+    std::optional<SaltedOutpointHasher> m_hasher GUARDED_BY(m_mutex);
+    std::vector<Entry> m_entries GUARDED_BY(m_mutex){RECENT_SPENT_OUTPOINTS_BLOCKS};
+};
+
+static RecentSpentOutpoints recentSpentOutpoints;
+
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When FAILED is returned, view is left in an indeterminate state. */
-DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean)
+DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean,
+                                             ReorgDisconnect* reorg)
 {
     AssertLockHeld(::cs_main);
     if (pfClean)
@@ -2135,7 +2276,16 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
     bool fClean = true;
 
     CBlockUndo blockUndo;
-    if (!UndoReadFromDisk(blockUndo, pindex)) {
+    bool fUndoRead = false;
+    if (reorg) {
+        auto it = reorg->prefetched.find(pindex->GetBlockHash());
+        if (it != reorg->prefetched.end()) {
+            blockUndo = std::move(it->second.undo);
+            reorg->prefetched.erase(it);
+            fUndoRead = true;
+        }
+    }
+    if (!fUndoRead && !UndoReadFromDisk(blockUndo, pindex)) {
         error("DisconnectBlock(): failure reading undo data");
         return DISCONNECT_FAILED;
     }
@@ -2145,11 +2295,6 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
         return DISCONNECT_FAILED;
     }
 
-    /////////////////////////////////////////////////////////// // qtum
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    ///////////////////////////////////////////////////////////
-
     // Ignore blocks that contain transactions which are 'overwritten' by later transactions,
     // unless those are already completely spent.
     // See https://github.com/bitcoin/bitcoin/issues/22596 for additional information.
@@ -2181,29 +2326,6 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
             }
         }
 
-        /////////////////////////////////////////////////////////// // qtum
-        if (pfClean == NULL && fAddressIndex) {
-
-            for (unsigned int k = tx.vout.size(); k-- > 0;) {
-                const CTxOut &out = tx.vout[k];
-
-                CTxDestination dest;
-                if (ExtractDestination({hash, k}, out.scriptPubKey, dest)) {
-                    valtype bytesID(std::visit(DataVisitor(), dest));
-                    if(bytesID.empty()) {
-                        continue;
-                    }
-                    valtype addressBytes(32);
-                    std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(dest.index(), uint256(addressBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(dest.index(), uint256(addressBytes), hash, k), CAddressUnspentValue()));
-                }
-            }
-        }
-        ///////////////////////////////////////////////////////////
-
         // restore inputs
         if (i > 0) { // not coinbases
             CTxUndo &txundo = blockUndo.vtxundo[i-1];
@@ -2217,27 +2339,6 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
                 int res = ApplyTxInUndo(std::move(txundo.vprevout[j]), view, out);
                 if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
                 fClean = fClean && res != DISCONNECT_UNCLEAN;
-
-                if (pfClean == NULL && fAddressIndex) {
-                    const auto &undo = txundo.vprevout[j];
-                    const bool isTxCoinStake = tx.IsCoinStake();
-                    const CTxIn input = tx.vin[j];
-                    const CTxOut &prevout = view.GetOutputFor(input);
-
-                    CTxDestination dest;
-                    if (ExtractDestination(input.prevout, prevout.scriptPubKey, dest)) {
-                        valtype bytesID(std::visit(DataVisitor(), dest));
-                        if(bytesID.empty()) {
-                            continue;
-                        }
-                        valtype addressBytes(32);
-                        std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(dest.index(), uint256(addressBytes), pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(dest.index(), uint256(addressBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undo.nHeight, isTxCoinStake)));
-                    }
-                }
             }
             // At this point, all of txundo.vprevout should have been moved out.
         }
@@ -2246,49 +2347,94 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
-    globalState->setRoot(uintToh256(pindex->pprev->hashStateRoot)); // qtum
-    globalState->setRootUTXO(uintToh256(pindex->pprev->hashUTXORoot)); // qtum
+    GetDelegationCache().DisconnectBlock(pindex->hashStateRoot, pindex->pprev->hashStateRoot);
+
+    // In a reorg the roots are reset once to the fork point by FinishDisconnect
+    if (!reorg) {
+        m_chainman.Qtum().state->setRoot(uintToh256(pindex->pprev->hashStateRoot)); // qtum
+        m_chainman.Qtum().state->setRootUTXO(uintToh256(pindex->pprev->hashUTXORoot)); // qtum
+    }
 
     if(pfClean == NULL && fLogEvents){
-        pstorageresult->deleteResults(block.vtx);
-        m_blockman.m_block_tree_db->EraseHeightIndex(pindex->nHeight);
+        if (reorg) {
+            reorg->deleted_txs.insert(reorg->deleted_txs.end(), block.vtx.begin(), block.vtx.end());
+            reorg->deleted_heights.push_back(pindex->nHeight);
+        } else {
+            m_chainman.Qtum().storageResults->deleteResults(block.vtx);
+            m_blockman.m_qtum_index_db->EraseHeightIndex(pindex->nHeight);
+            m_blockman.m_qtum_index_db->EraseContractIndexes({(unsigned int)pindex->nHeight});
+        }
     }
 
     // The stake and delegate index is needed for MPoS, update it while MPoS is active
     const CChainParams& chainparams = Params();
     if(pindex->nHeight <= chainparams.GetConsensus().nLastMPoSBlock)
     {
-        m_blockman.m_block_tree_db->EraseStakeIndex(pindex->nHeight);
+        m_blockman.m_qtum_index_db->EraseStakeIndex(pindex->nHeight);
         if(pindex->IsProofOfStake() && pindex->HasProofOfDelegation())
-            m_blockman.m_block_tree_db->EraseDelegateIndex(pindex->nHeight);
+            m_blockman.m_qtum_index_db->EraseDelegateIndex(pindex->nHeight);
+        RemoveMPoSScriptFromCache(pindex);
     }
-
-    //////////////////////////////////////////////////// // qtum
-    if (pfClean == NULL && fAddressIndex) {
-        if (!m_blockman.m_block_tree_db->EraseAddressIndex(addressIndex)) {
-            error("Failed to delete address index");
-            return DISCONNECT_FAILED;
-        }
-        if (!m_blockman.m_block_tree_db->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            error("Failed to write address unspent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-    ////////////////////////////////////////////////////
+    recentSpentOutpoints.Remove(pindex);
 
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
 static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+static CCheckQueue<HeaderSignatureCheck> headersigcheckqueue(16);
 
 void StartScriptCheckWorkerThreads(int threads_num)
 {
     scriptcheckqueue.StartWorkerThreads(threads_num);
+    headersigcheckqueue.StartWorkerThreads(threads_num, "headsig");
+    StartCoinFetchThreads(threads_num);
 }
 
 void StopScriptCheckWorkerThreads()
 {
     scriptcheckqueue.StopWorkerThreads();
+    headersigcheckqueue.StopWorkerThreads();
+    StopCoinFetchThreads();
+}
+
+void PreverifyTxScripts(Chainstate& active_chainstate, const CTxMemPool& pool, const std::vector<CTransactionRef>& txs)
+{
+    if (!scriptcheckqueue.HasThreads()) return;
+
+    std::vector<PrecomputedTransactionData> txsdata(txs.size());
+    std::vector<CScriptCheck> checks;
+    {
+        LOCK2(cs_main, pool.cs);
+        CCoinsViewMemPool view(&active_chainstate.CoinsTip(), pool);
+        for (size_t i = 0; i < txs.size(); i++) {
+            const CTransaction& tx = *txs[i];
+            if (tx.IsCoinBase() || tx.IsCoinStake()) continue;
+
+            std::vector<CTxOut> spent_outputs;
+            spent_outputs.reserve(tx.vin.size());
+            for (const CTxIn& txin : tx.vin) {
+                Coin coin;
+                if (!view.GetCoin(txin.prevout, coin)) break;
+                spent_outputs.push_back(coin.out);
+            }
+            if (spent_outputs.size() != tx.vin.size()) continue;
+
+            txsdata[i].Init(tx, std::move(spent_outputs));
+            for (unsigned int n = 0; n < tx.vin.size(); n++) {
+                checks.emplace_back(txsdata[i].m_spent_outputs[n], tx, n, STANDARD_SCRIPT_VERIFY_FLAGS, /*cacheIn=*/true, &txsdata[i]);
+            }
+            for (unsigned int n = 0; n < tx.vout.size(); n++) {
+                if (tx.vout[n].scriptPubKey.HasOpSender()) {
+                    checks.emplace_back(tx, n, 0, /*cacheIn=*/true, &txsdata[i]);
+                }
+            }
+        }
+    }
+
+    // A failure only ends the verification early, the transactions are all verified again when accepted
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(std::move(checks));
+    control.Wait();
 }
 
 /**
@@ -2365,6 +2511,41 @@ static unsigned int GetBlockScriptFlags(const CBlockIndex& block_index, const Ch
     return flags;
 }
 
+/** Whether the scripts of @p block_index are not verified because it is an ancestor of the assumevalid block */
+static bool IsAssumedValid(const CBlockIndex& block_index, const ChainstateManager& chainman) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    if (!chainman.AssumedValidBlock().IsNull()) {
+        // We've been configured with the hash of a block which has been externally verified to have a valid history.
+        // A suitable default value is included with the software and updated from time to time.  Because validity
+        //  relative to a piece of software is an objective fact these defaults can be easily reviewed.
+        // This setting doesn't force the selection of any particular chain but makes validating some faster by
+        //  effectively caching the result of part of the verification.
+        BlockMap::const_iterator it{chainman.m_blockman.m_block_index.find(chainman.AssumedValidBlock())};
+        if (it != chainman.m_blockman.m_block_index.end()) {
+            if (it->second.GetAncestor(block_index.nHeight) == &block_index &&
+                chainman.m_best_header->GetAncestor(block_index.nHeight) == &block_index &&
+                chainman.m_best_header->nChainWork >= chainman.MinimumChainWork()) {
+                // This block is a member of the assumed verified chain and an ancestor of the best header.
+                // Script verification is skipped when connecting blocks under the
+                // assumevalid block. Assuming the assumevalid block is valid this
+                // is safe because block merkle hashes are still computed and checked,
+                // Of course, if an assumed valid block is invalid due to false scriptSigs
+                // this optimization would allow an invalid chain to be accepted.
+                // The equivalent time check discourages hash power from extorting the network via DOS attack
+                //  into accepting an invalid block through telling users they must manually set assumevalid.
+                //  Requiring a software change or burying the invalid block, regardless of the setting, makes
+                //  it hard to hide the implication of the demand.  This also avoids having release candidates
+                //  that are hardly doing any signature verification at all in testing without having to
+                //  artificially set the default assumed verified block further back.
+                // The test against the minimum chain work prevents the skipping when denied access to any chain at
+                //  least as good as the expected chain.
+                return GetBlockProofEquivalentTime(*chainman.m_best_header, block_index, *chainman.m_best_header, chainman.GetConsensus()) > 60 * 60 * 24 * 7 * 2;
+            }
+        }
+    }
+    return false;
+}
+
 unsigned int GetContractScriptFlags(int nHeight, const Consensus::Params& consensusparams) {
     unsigned int flags = SCRIPT_EXEC_BYTE_CODE;
 
@@ -2383,6 +2564,7 @@ static SteadyClock::duration time_connect{};
 static SteadyClock::duration time_verify{};
 static SteadyClock::duration time_undo{};
 static SteadyClock::duration time_index{};
+static SteadyClock::duration time_contracts{};
 static SteadyClock::duration time_total{};
 static int64_t num_blocks_total = 0;
 
@@ -2451,7 +2633,9 @@ bool GetSpentCoinFromMainChain(const CBlockIndex* pforkPrev, COutPoint prevoutSt
     {
         CBlockIndex* pindex = chain.Tip();
         while(pindex && pindex != pforkBase) {
-            if(GetSpentCoinFromBlock(pindex, prevoutStake, coin)) {
+            bool maySpend = true;
+            recentSpentOutpoints.Find(pindex, prevoutStake, maySpend);
+            if(maySpend && GetSpentCoinFromBlock(pindex, prevoutStake, coin)) {
                 return true;
             }
             pindex = pindex->pprev;
@@ -2533,11 +2717,9 @@ bool CheckSenderScript(const CCoinsViewCache& view, const CTransaction& tx){
     return true;
 }
 
-std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::vector<unsigned char> opcode, Chainstate& chainstate, const dev::Address& sender, uint64_t gasLimit, CAmount nAmount){
-    CBlock block;
-    CMutableTransaction tx;
-
-    CBlockIndex* pblockindex = &(chainstate.m_blockman.m_block_index[chainstate.m_chain.Tip()->GetBlockHash()]);
+/** Block template for read-only calls: the tip with its coinstake/coinbase only, at the current time */
+static void PrepareCallBlock(Chainstate& chainstate, CBlock& block, CBlockIndex*& pblockindex, uint64_t& blockGasLimit){
+    pblockindex = &(chainstate.m_blockman.m_block_index[chainstate.m_chain.Tip()->GetBlockHash()]);
     ReadBlockFromDisk(block, pblockindex, Params().GetConsensus());
     block.nTime = GetAdjustedTimeSeconds();
 
@@ -2546,37 +2728,51 @@ std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::v
     else
     	block.vtx.erase(block.vtx.begin()+1,block.vtx.end());
 
-    QtumDGP qtumDGP(globalState.get(), chainstate, fGettingValuesDGP);
-    uint64_t blockGasLimit = qtumDGP.getBlockGasLimit(chainstate.m_chain.Tip()->nHeight + 1);
+    QtumDGP qtumDGP(chainstate.m_chainman.Qtum().state.get(), chainstate, fGettingValuesDGP);
+    blockGasLimit = qtumDGP.getBlockGasLimit(chainstate.m_chain.Tip()->nHeight + 1);
+}
 
+static QtumTransaction MakeCallTransaction(const ContractCall& call, CBlock& block, uint64_t blockGasLimit, const QtumState& state){
+    CMutableTransaction tx;
+    uint64_t gasLimit = call.gasLimit;
     if(gasLimit == 0){
         gasLimit = blockGasLimit - 1;
     }
-    dev::Address senderAddress = sender == dev::Address() ? dev::Address("ffffffffffffffffffffffffffffffffffffffff") : sender;
-    tx.vout.push_back(CTxOut(nAmount, CScript() << OP_DUP << OP_HASH160 << senderAddress.asBytes() << OP_EQUALVERIFY << OP_CHECKSIG));
-    block.vtx.push_back(MakeTransactionRef(CTransaction(tx)));
-    dev::u256 nonce = globalState->getNonce(senderAddress);
- 
+    dev::Address senderAddress = call.sender == dev::Address() ? dev::Address("ffffffffffffffffffffffffffffffffffffffff") : call.sender;
+    tx.vout.push_back(CTxOut(call.nAmount, CScript() << OP_DUP << OP_HASH160 << senderAddress.asBytes() << OP_EQUALVERIFY << OP_CHECKSIG));
+    block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+    dev::u256 nonce = state.getNonce(senderAddress);
+
     QtumTransaction callTransaction;
-    if(addrContract == dev::Address())
+    if(call.addrContract == dev::Address())
     {
-        callTransaction = QtumTransaction(nAmount, 1, dev::u256(gasLimit), opcode, nonce);
+        callTransaction = QtumTransaction(call.nAmount, 1, dev::u256(gasLimit), call.opcode, nonce);
     }
     else
     {
-        callTransaction = QtumTransaction(nAmount, 1, dev::u256(gasLimit), addrContract, opcode, nonce);
+        callTransaction = QtumTransaction(call.nAmount, 1, dev::u256(gasLimit), call.addrContract, call.opcode, nonce);
     }
     callTransaction.forceSender(senderAddress);
     callTransaction.setVersion(VersionVM::GetEVMDefault());
+    return callTransaction;
+}
 
-    
-    ByteCodeExec exec(block, std::vector<QtumTransaction>(1, callTransaction), blockGasLimit, pblockindex, chainstate.m_chain);
+std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::vector<unsigned char> opcode, Chainstate& chainstate, const dev::Address& sender, uint64_t gasLimit, CAmount nAmount){
+    CBlock block;
+    CBlockIndex* pblockindex = nullptr;
+    uint64_t blockGasLimit = 0;
+    PrepareCallBlock(chainstate, block, pblockindex, blockGasLimit);
+
+    std::vector<QtumTransaction> txs;
+    txs.push_back(MakeCallTransaction(ContractCall{addrContract, std::move(opcode), sender, gasLimit, nAmount}, block, blockGasLimit, *chainstate.m_chainman.Qtum().state));
+
+    ByteCodeExec exec(block, std::move(txs), blockGasLimit, pblockindex, chainstate.m_chain, chainstate.m_chainman.Qtum());
     exec.performByteCode(dev::eth::Permanence::Reverted);
     return exec.getResult();
 }
 
-bool CheckMinGasPrice(std::vector<EthTransactionParams>& etps, const uint64_t& minGasPrice){
-    for(EthTransactionParams& etp : etps){
+bool CheckMinGasPrice(const std::vector<EthTransactionParams>& etps, const uint64_t& minGasPrice){
+    for(const EthTransactionParams& etp : etps){
         if(etp.gasPrice < dev::u256(minGasPrice))
             return false;
     }
@@ -2683,7 +2879,7 @@ valtype GetSenderAddress(const CTransaction& tx, const CCoinsViewCache* coinsVie
 
     // Check the current (or in-progress) block for zero-confirmation change spending that won't yet be in txindex
     if(!scriptFilled && blockTxs){
-        for(auto btx : *blockTxs){
+        for(const auto& btx : *blockTxs){
             if(btx->GetHash() == tx.vin[0].prevout.hash){
                 script = btx->vout[tx.vin[0].prevout.n].scriptPubKey;
                 scriptFilled=true;
@@ -2721,112 +2917,246 @@ valtype GetSenderAddress(const CTransaction& tx, const CCoinsViewCache* coinsVie
     return valtype();
 }
 
-UniValue vmLogToJSON(const ResultExecute& execRes, const CTransaction& tx, const CBlock& block, CChain& chain){
-    UniValue result(UniValue::VOBJ);
+void writeVMlog(const std::vector<ResultExecute>& res, CChain& chain, const CTransaction& tx, const CBlock& block){
+    if(!g_vmlog_writer) return;
+
+    // Only the copies are made here, the log is formatted and written by the VM log writer thread
+    std::optional<uint256> txid;
     if(tx != CTransaction())
-        result.pushKV("txid", tx.GetHash().GetHex());
-    result.pushKV("address", execRes.execRes.newAddress.hex());
-    if(block.GetHash() != CBlock().GetHash()){
-        result.pushKV("time", block.GetBlockTime());
-        result.pushKV("blockhash", block.GetHash().GetHex());
-        result.pushKV("blockheight", chain.Tip()->nHeight + 1);
-    } else {
-        result.pushKV("time", GetAdjustedTimeSeconds());
-        result.pushKV("blockheight", chain.Tip()->nHeight);
-    }
-    UniValue logEntries(UniValue::VARR);
-    dev::eth::LogEntries logs = execRes.txRec.log();
-    for(dev::eth::LogEntry log : logs){
-        UniValue logEntrie(UniValue::VOBJ);
-        logEntrie.pushKV("address", log.address.hex());
-        UniValue topics(UniValue::VARR);
-        for(dev::h256 l : log.topics){
-            UniValue topicPair(UniValue::VOBJ);
-            topicPair.pushKV("raw", l.hex());
-            topics.push_back(topicPair);
-            //TODO add "pretty" field for human readable data
-        }
-        UniValue dataPair(UniValue::VOBJ);
-        dataPair.pushKV("raw", HexStr(log.data));
-        logEntrie.pushKV("data", dataPair);
-        logEntrie.pushKV("topics", topics);
-        logEntries.push_back(logEntrie);
-    }
-    result.pushKV("entries", logEntries);
-    return result;
+        txid = tx.GetHash();
+    std::optional<uint256> blockHash;
+    const uint256 hash = block.GetHash();
+    if(hash != CBlock().GetHash())
+        blockHash = hash;
+    std::vector<VMLogRecord> records;
+    records.reserve(res.size());
+    for(const ResultExecute& execRes : res){
+        VMLogRecord& record = records.emplace_back();
+        record.txid = txid;
+        record.address = execRes.execRes.newAddress;
+        record.time = blockHash ? block.GetBlockTime() : GetAdjustedTimeSeconds();
+        record.block_hash = blockHash;
+        record.block_height = blockHash ? chain.Tip()->nHeight + 1 : chain.Tip()->nHeight;
+        record.logs = execRes.txRec.log();
+    }
+    g_vmlog_writer->Enqueue(std::move(records));
 }
 
-void writeVMlog(const std::vector<ResultExecute>& res, CChain& chain, const CTransaction& tx, const CBlock& block){
-    fs::path qtumDir = gArgs.GetDataDirNet() / "vmExecLogs.json";
-    std::stringstream ss;
-    if(fIsVMlogFile){
-        ss << ",";
-    } else {
-        std::ofstream file(PathToString(qtumDir), std::ios::out | std::ios::app);
-        file << "{\"logs\":[]}";
-        file.close();
-    }
+namespace {
+/**
+ * The hashes of the last blocks of the chain ending at the tip of the latest environment, by height.
+ * The tip is kept by hash and height, never as a block index pointer, as the stale block indexes
+ * may be erased and their memory reused while the window still refers to them.
+ */
+class BlockHashWindow
+{
+public:
+    static constexpr int SIZE{256};
 
-    for(size_t i = 0; i < res.size(); i++){
-        ss << vmLogToJSON(res[i], tx, block, chain).write();
-        if(i != res.size() - 1){
-            ss << ",";
+    /** Move the window to @p tip, by one block when it is a child or the parent of the current tip */
+    void MoveTo(const CBlockIndex* tip) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        if (!tip) {
+            m_count = 0;
+            return;
+        }
+        const dev::h256 hash{uintToh256(tip->GetBlockHash())};
+        if (m_count > 0 && tip->nHeight == m_height && hash == m_hashes[m_height % SIZE]) return;
+        if (m_count > 0 && tip->nHeight == m_height + 1 && tip->pprev && uintToh256(tip->pprev->GetBlockHash()) == m_hashes[m_height % SIZE]) {
+            m_hashes[tip->nHeight % SIZE] = hash;
+            m_count = std::min(m_count + 1, SIZE);
+        } else if (m_count > 1 && tip->nHeight == m_height - 1 && hash == m_hashes[tip->nHeight % SIZE]) {
+            m_count -= 1;
         } else {
-            ss << "]}";
+            m_count = 0;
+            for (const CBlockIndex* pindex = tip; pindex && m_count < SIZE; pindex = pindex->pprev) {
+                m_hashes[pindex->nHeight % SIZE] = uintToh256(pindex->GetBlockHash());
+                ++m_count;
+            }
         }
+        m_height = tip->nHeight;
     }
-    
-    std::ofstream file(PathToString(qtumDir), std::ios::in | std::ios::out);
-    file.seekp(-2, std::ios::end);
-    file << ss.str();
-    file.close();
-    fIsVMlogFile = true;
-}
+
+    /** The hash of the ancestor at @p height of the tip @p tip_hash at @p tip_height, if the window is at that tip and holds it */
+    std::optional<dev::h256> Get(const dev::h256& tip_hash, int tip_height, int height) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        if (m_count == 0 || tip_height != m_height || tip_hash != m_hashes[m_height % SIZE]) return std::nullopt;
+        if (height > m_height || height <= m_height - m_count) return std::nullopt;
+        return m_hashes[height % SIZE];
+    }
+
+private:
+    mutable Mutex m_mutex;
+    //! Height of the tip of the window, whose hash is the one held at that height
+    int m_height GUARDED_BY(m_mutex){-1};
+    //! Number of hashes of the ancestors of the tip, the tip included, held by the window
+    int m_count GUARDED_BY(m_mutex){0};
+    std::array<dev::h256, SIZE> m_hashes GUARDED_BY(m_mutex);
+};
+
+BlockHashWindow g_block_hash_window;
+} // namespace
 
 LastHashes::LastHashes()
 {}
 
 void LastHashes::set(const CBlockIndex *tip)
 {
-    clear();
+    m_tip = tip;
+    m_tip_hash = tip ? uintToh256(tip->GetBlockHash()) : dev::h256();
+    g_block_hash_window.MoveTo(tip);
+}
 
-    m_lastHashes.resize(256);
-    for(int i=0;i<256;i++){
-        if(!tip)
-            break;
-        m_lastHashes[i]= uintToh256(*tip->phashBlock);
-        tip = tip->pprev;
+dev::h256s LastHashes::precedingHashes(const dev::h256 &mostRecentHash) const
+{
+    dev::h256s hashes(BlockHashWindow::SIZE);
+    for(unsigned i = 0; i < hashes.size(); i++){
+        hashes[i] = precedingHash(mostRecentHash, i);
     }
+    return hashes;
 }
 
-dev::h256s LastHashes::precedingHashes(const dev::h256 &) const
+dev::h256 LastHashes::precedingHash(const dev::h256 &, unsigned index) const
 {
-    return m_lastHashes;
+    if(!m_tip || index >= (unsigned)BlockHashWindow::SIZE || (int)index > m_tip->nHeight)
+        return dev::h256();
+    const int height = m_tip->nHeight - index;
+    if(std::optional<dev::h256> hash = g_block_hash_window.Get(m_tip_hash, m_tip->nHeight, height))
+        return *hash;
+    // The window moved on to another tip since the environment was built
+    return uintToh256(m_tip->GetAncestor(height)->GetBlockHash());
 }
 
 void LastHashes::clear()
 {
-    m_lastHashes.clear();
+    m_tip = nullptr;
+    m_tip_hash = dev::h256();
 }
 
 bool ByteCodeExec::performByteCode(dev::eth::Permanence type){
+    AllocScope alloc_scope{AllocTag::EVM};
+    if(resultCache && !flushState && type == dev::eth::Permanence::Committed){
+        return executeCached();
+    }
+    if(reconnect && type == dev::eth::Permanence::Committed && reconnect->Apply(txs, *state, *sealEngine, result)){
+        if(flushState){
+            state->commitDB();
+        }
+        return true;
+    }
+    if(!speculation || type != dev::eth::Permanence::Committed){
+        return executeConnected(type);
+    }
+
+    if(speculation->Apply(txs, result)){
+        return true;
+    }
+
+    // The speculative result could not be used, execute the usual way and remember
+    // what was touched so later speculative results are checked against it
+    dev::AddressHash accessedAccounts, accessedVins;
+    state->setAccessedAddresses(&accessedAccounts);
+    state->setAccessedVins(&accessedVins);
+    bool ret = executeConnected(type);
+    state->setAccessedAddresses(nullptr);
+    state->setAccessedVins(nullptr);
+    speculation->NoteAccessed(accessedAccounts, accessedVins);
+    return ret;
+}
+
+bool ByteCodeExec::executeCached(){
+    if(txs.empty()){
+        return executeTransactions(dev::eth::Permanence::Committed);
+    }
+    dev::eth::EnvInfo envInfo(BuildEVMEnvironment());
+    if(resultCache->Apply(txs, envInfo, *state, *sealEngine, result)){
+        return true;
+    }
+
+    // Execute with the write sets captured and remember what was read, for the next templates
+    const QtumState::Checkpoint before = state->checkpoint();
+    std::vector<ExecutionWriteSet> captured;
+    dev::AddressHash accessedAccounts, accessedVins;
+    bool contextRead = false;
+    writeSets = &captured;
+    blockContextRead = &contextRead;
+    state->setAccessedAddresses(&accessedAccounts);
+    state->setAccessedVins(&accessedVins);
+    bool ret = executeTransactions(dev::eth::Permanence::Committed);
+    state->setAccessedAddresses(nullptr);
+    state->setAccessedVins(nullptr);
+    writeSets = nullptr;
+    blockContextRead = nullptr;
+    if(ret){
+        resultCache->Store(txs, envInfo, contextRead, *state, before, accessedAccounts, accessedVins, result, std::move(captured));
+    }
+    return ret;
+}
+
+bool ByteCodeExec::executeConnected(dev::eth::Permanence type){
+    if(!connected || writeSets || type != dev::eth::Permanence::Committed){
+        return executeTransactions(type);
+    }
+
+    // Capture the write sets, so that the block is connected again without executing the transactions
+    std::vector<ExecutionWriteSet> captured;
+    writeSets = &captured;
+    bool ret = executeTransactions(type);
+    writeSets = nullptr;
+    if(ret){
+        if(flushState){
+            state->commitDB();
+        }
+        connected->Add(txs, result, std::move(captured));
+    }
+    return ret;
+}
+
+void ByteCodeExec::setExecutionContext(QtumState* _state, dev::eth::SealEngineFace* _sealEngine, std::vector<ExecutionWriteSet>* _writeSets){
+    state = _state;
+    sealEngine = _sealEngine;
+    writeSets = _writeSets;
+}
+
+bool ByteCodeExec::executeTransactions(dev::eth::Permanence type){
+    if(writeSets){
+        // write set pointers handed to the state must stay valid
+        writeSets->reserve(writeSets->size() + txs.size());
+    }
     for(QtumTransaction& tx : txs){
         //validate VM version
         if(tx.getVersion().toRaw() != VersionVM::GetEVMDefault().toRaw()){
+            state->setWriteSetCapture(nullptr);
             return false;
         }
         dev::eth::EnvInfo envInfo(BuildEVMEnvironment());
-        if(!tx.isCreation() && !globalState->addressInUse(tx.receiveAddress())){
+        envInfo.setBlockContextRead(blockContextRead);
+        if(writeSets){
+            writeSets->emplace_back();
+            state->setWriteSetCapture(&writeSets->back());
+        }
+        if(!tx.isCreation() && !state->addressInUse(tx.receiveAddress())){
             dev::eth::ExecutionResult execRes;
             execRes.excepted = dev::eth::TransactionException::Unknown;
             result.push_back(ResultExecute{execRes, QtumTransactionReceipt(dev::h256(), dev::h256(), dev::u256(), dev::eth::LogEntries()), CTransaction()});
+            if(writeSets){
+                // nothing is committed for a call to an unused address
+                writeSets->back().complete = true;
+            }
             continue;
         }
-        result.push_back(globalState->execute(envInfo, *globalSealEngine.get(), tx, chain, type, OnOpFunc()));
+        const auto time_start{SteadyClock::now()};
+        result.push_back(state->execute(envInfo, *sealEngine, tx, chainHeight ? *chainHeight : chain.Height(), type, OnOpFunc()));
+        // Creations are learned into the average rate only
+        ContractExecTimeModel::instance().Record(tx.isCreation() ? dev::Address() : tx.receiveAddress(), uint64_t(result.back().execRes.gasUsed), SteadyClock::now() - time_start);
     }
-    globalState->db().commit();
-    globalState->dbUtxo().commit();
-    globalSealEngine.get()->deleteAddresses.clear();
+    state->setWriteSetCapture(nullptr);
+    if(!writeSets && flushState){
+        state->commitDB();
+    }
+    sealEngine->deleteAddresses.clear();
     return true;
 }
 
@@ -2842,7 +3172,7 @@ bool ByteCodeExec::processingResults(ByteCodeExecResult& resultBCE){
         		tx.vin.push_back(CTxIn(h256Touint(txs[i].getHashWith()), txs[i].getNVout(), CScript() << OP_SPEND));
         		CScript script(CScript() << OP_DUP << OP_HASH160 << txs[i].sender().asBytes() << OP_EQUALVERIFY << OP_CHECKSIG);
         		tx.vout.push_back(CTxOut(CAmount(txs[i].value()), script));
-        		resultBCE.valueTransfers.push_back(CTransaction(tx));
+        		resultBCE.valueTransfers.emplace_back(std::move(tx));
         	}
         	if(!(chain.Height() >= consensusParams.QIP7Height && result[i].execRes.excepted == dev::eth::TransactionException::RevertInstruction)){
         	resultBCE.usedGas += gasUsed;
@@ -2894,7 +3224,7 @@ dev::eth::EnvInfo ByteCodeExec::BuildEVMEnvironment(){
         header.setAuthor(EthAddrFromScript(block.vtx[0]->vout[0].scriptPubKey));
     }
     dev::u256 gasUsed;
-    int &chainID = const_cast<int&>(globalSealEngine->chainParams().chainID);
+    int &chainID = const_cast<int&>(sealEngine->chainParams().chainID);
     chainID = qtumutils::eth_getChainId(tip->nHeight);
     dev::eth::EnvInfo env(header, lastHashes, gasUsed, chainID);
     return env;
@@ -2915,6 +3245,606 @@ dev::Address ByteCodeExec::EthAddrFromScript(const CScript& script){
     return dev::Address();
 }
 
+/** Speculative execution of the contract outputs of one transaction on a contract execution thread */
+class CContractExecCheck
+{
+private:
+    SpeculativeContractTx* job{nullptr};
+    const CBlock* block{nullptr};
+    uint64_t blockGasLimit{0};
+    CBlockIndex* pindex{nullptr};
+    CChain* chain{nullptr};
+    QtumContext* qtum{nullptr};
+
+public:
+    CContractExecCheck() = default;
+    CContractExecCheck(SpeculativeContractTx* _job, const CBlock& _block, uint64_t _blockGasLimit, CBlockIndex* _pindex, CChain& _chain, QtumContext& _qtum) :
+        job(_job), block(&_block), blockGasLimit(_blockGasLimit), pindex(_pindex), chain(&_chain), qtum(&_qtum) {}
+
+    bool operator()()
+    {
+        job->state->setAccessedAddresses(&job->accessedAccounts);
+        job->state->setAccessedVins(&job->accessedVins);
+        try {
+            ByteCodeExec exec(*block, job->txs, blockGasLimit, pindex, *chain, *qtum);
+            exec.setExecutionContext(job->state.get(), job->sealEngine.get(), &job->writeSets);
+            job->executed = exec.performByteCode();
+            job->result = std::move(exec.getResult());
+        } catch (const std::exception& e) {
+            LogPrintf("%s: speculative contract execution failed: %s\n", __func__, e.what());
+            job->executed = false;
+        }
+        job->state->setAccessedAddresses(nullptr);
+        job->state->setAccessedVins(nullptr);
+        // A failed speculation only means the transaction is executed again in block order
+        return true;
+    }
+};
+
+static CCheckQueue<CContractExecCheck> contractexecqueue(1);
+
+
+static bool IsSameContractExecution(const QtumTransaction& a, const QtumTransaction& b)
+{
+    return a.getHashWith() == b.getHashWith() && a.getNVout() == b.getNVout() &&
+        a.getVersion().toRaw() == b.getVersion().toRaw() && a.isCreation() == b.isCreation() &&
+        a.sender() == b.sender() && a.getRefundSender() == b.getRefundSender() &&
+        a.receiveAddress() == b.receiveAddress() && a.value() == b.value() &&
+        a.gas() == b.gas() && a.gasPrice() == b.gasPrice() && a.data() == b.data();
+}
+
+ContractExecSpeculation::ContractExecSpeculation(const CBlock& _block, const uint64_t _blockGasLimit, CBlockIndex* _pindex, CChain& _chain, QtumContext& _qtum) :
+    block(_block), blockGasLimit(_blockGasLimit), pindex(_pindex), chain(_chain), qtum(_qtum), base(*_qtum.state) {}
+
+void ContractExecSpeculation::Add(std::vector<QtumTransaction>&& txs){
+    if(txs.empty())
+        return;
+    SpeculativeContractTx& job = jobs[txs.front().getHashWith()];
+    job.txs = std::move(txs);
+}
+
+void ContractExecSpeculation::Run(){
+    if(jobs.size() < 2 || !contractexecqueue.HasThreads()){
+        // Nothing to gain over executing in block order
+        jobs.clear();
+        return;
+    }
+
+    std::vector<CContractExecCheck> checks;
+    checks.reserve(jobs.size());
+    for(auto& entry : jobs){
+        SpeculativeContractTx& job = entry.second;
+        job.state = std::make_unique<QtumState>(base);
+        job.sealEngine.reset(dev::eth::SealEngineRegistrar::create(qtum.sealEngine->chainParams()));
+        job.sealEngine->setQtumSchedule(qtum.sealEngine->getQtumSchedule());
+        checks.emplace_back(&job, block, blockGasLimit, pindex, chain, qtum);
+    }
+
+    CCheckQueueControl<CContractExecCheck> control(&contractexecqueue);
+    control.Add(std::move(checks));
+    control.Wait();
+
+    for(auto& entry : jobs){
+        // The private states are not needed anymore, only their write sets
+        entry.second.state.reset();
+        entry.second.sealEngine.reset();
+    }
+}
+
+/** One call of CallContracts, with the private state and seal engine it runs on */
+struct ContractCallJob{
+    CBlock block;
+    std::vector<QtumTransaction> txs;
+    std::unique_ptr<QtumState> state;
+    std::unique_ptr<dev::eth::SealEngineFace> sealEngine;
+    std::vector<ResultExecute> result;
+};
+
+class CContractCallCheck
+{
+private:
+    ContractCallJob* job{nullptr};
+    const ContractCallSnapshot* snapshot{nullptr};
+
+public:
+    CContractCallCheck() = default;
+    CContractCallCheck(ContractCallJob* _job, const ContractCallSnapshot& _snapshot) :
+        job(_job), snapshot(&_snapshot) {}
+
+    bool operator()()
+    {
+        try {
+            // The write sets are not used, they keep the private state from committing to the shared databases
+            std::vector<ExecutionWriteSet> writeSets;
+            ByteCodeExec exec(job->block, std::move(job->txs), snapshot->blockGasLimit, snapshot->pindex, snapshot->chain, *snapshot->qtum);
+            exec.setExecutionContext(job->state.get(), job->sealEngine.get(), &writeSets);
+            exec.setChainHeight(snapshot->pindex->nHeight);
+            exec.performByteCode(dev::eth::Permanence::Reverted);
+            job->result = std::move(exec.getResult());
+        } catch (const std::exception& e) {
+            LogPrintf("%s: contract call failed: %s\n", __func__, e.what());
+            job->result.clear();
+        }
+        return true;
+    }
+};
+
+static CCheckQueue<CContractCallCheck> contractcallqueue(1);
+
+static Mutex cs_callsnapshot;
+static std::shared_ptr<const ContractCallSnapshot> callSnapshot GUARDED_BY(cs_callsnapshot);
+
+static Mutex cs_gasestimates;
+static const CBlockIndex* gasEstimatesTip GUARDED_BY(cs_gasestimates){nullptr};
+static std::map<uint256, GasEstimate> gasEstimates GUARDED_BY(cs_gasestimates);
+
+std::shared_ptr<const ContractCallSnapshot> GetContractCallSnapshot(Chainstate& chainstate){
+    LOCK(cs_main);
+    CBlockIndex* pindex = chainstate.m_chain.Tip();
+    {
+        LOCK(cs_callsnapshot);
+        if(callSnapshot && callSnapshot->pindex == pindex)
+            return callSnapshot;
+    }
+
+    auto snapshot = std::make_shared<ContractCallSnapshot>(chainstate.m_chainman.m_options.qtum_context, pindex, chainstate.m_chain);
+    CBlockIndex* pblockindex = nullptr;
+    PrepareCallBlock(chainstate, snapshot->block, pblockindex, snapshot->blockGasLimit);
+    snapshot->schedule = snapshot->qtum->sealEngine->getQtumSchedule();
+
+    LOCK(cs_callsnapshot);
+    callSnapshot = snapshot;
+    return snapshot;
+}
+
+void ResetContractCallSnapshot(){
+    {
+        LOCK(cs_gasestimates);
+        gasEstimates.clear();
+        gasEstimatesTip = nullptr;
+    }
+    LOCK(cs_callsnapshot);
+    callSnapshot.reset();
+}
+
+std::vector<std::vector<ResultExecute>> CallContracts(const std::vector<ContractCall>& calls, const ContractCallSnapshot& snapshot){
+    std::vector<ContractCallJob> jobs(calls.size());
+    std::vector<CContractCallCheck> checks;
+    checks.reserve(calls.size());
+    for(size_t i = 0; i < calls.size(); i++){
+        ContractCallJob& job = jobs[i];
+        job.block = snapshot.block;
+        job.block.nTime = GetAdjustedTimeSeconds();
+        job.state = snapshot.view.makeState();
+        job.txs.push_back(MakeCallTransaction(calls[i], job.block, snapshot.blockGasLimit, *job.state));
+        job.sealEngine.reset(dev::eth::SealEngineRegistrar::create(snapshot.qtum->sealEngine->chainParams()));
+        job.sealEngine->setQtumSchedule(snapshot.schedule);
+        checks.emplace_back(&job, snapshot);
+    }
+
+    if(contractcallqueue.HasThreads() && checks.size() > 1){
+        CCheckQueueControl<CContractCallCheck> control(&contractcallqueue);
+        control.Add(std::move(checks));
+        control.Wait();
+    } else {
+        for(CContractCallCheck& check : checks){
+            check();
+        }
+    }
+
+    std::vector<std::vector<ResultExecute>> results;
+    results.reserve(jobs.size());
+    for(ContractCallJob& job : jobs){
+        results.push_back(std::move(job.result));
+    }
+    return results;
+}
+
+std::optional<GasEstimate> EstimateGas(const ContractCall& call, const ContractCallSnapshot& snapshot){
+    HashWriter hasher{};
+    hasher << call.addrContract.asBytes() << call.opcode << call.sender.asBytes() << call.gasLimit << call.nAmount;
+    const uint256 key = hasher.GetHash();
+    {
+        LOCK(cs_gasestimates);
+        if(gasEstimatesTip != snapshot.pindex){
+            gasEstimates.clear();
+            gasEstimatesTip = snapshot.pindex;
+        }
+        auto it = gasEstimates.find(key);
+        if(it != gasEstimates.end()){
+            GasEstimate estimate = it->second;
+            estimate.trials = 0;
+            return estimate;
+        }
+    }
+
+    CBlock block = snapshot.block;
+    block.nTime = GetAdjustedTimeSeconds();
+    std::unique_ptr<QtumState> state = snapshot.view.makeState();
+    const QtumState::Checkpoint checkpoint = state->checkpoint();
+    std::unique_ptr<dev::eth::SealEngineFace> sealEngine(dev::eth::SealEngineRegistrar::create(snapshot.qtum->sealEngine->chainParams()));
+    sealEngine->setQtumSchedule(snapshot.schedule);
+
+    unsigned trials = 0;
+    auto run = [&](uint64_t gasLimit) -> std::optional<ResultExecute> {
+        trials++;
+        ContractCall trial = call;
+        trial.gasLimit = gasLimit;
+        CBlock trialBlock = block;
+        std::vector<QtumTransaction> txs{MakeCallTransaction(trial, trialBlock, snapshot.blockGasLimit, *state)};
+        std::vector<ResultExecute> result;
+        try {
+            std::vector<ExecutionWriteSet> writeSets;
+            ByteCodeExec exec(trialBlock, std::move(txs), snapshot.blockGasLimit, snapshot.pindex, snapshot.chain, *snapshot.qtum);
+            exec.setExecutionContext(state.get(), sealEngine.get(), &writeSets);
+            exec.setChainHeight(snapshot.pindex->nHeight);
+            exec.performByteCode(dev::eth::Permanence::Reverted);
+            result = std::move(exec.getResult());
+        } catch (const std::exception& e) {
+            LogPrintf("%s: contract call failed: %s\n", __func__, e.what());
+        }
+        // Nothing of the trial is kept for the next one
+        state->revertToCheckpoint(checkpoint);
+        sealEngine->deleteAddresses.clear();
+        if(result.empty())
+            return std::nullopt;
+        return std::move(result[0]);
+    };
+    auto succeeds = [&](uint64_t gasLimit) {
+        std::optional<ResultExecute> result = run(gasLimit);
+        return result && result->execRes.excepted == dev::eth::TransactionException::None;
+    };
+
+    const uint64_t cap = call.gasLimit ? call.gasLimit : snapshot.blockGasLimit - 1;
+    std::optional<ResultExecute> first = run(cap);
+    if(!first)
+        return std::nullopt;
+    uint64_t lowestGasLimit = 0;
+    if(first->execRes.excepted == dev::eth::TransactionException::None){
+        // The call needs more than the gas it used, for the refunds and the gas held back from nested calls,
+        // so the search starts with a guess above that and ends with the lowest limit that succeeds
+        const uint64_t gasUsed = uint64_t(first->execRes.gasUsed);
+        uint64_t lo = gasUsed > 0 ? gasUsed - 1 : 0;
+        uint64_t hi = cap;
+        const uint64_t guess = std::min<uint64_t>(cap, (gasUsed + uint64_t(first->execRes.gasRefunded)) * 64 / 63);
+        auto narrow = [&](uint64_t gasLimit) {
+            if(succeeds(gasLimit))
+                hi = gasLimit;
+            else
+                lo = gasLimit;
+        };
+        if(guess > lo && guess < hi)
+            narrow(guess);
+        while(hi - lo > 1)
+            narrow(lo + (hi - lo) / 2);
+        lowestGasLimit = hi;
+    }
+    GasEstimate estimate{lowestGasLimit, std::move(*first), trials};
+
+    LOCK(cs_gasestimates);
+    if(gasEstimatesTip == snapshot.pindex){
+        if(gasEstimates.size() >= MAX_GAS_ESTIMATE_CACHE)
+            gasEstimates.erase(gasEstimates.begin());
+        gasEstimates.emplace(key, estimate);
+    }
+    return estimate;
+}
+
+void StartContractExecWorkerThreads(int threads_num)
+{
+    contractexecqueue.StartWorkerThreads(threads_num, "contrexec", SyscallSandboxPolicy::VALIDATION_CONTRACT_EXEC);
+    // Separate threads for the RPC calls, which should not hold back block validation
+    contractcallqueue.StartWorkerThreads(threads_num, "contrcall", SyscallSandboxPolicy::VALIDATION_CONTRACT_EXEC);
+}
+
+void StopContractExecWorkerThreads()
+{
+    contractexecqueue.StopWorkerThreads();
+    contractcallqueue.StopWorkerThreads();
+}
+
+bool ContractExecSpeculation::IsUnchanged(const SpeculativeContractTx& job) const{
+    for(const dev::Address& addr : job.accessedAccounts){
+        if(changedAccounts.count(addr) && base.committedAccount(addr) != qtum.state->committedAccount(addr))
+            return false;
+    }
+    for(const dev::Address& addr : job.accessedVins){
+        if(changedVins.count(addr) && base.committedVin(addr) != qtum.state->committedVin(addr))
+            return false;
+    }
+    return true;
+}
+
+bool ContractExecSpeculation::Apply(const std::vector<QtumTransaction>& txs, std::vector<ResultExecute>& result){
+    if(txs.empty())
+        return false;
+    auto it = jobs.find(txs.front().getHashWith());
+    if(it == jobs.end())
+        return false;
+
+    SpeculativeContractTx& job = it->second;
+    bool valid = job.executed && job.txs.size() == txs.size() && job.result.size() == txs.size() &&
+        job.writeSets.size() == txs.size() && qtum.sealEngine->deleteAddresses.empty();
+    for(size_t i = 0; valid && i < txs.size(); i++){
+        valid = IsSameContractExecution(job.txs[i], txs[i]) && job.writeSets[i].complete;
+    }
+    if(!valid || !IsUnchanged(job)){
+        nReexecuted++;
+        jobs.erase(it);
+        return false;
+    }
+
+    for(size_t i = 0; i < txs.size(); i++){
+        ResultExecute& res = job.result[i];
+        if(!txs[i].isCreation() && !qtum.state->addressInUse(txs[i].receiveAddress())){
+            result.push_back(std::move(res));
+            continue;
+        }
+        qtum.state->applyWriteSet(job.writeSets[i]);
+        // The receipt records the roots reached in block order, not those of the private state
+        res.txRec = QtumTransactionReceipt(qtum.state->rootHash(), qtum.state->rootHashUTXO(), res.txRec.cumulativeGasUsed(), res.txRec.log());
+        result.push_back(std::move(res));
+
+        for(auto const& acc : job.writeSets[i].accounts)
+            changedAccounts.insert(acc.first);
+        for(auto const& vin : job.writeSets[i].vins)
+            changedVins.insert(vin.first);
+    }
+    qtum.state->commitDB();
+    NoteAccessed(job.accessedAccounts, job.accessedVins);
+
+    nApplied++;
+    jobs.erase(it);
+    return true;
+}
+
+void ContractExecSpeculation::NoteAccessed(const dev::AddressHash& accounts, const dev::AddressHash& vins){
+    changedAccounts.insert(accounts.begin(), accounts.end());
+    changedVins.insert(vins.begin(), vins.end());
+}
+
+ContractExecResultCache& ContractExecResultCache::instance(){
+    static ContractExecResultCache cache;
+    return cache;
+}
+
+void ContractExecResultCache::BeginTemplate(const uint256& _tip){
+    LOCK(cs);
+    if(tip != _tip){
+        entries.clear();
+        tip = _tip;
+    }
+    templateAuthors.clear();
+    currentTemplate++;
+}
+
+void ContractExecResultCache::EndTemplate(){
+    LOCK(cs);
+    for(auto it = entries.begin(); it != entries.end();){
+        if(it->second.lastTemplate != currentTemplate && templateAuthors.count(it->first.first))
+            it = entries.erase(it);
+        else
+            ++it;
+    }
+}
+
+size_t ContractExecResultCache::Size() const{
+    LOCK(cs);
+    return entries.size();
+}
+
+bool ContractExecResultCache::Apply(const std::vector<QtumTransaction>& txs, const dev::eth::EnvInfo& envInfo, QtumState& state,
+                                    const dev::eth::SealEngineFace& sealEngine, std::vector<ResultExecute>& result){
+    LOCK(cs);
+    templateAuthors.insert(envInfo.author());
+    auto it = entries.find(std::make_pair(envInfo.author(), txs.front().getHashWith()));
+    if(it == entries.end()){
+        nExecuted++;
+        return false;
+    }
+
+    CachedContractExec& entry = it->second;
+    entry.lastTemplate = currentTemplate;
+    bool valid = entry.txs.size() == txs.size() && entry.result.size() == txs.size() && entry.writeSets.size() == txs.size() &&
+        sealEngine.deleteAddresses.empty() && entry.gasLimit == envInfo.gasLimit() &&
+        (!entry.blockContextRead || (entry.timestamp == envInfo.timestamp() && entry.difficulty == envInfo.difficulty()));
+    for(size_t i = 0; valid && i < txs.size(); i++){
+        valid = IsSameContractExecution(entry.txs[i], txs[i]) && entry.writeSets[i].complete;
+    }
+    for(size_t i = 0; valid && i < entry.accounts.size(); i++){
+        valid = state.committedAccount(entry.accounts[i].first) == entry.accounts[i].second;
+    }
+    for(size_t i = 0; valid && i < entry.vins.size(); i++){
+        valid = state.committedVin(entry.vins[i].first) == entry.vins[i].second;
+    }
+    if(!valid){
+        nExecuted++;
+        entries.erase(it);
+        return false;
+    }
+
+    for(size_t i = 0; i < txs.size(); i++){
+        ResultExecute res = entry.result[i];
+        if(!txs[i].isCreation() && !state.addressInUse(txs[i].receiveAddress())){
+            result.push_back(std::move(res));
+            continue;
+        }
+        state.applyWriteSet(entry.writeSets[i]);
+        res.txRec = QtumTransactionReceipt(state.rootHash(), state.rootHashUTXO(), res.txRec.cumulativeGasUsed(), res.txRec.log());
+        result.push_back(std::move(res));
+    }
+    nApplied++;
+    return true;
+}
+
+void ContractExecResultCache::Store(const std::vector<QtumTransaction>& txs, const dev::eth::EnvInfo& envInfo, bool blockContextRead,
+                                    const QtumState& state, const QtumState::Checkpoint& before, const dev::AddressHash& accessedAccounts,
+                                    const dev::AddressHash& accessedVins, const std::vector<ResultExecute>& result, std::vector<ExecutionWriteSet>&& writeSets){
+    if(result.size() != txs.size() || writeSets.size() != txs.size())
+        return;
+    dev::AddressHash accounts(accessedAccounts);
+    dev::AddressHash vins(accessedVins);
+    for(const ExecutionWriteSet& writeSet : writeSets){
+        if(!writeSet.complete)
+            return;
+        for(auto const& acc : writeSet.accounts)
+            accounts.insert(acc.first);
+        for(auto const& vin : writeSet.vins)
+            vins.insert(vin.first);
+    }
+
+    CachedContractExec entry;
+    entry.txs = txs;
+    entry.result = std::vector<ResultExecute>(result.begin(), result.end());
+    entry.writeSets = std::move(writeSets);
+    for(const dev::Address& addr : accounts)
+        entry.accounts.emplace_back(addr, state.committedAccountAt(before.stateRoot, addr));
+    for(const dev::Address& addr : vins)
+        entry.vins.emplace_back(addr, state.committedVinAt(before.utxoRoot, addr));
+    entry.author = envInfo.author();
+    entry.gasLimit = envInfo.gasLimit();
+    entry.blockContextRead = blockContextRead;
+    entry.timestamp = envInfo.timestamp();
+    entry.difficulty = envInfo.difficulty();
+
+    LOCK(cs);
+    templateAuthors.insert(entry.author);
+    entry.lastTemplate = currentTemplate;
+    entries[std::make_pair(entry.author, txs.front().getHashWith())] = std::move(entry);
+}
+
+void ConnectedBlockExec::Add(const std::vector<QtumTransaction>& txs, const std::vector<ResultExecute>& result, std::vector<ExecutionWriteSet>&& writeSets){
+    if(txs.empty() || result.size() != txs.size() || writeSets.size() != txs.size())
+        return;
+    for(const ExecutionWriteSet& writeSet : writeSets){
+        if(!writeSet.complete)
+            return;
+    }
+    ConnectedContractExec& exec = execs[txs.front().getHashWith()];
+    exec.txs = txs;
+    exec.result = std::vector<ResultExecute>(result.begin(), result.end());
+    exec.writeSets = std::move(writeSets);
+}
+
+bool ConnectedBlockExec::Apply(const std::vector<QtumTransaction>& txs, QtumState& state, const dev::eth::SealEngineFace& sealEngine,
+                               std::vector<ResultExecute>& result) const{
+    if(txs.empty())
+        return false;
+    auto it = execs.find(txs.front().getHashWith());
+    if(it == execs.end())
+        return false;
+
+    const ConnectedContractExec& exec = it->second;
+    bool valid = exec.txs.size() == txs.size() && exec.result.size() == txs.size() && exec.writeSets.size() == txs.size() &&
+        sealEngine.deleteAddresses.empty();
+    for(size_t i = 0; valid && i < txs.size(); i++){
+        valid = IsSameContractExecution(exec.txs[i], txs[i]) && exec.writeSets[i].complete;
+    }
+    if(!valid)
+        return false;
+
+    for(size_t i = 0; i < txs.size(); i++){
+        ResultExecute res = exec.result[i];
+        if(!txs[i].isCreation() && !state.addressInUse(txs[i].receiveAddress())){
+            result.push_back(std::move(res));
+            continue;
+        }
+        state.applyWriteSet(exec.writeSets[i]);
+        res.txRec = QtumTransactionReceipt(state.rootHash(), state.rootHashUTXO(), res.txRec.cumulativeGasUsed(), res.txRec.log());
+        result.push_back(std::move(res));
+    }
+    return true;
+}
+
+ConnectedBlockCache& ConnectedBlockCache::instance(){
+    static ConnectedBlockCache cache;
+    return cache;
+}
+
+std::shared_ptr<const ConnectedBlockExec> ConnectedBlockCache::Find(const uint256& hash, const dev::h256& stateRoot, const dev::h256& utxoRoot) const{
+    LOCK(cs);
+    auto it = entries.find(hash);
+    if(it == entries.end() || it->second->parentStateRoot != stateRoot || it->second->parentUTXORoot != utxoRoot)
+        return nullptr;
+    return it->second;
+}
+
+void ConnectedBlockCache::Store(const uint256& hash, std::shared_ptr<const ConnectedBlockExec> exec){
+    LOCK(cs);
+    auto [it, inserted] = entries.insert_or_assign(hash, std::move(exec));
+    if(inserted)
+        order.push_back(hash);
+    while(order.size() > CONNECTED_BLOCK_CACHE_BLOCKS){
+        entries.erase(order.front());
+        order.pop_front();
+    }
+}
+
+size_t ConnectedBlockCache::Size() const{
+    LOCK(cs);
+    return entries.size();
+}
+
+ContractExecTimeModel& ContractExecTimeModel::instance(){
+    static ContractExecTimeModel model;
+    return model;
+}
+
+void ContractExecTimeModel::Record(const dev::Address& contract, uint64_t gasUsed, std::chrono::nanoseconds time){
+    if(gasUsed == 0){
+        return;
+    }
+    const double nsPerGas = double(time.count()) / gasUsed;
+    LOCK(cs);
+    records++;
+    // The average of all executions moves slower than the rate of one contract
+    averageNsPerGas = records == 1 ? nsPerGas : averageNsPerGas + (nsPerGas - averageNsPerGas) / 64;
+    if(contract == dev::Address()){
+        return;
+    }
+    auto [it, inserted] = rates.try_emplace(contract, Rate{nsPerGas, records});
+    if(!inserted){
+        it->second.nsPerGas += (nsPerGas - it->second.nsPerGas) / 4;
+        it->second.lastUse = records;
+    }
+    if(rates.size() > MAX_CONTRACT_TIME_RATES){
+        // Forget the half of the contracts executed the longest ago
+        std::vector<uint64_t> uses;
+        uses.reserve(rates.size());
+        for(const auto& rate : rates){
+            uses.push_back(rate.second.lastUse);
+        }
+        std::nth_element(uses.begin(), uses.begin() + uses.size() / 2, uses.end());
+        const uint64_t median = uses[uses.size() / 2];
+        for(auto rate = rates.begin(); rate != rates.end();){
+            rate = rate->second.lastUse < median ? rates.erase(rate) : std::next(rate);
+        }
+    }
+}
+
+std::chrono::microseconds ContractExecTimeModel::Predict(const std::vector<QtumTransaction>& txs) const{
+    LOCK(cs);
+    double ns = 0;
+    for(const QtumTransaction& tx : txs){
+        auto it = tx.isCreation() ? rates.end() : rates.find(tx.receiveAddress());
+        ns += (it != rates.end() ? it->second.nsPerGas : averageNsPerGas) * double(tx.gas());
+    }
+    return std::chrono::microseconds{int64_t(ns / 1000)};
+}
+
+size_t ContractExecTimeModel::Size() const{
+    LOCK(cs);
+    return rates.size();
+}
+
+std::shared_ptr<const MempoolContractTxs> GetMempoolContractTxs(const CTxMemPool& pool, const uint256& txid, unsigned int flags){
+    AssertLockHeld(pool.cs);
+    const std::optional<CTxMemPool::txiter> it = pool.GetIter(txid);
+    if(!it || !(*it)->GetContractTxs() || (*it)->GetContractTxs()->flags != flags)
+        return nullptr;
+    return (*it)->GetContractTxs();
+}
+
 bool QtumTxConverter::extractionQtumTransactions(ExtractQtumTX& qtumtx){
     // Get the address of the sender that pay the coins for the contract transactions
     refundSender = dev::Address(GetSenderAddress(txBit, view, blockTransactions, chainstate, mempool));
@@ -2928,7 +3858,7 @@ bool QtumTxConverter::extractionQtumTransactions(ExtractQtumTX& qtumtx){
                 EthTransactionParams params;
                 if(parseEthTXParams(params)){
                     resultTX.push_back(createEthTX(params, i));
-                    resultETP.push_back(params);
+                    resultETP.push_back(std::move(params));
                 }else{
                     return false;
                 }
@@ -2937,7 +3867,7 @@ bool QtumTxConverter::extractionQtumTransactions(ExtractQtumTX& qtumtx){
             }
         }
     }
-    qtumtx = std::make_pair(resultTX, resultETP);
+    qtumtx = std::make_pair(std::move(resultTX), std::move(resultETP));
     return true;
 }
 
@@ -2977,7 +3907,7 @@ bool QtumTxConverter::parseEthTXParams(EthTransactionParams& params){
         if(stack.back().size() < 1){
             return false;
         }
-        valtype code(stack.back());
+        valtype code(std::move(stack.back()));
         stack.pop_back();
         uint64_t gasPrice = CScriptNum::vch_to_uint64(stack.back());
         stack.pop_back();
@@ -2999,7 +3929,7 @@ bool QtumTxConverter::parseEthTXParams(EthTransactionParams& params){
         params.version = version;
         params.gasPrice = dev::u256(gasPrice);
         params.receiveAddress = receiveAddress;
-        params.code = code;
+        params.code = std::move(code);
         params.gasLimit = dev::u256(gasLimit);
         return true;
     }
@@ -3067,9 +3997,10 @@ bool CheckDelegationOutput(const CBlock& block, bool& delegateOutputExist, CCoin
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
 bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state, CBlockIndex* pindex,
-                               CCoinsViewCache& view, bool fJustCheck)
+                               CCoinsViewCache& view, bool fJustCheck, std::vector<TransactionReceiptInfo>* receipts)
 {
     AssertLockHeld(cs_main);
+    QtumContext& qtum{m_chainman.Qtum()};
     assert(pindex);
 
     uint256 block_hash{block.GetHash()};
@@ -3080,8 +4011,8 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     const CChainParams& params{m_chainman.GetParams()};
 
     ///////////////////////////////////////////////// // qtum
-    QtumDGP qtumDGP(globalState.get(), *this, fGettingValuesDGP);
-    globalSealEngine->setQtumSchedule(qtumDGP.getGasSchedule(pindex->nHeight + (pindex->nHeight+1 >= params.GetConsensus().QIP7Height ? 0 : 1) ));
+    QtumDGP qtumDGP(qtum.state.get(), *this, fGettingValuesDGP);
+    qtum.sealEngine->setQtumSchedule(qtumDGP.getGasSchedule(pindex->nHeight + (pindex->nHeight+1 >= params.GetConsensus().QIP7Height ? 0 : 1) ));
     uint32_t sizeBlockDGP = qtumDGP.getBlockSize(pindex->nHeight + (pindex->nHeight+1 >= params.GetConsensus().QIP7Height ? 0 : 1));
     uint64_t minGasPrice = qtumDGP.getMinGasPrice(pindex->nHeight + (pindex->nHeight+1 >= params.GetConsensus().QIP7Height ? 0 : 1));
     uint64_t blockGasLimit = qtumDGP.getBlockGasLimit(pindex->nHeight + (pindex->nHeight+1 >= params.GetConsensus().QIP7Height ? 0 : 1));
@@ -3092,7 +4023,7 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
 
     /////////////////////////////////////////////////
     // We recheck the hardened checkpoints here since ContextualCheckBlock(Header) is not called in ConnectBlock.
-    if(m_chainman.m_options.checkpoints_enabled && !m_blockman.CheckHardened(pindex->nHeight, block.GetHash(), params.Checkpoints())) {
+    if(m_chainman.m_options.checkpoints_enabled && !m_blockman.CheckHardened(pindex->nHeight, block_hash, params.Checkpoints())) {
         return state.Invalid(BlockValidationResult::BLOCK_CHECKPOINT, "bad-fork-hardened-checkpoint", strprintf("%s: expected hardened checkpoint at height %d", __func__, pindex->nHeight));
     }
 
@@ -3152,41 +4083,23 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         return true;
     }
 
+    // A block connected before from the same contract state, like when a short reorg is undone, gets
+    // the proof of stake and the contract results it was connected with
+    std::shared_ptr<const ConnectedBlockExec> reconnect = ConnectedBlockCache::instance().Find(block_hash, qtum.state->rootHash(), qtum.state->rootHashUTXO());
+    // Blocks connected at the tip are kept for a reorg, not those of the initial block download
+    std::shared_ptr<ConnectedBlockExec> connected;
+    if (!fJustCheck && !reconnect && !IsInitialBlockDownload()) {
+        connected = std::make_shared<ConnectedBlockExec>();
+        connected->parentStateRoot = qtum.state->rootHash();
+        connected->parentUTXORoot = qtum.state->rootHashUTXO();
+    }
+
     // State is filled in by UpdateHashProof
-    if (!UpdateHashProof(block, state, params.GetConsensus(), pindex, view)) {
+    if (!UpdateHashProof(block, state, params.GetConsensus(), pindex, view, reconnect ? &reconnect->hashProof : nullptr)) {
         return error("%s: ConnectBlock(): %s", __func__, state.GetRejectReason().c_str());
     }
 
-    bool fScriptChecks = true;
-    if (!m_chainman.AssumedValidBlock().IsNull()) {
-        // We've been configured with the hash of a block which has been externally verified to have a valid history.
-        // A suitable default value is included with the software and updated from time to time.  Because validity
-        //  relative to a piece of software is an objective fact these defaults can be easily reviewed.
-        // This setting doesn't force the selection of any particular chain but makes validating some faster by
-        //  effectively caching the result of part of the verification.
-        BlockMap::const_iterator it{m_blockman.m_block_index.find(m_chainman.AssumedValidBlock())};
-        if (it != m_blockman.m_block_index.end()) {
-            if (it->second.GetAncestor(pindex->nHeight) == pindex &&
-                m_chainman.m_best_header->GetAncestor(pindex->nHeight) == pindex &&
-                m_chainman.m_best_header->nChainWork >= m_chainman.MinimumChainWork()) {
-                // This block is a member of the assumed verified chain and an ancestor of the best header.
-                // Script verification is skipped when connecting blocks under the
-                // assumevalid block. Assuming the assumevalid block is valid this
-                // is safe because block merkle hashes are still computed and checked,
-                // Of course, if an assumed valid block is invalid due to false scriptSigs
-                // this optimization would allow an invalid chain to be accepted.
-                // The equivalent time check discourages hash power from extorting the network via DOS attack
-                //  into accepting an invalid block through telling users they must manually set assumevalid.
-                //  Requiring a software change or burying the invalid block, regardless of the setting, makes
-                //  it hard to hide the implication of the demand.  This also avoids having release candidates
-                //  that are hardly doing any signature verification at all in testing without having to
-                //  artificially set the default assumed verified block further back.
-                // The test against the minimum chain work prevents the skipping when denied access to any chain at
-                //  least as good as the expected chain.
-                fScriptChecks = (GetBlockProofEquivalentTime(*m_chainman.m_best_header, *pindex, *m_chainman.m_best_header, params.GetConsensus()) <= 60 * 60 * 24 * 7 * 2);
-            }
-        }
-    }
+    const bool fScriptChecks{!IsAssumedValid(*pindex, m_chainman)};
 
     const auto time_1{SteadyClock::now()};
     time_check += time_1 - time_start;
@@ -3307,6 +4220,10 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     // for as long as `control`.
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && parallel_script_checks ? &scriptcheckqueue : nullptr);
     std::vector<PrecomputedTransactionData> txsdata(block.vtx.size());
+    // The Schnorr signatures of the scripts checked in this thread, verified together at the end.
+    // The queued checks verify theirs in the worker threads. Not used when the script results
+    // are cached, as they would be cached before their signatures are verified.
+    BatchSchnorrVerifier schnorr_batch;
 
     std::vector<int> prevheights;
     CAmount nFees = 0;
@@ -3317,18 +4234,74 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
 
     ///////////////////////////////////////////////////////// // qtum
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
     std::map<dev::Address, std::pair<CHeightTxIndexKey, std::vector<uint256>>> heightIndexes;
+    std::vector<CContractIndexEntry> contractIndexes;
+    std::vector<DelegationEvent> delegationEvents;
+    const QtumDelegation& qtumDelegation = GetQtumDelegation();
+    const uint256 hashStateRootPrev = h256Touint(qtum.state->rootHash());
+    // Durations and counts of the contract steps, reported by the qtum tracepoints
+    SteadyClock::duration time_convert{}, time_exec{}, time_receipts{};
+    uint64_t nContractTxs = 0, nContractExecs = 0, nReceipts = 0;
     /////////////////////////////////////////////////////////
 
+    // Load the state of the contracts the block calls into the caches, and execute the contract
+    // transactions of the block ahead of time on the contract execution threads
+    std::unique_ptr<ContractExecSpeculation> contractSpeculation;
+    if(contractexecqueue.HasThreads() && !reconnect){
+        contractSpeculation = std::make_unique<ContractExecSpeculation>(block, blockGasLimit, pindex->pprev, m_chain, qtum);
+    }
+    // The contract transactions of the block that were extracted when they entered the mempool
+    std::vector<std::shared_ptr<const MempoolContractTxs>> mempoolContractTxs(block.vtx.size());
+    if(m_mempool){
+        LOCK(m_mempool->cs);
+        for(size_t i = 0; i < block.vtx.size(); i++){
+            if(block.vtx[i]->HasCreateOrCall() && !block.vtx[i]->HasOpSpend())
+                mempoolContractTxs[i] = GetMempoolContractTxs(*m_mempool, block.vtx[i]->GetHash(), contractflags);
+        }
+    }
+    std::vector<dev::Address> calledContracts;
+    for(size_t i = 0; i < block.vtx.size(); i++){
+        const CTransactionRef& ptx = block.vtx[i];
+        if(!ptx->HasCreateOrCall() || ptx->HasOpSpend())
+            continue;
+        ExtractQtumTX resultConvertQtumTX;
+        if(mempoolContractTxs[i]){
+            if(contractSpeculation) resultConvertQtumTX.first = mempoolContractTxs[i]->extracted.first;
+        }else{
+            QtumTxConverter convert(*ptx, *this, m_mempool, &view, &block.vtx, contractflags);
+            if(!convert.extractionQtumTransactions(resultConvertQtumTX))
+                continue;
+        }
+        const std::vector<QtumTransaction>& qtumTransactions = mempoolContractTxs[i] ? mempoolContractTxs[i]->extracted.first : resultConvertQtumTX.first;
+        for(const QtumTransaction& qtx : qtumTransactions){
+            if(!qtx.isCreation()) calledContracts.push_back(qtx.receiveAddress());
+        }
+        if(contractSpeculation) contractSpeculation->Add(std::move(resultConvertQtumTX.first));
+    }
+    std::sort(calledContracts.begin(), calledContracts.end());
+    calledContracts.erase(std::unique(calledContracts.begin(), calledContracts.end()), calledContracts.end());
+    qtum.state->prefetch(calledContracts);
+    if(contractSpeculation) contractSpeculation->Run();
+
     uint64_t blockGasUsed = 0;
     CAmount gasRefunds=0;
 
     uint64_t nValueOut=0;
     uint64_t nValueIn=0;
 
+    // Load the inputs of the block into the cache at once, the ones missing are read in parallel
+    {
+        std::vector<COutPoint> prevouts;
+        prevouts.reserve(block.vtx.size());
+        for (const CTransactionRef& tx : block.vtx) {
+            if (tx->IsCoinBase()) continue;
+            for (const CTxIn& txin : tx->vin) {
+                prevouts.push_back(txin.prevout);
+            }
+        }
+        view.FetchCoins(prevouts);
+    }
+
     if(block.IsProofOfStake())
     {
         Coin coin;
@@ -3366,37 +4339,12 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
             prevheights.resize(tx.vin.size());
             for (size_t j = 0; j < tx.vin.size(); j++) {
                 prevheights[j] = view.AccessCoin(tx.vin[j].prevout).nHeight;
-            }
-
-            if (!SequenceLocks(tx, nLockTimeFlags, prevheights, *pindex)) {
-                LogPrintf("ERROR: %s: contains a non-BIP68-final transaction\n", __func__);
-                return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-txns-nonfinal");
-            }
-
-            ////////////////////////////////////////////////////////////////// // qtum
-            if (fAddressIndex)
-            {
-                for (size_t j = 0; j < tx.vin.size(); j++) {
-                    const CTxIn input = tx.vin[j];
-                    const CTxOut &prevout = view.GetOutputFor(tx.vin[j]);
-
-                    CTxDestination dest;
-                    if (ExtractDestination(input.prevout, prevout.scriptPubKey, dest)) {
-                        valtype bytesID(std::visit(DataVisitor(), dest));
-                        if(bytesID.empty()) {
-                            continue;
-                        }
-                        valtype addressBytes(32);
-                        std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(dest.index(), uint256(addressBytes), pindex->nHeight, i, tx.GetHash(), j, true), prevout.nValue * -1));
+            }
 
-                        // remove address from unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(dest.index(), uint256(addressBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(tx.GetHash(), j, pindex->nHeight, prevout.nValue, dest.index(), uint256(addressBytes))));
-                    }
-                }
+            if (!SequenceLocks(tx, nLockTimeFlags, prevheights, *pindex)) {
+                LogPrintf("ERROR: %s: contains a non-BIP68-final transaction\n", __func__);
+                return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-txns-nonfinal");
             }
-            //////////////////////////////////////////////////////////////////
         }
 
         // GetTransactionSigOpCost counts 3 types of sigops:
@@ -3419,7 +4367,7 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
             std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
             TxValidationState tx_state;
-            if (fScriptChecks && !CheckInputScripts(tx, tx_state, view, flags, fCacheResults, fCacheResults, txsdata[i], (hasOpSpend || tx.HasCreateOrCall()) ? nullptr : (parallel_script_checks ? &vChecks : nullptr))) {
+            if (fScriptChecks && !CheckInputScripts(tx, tx_state, view, flags, fCacheResults, fCacheResults, txsdata[i], (hasOpSpend || tx.HasCreateOrCall()) ? nullptr : (parallel_script_checks ? &vChecks : nullptr), fCacheResults ? nullptr : &schnorr_batch)) {
                 // Any transaction validation failure in ConnectBlock is a block consensus failure
                 state.Invalid(BlockValidationResult::BLOCK_CONSENSUS,
                               tx_state.GetRejectReason(), tx_state.GetDebugMessage());
@@ -3460,25 +4408,35 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-txns-invalid-sender-script");
             }
 
-            QtumTxConverter convert(tx, *this, m_mempool, &view, &block.vtx, contractflags);
-
+            const auto time_convert_start{SteadyClock::now()};
             ExtractQtumTX resultConvertQtumTX;
-            if(!convert.extractionQtumTransactions(resultConvertQtumTX)){
-                return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-tx-bad-contract-format", "ConnectBlock(): Contract transaction of the wrong format");
+            const std::vector<EthTransactionParams>* qtumETP = &resultConvertQtumTX.second;
+            if(mempoolContractTxs[i]){
+                resultConvertQtumTX.first = mempoolContractTxs[i]->extracted.first;
+                qtumETP = &mempoolContractTxs[i]->extracted.second;
+            }else{
+                QtumTxConverter convert(tx, *this, m_mempool, &view, &block.vtx, contractflags);
+                if(!convert.extractionQtumTransactions(resultConvertQtumTX)){
+                    return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-tx-bad-contract-format", "ConnectBlock(): Contract transaction of the wrong format");
+                }
             }
-            if(!CheckMinGasPrice(resultConvertQtumTX.second, minGasPrice))
+            time_convert += SteadyClock::now() - time_convert_start;
+            nContractTxs++;
+            if(!CheckMinGasPrice(*qtumETP, minGasPrice))
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-tx-low-gas-price", "ConnectBlock(): Contract execution has lower gas price than allowed");
 
 
             dev::u256 gasAllTxs = dev::u256(0);
-            ByteCodeExec exec(block, resultConvertQtumTX.first, blockGasLimit, pindex->pprev, m_chain);
+            ByteCodeExec exec(block, std::move(resultConvertQtumTX.first), blockGasLimit, pindex->pprev, m_chain, qtum, contractSpeculation.get());
+            exec.setConnectedBlock(reconnect.get(), connected.get());
+            const std::vector<QtumTransaction>& qtumTransactions = exec.getTransactions();
             //validate VM version and other ETH params before execution
             //Reject anything unknown (could be changed later by DGP)
             //TODO evaluate if this should be relaxed for soft-fork purposes
             bool nonZeroVersion=false;
             dev::u256 sumGas = dev::u256(0);
             CAmount nTxFee = view.GetValueIn(tx)-tx.GetValueOut();
-            for(QtumTransaction& qtx : resultConvertQtumTX.first){
+            for(const QtumTransaction& qtx : qtumTransactions){
                 sumGas += qtx.gas() * qtx.gasPrice();
 
                 if(sumGas > dev::u256(INT64_MAX)) {
@@ -3530,21 +4488,43 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 }
             }
 
-            if(!exec.performByteCode()){
+            const auto time_exec_start{SteadyClock::now()};
+            std::vector<dev::Address> createdContracts;
+            qtum.state->setCreatedContracts(fLogEvents && !fJustCheck ? &createdContracts : nullptr);
+            bool executed = exec.performByteCode();
+            qtum.state->setCreatedContracts(nullptr);
+            if(!executed){
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-tx-unknown-error", "ConnectBlock(): Unknown error during contract execution");
             }
+            for(const dev::Address& address : createdContracts){
+                contractIndexes.push_back({address, uint32_t(pindex->nHeight), tx.GetHash(), h256Touint(qtum.state->codeHash(address))});
+            }
 
-            std::vector<ResultExecute> resultExec(exec.getResult());
+            const std::vector<ResultExecute>& resultExec = exec.getResult();
             ByteCodeExecResult bcer;
             if(!exec.processingResults(bcer)){
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-vm-exec-processing", "ConnectBlock(): Error processing VM execution results");
             }
+            time_exec += SteadyClock::now() - time_exec_start;
+            nContractExecs += resultExec.size();
+
+            // The delegation cache follows the changes of the delegation contract from its events
+            if(!fJustCheck){
+                for(const ResultExecute& re : resultExec){
+                    for(const dev::eth::LogEntry& log : re.txRec.log()){
+                        DelegationEvent event;
+                        if(qtumDelegation.GetDelegationEvent(log, event))
+                            delegationEvents.push_back(event);
+                    }
+                }
+            }
 
             std::vector<TransactionReceiptInfo> tri;
-            if (fLogEvents && !fJustCheck)
+            if ((fLogEvents || receipts) && !fJustCheck)
             {
+                const auto time_receipts_start{SteadyClock::now()};
                 uint64_t countCumulativeGasUsed = blockGasUsed;
-                for(size_t k = 0; k < resultConvertQtumTX.first.size(); k ++){
+                for(size_t k = 0; k < qtumTransactions.size(); k ++){
                     for(auto& log : resultExec[k].txRec.log()) {
                         if(!heightIndexes.count(log.address)){
                             heightIndexes[log.address].first = CHeightTxIndexKey(pindex->nHeight, log.address);
@@ -3554,33 +4534,36 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
                     uint64_t gasUsed = uint64_t(resultExec[k].execRes.gasUsed);
                     countCumulativeGasUsed += gasUsed;
                     tri.push_back(TransactionReceiptInfo{
-                        block.GetHash(),
+                        block_hash,
                         uint32_t(pindex->nHeight),
                         tx.GetHash(),
                         uint32_t(i),
-                        resultConvertQtumTX.first[k].from(),
-                        resultConvertQtumTX.first[k].to(),
+                        qtumTransactions[k].from(),
+                        qtumTransactions[k].to(),
                         countCumulativeGasUsed,
                         gasUsed,
                         resultExec[k].execRes.newAddress,
                         resultExec[k].txRec.log(),
                         resultExec[k].execRes.excepted,
                         exceptedMessage(resultExec[k].execRes.excepted, resultExec[k].execRes.output),
-                        resultConvertQtumTX.first[k].getNVout(),
+                        qtumTransactions[k].getNVout(),
                         resultExec[k].txRec.bloom(),
                         resultExec[k].txRec.stateRoot(),
                         resultExec[k].txRec.utxoRoot(),
                     });
                 }
 
-                pstorageresult->addResult(uintToh256(tx.GetHash()), tri);
+                if (fLogEvents) qtum.storageResults->addResult(uintToh256(tx.GetHash()), tri);
+                if (receipts) receipts->insert(receipts->end(), tri.begin(), tri.end());
+                time_receipts += SteadyClock::now() - time_receipts_start;
+                nReceipts += tri.size();
             }
 
             blockGasUsed += bcer.usedGas;
             if(blockGasUsed > blockGasLimit){
                 return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-blk-gaslimit", "ConnectBlock(): Block exceeds gas limit");
             }
-            for(CTxOut refundVout : bcer.refundOutputs){
+            for(const CTxOut& refundVout : bcer.refundOutputs){
                 gasRefunds += refundVout.nValue;
             }
             checkVouts.insert(checkVouts.end(), bcer.refundOutputs.begin(), bcer.refundOutputs.end());
@@ -3591,37 +4574,13 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
                 writeVMlog(resultExec, m_chain, tx, block);
             }
 
-            for(ResultExecute& re: resultExec){
+            for(const ResultExecute& re: resultExec){
                 if(re.execRes.newAddress != dev::Address() && !fJustCheck)
                     dev::g_logPost(std::string("Address : " + re.execRes.newAddress.hex()), NULL);
             }
         }
 /////////////////////////////////////////////////////////////////////////////////////////
 
-        /////////////////////////////////////////////////////////////////////////////////// // qtum
-        if (fAddressIndex) {
-
-            for (unsigned int k = 0; k < tx.vout.size(); k++) {
-                const CTxOut &out = tx.vout[k];
-                const bool isTxCoinStake = tx.IsCoinStake();
-
-                CTxDestination dest;
-                if (ExtractDestination({tx.GetHash(), k}, out.scriptPubKey, dest)) {
-                    valtype bytesID(std::visit(DataVisitor(), dest));
-                    if(bytesID.empty()) {
-                        continue;
-                    }
-                    valtype addressBytes(32);
-                    std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(dest.index(), uint256(addressBytes), pindex->nHeight, i, tx.GetHash(), k, false), out.nValue));
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(dest.index(), uint256(addressBytes), tx.GetHash(), k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight, isTxCoinStake)));
-                }
-            }
-        }
-        ///////////////////////////////////////////////////////////////////////////////////
-
         CTxUndo undoDummy;
         if (i > 0) {
             blockundo.vtxundo.push_back(CTxUndo());
@@ -3639,13 +4598,38 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     if(nFees < gasRefunds) { //make sure it won't overflow
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-blk-fees-greater-gasrefund", "ConnectBlock(): Less total fees than gas refund fees");
     }
-    if(!CheckReward(block, state, pindex->nHeight, params.GetConsensus(), nFees, gasRefunds, nActualStakeReward, checkVouts, nValueCoinPrev, delegateOutputExist, m_chain, m_blockman))
+    time_contracts += time_convert + time_exec + time_receipts;
+    TRACE8(qtum, contracts_executed,
+        block_hash.data(),
+        pindex->nHeight,
+        nContractTxs,
+        Ticks<std::chrono::microseconds>(time_convert),
+        nContractExecs,
+        blockGasUsed,
+        Ticks<std::chrono::microseconds>(time_exec),
+        Ticks<std::chrono::microseconds>(time_receipts)
+    );
+
+    const auto time_reward_start{SteadyClock::now()};
+    bool fRewardValid = CheckReward(block, state, pindex->nHeight, params.GetConsensus(), nFees, gasRefunds, nActualStakeReward, checkVouts, nValueCoinPrev, delegateOutputExist, m_chain, m_blockman);
+    TRACE5(qtum, reward_checked,
+        block_hash.data(),
+        pindex->nHeight,
+        pindex->nHeight - 1 >= params.GetConsensus().nFirstMPoSBlock && pindex->nHeight - 1 < params.GetConsensus().nLastMPoSBlock,
+        fRewardValid,
+        Ticks<std::chrono::microseconds>(SteadyClock::now() - time_reward_start)
+    );
+    if(!fRewardValid)
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "block-reward-invalid", "ConnectBlock(): Reward check failed");
 
     if (!control.Wait()) {
         LogPrintf("ERROR: %s: CheckQueue failed\n", __func__);
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "block-validation-failed");
     }
+    if (!schnorr_batch.Verify()) {
+        return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "mandatory-script-verify-flag-failed (Invalid Schnorr signature)",
+                             "ConnectBlock(): batch Schnorr signature verification failed");
+    }
     const auto time_4{SteadyClock::now()};
     time_verify += time_4 - time_2;
     LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1,
@@ -3654,16 +4638,30 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
              Ticks<SecondsDouble>(time_verify),
              Ticks<MillisecondsDouble>(time_verify) / num_blocks_total);
 
+    if (contractSpeculation) {
+        LogPrint(BCLog::BENCH, "    - Speculative contract execution: %u applied, %u executed again\n", contractSpeculation->nApplied, contractSpeculation->nReexecuted);
+    }
+    if (reconnect) {
+        ConnectedBlockCache::instance().nReconnected++;
+        LogPrint(BCLog::BENCH, "    - Reconnected block: %u contract transactions replayed from its first connection\n", reconnect->execs.size());
+    }
+
 ////////////////////////////////////////////////////////////////// // qtum
     if(pindex->nHeight == params.GetConsensus().nOfflineStakeHeight){
-        globalState->deployDelegationsContract();
+        std::vector<dev::Address> createdContracts;
+        qtum.state->setCreatedContracts(fLogEvents && !fJustCheck ? &createdContracts : nullptr);
+        qtum.state->deployDelegationsContract();
+        qtum.state->setCreatedContracts(nullptr);
+        for(const dev::Address& address : createdContracts){
+            contractIndexes.push_back({address, uint32_t(pindex->nHeight), uint256(), h256Touint(qtum.state->codeHash(address))});
+        }
     }
     checkBlock.hashMerkleRoot = BlockMerkleRoot(checkBlock);
-    checkBlock.hashStateRoot = h256Touint(globalState->rootHash());
-    checkBlock.hashUTXORoot = h256Touint(globalState->rootHashUTXO());
+    checkBlock.hashStateRoot = h256Touint(qtum.state->rootHash());
+    checkBlock.hashUTXORoot = h256Touint(qtum.state->rootHashUTXO());
 
     //If this error happens, it probably means that something with AAL created transactions didn't match up to what is expected
-    if((checkBlock.GetHash() != block.GetHash()) && !fJustCheck)
+    if((checkBlock.GetHash() != block_hash) && !fJustCheck)
     {
         LogPrintf("Actual block data does not match block expected by AAL\n");
         //Something went wrong with AAL, compare different elements and determine what the problem is
@@ -3724,8 +4722,8 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
             prevHashStateRoot = uintToh256(pindex->pprev->hashStateRoot);
             prevHashUTXORoot = uintToh256(pindex->pprev->hashUTXORoot);
         }
-        globalState->setRoot(prevHashStateRoot);
-        globalState->setRootUTXO(prevHashUTXORoot);
+        qtum.state->setRoot(prevHashStateRoot);
+        qtum.state->setRootUTXO(prevHashUTXORoot);
         return true;
     }
 //////////////////////////////////////////////////////////////////
@@ -3743,6 +4741,11 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         return false;
     }
 
+    if (connected) {
+        connected->hashProof = pindex->hashProof;
+        ConnectedBlockCache::instance().Store(block_hash, std::move(connected));
+    }
+
     const auto time_5{SteadyClock::now()};
     time_undo += time_5 - time_4;
     LogPrint(BCLog::BENCH, "    - Write undo data: %.2fms [%.2fs (%.2fms/blk)]\n",
@@ -3755,15 +4758,23 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         m_blockman.m_dirty_blockindex.insert(pindex);
     }
 
+    const auto time_qtum_index_start{SteadyClock::now()};
+    uint64_t nIndexEntries = 0;
     if (fLogEvents)
     {
+        nIndexEntries += heightIndexes.size() + contractIndexes.size();
         for (const auto& e: heightIndexes)
         {
-            if (!m_blockman.m_block_tree_db->WriteHeightIndex(e.second.first, e.second.second))
+            if (!m_blockman.m_qtum_index_db->WriteHeightIndex(e.second.first, e.second.second))
                 return AbortNode(state, "Failed to write height index");
         }
+        if (!m_blockman.m_qtum_index_db->WriteContractIndex(contractIndexes))
+            return AbortNode(state, "Failed to write contract index");
     }
 
+    recentSpentOutpoints.Add(pindex, block);
+    GetDelegationCache().ConnectBlock(hashStateRootPrev, checkBlock.hashStateRoot, delegationEvents);
+
     // The stake and delegate index is needed for MPoS, update it while MPoS is active
     if(pindex->nHeight <= params.GetConsensus().nLastMPoSBlock)
     {
@@ -3774,55 +4785,31 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
             if(GetBlockPublicKey(block, vchPubKey))
             {
                 pkh = uint160(ToByteVector(CPubKey(vchPubKey).GetID()));
-                m_blockman.m_block_tree_db->WriteStakeIndex(pindex->nHeight, pkh);
+                m_blockman.m_qtum_index_db->WriteStakeIndex(pindex->nHeight, pkh);
             }else{
-                m_blockman.m_block_tree_db->WriteStakeIndex(pindex->nHeight, uint160());
+                m_blockman.m_qtum_index_db->WriteStakeIndex(pindex->nHeight, uint160());
             }
 
+            uint160 address;
+            uint8_t fee = 0;
             if(block.HasProofOfDelegation())
             {
-                uint160 address;
-                uint8_t fee = 0;
                 GetBlockDelegation(block, pkh, address, fee, view, *this);
-                m_blockman.m_block_tree_db->WriteDelegateIndex(pindex->nHeight, address, fee);
+                m_blockman.m_qtum_index_db->WriteDelegateIndex(pindex->nHeight, address, fee);
             }
+            AddMPoSScriptToCache(pindex, pkh, block.HasProofOfDelegation(), address, fee);
+            if(block.HasProofOfDelegation()) nIndexEntries++;
         }else{
-            m_blockman.m_block_tree_db->WriteStakeIndex(pindex->nHeight, uint160());
-        }
-    }
-
-    ///////////////////////////////////////////////////////////// // qtum
-    if (fAddressIndex) {
-        if (!m_blockman.m_block_tree_db->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-        if (!m_blockman.m_block_tree_db->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
-
-        if (!m_blockman.m_block_tree_db->UpdateSpentIndex(spentIndex))
-            return AbortNode(state, "Failed to write transaction index");
-
-        unsigned int logicalTS = pindex->nTime;
-        unsigned int prevLogicalTS = 0;
-
-        // retrieve logical timestamp of the previous block
-        if (pindex->pprev)
-            if (!m_blockman.m_block_tree_db->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
-                LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
-
-        if (logicalTS <= prevLogicalTS) {
-            logicalTS = prevLogicalTS + 1;
-            LogPrint(BCLog::INDEX, "%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
+            m_blockman.m_qtum_index_db->WriteStakeIndex(pindex->nHeight, uint160());
         }
-
-        if (!m_blockman.m_block_tree_db->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
-
-        if (!m_blockman.m_block_tree_db->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
-            return AbortNode(state, "Failed to write blockhash index");
+        nIndexEntries++;
     }
-    /////////////////////////////////////////////////////////////
+    TRACE4(qtum, index_written,
+        block_hash.data(),
+        pindex->nHeight,
+        nIndexEntries,
+        Ticks<std::chrono::microseconds>(SteadyClock::now() - time_qtum_index_start)
+    );
 
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
@@ -3834,6 +4821,11 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
              Ticks<SecondsDouble>(time_index),
              Ticks<MillisecondsDouble>(time_index) / num_blocks_total);
 
+    g_metrics.blocks_connected.Inc();
+    g_metrics.block_connect_time.Observe(std::chrono::duration_cast<std::chrono::microseconds>(time_6 - time_start));
+    g_metrics.contract_txs.Inc(nContractExecs);
+    g_metrics.contract_gas_used.Inc(blockGasUsed);
+
     TRACE6(validation, block_connected,
         block_hash.data(),
         pindex->nHeight,
@@ -3843,8 +4835,16 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         time_5 - time_start // in microseconds (µs)
     );
 
-    if (fLogEvents)
-        pstorageresult->commitResults();
+    if (fLogEvents) {
+        const auto time_commit_start{SteadyClock::now()};
+        qtum.storageResults->commitResults();
+        TRACE4(qtum, receipts_committed,
+            block_hash.data(),
+            pindex->nHeight,
+            nReceipts,
+            Ticks<std::chrono::microseconds>(SteadyClock::now() - time_commit_start)
+        );
+    }
 
     return true;
 }
@@ -3982,7 +4982,7 @@ bool Chainstate::FlushStateToDisk(
             if (fFlushForPrune) {
                 LOG_TIME_MILLIS_WITH_CATEGORY("unlink pruned files", BCLog::BENCH);
 
-                UnlinkPrunedFiles(setFilesToPrune);
+                m_blockman.UnlinkPrunedFiles(setFilesToPrune);
             }
             m_last_write = nNow;
         }
@@ -3999,6 +4999,14 @@ bool Chainstate::FlushStateToDisk(
             if (!CheckDiskSpace(gArgs.GetDataDirNet(), 48 * 2 * 2 * CoinsTip().GetCacheSize())) {
                 return AbortNode(state, "Disk space is too low!", _("Disk space is too low!"));
             }
+            // Write the receipts of the connected blocks before the chainstate that refers to them
+            if (fLogEvents) {
+                m_chainman.Qtum().storageResults->flushResults();
+            }
+            // And the contract state, so that the state roots of the best block are on disk
+            if (m_chainman.Qtum().state) {
+                m_chainman.Qtum().state->flushDB();
+            }
             // Flush the chainstate (which may refer to block index entries).
             if (!CoinsTip().Flush())
                 return AbortNode(state, "Failed to write to coin database");
@@ -4099,6 +5107,7 @@ void Chainstate::UpdateTip(const CBlockIndex* pindexNew)
     if (m_mempool) {
         m_mempool->AddTransactionsUpdated(1);
     }
+    g_metrics.chain_height.Set(pindexNew->nHeight);
 
     {
         LOCK(g_best_block_mutex);
@@ -4135,7 +5144,7 @@ void Chainstate::UpdateTip(const CBlockIndex* pindexNew)
   * disconnectpool (note that the caller is responsible for mempool consistency
   * in any case).
   */
-bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTransactions* disconnectpool)
+bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTransactions* disconnectpool, ReorgDisconnect* reorg)
 {
     AssertLockHeld(cs_main);
     if (m_mempool) AssertLockHeld(m_mempool->cs);
@@ -4143,18 +5152,25 @@ bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTra
     CBlockIndex *pindexDelete = m_chain.Tip();
     assert(pindexDelete);
     assert(pindexDelete->pprev);
-    // Read block from disk.
-    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-    CBlock& block = *pblock;
-    if (!ReadBlockFromDisk(block, pindexDelete, m_chainman.GetConsensus())) {
-        return error("DisconnectTip(): Failed to read block");
+    // Read block from disk, unless it was read ahead for the reorg.
+    std::shared_ptr<CBlock> pblock;
+    if (reorg) {
+        auto it = reorg->prefetched.find(pindexDelete->GetBlockHash());
+        if (it != reorg->prefetched.end()) pblock = it->second.block;
+    }
+    if (!pblock) {
+        pblock = std::make_shared<CBlock>();
+        if (!ReadBlockFromDisk(*pblock, pindexDelete, m_chainman.GetConsensus())) {
+            return error("DisconnectTip(): Failed to read block");
+        }
     }
+    CBlock& block = *pblock;
     // Apply the block atomically to the chain state.
     const auto time_start{SteadyClock::now()};
     {
         CCoinsViewCache view(&CoinsTip());
         assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
-        if (DisconnectBlock(block, pindexDelete, view, nullptr) != DISCONNECT_OK)
+        if (DisconnectBlock(block, pindexDelete, view, nullptr, reorg) != DISCONNECT_OK)
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         bool flushed = view.Flush();
         assert(flushed);
@@ -4192,6 +5208,9 @@ bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTra
     }
 
     m_chain.SetTip(*pindexDelete->pprev);
+    if (this == &m_chainman.ActiveChainstate()) {
+        m_chainman.m_stale_block_index.emplace(pindexDelete->nHeight, pindexDelete);
+    }
 
     UpdateTip(pindexDelete->pprev);
     // Let wallets know transactions went from 1-confirmed to
@@ -4200,15 +5219,326 @@ bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTra
     return true;
 }
 
+void Chainstate::PrefetchDisconnect(ReorgDisconnect& reorg, const CBlockIndex* pindexFork)
+{
+    AssertLockHeld(cs_main);
+
+    // The positions are read here under cs_main, the reads themselves do not take the lock
+    struct PrefetchTask {
+        uint256 hash;
+        uint256 prev_hash;
+        FlatFilePos block_pos;
+        FlatFilePos undo_pos;
+        std::shared_ptr<CBlock> block;
+        CBlockUndo undo;
+        bool read{false};
+    };
+    std::vector<PrefetchTask> tasks;
+    for (const CBlockIndex* pindex = m_chain.Tip(); pindex && pindex != pindexFork && pindex->pprev && (int)tasks.size() < MAX_DISCONNECT_PREFETCH; pindex = pindex->pprev) {
+        if (reorg.prefetched.count(pindex->GetBlockHash())) continue;
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA) || !(pindex->nStatus & BLOCK_HAVE_UNDO)) break;
+        tasks.push_back({pindex->GetBlockHash(), pindex->pprev->GetBlockHash(), pindex->GetBlockPos(), pindex->GetUndoPos(), /*block=*/nullptr, /*undo=*/{}, /*read=*/false});
+    }
+    if (tasks.empty()) return;
+
+    const Consensus::Params& consensus = m_chainman.GetConsensus();
+    std::atomic<size_t> next{0};
+    auto read_blocks = [&]() {
+        for (size_t i = next++; i < tasks.size(); i = next++) {
+            PrefetchTask& task = tasks[i];
+            task.block = std::make_shared<CBlock>();
+            // A failed read is left to DisconnectTip, which reads the block again and reports the error
+            task.read = ReadBlockFromDisk(*task.block, task.block_pos, consensus) &&
+                        task.block->GetHash() == task.hash &&
+                        UndoReadFromDisk(task.undo, task.undo_pos, task.prev_hash);
+        }
+    };
+    std::vector<std::thread> threads;
+    const int num_threads = std::min<int>(DISCONNECT_PREFETCH_THREADS, tasks.size()) - 1;
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back(read_blocks);
+    }
+    read_blocks();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (PrefetchTask& task : tasks) {
+        if (task.read) {
+            reorg.prefetched.emplace(task.hash, ReorgDisconnect::PrefetchedBlock{std::move(task.block), std::move(task.undo)});
+        }
+    }
+}
+
+void Chainstate::FinishDisconnect(ReorgDisconnect& reorg)
+{
+    AssertLockHeld(cs_main);
+
+    if (!reorg.deleted_txs.empty()) {
+        m_chainman.Qtum().storageResults->deleteResults(reorg.deleted_txs);
+        reorg.deleted_txs.clear();
+    }
+    if (!reorg.deleted_heights.empty()) {
+        m_blockman.m_qtum_index_db->EraseHeightIndexes(reorg.deleted_heights);
+        m_blockman.m_qtum_index_db->EraseContractIndexes(reorg.deleted_heights);
+        reorg.deleted_heights.clear();
+    }
+    reorg.prefetched.clear();
+
+    const CBlockIndex* pindexTip = m_chain.Tip();
+    m_chainman.Qtum().state->setRoot(uintToh256(pindexTip->hashStateRoot)); // qtum
+    m_chainman.Qtum().state->setRootUTXO(uintToh256(pindexTip->hashUTXORoot)); // qtum
+}
+
+/**
+ * Reads the blocks that ActivateBestChain is going to connect in a thread of its own, at most
+ * MAX_BLOCK_PREFETCH blocks ahead of ConnectTip, so that reading and deserializing them is off
+ * the critical path. The inputs of every block read are looked up in the coins database, which
+ * brings them into its cache before the block is connected.
+ *
+ * A second thread verifies the input signatures of the blocks read, in block order, and stores
+ * them in the signature cache, so that ConnectBlock only finds them there while the contracts
+ * are still executed one block after the other. The spent outputs are taken from the blocks read
+ * before, or from the coins database. Nothing depends on the outcome: a transaction whose spent
+ * outputs are not found is skipped, and a failing signature is reported by ConnectBlock.
+ */
+class BlockPrefetcher
+{
+public:
+    BlockPrefetcher(const Consensus::Params& consensus, CCoinsView* coins_db)
+        : m_consensus(consensus), m_coins_db(coins_db),
+          m_thread([this] { util::ThreadRename("blkprefetch"); ThreadRead(); }),
+          m_verify_thread([this] { util::ThreadRename("blkprecheck"); ThreadVerify(); }) {}
+
+    ~BlockPrefetcher()
+    {
+        WITH_LOCK(m_mutex, m_stop = true);
+        m_cv.notify_all();
+        m_thread.join();
+        m_verify_thread.join();
+    }
+
+    /**
+     * Queue a block to be read, in the order the blocks are connected. Queued blocks are skipped.
+     * @param[in] script_flags  Script verification flags of the block, its signatures are verified
+     *                          ahead unless it is std::nullopt.
+     */
+    void Schedule(const CBlockIndex* pindex, std::optional<unsigned int> script_flags) EXCLUSIVE_LOCKS_REQUIRED(cs_main, !m_mutex)
+    {
+        const FlatFilePos pos = pindex->GetBlockPos();
+        LOCK(m_mutex);
+        for (const auto& entry : m_queue) {
+            if (entry->hash == pindex->GetBlockHash()) return;
+        }
+        auto entry = std::make_shared<Entry>();
+        entry->hash = pindex->GetBlockHash();
+        entry->pos = pos;
+        entry->script_flags = script_flags;
+        m_queue.push_back(std::move(entry));
+        m_cv.notify_all();
+    }
+
+    //! The block of pindex, once it is read. nullptr when it was not queued or could not be read.
+    std::shared_ptr<const CBlock> Take(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        auto it = std::find_if(m_queue.begin(), m_queue.end(), [&](const std::shared_ptr<Entry>& entry) { return entry->hash == pindex->GetBlockHash(); });
+        // The blocks queued before this one are not going to be connected any more
+        std::shared_ptr<Entry> entry = it != m_queue.end() ? *it : nullptr;
+        const auto taken_end = it != m_queue.end() ? std::next(it) : it;
+        for (auto taken = m_queue.begin(); taken != taken_end; ++taken) {
+            (*taken)->taken = true;
+        }
+        m_queue.erase(m_queue.begin(), taken_end);
+        m_cv.notify_all();
+        if (!entry) return nullptr;
+        m_cv.wait(lock, [&] { return entry->done; });
+        return entry->block;
+    }
+
+private:
+    struct Entry {
+        uint256 hash;
+        FlatFilePos pos;
+        std::optional<unsigned int> script_flags;
+        bool reading{false};
+        bool done{false};
+        bool verifying{false};
+        //! Whether ConnectTip has taken the block or skipped it
+        bool taken{false};
+        std::shared_ptr<const CBlock> block;
+    };
+
+    std::shared_ptr<Entry> NextToRead() EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        int ready = 0;
+        for (const auto& entry : m_queue) {
+            if (entry->done) {
+                if (++ready >= MAX_BLOCK_PREFETCH) return nullptr;
+            } else if (!entry->reading) {
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    //! The first block of the queue not verified yet, once it is read
+    std::shared_ptr<Entry> NextToVerify() EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        for (const auto& entry : m_queue) {
+            if (!entry->done) return nullptr;
+            if (!entry->verifying) return entry;
+        }
+        return nullptr;
+    }
+
+    void ThreadRead() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        while (true) {
+            std::shared_ptr<Entry> entry;
+            m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || (entry = NextToRead()); });
+            if (m_stop) return;
+
+            entry->reading = true;
+            auto block = std::make_shared<CBlock>();
+            bool read = false;
+            {
+                REVERSE_LOCK(lock);
+                // The block is connected and dropped, its scripts can share a few chunks
+                DeserializeArena arena;
+                DeserializeArenaScope arena_scope{arena};
+                read = ReadBlockFromDisk(*block, entry->pos, m_consensus) && block->GetHash() == entry->hash;
+            }
+            // A block that could not be read is read again by ConnectTip, which reports the error
+            if (read) entry->block = block;
+            entry->done = true;
+            m_cv.notify_all();
+
+            if (read && m_coins_db) {
+                REVERSE_LOCK(lock);
+                for (const CTransactionRef& tx : block->vtx) {
+                    if (tx->IsCoinBase()) continue;
+                    for (const CTxIn& txin : tx->vin) {
+                        m_coins_db->HaveCoin(txin.prevout);
+                    }
+                }
+            }
+        }
+    }
+
+    void ThreadVerify() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        while (true) {
+            std::shared_ptr<Entry> entry;
+            m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || (entry = NextToVerify()); });
+            if (m_stop) return;
+
+            entry->verifying = true;
+            if (!entry->block) continue;
+            REVERSE_LOCK(lock);
+            VerifySignatures(*entry);
+        }
+    }
+
+    //! The output spent by @p prevout, from the blocks read before or the coins database
+    std::optional<CTxOut> SpentOutput(const COutPoint& prevout) const
+    {
+        auto it = m_recent_txs.find(prevout.hash);
+        if (it != m_recent_txs.end()) {
+            if (prevout.n >= it->second->vout.size()) return std::nullopt;
+            return it->second->vout[prevout.n];
+        }
+        Coin coin;
+        if (m_coins_db && m_coins_db->GetCoin(prevout, coin)) return coin.out;
+        return std::nullopt;
+    }
+
+    void VerifySignatures(const Entry& entry) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        // The outputs of the block are recorded first, they can be spent in the block itself
+        for (const CTransactionRef& tx : entry.block->vtx) {
+            m_recent_txs.emplace(tx->GetHash(), tx);
+        }
+        m_recent_blocks.push_back(entry.block);
+        if (m_recent_blocks.size() > MAX_BLOCK_PRECHECK_OUTPUTS) {
+            for (const CTransactionRef& tx : m_recent_blocks.front()->vtx) {
+                m_recent_txs.erase(tx->GetHash());
+            }
+            m_recent_blocks.pop_front();
+        }
+
+        if (!entry.script_flags) return;
+        for (const CTransactionRef& tx : entry.block->vtx) {
+            if (tx->IsCoinBase()) continue;
+            // ConnectTip is at this block already, it verifies the rest itself
+            if (WITH_LOCK(m_mutex, return entry.taken)) return;
+
+            std::vector<CTxOut> spent_outputs;
+            spent_outputs.reserve(tx->vin.size());
+            for (const CTxIn& txin : tx->vin) {
+                std::optional<CTxOut> spent = SpentOutput(txin.prevout);
+                if (!spent) break;
+                spent_outputs.push_back(std::move(*spent));
+            }
+            if (spent_outputs.size() != tx->vin.size()) continue;
+
+            PrecomputedTransactionData txdata;
+            txdata.Init(*tx, std::move(spent_outputs));
+            for (unsigned int i = 0; i < tx->vin.size(); i++) {
+                CScriptCheck check(txdata.m_spent_outputs[i], *tx, i, *entry.script_flags, /*cacheIn=*/true, &txdata);
+                if (!check()) break;
+            }
+        }
+    }
+
+    const Consensus::Params& m_consensus;
+    //! Coins database of the chainstate, nullptr when it is not looked up
+    CCoinsView* const m_coins_db;
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::shared_ptr<Entry>> m_queue GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    //! Blocks verified last and their transactions by txid, only used by the verification thread
+    std::deque<std::shared_ptr<const CBlock>> m_recent_blocks;
+    std::unordered_map<uint256, CTransactionRef, SaltedTxidHasher> m_recent_txs;
+    std::thread m_thread;
+    std::thread m_verify_thread;
+};
+
 static SteadyClock::duration time_read_from_disk_total{};
 static SteadyClock::duration time_connect_total{};
 static SteadyClock::duration time_flush{};
 static SteadyClock::duration time_chainstate{};
 static SteadyClock::duration time_post_connect{};
 
+BlockConnectionTimings GetBlockConnectionTimings()
+{
+    AssertLockHeld(::cs_main);
+    BlockConnectionTimings timings;
+    timings.blocks = num_blocks_total;
+    timings.read_from_disk = time_read_from_disk_total;
+    timings.check = time_check;
+    timings.forks = time_forks;
+    timings.connect = time_connect;
+    timings.contracts = time_contracts;
+    timings.verify = time_verify;
+    timings.undo = time_undo;
+    timings.index = time_index;
+    timings.connect_total = time_connect_total;
+    timings.flush = time_flush;
+    timings.chainstate = time_chainstate;
+    timings.post_connect = time_post_connect;
+    timings.total = time_total;
+    return timings;
+}
+
 struct PerBlockConnectTrace {
     CBlockIndex* pindex = nullptr;
     std::shared_ptr<const CBlock> pblock;
+    //! Receipts of the contract executions of the block, null when it has none
+    std::shared_ptr<const std::vector<TransactionReceiptInfo>> receipts;
     PerBlockConnectTrace() = default;
 };
 /**
@@ -4225,12 +5555,13 @@ private:
 public:
     explicit ConnectTrace() : blocksConnected(1) {}
 
-    void BlockConnected(CBlockIndex* pindex, std::shared_ptr<const CBlock> pblock) {
+    void BlockConnected(CBlockIndex* pindex, std::shared_ptr<const CBlock> pblock, std::shared_ptr<const std::vector<TransactionReceiptInfo>> receipts = nullptr) {
         assert(!blocksConnected.back().pindex);
         assert(pindex);
         assert(pblock);
         blocksConnected.back().pindex = pindex;
         blocksConnected.back().pblock = std::move(pblock);
+        blocksConnected.back().receipts = std::move(receipts);
         blocksConnected.emplace_back();
     }
 
@@ -4255,6 +5586,7 @@ public:
 bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool)
 {
     AssertLockHeld(cs_main);
+    QtumContext& qtum{m_chainman.Qtum()};
     if (m_mempool) AssertLockHeld(m_mempool->cs);
 
     assert(pindexNew->pprev == m_chain.Tip());
@@ -4263,6 +5595,8 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
     std::shared_ptr<const CBlock> pthisBlock;
     if (!pblock) {
         std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
+        DeserializeArena arena;
+        DeserializeArenaScope arena_scope{arena};
         if (!ReadBlockFromDisk(*pblockNew, pindexNew, m_chainman.GetConsensus())) {
             return AbortNode(state, "Failed to read block");
         }
@@ -4280,21 +5614,24 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
              Ticks<MillisecondsDouble>(time_2 - time_1),
              Ticks<SecondsDouble>(time_read_from_disk_total),
              Ticks<MillisecondsDouble>(time_read_from_disk_total) / num_blocks_total);
+    std::vector<TransactionReceiptInfo> receipts;
     {
         CCoinsViewCache view(&CoinsTip());
 
-        dev::h256 oldHashStateRoot(globalState->rootHash()); // qtum
-        dev::h256 oldHashUTXORoot(globalState->rootHashUTXO()); // qtum
+        dev::h256 oldHashStateRoot(qtum.state->rootHash()); // qtum
+        dev::h256 oldHashUTXORoot(qtum.state->rootHashUTXO()); // qtum
+        // During the initial block download the trie nodes are written in batches with the chainstate
+        qtum.state->setDeferWrites(IsInitialBlockDownload());
 
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view);
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, /*fJustCheck=*/false, &receipts);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
                 InvalidBlockFound(pindexNew, state);
 
-            globalState->setRoot(oldHashStateRoot); // qtum
-            globalState->setRootUTXO(oldHashUTXORoot); // qtum
-            pstorageresult->clearCacheResult();
+            qtum.state->setRoot(oldHashStateRoot); // qtum
+            qtum.state->setRootUTXO(oldHashUTXORoot); // qtum
+            qtum.storageResults->clearCacheResult();
             return error("%s: ConnectBlock %s failed, %s", __func__, pindexNew->GetBlockHash().ToString(), state.ToString());
         }
         time_3 = SteadyClock::now();
@@ -4330,6 +5667,9 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
     }
     // Update m_chain & related variables.
     m_chain.SetTip(*pindexNew);
+    if (this == &m_chainman.ActiveChainstate()) {
+        m_chainman.m_stale_block_index.erase({pindexNew->nHeight, pindexNew});
+    }
     UpdateTip(pindexNew);
 
     const auto time_6{SteadyClock::now()};
@@ -4352,7 +5692,11 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
         m_chainman.MaybeCompleteSnapshotValidation();
     }
 
-    connectTrace.BlockConnected(pindexNew, std::move(pthisBlock));
+    // Requested database compactions wait for the blocks to stop arriving
+    GetCompactionController().NotifyTip(IsInitialBlockDownload());
+
+    connectTrace.BlockConnected(pindexNew, std::move(pthisBlock),
+                                receipts.empty() ? nullptr : std::make_shared<const std::vector<TransactionReceiptInfo>>(std::move(receipts)));
     return true;
 }
 
@@ -4436,7 +5780,7 @@ void Chainstate::PruneBlockIndexCandidates() {
  *
  * @returns true unless a system error occurred
  */
-bool Chainstate::ActivateBestChainStep(BlockValidationState& state, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace)
+bool Chainstate::ActivateBestChainStep(BlockValidationState& state, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace, BlockPrefetcher* prefetcher)
 {
     AssertLockHeld(cs_main);
     if (m_mempool) AssertLockHeld(m_mempool->cs);
@@ -4445,10 +5789,20 @@ bool Chainstate::ActivateBestChainStep(BlockValidationState& state, CBlockIndex*
     const CBlockIndex* pindexFork = m_chain.FindFork(pindexMostWork);
 
     // Disconnect active blocks which are no longer in the best chain.
+    // A reorg of more than one block reads the blocks ahead and defers the
+    // qtum index work until all of them are disconnected.
     bool fBlocksDisconnected = false;
     DisconnectedBlockTransactions disconnectpool;
+    std::optional<ReorgDisconnect> reorg;
+    if (pindexOldTip && pindexFork && pindexOldTip->nHeight - pindexFork->nHeight > 1) {
+        reorg.emplace();
+    }
     while (m_chain.Tip() && m_chain.Tip() != pindexFork) {
-        if (!DisconnectTip(state, &disconnectpool)) {
+        if (reorg && reorg->prefetched.empty()) {
+            PrefetchDisconnect(*reorg, pindexFork);
+        }
+        if (!DisconnectTip(state, &disconnectpool, reorg ? &*reorg : nullptr)) {
+            if (reorg) FinishDisconnect(*reorg);
             // This is likely a fatal error, but keep the mempool consistent,
             // just in case. Only remove from the mempool in this case.
             MaybeUpdateMempoolForReorg(disconnectpool, false);
@@ -4461,6 +5815,9 @@ bool Chainstate::ActivateBestChainStep(BlockValidationState& state, CBlockIndex*
         }
         fBlocksDisconnected = true;
     }
+    if (reorg) {
+        FinishDisconnect(*reorg);
+    }
 
     // Build list of new blocks to connect (in descending height order).
     std::vector<CBlockIndex*> vpindexToConnect;
@@ -4479,9 +5836,20 @@ bool Chainstate::ActivateBestChainStep(BlockValidationState& state, CBlockIndex*
         }
         nHeight = nTargetHeight;
 
+        if (prefetcher) {
+            for (CBlockIndex* pindexConnect : reverse_iterate(vpindexToConnect)) {
+                if (pindexConnect == pindexMostWork && pblock) continue;
+                prefetcher->Schedule(pindexConnect, IsAssumedValid(*pindexConnect, m_chainman) ? std::nullopt : std::optional{GetBlockScriptFlags(*pindexConnect, m_chainman)});
+            }
+        }
+
         // Connect new blocks.
         for (CBlockIndex* pindexConnect : reverse_iterate(vpindexToConnect)) {
-            if (!ConnectTip(state, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
+            std::shared_ptr<const CBlock> pblockConnect = pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>();
+            if (!pblockConnect && prefetcher) {
+                pblockConnect = prefetcher->Take(pindexConnect);
+            }
+            if (!ConnectTip(state, pindexConnect, pblockConnect, connectTrace, disconnectpool)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
                     if (state.GetResult() != BlockValidationResult::BLOCK_MUTATED) {
@@ -4561,6 +5929,7 @@ static void LimitValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main) {
 bool Chainstate::ActivateBestChain(BlockValidationState& state, std::shared_ptr<const CBlock> pblock)
 {
     AssertLockNotHeld(m_chainstate_mutex);
+    AllocScope alloc_scope{AllocTag::VALIDATION};
 
     // Note that while we're often called here from ProcessNewBlock, this is
     // far from a guarantee. Things in the P2P/RPC will often end up calling
@@ -4585,6 +5954,8 @@ bool Chainstate::ActivateBestChain(BlockValidationState& state, std::shared_ptr<
     CBlockIndex *pindexMostWork = nullptr;
     CBlockIndex *pindexNewTip = nullptr;
     int nStopAtHeight = gArgs.GetIntArg("-stopatheight", DEFAULT_STOPATHEIGHT);
+    // Reads the blocks ahead when more than one block is connected, it lives across the releases of cs_main
+    std::unique_ptr<BlockPrefetcher> prefetcher;
     do {
         // Block until the validation queue drains. This should largely
         // never happen in normal operation, however may happen during
@@ -4614,9 +5985,14 @@ bool Chainstate::ActivateBestChain(BlockValidationState& state, std::shared_ptr<
                     break;
                 }
 
+                if (!prefetcher && pindexMostWork->nHeight > m_chain.Height() + 1) {
+                    // The coins database is not looked up while a snapshot chainstate may resize it
+                    prefetcher = std::make_unique<BlockPrefetcher>(m_chainman.GetConsensus(), m_chainman.IsSnapshotActive() ? nullptr : &CoinsDB());
+                }
+
                 bool fInvalidFound = false;
                 std::shared_ptr<const CBlock> nullBlockPtr;
-                if (!ActivateBestChainStep(state, pindexMostWork, pblock && pblock->GetHash() == pindexMostWork->GetBlockHash() ? pblock : nullBlockPtr, fInvalidFound, connectTrace)) {
+                if (!ActivateBestChainStep(state, pindexMostWork, pblock && pblock->GetHash() == pindexMostWork->GetBlockHash() ? pblock : nullBlockPtr, fInvalidFound, connectTrace, prefetcher.get())) {
                     // A system error occurred
                     return false;
                 }
@@ -4631,6 +6007,10 @@ bool Chainstate::ActivateBestChain(BlockValidationState& state, std::shared_ptr<
                 for (const PerBlockConnectTrace& trace : connectTrace.GetBlocksConnected()) {
                     assert(trace.pblock && trace.pindex);
                     GetMainSignals().BlockConnected(trace.pblock, trace.pindex);
+                    if (trace.receipts) {
+                        if (m_chainman.m_options.receipts_callback) m_chainman.m_options.receipts_callback(*trace.pindex, *trace.receipts);
+                        GetMainSignals().BlockReceiptsConnected(trace.receipts, trace.pindex);
+                    }
                 }
 
                 // This will have been toggled in
@@ -5399,7 +6779,7 @@ static bool ContextualCheckBlock(const CBlock& block, BlockValidationState& stat
     return true;
 }
 
-bool Chainstate::UpdateHashProof(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, CBlockIndex* pindex, CCoinsViewCache& view)
+bool Chainstate::UpdateHashProof(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, CBlockIndex* pindex, CCoinsViewCache& view, const uint256* knownHashProof)
 {
     int nHeight = pindex->nHeight;
     uint256 hash = block.GetHash();
@@ -5418,10 +6798,22 @@ bool Chainstate::UpdateHashProof(const CBlock& block, BlockValidationState& stat
 
     uint256 hashProof;
     // Verify hash target and signature of coinstake tx
-    if (block.IsProofOfStake())
+    if (block.IsProofOfStake() && knownHashProof)
+    {
+        hashProof = *knownHashProof;
+    }
+    else if (block.IsProofOfStake())
     {
         uint256 targetProofOfStake;
-        if (!CheckProofOfStake(pindex->pprev, state, *block.vtx[1], block.nBits, block.nTime, block.GetProofOfDelegation(), block.prevoutStake, hashProof, targetProofOfStake, view, *this))
+        const auto time_start{SteadyClock::now()};
+        bool fValid = CheckProofOfStake(pindex->pprev, state, *block.vtx[1], block.nBits, block.nTime, block.GetProofOfDelegation(), block.prevoutStake, hashProof, targetProofOfStake, view, *this);
+        TRACE4(qtum, check_proof_of_stake,
+            hash.data(),
+            nHeight,
+            fValid,
+            Ticks<std::chrono::microseconds>(SteadyClock::now() - time_start)
+        );
+        if (!fValid)
         {
             return error("UpdateHashProof() : check proof-of-stake failed for block %s", hash.ToString());
         }
@@ -5592,6 +6984,9 @@ bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValida
         return state.Invalid(BlockValidationResult::BLOCK_HEADER_LOW_WORK, "too-little-chainwork");
     }
     CBlockIndex* pindex{m_blockman.AddToBlockIndex(block, m_best_header)};
+    if (!ActiveChain().Contains(pindex)) {
+        m_stale_block_index.emplace(pindex->nHeight, pindex);
+    }
 
     if (ppindex)
         *ppindex = pindex;
@@ -5617,8 +7012,9 @@ bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValida
 }
 
 // Exposed wrapper for AcceptBlockHeader
-bool ChainstateManager::ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, bool min_pow_checked, BlockValidationState& state, const CBlockIndex** ppindex,  const CBlockIndex** pindexFirst)
+bool ChainstateManager::ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, bool min_pow_checked, BlockValidationState& state, const CBlockIndex** ppindex, std::pair<int, int>* accepted_heights)
 {
+    if (accepted_heights) *accepted_heights = {-1, -1};
     if(!ActiveChainstate().IsInitialBlockDownload() && headers.size() > 1) {
         LOCK(cs_main);
         const CBlockHeader last_header = headers[headers.size()-1];
@@ -5630,7 +7026,9 @@ bool ChainstateManager::ProcessNewBlockHeaders(const std::vector<CBlockHeader>&
     AssertLockNotHeld(cs_main);
     {
         LOCK(cs_main);
-        bool bFirst = true;
+        if (!ActiveChainstate().IsInitialBlockDownload() && headers.size() > 1) {
+            VerifyHeaderSignatures(headers);
+        }
         bool fInstantBan = false;
         for (size_t i = 0; i < headers.size(); ++i) {
             const CBlockHeader& header = headers[i];
@@ -5664,13 +7062,13 @@ bool ChainstateManager::ProcessNewBlockHeaders(const std::vector<CBlockHeader>&
             }
             if (ppindex) {
                 *ppindex = pindex;
-                if(bFirst && pindexFirst)
-                {
-                    *pindexFirst = pindex;
-                    bFirst = false;
-                }
+            }
+            if (accepted_heights) {
+                if (accepted_heights->first < 0) accepted_heights->first = pindex->nHeight;
+                accepted_heights->second = pindex->nHeight;
             }
         }
+        m_verified_header_signatures.clear();
     }
     if (NotifyHeaderTip(ActiveChainstate())) {
         if (ActiveChainstate().IsInitialBlockDownload() && ppindex && *ppindex) {
@@ -5683,6 +7081,42 @@ bool ChainstateManager::ProcessNewBlockHeaders(const std::vector<CBlockHeader>&
     return true;
 }
 
+void ChainstateManager::VerifyHeaderSignatures(const std::vector<CBlockHeader>& headers)
+{
+    AssertLockHeld(cs_main);
+    m_verified_header_signatures.clear();
+    if (!headersigcheckqueue.HasThreads()) return;
+
+    // The headers have to follow each other from a known block for their heights to be known
+    const CBlockIndex* pindexPrev = m_blockman.LookupBlockIndex(headers[0].hashPrevBlock);
+    if (!pindexPrev) return;
+
+    // The stake coins are read here, only the signatures are checked by the workers
+    std::vector<HeaderSignatureCheck> checks;
+    std::vector<uint256> hashes;
+    std::vector<uint256> checked;
+    CCoinsViewCache& view = ActiveChainstate().CoinsTip();
+    int nHeight = pindexPrev->nHeight + 1;
+    for (size_t i = 0; i < headers.size(); ++i, ++nHeight) {
+        const CBlockHeader& header = headers[i];
+        if (i > 0 && header.hashPrevBlock != hashes.back()) break;
+        hashes.push_back(header.GetHash());
+        if (!header.IsProofOfStake() || nHeight - 1 < GetConsensus().nEnableHeaderSignatureHeight) continue;
+
+        Coin coin;
+        if (!view.GetCoin(header.prevoutStake, coin)) continue;
+        checks.emplace_back(&header, nHeight, coin.out.scriptPubKey);
+        checked.push_back(hashes.back());
+    }
+    if (checks.size() < 2) return;
+
+    // A failure is only reported for the whole batch, the headers are then checked again one by one
+    CCheckQueueControl<HeaderSignatureCheck> control(&headersigcheckqueue);
+    control.Add(std::move(checks));
+    if (!control.Wait()) return;
+    m_verified_header_signatures.insert(checked.begin(), checked.end());
+}
+
 void ChainstateManager::ReportHeadersPresync(const arith_uint256& work, int64_t height, int64_t timestamp)
 {
     AssertLockNotHeld(cs_main);
@@ -5863,6 +7297,7 @@ bool CheckCanonicalBlockSignature(const CBlockHeader* pblock)
 bool ChainstateManager::ProcessNewBlock(const std::shared_ptr<const CBlock>& block, bool force_processing, bool min_pow_checked, bool* new_block)
 {
     AssertLockNotHeld(cs_main);
+    AllocScope alloc_scope{AllocTag::VALIDATION};
 
     {
         CBlockIndex *pindex = nullptr;
@@ -5923,6 +7358,7 @@ bool TestBlockValidity(BlockValidationState& state,
                        bool fCheckMerkleRoot)
 {
     AssertLockHeld(cs_main);
+    QtumContext& qtum{chainstate.m_chainman.Qtum()};
     assert(pindexPrev && pindexPrev == chainstate.m_chain.Tip());
     CCoinsViewCache viewNew(&chainstate.CoinsTip());
     uint256 block_hash(block.GetHash());
@@ -5939,13 +7375,13 @@ bool TestBlockValidity(BlockValidationState& state,
     if (!ContextualCheckBlock(block, state, chainstate.m_chainman, pindexPrev))
         return error("%s: Consensus::ContextualCheckBlock: %s", __func__, state.ToString());
 
-    dev::h256 oldHashStateRoot(globalState->rootHash()); // qtum
-    dev::h256 oldHashUTXORoot(globalState->rootHashUTXO()); // qtum
+    dev::h256 oldHashStateRoot(qtum.state->rootHash()); // qtum
+    dev::h256 oldHashUTXORoot(qtum.state->rootHashUTXO()); // qtum
 
     if (!chainstate.ConnectBlock(block, state, &indexDummy, viewNew, true)) {
-        globalState->setRoot(oldHashStateRoot); // qtum
-        globalState->setRootUTXO(oldHashUTXORoot); // qtum
-        pstorageresult->clearCacheResult();
+        qtum.state->setRoot(oldHashStateRoot); // qtum
+        qtum.state->setRootUTXO(oldHashUTXORoot); // qtum
+        qtum.storageResults->clearCacheResult();
         return false;
     }
     assert(state.IsValid());
@@ -5961,6 +7397,8 @@ void PruneBlockFilesManual(Chainstate& active_chainstate, int nManualPruneHeight
             state, FlushStateMode::NONE, nManualPruneHeight)) {
         LogPrintf("%s: failed to flush state (%s)\n", __func__, state.ToString());
     }
+    // The files are gone when pruneblockchain returns
+    active_chainstate.m_blockman.WaitForPrunedFiles();
 }
 
 void Chainstate::LoadMempool(const fs::path& load_path, FopenFn mockable_fopen_function)
@@ -6015,6 +7453,7 @@ VerifyDBResult CVerifyDB::VerifyDB(
     int nCheckLevel, int nCheckDepth)
 {
     AssertLockHeld(cs_main);
+    QtumContext& qtum{chainstate.m_chainman.Qtum()};
 
     if (chainstate.m_chain.Tip() == nullptr || chainstate.m_chain.Tip()->pprev == nullptr) {
         return VerifyDBResult::SUCCESS;
@@ -6036,9 +7475,9 @@ VerifyDBResult CVerifyDB::VerifyDB(
     bool skipped_l3_checks{false};
 
 ////////////////////////////////////////////////////////////////////////// // qtum
-    dev::h256 oldHashStateRoot(globalState->rootHash());
-    dev::h256 oldHashUTXORoot(globalState->rootHashUTXO());
-    QtumDGP qtumDGP(globalState.get(), chainstate, fGettingValuesDGP);
+    dev::h256 oldHashStateRoot(qtum.state->rootHash());
+    dev::h256 oldHashUTXORoot(qtum.state->rootHashUTXO());
+    QtumDGP qtumDGP(qtum.state.get(), chainstate, fGettingValuesDGP);
 //////////////////////////////////////////////////////////////////////////
 
     LogPrintf("Verification progress: 0%%\n");
@@ -6144,21 +7583,21 @@ VerifyDBResult CVerifyDB::VerifyDB(
                 return VerifyDBResult::CORRUPTED_BLOCK_DB;
             }
 
-            dev::h256 oldHashStateRoot(globalState->rootHash()); // qtum
-            dev::h256 oldHashUTXORoot(globalState->rootHashUTXO()); // qtum
+            dev::h256 oldHashStateRoot(qtum.state->rootHash()); // qtum
+            dev::h256 oldHashUTXORoot(qtum.state->rootHashUTXO()); // qtum
 
             if (!chainstate.ConnectBlock(block, state, pindex, coins)) {
                 LogPrintf("Verification error: found unconnectable block at %d, hash=%s (%s)\n", pindex->nHeight, pindex->GetBlockHash().ToString(), state.ToString());
-                globalState->setRoot(oldHashStateRoot); // qtum
-                globalState->setRootUTXO(oldHashUTXORoot); // qtum
-                pstorageresult->clearCacheResult();
+                qtum.state->setRoot(oldHashStateRoot); // qtum
+                qtum.state->setRootUTXO(oldHashUTXORoot); // qtum
+                qtum.storageResults->clearCacheResult();
                 return VerifyDBResult::CORRUPTED_BLOCK_DB;
             }
             if (ShutdownRequested()) return VerifyDBResult::INTERRUPTED;
         }
     } else {
-        globalState->setRoot(oldHashStateRoot); // qtum
-        globalState->setRootUTXO(oldHashUTXORoot); // qtum
+        qtum.state->setRoot(oldHashStateRoot); // qtum
+        qtum.state->setRootUTXO(oldHashUTXORoot); // qtum
     }
 
     LogPrintf("Verification: No coin database inconsistencies in last %i blocks (%i transactions)\n", block_count, nGoodTransactions);
@@ -6172,6 +7611,61 @@ VerifyDBResult CVerifyDB::VerifyDB(
     return VerifyDBResult::SUCCESS;
 }
 
+StateRootVerifier::StateRootVerifier(Chainstate& chainstate, int check_depth)
+    : m_chainstate(chainstate), m_check_depth(check_depth) {}
+
+bool StateRootVerifier::CheckRoot(const dev::OverlayDB& db, const dev::h256& root)
+{
+    if (root == dev::EmptyTrie || !root) return true;
+    const std::string node = db.lookup(root);
+    return !node.empty() && dev::sha3(node) == root;
+}
+
+bool StateRootVerifier::Step()
+{
+    if (m_result != VerifyDBResult::SUCCESS || m_depth > m_check_depth) return false;
+
+    std::unique_ptr<dev::OverlayDB> state_db;
+    std::unique_ptr<dev::OverlayDB> utxo_db;
+    std::vector<std::pair<int, std::pair<dev::h256, dev::h256>>> roots;
+    {
+        LOCK(cs_main);
+        if (!m_chainstate.m_chainman.Qtum().state) return false;
+        const CChain& chain = m_chainstate.m_chain;
+        if (m_tip_height < 0) {
+            m_tip_height = chain.Height();
+            if (m_tip_height < 0) return false;
+        }
+        // The copies share the databases of the global state, and their nodes of the blocks committed so far
+        state_db = std::make_unique<dev::OverlayDB>(m_chainstate.m_chainman.Qtum().state->db());
+        utxo_db = std::make_unique<dev::OverlayDB>(m_chainstate.m_chainman.Qtum().state->dbUtxo());
+        for (int samples = 0; samples < STATE_ROOT_CHECK_BATCH && m_depth <= m_check_depth && m_depth <= m_tip_height; ++samples) {
+            const int height = m_tip_height - m_depth;
+            m_depth += std::max(1, m_depth / STATE_ROOT_CHECK_BATCH);
+            // Blocks disconnected since the verification started are not checked
+            const CBlockIndex* pindex = chain[height];
+            if (!pindex) continue;
+            // Most blocks do not change the states, their roots are checked once
+            if (pindex->hashStateRoot == m_last_state_root && pindex->hashUTXORoot == m_last_utxo_root) continue;
+            m_last_state_root = pindex->hashStateRoot;
+            m_last_utxo_root = pindex->hashUTXORoot;
+            roots.emplace_back(height, std::make_pair(uintToh256(pindex->hashStateRoot), uintToh256(pindex->hashUTXORoot)));
+        }
+    }
+
+    for (const auto& [height, root] : roots) {
+        if (ShutdownRequested()) return false;
+        if (!CheckRoot(*state_db, root.first) || !CheckRoot(*utxo_db, root.second)) {
+            LogPrintf("%s: state root %s or UTXO root %s of block at height %d is missing or corrupted\n",
+                      __func__, root.first.hex(), root.second.hex(), height);
+            m_result = VerifyDBResult::CORRUPTED_BLOCK_DB;
+            return false;
+        }
+        ++m_checked;
+    }
+    return m_depth <= m_check_depth && m_depth <= m_tip_height;
+}
+
 /** Apply the effects of a block on the utxo cache, ignoring that it may already have been applied. */
 bool Chainstate::RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs)
 {
@@ -6382,10 +7876,6 @@ bool ChainstateManager::LoadBlockIndex()
         // Use the provided setting for -logevents in the new database
         fLogEvents = gArgs.GetBoolArg("-logevents", DEFAULT_LOGEVENTS);
         m_blockman.m_block_tree_db->WriteFlag("logevents", fLogEvents);
-        /////////////////////////////////////////////////////////////// // qtum
-        fAddressIndex = gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX);
-        m_blockman.m_block_tree_db->WriteFlag("addrindex", fAddressIndex);
-        ///////////////////////////////////////////////////////////////
     }
     return true;
 }
@@ -6866,9 +8356,23 @@ bool Chainstate::RemoveBlockIndex(CBlockIndex *pindex)
 
     m_chainman.m_versionbitscache.Erase(pindex);
 
+    m_chainman.m_stale_block_index.erase({pindex->nHeight, pindex});
+
     return true;
 }
 
+void ChainstateManager::SeedStaleBlockIndex()
+{
+    AssertLockHeld(cs_main);
+    if (m_stale_block_index_seeded) return;
+    for (auto& [hash, index] : m_blockman.m_block_index) {
+        if (!ActiveChain().Contains(&index)) {
+            m_stale_block_index.emplace(index.nHeight, &index);
+        }
+    }
+    m_stale_block_index_seeded = true;
+}
+
 //! Guess how far we are in the verification process at the given block index
 //! require cs_main if pindex has not been validated yet (because nChainTx might be unset)
 double GuessVerificationProgress(const ChainTxData& data, const CBlockIndex *pindex) {
@@ -7159,23 +8663,14 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
 
     const AssumeutxoData& au_data = *maybe_au_data;
 
-    COutPoint outpoint;
-    Coin coin;
     const uint64_t coins_count = metadata.m_coins_count;
     uint64_t coins_left = metadata.m_coins_count;
 
     LogPrintf("[snapshot] loading coins from snapshot %s\n", base_blockhash.ToString());
     int64_t coins_processed{0};
 
-    while (coins_left > 0) {
-        try {
-            coins_file >> outpoint;
-            coins_file >> coin;
-        } catch (const std::ios_base::failure&) {
-            LogPrintf("[snapshot] bad snapshot format or truncated snapshot after deserializing %d coins\n",
-                      coins_count - coins_left);
-            return false;
-        }
+    // Check and add a deserialized coin, @returns false when the snapshot is bad or shutdown was requested
+    const auto add_coin = [&](COutPoint&& outpoint, Coin&& coin) {
         if (coin.nHeight > base_height ||
             outpoint.n >= std::numeric_limits<decltype(outpoint.n)>::max() // Avoid integer wrap-around in coinstats.cpp:ApplyHash
         ) {
@@ -7218,6 +8713,61 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
                 FlushSnapshotToDisk(coins_cache, /*snapshot_loaded=*/false);
             }
         }
+        return true;
+    };
+
+    if (metadata.m_version == node::SNAPSHOT_VERSION_CHUNKED) {
+        // The next chunks are read and checked against their hash while the coins of a chunk are added
+        node::SnapshotChunkReader reader{coins_file, std::clamp(GetNumCores(), 1, node::MAX_SNAPSHOT_THREADS)};
+        node::SnapshotCoins coins;
+        try {
+            while (reader.Next(coins)) {
+                if (coins.size() > coins_left) {
+                    LogPrintf("[snapshot] bad snapshot - coins left over after deserializing %d coins\n",
+                        coins_count);
+                    return false;
+                }
+                for (auto& [outpoint, coin] : coins) {
+                    if (!add_coin(std::move(outpoint), std::move(coin))) return false;
+                }
+            }
+        } catch (const std::ios_base::failure& e) {
+            LogPrintf("[snapshot] bad snapshot format or truncated snapshot after deserializing %d coins: %s\n",
+                      coins_count - coins_left, e.what());
+            return false;
+        }
+        if (coins_left > 0) {
+            LogPrintf("[snapshot] bad snapshot - truncated snapshot after deserializing %d coins\n",
+                      coins_count - coins_left);
+            return false;
+        }
+    } else {
+        COutPoint outpoint;
+        Coin coin;
+        while (coins_left > 0) {
+            try {
+                coins_file >> outpoint;
+                coins_file >> coin;
+            } catch (const std::ios_base::failure&) {
+                LogPrintf("[snapshot] bad snapshot format or truncated snapshot after deserializing %d coins\n",
+                          coins_count - coins_left);
+                return false;
+            }
+            if (!add_coin(std::move(outpoint), std::move(coin))) return false;
+        }
+
+        bool out_of_coins{false};
+        try {
+            coins_file >> outpoint;
+        } catch (const std::ios_base::failure&) {
+            // We expect an exception since we should be out of coins.
+            out_of_coins = true;
+        }
+        if (!out_of_coins) {
+            LogPrintf("[snapshot] bad snapshot - coins left over after deserializing %d coins\n",
+                coins_count);
+            return false;
+        }
     }
 
     // Important that we set this. This and the coins_cache accesses above are
@@ -7227,19 +8777,6 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     // method.
     coins_cache.SetBestBlock(base_blockhash);
 
-    bool out_of_coins{false};
-    try {
-        coins_file >> outpoint;
-    } catch (const std::ios_base::failure&) {
-        // We expect an exception since we should be out of coins.
-        out_of_coins = true;
-    }
-    if (!out_of_coins) {
-        LogPrintf("[snapshot] bad snapshot - coins left over after deserializing %d coins\n",
-            coins_count);
-        return false;
-    }
-
     LogPrintf("[snapshot] loaded %d (%.2f MB) coins from snapshot %s\n",
         coins_count,
         coins_cache.DynamicMemoryUsage() / (1000 * 1000),
@@ -7538,6 +9075,7 @@ static ChainstateManager::Options&& Flatten(ChainstateManager::Options&& opts)
     if (!opts.check_block_index.has_value()) opts.check_block_index = opts.chainparams.DefaultConsistencyChecks();
     if (!opts.minimum_chain_work.has_value()) opts.minimum_chain_work = UintToArith256(opts.chainparams.GetConsensus().nMinimumChainWork);
     if (!opts.assumed_valid_block.has_value()) opts.assumed_valid_block = opts.chainparams.GetConsensus().defaultAssumeValid;
+    if (!opts.qtum_context) opts.qtum_context = g_qtum_context;
     Assert(opts.adjusted_time_callback);
     return std::move(opts);
 }
@@ -7735,17 +9273,28 @@ bool ChainstateManager::ValidatedSnapshotCleanup()
 }
 
 ////////////////////////////////////////////////////////////////////////////////// // qtum
-bool GetAddressIndex(uint256 addressHash, int type, std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, node::BlockManager& blockman, int start, int end)
+bool GetAddressIndex(uint256 addressHash, int type, std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, node::BlockManager& blockman, int start, int end, size_t limit)
 {
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!blockman.m_block_tree_db->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+    if (!g_addressindex || !g_addressindex->FindAddressDeltas(addressHash, type, addressIndex, start, end, limit))
         return error("unable to get txids for address");
 
     return true;
 }
 
+bool GetAddressBalance(uint256 addressHash, int type, AddressBalance &balance, node::BlockManager& blockman)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!g_addressindex || !g_addressindex->FindAddressBalance(addressHash, type, balance))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value, const CTxMemPool& mempool, node::BlockManager& blockman)
 {
     if (!fAddressIndex)
@@ -7754,7 +9303,7 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value, const CTxMemPoo
     if (mempool.getSpentIndex(key, value))
         return true;
 
-    if (!blockman.m_block_tree_db->ReadSpentIndex(key, value))
+    if (!g_addressindex || !g_addressindex->FindSpentInfo(key, value))
         return false;
 
     return true;
@@ -7765,18 +9314,29 @@ bool GetAddressUnspent(uint256 addressHash, int type, std::vector<std::pair<CAdd
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!blockman.m_block_tree_db->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
+    if (!g_addressindex || !g_addressindex->FindAddressUnspent(addressHash, type, unspentOutputs))
         return error("unable to get txids for address");
 
     return true;
 }
 
+bool GetAddressUnspent(const std::vector<std::pair<uint256, int> > &addresses, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs, node::BlockManager& blockman)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!g_addressindex || !g_addressindex->FindAddressUnspent(addresses, unspentOutputs))
+        return error("unable to get txids for addresses");
+
+    return true;
+}
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes, ChainstateManager& chainman)
 {
     if (!fAddressIndex)
         return error("Timestamp index not enabled");
 
-    if (!chainman.m_blockman.m_block_tree_db->ReadTimestampIndex(high, low, fActiveOnly, hashes, chainman))
+    if (!g_addressindex || !g_addressindex->FindBlocksByTimestamp(high, low, fActiveOnly, hashes))
         return error("Unable to get hashes for timestamps");
 
     return true;
@@ -7799,7 +9359,7 @@ CAmount GetTxGasFee(const CMutableTransaction& _tx, const CTxMemPool& mempool, C
         }
 
         dev::u256 sumGas = dev::u256(0);
-        for(QtumTransaction& qtx : resultConvertQtumTX.first){
+        for(const QtumTransaction& qtx : resultConvertQtumTX.first){
             sumGas += qtx.gas() * qtx.gasPrice();
         }
 
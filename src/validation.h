@@ -28,13 +28,17 @@
 #include <txdb.h>
 #include <txmempool.h> // For CTxMemPool::cs
 #include <uint256.h>
+#include <undo.h>
+#include <util/cachestats.h>
 #include <util/check.h>
 #include <util/fs.h>
 #include <util/hasher.h>
+#include <util/time.h>
 #include <util/translation.h>
 #include <versionbits.h>
 
 #include <atomic>
+#include <deque>
 #include <map>
 #include <memory>
 #include <optional>
@@ -42,6 +46,7 @@
 #include <stdint.h>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -55,26 +60,30 @@
 #include <libethashseal/GenesisInfo.h>
 #include <script/standard.h>
 #include <qtum/storageresults.h>
+#include <qtum/qtumcontext.h>
 
 
-extern std::unique_ptr<QtumState> globalState;
-extern std::shared_ptr<dev::eth::SealEngineFace> globalSealEngine;
-extern std::unique_ptr<StorageResults> pstorageresult;
+/** Members of the process-wide QtumContext, the one of the ChainstateManagers that are not given their own */
+extern std::unique_ptr<QtumState>& globalState;
+extern std::shared_ptr<dev::eth::SealEngineFace>& globalSealEngine;
+extern std::unique_ptr<StorageResults>& pstorageresult;
 extern bool fRecordLogOpcodes;
-extern bool fIsVMlogFile;
 extern bool fGettingValuesDGP;
 
 struct EthTransactionParams;
+struct AddressBalance;
 using valtype = std::vector<unsigned char>;
 using ExtractQtumTX = std::pair<std::vector<QtumTransaction>, std::vector<EthTransactionParams>>;
 ///////////////////////////////////////////
 
+class BatchSchnorrVerifier;
 class Chainstate;
 class CBlockTreeDB;
 class CTxMemPool;
 class ChainstateManager;
 struct ChainTxData;
 struct DisconnectedBlockTransactions;
+class BlockPrefetcher;
 struct PrecomputedTransactionData;
 struct LockPoints;
 struct AssumeutxoData;
@@ -96,6 +105,10 @@ static const uint64_t ADD_DELEGATION_MIN_GAS_LIMIT = 2200000;
 static const int MAX_SCRIPTCHECK_THREADS = 15;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of dedicated contract execution threads allowed */
+static const int MAX_CONTRACTEXEC_THREADS = 15;
+/** -parcontracts default (number of contract execution threads, 0 = execute contracts sequentially) */
+static const int DEFAULT_CONTRACTEXEC_THREADS = 0;
 static const bool DEFAULT_ADDRINDEX = false;
 static const bool DEFAULT_LOGEVENTS = false;
 /** Default for -stopatheight */
@@ -104,6 +117,10 @@ static const int DEFAULT_STOPATHEIGHT = 0;
 static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
 static const signed int DEFAULT_CHECKBLOCKS = 6;
 static constexpr int DEFAULT_CHECKLEVEL{3};
+/** Default for -checkstateroots, the depth below the tip whose state roots are checked in the background */
+static constexpr int DEFAULT_CHECKSTATEROOTS{10000};
+/** Number of sampled blocks whose state roots are checked by each step of StateRootVerifier */
+static constexpr int STATE_ROOT_CHECK_BATCH{64};
 // Require that user allocate at least 550 MiB for block & undo files (blk???.dat and rev???.dat)
 // At 1MB per block, 288 blocks = 288MB.
 // Add 15% for Undo data = 331MB
@@ -154,6 +171,18 @@ void StartScriptCheckWorkerThreads(int threads_num);
 /** Stop all of the script checking worker threads */
 void StopScriptCheckWorkerThreads();
 
+/**
+ * Verify the scripts of @p txs on the script checking worker threads, so that the signatures are
+ * found in the signature cache when the transactions are accepted to the mempool one by one. The
+ * inputs are read from the mempool and the coins tip, the transactions with missing inputs are
+ * skipped. Nothing is decided here, and nothing is done without worker threads.
+ */
+void PreverifyTxScripts(Chainstate& active_chainstate, const CTxMemPool& pool, const std::vector<CTransactionRef>& txs) LOCKS_EXCLUDED(cs_main);
+/** Run instances of speculative contract execution worker threads */
+void StartContractExecWorkerThreads(int threads_num);
+/** Stop all of the speculative contract execution worker threads */
+void StopContractExecWorkerThreads();
+
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams);
 
 bool AbortNode(BlockValidationState& state, const std::string& strMessage, const bilingual_str& userMessage = bilingual_str{});
@@ -161,6 +190,31 @@ bool AbortNode(BlockValidationState& state, const std::string& strMessage, const
 /** Guess verification progress (as a fraction between 0.0=genesis and 1.0=current tip). */
 double GuessVerificationProgress(const ChainTxData& data, const CBlockIndex* pindex);
 
+/**
+ * Time spent in the steps of connecting blocks since the start of the process, as logged with
+ * -debug=bench. The steps of ConnectBlock (check, forks, verify, undo, index) add up to
+ * connect_total, verify including connect (the transactions) and connect including contracts.
+ * The steps of ConnectTip (read_from_disk, connect_total, flush, chainstate, post_connect) add
+ * up to total.
+ */
+struct BlockConnectionTimings {
+    int64_t blocks{0};
+    SteadyClock::duration read_from_disk{};
+    SteadyClock::duration check{};
+    SteadyClock::duration forks{};
+    SteadyClock::duration connect{};
+    SteadyClock::duration contracts{};
+    SteadyClock::duration verify{};
+    SteadyClock::duration undo{};
+    SteadyClock::duration index{};
+    SteadyClock::duration connect_total{};
+    SteadyClock::duration flush{};
+    SteadyClock::duration chainstate{};
+    SteadyClock::duration post_connect{};
+    SteadyClock::duration total{};
+};
+BlockConnectionTimings GetBlockConnectionTimings() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
 /** Prune block files up to a given height */
 void PruneBlockFilesManual(Chainstate& active_chainstate, int nManualPruneHeight);
 
@@ -376,10 +430,12 @@ private:
     ScriptError error{SCRIPT_ERR_UNKNOWN_ERROR};
     PrecomputedTransactionData *txdata;
     int nOut;
+    //! Batch the Schnorr signatures of the input are deferred to, if set
+    BatchSchnorrVerifier* m_batch{nullptr};
 
 public:
-    CScriptCheck(const CTxOut& outIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn) :
-        m_tx_out(outIn), ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), txdata(txdataIn), nOut(-1) { }
+    CScriptCheck(const CTxOut& outIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn, BatchSchnorrVerifier* batch = nullptr) :
+        m_tx_out(outIn), ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), txdata(txdataIn), nOut(-1), m_batch(batch) { }
     CScriptCheck(const CTransaction& txToIn, int nOutIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn) :
         ptxTo(&txToIn), nIn(0), nFlags(nFlagsIn), cacheStore(cacheIn), txdata(txdataIn), nOut(nOutIn){ }
 
@@ -397,17 +453,25 @@ public:
 
 /** Initializes the script-execution cache */
 [[nodiscard]] bool InitScriptExecutionCache(size_t max_size_bytes);
+/** Set up the script-execution cache again with @p max_size_bytes, dropping its entries */
+[[nodiscard]] bool ResizeScriptExecutionCache(size_t max_size_bytes) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+CacheStats GetScriptExecutionCacheStats();
 
 ///////////////////////////////////////////////////////////////// // qtum
 bool GetAddressIndex(uint256 addressHash, int type,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, node::BlockManager& blockman,
-                     int start = 0, int end = 0);
+                     int start = 0, int end = 0, size_t limit = 0);
+
+bool GetAddressBalance(uint256 addressHash, int type, AddressBalance &balance, node::BlockManager& blockman);
 
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value, const CTxMemPool& mempool, node::BlockManager& blockman);
 
 bool GetAddressUnspent(uint256 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs, node::BlockManager& blockman);
 
+bool GetAddressUnspent(const std::vector<std::pair<uint256, int> > &addresses,
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs, node::BlockManager& blockman);
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes, ChainstateManager& chainman);
 
 bool GetAddressWeight(uint256 addressHash, int type, const std::map<COutPoint, uint32_t>& immatureStakes, int32_t nHeight, uint64_t& nWeight, node::BlockManager& blockman);
@@ -463,9 +527,49 @@ public:
         int nCheckDepth) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 };
 
+/**
+ * Check that the state and UTXO trie roots of the active chain are stored in the stateQtum databases
+ * and hash to the roots committed by the blocks, without connecting the blocks again like
+ * -checklevel 3 and 4 do. The blocks near the tip are all sampled, deeper blocks at intervals that
+ * grow with the depth.
+ *
+ * The samples are checked in steps, cs_main is only held while the roots of a step are read, so the
+ * verification can run in the background while the node syncs.
+ */
+class StateRootVerifier
+{
+public:
+    StateRootVerifier(Chainstate& chainstate, int check_depth);
+
+    /** Check the next STATE_ROOT_CHECK_BATCH samples, returns false once the verification is over */
+    bool Step() EXCLUSIVE_LOCKS_REQUIRED(!::cs_main);
+
+    /** SUCCESS, or CORRUPTED_BLOCK_DB if a root of a sampled block is missing or does not match its node */
+    VerifyDBResult Result() const { return m_result; }
+    /** Number of distinct roots checked so far */
+    int Checked() const { return m_checked; }
+
+private:
+    /** Whether @p root is the empty trie or is stored in @p db under its hash */
+    static bool CheckRoot(const dev::OverlayDB& db, const dev::h256& root);
+
+    Chainstate& m_chainstate;
+    const int m_check_depth;
+    //! Height the depths are counted from, the tip at the first step
+    int m_tip_height{-1};
+    int m_depth{0};
+    int m_checked{0};
+    uint256 m_last_state_root;
+    uint256 m_last_utxo_root;
+    VerifyDBResult m_result{VerifyDBResult::SUCCESS};
+};
+
 bool CheckReward(const CBlock& block, BlockValidationState& state, int nHeight, const Consensus::Params& consensusParams, CAmount nFees, CAmount gasRefunds, CAmount nActualStakeReward, const std::vector<CTxOut>& vouts, CAmount nValueCoinPrev, bool delegateOutputExist, CChain& chain, node::BlockManager& blockman);
 
 //////////////////////////////////////////////////////// qtum
+/** Number of recent blocks whose spent outpoints are kept in memory, it covers the largest coinbase maturity */
+static const int RECENT_SPENT_OUTPOINTS_BLOCKS = 2048;
+
 bool GetSpentCoinFromBlock(const CBlockIndex* pindex, COutPoint prevout, Coin* coin);
 
 bool GetSpentCoinFromMainChain(const CBlockIndex* pforkPrev, COutPoint prevoutStake, Coin* coin, CChain& chain);
@@ -474,11 +578,72 @@ unsigned int GetContractScriptFlags(int nHeight, const Consensus::Params& consen
 
 std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::vector<unsigned char> opcode, Chainstate& chainstate, const dev::Address& sender = dev::Address(), uint64_t gasLimit=0, CAmount nAmount=0);
 
+/** Parameters of one read-only contract call, see CallContract */
+struct ContractCall{
+    dev::Address addrContract;
+    std::vector<unsigned char> opcode;
+    dev::Address sender;
+    uint64_t gasLimit = 0;
+    CAmount nAmount = 0;
+};
+
+/** What read-only contract calls need from the tip, taken once under cs_main so that the calls can run without it */
+struct ContractCallSnapshot{
+    ContractCallSnapshot(std::shared_ptr<QtumContext> _qtum, CBlockIndex* _pindex, CChain& _chain) :
+        view(*_qtum->state, uintToh256(_pindex->hashStateRoot), uintToh256(_pindex->hashUTXORoot)), pindex(_pindex), chain(_chain), qtum(std::move(_qtum)) {}
+
+    QtumStateView view;
+    CBlockIndex* pindex;
+    CBlock block;
+    uint64_t blockGasLimit = 0;
+    dev::eth::EVMSchedule schedule;
+    /** Only handed to the execution, which runs at the height of pindex instead of reading it */
+    CChain& chain;
+    /** Context of the chainstate the snapshot was taken from, for the chain parameters of the seal engine */
+    std::shared_ptr<QtumContext> qtum;
+};
+
+/**
+ * Snapshot of the active tip for read-only contract calls. Snapshots are shared between callers
+ * until the tip changes, and stay valid after that.
+ */
+std::shared_ptr<const ContractCallSnapshot> GetContractCallSnapshot(Chainstate& chainstate);
+
+/** Drop the shared snapshot, which keeps the state databases open, and the gas estimates before the contract state is reset */
+void ResetContractCallSnapshot();
+
+/**
+ * Run several read-only contract calls against the same snapshot, without cs_main. The calls run on the
+ * contract execution threads (see -parcontracts) over private copies of the state, so each result is
+ * the same as the one of a separate CallContract at the tip of the snapshot.
+ */
+std::vector<std::vector<ResultExecute>> CallContracts(const std::vector<ContractCall>& calls, const ContractCallSnapshot& snapshot);
+
+/** Number of gas estimates kept for the tip of the last snapshot, see EstimateGas */
+static const size_t MAX_GAS_ESTIMATE_CACHE = 1000;
+
+struct GasEstimate{
+    /** Lowest gas limit with which the call succeeds, 0 when it fails with the highest one */
+    uint64_t gasLimit = 0;
+    /** Execution with the highest gas limit, the one of the call itself */
+    ResultExecute result;
+    /** Number of executions run for the estimate, 0 when it was cached */
+    unsigned trials = 0;
+};
+
+/**
+ * Find the lowest gas limit of a read-only contract call by binary search, up to the gas limit of the
+ * call or else the block gas limit. The trials share one private state, sealing engine and block, and
+ * only revert the state between them. Estimates are cached for the tip of the snapshot.
+ * Returns nullopt if the call could not be executed.
+ */
+std::optional<GasEstimate> EstimateGas(const ContractCall& call, const ContractCallSnapshot& snapshot);
+
 bool CheckOpSender(const CTransaction& tx, const CChainParams& chainparams, int nHeight);
 
 bool CheckSenderScript(const CCoinsViewCache& view, const CTransaction& tx);
 
-bool CheckMinGasPrice(std::vector<EthTransactionParams>& etps, const uint64_t& minGasPrice);
+bool CheckMinGasPrice(const std::vector<EthTransactionParams>& etps, const uint64_t& minGasPrice);
 
 void writeVMlog(const std::vector<ResultExecute>& res, CChain& chain, const CTransaction& tx = CTransaction(), const CBlock& block = CBlock());
 
@@ -491,7 +656,7 @@ struct EthTransactionParams{
     valtype code;
     dev::Address receiveAddress;
 
-    bool operator!=(EthTransactionParams etp){
+    bool operator!=(const EthTransactionParams& etp) const {
         if(this->version.toRaw() != etp.version.toRaw() || this->gasLimit != etp.gasLimit ||
         this->gasPrice != etp.gasPrice || this->code != etp.code ||
         this->receiveAddress != etp.receiveAddress)
@@ -511,7 +676,7 @@ class QtumTxConverter{
 
 public:
 
-    QtumTxConverter(CTransaction tx, Chainstate& _chainstate, const CTxMemPool* _mempool, CCoinsViewCache* v = NULL, const std::vector<CTransactionRef>* blockTxs = NULL, unsigned int flags = SCRIPT_EXEC_BYTE_CODE) : txBit(tx), view(v), blockTransactions(blockTxs), sender(false), nFlags(flags), chainstate(_chainstate), mempool(_mempool){}
+    QtumTxConverter(const CTransaction& tx, Chainstate& _chainstate, const CTxMemPool* _mempool, CCoinsViewCache* v = NULL, const std::vector<CTransactionRef>* blockTxs = NULL, unsigned int flags = SCRIPT_EXEC_BYTE_CODE) : txBit(tx), view(v), blockTransactions(blockTxs), sender(false), nFlags(flags), chainstate(_chainstate), mempool(_mempool){}
 
     bool extractionQtumTransactions(ExtractQtumTX& qtumTx);
 
@@ -525,7 +690,8 @@ private:
 
     size_t correctedStackSize(size_t size);
 
-    const CTransaction txBit;
+    //! The converted transaction, which must outlive the converter
+    const CTransaction& txBit;
     const CCoinsViewCache* view;
     std::vector<valtype> stack;
     opcodetype opcode;
@@ -537,6 +703,25 @@ private:
     const CTxMemPool* mempool;
 };
 
+/**
+ * The contract transactions of a mempool transaction, extracted when it was accepted. The senders
+ * only depend on the outputs the transaction spends, so the extraction is reused as long as the
+ * contract script flags are the same.
+ */
+struct MempoolContractTxs{
+    //! The contract script flags of the extraction
+    unsigned int flags;
+    ExtractQtumTX extracted;
+};
+
+/** The contract transactions of the mempool transaction @p txid if they were extracted with @p flags */
+std::shared_ptr<const MempoolContractTxs> GetMempoolContractTxs(const CTxMemPool& pool, const uint256& txid, unsigned int flags) EXCLUSIVE_LOCKS_REQUIRED(pool.cs);
+
+/**
+ * The hashes of the 256 blocks ending at a tip, for the BLOCKHASH opcode. They are read from a
+ * window of the last 256 hashes shared by the environments built on the same tip and moved along
+ * as blocks are connected and disconnected, so setting the tip and looking up a hash are O(1).
+ */
 class LastHashes: public dev::eth::LastBlockHashesFace
 {
 public:
@@ -546,17 +731,25 @@ public:
 
     dev::h256s precedingHashes(dev::h256 const&) const override;
 
+    dev::h256 precedingHash(dev::h256 const&, unsigned index) const override;
+
     void clear() override;
 
 private:
-    dev::h256s m_lastHashes;
+    //! The tip of the environment, alive while its contracts are executed
+    const CBlockIndex* m_tip{nullptr};
+    dev::h256 m_tip_hash;
 };
 
+class ContractExecSpeculation;
+class ContractExecResultCache;
+struct ConnectedBlockExec;
+
 class ByteCodeExec {
 
 public:
 
-    ByteCodeExec(const CBlock& _block, std::vector<QtumTransaction> _txs, const uint64_t _blockGasLimit, CBlockIndex* _pindex, CChain& _chain) : txs(_txs), block(_block), blockGasLimit(_blockGasLimit), pindex(_pindex), chain(_chain) {}
+    ByteCodeExec(const CBlock& _block, std::vector<QtumTransaction> _txs, const uint64_t _blockGasLimit, CBlockIndex* _pindex, CChain& _chain, QtumContext& _qtum, ContractExecSpeculation* _speculation = nullptr) : txs(std::move(_txs)), block(_block), blockGasLimit(_blockGasLimit), pindex(_pindex), chain(_chain), speculation(_speculation), state(_qtum.state.get()), sealEngine(_qtum.sealEngine.get()) {}
 
     bool performByteCode(dev::eth::Permanence type = dev::eth::Permanence::Committed);
 
@@ -564,8 +757,35 @@ public:
 
     std::vector<ResultExecute>& getResult(){ return result; }
 
+    const std::vector<QtumTransaction>& getTransactions() const { return txs; }
+
+    /** Execute on a private state and seal engine instead of the ones of the context, capturing one write set per transaction.
+     *  The private state is never flushed to the database. */
+    void setExecutionContext(QtumState* _state, dev::eth::SealEngineFace* _sealEngine, std::vector<ExecutionWriteSet>* _writeSets);
+
+    /** Execute with the consensus rules of @p _height instead of those of the chain height, so that the chain is not read */
+    void setChainHeight(int _height) { chainHeight = _height; }
+
+    /** Execute on the state of a block template, which keeps the committed changes in its memory overlay
+     *  instead of flushing them to the database after each execution. */
+    void setTemplateState(QtumState* _state) { state = _state; flushState = false; }
+
+    /** Reuse the result of an earlier template from @p _cache when what it read is unchanged, and store
+     *  the result otherwise. Only used with a template state. */
+    void setResultCache(ContractExecResultCache* _cache) { resultCache = _cache; }
+
+    /** Replay the result of connecting the block before from @p _reconnect when it has the transactions,
+     *  and add the result of the transactions executed to @p _connected */
+    void setConnectedBlock(const ConnectedBlockExec* _reconnect, ConnectedBlockExec* _connected) { reconnect = _reconnect; connected = _connected; }
+
 private:
 
+    bool executeTransactions(dev::eth::Permanence type);
+
+    bool executeCached();
+
+    bool executeConnected(dev::eth::Permanence type);
+
     dev::eth::EnvInfo BuildEVMEnvironment();
 
     dev::Address EthAddrFromScript(const CScript& scriptIn);
@@ -583,6 +803,269 @@ private:
     LastHashes lastHashes;
 
     CChain& chain;
+
+    ContractExecSpeculation* speculation;
+
+    QtumState* state;
+
+    dev::eth::SealEngineFace* sealEngine;
+
+    std::vector<ExecutionWriteSet>* writeSets = nullptr;
+
+    std::optional<int> chainHeight;
+
+    bool flushState = true;
+
+    ContractExecResultCache* resultCache = nullptr;
+
+    const ConnectedBlockExec* reconnect = nullptr;
+
+    ConnectedBlockExec* connected = nullptr;
+
+    bool* blockContextRead = nullptr;
+};
+
+/** The contract outputs of one transaction executed ahead of time on a private copy of the block-start state */
+struct SpeculativeContractTx{
+    std::vector<QtumTransaction> txs;
+    std::unique_ptr<QtumState> state;
+    std::unique_ptr<dev::eth::SealEngineFace> sealEngine;
+    std::vector<ResultExecute> result;
+    std::vector<ExecutionWriteSet> writeSets;
+    dev::AddressHash accessedAccounts;
+    dev::AddressHash accessedVins;
+    bool executed = false;
+};
+
+/**
+ * Optimistic parallel execution of the contract transactions of a block.
+ *
+ * Before ConnectBlock walks the block, the contract outputs of each transaction are executed
+ * concurrently on the contract execution threads, every transaction on its own copy of the
+ * block-start state and with its own seal engine. Each run records the accounts and UTXO trie
+ * entries it read and the caches it was about to commit. When ConnectBlock reaches the
+ * transaction in block order, the captured write sets are committed to the contract state if none of
+ * the entries the run read has been changed by an earlier transaction of the block; otherwise
+ * the transaction is executed again as usual. Conflicts are detected per account, so the
+ * resulting state roots and receipts are the same as those of sequential execution.
+ */
+class ContractExecSpeculation {
+
+public:
+
+    ContractExecSpeculation(const CBlock& _block, const uint64_t _blockGasLimit, CBlockIndex* _pindex, CChain& _chain, QtumContext& _qtum);
+
+    /** Queue the contract outputs of one transaction for speculative execution */
+    void Add(std::vector<QtumTransaction>&& txs);
+
+    /** Execute the queued transactions, returns immediately when there is nothing to run in parallel */
+    void Run();
+
+    /** Commit the speculative result of txs to the contract state, returns false if txs must be executed again */
+    bool Apply(const std::vector<QtumTransaction>& txs, std::vector<ResultExecute>& result);
+
+    /** Record the addresses the contract state accessed while executing a transaction sequentially */
+    void NoteAccessed(const dev::AddressHash& accounts, const dev::AddressHash& vins);
+
+    unsigned int nApplied = 0;
+
+    unsigned int nReexecuted = 0;
+
+private:
+
+    bool IsUnchanged(const SpeculativeContractTx& job) const;
+
+    const CBlock& block;
+
+    const uint64_t blockGasLimit;
+
+    CBlockIndex* pindex;
+
+    CChain& chain;
+
+    QtumContext& qtum;
+
+    //! Block-start state the speculative runs are compared against
+    QtumState base;
+
+    std::map<dev::h256, SpeculativeContractTx> jobs;
+
+    //! Entries written so far by the transactions of this block
+    dev::AddressHash changedAccounts;
+
+    dev::AddressHash changedVins;
+};
+
+/** The contract outputs of one transaction executed on a block template, with what the execution read */
+struct CachedContractExec{
+    std::vector<QtumTransaction> txs;
+    std::vector<ResultExecute> result;
+    std::vector<ExecutionWriteSet> writeSets;
+    //! Committed RLP of the accounts and UTXO trie entries read or written, from before the execution
+    std::vector<std::pair<dev::Address, std::string>> accounts;
+    std::vector<std::pair<dev::Address, std::string>> vins;
+    dev::Address author;
+    dev::u256 gasLimit;
+    //! The block time and difficulty only matter when the VM read the block context
+    bool blockContextRead = false;
+    int64_t timestamp = 0;
+    dev::u256 difficulty;
+    uint64_t lastTemplate = 0;
+};
+
+/**
+ * Contract execution results of the block templates assembled on the current tip.
+ *
+ * Templates are assembled again and again on the same tip, for every block time the staker tries and
+ * for every getblocktemplate call, and each of them executes the same mempool contract transactions.
+ * The result of an execution is kept with the committed values of the accounts and UTXO trie entries
+ * it read. A later template reuses it when its state still holds these values and the block author
+ * and gas limit are the same, as well as the block time and difficulty if the VM read them: the
+ * captured write sets are then committed without running the EVM, which gives the same state.
+ * The results are kept by block author, since the author is paid the gas of the execution, so that
+ * the stakers of several wallets reuse their own results. The results of other tips and those that
+ * the last template of their author did not look up are dropped.
+ */
+class ContractExecResultCache {
+
+public:
+
+    /** Start assembling a template on @p tip */
+    void BeginTemplate(const uint256& tip);
+
+    /** Drop the results of the template authors that the template did not look up */
+    void EndTemplate();
+
+    /** Commit the cached result of txs to @p state, returns false if txs must be executed */
+    bool Apply(const std::vector<QtumTransaction>& txs, const dev::eth::EnvInfo& envInfo, QtumState& state,
+               const dev::eth::SealEngineFace& sealEngine, std::vector<ResultExecute>& result);
+
+    /** Keep the result of txs executed on @p state from @p before */
+    void Store(const std::vector<QtumTransaction>& txs, const dev::eth::EnvInfo& envInfo, bool blockContextRead,
+               const QtumState& state, const QtumState::Checkpoint& before, const dev::AddressHash& accessedAccounts,
+               const dev::AddressHash& accessedVins, const std::vector<ResultExecute>& result, std::vector<ExecutionWriteSet>&& writeSets);
+
+    size_t Size() const;
+
+    unsigned int nApplied = 0;
+
+    unsigned int nExecuted = 0;
+
+    static ContractExecResultCache& instance();
+
+private:
+
+    mutable Mutex cs;
+
+    uint256 tip GUARDED_BY(cs);
+
+    uint64_t currentTemplate GUARDED_BY(cs) = 0;
+
+    //! Authors of the blocks the current template executed the transactions for
+    std::set<dev::Address> templateAuthors GUARDED_BY(cs);
+
+    std::map<std::pair<dev::Address, dev::h256>, CachedContractExec> entries GUARDED_BY(cs);
+};
+
+/** Number of recently connected blocks whose contract executions are kept by ConnectedBlockCache */
+static const size_t CONNECTED_BLOCK_CACHE_BLOCKS = 32;
+
+/** The contract outputs of one transaction executed by a connected block, with the write sets they committed */
+struct ConnectedContractExec{
+    std::vector<QtumTransaction> txs;
+    std::vector<ResultExecute> result;
+    std::vector<ExecutionWriteSet> writeSets;
+};
+
+/** What the connection of a block computed from the state of its parent */
+struct ConnectedBlockExec{
+    dev::h256 parentStateRoot;
+    dev::h256 parentUTXORoot;
+    uint256 hashProof;
+    //! By the hash of the first contract output of the transaction
+    std::map<dev::h256, ConnectedContractExec> execs;
+
+    /** Keep the result of txs executed with the write sets captured, unless one of them is incomplete */
+    void Add(const std::vector<QtumTransaction>& txs, const std::vector<ResultExecute>& result, std::vector<ExecutionWriteSet>&& writeSets);
+
+    /** Commit the write sets of txs to @p state, returns false if txs must be executed */
+    bool Apply(const std::vector<QtumTransaction>& txs, QtumState& state, const dev::eth::SealEngineFace& sealEngine, std::vector<ResultExecute>& result) const;
+};
+
+/**
+ * Proofs of stake and contract executions of the blocks recently connected outside of initial block
+ * download.
+ *
+ * Short reorganizations that switch back to a branch already validated are common with the orphan
+ * races of proof of stake. Connecting a block again from the same parent state gives the same result,
+ * so when the contract state is the one the block was first connected on, its proof of stake is not
+ * checked again and the write sets its contract transactions committed are replayed without running
+ * the EVM. The transactions whose write sets were not captured, like those applied from a speculative
+ * execution, are executed as usual: the state they start from is the same either way.
+ */
+class ConnectedBlockCache {
+
+public:
+
+    /** The result of connecting @p hash on the state with the given roots, if it is kept */
+    std::shared_ptr<const ConnectedBlockExec> Find(const uint256& hash, const dev::h256& stateRoot, const dev::h256& utxoRoot) const;
+
+    /** Keep the result of connecting @p hash, dropping the oldest block beyond CONNECTED_BLOCK_CACHE_BLOCKS */
+    void Store(const uint256& hash, std::shared_ptr<const ConnectedBlockExec> exec);
+
+    size_t Size() const;
+
+    std::atomic<unsigned int> nReconnected{0};
+
+    static ConnectedBlockCache& instance();
+
+private:
+
+    mutable Mutex cs;
+
+    std::map<uint256, std::shared_ptr<const ConnectedBlockExec>> entries GUARDED_BY(cs);
+
+    //! The blocks in the order they were stored
+    std::deque<uint256> order GUARDED_BY(cs);
+};
+
+/** Maximum number of contracts whose execution time is kept by ContractExecTimeModel */
+static const size_t MAX_CONTRACT_TIME_RATES = 4096;
+
+/**
+ * Execution time per unit of gas of the contracts, learned from their executions, to predict how long the
+ * contract transactions of a block template take to execute. The rate of a contract is a moving average
+ * of its last executions. Contracts that were never executed and contract creations are predicted with
+ * the average rate of all the executions.
+ */
+class ContractExecTimeModel {
+
+public:
+
+    /** Learn from an execution of @p contract that used @p gasUsed in @p time */
+    void Record(const dev::Address& contract, uint64_t gasUsed, std::chrono::nanoseconds time);
+
+    /** Time to execute @p txs with all of their gas, zero until executions have been recorded */
+    std::chrono::microseconds Predict(const std::vector<QtumTransaction>& txs) const;
+
+    size_t Size() const;
+
+    static ContractExecTimeModel& instance();
+
+private:
+
+    struct Rate {
+        double nsPerGas;
+        uint64_t lastUse;
+    };
+
+    mutable Mutex cs;
+
+    std::unordered_map<dev::Address, Rate> rates GUARDED_BY(cs);
+
+    double averageNsPerGas GUARDED_BY(cs) = 0;
+
+    uint64_t records GUARDED_BY(cs) = 0;
 };
 
 enum DisconnectResult
@@ -592,6 +1075,33 @@ enum DisconnectResult
     DISCONNECT_FAILED   // Something else went wrong.
 };
 
+/** Maximum number of blocks to connect that are read ahead from disk and not connected yet */
+static const int MAX_BLOCK_PREFETCH = 16;
+/** Number of blocks read ahead whose outputs are kept to verify the signatures of the next blocks */
+static const size_t MAX_BLOCK_PRECHECK_OUTPUTS = 256;
+/** Maximum number of blocks of a reorg that are read ahead from disk at once */
+static const int MAX_DISCONNECT_PREFETCH = 32;
+/** Number of threads reading the blocks of a reorg ahead */
+static const int DISCONNECT_PREFETCH_THREADS = 4;
+
+/**
+ * State of a reorg that disconnects more than one block. The blocks and their undo data are
+ * read ahead in parallel, and the receipt and height index erasures and the reset of the EVM
+ * roots are done once for all the disconnected blocks by Chainstate::FinishDisconnect.
+ */
+struct ReorgDisconnect {
+    struct PrefetchedBlock {
+        std::shared_ptr<CBlock> block;
+        CBlockUndo undo;
+    };
+    //! Blocks read ahead, by block hash
+    std::map<uint256, PrefetchedBlock> prefetched;
+    //! Transactions of the disconnected blocks whose receipts are deleted
+    std::vector<CTransactionRef> deleted_txs;
+    //! Heights of the disconnected blocks whose height index entries are erased
+    std::vector<unsigned int> deleted_heights;
+};
+
 class ConnectTrace;
 
 /** @see Chainstate::FlushStateToDisk */
@@ -780,6 +1290,17 @@ public:
         return *Assert(m_coins_views->m_cacheview);
     }
 
+    /**
+     * Look up a coin of the in-memory UTXO set without cs_main, see
+     * CCoinsViewCache::GetCoinConcurrent. The cache itself is only replaced during init,
+     * while no other thread reads it.
+     */
+    bool GetCoinConcurrent(const COutPoint& outpoint, Coin& coin, uint256& best_block) const NO_THREAD_SAFETY_ANALYSIS
+    {
+        Assert(m_coins_views);
+        return Assert(m_coins_views->m_cacheview)->GetCoinConcurrent(outpoint, coin, best_block);
+    }
+
     //! @returns A reference to the on-disk UTXO set database.
     CCoinsViewDB& CoinsDB() EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
     {
@@ -903,14 +1424,22 @@ public:
     bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, bool min_pow_checked) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block (dis)connection on a given view:
-    DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean)
+    DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean,
+                                     ReorgDisconnect* reorg = nullptr)
         EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
     bool ConnectBlock(const CBlock& block, BlockValidationState& state, CBlockIndex* pindex,
-                      CCoinsViewCache& view, bool fJustCheck = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
-    bool UpdateHashProof(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, CBlockIndex* pindex, CCoinsViewCache& view);
+                      CCoinsViewCache& view, bool fJustCheck = false,
+                      std::vector<TransactionReceiptInfo>* receipts = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** @p knownHashProof is the proof of a block connected before on the same parent state, which is not checked again */
+    bool UpdateHashProof(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, CBlockIndex* pindex, CCoinsViewCache& view, const uint256* knownHashProof = nullptr);
 
     // Apply the effects of a block disconnection on the UTXO set.
-    bool DisconnectTip(BlockValidationState& state, DisconnectedBlockTransactions* disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
+    bool DisconnectTip(BlockValidationState& state, DisconnectedBlockTransactions* disconnectpool,
+                       ReorgDisconnect* reorg = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
+    // Read the next blocks that a reorg disconnects from the tip down to pindexFork ahead in parallel.
+    void PrefetchDisconnect(ReorgDisconnect& reorg, const CBlockIndex* pindexFork) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    // Apply the erasures deferred while disconnecting blocks and reset the EVM roots to the new tip.
+    void FinishDisconnect(ReorgDisconnect& reorg) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Manual block validity manipulation:
     /** Mark a block as precious and reorganize.
@@ -980,7 +1509,7 @@ public:
     }
 
 private:
-    bool ActivateBestChainStep(BlockValidationState& state, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
+    bool ActivateBestChainStep(BlockValidationState& state, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace, BlockPrefetcher* prefetcher = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
     bool ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
 
     void InvalidBlockFound(CBlockIndex* pindex, const BlockValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -1167,6 +1696,8 @@ public:
     bool ShouldCheckBlockIndex() const { return *Assert(m_options.check_block_index); }
     const arith_uint256& MinimumChainWork() const { return *Assert(m_options.minimum_chain_work); }
     const uint256& AssumedValidBlock() const { return *Assert(m_options.assumed_valid_block); }
+    //! Contract state, seal engine and receipt storage the chainstates validate with
+    QtumContext& Qtum() const { return *m_options.qtum_context; }
 
     /**
      * Alias for ::cs_main.
@@ -1211,6 +1742,20 @@ public:
     /** Best header we've seen so far (used for getheaders queries' starting points). */
     CBlockIndex* m_best_header GUARDED_BY(::cs_main){nullptr};
 
+    /**
+     * The block indexes that are not in the active chain, ordered by height, which the block index
+     * cleanup of net processing looks for stale forks in. Kept up to date as headers are added and
+     * the tip moves, the ones loaded from disk are added by SeedStaleBlockIndex().
+     */
+    std::set<std::pair<int, CBlockIndex*>> m_stale_block_index GUARDED_BY(::cs_main);
+    bool m_stale_block_index_seeded GUARDED_BY(::cs_main){false};
+
+    /** Add the block indexes that are not in the active chain to m_stale_block_index, once */
+    void SeedStaleBlockIndex() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    /** Hashes of the PoS headers whose block signature was checked in parallel by ProcessNewBlockHeaders */
+    std::set<uint256> m_verified_header_signatures GUARDED_BY(::cs_main);
+
     //! The total number of bytes available for us to use across all in-memory
     //! coins caches. This will be split somehow across chainstates.
     int64_t m_total_coinstip_cache{0};
@@ -1321,8 +1866,16 @@ public:
      * @param[in]  min_pow_checked  True if proof-of-work anti-DoS checks have been done by caller for headers chain
      * @param[out] state This may be set to an Error state if any error occurred processing them
      * @param[out] ppindex If set, the pointer will be set to point to the last new block index object for the given headers
+     * @param[out] accepted_heights If set, the heights of the first and last accepted headers, read under cs_main, or {-1, -1} if none was accepted
+     */
+    bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, bool min_pow_checked, BlockValidationState& state, const CBlockIndex** ppindex = nullptr, std::pair<int, int>* accepted_heights = nullptr) LOCKS_EXCLUDED(cs_main);
+
+    /**
+     * Check the block signatures of a list of connected PoS headers with the header signature check
+     * workers, and add them to m_verified_header_signatures if they are all valid. Headers whose stake
+     * coin is not in the UTXO set are left to CheckHeaderPoS.
      */
-    bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, bool min_pow_checked, BlockValidationState& state, const CBlockIndex** ppindex = nullptr, const CBlockIndex** pindexFirst=nullptr) LOCKS_EXCLUDED(cs_main);
+    void VerifyHeaderSignatures(const std::vector<CBlockHeader>& headers) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     /**
      * Try to add a transaction to the memory pool.
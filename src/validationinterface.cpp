@@ -12,13 +12,107 @@
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <scheduler.h>
+#include <util/metrics.h>
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <future>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 std::string RemovalReasonToString(const MemPoolRemovalReason& r) noexcept;
 
+/**
+ * The background callbacks of one subscriber. They run one at a time and in the order they were
+ * queued, each on whichever scheduler thread is free, so that a slow subscriber only delays its
+ * own callbacks.
+ */
+class CallbackQueue : public std::enable_shared_from_this<CallbackQueue>
+{
+private:
+    CScheduler& m_scheduler;
+    Mutex m_mutex;
+    std::deque<std::function<void()>> m_pending GUARDED_BY(m_mutex);
+    bool m_running GUARDED_BY(m_mutex){false};
+    bool m_scheduled GUARDED_BY(m_mutex){false};
+
+    void Schedule()
+    {
+        m_scheduler.schedule([self = shared_from_this()] { self->RunOne(); }, std::chrono::steady_clock::now());
+    }
+
+    void RunOne() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        std::function<void()> callback;
+        {
+            LOCK(m_mutex);
+            m_scheduled = false;
+            if (m_running || m_pending.empty()) return;
+            m_running = true;
+            callback = std::move(m_pending.front());
+            m_pending.pop_front();
+        }
+        g_metrics.validation_callbacks_pending.Add(-1);
+
+        // Schedule the next callback even if this one throws
+        struct Finished {
+            CallbackQueue& queue;
+            ~Finished()
+            {
+                {
+                    LOCK(queue.m_mutex);
+                    queue.m_running = false;
+                    if (queue.m_pending.empty() || queue.m_scheduled) return;
+                    queue.m_scheduled = true;
+                }
+                queue.Schedule();
+            }
+        } finished{*this};
+        callback();
+    }
+
+public:
+    //! Cleared when the subscriber is unregistered, its queued events are then dropped
+    std::atomic<bool> m_registered{true};
+
+    explicit CallbackQueue(CScheduler& scheduler LIFETIMEBOUND) : m_scheduler{scheduler} {}
+
+    void Add(std::function<void()> func) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        {
+            LOCK(m_mutex);
+            m_pending.emplace_back(std::move(func));
+            g_metrics.validation_callbacks_pending.Add(1);
+            if (m_running || m_scheduled) return;
+            m_scheduled = true;
+        }
+        Schedule();
+    }
+
+    /** Run the remaining callbacks on the calling thread, the scheduler must have no threads left */
+    void Drain() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        assert(!m_scheduler.AreThreadsServicingQueue());
+        while (!WITH_LOCK(m_mutex, return m_pending.empty())) {
+            RunOne();
+        }
+    }
+
+    size_t Pending() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        return m_pending.size();
+    }
+
+    bool Idle() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        return !m_running && m_pending.empty();
+    }
+};
+
 /**
  * MainSignalsImpl manages a list of shared_ptr<CValidationInterface> callbacks.
  *
@@ -26,32 +120,70 @@ std::string RemovalReasonToString(const MemPoolRemovalReason& r) noexcept;
  * registered, and a std::list is used to store the callbacks that are
  * currently registered as well as any callbacks that are just unregistered
  * and about to be deleted when they are done executing.
+ *
+ * Each subscriber has its own queue of background callbacks, the queues of
+ * different subscribers run in parallel when the scheduler has several threads.
  */
 class MainSignalsImpl
 {
 private:
+    CScheduler& m_scheduler;
     Mutex m_mutex;
     //! List entries consist of a callback pointer and reference count. The
     //! count is equal to the number of current executions of that entry, plus 1
     //! if it's registered. It cannot be 0 because that would imply it is
     //! unregistered and also not being executed (so shouldn't exist).
-    struct ListEntry { std::shared_ptr<CValidationInterface> callbacks; int count = 1; };
+    struct ListEntry { std::shared_ptr<CValidationInterface> callbacks; int count = 1; std::shared_ptr<CallbackQueue> queue; };
     std::list<ListEntry> m_list GUARDED_BY(m_mutex);
     std::unordered_map<CValidationInterface*, std::list<ListEntry>::iterator> m_map GUARDED_BY(m_mutex);
+    //! Queues of unregistered subscribers that still have a callback running or queued
+    std::vector<std::shared_ptr<CallbackQueue>> m_retired GUARDED_BY(m_mutex);
+    //! Runs the functions waiting for all the queues when there is no subscriber
+    const std::shared_ptr<CallbackQueue> m_control;
+
+    /** A function that runs once the queues have processed every event queued before it */
+    struct Barrier {
+        std::function<void()> func;
+        size_t waiting;
+    };
+    Mutex m_barriers_mutex;
+    std::deque<std::shared_ptr<Barrier>> m_barriers GUARDED_BY(m_barriers_mutex);
+    bool m_barriers_running GUARDED_BY(m_barriers_mutex){false};
 
-public:
-    // We are not allowed to assume the scheduler only runs in one thread,
-    // but must ensure all callbacks happen in-order, so we end up creating
-    // our own queue here :(
-    SingleThreadedSchedulerClient m_schedulerClient;
+    void Retire(const std::shared_ptr<CallbackQueue>& queue) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        queue->m_registered = false;
+        if (!queue->Idle()) m_retired.push_back(queue);
+    }
+
+    /** Called by each queue reaching @p barrier, runs the functions of the barriers every queue has reached, in order */
+    void BarrierReached(Barrier& barrier) EXCLUSIVE_LOCKS_REQUIRED(!m_barriers_mutex)
+    {
+        WAIT_LOCK(m_barriers_mutex, lock);
+        --barrier.waiting;
+        if (m_barriers_running) return;
+        m_barriers_running = true;
+        while (!m_barriers.empty() && m_barriers.front()->waiting == 0) {
+            auto func = std::move(m_barriers.front()->func);
+            m_barriers.pop_front();
+            REVERSE_LOCK(lock);
+            func();
+        }
+        m_barriers_running = false;
+    }
 
-    explicit MainSignalsImpl(CScheduler& scheduler LIFETIMEBOUND) : m_schedulerClient(scheduler) {}
+public:
+    explicit MainSignalsImpl(CScheduler& scheduler LIFETIMEBOUND)
+        : m_scheduler{scheduler}, m_control{std::make_shared<CallbackQueue>(scheduler)} {}
 
     void Register(std::shared_ptr<CValidationInterface> callbacks) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
         LOCK(m_mutex);
         auto inserted = m_map.emplace(callbacks.get(), m_list.end());
-        if (inserted.second) inserted.first->second = m_list.emplace(m_list.end());
+        if (inserted.second) {
+            inserted.first->second = m_list.emplace(m_list.end());
+            inserted.first->second->queue = std::make_shared<CallbackQueue>(m_scheduler);
+        }
         inserted.first->second->callbacks = std::move(callbacks);
     }
 
@@ -60,6 +192,7 @@ public:
         LOCK(m_mutex);
         auto it = m_map.find(callbacks);
         if (it != m_map.end()) {
+            Retire(it->second->queue);
             if (!--it->second->count) m_list.erase(it->second);
             m_map.erase(it);
         }
@@ -73,6 +206,7 @@ public:
     {
         LOCK(m_mutex);
         for (const auto& entry : m_map) {
+            Retire(entry.second->queue);
             if (!--entry.second->count) m_list.erase(entry.second);
         }
         m_map.clear();
@@ -90,6 +224,73 @@ public:
             it = --it->count ? std::next(it) : m_list.erase(it);
         }
     }
+
+    /** Queue @p f to be called with each registered subscriber, on the queue of the subscriber */
+    void Enqueue(std::function<void(CValidationInterface&)> f) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        auto event = std::make_shared<const std::function<void(CValidationInterface&)>>(std::move(f));
+        LOCK(m_mutex);
+        size_t backlog{0};
+        for (const ListEntry& entry : m_list) {
+            if (!entry.queue->m_registered) continue;
+            entry.queue->Add([event, callbacks = entry.callbacks, queue = entry.queue.get()] {
+                if (queue->m_registered) (*event)(*callbacks);
+            });
+            backlog = std::max(backlog, entry.queue->Pending());
+        }
+        g_metrics.validation_callbacks_backlog.Set(backlog);
+    }
+
+    /** Call @p func once the events queued so far have been processed, including those of the unregistered subscribers still running */
+    void EnqueueBarrier(std::function<void()> func) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex, !m_barriers_mutex)
+    {
+        auto barrier = std::make_shared<Barrier>();
+        barrier->func = std::move(func);
+        LOCK(m_mutex);
+        m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(), [](const auto& queue) { return queue->Idle(); }), m_retired.end());
+        std::vector<CallbackQueue*> queues{m_control.get()};
+        for (const ListEntry& entry : m_list) {
+            if (entry.queue->m_registered) queues.push_back(entry.queue.get());
+        }
+        for (const auto& queue : m_retired) queues.push_back(queue.get());
+        barrier->waiting = queues.size();
+        WITH_LOCK(m_barriers_mutex, m_barriers.push_back(barrier));
+        for (CallbackQueue* queue : queues) {
+            queue->Add([this, barrier] { BarrierReached(*barrier); });
+        }
+    }
+
+    /** Run the remaining callbacks of every queue on the calling thread */
+    void Drain() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        // A callback may queue more events, repeat until all the queues are empty
+        while (true) {
+            std::vector<std::shared_ptr<CallbackQueue>> queues{m_control};
+            {
+                LOCK(m_mutex);
+                for (const ListEntry& entry : m_list) queues.push_back(entry.queue);
+                queues.insert(queues.end(), m_retired.begin(), m_retired.end());
+            }
+            bool idle{true};
+            for (const auto& queue : queues) {
+                if (queue->Idle()) continue;
+                idle = false;
+                queue->Drain();
+            }
+            if (idle) break;
+        }
+    }
+
+    /** The number of callbacks queued for the subscriber furthest behind */
+    size_t CallbacksPending() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        size_t pending = m_control->Pending();
+        for (const ListEntry& entry : m_list) {
+            pending = std::max(pending, entry.queue->Pending());
+        }
+        return pending;
+    }
 };
 
 static CMainSignals g_signals;
@@ -108,14 +309,14 @@ void CMainSignals::UnregisterBackgroundSignalScheduler()
 void CMainSignals::FlushBackgroundCallbacks()
 {
     if (m_internals) {
-        m_internals->m_schedulerClient.EmptyQueue();
+        m_internals->Drain();
     }
 }
 
 size_t CMainSignals::CallbacksPending()
 {
     if (!m_internals) return 0;
-    return m_internals->m_schedulerClient.CallbacksPending();
+    return m_internals->CallbacksPending();
 }
 
 CMainSignals& GetMainSignals()
@@ -159,7 +360,7 @@ void UnregisterAllValidationInterfaces()
 
 void CallFunctionInValidationInterfaceQueue(std::function<void()> func)
 {
-    g_signals.m_internals->m_schedulerClient.AddToProcessQueue(std::move(func));
+    g_signals.m_internals->EnqueueBarrier(std::move(func));
 }
 
 void SyncWithValidationInterfaceQueue()
@@ -176,15 +377,12 @@ void SyncWithValidationInterfaceQueue()
 // Use a macro instead of a function for conditional logging to prevent
 // evaluating arguments when logging is not enabled.
 //
-// NOTE: The lambda captures all local variables by value.
-#define ENQUEUE_AND_LOG_EVENT(event, fmt, name, ...)           \
-    do {                                                       \
-        auto local_name = (name);                              \
-        LOG_EVENT("Enqueuing " fmt, local_name, __VA_ARGS__);  \
-        m_internals->m_schedulerClient.AddToProcessQueue([=] { \
-            LOG_EVENT(fmt, local_name, __VA_ARGS__);           \
-            event();                                           \
-        });                                                    \
+// The event is logged once when it is queued, the subscribers run it later
+// from their own queues.
+#define ENQUEUE_AND_LOG_EVENT(event, fmt, name, ...)          \
+    do {                                                      \
+        LOG_EVENT("Enqueuing " fmt, (name), __VA_ARGS__);     \
+        m_internals->Enqueue(std::move(event));               \
     } while (0)
 
 #define LOG_EVENT(fmt, ...) \
@@ -195,8 +393,8 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
     // the chain actually updates. One way to ensure this is for the caller to invoke this signal
     // in the same critical section where the chain is updated
 
-    auto event = [pindexNew, pindexFork, fInitialDownload, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload); });
+    auto event = [pindexNew, pindexFork, fInitialDownload](CValidationInterface& callbacks) {
+        callbacks.UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: new block hash=%s fork block hash=%s (in IBD=%s)", __func__,
                           pindexNew->GetBlockHash().ToString(),
@@ -205,8 +403,8 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
 }
 
 void CMainSignals::TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence) {
-    auto event = [tx, mempool_sequence, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.TransactionAddedToMempool(tx, mempool_sequence); });
+    auto event = [tx, mempool_sequence](CValidationInterface& callbacks) {
+        callbacks.TransactionAddedToMempool(tx, mempool_sequence);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: txid=%s wtxid=%s", __func__,
                           tx->GetHash().ToString(),
@@ -214,8 +412,8 @@ void CMainSignals::TransactionAddedToMempool(const CTransactionRef& tx, uint64_t
 }
 
 void CMainSignals::TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence) {
-    auto event = [tx, reason, mempool_sequence, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.TransactionRemovedFromMempool(tx, reason, mempool_sequence); });
+    auto event = [tx, reason, mempool_sequence](CValidationInterface& callbacks) {
+        callbacks.TransactionRemovedFromMempool(tx, reason, mempool_sequence);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: txid=%s wtxid=%s reason=%s", __func__,
                           tx->GetHash().ToString(),
@@ -224,8 +422,8 @@ void CMainSignals::TransactionRemovedFromMempool(const CTransactionRef& tx, MemP
 }
 
 void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindex) {
-    auto event = [pblock, pindex, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.BlockConnected(pblock, pindex); });
+    auto event = [pblock, pindex](CValidationInterface& callbacks) {
+        callbacks.BlockConnected(pblock, pindex);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s block height=%d", __func__,
                           pblock->GetHash().ToString(),
@@ -234,17 +432,27 @@ void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, c
 
 void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex)
 {
-    auto event = [pblock, pindex, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.BlockDisconnected(pblock, pindex); });
+    auto event = [pblock, pindex](CValidationInterface& callbacks) {
+        callbacks.BlockDisconnected(pblock, pindex);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s block height=%d", __func__,
                           pblock->GetHash().ToString(),
                           pindex->nHeight);
 }
 
+void CMainSignals::BlockReceiptsConnected(const std::shared_ptr<const std::vector<TransactionReceiptInfo>>& receipts, const CBlockIndex* pindex)
+{
+    auto event = [receipts, pindex](CValidationInterface& callbacks) {
+        callbacks.BlockReceiptsConnected(receipts, pindex);
+    };
+    ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s block height=%d", __func__,
+                          pindex->GetBlockHash().ToString(),
+                          pindex->nHeight);
+}
+
 void CMainSignals::ChainStateFlushed(const CBlockLocator &locator) {
-    auto event = [locator, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.ChainStateFlushed(locator); });
+    auto event = [locator](CValidationInterface& callbacks) {
+        callbacks.ChainStateFlushed(locator);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s", __func__,
                           locator.IsNull() ? "null" : locator.vHave.front().ToString());
@@ -12,6 +12,7 @@
 
 #include <functional>
 #include <memory>
+#include <vector>
 
 class BlockValidationState;
 class CBlock;
@@ -20,6 +21,7 @@ struct CBlockLocator;
 class CValidationInterface;
 class CScheduler;
 enum class MemPoolRemovalReason;
+struct TransactionReceiptInfo;
 
 /** Register subscriber */
 void RegisterValidationInterface(CValidationInterface* callbacks);
@@ -71,7 +73,8 @@ void SyncWithValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main);
  * UpdatedBlockTip() callback may depend on an operation performed in
  * the BlockConnected() callback without worrying about explicit
  * synchronization. No ordering should be assumed across
- * ValidationInterface() subscribers.
+ * ValidationInterface() subscribers, and the callbacks of different
+ * subscribers may run at the same time on different scheduler threads.
  */
 class CValidationInterface {
 protected:
@@ -143,6 +146,14 @@ protected:
      * Called on a background thread.
      */
     virtual void BlockDisconnected(const std::shared_ptr<const CBlock> &block, const CBlockIndex* pindex) {}
+    /**
+     * Notifies listeners of the receipts of the contract executions of a connected
+     * block, as they were produced while connecting it. Only sent for blocks that
+     * execute contracts, right after BlockConnected for the same block.
+     *
+     * Called on a background thread.
+     */
+    virtual void BlockReceiptsConnected(const std::shared_ptr<const std::vector<TransactionReceiptInfo>>& receipts, const CBlockIndex* pindex) {}
     /**
      * Notifies listeners of the new active block chain on-disk.
      *
@@ -193,6 +204,7 @@ public:
     /** Call any remaining callbacks on the calling thread */
     void FlushBackgroundCallbacks();
 
+    /** The number of background callbacks queued for the subscriber furthest behind */
     size_t CallbacksPending();
 
 
@@ -201,6 +213,7 @@ public:
     void TransactionRemovedFromMempool(const CTransactionRef&, MemPoolRemovalReason, uint64_t mempool_sequence);
     void BlockConnected(const std::shared_ptr<const CBlock> &, const CBlockIndex *pindex);
     void BlockDisconnected(const std::shared_ptr<const CBlock> &, const CBlockIndex* pindex);
+    void BlockReceiptsConnected(const std::shared_ptr<const std::vector<TransactionReceiptInfo>>&, const CBlockIndex* pindex);
     void ChainStateFlushed(const CBlockLocator &);
     void BlockChecked(const CBlock&, const BlockValidationState&);
     void NewPoWValidBlock(const CBlockIndex *, const std::shared_ptr<const CBlock>&);
@@ -137,6 +137,10 @@ public:
 
     void ReloadDbEnv() override;
 
+    /** Not supported, every Berkeley DB batch has its own transaction */
+    bool BeginGroupCommit() override { return false; }
+    bool EndGroupCommit() override { return false; }
+
     /** Verifies the environment and database file */
     bool Verify(bilingual_str& error);
 
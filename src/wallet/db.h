@@ -159,6 +159,14 @@ public:
 
     virtual void ReloadDbEnv() = 0;
 
+    /** Start committing the writes of all the batches of this database together, until
+     *  EndGroupCommit. Batch transactions started meanwhile are nested in the group.
+     *  Returns false if the database does not support it or a transaction is in progress.
+     */
+    virtual bool BeginGroupCommit() = 0;
+    /** Commit the writes made since BeginGroupCommit */
+    virtual bool EndGroupCommit() = 0;
+
     /** Return path to main database file for logs and error messages. */
     virtual std::string Filename() = 0;
 
@@ -212,11 +220,31 @@ public:
     bool PeriodicFlush() override { return true; }
     void IncrementUpdateCounter() override { ++nUpdateCounter; }
     void ReloadDbEnv() override {}
+    bool BeginGroupCommit() override { return true; }
+    bool EndGroupCommit() override { return true; }
     std::string Filename() override { return "dummy"; }
     std::string Format() override { return "dummy"; }
     std::unique_ptr<DatabaseBatch> MakeBatch(bool flush_on_close = true) override { return std::make_unique<DummyBatch>(); }
 };
 
+/** RAII class that commits the wallet writes made during its lifetime together */
+class DatabaseGroupCommit
+{
+private:
+    WalletDatabase& m_database;
+    bool m_started;
+
+public:
+    explicit DatabaseGroupCommit(WalletDatabase& database) : m_database(database), m_started(database.BeginGroupCommit()) {}
+    ~DatabaseGroupCommit()
+    {
+        if (m_started) m_database.EndGroupCommit();
+    }
+
+    DatabaseGroupCommit(const DatabaseGroupCommit&) = delete;
+    DatabaseGroupCommit& operator=(const DatabaseGroupCommit&) = delete;
+};
+
 enum class DatabaseFormat {
     BERKELEY,
     SQLITE,
@@ -351,12 +351,12 @@ DelegationStakerInfo MakeWalletDelegationStakerInfo(CWallet& wallet, const uint1
 
 bool TokenTxStatus(CWallet& wallet, const uint256& txid, int& block_number, bool& in_mempool, int& num_blocks) EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet)
 {
-    auto mi = wallet.mapTokenTx.find(txid);
-    if (mi == wallet.mapTokenTx.end()) {
+    CTokenTx tokenTx;
+    if (!wallet.GetTokenTx(txid, tokenTx)) {
         return false;
     }
-    block_number = mi->second.blockNumber;
-    auto it = wallet.mapWallet.find(mi->second.transactionHash); 
+    block_number = tokenTx.blockNumber;
+    auto it = wallet.mapWallet.find(tokenTx.transactionHash);
     if(it != wallet.mapWallet.end())
     {
         in_mempool = it->second.InMempool();
@@ -575,6 +575,11 @@ public:
         }
         return result;
     }
+    size_t getWalletTxCount() override
+    {
+        LOCK(m_wallet->cs_wallet);
+        return m_wallet->mapWallet.size();
+    }
     bool tryGetTxStatus(const uint256& txid,
         interfaces::WalletTxStatus& tx_status,
         int& num_blocks,
@@ -887,9 +892,9 @@ public:
     {
         LOCK(m_wallet->cs_wallet);
 
-        auto mi = m_wallet->mapTokenTx.find(txid);
-        if (mi != m_wallet->mapTokenTx.end()) {
-            return MakeWalletTokenTx(mi->second);
+        CTokenTx tokenTx;
+        if (m_wallet->GetTokenTx(txid, tokenTx)) {
+            return MakeWalletTokenTx(tokenTx);
         }
         return {};
     }
@@ -898,9 +903,20 @@ public:
         LOCK(m_wallet->cs_wallet);
 
         std::vector<TokenTx> result;
-        result.reserve(m_wallet->mapTokenTx.size());
-        for (const auto& entry : m_wallet->mapTokenTx) {
-            result.emplace_back(MakeWalletTokenTx(entry.second));
+        result.reserve(m_wallet->m_token_txs.size());
+        for (const uint256& hash : m_wallet->m_token_txs) {
+            CTokenTx tokenTx;
+            if (m_wallet->GetTokenTx(hash, tokenTx)) {
+                result.emplace_back(MakeWalletTokenTx(tokenTx));
+            }
+        }
+        return result;
+    }
+    std::vector<TokenTx> getTokenTxs(const std::string& contract_address, const std::string& address, size_t offset, size_t count) override
+    {
+        std::vector<TokenTx> result;
+        for (const CTokenTx& tokenTx : m_wallet->ListTokenTxs(contract_address, address, offset, count)) {
+            result.emplace_back(MakeWalletTokenTx(tokenTx));
         }
         return result;
     }
@@ -1060,22 +1076,21 @@ public:
         DelegationDetails details;
 
         // Get wallet delegation details
-        for(auto mi : m_wallet->mapDelegation)
+        uint160 delegate = StringToKeyId(sAddress);
+        auto index = m_wallet->m_delegation_index.lower_bound({delegate, uint256()});
+        if(!delegate.IsNull() && index != m_wallet->m_delegation_index.end() && index->first == delegate)
         {
-            if(KeyIdToString(mi.second.delegateAddress) == sAddress)
-            {
-                details.w_entry_exist = true;
-                details.w_delegate_address = KeyIdToString(mi.second.delegateAddress);
-                details.w_staker_address = KeyIdToString(mi.second.stakerAddress);
-                details.w_staker_name = mi.second.strStakerName;
-                details.w_fee = mi.second.nFee;
-                details.w_time = mi.second.nCreateTime;
-                details.w_block_number = mi.second.blockNumber;
-                details.w_hash = mi.first;
-                details.w_create_tx_hash = mi.second.createTxHash;
-                details.w_remove_tx_hash = mi.second.removeTxHash;
-                break;
-            }
+            const auto& mi = *m_wallet->mapDelegation.find(index->second);
+            details.w_entry_exist = true;
+            details.w_delegate_address = KeyIdToString(mi.second.delegateAddress);
+            details.w_staker_address = KeyIdToString(mi.second.stakerAddress);
+            details.w_staker_name = mi.second.strStakerName;
+            details.w_fee = mi.second.nFee;
+            details.w_time = mi.second.nCreateTime;
+            details.w_block_number = mi.second.blockNumber;
+            details.w_hash = mi.first;
+            details.w_create_tx_hash = mi.second.createTxHash;
+            details.w_remove_tx_hash = mi.second.removeTxHash;
         }
 
         // Get wallet create tx details
@@ -1191,12 +1206,8 @@ public:
         if(address.IsNull())
             return false;
 
-        for (const auto& entry : m_wallet->mapSuperStaker) {
-            if(entry.second.stakerAddress == address)
-                return true;
-        }
-
-        return false;
+        auto it = m_wallet->m_super_staker_index.lower_bound({address, uint256()});
+        return it != m_wallet->m_super_staker_index.end() && it->first == address;
     }
     SuperStakerInfo getSuperStaker(const uint256& id) override
     {
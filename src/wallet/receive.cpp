@@ -301,7 +301,51 @@ bool CachedTxIsTrusted(const CWallet& wallet, const CWalletTx& wtx)
     return CachedTxIsTrusted(wallet, wtx, trusted_parents);
 }
 
-Balance GetBalance(const CWallet& wallet, const int min_depth, bool avoid_reuse)
+//! What a wallet transaction adds to the balance of the wallet
+static Balance GetTxBalance(const CWallet& wallet, const CWalletTx& wtx, const int min_depth, isminefilter reuse_filter, std::set<uint256>& trusted_parents) EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet)
+{
+    Balance ret;
+    const bool is_trusted{CachedTxIsTrusted(wallet, wtx, trusted_parents)};
+    const int tx_depth{wallet.GetTxDepthInMainChain(wtx)};
+    const CAmount tx_credit_mine{CachedTxGetAvailableCredit(wallet, wtx, ISMINE_SPENDABLE | reuse_filter)};
+    const CAmount tx_credit_watchonly{CachedTxGetAvailableCredit(wallet, wtx, ISMINE_WATCH_ONLY | reuse_filter)};
+    if (is_trusted && tx_depth >= min_depth) {
+        ret.m_mine_trusted += tx_credit_mine;
+        ret.m_watchonly_trusted += tx_credit_watchonly;
+    }
+    if (!is_trusted && tx_depth == 0 && wtx.InMempool()) {
+        ret.m_mine_untrusted_pending += tx_credit_mine;
+        ret.m_watchonly_untrusted_pending += tx_credit_watchonly;
+    }
+    ret.m_mine_immature += CachedTxGetImmatureCredit(wallet, wtx, ISMINE_SPENDABLE);
+    ret.m_watchonly_immature += CachedTxGetImmatureCredit(wallet, wtx, ISMINE_WATCH_ONLY);
+    ret.m_mine_stake += CachedTxGetStakeCredit(wallet, wtx, ISMINE_SPENDABLE);
+    ret.m_watchonly_stake += CachedTxGetStakeCredit(wallet, wtx, ISMINE_WATCH_ONLY);
+    return ret;
+}
+
+//! Add (sign 1) or remove (sign -1) a balance to the totals
+static void AddBalance(Balance& total, const Balance& balance, int sign)
+{
+    total.m_mine_trusted += sign * balance.m_mine_trusted;
+    total.m_mine_untrusted_pending += sign * balance.m_mine_untrusted_pending;
+    total.m_mine_immature += sign * balance.m_mine_immature;
+    total.m_mine_stake += sign * balance.m_mine_stake;
+    total.m_watchonly_trusted += sign * balance.m_watchonly_trusted;
+    total.m_watchonly_untrusted_pending += sign * balance.m_watchonly_untrusted_pending;
+    total.m_watchonly_immature += sign * balance.m_watchonly_immature;
+    total.m_watchonly_stake += sign * balance.m_watchonly_stake;
+}
+
+static bool operator==(const Balance& a, const Balance& b)
+{
+    return a.m_mine_trusted == b.m_mine_trusted && a.m_mine_untrusted_pending == b.m_mine_untrusted_pending &&
+           a.m_mine_immature == b.m_mine_immature && a.m_mine_stake == b.m_mine_stake &&
+           a.m_watchonly_trusted == b.m_watchonly_trusted && a.m_watchonly_untrusted_pending == b.m_watchonly_untrusted_pending &&
+           a.m_watchonly_immature == b.m_watchonly_immature && a.m_watchonly_stake == b.m_watchonly_stake;
+}
+
+Balance ComputeBalance(const CWallet& wallet, const int min_depth, bool avoid_reuse)
 {
     Balance ret;
     isminefilter reuse_filter = avoid_reuse ? ISMINE_NO : ISMINE_USED;
@@ -310,28 +354,70 @@ Balance GetBalance(const CWallet& wallet, const int min_depth, bool avoid_reuse)
         std::set<uint256> trusted_parents;
         for (const auto& entry : wallet.mapWallet)
         {
-            const CWalletTx& wtx = entry.second;
-            const bool is_trusted{CachedTxIsTrusted(wallet, wtx, trusted_parents)};
-            const int tx_depth{wallet.GetTxDepthInMainChain(wtx)};
-            const CAmount tx_credit_mine{CachedTxGetAvailableCredit(wallet, wtx, ISMINE_SPENDABLE | reuse_filter)};
-            const CAmount tx_credit_watchonly{CachedTxGetAvailableCredit(wallet, wtx, ISMINE_WATCH_ONLY | reuse_filter)};
-            if (is_trusted && tx_depth >= min_depth) {
-                ret.m_mine_trusted += tx_credit_mine;
-                ret.m_watchonly_trusted += tx_credit_watchonly;
-            }
-            if (!is_trusted && tx_depth == 0 && wtx.InMempool()) {
-                ret.m_mine_untrusted_pending += tx_credit_mine;
-                ret.m_watchonly_untrusted_pending += tx_credit_watchonly;
-            }
-            ret.m_mine_immature += CachedTxGetImmatureCredit(wallet, wtx, ISMINE_SPENDABLE);
-            ret.m_watchonly_immature += CachedTxGetImmatureCredit(wallet, wtx, ISMINE_WATCH_ONLY);
-            ret.m_mine_stake += CachedTxGetStakeCredit(wallet, wtx, ISMINE_SPENDABLE);
-            ret.m_watchonly_stake += CachedTxGetStakeCredit(wallet, wtx, ISMINE_WATCH_ONLY);
+            AddBalance(ret, GetTxBalance(wallet, entry.second, min_depth, reuse_filter, trusted_parents), 1);
         }
     }
     return ret;
 }
 
+Balance GetBalance(const CWallet& wallet, const int min_depth, bool avoid_reuse)
+{
+    if (min_depth != 0) return ComputeBalance(wallet, min_depth, avoid_reuse);
+
+    LOCK(wallet.cs_wallet);
+    BalanceCache& cache = wallet.m_balance_cache[avoid_reuse ? 1 : 0];
+    const int height = wallet.GetLastBlockHeight();
+
+    // Transactions mature again when blocks are disconnected, start over then
+    std::vector<uint256> update;
+    if (!cache.initialized || height < cache.height) {
+        cache = BalanceCache{};
+        cache.initialized = true;
+        update.reserve(wallet.mapWallet.size());
+        for (const auto& entry : wallet.mapWallet) {
+            update.push_back(entry.first);
+        }
+    } else {
+        update.assign(cache.dirty_txs.begin(), cache.dirty_txs.end());
+        for (const uint256& hash : cache.volatile_txs) {
+            if (!cache.dirty_txs.count(hash)) update.push_back(hash);
+        }
+        cache.dirty_txs.clear();
+    }
+    cache.height = height;
+
+    // Replace what the updated transactions add to the totals
+    isminefilter reuse_filter = avoid_reuse ? ISMINE_NO : ISMINE_USED;
+    std::set<uint256> trusted_parents;
+    for (const uint256& hash : update) {
+        auto it = cache.tx_balances.find(hash);
+        if (it != cache.tx_balances.end()) {
+            AddBalance(cache.total, it->second, -1);
+            cache.tx_balances.erase(it);
+        }
+        cache.volatile_txs.erase(hash);
+
+        const CWalletTx* wtx = wallet.GetWalletTx(hash);
+        if (!wtx) continue;
+        const Balance tx_balance = GetTxBalance(wallet, *wtx, min_depth, reuse_filter, trusted_parents);
+        AddBalance(cache.total, tx_balance, 1);
+        cache.tx_balances.emplace(hash, tx_balance);
+        if (wallet.GetTxDepthInMainChain(*wtx) == 0 || wallet.IsTxImmature(*wtx)) {
+            cache.volatile_txs.insert(hash);
+        }
+    }
+
+    if (wallet.m_check_balance) {
+        const Balance full = ComputeBalance(wallet, min_depth, avoid_reuse);
+        if (!(full == cache.total)) {
+            wallet.WalletLogPrintf("ERROR: cached balance does not match the balance of the wallet transactions, rebuilding it\n");
+            cache.initialized = false;
+            return full;
+        }
+    }
+    return cache.total;
+}
+
 std::map<CTxDestination, CAmount> GetAddressBalances(const CWallet& wallet)
 {
     std::map<CTxDestination, CAmount> balances;
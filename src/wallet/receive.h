@@ -50,17 +50,10 @@ bool CachedTxIsFromMe(const CWallet& wallet, const CWalletTx& wtx, const isminef
 bool CachedTxIsTrusted(const CWallet& wallet, const CWalletTx& wtx, std::set<uint256>& trusted_parents) EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet);
 bool CachedTxIsTrusted(const CWallet& wallet, const CWalletTx& wtx);
 
-struct Balance {
-    CAmount m_mine_trusted{0};           //!< Trusted, at depth=GetBalance.min_depth or more
-    CAmount m_mine_untrusted_pending{0}; //!< Untrusted, but in mempool (pending)
-    CAmount m_mine_immature{0};          //!< Immature coinbases in the main chain
-    CAmount m_mine_stake{0};
-    CAmount m_watchonly_trusted{0};
-    CAmount m_watchonly_untrusted_pending{0};
-    CAmount m_watchonly_immature{0};
-    CAmount m_watchonly_stake{0};
-};
+/** Balance of the wallet, from the balance caches of the wallet at min_depth 0 */
 Balance GetBalance(const CWallet& wallet, int min_depth = 0, bool avoid_reuse = true);
+/** Balance of the wallet, going through all the wallet transactions */
+Balance ComputeBalance(const CWallet& wallet, int min_depth = 0, bool avoid_reuse = true);
 
 std::map<CTxDestination, CAmount> GetAddressBalances(const CWallet& wallet);
 std::set<std::set<CTxDestination>> GetAddressGroupings(const CWallet& wallet) EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet);
@@ -6,6 +6,7 @@
 #include <wallet/rpc/mining.h>
 #include <wallet/wallet.h>
 #include <node/miner.h>
+#include <node/stakeestimator.h>
 #include <pow.h>
 #include <warnings.h>
 #include <chainparams.h>
@@ -125,6 +126,8 @@ RPCHelpMan getstakinginfo()
                         {RPCResult::Type::NUM, "delegateweight", "Delegate weight"},
                         {RPCResult::Type::NUM, "netstakeweight", "Network stake weight"},
                         {RPCResult::Type::NUM, "expectedtime", "Expected time to earn reward"},
+                        {RPCResult::Type::NUM, "stakecachesize", "The number of coins in the staker cache"},
+                        {RPCResult::Type::NUM, "stakecachememory", "The memory used by the staker cache in bytes"},
                     }
                 },
                 RPCExamples{
@@ -143,20 +146,29 @@ RPCHelpMan getstakinginfo()
     uint64_t nStakerWeight = 0;
     uint64_t nDelegateWeight = 0;
     uint64_t lastCoinStakeSearchInterval = 0;
+    uint64_t stakeCacheSize = 0;
+    uint64_t stakeCacheMemory = 0;
 
     if (pwallet)
     {
         LOCK(pwallet->cs_wallet);
         nWeight = pwallet->GetStakeWeight(&nStakerWeight, &nDelegateWeight);
         lastCoinStakeSearchInterval = pwallet->m_enabled_staking ? pwallet->m_last_coin_stake_search_interval : 0;
+        stakeCacheSize = pwallet->minerStakeCache.size();
+        stakeCacheMemory = pwallet->minerStakeCache.memoryUsage();
     }
 
     LOCK(cs_main);
     uint64_t nNetworkWeight = GetPoSKernelPS(chainman);
     bool staking = lastCoinStakeSearchInterval && nWeight;
-    const Consensus::Params& consensusParams = Params().GetConsensus();
-    int64_t nTargetSpacing = consensusParams.TargetSpacing(chainman.m_best_header->nHeight);
-    uint64_t nExpectedTime = staking ? (nTargetSpacing * nNetworkWeight / nWeight) : 0;
+    uint64_t nExpectedTime = 0;
+    if (staking && g_stake_estimator && g_stake_estimator->Ready()) {
+        nExpectedTime = g_stake_estimator->ExpectedTime(nWeight);
+    } else if (staking) {
+        const Consensus::Params& consensusParams = Params().GetConsensus();
+        int64_t nTargetSpacing = consensusParams.TargetSpacing(chainman.m_best_header->nHeight);
+        nExpectedTime = nTargetSpacing * nNetworkWeight / nWeight;
+    }
 
     UniValue obj(UniValue::VOBJ);
 
@@ -175,6 +187,84 @@ RPCHelpMan getstakinginfo()
     obj.pushKV("netstakeweight", (uint64_t)nNetworkWeight);
 
     obj.pushKV("expectedtime", nExpectedTime);
+    obj.pushKV("stakecachesize", stakeCacheSize);
+    obj.pushKV("stakecachememory", stakeCacheMemory);
+
+    return obj;
+},
+    };
+}
+
+static RPCHelpMan getstakingmetrics()
+{
+    return RPCHelpMan{"getstakingmetrics",
+                "\nReturns the timings of the staker phases for each block time it searched, and its slot counters.\n"
+                "A slot is missed when a kernel was found for the block time but no block was submitted for it.\n",
+                {
+                    {"reset", RPCArg::Type::BOOL, RPCArg::Default{false}, "Reset the metrics after returning them"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "slotssearched", "The number of block times searched for a kernel"},
+                        {RPCResult::Type::NUM, "slotssolved", "The number of block times a kernel was found for"},
+                        {RPCResult::Type::NUM, "slotsmissed", "The number of solved block times no block was submitted for"},
+                        {RPCResult::Type::NUM, "blockssubmitted", "The number of blocks passed to block validation"},
+                        {RPCResult::Type::NUM, "blocksaccepted", "The number of submitted blocks that were accepted"},
+                        {RPCResult::Type::OBJ_DYN, "phases", "The timings by phase (updatedata, kernelsearch, createblock, signblock, processblock)",
+                        {
+                            {RPCResult::Type::OBJ, "phase", "",
+                            {
+                                {RPCResult::Type::NUM, "count", "The number of timed runs"},
+                                {RPCResult::Type::NUM, "total_us", "The total duration in microseconds"},
+                                {RPCResult::Type::NUM, "avg_us", "The average duration in microseconds"},
+                                {RPCResult::Type::NUM, "max_us", "The longest duration in microseconds"},
+                                {RPCResult::Type::ARR, "histogram", "The number of runs that took less than 1, 2, 4, ... 2^14 ms, the last entry the longer runs",
+                                {
+                                    {RPCResult::Type::NUM, "", "The number of runs"},
+                                }},
+                            }},
+                        }},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("getstakingmetrics", "")
+            + HelpExampleCli("getstakingmetrics", "true")
+            + HelpExampleRpc("getstakingmetrics", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    std::shared_ptr<CWallet> const pwallet = GetWalletForJSONRPCRequest(request);
+    if (!pwallet) return NullUniValue;
+
+    const StakingMetrics::Snapshot metrics = pwallet->m_staking_metrics.GetSnapshot();
+    if (!request.params[0].isNull() && request.params[0].get_bool()) {
+        pwallet->m_staking_metrics.Reset();
+    }
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("slotssearched", metrics.slots_searched);
+    obj.pushKV("slotssolved", metrics.slots_solved);
+    obj.pushKV("slotsmissed", metrics.slots_missed);
+    obj.pushKV("blockssubmitted", metrics.blocks_submitted);
+    obj.pushKV("blocksaccepted", metrics.blocks_accepted);
+
+    UniValue phases(UniValue::VOBJ);
+    for (size_t i = 0; i < STAKING_PHASE_COUNT; ++i) {
+        const StakingMetrics::Timing& timing = metrics.phases[i];
+        UniValue phase(UniValue::VOBJ);
+        phase.pushKV("count", timing.count);
+        phase.pushKV("total_us", count_microseconds(timing.total));
+        phase.pushKV("avg_us", timing.count ? count_microseconds(timing.total) / (int64_t)timing.count : 0);
+        phase.pushKV("max_us", count_microseconds(timing.max));
+        UniValue histogram(UniValue::VARR);
+        for (uint64_t bucket : timing.histogram) {
+            histogram.push_back(bucket);
+        }
+        phase.pushKV("histogram", histogram);
+        phases.pushKV(StakingPhaseName(static_cast<StakingPhase>(i)), phase);
+    }
+    obj.pushKV("phases", phases);
 
     return obj;
 },
@@ -189,6 +279,7 @@ static const CRPCCommand commands[] =
   //  ------------------    ------------------------
     { "mining",             &getmininginfo,                  },
     { "mining",             &getstakinginfo,                 },
+    { "mining",             &getstakingmetrics,              },
 };
 // clang-format on
     return commands;
@@ -1934,6 +1934,53 @@ CTransactionRef SplitUTXOs(std::shared_ptr<CWallet> const pwallet, const CTxDest
     return tx;
 }
 
+/** Sign transactions that spend different coins of the wallet, in parallel on the wallet threads */
+static bool SignTransactions(const CWallet& wallet, std::vector<CMutableTransaction>& txs) EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet)
+{
+    // Get the coins spent under the wallet lock, the signing only reads the keys
+    std::vector<std::map<COutPoint, Coin>> coins(txs.size());
+    for(size_t i = 0; i < txs.size(); i++)
+    {
+        for (const CTxIn& input : txs[i].vin) {
+            const CWalletTx* wtx = wallet.GetWalletTx(input.prevout.hash);
+            if (!wtx || input.prevout.n >= wtx->tx->vout.size()) {
+                return false;
+            }
+            int prev_height = wtx->state<TxStateConfirmed>() ? wtx->state<TxStateConfirmed>()->confirmed_block_height : 0;
+            coins[i][input.prevout] = Coin(wtx->tx->vout[input.prevout.n], prev_height, wtx->IsCoinBase(), wtx->IsCoinStake());
+        }
+    }
+
+    std::vector<char> signed_txs(txs.size(), false);
+    auto sign = [&wallet, &txs, &coins, &signed_txs](size_t from, size_t to) {
+        for(size_t i = from; i < to; i++)
+        {
+            std::map<int, bilingual_str> input_errors;
+            signed_txs[i] = wallet.SignTransaction(txs[i], coins[i], SIGHASH_DEFAULT, input_errors);
+        }
+    };
+
+    size_t listSize = txs.size();
+    int numThreads = std::min(wallet.m_num_threads, (int)listSize);
+    if(numThreads < 2)
+    {
+        sign(0, listSize);
+    }
+    else
+    {
+        size_t chunk = listSize / numThreads;
+        for(int i = 0; i < numThreads; i++)
+        {
+            size_t from = i * chunk;
+            size_t to = i == (numThreads -1) ? listSize : from + chunk;
+            wallet.threads.create_thread([&sign, from, to]{ sign(from, to); });
+        }
+        wallet.threads.join_all();
+    }
+
+    return std::all_of(signed_txs.begin(), signed_txs.end(), [](char ok) { return ok; });
+}
+
 RPCHelpMan splitutxosforaddress()
 {
     return RPCHelpMan{"splitutxosforaddress",
@@ -1945,11 +1992,17 @@ RPCHelpMan splitutxosforaddress()
                     {"maxvalue", RPCArg::Type::AMOUNT, RPCArg::Optional::NO, "Select utxo which value is greater than value (minimum 0.1 COIN)"},
                     {"maxoutputs", RPCArg::Type::NUM, RPCArg::Default{100}, "Maximum outputs to create"},
                     {"psbt", RPCArg::Type::BOOL, RPCArg::Optional::OMITTED, "Create partially signed transaction."},
+                    {"maxtransactions", RPCArg::Type::NUM, RPCArg::Default{1}, "Maximum transactions to create, each one with up to maxoutputs outputs. "
+                        "The transactions spend only the coins selected for them, are signed in parallel and sent together. Not supported with psbt."},
                 },
                 RPCResult{
                     RPCResult::Type::OBJ, "", "",
                     {
                         {RPCResult::Type::STR_HEX, "txid", /*optional=*/true, "The hex-encoded transaction id"},
+                        {RPCResult::Type::ARR, "txids", /*optional=*/true, "The hex-encoded transaction ids, when maxtransactions is greater than 1",
+                        {
+                            {RPCResult::Type::STR_HEX, "txid", "The hex-encoded transaction id"},
+                        }},
                         {RPCResult::Type::STR, "psbt", /*optional=*/true, "The base64-encoded unsigned PSBT of the new transaction."},
                         {RPCResult::Type::STR, "selected", "Selected amount of coins"},
                         {RPCResult::Type::STR, "splited", "Splited amount of coins"},
@@ -1960,6 +2013,7 @@ RPCHelpMan splitutxosforaddress()
             + HelpExampleCli("splitutxosforaddress", "\"QM72Sfpbz1BPpXFHz9m3CdqATR44Jvaydd\" 100 200 100")
             + HelpExampleRpc("splitutxosforaddress", "\"QM72Sfpbz1BPpXFHz9m3CdqATR44Jvaydd\" 100 200")
             + HelpExampleRpc("splitutxosforaddress", "\"QM72Sfpbz1BPpXFHz9m3CdqATR44Jvaydd\" 100 200 100")
+            + HelpExampleCli("splitutxosforaddress", "\"QM72Sfpbz1BPpXFHz9m3CdqATR44Jvaydd\" 100 200 100 false 10")
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
@@ -2005,6 +2059,15 @@ RPCHelpMan splitutxosforaddress()
         fPsbt=request.params[4].get_bool();
     }
 
+    // Maximum transactions
+    int maxTransactions = !request.params[5].isNull() ? request.params[5].getInt<int>() : 1;
+    if (maxTransactions < 1) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid value for maximum transactions");
+    }
+    if (maxTransactions > 1 && fPsbt) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Maximum transactions greater than 1 is not supported with psbt");
+    }
+
     // Amount
     CAmount nSplitAmount = minValue;
     CAmount nRequiredAmount = nSplitAmount * maxOutputs;
@@ -2019,8 +2082,12 @@ RPCHelpMan splitutxosforaddress()
     assert(pwallet != NULL);
     std::vector<COutput> vecOutputs = AvailableCoins(*pwallet, &coin_control).All();
 
+    // The coins are selected for each transaction in turn, the transactions of a bulk split spend only their coins
+    std::vector<CCoinControl> groups{coin_control};
+    std::vector<CAmount> selected{0};
+    if(maxTransactions > 1) groups.back().m_allow_other_inputs = false;
+
     CAmount total = 0;
-    CAmount nSelectedAmount = 0;
     for(const COutput& out : vecOutputs) {
         CTxDestination destAdress;
         const CScript& scriptPubKey = out.txout.scriptPubKey;
@@ -2030,19 +2097,57 @@ RPCHelpMan splitutxosforaddress()
         if (!fValidAddress || address != destAdress || (val >= minValue && val <= maxValue ) )
             continue;
 
-        if(nSelectedAmount <= nRequiredAmount)
+        if(selected.back() > nRequiredAmount && (int)groups.size() < maxTransactions)
         {
-            coin_control.Select(out.outpoint);
-            nSelectedAmount += val;
+            groups.push_back(groups.back());
+            groups.back().UnSelectAll();
+            selected.push_back(0);
+        }
+        if(selected.back() <= nRequiredAmount)
+        {
+            groups.back().Select(out.outpoint);
+            selected.back() += val;
         }
         total += val;
     }
 
     CAmount splited = 0;
     UniValue obj(UniValue::VOBJ);
-    if(coin_control.HasSelected() && nSplitAmount < nSelectedAmount){
+    if(maxTransactions > 1){
+        // Build the transactions, then sign them in parallel and commit them together
+        EnsureWalletIsUnlocked(*pwallet);
+        std::vector<CMutableTransaction> txs;
+        for(size_t i = 0; i < groups.size(); i++)
+        {
+            if(!groups[i].HasSelected() || nSplitAmount >= selected[i])
+                continue;
+
+            CAmount nSplited = 0;
+            txs.emplace_back(*SplitUTXOs(pwallet, address, nSplitAmount, maxValue, groups[i], selected[i], maxOutputs, nSplited, false));
+            splited += nSplited;
+        }
+
+        if (!SignTransactions(*pwallet, txs)) {
+            throw JSONRPCError(RPC_WALLET_ERROR, "Signing transaction failed");
+        }
+
+        UniValue txids(UniValue::VARR);
+        DatabaseGroupCommit group_commit(pwallet->GetDatabase());
+        for(CMutableTransaction& mtx : txs)
+        {
+            CTransactionRef tx = MakeTransactionRef(std::move(mtx));
+            pwallet->CommitTransaction(tx, {} /* mapValue */, {} /* orderForm */);
+            txids.push_back(tx->GetHash().GetHex());
+        }
+        if(!txids.empty())
+        {
+            obj.pushKV("txid",          txids[0].get_str());
+            obj.pushKV("txids",         txids);
+        }
+    }
+    else if(groups[0].HasSelected() && nSplitAmount < selected[0]){
         EnsureWalletIsUnlocked(*pwallet);
-        CTransactionRef tx = SplitUTXOs(pwallet, address, nSplitAmount, maxValue, coin_control, nSelectedAmount, maxOutputs, splited, !fPsbt);
+        CTransactionRef tx = SplitUTXOs(pwallet, address, nSplitAmount, maxValue, groups[0], selected[0], maxOutputs, splited, !fPsbt);
         if(fPsbt){
             // Make a blank psbt
             PartiallySignedTransaction psbtx;
@@ -184,16 +184,7 @@ static RPCHelpMan setsuperstakervaluesforaddress()
 
     // Search for super staker
     CSuperStakerInfo superStaker;
-    bool found = false;
-    for(auto item : pwallet->mapSuperStaker)
-    {
-        if(PKHash(item.second.stakerAddress) == pkhStaker)
-        {
-            superStaker = item.second;
-            found = true;
-            break;
-        }
-    }
+    bool found = pwallet->GetSuperStaker(superStaker, uint160(pkhStaker));
 
     if(found)
     {
@@ -322,16 +313,7 @@ static RPCHelpMan listsuperstakervaluesforaddress()
 
     // Search for super staker
     CSuperStakerInfo superStaker;
-    bool found = false;
-    for(auto item : pwallet->mapSuperStaker)
-    {
-        if(PKHash(item.second.stakerAddress) == pkhStaker)
-        {
-            superStaker = item.second;
-            found = true;
-            break;
-        }
-    }
+    bool found = pwallet->GetSuperStaker(superStaker, uint160(pkhStaker));
 
     if(!found)
     {
@@ -374,12 +356,14 @@ static RPCHelpMan removesuperstakervaluesforaddress()
     // Search for super staker
     CSuperStakerInfo superStaker;
     bool found = false;
-    for(auto item : pwallet->mapSuperStaker)
+    uint160 stakerAddress(pkhStaker);
+    for(auto it = pwallet->m_super_staker_index.lower_bound({stakerAddress, uint256()});
+        it != pwallet->m_super_staker_index.end() && it->first == stakerAddress; it++)
     {
-        if(PKHash(item.second.stakerAddress) == pkhStaker &&
-                item.second.fCustomConfig)
+        const CSuperStakerInfo& item = pwallet->mapSuperStaker.at(it->second);
+        if(item.fCustomConfig)
         {
-            superStaker = item.second;
+            superStaker = item;
             found = true;
             break;
         }
@@ -456,6 +440,7 @@ static RPCHelpMan reservebalance()
                 throw std::runtime_error("cannot specify amount to turn off reserve.\n");
             pwallet->m_reserve_balance = 0;
         }
+        pwallet->MarkStakeWeightDirty();
     }
 
     UniValue result(UniValue::VOBJ);
@@ -9,18 +9,56 @@
 #include <script/descriptor.h>
 #include <script/sign.h>
 #include <util/bip32.h>
+#include <util/system.h>
 #include <util/strencodings.h>
 #include <util/string.h>
 #include <util/time.h>
 #include <util/translation.h>
 #include <wallet/scriptpubkeyman.h>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <optional>
+#include <thread>
 
 namespace wallet {
 //! Value for the first BIP 32 hardened derivation. Can be used as a bit mask and as a value. See BIP 32 for more details.
 const uint32_t BIP32_HARDENED_KEY_LIMIT = 0x80000000;
 
+//! Minimum number of PSBT inputs for each thread that signs them, fewer inputs are signed by the calling thread
+static constexpr size_t PSBT_INPUTS_PER_THREAD{32};
+
+/**
+ * Sign the PSBT inputs at the indexes, in parallel when there are many of them. Each input is
+ * signed once and only its own PSBTInput is written, so the result does not depend on the threads.
+ */
+static void SignPSBTInputs(const std::vector<unsigned int>& indexes, const std::function<void(unsigned int)>& sign_input)
+{
+    const size_t num_threads = std::min<size_t>(GetNumCores(), indexes.size() / PSBT_INPUTS_PER_THREAD);
+    if (num_threads < 2) {
+        for (unsigned int i : indexes) {
+            sign_input(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t k = next++; k < indexes.size(); k = next++) {
+            sign_input(indexes[k]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
 util::Result<CTxDestination> LegacyScriptPubKeyMan::GetNewDestination(const OutputType type)
 {
     if (LEGACY_OUTPUT_TYPES.count(type) == 0) {
@@ -629,6 +667,7 @@ TransactionError LegacyScriptPubKeyMan::FillPSBT(PartiallySignedTransaction& psb
     if (n_signed) {
         *n_signed = 0;
     }
+    std::vector<unsigned int> to_sign;
     for (unsigned int i = 0; i < psbtx.tx->vin.size(); ++i) {
         const CTxIn& txin = psbtx.tx->vin[i];
         PSBTInput& input = psbtx.inputs.at(i);
@@ -651,11 +690,16 @@ TransactionError LegacyScriptPubKeyMan::FillPSBT(PartiallySignedTransaction& psb
             // There's no UTXO so we can just skip this now
             continue;
         }
-        SignatureData sigdata;
-        input.FillSignatureData(sigdata);
+        to_sign.push_back(i);
+    }
+
+    // The key store is locked for each key read, the signatures are made without the lock
+    SignPSBTInputs(to_sign, [&](unsigned int i) {
         SignPSBTInput(HidingSigningProvider(this, !sign, !bip32derivs), psbtx, i, &txdata, sighash_type, nullptr, finalize);
+    });
 
-        bool signed_one = PSBTInputSigned(input);
+    for (unsigned int i : to_sign) {
+        bool signed_one = PSBTInputSigned(psbtx.inputs.at(i));
         if (n_signed && (signed_one || !sign)) {
             // If sign is false, we assume that we _could_ sign if we get here. This
             // will never have false negatives; it is hard to tell under what i
@@ -2137,6 +2181,37 @@ std::map<CKeyID, CKey> DescriptorScriptPubKeyMan::GetKeys() const
     return m_map_keys;
 }
 
+/** The scripts and keys of a descriptor at an index */
+struct ExpandedIndex
+{
+    bool expanded{false};
+    std::vector<CScript> scripts;
+    FlatSigningProvider keys;
+};
+
+/** Expand the indexes [start, end) of a descriptor from its cache. The BIP32 derivations are
+ *  split on several threads for a large range. */
+static std::vector<ExpandedIndex> ExpandFromCacheParallel(const Descriptor& descriptor, const DescriptorCache& cache, int32_t start, int32_t end)
+{
+    std::vector<ExpandedIndex> result(std::max(end - start, 0));
+    auto expand = [&](size_t from, size_t to) {
+        for (size_t pos = from; pos < to; ++pos) {
+            result[pos].expanded = descriptor.ExpandFromCache(start + static_cast<int32_t>(pos), cache, result[pos].scripts, result[pos].keys);
+        }
+    };
+
+    size_t num_threads = result.size() < PARALLEL_EXPAND_MIN_INDEXES ? 1 : std::clamp(GetNumCores(), 1, MAX_EXPAND_THREADS);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; ++i) {
+        threads.emplace_back(expand, i * result.size() / num_threads, (i + 1) * result.size() / num_threads);
+    }
+    expand(0, result.size() / num_threads);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return result;
+}
+
 bool DescriptorScriptPubKeyMan::TopUp(unsigned int size)
 {
     LOCK(cs_desc_man);
@@ -2162,17 +2237,28 @@ bool DescriptorScriptPubKeyMan::TopUp(unsigned int size)
 
     WalletBatch batch(m_storage.GetDatabase());
     uint256 id = GetID();
-    for (int32_t i = m_max_cached_index + 1; i < new_range_end; ++i) {
+    const int32_t start = m_max_cached_index + 1;
+    std::vector<ExpandedIndex> expanded;
+    std::vector<CScript> new_spks;
+    for (int32_t i = start; i < new_range_end; ++i) {
         FlatSigningProvider out_keys;
         std::vector<CScript> scripts_temp;
         DescriptorCache temp_cache;
-        // Maybe we have a cached xpub and we can expand from the cache first
-        if (!m_wallet_descriptor.descriptor->ExpandFromCache(i, m_wallet_descriptor.cache, scripts_temp, out_keys)) {
+        // Maybe we have a cached xpub and we can expand from the cache first. Once the first index is
+        // expanded its xpubs are cached, and the rest of the range is derived from them on several threads.
+        if (i == start + 1) {
+            expanded = ExpandFromCacheParallel(*m_wallet_descriptor.descriptor, m_wallet_descriptor.cache, i, new_range_end);
+        }
+        if (i > start && expanded[i - start - 1].expanded) {
+            scripts_temp = std::move(expanded[i - start - 1].scripts);
+            out_keys = std::move(expanded[i - start - 1].keys);
+        } else if (!m_wallet_descriptor.descriptor->ExpandFromCache(i, m_wallet_descriptor.cache, scripts_temp, out_keys)) {
             if (!m_wallet_descriptor.descriptor->Expand(i, provider, scripts_temp, out_keys, &temp_cache)) return false;
         }
         // Add all of the scriptPubKeys to the scriptPubKey set
         for (const CScript& script : scripts_temp) {
             m_map_script_pub_keys[script] = i;
+            new_spks.push_back(script);
         }
         for (const auto& pk_pair : out_keys.pubkeys) {
             const CPubKey& pubkey = pk_pair.second;
@@ -2192,6 +2278,7 @@ bool DescriptorScriptPubKeyMan::TopUp(unsigned int size)
     }
     m_wallet_descriptor.range_end = new_range_end;
     batch.WriteDescriptor(GetID(), m_wallet_descriptor);
+    m_storage.TopUpCallback(new_spks, this);
 
     // By this point, the cache size should be the size of the entire range
     assert(m_wallet_descriptor.range_end - 1 == m_max_cached_index);
@@ -2492,6 +2579,8 @@ TransactionError DescriptorScriptPubKeyMan::FillPSBT(PartiallySignedTransaction&
     if (n_signed) {
         *n_signed = 0;
     }
+    std::vector<unsigned int> to_sign;
+    std::vector<CScript> scripts(psbtx.tx->vin.size());
     for (unsigned int i = 0; i < psbtx.tx->vin.size(); ++i) {
         const CTxIn& txin = psbtx.tx->vin[i];
         PSBTInput& input = psbtx.inputs.at(i);
@@ -2506,7 +2595,7 @@ TransactionError DescriptorScriptPubKeyMan::FillPSBT(PartiallySignedTransaction&
         }
 
         // Get the scriptPubKey to know which SigningProvider to use
-        CScript script;
+        CScript& script = scripts[i];
         if (!input.witness_utxo.IsNull()) {
             script = input.witness_utxo.scriptPubKey;
         } else if (input.non_witness_utxo) {
@@ -2518,8 +2607,13 @@ TransactionError DescriptorScriptPubKeyMan::FillPSBT(PartiallySignedTransaction&
             // There's no UTXO so we can just skip this now
             continue;
         }
-        SignatureData sigdata;
-        input.FillSignatureData(sigdata);
+        to_sign.push_back(i);
+    }
+
+    // The descriptors are locked to get the keys of an input, the signatures are made without the lock
+    SignPSBTInputs(to_sign, [&](unsigned int i) {
+        const PSBTInput& input = psbtx.inputs.at(i);
+        const CScript& script = scripts[i];
 
         std::unique_ptr<FlatSigningProvider> keys = std::make_unique<FlatSigningProvider>();
         std::unique_ptr<FlatSigningProvider> script_keys = GetSigningProvider(script, /*include_private=*/sign);
@@ -2565,8 +2659,10 @@ TransactionError DescriptorScriptPubKeyMan::FillPSBT(PartiallySignedTransaction&
         }
 
         SignPSBTInput(HidingSigningProvider(keys.get(), /*hide_secret=*/!sign, /*hide_origin=*/!bip32derivs), psbtx, i, &txdata, sighash_type, nullptr, finalize);
+    });
 
-        bool signed_one = PSBTInputSigned(input);
+    for (unsigned int i : to_sign) {
+        bool signed_one = PSBTInputSigned(psbtx.inputs.at(i));
         if (n_signed && (signed_one || !sign)) {
             // If sign is false, we assume that we _could_ sign if we get here. This
             // will never have false negatives; it is hard to tell under what i
@@ -2618,18 +2714,22 @@ void DescriptorScriptPubKeyMan::SetCache(const DescriptorCache& cache)
 {
     LOCK(cs_desc_man);
     m_wallet_descriptor.cache = cache;
+    std::vector<ExpandedIndex> expanded = ExpandFromCacheParallel(*m_wallet_descriptor.descriptor, m_wallet_descriptor.cache,
+                                                                  m_wallet_descriptor.range_start, m_wallet_descriptor.range_end);
+    std::vector<CScript> new_spks;
     for (int32_t i = m_wallet_descriptor.range_start; i < m_wallet_descriptor.range_end; ++i) {
-        FlatSigningProvider out_keys;
-        std::vector<CScript> scripts_temp;
-        if (!m_wallet_descriptor.descriptor->ExpandFromCache(i, m_wallet_descriptor.cache, scripts_temp, out_keys)) {
+        ExpandedIndex& index = expanded[i - m_wallet_descriptor.range_start];
+        if (!index.expanded) {
             throw std::runtime_error("Error: Unable to expand wallet descriptor from cache");
         }
+        const FlatSigningProvider& out_keys = index.keys;
         // Add all of the scriptPubKeys to the scriptPubKey set
-        for (const CScript& script : scripts_temp) {
+        for (const CScript& script : index.scripts) {
             if (m_map_script_pub_keys.count(script) != 0) {
                 throw std::runtime_error(strprintf("Error: Already loaded script at index %d as being at index %d", i, m_map_script_pub_keys[script]));
             }
             m_map_script_pub_keys[script] = i;
+            new_spks.push_back(script);
         }
         for (const auto& pk_pair : out_keys.pubkeys) {
             const CPubKey& pubkey = pk_pair.second;
@@ -2642,6 +2742,7 @@ void DescriptorScriptPubKeyMan::SetCache(const DescriptorCache& cache)
         }
         m_max_cached_index++;
     }
+    m_storage.TopUpCallback(new_spks, this);
 }
 
 bool DescriptorScriptPubKeyMan::AddKey(const CKeyID& key_id, const CKey& key)
@@ -27,6 +27,8 @@ enum class OutputType;
 struct bilingual_str;
 
 namespace wallet {
+class ScriptPubKeyMan;
+
 // Wallet storage things that ScriptPubKeyMans need in order to be able to store things to the wallet database.
 // It provides access to things that are part of the entire wallet and not specific to a ScriptPubKeyMan such as
 // wallet flags, wallet version, encryption keys, encryption status, and the database itself. This allows a
@@ -45,8 +47,15 @@ public:
     virtual const CKeyingMaterial& GetEncryptionKey() const = 0;
     virtual bool HasEncryptionKeys() const = 0;
     virtual bool IsLocked() const = 0;
+    //! Callback with the scriptPubKeys a ScriptPubKeyMan starts watching, see DescriptorScriptPubKeyMan::TopUp
+    virtual void TopUpCallback(const std::vector<CScript>& spks, ScriptPubKeyMan* spkm) = 0;
 };
 
+//! Expand the descriptor indexes from the cache on several threads when there are at least this many
+static constexpr size_t PARALLEL_EXPAND_MIN_INDEXES{64};
+//! Maximum number of threads expanding descriptor indexes from the cache
+static constexpr int MAX_EXPAND_THREADS{8};
+
 //! Default for -keypool
 static const unsigned int DEFAULT_KEYPOOL_SIZE = 1000;
 
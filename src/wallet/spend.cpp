@@ -24,11 +24,14 @@
 #include <wallet/wallet.h>
 
 #include <cmath>
+#include <thread>
 
 using interfaces::FoundBlock;
 
 namespace wallet {
 static constexpr size_t OUTPUT_GROUP_MAX_ENTRIES{100};
+//! Run BnB on its own thread next to the other solvers from this many positive output groups
+static constexpr size_t PARALLEL_BNB_MIN_GROUPS{100};
 
 int CalculateMaximumSignedInputSize(const CTxOut& txout, const COutPoint outpoint, const SigningProvider* provider, bool can_grind_r, const CCoinControl* coin_control)
 {
@@ -218,10 +221,10 @@ CoinsResult AvailableCoins(const CWallet& wallet,
     const bool can_grind_r = wallet.CanGrindR();
 
     std::set<uint256> trusted_parents;
-    for (const auto& entry : wallet.mapWallet)
+    for (const CWalletTx* pwtx : wallet.GetUnspentTxs())
     {
-        const uint256& wtxid = entry.first;
-        const CWalletTx& wtx = entry.second;
+        const uint256& wtxid = pwtx->GetHash();
+        const CWalletTx& wtx = *pwtx;
 
         if (wallet.IsTxImmature(wtx) && !params.include_immature_coinbase)
             continue;
@@ -560,8 +563,18 @@ util::Result<SelectionResult> ChooseSelectionResult(const CAmount& nTargetValue,
     // Vector of results. We will choose the best one based on waste.
     std::vector<SelectionResult> results;
 
-    if (auto bnb_result{SelectCoinsBnB(groups.positive_group, nTargetValue, coin_selection_params.m_cost_of_change)}) {
-        results.push_back(*bnb_result);
+    // The BnB search takes the longest on large pools, run it on its own thread over a copy
+    // of the pool, which it sorts, while the other solvers run here
+    std::optional<SelectionResult> bnb_result;
+    std::vector<OutputGroup> bnb_pool;
+    std::thread bnb_thread;
+    if (groups.positive_group.size() >= PARALLEL_BNB_MIN_GROUPS) {
+        bnb_pool = groups.positive_group;
+        bnb_thread = std::thread([&] {
+            bnb_result = SelectCoinsBnB(bnb_pool, nTargetValue, coin_selection_params.m_cost_of_change);
+        });
+    } else {
+        bnb_result = SelectCoinsBnB(groups.positive_group, nTargetValue, coin_selection_params.m_cost_of_change);
     }
 
     // The knapsack solver has some legacy behavior where it will spend dust outputs. We retain this behavior, so don't filter for positive only here.
@@ -575,6 +588,12 @@ util::Result<SelectionResult> ChooseSelectionResult(const CAmount& nTargetValue,
         results.push_back(*srd_result);
     }
 
+    // BnB goes first, the first result with the least waste is chosen
+    if (bnb_thread.joinable()) bnb_thread.join();
+    if (bnb_result) {
+        results.insert(results.begin(), *bnb_result);
+    }
+
     if (results.empty()) {
         // No solution found
         return util::Error();
@@ -256,6 +256,11 @@ void SQLiteDatabase::Open()
     // Enable fullfsync for the platforms that use it
     SetPragma(m_db, "fullfsync", "true", "Failed to enable fullfsync");
 
+    // Append the transactions to a write-ahead log, a commit only syncs the log. The
+    // synchronous mode stays FULL so that a committed transaction survives a power loss.
+    // With the exclusive locking mode the log does not use shared memory.
+    SetPragma(m_db, "journal_mode", "WAL", "Failed to set journal mode to WAL");
+
     if (m_use_unsafe_sync) {
         // Use normal synchronous mode for the journal
         LogPrintf("WARNING SQLite is configured to not wait for data to be flushed to disk. Data loss and corruption may occur.\n");
@@ -334,6 +339,31 @@ bool SQLiteDatabase::Backup(const std::string& dest) const
     return res == SQLITE_OK;
 }
 
+bool SQLiteDatabase::BeginGroupCommit()
+{
+    if (!m_db || m_group_commit || sqlite3_get_autocommit(m_db) == 0) return false;
+    int res = sqlite3_exec(m_db, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
+    if (res != SQLITE_OK) {
+        LogPrintf("SQLiteDatabase: Failed to begin the group commit\n");
+        return false;
+    }
+    m_group_commit = true;
+    return true;
+}
+
+bool SQLiteDatabase::EndGroupCommit()
+{
+    if (!m_db || !m_group_commit) return false;
+    m_group_commit = false;
+    int res = sqlite3_exec(m_db, "COMMIT TRANSACTION", nullptr, nullptr, nullptr);
+    if (res != SQLITE_OK) {
+        LogPrintf("SQLiteDatabase: Failed to commit the group commit: %s\n", sqlite3_errstr(res));
+        // Leave the database in autocommit mode for the next writes
+        if (sqlite3_get_autocommit(m_db) == 0) sqlite3_exec(m_db, "ROLLBACK TRANSACTION", nullptr, nullptr, nullptr);
+    }
+    return res == SQLITE_OK;
+}
+
 void SQLiteDatabase::Close()
 {
     int res = sqlite3_close(m_db);
@@ -360,8 +390,8 @@ SQLiteBatch::SQLiteBatch(SQLiteDatabase& database)
 
 void SQLiteBatch::Close()
 {
-    // If m_db is in a transaction (i.e. not in autocommit mode), then abort the transaction in progress
-    if (m_database.m_db && sqlite3_get_autocommit(m_database.m_db) == 0) {
+    // If this batch began a transaction, then abort the transaction in progress
+    if (m_database.m_db && (m_txn || m_savepoint)) {
         if (TxnAbort()) {
             LogPrintf("SQLiteBatch: Batch closed unexpectedly without the transaction being explicitly committed or aborted\n");
         } else {
@@ -520,17 +550,38 @@ std::unique_ptr<DatabaseCursor> SQLiteBatch::GetNewCursor()
 
 bool SQLiteBatch::TxnBegin()
 {
-    if (!m_database.m_db || sqlite3_get_autocommit(m_database.m_db) == 0) return false;
+    if (!m_database.m_db || m_txn || m_savepoint) return false;
+    if (m_database.m_group_commit) {
+        // The writes are committed with the group, a savepoint keeps them abortable
+        int res = sqlite3_exec(m_database.m_db, "SAVEPOINT batch", nullptr, nullptr, nullptr);
+        if (res != SQLITE_OK) {
+            LogPrintf("SQLiteBatch: Failed to begin the transaction savepoint\n");
+        }
+        m_savepoint = res == SQLITE_OK;
+        return m_savepoint;
+    }
+    if (sqlite3_get_autocommit(m_database.m_db) == 0) return false;
     int res = sqlite3_exec(m_database.m_db, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
     if (res != SQLITE_OK) {
         LogPrintf("SQLiteBatch: Failed to begin the transaction\n");
     }
-    return res == SQLITE_OK;
+    m_txn = res == SQLITE_OK;
+    return m_txn;
 }
 
 bool SQLiteBatch::TxnCommit()
 {
-    if (!m_database.m_db || sqlite3_get_autocommit(m_database.m_db) != 0) return false;
+    if (!m_database.m_db) return false;
+    if (m_savepoint) {
+        m_savepoint = false;
+        int res = sqlite3_exec(m_database.m_db, "RELEASE SAVEPOINT batch", nullptr, nullptr, nullptr);
+        if (res != SQLITE_OK) {
+            LogPrintf("SQLiteBatch: Failed to release the transaction savepoint\n");
+        }
+        return res == SQLITE_OK;
+    }
+    if (!m_txn || sqlite3_get_autocommit(m_database.m_db) != 0) return false;
+    m_txn = false;
     int res = sqlite3_exec(m_database.m_db, "COMMIT TRANSACTION", nullptr, nullptr, nullptr);
     if (res != SQLITE_OK) {
         LogPrintf("SQLiteBatch: Failed to commit the transaction\n");
@@ -540,7 +591,20 @@ bool SQLiteBatch::TxnCommit()
 
 bool SQLiteBatch::TxnAbort()
 {
-    if (!m_database.m_db || sqlite3_get_autocommit(m_database.m_db) != 0) return false;
+    if (!m_database.m_db) return false;
+    if (m_savepoint) {
+        m_savepoint = false;
+        int res = sqlite3_exec(m_database.m_db, "ROLLBACK TRANSACTION TO SAVEPOINT batch", nullptr, nullptr, nullptr);
+        if (res == SQLITE_OK) {
+            res = sqlite3_exec(m_database.m_db, "RELEASE SAVEPOINT batch", nullptr, nullptr, nullptr);
+        }
+        if (res != SQLITE_OK) {
+            LogPrintf("SQLiteBatch: Failed to abort the transaction savepoint\n");
+        }
+        return res == SQLITE_OK;
+    }
+    if (!m_txn || sqlite3_get_autocommit(m_database.m_db) != 0) return false;
+    m_txn = false;
     int res = sqlite3_exec(m_database.m_db, "ROLLBACK TRANSACTION", nullptr, nullptr, nullptr);
     if (res != SQLITE_OK) {
         LogPrintf("SQLiteBatch: Failed to abort the transaction\n");
@@ -37,6 +37,10 @@ private:
     sqlite3_stmt* m_overwrite_stmt{nullptr};
     sqlite3_stmt* m_delete_stmt{nullptr};
 
+    //! Whether this batch began a transaction, or a savepoint in the group commit
+    bool m_txn{false};
+    bool m_savepoint{false};
+
     void SetupSQLStatements();
 
     bool ReadKey(DataStream&& key, DataStream& value) override;
@@ -120,6 +124,9 @@ public:
     bool PeriodicFlush() override { return false; }
     void ReloadDbEnv() override {}
 
+    bool BeginGroupCommit() override;
+    bool EndGroupCommit() override;
+
     void IncrementUpdateCounter() override { ++nUpdateCounter; }
 
     std::string Filename() override { return m_file_path; }
@@ -130,6 +137,8 @@ public:
 
     sqlite3* m_db{nullptr};
     bool m_use_unsafe_sync;
+    //! Whether a group commit is in progress, see BeginGroupCommit
+    std::atomic<bool> m_group_commit{false};
 };
 
 std::unique_ptr<SQLiteDatabase> MakeSQLiteDatabase(const fs::path& path, const DatabaseOptions& options, DatabaseStatus& status, bilingual_str& error);
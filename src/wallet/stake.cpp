@@ -1,5 +1,6 @@
 #include <wallet/stake.h>
 #include <wallet/receive.h>
+#include <index/addressindex.h>
 #include <node/miner.h>
 #include <qtum/qtumledger.h>
 #include <pos.h>
@@ -49,6 +50,14 @@ void StopStake(CWallet& wallet)
     wallet.m_is_staking_thread_stopped = true;
 }
 
+/** Start a new generation of @p cache once per connected block, so that the coins no longer staked are dropped */
+static void NewStakeCacheGeneration(CStakeCacheMap& cache, uint256& cacheTip, const CBlockIndex* pindexPrev)
+{
+    if(cacheTip == pindexPrev->GetBlockHash()) return;
+    cache.newGeneration();
+    cacheTip = pindexPrev->GetBlockHash();
+}
+
 bool CreateCoinStakeFromMine(CWallet& wallet, unsigned int nBits, const CAmount& nTotalFees, uint32_t nTimeBlock, CMutableTransaction& tx, PKHash& pkhash, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoins, std::vector<COutPoint>& setSelectedCoins, bool selectedOnly, bool sign, COutPoint& headerPrevout)
 {
     bool fAllowWatchOnly = wallet.IsWalletFlagSet(WALLET_FLAG_DISABLE_PRIVATE_KEYS);
@@ -85,7 +94,7 @@ bool CreateCoinStakeFromMine(CWallet& wallet, unsigned int nBits, const CAmount&
         wallet.stakeCache.clear();
     }
     if(!wallet.fHasMinerStakeCache && gArgs.GetBoolArg("-stakecache", node::DEFAULT_STAKE_CACHE)) {
-
+        NewStakeCacheGeneration(wallet.stakeCache, wallet.stakeCacheTip, pindexPrev);
         for(const std::pair<const CWalletTx*,unsigned int> &pcoin : setCoins)
         {
             boost::this_thread::interruption_point();
@@ -93,7 +102,7 @@ bool CreateCoinStakeFromMine(CWallet& wallet, unsigned int nBits, const CAmount&
             CacheKernel(wallet.stakeCache, prevoutStake, pindexPrev, wallet.chain().getCoinsTip()); //this will do a 2 disk loads per op
         }
     }
-    std::map<COutPoint, CStakeCache>& cache = wallet.fHasMinerStakeCache ? wallet.minerStakeCache : wallet.stakeCache;
+    CStakeCacheMap& cache = wallet.fHasMinerStakeCache ? wallet.minerStakeCache : wallet.stakeCache;
     int64_t nCredit = 0;
     CScript scriptPubKeyKernel;
     CScript aggregateScriptPubKeyHashKernel;
@@ -302,14 +311,14 @@ bool CreateCoinStakeFromDelegate(CWallet& wallet, unsigned int nBits, const CAmo
         wallet.stakeDelegateCache.clear();
     }
     if(!wallet.fHasMinerStakeCache && gArgs.GetBoolArg("-stakecache", node::DEFAULT_STAKE_CACHE)) {
-
+        NewStakeCacheGeneration(wallet.stakeDelegateCache, wallet.stakeDelegateCacheTip, pindexPrev);
         for(const COutPoint &prevoutStake : setDelegateCoins)
         {
             boost::this_thread::interruption_point();
             CacheKernel(wallet.stakeDelegateCache, prevoutStake, pindexPrev, wallet.chain().getCoinsTip()); //this will do a 2 disk loads per op
         }
     }
-    std::map<COutPoint, CStakeCache>& cache = wallet.fHasMinerStakeCache ? wallet.minerStakeCache : wallet.stakeDelegateCache;
+    CStakeCacheMap& cache = wallet.fHasMinerStakeCache ? wallet.minerStakeCache : wallet.stakeDelegateCache;
     int64_t nCredit = 0;
     CScript scriptPubKeyKernel;
     CScript scriptPubKeyStaker;
@@ -540,8 +549,11 @@ void AvailableCoinsForStaking(const CWallet& wallet, const std::vector<uint256>&
     }
 }
 
-bool AvailableDelegateCoinsForStaking(const CWallet& wallet, const std::vector<uint160>& delegations, size_t from, size_t to, int32_t height, const std::map<COutPoint, uint32_t>& immatureStakes,  const std::map<uint256, CSuperStakerInfo>& mapStakers, std::vector<std::pair<COutPoint,CAmount>>& vUnsortedDelegateCoins, std::map<uint160, CAmount> &mDelegateWeight)
+bool AvailableDelegateCoinsForStaking(const CWallet& wallet, const std::vector<uint160>& delegations, size_t from, size_t to, int32_t height, const std::map<COutPoint, uint32_t>& immatureStakes,  const std::map<uint160, CSuperStakerInfo>& mapStakers, std::vector<std::pair<COutPoint,CAmount>>& vUnsortedDelegateCoins, std::map<uint160, CAmount> &mDelegateWeight)
 {
+    // Delegates whose utxos are staked, by address index key, with their minimum utxo value
+    std::map<uint256, std::pair<uint160, CAmount>> mapDelegates;
+    std::vector<std::pair<uint256, int>> addresses;
     for(size_t i = from; i < to; i++)
     {
         std::map<uint160, Delegation>::const_iterator it = wallet.m_delegations_staker.find(delegations[i]);
@@ -551,23 +563,16 @@ bool AvailableDelegateCoinsForStaking(const CWallet& wallet, const std::vector<u
         const Delegation* delegation = &(*it).second;
 
         // Set default delegate stake weight
-        CAmount weight = 0;
-        mDelegateWeight[it->first] = weight;
+        mDelegateWeight[it->first] = 0;
 
         // Get super staker custom configuration
         CAmount staking_min_utxo_value = wallet.m_staking_min_utxo_value;
         uint8_t staking_min_fee = wallet.m_staking_min_fee;
-        for (std::map<uint256, CSuperStakerInfo>::const_iterator it=mapStakers.begin(); it!=mapStakers.end(); it++)
+        std::map<uint160, CSuperStakerInfo>::const_iterator staker = mapStakers.find(delegation->staker);
+        if(staker != mapStakers.end())
         {
-            if(it->second.stakerAddress == delegation->staker)
-            {
-                CSuperStakerInfo info = it->second;
-                if(info.fCustomConfig)
-                {
-                    staking_min_utxo_value = info.nMinDelegateUtxo;
-                    staking_min_fee = info.nMinFee;
-                }
-            }
+            staking_min_utxo_value = staker->second.nMinDelegateUtxo;
+            staking_min_fee = staker->second.nMinFee;
         }
 
         // Check for min staking fee
@@ -580,37 +585,147 @@ bool AvailableDelegateCoinsForStaking(const CWallet& wallet, const std::vector<u
         if (!DecodeIndexKey(EncodeDestination(keyid), hashBytes, type)) {
             return error("Invalid address");
         }
+        mapDelegates[hashBytes] = std::make_pair(it->first, staking_min_utxo_value);
+        addresses.push_back(std::make_pair(hashBytes, type));
+    }
+
+    // Get the utxos of all the addresses in one pass over the address index
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    if (!GetAddressUnspent(addresses, unspentOutputs, wallet.chain().chainman().m_blockman)) {
+        throw error("No information available for address");
+    }
+
+    // Add the utxos to the list if they are mature and at least the minimum value
+    int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(height + 1);
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator i=unspentOutputs.begin(); i!=unspentOutputs.end(); i++) {
+
+        auto delegate = mapDelegates.find(i->first.hashBytes);
+        if(delegate == mapDelegates.end())
+            continue;
+
+        int nDepth = height - i->second.blockHeight + 1;
+        if (nDepth < coinbaseMaturity)
+            continue;
+
+        if(i->second.satoshis < delegate->second.second)
+            continue;
 
-        // Get address utxos
-        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
-        if (!GetAddressUnspent(hashBytes, type, unspentOutputs, wallet.chain().chainman().m_blockman)) {
-            throw error("No information available for address");
+        COutPoint prevout = COutPoint(i->first.txhash, i->first.index);
+        if(immatureStakes.find(prevout) == immatureStakes.end())
+        {
+            vUnsortedDelegateCoins.push_back(std::make_pair(prevout, i->second.satoshis));
+
+            // Update delegate stake weight
+            mDelegateWeight[delegate->second.first] += i->second.satoshis;
         }
+    }
+
+    return true;
+}
+
+bool LoadDelegateCoins(const CWallet& wallet)
+{
+    AssertLockHeld(wallet.cs_wallet);
 
-        // Add the utxos to the list if they are mature and at least the minimum value
-        int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(height + 1);
-        for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator i=unspentOutputs.begin(); i!=unspentOutputs.end(); i++) {
+    // Delegates without a shard, by address index key
+    CWallet::DelegateCoinsSnapshot& snapshot = wallet.m_delegate_coins;
+    std::map<uint256, uint160> mapDelegates;
+    std::vector<std::pair<uint256, int>> addresses;
+    for (const auto& item : wallet.m_delegations_staker)
+    {
+        if(snapshot.fValid && snapshot.shards.count(item.first))
+            continue;
 
-            int nDepth = height - i->second.blockHeight + 1;
-            if (nDepth < coinbaseMaturity)
-                continue;
+        uint256 hashBytes;
+        int type = 0;
+        if (!DecodeIndexKey(EncodeDestination(PKHash(item.first)), hashBytes, type)) {
+            return error("Invalid address");
+        }
+        mapDelegates[hashBytes] = item.first;
+        addresses.push_back(std::make_pair(hashBytes, type));
+    }
+    if(snapshot.fValid && addresses.empty())
+        return true;
+
+    // The shards are loaded at the block of the wallet, the blocks connected after are applied to them.
+    // An index that appended blocks during the read is ahead, which applying these blocks again tolerates.
+    const uint256 hashBlock = wallet.GetLastBlockHash();
+    if(!g_addressindex || g_addressindex->GetSummary().best_block_hash != hashBlock)
+        return false;
+    if(snapshot.fValid && snapshot.hashBlock != hashBlock)
+        snapshot = CWallet::DelegateCoinsSnapshot{};
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    if (!GetAddressUnspent(addresses, unspentOutputs, wallet.chain().chainman().m_blockman)) {
+        return false;
+    }
+
+    if(!snapshot.fValid)
+    {
+        snapshot.fValid = true;
+        snapshot.hashBlock = hashBlock;
+    }
+    for (const auto& item : mapDelegates)
+    {
+        snapshot.shards[item.second];
+    }
+    for (const auto& [key, value] : unspentOutputs)
+    {
+        auto delegate = mapDelegates.find(key.hashBytes);
+        if(delegate == mapDelegates.end())
+            continue;
+
+        COutPoint prevout(key.txhash, key.index);
+        snapshot.shards[delegate->second][prevout] = CWallet::DelegateCoin{value.satoshis, value.blockHeight};
+        snapshot.delegates[prevout] = delegate->second;
+    }
+
+    return true;
+}
+
+void ReadDelegateCoins(const CWallet& wallet, int32_t height, const std::map<COutPoint, uint32_t>& immatureStakes, const std::map<uint160, CSuperStakerInfo>& mapStakers, std::vector<std::pair<COutPoint,CAmount>>& vUnsortedDelegateCoins, std::map<uint160, CAmount> &mDelegateWeight)
+{
+    AssertLockHeld(wallet.cs_wallet);
+
+    int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(height + 1);
+    for (const auto& [address, delegation] : wallet.m_delegations_staker)
+    {
+        auto shard = wallet.m_delegate_coins.shards.find(address);
+        if(shard == wallet.m_delegate_coins.shards.end())
+            continue;
+
+        // Set default delegate stake weight
+        CAmount& weight = mDelegateWeight[address];
+        weight = 0;
 
-            if(i->second.satoshis < staking_min_utxo_value)
+        // Get super staker custom configuration
+        CAmount staking_min_utxo_value = wallet.m_staking_min_utxo_value;
+        uint8_t staking_min_fee = wallet.m_staking_min_fee;
+        std::map<uint160, CSuperStakerInfo>::const_iterator staker = mapStakers.find(delegation.staker);
+        if(staker != mapStakers.end())
+        {
+            staking_min_utxo_value = staker->second.nMinDelegateUtxo;
+            staking_min_fee = staker->second.nMinFee;
+        }
+
+        // Check for min staking fee
+        if(delegation.fee < staking_min_fee)
+            continue;
+
+        // Add the coins that are mature and at least the minimum value
+        for (const auto& [prevout, coin] : shard->second)
+        {
+            int nDepth = height - coin.nHeight + 1;
+            if (nDepth < coinbaseMaturity || coin.nValue < staking_min_utxo_value)
                 continue;
 
-            COutPoint prevout = COutPoint(i->first.txhash, i->first.index);
             if(immatureStakes.find(prevout) == immatureStakes.end())
             {
-                vUnsortedDelegateCoins.push_back(std::make_pair(prevout, i->second.satoshis));
-                weight+= i->second.satoshis;
+                vUnsortedDelegateCoins.push_back(std::make_pair(prevout, coin.nValue));
+                weight += coin.nValue;
             }
         }
-
-        // Update delegate stake weight
-        mDelegateWeight[it->first] = weight;
     }
-
-    return true;
 }
 
 void AvailableAddress(const CWallet& wallet, const std::vector<uint256> &maturedTx, size_t from, size_t to, std::map<uint160, bool> &mapAddress, std::map<COutPoint, CScriptCache> *insertScriptCache)
@@ -649,39 +764,71 @@ void AvailableAddress(const CWallet& wallet, const std::vector<uint256> &matured
     }
 }
 
+void UpdateStakeTxIndex(const CWallet& wallet)
+{
+    AssertLockHeld(wallet.cs_wallet);
+
+    CWallet::StakeTxIndex& index = wallet.m_stake_tx_index;
+    int nTipHeight = wallet.GetLastBlockHeight();
+    int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(nTipHeight + 1);
+    if(!index.fValid || index.nCoinbaseMaturity != coinbaseMaturity)
+    {
+        // Rebuild the index from the confirmed transactions
+        index = CWallet::StakeTxIndex{};
+        index.fValid = true;
+        index.nCoinbaseMaturity = coinbaseMaturity;
+        for (auto it = wallet.mapWallet.begin(); it != wallet.mapWallet.end(); ++it)
+        {
+            const CWalletTx& wtx = it->second;
+            if (auto* conf = wtx.state<TxStateConfirmed>())
+            {
+                int maturity = coinbaseMaturity + ((wtx.IsCoinBase() || wtx.IsCoinStake()) ? 1 : 0);
+                index.pending.emplace(conf->confirmed_block_height + maturity - 1, it->first);
+            }
+        }
+    }
+
+    // Move the transactions that became mature at the tip
+    while(!index.pending.empty() && index.pending.begin()->first <= nTipHeight)
+    {
+        auto it = wallet.mapWallet.find(index.pending.begin()->second);
+        if(it != wallet.mapWallet.end())
+        {
+            const CWalletTx& wtx = it->second;
+            int nDepth = wallet.GetTxDepthInMainChain(wtx);
+            if(nDepth >= 1 && nDepth >= coinbaseMaturity && wallet.GetTxBlocksToMaturity(wtx) == 0)
+            {
+                index.matured.insert(it->first);
+            }
+        }
+        index.pending.erase(index.pending.begin());
+    }
+}
+
 bool SelectCoinsForStaking(const CWallet& wallet, CAmount &nTargetValue, std::set<std::pair<const CWalletTx *, unsigned int> > &setCoinsRet, CAmount &nValueRet)
 {
     std::vector<std::pair<const CWalletTx *, unsigned int> > vCoins;
     vCoins.clear();
 
     bool isDescriptorWallet = wallet.IsWalletFlagSet(WALLET_FLAG_DESCRIPTORS);
-    int nHeight = wallet.GetLastBlockHeight() + 1;
-    int coinbaseMaturity = Params().GetConsensus().CoinbaseMaturity(nHeight);
     std::map<COutPoint, uint32_t> immatureStakes = wallet.chain().getImmatureStakes();
     std::vector<uint256> maturedTx;
     const bool include_watch_only = wallet.GetLegacyScriptPubKeyMan() && wallet.IsWalletFlagSet(WALLET_FLAG_DISABLE_PRIVATE_KEYS);
     const isminetype is_mine_filter = include_watch_only ? ISMINE_WATCH_ONLY : ISMINE_SPENDABLE;
-    for (auto it = wallet.mapWallet.begin(); it != wallet.mapWallet.end(); ++it)
+    UpdateStakeTxIndex(wallet);
+    std::set<uint256>& matured = wallet.m_stake_tx_index.matured;
+    for (auto it = matured.begin(); it != matured.end();)
     {
-        // Check the cached data for available coins for the tx
-        const CWalletTx* pcoin = &(*it).second;
-        const CAmount tx_credit_mine{CachedTxGetAvailableCredit(wallet, *pcoin, is_mine_filter | ISMINE_NO)};
-        if(tx_credit_mine == 0)
-            continue;
-
-        const uint256& wtxid = it->first;
-        int nDepth = wallet.GetTxDepthInMainChain(*pcoin);
-
-        if (nDepth < 1)
-            continue;
-
-        if (nDepth < coinbaseMaturity)
-            continue;
-
-        if (wallet.GetTxBlocksToMaturity(*pcoin) > 0)
+        // Check the cached data for available coins for the tx, the spent transactions leave the index
+        auto wit = wallet.mapWallet.find(*it);
+        if(wit == wallet.mapWallet.end() || CachedTxGetAvailableCredit(wallet, wit->second, is_mine_filter | ISMINE_NO) == 0)
+        {
+            it = matured.erase(it);
             continue;
+        }
 
-        maturedTx.push_back(wtxid);
+        maturedTx.push_back(*it);
+        it++;
     }
 
     size_t listSize = maturedTx.size();
@@ -783,17 +930,33 @@ bool SelectDelegateCoinsForStaking(const CWallet& wallet, std::vector<COutPoint>
     }
 
     std::map<COutPoint, uint32_t> immatureStakes = wallet.chain().getImmatureStakes();
-    std::map<uint256, CSuperStakerInfo> mapStakers = wallet.mapSuperStaker;
+    // Super stakers with custom configuration by staker address
+    std::map<uint160, CSuperStakerInfo> mapStakers;
+    for (const auto& item : wallet.mapSuperStaker)
+    {
+        if(item.second.fCustomConfig)
+        {
+            mapStakers[item.second.stakerAddress] = item.second;
+        }
+    }
 
+    // Read the coins from the snapshot, or from the address index while the snapshot cannot be loaded
     std::vector<uint160> delegations;
-    for (std::map<uint160, Delegation>::const_iterator it = wallet.m_delegations_staker.begin(); it != wallet.m_delegations_staker.end(); ++it)
+    if(!LoadDelegateCoins(wallet))
     {
-        delegations.push_back(it->first);
+        for (std::map<uint160, Delegation>::const_iterator it = wallet.m_delegations_staker.begin(); it != wallet.m_delegations_staker.end(); ++it)
+        {
+            delegations.push_back(it->first);
+        }
     }
     size_t listSize = delegations.size();
     int numThreads = std::min(wallet.m_num_threads, (int)listSize);
     bool ret = true;
-    if(numThreads < 2)
+    if(listSize == 0)
+    {
+        ReadDelegateCoins(wallet, height, immatureStakes, mapStakers, vUnsortedDelegateCoins, mDelegateWeight);
+    }
+    else if(numThreads < 2)
     {
         ret = AvailableDelegateCoinsForStaking(wallet, delegations, 0, listSize, height, immatureStakes, mapStakers, vUnsortedDelegateCoins, mDelegateWeight);
     }
@@ -887,12 +1050,10 @@ void SelectAddress(const CWallet& wallet, std::map<uint160, bool> &mapAddress)
 
 void UpdateMinerStakeCache(CWallet& wallet, bool fStakeCache, const std::vector<COutPoint> &prevouts, CBlockIndex *pindexPrev )
 {
-    if(wallet.minerStakeCache.size() > prevouts.size() + 100){
-        wallet.minerStakeCache.clear();
-    }
-
     if(fStakeCache)
     {
+        // The coins that are no longer staked are dropped after a generation without being used
+        wallet.minerStakeCache.newGeneration();
         for(const COutPoint &prevoutStake : prevouts)
         {
             boost::this_thread::interruption_point();
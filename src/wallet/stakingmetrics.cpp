@@ -0,0 +1,77 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <wallet/stakingmetrics.h>
+
+#include <util/metrics.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace wallet {
+const char* StakingPhaseName(StakingPhase phase)
+{
+    switch (phase) {
+    case StakingPhase::UPDATE_DATA: return "updatedata";
+    case StakingPhase::KERNEL_SEARCH: return "kernelsearch";
+    case StakingPhase::CREATE_BLOCK: return "createblock";
+    case StakingPhase::SIGN_BLOCK: return "signblock";
+    case StakingPhase::PROCESS_BLOCK: return "processblock";
+    } // no default case, so the compiler can warn about missing cases
+    assert(false);
+}
+
+void StakingMetrics::AddTiming(StakingPhase phase, std::chrono::microseconds duration)
+{
+    size_t bucket{0};
+    for (int64_t ms = duration.count() / 1000; ms > 0 && bucket + 1 < HISTOGRAM_BUCKETS; ms >>= 1) {
+        ++bucket;
+    }
+    if (phase == StakingPhase::KERNEL_SEARCH) g_metrics.staker_kernel_search_time.Observe(duration);
+
+    LOCK(m_mutex);
+    Timing& timing = m_data.phases[static_cast<size_t>(phase)];
+    ++timing.count;
+    timing.total += duration;
+    timing.max = std::max(timing.max, duration);
+    ++timing.histogram[bucket];
+}
+
+void StakingMetrics::AddSlot(bool solved)
+{
+    g_metrics.staker_slots_searched.Inc();
+    if (solved) g_metrics.staker_slots_solved.Inc();
+    LOCK(m_mutex);
+    ++m_data.slots_searched;
+    if (solved) ++m_data.slots_solved;
+}
+
+void StakingMetrics::AddMissedSlot()
+{
+    g_metrics.staker_slots_missed.Inc();
+    LOCK(m_mutex);
+    ++m_data.slots_missed;
+}
+
+void StakingMetrics::AddSubmittedBlock(bool accepted)
+{
+    g_metrics.staker_blocks_submitted.Inc();
+    if (accepted) g_metrics.staker_blocks_accepted.Inc();
+    LOCK(m_mutex);
+    ++m_data.blocks_submitted;
+    if (accepted) ++m_data.blocks_accepted;
+}
+
+StakingMetrics::Snapshot StakingMetrics::GetSnapshot() const
+{
+    LOCK(m_mutex);
+    return m_data;
+}
+
+void StakingMetrics::Reset()
+{
+    LOCK(m_mutex);
+    m_data = Snapshot{};
+}
+} // namespace wallet
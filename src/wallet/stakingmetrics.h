@@ -0,0 +1,64 @@
+// Copyright (c) 2017-2022 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QTUM_WALLET_STAKINGMETRICS_H
+#define QTUM_WALLET_STAKINGMETRICS_H
+
+#include <sync.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace wallet {
+/** Phases of a staking slot timed by the staker */
+enum class StakingPhase {
+    UPDATE_DATA,   //!< Coin selection and stake cache update when the tip changes
+    KERNEL_SEARCH, //!< Kernel search over the staking coins for a block time
+    CREATE_BLOCK,  //!< Assembling the block, including the contract execution
+    SIGN_BLOCK,    //!< Signing the coinstake and the block, with the wallet, ledger or HWI
+    PROCESS_BLOCK, //!< Validation of the block and relay through ProcessNewBlock
+};
+static constexpr size_t STAKING_PHASE_COUNT{5};
+
+const char* StakingPhaseName(StakingPhase phase);
+
+/** Timings and slot counters of the staker of a wallet */
+class StakingMetrics
+{
+public:
+    //! Bucket i counts the durations below 2^i milliseconds, the last one the longer durations
+    static constexpr size_t HISTOGRAM_BUCKETS{16};
+
+    struct Timing {
+        uint64_t count{0};
+        std::chrono::microseconds total{0};
+        std::chrono::microseconds max{0};
+        std::array<uint64_t, HISTOGRAM_BUCKETS> histogram{};
+    };
+
+    struct Snapshot {
+        std::array<Timing, STAKING_PHASE_COUNT> phases{};
+        uint64_t slots_searched{0};   //!< Block times searched for a kernel
+        uint64_t slots_solved{0};     //!< Block times a kernel was found for
+        uint64_t slots_missed{0};     //!< Solved block times no block was submitted for
+        uint64_t blocks_submitted{0}; //!< Blocks passed to ProcessNewBlock
+        uint64_t blocks_accepted{0};  //!< Blocks ProcessNewBlock accepted
+    };
+
+    void AddTiming(StakingPhase phase, std::chrono::microseconds duration) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void AddSlot(bool solved) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void AddMissedSlot() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void AddSubmittedBlock(bool accepted) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    Snapshot GetSnapshot() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void Reset() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    mutable Mutex m_mutex;
+    Snapshot m_data GUARDED_BY(m_mutex);
+};
+} // namespace wallet
+
+#endif // QTUM_WALLET_STAKINGMETRICS_H
@@ -7,6 +7,7 @@
 #include <test/util/setup_common.h>
 #include <util/fs.h>
 #include <wallet/bdb.h>
+#include <wallet/walletdb.h>
 
 #include <fstream>
 #include <memory>
@@ -78,5 +79,40 @@ BOOST_AUTO_TEST_CASE(getwalletenv_g_dbenvs_free_instance)
     BOOST_CHECK(env_2_a == env_2_b);
 }
 
+#ifdef USE_SQLITE
+BOOST_AUTO_TEST_CASE(sqlite_group_commit)
+{
+    DatabaseOptions options;
+    options.require_format = DatabaseFormat::SQLITE;
+    std::unique_ptr<WalletDatabase> database = CreateMockWalletDatabase(options);
+    std::unique_ptr<DatabaseBatch> batch = database->MakeBatch();
+    std::unique_ptr<DatabaseBatch> other_batch = database->MakeBatch();
+
+    BOOST_CHECK(database->BeginGroupCommit());
+    BOOST_CHECK(!database->BeginGroupCommit());
+    BOOST_CHECK(batch->Write(std::string("a"), 1));
+
+    // The transactions of the batches are nested in the group, and can still be aborted
+    BOOST_CHECK(other_batch->TxnBegin());
+    BOOST_CHECK(other_batch->Write(std::string("b"), 2));
+    BOOST_CHECK(other_batch->TxnAbort());
+    BOOST_CHECK(other_batch->TxnBegin());
+    BOOST_CHECK(other_batch->Write(std::string("c"), 3));
+    BOOST_CHECK(other_batch->TxnCommit());
+    BOOST_CHECK(database->EndGroupCommit());
+    BOOST_CHECK(!database->EndGroupCommit());
+
+    int value;
+    BOOST_CHECK(batch->Read(std::string("a"), value) && value == 1);
+    BOOST_CHECK(!batch->Exists(std::string("b")));
+    BOOST_CHECK(batch->Read(std::string("c"), value) && value == 3);
+
+    // A batch transaction in progress prevents the group commit
+    BOOST_CHECK(batch->TxnBegin());
+    BOOST_CHECK(!database->BeginGroupCommit());
+    BOOST_CHECK(batch->TxnCommit());
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
 } // namespace wallet
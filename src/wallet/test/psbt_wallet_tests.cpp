@@ -70,6 +70,55 @@ BOOST_AUTO_TEST_CASE(psbt_updater_test)
     BOOST_CHECK(m_wallet.FillPSBT(psbtx, complete, SIGHASH_ALL, true, true) != TransactionError::OK);
 }
 
+BOOST_AUTO_TEST_CASE(psbt_sign_many_inputs)
+{
+    LOCK(m_wallet.cs_wallet);
+    m_wallet.SetWalletFlag(WALLET_FLAG_DESCRIPTORS);
+    import_descriptor(m_wallet, "pkh(xprv9s21ZrQH143K2LE7W4Xf3jATf9jECxSb7wj91ZnmY4qEJrS66Qru9RFqq8xbkgT32ya6HqYJweFdJUEDf5Q6JFV7jMiUws7kQfe6Tv4RbfN/0h/0h/*h)");
+    std::vector<CScript> scripts;
+    for (ScriptPubKeyMan* spk_man : m_wallet.GetAllScriptPubKeyMans()) {
+        for (const CScript& script : spk_man->GetScriptPubKeys()) {
+            scripts.push_back(script);
+        }
+    }
+    BOOST_REQUIRE(!scripts.empty());
+
+    // A previous transaction with an output to the wallet for each input
+    const unsigned int num_inputs = 200;
+    CMutableTransaction prev_tx;
+    prev_tx.vin.emplace_back();
+    for (unsigned int i = 0; i < num_inputs; ++i) {
+        prev_tx.vout.emplace_back(COIN, scripts[i % scripts.size()]);
+    }
+    CTransactionRef prev = MakeTransactionRef(prev_tx);
+    m_wallet.mapWallet.emplace(std::piecewise_construct, std::forward_as_tuple(prev->GetHash()), std::forward_as_tuple(prev, TxStateInactive{}));
+
+    CMutableTransaction tx;
+    for (unsigned int i = 0; i < num_inputs; ++i) {
+        tx.vin.emplace_back(COutPoint{prev->GetHash(), i});
+    }
+    tx.vout.emplace_back(num_inputs * COIN - COIN, scripts[0]);
+
+    // The inputs signed in parallel are all signed, and the result is the same each time
+    std::string first_hex;
+    for (int run = 0; run < 2; ++run) {
+        PartiallySignedTransaction psbtx{tx};
+        bool complete = false;
+        size_t n_signed = 0;
+        BOOST_REQUIRE_EQUAL(TransactionError::OK, m_wallet.FillPSBT(psbtx, complete, SIGHASH_ALL, true, true, &n_signed));
+        BOOST_CHECK(complete);
+        BOOST_CHECK_EQUAL(n_signed, num_inputs);
+
+        CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
+        ssTx << psbtx;
+        if (run == 0) {
+            first_hex = HexStr(ssTx);
+        } else {
+            BOOST_CHECK_EQUAL(HexStr(ssTx), first_hex);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(parse_hd_keypath)
 {
     std::vector<uint32_t> keypath;
@@ -7,6 +7,7 @@
 #include <test/util/setup_common.h>
 #include <wallet/scriptpubkeyman.h>
 #include <wallet/wallet.h>
+#include <wallet/walletdb.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -39,5 +40,33 @@ BOOST_AUTO_TEST_CASE(CanProvide)
     BOOST_CHECK(keyman.CanProvide(p2sh_script, data));
 }
 
+// Test that the descriptor ranges derived on several threads are complete, and that the wallet
+// recognizes their scripts without going through every ScriptPubKeyMan
+BOOST_AUTO_TEST_CASE(DescriptorTopUp)
+{
+    CWallet wallet(m_node.chain.get(), "", CreateMockWalletDatabase());
+    LOCK(wallet.cs_wallet);
+    wallet.SetWalletFlag(WALLET_FLAG_DESCRIPTORS);
+    wallet.SetupDescriptorScriptPubKeyMans();
+
+    for (bool internal : {false, true}) {
+        auto spkm = dynamic_cast<DescriptorScriptPubKeyMan*>(wallet.GetScriptPubKeyMan(OutputType::BECH32, internal));
+        BOOST_REQUIRE(spkm);
+        int32_t range_end = WITH_LOCK(spkm->cs_desc_man, return spkm->GetWalletDescriptor().range_end);
+        BOOST_CHECK_GT(range_end, int32_t(PARALLEL_EXPAND_MIN_INDEXES));
+
+        // One script for every index
+        const auto spks = spkm->GetScriptPubKeys();
+        BOOST_CHECK_EQUAL(spks.size(), size_t(range_end));
+        for (const CScript& script : spks) {
+            BOOST_CHECK_EQUAL(wallet.IsMine(script), ISMINE_SPENDABLE);
+        }
+    }
+
+    CKey key;
+    key.MakeNewKey(true);
+    BOOST_CHECK_EQUAL(wallet.IsMine(GetScriptForDestination(PKHash(key.GetPubKey()))), ISMINE_NO);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 } // namespace wallet
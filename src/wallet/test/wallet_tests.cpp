@@ -15,6 +15,7 @@
 #include <policy/policy.h>
 #include <rpc/server.h>
 #include <test/util/logging.h>
+#include <test/util/random.h>
 #include <test/util/setup_common.h>
 #include <util/translation.h>
 #include <validation.h>
@@ -671,6 +672,65 @@ BOOST_FIXTURE_TEST_CASE(BasicOutputTypesTest, ListCoinsTest)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(balance_cache, ListCoinsTestingSetup)
+{
+    auto check_balance = [&] {
+        for (bool avoid_reuse : {false, true}) {
+            const Balance cached = GetBalance(*wallet, /*min_depth=*/0, avoid_reuse);
+            const Balance full = ComputeBalance(*wallet, /*min_depth=*/0, avoid_reuse);
+            BOOST_CHECK_EQUAL(cached.m_mine_trusted, full.m_mine_trusted);
+            BOOST_CHECK_EQUAL(cached.m_mine_untrusted_pending, full.m_mine_untrusted_pending);
+            BOOST_CHECK_EQUAL(cached.m_mine_immature, full.m_mine_immature);
+            BOOST_CHECK_EQUAL(cached.m_mine_stake, full.m_mine_stake);
+        }
+    };
+    check_balance();
+    const CAmount initial_balance = GetBalance(*wallet).m_mine_trusted;
+    BOOST_CHECK(initial_balance > 0);
+
+    // Sending to ourselves only costs the fee, the spent coin and the new transaction are updated
+    AddTx(CRecipient{GetScriptForRawPubKey(coinbaseKey.GetPubKey()), 1 * COIN, /*fSubtractFeeFromAmount=*/false});
+    check_balance();
+    const CAmount self_balance = GetBalance(*wallet).m_mine_trusted;
+    BOOST_CHECK(self_balance < initial_balance && self_balance > initial_balance - 1 * COIN);
+
+    // Sending away costs the amount as well
+    AddTx(CRecipient{GetScriptForRawPubKey({}), 1 * COIN, /*fSubtractFeeFromAmount=*/false});
+    check_balance();
+    BOOST_CHECK(GetBalance(*wallet).m_mine_trusted < self_balance - 1 * COIN);
+
+    // Marking the whole wallet dirty rebuilds the caches
+    wallet->MarkDirty();
+    check_balance();
+}
+
+BOOST_FIXTURE_TEST_CASE(unspent_txs, ListCoinsTestingSetup)
+{
+    auto unspent_txs = [&] {
+        std::set<uint256> result;
+        for (const CWalletTx* wtx : WITH_LOCK(wallet->cs_wallet, return wallet->GetUnspentTxs())) {
+            result.insert(wtx->GetHash());
+        }
+        return result;
+    };
+    std::set<uint256> before = unspent_txs();
+    BOOST_CHECK_EQUAL(before.size(), WITH_LOCK(wallet->cs_wallet, return wallet->mapWallet.size()));
+
+    // The spent coinbase is left out once the transaction spending it is in the wallet
+    const uint256 spending = AddTx(CRecipient{GetScriptForRawPubKey({}), 1 * COIN, /*fSubtractFeeFromAmount=*/false}).GetHash();
+    std::set<uint256> after = unspent_txs();
+    BOOST_CHECK(after.count(spending));
+    for (const uint256& hash : before) {
+        BOOST_CHECK_EQUAL(after.count(hash), WITH_LOCK(wallet->cs_wallet, return wallet->HasUnspentOutputs(*wallet->GetWalletTx(hash))));
+    }
+    BOOST_CHECK(after.size() <= before.size());
+
+    // The available coins are the same as without the pruned transactions
+    CoinsResult available_coins = WITH_LOCK(wallet->cs_wallet, return AvailableCoins(*wallet));
+    wallet->MarkDirty();
+    BOOST_CHECK_EQUAL(WITH_LOCK(wallet->cs_wallet, return AvailableCoins(*wallet)).GetTotalAmount(), available_coins.GetTotalAmount());
+}
+
 BOOST_FIXTURE_TEST_CASE(wallet_disableprivkeys, TestChain100Setup)
 {
     {
@@ -959,6 +1019,8 @@ public:
     bool PeriodicFlush() override { return true; }
     void IncrementUpdateCounter() override { ++nUpdateCounter; }
     void ReloadDbEnv() override {}
+    bool BeginGroupCommit() override { return false; }
+    bool EndGroupCommit() override { return false; }
     std::string Filename() override { return "faildb"; }
     std::string Format() override { return "faildb"; }
     std::unique_ptr<DatabaseBatch> MakeBatch(bool flush_on_close = true) override { return std::make_unique<FailBatch>(m_pass); }
@@ -1025,5 +1087,53 @@ BOOST_FIXTURE_TEST_CASE(wallet_sync_tx_invalid_state_test, TestingSetup)
                           HasReason("DB error adding transaction to wallet, write failed"));
 }
 
+BOOST_FIXTURE_TEST_CASE(token_tx_index, TestingSetup)
+{
+    CWallet wallet(m_node.chain.get(), "", CreateMockWalletDatabase());
+    LOCK(wallet.cs_wallet);
+
+    // Transfers of one contract from and to a wallet address, one per block, and one of another contract
+    auto make_transfer = [](const std::string& contract, const std::string& sender, const std::string& receiver, int64_t height) {
+        CTokenTx tokenTx;
+        tokenTx.strContractAddress = contract;
+        tokenTx.strSenderAddress = sender;
+        tokenTx.strReceiverAddress = receiver;
+        tokenTx.nValue = uint256::ONE;
+        tokenTx.transactionHash = InsecureRand256();
+        tokenTx.blockNumber = height;
+        return tokenTx;
+    };
+    // The transactions are read from the database when listed
+    WalletBatch batch(wallet.GetDatabase());
+    auto load_transfer = [&](const CTokenTx& tokenTx) {
+        BOOST_CHECK(batch.WriteTokenTx(tokenTx));
+        wallet.LoadTokenTx(tokenTx);
+    };
+    for (int64_t height = 0; height < 10; ++height) {
+        load_transfer(make_transfer("contract", height % 2 ? "mine" : "other", height % 2 ? "other" : "mine", height));
+    }
+    load_transfer(make_transfer("contract2", "mine", "other", 5));
+    BOOST_CHECK(wallet.m_token_tx_cache.empty());
+
+    std::vector<CTokenTx> page = wallet.ListTokenTxs("contract", "mine", 0, 4);
+    BOOST_REQUIRE_EQUAL(page.size(), 4U);
+    for (size_t i = 0; i < page.size(); ++i) {
+        BOOST_CHECK_EQUAL(page[i].blockNumber, int64_t(9 - i));
+    }
+    page = wallet.ListTokenTxs("contract", "mine", 8, 4);
+    BOOST_REQUIRE_EQUAL(page.size(), 2U);
+    BOOST_CHECK_EQUAL(page[1].blockNumber, 0);
+    BOOST_CHECK_EQUAL(wallet.ListTokenTxs("contract2", "mine", 0, 4).size(), 1U);
+    BOOST_CHECK(wallet.ListTokenTxs("contract", "nobody", 0, 4).empty());
+    BOOST_CHECK_EQUAL(wallet.m_token_tx_cache.size(), 7U);
+
+    // A transaction missing from the database is not listed
+    CTokenTx missing = make_transfer("contract2", "mine", "other", 6);
+    wallet.LoadTokenTx(missing);
+    BOOST_CHECK_EQUAL(wallet.ListTokenTxs("contract2", "mine", 0, 4).size(), 1U);
+    CTokenTx tokenTx;
+    BOOST_CHECK(!wallet.GetTokenTx(missing.GetHash(), tokenTx));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 } // namespace wallet
@@ -7,6 +7,7 @@
 
 #include <blockfilter.h>
 #include <chain.h>
+#include <checkqueue.h>
 #include <consensus/amount.h>
 #include <consensus/consensus.h>
 #include <consensus/validation.h>
@@ -27,6 +28,7 @@
 #include <script/signingprovider.h>
 #include <support/cleanse.h>
 #include <txmempool.h>
+#include <util/allocstats.h>
 #include <util/bip32.h>
 #include <util/check.h>
 #include <util/error.h>
@@ -48,6 +50,8 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <iterator>
+#include <limits>
 #include <optional>
 
 using interfaces::FoundBlock;
@@ -283,8 +287,10 @@ public:
         }
     }
 
-    void UpdateIfNeeded()
+    //! Returns whether new scripts were added to the filter set
+    bool UpdateIfNeeded()
     {
+        bool updated{false};
         // repopulate filter with new scripts if top-up has happened since last iteration
         for (const auto& [desc_spkm_id, last_range_end] : m_last_range_ends) {
             auto desc_spkm{dynamic_cast<DescriptorScriptPubKeyMan*>(m_wallet.GetScriptPubKeyMan(desc_spkm_id))};
@@ -293,8 +299,10 @@ public:
             if (current_range_end > last_range_end) {
                 AddScriptPubKeys(desc_spkm, last_range_end);
                 m_last_range_ends.at(desc_spkm->GetID()) = current_range_end;
+                updated = true;
             }
         }
+        return updated;
     }
 
     std::optional<bool> MatchesBlock(const uint256& block_hash) const
@@ -320,6 +328,54 @@ private:
         }
     }
 };
+
+//! Number of blocks read ahead together during a rescan.
+constexpr size_t RESCAN_BLOCKS_BATCH{16};
+//! Number of blocks matched against the block filters together during a rescan, only the
+//! matching ones are then read RESCAN_BLOCKS_BATCH at a time.
+constexpr size_t RESCAN_FILTERS_BATCH{1000};
+//! Maximum number of threads reading blocks during a rescan, besides the scanning thread.
+constexpr int MAX_RESCAN_THREADS{4};
+
+/** A block of the active chain to rescan, with its position in the chain found before it is read */
+struct RescanBlock
+{
+    uint256 hash;
+    int height{0};
+    bool still_active{false};
+    bool has_next{false};
+    uint256 next_hash;
+    //! Result of the block filter, unset when there is no filter or it was not found
+    std::optional<bool> filter_match;
+    CBlock data;
+};
+
+/** Matches a block against the block filter, and reads it unless the filter ruled it out.
+ *  The blocks are then applied to the wallet in height order on the scanning thread. */
+class RescanBlockRead
+{
+private:
+    interfaces::Chain* chain{nullptr};
+    const FastWalletRescanFilter* filter{nullptr};
+    RescanBlock* block{nullptr};
+    bool read{true};
+
+public:
+    RescanBlockRead() = default;
+    RescanBlockRead(interfaces::Chain* chain_, const FastWalletRescanFilter* filter_, RescanBlock* block_, bool read_ = true) :
+        chain(chain_), filter(filter_), block(block_), read(read_) {}
+
+    bool operator()()
+    {
+        if (filter) {
+            block->filter_match = filter->MatchesBlock(block->hash);
+        }
+        if (read && block->filter_match != false) {
+            chain->findBlock(block->hash, FoundBlock().data(block->data));
+        }
+        return true;
+    }
+};
 } // namespace
 
 std::shared_ptr<CWallet> LoadWallet(WalletContext& context, const std::string& name, std::optional<bool> load_on_start, const DatabaseOptions& options, DatabaseStatus& status, bilingual_str& error, std::vector<bilingual_str>& warnings)
@@ -492,6 +548,40 @@ const CWalletTx* CWallet::GetWalletTx(const uint256& hash) const
     return &(it->second);
 }
 
+bool CWallet::HasUnspentOutputs(const CWalletTx& wtx) const
+{
+    AssertLockHeld(cs_wallet);
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        if (!IsSpent(COutPoint(wtx.GetHash(), i)) && IsMine(wtx.tx->vout[i]) != ISMINE_NO) return true;
+    }
+    return false;
+}
+
+std::vector<const CWalletTx*> CWallet::GetUnspentTxs() const
+{
+    AssertLockHeld(cs_wallet);
+    if (!m_unspent_txs_initialized) {
+        m_unspent_txs.clear();
+        for (const auto& entry : mapWallet) {
+            m_unspent_txs.insert(entry.first);
+        }
+        m_unspent_txs_initialized = true;
+    }
+
+    std::vector<const CWalletTx*> result;
+    result.reserve(m_unspent_txs.size());
+    for (auto it = m_unspent_txs.begin(); it != m_unspent_txs.end();) {
+        const CWalletTx* wtx = GetWalletTx(*it);
+        if (!wtx || !HasUnspentOutputs(*wtx)) {
+            it = m_unspent_txs.erase(it);
+            continue;
+        }
+        result.push_back(wtx);
+        ++it;
+    }
+    return result;
+}
+
 void CWallet::UpgradeKeyMetadata()
 {
     if (IsLocked() || IsWalletFlagSet(WALLET_FLAG_KEY_ORIGIN_METADATA)) {
@@ -954,7 +1044,23 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         for (std::pair<const uint256, CWalletTx>& item : mapWallet)
             item.second.MarkDirty();
+        for (BalanceCache& cache : m_balance_cache) {
+            cache.initialized = false;
+        }
+        m_unspent_txs_initialized = false;
+        MarkStakeWeightDirty();
+        MarkStakeTxIndexDirty();
+    }
+}
+
+void CWallet::MarkTxDirty(CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet);
+    wtx.MarkDirty();
+    for (BalanceCache& cache : m_balance_cache) {
+        if (cache.initialized) cache.dirty_txs.insert(wtx.GetHash());
     }
+    if (m_unspent_txs_initialized) m_unspent_txs.insert(wtx.GetHash());
 }
 
 bool CWallet::MarkReplaced(const uint256& originalHash, const uint256& newHash)
@@ -1042,9 +1148,13 @@ bool CWallet::IsSpentKey(const CScript& scriptPubKey) const
 CWalletTx* CWallet::AddToWallet(CTransactionRef tx, const TxState& state, const UpdateWalletTxFn& update_wtx, bool fFlushOnClose, bool rescanning_old_block)
 {
     LOCK(cs_wallet);
+    MarkStakeWeightDirty();
 
     WalletBatch batch(GetDatabase(), fFlushOnClose);
 
+    // The wallet keeps the transactions of connected blocks, which must not pin the arena chunks of the block
+    tx = UnshareArenaScripts(tx);
+
     uint256 hash = tx->GetHash();
 
     if (IsWalletFlagSet(WALLET_FLAG_AVOID_REUSE)) {
@@ -1063,6 +1173,7 @@ CWalletTx* CWallet::AddToWallet(CTransactionRef tx, const TxState& state, const
     auto ret = mapWallet.emplace(std::piecewise_construct, std::forward_as_tuple(hash), std::forward_as_tuple(tx, state));
     CWalletTx& wtx = (*ret.first).second;
     bool fInsertedNew = ret.second;
+    bool fWasConfirmed = !fInsertedNew && wtx.isConfirmed();
     bool fUpdated = update_wtx && update_wtx(wtx, fInsertedNew);
     if (fInsertedNew) {
         wtx.nTimeReceived = GetTime();
@@ -1096,6 +1207,16 @@ CWalletTx* CWallet::AddToWallet(CTransactionRef tx, const TxState& state, const
         }
     }
 
+    // Confirmed transactions wait in the stake index until they are mature
+    if (auto* conf = wtx.state<TxStateConfirmed>()) {
+        if (m_stake_tx_index.fValid) {
+            int maturity = m_stake_tx_index.nCoinbaseMaturity + ((wtx.IsCoinBase() || wtx.IsCoinStake()) ? 1 : 0);
+            m_stake_tx_index.pending.emplace(conf->confirmed_block_height + maturity - 1, hash);
+        }
+    } else if (fWasConfirmed) {
+        MarkStakeTxIndexDirty();
+    }
+
     // Mark inactive coinbase transactions and their descendants as abandoned
     if (wtx.IsCoinBase() && wtx.isInactive()) {
         std::vector<CWalletTx*> txs{&wtx};
@@ -1107,7 +1228,7 @@ CWalletTx* CWallet::AddToWallet(CTransactionRef tx, const TxState& state, const
             txs.pop_back();
             desc_tx->m_state = inactive_state;
             // Break caches since we have changed the state
-            desc_tx->MarkDirty();
+            MarkTxDirty(*desc_tx);
             batch.WriteTx(*desc_tx);
             MarkInputsDirty(desc_tx->tx);
             for (unsigned int i = 0; i < desc_tx->tx->vout.size(); ++i) {
@@ -1159,7 +1280,7 @@ CWalletTx* CWallet::AddToWallet(CTransactionRef tx, const TxState& state, const
             return nullptr;
 
     // Break debit/credit balance caches:
-    wtx.MarkDirty();
+    MarkTxDirty(wtx);
 
     // Notify UI of new or updated transaction
     NotifyTransactionChanged(hash, fInsertedNew ? CT_NEW : CT_UPDATED);
@@ -1315,10 +1436,12 @@ bool CWallet::TransactionCanBeAbandoned(const uint256& hashTx) const
 
 void CWallet::MarkInputsDirty(const CTransactionRef& tx)
 {
+    MarkStakeWeightDirty();
+    MarkStakeTxIndexDirty();
     for (const CTxIn& txin : tx->vin) {
         auto it = mapWallet.find(txin.prevout.hash);
         if (it != mapWallet.end()) {
-            it->second.MarkDirty();
+            MarkTxDirty(it->second);
         }
     }
 }
@@ -1357,7 +1480,7 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             // If the orig tx was not in block/mempool, none of its spends can be in mempool
             assert(!wtx.InMempool());
             wtx.m_state = TxStateInactive{/*abandoned=*/true};
-            wtx.MarkDirty();
+            MarkTxDirty(wtx);
             batch.WriteTx(wtx);
             NotifyTransactionChanged(wtx.GetHash(), CT_UPDATED);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them abandoned too.
@@ -1417,7 +1540,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, int conflicting_height, c
             // Block is 'more conflicted' than current confirm; update.
             // Mark transaction as conflicted with this block.
             wtx.m_state = TxStateConflicted{hashBlock, conflicting_height};
-            wtx.MarkDirty();
+            MarkTxDirty(wtx);
             batch.WriteTx(wtx);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them conflicted too
             for (unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
@@ -1460,6 +1583,7 @@ void CWallet::SyncTransaction(const CTransactionRef& ptx, const SyncTxState& sta
 
 void CWallet::transactionAddedToMempool(const CTransactionRef& tx) {
     LOCK(cs_wallet);
+    MarkStakeWeightDirty();
     SyncTransaction(tx, TxStateInMempool{});
 
     auto it = mapWallet.find(tx->GetHash());
@@ -1470,6 +1594,7 @@ void CWallet::transactionAddedToMempool(const CTransactionRef& tx) {
 
 void CWallet::transactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason) {
     LOCK(cs_wallet);
+    MarkStakeWeightDirty();
     auto it = mapWallet.find(tx->GetHash());
     if (it != mapWallet.end()) {
         RefreshMempoolStatus(it->second, chain());
@@ -1507,9 +1632,15 @@ void CWallet::transactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRe
 
 void CWallet::blockConnected(const interfaces::BlockInfo& block)
 {
+    AllocScope alloc_scope{AllocTag::WALLET};
     assert(block.data);
     LOCK(cs_wallet);
+    // Commit the transactions and token transfers of the block together
+    DatabaseGroupCommit group_commit(GetDatabase());
 
+    // The depth of the coins changes, so coins may become mature for staking
+    MarkStakeWeightDirty();
+    SyncDelegateCoins(block);
     bool hasDelegation = block.data->HasProofOfDelegation();
     m_last_block_processed_height = block.height;
     m_last_block_processed = block.hash;
@@ -1517,6 +1648,34 @@ void CWallet::blockConnected(const interfaces::BlockInfo& block)
         SyncTransaction(block.data->vtx[index], TxStateConfirmed{block.hash, block.height, static_cast<int>(index), hasDelegation});
         transactionRemovedFromMempool(block.data->vtx[index], MemPoolRemovalReason::BLOCK);
     }
+    if (!mapToken.empty()) SyncTokenTransfers(block);
+}
+
+void CWallet::SyncTokenTransfers(const interfaces::BlockInfo& block)
+{
+    AssertLockHeld(cs_wallet);
+
+    for (const interfaces::TokenTransfer& transfer : chain().getTokenTransfers(*block.data, block.hash, block.height)) {
+        CTokenTx tokenTx;
+        tokenTx.strContractAddress = HexStr(transfer.contract_address);
+        tokenTx.strSenderAddress = EncodeDestination(PKHash(transfer.sender));
+        if (!transfer.burn) tokenTx.strReceiverAddress = EncodeDestination(PKHash(transfer.receiver));
+        tokenTx.nValue = transfer.value;
+        tokenTx.transactionHash = transfer.txid;
+        tokenTx.blockHash = block.hash;
+        tokenTx.blockNumber = block.height;
+        if (IsTokenTxMine(tokenTx)) AddTokenTxEntry(tokenTx, false);
+    }
+
+    // The GUI searches the logs of a token once, from the block it was synced up to, the tokens
+    // synced up to the previous block are now synced up to this one
+    WalletBatch batch(GetDatabase(), false);
+    for (auto& [hash, token] : mapToken) {
+        if (token.blockNumber != block.height - 1 || !block.prev_hash || token.blockHash != *block.prev_hash) continue;
+        token.blockHash = block.hash;
+        token.blockNumber = block.height;
+        batch.WriteToken(token);
+    }
 }
 
 void CWallet::blockDisconnected(const interfaces::BlockInfo& block)
@@ -1528,6 +1687,9 @@ void CWallet::blockDisconnected(const interfaces::BlockInfo& block)
     // be unconfirmed, whether or not the transaction is added back to the mempool.
     // User may have to call abandontransaction again. It may be addressed in the
     // future with a stickier abandoned state or even removing abandontransaction call.
+    MarkStakeWeightDirty();
+    MarkStakeTxIndexDirty();
+    MarkDelegateCoinsDirty();
     m_last_block_processed_height = block.height - 1;
     m_last_block_processed = *Assert(block.prev_hash);
     for (const CTransactionRef& ptx : Assert(block.data)->vtx) {
@@ -1581,6 +1743,11 @@ isminetype CWallet::IsMine(const CTxDestination& dest) const
 
 isminetype CWallet::IsMine(const CScript& script) const
 {
+    // Descriptor wallets only own the scripts of their descriptors
+    if (IsWalletFlagSet(WALLET_FLAG_DESCRIPTORS) && WITH_LOCK(m_cached_spks_mutex, return m_cached_spks.count(script) == 0)) {
+        return ISMINE_NO;
+    }
+
     isminetype result = ISMINE_NO;
     for (const auto& spk_man_pair : m_spk_managers) {
         result = std::max(result, spk_man_pair.second->IsMine(script));
@@ -1923,6 +2090,10 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
     WalletLogPrintf("Rescan started from block %s... (%s)\n", start_block.ToString(),
                     fast_rescan_filter ? "fast variant using block filters" : "slow variant inspecting all blocks");
 
+    // Blocks are read and matched against the block filters ahead of the scan on worker threads
+    CCheckQueue<RescanBlockRead> read_queue(1);
+    read_queue.StartWorkerThreads(std::clamp(GetNumCores() - 1, 0, MAX_RESCAN_THREADS), "rescan", SyscallSandboxPolicy::INITIALIZATION_LOAD_BLOCKS);
+
     fAbortRescan = false;
     ShowProgress(strprintf("%s " + _("Rescanning…").translated, GetDisplayName()), 0); // show rescan progress in GUI as dialog or on splashscreen, if rescan required on startup (e.g. due to corruption)
     uint256 tip_hash = WITH_LOCK(cs_wallet, return GetLastBlockHash());
@@ -1932,107 +2103,158 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
     double progress_end = chain().guessVerificationProgress(end_hash);
     double progress_current = progress_begin;
     int block_height = start_height;
-    while (!fAbortRescan && !chain().shutdownRequested()) {
-        if (progress_end - progress_begin > 0.0) {
-            m_scanning_progress = (progress_current - progress_begin) / (progress_end - progress_begin);
-        } else { // avoid divide-by-zero for single block scan range (i.e. start and stop hashes are equal)
-            m_scanning_progress = 0;
-        }
-        if (block_height % 100 == 0 && progress_end - progress_begin > 0.0) {
-            ShowProgress(strprintf("%s " + _("Rescanning…").translated, GetDisplayName()), std::max(1, std::min(99, (int)(m_scanning_progress * 100))));
-        }
-
-        bool next_interval = reserver.now() >= current_time + INTERVAL_TIME;
-        if (next_interval) {
-            current_time = reserver.now();
-            WalletLogPrintf("Still rescanning. At block %d. Progress=%f\n", block_height, progress_current);
-        }
-
-        bool fetch_block{true};
+    bool done = false;
+    while (!done && !fAbortRescan && !chain().shutdownRequested()) {
+        // Find the next blocks separately from reading their data below, because reading
+        // is slow and there might be a reorg while they are read. With block filters, a
+        // longer range is matched at once, since only the matching blocks are read.
+        std::vector<RescanBlock> blocks(fast_rescan_filter ? RESCAN_FILTERS_BATCH : RESCAN_BLOCKS_BATCH);
+        size_t num_blocks = 0;
+        for (uint256 hash = block_hash; num_blocks < blocks.size();) {
+            RescanBlock& block = blocks[num_blocks++];
+            block.hash = hash;
+            block.height = block_height + static_cast<int>(num_blocks) - 1;
+            chain().findBlock(hash, FoundBlock().inActiveChain(block.still_active).nextBlock(FoundBlock().inActiveChain(block.has_next).hash(block.next_hash)));
+            if ((max_height && block.height >= *max_height) || !block.has_next) break;
+            hash = block.next_hash;
+        }
+        blocks.resize(num_blocks);
+
+        const auto run_reads = [&](std::vector<RescanBlockRead>&& reads) {
+            if (reads.size() > 1 && read_queue.HasThreads()) {
+                CCheckQueueControl<RescanBlockRead> control(&read_queue);
+                control.Add(std::move(reads));
+                control.Wait();
+            } else {
+                for (RescanBlockRead& read : reads) read();
+            }
+        };
         if (fast_rescan_filter) {
             fast_rescan_filter->UpdateIfNeeded();
-            auto matches_block{fast_rescan_filter->MatchesBlock(block_hash)};
-            if (matches_block.has_value()) {
-                if (*matches_block) {
-                    LogPrint(BCLog::SCAN, "Fast rescan: inspect block %d [%s] (filter matched)\n", block_height, block_hash.ToString());
-                } else {
-                    result.last_scanned_block = block_hash;
-                    result.last_scanned_height = block_height;
-                    fetch_block = false;
-                }
-            } else {
-                LogPrint(BCLog::SCAN, "Fast rescan: inspect block %d [%s] (WARNING: block filter not found!)\n", block_height, block_hash.ToString());
+            std::vector<RescanBlockRead> matches;
+            for (RescanBlock& block : blocks) {
+                matches.emplace_back(&chain(), fast_rescan_filter.get(), &block, /*read_=*/false);
             }
+            run_reads(std::move(matches));
         }
 
-        // Find next block separately from reading data above, because reading
-        // is slow and there might be a reorg while it is read.
-        bool block_still_active = false;
-        bool next_block = false;
-        uint256 next_block_hash;
-        chain().findBlock(block_hash, FoundBlock().inActiveChain(block_still_active).nextBlock(FoundBlock().inActiveChain(next_block).hash(next_block_hash)));
-
-        if (fetch_block) {
-            // Read block data
-            CBlock block;
-            chain().findBlock(block_hash, FoundBlock().data(block));
-
-            if (!block.IsNull()) {
-                LOCK(cs_wallet);
-                if (!block_still_active) {
-                    // Abort scan if current block is no longer active, to prevent
-                    // marking transactions as coming from the wrong block.
-                    result.last_failed_block = block_hash;
-                    result.status = ScanResult::FAILURE;
-                    break;
+        bool filter_updated = false;
+        for (size_t batch_begin = 0; batch_begin < blocks.size() && !done && !fAbortRescan && !chain().shutdownRequested(); batch_begin += RESCAN_BLOCKS_BATCH) {
+            const auto batch{Span{blocks}.subspan(batch_begin, std::min(RESCAN_BLOCKS_BATCH, blocks.size() - batch_begin))};
+            std::vector<RescanBlockRead> reads;
+            for (RescanBlock& block : batch) {
+                if (block.filter_match != false) reads.emplace_back(&chain(), nullptr, &block);
+            }
+            run_reads(std::move(reads));
+
+            // Apply the blocks to the wallet in height order, their writes are committed together
+            DatabaseGroupCommit group_commit(GetDatabase());
+            for (RescanBlock& block : batch) {
+                if (fAbortRescan || chain().shutdownRequested()) break;
+                assert(block.hash == block_hash && block.height == block_height);
+
+                if (progress_end - progress_begin > 0.0) {
+                    m_scanning_progress = (progress_current - progress_begin) / (progress_end - progress_begin);
+                } else { // avoid divide-by-zero for single block scan range (i.e. start and stop hashes are equal)
+                    m_scanning_progress = 0;
                 }
-                bool hasDelegation = block.HasProofOfDelegation();
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    SyncTransaction(block.vtx[posInBlock], TxStateConfirmed{block_hash, block_height, static_cast<int>(posInBlock), hasDelegation}, fUpdate, /*rescanning_old_block=*/true);
+                if (block_height % 100 == 0 && progress_end - progress_begin > 0.0) {
+                    ShowProgress(strprintf("%s " + _("Rescanning…").translated, GetDisplayName()), std::max(1, std::min(99, (int)(m_scanning_progress * 100))));
                 }
-                // scan succeeded, record block as most recent successfully scanned
-                result.last_scanned_block = block_hash;
-                result.last_scanned_height = block_height;
 
-                if (save_progress && next_interval) {
-                    CBlockLocator loc = m_chain->getActiveChainLocator(block_hash);
+                bool next_interval = reserver.now() >= current_time + INTERVAL_TIME;
+                if (next_interval) {
+                    current_time = reserver.now();
+                    WalletLogPrintf("Still rescanning. At block %d. Progress=%f\n", block_height, progress_current);
+                }
 
-                    if (!loc.IsNull()) {
-                        WalletLogPrintf("Saving scan progress %d.\n", block_height);
-                        WalletBatch batch(GetDatabase());
-                        batch.WriteBestBlock(loc);
+                bool fetch_block{true};
+                if (fast_rescan_filter) {
+                    // the blocks were matched before the scripts derived by the blocks applied
+                    // since, match again the ones the filter ruled out
+                    if (fast_rescan_filter->UpdateIfNeeded()) filter_updated = true;
+                    if (filter_updated && block.filter_match == false) {
+                        block.filter_match = fast_rescan_filter->MatchesBlock(block_hash);
+                        if (block.filter_match != false) chain().findBlock(block_hash, FoundBlock().data(block.data));
+                    }
+                    if (block.filter_match.has_value()) {
+                        if (*block.filter_match) {
+                            LogPrint(BCLog::SCAN, "Fast rescan: inspect block %d [%s] (filter matched)\n", block_height, block_hash.ToString());
+                        } else {
+                            result.last_scanned_block = block_hash;
+                            result.last_scanned_height = block_height;
+                            fetch_block = false;
+                        }
+                    } else {
+                        LogPrint(BCLog::SCAN, "Fast rescan: inspect block %d [%s] (WARNING: block filter not found!)\n", block_height, block_hash.ToString());
                     }
                 }
-            } else {
-                // could not scan block, keep scanning but record this block as the most recent failure
-                result.last_failed_block = block_hash;
-                result.status = ScanResult::FAILURE;
-            }
-        }
-        if (max_height && block_height >= *max_height) {
-            break;
-        }
-        {
-            if (!next_block) {
-                // break successfully when rescan has reached the tip, or
-                // previous block is no longer on the chain due to a reorg
-                break;
-            }
 
-            // increment block and verification progress
-            block_hash = next_block_hash;
-            ++block_height;
-            progress_current = chain().guessVerificationProgress(block_hash);
-
-            // handle updated tip hash
-            const uint256 prev_tip_hash = tip_hash;
-            tip_hash = WITH_LOCK(cs_wallet, return GetLastBlockHash());
-            if (!max_height && prev_tip_hash != tip_hash) {
-                // in case the tip has changed, update progress max
-                progress_end = chain().guessVerificationProgress(tip_hash);
+                if (fetch_block) {
+                    if (!block.data.IsNull()) {
+                        LOCK(cs_wallet);
+                        if (!block.still_active) {
+                            // Abort scan if current block is no longer active, to prevent
+                            // marking transactions as coming from the wrong block.
+                            result.last_failed_block = block_hash;
+                            result.status = ScanResult::FAILURE;
+                            done = true;
+                            break;
+                        }
+                        bool hasDelegation = block.data.HasProofOfDelegation();
+                        for (size_t posInBlock = 0; posInBlock < block.data.vtx.size(); ++posInBlock) {
+                            SyncTransaction(block.data.vtx[posInBlock], TxStateConfirmed{block_hash, block_height, static_cast<int>(posInBlock), hasDelegation}, fUpdate, /*rescanning_old_block=*/true);
+                        }
+                        // scan succeeded, record block as most recent successfully scanned
+                        result.last_scanned_block = block_hash;
+                        result.last_scanned_height = block_height;
+
+                        if (save_progress && next_interval) {
+                            CBlockLocator loc = m_chain->getActiveChainLocator(block_hash);
+
+                            if (!loc.IsNull()) {
+                                WalletLogPrintf("Saving scan progress %d.\n", block_height);
+                                WalletBatch batch(GetDatabase());
+                                batch.WriteBestBlock(loc);
+                            }
+                        }
+                    } else {
+                        // could not scan block, keep scanning but record this block as the most recent failure
+                        result.last_failed_block = block_hash;
+                        result.status = ScanResult::FAILURE;
+                    }
+                    // the transactions of the block are in the wallet now
+                    block.data.SetNull();
+                }
+                if (max_height && block_height >= *max_height) {
+                    done = true;
+                    break;
+                }
+                {
+                    if (!block.has_next) {
+                        // break successfully when rescan has reached the tip, or
+                        // previous block is no longer on the chain due to a reorg
+                        done = true;
+                        break;
+                    }
+
+                    // increment block and verification progress
+                    block_hash = block.next_hash;
+                    ++block_height;
+                    progress_current = chain().guessVerificationProgress(block_hash);
+
+                    // handle updated tip hash
+                    const uint256 prev_tip_hash = tip_hash;
+                    tip_hash = WITH_LOCK(cs_wallet, return GetLastBlockHash());
+                    if (!max_height && prev_tip_hash != tip_hash) {
+                        // in case the tip has changed, update progress max
+                        progress_end = chain().guessVerificationProgress(tip_hash);
+                    }
+                }
             }
         }
     }
+    read_queue.StopWorkerThreads();
     if (!max_height) {
         WalletLogPrintf("Scanning current mempool transactions.\n");
         WITH_LOCK(cs_wallet, chain().requestMempoolTransactions(*this));
@@ -2552,7 +2774,7 @@ void CWallet::CommitTransaction(CTransactionRef tx, mapValue_t mapValue, std::ve
     // Notify that old coins are spent
     for (const CTxIn& txin : tx->vin) {
         CWalletTx &coin = mapWallet.at(txin.prevout.hash);
-        coin.MarkDirty();
+        MarkTxDirty(coin);
         NotifyTransactionChanged(coin.GetHash(), CT_UPDATED);
     }
 
@@ -2572,11 +2794,84 @@ uint64_t CWallet::GetStakeWeight(uint64_t* pStakerWeight, uint64_t* pDelegateWei
 {
     if(HaveChain())
     {
-        return chain().getStakeWeight(*this, pStakerWeight, pDelegateWeight);
+        // The weight is only recomputed after the wallet was marked dirty, polling it is cheap
+        LOCK(cs_wallet);
+        if(!m_stake_weight)
+        {
+            StakeWeight weight;
+            weight.nWeight = chain().getStakeWeight(*this, &weight.nStakerWeight, &weight.nDelegateWeight);
+            m_stake_weight = weight;
+        }
+        if(pStakerWeight) *pStakerWeight = m_stake_weight->nStakerWeight;
+        if(pDelegateWeight) *pDelegateWeight = m_stake_weight->nDelegateWeight;
+        return m_stake_weight->nWeight;
     }
     return 0;
 }
 
+void CWallet::MarkStakeWeightDirty()
+{
+    LOCK(cs_wallet);
+    m_stake_weight.reset();
+}
+
+void CWallet::MarkStakeTxIndexDirty()
+{
+    LOCK(cs_wallet);
+    m_stake_tx_index.fValid = false;
+}
+
+void CWallet::MarkDelegateCoinsDirty()
+{
+    LOCK(cs_wallet);
+    m_delegate_coins = DelegateCoinsSnapshot{};
+}
+
+void CWallet::SyncDelegateCoins(const interfaces::BlockInfo& block)
+{
+    AssertLockHeld(cs_wallet);
+
+    DelegateCoinsSnapshot& snapshot = m_delegate_coins;
+    if(!snapshot.fValid)
+        return;
+
+    if(!block.prev_hash || *block.prev_hash != snapshot.hashBlock)
+    {
+        snapshot = DelegateCoinsSnapshot{};
+        return;
+    }
+
+    // The outputs are indexed the way the address index does, an output spent in its own block is then erased
+    for(const CTransactionRef& tx : block.data->vtx)
+    {
+        if(!tx->IsCoinBase())
+        {
+            for(const CTxIn& txin : tx->vin)
+            {
+                auto it = snapshot.delegates.find(txin.prevout);
+                if(it == snapshot.delegates.end()) continue;
+                snapshot.shards[it->second].erase(txin.prevout);
+                snapshot.delegates.erase(it);
+            }
+        }
+
+        const uint256& txid = tx->GetHash();
+        for(size_t i = 0; i < tx->vout.size(); i++)
+        {
+            COutPoint prevout(txid, i);
+            CTxDestination dest;
+            if(!ExtractDestination(prevout, tx->vout[i].scriptPubKey, dest)) continue;
+            const PKHash* keyid = std::get_if<PKHash>(&dest);
+            if(!keyid) continue;
+            auto shard = snapshot.shards.find(uint160(*keyid));
+            if(shard == snapshot.shards.end()) continue;
+            shard->second[prevout] = DelegateCoin{tx->vout[i].nValue, block.height};
+            snapshot.delegates[prevout] = shard->first;
+        }
+    }
+    snapshot.hashBlock = block.hash;
+}
+
 bool CWallet::GetDelegationStaker(const uint160& keyid, Delegation& delegation)
 {
     std::map<uint160, Delegation>::iterator it = m_delegations_staker.find(keyid);
@@ -2835,7 +3130,7 @@ void CWallet::MarkDestinationsDirty(const std::set<CTxDestination>& destinations
         for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
             CTxDestination dst;
             if (ExtractDestination(wtx.tx->vout[i].scriptPubKey, dst) && destinations.count(dst)) {
-                wtx.MarkDirty();
+                MarkTxDirty(wtx);
                 break;
             }
         }
@@ -2898,11 +3193,11 @@ void CWallet::DisableTransaction(const CTransaction &tx)
             auto it = mapWallet.find(txin.prevout.hash);
             if (it != mapWallet.end()) {
                 CWalletTx &coin = it->second;
-                coin.MarkDirty();
+                MarkTxDirty(coin);
                 NotifyTransactionChanged(coin.GetHash(), CT_UPDATED);
             }
         }
-        wtx.MarkDirty();
+        MarkTxDirty(wtx);
         NotifyTransactionChanged(hash, CT_DELETED);
     }
 }
@@ -2960,6 +3255,7 @@ bool CWallet::LockCoin(const COutPoint& output, WalletBatch* batch)
 {
     AssertLockHeld(cs_wallet);
     setLockedCoins.insert(output);
+    MarkStakeWeightDirty();
     if (batch) {
         return batch->WriteLockedUTXO(output);
     }
@@ -2970,6 +3266,7 @@ bool CWallet::UnlockCoin(const COutPoint& output, WalletBatch* batch)
 {
     AssertLockHeld(cs_wallet);
     bool was_locked = setLockedCoins.erase(output);
+    MarkStakeWeightDirty();
     if (batch && was_locked) {
         return batch->EraseLockedUTXO(output);
     }
@@ -2985,6 +3282,7 @@ bool CWallet::UnlockAllCoins()
         success &= batch.EraseLockedUTXO(*it);
     }
     setLockedCoins.clear();
+    MarkStakeWeightDirty();
     return success;
 }
 
@@ -3461,6 +3759,7 @@ std::shared_ptr<CWallet> CWallet::Create(WalletContext& context, const std::stri
     walletInstance->m_confirm_target = args.GetIntArg("-txconfirmtarget", DEFAULT_TX_CONFIRM_TARGET);
     walletInstance->m_spend_zero_conf_change = args.GetBoolArg("-spendzeroconfchange", DEFAULT_SPEND_ZEROCONF_CHANGE);
     walletInstance->m_signal_rbf = args.GetBoolArg("-walletrbf", DEFAULT_WALLET_RBF);
+    walletInstance->m_check_balance = args.GetBoolArg("-checkwalletbalance", DEFAULT_CHECK_WALLET_BALANCE);
     std::optional<CAmount> reserve_balance = ParseMoney(gArgs.GetArg("-reservebalance", FormatMoney(DEFAULT_RESERVE_BALANCE)));
     walletInstance->m_reserve_balance = reserve_balance.value_or(DEFAULT_RESERVE_BALANCE);
     walletInstance->m_use_change_address = gArgs.GetBoolArg("-usechangeaddress", DEFAULT_USE_CHANGE_ADDRESS);
@@ -3699,13 +3998,101 @@ bool CWallet::LoadToken(const CTokenInfo &token)
 }
 
 bool CWallet::LoadTokenTx(const CTokenTx &tokenTx)
+{
+    // The transaction is read again from the database when needed
+    m_token_txs.insert(tokenTx.GetHash());
+    IndexTokenTx(tokenTx);
+
+    return true;
+}
+
+void CWallet::IndexTokenTx(const CTokenTx &tokenTx, bool fErase)
 {
     uint256 hash = tokenTx.GetHash();
-    mapTokenTx[hash] = tokenTx;
+    for(const std::string& address : {tokenTx.strSenderAddress, tokenTx.strReceiverAddress})
+    {
+        TokenTxIndexKey key{tokenTx.strContractAddress, address, tokenTx.blockNumber, hash};
+        if(fErase)
+            m_token_tx_index.erase(key);
+        else
+            m_token_tx_index.insert(key);
+    }
+}
+
+bool CWallet::GetTokenTx(const uint256& hash, CTokenTx& tokenTx) const
+{
+    AssertLockHeld(cs_wallet);
+    if(!m_token_txs.count(hash))
+        return false;
 
+    auto it = m_token_tx_cache.find(hash);
+    if(it != m_token_tx_cache.end())
+    {
+        m_token_tx_order.splice(m_token_tx_order.begin(), m_token_tx_order, it->second.second);
+        tokenTx = it->second.first;
+        return true;
+    }
+
+    WalletBatch batch(GetDatabase());
+    if(!batch.ReadTokenTx(hash, tokenTx))
+    {
+        WalletLogPrintf("Failed to read the token transaction %s\n", hash.ToString());
+        return false;
+    }
+    CacheTokenTx(hash, tokenTx);
     return true;
 }
 
+void CWallet::CacheTokenTx(const uint256& hash, const CTokenTx& tokenTx) const
+{
+    AssertLockHeld(cs_wallet);
+    UncacheTokenTx(hash);
+    m_token_tx_order.push_front(hash);
+    m_token_tx_cache.emplace(hash, std::make_pair(tokenTx, m_token_tx_order.begin()));
+    while(m_token_tx_cache.size() > TOKEN_TX_CACHE_SIZE)
+    {
+        UncacheTokenTx(m_token_tx_order.back());
+    }
+}
+
+void CWallet::UncacheTokenTx(const uint256& hash) const
+{
+    AssertLockHeld(cs_wallet);
+    auto it = m_token_tx_cache.find(hash);
+    if(it == m_token_tx_cache.end())
+        return;
+
+    m_token_tx_order.erase(it->second.second);
+    m_token_tx_cache.erase(it);
+}
+
+std::pair<std::set<CWallet::TokenTxIndexKey>::const_iterator, std::set<CWallet::TokenTxIndexKey>::const_iterator> CWallet::TokenTxIndexRange(const std::string& contractAddress, const std::string& address) const
+{
+    uint256 maxHash;
+    std::fill(maxHash.begin(), maxHash.end(), 0xff);
+    return {m_token_tx_index.lower_bound(TokenTxIndexKey{contractAddress, address, std::numeric_limits<int64_t>::min(), uint256()}),
+            m_token_tx_index.upper_bound(TokenTxIndexKey{contractAddress, address, std::numeric_limits<int64_t>::max(), maxHash})};
+}
+
+std::vector<CTokenTx> CWallet::ListTokenTxs(const std::string& contractAddress, const std::string& address, size_t offset, size_t count) const
+{
+    LOCK(cs_wallet);
+
+    std::vector<CTokenTx> result;
+    auto [begin, end] = TokenTxIndexRange(contractAddress, address);
+    for(auto it = std::make_reverse_iterator(end); it != std::make_reverse_iterator(begin) && result.size() < count; it++)
+    {
+        if(offset > 0)
+        {
+            offset--;
+            continue;
+        }
+        CTokenTx tokenTx;
+        if(GetTokenTx(std::get<3>(*it), tokenTx)) result.push_back(tokenTx);
+    }
+    return result;
+}
+
 bool CWallet::AddTokenEntry(const CTokenInfo &token, bool fFlushOnClose)
 {
     LOCK(cs_wallet);
@@ -3743,10 +4130,10 @@ bool CWallet::AddTokenEntry(const CTokenInfo &token, bool fFlushOnClose)
     // Refresh token tx
     if(fInsertedNew)
     {
-        for(auto it = mapTokenTx.begin(); it != mapTokenTx.end(); it++)
+        auto [begin, end] = TokenTxIndexRange(wtoken.strContractAddress, wtoken.strSenderAddress);
+        for(auto it = begin; it != end; it++)
         {
-            uint256 tokenTxHash = it->second.GetHash();
-            NotifyTokenTransactionChanged(this, tokenTxHash, CT_UPDATED);
+            NotifyTokenTransactionChanged(this, std::get<3>(*it), CT_UPDATED);
         }
     }
 
@@ -3763,19 +4150,15 @@ bool CWallet::AddTokenTxEntry(const CTokenTx &tokenTx, bool fFlushOnClose)
 
     uint256 hash = tokenTx.GetHash();
 
-    bool fInsertedNew = true;
-
-    std::map<uint256, CTokenTx>::iterator it = mapTokenTx.find(hash);
-    if(it!=mapTokenTx.end())
-    {
-        fInsertedNew = false;
-    }
+    CTokenTx oldTokenTx;
+    bool fInsertedNew = !GetTokenTx(hash, oldTokenTx);
 
     // Write to disk
     CTokenTx wtokenTx = tokenTx;
     if(!fInsertedNew)
     {
-        wtokenTx.strLabel = it->second.strLabel;
+        wtokenTx.strLabel = oldTokenTx.strLabel;
+        IndexTokenTx(oldTokenTx, true);
     }
     int64_t blockTime;
     uint256 blockHash = wtokenTx.blockNumber < 0 ? uint256() : chain().getBlockHash(wtokenTx.blockNumber);
@@ -3785,7 +4168,9 @@ bool CWallet::AddTokenTxEntry(const CTokenTx &tokenTx, bool fFlushOnClose)
     if (!batch.WriteTokenTx(wtokenTx))
         return false;
 
-    mapTokenTx[hash] = wtokenTx;
+    m_token_txs.insert(hash);
+    CacheTokenTx(hash, wtokenTx);
+    IndexTokenTx(wtokenTx);
 
     NotifyTokenTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
@@ -4013,6 +4398,12 @@ void CWallet::SetupLegacyScriptPubKeyMan()
     m_spk_managers[spk_manager->GetID()] = std::move(spk_manager);
 }
 
+void CWallet::TopUpCallback(const std::vector<CScript>& spks, ScriptPubKeyMan* spkm)
+{
+    LOCK(m_cached_spks_mutex);
+    m_cached_spks.insert(spks.begin(), spks.end());
+}
+
 const CKeyingMaterial& CWallet::GetEncryptionKey() const
 {
     return vMasterKey;
@@ -4863,15 +5254,16 @@ bool CWallet::RemoveTokenEntry(const uint256 &tokenHash, bool fFlushOnClose)
         if (!batch.EraseToken(tokenHash))
             return false;
 
+        CTokenInfo token = it->second;
         mapToken.erase(it);
 
         NotifyTokenChanged(this, tokenHash, CT_DELETED);
 
         // Refresh token tx
-        for(auto it = mapTokenTx.begin(); it != mapTokenTx.end(); it++)
+        auto [begin, end] = TokenTxIndexRange(token.strContractAddress, token.strSenderAddress);
+        for(auto it = begin; it != end; it++)
         {
-            uint256 tokenTxHash = it->second.GetHash();
-            NotifyTokenTransactionChanged(this, tokenTxHash, CT_UPDATED);
+            NotifyTokenTransactionChanged(this, std::get<3>(*it), CT_UPDATED);
         }
     }
 
@@ -4887,54 +5279,66 @@ bool CWallet::CleanTokenTxEntries(bool fFlushOnClose)
     // Open db
     WalletBatch batch(GetDatabase(), fFlushOnClose);
 
-    // Get all token transaction hashes
-    std::vector<uint256> tokenTxHashes;
-    for(auto it = mapTokenTx.begin(); it != mapTokenTx.end(); it++)
+    // Duplicated entries have the same contract, sender and block number, so they are
+    // next to each other in the token tx index
+    std::vector<std::vector<uint256>> groups;
+    for(auto it = m_token_tx_index.begin(); it != m_token_tx_index.end(); it++)
     {
-        tokenTxHashes.push_back(it->first);
+        auto prev = it == m_token_tx_index.begin() ? m_token_tx_index.end() : std::prev(it);
+        if(prev == m_token_tx_index.end() || std::get<0>(*prev) != std::get<0>(*it) ||
+                std::get<1>(*prev) != std::get<1>(*it) || std::get<2>(*prev) != std::get<2>(*it))
+        {
+            groups.emplace_back();
+        }
+        groups.back().push_back(std::get<3>(*it));
     }
 
     // Remove existing entries
-    for(size_t i = 0; i < tokenTxHashes.size(); i++)
+    for(const std::vector<uint256>& tokenTxHashes : groups)
     {
-        // Get the I entry
-        uint256 hashTxI = tokenTxHashes[i];
-        auto itTxI = mapTokenTx.find(hashTxI);
-        if(itTxI == mapTokenTx.end()) continue;
-        CTokenTx tokenTxI = itTxI->second;
+        if(tokenTxHashes.size() < 2) continue;
 
-        for(size_t j = 0; j < tokenTxHashes.size(); j++)
+        for(size_t i = 0; i < tokenTxHashes.size(); i++)
         {
-            // Skip the same entry
-            if(i == j) continue;
-
-            // Get the J entry
-            uint256 hashTxJ = tokenTxHashes[j];
-            auto itTxJ = mapTokenTx.find(hashTxJ);
-            if(itTxJ == mapTokenTx.end()) continue;
-            CTokenTx tokenTxJ = itTxJ->second;
-
-            // Compare I and J entries
-            if(tokenTxI.strContractAddress != tokenTxJ.strContractAddress) continue;
-            if(tokenTxI.strSenderAddress != tokenTxJ.strSenderAddress) continue;
-            if(tokenTxI.strReceiverAddress != tokenTxJ.strReceiverAddress) continue;
-            if(tokenTxI.blockHash != tokenTxJ.blockHash) continue;
-            if(tokenTxI.blockNumber != tokenTxJ.blockNumber) continue;
-            if(tokenTxI.transactionHash != tokenTxJ.transactionHash) continue;
-
-            // Delete the lower entry from disk
-            size_t nLower = uintTou256(tokenTxI.nValue) < uintTou256(tokenTxJ.nValue) ? i : j;
-            auto itTx = nLower == i ? itTxI : itTxJ;
-            uint256 hashTx = nLower == i ? hashTxI : hashTxJ;
-
-            if (!batch.EraseTokenTx(hashTx))
-                return false;
+            // Get the I entry
+            uint256 hashTxI = tokenTxHashes[i];
+            CTokenTx tokenTxI;
+            if(!GetTokenTx(hashTxI, tokenTxI)) continue;
 
-            mapTokenTx.erase(itTx);
+            for(size_t j = 0; j < tokenTxHashes.size(); j++)
+            {
+                // Skip the same entry
+                if(i == j) continue;
+
+                // Get the J entry
+                uint256 hashTxJ = tokenTxHashes[j];
+                CTokenTx tokenTxJ;
+                if(!GetTokenTx(hashTxJ, tokenTxJ)) continue;
+
+                // Compare I and J entries
+                if(tokenTxI.strContractAddress != tokenTxJ.strContractAddress) continue;
+                if(tokenTxI.strSenderAddress != tokenTxJ.strSenderAddress) continue;
+                if(tokenTxI.strReceiverAddress != tokenTxJ.strReceiverAddress) continue;
+                if(tokenTxI.blockHash != tokenTxJ.blockHash) continue;
+                if(tokenTxI.blockNumber != tokenTxJ.blockNumber) continue;
+                if(tokenTxI.transactionHash != tokenTxJ.transactionHash) continue;
+
+                // Delete the lower entry from disk
+                size_t nLower = uintTou256(tokenTxI.nValue) < uintTou256(tokenTxJ.nValue) ? i : j;
+                const CTokenTx& tokenTx = nLower == i ? tokenTxI : tokenTxJ;
+                uint256 hashTx = nLower == i ? hashTxI : hashTxJ;
+
+                if (!batch.EraseTokenTx(hashTx))
+                    return false;
 
-            NotifyTokenTransactionChanged(this, hashTx, CT_DELETED);
+                IndexTokenTx(tokenTx, true);
+                m_token_txs.erase(hashTx);
+                UncacheTokenTx(hashTx);
 
-            break;
+                NotifyTokenTransactionChanged(this, hashTx, CT_DELETED);
+
+                break;
+            }
         }
     }
 
@@ -4997,6 +5401,7 @@ bool CWallet::LoadDelegation(const CDelegationInfo &delegation)
 {
     uint256 hash = delegation.GetHash();
     mapDelegation[hash] = delegation;
+    m_delegation_index.emplace(delegation.delegateAddress, hash);
 
     return true;
 }
@@ -5032,6 +5437,7 @@ bool CWallet::AddDelegationEntry(const CDelegationInfo& delegation, bool fFlushO
         return false;
 
     mapDelegation[hash] = wdelegation;
+    m_delegation_index.emplace(wdelegation.delegateAddress, hash);
 
     NotifyDelegationChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
@@ -5063,6 +5469,7 @@ bool CWallet::RemoveDelegationEntry(const uint256& delegationHash, bool fFlushOn
         if (!batch.EraseDelegation(delegationHash))
             return false;
 
+        m_delegation_index.erase({it->second.delegateAddress, delegationHash});
         mapDelegation.erase(it);
 
         NotifyDelegationChanged(this, delegationHash, CT_DELETED);
@@ -5077,6 +5484,7 @@ bool CWallet::LoadSuperStaker(const CSuperStakerInfo &superStaker)
 {
     uint256 hash = superStaker.GetHash();
     mapSuperStaker[hash] = superStaker;
+    m_super_staker_index.emplace(superStaker.stakerAddress, hash);
 
     return true;
 }
@@ -5084,6 +5492,7 @@ bool CWallet::LoadSuperStaker(const CSuperStakerInfo &superStaker)
 bool CWallet::AddSuperStakerEntry(const CSuperStakerInfo& superStaker, bool fFlushOnClose)
 {
     LOCK(cs_wallet);
+    MarkStakeWeightDirty();
 
     WalletBatch batch(GetDatabase(), fFlushOnClose);
 
@@ -5112,6 +5521,7 @@ bool CWallet::AddSuperStakerEntry(const CSuperStakerInfo& superStaker, bool fFlu
         return false;
 
     mapSuperStaker[hash] = wsuperStaker;
+    m_super_staker_index.emplace(wsuperStaker.stakerAddress, hash);
 
     NotifySuperStakerChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
@@ -5130,6 +5540,7 @@ bool CWallet::AddSuperStakerEntry(const CSuperStakerInfo& superStaker, bool fFlu
 bool CWallet::RemoveSuperStakerEntry(const uint256& superStakerHash, bool fFlushOnClose)
 {
     LOCK(cs_wallet);
+    MarkStakeWeightDirty();
 
     WalletBatch batch(GetDatabase(), fFlushOnClose);
 
@@ -5147,6 +5558,7 @@ bool CWallet::RemoveSuperStakerEntry(const uint256& superStakerHash, bool fFlush
         if (!batch.EraseSuperStaker(superStakerHash))
             return false;
 
+        m_super_staker_index.erase({it->second.stakerAddress, superStakerHash});
         mapSuperStaker.erase(it);
 
         NotifySuperStakerChanged(this, superStakerHash, CT_DELETED);
@@ -5178,9 +5590,21 @@ bool CWallet::IsStakeClosing()
     return m_stop_staking_thread;
 }
 
+void CWallet::RemoveDelegateOfStaker(const uint160& staker, const uint160& delegate)
+{
+    auto it = m_delegates_by_staker.find(staker);
+    if(it == m_delegates_by_staker.end())
+        return;
+
+    it->second.erase(delegate);
+    if(it->second.empty())
+        m_delegates_by_staker.erase(it);
+}
+
 void CWallet::updateDelegationsStaker(const std::map<uint160, Delegation> &delegations_staker)
 {
     LOCK(cs_wallet);
+    MarkStakeWeightDirty();
 
     // Notify for updated and deleted delegation items
     for (std::map<uint160, Delegation>::iterator it=m_delegations_staker.begin(); it!=m_delegations_staker.end();)
@@ -5189,6 +5613,14 @@ void CWallet::updateDelegationsStaker(const std::map<uint160, Delegation> &deleg
         std::map<uint160, Delegation>::const_iterator delegation = delegations_staker.find(addressDelegate);
         if(delegation == delegations_staker.end())
         {
+            RemoveDelegateOfStaker(it->second.staker, addressDelegate);
+            auto shard = m_delegate_coins.shards.find(addressDelegate);
+            if(shard != m_delegate_coins.shards.end())
+            {
+                for(const auto& coin : shard->second)
+                    m_delegate_coins.delegates.erase(coin.first);
+                m_delegate_coins.shards.erase(shard);
+            }
             it = m_delegations_staker.erase(it);
             m_delegations_weight.erase(addressDelegate);
             NotifyDelegationsStakerChanged(this, addressDelegate, CT_DELETED);
@@ -5197,6 +5629,8 @@ void CWallet::updateDelegationsStaker(const std::map<uint160, Delegation> &deleg
         {
             if(delegation->second != it->second)
             {
+                RemoveDelegateOfStaker(it->second.staker, addressDelegate);
+                m_delegates_by_staker[delegation->second.staker].insert(addressDelegate);
                 it->second = delegation->second;
                 NotifyDelegationsStakerChanged(this, addressDelegate, CT_UPDATED);
             }
@@ -5210,6 +5644,7 @@ void CWallet::updateDelegationsStaker(const std::map<uint160, Delegation> &deleg
         if(m_delegations_staker.find(it->first) == m_delegations_staker.end())
         {
             m_delegations_staker[it->first] = it->second;
+            m_delegates_by_staker[it->second.staker].insert(it->first);
             NotifyDelegationsStakerChanged(this, it->first, CT_NEW);
         }
     }
@@ -5254,18 +5689,15 @@ uint64_t CWallet::GetSuperStakerWeight(const uint160 &staker) const
 
     uint64_t nWeight = 0;
     auto iterator = m_have_coin_superstaker.find(staker);
-    if (iterator != m_have_coin_superstaker.end() && iterator->second)
+    auto delegates = m_delegates_by_staker.find(staker);
+    if (iterator != m_have_coin_superstaker.end() && iterator->second && delegates != m_delegates_by_staker.end())
     {
-        for (std::map<uint160, Delegation>::const_iterator it=m_delegations_staker.begin(); it!=m_delegations_staker.end(); it++)
+        for (const uint160& delegate : delegates->second)
         {
-            if(it->second.staker == staker)
+            std::map<uint160, CAmount>::const_iterator mi = m_delegations_weight.find(delegate);
+            if(mi != m_delegations_weight.end())
             {
-                uint160 delegate = it->first;
-                std::map<uint160, CAmount>::const_iterator mi = m_delegations_weight.find(delegate);
-                if(mi != m_delegations_weight.end())
-                {
-                    nWeight += mi->second;
-                }
+                nWeight += mi->second;
             }
         }
     }
@@ -5277,13 +5709,11 @@ bool CWallet::GetSuperStaker(CSuperStakerInfo &info, const uint160 &stakerAddres
 {
     LOCK(cs_wallet);
 
-    for (std::map<uint256, CSuperStakerInfo>::const_iterator it=mapSuperStaker.begin(); it!=mapSuperStaker.end(); it++)
+    auto it = m_super_staker_index.lower_bound({stakerAddress, uint256()});
+    if(it != m_super_staker_index.end() && it->first == stakerAddress)
     {
-        if(it->second.stakerAddress == stakerAddress)
-        {
-            info = it->second;
-            return true;
-        }
+        info = mapSuperStaker.at(it->second);
+        return true;
     }
 
     return false;
@@ -26,6 +26,7 @@
 #include <validationinterface.h>
 #include <wallet/crypter.h>
 #include <wallet/scriptpubkeyman.h>
+#include <wallet/stakingmetrics.h>
 #include <wallet/transaction.h>
 #include <wallet/walletdb.h>
 #include <wallet/walletutil.h>
@@ -35,6 +36,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <list>
 #include <map>
 #include <memory>
 #include <optional>
@@ -42,8 +44,10 @@
 #include <stdexcept>
 #include <stdint.h>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <boost/signals2/signal.hpp>
@@ -114,6 +118,8 @@ static const bool DEFAULT_WALLET_RBF = true;
 static const bool DEFAULT_WALLETBROADCAST = true;
 static const bool DEFAULT_DISABLE_WALLET = false;
 static const bool DEFAULT_WALLETCROSSCHAIN = false;
+//! Default for -checkwalletbalance
+static const bool DEFAULT_CHECK_WALLET_BALANCE = false;
 static const bool DEFAULT_USE_CHANGE_ADDRESS = true;
 static const CAmount DEFAULT_RESERVE_BALANCE = 0;
 //! -maxtxfee default
@@ -124,6 +130,8 @@ constexpr CAmount HIGH_TX_FEE_PER_KB{1 * COIN};
 constexpr CAmount HIGH_MAX_TX_FEE{100 * HIGH_TX_FEE_PER_KB};
 //! Pre-calculated constants for input size estimation in *virtual size*
 static constexpr size_t DUMMY_NESTED_P2WPKH_INPUT_SIZE = 91;
+//! Number of token transactions kept in memory after they are read from the database
+static constexpr size_t TOKEN_TX_CACHE_SIZE{1000};
 
 //! -stakingminfee default
 static const uint8_t DEFAULT_STAKING_MIN_FEE = 10;
@@ -297,6 +305,32 @@ struct CScriptCache{
 };
 
 class WalletRescanReserver; //forward declarations for ScanForWalletTransactions/RescanFromTime
+
+struct Balance {
+    CAmount m_mine_trusted{0};           //!< Trusted, at depth=GetBalance.min_depth or more
+    CAmount m_mine_untrusted_pending{0}; //!< Untrusted, but in mempool (pending)
+    CAmount m_mine_immature{0};          //!< Immature coinbases in the main chain
+    CAmount m_mine_stake{0};
+    CAmount m_watchonly_trusted{0};
+    CAmount m_watchonly_untrusted_pending{0};
+    CAmount m_watchonly_immature{0};
+    CAmount m_watchonly_stake{0};
+};
+
+/** Running totals of GetBalance at min_depth 0, updated from the transactions marked dirty since the last call */
+struct BalanceCache {
+    bool initialized{false};
+    //! Height of the last block processed when the totals were updated
+    int height{0};
+    Balance total;
+    //! What every wallet transaction adds to the totals
+    std::map<uint256, Balance> tx_balances;
+    //! Transactions marked dirty since the last update
+    std::set<uint256> dirty_txs;
+    //! Unconfirmed and immature transactions, what they add changes with the mempool and the chain height
+    std::set<uint256> volatile_txs;
+};
+
 /**
  * A CWallet maintains a set of transactions and balances, and provides the ability to create new transactions.
  */
@@ -366,6 +400,10 @@ private:
 
     void SyncTransaction(const CTransactionRef& tx, const SyncTxState& state, bool update_tx = true, bool rescanning_old_block = false) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    /** Add the token transactions of the tracked tokens from the QRC20 events of a connected block,
+     *  and record that the tokens are synced up to that block */
+    void SyncTokenTransfers(const interfaces::BlockInfo& block) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     /** WalletFlags set on this wallet. */
     std::atomic<uint64_t> m_wallet_flags{0};
 
@@ -409,6 +447,11 @@ private:
     // ScriptPubKeyMan::GetID. In many cases it will be the hash of an internal structure
     std::map<uint256, std::unique_ptr<ScriptPubKeyMan>> m_spk_managers;
 
+    /** The scriptPubKeys of the descriptor ScriptPubKeyMans, so that IsMine rejects the
+     *  other scripts without going through every ScriptPubKeyMan */
+    mutable Mutex m_cached_spks_mutex;
+    std::unordered_set<CScript, SaltedSipHasher> m_cached_spks GUARDED_BY(m_cached_spks_mutex);
+
     /**
      * Catch wallet up to current chain, scanning new blocks, updating the best
      * block locator and m_last_block_processed, and registering for
@@ -486,15 +529,32 @@ public:
 
     std::map<uint256, CTokenInfo> mapToken;
 
-    std::map<uint256, CTokenTx> mapTokenTx;
+    /** Hashes of the token transactions. Only the index is loaded with the wallet, the
+     *  transactions are read from the database when needed, see GetTokenTx */
+    std::set<uint256> m_token_txs;
+
+    /** Token transaction hashes by contract address, sender or receiver address and block number,
+     *  so the transactions of a token are found without reading them all */
+    using TokenTxIndexKey = std::tuple<std::string, std::string, int64_t, uint256>;
+    std::set<TokenTxIndexKey> m_token_tx_index;
+
+    /** Token transactions read from the database, the least recently used at the back of m_token_tx_order */
+    mutable std::list<uint256> m_token_tx_order;
+    mutable std::map<uint256, std::pair<CTokenTx, std::list<uint256>::iterator>> m_token_tx_cache;
 
     std::map<uint256, CDelegationInfo> mapDelegation;
 
+    /** Delegation hashes by delegate address */
+    std::set<std::pair<uint160, uint256>> m_delegation_index;
+
     std::map<uint256, CSuperStakerInfo> mapSuperStaker;
 
+    /** Super staker hashes by staker address */
+    std::set<std::pair<uint160, uint256>> m_super_staker_index;
+
     bool fUpdatedSuperStaker = false;
 
-    std::map<COutPoint, CStakeCache> minerStakeCache;
+    CStakeCacheMap minerStakeCache;
 
     std::map<uint160, bool> mapAddressUnspentCache;
 
@@ -508,6 +568,13 @@ public:
 
     const CWalletTx* GetWalletTx(const uint256& hash) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    //! Whether a wallet transaction has outputs of the wallet that are not spent
+    bool HasUnspentOutputs(const CWalletTx& wtx) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+    /** Wallet transactions with outputs of the wallet that are not spent. The fully spent
+     *  transactions are only looked at again once they are marked dirty. */
+    std::vector<const CWalletTx*> GetUnspentTxs() const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     std::set<uint256> GetTxConflicts(const CWalletTx& wtx) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
     /**
@@ -591,6 +658,19 @@ public:
 
     bool LoadTokenTx(const CTokenTx &tokenTx);
 
+    //! Add or remove a token transaction from m_token_tx_index
+    void IndexTokenTx(const CTokenTx &tokenTx, bool fErase=false);
+
+    //! Read a token transaction from the cache or the database
+    bool GetTokenTx(const uint256& hash, CTokenTx& tokenTx) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+    //! Add or remove a token transaction from m_token_tx_cache
+    void CacheTokenTx(const uint256& hash, const CTokenTx& tokenTx) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void UncacheTokenTx(const uint256& hash) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+    //! Range of m_token_tx_index with the transactions of a contract address and a sender or receiver address
+    std::pair<std::set<TokenTxIndexKey>::const_iterator, std::set<TokenTxIndexKey>::const_iterator> TokenTxIndexRange(const std::string& contractAddress, const std::string& address) const;
+
     //! Adds a contract data tuple to the store, without saving it to disk
     bool LoadContractData(const std::string &address, const std::string &key, const std::string &value);
 
@@ -603,6 +683,10 @@ public:
 
     void MarkDirty();
 
+    //! Break the cached amounts of a wallet transaction and what it adds to the balance cache, and
+    //! look at its outputs again in GetUnspentTxs
+    void MarkTxDirty(CWalletTx& wtx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     //! Callback for updating transaction metadata in mapWallet.
     //!
     //! @param wtx - reference to mapWallet transaction to update
@@ -724,6 +808,13 @@ public:
     /** Allow Coin Selection to pick unconfirmed UTXOs that were sent from our own wallet if it
      * cannot fund the transaction otherwise. */
     bool m_spend_zero_conf_change{DEFAULT_SPEND_ZEROCONF_CHANGE};
+    /** Transactions that may have unspent outputs of the wallet, see GetUnspentTxs */
+    mutable std::unordered_set<uint256, SaltedTxidHasher> m_unspent_txs GUARDED_BY(cs_wallet);
+    mutable bool m_unspent_txs_initialized GUARDED_BY(cs_wallet){false};
+    /** Balance caches without and with avoid_reuse, see GetBalance */
+    mutable BalanceCache m_balance_cache[2] GUARDED_BY(cs_wallet);
+    //! Check the balance caches against the balance of all the wallet transactions (-checkwalletbalance)
+    bool m_check_balance{DEFAULT_CHECK_WALLET_BALANCE};
     bool m_signal_rbf{DEFAULT_WALLET_RBF};
     bool m_allow_fallback_fee{true}; //!< will be false if -fallbackfee=0
     CFeeRate m_min_fee{DEFAULT_TRANSACTION_MINFEE}; //!< Override with -mintxfee
@@ -771,6 +862,8 @@ public:
     CAmount m_reserve_balance{DEFAULT_RESERVE_BALANCE};
     int64_t m_last_coin_stake_search_time{0};
     int64_t m_last_coin_stake_search_interval{0};
+    //! Slot timings and counters of the staker, reported by getstakingmetrics
+    StakingMetrics m_staking_metrics;
     std::atomic<bool> m_enabled_staking{false};
     CAmount m_staking_min_utxo_value{DEFAULT_STAKING_MIN_UTXO_VALUE};
     CAmount m_staker_min_utxo_size{DEFAULT_STAKER_MIN_UTXO_SIZE};
@@ -1043,6 +1136,9 @@ public:
     const CKeyingMaterial& GetEncryptionKey() const override;
     bool HasEncryptionKeys() const override;
 
+    //! Add the scriptPubKeys of a ScriptPubKeyMan to m_cached_spks
+    void TopUpCallback(const std::vector<CScript>& spks, ScriptPubKeyMan* spkm) override EXCLUSIVE_LOCKS_REQUIRED(!m_cached_spks_mutex);
+
     /** Get last block processed height */
     int GetLastBlockHeight() const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet)
     {
@@ -1134,6 +1230,10 @@ public:
     /* Check if token transaction is mine */
     bool IsTokenTxMine(const CTokenTx &wtx) const;
 
+    /* List the token transactions of a contract address and a sender or receiver address,
+       most recent first, skipping the first offset ones and returning at most count */
+    std::vector<CTokenTx> ListTokenTxs(const std::string& contractAddress, const std::string& address, size_t offset, size_t count) const;
+
     /* Remove token entry from the wallet */
     bool RemoveTokenEntry(const uint256& tokenHash, bool fFlushOnClose=true);
 
@@ -1176,8 +1276,11 @@ public:
     void updateDelegationsStaker(const std::map<uint160, Delegation>& delegations_staker);
     void updateDelegationsWeight(const std::map<uint160, CAmount>& delegations_weight);
     void updateHaveCoinSuperStaker(const std::set<std::pair<const CWalletTx*,unsigned int> >& setCoins);
+    void RemoveDelegateOfStaker(const uint160& staker, const uint160& delegate) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
     std::map<uint160, Delegation> m_delegations_staker;
+    /** Delegate addresses of m_delegations_staker by staker address */
+    std::map<uint160, std::set<uint160>> m_delegates_by_staker;
     std::map<uint160, CAmount> m_delegations_weight;
     std::map<uint160, Delegation> m_my_delegations;
     std::map<uint160, bool> m_have_coin_superstaker;
@@ -1185,12 +1288,69 @@ public:
     mutable boost::thread_group threads;
     std::string m_ledger_id;
     boost::thread_group* stakeThread = nullptr;
-    std::map<COutPoint, CStakeCache> stakeCache;
-    std::map<COutPoint, CStakeCache> stakeDelegateCache;
+    CStakeCacheMap stakeCache;
+    CStakeCacheMap stakeDelegateCache;
+    //! Tips at which the last generation of stakeCache and stakeDelegateCache was started
+    uint256 stakeCacheTip;
+    uint256 stakeDelegateCacheTip;
     bool fHasMinerStakeCache = false;
     mutable std::map<COutPoint, CScriptCache> prevoutScriptCache;
     mutable std::map<uint160, bool> addressStakeCache;
     std::atomic<bool> fCleanCoinStake = true;
+
+    struct StakeWeight
+    {
+        uint64_t nWeight = 0;
+        uint64_t nStakerWeight = 0;
+        uint64_t nDelegateWeight = 0;
+    };
+    //! Stake weight computed by GetStakeWeight, kept until the wallet coins or staking settings change
+    mutable std::optional<StakeWeight> m_stake_weight GUARDED_BY(cs_wallet);
+    //! Recompute the stake weight on the next GetStakeWeight call
+    void MarkStakeWeightDirty();
+
+    /**
+     * Confirmed wallet transactions with coins that can be staked, so that the staker does not walk
+     * the whole wallet on every iteration. Transactions are added when they are confirmed, wait in
+     * pending until the tip height at which they are mature, and leave the matured set once they
+     * have no coin available. The index is rebuilt when coins may become available again or
+     * mature transactions may become immature (disconnected blocks, conflicts, abandoned transactions).
+     */
+    struct StakeTxIndex
+    {
+        bool fValid = false;
+        int nCoinbaseMaturity = 0;
+        std::multimap<int, uint256> pending; //!< By tip height at which the transaction is mature
+        std::set<uint256> matured;
+    };
+    mutable StakeTxIndex m_stake_tx_index GUARDED_BY(cs_wallet);
+    //! Rebuild the stake transaction index on its next use
+    void MarkStakeTxIndexDirty();
+
+    /**
+     * Coins of the delegates of m_delegations_staker, sharded by delegate address, so that the super
+     * staker does not read the address index for all its delegates on every iteration. The shard of a
+     * delegate is loaded from the address index when the index is at the block of the wallet, and is
+     * then updated with the outputs created and spent by the connected blocks. The snapshot is
+     * reloaded after a block is disconnected.
+     */
+    struct DelegateCoin
+    {
+        CAmount nValue = 0;
+        int nHeight = 0;
+    };
+    struct DelegateCoinsSnapshot
+    {
+        bool fValid = false;
+        uint256 hashBlock; //!< Block the coins are at
+        std::map<uint160, std::map<COutPoint, DelegateCoin>> shards;
+        std::map<COutPoint, uint160> delegates; //!< Delegate address of each coin of the shards
+    };
+    mutable DelegateCoinsSnapshot m_delegate_coins GUARDED_BY(cs_wallet);
+    //! Reload the delegate coins snapshot on its next use
+    void MarkDelegateCoinsDirty();
+    //! Update the delegate coins snapshot with the coins created and spent by a connected block
+    void SyncDelegateCoins(const interfaces::BlockInfo& block) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 };
 
 /**
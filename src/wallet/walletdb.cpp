@@ -1237,6 +1237,11 @@ bool WalletBatch::WriteTokenTx(const CTokenTx &wTokenTx)
     return WriteIC(std::make_pair(DBKeys::TOKENTX, wTokenTx.GetHash()), wTokenTx);
 }
 
+bool WalletBatch::ReadTokenTx(const uint256& hash, CTokenTx& wTokenTx)
+{
+    return m_batch->Read(std::make_pair(DBKeys::TOKENTX, hash), wTokenTx);
+}
+
 bool WalletBatch::EraseTokenTx(uint256 hash)
 {
     return EraseIC(std::make_pair(DBKeys::TOKENTX, hash));
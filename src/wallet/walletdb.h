@@ -245,6 +245,7 @@ public:
     bool EraseToken(uint256 hash);
 
     bool WriteTokenTx(const CTokenTx& wTokenTx);
+    bool ReadTokenTx(const uint256& hash, CTokenTx& wTokenTx);
     bool EraseTokenTx(uint256 hash);
 
     bool WriteDelegation(const CDelegationInfo& wdelegation);
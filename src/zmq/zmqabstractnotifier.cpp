@@ -42,3 +42,13 @@ bool CZMQAbstractNotifier::NotifyTransactionRemoval(const CTransaction &/*transa
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyReceiptsConnect(const CBlockIndex * /*CBlockIndex*/, const std::vector<TransactionReceiptInfo> &/*receipts*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyReceiptsDisconnect(const CBlockIndex * /*CBlockIndex*/)
+{
+    return true;
+}
@@ -8,10 +8,12 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 class CBlockIndex;
 class CTransaction;
 class CZMQAbstractNotifier;
+struct TransactionReceiptInfo;
 
 using CZMQNotifierFactory = std::unique_ptr<CZMQAbstractNotifier> (*)();
 
@@ -55,6 +57,10 @@ public:
     virtual bool NotifyTransactionRemoval(const CTransaction &transaction, uint64_t mempool_sequence);
     // Notifies of transactions added to mempool or appearing in blocks
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    // Notifies of the contract receipts of every block connection
+    virtual bool NotifyReceiptsConnect(const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts);
+    // Notifies of every disconnection of a block with contract transactions
+    virtual bool NotifyReceiptsDisconnect(const CBlockIndex *pindex);
 
 protected:
     void* psocket{nullptr};
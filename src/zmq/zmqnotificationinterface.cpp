@@ -15,6 +15,7 @@
 
 #include <zmq.h>
 
+#include <algorithm>
 #include <cassert>
 #include <map>
 #include <string>
@@ -47,6 +48,8 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
     factories["pubsequence"] = CZMQAbstractNotifier::Create<CZMQPublishSequenceNotifier>;
+    factories["pubreceipt"] = CZMQAbstractNotifier::Create<CZMQPublishReceiptNotifier>;
+    factories["pubcontractlog"] = CZMQAbstractNotifier::Create<CZMQPublishContractLogNotifier>;
 
     std::list<std::unique_ptr<CZMQAbstractNotifier>> notifiers;
     for (const auto& entry : factories)
@@ -196,6 +199,23 @@ void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CB
     TryForEachAndRemoveFailed(notifiers, [pindexDisconnected](CZMQAbstractNotifier* notifier) {
         return notifier->NotifyBlockDisconnect(pindexDisconnected);
     });
+
+    // Receipt listeners drop what they got for blocks that may have executed contracts
+    const bool has_contracts = std::any_of(pblock->vtx.begin(), pblock->vtx.end(), [](const CTransactionRef& ptx) {
+        return ptx->HasCreateOrCall() || ptx->HasOpSpend();
+    });
+    if (has_contracts) {
+        TryForEachAndRemoveFailed(notifiers, [pindexDisconnected](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyReceiptsDisconnect(pindexDisconnected);
+        });
+    }
+}
+
+void CZMQNotificationInterface::BlockReceiptsConnected(const std::shared_ptr<const std::vector<TransactionReceiptInfo>>& receipts, const CBlockIndex* pindexConnected)
+{
+    TryForEachAndRemoveFailed(notifiers, [&receipts, pindexConnected](CZMQAbstractNotifier* notifier) {
+        return notifier->NotifyReceiptsConnect(pindexConnected, *receipts);
+    });
 }
 
 CZMQNotificationInterface* g_zmq_notification_interface = nullptr;
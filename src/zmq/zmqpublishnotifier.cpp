@@ -14,11 +14,13 @@
 #include <node/blockstorage.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
+#include <qtum/storageresults.h>
 #include <rpc/server.h>
 #include <serialize.h>
 #include <streams.h>
 #include <sync.h>
 #include <uint256.h>
+#include <util/convert.h>
 #include <version.h>
 #include <zmq/zmqutil.h>
 
@@ -48,6 +50,8 @@ static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
 static const char *MSG_SEQUENCE  = "sequence";
+static const char *MSG_RECEIPT   = "receipt";
+static const char *MSG_CONTRACTLOG = "contractlog";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -309,3 +313,59 @@ bool CZMQPublishSequenceNotifier::NotifyTransactionRemoval(const CTransaction &t
     LogPrint(BCLog::ZMQ, "Publish hashtx mempool removal %s to %s\n", hash.GetHex(), this->address);
     return SendSequenceMsg(*this, hash, /* Mempool (R)emoval */ 'R', mempool_sequence);
 }
+
+// Helper function to start a 'receipt' or 'contractlog' topic message with the block it belongs to:
+//    <1-byte label> | <32-byte block hash> | <4-byte LE height>
+static DataStream ReceiptMsgStart(const CBlockIndex *pindex, char label)
+{
+    DataStream ss{};
+    ss << uint8_t(label) << pindex->GetBlockHash() << uint32_t(pindex->nHeight);
+    return ss;
+}
+
+bool CZMQPublishReceiptNotifier::NotifyReceiptsConnect(const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts)
+{
+    LogPrint(BCLog::ZMQ, "Publish %u receipts of block %s to %s\n", receipts.size(), pindex->GetBlockHash().GetHex(), this->address);
+    for (const TransactionReceiptInfo& receipt : receipts) {
+        DataStream ss{ReceiptMsgStart(pindex, /* Block (C)onnect */ 'C')};
+        ss << receipt.transactionHash << receipt.transactionIndex << receipt.outputIndex;
+        ss << h160Touint(receipt.from) << h160Touint(receipt.to) << h160Touint(receipt.contractAddress);
+        ss << receipt.gasUsed << receipt.cumulativeGasUsed << uint32_t(receipt.excepted);
+        ss << h256Touint(receipt.stateRoot) << h256Touint(receipt.utxoRoot) << uint32_t(receipt.logs.size());
+        if (!SendZmqMessage(MSG_RECEIPT, ss.data(), ss.size())) return false;
+    }
+    return true;
+}
+
+bool CZMQPublishReceiptNotifier::NotifyReceiptsDisconnect(const CBlockIndex *pindex)
+{
+    LogPrint(BCLog::ZMQ, "Publish receipts disconnect of block %s to %s\n", pindex->GetBlockHash().GetHex(), this->address);
+    DataStream ss{ReceiptMsgStart(pindex, /* Block (D)isconnect */ 'D')};
+    return SendZmqMessage(MSG_RECEIPT, ss.data(), ss.size());
+}
+
+bool CZMQPublishContractLogNotifier::NotifyReceiptsConnect(const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts)
+{
+    LogPrint(BCLog::ZMQ, "Publish contract logs of block %s to %s\n", pindex->GetBlockHash().GetHex(), this->address);
+    for (const TransactionReceiptInfo& receipt : receipts) {
+        for (size_t i = 0; i < receipt.logs.size(); i++) {
+            const dev::eth::LogEntry& log = receipt.logs[i];
+            DataStream ss{ReceiptMsgStart(pindex, /* Block (C)onnect */ 'C')};
+            ss << receipt.transactionHash << receipt.outputIndex << uint32_t(i) << h160Touint(log.address);
+            WriteCompactSize(ss, log.topics.size());
+            for (const dev::h256& topic : log.topics) {
+                ss << h256Touint(topic);
+            }
+            ss << log.data;
+            if (!SendZmqMessage(MSG_CONTRACTLOG, ss.data(), ss.size())) return false;
+        }
+    }
+    return true;
+}
+
+bool CZMQPublishContractLogNotifier::NotifyReceiptsDisconnect(const CBlockIndex *pindex)
+{
+    LogPrint(BCLog::ZMQ, "Publish contract logs disconnect of block %s to %s\n", pindex->GetBlockHash().GetHex(), this->address);
+    DataStream ss{ReceiptMsgStart(pindex, /* Block (D)isconnect */ 'D')};
+    return SendZmqMessage(MSG_CONTRACTLOG, ss.data(), ss.size());
+}
@@ -65,4 +65,18 @@ public:
     bool NotifyTransactionRemoval(const CTransaction &transaction, uint64_t mempool_sequence) override;
 };
 
+class CZMQPublishReceiptNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyReceiptsConnect(const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts) override;
+    bool NotifyReceiptsDisconnect(const CBlockIndex *pindex) override;
+};
+
+class CZMQPublishContractLogNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyReceiptsConnect(const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts) override;
+    bool NotifyReceiptsDisconnect(const CBlockIndex *pindex) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
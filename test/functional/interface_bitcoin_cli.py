@@ -5,6 +5,7 @@
 """Test bitcoin-cli"""
 
 from decimal import Decimal
+import json
 import re
 
 from test_framework.qtumconfig import INITIAL_BLOCK_REWARD, COINBASE_MATURITY 
@@ -104,6 +105,16 @@ class TestBitcoinCli(BitcoinTestFramework):
         assert_equal(['foo', 'bar'], self.nodes[0].cli(f'-rpcuser={user}', '-stdin', '-stdinrpcpass', input=f'{password}\nfoo\nbar').echo())
         assert_raises_process_error(1, 'Incorrect rpcuser or rpcpassword', self.nodes[0].cli(f'-rpcuser={user}', '-stdin', '-stdinrpcpass', input='foo').echo)
 
+        self.log.info("Test -stdinbatch")
+        commands = 'getblockcount\n\n["echo", "foo", 2]\necho  bar\ngetblockhash 0\n'
+        replies = [json.loads(line) for line in self.nodes[0].cli('-stdinbatch', '-batchsize=2', input=commands).send_cli().splitlines()]
+        assert_equal([reply['id'] for reply in replies], [1, 3, 4, 5])
+        assert_equal(replies[0]['result'], BLOCKS)
+        assert_equal(replies[1]['result'], ['foo', '2'])
+        assert_equal(replies[2]['result'], ['bar'])
+        assert_equal(replies[3]['result'], self.nodes[0].getblockhash(0))
+        assert_raises_process_error(1, "-stdinbatch reads the commands from standard input", self.nodes[0].cli('-stdinbatch').echo)
+
         self.log.info("Test connecting to a non-existing server")
         assert_raises_process_error(1, "Could not connect to the server", self.nodes[0].cli('-rpcport=1').echo)
 
@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+# Copyright (c) 2018-2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test that long-poll RPC calls do not hold the worker threads of other calls."""
+
+from threading import Thread
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, get_rpc_proxy
+
+NUM_WAITERS = 8
+
+
+class RPCWorkQueuesTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        # A single worker for each class of calls
+        self.extra_args = [["-rpcthreads=1", "-rpcheavythreads=1", "-rpclongpollthreads=1"]]
+        self.supports_cli = False
+
+    def parked_calls(self, method):
+        with open(self.nodes[0].debug_log_path, encoding='utf-8') as dl:
+            return dl.read().count(f"Parked {method} call")
+
+    def run_test(self):
+        node = self.nodes[0]
+        results = []
+        waiters = []
+        for _ in range(NUM_WAITERS):
+            long_poll = get_rpc_proxy(node.url, 1, timeout=600, coveragedir=node.coverage_dir)
+            # Force connection establishment by executing a dummy command.
+            long_poll.getblockcount()
+            waiters.append(Thread(target=lambda rpc=long_poll: results.append(rpc.waitfornewblock())))
+            waiters[-1].start()
+
+        self.log.info("Check that more calls wait than there are long-poll workers")
+        self.wait_until(lambda: self.parked_calls('waitfornewblock') == NUM_WAITERS)
+        assert_equal(node.getrpcinfo()['active_commands'][0]['method'], 'getrpcinfo')
+
+        self.log.info("Check that other calls are served while they wait")
+        assert_equal(node.getblockcount(), 0)
+        node.gettxoutsetinfo()
+        assert all(waiter.is_alive() for waiter in waiters)
+
+        self.log.info("Check that a parked call times out")
+        assert_equal(node.waitfornewblock(100)['hash'], node.getbestblockhash())
+
+        self.log.info("Check that the long-poll calls return on a new block")
+        blockhash = self.generate(node, 1)[0]
+        for waiter in waiters:
+            waiter.join()
+        assert_equal([result['hash'] for result in results], [blockhash] * NUM_WAITERS)
+
+
+if __name__ == '__main__':
+    RPCWorkQueuesTest().main()
@@ -38,6 +38,7 @@ class CallContractTest(BitcoinTestFramework):
         contract_address = contract_data['address']
         self.node.generate(1)
         ret = self.node.callcontract(contract_address, "00")
+        self.calls.append((contract_address, "00"))
         assert(ret['address'] == contract_address)
         assert(ret['executionResult']['gasUsed'] == 21037)
         assert(ret['executionResult']['excepted'] == "None")
@@ -75,6 +76,7 @@ class CallContractTest(BitcoinTestFramework):
         self.node.generate(1)
         # call add()
         ret = self.node.callcontract(contract_address, "4f2be91f")
+        self.calls.append((contract_address, "4f2be91f"))
         assert(ret['address'] == contract_address)
         assert(ret['executionResult']['gasUsed'] == 26370 if ENABLE_REDUCED_BLOCK_TIME else 26878)
         assert(ret['executionResult']['excepted'] == "None")
@@ -137,6 +139,7 @@ class CallContractTest(BitcoinTestFramework):
         self.node.generate(1)
         # call CallTest()
         ret = self.node.callcontract(contract_address, "b717cfe6")
+        self.calls.append((contract_address, "b717cfe6"))
         expected_log = [
             {
             "address": contract_address,
@@ -228,11 +231,45 @@ class CallContractTest(BitcoinTestFramework):
         assert(ret['transactionReceipt']['log'] == expected_log)
 
 
+    # Verifies that a batch returns the same results as the individual calls, in order
+    def callcontractbatch_test(self):
+        # Repeat the calls so that the batch is large enough to be split over several workers
+        calls = self.calls * 4
+        expected = [self.node.callcontract(address, data) for address, data in calls]
+        ret = self.node.callcontractbatch([{"address": address, "data": data} for address, data in calls])
+        assert_equal(ret, expected)
+
+        # The calls of a batch do not see each other's state changes
+        address, data = self.calls[1]
+        ret = self.node.callcontractbatch([{"address": address, "data": data, "gaslimit": 1000000}] * 2)
+        assert_equal(ret[0]['executionResult']['output'], ret[1]['executionResult']['output'])
+
+        assert_equal(self.node.callcontractbatch([]), [])
+        assert_raises_rpc_error(-5, "Address does not exist", self.node.callcontractbatch, [{"address": "00" * 20, "data": "00"}])
+        assert_raises_rpc_error(-3, "Missing data", self.node.callcontractbatch, [{"address": address}])
+
+    # Verifies that the estimated gas limit is the lowest one with which the calls succeed
+    def estimategas_test(self):
+        for address, data in self.calls:
+            ret = self.node.estimategas(address, data)
+            assert_equal(ret['address'], address)
+            assert_equal(ret['executionResult']['excepted'], "None")
+            assert(ret['gasLimit'] >= ret['executionResult']['gasUsed'])
+            assert_equal(self.node.callcontract(address, data, None, ret['gasLimit'])['executionResult']['excepted'], "None")
+            assert(self.node.callcontract(address, data, None, ret['gasLimit'] - 1)['executionResult']['excepted'] != "None")
+            # Estimated again for the same block
+            assert_equal(self.node.estimategas(address, data)['cached'], True)
+
+        assert_raises_rpc_error(-5, "Address does not exist", self.node.estimategas, "00" * 20, "00")
+
     def run_test(self):
+        self.calls = []
         self.nodes[0].generate(COINBASE_MATURITY+100)
         self.callcontract_fallback_function_test()
         self.callcontract_abi_function_signature_test()
         self.callcontract_verify_subcall_and_logs_test()
+        self.callcontractbatch_test()
+        self.estimategas_test()
 
 if __name__ == '__main__':
     CallContractTest().main()
@@ -38,7 +38,8 @@ class QtumQRC20Test(BitcoinTestFramework):
     def set_test_params(self):
         self.num_nodes = 2
         self.setup_clean_chain = True
-        self.extra_args = [['-txindex', '-logevents']]*2
+        # The second node reads the token transfers from the QRC20 index
+        self.extra_args = [['-txindex', '-logevents'], ['-txindex', '-logevents', '-qrc20index']]
 
     def skip_test_if_missing_module(self):
         self.skip_if_no_wallet()
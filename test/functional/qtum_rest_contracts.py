@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+# Copyright (c) 2014-2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the contract receipt, logs and storage REST endpoints."""
+
+from decimal import Decimal
+import http.client
+import json
+import urllib.parse
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+from test_framework.qtumconfig import COINBASE_MATURITY
+
+TOPIC = "ab" * 32
+# Constructor that stores 42 in slot 0 and emits LOG1(TOPIC) with the 32-byte word 42 as data
+BYTECODE = "602a600055" + "602a600052" + "7f" + TOPIC + "6020" + "6000" + "a1" + "00"
+
+
+class QtumRESTContractsTest(BitcoinTestFramework):
+    def add_options(self, parser):
+        self.add_wallet_options(parser)
+
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [["-rest", "-logevents"]]
+        self.supports_cli = False
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def rest_request(self, uri, status=200, query_params=None):
+        rest_uri = '/rest' + uri
+        if query_params:
+            rest_uri += f'?{urllib.parse.urlencode(query_params)}'
+        conn = http.client.HTTPConnection(self.url.hostname, self.url.port)
+        conn.request('GET', rest_uri)
+        resp = conn.getresponse()
+        assert_equal(resp.status, status)
+        body = resp.read()
+        if uri.endswith('.json') and status == 200:
+            return json.loads(body.decode('utf-8'), parse_float=Decimal)
+        return body
+
+    def run_test(self):
+        node = self.nodes[0]
+        self.url = urllib.parse.urlparse(node.url)
+        self.generate(node, COINBASE_MATURITY + 100)
+
+        contract = node.createcontract(BYTECODE)
+        txid, address = contract['txid'], contract['address']
+        self.generate(node, 1)
+        height = node.getblockcount()
+
+        self.log.info("Test the /receipt URI")
+        receipt = node.gettransactionreceipt(txid)
+        assert_equal(self.rest_request(f"/receipt/{txid}.json"), receipt)
+        raw = self.rest_request(f"/receipt/{txid}.bin")
+        assert_equal(raw[0], 1)
+        assert_equal(raw[1:33][::-1].hex(), receipt[0]['blockHash'])
+        assert_equal(raw[37:69][::-1].hex(), txid)
+        assert_equal(self.rest_request(f"/receipt/{txid}.hex").decode().strip(), raw.hex())
+        # Transactions without contract executions have no receipts
+        coinbase = node.getblock(node.getbestblockhash())['tx'][0]
+        assert_equal(self.rest_request(f"/receipt/{coinbase}.json"), [])
+        self.rest_request("/receipt/abc.json", status=400)
+
+        self.log.info("Test the /logs URI")
+        logs = self.rest_request(f"/logs/{height}/{height}.json", query_params={"address": address})
+        assert_equal([r['transactionHash'] for r in logs], [txid])
+        assert_equal(logs, self.rest_request(f"/logs/{height}/{height}.json", query_params={"topic": TOPIC}))
+        assert_equal(self.rest_request(f"/logs/{height}/{height}.json", query_params={"topic": "cd" * 32}), [])
+        assert_equal(self.rest_request(f"/logs/0/{height}.json", query_params={"address": "00" * 20}), [])
+        assert_equal(self.rest_request(f"/logs/{height}/{height}.bin", query_params={"address": address}), raw)
+        self.rest_request(f"/logs/{height}/0.json", status=400)
+        self.rest_request(f"/logs/0/{height + 1000}.json", status=400)
+        self.rest_request(f"/logs/{height}.json", status=400)
+        self.rest_request(f"/logs/0/{height}.json", status=400, query_params={"address": "xyz"})
+
+        self.log.info("Test the /storage URI")
+        storage = node.getstorage(address)
+        assert_equal(self.rest_request(f"/storage/{address}.json"), storage)
+        raw = self.rest_request(f"/storage/{address}.bin")
+        assert_equal(raw[0], 1)
+        assert_equal(len(raw), 1 + 3 * 32)
+        assert_equal(raw[1:33].hex(), list(storage.keys())[0])
+        assert_equal(raw[65:97], (42).to_bytes(32, 'big'))
+        # The contract does not exist before it was created
+        self.rest_request(f"/storage/{address}.json", status=404, query_params={"height": height - 1})
+        self.rest_request(f"/storage/{address}.json", status=404, query_params={"height": height + 1})
+        self.rest_request(f"/storage/{'00' * 20}.json", status=404)
+        self.rest_request("/storage/abc.json", status=400)
+
+
+if __name__ == '__main__':
+    QtumRESTContractsTest().main()
@@ -82,8 +82,22 @@ class QtumBitcoreTest(BitcoinTestFramework):
         ret = node.getaddressdeltas({'addresses': [confirmed_address]})
         assert_equal(len(ret), 10)
 
+        # The latest deltas are read backwards from the end of the address entries
+        latest = node.getaddressdeltas({'addresses': [confirmed_address], 'limit': 3})
+        assert_equal(latest, ret[-3:])
+        assert_equal(node.getaddressdeltas({'addresses': [confirmed_address], 'start': ret[0]['height']}), ret)
+        assert_equal(node.getaddressdeltas({'addresses': [confirmed_address], 'start': ret[0]['height'] + 1}), [])
+
         ret = node.getaddressbalance({'addresses': [confirmed_address]})
         assert_equal(ret['balance'], 10000000000)
+        assert_equal(ret['received'], 10000000000)
+
+        # The running balance is rewound with the block that paid the address and restored with it
+        tip = node.getbestblockhash()
+        node.invalidateblock(tip)
+        assert_equal(node.getaddressbalance({'addresses': [confirmed_address]})['balance'], 0)
+        node.reconsiderblock(tip)
+        assert_equal(node.getaddressbalance({'addresses': [confirmed_address]}), ret)
 
         ret = node.getaddressutxos({'addresses': [confirmed_address]})
 
@@ -12,12 +12,19 @@ import sys
 class QtumRPCSearchlogsTest(BitcoinTestFramework):
     def add_options(self, parser):
         self.add_wallet_options(parser)
+        parser.add_argument("--logindex", action='store_true', dest="logindex",
+                            help="Search the logs through the bloom filters of -logindex")
 
     def set_test_params(self):
         self.setup_clean_chain = True
         self.num_nodes = 1
         self.extra_args = [["-logevents"]]
 
+    def setup_network(self):
+        if self.options.logindex:
+            self.extra_args[0].append("-logindex")
+        self.setup_nodes()
+
     def skip_test_if_missing_module(self):
         self.skip_if_no_wallet()
 
@@ -85,6 +92,23 @@ class QtumRPCSearchlogsTest(BitcoinTestFramework):
 
         assert_equal(self.nodes[0].searchlogs(604,604,addresses,topics),[])
 
+        self.log.info("Page through the logs one receipt at a time")
+        all_receipts = self.nodes[0].searchlogs(0, -1)
+        paged_receipts = []
+        options = {"limit": 1}
+        while True:
+            page = self.nodes[0].searchlogspage(0, -1, None, None, 0, options)
+            assert len(page["receipts"]) <= 1
+            paged_receipts += page["receipts"]
+            if "cursor" not in page:
+                break
+            options["cursor"] = page["cursor"]
+        key = lambda r: (r["blockNumber"], r["transactionIndex"], r["outputIndex"])
+        assert len(paged_receipts) > 1
+        assert_equal(paged_receipts, sorted(all_receipts, key=key))
+        assert_equal(self.nodes[0].searchlogspage(604, 604, addresses, topics)["receipts"], [])
+        assert_raises_rpc_error(-8, "Invalid cursor", self.nodes[0].searchlogspage, 0, -1, None, None, 0, {"cursor": "00"})
+
 
 if __name__ == '__main__':
     QtumRPCSearchlogsTest().main()
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+# Copyright (c) 2015-2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the ZMQ contract receipt and contract log notifications."""
+import struct
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    p2p_port,
+)
+from test_framework.qtumconfig import COINBASE_MATURITY
+
+# Test may be skipped and not have zmq installed
+try:
+    import zmq
+except ImportError:
+    pass
+
+TOPIC = "ab" * 32
+# Constructor that emits LOG1(TOPIC) with the 32-byte word 42 as data
+LOG_BYTECODE = "602a600052" + "7f" + TOPIC + "6020" + "6000" + "a1" + "00"
+
+
+class QtumZMQReceiptsTest(BitcoinTestFramework):
+    def add_options(self, parser):
+        self.add_wallet_options(parser)
+
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.zmq_port_base = p2p_port(self.num_nodes + 1)
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_py3_zmq()
+        self.skip_if_no_bitcoind_zmq()
+        self.skip_if_no_wallet()
+
+    def receive(self, socket, topic):
+        received_topic, body, seq = socket.recv_multipart()
+        assert_equal(received_topic, topic)
+        return body
+
+    def deploy(self):
+        node = self.nodes[0]
+        txid = node.createcontract(LOG_BYTECODE)['txid']
+        blockhash = self.generate(node, 1)[0]
+        return txid, blockhash
+
+    def run_test(self):
+        node = self.nodes[0]
+        address = f"tcp://127.0.0.1:{self.zmq_port_base}"
+        self.restart_node(0, [f"-zmqpubreceipt={address}", f"-zmqpubcontractlog={address}"])
+        self.generate(node, COINBASE_MATURITY + 100)
+
+        self.ctx = zmq.Context()
+        try:
+            receipts = self.ctx.socket(zmq.SUB)
+            receipts.setsockopt(zmq.SUBSCRIBE, b"receipt")
+            logs = self.ctx.socket(zmq.SUB)
+            logs.setsockopt(zmq.SUBSCRIBE, b"contractlog")
+            for socket in (receipts, logs):
+                socket.set(zmq.RCVTIMEO, 1000)
+                socket.connect(address)
+
+            self.log.info("Deploy contracts until the subscribers are connected")
+            while True:
+                txid, blockhash = self.deploy()
+                try:
+                    body = self.receive(receipts, b"receipt")
+                    break
+                except zmq.error.Again:
+                    self.log.debug("Didn't receive the receipt, trying again.")
+            for socket in (receipts, logs):
+                socket.set(zmq.RCVTIMEO, 60000)
+
+            self.log.info("Check the receipt of the last contract")
+            # Later subscribers can miss the receipts of earlier blocks, skip anything older
+            while body[1:33][::-1].hex() != blockhash:
+                body = self.receive(receipts, b"receipt")
+            assert_equal(body[0:1], b"C")
+            height, = struct.unpack("<I", body[33:37])
+            assert_equal(height, node.getblockcount())
+            assert_equal(body[37:69][::-1].hex(), txid)
+            receipt = node.gettransactionreceipt(txid)[0]
+            assert_equal(body[77 + 40:77 + 60].hex(), receipt['contractAddress'])
+            gas_used, = struct.unpack("<Q", body[137:145])
+            assert_equal(gas_used, receipt['gasUsed'])
+            log_count, = struct.unpack("<I", body[-4:])
+            assert_equal(log_count, 1)
+
+            self.log.info("Check the log entry of the last contract")
+            body = self.receive(logs, b"contractlog")
+            while body[1:33][::-1].hex() != blockhash:
+                body = self.receive(logs, b"contractlog")
+            assert_equal(body[0:1], b"C")
+            assert_equal(body[37:69][::-1].hex(), txid)
+            assert_equal(body[77:97].hex(), receipt['contractAddress'])
+            assert_equal(body[97], 1)
+            assert_equal(body[98:130].hex(), TOPIC)
+            assert_equal(body[130], 32)
+            assert_equal(body[131:163], (42).to_bytes(32, 'big'))
+
+            self.log.info("Check the disconnect notifications")
+            node.invalidateblock(blockhash)
+            for socket, topic in ((receipts, b"receipt"), (logs, b"contractlog")):
+                body = self.receive(socket, topic)
+                assert_equal(body[0:1], b"D")
+                assert_equal(body[1:33][::-1].hex(), blockhash)
+                assert_equal(struct.unpack("<I", body[33:37])[0], height)
+        finally:
+            self.ctx.destroy(linger=None)
+
+
+if __name__ == '__main__':
+    QtumZMQReceiptsTest().main()
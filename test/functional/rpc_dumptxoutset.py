@@ -57,6 +57,15 @@ class DumptxoutsetTest(BitcoinTestFramework):
         assert_raises_rpc_error(
             -8, "Couldn't open file {}.incomplete for writing".format(invalid_path), node.dumptxoutset, invalid_path)
 
+        # The chunked format holds the same coins, with a header telling it apart from the legacy format.
+        out_chunked = node.dumptxoutset('txoutset_chunked.dat', 'chunked')
+        assert_equal(out_chunked['coins_written'], out['coins_written'])
+        assert_equal(out_chunked['txoutset_hash'], out['txoutset_hash'])
+        with open(out_chunked['path'], 'rb') as f:
+            assert_equal(f.read(6), b'qutxo\xff')
+        assert_raises_rpc_error(
+            -8, "Unknown snapshot format: zip", node.dumptxoutset, 'txoutset_zip.dat', 'zip')
+
 
 if __name__ == '__main__':
     DumptxoutsetTest().main()
@@ -183,5 +183,14 @@ class GetblockstatsTest(BitcoinTestFramework):
         assert_equal(tip_stats["utxo_increase_actual"], 4)
         assert_equal(tip_stats["utxo_size_inc_actual"], 300)
 
-if __name__ == '__main__':
+        self.log.info('Test the stats read from -blockstatsindex')
+        self.restart_node(0, extra_args=['-blockstatsindex'])
+        self.wait_until(lambda: self.nodes[0].getindexinfo('blockstatsindex')['blockstatsindex']['synced'])
+        assert_equal(self.get_stats(), self.expected_stats)
+        assert_equal(self.nodes[0].getblockstats(0), genesis_stats)
+        assert_equal(self.nodes[0].getblockstats(tip), tip_stats)
+        assert_equal(self.nodes[0].getblockstats(hash_or_height=tip, stats=['minfee', 'maxfee']),
+                     {'minfee': tip_stats['minfee'], 'maxfee': tip_stats['maxfee']})
+
+if __name == '__main__':
     GetblockstatsTest().main()
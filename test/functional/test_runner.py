@@ -168,6 +168,10 @@ BASE_SCRIPTS = [
     'wallet_keypool_topup.py --descriptors',
     'wallet_fast_rescan.py --descriptors',
     'interface_zmq.py',
+    'qtum_zmq_receipts.py --legacy-wallet',
+    'qtum_zmq_receipts.py --descriptors',
+    'qtum_rest_contracts.py --legacy-wallet',
+    'qtum_rest_contracts.py --descriptors',
     'rpc_invalid_address_message.py',
     'rpc_validateaddress.py',
     'interface_bitcoin_cli.py --legacy-wallet',
@@ -196,6 +200,7 @@ BASE_SCRIPTS = [
     'wallet_reorgsrestore.py',
     'interface_http.py',
     'interface_rpc.py',
+    'interface_rpc_work_queues.py',
     'interface_usdt_coinselection.py',
     'interface_usdt_mempool.py',
     'interface_usdt_net.py',
@@ -382,6 +387,7 @@ BASE_SCRIPTS = [
     'qtum_gas_limit.py --descriptors',
     'qtum_searchlog.py --legacy-wallet',
     'qtum_searchlog.py --descriptors',
+    'qtum_searchlog.py --descriptors --logindex',
     'qtum_pos_segwit.py --legacy-wallet',
     'qtum_pos_segwit.py --descriptors',
     'qtum_state_root.py --legacy-wallet',